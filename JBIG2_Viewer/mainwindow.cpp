@@ -36,6 +36,8 @@
 #include <QMessageBox>
 #include <QElapsedTimer>
 
+#include <limits>
+
 MainWindow::MainWindow(QWidget* parent) :
     QMainWindow(parent),
     ui(new Ui::MainWindow)
@@ -136,6 +138,63 @@ void MainWindow::on_actionAdd_JBIG2_image_triggered()
     }
 }
 
+void MainWindow::on_actionBenchmark_JBIG2_image_triggered()
+{
+    QString fileName = QFileDialog::getOpenFileName(this, tr("Open image"), m_directory, QString("JBIG2 image (*.jb2)"));
+    if (QFile::exists(fileName))
+    {
+        QFile file(fileName);
+        if (file.open(QFile::ReadOnly))
+        {
+            m_directory = QFileInfo(file).filePath();
+            QByteArray fileContentData = file.readAll();
+            file.close();
+
+            try
+            {
+                // Decode the image repeatedly, until we have enough samples
+                // to get stable results, but do not run too long.
+                constexpr int MAX_ITERATIONS = 50;
+                constexpr qint64 MAX_TIME_NS = 5000000000LL;
+
+                qint64 totalTime = 0;
+                qint64 minimalTime = std::numeric_limits<qint64>::max();
+                int iterations = 0;
+
+                while (iterations < MAX_ITERATIONS && totalTime < MAX_TIME_NS)
+                {
+                    pdf::PDFJBIG2Decoder decoder(fileContentData, QByteArray(), this);
+
+                    QElapsedTimer timer;
+                    timer.start();
+                    pdf::PDFImageData imageData = decoder.decodeFileStream();
+                    const qint64 time = timer.nsecsElapsed();
+
+                    if (!imageData.isValid())
+                    {
+                        break;
+                    }
+
+                    totalTime += time;
+                    minimalTime = qMin(minimalTime, time);
+                    ++iterations;
+                }
+
+                if (iterations > 0)
+                {
+                    const double averageTime = double(totalTime) / iterations / 1000000.0;
+                    QString message = tr("%1\nIterations: %2\nAverage time: %3 [msec]\nMinimal time: %4 [msec]").arg(QFileInfo(file).fileName()).arg(iterations).arg(averageTime, 0, 'f', 3).arg(double(minimalTime) / 1000000.0, 0, 'f', 3);
+                    QMessageBox::information(this, tr("Benchmark"), message);
+                }
+            }
+            catch (const pdf::PDFException& exception)
+            {
+                QMessageBox::critical(this, tr("Error"), exception.getMessage());
+            }
+        }
+    }
+}
+
 void MainWindow::reportRenderErrorOnce(pdf::RenderErrorType type, QString message)
 {
     Q_UNUSED(type);
@@ -24,6 +24,7 @@ private slots:
     void on_actionAddImage_triggered();
     void on_actionClear_triggered();
     void on_actionAdd_JBIG2_image_triggered();
+    void on_actionBenchmark_JBIG2_image_triggered();
 
 private:
     void addImage(QString title, QImage image);
@@ -0,0 +1,109 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pdfbenchmarksuite.h"
+#include "pdfconstants.h"
+
+#include <QFile>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QTextStream>
+#include <QGuiApplication>
+#include <QCommandLineParser>
+
+int main(int argc, char *argv[])
+{
+    // Benchmarks don't need any display, so offscreen platform is used by default
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+    {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QGuiApplication a(argc, argv);
+    QCoreApplication::setOrganizationName("MelkaJ");
+    QCoreApplication::setApplicationName("Pdf4QtBenchmarks");
+    QCoreApplication::setApplicationVersion(pdf::PDF_LIBRARY_VERSION);
+
+    QCommandLineOption corpusOption("corpus", "Directory with pdf documents, which are benchmarked together with synthetic data.", "directory");
+    QCommandLineOption outputOption("output", "Output file for results in JSON format (standard output is used, if not set).", "file");
+    QCommandLineOption iterationsOption("iterations", "Number of measured iterations of each benchmark.", "count", "5");
+    QCommandLineOption warmupOption("warmup", "Number of warmup iterations of each benchmark.", "count", "1");
+    QCommandLineOption filterOption("filter", "Regular expression, only benchmarks with matching name (category/name) are executed.", "regexp");
+    QCommandLineOption noSyntheticOption("no-synthetic", "Do not run benchmarks on synthetic data.");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Pdf4QtBenchmarks - benchmark suite of the pdf library");
+    parser.addOption(corpusOption);
+    parser.addOption(outputOption);
+    parser.addOption(iterationsOption);
+    parser.addOption(warmupOption);
+    parser.addOption(filterOption);
+    parser.addOption(noSyntheticOption);
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.process(QCoreApplication::arguments());
+
+    pdfbenchmarks::PDFBenchmarkSuite::Settings settings;
+    settings.corpusDirectory = parser.value(corpusOption);
+    settings.filter = QRegularExpression(parser.value(filterOption));
+    settings.iterations = qMax(parser.value(iterationsOption).toInt(), 1);
+    settings.warmupIterations = qMax(parser.value(warmupOption).toInt(), 0);
+    settings.synthetic = !parser.isSet(noSyntheticOption);
+
+    if (!settings.filter.isValid())
+    {
+        QTextStream(stderr) << QString("Invalid filter: %1").arg(settings.filter.errorString()) << Qt::endl;
+        return 1;
+    }
+
+    pdfbenchmarks::PDFBenchmarkSuite suite(qMove(settings));
+    suite.run();
+
+    QJsonObject results = suite.getResults();
+    results["version"] = QString(pdf::PDF_LIBRARY_VERSION);
+    results["qt"] = QString(qVersion());
+    results["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+
+    const QByteArray json = QJsonDocument(results).toJson(QJsonDocument::Indented);
+
+    if (parser.isSet(outputOption))
+    {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QFile::WriteOnly | QFile::Truncate))
+        {
+            QTextStream(stderr) << QString("Can't write results to file '%1'.").arg(file.fileName()) << Qt::endl;
+            return 1;
+        }
+
+        file.write(json);
+        file.close();
+    }
+    else
+    {
+        QFile file;
+        file.open(stdout, QFile::WriteOnly);
+        file.write(json);
+    }
+
+    return 0;
+}
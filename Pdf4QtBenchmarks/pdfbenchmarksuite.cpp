@@ -0,0 +1,952 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pdfbenchmarksuite.h"
+#include "pdfparser.h"
+#include "pdfstreamfilters.h"
+#include "pdfdocumentreader.h"
+#include "pdfdocumentwriter.h"
+#include "pdfdocumentbuilder.h"
+#include "pdfconstants.h"
+#include "pdfcolorspaces.h"
+#include "pdfimage.h"
+#include "pdfcms.h"
+#include "pdffont.h"
+#include "pdfrenderer.h"
+#include "pdfoptionalcontent.h"
+#include "pdftextlayoutgenerator.h"
+#include "pdfdiff.h"
+#include "pdfexception.h"
+
+#include <QDir>
+#include <QFile>
+#include <QBuffer>
+#include <QPainter>
+#include <QElapsedTimer>
+#include <QCryptographicHash>
+#include <QRandomGenerator>
+#include <QTextStream>
+
+#include <map>
+#include <atomic>
+#include <numeric>
+#include <algorithm>
+
+namespace pdfbenchmarks
+{
+
+namespace
+{
+
+/// Fetcher of objects of the storage (references are dereferenced)
+pdf::PDFObjectFetcher createObjectFetcher(const pdf::PDFObjectStorage& storage)
+{
+    return [&storage](const pdf::PDFObject& object) -> const pdf::PDFObject& { return storage.getObject(object); };
+}
+
+/// Returns name of the first filter of the stream, or "None", if stream is not filtered
+QByteArray getFirstFilterName(const pdf::PDFObjectStorage& storage, const pdf::PDFStream* stream)
+{
+    const pdf::PDFObject& filterObject = storage.getObject(stream->getDictionary()->get("Filter"));
+
+    if (filterObject.isName())
+    {
+        return filterObject.getString();
+    }
+
+    if (filterObject.isArray() && filterObject.getArray()->getCount() > 0)
+    {
+        const pdf::PDFObject& firstFilterObject = storage.getObject(filterObject.getArray()->getItem(0));
+        if (firstFilterObject.isName())
+        {
+            return firstFilterObject.getString();
+        }
+    }
+
+    return "None";
+}
+
+QByteArray encodeAscii85(const QByteArray& data)
+{
+    QByteArray result;
+    result.reserve(data.size() * 5 / 4 + 8);
+
+    for (qsizetype i = 0; i < data.size(); i += 4)
+    {
+        const qsizetype count = std::min<qsizetype>(4, data.size() - i);
+        quint32 value = 0;
+        for (qsizetype j = 0; j < 4; ++j)
+        {
+            value = (value << 8) | (j < count ? quint8(data[i + j]) : 0);
+        }
+
+        if (value == 0 && count == 4)
+        {
+            result.append('z');
+            continue;
+        }
+
+        char encoded[5] = { };
+        for (int j = 4; j >= 0; --j)
+        {
+            encoded[j] = char('!' + value % 85);
+            value /= 85;
+        }
+        result.append(encoded, count + 1);
+    }
+
+    result.append("~>");
+    return result;
+}
+
+QByteArray encodeRunLength(const QByteArray& data)
+{
+    QByteArray result;
+    result.reserve(data.size() + data.size() / 128 + 2);
+
+    qsizetype i = 0;
+    while (i < data.size())
+    {
+        qsizetype run = 1;
+        while (i + run < data.size() && run < 128 && data[i + run] == data[i])
+        {
+            ++run;
+        }
+
+        if (run > 1)
+        {
+            result.append(char(257 - run));
+            result.append(data[i]);
+            i += run;
+            continue;
+        }
+
+        qsizetype literal = 1;
+        while (i + literal < data.size() && literal < 128 && (i + literal + 1 >= data.size() || data[i + literal] != data[i + literal + 1]))
+        {
+            ++literal;
+        }
+
+        result.append(char(literal - 1));
+        result.append(data.constData() + i, literal);
+        i += literal;
+    }
+
+    result.append(char(128));
+    return result;
+}
+
+/// Synthetic image data: smooth gradients with noise, so compression
+/// and decompression behave similarly as on real images.
+QByteArray generateImageData(int width, int height, int components)
+{
+    QRandomGenerator generator(42);
+    QByteArray result(qsizetype(width) * height * components, 0);
+
+    char* data = result.data();
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            for (int c = 0; c < components; ++c)
+            {
+                const int value = (x * (c + 1) + y * (components - c)) % 256 + int(generator.bounded(8));
+                *data++ = char(std::clamp(value, 0, 255));
+            }
+        }
+    }
+
+    return result;
+}
+
+}   // namespace
+
+PDFBenchmarkSuite::PDFBenchmarkSuite(Settings settings) :
+    m_settings(qMove(settings))
+{
+
+}
+
+void PDFBenchmarkSuite::run()
+{
+    m_results.clear();
+
+    if (m_settings.synthetic)
+    {
+        runLexerAndParserBenchmarks();
+        runStreamFilterBenchmarks();
+        runColorConversionBenchmarks();
+
+        pdf::PDFDocument document = generateDocument(16);
+        runDocumentBenchmarks("synthetic", document);
+    }
+
+    loadCorpus();
+
+    for (CorpusDocument& corpusDocument : m_corpus)
+    {
+        runDocumentBenchmarks(corpusDocument.fileName, corpusDocument.document);
+    }
+}
+
+QJsonObject PDFBenchmarkSuite::getResults() const
+{
+    QJsonArray corpus;
+    for (const CorpusDocument& corpusDocument : m_corpus)
+    {
+        QJsonObject item;
+        item["file"] = corpusDocument.fileName;
+        item["sha256"] = QString::fromLatin1(corpusDocument.hash.toHex());
+        item["pages"] = qint64(corpusDocument.document.getCatalog()->getPageCount());
+        corpus.append(item);
+    }
+
+    QJsonArray benchmarks;
+    for (const BenchmarkResult& result : m_results)
+    {
+        QJsonObject item;
+        item["category"] = result.category;
+        item["name"] = result.name;
+        item["iterations"] = result.iterations;
+        item["min_ns"] = result.minimalTime;
+        item["median_ns"] = result.medianTime;
+        item["mean_ns"] = result.meanTime;
+
+        if (result.bytes > 0)
+        {
+            item["bytes"] = result.bytes;
+
+            if (result.medianTime > 0)
+            {
+                item["throughput_mb_s"] = double(result.bytes) / double(result.medianTime) * 1.0e9 / (1024.0 * 1024.0);
+            }
+        }
+
+        if (!result.counters.isEmpty())
+        {
+            item["counters"] = result.counters;
+        }
+
+        benchmarks.append(item);
+    }
+
+    QJsonObject settings;
+    settings["iterations"] = m_settings.iterations;
+    settings["warmup"] = m_settings.warmupIterations;
+    settings["filter"] = m_settings.filter.pattern();
+    settings["synthetic"] = m_settings.synthetic;
+
+    QJsonObject results;
+    results["settings"] = settings;
+    results["corpus"] = corpus;
+    results["benchmarks"] = benchmarks;
+    return results;
+}
+
+void PDFBenchmarkSuite::execute(QString category, QString name, qint64 bytes, const BenchmarkFunction& function, QJsonObject counters)
+{
+    const QString fullName = QString("%1/%2").arg(category, name);
+    if (!m_settings.filter.pattern().isEmpty() && !m_settings.filter.match(fullName).hasMatch())
+    {
+        return;
+    }
+
+    QTextStream errorStream(stderr);
+    errorStream << fullName << Qt::endl;
+
+    std::vector<qint64> times;
+    times.reserve(m_settings.iterations);
+
+    try
+    {
+        for (int i = 0; i < m_settings.warmupIterations; ++i)
+        {
+            function();
+        }
+
+        for (int i = 0; i < m_settings.iterations; ++i)
+        {
+            QElapsedTimer timer;
+            timer.start();
+            function();
+            times.push_back(timer.nsecsElapsed());
+        }
+    }
+    catch (const pdf::PDFException& exception)
+    {
+        counters["error"] = exception.getMessage();
+    }
+
+    BenchmarkResult result;
+    result.category = qMove(category);
+    result.name = qMove(name);
+    result.iterations = int(times.size());
+    result.bytes = bytes;
+    result.counters = qMove(counters);
+
+    if (!times.empty())
+    {
+        std::sort(times.begin(), times.end());
+        result.minimalTime = times.front();
+        result.medianTime = times[times.size() / 2];
+        result.meanTime = std::accumulate(times.cbegin(), times.cend(), qint64(0)) / qint64(times.size());
+    }
+
+    m_results.emplace_back(qMove(result));
+}
+
+void PDFBenchmarkSuite::loadCorpus()
+{
+    m_corpus.clear();
+
+    if (m_settings.corpusDirectory.isEmpty())
+    {
+        return;
+    }
+
+    QDir directory(m_settings.corpusDirectory);
+    const QStringList fileNames = directory.entryList(QStringList() << "*.pdf", QDir::Files, QDir::Name);
+
+    for (const QString& fileName : fileNames)
+    {
+        QFile file(directory.absoluteFilePath(fileName));
+        if (!file.open(QFile::ReadOnly))
+        {
+            QTextStream(stderr) << QString("Can't open file '%1'.").arg(fileName) << Qt::endl;
+            continue;
+        }
+
+        QByteArray buffer = file.readAll();
+        file.close();
+
+        pdf::PDFDocumentReader reader(nullptr, [](bool* ok) { *ok = false; return QString(); }, true, false);
+        pdf::PDFDocument document = reader.readFromBuffer(buffer);
+
+        if (reader.getReadingResult() != pdf::PDFDocumentReader::Result::OK)
+        {
+            QTextStream(stderr) << QString("Can't read document '%1': %2").arg(fileName, reader.getErrorMessage()) << Qt::endl;
+            continue;
+        }
+
+        CorpusDocument corpusDocument;
+        corpusDocument.fileName = fileName;
+        corpusDocument.hash = QCryptographicHash::hash(buffer, QCryptographicHash::Sha256);
+        corpusDocument.document = qMove(document);
+        m_corpus.emplace_back(qMove(corpusDocument));
+    }
+}
+
+void PDFBenchmarkSuite::runLexerAndParserBenchmarks()
+{
+    for (const int operatorCount : { 1000, 100000 })
+    {
+        const QByteArray contentStream = generateContentStream(operatorCount);
+
+        QJsonObject counters;
+        counters["operators"] = operatorCount;
+
+        execute("lexer", QString("content-stream-%1").arg(operatorCount), contentStream.size(), [&contentStream]()
+        {
+            pdf::PDFLexicalAnalyzer analyzer(contentStream.constData(), contentStream.constData() + contentStream.size());
+            pdf::PDFLexicalAnalyzer::TypedToken token;
+
+            do
+            {
+                analyzer.fetch(token);
+            }
+            while (token.type != pdf::PDFLexicalAnalyzer::TokenType::EndOfFile);
+        }, counters);
+    }
+
+    for (const int objectCount : { 100, 10000 })
+    {
+        const QByteArray objects = generateObjects(objectCount);
+
+        QJsonObject counters;
+        counters["objects"] = objectCount;
+
+        execute("parser", QString("objects-%1").arg(objectCount), objects.size(), [&objects]()
+        {
+            pdf::PDFParser parser(objects, nullptr, pdf::PDFParser::None);
+            pdf::PDFObject object = parser.getObject();
+            Q_UNUSED(object);
+        }, counters);
+    }
+}
+
+void PDFBenchmarkSuite::runStreamFilterBenchmarks()
+{
+    const QByteArray imageData = generateImageData(1024, 1024, 3);
+    const QByteArray contentStream = generateContentStream(100000);
+    const pdf::PDFObjectFetcher objectFetcher = [](const pdf::PDFObject& object) -> const pdf::PDFObject& { return object; };
+
+    struct InputData
+    {
+        QString name;
+        const QByteArray* data;
+    };
+
+    for (const InputData& input : { InputData{ "image", &imageData }, InputData{ "content", &contentStream } })
+    {
+        const QByteArray& data = *input.data;
+
+        execute("filter", QString("flate-encode-%1").arg(input.name), data.size(), [&data]()
+        {
+            QByteArray compressedData = pdf::PDFFlateDecodeFilter::compress(data);
+            Q_UNUSED(compressedData);
+        });
+
+        const QByteArray flateData = pdf::PDFFlateDecodeFilter::compress(data);
+        execute("filter", QString("flate-decode-%1").arg(input.name), data.size(), [&]()
+        {
+            pdf::PDFFlateDecodeFilter filter;
+            QByteArray decodedData = filter.apply(flateData, objectFetcher, pdf::PDFObject(), nullptr);
+            Q_UNUSED(decodedData);
+        });
+
+        const QByteArray asciiHexData = data.toHex() + ">";
+        execute("filter", QString("asciihex-decode-%1").arg(input.name), data.size(), [&]()
+        {
+            pdf::PDFAsciiHexDecodeFilter filter;
+            QByteArray decodedData = filter.apply(asciiHexData, objectFetcher, pdf::PDFObject(), nullptr);
+            Q_UNUSED(decodedData);
+        });
+
+        const QByteArray ascii85Data = encodeAscii85(data);
+        execute("filter", QString("ascii85-decode-%1").arg(input.name), data.size(), [&]()
+        {
+            pdf::PDFAscii85DecodeFilter filter;
+            QByteArray decodedData = filter.apply(ascii85Data, objectFetcher, pdf::PDFObject(), nullptr);
+            Q_UNUSED(decodedData);
+        });
+
+        const QByteArray runLengthData = encodeRunLength(data);
+        execute("filter", QString("runlength-decode-%1").arg(input.name), data.size(), [&]()
+        {
+            pdf::PDFRunLengthDecodeFilter filter;
+            QByteArray decodedData = filter.apply(runLengthData, objectFetcher, pdf::PDFObject(), nullptr);
+            Q_UNUSED(decodedData);
+        });
+    }
+}
+
+void PDFBenchmarkSuite::runColorConversionBenchmarks()
+{
+    constexpr unsigned int width = 1024;
+    constexpr unsigned int height = 1024;
+
+    pdf::PDFCMSManager cmsManager(nullptr);
+    pdf::PDFCMSPointer cms = cmsManager.getCurrentCMS();
+    pdf::PDFRenderErrorReporterDummy reporter;
+
+    struct ColorSpaceInfo
+    {
+        const char* name;
+        unsigned int components;
+    };
+
+    for (const ColorSpaceInfo& info : { ColorSpaceInfo{ pdf::COLOR_SPACE_NAME_DEVICE_GRAY, 1 },
+                                        ColorSpaceInfo{ pdf::COLOR_SPACE_NAME_DEVICE_RGB, 3 },
+                                        ColorSpaceInfo{ pdf::COLOR_SPACE_NAME_DEVICE_CMYK, 4 } })
+    {
+        pdf::PDFColorSpacePointer colorSpace = pdf::PDFAbstractColorSpace::createDeviceColorSpaceByName(nullptr, nullptr, info.name);
+        pdf::PDFImageData imageData(info.components, 8, width, height, width * info.components, pdf::PDFImageData::MaskingType::None,
+                                    generateImageData(width, height, info.components), { }, { }, { });
+
+        QString name = QString::fromLatin1(info.name).toLower();
+        execute("color", QString("%1-image").arg(name), imageData.getData().size(), [&]()
+        {
+            QImage image = colorSpace->getImage(imageData, pdf::PDFImageData(), cms.data(), pdf::RenderingIntent::Perceptual, &reporter, nullptr);
+            Q_UNUSED(image);
+        });
+    }
+}
+
+void PDFBenchmarkSuite::runDocumentBenchmarks(const QString& documentName, pdf::PDFDocument& document)
+{
+    QByteArray buffer;
+    {
+        QBuffer device(&buffer);
+        device.open(QBuffer::WriteOnly);
+        pdf::PDFDocumentWriter writer(nullptr);
+        writer.write(&device, &document);
+    }
+
+    execute("document", QString("read-%1").arg(documentName), buffer.size(), [&buffer]()
+    {
+        pdf::PDFDocumentReader reader(nullptr, [](bool* ok) { *ok = false; return QString(); }, true, false);
+        pdf::PDFDocument readDocument = reader.readFromBuffer(buffer);
+
+        if (reader.getReadingResult() != pdf::PDFDocumentReader::Result::OK)
+        {
+            throw pdf::PDFException(reader.getErrorMessage());
+        }
+    });
+
+    // Decode all streams of the document, grouped by the first filter
+    const pdf::PDFObjectStorage& storage = document.getStorage();
+    const pdf::PDFObjectFetcher objectFetcher = createObjectFetcher(storage);
+
+    std::map<QByteArray, std::vector<const pdf::PDFStream*>> streamsByFilter;
+    for (const pdf::PDFObjectStorage::Entry& entry : storage.getObjects())
+    {
+        if (entry.object.isStream())
+        {
+            // Image filters are measured by image decoder benchmarks
+            const pdf::PDFStream* stream = entry.object.getStream();
+            QByteArray filterName = getFirstFilterName(storage, stream);
+            if (filterName != "DCTDecode" && filterName != "JPXDecode" && filterName != "JBIG2Decode" && filterName != "CCITTFaxDecode")
+            {
+                streamsByFilter[filterName].push_back(stream);
+            }
+        }
+    }
+
+    for (const auto& [filterName, streams] : streamsByFilter)
+    {
+        qint64 bytes = 0;
+        for (const pdf::PDFStream* stream : streams)
+        {
+            bytes += stream->getContent()->size();
+        }
+
+        QJsonObject counters;
+        counters["streams"] = qint64(streams.size());
+
+        execute("stream", QString("%1-%2").arg(QString::fromLatin1(filterName).toLower(), documentName), bytes, [&]()
+        {
+            for (const pdf::PDFStream* stream : streams)
+            {
+                QByteArray decodedData = pdf::PDFStreamFilterStorage::getDecodedStream(stream, objectFetcher, storage.getSecurityHandler());
+                Q_UNUSED(decodedData);
+            }
+        }, counters);
+    }
+
+    runImageDecoderBenchmarks(documentName, document);
+    runFontRealizationBenchmarks(documentName, document);
+    runRenderingBenchmarks(documentName, document);
+    runTextLayoutBenchmarks(documentName, document);
+    runDiffBenchmarks(documentName, document);
+}
+
+void PDFBenchmarkSuite::runImageDecoderBenchmarks(const QString& documentName, const pdf::PDFDocument& document)
+{
+    const pdf::PDFObjectStorage& storage = document.getStorage();
+    pdf::PDFRenderErrorReporterDummy reporter;
+
+    struct ImageInfo
+    {
+        const pdf::PDFStream* stream = nullptr;
+        pdf::PDFColorSpacePointer colorSpace;
+    };
+
+    std::map<QByteArray, std::vector<ImageInfo>> imagesByFilter;
+    for (const pdf::PDFObjectStorage::Entry& entry : storage.getObjects())
+    {
+        if (!entry.object.isStream())
+        {
+            continue;
+        }
+
+        const pdf::PDFStream* stream = entry.object.getStream();
+        const pdf::PDFDictionary* dictionary = stream->getDictionary();
+        const pdf::PDFObject& subtypeObject = storage.getObject(dictionary->get("Subtype"));
+        if (!subtypeObject.isName() || subtypeObject.getString() != "Image")
+        {
+            continue;
+        }
+
+        ImageInfo info;
+        info.stream = stream;
+
+        try
+        {
+            const pdf::PDFObject& imageMaskObject = storage.getObject(dictionary->get("ImageMask"));
+            const bool isImageMask = imageMaskObject.isBool() && imageMaskObject.getBool();
+            const pdf::PDFObject& colorSpaceObject = dictionary->get("ColorSpace");
+
+            if (!isImageMask && !colorSpaceObject.isNull())
+            {
+                info.colorSpace = pdf::PDFAbstractColorSpace::createColorSpace(nullptr, &document, colorSpaceObject);
+            }
+        }
+        catch (const pdf::PDFException&)
+        {
+            continue;
+        }
+
+        imagesByFilter[getFirstFilterName(storage, stream)].push_back(qMove(info));
+    }
+
+    for (const auto& [filterName, images] : imagesByFilter)
+    {
+        qint64 bytes = 0;
+        for (const ImageInfo& info : images)
+        {
+            bytes += info.stream->getContent()->size();
+        }
+
+        QJsonObject counters;
+        counters["images"] = qint64(images.size());
+
+        execute("image", QString("%1-%2").arg(QString::fromLatin1(filterName).toLower(), documentName), bytes, [&]()
+        {
+            for (const ImageInfo& info : images)
+            {
+                pdf::PDFImage image = pdf::PDFImage::createImage(&document, info.stream, info.colorSpace, false, pdf::RenderingIntent::Perceptual, &reporter);
+                Q_UNUSED(image);
+            }
+        }, counters);
+    }
+}
+
+void PDFBenchmarkSuite::runFontRealizationBenchmarks(const QString& documentName, const pdf::PDFDocument& document)
+{
+    const pdf::PDFObjectStorage& storage = document.getStorage();
+    const pdf::PDFObjects& objects = storage.getObjects();
+    pdf::PDFRenderErrorReporterDummy reporter;
+
+    std::vector<std::pair<pdf::PDFObjectReference, const pdf::PDFObject*>> fontObjects;
+    for (size_t i = 0; i < objects.size(); ++i)
+    {
+        const pdf::PDFObject& object = objects[i].object;
+        if (!object.isDictionary())
+        {
+            continue;
+        }
+
+        const pdf::PDFDictionary* dictionary = object.getDictionary();
+        const pdf::PDFObject& typeObject = storage.getObject(dictionary->get("Type"));
+        const pdf::PDFObject& subtypeObject = storage.getObject(dictionary->get("Subtype"));
+
+        // Descendant fonts of the composite fonts are created together with their parent font
+        if (typeObject.isName() && typeObject.getString() == "Font" && subtypeObject.isName() &&
+            subtypeObject.getString() != "CIDFontType0" && subtypeObject.getString() != "CIDFontType2")
+        {
+            fontObjects.emplace_back(pdf::PDFObjectReference(pdf::PDFInteger(i), objects[i].generation), &object);
+        }
+    }
+
+    if (fontObjects.empty())
+    {
+        return;
+    }
+
+    QJsonObject counters;
+    counters["fonts"] = qint64(fontObjects.size());
+
+    std::vector<pdf::PDFFontPointer> fonts;
+    execute("font", QString("create-%1").arg(documentName), 0, [&]()
+    {
+        fonts.clear();
+        for (const auto& [reference, object] : fontObjects)
+        {
+            try
+            {
+                QByteArray fontId = QString("%1 %2 R").arg(reference.objectNumber).arg(reference.generation).toLatin1();
+                fonts.push_back(pdf::PDFFont::createFont(*object, qMove(fontId), &document));
+            }
+            catch (const pdf::PDFException&)
+            {
+                // Invalid fonts are skipped, the same way as in the renderer
+            }
+        }
+    }, counters);
+
+    execute("font", QString("realize-%1").arg(documentName), 0, [&]()
+    {
+        for (const pdf::PDFFontPointer& font : fonts)
+        {
+            try
+            {
+                pdf::PDFRealizedFontPointer realizedFont = pdf::PDFRealizedFont::createRealizedFont(font, 12.0, &reporter);
+                Q_UNUSED(realizedFont);
+            }
+            catch (const pdf::PDFException&)
+            {
+                // Invalid fonts are skipped, the same way as in the renderer
+            }
+        }
+    }, counters);
+}
+
+void PDFBenchmarkSuite::runRenderingBenchmarks(const QString& documentName, pdf::PDFDocument& document)
+{
+    const size_t pageCount = document.getCatalog()->getPageCount();
+    if (pageCount == 0)
+    {
+        return;
+    }
+
+    std::vector<pdf::PDFInteger> pageIndices(pageCount, 0);
+    std::iota(pageIndices.begin(), pageIndices.end(), 0);
+
+    pdf::PDFOptionalContentActivity optionalContentActivity(&document, pdf::OCUsage::View, nullptr);
+    pdf::PDFCMSManager cmsManager(nullptr);
+    cmsManager.setDocument(&document);
+
+    pdf::PDFFontCache fontCache(pdf::DEFAULT_FONT_CACHE_LIMIT, pdf::DEFAULT_REALIZED_FONT_CACHE_LIMIT);
+    pdf::PDFModifiedDocument modifiedDocument(&document, &optionalContentActivity);
+    fontCache.setDocument(modifiedDocument);
+    fontCache.setCacheShrinkEnabled(nullptr, false);
+
+    pdf::PDFMeshQualitySettings meshQualitySettings;
+
+    auto imageSizeGetter = [](const pdf::PDFPage* page) -> QSize
+    {
+        return (page->getRotatedMediaBox().size() * pdf::PDF_POINT_TO_INCH * 150.0).toSize();
+    };
+
+    struct EngineInfo
+    {
+        const char* name;
+        pdf::RendererEngine engine;
+    };
+
+    for (const EngineInfo& info : { EngineInfo{ "blend2d-mt", pdf::RendererEngine::Blend2D_MultiThread },
+                                    EngineInfo{ "blend2d-st", pdf::RendererEngine::Blend2D_SingleThread },
+                                    EngineInfo{ "qpainter", pdf::RendererEngine::QPainter } })
+    {
+        pdf::PDFRasterizerPool rasterizerPool(&document, &fontCache, &cmsManager, &optionalContentActivity,
+                                              pdf::PDFRenderer::getDefaultFeatures(), meshQualitySettings,
+                                              pdf::PDFRasterizerPool::getDefaultRasterizerCount(), info.engine, nullptr);
+
+        const QString name = QString("%1-%2").arg(QString::fromLatin1(info.name), documentName);
+        if (!m_settings.filter.pattern().isEmpty() && !m_settings.filter.match(QString("render/%1").arg(name)).hasMatch())
+        {
+            continue;
+        }
+
+        // Profiling pass - compile and render times are measured separately
+        // by the rasterizer pool, they are stored as counters of the benchmark.
+        std::atomic<qint64> compileTime = 0;
+        std::atomic<qint64> renderTime = 0;
+        std::atomic<qint64> instructionCount = 0;
+
+        auto profileImage = [&](pdf::PDFRenderedPageImage& image)
+        {
+            compileTime += image.pageCompileTime;
+            renderTime += image.pageRenderTime;
+            instructionCount += qint64(image.pageInstructionCount);
+        };
+        rasterizerPool.render(pageIndices, imageSizeGetter, profileImage, nullptr);
+
+        QJsonObject counters;
+        counters["pages"] = qint64(pageCount);
+        counters["compile_ms"] = compileTime.load();
+        counters["render_ms"] = renderTime.load();
+        counters["instructions"] = instructionCount.load();
+
+        execute("render", name, 0, [&]()
+        {
+            rasterizerPool.render(pageIndices, imageSizeGetter, [](pdf::PDFRenderedPageImage&) { }, nullptr);
+        }, counters);
+    }
+
+    fontCache.setCacheShrinkEnabled(nullptr, true);
+}
+
+void PDFBenchmarkSuite::runTextLayoutBenchmarks(const QString& documentName, pdf::PDFDocument& document)
+{
+    const size_t pageCount = document.getCatalog()->getPageCount();
+    if (pageCount == 0)
+    {
+        return;
+    }
+
+    pdf::PDFOptionalContentActivity optionalContentActivity(&document, pdf::OCUsage::View, nullptr);
+    pdf::PDFCMSManager cmsManager(nullptr);
+    cmsManager.setDocument(&document);
+    pdf::PDFCMSPointer cms = cmsManager.getCurrentCMS();
+
+    pdf::PDFFontCache fontCache(pdf::DEFAULT_FONT_CACHE_LIMIT, pdf::DEFAULT_REALIZED_FONT_CACHE_LIMIT);
+    pdf::PDFModifiedDocument modifiedDocument(&document, &optionalContentActivity);
+    fontCache.setDocument(modifiedDocument);
+    fontCache.setCacheShrinkEnabled(nullptr, false);
+
+    pdf::PDFMeshQualitySettings meshQualitySettings;
+
+    QJsonObject counters;
+    counters["pages"] = qint64(pageCount);
+
+    execute("text", QString("layout-%1").arg(documentName), 0, [&]()
+    {
+        for (size_t i = 0; i < pageCount; ++i)
+        {
+            const pdf::PDFPage* page = document.getCatalog()->getPage(i);
+            pdf::PDFTextLayoutGenerator generator(pdf::PDFRenderer::IgnoreOptionalContent, page, &document, &fontCache,
+                                                  cms.data(), &optionalContentActivity, QTransform(), meshQualitySettings);
+            generator.processContents();
+            pdf::PDFTextLayout textLayout = generator.createTextLayout();
+            Q_UNUSED(textLayout);
+        }
+    }, counters);
+
+    fontCache.setCacheShrinkEnabled(nullptr, true);
+}
+
+void PDFBenchmarkSuite::runDiffBenchmarks(const QString& documentName, const pdf::PDFDocument& document)
+{
+    const size_t pageCount = document.getCatalog()->getPageCount();
+    if (pageCount == 0)
+    {
+        return;
+    }
+
+    QJsonObject counters;
+    counters["pages"] = qint64(pageCount);
+
+    execute("diff", QString("self-%1").arg(documentName), 0, [&]()
+    {
+        pdf::PDFClosedIntervalSet pages;
+        pages.addInterval(0, pdf::PDFInteger(pageCount) - 1);
+
+        pdf::PDFDiff diff(nullptr);
+        diff.setOption(pdf::PDFDiff::Asynchronous, false);
+        diff.setLeftDocument(&document);
+        diff.setRightDocument(&document);
+        diff.setPagesForLeftDocument(pages);
+        diff.setPagesForRightDocument(pages);
+        diff.start();
+
+        if (!diff.getResult().getResult())
+        {
+            throw pdf::PDFException(diff.getResult().getResult().getErrorMessage());
+        }
+    }, counters);
+}
+
+QByteArray PDFBenchmarkSuite::generateContentStream(int operatorCount)
+{
+    QRandomGenerator generator(42);
+    QByteArray result;
+    QTextStream stream(&result, QIODevice::WriteOnly);
+    stream.setRealNumberPrecision(4);
+
+    auto coordinate = [&generator]() { return generator.bounded(595.0); };
+
+    int count = 0;
+    while (count < operatorCount)
+    {
+        switch (generator.bounded(6))
+        {
+            case 0:
+                stream << coordinate() << " " << coordinate() << " m " << coordinate() << " " << coordinate() << " l S\n";
+                count += 3;
+                break;
+
+            case 1:
+                stream << coordinate() << " " << coordinate() << " " << coordinate() << " " << coordinate() << " re f\n";
+                count += 2;
+                break;
+
+            case 2:
+                stream << "q 1 0 0 1 " << coordinate() << " " << coordinate() << " cm Q\n";
+                count += 3;
+                break;
+
+            case 3:
+                stream << generator.bounded(1.0) << " " << generator.bounded(1.0) << " " << generator.bounded(1.0) << " rg\n";
+                count += 1;
+                break;
+
+            case 4:
+                stream << "BT /F1 12 Tf " << coordinate() << " " << coordinate() << " Td (Lorem ipsum dolor sit amet) Tj ET\n";
+                count += 5;
+                break;
+
+            case 5:
+                stream << "BT /F1 10 Tf [(Con) -20 (sectetur) 15 <616469706973> -250 (elit)] TJ ET\n";
+                count += 4;
+                break;
+
+            default:
+                Q_ASSERT(false);
+                break;
+        }
+    }
+
+    stream.flush();
+    return result;
+}
+
+QByteArray PDFBenchmarkSuite::generateObjects(int objectCount)
+{
+    QRandomGenerator generator(42);
+    QByteArray result;
+    QTextStream stream(&result, QIODevice::WriteOnly);
+
+    stream << "[\n";
+    for (int i = 0; i < objectCount; ++i)
+    {
+        stream << "<< /Type /Annot /Subtype /Link /Rect [" << generator.bounded(595) << " " << generator.bounded(842) << " "
+               << generator.bounded(595.0) << " " << generator.bounded(842.0) << "] /Border [0 0 1] /F 4"
+               << " /Contents (Object number " << i << ") /P " << i + 1 << " 0 R /NM <" << QString::number(generator.generate(), 16) << ">"
+               << " /A << /S /URI /URI (https://example.com/" << i << ") >> /Hidden false >>\n";
+    }
+    stream << "]\n";
+
+    stream.flush();
+    return result;
+}
+
+pdf::PDFDocument PDFBenchmarkSuite::generateDocument(int pageCount)
+{
+    QRandomGenerator generator(42);
+
+    QImage image(256, 256, QImage::Format_RGB888);
+    const QByteArray imageData = generateImageData(image.width(), image.height(), 3);
+    for (int y = 0; y < image.height(); ++y)
+    {
+        std::copy_n(imageData.constData() + y * image.width() * 3, image.width() * 3, reinterpret_cast<char*>(image.scanLine(y)));
+    }
+
+    pdf::PDFDocumentBuilder builder;
+    pdf::PDFPageContentStreamBuilder pageContentStreamBuilder(&builder);
+
+    for (int pageIndex = 0; pageIndex < pageCount; ++pageIndex)
+    {
+        QPainter* painter = pageContentStreamBuilder.beginNewPage(QRectF(0, 0, 595, 842));
+
+        for (int i = 0; i < 40; ++i)
+        {
+            painter->setPen(QColor::fromRgb(generator.generate() & 0xFFFFFF));
+            painter->drawLine(QPointF(generator.bounded(595.0), generator.bounded(842.0)), QPointF(generator.bounded(595.0), generator.bounded(842.0)));
+            painter->fillRect(QRectF(generator.bounded(595.0), generator.bounded(842.0), generator.bounded(100.0), generator.bounded(100.0)), QColor::fromRgb(generator.generate() & 0xFFFFFF));
+        }
+
+        painter->setPen(Qt::black);
+        for (int line = 0; line < 50; ++line)
+        {
+            painter->drawText(QPointF(40, 40 + line * 15), QString("Page %1, line %2: Lorem ipsum dolor sit amet, consectetur adipiscing elit.").arg(pageIndex + 1).arg(line + 1));
+        }
+
+        painter->drawImage(QRectF(300, 500, 256, 256), image);
+        pageContentStreamBuilder.end(painter);
+    }
+
+    return builder.build();
+}
+
+}   // namespace pdfbenchmarks
@@ -0,0 +1,125 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef PDFBENCHMARKSUITE_H
+#define PDFBENCHMARKSUITE_H
+
+#include "pdfdocument.h"
+
+#include <QString>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QRegularExpression>
+
+#include <vector>
+#include <functional>
+
+namespace pdfbenchmarks
+{
+
+/// Benchmark suite covering parsing, stream filters, image decoders, color
+/// conversion, font realization, page compilation and drawing, text layout
+/// and document comparison. Benchmarks run on synthetic data created by
+/// deterministic generators (so they are reproducible between commits), and
+/// optionally on documents of the corpus directory. Results are written
+/// in JSON format, which can be compared between commits.
+class PDFBenchmarkSuite
+{
+public:
+
+    struct Settings
+    {
+        QString corpusDirectory;            ///< Directory with documents of the corpus (empty means no corpus)
+        QRegularExpression filter;          ///< Only benchmarks with matching name (category/name) are executed
+        int iterations = 5;                 ///< Number of measured iterations of each benchmark
+        int warmupIterations = 1;           ///< Number of iterations, which are not measured
+        bool synthetic = true;              ///< Run benchmarks on synthetic data
+    };
+
+    explicit PDFBenchmarkSuite(Settings settings);
+
+    /// Executes all benchmarks
+    void run();
+
+    /// Returns results in JSON format
+    QJsonObject getResults() const;
+
+private:
+    using BenchmarkFunction = std::function<void()>;
+
+    struct BenchmarkResult
+    {
+        QString category;
+        QString name;
+        int iterations = 0;
+        qint64 minimalTime = 0;             ///< Minimal time of iteration in nanoseconds
+        qint64 medianTime = 0;              ///< Median time of iteration in nanoseconds
+        qint64 meanTime = 0;                ///< Mean time of iteration in nanoseconds
+        qint64 bytes = 0;                   ///< Bytes processed by single iteration (or 0)
+        QJsonObject counters;               ///< Additional counters of the benchmark
+    };
+
+    struct CorpusDocument
+    {
+        QString fileName;
+        QByteArray hash;
+        pdf::PDFDocument document;
+    };
+
+    /// Executes benchmark, if it passes the filter
+    /// \param category Category of the benchmark
+    /// \param name Name of the benchmark
+    /// \param bytes Bytes processed by single iteration (or 0)
+    /// \param function Benchmark function (single iteration)
+    /// \param counters Additional counters of the benchmark
+    void execute(QString category, QString name, qint64 bytes, const BenchmarkFunction& function, QJsonObject counters = QJsonObject());
+
+    void loadCorpus();
+
+    void runLexerAndParserBenchmarks();
+    void runStreamFilterBenchmarks();
+    void runColorConversionBenchmarks();
+    void runDocumentBenchmarks(const QString& documentName, pdf::PDFDocument& document);
+    void runImageDecoderBenchmarks(const QString& documentName, const pdf::PDFDocument& document);
+    void runFontRealizationBenchmarks(const QString& documentName, const pdf::PDFDocument& document);
+    void runRenderingBenchmarks(const QString& documentName, pdf::PDFDocument& document);
+    void runTextLayoutBenchmarks(const QString& documentName, pdf::PDFDocument& document);
+    void runDiffBenchmarks(const QString& documentName, const pdf::PDFDocument& document);
+
+    /// Synthetic content stream with given number of operators
+    static QByteArray generateContentStream(int operatorCount);
+
+    /// Synthetic array of dictionaries with given number of items
+    static QByteArray generateObjects(int objectCount);
+
+    /// Synthetic document with given number of pages with text and graphics
+    static pdf::PDFDocument generateDocument(int pageCount);
+
+    Settings m_settings;
+    std::vector<CorpusDocument> m_corpus;
+    std::vector<BenchmarkResult> m_results;
+};
+
+}   // namespace pdfbenchmarks
+
+#endif // PDFBENCHMARKSUITE_H
@@ -91,7 +91,8 @@ DifferencesDockWidget::DifferencesDockWidget(QWidget* parent,
     m_diffResult(diffResult),
     m_diffNavigator(diffNavigator),
     m_settings(settings),
-    m_disableChangeSelectedResultIndex(false)
+    m_disableChangeSelectedResultIndex(false),
+    m_isComparationInProgress(false)
 {
     ui->setupUi(this);
 
@@ -202,15 +203,23 @@ void DifferencesDockWidget::update()
         const size_t unfilteredDifferenceCount = m_unfilteredDiffResult->getDifferencesCount();
         const size_t hiddenDifferences = unfilteredDifferenceCount - differenceCount;
 
+        QString infoText;
         if (hiddenDifferences > 0)
         {
-            ui->infoTextLabel->setText(tr("%1 Differences (+%2 hidden)").arg(differenceCount).arg(hiddenDifferences));
+            infoText = tr("%1 Differences (+%2 hidden)").arg(differenceCount).arg(hiddenDifferences);
         }
         else
         {
-            ui->infoTextLabel->setText(tr("%1 Differences").arg(differenceCount));
+            infoText = tr("%1 Differences").arg(differenceCount);
         }
 
+        if (m_isComparationInProgress)
+        {
+            infoText = tr("%1, comparing...").arg(infoText);
+        }
+
+        ui->infoTextLabel->setText(infoText);
+
         pdf::PDFInteger lastLeftPageIndex = -1;
         pdf::PDFInteger lastRightPageIndex = -1;
 
@@ -265,6 +274,10 @@ void DifferencesDockWidget::update()
             }
         }
     }
+    else if (m_isComparationInProgress)
+    {
+        ui->infoTextLabel->setText(tr("Comparing..."));
+    }
     else
     {
         ui->infoTextLabel->setText(tr("No Differences Found!"));
@@ -274,6 +287,11 @@ void DifferencesDockWidget::update()
     ui->differencesTreeWidget->expandAll();
 }
 
+void DifferencesDockWidget::setComparationInProgress(bool comparationInProgress)
+{
+    m_isComparationInProgress = comparationInProgress;
+}
+
 void DifferencesDockWidget::onSelectionChanged(size_t currentIndex)
 {
     if (m_disableChangeSelectedResultIndex)
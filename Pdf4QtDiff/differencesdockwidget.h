@@ -72,6 +72,11 @@ public:
 
     void update();
 
+    /// Sets, if comparation is in progress, i.e. displayed
+    /// differences are just a partial result.
+    /// \param comparationInProgress Is comparation in progress?
+    void setComparationInProgress(bool comparationInProgress);
+
 private slots:
     void onSelectionChanged(size_t currentIndex);
     void onCurrentItemChanged(QTreeWidgetItem* current, QTreeWidgetItem* previous);
@@ -87,6 +92,7 @@ private:
     pdf::PDFDiffResultNavigator* m_diffNavigator;
     Settings* m_settings;
     bool m_disableChangeSelectedResultIndex;
+    bool m_isComparationInProgress;
 };
 
 }   // namespace pdfdiff
@@ -29,6 +29,7 @@
 
 #include "pdfwidgetutils.h"
 #include "pdfdocumentreader.h"
+#include "pdfdocumentregistry.h"
 #include "pdfdrawspacecontroller.h"
 #include "pdfdocumentmanipulator.h"
 #include "pdfdocumentbuilder.h"
@@ -64,6 +65,7 @@ MainWindow::MainWindow(QWidget* parent) :
     m_diff(nullptr),
     m_isChangingProgressStep(false),
     m_dontDisplayErrorMessage(false),
+    m_hasPartialComparationResult(false),
     m_diffNavigator(nullptr),
     m_drawInterface(&m_settings, &m_documentMapper, &m_filteredDiffResult)
 {
@@ -87,6 +89,7 @@ MainWindow::MainWindow(QWidget* parent) :
     ui->documentFrame->setLayout(new QVBoxLayout);
 
     m_cmsManager = new pdf::PDFCMSManager(this);
+    m_cmsManager->setAsynchronousProfileEnumeration(true);
     m_pdfWidget = new pdf::PDFWidget(m_cmsManager, pdf::RendererEngine::QPainter, ui->documentFrame);
     m_pdfWidget->getDrawWidgetProxy()->setProgress(m_progress);
     ui->documentFrame->layout()->addWidget(m_pdfWidget);
@@ -182,7 +185,10 @@ MainWindow::MainWindow(QWidget* parent) :
 
     m_diff.setProgress(m_progress);
     m_diff.setOption(pdf::PDFDiff::Asynchronous, true);
+    m_diff.setOption(pdf::PDFDiff::IncrementalResults, true);
     connect(&m_diff, &pdf::PDFDiff::comparationFinished, this, &MainWindow::onComparationFinished);
+    connect(&m_diff, &pdf::PDFDiff::partialResultAvailable, this, &MainWindow::onComparationPartialResult);
+    connect(m_pdfWidget->getDrawWidgetProxy(), &pdf::PDFDrawWidgetProxy::drawSpaceChanged, this, &MainWindow::updateComparationPriorityPages);
 
     m_diff.setLeftDocument(&m_leftDocument);
     m_diff.setRightDocument(&m_rightDocument);
@@ -226,9 +232,23 @@ void MainWindow::onMappedActionTriggered(int actionId)
 
 void MainWindow::onComparationFinished()
 {
-    clear(false, false);
+    // If partial results were displayed, the view is kept as it is, so
+    // user doesn't lose position in the document, which is being reviewed.
+    const bool hasPartialComparationResult = m_hasPartialComparationResult;
+    m_hasPartialComparationResult = false;
+
+    pdf::PDFDiffResult previousResult;
+    if (hasPartialComparationResult)
+    {
+        previousResult = std::move(m_diffResult);
+    }
+    else
+    {
+        clear(false, false);
+    }
 
     m_diffResult = m_diff.getResult();
+    m_differencesDockWidget->setComparationInProgress(false);
 
     if (!m_dontDisplayErrorMessage)
     {
@@ -242,7 +262,50 @@ void MainWindow::onComparationFinished()
         }
     }
 
-    // Create merged document
+    if (hasPartialComparationResult)
+    {
+        checkFiltersForNewDifferences(previousResult);
+        updateAll(false);
+        m_pdfWidget->update();
+        return;
+    }
+
+    createCombinedDocument();
+    updateAll(true);
+}
+
+void MainWindow::onComparationPartialResult()
+{
+    if (!m_diff.hasPartialResult())
+    {
+        // Signal of an already finished or stopped comparation
+        return;
+    }
+
+    if (!m_hasPartialComparationResult)
+    {
+        clear(false, false);
+
+        m_hasPartialComparationResult = true;
+        m_diffResult = m_diff.getPartialResult();
+        m_differencesDockWidget->setComparationInProgress(true);
+
+        createCombinedDocument();
+        updateAll(true);
+        updateComparationPriorityPages();
+        return;
+    }
+
+    pdf::PDFDiffResult previousResult = std::move(m_diffResult);
+    m_diffResult = m_diff.getPartialResult();
+
+    checkFiltersForNewDifferences(previousResult);
+    updateAll(false);
+    m_pdfWidget->update();
+}
+
+void MainWindow::createCombinedDocument()
+{
     pdf::PDFDocumentManipulator manipulator;
     manipulator.setOutlineMode(pdf::PDFDocumentManipulator::OutlineMode::NoOutline);
     manipulator.addDocument(1, &m_leftDocument);
@@ -260,8 +323,51 @@ void MainWindow::onComparationFinished()
     {
         m_combinedDocument = pdf::PDFDocument();
     }
+}
 
-    updateAll(true);
+void MainWindow::checkFiltersForNewDifferences(const pdf::PDFDiffResult& previousResult)
+{
+    auto checkFilter = [](QAction* action, bool hadDifferences, bool hasDifferences)
+    {
+        if (!hadDifferences && hasDifferences)
+        {
+            action->setChecked(true);
+        }
+    };
+
+    checkFilter(ui->actionFilter_Page_Movement, previousResult.hasPageMoveDifferences(), m_diffResult.hasPageMoveDifferences());
+    checkFilter(ui->actionFilter_Text, previousResult.hasTextDifferences(), m_diffResult.hasTextDifferences());
+    checkFilter(ui->actionFilter_Vector_Graphics, previousResult.hasVectorGraphicsDifferences(), m_diffResult.hasVectorGraphicsDifferences());
+    checkFilter(ui->actionFilter_Images, previousResult.hasImageDifferences(), m_diffResult.hasImageDifferences());
+    checkFilter(ui->actionFilter_Shading, previousResult.hasShadingDifferences(), m_diffResult.hasShadingDifferences());
+}
+
+void MainWindow::updateComparationPriorityPages()
+{
+    if (!m_hasPartialComparationResult)
+    {
+        return;
+    }
+
+    std::vector<pdf::PDFInteger> leftPages;
+    std::vector<pdf::PDFInteger> rightPages;
+
+    for (const pdf::PDFInteger pageIndex : m_pdfWidget->getDrawWidgetProxy()->getActivePages())
+    {
+        const pdf::PDFInteger leftPageIndex = m_documentMapper.getLeftPageIndex(pageIndex);
+        if (leftPageIndex != -1)
+        {
+            leftPages.push_back(leftPageIndex);
+        }
+
+        const pdf::PDFInteger rightPageIndex = m_documentMapper.getRightPageIndex(pageIndex);
+        if (rightPageIndex != -1)
+        {
+            rightPages.push_back(rightPageIndex);
+        }
+    }
+
+    m_diff.setPriorityPages(std::move(leftPages), std::move(rightPages));
 }
 
 void MainWindow::onColorsChanged()
@@ -490,6 +596,7 @@ void MainWindow::performOperation(Operation operation)
         {
             pdf::PDFTemporaryValueChange guard(&m_dontDisplayErrorMessage, true);
             m_diff.stop();
+            m_diff.setPriorityPages({ }, { });
 
             m_diff.setOption(pdf::PDFDiff::CompareTextsAsVector, m_settingsDockWidget->isCompareTextAsVectorGraphics());
             m_diff.setOption(pdf::PDFDiff::CompareWords, !m_settingsDockWidget->isCompareTextCharactersInsteadOfWords());
@@ -724,6 +831,8 @@ void MainWindow::clear(bool clearLeftDocument, bool clearRightDocument)
     m_diffResult = pdf::PDFDiffResult();
     m_filteredDiffResult = pdf::PDFDiffResult();
     m_diffNavigator.update();
+    m_hasPartialComparationResult = false;
+    m_differencesDockWidget->setComparationInProgress(false);
 
     updateAll(false);
 }
@@ -823,6 +932,14 @@ std::optional<pdf::PDFDocument> MainWindow::openDocument()
     QFileInfo fileInfo(fileName);
     m_settings.directory = fileInfo.dir().absolutePath();
 
+    // Same document is often compared with its other version, or opened
+    // on both sides, copy of the registered document shares its content.
+    pdf::PDFDocumentRegistry* registry = pdf::PDFDocumentRegistry::getInstance();
+    if (pdf::PDFDocumentPointer registeredDocument = registry->getDocument(fileName))
+    {
+        return *registeredDocument;
+    }
+
     // Try to open a new document
     pdf::PDFDocumentReader reader(nullptr, qMove(queryPassword), true, false);
     pdf::PDFDocument document = reader.readFromFile(fileName);
@@ -831,7 +948,8 @@ std::optional<pdf::PDFDocument> MainWindow::openDocument()
     pdf::PDFDocumentReader::Result result = reader.getReadingResult();
     if (result == pdf::PDFDocumentReader::Result::OK)
     {
-        return document;
+        pdf::PDFDocumentPointer documentPointer = registry->registerDocument(fileName, pdf::PDFDocumentPointer(new pdf::PDFDocument(qMove(document))));
+        return *documentPointer;
     }
     else if (result == pdf::PDFDocumentReader::Result::Failed)
     {
@@ -104,6 +104,7 @@ private slots:
 private:
     void onMappedActionTriggered(int actionId);
     void onComparationFinished();
+    void onComparationPartialResult();
     void onColorsChanged();
 
     void onProgressStarted(pdf::ProgressStartupInfo info);
@@ -123,6 +124,17 @@ private:
     /// \param clearRightDocument Clear left document?
     void clear(bool clearLeftDocument, bool clearRightDocument);
 
+    /// Creates combined document from left and right document
+    void createCombinedDocument();
+
+    /// Checks filters of difference types, which are present in current
+    /// result, but were not present in the previous result.
+    /// \param previousResult Previous result
+    void checkFiltersForNewDifferences(const pdf::PDFDiffResult& previousResult);
+
+    /// Updates pages, which are compared first, to the pages visible in the view
+    void updateComparationPriorityPages();
+
     void updateAll(bool resetFilters);
     void updateFilteredResult();
     void updateCustomPageLayout();
@@ -148,6 +160,7 @@ private:
     pdf::PDFDiff m_diff;
     bool m_isChangingProgressStep;
     bool m_dontDisplayErrorMessage;
+    bool m_hasPartialComparationResult; ///< Partial result of running comparation is displayed
 
     pdf::PDFDocument m_leftDocument;
     pdf::PDFDocument m_rightDocument;
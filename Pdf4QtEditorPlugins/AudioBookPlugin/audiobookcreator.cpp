@@ -21,6 +21,7 @@
 // SOFTWARE.
 
 #include "audiobookcreator.h"
+#include "pdfspeechsynthesispipeline.h"
 
 #include <QTextStream>
 
@@ -57,16 +58,10 @@ AudioBookCreator::~AudioBookCreator()
 pdf::PDFOperationResult AudioBookCreator::createAudioBook(const Settings& settings, pdf::PDFDocumentTextFlow& flow)
 {
 #ifdef Q_OS_WIN
-    QString audioString;
-    QTextStream textStream(&audioString);
-
+    QStringList paragraphs;
     for (const pdf::PDFDocumentTextFlow::Item& item : flow.getItems())
     {
-        QString trimmedText = item.text.trimmed();
-        if (!trimmedText.isEmpty())
-        {
-            textStream << trimmedText << Qt::endl;
-        }
+        paragraphs << item.text;
     }
 
     auto getVoiceToken = [](const Settings& settings)
@@ -132,52 +127,93 @@ pdf::PDFOperationResult AudioBookCreator::createAudioBook(const Settings& settin
         return tr("No suitable voice found.");
     }
 
-    QString outputFile = settings.audioFileName;
-    BSTR outputFileName = (BSTR)outputFile.utf16();
-
-    ISpeechFileStream* stream = nullptr;
-    if (!SUCCEEDED(::CoCreateInstance(CLSID_SpFileStream, NULL, CLSCTX_ALL, __uuidof(ISpeechFileStream), (LPVOID*)&stream)))
+    // Chunks are synthesized in worker threads, so we use the voice
+    // token identifier instead of the token (COM objects can't be shared
+    // between threads without marshalling).
+    QString voiceTokenId;
+    LPWSTR voiceTokenIdString = nullptr;
+    if (SUCCEEDED(voiceToken->GetId(&voiceTokenIdString)))
     {
-        voiceToken->Release();
-        return tr("Cannot create output stream '%1'.").arg(outputFile);
+        voiceTokenId = QString::fromWCharArray(voiceTokenIdString);
+        ::CoTaskMemFree(voiceTokenIdString);
     }
+    voiceToken->Release();
 
-    ISpVoice* voice = nullptr;
-    if (!SUCCEEDED(::CoCreateInstance(CLSID_SpVoice, NULL, CLSCTX_ALL, __uuidof(ISpVoice), (LPVOID*)&voice)))
+    if (voiceTokenId.isEmpty())
     {
-        voiceToken->Release();
-        stream->Release();
-        return tr("Cannot create voice.");
+        return tr("No suitable voice found.");
     }
 
-    if (!SUCCEEDED(stream->Open(outputFileName, SSFMCreateForWrite)))
+    auto synthesize = [&settings, &voiceTokenId](const QString& text, const QString& waveFileName) -> pdf::PDFOperationResult
     {
-        voiceToken->Release();
-        voice->Release();
-        stream->Release();
-        return tr("Cannot create output stream '%1'.").arg(outputFile);
-    }
+        const bool isComInitialized = SUCCEEDED(::CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+        pdf::PDFOperationResult result = true;
 
-    if (!SUCCEEDED(voice->SetVoice(voiceToken)))
-    {
-        voiceToken->Release();
-        voice->Release();
-        stream->Release();
-        return tr("Failed to set requested voice.");
-    }
+        ISpObjectToken* token = nullptr;
+        ISpeechFileStream* stream = nullptr;
+        ISpVoice* voice = nullptr;
 
-    LPCWSTR stringToSpeak = (LPCWSTR)audioString.utf16();
+        if (!SUCCEEDED(::CoCreateInstance(CLSID_SpObjectToken, NULL, CLSCTX_ALL, __uuidof(ISpObjectToken), (LPVOID*)&token)) ||
+            !SUCCEEDED(token->SetId(NULL, (LPCWSTR)voiceTokenId.utf16(), FALSE)))
+        {
+            result = tr("No suitable voice found.");
+        }
+        else if (!SUCCEEDED(::CoCreateInstance(CLSID_SpFileStream, NULL, CLSCTX_ALL, __uuidof(ISpeechFileStream), (LPVOID*)&stream)) ||
+                 !SUCCEEDED(stream->Open((BSTR)waveFileName.utf16(), SSFMCreateForWrite)))
+        {
+            result = tr("Cannot create output stream '%1'.").arg(waveFileName);
+        }
+        else if (!SUCCEEDED(::CoCreateInstance(CLSID_SpVoice, NULL, CLSCTX_ALL, __uuidof(ISpVoice), (LPVOID*)&voice)))
+        {
+            result = tr("Cannot create voice.");
+        }
+        else if (!SUCCEEDED(voice->SetVoice(token)))
+        {
+            result = tr("Failed to set requested voice.");
+        }
+        else
+        {
+            voice->SetOutput(stream, FALSE);
+            voice->SetRate(settings.rate * 10.0);
+            voice->SetVolume(settings.volume * 100.0);
+
+            if (!SUCCEEDED(voice->Speak((LPCWSTR)text.utf16(), SPF_PURGEBEFORESPEAK | SPF_PARSE_SAPI, NULL)))
+            {
+                result = tr("Speech synthesis failed.");
+            }
+        }
 
-    voice->SetOutput(stream, FALSE);
-    voice->SetRate(settings.rate * 10.0);
-    voice->SetVolume(settings.volume * 100.0);
-    voice->Speak(stringToSpeak, SPF_PURGEBEFORESPEAK | SPF_PARSE_SAPI, NULL);
+        if (voice)
+        {
+            voice->Release();
+        }
 
-    voice->Release();
-    stream->Release();
-    voiceToken->Release();
+        if (stream)
+        {
+            stream->Close();
+            stream->Release();
+        }
+
+        if (token)
+        {
+            token->Release();
+        }
+
+        if (isComInitialized)
+        {
+            ::CoUninitialize();
+        }
+
+        return result;
+    };
+
+    pdf::PDFSpeechSynthesisPipeline::Settings pipelineSettings;
+    pipelineSettings.voiceKey = QString("%1|%2|%3").arg(voiceTokenId).arg(settings.rate).arg(settings.volume).toUtf8();
+
+    const QStringList chunks = pdf::PDFSpeechSynthesisPipeline::createChunks(paragraphs, pipelineSettings.maximalChunkLength);
 
-    return true;
+    pdf::PDFSpeechSynthesisPipeline pipeline(qMove(pipelineSettings));
+    return pipeline.execute(chunks, settings.audioFileName, synthesize);
 #else
     return tr("Audio book plugin is unsupported on your system.");
 #endif
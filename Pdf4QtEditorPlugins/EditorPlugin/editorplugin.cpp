@@ -191,7 +191,8 @@ QString EditorPlugin::getPluginMenuName() const
 
 bool EditorPlugin::updatePageContent(pdf::PDFInteger pageIndex,
                                      const std::vector<const pdf::PDFPageContentElement*>& elements,
-                                     pdf::PDFDocumentBuilder* builder)
+                                     pdf::PDFDocumentBuilder* builder,
+                                     bool spliceOriginalContent)
 {
     pdf::PDFColorConvertor convertor;
     const pdf::PDFPage* page = m_document->getCatalog()->getPage(pageIndex);
@@ -203,6 +204,23 @@ bool EditorPlugin::updatePageContent(pdf::PDFInteger pageIndex,
     pdf::PDFPageContentEditorContentStreamBuilder contentStreamBuilder(m_document);
     contentStreamBuilder.setFontDictionary(editedPageContent.getFontDictionary());
 
+    // Try to write only changed parts of the original content, unchanged
+    // parts of the content streams are copied as they are.
+    bool isOriginalContentSpliced = false;
+    if (spliceOriginalContent)
+    {
+        std::vector<const pdf::PDFEditedPageContentElement*> editedElements;
+        for (const pdf::PDFPageContentElement* element : elements)
+        {
+            if (const pdf::PDFPageContentElementEdited* editedElement = element->asElementEdited())
+            {
+                editedElements.push_back(editedElement->getElement());
+            }
+        }
+
+        isOriginalContentSpliced = contentStreamBuilder.writeEditedPageContent(page, editedPageContent, editedElements);
+    }
+
     for (const pdf::PDFPageContentElement* element : elements)
     {
         const pdf::PDFPageContentElementEdited* editedElement = element->asElementEdited();
@@ -213,7 +231,7 @@ bool EditorPlugin::updatePageContent(pdf::PDFInteger pageIndex,
         const pdf::PDFPageContentImageElement* elementImage = element->asElementImage();
         const pdf::PDFPageContentElementTextBox* elementTextBox = element->asElementTextBox();
 
-        if (editedElement)
+        if (editedElement && !isOriginalContentSpliced)
         {
             contentStreamBuilder.writeEditedElement(editedElement->getElement());
         }
@@ -359,6 +377,24 @@ bool EditorPlugin::updatePageContent(pdf::PDFInteger pageIndex,
         factory.endDictionaryItem();
     }
 
+    if (isOriginalContentSpliced)
+    {
+        // Original content may use other resources (color spaces, patterns, ...)
+        if (const pdf::PDFDictionary* resourcesDictionary = m_document->getDictionaryFromObject(page->getResources()))
+        {
+            for (size_t i = 0; i < resourcesDictionary->getCount(); ++i)
+            {
+                const QByteArray& key = resourcesDictionary->getKey(i).getString();
+                if (key != "Font" && key != "XObject" && key != "ExtGState")
+                {
+                    factory.beginDictionaryItem(key);
+                    factory << resourcesDictionary->getValue(i);
+                    factory.endDictionaryItem();
+                }
+            }
+        }
+    }
+
     factory.endDictionary();
     factory.endDictionaryItem();
 
@@ -411,7 +447,7 @@ bool EditorPlugin::save()
                 elements = std::move(it->second);
             }
 
-            if (!updatePageContent(pageIndex, elements, builder))
+            if (!updatePageContent(pageIndex, elements, builder, true))
             {
                 return false;
             }
@@ -792,7 +828,7 @@ bool EditorPlugin::updateTextElement(pdf::PDFPageContentElementEdited* element)
     pdf::PDFDocumentModifier modifier(m_document);
     pdf::PDFDocumentBuilder* builder = modifier.getBuilder();
 
-    if (!updatePageContent(element->getPageIndex(), { element }, builder))
+    if (!updatePageContent(element->getPageIndex(), { element }, builder, false))
     {
         return false;
     }
@@ -119,7 +119,8 @@ private:
 
     bool updatePageContent(pdf::PDFInteger pageIndex,
                            const std::vector<const pdf::PDFPageContentElement*>& elements,
-                           pdf::PDFDocumentBuilder* builder);
+                           pdf::PDFDocumentBuilder* builder,
+                           bool spliceOriginalContent);
     bool updateTextElement(pdf::PDFPageContentElementEdited* element);
 
     void onDrawSpaceChanged();
@@ -78,6 +78,8 @@ void InkCoverageDialog::updateInkCoverage()
         settings.flags.setFlag(pdf::PDFTransparencyRendererSettings::ActiveColorMask, false);
         settings.flags.setFlag(pdf::PDFTransparencyRendererSettings::SeparationSimulation, m_inkMapper.getActiveSpotColorCount() > 0);
         settings.flags.setFlag(pdf::PDFTransparencyRendererSettings::SaveOriginalProcessImage, true);
+        settings.storagePrecision = pdf::PDFFloatBitmap::Precision::UNorm16;
+        settings.bandHeight = 256;
 
         pdf::PDFInkCoverageCalculator calculator(m_document,
                                                  m_widget->getDrawWidgetProxy()->getFontCache(),
@@ -273,7 +273,8 @@ void OutputPreviewDialog::updatePageImage()
 
     m_needUpdateImage = false;
 
-    const pdf::PDFPage* page = m_document->getCatalog()->getPage(ui->pageIndexScrollBar->value() - 1);
+    const pdf::PDFInteger pageIndex = ui->pageIndexScrollBar->value() - 1;
+    const pdf::PDFPage* page = m_document->getCatalog()->getPage(pageIndex);
     if (!page)
     {
         m_outputPreviewWidget->clear();
@@ -325,11 +326,26 @@ void OutputPreviewDialog::updatePageImage()
     flags.setFlag(pdf::PDFTransparencyRendererSettings::DisplayTilingPatterns, ui->displayTilingPatternsCheckBox->isChecked());
     flags.setFlag(pdf::PDFTransparencyRendererSettings::SaveOriginalProcessImage, true);
 
+    RenderParameters parameters;
+    parameters.pageIndex = pageIndex;
+    parameters.renderSize = m_outputPreviewWidget->getPageImageSizeHint();
+    parameters.flags = flags;
+    parameters.activeSpotColorCount = m_inkMapper.getActiveSpotColorCount();
+
+    // Page bitmap is rendered with all inks active, so if only ink selection
+    // or paper color is changed, we can create the image from the page bitmap.
+    if (parameters == m_pageBitmapParameters)
+    {
+        RenderedImage result = createRenderedImage(m_pageBitmap, m_pageBitmapSize, paperColor, activeColorMask);
+        m_outputPreviewWidget->setPageImage(qMove(result.image), qMove(result.originalProcessImage), result.pageSize);
+        QApplication::restoreOverrideCursor();
+        return;
+    }
+
     m_inkMapperForRendering = m_inkMapper;
-    QSize renderSize = m_outputPreviewWidget->getPageImageSizeHint();
-    auto renderImage = [this, page, renderSize, paperColor, activeColorMask, flags]() -> RenderedImage
+    auto renderImage = [this, page, parameters, paperColor, activeColorMask]() -> RenderedImage
     {
-        return renderPage(page, renderSize, paperColor, activeColorMask, flags);
+        return renderPage(page, parameters, paperColor, activeColorMask);
     };
 
     m_future = QtConcurrent::run(renderImage);
@@ -339,16 +355,16 @@ void OutputPreviewDialog::updatePageImage()
 }
 
 OutputPreviewDialog::RenderedImage OutputPreviewDialog::renderPage(const pdf::PDFPage* page,
-                                                                   QSize renderSize,
+                                                                   RenderParameters parameters,
                                                                    pdf::PDFRGB paperColor,
-                                                                   uint32_t activeColorMask,
-                                                                   pdf::PDFTransparencyRendererSettings::Flags additionalFlags)
+                                                                   uint32_t activeColorMask)
 {
     RenderedImage result;
+    result.parameters = parameters;
 
     QRectF pageRect = page->getRotatedMediaBox();
     QSizeF pageSize = pageRect.size();
-    pageSize.scale(renderSize.width(), renderSize.height(), Qt::KeepAspectRatio);
+    pageSize.scale(parameters.renderSize.width(), parameters.renderSize.height(), Qt::KeepAspectRatio);
     QSize imageSize = pageSize.toSize();
 
     if (!imageSize.isValid())
@@ -357,16 +373,18 @@ OutputPreviewDialog::RenderedImage OutputPreviewDialog::renderPage(const pdf::PD
     }
 
     pdf::PDFTransparencyRendererSettings settings;
-    settings.flags = additionalFlags;
+    settings.flags = parameters.flags;
 
     // Jakub Melka: debug is very slow, use multithreading
 #ifdef QT_DEBUG
     settings.flags.setFlag(pdf::PDFTransparencyRendererSettings::MultithreadedPathSampler, true);
 #endif
 
-    settings.flags.setFlag(pdf::PDFTransparencyRendererSettings::ActiveColorMask, activeColorMask != pdf::PDFPixelFormat::getAllColorsMask());
+    // All inks are rendered, inactive inks are removed from the page bitmap later
+    settings.flags.setFlag(pdf::PDFTransparencyRendererSettings::ActiveColorMask, false);
     settings.flags.setFlag(pdf::PDFTransparencyRendererSettings::SeparationSimulation, m_inkMapperForRendering.getActiveSpotColorCount() > 0);
-    settings.activeColorMask = activeColorMask;
+    settings.activeColorMask = pdf::PDFPixelFormat::getAllColorsMask();
+    settings.storagePrecision = pdf::PDFFloatBitmap::Precision::UNorm16;
 
     QTransform pagePointToDevicePoint = pdf::PDFRenderer::createPagePointToDevicePointMatrix(page, QRect(QPoint(0, 0), imageSize));
     pdf::PDFDrawWidgetProxy* proxy = m_widget->getDrawWidgetProxy();
@@ -375,14 +393,43 @@ OutputPreviewDialog::RenderedImage OutputPreviewDialog::renderPage(const pdf::PD
                                           &m_inkMapperForRendering, settings, pagePointToDevicePoint);
 
     renderer.beginPaint(imageSize);
-    result.errors = renderer.processContents();
+    QList<pdf::PDFRenderError> errors = renderer.processContents();
     renderer.endPaint();
 
-    QImage image = renderer.toImage(false, true, paperColor);
+    QSizeF pageSizeMM = page->getRotatedMediaBoxMM().size();
+    pdf::PDFFloatBitmapWithColorSpace pageBitmap = renderer.getOriginalProcessBitmap();
+
+    RenderedImage renderedImage = createRenderedImage(pageBitmap, pageSizeMM, paperColor, activeColorMask);
+    renderedImage.pageBitmap = qMove(pageBitmap);
+    renderedImage.parameters = parameters;
+    renderedImage.errors = qMove(errors);
+    return renderedImage;
+}
+
+OutputPreviewDialog::RenderedImage OutputPreviewDialog::createRenderedImage(const pdf::PDFFloatBitmapWithColorSpace& pageBitmap,
+                                                                            QSizeF pageSize,
+                                                                            pdf::PDFRGB paperColor,
+                                                                            uint32_t activeColorMask) const
+{
+    RenderedImage result;
+
+    pdf::PDFCMSPointer cms = m_widget->getDrawWidgetProxy()->getCMSManager()->getCurrentCMS();
+    pdf::PDFColorSpacePointer deviceColorSpace(new pdf::PDFDeviceRGBColorSpace());
+    pdf::PDFRenderErrorReporterDummy errorReporter;
+
+    result.image = pdf::PDFTransparencyRenderer::createImageFromOriginalProcessBitmap(pageBitmap, activeColorMask, &m_inkMapperForRendering, cms.data(),
+                                                                                      deviceColorSpace, true, paperColor, &errorReporter);
+    result.originalProcessImage = pageBitmap;
+    result.pageSize = pageSize;
+
+    if (activeColorMask != pdf::PDFPixelFormat::getAllColorsMask())
+    {
+        const pdf::PDFFloatBitmap::Precision precision = pageBitmap.getPrecision();
+        result.originalProcessImage.setPrecision(pdf::PDFFloatBitmap::Precision::Float32);
+        result.originalProcessImage.clearInactiveColors(activeColorMask);
+        result.originalProcessImage.setPrecision(precision);
+    }
 
-    result.image = qMove(image);
-    result.originalProcessImage = renderer.getOriginalProcessBitmap();
-    result.pageSize = page->getRotatedMediaBoxMM().size();
     return result;
 }
 
@@ -397,6 +444,10 @@ void OutputPreviewDialog::onPageImageRendered()
         m_futureWatcher->deleteLater();
         m_futureWatcher = nullptr;
 
+        m_pageBitmapParameters = result.parameters;
+        m_pageBitmap = qMove(result.pageBitmap);
+        m_pageBitmapSize = result.pageSize;
+
         m_outputPreviewWidget->setPageImage(qMove(result.image), qMove(result.originalProcessImage), result.pageSize);
 
         if (m_needUpdateImage)
@@ -69,10 +69,31 @@ private:
     void onInkCoverageLimitChanged(double value);
     void onRichBlackLimtiChanged(double value);
 
+    /// Parameters of page rendering. Page bitmap is rendered with all inks
+    /// active, so it can be reused for any ink selection and paper color,
+    /// while these parameters remain the same.
+    struct RenderParameters
+    {
+        pdf::PDFInteger pageIndex = -1;
+        QSize renderSize;
+        pdf::PDFTransparencyRendererSettings::Flags flags = pdf::PDFTransparencyRendererSettings::None;
+        size_t activeSpotColorCount = 0;
+
+        bool operator==(const RenderParameters& other) const
+        {
+            return pageIndex == other.pageIndex &&
+                   renderSize == other.renderSize &&
+                   pdf::PDFTransparencyRendererSettings::Flags::Integer(flags) == pdf::PDFTransparencyRendererSettings::Flags::Integer(other.flags) &&
+                   activeSpotColorCount == other.activeSpotColorCount;
+        }
+    };
+
     struct RenderedImage
     {
         QImage image;
         pdf::PDFFloatBitmapWithColorSpace originalProcessImage;
+        pdf::PDFFloatBitmapWithColorSpace pageBitmap;
+        RenderParameters parameters;
         QSizeF pageSize;
         QList<pdf::PDFRenderError> errors;
     };
@@ -80,10 +101,13 @@ private:
     void updatePageImage();
     void onPageImageRendered();
     RenderedImage renderPage(const pdf::PDFPage* page,
-                             QSize renderSize,
+                             RenderParameters parameters,
                              pdf::PDFRGB paperColor,
-                             uint32_t activeColorMask,
-                             pdf::PDFTransparencyRendererSettings::Flags additionalFlags);
+                             uint32_t activeColorMask);
+    RenderedImage createRenderedImage(const pdf::PDFFloatBitmapWithColorSpace& pageBitmap,
+                                      QSizeF pageSize,
+                                      pdf::PDFRGB paperColor,
+                                      uint32_t activeColorMask) const;
     bool isRenderingDone() const;
 
     Ui::OutputPreviewDialog* ui;
@@ -94,6 +118,10 @@ private:
     bool m_needUpdateImage;
     OutputPreviewWidget* m_outputPreviewWidget;
 
+    RenderParameters m_pageBitmapParameters;
+    pdf::PDFFloatBitmapWithColorSpace m_pageBitmap;
+    QSizeF m_pageBitmapSize;
+
     QFuture<RenderedImage> m_future;
     QFutureWatcher<RenderedImage>* m_futureWatcher;
 };
@@ -28,6 +28,8 @@
 #include <QMouseEvent>
 #include <QFontMetrics>
 
+#include <algorithm>
+
 namespace pdfplugin
 {
 
@@ -60,6 +62,7 @@ void OutputPreviewWidget::clear()
     m_infoBoxItems.clear();
     m_imagePointUnderCursor = std::nullopt;
     m_inkCoverageMM.dirty();
+    m_pixelInkCoverage.dirty();
     m_alarmCoverageImage.dirty();
     m_alarmRichBlackImage.dirty();
     m_inkCoverageImage.dirty();
@@ -84,6 +87,7 @@ void OutputPreviewWidget::setPageImage(QImage image, pdf::PDFFloatBitmapWithColo
     }
 
     m_inkCoverageMM.dirty();
+    m_pixelInkCoverage.dirty();
     m_alarmCoverageImage.dirty();
     m_alarmRichBlackImage.dirty();
     m_inkCoverageImage.dirty();
@@ -451,7 +455,9 @@ void OutputPreviewWidget::buildInfoBoxItems()
                     Q_ASSERT(point.y() >= 0);
                     Q_ASSERT(point.y() < m_originalProcessBitmap.getHeight());
 
-                    pdf::PDFColorBuffer buffer = m_originalProcessBitmap.getPixel(point.x(), point.y());
+                    std::vector<pdf::PDFColorComponent> pixel(m_originalProcessBitmap.getPixelSize(), 0.0f);
+                    pdf::PDFColorBuffer buffer(pixel.data(), pixel.size());
+                    m_originalProcessBitmap.readPixel(point.x(), point.y(), buffer);
                     for (int i = 0; i < pixelFormat.getColorChannelCount(); ++i)
                     {
                         const pdf::PDFColorComponent color = buffer[i] * 100.0f;
@@ -634,6 +640,11 @@ const std::vector<pdf::PDFColorComponent>& OutputPreviewWidget::getInkCoverage()
     return m_inkCoverageMM.get(this, &OutputPreviewWidget::getInkCoverageImpl);
 }
 
+const std::vector<pdf::PDFColorComponent>& OutputPreviewWidget::getPixelInkCoverage() const
+{
+    return m_pixelInkCoverage.get(this, &OutputPreviewWidget::getPixelInkCoverageImpl);
+}
+
 const OutputPreviewWidget::AlarmImageInfo& OutputPreviewWidget::getAlarmCoverageImage() const
 {
     return m_alarmCoverageImage.get(this, &OutputPreviewWidget::getAlarmCoverageImageImpl);
@@ -670,21 +681,7 @@ std::vector<pdf::PDFColorComponent> OutputPreviewWidget::getInkCoverageImpl() co
         pdf::PDFColorComponent pixelArea = totalArea / pdf::PDFColorComponent(m_originalProcessBitmap.getWidth() * m_originalProcessBitmap.getHeight());
 
         const uint8_t colorChannelCount = pixelFormat.getColorChannelCount();
-        result.resize(colorChannelCount, 0.0f);
-
-        for (size_t y = 0; y < m_originalProcessBitmap.getHeight(); ++y)
-        {
-            for (size_t x = 0; x < m_originalProcessBitmap.getWidth(); ++x)
-            {
-                const pdf::PDFConstColorBuffer buffer = m_originalProcessBitmap.getPixel(x, y);
-                const pdf::PDFColorComponent alpha = pixelFormat.hasOpacityChannel() ? buffer[pixelFormat.getOpacityChannelIndex()] : 1.0f;
-
-                for (uint8_t i = 0; i < colorChannelCount; ++i)
-                {
-                    result[i] += buffer[i] * alpha;
-                }
-            }
-        }
+        result = m_originalProcessBitmap.getColorChannelSums();
 
         for (uint8_t i = 0; i < colorChannelCount; ++i)
         {
@@ -695,6 +692,11 @@ std::vector<pdf::PDFColorComponent> OutputPreviewWidget::getInkCoverageImpl() co
     return result;
 }
 
+std::vector<pdf::PDFColorComponent> OutputPreviewWidget::getPixelInkCoverageImpl() const
+{
+    return m_originalProcessBitmap.getInkCoverageValues();
+}
+
 OutputPreviewWidget::AlarmImageInfo OutputPreviewWidget::getAlarmCoverageImageImpl() const
 {
     AlarmImageInfo alarmImage;
@@ -704,12 +706,20 @@ OutputPreviewWidget::AlarmImageInfo OutputPreviewWidget::getAlarmCoverageImageIm
 
     const int width = alarmImage.image.width();
     const int height = alarmImage.image.height();
+    const std::vector<pdf::PDFColorComponent>& pixelInkCoverage = getPixelInkCoverage();
+
+    if (pixelInkCoverage.size() != size_t(width) * size_t(height))
+    {
+        return alarmImage;
+    }
 
     for (int y = 0; y < height; ++y)
     {
+        const pdf::PDFColorComponent* rowInkCoverage = pixelInkCoverage.data() + size_t(y) * size_t(width);
+
         for (int x = 0; x < width; ++x)
         {
-            pdf::PDFColorComponent inkCoverage = m_originalProcessBitmap.getPixelInkCoverage(x, y);
+            pdf::PDFColorComponent inkCoverage = rowInkCoverage[x];
 
             if (inkCoverage > m_inkCoverageLimit)
             {
@@ -747,14 +757,36 @@ OutputPreviewWidget::AlarmImageInfo OutputPreviewWidget::getAlarmRichBlackImageI
         const int height = alarmImage.image.height();
 
         const uint8_t blackChannelIndex = pixelFormat.getProcessColorChannelIndexStart() + 3;
+        const std::vector<pdf::PDFColorComponent>& pixelInkCoverage = getPixelInkCoverage();
+
+        if (pixelInkCoverage.size() != size_t(width) * size_t(height))
+        {
+            return alarmImage;
+        }
+
+        std::vector<pdf::PDFColorComponent> pixel(m_originalProcessBitmap.getPixelSize(), 0.0f);
+        pdf::PDFColorBuffer buffer(pixel.data(), pixel.size());
 
         for (int y = 0; y < height; ++y)
         {
+            const pdf::PDFColorComponent* rowInkCoverage = pixelInkCoverage.data() + size_t(y) * size_t(width);
+
             for (int x = 0; x < width; ++x)
             {
-                pdf::PDFConstColorBuffer buffer = m_originalProcessBitmap.getPixel(x, y);
+                pdf::PDFColorComponent inkCoverage = rowInkCoverage[x];
+
+                // Black ink can't exceed the limit, if total ink coverage doesn't
+                if (inkCoverage <= m_richBlackLimit)
+                {
+                    if (!qFuzzyIsNull(inkCoverage))
+                    {
+                        alarmImage.areaValid += 1.0f;
+                    }
+                    continue;
+                }
+
+                m_originalProcessBitmap.readPixel(x, y, buffer);
                 pdf::PDFColorComponent blackInk = buffer[blackChannelIndex];
-                pdf::PDFColorComponent inkCoverage = m_originalProcessBitmap.getPixelInkCoverage(x, y);
                 pdf::PDFColorComponent inkCoverageWithoutBlack = inkCoverage - blackInk;
 
                 if (blackInk > m_richBlackLimit && !qFuzzyIsNull(inkCoverageWithoutBlack))
@@ -786,32 +818,24 @@ OutputPreviewWidget::InkCoverageInfo OutputPreviewWidget::getInkCoverageInfoImpl
     coverageInfo.minValue = 0.0f;
     coverageInfo.maxValue = 1.0f;
 
-    pdf::PDFFloatBitmap inkCoverageBitmap = m_originalProcessBitmap.getInkCoverageBitmap();
+    const std::vector<pdf::PDFColorComponent>& pixelInkCoverage = getPixelInkCoverage();
 
-    int width = int(inkCoverageBitmap.getWidth());
-    int height = int(inkCoverageBitmap.getHeight());
+    int width = int(m_originalProcessBitmap.getWidth());
+    int height = int(m_originalProcessBitmap.getHeight());
 
     if (width > 0 && height > 0)
     {
-        for (int y = 0; y < height; ++y)
-        {
-            for (int x = 0; x < width; ++x)
-            {
-                pdf::PDFColorBuffer buffer = inkCoverageBitmap.getPixel(x, y);
-                const pdf::PDFColorComponent coverage = buffer[0];
-                coverageInfo.maxValue = qMax(coverage, coverageInfo.maxValue);
-            }
-        }
-
+        coverageInfo.maxValue = qMax(*std::max_element(pixelInkCoverage.cbegin(), pixelInkCoverage.cend()), coverageInfo.maxValue);
         coverageInfo.colorScale = pdf::PDFColorScale(coverageInfo.minValue, coverageInfo.maxValue);
         coverageInfo.image = QImage(width, height, QImage::Format_RGBX8888);
 
         for (int y = 0; y < height; ++y)
         {
+            const pdf::PDFColorComponent* rowInkCoverage = pixelInkCoverage.data() + size_t(y) * size_t(width);
+
             for (int x = 0; x < width; ++x)
             {
-                pdf::PDFColorBuffer buffer = inkCoverageBitmap.getPixel(x, y);
-                const pdf::PDFColorComponent coverage = buffer[0];
+                const pdf::PDFColorComponent coverage = rowInkCoverage[x];
 
                 coverageInfo.image.setPixelColor(x, y, coverageInfo.colorScale.map(coverage));
             }
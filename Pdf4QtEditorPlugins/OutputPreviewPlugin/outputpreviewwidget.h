@@ -111,6 +111,7 @@ private:
     };
 
     const std::vector<pdf::PDFColorComponent>& getInkCoverage() const;
+    const std::vector<pdf::PDFColorComponent>& getPixelInkCoverage() const;
     const AlarmImageInfo& getAlarmCoverageImage() const;
     const AlarmImageInfo& getAlarmRichBlackImage() const;
     const InkCoverageInfo& getInkCoverageInfo() const;
@@ -118,6 +119,7 @@ private:
     const QImage& getOpacityImage() const;
 
     std::vector<pdf::PDFColorComponent> getInkCoverageImpl() const;
+    std::vector<pdf::PDFColorComponent> getPixelInkCoverageImpl() const;
     AlarmImageInfo getAlarmCoverageImageImpl() const;
     AlarmImageInfo getAlarmRichBlackImageImpl() const;
     InkCoverageInfo getInkCoverageInfoImpl() const;
@@ -158,6 +160,7 @@ private:
     pdf::PDFColorComponent m_richBlackLimit;
 
     mutable pdf::PDFCachedItem<std::vector<pdf::PDFColorComponent>> m_inkCoverageMM;
+    mutable pdf::PDFCachedItem<std::vector<pdf::PDFColorComponent>> m_pixelInkCoverage;
     mutable pdf::PDFCachedItem<AlarmImageInfo> m_alarmCoverageImage;
     mutable pdf::PDFCachedItem<AlarmImageInfo> m_alarmRichBlackImage;
     mutable pdf::PDFCachedItem<InkCoverageInfo> m_inkCoverageImage;
@@ -85,12 +85,12 @@ LaunchDialog::~LaunchDialog()
 
 void LaunchDialog::startEditor()
 {
-    startProgram("Pdf4QtEditor");
+    startProgram("Pdf4QtEditor", { "--single-instance" });
 }
 
 void LaunchDialog::startViewer()
 {
-    startProgram("Pdf4QtViewer");
+    startProgram("Pdf4QtViewer", { "--single-instance" });
 }
 
 void LaunchDialog::startPageMaster()
@@ -103,7 +103,7 @@ void LaunchDialog::startDiff()
     startProgram("Pdf4QtDiff");
 }
 
-void LaunchDialog::startProgram(const QString& program)
+void LaunchDialog::startProgram(const QString& program, const QStringList& arguments)
 {
 #ifndef Q_OS_WIN
     QString appDir = qgetenv("APPDIR");
@@ -128,12 +128,12 @@ void LaunchDialog::startProgram(const QString& program)
     }
 
     qint64 pid = 0;
-    if (!QProcess::startDetached(internalToolPath, {}, QString(), &pid))
+    if (!QProcess::startDetached(internalToolPath, arguments, QString(), &pid))
     {
         QMessageBox::critical(this, tr("Error"), tr("Failed to start process '%1'").arg(internalToolPath));
     }
 #else
-    QProcess::startDetached(program);
+    QProcess::startDetached(program, arguments);
 #endif
     close();
 }
@@ -44,7 +44,7 @@ private:
     void startPageMaster();
     void startDiff();
 
-    void startProgram(const QString& program);
+    void startProgram(const QString& program, const QStringList& arguments = QStringList());
 
     Ui::LaunchDialog* ui;
 };
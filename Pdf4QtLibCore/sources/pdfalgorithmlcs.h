@@ -25,6 +25,9 @@
 
 #include "pdfglobal.h"
 
+#include <array>
+#include <vector>
+
 namespace pdf
 {
 
@@ -99,6 +102,13 @@ public:
 /// of objects, which are implementing operator "==" (equal operator).
 /// Constructor takes bidirectional iterators to the sequence. So, iterators
 /// are requred to be bidirectional.
+///
+/// Two methods are implemented. Classic dynamic programming table requires
+/// O(n*m) time and memory, it is used for small inputs. For large inputs,
+/// Myers O(ND) difference algorithm with linear space refinement (middle snake,
+/// divide and conquer) is used, which requires O((n+m)*D) time, where D is
+/// size of the minimal edit script, and O(n+m) memory. Both methods produce
+/// longest common subsequence in the same format.
 template<typename Iterator, typename Comparator>
 class PDFAlgorithmLongestCommonSubsequence : public PDFAlgorithmLongestCommonSubsequenceBase
 {
@@ -109,12 +119,39 @@ public:
                                          Iterator it2End,
                                          Comparator comparator);
 
+    enum class Method
+    {
+        Automatic,  ///< Select method by input size
+        Table,      ///< Dynamic programming table, O(n*m) time and memory
+        Myers       ///< Myers linear space algorithm, O((n+m)*D) time, O(n+m) memory
+    };
+
+    /// Maximal number of cells of the dynamic programming
+    /// table, for which table method is used automatically.
+    static constexpr size_t TABLE_METHOD_CELL_LIMIT = 16 * 1024 * 1024;
 
     void perform();
 
     const Sequence& getSequence() const { return m_sequence; }
 
+    Method getMethod() const { return m_method; }
+    void setMethod(Method method) { m_method = method; }
+
 private:
+    void performTable();
+    void performMyers();
+
+    /// Computes difference of subsequences [index1, index1 + size1) and
+    /// [index2, index2 + size2) and appends it to the sequence.
+    void performMyersRange(size_t index1, size_t size1, size_t index2, size_t size2);
+
+    /// Finds middle snake of the shortest edit script of given subsequences
+    /// (Myers, section 4b). Returns start and end point of the snake
+    /// in coordinates relative to the subsequences.
+    std::array<size_t, 4> findMiddleSnake(size_t index1, size_t size1, size_t index2, size_t size2);
+
+    bool isEqual(size_t index1, size_t index2) { return m_comparator(*m_items1[index1], *m_items2[index2]); }
+
     Iterator m_it1;
     Iterator m_it1End;
     Iterator m_it2;
@@ -125,9 +162,15 @@ private:
     size_t m_matrixSize;
 
     Comparator m_comparator;
+    Method m_method = Method::Automatic;
 
     std::vector<bool> m_backtrackData;
     Sequence m_sequence;
+
+    std::vector<Iterator> m_items1;
+    std::vector<Iterator> m_items2;
+    std::vector<std::ptrdiff_t> m_forward;
+    std::vector<std::ptrdiff_t> m_backward;
 };
 
 template<typename Iterator, typename Comparator>
@@ -152,6 +195,31 @@ PDFAlgorithmLongestCommonSubsequence<Iterator, Comparator>::PDFAlgorithmLongestC
 
 template<typename Iterator, typename Comparator>
 void PDFAlgorithmLongestCommonSubsequence<Iterator, Comparator>::perform()
+{
+    Method method = m_method;
+    if (method == Method::Automatic)
+    {
+        method = (m_matrixSize <= TABLE_METHOD_CELL_LIMIT) ? Method::Table : Method::Myers;
+    }
+
+    switch (method)
+    {
+        case Method::Table:
+            performTable();
+            break;
+
+        case Method::Myers:
+            performMyers();
+            break;
+
+        default:
+            Q_ASSERT(false);
+            break;
+    }
+}
+
+template<typename Iterator, typename Comparator>
+void PDFAlgorithmLongestCommonSubsequence<Iterator, Comparator>::performTable()
 {
     m_backtrackData.resize(m_matrixSize);
     m_sequence.clear();
@@ -260,6 +328,182 @@ void PDFAlgorithmLongestCommonSubsequence<Iterator, Comparator>::perform()
     std::reverse(m_sequence.begin(), m_sequence.end());
 }
 
+template<typename Iterator, typename Comparator>
+void PDFAlgorithmLongestCommonSubsequence<Iterator, Comparator>::performMyers()
+{
+    m_sequence.clear();
+    m_items1.clear();
+    m_items2.clear();
+
+    const size_t size1 = m_size1 - 1;
+    const size_t size2 = m_size2 - 1;
+
+    m_items1.reserve(size1);
+    m_items2.reserve(size2);
+    for (auto it = m_it1; it != m_it1End; ++it)
+    {
+        m_items1.push_back(it);
+    }
+    for (auto it = m_it2; it != m_it2End; ++it)
+    {
+        m_items2.push_back(it);
+    }
+
+    // Diagonals are in range [-(size1 + size2), size1 + size2], arrays
+    // are allocated once and reused in all recursion levels.
+    const size_t diagonalCount = 2 * (size1 + size2) + 3;
+    m_forward.assign(diagonalCount, 0);
+    m_backward.assign(diagonalCount, 0);
+
+    m_sequence.reserve(qMax(size1, size2));
+    performMyersRange(0, size1, 0, size2);
+
+    m_items1.clear();
+    m_items2.clear();
+    m_forward.clear();
+    m_forward.shrink_to_fit();
+    m_backward.clear();
+    m_backward.shrink_to_fit();
+}
+
+template<typename Iterator, typename Comparator>
+void PDFAlgorithmLongestCommonSubsequence<Iterator, Comparator>::performMyersRange(size_t index1, size_t size1, size_t index2, size_t size2)
+{
+    auto addMatch = [this](size_t i1, size_t i2)
+    {
+        SequenceItem item;
+        item.index1 = i1;
+        item.index2 = i2;
+        m_sequence.push_back(item);
+    };
+
+    // Common prefix
+    while (size1 > 0 && size2 > 0 && isEqual(index1, index2))
+    {
+        addMatch(index1++, index2++);
+        --size1;
+        --size2;
+    }
+
+    // Common suffix (it is added after the middle part)
+    size_t suffixSize = 0;
+    while (suffixSize < size1 && suffixSize < size2 && isEqual(index1 + size1 - suffixSize - 1, index2 + size2 - suffixSize - 1))
+    {
+        ++suffixSize;
+    }
+    size1 -= suffixSize;
+    size2 -= suffixSize;
+
+    if (size1 == 0 || size2 == 0)
+    {
+        for (size_t i = 0; i < size1; ++i)
+        {
+            SequenceItem item;
+            item.index1 = index1 + i;
+            m_sequence.push_back(item);
+        }
+
+        for (size_t i = 0; i < size2; ++i)
+        {
+            SequenceItem item;
+            item.index2 = index2 + i;
+            m_sequence.push_back(item);
+        }
+    }
+    else
+    {
+        // Both parts are nonempty and they have different first and last items,
+        // so edit script has at least two edits and middle snake splits the problem
+        // into two strictly smaller problems.
+        const std::array<size_t, 4> snake = findMiddleSnake(index1, size1, index2, size2);
+        const size_t x = snake[0];
+        const size_t y = snake[1];
+        const size_t u = snake[2];
+        const size_t v = snake[3];
+
+        performMyersRange(index1, x, index2, y);
+        for (size_t i = 0; i < u - x; ++i)
+        {
+            addMatch(index1 + x + i, index2 + y + i);
+        }
+        performMyersRange(index1 + u, size1 - u, index2 + v, size2 - v);
+    }
+
+    for (size_t i = 0; i < suffixSize; ++i)
+    {
+        addMatch(index1 + size1 + i, index2 + size2 + i);
+    }
+}
+
+template<typename Iterator, typename Comparator>
+std::array<size_t, 4> PDFAlgorithmLongestCommonSubsequence<Iterator, Comparator>::findMiddleSnake(size_t index1, size_t size1, size_t index2, size_t size2)
+{
+    // Forward array contains furthest reaching x on diagonal k = x - y, backward
+    // array contains furthest reaching x on diagonal k of reversed sequences.
+    const std::ptrdiff_t n = size1;
+    const std::ptrdiff_t m = size2;
+    const std::ptrdiff_t delta = n - m;
+    const bool isOdd = (delta % 2) != 0;
+    const std::ptrdiff_t maxD = (n + m + 1) / 2;
+    const std::ptrdiff_t offset = maxD + 1;
+
+    Q_ASSERT(size_t(2 * offset + 1) <= m_forward.size());
+
+    std::ptrdiff_t* forward = m_forward.data() + offset;
+    std::ptrdiff_t* backward = m_backward.data() + offset;
+    forward[1] = 0;
+    backward[1] = 0;
+
+    for (std::ptrdiff_t d = 0; d <= maxD; ++d)
+    {
+        for (std::ptrdiff_t k = -d; k <= d; k += 2)
+        {
+            std::ptrdiff_t x = (k == -d || (k != d && forward[k - 1] < forward[k + 1])) ? forward[k + 1] : forward[k - 1] + 1;
+            std::ptrdiff_t y = x - k;
+            const std::ptrdiff_t xStart = x;
+            const std::ptrdiff_t yStart = y;
+
+            while (x < n && y < m && isEqual(index1 + x, index2 + y))
+            {
+                ++x;
+                ++y;
+            }
+            forward[k] = x;
+
+            const std::ptrdiff_t kBackward = delta - k;
+            if (isOdd && kBackward >= -(d - 1) && kBackward <= d - 1 && forward[k] + backward[kBackward] >= n)
+            {
+                return { size_t(xStart), size_t(yStart), size_t(x), size_t(y) };
+            }
+        }
+
+        for (std::ptrdiff_t k = -d; k <= d; k += 2)
+        {
+            std::ptrdiff_t x = (k == -d || (k != d && backward[k - 1] < backward[k + 1])) ? backward[k + 1] : backward[k - 1] + 1;
+            std::ptrdiff_t y = x - k;
+            const std::ptrdiff_t xStart = x;
+            const std::ptrdiff_t yStart = y;
+
+            while (x < n && y < m && isEqual(index1 + n - x - 1, index2 + m - y - 1))
+            {
+                ++x;
+                ++y;
+            }
+            backward[k] = x;
+
+            const std::ptrdiff_t kForward = delta - k;
+            if (!isOdd && kForward >= -d && kForward <= d && forward[kForward] + backward[k] >= n)
+            {
+                return { size_t(n - x), size_t(m - y), size_t(n - xStart), size_t(m - yStart) };
+            }
+        }
+    }
+
+    // We should never get here, overlap is always found
+    Q_ASSERT(false);
+    return { 0, 0, 0, 0 };
+}
+
 }   // namespace pdf
 
 #endif // PDFALGORITHMLCS_H
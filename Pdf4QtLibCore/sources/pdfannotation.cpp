@@ -1305,6 +1305,9 @@ PDFAnnotationAdditionalActions PDFAnnotationAdditionalActions::parse(const PDFOb
     return result;
 }
 
+/// Maximal total size of cached appearance stream renditions in bytes
+constexpr qint64 APPEARANCE_CACHE_BUDGET = 32 * 1024 * 1024;
+
 PDFAnnotationManager::PDFAnnotationManager(PDFFontCache* fontCache,
                                            const PDFCMSManager* cmsManager,
                                            const PDFOptionalContentActivity* optionalActivity,
@@ -1322,7 +1325,12 @@ PDFAnnotationManager::PDFAnnotationManager(PDFFontCache* fontCache,
     m_features(features),
     m_target(target)
 {
+    m_appearanceCache.setMaxCost(APPEARANCE_CACHE_BUDGET);
 
+    if (m_optionalActivity)
+    {
+        m_optionalActivityConnection = connect(m_optionalActivity, &PDFOptionalContentActivity::optionalContentGroupStateChanged, this, &PDFAnnotationManager::clearAppearanceCache);
+    }
 }
 
 PDFAnnotationManager::~PDFAnnotationManager()
@@ -1662,7 +1670,57 @@ void PDFAnnotationManager::drawAnnotationUsingAppearanceStream(const PageAnnotat
 
     bool isContentVisible = false;
 
-    // Draw annotation
+    // Jakub Melka: try to use cached rendition of the appearance stream. Rendition
+    // is recorded in the user space without translation of the matrix AA, so it
+    // doesn't depend on zoom and can be shared by annotations of the same size.
+    // Annotations with optional content are not cached, because visibility
+    // of the annotation is evaluated by the painter.
+    if (!annotation.annotation->getOptionalContent().isValid())
+    {
+        AppearanceCacheKey key;
+        key.streamId = formStream->getUniqueId();
+        key.cmsId = cms->getUniqueId();
+        key.features = features.toInt();
+        key.m11 = AA.m11();
+        key.m12 = AA.m12();
+        key.m21 = AA.m21();
+        key.m22 = AA.m22();
+
+        const QTransform formLinearMatrix(AA.m11(), AA.m12(), AA.m21(), AA.m22(), 0.0, 0.0);
+        const QTransform formTranslationMatrix = QTransform::fromTranslate(AA.dx(), AA.dy());
+
+        std::shared_ptr<const PDFPrecompiledPage> rendition;
+        {
+            QMutexLocker lock(&m_mutex);
+            if (const std::shared_ptr<const PDFPrecompiledPage>* cachedRendition = m_appearanceCache.object(key))
+            {
+                rendition = *cachedRendition;
+            }
+        }
+
+        if (!rendition)
+        {
+            auto precompiledPage = std::make_shared<PDFPrecompiledPage>();
+            PDFPrecompiledPageGenerator generator(precompiledPage.get(), features, page, m_document, m_fontCache, cms, m_optionalActivity, m_meshQualitySettings);
+            generator.initializeProcessor();
+            generator.processForm(formLinearMatrix, formBoundingBox, resources, transparencyGroup, content, formStructuralParentKey);
+            precompiledPage->optimize();
+            precompiledPage->finalize(0, QList<PDFRenderError>());
+            rendition = precompiledPage;
+
+            QMutexLocker lock(&m_mutex);
+            if (!m_appearanceCache.contains(key))
+            {
+                m_appearanceCache.insert(key, new std::shared_ptr<const PDFPrecompiledPage>(rendition), qMax<qint64>(rendition->getMemoryConsumptionEstimate(), 1));
+            }
+        }
+
+        // Crop box is shifted, because it is mapped from the recorded space
+        const QRectF cropBox = page->getCropBox().translated(-AA.dx(), -AA.dy());
+        rendition->draw(painter, cropBox, formTranslationMatrix * userSpaceToDeviceSpace, features, painter->opacity());
+        isContentVisible = true;
+    }
+    else
     {
         PDFPainterStateGuard guard(painter);
         PDFPainter pdfPainter(painter, features, userSpaceToDeviceSpace, page, m_document, m_fontCache, cms, m_optionalActivity, m_meshQualitySettings);
@@ -1694,15 +1752,26 @@ void PDFAnnotationManager::setDocument(const PDFModifiedDocument& document)
     if (m_document != document)
     {
         m_document = document;
-        m_optionalActivity = document.getOptionalContentActivity();
+        setOptionalActivity(document.getOptionalContentActivity());
 
         if (document.hasReset() || document.hasFlag(PDFModifiedDocument::Annotation))
         {
             m_pageAnnotations.clear();
         }
+
+        if (document.hasReset() || document.hasFlag(PDFModifiedDocument::Annotation) || document.hasFlag(PDFModifiedDocument::FormField))
+        {
+            clearAppearanceCache();
+        }
     }
 }
 
+void PDFAnnotationManager::clearAppearanceCache()
+{
+    QMutexLocker lock(&m_mutex);
+    m_appearanceCache.clear();
+}
+
 PDFObject PDFAnnotationManager::getAppearanceStream(const PageAnnotation& pageAnnotation) const
 {
     auto getAppearanceStream = [&pageAnnotation] (void) -> PDFObject
@@ -1809,6 +1878,7 @@ PDFMeshQualitySettings PDFAnnotationManager::getMeshQualitySettings() const
 void PDFAnnotationManager::setMeshQualitySettings(const PDFMeshQualitySettings& meshQualitySettings)
 {
     m_meshQualitySettings = meshQualitySettings;
+    clearAppearanceCache();
 }
 
 PDFFontCache* PDFAnnotationManager::getFontCache() const
@@ -1828,7 +1898,17 @@ const PDFOptionalContentActivity* PDFAnnotationManager::getOptionalActivity() co
 
 void PDFAnnotationManager::setOptionalActivity(const PDFOptionalContentActivity* optionalActivity)
 {
-    m_optionalActivity = optionalActivity;
+    if (m_optionalActivity != optionalActivity)
+    {
+        disconnect(m_optionalActivityConnection);
+        m_optionalActivity = optionalActivity;
+        clearAppearanceCache();
+
+        if (m_optionalActivity)
+        {
+            m_optionalActivityConnection = connect(m_optionalActivity, &PDFOptionalContentActivity::optionalContentGroupStateChanged, this, &PDFAnnotationManager::clearAppearanceCache);
+        }
+    }
 }
 
 PDFAnnotationManager::Target PDFAnnotationManager::getTarget() const
@@ -36,6 +36,7 @@
 #include "pdfcolorconvertor.h"
 #include "pdftextlayout.h"
 
+#include <QCache>
 #include <QCursor>
 #include <QPainterPath>
 
@@ -1631,6 +1632,31 @@ protected:
                                              const PDFCMS* cms,
                                              QPainter* painter) const;
 
+    /// Key of the cached appearance stream rendition. Rendition is recorded
+    /// without translation part of the form matrix, so annotations of the same
+    /// size sharing one appearance stream (for example, check boxes) share also
+    /// the cached rendition.
+    struct AppearanceCacheKey
+    {
+        bool operator==(const AppearanceCacheKey&) const = default;
+
+        friend size_t qHash(const AppearanceCacheKey& key, size_t seed = 0)
+        {
+            return qHashMulti(seed, key.streamId, key.cmsId, key.features, key.m11, key.m12, key.m21, key.m22);
+        }
+
+        quint64 streamId = 0;   ///< Unique id of the appearance stream
+        quint64 cmsId = 0;      ///< Unique id of the color management system
+        int features = 0;       ///< Renderer features
+        PDFReal m11 = 0.0;      ///< Linear part of the form to user space matrix
+        PDFReal m12 = 0.0;
+        PDFReal m21 = 0.0;
+        PDFReal m22 = 0.0;
+    };
+
+    /// Clears cached appearance stream renditions
+    void clearAppearanceCache();
+
     const PDFDocument* m_document;
 
     PDFFontCache* m_fontCache;
@@ -1642,6 +1668,8 @@ protected:
 
     mutable QMutex m_mutex;
     mutable std::map<PDFInteger, PageAnnotations> m_pageAnnotations;
+    mutable QCache<AppearanceCacheKey, std::shared_ptr<const PDFPrecompiledPage>> m_appearanceCache;
+    QMetaObject::Connection m_optionalActivityConnection;
     Target m_target = Target::View;
 };
 
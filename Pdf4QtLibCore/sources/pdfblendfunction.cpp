@@ -25,6 +25,14 @@
 
 #include <algorithm>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PDF4QT_BLEND_FUNCTION_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define PDF4QT_BLEND_FUNCTION_NEON
+#include <arm_neon.h>
+#endif
+
 namespace pdf
 {
 
@@ -267,122 +275,327 @@ std::vector<BlendMode> PDFBlendModeInfo::getBlendModes()
     };
 }
 
-PDFColorComponent PDFBlendFunction::blend(BlendMode mode, PDFColorComponent Cb, PDFColorComponent Cs)
+namespace
 {
-    switch (mode)
-    {
-        case BlendMode::Normal:
-        case BlendMode::Compatible:
-            return Cs;
-
-        case BlendMode::Multiply:
-            return Cb * Cs;
 
-        case BlendMode::Screen:
-            return Cb + Cs - Cb * Cs;
+template<BlendMode mode>
+inline PDFColorComponent blendSeparable(PDFColorComponent Cb, PDFColorComponent Cs)
+{
+    if constexpr (mode == BlendMode::Normal || mode == BlendMode::Compatible)
+    {
+        return Cs;
+    }
+    else if constexpr (mode == BlendMode::Multiply)
+    {
+        return Cb * Cs;
+    }
+    else if constexpr (mode == BlendMode::Screen)
+    {
+        return Cb + Cs - Cb * Cs;
+    }
+    else if constexpr (mode == BlendMode::Overlay)
+    {
+        return blendSeparable<BlendMode::HardLight>(Cs, Cb);
+    }
+    else if constexpr (mode == BlendMode::Darken)
+    {
+        return qMin(Cb, Cs);
+    }
+    else if constexpr (mode == BlendMode::Lighten)
+    {
+        return qMax(Cb, Cs);
+    }
+    else if constexpr (mode == BlendMode::ColorDodge)
+    {
+        if (qFuzzyIsNull(Cb))
+        {
+            return 0.0f;
+        }
 
-        case BlendMode::Overlay:
-            return blend(BlendMode::HardLight, Cs, Cb);
+        const PDFColorComponent CsInverted = 1.0f - Cs;
+        if (Cb >= CsInverted)
+        {
+            return 1.0f;
+        }
 
-        case BlendMode::Darken:
-            return qMin(Cb, Cs);
+        return Cb / CsInverted;
+    }
+    else if constexpr (mode == BlendMode::ColorBurn)
+    {
+        const PDFColorComponent CbInverted = 1.0f - Cb;
+        if (qFuzzyIsNull(CbInverted))
+        {
+            return 1.0f;
+        }
 
-        case BlendMode::Lighten:
-            return qMax(Cb, Cs);
+        if (CbInverted >= Cs)
+        {
+            return 0.0f;
+        }
 
-        case BlendMode::ColorDodge:
+        return 1.0f - CbInverted / Cs;
+    }
+    else if constexpr (mode == BlendMode::HardLight)
+    {
+        if (Cs <= 0.5f)
+        {
+            return blendSeparable<BlendMode::Multiply>(Cb, 2.0f * Cs);
+        }
+        else
         {
-            if (qFuzzyIsNull(Cb))
+            return blendSeparable<BlendMode::Screen>(Cb, 2.0f * Cs - 1.0f);
+        }
+    }
+    else if constexpr (mode == BlendMode::SoftLight)
+    {
+        if (Cs <= 0.5f)
+        {
+            return Cb - (1.0f - 2.0f * Cs) * Cb * (1.0f - Cb);
+        }
+        else
+        {
+            PDFColorComponent D = 0.0f;
+            if (Cb <= 0.25)
             {
-                return 0.0f;
+                D = ((16.0f * Cb - 12.0f) * Cb + 4.0f) * Cb;
             }
-
-            const PDFColorComponent CsInverted = 1.0f - Cs;
-            if (Cb >= CsInverted)
+            else
             {
-                return 1.0f;
+                D = std::sqrt(Cb);
             }
-
-            return Cb / CsInverted;
+            return Cb + (2.0f * Cs - 1.0f) * (D - Cb);
+        }
+    }
+    else if constexpr (mode == BlendMode::Difference)
+    {
+        return qAbs(Cb - Cs);
+    }
+    else if constexpr (mode == BlendMode::Exclusion)
+    {
+        return Cb + Cs - 2.0f * Cb * Cs;
+    }
+    else if constexpr (mode == BlendMode::Overprint_SelectBackdrop)
+    {
+        return Cb;
+    }
+    else if constexpr (mode == BlendMode::Overprint_SelectNonZeroSourceOrBackdrop)
+    {
+        if (qFuzzyIsNull(Cs))
+        {
+            return Cb;
         }
 
-        case BlendMode::ColorBurn:
+        return Cs;
+    }
+    else if constexpr (mode == BlendMode::Overprint_SelectNonOneSourceOrBackdrop)
+    {
+        if (qFuzzyIsNull(1.0f - Cs))
         {
-            const PDFColorComponent CbInverted = 1.0f - Cb;
-            if (qFuzzyIsNull(CbInverted))
-            {
-                return 1.0f;
-            }
+            return Cb;
+        }
 
-            if (CbInverted >= Cs)
-            {
-                return 0.0f;
-            }
+        return Cs;
+    }
+    else
+    {
+        static_assert(mode == BlendMode::Normal, "Blend mode is not separable.");
+        return Cs;
+    }
+}
 
-            return 1.0f - CbInverted / Cs;
-        }
+#if defined(PDF4QT_BLEND_FUNCTION_SSE2)
 
-        case BlendMode::HardLight:
+#define PDF4QT_BLEND_FUNCTION_SIMD
+
+using Vector = __m128;
+
+constexpr size_t VECTOR_SIZE = 4;
+
+inline Vector load(const PDFColorComponent* data) { return _mm_loadu_ps(data); }
+inline void store(PDFColorComponent* data, Vector vector) { _mm_storeu_ps(data, vector); }
+inline Vector broadcast(PDFColorComponent value) { return _mm_set1_ps(value); }
+inline Vector add(Vector left, Vector right) { return _mm_add_ps(left, right); }
+inline Vector sub(Vector left, Vector right) { return _mm_sub_ps(left, right); }
+inline Vector mul(Vector left, Vector right) { return _mm_mul_ps(left, right); }
+inline Vector min(Vector left, Vector right) { return _mm_min_ps(left, right); }
+inline Vector max(Vector left, Vector right) { return _mm_max_ps(left, right); }
+inline Vector abs(Vector vector) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), vector); }
+
+#elif defined(PDF4QT_BLEND_FUNCTION_NEON)
+
+#define PDF4QT_BLEND_FUNCTION_SIMD
+
+using Vector = float32x4_t;
+
+constexpr size_t VECTOR_SIZE = 4;
+
+inline Vector load(const PDFColorComponent* data) { return vld1q_f32(data); }
+inline void store(PDFColorComponent* data, Vector vector) { vst1q_f32(data, vector); }
+inline Vector broadcast(PDFColorComponent value) { return vdupq_n_f32(value); }
+inline Vector add(Vector left, Vector right) { return vaddq_f32(left, right); }
+inline Vector sub(Vector left, Vector right) { return vsubq_f32(left, right); }
+inline Vector mul(Vector left, Vector right) { return vmulq_f32(left, right); }
+inline Vector min(Vector left, Vector right) { return vbslq_f32(vcltq_f32(left, right), left, right); }
+inline Vector max(Vector left, Vector right) { return vbslq_f32(vcltq_f32(right, left), left, right); }
+inline Vector abs(Vector vector) { return vabsq_f32(vector); }
+
+#endif
+
+/// Returns true, if blend mode has vectorized implementation
+template<BlendMode mode>
+constexpr bool isVectorized()
+{
+    return mode == BlendMode::Normal || mode == BlendMode::Compatible || mode == BlendMode::Multiply ||
+           mode == BlendMode::Screen || mode == BlendMode::Darken || mode == BlendMode::Lighten ||
+           mode == BlendMode::Difference || mode == BlendMode::Exclusion || mode == BlendMode::Overprint_SelectBackdrop;
+}
+
+#if defined(PDF4QT_BLEND_FUNCTION_SIMD)
+
+template<BlendMode mode>
+inline Vector blendSeparable(Vector Cb, Vector Cs)
+{
+    if constexpr (mode == BlendMode::Normal || mode == BlendMode::Compatible)
+    {
+        return Cs;
+    }
+    else if constexpr (mode == BlendMode::Multiply)
+    {
+        return mul(Cb, Cs);
+    }
+    else if constexpr (mode == BlendMode::Screen)
+    {
+        return sub(add(Cb, Cs), mul(Cb, Cs));
+    }
+    else if constexpr (mode == BlendMode::Darken)
+    {
+        return min(Cb, Cs);
+    }
+    else if constexpr (mode == BlendMode::Lighten)
+    {
+        return max(Cb, Cs);
+    }
+    else if constexpr (mode == BlendMode::Difference)
+    {
+        return abs(sub(Cb, Cs));
+    }
+    else if constexpr (mode == BlendMode::Exclusion)
+    {
+        const Vector product = mul(Cb, Cs);
+        return sub(add(Cb, Cs), add(product, product));
+    }
+    else
+    {
+        static_assert(mode == BlendMode::Overprint_SelectBackdrop, "Blend mode is not vectorized.");
+        return Cb;
+    }
+}
+
+#endif
+
+template<BlendMode mode, bool subtractive>
+void blendSpanImpl(const PDFColorComponent* Cb, const PDFColorComponent* Cs, PDFColorComponent* B, size_t count)
+{
+    size_t i = 0;
+
+#if defined(PDF4QT_BLEND_FUNCTION_SIMD)
+    if constexpr (isVectorized<mode>())
+    {
+        const Vector one = broadcast(1.0f);
+        for (; i + VECTOR_SIZE <= count; i += VECTOR_SIZE)
         {
-            if (Cs <= 0.5f)
+            Vector backdrop = load(Cb + i);
+            Vector source = load(Cs + i);
+
+            if constexpr (subtractive)
             {
-                return blend(BlendMode::Multiply, Cb, 2.0f * Cs);
+                store(B + i, sub(one, blendSeparable<mode>(sub(one, backdrop), sub(one, source))));
             }
             else
             {
-                return blend(BlendMode::Screen, Cb, 2.0f * Cs - 1.0f);
+                store(B + i, blendSeparable<mode>(backdrop, source));
             }
         }
+    }
+#endif
 
-        case BlendMode::SoftLight:
+    for (; i < count; ++i)
+    {
+        if constexpr (subtractive)
         {
-            if (Cs <= 0.5f)
-            {
-                return Cb - (1.0f - 2.0f * Cs) * Cb * (1.0f - Cb);
-            }
-            else
-            {
-                PDFColorComponent D = 0.0f;
-                if (Cb <= 0.25)
-                {
-                    D = ((16.0f * Cb - 12.0f) * Cb + 4.0f) * Cb;
-                }
-                else
-                {
-                    D = std::sqrt(Cb);
-                }
-                return Cb + (2.0f * Cs - 1.0f) * (D - Cb);
-            }
+            B[i] = 1.0f - blendSeparable<mode>(1.0f - Cb[i], 1.0f - Cs[i]);
+        }
+        else
+        {
+            B[i] = blendSeparable<mode>(Cb[i], Cs[i]);
         }
+    }
+}
+
+template<BlendMode mode>
+void blendSpanMode(bool subtractive, const PDFColorComponent* Cb, const PDFColorComponent* Cs, PDFColorComponent* B, size_t count)
+{
+    if (subtractive)
+    {
+        blendSpanImpl<mode, true>(Cb, Cs, B, count);
+    }
+    else
+    {
+        blendSpanImpl<mode, false>(Cb, Cs, B, count);
+    }
+}
+
+}   // namespace
+
+PDFColorComponent PDFBlendFunction::blend(BlendMode mode, PDFColorComponent Cb, PDFColorComponent Cs)
+{
+    switch (mode)
+    {
+        case BlendMode::Normal:
+        case BlendMode::Compatible:
+            return blendSeparable<BlendMode::Normal>(Cb, Cs);
+
+        case BlendMode::Multiply:
+            return blendSeparable<BlendMode::Multiply>(Cb, Cs);
+
+        case BlendMode::Screen:
+            return blendSeparable<BlendMode::Screen>(Cb, Cs);
+
+        case BlendMode::Overlay:
+            return blendSeparable<BlendMode::Overlay>(Cb, Cs);
+
+        case BlendMode::Darken:
+            return blendSeparable<BlendMode::Darken>(Cb, Cs);
+
+        case BlendMode::Lighten:
+            return blendSeparable<BlendMode::Lighten>(Cb, Cs);
+
+        case BlendMode::ColorDodge:
+            return blendSeparable<BlendMode::ColorDodge>(Cb, Cs);
+
+        case BlendMode::ColorBurn:
+            return blendSeparable<BlendMode::ColorBurn>(Cb, Cs);
+
+        case BlendMode::HardLight:
+            return blendSeparable<BlendMode::HardLight>(Cb, Cs);
+
+        case BlendMode::SoftLight:
+            return blendSeparable<BlendMode::SoftLight>(Cb, Cs);
 
         case BlendMode::Difference:
-            return qAbs(Cb - Cs);
+            return blendSeparable<BlendMode::Difference>(Cb, Cs);
 
         case BlendMode::Exclusion:
-            return Cb + Cs - 2.0f * Cb * Cs;
+            return blendSeparable<BlendMode::Exclusion>(Cb, Cs);
 
         case BlendMode::Overprint_SelectBackdrop:
-            return Cb;
+            return blendSeparable<BlendMode::Overprint_SelectBackdrop>(Cb, Cs);
 
         case BlendMode::Overprint_SelectNonZeroSourceOrBackdrop:
-        {
-            if (qFuzzyIsNull(Cs))
-            {
-                return Cb;
-            }
-
-            return Cs;
-        }
+            return blendSeparable<BlendMode::Overprint_SelectNonZeroSourceOrBackdrop>(Cb, Cs);
 
         case BlendMode::Overprint_SelectNonOneSourceOrBackdrop:
-        {
-            if (qFuzzyIsNull(1.0f - Cs))
-            {
-                return Cb;
-            }
-
-            return Cs;
-        }
+            return blendSeparable<BlendMode::Overprint_SelectNonOneSourceOrBackdrop>(Cb, Cs);
 
         default:
         {
@@ -394,6 +607,85 @@ PDFColorComponent PDFBlendFunction::blend(BlendMode mode, PDFColorComponent Cb,
     return Cs;
 }
 
+void PDFBlendFunction::blendSpan(BlendMode mode,
+                                 bool subtractive,
+                                 const PDFColorComponent* Cb,
+                                 const PDFColorComponent* Cs,
+                                 PDFColorComponent* B,
+                                 size_t count)
+{
+    switch (mode)
+    {
+        case BlendMode::Normal:
+        case BlendMode::Compatible:
+            blendSpanMode<BlendMode::Normal>(subtractive, Cb, Cs, B, count);
+            break;
+
+        case BlendMode::Multiply:
+            blendSpanMode<BlendMode::Multiply>(subtractive, Cb, Cs, B, count);
+            break;
+
+        case BlendMode::Screen:
+            blendSpanMode<BlendMode::Screen>(subtractive, Cb, Cs, B, count);
+            break;
+
+        case BlendMode::Overlay:
+            blendSpanMode<BlendMode::Overlay>(subtractive, Cb, Cs, B, count);
+            break;
+
+        case BlendMode::Darken:
+            blendSpanMode<BlendMode::Darken>(subtractive, Cb, Cs, B, count);
+            break;
+
+        case BlendMode::Lighten:
+            blendSpanMode<BlendMode::Lighten>(subtractive, Cb, Cs, B, count);
+            break;
+
+        case BlendMode::ColorDodge:
+            blendSpanMode<BlendMode::ColorDodge>(subtractive, Cb, Cs, B, count);
+            break;
+
+        case BlendMode::ColorBurn:
+            blendSpanMode<BlendMode::ColorBurn>(subtractive, Cb, Cs, B, count);
+            break;
+
+        case BlendMode::HardLight:
+            blendSpanMode<BlendMode::HardLight>(subtractive, Cb, Cs, B, count);
+            break;
+
+        case BlendMode::SoftLight:
+            blendSpanMode<BlendMode::SoftLight>(subtractive, Cb, Cs, B, count);
+            break;
+
+        case BlendMode::Difference:
+            blendSpanMode<BlendMode::Difference>(subtractive, Cb, Cs, B, count);
+            break;
+
+        case BlendMode::Exclusion:
+            blendSpanMode<BlendMode::Exclusion>(subtractive, Cb, Cs, B, count);
+            break;
+
+        case BlendMode::Overprint_SelectBackdrop:
+            blendSpanMode<BlendMode::Overprint_SelectBackdrop>(subtractive, Cb, Cs, B, count);
+            break;
+
+        case BlendMode::Overprint_SelectNonZeroSourceOrBackdrop:
+            blendSpanMode<BlendMode::Overprint_SelectNonZeroSourceOrBackdrop>(subtractive, Cb, Cs, B, count);
+            break;
+
+        case BlendMode::Overprint_SelectNonOneSourceOrBackdrop:
+            blendSpanMode<BlendMode::Overprint_SelectNonOneSourceOrBackdrop>(subtractive, Cb, Cs, B, count);
+            break;
+
+        default:
+        {
+            Q_ASSERT(false);
+            std::copy(Cs, Cs + count, B);
+            break;
+        }
+    }
+}
+
 PDFRGB PDFBlendFunction::blend_Hue(PDFRGB Cb, PDFRGB Cs)
 {
     return nonseparable_SetLum(nonseparable_SetSat(Cs, nonseparable_Sat(Cb)), nonseparable_Lum(Cb));
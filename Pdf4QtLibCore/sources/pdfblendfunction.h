@@ -119,6 +119,23 @@ public:
     /// \param Cs Source color
     static PDFColorComponent blend(BlendMode mode, PDFColorComponent Cb, PDFColorComponent Cs);
 
+    /// Blends span of color components using separable blend mode. Blend mode
+    /// is selected once for the whole span, simple blend modes are vectorized.
+    /// If colors are subtractive, they are inverted before blending and
+    /// the blended color is inverted back.
+    /// \param mode Separable blend mode
+    /// \param subtractive Are colors subtractive?
+    /// \param Cb Backdrop colors
+    /// \param Cs Source colors
+    /// \param B Blended colors
+    /// \param count Number of color components
+    static void blendSpan(BlendMode mode,
+                          bool subtractive,
+                          const PDFColorComponent* Cb,
+                          const PDFColorComponent* Cs,
+                          PDFColorComponent* B,
+                          size_t count);
+
     /// Blend non-separable hue function
     /// \param Cb Backdrop color
     /// \param Cs Source color
@@ -22,6 +22,7 @@
 
 #include "pdfblpainter.h"
 #include "pdffont.h"
+#include "pdfpainterutils.h"
 
 #include <QThread>
 #include <QRawFont>
@@ -37,7 +38,7 @@ namespace pdf
 class PDFBLPaintEngine : public QPaintEngine
 {
 public:
-    explicit PDFBLPaintEngine(QImage& qtOffscreenBuffer, bool isMultithreaded);
+    explicit PDFBLPaintEngine(QImage& qtOffscreenBuffer, bool isMultithreaded, int threadCount);
 
     virtual bool begin(QPaintDevice*) override;
     virtual bool end() override;
@@ -118,6 +119,7 @@ private:
     std::optional<BLContext> m_blContext;
     std::optional<BLImage> m_blOffscreenBuffer;
     bool m_isMultithreaded;
+    int m_threadCount;
 
     QPen m_currentPen;
     QBrush m_currentBrush;
@@ -131,9 +133,9 @@ private:
     QRectF m_finalClipPathBoundingBox;
 };
 
-PDFBLPaintDevice::PDFBLPaintDevice(QImage& offscreenBuffer, bool isMultithreaded) :
+PDFBLPaintDevice::PDFBLPaintDevice(QImage& offscreenBuffer, bool isMultithreaded, int threadCount) :
     m_offscreenBuffer(offscreenBuffer),
-    m_paintEngine(new PDFBLPaintEngine(offscreenBuffer, isMultithreaded))
+    m_paintEngine(new PDFBLPaintEngine(offscreenBuffer, isMultithreaded, threadCount))
 {
 
 }
@@ -195,10 +197,11 @@ int PDFBLPaintDevice::metric(PaintDeviceMetric metric) const
     return 0;
 }
 
-PDFBLPaintEngine::PDFBLPaintEngine(QImage& qtOffscreenBuffer, bool isMultithreaded) :
+PDFBLPaintEngine::PDFBLPaintEngine(QImage& qtOffscreenBuffer, bool isMultithreaded, int threadCount) :
     QPaintEngine(getStaticFeatures()),
     m_qtOffscreenBuffer(qtOffscreenBuffer),
-    m_isMultithreaded(isMultithreaded)
+    m_isMultithreaded(isMultithreaded),
+    m_threadCount(threadCount > 0 ? threadCount : QThread::idealThreadCount())
 {
 
 }
@@ -218,7 +221,7 @@ bool PDFBLPaintEngine::begin(QPaintDevice*)
     if (m_isMultithreaded)
     {
         info.flags = BL_CONTEXT_CREATE_FLAG_FALLBACK_TO_SYNC;
-        info.thread_count = QThread::idealThreadCount();
+        info.thread_count = m_threadCount;
     }
 
     m_blContext->set_hint(BL_CONTEXT_HINT_RENDERING_QUALITY, BL_RENDERING_QUALITY_MAX_VALUE);
@@ -1150,6 +1153,11 @@ void PDFBLPaintEngine::updateClipping(std::optional<QRegion> clipRegion,
 
     finalClipPath = m_currentTransform.map(finalClipPath);
 
+    // Rectangular clips are intersected analytically, path
+    // intersection is used only, if some of the clips is a true path.
+    const QRectF clipRect = PDFPainterHelper::getAxisAlignedRectangle(finalClipPath);
+    QRectF finalClipRect;
+
     switch (clipOperation)
     {
         case Qt::NoClip:
@@ -1162,6 +1170,7 @@ void PDFBLPaintEngine::updateClipping(std::optional<QRegion> clipRegion,
         case Qt::ReplaceClip:
         {
             m_finalClipPath = std::move(finalClipPath);
+            finalClipRect = clipRect;
             break;
         }
 
@@ -1169,30 +1178,51 @@ void PDFBLPaintEngine::updateClipping(std::optional<QRegion> clipRegion,
         {
             if (m_finalClipPath.has_value())
             {
-                m_finalClipPath = m_finalClipPath->intersected(finalClipPath);
+                if (m_clipSingleRect && clipRect.isValid())
+                {
+                    finalClipRect = m_finalClipPathBoundingBox.intersected(clipRect);
+
+                    QPainterPath intersectedClipPath;
+                    intersectedClipPath.addRect(finalClipRect);
+                    m_finalClipPath = std::move(intersectedClipPath);
+                }
+                else
+                {
+                    m_finalClipPath = m_finalClipPath->intersected(finalClipPath);
+                }
             }
             else
             {
                 m_finalClipPath = std::move(finalClipPath);
+                finalClipRect = clipRect;
             }
             break;
         }
     }
 
     m_clipSingleRect = false;
-    m_finalClipPathBoundingBox = m_finalClipPath->controlPointRect();
 
-    if (m_finalClipPath->elementCount() == 5)
+    if (finalClipRect.isValid())
     {
-        QRectF testRect = m_finalClipPathBoundingBox.adjusted(1.0, 1.0, -2.0, -2.0);
-        m_clipSingleRect = m_finalClipPath->contains(testRect);
+        m_clipSingleRect = true;
+        m_finalClipPathBoundingBox = finalClipRect;
+    }
+    else
+    {
+        m_finalClipPathBoundingBox = m_finalClipPath->controlPointRect();
+
+        if (m_finalClipPath->elementCount() == 5)
+        {
+            QRectF testRect = m_finalClipPathBoundingBox.adjusted(1.0, 1.0, -2.0, -2.0);
+            m_clipSingleRect = m_finalClipPath->contains(testRect);
+        }
     }
 
     if (m_clipSingleRect)
     {
         BLMatrix2D matrix = m_blContext->user_transform();
         m_blContext->reset_transform();
-        m_blContext->clip_to_rect(getBLRect(m_finalClipPath->boundingRect()));
+        m_blContext->clip_to_rect(getBLRect(m_finalClipPathBoundingBox));
         m_blContext->set_transform(matrix);
     }
     else
@@ -35,7 +35,11 @@ class PDFBLPaintEngine;
 class PDF4QTLIBCORESHARED_EXPORT PDFBLPaintDevice : public QPaintDevice
 {
 public:
-    PDFBLPaintDevice(QImage& offscreenBuffer, bool isMultithreaded);
+    /// Creates paint device, which paints onto offscreen buffer using Blend2D
+    /// \param offscreenBuffer Offscreen buffer
+    /// \param isMultithreaded Use Blend2D worker threads
+    /// \param threadCount Number of Blend2D worker threads (zero means ideal thread count)
+    PDFBLPaintDevice(QImage& offscreenBuffer, bool isMultithreaded, int threadCount = 0);
     virtual ~PDFBLPaintDevice() override;
 
     virtual int devType() const override;
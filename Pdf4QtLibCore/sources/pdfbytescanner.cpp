@@ -0,0 +1,256 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pdfbytescanner.h"
+#include "pdfparser.h"
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__AVX2__)
+#define PDF4QT_BYTE_SCANNER_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PDF4QT_BYTE_SCANNER_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define PDF4QT_BYTE_SCANNER_NEON
+#include <arm_neon.h>
+#endif
+
+#include "pdfdbgheap.h"
+
+namespace pdf
+{
+
+namespace
+{
+
+#if defined(PDF4QT_BYTE_SCANNER_AVX2)
+
+#define PDF4QT_BYTE_SCANNER_SIMD
+
+using Vector = __m256i;
+
+constexpr std::ptrdiff_t VECTOR_SIZE = 32;
+constexpr int MASK_BITS_PER_BYTE = 1;
+constexpr uint64_t FULL_MASK = 0xFFFFFFFFULL;
+
+inline Vector load(const char* data) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data)); }
+inline Vector equal(Vector vector, char character) { return _mm256_cmpeq_epi8(vector, _mm256_set1_epi8(character)); }
+inline Vector bitOr(Vector left, Vector right) { return _mm256_or_si256(left, right); }
+inline Vector bitAnd(Vector left, Vector right) { return _mm256_and_si256(left, right); }
+inline uint64_t toMask(Vector vector) { return static_cast<uint32_t>(_mm256_movemask_epi8(vector)); }
+
+#elif defined(PDF4QT_BYTE_SCANNER_SSE2)
+
+#define PDF4QT_BYTE_SCANNER_SIMD
+
+using Vector = __m128i;
+
+constexpr std::ptrdiff_t VECTOR_SIZE = 16;
+constexpr int MASK_BITS_PER_BYTE = 1;
+constexpr uint64_t FULL_MASK = 0xFFFFULL;
+
+inline Vector load(const char* data) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)); }
+inline Vector equal(Vector vector, char character) { return _mm_cmpeq_epi8(vector, _mm_set1_epi8(character)); }
+inline Vector bitOr(Vector left, Vector right) { return _mm_or_si128(left, right); }
+inline Vector bitAnd(Vector left, Vector right) { return _mm_and_si128(left, right); }
+inline uint64_t toMask(Vector vector) { return static_cast<uint32_t>(_mm_movemask_epi8(vector)); }
+
+#elif defined(PDF4QT_BYTE_SCANNER_NEON)
+
+#define PDF4QT_BYTE_SCANNER_SIMD
+
+using Vector = uint8x16_t;
+
+constexpr std::ptrdiff_t VECTOR_SIZE = 16;
+constexpr int MASK_BITS_PER_BYTE = 4;
+constexpr uint64_t FULL_MASK = ~0ULL;
+
+inline Vector load(const char* data) { return vld1q_u8(reinterpret_cast<const uint8_t*>(data)); }
+inline Vector equal(Vector vector, char character) { return vceqq_u8(vector, vdupq_n_u8(static_cast<uint8_t>(character))); }
+inline Vector bitOr(Vector left, Vector right) { return vorrq_u8(left, right); }
+inline Vector bitAnd(Vector left, Vector right) { return vandq_u8(left, right); }
+
+// NEON doesn't have movemask instruction, we narrow each byte of the
+// comparison result to 4 bits, so we get 64-bit mask.
+inline uint64_t toMask(Vector vector) { return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(vector), 4)), 0); }
+
+#endif
+
+#if defined(PDF4QT_BYTE_SCANNER_SIMD)
+
+constexpr uint64_t BYTE_MASK = (uint64_t(1) << MASK_BITS_PER_BYTE) - 1;
+
+inline Vector whitespace(Vector vector)
+{
+    Vector result = equal(vector, CHAR_SPACE);
+    result = bitOr(result, equal(vector, CHAR_LINE_FEED));
+    result = bitOr(result, equal(vector, CHAR_CARRIAGE_RETURN));
+    result = bitOr(result, equal(vector, CHAR_TAB));
+    result = bitOr(result, equal(vector, CHAR_FORM_FEED));
+    result = bitOr(result, equal(vector, CHAR_NULL));
+    return result;
+}
+
+inline Vector delimiter(Vector vector)
+{
+    Vector result = equal(vector, CHAR_SLASH);
+    result = bitOr(result, equal(vector, CHAR_LEFT_BRACKET));
+    result = bitOr(result, equal(vector, CHAR_RIGHT_BRACKET));
+    result = bitOr(result, equal(vector, CHAR_LEFT_ANGLE));
+    result = bitOr(result, equal(vector, CHAR_RIGHT_ANGLE));
+    result = bitOr(result, equal(vector, CHAR_ARRAY_START));
+    result = bitOr(result, equal(vector, CHAR_ARRAY_END));
+    result = bitOr(result, equal(vector, CHAR_LEFT_CURLY_BRACKET));
+    result = bitOr(result, equal(vector, CHAR_RIGHT_CURLY_BRACKET));
+    result = bitOr(result, equal(vector, CHAR_PERCENT));
+    return result;
+}
+
+#endif
+
+/// Returns first character, for which match function returns nonzero bit
+/// in the block mask (or scalar predicate returns true).
+template<typename BlockMatch, typename ScalarMatch>
+inline const char* findFirst(const char* begin, const char* end, BlockMatch blockMatch, ScalarMatch scalarMatch)
+{
+#if defined(PDF4QT_BYTE_SCANNER_SIMD)
+    while (std::distance(begin, end) >= VECTOR_SIZE)
+    {
+        const uint64_t mask = blockMatch(load(begin));
+        if (mask)
+        {
+            return begin + std::countr_zero(mask) / MASK_BITS_PER_BYTE;
+        }
+
+        begin += VECTOR_SIZE;
+    }
+#else
+    Q_UNUSED(blockMatch);
+#endif
+
+    return std::find_if(begin, end, scalarMatch);
+}
+
+}   // namespace
+
+const char* PDFByteScanner::skipWhitespace(const char* begin, const char* end)
+{
+    // Whitespace runs are usually short, check the first character at first
+    if (begin != end && !PDFLexicalAnalyzer::isWhitespace(*begin))
+    {
+        return begin;
+    }
+
+#if defined(PDF4QT_BYTE_SCANNER_SIMD)
+    auto blockMatch = [](Vector vector) { return ~toMask(whitespace(vector)) & FULL_MASK; };
+#else
+    auto blockMatch = [](auto) { return uint64_t(0); };
+#endif
+    return findFirst(begin, end, blockMatch, [](char character) { return !PDFLexicalAnalyzer::isWhitespace(character); });
+}
+
+const char* PDFByteScanner::findNonRegular(const char* begin, const char* end)
+{
+#if defined(PDF4QT_BYTE_SCANNER_SIMD)
+    auto blockMatch = [](Vector vector) { return toMask(bitOr(whitespace(vector), delimiter(vector))); };
+#else
+    auto blockMatch = [](auto) { return uint64_t(0); };
+#endif
+    return findFirst(begin, end, blockMatch, [](char character) { return !PDFLexicalAnalyzer::isRegular(character); });
+}
+
+const char* PDFByteScanner::findLineEnd(const char* begin, const char* end)
+{
+#if defined(PDF4QT_BYTE_SCANNER_SIMD)
+    auto blockMatch = [](Vector vector) { return toMask(bitOr(equal(vector, CHAR_CARRIAGE_RETURN), equal(vector, CHAR_LINE_FEED))); };
+#else
+    auto blockMatch = [](auto) { return uint64_t(0); };
+#endif
+    return findFirst(begin, end, blockMatch, [](char character) { return character == CHAR_CARRIAGE_RETURN || character == CHAR_LINE_FEED; });
+}
+
+const char* PDFByteScanner::findLiteralStringSpecialCharacter(const char* begin, const char* end)
+{
+#if defined(PDF4QT_BYTE_SCANNER_SIMD)
+    auto blockMatch = [](Vector vector) { return toMask(bitOr(bitOr(equal(vector, CHAR_LEFT_BRACKET), equal(vector, CHAR_RIGHT_BRACKET)), equal(vector, CHAR_BACKSLASH))); };
+#else
+    auto blockMatch = [](auto) { return uint64_t(0); };
+#endif
+    return findFirst(begin, end, blockMatch, [](char character) { return character == CHAR_LEFT_BRACKET || character == CHAR_RIGHT_BRACKET || character == CHAR_BACKSLASH; });
+}
+
+const char* PDFByteScanner::find(const char* begin, const char* end, const char* what, size_t length)
+{
+    if (length == 0)
+    {
+        return begin;
+    }
+
+    const std::ptrdiff_t searchLength = static_cast<std::ptrdiff_t>(length);
+    if (std::distance(begin, end) < searchLength)
+    {
+        return end;
+    }
+
+    // Last position, where searched string can start
+    const char* last = end - searchLength;
+    const char firstCharacter = what[0];
+    const char lastCharacter = what[length - 1];
+
+#if defined(PDF4QT_BYTE_SCANNER_SIMD)
+    // We compare first and last character of the searched string in the whole block,
+    // and only candidate positions are compared with the whole string.
+    while (std::distance(begin, last) >= VECTOR_SIZE)
+    {
+        uint64_t mask = toMask(bitAnd(equal(load(begin), firstCharacter), equal(load(begin + length - 1), lastCharacter)));
+        while (mask)
+        {
+            const int index = std::countr_zero(mask) / MASK_BITS_PER_BYTE;
+            if (std::memcmp(begin + index, what, length) == 0)
+            {
+                return begin + index;
+            }
+
+            mask &= ~(BYTE_MASK << (index * MASK_BITS_PER_BYTE));
+        }
+
+        begin += VECTOR_SIZE;
+    }
+#endif
+
+    for (; begin <= last; ++begin)
+    {
+        if (*begin == firstCharacter && *(begin + length - 1) == lastCharacter && std::memcmp(begin, what, length) == 0)
+        {
+            return begin;
+        }
+    }
+
+    return end;
+}
+
+}   // namespace pdf
@@ -0,0 +1,73 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef PDFBYTESCANNER_H
+#define PDFBYTESCANNER_H
+
+#include "pdfglobal.h"
+
+namespace pdf
+{
+
+/// Scanning kernels for classification of bytes in large buffers. They are used
+/// by the lexical analyzer and when restoring damaged documents. If SIMD instructions
+/// (SSE2, AVX2 or NEON) are available at compile time, then buffer is scanned by blocks
+/// of 16 (32 for AVX2) bytes, otherwise scalar fallback is used. All functions
+/// return \p end, if no matching character is found.
+class PDF4QTLIBCORESHARED_EXPORT PDFByteScanner
+{
+public:
+    PDFByteScanner() = delete;
+
+    /// Returns pointer to the first character, which is not a whitespace
+    /// \param begin Begin of the buffer
+    /// \param end End of the buffer
+    static const char* skipWhitespace(const char* begin, const char* end);
+
+    /// Returns pointer to the first character, which is not a regular character,
+    /// i.e. it is a whitespace or a delimiter.
+    /// \param begin Begin of the buffer
+    /// \param end End of the buffer
+    static const char* findNonRegular(const char* begin, const char* end);
+
+    /// Returns pointer to the first end of line character (carriage return or line feed)
+    /// \param begin Begin of the buffer
+    /// \param end End of the buffer
+    static const char* findLineEnd(const char* begin, const char* end);
+
+    /// Returns pointer to the first character, which has special meaning in the
+    /// literal string, i.e. left bracket, right bracket or backslash.
+    /// \param begin Begin of the buffer
+    /// \param end End of the buffer
+    static const char* findLiteralStringSpecialCharacter(const char* begin, const char* end);
+
+    /// Returns pointer to the first occurence of the string \p what in the buffer
+    /// \param begin Begin of the buffer
+    /// \param end End of the buffer
+    /// \param what String to be found
+    /// \param length Length of the string to be found
+    static const char* find(const char* begin, const char* end, const char* what, size_t length);
+};
+
+}   // namespace pdf
+
+#endif // PDFBYTESCANNER_H
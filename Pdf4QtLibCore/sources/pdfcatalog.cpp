@@ -64,26 +64,15 @@ static constexpr const char* PDF_VIEWER_PREFERENCES_PICK_TRAY_BY_PDF_SIZE = "Pic
 static constexpr const char* PDF_VIEWER_PREFERENCES_NUMBER_OF_COPIES = "NumCopies";
 static constexpr const char* PDF_VIEWER_PREFERENCES_PRINT_PAGE_RANGE = "PrintPageRange";
 
-size_t PDFCatalog::getPageIndexFromPageReference(PDFObjectReference reference) const
+const PDFDestination* PDFCatalog::getNamedDestination(const QByteArray& key) const
 {
-    auto it = std::find_if(m_pages.cbegin(), m_pages.cend(), [reference](const PDFPage& page) { return page.getPageReference() == reference; });
-    if (it != m_pages.cend())
-    {
-        return std::distance(m_pages.cbegin(), it);
-    }
-
-    return INVALID_PAGE_INDEX;
+    return m_namedDestinations.find(key);
 }
 
-const PDFDestination* PDFCatalog::getNamedDestination(const QByteArray& key) const
+void PDFCatalog::setStorage(const PDFObjectStorage* storage)
 {
-    auto it = m_namedDestinations.find(key);
-    if (it != m_namedDestinations.cend())
-    {
-        return &it->second;
-    }
-
-    return nullptr;
+    m_pageTree.setStorage(storage);
+    m_namedDestinations.setStorage(storage);
 }
 
 PDFActionPtr PDFCatalog::getNamedJavaScriptAction(const QByteArray& key) const
@@ -186,7 +175,7 @@ PDFCatalog PDFCatalog::parse(const PDFObject& catalog, const PDFDocument* docume
 
     PDFCatalog catalogObject;
     catalogObject.m_viewerPreferences = PDFViewerPreferences::parse(catalog, document);
-    catalogObject.m_pages = PDFPage::parse(&document->getStorage(), catalogDictionary->get("Pages"));
+    catalogObject.m_pageTree = PDFPageTree::parse(&document->getStorage(), catalogDictionary->get("Pages"));
     catalogObject.m_pageLabels = PDFNumberTreeLoader<PDFPageLabel>::parse(&document->getStorage(), catalogDictionary->get("PageLabels"));
 
     if (catalogDictionary->hasKey("OCProperties"))
@@ -254,23 +243,12 @@ PDFCatalog PDFCatalog::parse(const PDFObject& catalog, const PDFDocument* docume
 
     if (const PDFDictionary* namesDictionary = document->getDictionaryFromObject(catalogDictionary->get("Names")))
     {
-        auto parseDestination = [](const PDFObjectStorage* storage, PDFObject object)
-        {
-            object = storage->getObject(object);
-            if (object.isDictionary())
-            {
-                object = object.getDictionary()->get("D");
-            }
-
-            return PDFDestination::parse(storage, qMove(object));
-        };
-
         auto getObject = [](const PDFObjectStorage*, PDFObject object)
         {
             return object;
         };
 
-        catalogObject.m_namedDestinations = PDFNameTreeLoader<PDFDestination>::parse(&document->getStorage(), namesDictionary->get("Dests"), parseDestination);
+        catalogObject.m_namedDestinations = PDFNamedDestinations(&document->getStorage(), namesDictionary->get("Dests"));
         catalogObject.m_namedAppearanceStreams = PDFNameTreeLoader<PDFObject>::parse(&document->getStorage(), namesDictionary->get("AP"), getObject);
         catalogObject.m_namedJavaScriptActions = PDFNameTreeLoader<PDFActionPtr>::parse(&document->getStorage(), namesDictionary->get("JavaScript"), &PDFAction::parse);
         catalogObject.m_namedPages = PDFNameTreeLoader<PDFObject>::parse(&document->getStorage(), namesDictionary->get("Pages"), getObject);
@@ -288,7 +266,7 @@ PDFCatalog PDFCatalog::parse(const PDFObject& catalog, const PDFDocument* docume
         const size_t count = destsDictionary->getCount();
         for (size_t i = 0; i < count; ++i)
         {
-            catalogObject.m_namedDestinations[destsDictionary->getKey(i).getString()] = PDFDestination::parse(&document->getStorage(), destsDictionary->getValue(i));
+            catalogObject.m_namedDestinations.insert(destsDictionary->getKey(i).getString(), PDFDestination::parse(&document->getStorage(), destsDictionary->getValue(i)));
         }
     }
 
@@ -1100,4 +1078,107 @@ PageLayout PDFPageLayoutUtils::convertStringToPageLayout(const QString& text, Pa
     return defaultPageLayout;
 }
 
+PDFNamedDestinations::PDFNamedDestinations(const PDFObjectStorage* storage, PDFObject root) :
+    m_storage(storage),
+    m_root(std::move(root))
+{
+
+}
+
+PDFNamedDestinations::PDFNamedDestinations(const PDFNamedDestinations& other)
+{
+    *this = other;
+}
+
+PDFNamedDestinations& PDFNamedDestinations::operator=(const PDFNamedDestinations& other)
+{
+    if (this != &other)
+    {
+        QMutexLocker lock(&other.m_mutex);
+        m_storage = other.m_storage;
+        m_root = other.m_root;
+        m_insertedDestinations = other.m_insertedDestinations;
+        m_foundDestinations = other.m_foundDestinations;
+        m_allDestinations = other.m_allDestinations;
+    }
+
+    return *this;
+}
+
+void PDFNamedDestinations::insert(const QByteArray& key, PDFDestination destination)
+{
+    QMutexLocker lock(&m_mutex);
+    m_insertedDestinations[key] = destination;
+
+    if (m_allDestinations)
+    {
+        (*m_allDestinations)[key] = std::move(destination);
+    }
+}
+
+const PDFDestination* PDFNamedDestinations::find(const QByteArray& key) const
+{
+    QMutexLocker lock(&m_mutex);
+
+    auto insertedIt = m_insertedDestinations.find(key);
+    if (insertedIt != m_insertedDestinations.cend())
+    {
+        return &insertedIt->second;
+    }
+
+    if (m_allDestinations)
+    {
+        auto it = m_allDestinations->find(key);
+        return it != m_allDestinations->cend() ? &it->second : nullptr;
+    }
+
+    auto foundIt = m_foundDestinations.find(key);
+    if (foundIt == m_foundDestinations.cend())
+    {
+        std::optional<PDFDestination> destination;
+        if (m_storage)
+        {
+            destination = PDFNameTreeLoader<PDFDestination>::find(m_storage, m_root, key, &PDFNamedDestinations::parseDestination);
+        }
+
+        foundIt = m_foundDestinations.emplace(key, std::move(destination)).first;
+    }
+
+    return foundIt->second ? &foundIt->second.value() : nullptr;
+}
+
+const std::map<QByteArray, PDFDestination>& PDFNamedDestinations::getAll() const
+{
+    QMutexLocker lock(&m_mutex);
+
+    if (!m_allDestinations)
+    {
+        std::map<QByteArray, PDFDestination> destinations;
+        if (m_storage)
+        {
+            destinations = PDFNameTreeLoader<PDFDestination>::parse(m_storage, m_root, &PDFNamedDestinations::parseDestination);
+        }
+
+        for (const auto& item : m_insertedDestinations)
+        {
+            destinations[item.first] = item.second;
+        }
+
+        m_allDestinations = std::move(destinations);
+    }
+
+    return *m_allDestinations;
+}
+
+PDFDestination PDFNamedDestinations::parseDestination(const PDFObjectStorage* storage, PDFObject object)
+{
+    object = storage->getObject(object);
+    if (object.isDictionary())
+    {
+        object = object.getDictionary()->get("D");
+    }
+
+    return PDFDestination::parse(storage, qMove(object));
+}
+
 }   // namespace pdf
@@ -29,9 +29,12 @@
 #include "pdfoutline.h"
 #include "pdfaction.h"
 
+#include <QMutex>
+
 #include <array>
 #include <vector>
 #include <utility>
+#include <optional>
 
 namespace pdf
 {
@@ -576,6 +579,59 @@ private:
     std::array<PDFActionPtr, End> m_actions;
 };
 
+/// Named destinations of the document. Destinations are stored in the name tree,
+/// which can be very large, so single destinations are looked up lazily in the name
+/// tree (only nodes on the path to the destination are loaded), and found destinations
+/// are cached. All destinations are loaded only when they are requested all at once,
+/// or when index is explicitly built (for example, in a background thread). This class
+/// is thread safe, pointers to the destinations remain valid for the lifetime of the object.
+class PDF4QTLIBCORESHARED_EXPORT PDFNamedDestinations
+{
+public:
+    explicit PDFNamedDestinations() = default;
+
+    /// Creates named destinations from the name tree
+    /// \param storage Object storage
+    /// \param root Root of the name tree
+    explicit PDFNamedDestinations(const PDFObjectStorage* storage, PDFObject root);
+
+    PDFNamedDestinations(const PDFNamedDestinations& other);
+    PDFNamedDestinations& operator=(const PDFNamedDestinations& other);
+
+    /// Inserts destination. Inserted destinations take
+    /// precedence over destinations of the name tree.
+    /// \param key Destination key
+    /// \param destination Destination
+    void insert(const QByteArray& key, PDFDestination destination);
+
+    /// Finds destination with given key. If it is not found, nullptr is returned.
+    /// \param key Destination key
+    const PDFDestination* find(const QByteArray& key) const;
+
+    /// Returns all destinations. Destinations are loaded,
+    /// if they were not loaded yet.
+    const std::map<QByteArray, PDFDestination>& getAll() const;
+
+    /// Loads all destinations, so subsequent lookups
+    /// don't access the object storage.
+    void buildIndex() const { getAll(); }
+
+    /// Sets object storage. It must be called, when storage
+    /// is moved or copied together with the destinations.
+    /// \param storage Storage
+    void setStorage(const PDFObjectStorage* storage) { m_storage = storage; }
+
+private:
+    static PDFDestination parseDestination(const PDFObjectStorage* storage, PDFObject object);
+
+    const PDFObjectStorage* m_storage = nullptr;
+    PDFObject m_root;
+    mutable QMutex m_mutex;
+    std::map<QByteArray, PDFDestination> m_insertedDestinations;
+    mutable std::map<QByteArray, std::optional<PDFDestination>> m_foundDestinations;
+    mutable std::optional<std::map<QByteArray, PDFDestination>> m_allDestinations;
+};
+
 class PDF4QTLIBCORESHARED_EXPORT PDFCatalog
 {
 public:
@@ -587,7 +643,7 @@ public:
     inline PDFCatalog& operator=(const PDFCatalog&) = default;
     inline PDFCatalog& operator=(PDFCatalog&&) = default;
 
-    static constexpr const size_t INVALID_PAGE_INDEX = std::numeric_limits<size_t>::max();
+    static constexpr const size_t INVALID_PAGE_INDEX = PDFPageTree::INVALID_PAGE_INDEX;
 
     enum DocumentAction
     {
@@ -603,13 +659,14 @@ public:
     const PDFViewerPreferences* getViewerPreferences() const { return &m_viewerPreferences; }
 
     /// Returns the page count
-    size_t getPageCount() const { return m_pages.size(); }
+    size_t getPageCount() const { return m_pageTree.getPageCount(); }
 
-    /// Returns the page
-    const PDFPage* getPage(size_t index) const { return &m_pages.at(index); }
+    /// Returns the page. Pages of large documents are loaded
+    /// lazily, when they are accessed for the first time.
+    const PDFPage* getPage(size_t index) const { return m_pageTree.getPage(index); }
 
     /// Returns page index. If page is not found, then INVALID_PAGE_INDEX is returned.
-    size_t getPageIndexFromPageReference(PDFObjectReference reference) const;
+    size_t getPageIndexFromPageReference(PDFObjectReference reference) const { return m_pageTree.getPageIndex(reference); }
 
     /// Returns optional content properties
     const PDFOptionalContentProperties* getOptionalContentProperties() const { return &m_optionalContentProperties; }
@@ -646,7 +703,11 @@ public:
     bool isXFANeedsRendering() const { return m_xfaNeedsRendering; }
     const PDFObject& getAssociatedFiles() const { return m_associatedFiles; }
     const PDFObject& getDocumentPartRoot() const { return m_documentPartRoot; }
-    const std::map<QByteArray, PDFDestination>& getNamedDestinations() const { return m_namedDestinations; }
+    const std::map<QByteArray, PDFDestination>& getNamedDestinations() const { return m_namedDestinations.getAll(); }
+
+    /// Loads all named destinations, which are otherwise looked up lazily.
+    /// It can be called from a background thread, when document is opened.
+    void buildNamedDestinationsIndex() const { m_namedDestinations.buildIndex(); }
 
     /// Is document marked to have structure tree conforming to tagged document convention?
     bool isLogicalStructureMarked() const { return m_markInfoFlags.testFlag(MarkInfo_Marked); }
@@ -721,6 +782,12 @@ public:
     static PDFCatalog parse(const PDFObject& catalog, const PDFDocument* document);
 
 private:
+    friend class PDFDocument;
+
+    /// Sets object storage of the document, it must be called,
+    /// when document is moved or copied.
+    /// \param storage Storage
+    void setStorage(const PDFObjectStorage* storage);
 
     enum MarkInfoFlag : uint8_t
     {
@@ -733,7 +800,7 @@ private:
 
     QByteArray m_version;
     PDFViewerPreferences m_viewerPreferences;
-    std::vector<PDFPage> m_pages;
+    PDFPageTree m_pageTree;
     std::vector<PDFPageLabel> m_pageLabels;
     PDFOptionalContentProperties m_optionalContentProperties;
     QSharedPointer<PDFOutlineItem> m_outlineRoot;
@@ -762,7 +829,7 @@ private:
     PDFObject m_documentPartRoot;
 
     // Maps from Names dictionary
-    std::map<QByteArray, PDFDestination> m_namedDestinations;
+    PDFNamedDestinations m_namedDestinations;
     std::map<QByteArray, PDFObject> m_namedAppearanceStreams;
     std::map<QByteArray, PDFActionPtr> m_namedJavaScriptActions;
     std::map<QByteArray, PDFObject> m_namedPages;
@@ -24,6 +24,9 @@
 #include "pdfexception.h"
 #include "pdfdbgheap.h"
 
+#include <array>
+#include <cstring>
+
 namespace pdf
 {
 
@@ -288,6 +291,55 @@ static constexpr PDFCCITTCode CCITT_BLACK_CODES[] = {
     { 2560,    0b000000011111,     000000011111_bitlength }
 };
 
+/// Creates lookup table for prefix codes. Table is indexed by next \p TableBits bits
+/// of the stream, and each entry contains the code, which is a prefix of these bits.
+/// Entries without a code have zero bit length.
+template<size_t TableBits, typename Code, size_t CodeCount>
+static std::array<Code, static_cast<size_t>(1) << TableBits> createCCITTLookupTable(const Code (&codes)[CodeCount])
+{
+    std::array<Code, static_cast<size_t>(1) << TableBits> table = { };
+
+    for (const Code& code : codes)
+    {
+        Q_ASSERT(code.bits <= TableBits);
+        const size_t shift = TableBits - code.bits;
+        const size_t first = static_cast<size_t>(code.code) << shift;
+        std::fill_n(std::next(table.begin(), first), static_cast<size_t>(1) << shift, code);
+    }
+
+    return table;
+}
+
+static constexpr uint8_t CODE_TABLE_BIT_LENGTH = MAX_CODE_BIT_LENGTH + 1;
+
+static const std::array<PDFCCITT2DModeInfo, 1 << MAX_2D_MODE_BIT_LENGTH> CCITT_2D_CODE_MODE_TABLE = createCCITTLookupTable<MAX_2D_MODE_BIT_LENGTH>(CCITT_2D_CODE_MODES);
+static const std::array<PDFCCITTCode, 1 << CODE_TABLE_BIT_LENGTH> CCITT_WHITE_CODE_TABLE = createCCITTLookupTable<CODE_TABLE_BIT_LENGTH>(CCITT_WHITE_CODES);
+static const std::array<PDFCCITTCode, 1 << CODE_TABLE_BIT_LENGTH> CCITT_BLACK_CODE_TABLE = createCCITTLookupTable<CODE_TABLE_BIT_LENGTH>(CCITT_BLACK_CODES);
+
+/// Sets pixels in range [from, to) of the 1 bit per pixel row to 1
+static void fillCCITTRow(uint8_t* row, int from, int to)
+{
+    if (from >= to)
+    {
+        return;
+    }
+
+    const int firstByte = from / 8;
+    const int lastByte = (to - 1) / 8;
+    const uint8_t firstMask = 0xFF >> (from % 8);
+    const uint8_t lastMask = 0xFF << (7 - (to - 1) % 8);
+
+    if (firstByte == lastByte)
+    {
+        row[firstByte] |= firstMask & lastMask;
+        return;
+    }
+
+    row[firstByte] |= firstMask;
+    std::memset(row + firstByte + 1, 0xFF, lastByte - firstByte - 1);
+    row[lastByte] |= lastMask;
+}
+
 PDFCCITTFaxDecoder::PDFCCITTFaxDecoder(const QByteArray* stream, const PDFCCITTFaxDecoderParameters& parameters) :
     m_reader(stream, 1),
     m_parameters(parameters)
@@ -295,9 +347,13 @@ PDFCCITTFaxDecoder::PDFCCITTFaxDecoder(const QByteArray* stream, const PDFCCITTF
 
 }
 
-PDFImageData PDFCCITTFaxDecoder::decode()
+PDFImageData PDFCCITTFaxDecoder::decode(Implementation implementation)
 {
+    m_implementation = implementation;
+
     PDFBitWriter writer(1);
+    QByteArray imageData;
+    const int stride = (m_parameters.columns + 7) / 8;
     std::vector<int> codingLine;
     std::vector<int> referenceLine;
 
@@ -458,19 +514,39 @@ PDFImageData PDFCCITTFaxDecoder::decode()
         }
 
         // Write the line to the output buffer
-        isCurrentPixelBlack = false;
-        int index = 0;
-        for (int i = 0; i < m_parameters.columns; ++i)
+        if (m_implementation == Implementation::Optimized)
         {
-            if (i == codingLine[index])
+            // Even runs are white (bits set to 1), odd runs are black (bits set to 0)
+            imageData.append(stride, 0);
+            uint8_t* rowData = reinterpret_cast<uint8_t*>(imageData.data()) + static_cast<qsizetype>(row) * stride;
+
+            int runStart = 0;
+            for (size_t i = 0; i < codingLine.size() && runStart < m_parameters.columns; ++i)
             {
-                isCurrentPixelBlack = !isCurrentPixelBlack;
-                ++index;
+                const int runEnd = qMin(codingLine[i], int(m_parameters.columns));
+                if (i % 2 == 0)
+                {
+                    fillCCITTRow(rowData, runStart, runEnd);
+                }
+                runStart = qMax(runStart, runEnd);
             }
+        }
+        else
+        {
+            isCurrentPixelBlack = false;
+            int index = 0;
+            for (int i = 0; i < m_parameters.columns; ++i)
+            {
+                if (i == codingLine[index])
+                {
+                    isCurrentPixelBlack = !isCurrentPixelBlack;
+                    ++index;
+                }
 
-            writer.write(isCurrentPixelBlack ? 0 : 1);
+                writer.write(isCurrentPixelBlack ? 0 : 1);
+            }
+            writer.finishLine();
         }
-        writer.finishLine();
 
         ++row;
 
@@ -560,7 +636,12 @@ PDFImageData PDFCCITTFaxDecoder::decode()
         decode = { m_parameters.decode[0], m_parameters.decode[1] };
     }
 
-    return PDFImageData(1, 1, m_parameters.columns, row, (m_parameters.columns + 7) / 8, m_parameters.maskingType, writer.takeByteArray(), { }, qMove(decode), { });
+    if (m_implementation == Implementation::Reference)
+    {
+        imageData = writer.takeByteArray();
+    }
+
+    return PDFImageData(1, 1, m_parameters.columns, row, stride, m_parameters.maskingType, qMove(imageData), { }, qMove(decode), { });
 }
 
 void PDFCCITTFaxDecoder::skipFill()
@@ -644,11 +725,21 @@ uint32_t PDFCCITTFaxDecoder::getRunLength(bool white)
 
 uint32_t PDFCCITTFaxDecoder::getWhiteCode()
 {
+    if (m_implementation == Implementation::Optimized)
+    {
+        return getCodeFromTable(CCITT_WHITE_CODE_TABLE.data());
+    }
+
     return getCode(CCITT_WHITE_CODES, std::size(CCITT_WHITE_CODES));
 }
 
 uint32_t PDFCCITTFaxDecoder::getBlackCode()
 {
+    if (m_implementation == Implementation::Optimized)
+    {
+        return getCodeFromTable(CCITT_BLACK_CODE_TABLE.data());
+    }
+
     return getCode(CCITT_BLACK_CODES, std::size(CCITT_BLACK_CODES));
 }
 
@@ -675,8 +766,36 @@ uint32_t PDFCCITTFaxDecoder::getCode(const PDFCCITTCode* codes, size_t codeCount
     throw PDFException(PDFTranslationContext::tr("Invalid CCITT run length code word."));
 }
 
+uint32_t PDFCCITTFaxDecoder::getCodeFromTable(const PDFCCITTCode* table)
+{
+    // Codes are prefix codes, so we can look at the maximal code length and
+    // then skip only bits of the code found in the table.
+    const PDFCCITTCode& code = table[m_reader.look(CODE_TABLE_BIT_LENGTH)];
+
+    if (code.bits == 0)
+    {
+        throw PDFException(PDFTranslationContext::tr("Invalid CCITT run length code word."));
+    }
+
+    m_reader.read(code.bits);
+    return code.length;
+}
+
 CCITT_2D_Code_Mode PDFCCITTFaxDecoder::get2DMode()
 {
+    if (m_implementation == Implementation::Optimized)
+    {
+        const PDFCCITT2DModeInfo& info = CCITT_2D_CODE_MODE_TABLE[m_reader.look(MAX_2D_MODE_BIT_LENGTH)];
+
+        if (info.bits == 0)
+        {
+            throw PDFException(PDFTranslationContext::tr("Invalid CCITT 2D mode."));
+        }
+
+        m_reader.read(info.bits);
+        return info.mode;
+    }
+
     uint32_t code = 0;
     uint8_t bits = 0;
 
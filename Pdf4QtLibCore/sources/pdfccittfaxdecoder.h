@@ -91,12 +91,24 @@ enum CCITT_2D_Code_Mode
     Invalid
 };
 
-class PDFCCITTFaxDecoder
+class PDF4QTLIBCORESHARED_EXPORT PDFCCITTFaxDecoder
 {
 public:
     explicit PDFCCITTFaxDecoder(const QByteArray* stream, const PDFCCITTFaxDecoderParameters& parameters);
 
-    PDFImageData decode();
+    enum class Implementation
+    {
+        Reference,  ///< Generic implementation, which reads codes bit by bit and writes image pixel by pixel
+        Optimized   ///< Resolves codes using lookup tables and writes whole runs of pixels into the image rows
+    };
+
+    PDFImageData decode() { return decode(Implementation::Optimized); }
+
+    /// Decodes the image using given implementation. Both implementations
+    /// give the same result, this function is mainly for testing and
+    /// benchmarking purposes.
+    /// \param implementation Implementation of the decoder
+    PDFImageData decode(Implementation implementation);
 
     const PDFBitReader* getReader() const { return &m_reader; }
 
@@ -129,8 +141,13 @@ private:
 
     uint32_t getCode(const PDFCCITTCode* codes, size_t codeCount);
 
+    /// Resolves code from the lookup table, which is indexed by next 13 bits of the stream
+    /// \param table Lookup table of the codes
+    uint32_t getCodeFromTable(const PDFCCITTCode* table);
+
     PDFBitReader m_reader;
     PDFCCITTFaxDecoderParameters m_parameters;
+    Implementation m_implementation = Implementation::Optimized;
 };
 
 }   // namespace pdf
@@ -28,7 +28,21 @@
 #include <QFile>
 #include <QBuffer>
 #include <QCoreApplication>
-#include <QReadWriteLock>
+#include <QMutex>
+#include <QCryptographicHash>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QStandardPaths>
+#include <QFileInfo>
+#include <QtConcurrent/QtConcurrent>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PDF4QT_CMS_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define PDF4QT_CMS_NEON
+#include <arm_neon.h>
+#endif
 
 #include "pdfdbgheap.h"
 
@@ -66,10 +80,347 @@
 #endif
 
 #include <unordered_map>
+#include <type_traits>
+#include <algorithm>
+#include <optional>
+#include <cstring>
+#include <atomic>
+#include <memory>
+#include <vector>
 
 namespace pdf
 {
 
+/// Cache of color transforms, which can be read without any locking. Cache content is
+/// an immutable map (snapshot). When a new transform is inserted, the snapshot
+/// is copied, the transform is added to the copy and the copy is published
+/// by atomic pointer swap. Old snapshots are kept alive until the cache is destroyed,
+/// because other threads may still read them. Count of transforms is small, so
+/// this is cheaper than acquiring a lock on each color conversion. Values of the map
+/// are usually transforms (which are deleted by the cache), but they can also
+/// be shared pointers to the precomputed color lookup tables.
+template<typename Map>
+class PDFTransformSnapshotCache
+{
+public:
+    using Key = typename Map::key_type;
+    using Value = typename Map::mapped_type;
+
+    PDFTransformSnapshotCache()
+    {
+        m_snapshots.emplace_back(std::make_unique<const Map>());
+        m_snapshot.store(m_snapshots.back().get(), std::memory_order_release);
+    }
+
+    ~PDFTransformSnapshotCache()
+    {
+        clear();
+    }
+
+    /// Deletes all transforms. The last snapshot contains all transforms
+    /// ever inserted into the cache. This function is not thread safe,
+    /// no other thread can access the cache during this call.
+    void clear()
+    {
+        if constexpr (std::is_same_v<Value, cmsHTRANSFORM>)
+        {
+            for (const auto& transformItem : *m_snapshot.load(std::memory_order_acquire))
+            {
+                cmsHTRANSFORM transform = transformItem.second;
+                if (transform)
+                {
+                    cmsDeleteTransform(transform);
+                }
+            }
+        }
+
+        m_snapshots.clear();
+        m_snapshots.emplace_back(std::make_unique<const Map>());
+        m_snapshot.store(m_snapshots.back().get(), std::memory_order_release);
+    }
+
+    /// Returns transform from the cache. If transform doesn't exist,
+    /// then it is created using \p create and inserted into the cache.
+    /// Creation is serialized, so each transform is created only once.
+    /// \param key Key
+    /// \param create Function, which creates new transform (it can return null transform)
+    template<typename Create>
+    const Value& get(const Key& key, Create&& create) const
+    {
+        const Map* snapshot = m_snapshot.load(std::memory_order_acquire);
+        auto it = snapshot->find(key);
+        if (it != snapshot->cend())
+        {
+            return it->second;
+        }
+
+        QMutexLocker lock(&m_mutex);
+
+        // Now, we have locked the cache for writing. We must find out,
+        // if some other thread doesn't created the transformation already.
+        snapshot = m_snapshot.load(std::memory_order_acquire);
+        it = snapshot->find(key);
+        if (it != snapshot->cend())
+        {
+            return it->second;
+        }
+
+        Value value = create();
+
+        // Items of the snapshot are never modified nor deleted, so we can
+        // return a reference to the item of the newly created snapshot.
+        std::unique_ptr<Map> newSnapshot = std::make_unique<Map>(*snapshot);
+        const Value& insertedValue = newSnapshot->insert(std::make_pair(key, std::move(value))).first->second;
+        m_snapshot.store(newSnapshot.get(), std::memory_order_release);
+        m_snapshots.emplace_back(std::move(newSnapshot));
+        return insertedValue;
+    }
+
+    /// Returns count of transforms in the cache
+    size_t size() const
+    {
+        return m_snapshot.load(std::memory_order_acquire)->size();
+    }
+
+private:
+    mutable QMutex m_mutex;
+    mutable std::atomic<const Map*> m_snapshot = nullptr;
+    mutable std::vector<std::unique_ptr<const Map>> m_snapshots;
+};
+
+/// Precomputed color lookup table of the soft-proofing (or gamut checking) transform
+/// from the input color space to the output RGB color space. Each node of the regular
+/// grid contains proofed RGB color and gamut alarm flag (1.0, if color is out of gamut
+/// of the proofing profile, 0.0 otherwise). Colors are computed by simplex interpolation
+/// (which is tetrahedral interpolation for three input channels), alarm color
+/// is not a part of the table, it is applied when the color is evaluated. So
+/// table doesn't depend on the alarm color at all.
+class PDFProofingLookupTable
+{
+public:
+    using Node = std::array<float, 4>;
+
+    /// Creates lookup table by sampling the transforms in the grid nodes. Both transforms
+    /// must have 4-byte float input and float RGB output. If \p gamutCheckTransform is
+    /// provided, then it must mark out of gamut colors by negative output (little CMS
+    /// float transforms do that). If table can't be created, nullptr is returned.
+    /// \param proofingTransform Transform, which computes proofed colors
+    /// \param gamutCheckTransform Transform with gamut check (can be null)
+    /// \param inputScale Input colors of transforms are multiplied by this scale (100.0 for CMYK)
+    /// \param gridPoints Grid point count in each dimension
+    static std::shared_ptr<const PDFProofingLookupTable> create(cmsHTRANSFORM proofingTransform,
+                                                                cmsHTRANSFORM gamutCheckTransform,
+                                                                float inputScale,
+                                                                int gridPoints);
+
+    /// Returns count of input channels
+    size_t getInputChannels() const { return m_inputChannels; }
+
+    /// Returns size of the table in bytes
+    qint64 getMemoryConsumptionEstimate() const { return qint64(sizeof(*this) + m_nodes.size() * sizeof(Node)); }
+
+    /// Transforms single color. Values of input channels are in range [0, 1].
+    /// \param input Input color channels
+    /// \param alarmColor Color of the out of gamut colors
+    QColor transformColor(const float* input, const QColor& alarmColor) const;
+
+    /// Transforms colors to the 8-bit RGB buffer. Values of input channels are in range [0, 1].
+    /// \param input Input color channels
+    /// \param pixelCount Count of pixels
+    /// \param alarmColor Color of the out of gamut colors
+    /// \param outputBuffer Output 8-bit RGB buffer
+    void transformToRGB888(const float* input, size_t pixelCount, const QColor& alarmColor, unsigned char* outputBuffer) const;
+
+private:
+    PDFProofingLookupTable() = default;
+
+    /// Interpolates the table at the input color. Result contains RGB color
+    /// and the alarm flag in the last channel.
+    Node interpolate(const float* input) const;
+
+    size_t m_inputChannels = 0;
+    int m_gridPoints = 0;
+    std::array<size_t, 4> m_strides = { };
+    std::vector<Node> m_nodes;
+};
+
+std::shared_ptr<const PDFProofingLookupTable> PDFProofingLookupTable::create(cmsHTRANSFORM proofingTransform,
+                                                                             cmsHTRANSFORM gamutCheckTransform,
+                                                                             float inputScale,
+                                                                             int gridPoints)
+{
+    const cmsUInt32Number inputFormat = cmsGetTransformInputFormat(proofingTransform);
+    const size_t inputChannels = T_CHANNELS(inputFormat);
+
+    if (inputChannels < 1 || inputChannels > 4 || gridPoints < 2 ||
+        T_FLOAT(inputFormat) == 0 || T_BYTES(inputFormat) != 4 ||
+        cmsGetTransformOutputFormat(proofingTransform) != TYPE_RGB_FLT ||
+        (gamutCheckTransform && (cmsGetTransformInputFormat(gamutCheckTransform) != inputFormat ||
+                                 cmsGetTransformOutputFormat(gamutCheckTransform) != TYPE_RGB_FLT)))
+    {
+        return nullptr;
+    }
+
+    std::shared_ptr<PDFProofingLookupTable> table(new PDFProofingLookupTable());
+    table->m_inputChannels = inputChannels;
+    table->m_gridPoints = gridPoints;
+
+    // First input channel is the most significant one
+    size_t nodeCount = 1;
+    for (size_t i = inputChannels; i-- > 0;)
+    {
+        table->m_strides[i] = nodeCount;
+        nodeCount *= size_t(gridPoints);
+    }
+
+    std::vector<float> inputs(nodeCount * inputChannels, 0.0f);
+    const float step = inputScale / float(gridPoints - 1);
+    for (size_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex)
+    {
+        for (size_t channel = 0; channel < inputChannels; ++channel)
+        {
+            const size_t coordinate = (nodeIndex / table->m_strides[channel]) % size_t(gridPoints);
+            inputs[nodeIndex * inputChannels + channel] = float(coordinate) * step;
+        }
+    }
+
+    std::vector<float> colors(nodeCount * 3, 0.0f);
+    cmsDoTransform(proofingTransform, inputs.data(), colors.data(), cmsUInt32Number(nodeCount));
+
+    std::vector<float> gamutCheckColors;
+    if (gamutCheckTransform)
+    {
+        gamutCheckColors.resize(nodeCount * 3, 0.0f);
+        cmsDoTransform(gamutCheckTransform, inputs.data(), gamutCheckColors.data(), cmsUInt32Number(nodeCount));
+    }
+
+    table->m_nodes.resize(nodeCount);
+    for (size_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex)
+    {
+        const float* color = colors.data() + nodeIndex * 3;
+        const bool isOutOfGamut = !gamutCheckColors.empty() && gamutCheckColors[nodeIndex * 3] < -0.5f;
+        table->m_nodes[nodeIndex] = { color[0], color[1], color[2], isOutOfGamut ? 1.0f : 0.0f };
+    }
+
+    return table;
+}
+
+PDFProofingLookupTable::Node PDFProofingLookupTable::interpolate(const float* input) const
+{
+    // Simplex interpolation - unit cell of the grid is divided into simplices
+    // by ordering of the fractional parts of the coordinates. We go from the
+    // base node of the cell along the axes in descending order of fractional parts,
+    // and color is a weighted sum of the visited nodes.
+    std::array<float, 4> fractions = { };
+    std::array<size_t, 4> axes = { };
+    size_t nodeIndex = 0;
+
+    const float maxCoordinate = float(m_gridPoints - 1);
+    for (size_t i = 0; i < m_inputChannels; ++i)
+    {
+        const float coordinate = qBound(0.0f, input[i], 1.0f) * maxCoordinate;
+        const int cell = qMin(int(coordinate), m_gridPoints - 2);
+        fractions[i] = coordinate - float(cell);
+        nodeIndex += size_t(cell) * m_strides[i];
+        axes[i] = i;
+    }
+
+    // Insertion sort of the axes, there are at most four of them
+    for (size_t i = 1; i < m_inputChannels; ++i)
+    {
+        for (size_t j = i; j > 0 && fractions[axes[j - 1]] < fractions[axes[j]]; --j)
+        {
+            std::swap(axes[j - 1], axes[j]);
+        }
+    }
+
+    const Node* nodes = m_nodes.data();
+    float weight = 1.0f - fractions[axes[0]];
+
+#if defined(PDF4QT_CMS_SSE2)
+    __m128 result = _mm_mul_ps(_mm_loadu_ps(nodes[nodeIndex].data()), _mm_set1_ps(weight));
+    for (size_t i = 0; i < m_inputChannels; ++i)
+    {
+        nodeIndex += m_strides[axes[i]];
+        weight = fractions[axes[i]] - (i + 1 < m_inputChannels ? fractions[axes[i + 1]] : 0.0f);
+        result = _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(nodes[nodeIndex].data()), _mm_set1_ps(weight)));
+    }
+
+    Node node;
+    _mm_storeu_ps(node.data(), result);
+    return node;
+#elif defined(PDF4QT_CMS_NEON)
+    float32x4_t result = vmulq_n_f32(vld1q_f32(nodes[nodeIndex].data()), weight);
+    for (size_t i = 0; i < m_inputChannels; ++i)
+    {
+        nodeIndex += m_strides[axes[i]];
+        weight = fractions[axes[i]] - (i + 1 < m_inputChannels ? fractions[axes[i + 1]] : 0.0f);
+        result = vmlaq_n_f32(result, vld1q_f32(nodes[nodeIndex].data()), weight);
+    }
+
+    Node node;
+    vst1q_f32(node.data(), result);
+    return node;
+#else
+    Node node = { };
+    for (size_t c = 0; c < node.size(); ++c)
+    {
+        node[c] = nodes[nodeIndex][c] * weight;
+    }
+
+    for (size_t i = 0; i < m_inputChannels; ++i)
+    {
+        nodeIndex += m_strides[axes[i]];
+        weight = fractions[axes[i]] - (i + 1 < m_inputChannels ? fractions[axes[i + 1]] : 0.0f);
+        for (size_t c = 0; c < node.size(); ++c)
+        {
+            node[c] += nodes[nodeIndex][c] * weight;
+        }
+    }
+
+    return node;
+#endif
+}
+
+QColor PDFProofingLookupTable::transformColor(const float* input, const QColor& alarmColor) const
+{
+    const Node node = interpolate(input);
+
+    if (node[3] >= 0.5f)
+    {
+        return alarmColor;
+    }
+
+    QColor color(QColor::Rgb);
+    color.setRgbF(qBound(0.0f, node[0], 1.0f), qBound(0.0f, node[1], 1.0f), qBound(0.0f, node[2], 1.0f));
+    return color;
+}
+
+void PDFProofingLookupTable::transformToRGB888(const float* input, size_t pixelCount, const QColor& alarmColor, unsigned char* outputBuffer) const
+{
+    const std::array<unsigned char, 3> alarm = { uchar(alarmColor.red()), uchar(alarmColor.green()), uchar(alarmColor.blue()) };
+
+    for (size_t i = 0; i < pixelCount; ++i)
+    {
+        const Node node = interpolate(input);
+        input += m_inputChannels;
+
+        if (node[3] >= 0.5f)
+        {
+            std::copy(alarm.cbegin(), alarm.cend(), outputBuffer);
+        }
+        else
+        {
+            for (size_t c = 0; c < 3; ++c)
+            {
+                outputBuffer[c] = uchar(qBound(0.0f, node[c], 1.0f) * 255.0f + 0.5f);
+            }
+        }
+
+        outputBuffer += 3;
+    }
+}
+
 class PDFLittleCMS : public PDFCMS
 {
 public:
@@ -91,11 +442,23 @@ public:
     virtual bool fillRGBBufferFromXYZ(const PDFColor3& whitePoint, const std::vector<float>& colors, RenderingIntent intent, unsigned char* outputBuffer, PDFRenderErrorReporter* reporter) const override;
     virtual bool fillRGBBufferFromICC(const std::vector<float>& colors, RenderingIntent renderingIntent, unsigned char* outputBuffer, const QByteArray& iccID, const QByteArray& iccData, PDFRenderErrorReporter* reporter) const override;
     virtual bool transformColorSpace(const ColorSpaceTransformParams& params) const override;
+    virtual bool isGenericDeviceColorConversion(ColorSpaceType colorSpaceType, RenderingIntent intent) const override;
+    virtual PDFCMSColorCacheStatistics getColorCacheStatistics() const override;
+    virtual void prewarm(const PDFDocument* document) const override;
+    virtual void collectMemoryUsage(PDFMemoryReport* report) const override;
     virtual PDFColorConvertor getColorConvertor() const override;
 
 private:
     void init();
 
+    /// Transforms single color to the output color using \p transform. Recently
+    /// transformed colors are memoized in a small thread local cache, because
+    /// pages usually set the same few colors over and over again.
+    /// \param transform Transform (with float output RGB buffer)
+    /// \param input Input color channels (in the input format of the transform)
+    /// \param channels Count of input color channels (at most 4)
+    QColor transformColor(cmsHTRANSFORM transform, const float* input, size_t channels) const;
+
     static int installCmsPlugins();
 
     static cmsBool optimizePipeline(cmsPipeline** Lut,
@@ -140,6 +503,71 @@ private:
     /// \param isRGB888Buffer If true, 8-bit RGB output buffer is used, otherwise FLOAT RGB output buffer is used
     cmsHTRANSFORM getTransformFromICCProfile(const QByteArray& iccData, const QByteArray& iccID, RenderingIntent renderingIntent, bool isRGB888Buffer) const;
 
+    /// Gets precomputed soft-proofing lookup table from cache. If it doesn't exist,
+    /// then it is created. If soft-proofing (or gamut checking) is not active,
+    /// or color space of the profile is not supported, nullptr is returned.
+    /// \param profile Color profile
+    /// \param intent Rendering intent
+    const PDFProofingLookupTable* getProofingLookupTable(Profile profile, RenderingIntent intent) const;
+
+    /// Gets precomputed soft-proofing lookup table for ICC profile from cache.
+    /// If it doesn't exist, then it is created. If soft-proofing (or gamut checking)
+    /// is not active, or color space of the profile is not supported, nullptr is returned.
+    /// \param iccData Data of icc profile
+    /// \param iccID Icc profile id
+    /// \param renderingIntent Rendering intent
+    const PDFProofingLookupTable* getProofingLookupTableFromICCProfile(const QByteArray& iccData, const QByteArray& iccID, RenderingIntent renderingIntent) const;
+
+    /// Creates soft-proofing lookup table from \p input profile to the output profile.
+    /// Tables are shared between all color management systems with the same profiles,
+    /// rendering intents and transformation flags, so table is computed only once, even
+    /// if the other settings (for example, the alarm color) are changed.
+    /// \param input Input color profile
+    /// \param inputHash Hash of the input color profile (if empty, table is not shared)
+    /// \param intent Rendering intent
+    std::shared_ptr<const PDFProofingLookupTable> createProofingLookupTable(cmsHPROFILE input, const QByteArray& inputHash, RenderingIntent intent) const;
+
+    /// Fills 8-bit RGB buffer using the soft-proofing lookup table. If table is null,
+    /// or count of colors doesn't match the input channels, false is returned.
+    /// \param table Lookup table (can be null)
+    /// \param colors Input colors (values are in range [0, 1])
+    /// \param outputBuffer Output 8-bit RGB buffer
+    bool fillRGBBufferFromProofingLookupTable(const PDFProofingLookupTable* table, const std::vector<float>& colors, unsigned char* outputBuffer) const;
+
+    /// Transforms color using the soft-proofing lookup table. If table is null,
+    /// or count of color channels doesn't match the input channels, no value is returned.
+    /// \param table Lookup table (can be null)
+    /// \param color Input color (values are in range [0, 1])
+    std::optional<QColor> getColorFromProofingLookupTable(const PDFProofingLookupTable* table, const PDFColor& color) const;
+
+    /// Creates transform from \p input profile to the output profile (possibly
+    /// with soft-proofing). Transforms are stored as device links in the disk cache,
+    /// so next time (even in another process) the transform is created from
+    /// the device link, which is much faster for large profiles.
+    /// \param input Input color profile
+    /// \param inputHash Hash of the input color profile (if empty, disk cache is not used)
+    /// \param inputFormat Input data format
+    /// \param outputFormat Output data format
+    /// \param intent Rendering intent
+    cmsHTRANSFORM createTransform(cmsHPROFILE input,
+                                  const QByteArray& inputHash,
+                                  cmsUInt32Number inputFormat,
+                                  cmsUInt32Number outputFormat,
+                                  RenderingIntent intent) const;
+
+    /// Returns directory of the disk cache of device link profiles
+    static QString getDeviceLinkCacheDirectory();
+
+    /// Returns MD5 hash of the profile content. If profile is invalid,
+    /// or hash can't be computed, empty byte array is returned.
+    /// \param profile Color profile
+    static QByteArray getProfileHash(cmsHPROFILE profile);
+
+    /// Returns true, if both profiles are valid and have the same content
+    /// \param profile1 First color profile
+    /// \param profile2 Second color profile
+    static bool isSameProfile(cmsHPROFILE profile1, cmsHPROFILE profile2);
+
     /// Returns transformation flags according to the current settings
     cmsUInt32Number getTransformationFlags() const;
 
@@ -174,16 +602,18 @@ private:
     PDFCMSSettings m_settings;
     QColor m_paperColor;
     std::array<cmsHPROFILE, ProfileCount> m_profiles;
+    std::array<QByteArray, ProfileCount> m_profileHashes;
     PDFColorConvertor m_colorConvertor;
+    bool m_isDeviceRGBIdentity = false;
 
-    mutable QReadWriteLock m_transformationCacheLock;
-    mutable std::unordered_map<int, cmsHTRANSFORM> m_transformationCache;
-
-    mutable QReadWriteLock m_customIccProfileCacheLock;
-    mutable std::map<std::pair<QByteArray, RenderingIntent>, cmsHTRANSFORM> m_customIccProfileCache;
+    PDFTransformSnapshotCache<std::unordered_map<int, cmsHTRANSFORM>> m_transformationCache;
+    PDFTransformSnapshotCache<std::map<std::pair<QByteArray, RenderingIntent>, cmsHTRANSFORM>> m_customIccProfileCache;
+    PDFTransformSnapshotCache<std::map<QByteArray, cmsHTRANSFORM>> m_transformColorSpaceCache;
+    PDFTransformSnapshotCache<std::unordered_map<int, std::shared_ptr<const PDFProofingLookupTable>>> m_proofingLookupTableCache;
+    PDFTransformSnapshotCache<std::map<std::pair<QByteArray, RenderingIntent>, std::shared_ptr<const PDFProofingLookupTable>>> m_customIccProofingLookupTableCache;
 
-    mutable QReadWriteLock m_transformColorSpaceCacheLock;
-    mutable std::map<QByteArray, cmsHTRANSFORM> m_transformColorSpaceCache;
+    mutable std::atomic<qint64> m_colorCacheHits = 0;
+    mutable std::atomic<qint64> m_colorCacheMisses = 0;
 };
 
 bool PDFLittleCMS::fillRGBBufferFromDeviceGray(const std::vector<float>& colors,
@@ -191,6 +621,11 @@ bool PDFLittleCMS::fillRGBBufferFromDeviceGray(const std::vector<float>& colors,
                                                unsigned char* outputBuffer,
                                                PDFRenderErrorReporter* reporter) const
 {
+    if (fillRGBBufferFromProofingLookupTable(getProofingLookupTable(Gray, getEffectiveRenderingIntent(intent)), colors, outputBuffer))
+    {
+        return true;
+    }
+
     cmsHTRANSFORM transform = getTransform(Gray, getEffectiveRenderingIntent(intent), true);
 
     if (!transform)
@@ -215,6 +650,11 @@ bool PDFLittleCMS::fillRGBBufferFromDeviceGray(const std::vector<float>& colors,
 
 bool PDFLittleCMS::fillRGBBufferFromDeviceRGB(const std::vector<float>& colors, RenderingIntent intent, unsigned char* outputBuffer, PDFRenderErrorReporter* reporter) const
 {
+    if (fillRGBBufferFromProofingLookupTable(getProofingLookupTable(RGB, getEffectiveRenderingIntent(intent)), colors, outputBuffer))
+    {
+        return true;
+    }
+
     cmsHTRANSFORM transform = getTransform(RGB, getEffectiveRenderingIntent(intent), true);
 
     if (!transform)
@@ -240,6 +680,11 @@ bool PDFLittleCMS::fillRGBBufferFromDeviceRGB(const std::vector<float>& colors,
 
 bool PDFLittleCMS::fillRGBBufferFromDeviceCMYK(const std::vector<float>& colors, RenderingIntent intent, unsigned char* outputBuffer, PDFRenderErrorReporter* reporter) const
 {
+    if (fillRGBBufferFromProofingLookupTable(getProofingLookupTable(CMYK, getEffectiveRenderingIntent(intent)), colors, outputBuffer))
+    {
+        return true;
+    }
+
     cmsHTRANSFORM transform = getTransform(CMYK, getEffectiveRenderingIntent(intent), true);
 
     if (!transform)
@@ -312,6 +757,11 @@ bool PDFLittleCMS::fillRGBBufferFromXYZ(const PDFColor3& whitePoint, const std::
 
 bool PDFLittleCMS::fillRGBBufferFromICC(const std::vector<float>& colors, RenderingIntent renderingIntent, unsigned char* outputBuffer, const QByteArray& iccID, const QByteArray& iccData, PDFRenderErrorReporter* reporter) const
 {
+    if (fillRGBBufferFromProofingLookupTable(getProofingLookupTableFromICCProfile(iccData, iccID, renderingIntent), colors, outputBuffer))
+    {
+        return true;
+    }
+
     cmsHTRANSFORM transform = getTransformFromICCProfile(iccData, iccID, renderingIntent, true);
 
     if (!transform)
@@ -480,32 +930,11 @@ PDFLittleCMS::PDFLittleCMS(const PDFCMSManager* manager,
 
 PDFLittleCMS::~PDFLittleCMS()
 {
-    for (const auto& transformItem : m_transformationCache)
-    {
-        cmsHTRANSFORM transform = transformItem.second;
-        if (transform)
-        {
-            cmsDeleteTransform(transform);
-        }
-    }
-
-    for (const auto& transformItem : m_customIccProfileCache)
-    {
-        cmsHTRANSFORM transform = transformItem.second;
-        if (transform)
-        {
-            cmsDeleteTransform(transform);
-        }
-    }
-
-    for (const auto& transformItem : m_transformColorSpaceCache)
-    {
-        cmsHTRANSFORM transform = transformItem.second;
-        if (transform)
-        {
-            cmsDeleteTransform(transform);
-        }
-    }
+    m_transformationCache.clear();
+    m_customIccProfileCache.clear();
+    m_transformColorSpaceCache.clear();
+    m_proofingLookupTableCache.clear();
+    m_customIccProofingLookupTableCache.clear();
 
     for (cmsHPROFILE profile : m_profiles)
     {
@@ -528,6 +957,11 @@ QColor PDFLittleCMS::getPaperColor() const
 
 QColor PDFLittleCMS::getColorFromDeviceGray(const PDFColor& color, RenderingIntent intent, PDFRenderErrorReporter* reporter) const
 {
+    if (std::optional<QColor> proofedColor = getColorFromProofingLookupTable(getProofingLookupTable(Gray, getEffectiveRenderingIntent(intent)), color))
+    {
+        return *proofedColor;
+    }
+
     cmsHTRANSFORM transform = getTransform(Gray, getEffectiveRenderingIntent(intent), false);
 
     if (!transform)
@@ -541,9 +975,7 @@ QColor PDFLittleCMS::getColorFromDeviceGray(const PDFColor& color, RenderingInte
         Q_ASSERT(cmsGetTransformOutputFormat(transform) == TYPE_RGB_FLT);
 
         const float grayColor = color[0];
-        std::array<float, 3> rgbOutputColor = { };
-        cmsDoTransform(transform, &grayColor, rgbOutputColor.data(), 1);
-        return getColorFromOutputColor(rgbOutputColor);
+        return transformColor(transform, &grayColor, 1);
     }
     else
     {
@@ -555,6 +987,11 @@ QColor PDFLittleCMS::getColorFromDeviceGray(const PDFColor& color, RenderingInte
 
 QColor PDFLittleCMS::getColorFromDeviceRGB(const PDFColor& color, RenderingIntent intent, PDFRenderErrorReporter* reporter) const
 {
+    if (std::optional<QColor> proofedColor = getColorFromProofingLookupTable(getProofingLookupTable(RGB, getEffectiveRenderingIntent(intent)), color))
+    {
+        return *proofedColor;
+    }
+
     cmsHTRANSFORM transform = getTransform(RGB, getEffectiveRenderingIntent(intent), false);
 
     if (!transform)
@@ -568,9 +1005,7 @@ QColor PDFLittleCMS::getColorFromDeviceRGB(const PDFColor& color, RenderingInten
         Q_ASSERT(cmsGetTransformOutputFormat(transform) == TYPE_RGB_FLT);
 
         std::array<float, 3> rgbInputColor = { color[0], color[1], color[2] };
-        std::array<float, 3> rgbOutputColor = { };
-        cmsDoTransform(transform, rgbInputColor.data(), rgbOutputColor.data(), 1);
-        return getColorFromOutputColor(rgbOutputColor);
+        return transformColor(transform, rgbInputColor.data(), rgbInputColor.size());
     }
     else
     {
@@ -582,6 +1017,11 @@ QColor PDFLittleCMS::getColorFromDeviceRGB(const PDFColor& color, RenderingInten
 
 QColor PDFLittleCMS::getColorFromDeviceCMYK(const PDFColor& color, RenderingIntent intent, PDFRenderErrorReporter* reporter) const
 {
+    if (std::optional<QColor> proofedColor = getColorFromProofingLookupTable(getProofingLookupTable(CMYK, getEffectiveRenderingIntent(intent)), color))
+    {
+        return *proofedColor;
+    }
+
     cmsHTRANSFORM transform = getTransform(CMYK, getEffectiveRenderingIntent(intent), false);
 
     if (!transform)
@@ -595,9 +1035,7 @@ QColor PDFLittleCMS::getColorFromDeviceCMYK(const PDFColor& color, RenderingInte
         Q_ASSERT(cmsGetTransformOutputFormat(transform) == TYPE_RGB_FLT);
 
         std::array<float, 4> cmykInputColor = { color[0] * 100.0f, color[1] * 100.0f, color[2] * 100.0f, color[3] * 100.0f };
-        std::array<float, 3> rgbOutputColor = { };
-        cmsDoTransform(transform, cmykInputColor.data(), rgbOutputColor.data(), 1);
-        return getColorFromOutputColor(rgbOutputColor);
+        return transformColor(transform, cmykInputColor.data(), cmykInputColor.size());
     }
     else
     {
@@ -623,9 +1061,7 @@ QColor PDFLittleCMS::getColorFromXYZ(const PDFColor3& whitePoint, const PDFColor
 
         const PDFColorComponentMatrix_3x3 adaptationMatrix = PDFChromaticAdaptationXYZ::createWhitepointChromaticAdaptation(getDefaultXYZWhitepoint(), whitePoint, m_settings.colorAdaptationXYZ);
         const PDFColor3 xyzInputColor = adaptationMatrix * color;
-        std::array<float, 3> rgbOutputColor = { };
-        cmsDoTransform(transform, xyzInputColor.data(), rgbOutputColor.data(), 1);
-        return getColorFromOutputColor(rgbOutputColor);
+        return transformColor(transform, xyzInputColor.data(), xyzInputColor.size());
     }
     else
     {
@@ -639,61 +1075,32 @@ cmsHTRANSFORM PDFLittleCMS::getTransformFromICCProfile(const QByteArray& iccData
 {
     RenderingIntent effectiveRenderingIntent = getEffectiveRenderingIntent(renderingIntent);
     const auto key = std::make_pair(iccID + (isRGB888Buffer ? "RGB_888" : "FLT"), effectiveRenderingIntent);
-    QReadLocker lock(&m_customIccProfileCacheLock);
-    auto it = m_customIccProfileCache.find(key);
-    if (it == m_customIccProfileCache.cend())
-    {
-        lock.unlock();
-        QWriteLocker writeLock(&m_customIccProfileCacheLock);
 
-        // Now, we have locked cache for writing. We must find out,
-        // if some other thread doesn't created the transformation already.
-        it = m_customIccProfileCache.find(key);
-        if (it == m_customIccProfileCache.cend())
+    return m_customIccProfileCache.get(key, [&]()
+    {
+        cmsHTRANSFORM transform = cmsHTRANSFORM();
+        cmsHPROFILE profile = cmsOpenProfileFromMem(iccData.data(), iccData.size());
+        if (profile)
         {
-            cmsHTRANSFORM transform = cmsHTRANSFORM();
-            cmsHPROFILE profile = cmsOpenProfileFromMem(iccData.data(), iccData.size());
-            if (profile)
+            if (const cmsUInt32Number inputDataFormat = getProfileDataFormat(profile))
             {
-                if (const cmsUInt32Number inputDataFormat = getProfileDataFormat(profile))
-                {
-                    cmsUInt32Number lcmsIntent = getLittleCMSRenderingIntent(effectiveRenderingIntent);
-
-                    if (isSoftProofing())
-                    {
-                        cmsHPROFILE proofingProfile = m_profiles[SoftProofing];
-                        RenderingIntent proofingIntent = m_settings.proofingIntent;
-                        if (m_settings.proofingIntent == RenderingIntent::Auto)
-                        {
-                            proofingIntent = effectiveRenderingIntent;
-                        }
-
-                        transform = cmsCreateProofingTransform(profile, inputDataFormat, m_profiles[Output], isRGB888Buffer ? TYPE_RGB_8 : TYPE_RGB_FLT, proofingProfile,
-                                                               lcmsIntent, getLittleCMSRenderingIntent(proofingIntent), getTransformationFlags());
-                    }
-                    else
-                    {
-                        transform = cmsCreateTransform(profile, inputDataFormat, m_profiles[Output], isRGB888Buffer ? TYPE_RGB_8 : TYPE_RGB_FLT, lcmsIntent, getTransformationFlags());
-                    }
-                }
-                cmsCloseProfile(profile);
+                // Identifier of the ICC profile is hash of the profile data
+                transform = createTransform(profile, iccID, inputDataFormat, isRGB888Buffer ? TYPE_RGB_8 : TYPE_RGB_FLT, effectiveRenderingIntent);
             }
-
-            it = m_customIccProfileCache.insert(std::make_pair(key, transform)).first;
+            cmsCloseProfile(profile);
         }
 
-        return it->second;
-    }
-    else
-    {
-        return it->second;
-    }
-
-    return cmsHTRANSFORM();
+        return transform;
+    });
 }
 
 QColor PDFLittleCMS::getColorFromICC(const PDFColor& color, RenderingIntent renderingIntent, const QByteArray& iccID, const QByteArray& iccData, PDFRenderErrorReporter* reporter) const
 {
+    if (std::optional<QColor> proofedColor = getColorFromProofingLookupTable(getProofingLookupTableFromICCProfile(iccData, iccID, renderingIntent), color))
+    {
+        return *proofedColor;
+    }
+
     cmsHTRANSFORM transform = getTransformFromICCProfile(iccData, iccID, renderingIntent, false);
 
     if (!transform)
@@ -714,9 +1121,7 @@ QColor PDFLittleCMS::getColorFromICC(const PDFColor& color, RenderingIntent rend
             inputBuffer[i] = isCMYK ? color[i] * 100.0f : color[i];
         }
 
-        std::array<float, 3> rgbOutputColor = { };
-        cmsDoTransform(transform, inputBuffer.data(), rgbOutputColor.data(), 1);
-        return getColorFromOutputColor(rgbOutputColor);
+        return transformColor(transform, inputBuffer.data(), channels);
     }
     else
     {
@@ -736,6 +1141,15 @@ void PDFLittleCMS::init()
     m_profiles[SoftProofing] = createProfile(m_settings.softProofingProfile, m_manager->getCMYKProfiles(), false);
     m_profiles[XYZ] = cmsCreateXYZProfile();
 
+    for (size_t i = 0; i < m_profiles.size(); ++i)
+    {
+        m_profileHashes[i] = getProfileHash(m_profiles[i]);
+    }
+
+    // Device RGB colors are passed to the output unchanged, if both color profiles are the same
+    // and we do not mark the colors by soft-proofing or gamut checking.
+    m_isDeviceRGBIdentity = !m_settings.isSoftProofing && !m_settings.isGamutChecking && isSameProfile(m_profiles[RGB], m_profiles[Output]);
+
     cmsUInt16Number outOfGamutR = m_settings.outOfGamutColor.redF() * 0xFFFF;
     cmsUInt16Number outOfGamutG = m_settings.outOfGamutColor.greenF() * 0xFFFF;
     cmsUInt16Number outOfGamutB = m_settings.outOfGamutColor.blueF() * 0xFFFF;
@@ -753,11 +1167,6 @@ void PDFLittleCMS::init()
             m_paperColor = QColor(Qt::white);
         }
     }
-
-    // 64 should be enough, because we can have 4 input color spaces (gray, RGB, CMYK and XYZ),
-    // and 4 rendering intents. We have 4 * 4 = 16 input tables, so 64 will suffice enough
-    // (because we then have 25% load factor).
-    m_transformationCache.reserve(64);
 }
 
 int PDFLittleCMS::installCmsPlugins()
@@ -866,6 +1275,289 @@ cmsBool PDFLittleCMS::optimizePipeline(cmsPipeline** Lut, cmsUInt32Number Intent
     return FALSE;
 }
 
+bool PDFLittleCMS::isGenericDeviceColorConversion(ColorSpaceType colorSpaceType, RenderingIntent intent) const
+{
+    Q_UNUSED(intent);
+    return colorSpaceType == DeviceRGB && m_isDeviceRGBIdentity;
+}
+
+PDFCMSColorCacheStatistics PDFLittleCMS::getColorCacheStatistics() const
+{
+    PDFCMSColorCacheStatistics statistics;
+    statistics.hits = m_colorCacheHits.load(std::memory_order_relaxed);
+    statistics.misses = m_colorCacheMisses.load(std::memory_order_relaxed);
+    return statistics;
+}
+
+void PDFLittleCMS::collectMemoryUsage(PDFMemoryReport* report) const
+{
+    // Little CMS doesn't provide size of the transform. Optimized transforms
+    // are mostly lookup tables of moderate size, so we use rough estimate.
+    constexpr qint64 TRANSFORM_MEMORY_ESTIMATE = 64 * 1024;
+
+    const qint64 count = qint64(m_transformationCache.size() + m_customIccProfileCache.size() + m_transformColorSpaceCache.size());
+    report->addItem(PDFTranslationContext::tr("Color transforms"), count * TRANSFORM_MEMORY_ESTIMATE, count);
+}
+
+void PDFLittleCMS::prewarm(const PDFDocument* document) const
+{
+    // Perceptual is the default rendering intent of the page content
+    const RenderingIntent intent = getEffectiveRenderingIntent(RenderingIntent::Perceptual);
+
+    for (const Profile profile : { Gray, RGB, CMYK })
+    {
+        getTransform(profile, intent, false);
+        getTransform(profile, intent, true);
+        getProofingLookupTable(profile, intent);
+    }
+
+    if (!document || document->getCatalog()->getPageCount() == 0)
+    {
+        return;
+    }
+
+    try
+    {
+        const PDFPage* page = document->getCatalog()->getPage(0);
+        const PDFDictionary* resources = document->getDictionaryFromObject(page->getResources());
+        const PDFDictionary* colorSpaces = resources ? document->getDictionaryFromObject(resources->get("ColorSpace")) : nullptr;
+
+        if (!colorSpaces)
+        {
+            return;
+        }
+
+        for (size_t i = 0; i < colorSpaces->getCount(); ++i)
+        {
+            const PDFObject& colorSpaceObject = document->getObject(colorSpaces->getValue(i));
+            if (!colorSpaceObject.isArray())
+            {
+                continue;
+            }
+
+            const PDFArray* colorSpaceArray = colorSpaceObject.getArray();
+            if (colorSpaceArray->getCount() != 2)
+            {
+                continue;
+            }
+
+            const PDFObject& nameObject = document->getObject(colorSpaceArray->getItem(0));
+            const PDFObject& streamObject = document->getObject(colorSpaceArray->getItem(1));
+            if (nameObject.isName() && nameObject.getString() == COLOR_SPACE_NAME_ICCBASED && streamObject.isStream())
+            {
+                QByteArray iccProfileData = document->getDecodedStream(streamObject.getStream());
+                QByteArray iccProfileDataChecksum = QCryptographicHash::hash(iccProfileData, QCryptographicHash::Md5);
+                getTransformFromICCProfile(iccProfileData, iccProfileDataChecksum, intent, false);
+                getTransformFromICCProfile(iccProfileData, iccProfileDataChecksum, intent, true);
+                getProofingLookupTableFromICCProfile(iccProfileData, iccProfileDataChecksum, intent);
+            }
+        }
+    }
+    catch (const PDFException&)
+    {
+        // Prewarming is only an optimization, transforms
+        // will be created when they are needed.
+    }
+}
+
+QColor PDFLittleCMS::transformColor(cmsHTRANSFORM transform, const float* input, size_t channels) const
+{
+    Q_ASSERT(channels <= 4);
+
+    // Direct mapped cache. Entries are keyed by unique id of the color management
+    // system (which is never reused, unlike the address of the transform), by
+    // the transform and by the exact bits of the input color.
+    struct CacheEntry
+    {
+        quint64 cmsId = 0;
+        cmsHTRANSFORM transform = nullptr;
+        std::array<quint32, 4> input = { };
+        QColor color;
+    };
+
+    constexpr size_t CACHE_SIZE = 256;
+    thread_local std::array<CacheEntry, CACHE_SIZE> cache;
+
+    std::array<quint32, 4> inputBits = { };
+    std::memcpy(inputBits.data(), input, channels * sizeof(float));
+
+    size_t hash = size_t(reinterpret_cast<quintptr>(transform));
+    for (const quint32 bits : inputBits)
+    {
+        hash = (hash ^ bits) * 0x9E3779B1u;
+    }
+    hash ^= hash >> 16;
+
+    CacheEntry& entry = cache[hash % CACHE_SIZE];
+    const quint64 cmsId = getUniqueId();
+    if (entry.cmsId == cmsId && entry.transform == transform && entry.input == inputBits)
+    {
+        m_colorCacheHits.fetch_add(1, std::memory_order_relaxed);
+        return entry.color;
+    }
+
+    m_colorCacheMisses.fetch_add(1, std::memory_order_relaxed);
+
+    std::array<float, 3> rgbOutputColor = { };
+    cmsDoTransform(transform, input, rgbOutputColor.data(), 1);
+
+    entry.cmsId = cmsId;
+    entry.transform = transform;
+    entry.input = inputBits;
+    entry.color = getColorFromOutputColor(rgbOutputColor);
+    return entry.color;
+}
+
+cmsHTRANSFORM PDFLittleCMS::createTransform(cmsHPROFILE input,
+                                           const QByteArray& inputHash,
+                                           cmsUInt32Number inputFormat,
+                                           cmsUInt32Number outputFormat,
+                                           RenderingIntent intent) const
+{
+    cmsHPROFILE output = m_profiles[Output];
+    const cmsUInt32Number flags = getTransformationFlags();
+    const cmsUInt32Number lcmsIntent = getLittleCMSRenderingIntent(intent);
+    const bool softProofing = isSoftProofing();
+
+    RenderingIntent proofingIntent = m_settings.proofingIntent;
+    if (m_settings.proofingIntent == RenderingIntent::Auto)
+    {
+        proofingIntent = intent;
+    }
+    const cmsUInt32Number lcmsProofingIntent = getLittleCMSRenderingIntent(proofingIntent);
+
+    // Gamut check is performed by a separate pipeline, which is not
+    // a part of the device link, so such transforms are not cached.
+    const bool useDeviceLinkCache = !inputHash.isEmpty() &&
+                                    !m_profileHashes[Output].isEmpty() &&
+                                    !(flags & cmsFLAGS_GAMUTCHECK) &&
+                                    (!softProofing || !m_profileHashes[SoftProofing].isEmpty());
+
+    QString deviceLinkFileName;
+    if (useDeviceLinkCache)
+    {
+        QByteArray parameters;
+        {
+            QDataStream stream(&parameters, QIODevice::WriteOnly);
+            stream << inputFormat << outputFormat << lcmsIntent << flags << quint32(LCMS_VERSION);
+
+            if (softProofing)
+            {
+                stream << lcmsProofingIntent;
+            }
+        }
+
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        hash.addData(inputHash);
+        hash.addData(m_profileHashes[Output]);
+        if (softProofing)
+        {
+            hash.addData(m_profileHashes[SoftProofing]);
+        }
+        hash.addData(parameters);
+        deviceLinkFileName = getDeviceLinkCacheDirectory() + "/" + QString::fromLatin1(hash.result().toHex()) + ".icc";
+
+        QFile file(deviceLinkFileName);
+        if (file.open(QFile::ReadOnly))
+        {
+            QByteArray deviceLinkData = file.readAll();
+            file.close();
+
+            if (cmsHPROFILE deviceLink = cmsOpenProfileFromMem(deviceLinkData.constData(), cmsUInt32Number(deviceLinkData.size())))
+            {
+                // Black point compensation and soft-proofing are already contained in the device link
+                const cmsUInt32Number deviceLinkFlags = flags & ~(cmsFLAGS_SOFTPROOFING | cmsFLAGS_BLACKPOINTCOMPENSATION);
+                cmsHTRANSFORM transform = cmsCreateTransform(deviceLink, inputFormat, nullptr, outputFormat, lcmsIntent, deviceLinkFlags);
+                cmsCloseProfile(deviceLink);
+
+                if (transform)
+                {
+                    return transform;
+                }
+            }
+        }
+    }
+
+    cmsHTRANSFORM transform = cmsHTRANSFORM();
+    if (softProofing)
+    {
+        transform = cmsCreateProofingTransform(input, inputFormat, output, outputFormat, m_profiles[SoftProofing], lcmsIntent, lcmsProofingIntent, flags);
+    }
+    else
+    {
+        transform = cmsCreateTransform(input, inputFormat, output, outputFormat, lcmsIntent, flags);
+    }
+
+    if (transform && useDeviceLinkCache)
+    {
+        // Store the transform as a device link. If it fails, then nothing happens,
+        // transform will be created from the profiles again next time.
+        const cmsUInt32Number precalculationFlags = flags & (cmsFLAGS_LOWRESPRECALC | cmsFLAGS_HIGHRESPRECALC);
+        if (cmsHPROFILE deviceLink = cmsTransform2DeviceLink(transform, 4.3, precalculationFlags))
+        {
+            cmsUInt32Number size = 0;
+            if (cmsSaveProfileToMem(deviceLink, nullptr, &size) && size > 0)
+            {
+                QByteArray deviceLinkData(size, Qt::Uninitialized);
+                if (cmsSaveProfileToMem(deviceLink, deviceLinkData.data(), &size) && QDir().mkpath(getDeviceLinkCacheDirectory()))
+                {
+                    QSaveFile file(deviceLinkFileName);
+                    if (file.open(QFile::WriteOnly))
+                    {
+                        file.write(deviceLinkData.constData(), size);
+                        file.commit();
+                    }
+                }
+            }
+
+            cmsCloseProfile(deviceLink);
+        }
+    }
+
+    return transform;
+}
+
+QString PDFLittleCMS::getDeviceLinkCacheDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/DeviceLinks";
+}
+
+QByteArray PDFLittleCMS::getProfileHash(cmsHPROFILE profile)
+{
+    if (!profile || !cmsMD5computeID(profile))
+    {
+        return QByteArray();
+    }
+
+    cmsUInt8Number profileId[16] = { };
+    cmsGetHeaderProfileID(profile, profileId);
+    return QByteArray(reinterpret_cast<const char*>(profileId), sizeof(profileId));
+}
+
+bool PDFLittleCMS::isSameProfile(cmsHPROFILE profile1, cmsHPROFILE profile2)
+{
+    if (!profile1 || !profile2)
+    {
+        return false;
+    }
+
+    if (profile1 == profile2)
+    {
+        return true;
+    }
+
+    if (!cmsMD5computeID(profile1) || !cmsMD5computeID(profile2))
+    {
+        return false;
+    }
+
+    cmsUInt8Number profileId1[16] = { };
+    cmsUInt8Number profileId2[16] = { };
+    cmsGetHeaderProfileID(profile1, profileId1);
+    cmsGetHeaderProfileID(profile2, profileId2);
+    return std::memcmp(profileId1, profileId2, sizeof(profileId1)) == 0;
+}
+
 bool PDFLittleCMS::isSoftProofing() const
 {
     return (m_settings.isSoftProofing || m_settings.isGamutChecking) && m_profiles[SoftProofing];
@@ -936,75 +1628,235 @@ cmsHPROFILE PDFLittleCMS::createProfile(const QString& id, const PDFColorProfile
                     QByteArray fileContent = file.readAll();
                     file.close();
 
-                    return cmsOpenProfileFromMem(fileContent.data(), fileContent.size());
-                }
+                    return cmsOpenProfileFromMem(fileContent.data(), fileContent.size());
+                }
+
+                break;
+            }
+
+            case PDFColorProfileIdentifier::Type::MemoryGray:
+            case PDFColorProfileIdentifier::Type::MemoryRGB:
+            case PDFColorProfileIdentifier::Type::MemoryCMYK:
+                return cmsOpenProfileFromMem(identifier.profileMemoryData.data(), identifier.profileMemoryData.size());
+
+            default:
+                Q_ASSERT(false);
+                break;
+        }
+    }
+
+    return cmsHPROFILE();
+}
+
+cmsHTRANSFORM PDFLittleCMS::getTransform(Profile profile, RenderingIntent intent, bool isRGB888Buffer) const
+{
+    const int key = getCacheKey(profile, intent, isRGB888Buffer);
+
+    return m_transformationCache.get(key, [&]()
+    {
+        cmsHTRANSFORM transform = cmsHTRANSFORM();
+        cmsHPROFILE input = m_profiles[profile];
+
+        if (input && m_profiles[Output])
+        {
+            transform = createTransform(input, m_profileHashes[profile], getProfileDataFormat(input), isRGB888Buffer ? TYPE_RGB_8 : TYPE_RGB_FLT, intent);
+        }
+
+        return transform;
+    });
+}
+
+const PDFProofingLookupTable* PDFLittleCMS::getProofingLookupTable(Profile profile, RenderingIntent intent) const
+{
+    if (!isSoftProofing())
+    {
+        return nullptr;
+    }
+
+    const int key = getCacheKey(profile, intent, false);
+    return m_proofingLookupTableCache.get(key, [&]()
+    {
+        std::shared_ptr<const PDFProofingLookupTable> table;
+        if (cmsHPROFILE input = m_profiles[profile])
+        {
+            table = createProofingLookupTable(input, m_profileHashes[profile], intent);
+        }
+        return table;
+    }).get();
+}
+
+const PDFProofingLookupTable* PDFLittleCMS::getProofingLookupTableFromICCProfile(const QByteArray& iccData, const QByteArray& iccID, RenderingIntent renderingIntent) const
+{
+    if (!isSoftProofing())
+    {
+        return nullptr;
+    }
+
+    RenderingIntent effectiveRenderingIntent = getEffectiveRenderingIntent(renderingIntent);
+    const auto key = std::make_pair(iccID, effectiveRenderingIntent);
+
+    return m_customIccProofingLookupTableCache.get(key, [&]()
+    {
+        std::shared_ptr<const PDFProofingLookupTable> table;
+        if (cmsHPROFILE profile = cmsOpenProfileFromMem(iccData.data(), iccData.size()))
+        {
+            // Identifier of the ICC profile is hash of the profile data
+            table = createProofingLookupTable(profile, iccID, effectiveRenderingIntent);
+            cmsCloseProfile(profile);
+        }
+        return table;
+    }).get();
+}
+
+std::shared_ptr<const PDFProofingLookupTable> PDFLittleCMS::createProofingLookupTable(cmsHPROFILE input, const QByteArray& inputHash, RenderingIntent intent) const
+{
+    cmsHPROFILE output = m_profiles[Output];
+    const cmsUInt32Number inputFormat = getProfileDataFormat(input);
+    const cmsUInt32Number colorSpace = T_COLORSPACE(inputFormat);
 
-                break;
-            }
+    // XYZ colors are not bounded to the unit range, so they are transformed directly
+    if (!output || !isSoftProofing() || (colorSpace != PT_GRAY && colorSpace != PT_RGB && colorSpace != PT_CMYK))
+    {
+        return nullptr;
+    }
 
-            case PDFColorProfileIdentifier::Type::MemoryGray:
-            case PDFColorProfileIdentifier::Type::MemoryRGB:
-            case PDFColorProfileIdentifier::Type::MemoryCMYK:
-                return cmsOpenProfileFromMem(identifier.profileMemoryData.data(), identifier.profileMemoryData.size());
+    const cmsUInt32Number flags = getTransformationFlags();
+    const cmsUInt32Number lcmsIntent = getLittleCMSRenderingIntent(intent);
 
-            default:
-                Q_ASSERT(false);
-                break;
-        }
+    RenderingIntent proofingIntent = m_settings.proofingIntent;
+    if (m_settings.proofingIntent == RenderingIntent::Auto)
+    {
+        proofingIntent = intent;
     }
+    const cmsUInt32Number lcmsProofingIntent = getLittleCMSRenderingIntent(proofingIntent);
 
-    return cmsHPROFILE();
-}
+    // Grid point counts are the same as little CMS uses for precalculated transforms
+    const size_t inputChannels = T_CHANNELS(inputFormat);
+    int gridPoints = 0;
+    switch (m_settings.accuracy)
+    {
+        case PDFCMSSettings::Accuracy::Low:
+            gridPoints = inputChannels == 1 ? 256 : (inputChannels == 3 ? 17 : 9);
+            break;
 
-cmsHTRANSFORM PDFLittleCMS::getTransform(Profile profile, RenderingIntent intent, bool isRGB888Buffer) const
-{
-    const int key = getCacheKey(profile, intent, isRGB888Buffer);
+        case PDFCMSSettings::Accuracy::Medium:
+            gridPoints = inputChannels == 1 ? 256 : (inputChannels == 3 ? 33 : 17);
+            break;
+
+        case PDFCMSSettings::Accuracy::High:
+            gridPoints = inputChannels == 1 ? 1024 : (inputChannels == 3 ? 49 : 23);
+            break;
 
-    QReadLocker lock(&m_transformationCacheLock);
-    auto it = m_transformationCache.find(key);
-    if (it == m_transformationCache.cend())
+        default:
+            Q_ASSERT(false);
+            break;
+    }
+
+    auto createTable = [&]() -> std::shared_ptr<const PDFProofingLookupTable>
     {
-        lock.unlock();
-        QWriteLocker writeLock(&m_transformationCacheLock);
+        // Little CMS float transforms are not precalculated, so the whole chain of profiles
+        // is evaluated, which is slow. Proofed colors are computed without gamut check,
+        // because out of gamut colors are marked by negative values in the gamut check transform.
+        cmsHTRANSFORM proofingTransform = cmsCreateProofingTransform(input, inputFormat, output, TYPE_RGB_FLT, m_profiles[SoftProofing], lcmsIntent, lcmsProofingIntent, flags & ~cmsFLAGS_GAMUTCHECK);
+        cmsHTRANSFORM gamutCheckTransform = cmsHTRANSFORM();
 
-        // Now, we have locked cache for writing. We must find out,
-        // if some other thread doesn't created the transformation already.
-        it = m_transformationCache.find(key);
-        if (it == m_transformationCache.cend())
+        if (flags & cmsFLAGS_GAMUTCHECK)
         {
-            cmsHTRANSFORM transform = cmsHTRANSFORM();
-            cmsHPROFILE input = m_profiles[profile];
-            cmsHPROFILE output = m_profiles[Output];
+            gamutCheckTransform = cmsCreateProofingTransform(input, inputFormat, output, TYPE_RGB_FLT, m_profiles[SoftProofing], lcmsIntent, lcmsProofingIntent, flags);
+        }
 
-            if (input && output)
-            {
-                if (isSoftProofing())
-                {
-                    cmsHPROFILE proofingProfile = m_profiles[SoftProofing];
-                    RenderingIntent proofingIntent = m_settings.proofingIntent;
-                    if (m_settings.proofingIntent == RenderingIntent::Auto)
-                    {
-                        proofingIntent = intent;
-                    }
+        std::shared_ptr<const PDFProofingLookupTable> table;
+        if (proofingTransform && (gamutCheckTransform || !(flags & cmsFLAGS_GAMUTCHECK)))
+        {
+            const float inputScale = colorSpace == PT_CMYK ? 100.0f : 1.0f;
+            table = PDFProofingLookupTable::create(proofingTransform, gamutCheckTransform, inputScale, gridPoints);
+        }
 
-                    transform = cmsCreateProofingTransform(input, getProfileDataFormat(input), output, isRGB888Buffer ? TYPE_RGB_8 : TYPE_RGB_FLT, proofingProfile,
-                                                           getLittleCMSRenderingIntent(intent), getLittleCMSRenderingIntent(proofingIntent), getTransformationFlags());
-                }
-                else
-                {
-                    transform = cmsCreateTransform(input, getProfileDataFormat(input), output, isRGB888Buffer ? TYPE_RGB_8 : TYPE_RGB_FLT, getLittleCMSRenderingIntent(intent), getTransformationFlags());
-                }
-            }
+        if (proofingTransform)
+        {
+            cmsDeleteTransform(proofingTransform);
+        }
 
-            it = m_transformationCache.insert(std::make_pair(key, transform)).first;
+        if (gamutCheckTransform)
+        {
+            cmsDeleteTransform(gamutCheckTransform);
         }
 
-        // We must return it here to avoid race condition (after current block,
-        // lock is not locked, because we unlocked lock for reading).
+        return table;
+    };
+
+    if (inputHash.isEmpty() || m_profileHashes[Output].isEmpty() || m_profileHashes[SoftProofing].isEmpty())
+    {
+        return createTable();
+    }
+
+    QByteArray parameters;
+    {
+        QDataStream stream(&parameters, QIODevice::WriteOnly);
+        stream << inputFormat << lcmsIntent << lcmsProofingIntent << flags << qint32(gridPoints);
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(inputHash);
+    hash.addData(m_profileHashes[Output]);
+    hash.addData(m_profileHashes[SoftProofing]);
+    hash.addData(parameters);
+    const QByteArray key = hash.result();
+
+    // Tables are shared by color management systems, which are recreated
+    // each time the settings are changed. Tables, which are not used
+    // by any color management system, are released, when there is too
+    // many tables in the cache.
+    constexpr size_t SHARED_TABLE_LIMIT = 32;
+    static QMutex mutex;
+    static std::map<QByteArray, std::shared_ptr<const PDFProofingLookupTable>> sharedTables;
+
+    QMutexLocker lock(&mutex);
+    auto it = sharedTables.find(key);
+    if (it != sharedTables.cend())
+    {
         return it->second;
     }
 
-    return it->second;
+    std::shared_ptr<const PDFProofingLookupTable> table = createTable();
+    if (table)
+    {
+        if (sharedTables.size() >= SHARED_TABLE_LIMIT)
+        {
+            std::erase_if(sharedTables, [](const auto& item) { return item.second.use_count() == 1; });
+        }
+
+        sharedTables[key] = table;
+    }
+
+    return table;
+}
+
+bool PDFLittleCMS::fillRGBBufferFromProofingLookupTable(const PDFProofingLookupTable* table, const std::vector<float>& colors, unsigned char* outputBuffer) const
+{
+    if (!table || colors.size() % table->getInputChannels() != 0)
+    {
+        return false;
+    }
+
+    table->transformToRGB888(colors.data(), colors.size() / table->getInputChannels(), m_settings.outOfGamutColor, outputBuffer);
+    return true;
+}
+
+std::optional<QColor> PDFLittleCMS::getColorFromProofingLookupTable(const PDFProofingLookupTable* table, const PDFColor& color) const
+{
+    if (!table || color.size() != table->getInputChannels())
+    {
+        return std::nullopt;
+    }
+
+    std::array<float, 4> input = { };
+    for (size_t i = 0; i < color.size(); ++i)
+    {
+        input[i] = color[i];
+    }
+
+    return table->transformColor(input.data(), m_settings.outOfGamutColor);
 }
 
 cmsUInt32Number PDFLittleCMS::getTransformationFlags() const
@@ -1136,102 +1988,84 @@ QByteArray PDFLittleCMS::getTransformColorSpaceKey(const PDFCMS::ColorSpaceTrans
 cmsHTRANSFORM PDFLittleCMS::getTransformBetweenColorSpaces(const PDFCMS::ColorSpaceTransformParams& params) const
 {
     QByteArray key = getTransformColorSpaceKey(params);
-    QReadLocker lock(&m_transformColorSpaceCacheLock);
-    auto it = m_transformColorSpaceCache.find(key);
-    if (it == m_transformColorSpaceCache.cend())
+
+    return m_transformColorSpaceCache.get(key, [&]()
     {
-        lock.unlock();
-        QWriteLocker writeLock(&m_transformColorSpaceCacheLock);
+        cmsHPROFILE inputProfile = cmsHPROFILE();
+        cmsHPROFILE outputProfile = cmsHPROFILE();
+        cmsHTRANSFORM transform = cmsHTRANSFORM();
 
-        // Now, we have locked cache for writing. We must find out,
-        // if some other thread doesn't created the transformation already.
-        it = m_transformColorSpaceCache.find(key);
-        if (it == m_transformColorSpaceCache.cend())
+        switch (params.sourceType)
         {
-            cmsHPROFILE inputProfile = cmsHPROFILE();
-            cmsHPROFILE outputProfile = cmsHPROFILE();
-            cmsHTRANSFORM transform = cmsHTRANSFORM();
-
-            switch (params.sourceType)
-            {
-                case ColorSpaceType::DeviceGray:
-                    inputProfile = m_profiles[Gray];
-                    break;
-
-                case ColorSpaceType::DeviceRGB:
-                    inputProfile = m_profiles[RGB];
-                    break;
-
-                case ColorSpaceType::DeviceCMYK:
-                    inputProfile = m_profiles[CMYK];
-                    break;
+            case ColorSpaceType::DeviceGray:
+                inputProfile = m_profiles[Gray];
+                break;
 
-                case ColorSpaceType::XYZ:
-                    inputProfile = m_profiles[XYZ];
-                    break;
+            case ColorSpaceType::DeviceRGB:
+                inputProfile = m_profiles[RGB];
+                break;
 
-                case ColorSpaceType::ICC:
-                    inputProfile = cmsOpenProfileFromMem(params.sourceIccData.data(), params.sourceIccData.size());
-                    break;
+            case ColorSpaceType::DeviceCMYK:
+                inputProfile = m_profiles[CMYK];
+                break;
 
-                default:
-                    Q_ASSERT(false);
-                    break;
-            }
+            case ColorSpaceType::XYZ:
+                inputProfile = m_profiles[XYZ];
+                break;
 
-            switch (params.targetType)
-            {
-                case ColorSpaceType::DeviceGray:
-                    outputProfile = m_profiles[Gray];
-                    break;
+            case ColorSpaceType::ICC:
+                inputProfile = cmsOpenProfileFromMem(params.sourceIccData.data(), params.sourceIccData.size());
+                break;
 
-                case ColorSpaceType::DeviceRGB:
-                    outputProfile = m_profiles[RGB];
-                    break;
+            default:
+                Q_ASSERT(false);
+                break;
+        }
 
-                case ColorSpaceType::DeviceCMYK:
-                    outputProfile = m_profiles[CMYK];
-                    break;
+        switch (params.targetType)
+        {
+            case ColorSpaceType::DeviceGray:
+                outputProfile = m_profiles[Gray];
+                break;
 
-                case ColorSpaceType::XYZ:
-                    outputProfile = m_profiles[XYZ];
-                    break;
+            case ColorSpaceType::DeviceRGB:
+                outputProfile = m_profiles[RGB];
+                break;
 
-                case ColorSpaceType::ICC:
-                    outputProfile = cmsOpenProfileFromMem(params.targetIccData.data(), params.targetIccData.size());
-                    break;
+            case ColorSpaceType::DeviceCMYK:
+                outputProfile = m_profiles[CMYK];
+                break;
 
-                default:
-                    Q_ASSERT(false);
-                    break;
-            }
+            case ColorSpaceType::XYZ:
+                outputProfile = m_profiles[XYZ];
+                break;
 
-            if (inputProfile && outputProfile)
-            {
-                transform = cmsCreateTransform(inputProfile, getProfileDataFormat(inputProfile), outputProfile, getProfileDataFormat(outputProfile), getLittleCMSRenderingIntent(params.intent), getTransformationFlags());
-            }
+            case ColorSpaceType::ICC:
+                outputProfile = cmsOpenProfileFromMem(params.targetIccData.data(), params.targetIccData.size());
+                break;
 
-            if (params.sourceType == ColorSpaceType::ICC)
-            {
-                cmsCloseProfile(inputProfile);
-            }
+            default:
+                Q_ASSERT(false);
+                break;
+        }
 
-            if (params.targetType == ColorSpaceType::ICC)
-            {
-                cmsCloseProfile(outputProfile);
-            }
+        if (inputProfile && outputProfile)
+        {
+            transform = cmsCreateTransform(inputProfile, getProfileDataFormat(inputProfile), outputProfile, getProfileDataFormat(outputProfile), getLittleCMSRenderingIntent(params.intent), getTransformationFlags());
+        }
 
-            it = m_transformColorSpaceCache.insert(std::make_pair(key, transform)).first;
+        if (params.sourceType == ColorSpaceType::ICC)
+        {
+            cmsCloseProfile(inputProfile);
         }
 
-        return it->second;
-    }
-    else
-    {
-        return it->second;
-    }
+        if (params.targetType == ColorSpaceType::ICC)
+        {
+            cmsCloseProfile(outputProfile);
+        }
 
-    return cmsHTRANSFORM();
+        return transform;
+    });
 }
 
 QString getInfoFromProfile(cmsHPROFILE profile, cmsInfoType infoType)
@@ -1391,6 +2225,24 @@ bool PDFCMSGeneric::transformColorSpace(const PDFCMS::ColorSpaceTransformParams&
     return false;
 }
 
+bool PDFCMSGeneric::isGenericDeviceColorConversion(ColorSpaceType colorSpaceType, RenderingIntent intent) const
+{
+    Q_UNUSED(intent);
+
+    switch (colorSpaceType)
+    {
+        case DeviceGray:
+        case DeviceRGB:
+        case DeviceCMYK:
+            return true;
+
+        default:
+            break;
+    }
+
+    return false;
+}
+
 PDFColorConvertor PDFCMSGeneric::getColorConvertor() const
 {
     return m_colorConvertor;
@@ -1404,6 +2256,18 @@ PDFCMSManager::PDFCMSManager(QObject* parent) :
 
 }
 
+PDFCMSManager::~PDFCMSManager()
+{
+    m_cancelled = true;
+    m_externalProfilesFuture.waitForFinished();
+}
+
+void PDFCMSManager::setAsynchronousProfileEnumeration(bool asynchronous)
+{
+    QMutexLocker lock(&m_mutex);
+    m_isAsynchronousProfileEnumeration = asynchronous;
+}
+
 void PDFCMSManager::finalize()
 {
     cmsUnregisterPlugins();
@@ -1415,6 +2279,11 @@ PDFCMSPointer PDFCMSManager::getCurrentCMS() const
     return m_CMS.get(this, &PDFCMSManager::getCurrentCMSImpl);
 }
 
+void PDFCMSManager::collectMemoryUsage(PDFMemoryReport* report) const
+{
+    getCurrentCMS()->collectMemoryUsage(report);
+}
+
 void PDFCMSManager::setSettings(const PDFCMSSettings& settings)
 {
     if (m_settings != settings)
@@ -1586,6 +2455,12 @@ void PDFCMSManager::setDocument(const PDFDocument* document)
         lock = std::nullopt;
         Q_EMIT colorManagementSystemChanged();
     }
+
+    if (document)
+    {
+        lock = std::nullopt;
+        getCurrentCMS()->prewarm(document);
+    }
 }
 
 QString PDFCMSManager::getSystemName(PDFCMSSettings::System system)
@@ -1763,8 +2638,68 @@ PDFColorProfileIdentifiers PDFCMSManager::getExternalColorProfiles(QString profi
 
 PDFColorProfileIdentifiers PDFCMSManager::getExternalProfilesImpl() const
 {
+    const QStringList directories = getExternalProfileDirectories();
+    const DirectoryStamps stamps = getDirectoryStamps(directories);
+
+    if (!m_externalProfilesIndexStamps.empty() && m_externalProfilesIndexStamps == stamps)
+    {
+        return m_externalProfilesIndex;
+    }
+
     PDFColorProfileIdentifiers result;
+    bool isUpToDate = false;
+    const bool isIndexLoaded = loadExternalProfilesIndex(stamps, result, isUpToDate);
 
+    if (isIndexLoaded && isUpToDate)
+    {
+        m_externalProfilesIndexStamps = stamps;
+        m_externalProfilesIndex = result;
+        return result;
+    }
+
+    if (!m_isAsynchronousProfileEnumeration)
+    {
+        result = enumerateExternalProfiles(directories);
+        saveExternalProfilesIndex(stamps, result);
+        m_externalProfilesIndexStamps = stamps;
+        m_externalProfilesIndex = result;
+        return result;
+    }
+
+    // Scan directories in the background. If some scan is already running,
+    // then we do not start a new one. When the scan finishes, the cache is cleared,
+    // so the stamps are checked again and a new scan is started, if needed.
+    if (!m_externalProfilesFuture.isRunning())
+    {
+        PDFCMSManager* manager = const_cast<PDFCMSManager*>(this);
+        m_externalProfilesFuture = QtConcurrent::run([manager, directories, stamps]()
+        {
+            PDFColorProfileIdentifiers profiles = manager->enumerateExternalProfiles(directories);
+
+            if (manager->m_cancelled)
+            {
+                return;
+            }
+
+            saveExternalProfilesIndex(stamps, profiles);
+
+            {
+                QMutexLocker lock(&manager->m_mutex);
+                manager->m_externalProfilesIndexStamps = stamps;
+                manager->m_externalProfilesIndex = qMove(profiles);
+                manager->clearCache();
+            }
+
+            Q_EMIT manager->colorManagementSystemChanged();
+        });
+    }
+
+    // Use outdated index (or nothing, if index doesn't exist) until scan is finished
+    return result;
+}
+
+QStringList PDFCMSManager::getExternalProfileDirectories() const
+{
     QStringList directories(m_settings.profileDirectory);
 
 #if defined(Q_OS_WIN)
@@ -1792,8 +2727,21 @@ PDFColorProfileIdentifiers PDFCMSManager::getExternalProfilesImpl() const
 #else
     static_assert(false, "Implement this for another OS!");
 #endif
+
+    return directories;
+}
+
+PDFColorProfileIdentifiers PDFCMSManager::enumerateExternalProfiles(const QStringList& directories) const
+{
+    PDFColorProfileIdentifiers result;
+
     for (const QString& directory : directories)
     {
+        if (m_cancelled)
+        {
+            break;
+        }
+
         PDFColorProfileIdentifiers externalProfiles = getExternalColorProfiles(directory);
         result.insert(result.end(), externalProfiles.begin(), externalProfiles.end());
     }
@@ -1801,6 +2749,114 @@ PDFColorProfileIdentifiers PDFCMSManager::getExternalProfilesImpl() const
     return result;
 }
 
+QString PDFCMSManager::getExternalProfilesIndexFileName()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/ColorProfileIndex.bin";
+}
+
+PDFCMSManager::DirectoryStamps PDFCMSManager::getDirectoryStamps(const QStringList& directories)
+{
+    DirectoryStamps stamps;
+
+    // Profile file names are stored relative to the application directory
+    stamps.emplace_back(QCoreApplication::applicationDirPath(), 0);
+
+    // Profile directories are not scanned recursively, so it is
+    // sufficient to check only modification time of the directory.
+    for (const QString& directory : directories)
+    {
+        QFileInfo directoryInfo(directory);
+        const qint64 modified = directoryInfo.isDir() ? directoryInfo.lastModified().toMSecsSinceEpoch() : 0;
+        stamps.emplace_back(directory, modified);
+    }
+
+    return stamps;
+}
+
+bool PDFCMSManager::loadExternalProfilesIndex(const DirectoryStamps& stamps, PDFColorProfileIdentifiers& profiles, bool& isUpToDate)
+{
+    isUpToDate = false;
+
+    QFile file(getExternalProfilesIndexFileName());
+    if (!file.open(QFile::ReadOnly))
+    {
+        return false;
+    }
+
+    QDataStream stream(&file);
+
+    quint32 version = 0;
+    stream >> version;
+    if (version != EXTERNAL_PROFILES_INDEX_VERSION)
+    {
+        return false;
+    }
+
+    DirectoryStamps indexStamps;
+    qint64 stampCount = 0;
+    stream >> stampCount;
+    for (qint64 i = 0; i < stampCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        QString directory;
+        qint64 modified = 0;
+        stream >> directory;
+        stream >> modified;
+        indexStamps.emplace_back(qMove(directory), modified);
+    }
+
+    PDFColorProfileIdentifiers indexProfiles;
+    qint64 profileCount = 0;
+    stream >> profileCount;
+    for (qint64 i = 0; i < profileCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        qint32 type = 0;
+        QString name;
+        QString id;
+        stream >> type;
+        stream >> name;
+        stream >> id;
+        indexProfiles.emplace_back(PDFColorProfileIdentifier::createFile(PDFColorProfileIdentifier::Type(type), qMove(name), qMove(id)));
+    }
+
+    if (stream.status() != QDataStream::Ok)
+    {
+        return false;
+    }
+
+    isUpToDate = indexStamps == stamps;
+    profiles = qMove(indexProfiles);
+    return true;
+}
+
+void PDFCMSManager::saveExternalProfilesIndex(const DirectoryStamps& stamps, const PDFColorProfileIdentifiers& profiles)
+{
+    QString fileName = getExternalProfilesIndexFileName();
+    QDir().mkpath(QFileInfo(fileName).path());
+
+    QSaveFile file(fileName);
+    if (file.open(QFile::WriteOnly))
+    {
+        QDataStream stream(&file);
+        stream << EXTERNAL_PROFILES_INDEX_VERSION;
+        stream << qint64(stamps.size());
+        for (const auto& stamp : stamps)
+        {
+            stream << stamp.first;
+            stream << stamp.second;
+        }
+
+        stream << qint64(profiles.size());
+        for (const PDFColorProfileIdentifier& profile : profiles)
+        {
+            stream << qint32(profile.type);
+            stream << profile.name;
+            stream << profile.id;
+        }
+
+        file.commit();
+    }
+}
+
 PDFColorProfileIdentifiers PDFCMSManager::getFilteredExternalProfiles(PDFColorProfileIdentifier::Type type) const
 {
     PDFColorProfileIdentifiers result;
@@ -1876,6 +2932,34 @@ PDFColor3 PDFCMS::getDefaultXYZWhitepoint()
     return PDFColor3{ PDFColorComponent(whitePoint->X), PDFColorComponent(whitePoint->Y), PDFColorComponent(whitePoint->Z) };
 }
 
+bool PDFCMS::isGenericDeviceColorConversion(ColorSpaceType colorSpaceType, RenderingIntent intent) const
+{
+    Q_UNUSED(colorSpaceType);
+    Q_UNUSED(intent);
+    return false;
+}
+
+PDFCMSColorCacheStatistics PDFCMS::getColorCacheStatistics() const
+{
+    return PDFCMSColorCacheStatistics();
+}
+
+void PDFCMS::prewarm(const PDFDocument* document) const
+{
+    Q_UNUSED(document);
+}
+
+void PDFCMS::collectMemoryUsage(PDFMemoryReport* report) const
+{
+    Q_UNUSED(report);
+}
+
+quint64 PDFCMS::createUniqueId()
+{
+    static std::atomic<quint64> s_lastUniqueId = 0;
+    return s_lastUniqueId.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
 PDFColorComponentMatrix_3x3 PDFChromaticAdaptationXYZ::createWhitepointChromaticAdaptation(const PDFColor3& targetWhitePoint,
                                                                                            const PDFColor3& sourceWhitePoint,
                                                                                            PDFCMSSettings::ColorAdaptationXYZ method)
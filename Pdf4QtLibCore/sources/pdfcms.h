@@ -28,11 +28,14 @@
 #include "pdfexception.h"
 #include "pdfutils.h"
 #include "pdfcolorconvertor.h"
+#include "pdfmemoryreport.h"
 
+#include <QFuture>
 #include <QRecursiveMutex>
 #include <QSharedPointer>
 
 #include <compare>
+#include <atomic>
 
 namespace pdf
 {
@@ -97,10 +100,17 @@ struct PDFCMSSettings
     double sigmoidSlopeFactor = 10.0;
 };
 
+/// Statistics of the cache of single color conversions
+struct PDFCMSColorCacheStatistics
+{
+    qint64 hits = 0;    ///< Count of colors taken from the cache
+    qint64 misses = 0;  ///< Count of colors, which were transformed by the color management system
+};
+
 /// Color management system base class. It contains functions to transform
 /// colors from various color system to device color system. If color management
 /// system can't handle color transform, it should return invalid color.
-class PDFCMS
+class PDFCMS : public PDFMemoryAccountable
 {
 public:
     explicit inline PDFCMS() = default;
@@ -263,8 +273,42 @@ public:
     /// it just transforms two float buffers from input color space to output color space.
     virtual bool transformColorSpace(const ColorSpaceTransformParams& params) const = 0;
 
+    /// Returns true, if colors in the device color space are converted to the output
+    /// device by the generic (simple) conversion, for example, when color profile of the
+    /// device color space is the same as the output profile. Callers can then convert
+    /// large buffers of such colors directly, without the color management system.
+    /// \param colorSpaceType Device color space (gray, RGB or CMYK)
+    /// \param intent Rendering intent
+    virtual bool isGenericDeviceColorConversion(ColorSpaceType colorSpaceType, RenderingIntent intent) const;
+
+    /// Returns statistics of the cache of single color conversions. Color management
+    /// systems, which don't cache converted colors, return empty statistics.
+    virtual PDFCMSColorCacheStatistics getColorCacheStatistics() const;
+
+    /// Creates color transforms, which will be probably needed to render the document
+    /// (device color spaces and ICC based color spaces of the first page), so they
+    /// are not created later by the rendering threads. Default implementation
+    /// does nothing.
+    /// \param document Document
+    virtual void prewarm(const PDFDocument* document) const;
+
+    /// Adds consumed memory of cached color transforms into the report.
+    /// Default implementation adds nothing.
+    /// \param report Report
+    virtual void collectMemoryUsage(PDFMemoryReport* report) const override;
+
     /// Get D50 white point for XYZ color space
     static PDFColor3 getDefaultXYZWhitepoint();
+
+    /// Returns identifier of the color management system, which is unique during the
+    /// lifetime of the application. Unlike the address of the object, it is never
+    /// reused, so caches of converted colors can use it as a key.
+    quint64 getUniqueId() const { return m_uniqueId; }
+
+private:
+    static quint64 createUniqueId();
+
+    quint64 m_uniqueId = createUniqueId();
 };
 
 using PDFCMSPointer = QSharedPointer<PDFCMS>;
@@ -288,6 +332,7 @@ public:
     virtual bool fillRGBBufferFromXYZ(const PDFColor3& whitePoint, const std::vector<float>& colors, RenderingIntent intent, unsigned char* outputBuffer, PDFRenderErrorReporter* reporter) const override;
     virtual bool fillRGBBufferFromICC(const std::vector<float>& colors, RenderingIntent renderingIntent, unsigned char* outputBuffer, const QByteArray& iccID, const QByteArray& iccData, PDFRenderErrorReporter* reporter) const override;
     virtual bool transformColorSpace(const ColorSpaceTransformParams& params) const override;
+    virtual bool isGenericDeviceColorConversion(ColorSpaceType colorSpaceType, RenderingIntent intent) const override;
     virtual PDFColorConvertor getColorConvertor() const override;
 
 private:
@@ -361,7 +406,7 @@ using PDFColorProfileIdentifiers = std::vector<PDFColorProfileIdentifier>;
 /// It also handles settings, and it's changes. Constant functions
 /// is save to call from multiple threads, this also holds for some
 /// non-constant functions - manager is protected by mutexes.
-class PDF4QTLIBCORESHARED_EXPORT PDFCMSManager : public QObject
+class PDF4QTLIBCORESHARED_EXPORT PDFCMSManager : public QObject, public PDFMemoryAccountable
 {
     Q_OBJECT
 
@@ -370,6 +415,7 @@ private:
 
 public:
     explicit PDFCMSManager(QObject* parent);
+    virtual ~PDFCMSManager() override;
 
     /// Finalizes cms manager. Call this function
     /// only at program exit. Frees all allocated
@@ -407,6 +453,20 @@ public:
     /// \param system System
     static QString getSystemName(PDFCMSSettings::System system);
 
+    /// Enables or disables asynchronous enumeration of external color profiles.
+    /// External profiles are taken from the persistent index, which is invalidated,
+    /// when modification time of some profile directory changes. If the index
+    /// must be rebuilt and asynchronous enumeration is enabled, profile directories
+    /// are scanned in the background, and signal \p colorManagementSystemChanged
+    /// is emitted, when scanning is finished. Until then, outdated index (if it
+    /// exists) is used. Otherwise, directories are scanned immediately.
+    /// \param asynchronous Enumerate profiles asynchronously
+    void setAsynchronousProfileEnumeration(bool asynchronous);
+
+    /// Adds consumed memory of the current color management system into the report
+    /// \param report Report
+    virtual void collectMemoryUsage(PDFMemoryReport* report) const override;
+
 signals:
     void colorManagementSystemChanged();
 
@@ -442,6 +502,34 @@ private:
     /// \param profileDirectory Directory with profiles
     PDFColorProfileIdentifiers getExternalColorProfiles(QString profileDirectory) const;
 
+    /// Modification times of profile directories, they are used to invalidate the index
+    using DirectoryStamps = std::vector<std::pair<QString, qint64>>;
+
+    static constexpr quint32 EXTERNAL_PROFILES_INDEX_VERSION = 1;
+
+    /// Returns list of directories containing external color profiles
+    QStringList getExternalProfileDirectories() const;
+
+    /// Scans directories and returns all external color profiles found in them
+    /// \param directories Directories with profiles
+    PDFColorProfileIdentifiers enumerateExternalProfiles(const QStringList& directories) const;
+
+    static QString getExternalProfilesIndexFileName();
+    static DirectoryStamps getDirectoryStamps(const QStringList& directories);
+
+    /// Loads index of external profiles from the file. If index doesn't exist, or it
+    /// can't be read, false is returned. If index exist, but it is outdated,
+    /// profiles are loaded, but \p isUpToDate is set to false.
+    /// \param stamps Current directory stamps
+    /// \param profiles Loaded profiles
+    /// \param isUpToDate Is index up to date?
+    static bool loadExternalProfilesIndex(const DirectoryStamps& stamps, PDFColorProfileIdentifiers& profiles, bool& isUpToDate);
+
+    /// Saves index of external profiles to the file
+    /// \param stamps Directory stamps
+    /// \param profiles External profiles
+    static void saveExternalProfilesIndex(const DirectoryStamps& stamps, const PDFColorProfileIdentifiers& profiles);
+
     PDFCMSSettings m_settings;
     const PDFDocument* m_document;
     PDFColorProfileIdentifiers m_outputIntentProfiles;
@@ -453,6 +541,12 @@ private:
     mutable PDFCachedItem<PDFColorProfileIdentifiers> m_RGBProfiles;
     mutable PDFCachedItem<PDFColorProfileIdentifiers> m_CMYKProfiles;
     mutable PDFCachedItem<PDFColorProfileIdentifiers> m_externalProfiles;
+
+    bool m_isAsynchronousProfileEnumeration = false;
+    std::atomic_bool m_cancelled = false;
+    mutable QFuture<void> m_externalProfilesFuture;
+    mutable DirectoryStamps m_externalProfilesIndexStamps;
+    mutable PDFColorProfileIdentifiers m_externalProfilesIndex;
 };
 
 /// Class providing chromatic adaptation of whitepoints
@@ -25,6 +25,7 @@
 #include "pdfutils.h"
 #include "pdfdbgheap.h"
 
+#include <array>
 #include <cmath>
 
 namespace pdf
@@ -185,6 +186,184 @@ QImage PDFColorConvertor::convert(QImage image) const
     return image;
 }
 
+namespace
+{
+
+/// Returns sum of maximal and minimal color component, which is
+/// twice the lightness of the color in HSL color space.
+inline int getLightnessSum(QRgb rgb)
+{
+    const int red = qRed(rgb);
+    const int green = qGreen(rgb);
+    const int blue = qBlue(rgb);
+    return qMax(red, qMax(green, blue)) + qMin(red, qMin(green, blue));
+}
+
+/// Converts each pixel of the 32-bit image by the function. Function is called
+/// with unpremultiplied color and returns new color, alpha of pixel is kept.
+/// Fully transparent pixels of premultiplied image are skipped.
+template<typename Function>
+void convertImagePixels(QImage& image, Function function)
+{
+    const bool isPremultiplied = image.format() == QImage::Format_ARGB32_Premultiplied;
+    const int width = image.width();
+    const int height = image.height();
+
+    for (int y = 0; y < height; ++y)
+    {
+        QRgb* scanline = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < width; ++x)
+        {
+            const QRgb pixel = scanline[x];
+            const int alpha = qAlpha(pixel);
+
+            if (!isPremultiplied || alpha == 255)
+            {
+                const QRgb convertedPixel = function(pixel);
+                scanline[x] = qRgba(qRed(convertedPixel), qGreen(convertedPixel), qBlue(convertedPixel), alpha);
+            }
+            else if (alpha > 0)
+            {
+                const QRgb convertedPixel = function(qUnpremultiply(pixel));
+                scanline[x] = qPremultiply(qRgba(qRed(convertedPixel), qGreen(convertedPixel), qBlue(convertedPixel), alpha));
+            }
+        }
+    }
+}
+
+}   // namespace
+
+void PDFColorConvertor::convertRenderedImage(QImage& image) const
+{
+    if (!isActive() || image.isNull())
+    {
+        return;
+    }
+
+    const QImage::Format format = image.format();
+    if (format != QImage::Format_ARGB32_Premultiplied && format != QImage::Format_ARGB32 && format != QImage::Format_RGB32)
+    {
+        image.convertTo(QImage::Format_ARGB32_Premultiplied);
+    }
+
+    const bool isPremultiplied = image.format() == QImage::Format_ARGB32_Premultiplied;
+    const int width = image.width();
+    const int height = image.height();
+
+    // Lookup tables are indexed by sum of maximal and minimal color component
+    constexpr size_t LIGHTNESS_TABLE_SIZE = 511;
+
+    switch (m_mode)
+    {
+        case Mode::Normal:
+            break;
+
+        case Mode::InvertedColors:
+        {
+            // Inversion is linear, premultiplied colors are inverted against alpha
+            for (int y = 0; y < height; ++y)
+            {
+                QRgb* scanline = reinterpret_cast<QRgb*>(image.scanLine(y));
+                for (int x = 0; x < width; ++x)
+                {
+                    const QRgb pixel = scanline[x];
+                    const int alpha = qAlpha(pixel);
+                    const int maximum = isPremultiplied ? alpha : 255;
+                    scanline[x] = qRgba(maximum - qRed(pixel), maximum - qGreen(pixel), maximum - qBlue(pixel), alpha);
+                }
+            }
+            break;
+        }
+
+        case Mode::Grayscale:
+        {
+            // Gray is weighted sum of components, so premultiplied colors can be converted directly
+            for (int y = 0; y < height; ++y)
+            {
+                QRgb* scanline = reinterpret_cast<QRgb*>(image.scanLine(y));
+                for (int x = 0; x < width; ++x)
+                {
+                    const QRgb pixel = scanline[x];
+                    const int gray = qGray(pixel);
+                    scanline[x] = qRgba(gray, gray, gray, qAlpha(pixel));
+                }
+            }
+            break;
+        }
+
+        case Mode::HighContrast:
+        {
+            // Lightness is adjusted by sigmoid function, hue and saturation are kept. In HSL
+            // color space, distance of components from lightness is proportional to chroma,
+            // so we only scale it by ratio of adjusted chroma and original chroma.
+            std::array<float, LIGHTNESS_TABLE_SIZE> lightnessTable = { };
+            std::array<float, LIGHTNESS_TABLE_SIZE> chromaRatioTable = { };
+            for (size_t i = 0; i < LIGHTNESS_TABLE_SIZE; ++i)
+            {
+                const float lightness = float(i) / float(LIGHTNESS_TABLE_SIZE - 1);
+                const float adjustedLightness = correctLigthnessBySigmoidFunction(lightness);
+                const float chroma = 1.0f - std::abs(2.0f * lightness - 1.0f);
+                const float adjustedChroma = 1.0f - std::abs(2.0f * adjustedLightness - 1.0f);
+                lightnessTable[i] = adjustedLightness * 255.0f;
+                chromaRatioTable[i] = (chroma > 0.0f) ? adjustedChroma / chroma : 0.0f;
+            }
+
+            convertImagePixels(image, [&lightnessTable, &chromaRatioTable](QRgb pixel)
+            {
+                const int lightnessSum = getLightnessSum(pixel);
+                const float lightness = lightnessSum * 0.5f;
+                const float adjustedLightness = lightnessTable[lightnessSum];
+                const float chromaRatio = chromaRatioTable[lightnessSum];
+
+                auto adjust = [lightness, adjustedLightness, chromaRatio](int component)
+                {
+                    return qBound(0, qRound(adjustedLightness + (component - lightness) * chromaRatio), 255);
+                };
+
+                return qRgb(adjust(qRed(pixel)), adjust(qGreen(pixel)), adjust(qBlue(pixel)));
+            });
+            break;
+        }
+
+        case Mode::Bitonal:
+        {
+            const int thresholdSum = 2 * m_bitonalThreshold;
+            convertImagePixels(image, [thresholdSum](QRgb pixel)
+            {
+                return (getLightnessSum(pixel) >= thresholdSum) ? qRgb(255, 255, 255) : qRgb(0, 0, 0);
+            });
+            break;
+        }
+
+        case Mode::CustomColors:
+        {
+            // Dark colors are mapped to foreground color, light colors to background color
+            std::array<QRgb, LIGHTNESS_TABLE_SIZE> colorTable = { };
+            const QRgb foreground = m_foregroundColor.rgb();
+            const QRgb background = m_backgroundColor.rgb();
+            for (size_t i = 0; i < LIGHTNESS_TABLE_SIZE; ++i)
+            {
+                const float lightness = float(i) / float(LIGHTNESS_TABLE_SIZE - 1);
+                auto interpolate = [lightness](int foregroundComponent, int backgroundComponent)
+                {
+                    return qRound(foregroundComponent * (1.0f - lightness) + backgroundComponent * lightness);
+                };
+
+                colorTable[i] = qRgb(interpolate(qRed(foreground), qRed(background)),
+                                     interpolate(qGreen(foreground), qGreen(background)),
+                                     interpolate(qBlue(foreground), qBlue(background)));
+            }
+
+            convertImagePixels(image, [&colorTable](QRgb pixel) { return colorTable[getLightnessSum(pixel)]; });
+            break;
+        }
+
+        default:
+            Q_ASSERT(false);
+            break;
+    }
+}
+
 void PDFColorConvertor::setHighContrastBrightnessFactor(float factor)
 {
     m_sigmoidParamC = factor;
@@ -79,6 +79,16 @@ public:
     /// \return The converted image
     QImage convert(QImage image) const;
 
+    /// Converts colors of the rendered page image in place, based on the current mode.
+    /// Whole image is treated as a page, so in custom colors mode, dark areas become
+    /// foreground color and light areas become background color, and bitonal mode
+    /// uses bitonal threshold. Image is processed scanline by scanline using lookup
+    /// tables, so it is a lot faster than conversion of all pens, brushes and images
+    /// of the page. Image is converted to premultiplied ARGB32 format, if it has
+    /// format other than 32-bit RGB.
+    /// \param image Rendered page image
+    void convertRenderedImage(QImage& image) const;
+
     /// Sets the correction factor for enhancing contrast in high contrast mode.
     /// This factor determines the level of contrast enhancement:
     /// - For subtle enhancement, set the factor between 5 and 10.
@@ -38,6 +38,336 @@
 namespace pdf
 {
 
+namespace
+{
+
+/// Returns pointer to the row of the image, if the row is fully contained
+/// in the image data, otherwise nullptr is returned.
+/// \param imageData Image data
+/// \param rowIndex Row index
+const unsigned char* getCompleteImageRow(const PDFImageData& imageData, unsigned int rowIndex)
+{
+    const size_t rowOffset = size_t(rowIndex) * imageData.getStride();
+    const size_t rowSize = (size_t(imageData.getWidth()) * imageData.getComponents() * imageData.getBitsPerComponent() + 7) / 8;
+
+    if (rowOffset + rowSize <= size_t(imageData.getData().size()))
+    {
+        return imageData.getRow(rowIndex);
+    }
+
+    return nullptr;
+}
+
+/// Creates table of normalized colors for all sample values of each color component
+/// of the image, decode array is applied. For images with more than 8 bits per component,
+/// empty table is returned.
+/// \param imageData Image data
+std::vector<float> createImageSampleTable(const PDFImageData& imageData)
+{
+    std::vector<float> table;
+
+    const unsigned int bitsPerComponent = imageData.getBitsPerComponent();
+    if (bitsPerComponent > 8)
+    {
+        return table;
+    }
+
+    const unsigned int componentCount = imageData.getComponents();
+    const unsigned int sampleCount = 1u << bitsPerComponent;
+    const std::vector<PDFReal>& decode = imageData.getDecode();
+    const double max = sampleCount - 1;
+    const double coefficient = 1.0 / max;
+
+    table.resize(componentCount * sampleCount, 0.0f);
+    for (unsigned int k = 0; k < componentCount; ++k)
+    {
+        for (unsigned int value = 0; value < sampleCount; ++value)
+        {
+            if (!decode.empty())
+            {
+                table[k * sampleCount + value] = interpolate(value, 0.0, max, decode[2 * k], decode[2 * k + 1]);
+            }
+            else
+            {
+                table[k * sampleCount + value] = value * coefficient;
+            }
+        }
+    }
+
+    return table;
+}
+
+/// Reads normalized colors of the image row, decode array is applied.
+/// \param imageData Image data
+/// \param sampleTable Table created by \p createImageSampleTable
+/// \param rowIndex Row index
+/// \param colors Output colors, must have size width * components
+void readImageRowColors(const PDFImageData& imageData, const std::vector<float>& sampleTable, unsigned int rowIndex, std::vector<float>& colors)
+{
+    const unsigned int componentCount = imageData.getComponents();
+    const unsigned int pixelCount = imageData.getWidth();
+    auto itColor = colors.begin();
+
+    if (!sampleTable.empty())
+    {
+        const size_t sampleCount = size_t(1) << imageData.getBitsPerComponent();
+        const unsigned char* row = imageData.getBitsPerComponent() == 8 ? getCompleteImageRow(imageData, rowIndex) : nullptr;
+
+        if (row)
+        {
+            for (unsigned int j = 0; j < pixelCount; ++j)
+            {
+                for (unsigned int k = 0; k < componentCount; ++k)
+                {
+                    *itColor++ = sampleTable[k * sampleCount + *row++];
+                }
+            }
+        }
+        else
+        {
+            PDFBitReader reader(&imageData.getData(), imageData.getBitsPerComponent());
+            reader.seek(rowIndex * imageData.getStride());
+
+            for (unsigned int j = 0; j < pixelCount; ++j)
+            {
+                for (unsigned int k = 0; k < componentCount; ++k)
+                {
+                    *itColor++ = sampleTable[k * sampleCount + reader.read()];
+                }
+            }
+        }
+
+        return;
+    }
+
+    PDFBitReader reader(&imageData.getData(), imageData.getBitsPerComponent());
+    reader.seek(rowIndex * imageData.getStride());
+
+    const std::vector<PDFReal>& decode = imageData.getDecode();
+    const double max = reader.max();
+    const double coefficient = 1.0 / max;
+
+    for (unsigned int j = 0; j < pixelCount; ++j)
+    {
+        for (unsigned int k = 0; k < componentCount; ++k)
+        {
+            PDFReal value = reader.read();
+
+            // Interpolate value, if it is not empty
+            if (!decode.empty())
+            {
+                *itColor++ = interpolate(value, 0.0, max, decode[2 * k], decode[2 * k + 1]);
+            }
+            else
+            {
+                *itColor++ = value * coefficient;
+            }
+        }
+    }
+}
+
+/// Returns true, if samples of the image can be converted to RGB directly
+/// by \p fillRGBBufferFromDeviceSamples, without color management system.
+/// \param colorSpace Color space of the image
+/// \param imageData Image data
+/// \param cms Color management system
+/// \param intent Rendering intent
+bool isDirectDeviceSampleConversion(const PDFAbstractColorSpace* colorSpace, const PDFImageData& imageData, const PDFCMS* cms, RenderingIntent intent)
+{
+    if (imageData.getBitsPerComponent() != 8 && imageData.getBitsPerComponent() != 16)
+    {
+        return false;
+    }
+
+    const std::vector<PDFReal>& decode = imageData.getDecode();
+    for (size_t i = 0; i < decode.size(); ++i)
+    {
+        if (decode[i] != ((i % 2 == 0) ? 0.0 : 1.0))
+        {
+            return false;
+        }
+    }
+
+    switch (colorSpace->getColorSpace())
+    {
+        case PDFAbstractColorSpace::ColorSpace::DeviceGray:
+            return cms->isGenericDeviceColorConversion(PDFCMS::DeviceGray, intent);
+
+        case PDFAbstractColorSpace::ColorSpace::DeviceRGB:
+            return cms->isGenericDeviceColorConversion(PDFCMS::DeviceRGB, intent);
+
+        case PDFAbstractColorSpace::ColorSpace::DeviceCMYK:
+            return cms->isGenericDeviceColorConversion(PDFCMS::DeviceCMYK, intent);
+
+        default:
+            break;
+    }
+
+    return false;
+}
+
+/// Computes a * b / 255 with correct rounding, for values in range 0-255
+inline unsigned int multiply255(unsigned int a, unsigned int b)
+{
+    const unsigned int value = a * b + 128;
+    return (value + (value >> 8)) >> 8;
+}
+
+/// Reads 8-bit sample from buffer of 8-bit or 16-bit (big endian) samples,
+/// 16-bit samples are rounded to the nearest 8-bit value.
+template<unsigned int BitsPerComponent>
+inline unsigned int readSample8(const unsigned char* samples, size_t index)
+{
+    if constexpr (BitsPerComponent == 8)
+    {
+        return samples[index];
+    }
+    else
+    {
+        static_assert(BitsPerComponent == 16);
+        const unsigned int value = (unsigned int(samples[2 * index]) << 8) | samples[2 * index + 1];
+        return (value * 255 + 32895) >> 16;
+    }
+}
+
+/// Bulk conversion kernels of device color spaces. Loops do not have any
+/// dependencies between pixels, so they are vectorized by the compiler.
+template<unsigned int BitsPerComponent>
+void fillRGBBufferFromDeviceSamplesImpl(PDFAbstractColorSpace::ColorSpace colorSpace,
+                                        const unsigned char* samples,
+                                        size_t pixelCount,
+                                        unsigned char* outputBuffer)
+{
+    switch (colorSpace)
+    {
+        case PDFAbstractColorSpace::ColorSpace::DeviceGray:
+        {
+            for (size_t i = 0; i < pixelCount; ++i)
+            {
+                const unsigned char gray = readSample8<BitsPerComponent>(samples, i);
+                outputBuffer[3 * i + 0] = gray;
+                outputBuffer[3 * i + 1] = gray;
+                outputBuffer[3 * i + 2] = gray;
+            }
+            break;
+        }
+
+        case PDFAbstractColorSpace::ColorSpace::DeviceRGB:
+        {
+            if constexpr (BitsPerComponent == 8)
+            {
+                std::copy(samples, samples + 3 * pixelCount, outputBuffer);
+            }
+            else
+            {
+                for (size_t i = 0; i < 3 * pixelCount; ++i)
+                {
+                    outputBuffer[i] = readSample8<BitsPerComponent>(samples, i);
+                }
+            }
+            break;
+        }
+
+        case PDFAbstractColorSpace::ColorSpace::DeviceCMYK:
+        {
+            for (size_t i = 0; i < pixelCount; ++i)
+            {
+                const unsigned int white = 255 - readSample8<BitsPerComponent>(samples, 4 * i + 3);
+                outputBuffer[3 * i + 0] = multiply255(255 - readSample8<BitsPerComponent>(samples, 4 * i + 0), white);
+                outputBuffer[3 * i + 1] = multiply255(255 - readSample8<BitsPerComponent>(samples, 4 * i + 1), white);
+                outputBuffer[3 * i + 2] = multiply255(255 - readSample8<BitsPerComponent>(samples, 4 * i + 2), white);
+            }
+            break;
+        }
+
+        default:
+            Q_ASSERT(false);
+            break;
+    }
+}
+
+/// Converts 8-bit or 16-bit samples of device color space to 8-bit RGB buffer
+/// using generic conversion. \sa isDirectDeviceSampleConversion
+/// \param colorSpace Device color space (gray, RGB or CMYK)
+/// \param samples Image samples
+/// \param bitsPerComponent Bits per component (8 or 16)
+/// \param pixelCount Pixel count
+/// \param outputBuffer 8-bit RGB output buffer
+void fillRGBBufferFromDeviceSamples(PDFAbstractColorSpace::ColorSpace colorSpace,
+                                    const unsigned char* samples,
+                                    unsigned int bitsPerComponent,
+                                    size_t pixelCount,
+                                    unsigned char* outputBuffer)
+{
+    if (bitsPerComponent == 8)
+    {
+        fillRGBBufferFromDeviceSamplesImpl<8>(colorSpace, samples, pixelCount, outputBuffer);
+    }
+    else
+    {
+        Q_ASSERT(bitsPerComponent == 16);
+        fillRGBBufferFromDeviceSamplesImpl<16>(colorSpace, samples, pixelCount, outputBuffer);
+    }
+}
+
+/// Evaluates tint transform for multiple colors at once and stores output colors
+/// into the result buffer. If tint transform can't be evaluated, result is unchanged.
+/// \param tintTransform Tint transform
+/// \param inputColors Input colors, stored color by color
+/// \param inputCount Number of colorants
+/// \param indices Indices of the colors in the result buffer
+/// \param outputCount Number of components of the alternate color space
+/// \param result Result buffer (output colors stored color by color)
+void applyTintTransformMany(const PDFFunction* tintTransform,
+                            const std::vector<PDFReal>& inputColors,
+                            size_t inputCount,
+                            const std::vector<size_t>& indices,
+                            size_t outputCount,
+                            std::vector<PDFColorComponent>& result)
+{
+    const size_t count = indices.size();
+    if (count == 0 || tintTransform->getInputVariableCount() != inputCount || tintTransform->getOutputVariableCount() != outputCount)
+    {
+        return;
+    }
+
+    // Transpose inputs to the structure of arrays
+    std::vector<PDFReal> inputValues(count * inputCount, 0.0);
+    std::vector<PDFReal> outputValues(count * outputCount, 0.0);
+    std::vector<PDFFunction::const_iterator> inputs(inputCount, nullptr);
+    std::vector<PDFFunction::iterator> outputs(outputCount, nullptr);
+
+    for (size_t i = 0; i < inputCount; ++i)
+    {
+        inputs[i] = inputValues.data() + i * count;
+        for (size_t k = 0; k < count; ++k)
+        {
+            inputValues[i * count + k] = inputColors[k * inputCount + i];
+        }
+    }
+
+    for (size_t j = 0; j < outputCount; ++j)
+    {
+        outputs[j] = outputValues.data() + j * count;
+    }
+
+    if (!tintTransform->applyMany(inputs.data(), outputs.data(), count))
+    {
+        return;
+    }
+
+    for (size_t k = 0; k < count; ++k)
+    {
+        PDFColorComponent* outputColor = result.data() + indices[k] * outputCount;
+        for (size_t j = 0; j < outputCount; ++j)
+        {
+            outputColor[j] = static_cast<PDFColorComponent>(outputs[j][k]);
+        }
+    }
+}
+
+} // namespace
+
 PDFColorComponentMatrix_3x3 getInverseMatrix(const PDFColorComponentMatrix_3x3& matrix)
 {
     const PDFColorComponent a_11 = matrix.getValue(0, 0);
@@ -239,6 +569,9 @@ QImage PDFAbstractColorSpace::getImage(const PDFImageData& imageData,
                 QMutex exceptionMutex;
                 std::optional<PDFException> exception;
 
+                const bool isDirectConversion = isDirectDeviceSampleConversion(this, imageData, cms, intent);
+                const std::vector<float> sampleTable = createImageSampleTable(imageData);
+
                 auto transformPixelLine = [&](unsigned int i)
                 {
                     // Is operation being cancelled?
@@ -249,39 +582,16 @@ QImage PDFAbstractColorSpace::getImage(const PDFImageData& imageData,
 
                     try
                     {
-                        PDFBitReader reader(&imageData.getData(), imageData.getBitsPerComponent());
-                        reader.seek(i * imageData.getStride());
-
-                        const double max = reader.max();
-                        const double coefficient = 1.0 / max;
                         unsigned char* outputLine = image.scanLine(i);
 
-                        std::vector<float> inputColors(imageWidth * componentCount, 0.0f);
-                        auto itInputColor = inputColors.begin();
-
-                        if (!decode.empty())
-                        {
-                            // Interpolate value
-                            for (unsigned int j = 0; j < imageData.getWidth(); ++j)
-                            {
-                                for (unsigned int k = 0; k < componentCount; ++k)
-                                {
-                                    PDFReal value = reader.read();
-                                    *itInputColor++ = interpolate(value, 0.0, max, decode[2 * k], decode[2 * k + 1]);
-                                }
-                            }
-                        }
-                        else
+                        if (const unsigned char* row = isDirectConversion ? getCompleteImageRow(imageData, i) : nullptr)
                         {
-                            // Just read all values and multiply them with coefficient
-                            const unsigned int pixelCount = imageData.getWidth() * componentCount;
-                            for (unsigned int j = 0; j < pixelCount; ++j)
-                            {
-                                PDFReal value = reader.read();
-                                *itInputColor++ = value * coefficient;
-                            }
+                            fillRGBBufferFromDeviceSamples(getColorSpace(), row, imageData.getBitsPerComponent(), imageWidth, outputLine);
+                            return;
                         }
 
+                        std::vector<float> inputColors(imageWidth * componentCount, 0.0f);
+                        readImageRowColors(imageData, sampleTable, i, inputColors);
                         fillRGBBuffer(inputColors, outputLine, intent, cms, reporter);
                     }
                     catch (const PDFException &lineException)
@@ -332,6 +642,9 @@ QImage PDFAbstractColorSpace::getImage(const PDFImageData& imageData,
                 QMutex exceptionMutex;
                 std::optional<PDFException> exception;
 
+                const bool isDirectConversion = isDirectDeviceSampleConversion(this, imageData, cms, intent);
+                const std::vector<float> sampleTable = createImageSampleTable(imageData);
+
                 auto transformPixelLine = [&](unsigned int i)
                 {
                     // Is operation being cancelled?
@@ -342,36 +655,19 @@ QImage PDFAbstractColorSpace::getImage(const PDFImageData& imageData,
 
                     try
                     {
-                        PDFBitReader reader(&imageData.getData(), imageData.getBitsPerComponent());
-                        reader.seek(i * imageData.getStride());
-
-                        const double max = reader.max();
-                        const double coefficient = 1.0 / max;
                         unsigned char* outputLine = image.scanLine(i);
-
-                        std::vector<float> inputColors(imageWidth * componentCount, 0.0f);
                         std::vector<unsigned char> outputColors(imageWidth * 3, 0);
 
-                        auto itInputColor = inputColors.begin();
-                        for (unsigned int j = 0; j < imageData.getWidth(); ++j)
+                        if (const unsigned char* row = isDirectConversion ? getCompleteImageRow(imageData, i) : nullptr)
                         {
-                            for (unsigned int k = 0; k < componentCount; ++k)
-                            {
-                                PDFReal value = reader.read();
-
-                                // Interpolate value, if it is not empty
-                                if (!decode.empty())
-                                {
-                                    *itInputColor++ = interpolate(value, 0.0, max, decode[2 * k], decode[2 * k + 1]);
-                                }
-                                else
-                                {
-                                    *itInputColor++ = value * coefficient;
-                                }
-                            }
+                            fillRGBBufferFromDeviceSamples(getColorSpace(), row, imageData.getBitsPerComponent(), imageWidth, outputColors.data());
+                        }
+                        else
+                        {
+                            std::vector<float> inputColors(imageWidth * componentCount, 0.0f);
+                            readImageRowColors(imageData, sampleTable, i, inputColors);
+                            fillRGBBuffer(inputColors, outputColors.data(), intent, cms, reporter);
                         }
-
-                        fillRGBBuffer(inputColors, outputColors.data(), intent, cms, reporter);
 
                         const unsigned char* transformedLine = outputColors.data();
                         for (unsigned int ii = 0; ii < imageWidth; ++ii)
@@ -1927,6 +2223,8 @@ QImage PDFIndexedColorSpace::getImage(const PDFImageData& imageData,
                 PDFColor color;
                 color.resize(1);
 
+                const std::vector<QRgb> colorTable = createImageColorTable(imageData, cms, intent, reporter);
+
                 for (unsigned int i = 0, rowCount = imageData.getHeight(); i < rowCount; ++i)
                 {
                     // Is operation being cancelled?
@@ -1941,10 +2239,17 @@ QImage PDFIndexedColorSpace::getImage(const PDFImageData& imageData,
                     for (unsigned int j = 0; j < imageData.getWidth(); ++j)
                     {
                         PDFBitReader::Value index = reader.read();
-                        color[0] = index;
 
-                        QColor transformedColor = getColor(color, cms, intent, reporter, false);
-                        QRgb rgb = transformedColor.rgb();
+                        QRgb rgb = 0;
+                        if (!colorTable.empty())
+                        {
+                            rgb = colorTable[index];
+                        }
+                        else
+                        {
+                            color[0] = index;
+                            rgb = getColor(color, cms, intent, reporter, false).rgb();
+                        }
 
                         *outputLine++ = qRed(rgb);
                         *outputLine++ = qGreen(rgb);
@@ -1973,6 +2278,8 @@ QImage PDFIndexedColorSpace::getImage(const PDFImageData& imageData,
                 PDFColor color;
                 color.resize(1);
 
+                const std::vector<QRgb> colorTable = createImageColorTable(imageData, cms, intent, reporter);
+
                 QImage alphaMask = createAlphaMask(softMask);
                 QSize targetSize = getLargerSizeByArea(alphaMask.size(), image.size());
 
@@ -1990,10 +2297,17 @@ QImage PDFIndexedColorSpace::getImage(const PDFImageData& imageData,
                     for (unsigned int j = 0; j < imageData.getWidth(); ++j)
                     {
                         PDFBitReader::Value index = reader.read();
-                        color[0] = index;
 
-                        QColor transformedColor = getColor(color, cms, intent, reporter, false);
-                        QRgb rgb = transformedColor.rgb();
+                        QRgb rgb = 0;
+                        if (!colorTable.empty())
+                        {
+                            rgb = colorTable[index];
+                        }
+                        else
+                        {
+                            color[0] = index;
+                            rgb = getColor(color, cms, intent, reporter, false).rgb();
+                        }
 
                         *outputLine++ = qRed(rgb);
                         *outputLine++ = qGreen(rgb);
@@ -2100,6 +2414,34 @@ QImage PDFIndexedColorSpace::getImage(const PDFImageData& imageData,
     return QImage();
 }
 
+std::vector<QRgb> PDFIndexedColorSpace::createImageColorTable(const PDFImageData& imageData,
+                                                              const PDFCMS* cms,
+                                                              RenderingIntent intent,
+                                                              PDFRenderErrorReporter* reporter) const
+{
+    std::vector<QRgb> colorTable;
+
+    const unsigned int bitsPerComponent = imageData.getBitsPerComponent();
+    if (bitsPerComponent > 8)
+    {
+        return colorTable;
+    }
+
+    const unsigned int sampleCount = 1u << bitsPerComponent;
+    colorTable.reserve(sampleCount);
+
+    PDFColor color;
+    color.resize(1);
+
+    for (unsigned int index = 0; index < sampleCount; ++index)
+    {
+        color[0] = index;
+        colorTable.push_back(getColor(color, cms, intent, reporter, false).rgb());
+    }
+
+    return colorTable;
+}
+
 PDFColorSpacePointer PDFIndexedColorSpace::createIndexedColorSpace(const PDFDictionary* colorSpaceDictionary,
                                                                    const PDFDocument* document,
                                                                    const PDFArray* array,
@@ -2189,10 +2531,243 @@ const QByteArray& PDFIndexedColorSpace::getColors() const
     return m_colors;
 }
 
+PDFTintTransformLookupTable::PDFTintTransformLookupTable(PDFFunctionPtr tintTransform, size_t inputCount, size_t outputCount) :
+    m_tintTransform(qMove(tintTransform)),
+    m_inputCount(inputCount),
+    m_outputCount(outputCount)
+{
+
+}
+
+bool PDFTintTransformLookupTable::apply(const PDFReal* x, PDFReal* y) const
+{
+    if (!m_tintTransform || m_inputCount == 0 || m_inputCount > MAX_INPUT_COUNT || m_outputCount == 0)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < m_inputCount; ++i)
+    {
+        if (!(x[i] >= 0.0 && x[i] <= 1.0))
+        {
+            return false;
+        }
+    }
+
+    if (!m_ready.load(std::memory_order_acquire))
+    {
+        // Create lookup table, if tint transform is evaluated many times
+        const uint32_t threshold = getEvaluationThreshold();
+        if (m_evaluationCount.load(std::memory_order_relaxed) < threshold &&
+            m_evaluationCount.fetch_add(1, std::memory_order_relaxed) + 1 == threshold)
+        {
+            build();
+        }
+
+        if (!m_ready.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+    }
+
+    interpolate(x, y);
+    return true;
+}
+
+size_t PDFTintTransformLookupTable::getGridSize() const
+{
+    switch (m_inputCount)
+    {
+        case 1:
+            return 256;
+        case 2:
+            return 33;
+        case 3:
+            return 17;
+        default:
+            return 9;
+    }
+}
+
+uint32_t PDFTintTransformLookupTable::getEvaluationThreshold() const
+{
+    // Tint transform is evaluated at samples and at the centers of the cells
+    // during creation of the lookup table. We create the table after the tint
+    // transform was evaluated twice as many times.
+    const size_t gridSize = getGridSize();
+    size_t sampleCount = 1;
+    size_t cellCount = 1;
+    for (size_t i = 0; i < m_inputCount; ++i)
+    {
+        sampleCount *= gridSize;
+        cellCount *= gridSize - 1;
+    }
+
+    return static_cast<uint32_t>(2 * (sampleCount + cellCount));
+}
+
+void PDFTintTransformLookupTable::interpolate(const PDFReal* x, PDFReal* y) const
+{
+    const size_t gridSize = getGridSize();
+
+    std::array<size_t, MAX_INPUT_COUNT> indices = { };
+    std::array<PDFReal, MAX_INPUT_COUNT> fractions = { };
+    for (size_t i = 0; i < m_inputCount; ++i)
+    {
+        const PDFReal position = x[i] * (gridSize - 1);
+        indices[i] = qMin(static_cast<size_t>(position), gridSize - 2);
+        fractions[i] = position - indices[i];
+    }
+
+    std::fill(y, y + m_outputCount, 0.0);
+
+    // Sum the corners of the cell, weighted by multilinear weights
+    const size_t cornerCount = size_t(1) << m_inputCount;
+    for (size_t corner = 0; corner < cornerCount; ++corner)
+    {
+        PDFReal weight = 1.0;
+        size_t offset = 0;
+        size_t stride = 1;
+
+        for (size_t i = 0; i < m_inputCount; ++i)
+        {
+            const bool isUpper = corner & (size_t(1) << i);
+            weight *= isUpper ? fractions[i] : 1.0 - fractions[i];
+            offset += (indices[i] + (isUpper ? 1 : 0)) * stride;
+            stride *= gridSize;
+        }
+
+        if (weight == 0.0)
+        {
+            continue;
+        }
+
+        const PDFReal* values = m_table.data() + offset * m_outputCount;
+        for (size_t i = 0; i < m_outputCount; ++i)
+        {
+            y[i] += weight * values[i];
+        }
+    }
+}
+
+void PDFTintTransformLookupTable::build() const
+{
+    const size_t gridSize = getGridSize();
+
+    size_t sampleCount = 1;
+    size_t cellCount = 1;
+    for (size_t i = 0; i < m_inputCount; ++i)
+    {
+        sampleCount *= gridSize;
+        cellCount *= gridSize - 1;
+    }
+
+    // Returns input values at given position, index is decomposed to the
+    // grid coordinates, first coordinate changes fastest.
+    std::array<PDFReal, MAX_INPUT_COUNT> x = { };
+    auto setInput = [&](size_t index, size_t size, PDFReal offset)
+    {
+        for (size_t i = 0; i < m_inputCount; ++i)
+        {
+            x[i] = qBound<PDFReal>(0.0, (index % size + offset) / (gridSize - 1), 1.0);
+            index /= size;
+        }
+    };
+
+    // Evaluates the tint transform at all points of the grid at once. Input and
+    // output values are stored as structure of arrays, output values are then
+    // stored into the result as array of structures (tuple by tuple).
+    auto evaluateGrid = [&](size_t count, size_t size, PDFReal offset, std::vector<PDFReal>& result)
+    {
+        if (m_tintTransform->getInputVariableCount() != m_inputCount || m_tintTransform->getOutputVariableCount() != m_outputCount)
+        {
+            return false;
+        }
+
+        std::vector<PDFReal> inputValues(count * m_inputCount, 0.0);
+        std::vector<PDFReal> outputValues(count * m_outputCount, 0.0);
+        std::array<PDFFunction::const_iterator, MAX_INPUT_COUNT> inputs = { };
+        std::vector<PDFFunction::iterator> outputs(m_outputCount, nullptr);
+
+        for (size_t i = 0; i < m_inputCount; ++i)
+        {
+            inputs[i] = inputValues.data() + i * count;
+        }
+
+        for (size_t j = 0; j < m_outputCount; ++j)
+        {
+            outputs[j] = outputValues.data() + j * count;
+        }
+
+        for (size_t index = 0; index < count; ++index)
+        {
+            setInput(index, size, offset);
+            for (size_t i = 0; i < m_inputCount; ++i)
+            {
+                inputValues[i * count + index] = x[i];
+            }
+        }
+
+        if (!m_tintTransform->applyMany(inputs.data(), outputs.data(), count))
+        {
+            return false;
+        }
+
+        result.resize(count * m_outputCount);
+        for (size_t index = 0; index < count; ++index)
+        {
+            for (size_t j = 0; j < m_outputCount; ++j)
+            {
+                result[index * m_outputCount + j] = outputs[j][index];
+            }
+        }
+
+        return true;
+    };
+
+    // Sample the tint transform
+    std::vector<PDFReal> table;
+    if (!evaluateGrid(sampleCount, gridSize, 0.0, table))
+    {
+        return;
+    }
+
+    m_table = std::move(table);
+
+    // Verify, that interpolated values in the centers of the cells are within the tolerance
+    std::vector<PDFReal> exactValues;
+    if (!evaluateGrid(cellCount, gridSize - 1, 0.5, exactValues))
+    {
+        m_table.clear();
+        return;
+    }
+
+    std::vector<PDFReal> interpolated(m_outputCount, 0.0);
+    for (size_t cell = 0; cell < cellCount; ++cell)
+    {
+        setInput(cell, gridSize - 1, 0.5);
+        const PDFReal* exact = exactValues.data() + cell * m_outputCount;
+
+        interpolate(x.data(), interpolated.data());
+        for (size_t i = 0; i < m_outputCount; ++i)
+        {
+            const PDFReal tolerance = TOLERANCE * qMax<PDFReal>(1.0, qAbs(exact[i]));
+            if (!(qAbs(exact[i] - interpolated[i]) <= tolerance))
+            {
+                m_table.clear();
+                return;
+            }
+        }
+    }
+
+    m_ready.store(true, std::memory_order_release);
+}
+
 PDFSeparationColorSpace::PDFSeparationColorSpace(QByteArray&& colorName, PDFColorSpacePointer alternateColorSpace, PDFFunctionPtr tintTransform) :
     m_colorName(qMove(colorName)),
     m_alternateColorSpace(qMove(alternateColorSpace)),
     m_tintTransform(qMove(tintTransform)),
+    m_tintTransformLookupTable(m_tintTransform, 1, m_alternateColorSpace ? m_alternateColorSpace->getColorComponentCount() : 0),
     m_isNone(m_colorName == "None"),
     m_isAll(m_colorName == "All")
 {
@@ -2257,7 +2832,11 @@ QColor PDFSeparationColorSpace::getColor(const PDFColor& color, const PDFCMS* cm
     // Output values
     std::vector<double> outputColor;
     outputColor.resize(m_alternateColorSpace->getColorComponentCount(), 0.0);
-    PDFFunction::FunctionResult result = m_tintTransform->apply(&tint, &tint + 1, outputColor.data(), outputColor.data() + outputColor.size());
+    PDFFunction::FunctionResult result = true;
+    if (!m_tintTransformLookupTable.apply(&tint, outputColor.data()))
+    {
+        result = m_tintTransform->apply(&tint, &tint + 1, outputColor.data(), outputColor.data() + outputColor.size());
+    }
 
     if (result)
     {
@@ -2285,6 +2864,10 @@ std::vector<PDFColorComponent> PDFSeparationColorSpace::transformColorsToBaseCol
     std::vector<double> outputColor;
     outputColor.resize(colorComponentCount, 0.0);
 
+    // Tints, which can't be interpolated from the lookup table, are evaluated at once
+    std::vector<PDFReal> evaluatedTints;
+    std::vector<size_t> evaluatedIndices;
+
     auto outputIt = result.begin();
     for (PDFColorComponent input : buffer)
     {
@@ -2300,14 +2883,22 @@ std::vector<PDFColorComponent> PDFSeparationColorSpace::transformColorsToBaseCol
         }
         else
         {
-            m_tintTransform->apply(&tint, &tint + 1, outputColor.data(), outputColor.data() + outputColor.size());
-            std::copy(outputColor.cbegin(), outputColor.cend(), outputIt);
+            if (m_tintTransformLookupTable.apply(&tint, outputColor.data()))
+            {
+                std::copy(outputColor.cbegin(), outputColor.cend(), outputIt);
+            }
+            else
+            {
+                evaluatedTints.push_back(tint);
+                evaluatedIndices.push_back(std::distance(result.begin(), outputIt) / colorComponentCount);
+            }
         }
 
         outputIt = std::next(outputIt, colorComponentCount);
     }
     Q_ASSERT(outputIt == result.cend());
 
+    applyTintTransformMany(m_tintTransform.get(), evaluatedTints, 1, evaluatedIndices, colorComponentCount, result);
     return result;
 }
 
@@ -2409,6 +3000,7 @@ PDFDeviceNColorSpace::PDFDeviceNColorSpace(PDFDeviceNColorSpace::Type type,
     m_alternateColorSpace(qMove(alternateColorSpace)),
     m_processColorSpace(qMove(processColorSpace)),
     m_tintTransform(qMove(tintTransform)),
+    m_tintTransformLookupTable(m_tintTransform, m_colorants.size(), m_alternateColorSpace ? m_alternateColorSpace->getColorComponentCount() : 0),
     m_colorantsPrintingOrder(qMove(colorantsPrintingOrder)),
     m_processColorSpaceComponents(qMove(processColorSpaceComponents)),
     m_isNone(false)
@@ -2492,7 +3084,11 @@ QColor PDFDeviceNColorSpace::getColor(const PDFColor& color, const PDFCMS* cms,
     // Output values
     std::vector<double> outputColor;
     outputColor.resize(m_alternateColorSpace->getColorComponentCount(), 0.0);
-    PDFFunction::FunctionResult result = m_tintTransform->apply(inputColor.data(), inputColor.data() + inputColor.size(), outputColor.data(), outputColor.data() + outputColor.size());
+    PDFFunction::FunctionResult result = true;
+    if (inputColor.size() != getColorComponentCount() || !m_tintTransformLookupTable.apply(inputColor.data(), outputColor.data()))
+    {
+        result = m_tintTransform->apply(inputColor.data(), inputColor.data() + inputColor.size(), outputColor.data(), outputColor.data() + outputColor.size());
+    }
 
     if (result)
     {
@@ -2526,15 +3122,28 @@ std::vector<PDFColorComponent> PDFDeviceNColorSpace::transformColorsToBaseColorS
         std::vector<double> inputColor(colorantCount, 0.0);
         std::vector<double> outputColor(alternateColorSpaceComponentCount, 0.0);
 
+        // Colors, which can't be interpolated from the lookup table, are evaluated at once
+        std::vector<PDFReal> evaluatedColors;
+        std::vector<size_t> evaluatedIndices;
+
         auto outputIt = result.begin();
         for (auto it = buffer.begin(); it != buffer.end(); it = std::next(it, colorantCount))
         {
             std::copy(it, it + colorantCount, inputColor.begin());
-            m_tintTransform->apply(inputColor.data(), inputColor.data() + inputColor.size(), outputColor.data(), outputColor.data() + outputColor.size());
-            std::copy(outputColor.cbegin(), outputColor.cend(), outputIt);
+            if (m_tintTransformLookupTable.apply(inputColor.data(), outputColor.data()))
+            {
+                std::copy(outputColor.cbegin(), outputColor.cend(), outputIt);
+            }
+            else
+            {
+                evaluatedColors.insert(evaluatedColors.end(), inputColor.cbegin(), inputColor.cend());
+                evaluatedIndices.push_back(std::distance(result.begin(), outputIt) / alternateColorSpaceComponentCount);
+            }
             outputIt = std::next(outputIt, alternateColorSpaceComponentCount);
         }
         Q_ASSERT(outputIt == result.cend());
+
+        applyTintTransformMany(m_tintTransform.get(), evaluatedColors, colorantCount, evaluatedIndices, alternateColorSpaceComponentCount, result);
     }
 
     return result;
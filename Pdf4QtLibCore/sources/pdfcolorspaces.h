@@ -33,6 +33,7 @@
 #include <QSharedPointer>
 
 #include <set>
+#include <atomic>
 
 namespace pdf
 {
@@ -787,6 +788,18 @@ public:
     const QByteArray& getColors() const;
 
 private:
+    /// Creates table of transformed colors for all possible sample values of the
+    /// image, so colors are transformed only once, not for each pixel. If image has
+    /// more than 8 bits per component, empty table is returned.
+    /// \param imageData Image data
+    /// \param cms Color management system
+    /// \param intent Rendering intent
+    /// \param reporter Render error reporter
+    std::vector<QRgb> createImageColorTable(const PDFImageData& imageData,
+                                            const PDFCMS* cms,
+                                            RenderingIntent intent,
+                                            PDFRenderErrorReporter* reporter) const;
+
     static constexpr const int MIN_VALUE = 0;
     static constexpr const int MAX_VALUE = 255;
 
@@ -795,6 +808,50 @@ private:
     int m_maxValue;
 };
 
+/// Lookup table of the tint transform of Separation and DeviceN color spaces. Tint
+/// transform is sampled on a regular grid over the unit cube of the colorants
+/// (256 samples for one colorant, coarser grids up to four colorants), values
+/// between samples are interpolated multilinearly. Table is created lazily, after
+/// the tint transform was evaluated enough times, so creation of the table is cheaper,
+/// than the evaluations saved. Table is used only, if interpolated values
+/// between samples are within the tolerance. This class is thread safe.
+class PDFTintTransformLookupTable
+{
+public:
+    explicit PDFTintTransformLookupTable(PDFFunctionPtr tintTransform, size_t inputCount, size_t outputCount);
+
+    /// Interpolates tint transform output values from the lookup table. If lookup
+    /// table is not available (yet), or input values are outside of the unit cube,
+    /// then false is returned and caller must evaluate the tint transform.
+    /// \param x Input values (colorants)
+    /// \param y Output values (alternate color space components)
+    bool apply(const PDFReal* x, PDFReal* y) const;
+
+private:
+    static constexpr size_t MAX_INPUT_COUNT = 4;
+
+    /// Maximal error of the interpolated values (for values in range [0, 1])
+    static constexpr PDFReal TOLERANCE = 1.0 / 512.0;
+
+    /// Returns number of samples in each dimension
+    size_t getGridSize() const;
+
+    /// Returns number of evaluations of the tint transform, after which lookup table is created
+    uint32_t getEvaluationThreshold() const;
+
+    void interpolate(const PDFReal* x, PDFReal* y) const;
+    void build() const;
+
+    PDFFunctionPtr m_tintTransform;
+    size_t m_inputCount;
+    size_t m_outputCount;
+
+    /// Lookup table of sampled values (valid only, if m_ready is true)
+    mutable std::vector<PDFReal> m_table;
+    mutable std::atomic_bool m_ready = false;
+    mutable std::atomic_uint32_t m_evaluationCount = 0;
+};
+
 class PDFSeparationColorSpace : public PDFAbstractColorSpace
 {
 public:
@@ -831,6 +888,7 @@ private:
     QByteArray m_colorName;
     PDFColorSpacePointer m_alternateColorSpace;
     PDFFunctionPtr m_tintTransform;
+    PDFTintTransformLookupTable m_tintTransformLookupTable;
     bool m_isNone;
     bool m_isAll;
 };
@@ -901,6 +959,7 @@ private:
     PDFColorSpacePointer m_alternateColorSpace;
     PDFColorSpacePointer m_processColorSpace;
     PDFFunctionPtr m_tintTransform;
+    PDFTintTransformLookupTable m_tintTransformLookupTable;
     std::vector<QByteArray> m_colorantsPrintingOrder;
     std::vector<QByteArray> m_processColorSpaceComponents;
     bool m_isNone;
@@ -78,6 +78,15 @@ static constexpr const int PDF_MAX_COLOR_COMPONENTS = 32;
 // Cache limits
 static constexpr size_t DEFAULT_FONT_CACHE_LIMIT = 32;
 static constexpr size_t DEFAULT_REALIZED_FONT_CACHE_LIMIT = 128;
+static constexpr int DEFAULT_GLYPH_OUTLINE_CACHE_LIMIT = 4096;
+static constexpr qint64 DEFAULT_GLYPH_ATLAS_BUDGET = 1024 * 1024;
+static constexpr qint64 DEFAULT_IMAGE_CACHE_BUDGET = 128 * 1024 * 1024;
+static constexpr qint64 DEFAULT_JBIG2_GLOBALS_CACHE_BUDGET = 32 * 1024 * 1024;
+static constexpr qint64 DEFAULT_COMPILED_CONTENT_STREAM_CACHE_BUDGET = 64 * 1024 * 1024;
+static constexpr qint64 DEFAULT_SHADING_MESH_CACHE_BUDGET = 64 * 1024 * 1024;
+static constexpr qint64 DEFAULT_RESOURCE_CACHE_BUDGET = 8 * 1024 * 1024;
+static constexpr qint64 DEFAULT_SYSTEM_FONT_SUBSTITUTION_CACHE_BUDGET = 64 * 1024 * 1024;
+static constexpr qint64 DEFAULT_OBJECT_STREAM_CACHE_BUDGET = 32 * 1024 * 1024;
 
 }   // namespace pdf
 
@@ -30,6 +30,13 @@
 #include "pdfalgorithmlcs.h"
 #include "pdfpainter.h"
 
+#include <QFile>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QCryptographicHash>
 #include <QtConcurrent/QtConcurrent>
 
 #include "pdfdbgheap.h"
@@ -84,10 +91,13 @@ PDFDiff::PDFDiff(QObject* parent) :
     m_progress(nullptr),
     m_leftDocument(nullptr),
     m_rightDocument(nullptr),
-    m_options(Asynchronous | PC_Text | PC_VectorGraphics | PC_Images | CompareWords),
+    m_options(Asynchronous | PC_Text | PC_VectorGraphics | PC_Images | CompareWords | SkipUnchangedPages),
     m_epsilon(0.001),
     m_cancelled(false),
-    m_textAnalysisAlgorithm(PDFDocumentTextFlowFactory::Algorithm::Layout)
+    m_textAnalysisAlgorithm(PDFDocumentTextFlowFactory::Algorithm::Layout),
+    m_resultSink(nullptr),
+    m_streamingWindowSize(DEFAULT_STREAMING_WINDOW_SIZE),
+    m_hasPartialResult(false)
 {
 
 }
@@ -127,6 +137,23 @@ void PDFDiff::setPagesForRightDocument(PDFClosedIntervalSet pagesForRightDocumen
     m_pagesForRightDocument = std::move(pagesForRightDocument);
 }
 
+void PDFDiff::setResultSink(PDFDiffResultSink* resultSink, size_t windowSize)
+{
+    stop();
+    m_resultSink = resultSink;
+    m_streamingWindowSize = qMax<size_t>(windowSize, 1);
+}
+
+void PDFDiff::setPriorityPages(std::vector<PDFInteger> leftPages, std::vector<PDFInteger> rightPages)
+{
+    std::sort(leftPages.begin(), leftPages.end());
+    std::sort(rightPages.begin(), rightPages.end());
+
+    QMutexLocker lock(&m_partialResultMutex);
+    m_priorityLeftPages = std::move(leftPages);
+    m_priorityRightPages = std::move(rightPages);
+}
+
 void PDFDiff::start()
 {
     // Jakub Melka: First, we must ensure, that comparation
@@ -136,6 +163,12 @@ void PDFDiff::start()
 
     m_cancelled = false;
 
+    {
+        QMutexLocker lock(&m_partialResultMutex);
+        m_partialResult = PDFDiffResult();
+        m_hasPartialResult = false;
+    }
+
     if (m_options.testFlag(Asynchronous))
     {
         m_futureWatcher = std::nullopt;
@@ -161,9 +194,26 @@ void PDFDiff::stop()
         // If we are finished, we do not want to set cancelled state.
         m_cancelled = true;
         m_futureWatcher->waitForFinished();
+
+        // Partial result of stopped comparation is not valid
+        QMutexLocker lock(&m_partialResultMutex);
+        m_partialResult = PDFDiffResult();
+        m_hasPartialResult = false;
     }
 }
 
+bool PDFDiff::hasPartialResult() const
+{
+    QMutexLocker lock(&m_partialResultMutex);
+    return m_hasPartialResult;
+}
+
+PDFDiffResult PDFDiff::getPartialResult() const
+{
+    QMutexLocker lock(&m_partialResultMutex);
+    return m_partialResult;
+}
+
 PDFDiffResult PDFDiff::perform()
 {
     PDFDiffResult result;
@@ -225,10 +275,225 @@ struct PDFDiffPageContext
 {
     PDFInteger pageIndex = 0;
     std::array<uint8_t, 64> pageHash = { };
+    std::array<uint8_t, 64> fingerprint = { };
+    bool isUnchanged = false; ///< Page has identical fingerprint as its counterpart, content is not extracted
     PDFPrecompiledPage::GraphicPieceInfos graphicPieces;
     PDFDocumentTextFlow text;
 };
 
+/// Calculates page fingerprints, which are cheap to compute (page is not
+/// compiled), but identify page content exactly. Fingerprint is composed
+/// of decoded content streams, resources (traversed deeply, with raw stream
+/// data) and page boxes. Hashes of referenced objects are cached, so shared
+/// resources, such as fonts, are hashed only once. This class is thread safe.
+class PDFDiffFingerprintCalculator
+{
+public:
+    explicit PDFDiffFingerprintCalculator(const PDFDocument* document) :
+        m_document(document)
+    {
+
+    }
+
+    /// Calculates fingerprint of a given page
+    /// \param pageIndex Page index
+    std::array<uint8_t, 64> calculate(PDFInteger pageIndex);
+
+private:
+    using Stack = std::vector<PDFObjectReference>;
+
+    void addObject(QCryptographicHash& hasher, const PDFObject& object, Stack& stack);
+    void addDictionary(QCryptographicHash& hasher, const PDFDictionary* dictionary, Stack& stack);
+    QByteArray getReferenceHash(PDFObjectReference reference, Stack& stack);
+
+    const PDFDocument* m_document;
+    QMutex m_mutex;
+    std::map<PDFObjectReference, QByteArray> m_referenceHashes;
+};
+
+std::array<uint8_t, 64> PDFDiffFingerprintCalculator::calculate(PDFInteger pageIndex)
+{
+    std::array<uint8_t, 64> fingerprint = { };
+
+    const PDFPage* page = m_document->getCatalog()->getPage(pageIndex);
+    if (!page)
+    {
+        return fingerprint;
+    }
+
+    QCryptographicHash hasher(QCryptographicHash::Sha512);
+
+    auto addContentStream = [this, &hasher](const PDFObject& object)
+    {
+        const PDFObject& streamObject = m_document->getObject(object);
+        if (streamObject.isStream())
+        {
+            QByteArray content = m_document->getDecodedStream(streamObject.getStream());
+            hasher.addData(QByteArray::number(content.size()));
+            hasher.addData(content);
+        }
+    };
+
+    const PDFObject& contents = m_document->getObject(page->getContents());
+    if (contents.isArray())
+    {
+        const PDFArray* array = contents.getArray();
+        const size_t count = array->getCount();
+        for (size_t i = 0; i < count; ++i)
+        {
+            addContentStream(array->getItem(i));
+        }
+    }
+    else
+    {
+        addContentStream(contents);
+    }
+
+    Stack stack;
+    addObject(hasher, page->getResources(), stack);
+    addObject(hasher, page->getTransparencyGroup(&m_document->getStorage()), stack);
+
+    const QRectF mediaBox = page->getMediaBox();
+    const QRectF cropBox = page->getCropBox();
+    const std::array<PDFReal, 9> pageGeometry = { mediaBox.left(), mediaBox.top(), mediaBox.width(), mediaBox.height(),
+                                                  cropBox.left(), cropBox.top(), cropBox.width(), cropBox.height(),
+                                                  PDFReal(page->getPageRotation()) };
+    hasher.addData(QByteArrayView(reinterpret_cast<const char*>(pageGeometry.data()), sizeof(pageGeometry)));
+
+    QByteArray hash = hasher.result();
+    size_t size = qMin<size_t>(hash.length(), fingerprint.size());
+    std::copy(hash.data(), hash.data() + size, fingerprint.data());
+    return fingerprint;
+}
+
+void PDFDiffFingerprintCalculator::addObject(QCryptographicHash& hasher, const PDFObject& object, Stack& stack)
+{
+    auto addValue = [&hasher](char type, const auto& value)
+    {
+        hasher.addData(QByteArrayView(&type, 1));
+        hasher.addData(QByteArrayView(reinterpret_cast<const char*>(&value), sizeof(value)));
+    };
+
+    auto addBytes = [&hasher](char type, const QByteArray& bytes)
+    {
+        hasher.addData(QByteArrayView(&type, 1));
+        hasher.addData(QByteArray::number(bytes.size()));
+        hasher.addData(bytes);
+    };
+
+    switch (object.getType())
+    {
+        case PDFObject::Type::Null:
+            hasher.addData("n");
+            break;
+
+        case PDFObject::Type::Bool:
+            addValue('b', object.getBool());
+            break;
+
+        case PDFObject::Type::Int:
+            addValue('i', object.getInteger());
+            break;
+
+        case PDFObject::Type::Real:
+            addValue('r', object.getReal());
+            break;
+
+        case PDFObject::Type::String:
+            addBytes('s', object.getString());
+            break;
+
+        case PDFObject::Type::Name:
+            addBytes('/', object.getString());
+            break;
+
+        case PDFObject::Type::Array:
+        {
+            const PDFArray* array = object.getArray();
+            const size_t count = array->getCount();
+            hasher.addData("[");
+            for (size_t i = 0; i < count; ++i)
+            {
+                addObject(hasher, array->getItem(i), stack);
+            }
+            hasher.addData("]");
+            break;
+        }
+
+        case PDFObject::Type::Dictionary:
+            addDictionary(hasher, object.getDictionary(), stack);
+            break;
+
+        case PDFObject::Type::Stream:
+        {
+            const PDFStream* stream = object.getStream();
+            addDictionary(hasher, stream->getDictionary(), stack);
+            addBytes('S', *stream->getContent());
+            break;
+        }
+
+        case PDFObject::Type::Reference:
+            hasher.addData(getReferenceHash(object.getReference(), stack));
+            break;
+
+        default:
+            Q_ASSERT(false);
+            break;
+    }
+}
+
+void PDFDiffFingerprintCalculator::addDictionary(QCryptographicHash& hasher, const PDFDictionary* dictionary, Stack& stack)
+{
+    hasher.addData("<<");
+    const size_t count = dictionary->getCount();
+    for (size_t i = 0; i < count; ++i)
+    {
+        const PDFInplaceOrMemoryString& key = dictionary->getKey(i);
+
+        // Parent links would pull the whole page tree into the fingerprint
+        if (key == "Parent")
+        {
+            continue;
+        }
+
+        QByteArrayView keyView = key.getView();
+        hasher.addData(QByteArray::number(keyView.size()));
+        hasher.addData(keyView);
+        addObject(hasher, dictionary->getValue(i), stack);
+    }
+    hasher.addData(">>");
+}
+
+QByteArray PDFDiffFingerprintCalculator::getReferenceHash(PDFObjectReference reference, Stack& stack)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        auto it = m_referenceHashes.find(reference);
+        if (it != m_referenceHashes.cend())
+        {
+            return it->second;
+        }
+    }
+
+    if (std::find(stack.cbegin(), stack.cend(), reference) != stack.cend())
+    {
+        // Cyclic reference, we identify it by the reference itself. Object
+        // numbers usually differ between documents, so such page will be
+        // probably compared in the usual way.
+        return QByteArray("R") + QByteArray::number(reference.objectNumber) + QByteArray(" ") + QByteArray::number(reference.generation);
+    }
+
+    stack.push_back(reference);
+    QCryptographicHash hasher(QCryptographicHash::Sha512);
+    addObject(hasher, m_document->getObject(reference), stack);
+    QByteArray hash = hasher.result();
+    stack.pop_back();
+
+    QMutexLocker lock(&m_mutex);
+    m_referenceHashes[reference] = hash;
+    return hash;
+}
+
 void PDFDiff::performPageMatching(const std::vector<PDFDiffPageContext>& leftPreparedPages,
                                   const std::vector<PDFDiffPageContext>& rightPreparedPages,
                                   PDFAlgorithmLongestCommonSubsequenceBase::Sequence& pageSequence,
@@ -276,12 +541,33 @@ void PDFDiff::performPageMatching(const std::vector<PDFDiffPageContext>& leftPre
     {
         const PDFDiffPageContext& leftPageContext = leftPreparedPages[leftIndex];
 
+        if (leftPageContext.isUnchanged)
+        {
+            // Content of unchanged page is not extracted, it can be matched only by page hash
+            return;
+        }
+
         auto page = m_leftDocument->getCatalog()->getPage(leftPageContext.pageIndex);
         PDFReal epsilon = calculateEpsilonForPage(page);
 
         for (const size_t rightIndex : rightUnmatched)
         {
             const PDFDiffPageContext& rightPageContext = rightPreparedPages[rightIndex];
+            if (rightPageContext.isUnchanged)
+            {
+                continue;
+            }
+
+            if (m_resultSink)
+            {
+                // Graphic pieces are released in streaming mode, we can use only page hash
+                if (leftPageContext.pageHash == rightPageContext.pageHash)
+                {
+                    matchedPages[leftIndex].push_back(rightIndex);
+                }
+                continue;
+            }
+
             if (leftPageContext.graphicPieces.size() != rightPageContext.graphicPieces.size())
             {
                 // Match cannot exist, graphic pieces have different size
@@ -353,60 +639,63 @@ void PDFDiff::performSteps(const std::vector<PDFInteger>& leftPages,
     std::transform(leftPages.cbegin(), leftPages.cend(), std::back_inserter(leftPreparedPages), createDiffPageContext);
     std::transform(rightPages.cbegin(), rightPages.cend(), std::back_inserter(rightPreparedPages), createDiffPageContext);
 
-    // StepExtractContentLeftDocument
-    if (!m_cancelled)
+    auto getChangedContexts = [](std::vector<PDFDiffPageContext>& contexts)
     {
-        PDFFontCache fontCache(DEFAULT_FONT_CACHE_LIMIT, DEFAULT_REALIZED_FONT_CACHE_LIMIT);
-        PDFOptionalContentActivity optionalContentActivity(m_leftDocument, pdf::OCUsage::View, nullptr);
-        fontCache.setDocument(pdf::PDFModifiedDocument(const_cast<pdf::PDFDocument*>(m_leftDocument), &optionalContentActivity));
+        std::vector<PDFDiffPageContext*> result;
+        for (PDFDiffPageContext& context : contexts)
+        {
+            if (!context.isUnchanged)
+            {
+                result.push_back(&context);
+            }
+        }
+        return result;
+    };
 
-        PDFCMSManager cmsManager(nullptr);
-        cmsManager.setDocument(m_leftDocument);
-        PDFCMSPointer cms = cmsManager.getCurrentCMS();
+    // In streaming mode, graphic pieces are released after page hash is computed,
+    // they are extracted again when the page is compared.
+    auto extractContent = [this](const PDFDocument* document, const std::vector<PDFDiffPageContext*>& contexts)
+    {
+        if (!m_resultSink)
+        {
+            performContentExtraction(document, contexts);
+            return;
+        }
 
-        auto fillPageContext = [&, this](PDFDiffPageContext& context)
+        for (size_t i = 0; i < contexts.size() && !m_cancelled; i += m_streamingWindowSize)
         {
-            PDFPrecompiledPage compiledPage;
-            constexpr PDFRenderer::Features features = PDFRenderer::IgnoreOptionalContent;
-            PDFRenderer renderer(m_leftDocument, &fontCache, cms.data(), &optionalContentActivity, features, pdf::PDFMeshQualitySettings());
-            renderer.compile(&compiledPage, context.pageIndex);
+            const size_t windowEnd = qMin(i + m_streamingWindowSize, contexts.size());
+            std::vector<PDFDiffPageContext*> windowContexts(std::next(contexts.cbegin(), i), std::next(contexts.cbegin(), windowEnd));
+            performContentExtraction(document, windowContexts);
 
-            auto page = m_leftDocument->getCatalog()->getPage(context.pageIndex);
-            PDFReal epsilon = calculateEpsilonForPage(page);
-            context.graphicPieces = compiledPage.calculateGraphicPieceInfos(page->getMediaBox(), epsilon);
+            for (PDFDiffPageContext* context : windowContexts)
+            {
+                context->graphicPieces = PDFPrecompiledPage::GraphicPieceInfos();
+            }
+        }
+    };
 
-            finalizeGraphicsPieces(context);
-        };
-        PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, leftPreparedPages.begin(), leftPreparedPages.end(), fillPageContext);
+    // StepCalculateFingerprints
+    if (!m_cancelled)
+    {
+        if (m_options.testFlag(SkipUnchangedPages))
+        {
+            performFingerprintMatching(leftPreparedPages, rightPreparedPages);
+        }
         stepProgress();
     }
 
-    // StepExtractContentRightDocument
+    // StepExtractContentLeftDocument
     if (!m_cancelled)
     {
-        PDFFontCache fontCache(DEFAULT_FONT_CACHE_LIMIT, DEFAULT_REALIZED_FONT_CACHE_LIMIT);
-        PDFOptionalContentActivity optionalContentActivity(m_rightDocument, pdf::OCUsage::View, nullptr);
-        fontCache.setDocument(pdf::PDFModifiedDocument(const_cast<pdf::PDFDocument*>(m_rightDocument), &optionalContentActivity));
-
-        PDFCMSManager cmsManager(nullptr);
-        cmsManager.setDocument(m_rightDocument);
-        PDFCMSPointer cms = cmsManager.getCurrentCMS();
-
-        auto fillPageContext = [&, this](PDFDiffPageContext& context)
-        {
-            PDFPrecompiledPage compiledPage;
-            constexpr PDFRenderer::Features features = PDFRenderer::IgnoreOptionalContent;
-            PDFRenderer renderer(m_rightDocument, &fontCache, cms.data(), &optionalContentActivity, features, pdf::PDFMeshQualitySettings());
-            renderer.compile(&compiledPage, context.pageIndex);
-
-            const PDFPage* page = m_rightDocument->getCatalog()->getPage(context.pageIndex);
-            PDFReal epsilon = calculateEpsilonForPage(page);
-            context.graphicPieces = compiledPage.calculateGraphicPieceInfos(page->getMediaBox(), epsilon);
-
-            finalizeGraphicsPieces(context);
-        };
+        extractContent(m_leftDocument, getChangedContexts(leftPreparedPages));
+        stepProgress();
+    }
 
-        PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, rightPreparedPages.begin(), rightPreparedPages.end(), fillPageContext);
+    // StepExtractContentRightDocument
+    if (!m_cancelled)
+    {
+        extractContent(m_rightDocument, getChangedContexts(rightPreparedPages));
         stepProgress();
     }
 
@@ -414,24 +703,61 @@ void PDFDiff::performSteps(const std::vector<PDFInteger>& leftPages,
     if (!m_cancelled)
     {
         performPageMatching(leftPreparedPages, rightPreparedPages, pageSequence, pageMatches);
+
+        // Unchanged pages are matched with their counterparts, unless page matching
+        // has found a different alignment. In that case, page content of these pages
+        // is extracted and pages are matched again.
+        while (!m_cancelled)
+        {
+            std::vector<PDFDiffPageContext*> leftMisalignedPages;
+            std::vector<PDFDiffPageContext*> rightMisalignedPages;
+
+            for (const PDFDiffHelper::PageSequence::value_type& item : pageSequence)
+            {
+                const bool isAligned = item.isMatch() && !item.isReplaced();
+
+                if (item.isLeftValid() && !isAligned && leftPreparedPages[item.index1].isUnchanged)
+                {
+                    leftMisalignedPages.push_back(&leftPreparedPages[item.index1]);
+                }
+                if (item.isRightValid() && !isAligned && rightPreparedPages[item.index2].isUnchanged)
+                {
+                    rightMisalignedPages.push_back(&rightPreparedPages[item.index2]);
+                }
+            }
+
+            if (leftMisalignedPages.empty() && rightMisalignedPages.empty())
+            {
+                break;
+            }
+
+            for (PDFDiffPageContext* context : leftMisalignedPages)
+            {
+                context->isUnchanged = false;
+            }
+            for (PDFDiffPageContext* context : rightMisalignedPages)
+            {
+                context->isUnchanged = false;
+            }
+
+            extractContent(m_leftDocument, leftMisalignedPages);
+            extractContent(m_rightDocument, rightMisalignedPages);
+
+            pageMatches.clear();
+            performPageMatching(leftPreparedPages, rightPreparedPages, pageSequence, pageMatches);
+        }
+
+        result.m_unchangedPageCount = std::count_if(leftPreparedPages.cbegin(), leftPreparedPages.cend(), [](const PDFDiffPageContext& context) { return context.isUnchanged; });
         stepProgress();
     }
 
-    // StepExtractTextLeftDocument
+    // StepExtractTextLeftDocument (in streaming and incremental mode,
+    // text is extracted during comparation)
     if (!m_cancelled)
     {
-        pdf::PDFDocumentTextFlowFactory factoryLeftDocumentTextFlow;
-        factoryLeftDocumentTextFlow.setCalculateBoundingBoxes(true);
-        PDFDocumentTextFlow leftTextFlow = factoryLeftDocumentTextFlow.create(m_leftDocument, leftPages, m_textAnalysisAlgorithm);
-        std::map<PDFInteger, PDFDocumentTextFlow> splittedText = leftTextFlow.split(PDFDocumentTextFlow::Text);
-        for (PDFDiffPageContext& leftContext : leftPreparedPages)
+        if (!m_resultSink && !isIncrementalCompare())
         {
-            auto it = splittedText.find(leftContext.pageIndex);
-            if (it != splittedText.cend())
-            {
-                leftContext.text = std::move(it->second);
-                splittedText.erase(it);
-            }
+            performTextExtraction(m_leftDocument, getChangedContexts(leftPreparedPages));
         }
         stepProgress();
     }
@@ -439,18 +765,9 @@ void PDFDiff::performSteps(const std::vector<PDFInteger>& leftPages,
     // StepExtractTextRightDocument
     if (!m_cancelled)
     {
-        pdf::PDFDocumentTextFlowFactory factoryRightDocumentTextFlow;
-        factoryRightDocumentTextFlow.setCalculateBoundingBoxes(true);
-        PDFDocumentTextFlow rightTextFlow = factoryRightDocumentTextFlow.create(m_rightDocument, rightPages, m_textAnalysisAlgorithm);
-        std::map<PDFInteger, PDFDocumentTextFlow> splittedText = rightTextFlow.split(PDFDocumentTextFlow::Text);
-        for (PDFDiffPageContext& rightContext : rightPreparedPages)
+        if (!m_resultSink && !isIncrementalCompare())
         {
-            auto it = splittedText.find(rightContext.pageIndex);
-            if (it != splittedText.cend())
-            {
-                rightContext.text = std::move(it->second);
-                splittedText.erase(it);
-            }
+            performTextExtraction(m_rightDocument, getChangedContexts(rightPreparedPages));
         }
         stepProgress();
     }
@@ -458,20 +775,342 @@ void PDFDiff::performSteps(const std::vector<PDFInteger>& leftPages,
     // StepCompare
     if (!m_cancelled)
     {
-        performCompare(leftPreparedPages, rightPreparedPages, pageSequence, pageMatches, result);
+        if (m_resultSink)
+        {
+            performStreamingCompare(leftPreparedPages, rightPreparedPages, pageSequence, pageMatches, result);
+        }
+        else if (isIncrementalCompare())
+        {
+            performIncrementalCompare(leftPreparedPages, rightPreparedPages, pageSequence, pageMatches, result);
+        }
+        else
+        {
+            performCompare(leftPreparedPages, rightPreparedPages, pageSequence, pageMatches, result);
+        }
         stepProgress();
     }
 }
 
+void PDFDiff::performFingerprintMatching(std::vector<PDFDiffPageContext>& leftPreparedPages,
+                                         std::vector<PDFDiffPageContext>& rightPreparedPages)
+{
+    PDFDiffFingerprintCalculator leftCalculator(m_leftDocument);
+    PDFDiffFingerprintCalculator rightCalculator(m_rightDocument);
+
+    auto calculateLeftFingerprint = [&leftCalculator](PDFDiffPageContext& context) { context.fingerprint = leftCalculator.calculate(context.pageIndex); };
+    auto calculateRightFingerprint = [&rightCalculator](PDFDiffPageContext& context) { context.fingerprint = rightCalculator.calculate(context.pageIndex); };
+
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, leftPreparedPages.begin(), leftPreparedPages.end(), calculateLeftFingerprint);
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, rightPreparedPages.begin(), rightPreparedPages.end(), calculateRightFingerprint);
+
+    if (m_cancelled)
+    {
+        return;
+    }
+
+    // Pages with identical fingerprints have identical content, so we do not
+    // need to extract their graphics and text. Page hash is set to the fingerprint,
+    // so these pages are matched again in the page matching step.
+    auto compareFingerprints = [](const PDFDiffPageContext& left, const PDFDiffPageContext& right)
+    {
+        return left.fingerprint == right.fingerprint;
+    };
+    PDFAlgorithmLongestCommonSubsequence algorithm(leftPreparedPages.cbegin(), leftPreparedPages.cend(),
+                                                   rightPreparedPages.cbegin(), rightPreparedPages.cend(),
+                                                   compareFingerprints);
+    algorithm.perform();
+
+    for (const PDFDiffHelper::PageSequence::value_type& item : algorithm.getSequence())
+    {
+        if (item.isMatch())
+        {
+            PDFDiffPageContext& leftContext = leftPreparedPages[item.index1];
+            PDFDiffPageContext& rightContext = rightPreparedPages[item.index2];
+
+            leftContext.isUnchanged = true;
+            leftContext.pageHash = leftContext.fingerprint;
+            rightContext.isUnchanged = true;
+            rightContext.pageHash = rightContext.fingerprint;
+        }
+    }
+}
+
+void PDFDiff::performContentExtraction(const PDFDocument* document, const std::vector<PDFDiffPageContext*>& contexts)
+{
+    if (contexts.empty())
+    {
+        return;
+    }
+
+    PDFFontCache fontCache(DEFAULT_FONT_CACHE_LIMIT, DEFAULT_REALIZED_FONT_CACHE_LIMIT);
+    PDFOptionalContentActivity optionalContentActivity(document, pdf::OCUsage::View, nullptr);
+    fontCache.setDocument(pdf::PDFModifiedDocument(const_cast<pdf::PDFDocument*>(document), &optionalContentActivity));
+
+    PDFCMSManager cmsManager(nullptr);
+    cmsManager.setDocument(document);
+    PDFCMSPointer cms = cmsManager.getCurrentCMS();
+
+    PDFImagePerceptualHashCache imageHashCache;
+
+    auto fillPageContext = [&, this](PDFDiffPageContext* context)
+    {
+        PDFPrecompiledPage compiledPage;
+        constexpr PDFRenderer::Features features = PDFRenderer::IgnoreOptionalContent;
+        PDFRenderer renderer(document, &fontCache, cms.data(), &optionalContentActivity, features, pdf::PDFMeshQualitySettings());
+        renderer.compile(&compiledPage, context->pageIndex);
+
+        const PDFPage* page = document->getCatalog()->getPage(context->pageIndex);
+        PDFReal epsilon = calculateEpsilonForPage(page);
+        context->graphicPieces = compiledPage.calculateGraphicPieceInfos(page->getMediaBox(), epsilon, &imageHashCache);
+
+        finalizeGraphicsPieces(*context);
+    };
+
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, contexts.begin(), contexts.end(), fillPageContext);
+}
+
+void PDFDiff::performTextExtraction(const PDFDocument* document, const std::vector<PDFDiffPageContext*>& contexts)
+{
+    if (contexts.empty())
+    {
+        return;
+    }
+
+    std::vector<PDFInteger> pageIndices;
+    pageIndices.reserve(contexts.size());
+    std::transform(contexts.cbegin(), contexts.cend(), std::back_inserter(pageIndices), [](const PDFDiffPageContext* context) { return context->pageIndex; });
+
+    pdf::PDFDocumentTextFlowFactory factoryDocumentTextFlow;
+    factoryDocumentTextFlow.setCalculateBoundingBoxes(true);
+    PDFDocumentTextFlow textFlow = factoryDocumentTextFlow.create(document, pageIndices, m_textAnalysisAlgorithm);
+    std::map<PDFInteger, PDFDocumentTextFlow> splittedText = textFlow.split(PDFDocumentTextFlow::Text);
+    for (PDFDiffPageContext* context : contexts)
+    {
+        auto it = splittedText.find(context->pageIndex);
+        if (it != splittedText.cend())
+        {
+            context->text = std::move(it->second);
+            splittedText.erase(it);
+        }
+    }
+}
+
 void PDFDiff::performCompare(const std::vector<PDFDiffPageContext>& leftPreparedPages,
                              const std::vector<PDFDiffPageContext>& rightPreparedPages,
                              PDFAlgorithmLongestCommonSubsequenceBase::Sequence& pageSequence,
                              const std::map<size_t, size_t>& pageMatches,
                              PDFDiffResult& result)
+{
+    performComparePageSequence(leftPreparedPages, rightPreparedPages, pageSequence, pageMatches, result);
+    performCompareRanges(leftPreparedPages, rightPreparedPages, PDFAlgorithmLongestCommonSubsequenceBase::getModifiedRanges(pageSequence), result);
+
+    // Jakub Melka: sort results
+    result.finalize();
+}
+
+void PDFDiff::performStreamingCompare(std::vector<PDFDiffPageContext>& leftPreparedPages,
+                                      std::vector<PDFDiffPageContext>& rightPreparedPages,
+                                      PDFAlgorithmLongestCommonSubsequenceBase::Sequence& pageSequence,
+                                      const std::map<size_t, size_t>& pageMatches,
+                                      PDFDiffResult& result)
+{
+    using AlgorithmLCS = PDFAlgorithmLongestCommonSubsequenceBase;
+
+    // Result contains only page sequence and page moves, it is also
+    // a summary of the report.
+    performComparePageSequence(leftPreparedPages, rightPreparedPages, pageSequence, pageMatches, result);
+    result.finalize();
+
+    m_resultSink->beginReport(result);
+    m_resultSink->writeDifferences(result);
+
+    for (const AlgorithmLCS::SequenceItemRanges& window : createCompareWindows(pageSequence, m_streamingWindowSize))
+    {
+        if (m_cancelled)
+        {
+            break;
+        }
+
+        PDFDiffResult windowResult;
+        performCompareWindow(leftPreparedPages, rightPreparedPages, window, windowResult);
+        windowResult.finalize();
+        m_resultSink->writeDifferences(windowResult);
+    }
+
+    m_resultSink->endReport();
+}
+
+void PDFDiff::performIncrementalCompare(std::vector<PDFDiffPageContext>& leftPreparedPages,
+                                        std::vector<PDFDiffPageContext>& rightPreparedPages,
+                                        PDFAlgorithmLongestCommonSubsequenceBase::Sequence& pageSequence,
+                                        const std::map<size_t, size_t>& pageMatches,
+                                        PDFDiffResult& result)
+{
+    using AlgorithmLCS = PDFAlgorithmLongestCommonSubsequenceBase;
+
+    // Page sequence and page moves are known immediately, so
+    // they are published before any page is compared.
+    performComparePageSequence(leftPreparedPages, rightPreparedPages, pageSequence, pageMatches, result);
+    publishPartialResult(result);
+
+    std::vector<AlgorithmLCS::SequenceItemRanges> windows = createCompareWindows(pageSequence, INCREMENTAL_WINDOW_SIZE);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    while (!windows.empty() && !m_cancelled)
+    {
+        std::vector<PDFInteger> priorityLeftPages;
+        std::vector<PDFInteger> priorityRightPages;
+
+        {
+            QMutexLocker lock(&m_partialResultMutex);
+            priorityLeftPages = m_priorityLeftPages;
+            priorityRightPages = m_priorityRightPages;
+        }
+
+        auto isPriorityWindow = [&](const AlgorithmLCS::SequenceItemRanges& window)
+        {
+            for (const AlgorithmLCS::SequenceItemRange& range : window)
+            {
+                for (auto it = range.first; it != range.second; ++it)
+                {
+                    if (it->isLeftValid() && std::binary_search(priorityLeftPages.cbegin(), priorityLeftPages.cend(), leftPreparedPages[it->index1].pageIndex))
+                    {
+                        return true;
+                    }
+                    if (it->isRightValid() && std::binary_search(priorityRightPages.cbegin(), priorityRightPages.cend(), rightPreparedPages[it->index2].pageIndex))
+                    {
+                        return true;
+                    }
+                }
+            }
+
+            return false;
+        };
+
+        // Windows with priority pages are compared first, then
+        // the remaining windows in the order of the page sequence.
+        auto itWindow = std::find_if(windows.begin(), windows.end(), isPriorityWindow);
+        const bool isPriority = itWindow != windows.end();
+        if (!isPriority)
+        {
+            itWindow = windows.begin();
+        }
+
+        PDFDiffResult windowResult;
+        performCompareWindow(leftPreparedPages, rightPreparedPages, *itWindow, windowResult);
+        windows.erase(itWindow);
+        result.append(windowResult);
+
+        if (!windows.empty() && (isPriority || timer.elapsed() >= PARTIAL_RESULT_INTERVAL_MS))
+        {
+            publishPartialResult(result);
+            timer.restart();
+        }
+    }
+
+    result.finalize();
+}
+
+void PDFDiff::performCompareWindow(std::vector<PDFDiffPageContext>& leftPreparedPages,
+                                   std::vector<PDFDiffPageContext>& rightPreparedPages,
+                                   const PDFAlgorithmLongestCommonSubsequenceBase::SequenceItemRanges& window,
+                                   PDFDiffResult& result)
+{
+    using AlgorithmLCS = PDFAlgorithmLongestCommonSubsequenceBase;
+
+    std::vector<PDFDiffPageContext*> leftContentContexts;
+    std::vector<PDFDiffPageContext*> rightContentContexts;
+    std::vector<PDFDiffPageContext*> leftTextContexts;
+    std::vector<PDFDiffPageContext*> rightTextContexts;
+
+    for (const AlgorithmLCS::SequenceItemRange& range : window)
+    {
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            const AlgorithmLCS::SequenceItem& item = *it;
+
+            if (item.isLeftValid())
+            {
+                leftTextContexts.push_back(&leftPreparedPages[item.index1]);
+            }
+            if (item.isRightValid())
+            {
+                rightTextContexts.push_back(&rightPreparedPages[item.index2]);
+            }
+            if (item.isReplaced() && item.isMatch())
+            {
+                leftContentContexts.push_back(&leftPreparedPages[item.index1]);
+                rightContentContexts.push_back(&rightPreparedPages[item.index2]);
+            }
+        }
+    }
+
+    // In streaming mode, page content was released after page hash was computed
+    if (m_resultSink)
+    {
+        performContentExtraction(m_leftDocument, leftContentContexts);
+        performContentExtraction(m_rightDocument, rightContentContexts);
+    }
+
+    performTextExtraction(m_leftDocument, leftTextContexts);
+    performTextExtraction(m_rightDocument, rightTextContexts);
+
+    performCompareRanges(leftPreparedPages, rightPreparedPages, window, result);
+
+    const bool releaseContent = m_resultSink != nullptr;
+    auto releaseContexts = [releaseContent](const std::vector<PDFDiffPageContext*>& contexts)
+    {
+        for (PDFDiffPageContext* context : contexts)
+        {
+            if (releaseContent)
+            {
+                context->graphicPieces = PDFPrecompiledPage::GraphicPieceInfos();
+            }
+            context->text = PDFDocumentTextFlow();
+        }
+    };
+    releaseContexts(leftTextContexts);
+    releaseContexts(rightTextContexts);
+}
+
+std::vector<PDFAlgorithmLongestCommonSubsequenceBase::SequenceItemRanges> PDFDiff::createCompareWindows(PDFAlgorithmLongestCommonSubsequenceBase::Sequence& pageSequence,
+                                                                                                         size_t windowSize)
+{
+    using AlgorithmLCS = PDFAlgorithmLongestCommonSubsequenceBase;
+
+    std::vector<AlgorithmLCS::SequenceItemRanges> windows;
+    size_t windowItemCount = 0;
+    for (const AlgorithmLCS::SequenceItemRange& range : AlgorithmLCS::getModifiedRanges(pageSequence))
+    {
+        for (auto it = range.first; it != range.second;)
+        {
+            if (windows.empty() || windowItemCount == windowSize)
+            {
+                windows.emplace_back();
+                windowItemCount = 0;
+            }
+
+            const size_t count = qMin<size_t>(std::distance(it, range.second), windowSize - windowItemCount);
+            auto itEnd = std::next(it, count);
+            windows.back().emplace_back(it, itEnd);
+            windowItemCount += count;
+            it = itEnd;
+        }
+    }
+
+    return windows;
+}
+
+void PDFDiff::performComparePageSequence(const std::vector<PDFDiffPageContext>& leftPreparedPages,
+                                         const std::vector<PDFDiffPageContext>& rightPreparedPages,
+                                         const PDFAlgorithmLongestCommonSubsequenceBase::Sequence& pageSequence,
+                                         const std::map<size_t, size_t>& pageMatches,
+                                         PDFDiffResult& result)
 {
     using AlgorithmLCS = PDFAlgorithmLongestCommonSubsequenceBase;
 
-    auto modifiedRanges = AlgorithmLCS::getModifiedRanges(pageSequence);
     PDFDiffResult::PageSequence resultPageSequence;
     resultPageSequence.reserve(pageSequence.size());
 
@@ -504,6 +1143,14 @@ void PDFDiff::performCompare(const std::vector<PDFDiffPageContext>& leftPrepared
         resultPageSequence.emplace_back(pageSequenceItem);
     }
     result.setPageSequence(std::move(resultPageSequence));
+}
+
+void PDFDiff::performCompareRanges(const std::vector<PDFDiffPageContext>& leftPreparedPages,
+                                   const std::vector<PDFDiffPageContext>& rightPreparedPages,
+                                   const PDFAlgorithmLongestCommonSubsequenceBase::SequenceItemRanges& modifiedRanges,
+                                   PDFDiffResult& result)
+{
+    using AlgorithmLCS = PDFAlgorithmLongestCommonSubsequenceBase;
 
     std::vector<PDFDiffHelper::TextFlowDifferences> textFlowDifferences;
 
@@ -857,9 +1504,6 @@ void PDFDiff::performCompare(const std::vector<PDFDiffPageContext>& leftPrepared
     };
 
     PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, textFlowDifferences.begin(), textFlowDifferences.end(), compareTexts);
-
-    // Jakub Melka: sort results
-    result.finalize();
 }
 
 void PDFDiff::finalizeGraphicsPieces(PDFDiffPageContext& context)
@@ -900,10 +1544,36 @@ void PDFDiff::finalizeGraphicsPieces(PDFDiffPageContext& context)
     std::copy(hash.data(), hash.data() + size, context.pageHash.data());
 }
 
+void PDFDiff::publishPartialResult(const PDFDiffResult& result)
+{
+    PDFDiffResult partialResult = result;
+    partialResult.finalize();
+
+    {
+        QMutexLocker lock(&m_partialResultMutex);
+        m_partialResult = std::move(partialResult);
+        m_hasPartialResult = true;
+    }
+
+    Q_EMIT partialResultAvailable();
+}
+
+bool PDFDiff::isIncrementalCompare() const
+{
+    return m_options.testFlag(Asynchronous) && m_options.testFlag(IncrementalResults) && !m_resultSink;
+}
+
 void PDFDiff::onComparationPerformed()
 {
     m_cancelled = false;
     m_result = m_future.result();
+
+    {
+        QMutexLocker lock(&m_partialResultMutex);
+        m_partialResult = PDFDiffResult();
+        m_hasPartialResult = false;
+    }
+
     Q_EMIT comparationFinished();
 }
 
@@ -1060,157 +1730,272 @@ void PDFDiffResult::addTextRemoved(PDFInteger pageIndex,
     difference.leftRectCount = rectInfos.size();
     m_rects.insert(m_rects.end(), rectInfos.cbegin(), rectInfos.cend());
 
-    m_differences.emplace_back(std::move(difference));
-}
+    m_differences.emplace_back(std::move(difference));
+}
+
+void PDFDiffResult::addTextReplaced(PDFInteger pageIndex1,
+                                    PDFInteger pageIndex2,
+                                    QString textRemoved,
+                                    QString textAdded,
+                                    const RectInfos& rectInfos1,
+                                    const RectInfos& rectInfos2)
+{
+    Difference difference;
+
+    difference.type = Type::TextReplaced;
+    difference.pageIndex1 = pageIndex1;
+    difference.pageIndex2 = pageIndex2;
+    difference.textRemovedIndex = m_strings.size();
+    m_strings << textRemoved;
+    difference.textAddedIndex = m_strings.size();
+    m_strings << textAdded;
+
+    difference.leftRectIndex = m_rects.size();
+    difference.leftRectCount = rectInfos1.size();
+    m_rects.insert(m_rects.end(), rectInfos1.cbegin(), rectInfos1.cend());
+
+    difference.rightRectIndex = m_rects.size();
+    difference.rightRectCount = rectInfos2.size();
+    m_rects.insert(m_rects.end(), rectInfos2.cbegin(), rectInfos2.cend());
+
+    m_differences.emplace_back(std::move(difference));
+}
+
+void PDFDiffResult::saveToStream(QXmlStreamWriter* stream) const
+{
+    stream->setAutoFormatting(true);
+    stream->setAutoFormattingIndent(2);
+    stream->writeStartDocument();
+    stream->writeNamespace("https://github.com/JakubMelka/PDF4QT", "pdf4qt");
+    stream->writeStartElement("difference-report");
+    stream->writeAttribute("unchanged-pages", QString::number(m_unchangedPageCount));
+
+    // Jakub Melka: write all differences
+    stream->writeStartElement("differences");
+    for (size_t i = 0; i < m_differences.size(); ++i)
+    {
+        saveDifferenceToStream(stream, i);
+    }
+    stream->writeEndElement();
+
+    savePageSequenceToStream(stream);
+
+    stream->writeEndElement();
+    stream->writeEndDocument();
+}
+
+void PDFDiffResult::saveDifferenceToStream(QXmlStreamWriter* stream, size_t index) const
+{
+    const Difference& difference = m_differences.at(index);
+
+    stream->writeStartElement("difference");
+    stream->writeAttribute("type", getTypeName(difference.type));
+
+    if (difference.pageIndex1 != -1)
+    {
+        stream->writeAttribute("left", QString::number(difference.pageIndex1 + 1));
+    }
+
+    if (difference.pageIndex2 != -1)
+    {
+        stream->writeAttribute("right", QString::number(difference.pageIndex2 + 1));
+    }
+
+    if (difference.textAddedIndex != -1)
+    {
+        stream->writeTextElement("text-added", m_strings[difference.textAddedIndex]);
+    }
+
+    if (difference.textRemovedIndex != -1)
+    {
+        stream->writeTextElement("text-removed", m_strings[difference.textRemovedIndex]);
+    }
+
+    stream->writeEndElement();
+}
+
+void PDFDiffResult::savePageSequenceToStream(QXmlStreamWriter* stream) const
+{
+    stream->writeStartElement("page-sequence");
+    for (const PageSequenceItem& item : m_pageSequence)
+    {
+        stream->writeStartElement("item");
+
+        QString left = item.leftPage != -1 ? QString::number(item.leftPage + 1) : QString("none");
+        QString right = item.rightPage != -1 ? QString::number(item.rightPage + 1) : QString("none");
+
+        stream->writeAttribute("left", left);
+        stream->writeAttribute("right", right);
+
+        stream->writeEndElement();
+    }
+    stream->writeEndElement();
+}
+
+QJsonObject PDFDiffResult::saveDifferenceToJson(size_t index) const
+{
+    const Difference& difference = m_differences.at(index);
+
+    QJsonObject object;
+    object["type"] = getTypeName(difference.type);
+
+    if (difference.pageIndex1 != -1)
+    {
+        object["left"] = qint64(difference.pageIndex1 + 1);
+    }
+
+    if (difference.pageIndex2 != -1)
+    {
+        object["right"] = qint64(difference.pageIndex2 + 1);
+    }
 
-void PDFDiffResult::addTextReplaced(PDFInteger pageIndex1,
-                                    PDFInteger pageIndex2,
-                                    QString textRemoved,
-                                    QString textAdded,
-                                    const RectInfos& rectInfos1,
-                                    const RectInfos& rectInfos2)
-{
-    Difference difference;
+    object["message"] = getMessage(index);
 
-    difference.type = Type::TextReplaced;
-    difference.pageIndex1 = pageIndex1;
-    difference.pageIndex2 = pageIndex2;
-    difference.textRemovedIndex = m_strings.size();
-    m_strings << textRemoved;
-    difference.textAddedIndex = m_strings.size();
-    m_strings << textAdded;
+    if (difference.textAddedIndex != -1)
+    {
+        object["text-added"] = m_strings[difference.textAddedIndex];
+    }
 
-    difference.leftRectIndex = m_rects.size();
-    difference.leftRectCount = rectInfos1.size();
-    m_rects.insert(m_rects.end(), rectInfos1.cbegin(), rectInfos1.cend());
+    if (difference.textRemovedIndex != -1)
+    {
+        object["text-removed"] = m_strings[difference.textRemovedIndex];
+    }
 
-    difference.rightRectIndex = m_rects.size();
-    difference.rightRectCount = rectInfos2.size();
-    m_rects.insert(m_rects.end(), rectInfos2.cbegin(), rectInfos2.cend());
+    // Rectangles are stored as arrays [page, x, y, width, height]
+    auto getRects = [this](size_t rectIndex, size_t rectCount)
+    {
+        QJsonArray rects;
+        for (size_t i = rectIndex; i < rectIndex + rectCount; ++i)
+        {
+            const auto& [pageIndex, rect] = m_rects[i];
+            rects.append(QJsonArray({ QJsonValue(qint64(pageIndex + 1)), rect.x(), rect.y(), rect.width(), rect.height() }));
+        }
+        return rects;
+    };
 
-    m_differences.emplace_back(std::move(difference));
+    if (difference.leftRectCount > 0)
+    {
+        object["left-rects"] = getRects(difference.leftRectIndex, difference.leftRectCount);
+    }
+
+    if (difference.rightRectCount > 0)
+    {
+        object["right-rects"] = getRects(difference.rightRectIndex, difference.rightRectCount);
+    }
+
+    return object;
 }
 
-void PDFDiffResult::saveToStream(QXmlStreamWriter* stream) const
+void PDFDiffResult::loadDifferenceFromJson(const QJsonObject& object)
 {
-    stream->setAutoFormatting(true);
-    stream->setAutoFormattingIndent(2);
-    stream->writeStartDocument();
-    stream->writeNamespace("https://github.com/JakubMelka/PDF4QT", "pdf4qt");
-    stream->writeStartElement("difference-report");
+    Difference difference;
+    difference.type = getTypeFromName(object["type"].toString());
+    difference.pageIndex1 = object["left"].toInteger(0) - 1;
+    difference.pageIndex2 = object["right"].toInteger(0) - 1;
 
-    // Jakub Melka: write all differences
-    stream->writeStartElement("differences");
-    for (const Difference& difference : m_differences)
+    if (object.contains("text-added"))
     {
-        stream->writeStartElement("difference");
+        difference.textAddedIndex = m_strings.size();
+        m_strings << object["text-added"].toString();
+    }
 
-        QString type;
-        switch (difference.type)
-        {
-            case Type::PageMoved:
-                type = "page-moved";
-                break;
+    if (object.contains("text-removed"))
+    {
+        difference.textRemovedIndex = m_strings.size();
+        m_strings << object["text-removed"].toString();
+    }
 
-            case Type::PageAdded:
-                type = "page-added";
-                break;
+    auto loadRects = [this](const QJsonArray& rects, size_t& rectIndex, size_t& rectCount)
+    {
+        rectIndex = m_rects.size();
+        rectCount = 0;
 
-            case Type::PageRemoved:
-                type = "page-removed";
-                break;
+        for (const QJsonValue& value : rects)
+        {
+            QJsonArray rect = value.toArray();
+            if (rect.size() == 5)
+            {
+                m_rects.emplace_back(rect[0].toInteger() - 1, QRectF(rect[1].toDouble(), rect[2].toDouble(), rect[3].toDouble(), rect[4].toDouble()));
+                ++rectCount;
+            }
+        }
+    };
 
-            case Type::RemovedTextCharContent:
-                type = "removed-text-char";
-                break;
+    loadRects(object["left-rects"].toArray(), difference.leftRectIndex, difference.leftRectCount);
+    loadRects(object["right-rects"].toArray(), difference.rightRectIndex, difference.rightRectCount);
 
-            case Type::RemovedVectorGraphicContent:
-                type = "removed-vector-graphics";
-                break;
+    if (difference.type != Type::Invalid)
+    {
+        m_typeFlags |= uint32_t(difference.type);
+        m_differences.emplace_back(std::move(difference));
+    }
+}
 
-            case Type::RemovedImageContent:
-                type = "removed-image";
-                break;
+QString PDFDiffResult::getTypeName(Type type)
+{
+    switch (type)
+    {
+        case Type::PageMoved:
+            return QString("page-moved");
 
-            case Type::RemovedShadingContent:
-                type = "removed-shading";
-                break;
+        case Type::PageAdded:
+            return QString("page-added");
 
-            case Type::AddedTextCharContent:
-                type = "added-text-char";
-                break;
+        case Type::PageRemoved:
+            return QString("page-removed");
 
-            case Type::AddedVectorGraphicContent:
-                type = "added-vector-graphics";
-                break;
+        case Type::RemovedTextCharContent:
+            return QString("removed-text-char");
 
-            case Type::AddedImageContent:
-                type = "added-image";
-                break;
+        case Type::RemovedVectorGraphicContent:
+            return QString("removed-vector-graphics");
 
-            case Type::AddedShadingContent:
-                type = "added-shading";
-                break;
+        case Type::RemovedImageContent:
+            return QString("removed-image");
 
-            case Type::TextAdded:
-                type = "text-added";
-                break;
+        case Type::RemovedShadingContent:
+            return QString("removed-shading");
 
-            case Type::TextRemoved:
-                type = "text-removed";
-                break;
+        case Type::AddedTextCharContent:
+            return QString("added-text-char");
 
-            case Type::TextReplaced:
-                type = "text-replaced";
-                break;
+        case Type::AddedVectorGraphicContent:
+            return QString("added-vector-graphics");
 
-            default:
-                Q_ASSERT(false);
-                break;
-        }
-        stream->writeAttribute("type", type);
+        case Type::AddedImageContent:
+            return QString("added-image");
 
-        if (difference.pageIndex1 != -1)
-        {
-            stream->writeAttribute("left", QString::number(difference.pageIndex1 + 1));
-        }
+        case Type::AddedShadingContent:
+            return QString("added-shading");
 
-        if (difference.pageIndex2 != -1)
-        {
-            stream->writeAttribute("right", QString::number(difference.pageIndex2 + 1));
-        }
+        case Type::TextAdded:
+            return QString("text-added");
 
-        if (difference.textAddedIndex != -1)
-        {
-            stream->writeTextElement("text-added", m_strings[difference.textAddedIndex]);
-        }
+        case Type::TextRemoved:
+            return QString("text-removed");
 
-        if (difference.textRemovedIndex != -1)
-        {
-            stream->writeTextElement("text-removed", m_strings[difference.textRemovedIndex]);
-        }
+        case Type::TextReplaced:
+            return QString("text-replaced");
 
-        stream->writeEndElement();
+        default:
+            Q_ASSERT(false);
+            break;
     }
-    stream->writeEndElement();
-
-    stream->writeStartElement("page-sequence");
-    for (const PageSequenceItem& item : m_pageSequence)
-    {
-        stream->writeStartElement("item");
-
-        QString left = item.leftPage != -1 ? QString::number(item.leftPage + 1) : QString("none");
-        QString right = item.rightPage != -1 ? QString::number(item.rightPage + 1) : QString("none");
 
-        stream->writeAttribute("left", left);
-        stream->writeAttribute("right", right);
+    return QString();
+}
 
-        stream->writeEndElement();
+PDFDiffResult::Type PDFDiffResult::getTypeFromName(const QString& name)
+{
+    for (uint32_t flag = uint32_t(Type::PageMoved); flag <= uint32_t(Type::TextRemoved); flag <<= 1)
+    {
+        if (getTypeName(Type(flag)) == name)
+        {
+            return Type(flag);
+        }
     }
-    stream->writeEndElement();
 
-    stream->writeEndElement();
-    stream->writeEndDocument();
+    return Type::Invalid;
 }
 
 void PDFDiffResult::finalize()
@@ -1229,6 +2014,36 @@ void PDFDiffResult::finalize()
     }
 }
 
+void PDFDiffResult::append(const PDFDiffResult& result)
+{
+    const size_t rectOffset = m_rects.size();
+    const int stringOffset = m_strings.size();
+
+    m_rects.insert(m_rects.end(), result.m_rects.cbegin(), result.m_rects.cend());
+    m_strings.append(result.m_strings);
+
+    m_differences.reserve(m_differences.size() + result.m_differences.size());
+    for (Difference difference : result.m_differences)
+    {
+        difference.leftRectIndex += rectOffset;
+        difference.rightRectIndex += rectOffset;
+
+        if (difference.textAddedIndex != -1)
+        {
+            difference.textAddedIndex += stringOffset;
+        }
+
+        if (difference.textRemovedIndex != -1)
+        {
+            difference.textRemovedIndex += stringOffset;
+        }
+
+        m_differences.push_back(difference);
+    }
+
+    m_typeFlags |= result.m_typeFlags;
+}
+
 uint32_t PDFDiffResult::getTypeFlags(size_t index) const
 {
     if (index >= m_differences.size())
@@ -1599,7 +2414,7 @@ PDFDiffHelper::Differences PDFDiffHelper::calculateDifferences(const GraphicPiec
                 continue;
             }
 
-            hasMatch = (leftInfo.type != GraphicPieceInfo::Type::Image) || (leftInfo.imageHash == rightInfo.imageHash);
+            hasMatch = (leftInfo.type != GraphicPieceInfo::Type::Image) || leftInfo.imageHash.isSimilar(rightInfo.imageHash);
             const int elementCount = leftInfo.pagePath.elementCount();
             for (int i = 0; i < elementCount && hasMatch; ++i)
             {
@@ -1794,9 +2609,189 @@ void PDFDiffHelper::refineTextRectangles(PDFDiffResult::RectInfos& items)
     items = std::move(refinedItems);
 }
 
+PDFDiffResultXMLSink::PDFDiffResultXMLSink(QIODevice* device) :
+    m_stream(device)
+{
+
+}
+
+void PDFDiffResultXMLSink::beginReport(const PDFDiffResult& summary)
+{
+    m_pageSequence = summary.getPageSequence();
+
+    m_stream.setAutoFormatting(true);
+    m_stream.setAutoFormattingIndent(2);
+    m_stream.writeStartDocument();
+    m_stream.writeNamespace("https://github.com/JakubMelka/PDF4QT", "pdf4qt");
+    m_stream.writeStartElement("difference-report");
+    m_stream.writeAttribute("unchanged-pages", QString::number(summary.getUnchangedPageCount()));
+    m_stream.writeStartElement("differences");
+}
+
+void PDFDiffResultXMLSink::writeDifferences(const PDFDiffResult& result)
+{
+    const size_t count = result.getDifferencesCount();
+    for (size_t i = 0; i < count; ++i)
+    {
+        result.saveDifferenceToStream(&m_stream, i);
+    }
+    m_writtenDifferencesCount += count;
+}
+
+void PDFDiffResultXMLSink::endReport()
+{
+    m_stream.writeEndElement();
+
+    PDFDiffResult pageSequenceResult;
+    pageSequenceResult.setPageSequence(std::move(m_pageSequence));
+    pageSequenceResult.savePageSequenceToStream(&m_stream);
+    m_pageSequence.clear();
+
+    m_stream.writeEndElement();
+    m_stream.writeEndDocument();
+}
+
+PDFDiffResultNDJSONSink::PDFDiffResultNDJSONSink(QIODevice* device) :
+    m_device(device)
+{
+
+}
+
+void PDFDiffResultNDJSONSink::beginReport(const PDFDiffResult& summary)
+{
+    QJsonArray pageSequence;
+    for (const PDFDiffResult::PageSequenceItem& item : summary.getPageSequence())
+    {
+        QJsonValue left = item.leftPage != -1 ? QJsonValue(qint64(item.leftPage + 1)) : QJsonValue();
+        QJsonValue right = item.rightPage != -1 ? QJsonValue(qint64(item.rightPage + 1)) : QJsonValue();
+        pageSequence.append(QJsonArray({ left, right }));
+    }
+
+    QJsonObject report;
+    report["unchanged-pages"] = qint64(summary.getUnchangedPageCount());
+    report["page-sequence"] = pageSequence;
+
+    QJsonObject object;
+    object["report"] = report;
+
+    m_device->write(QJsonDocument(object).toJson(QJsonDocument::Compact));
+    m_device->write("\n");
+}
+
+void PDFDiffResultNDJSONSink::writeDifferences(const PDFDiffResult& result)
+{
+    const size_t count = result.getDifferencesCount();
+    for (size_t i = 0; i < count; ++i)
+    {
+        m_device->write(QJsonDocument(result.saveDifferenceToJson(i)).toJson(QJsonDocument::Compact));
+        m_device->write("\n");
+    }
+    m_writtenDifferencesCount += count;
+}
+
+void PDFDiffResultNDJSONSink::endReport()
+{
+
+}
+
+PDFOperationResult PDFDiffNDJSONResultFile::open(const QString& fileName)
+{
+    m_fileName = fileName;
+    m_offsets.clear();
+    m_unchangedPageCount = 0;
+    m_pageSequence.clear();
+
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly))
+    {
+        return PDFDiff::tr("Cannot open file '%1'.").arg(fileName);
+    }
+
+    bool isReportRead = false;
+    while (!file.atEnd())
+    {
+        const qint64 offset = file.pos();
+        QByteArray line = file.readLine().trimmed();
+
+        if (line.isEmpty())
+        {
+            continue;
+        }
+
+        if (!isReportRead)
+        {
+            QJsonObject report = QJsonDocument::fromJson(line).object()["report"].toObject();
+            if (report.isEmpty())
+            {
+                return PDFDiff::tr("File '%1' is not a difference report.").arg(fileName);
+            }
+
+            m_unchangedPageCount = report["unchanged-pages"].toInteger();
+            for (const QJsonValue& value : report["page-sequence"].toArray())
+            {
+                QJsonArray item = value.toArray();
+                PDFDiffResult::PageSequenceItem pageSequenceItem;
+                pageSequenceItem.leftPage = item[0].toInteger(0) - 1;
+                pageSequenceItem.rightPage = item[1].toInteger(0) - 1;
+                m_pageSequence.push_back(pageSequenceItem);
+            }
+
+            isReportRead = true;
+            continue;
+        }
+
+        m_offsets.push_back(offset);
+    }
+
+    if (!isReportRead)
+    {
+        return PDFDiff::tr("File '%1' is not a difference report.").arg(fileName);
+    }
+
+    return true;
+}
+
+PDFDiffResult PDFDiffNDJSONResultFile::read(size_t index, size_t count) const
+{
+    PDFDiffResult result;
+
+    QFile file(m_fileName);
+    if (index >= m_offsets.size() || !file.open(QFile::ReadOnly))
+    {
+        return result;
+    }
+
+    const size_t end = qMin(index + count, m_offsets.size());
+    for (size_t i = index; i < end; ++i)
+    {
+        QJsonParseError error = { };
+        QJsonDocument document;
+
+        if (file.seek(m_offsets[i]))
+        {
+            document = QJsonDocument::fromJson(file.readLine(), &error);
+        }
+        else
+        {
+            error.error = QJsonParseError::IllegalValue;
+        }
+
+        if (error.error != QJsonParseError::NoError)
+        {
+            result.setResult(PDFDiff::tr("Invalid difference record %1 in file '%2'.").arg(i + 1).arg(m_fileName));
+            break;
+        }
+
+        result.loadDifferenceFromJson(document.object());
+    }
+
+    return result;
+}
+
 PDFDiffResultNavigator::PDFDiffResultNavigator(QObject* parent) :
     QObject(parent),
     m_diffResult(nullptr),
+    m_resultFile(nullptr),
     m_currentIndex(0)
 {
 
@@ -1816,6 +2811,30 @@ void PDFDiffResultNavigator::setResult(const PDFDiffResult* diffResult)
     }
 }
 
+void PDFDiffResultNavigator::setResultFile(const PDFDiffNDJSONResultFile* resultFile)
+{
+    if (m_resultFile != resultFile)
+    {
+        m_resultFile = resultFile;
+        Q_EMIT selectionChanged(m_currentIndex);
+    }
+}
+
+size_t PDFDiffResultNavigator::getLimit() const
+{
+    if (m_diffResult)
+    {
+        return m_diffResult->getDifferencesCount();
+    }
+
+    if (m_resultFile)
+    {
+        return m_resultFile->getDifferencesCount();
+    }
+
+    return 0;
+}
+
 bool PDFDiffResultNavigator::isSelected() const
 {
     const size_t limit = getLimit();
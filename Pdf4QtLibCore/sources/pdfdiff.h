@@ -29,14 +29,16 @@
 #include "pdfalgorithmlcs.h"
 #include "pdfdocumenttextflow.h"
 
+#include <QMutex>
 #include <QObject>
 #include <QFuture>
 #include <QFutureWatcher>
+#include <QXmlStreamWriter>
 
 #include <atomic>
 
 class QIODevice;
-class QXmlStreamWriter;
+class QJsonObject;
 
 namespace pdf
 {
@@ -136,6 +138,11 @@ public:
     /// Returns sorted changed page indices from right document
     std::vector<PDFInteger> getChangedRightPageIndices() const;
 
+    /// Returns number of page pairs, which were recognized as unchanged
+    /// by their fingerprints (content streams and resources are identical),
+    /// and for which the content comparation was skipped.
+    size_t getUnchangedPageCount() const { return m_unchangedPageCount; }
+
     /// Filters results using given critera
     /// \param filterPageMoveDifferences Filter page move differences?
     /// \param filterTextDifferences Filter text diffferences?
@@ -164,8 +171,22 @@ public:
     /// \param string Output string
     void saveToXML(QString* string) const;
 
+    /// Saves single difference as element 'difference' to a XML stream
+    /// \param stream Output stream
+    /// \param index Index of difference
+    void saveDifferenceToStream(QXmlStreamWriter* stream, size_t index) const;
+
+    /// Saves page sequence as element 'page-sequence' to a XML stream
+    /// \param stream Output stream
+    void savePageSequenceToStream(QXmlStreamWriter* stream) const;
+
+    /// Returns single difference as JSON object (used in NDJSON reports)
+    /// \param index Index of difference
+    QJsonObject saveDifferenceToJson(size_t index) const;
+
 private:
     friend class PDFDiff;
+    friend class PDFDiffNDJSONResultFile;
 
     static constexpr uint32_t FLAGS_PAGE_MOVE = uint32_t(Type::PageMoved) | uint32_t(Type::PageAdded) | uint32_t(Type::PageRemoved);
     static constexpr uint32_t FLAGS_TEXT = uint32_t(Type::RemovedTextCharContent) | uint32_t(Type::AddedTextCharContent) | uint32_t(Type::TextReplaced) | uint32_t(Type::TextAdded) | uint32_t(Type::TextRemoved);
@@ -203,9 +224,17 @@ private:
                          const RectInfos& rectInfos2);
 
     void saveToStream(QXmlStreamWriter* stream) const;
+    void loadDifferenceFromJson(const QJsonObject& object);
+
+    static QString getTypeName(Type type);
+    static Type getTypeFromName(const QString& name);
 
     void finalize();
 
+    /// Appends differences of another result (page sequence is not appended)
+    /// \param result Result
+    void append(const PDFDiffResult& result);
+
     uint32_t getTypeFlags(size_t index) const;
 
     /// Single content difference descriptor. It describes type
@@ -238,6 +267,96 @@ private:
     QStringList m_strings;
     uint32_t m_typeFlags = 0;
     PageSequence m_pageSequence;
+    size_t m_unchangedPageCount = 0;
+};
+
+/// Sink for differences, which are written progressively during the streaming
+/// comparation. Report begins with a summary (page sequence, page moves and
+/// unchanged pages), then differences are written in chunks, as page windows
+/// are being compared, and finally, report is ended.
+class PDF4QTLIBCORESHARED_EXPORT PDFDiffResultSink
+{
+public:
+    explicit PDFDiffResultSink() = default;
+    virtual ~PDFDiffResultSink() = default;
+
+    /// Begins the report
+    /// \param summary Result containing page sequence, but no differences
+    virtual void beginReport(const PDFDiffResult& summary) = 0;
+
+    /// Writes differences from a chunk of compared pages
+    /// \param result Result containing differences of the chunk
+    virtual void writeDifferences(const PDFDiffResult& result) = 0;
+
+    /// Ends the report
+    virtual void endReport() = 0;
+
+    /// Returns number of differences written so far
+    size_t getWrittenDifferencesCount() const { return m_writtenDifferencesCount; }
+
+protected:
+    size_t m_writtenDifferencesCount = 0;
+};
+
+/// Writes differences progressively to a XML stream, using the same
+/// format as \p PDFDiffResult::saveToXML.
+class PDF4QTLIBCORESHARED_EXPORT PDFDiffResultXMLSink : public PDFDiffResultSink
+{
+public:
+    explicit PDFDiffResultXMLSink(QIODevice* device);
+
+    virtual void beginReport(const PDFDiffResult& summary) override;
+    virtual void writeDifferences(const PDFDiffResult& result) override;
+    virtual void endReport() override;
+
+private:
+    QXmlStreamWriter m_stream;
+    PDFDiffResult::PageSequence m_pageSequence;
+};
+
+/// Writes differences progressively as NDJSON (one JSON object per line).
+/// First line contains the report summary (object with key 'report'),
+/// each following line contains single difference.
+class PDF4QTLIBCORESHARED_EXPORT PDFDiffResultNDJSONSink : public PDFDiffResultSink
+{
+public:
+    explicit PDFDiffResultNDJSONSink(QIODevice* device);
+
+    virtual void beginReport(const PDFDiffResult& summary) override;
+    virtual void writeDifferences(const PDFDiffResult& result) override;
+    virtual void endReport() override;
+
+private:
+    QIODevice* m_device;
+};
+
+/// Difference report stored in NDJSON file (written by \p PDFDiffResultNDJSONSink).
+/// Only file offsets of the differences are kept in memory, differences
+/// are read from the file on demand.
+class PDF4QTLIBCORESHARED_EXPORT PDFDiffNDJSONResultFile
+{
+public:
+    explicit PDFDiffNDJSONResultFile() = default;
+
+    /// Opens report file and indexes its differences
+    /// \param fileName File name
+    PDFOperationResult open(const QString& fileName);
+
+    size_t getDifferencesCount() const { return m_offsets.size(); }
+    size_t getUnchangedPageCount() const { return m_unchangedPageCount; }
+    const PDFDiffResult::PageSequence& getPageSequence() const { return m_pageSequence; }
+
+    /// Reads differences with indices [index, index + count) from the file.
+    /// Differences in the returned result are indexed from zero.
+    /// \param index Index of first difference
+    /// \param count Number of differences
+    PDFDiffResult read(size_t index, size_t count) const;
+
+private:
+    QString m_fileName;
+    std::vector<qint64> m_offsets;
+    size_t m_unchangedPageCount = 0;
+    PDFDiffResult::PageSequence m_pageSequence;
 };
 
 /// Class for result navigation, can go to next, or previous result.
@@ -251,6 +370,11 @@ public:
 
     void setResult(const PDFDiffResult* diffResult);
 
+    /// Sets result stored in a file. Differences are not loaded,
+    /// they can be read lazily for a current index.
+    /// \param resultFile Result file
+    void setResultFile(const PDFDiffNDJSONResultFile* resultFile);
+
     /// Returns true, if valid result is selected
     bool isSelected() const;
 
@@ -281,9 +405,10 @@ signals:
     void selectionChanged(size_t currentIndex);
 
 private:
-    size_t getLimit() const { return m_diffResult ? m_diffResult->getDifferencesCount() : 0; }
+    size_t getLimit() const;
 
     const PDFDiffResult* m_diffResult;
+    const PDFDiffNDJSONResultFile* m_resultFile;
     size_t m_currentIndex;
 };
 
@@ -309,6 +434,8 @@ public:
         PC_Mesh                 = 0x0010,   ///< Use mesh to compare pages (determine, which pages correspond to each other)
         CompareTextsAsVector    = 0x0020,   ///< Compare texts as vector graphics
         CompareWords            = 0x0040,   ///< Compare words, not just characters
+        SkipUnchangedPages      = 0x0080,   ///< Skip comparation of pages with identical content streams and resources
+        IncrementalResults      = 0x0100,   ///< Publish partial results during asynchronous comparation
     };
     Q_DECLARE_FLAGS(Options, Option)
 
@@ -337,6 +464,26 @@ public:
     /// \param enable Enable or disable option?
     void setOption(Option option, bool enable) { m_options.setFlag(option, enable); }
 
+    static constexpr size_t DEFAULT_STREAMING_WINDOW_SIZE = 32;
+
+    /// Sets result sink. If sink is set, comparation is streamed - differences
+    /// are not accumulated in the result, but they are written to the sink
+    /// progressively. Matched page ranges are compared in windows of a given
+    /// size, and page content is released after the window is compared, so
+    /// memory consumption doesn't depend on document size. Result then contains
+    /// only page sequence and page moves. Pages can be matched only by exact
+    /// page hash in this mode.
+    /// \param resultSink Result sink (or nullptr to disable streaming)
+    /// \param windowSize Number of page pairs compared at once
+    void setResultSink(PDFDiffResultSink* resultSink, size_t windowSize = DEFAULT_STREAMING_WINDOW_SIZE);
+
+    /// Sets pages, which should be compared first, when incremental results
+    /// are enabled (for example, pages visible in the viewer). Priority pages
+    /// can be changed while comparation is running.
+    /// \param leftPages Page indices of the left document
+    /// \param rightPages Page indices of the right document
+    void setPriorityPages(std::vector<PDFInteger> leftPages, std::vector<PDFInteger> rightPages);
+
     /// Starts comparator engine. If asynchronous engine option
     /// is enabled, then separate thread is started, in which two
     /// document is compared, and then signal \p comparationFinished,
@@ -350,16 +497,30 @@ public:
     /// Returns result of a comparation process
     const PDFDiffResult& getResult() const { return m_result; }
 
+    /// Returns true, if partial result of a running comparation is available
+    bool hasPartialResult() const;
+
+    /// Returns partial result of a running comparation. It contains page
+    /// sequence, page moves and differences of page ranges, which were
+    /// already compared. Partial result is available only if option
+    /// \p IncrementalResults is enabled.
+    PDFDiffResult getPartialResult() const;
+
     PDFDocumentTextFlowFactory::Algorithm getTextAnalysisAlgorithm() const;
     void setTextAnalysisAlgorithm(PDFDocumentTextFlowFactory::Algorithm textAnalysisAlgorithm);
 
 signals:
     void comparationFinished();
 
+    /// This signal is emitted from the comparation thread, when a new
+    /// partial result is available (see \p getPartialResult).
+    void partialResultAvailable();
+
 private:
 
     enum Steps
     {
+        StepCalculateFingerprints,
         StepExtractContentLeftDocument,
         StepExtractContentRightDocument,
         StepMatchPages,
@@ -374,6 +535,12 @@ private:
     void performSteps(const std::vector<PDFInteger>& leftPages,
                       const std::vector<PDFInteger>& rightPages,
                       PDFDiffResult& result);
+    void performFingerprintMatching(std::vector<PDFDiffPageContext>& leftPreparedPages,
+                                    std::vector<PDFDiffPageContext>& rightPreparedPages);
+    void performContentExtraction(const PDFDocument* document,
+                                  const std::vector<PDFDiffPageContext*>& contexts);
+    void performTextExtraction(const PDFDocument* document,
+                               const std::vector<PDFDiffPageContext*>& contexts);
     void performPageMatching(const std::vector<PDFDiffPageContext>& leftPreparedPages,
                              const std::vector<PDFDiffPageContext>& rightPreparedPages,
                              PDFAlgorithmLongestCommonSubsequenceBase::Sequence& pageSequence,
@@ -383,10 +550,49 @@ private:
                         PDFAlgorithmLongestCommonSubsequenceBase::Sequence& pageSequence,
                         const std::map<size_t, size_t>& pageMatches,
                         PDFDiffResult& result);
+    void performStreamingCompare(std::vector<PDFDiffPageContext>& leftPreparedPages,
+                                 std::vector<PDFDiffPageContext>& rightPreparedPages,
+                                 PDFAlgorithmLongestCommonSubsequenceBase::Sequence& pageSequence,
+                                 const std::map<size_t, size_t>& pageMatches,
+                                 PDFDiffResult& result);
+    void performIncrementalCompare(std::vector<PDFDiffPageContext>& leftPreparedPages,
+                                   std::vector<PDFDiffPageContext>& rightPreparedPages,
+                                   PDFAlgorithmLongestCommonSubsequenceBase::Sequence& pageSequence,
+                                   const std::map<size_t, size_t>& pageMatches,
+                                   PDFDiffResult& result);
+    void performCompareWindow(std::vector<PDFDiffPageContext>& leftPreparedPages,
+                              std::vector<PDFDiffPageContext>& rightPreparedPages,
+                              const PDFAlgorithmLongestCommonSubsequenceBase::SequenceItemRanges& window,
+                              PDFDiffResult& result);
+    void performComparePageSequence(const std::vector<PDFDiffPageContext>& leftPreparedPages,
+                                    const std::vector<PDFDiffPageContext>& rightPreparedPages,
+                                    const PDFAlgorithmLongestCommonSubsequenceBase::Sequence& pageSequence,
+                                    const std::map<size_t, size_t>& pageMatches,
+                                    PDFDiffResult& result);
+    void performCompareRanges(const std::vector<PDFDiffPageContext>& leftPreparedPages,
+                              const std::vector<PDFDiffPageContext>& rightPreparedPages,
+                              const PDFAlgorithmLongestCommonSubsequenceBase::SequenceItemRanges& modifiedRanges,
+                              PDFDiffResult& result);
     void finalizeGraphicsPieces(PDFDiffPageContext& context);
+    void publishPartialResult(const PDFDiffResult& result);
+
+    /// Returns true, if results are published progressively, and text
+    /// is extracted just before the page range is compared.
+    bool isIncrementalCompare() const;
+
+    /// Splits modified page ranges of a sequence into windows of a given size.
+    /// Long ranges are split into several windows, short ranges are merged
+    /// into one window.
+    /// \param pageSequence Page sequence
+    /// \param windowSize Maximal number of page pairs in a window
+    static std::vector<PDFAlgorithmLongestCommonSubsequenceBase::SequenceItemRanges> createCompareWindows(PDFAlgorithmLongestCommonSubsequenceBase::Sequence& pageSequence,
+                                                                                                            size_t windowSize);
 
     void onComparationPerformed();
 
+    static constexpr size_t INCREMENTAL_WINDOW_SIZE = 4;
+    static constexpr qint64 PARTIAL_RESULT_INTERVAL_MS = 250;
+
     /// Calculates real epsilon for a page. Epsilon is used in page
     /// comparation process, where points closer that epsilon
     /// are recognized as equal.
@@ -403,6 +609,14 @@ private:
     std::atomic_bool m_cancelled;
     PDFDiffResult m_result;
     PDFDocumentTextFlowFactory::Algorithm m_textAnalysisAlgorithm;
+    PDFDiffResultSink* m_resultSink;
+    size_t m_streamingWindowSize;
+
+    mutable QMutex m_partialResultMutex;
+    PDFDiffResult m_partialResult;
+    bool m_hasPartialResult;
+    std::vector<PDFInteger> m_priorityLeftPages;
+    std::vector<PDFInteger> m_priorityRightPages;
 
     QFuture<PDFDiffResult> m_future;
     std::optional<QFutureWatcher<PDFDiffResult>> m_futureWatcher;
@@ -25,16 +25,402 @@
 #include "pdfexception.h"
 #include "pdfstreamfilters.h"
 #include "pdfconstants.h"
+#include "pdfjbig2decoder.h"
+#include "pdfpagecontentprocessor.h"
+#include "pdfpattern.h"
 #include "pdfdbgheap.h"
 
+#include <QMutex>
+
+#include <set>
+#include <atomic>
+#include <utility>
+
 namespace pdf
 {
 
+struct PDFObjectStorage::LazyLoadingState
+{
+    explicit LazyLoadingState(std::unique_ptr<PDFObjectStorageLoader> loader, size_t count) :
+        loader(std::move(loader)),
+        loaded(count)
+    {
+
+    }
+
+    std::unique_ptr<PDFObjectStorageLoader> loader;
+    std::vector<std::atomic_bool> loaded;
+    std::set<PDFInteger> loadingObjects;
+    QRecursiveMutex mutex;
+};
+
 static constexpr const char* PDF_DOCUMENT_INFO_ENTRY = "Info";
 
 QByteArray PDFObjectStorage::getDecodedStream(const PDFStream* stream) const
 {
-    return PDFStreamFilterStorage::getDecodedStream(stream, std::bind(QOverload<const PDFObject&>::of(&PDFObjectStorage::getObject), this, std::placeholders::_1), getSecurityHandler());
+    auto decode = [this, stream]()
+    {
+        return PDFStreamFilterStorage::getDecodedStream(stream, std::bind(QOverload<const PDFObject&>::of(&PDFObjectStorage::getObject), this, std::placeholders::_1), getSecurityHandler());
+    };
+
+    if (m_decodedStreamCache && stream)
+    {
+        return m_decodedStreamCache->getDecodedStream(stream, decode);
+    }
+
+    return decode();
+}
+
+PDFStreamReaderPointer PDFObjectStorage::createDecodedStreamReader(const PDFStream* stream) const
+{
+    return PDFStreamFilterStorage::createDecodedStreamReader(stream, std::bind(QOverload<const PDFObject&>::of(&PDFObjectStorage::getObject), this, std::placeholders::_1), getSecurityHandler());
+}
+
+void PDFObjectStorage::setDecodedStreamCacheBudget(qint64 budget)
+{
+    if (budget > 0)
+    {
+        m_decodedStreamCache = std::make_shared<PDFDecodedStreamCache>(budget);
+    }
+    else
+    {
+        m_decodedStreamCache.reset();
+    }
+}
+
+PDFDecodedStreamCacheStatistics PDFObjectStorage::getDecodedStreamCacheStatistics() const
+{
+    if (m_decodedStreamCache)
+    {
+        return m_decodedStreamCache->getStatistics();
+    }
+
+    return PDFDecodedStreamCacheStatistics();
+}
+
+void PDFObjectStorage::setSecurityHandler(PDFSecurityHandlerPointer handler)
+{
+    m_securityHandler = qMove(handler);
+
+    // Decoded data depend on the security handler
+    if (m_decodedStreamCache)
+    {
+        m_decodedStreamCache->clear();
+    }
+}
+
+PDFDecodedStreamCache::PDFDecodedStreamCache(qint64 budget)
+{
+    m_cache.setMaxCost(budget);
+}
+
+QByteArray PDFDecodedStreamCache::getDecodedStream(const PDFStream* stream, const std::function<QByteArray()>& decode)
+{
+    const quint64 key = stream->getUniqueId();
+
+    {
+        QMutexLocker lock(&m_mutex);
+        if (const QByteArray* data = m_cache.object(key))
+        {
+            ++m_hits;
+            return *data;
+        }
+
+        ++m_misses;
+    }
+
+    QByteArray decodedData = decode();
+
+    QMutexLocker lock(&m_mutex);
+    if (!m_cache.contains(key))
+    {
+        // Cost must be at least one, otherwise empty streams would not be limited
+        m_cache.insert(key, new QByteArray(decodedData), qMax<qsizetype>(decodedData.size(), 1));
+    }
+
+    return decodedData;
+}
+
+void PDFDecodedStreamCache::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_cache.clear();
+}
+
+PDFDecodedStreamCacheStatistics PDFDecodedStreamCache::getStatistics() const
+{
+    QMutexLocker lock(&m_mutex);
+
+    PDFDecodedStreamCacheStatistics statistics;
+    statistics.hits = m_hits;
+    statistics.misses = m_misses;
+    statistics.size = m_cache.totalCost();
+    statistics.budget = m_cache.maxCost();
+    return statistics;
+}
+
+qint64 PDFDecodedStreamCache::getBudget() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_cache.maxCost();
+}
+
+void PDFDecodedStreamCache::collectMemoryUsage(PDFMemoryReport* report) const
+{
+    QMutexLocker lock(&m_mutex);
+    report->addItem(PDFTranslationContext::tr("Decoded streams"), m_cache.totalCost(), m_cache.count());
+}
+
+PDFImageCache::PDFImageCache(qint64 budget)
+{
+    m_cache.setMaxCost(qMax<qint64>(budget, 0));
+}
+
+PDFImageCache::Image PDFImageCache::getImage(const Key& key, const std::function<bool(Image&)>& create)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        if (const Image* image = m_cache.object(key))
+        {
+            ++m_hits;
+            return *image;
+        }
+
+        ++m_misses;
+    }
+
+    Image image;
+    if (create(image) && !image.image.isNull())
+    {
+        QMutexLocker lock(&m_mutex);
+        if (m_cache.maxCost() > 0 && !m_cache.contains(key))
+        {
+            // Image data are implicitly shared, so cached image costs no memory,
+            // as long as the image is also used elsewhere (in compiled page).
+            m_cache.insert(key, new Image(image), qMax<qsizetype>(image.image.sizeInBytes(), 1));
+        }
+    }
+
+    return image;
+}
+
+void PDFImageCache::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_cache.clear();
+}
+
+PDFImageCacheStatistics PDFImageCache::getStatistics() const
+{
+    QMutexLocker lock(&m_mutex);
+
+    PDFImageCacheStatistics statistics;
+    statistics.hits = m_hits;
+    statistics.misses = m_misses;
+    statistics.size = m_cache.totalCost();
+    statistics.budget = m_cache.maxCost();
+    return statistics;
+}
+
+qint64 PDFImageCache::getBudget() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_cache.maxCost();
+}
+
+void PDFImageCache::setBudget(qint64 budget)
+{
+    QMutexLocker lock(&m_mutex);
+    m_cache.setMaxCost(qMax<qint64>(budget, 0));
+}
+
+void PDFImageCache::collectMemoryUsage(PDFMemoryReport* report) const
+{
+    QMutexLocker lock(&m_mutex);
+    report->addItem(PDFTranslationContext::tr("Images"), m_cache.totalCost(), m_cache.count());
+}
+
+PDFJBIG2GlobalsCache::PDFJBIG2GlobalsCache(qint64 budget)
+{
+    m_cache.setMaxCost(qMax<qint64>(budget, 0));
+}
+
+std::shared_ptr<const PDFJBIG2Globals> PDFJBIG2GlobalsCache::getGlobals(const PDFStream* stream, const std::function<std::shared_ptr<const PDFJBIG2Globals>()>& decode)
+{
+    const quint64 key = stream->getUniqueId();
+
+    {
+        QMutexLocker lock(&m_mutex);
+        if (const std::shared_ptr<const PDFJBIG2Globals>* globals = m_cache.object(key))
+        {
+            return *globals;
+        }
+    }
+
+    std::shared_ptr<const PDFJBIG2Globals> globals = decode();
+
+    if (globals)
+    {
+        QMutexLocker lock(&m_mutex);
+        if (!m_cache.contains(key))
+        {
+            m_cache.insert(key, new std::shared_ptr<const PDFJBIG2Globals>(globals), qMax<qint64>(globals->getSize(), 1));
+        }
+    }
+
+    return globals;
+}
+
+void PDFJBIG2GlobalsCache::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_cache.clear();
+}
+
+void PDFJBIG2GlobalsCache::collectMemoryUsage(PDFMemoryReport* report) const
+{
+    QMutexLocker lock(&m_mutex);
+    report->addItem(PDFTranslationContext::tr("JBIG2 global segments"), m_cache.totalCost(), m_cache.count());
+}
+
+PDFCompiledContentStreamCache::PDFCompiledContentStreamCache(qint64 budget)
+{
+    m_cache.setMaxCost(qMax<qint64>(budget, 0));
+}
+
+std::shared_ptr<const PDFCompiledContentStream> PDFCompiledContentStreamCache::getCompiledContentStream(const PDFStream* stream, const std::function<std::shared_ptr<const PDFCompiledContentStream>()>& compile)
+{
+    const quint64 key = stream->getUniqueId();
+
+    {
+        QMutexLocker lock(&m_mutex);
+        if (const std::shared_ptr<const PDFCompiledContentStream>* compiledContentStream = m_cache.object(key))
+        {
+            return *compiledContentStream;
+        }
+    }
+
+    std::shared_ptr<const PDFCompiledContentStream> compiledContentStream = compile();
+
+    if (compiledContentStream)
+    {
+        QMutexLocker lock(&m_mutex);
+        if (!m_cache.contains(key))
+        {
+            m_cache.insert(key, new std::shared_ptr<const PDFCompiledContentStream>(compiledContentStream), qMax<qint64>(compiledContentStream->memoryConsumptionEstimate, 1));
+        }
+    }
+
+    return compiledContentStream;
+}
+
+void PDFCompiledContentStreamCache::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_cache.clear();
+}
+
+void PDFCompiledContentStreamCache::collectMemoryUsage(PDFMemoryReport* report) const
+{
+    QMutexLocker lock(&m_mutex);
+    report->addItem(PDFTranslationContext::tr("Compiled content streams"), m_cache.totalCost(), m_cache.count());
+}
+
+PDFShadingMeshCache::PDFShadingMeshCache(qint64 budget)
+{
+    m_cache.setMaxCost(qMax<qint64>(budget, 0));
+}
+
+PDFShadingMeshCache::Mesh PDFShadingMeshCache::getMesh(const Key& key, const std::function<bool(Mesh&)>& create)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        if (const Mesh* mesh = m_cache.object(key))
+        {
+            return *mesh;
+        }
+    }
+
+    Mesh mesh;
+    if (create(mesh) && mesh.mesh)
+    {
+        QMutexLocker lock(&m_mutex);
+        if (m_cache.maxCost() > 0 && !m_cache.contains(key))
+        {
+            m_cache.insert(key, new Mesh(mesh), qMax<qint64>(mesh.mesh->getMemoryConsumptionEstimate(), 1));
+        }
+    }
+
+    return mesh;
+}
+
+void PDFShadingMeshCache::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_cache.clear();
+}
+
+qint64 PDFShadingMeshCache::getBudget() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_cache.maxCost();
+}
+
+void PDFShadingMeshCache::collectMemoryUsage(PDFMemoryReport* report) const
+{
+    QMutexLocker lock(&m_mutex);
+    report->addItem(PDFTranslationContext::tr("Shading meshes"), m_cache.totalCost(), m_cache.count());
+}
+
+PDFResourceCache::PDFResourceCache(qint64 budget)
+{
+    m_cache.setMaxCost(qMax<qint64>(budget, 0));
+}
+
+QSharedPointer<PDFAbstractColorSpace> PDFResourceCache::getColorSpace(const Key& key, const std::function<QSharedPointer<PDFAbstractColorSpace>()>& create)
+{
+    return getResource(key, [&create]() { return Resource{ create(), nullptr }; }).colorSpace;
+}
+
+std::shared_ptr<PDFPattern> PDFResourceCache::getPattern(const Key& key, const std::function<std::shared_ptr<PDFPattern>()>& create)
+{
+    return getResource(key, [&create]() { return Resource{ nullptr, create() }; }).pattern;
+}
+
+PDFResourceCache::Resource PDFResourceCache::getResource(const Key& key, const std::function<Resource()>& create)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        if (const Resource* resource = m_cache.object(key))
+        {
+            return *resource;
+        }
+    }
+
+    Resource resource = create();
+
+    if (resource.colorSpace || resource.pattern)
+    {
+        QMutexLocker lock(&m_mutex);
+        if (m_cache.maxCost() > 0 && !m_cache.contains(key))
+        {
+            m_cache.insert(key, new Resource(resource), RESOURCE_SIZE_ESTIMATE + key.name.size());
+        }
+    }
+
+    return resource;
+}
+
+void PDFResourceCache::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_cache.clear();
+}
+
+void PDFResourceCache::collectMemoryUsage(PDFMemoryReport* report) const
+{
+    QMutexLocker lock(&m_mutex);
+    report->addItem(PDFTranslationContext::tr("Resolved resources"), m_cache.totalCost(), m_cache.count());
 }
 
 PDFDocument::~PDFDocument()
@@ -42,6 +428,82 @@ PDFDocument::~PDFDocument()
 
 }
 
+PDFDocument::PDFDocument(const PDFDocument& other) :
+    m_pdfObjectStorage(other.m_pdfObjectStorage),
+    m_info(other.m_info),
+    m_catalog(other.m_catalog),
+    m_sourceDataHash(other.m_sourceDataHash),
+    m_imageCache(other.m_imageCache),
+    m_jbig2GlobalsCache(other.m_jbig2GlobalsCache),
+    m_compiledContentStreamCache(other.m_compiledContentStreamCache),
+    m_shadingMeshCache(other.m_shadingMeshCache),
+    m_resourceCache(std::make_shared<PDFResourceCache>(DEFAULT_RESOURCE_CACHE_BUDGET))
+{
+    m_catalog.setStorage(&m_pdfObjectStorage);
+}
+
+PDFDocument::PDFDocument(PDFDocument&& other) :
+    m_pdfObjectStorage(std::move(other.m_pdfObjectStorage)),
+    m_info(std::move(other.m_info)),
+    m_catalog(std::move(other.m_catalog)),
+    m_sourceDataHash(std::move(other.m_sourceDataHash)),
+    m_imageCache(std::move(other.m_imageCache)),
+    m_jbig2GlobalsCache(std::move(other.m_jbig2GlobalsCache)),
+    m_compiledContentStreamCache(std::move(other.m_compiledContentStreamCache)),
+    m_shadingMeshCache(std::move(other.m_shadingMeshCache)),
+    m_resourceCache(std::move(other.m_resourceCache))
+{
+    m_catalog.setStorage(&m_pdfObjectStorage);
+}
+
+PDFDocument& PDFDocument::operator=(const PDFDocument& other)
+{
+    if (this != &other)
+    {
+        m_pdfObjectStorage = other.m_pdfObjectStorage;
+        m_info = other.m_info;
+        m_catalog = other.m_catalog;
+        m_sourceDataHash = other.m_sourceDataHash;
+        m_imageCache = other.m_imageCache;
+        m_jbig2GlobalsCache = other.m_jbig2GlobalsCache;
+        m_compiledContentStreamCache = other.m_compiledContentStreamCache;
+        m_shadingMeshCache = other.m_shadingMeshCache;
+        m_resourceCache = std::make_shared<PDFResourceCache>(DEFAULT_RESOURCE_CACHE_BUDGET);
+        m_catalog.setStorage(&m_pdfObjectStorage);
+    }
+
+    return *this;
+}
+
+PDFDocument& PDFDocument::operator=(PDFDocument&& other)
+{
+    if (this != &other)
+    {
+        m_pdfObjectStorage = std::move(other.m_pdfObjectStorage);
+        m_info = std::move(other.m_info);
+        m_catalog = std::move(other.m_catalog);
+        m_sourceDataHash = std::move(other.m_sourceDataHash);
+        m_imageCache = std::move(other.m_imageCache);
+        m_jbig2GlobalsCache = std::move(other.m_jbig2GlobalsCache);
+        m_compiledContentStreamCache = std::move(other.m_compiledContentStreamCache);
+        m_shadingMeshCache = std::move(other.m_shadingMeshCache);
+        m_resourceCache = std::move(other.m_resourceCache);
+        m_catalog.setStorage(&m_pdfObjectStorage);
+    }
+
+    return *this;
+}
+
+void PDFDocument::collectMemoryUsage(PDFMemoryReport* report) const
+{
+    m_pdfObjectStorage.collectMemoryUsage(report);
+    m_imageCache->collectMemoryUsage(report);
+    m_jbig2GlobalsCache->collectMemoryUsage(report);
+    m_compiledContentStreamCache->collectMemoryUsage(report);
+    m_shadingMeshCache->collectMemoryUsage(report);
+    m_resourceCache->collectMemoryUsage(report);
+}
+
 bool PDFDocument::operator==(const PDFDocument& other) const
 {
     // Document is considered equal, if storage is equal
@@ -73,6 +535,11 @@ QByteArray PDFDocument::getDecodedStream(const PDFStream* stream) const
     return m_pdfObjectStorage.getDecodedStream(stream);
 }
 
+PDFStreamReaderPointer PDFDocument::createDecodedStreamReader(const PDFStream* stream) const
+{
+    return m_pdfObjectStorage.createDecodedStreamReader(stream);
+}
+
 const PDFDictionary* PDFDocument::getTrailerDictionary() const
 {
     const PDFObject& trailerDictionary = m_pdfObjectStorage.getTrailerDictionary();
@@ -126,20 +593,70 @@ void PDFDocument::initInfo()
     }
 }
 
+PDFObjectStorage::PDFObjectStorage(const PDFObjectStorage& other) :
+    m_objects(other.getObjects().share()),
+    m_trailerDictionary(other.m_trailerDictionary),
+    m_securityHandler(other.m_securityHandler),
+    m_sourceDataOwner(other.m_sourceDataOwner)
+{
+    if (other.m_decodedStreamCache)
+    {
+        setDecodedStreamCacheBudget(other.m_decodedStreamCache->getBudget());
+    }
+}
+
+PDFObjectStorage::PDFObjectStorage(PDFObjects&& objects,
+                                   PDFObject&& trailerDictionary,
+                                   PDFSecurityHandlerPointer&& securityHandler,
+                                   std::unique_ptr<PDFObjectStorageLoader> loader) :
+    m_objects(std::move(objects)),
+    m_trailerDictionary(std::move(trailerDictionary)),
+    m_securityHandler(std::move(securityHandler))
+{
+    if (loader)
+    {
+        m_lazyLoadingState = std::make_shared<LazyLoadingState>(std::move(loader), m_objects.size());
+    }
+}
+
+PDFObjectStorage& PDFObjectStorage::operator=(const PDFObjectStorage& other)
+{
+    if (this != &other)
+    {
+        m_objects = other.getObjects().share();
+        m_trailerDictionary = other.m_trailerDictionary;
+        m_securityHandler = other.m_securityHandler;
+        m_sourceDataOwner = other.m_sourceDataOwner;
+        m_lazyLoadingState.reset();
+        setDecodedStreamCacheBudget(other.m_decodedStreamCache ? other.m_decodedStreamCache->getBudget() : 0);
+    }
+
+    return *this;
+}
+
 bool PDFObjectStorage::operator==(const PDFObjectStorage& other) const
 {
     // We compare just content. Security handler just defines encryption behavior.
-    return m_objects == other.m_objects &&
+    return getObjects() == other.getObjects() &&
            m_trailerDictionary == other.m_trailerDictionary;
 }
 
 const PDFObject& PDFObjectStorage::getObject(PDFObjectReference reference) const
 {
+    // Objects are mutable, so we must access them using const reference,
+    // otherwise chunks shared with other storages would be copied.
+    const PDFObjects& objects = m_objects;
+
     if (reference.objectNumber >= 0 &&
-        reference.objectNumber < static_cast<PDFInteger>(m_objects.size()) &&
-        m_objects[reference.objectNumber].generation == reference.generation)
+        reference.objectNumber < static_cast<PDFInteger>(objects.size()) &&
+        objects[reference.objectNumber].generation == reference.generation)
     {
-        return m_objects[reference.objectNumber].object;
+        if (m_lazyLoadingState)
+        {
+            loadObject(reference);
+        }
+
+        return objects[reference.objectNumber].object;
     }
     else
     {
@@ -148,8 +665,231 @@ const PDFObject& PDFObjectStorage::getObject(PDFObjectReference reference) const
     }
 }
 
+const PDFObject& PDFObjectStorage::preloadObject(PDFInteger objectNumber) const
+{
+    if (objectNumber >= 0 && objectNumber < static_cast<PDFInteger>(m_objects.size()))
+    {
+        return getObject(PDFObjectReference(objectNumber, std::as_const(m_objects)[objectNumber].generation));
+    }
+
+    static const PDFObject dummy;
+    return dummy;
+}
+
+PDFObjectStorage::Entry PDFObjectStorage::readEntry(PDFInteger objectNumber) const
+{
+    const PDFObjects& objects = m_objects;
+
+    if (objectNumber < 0 || objectNumber >= static_cast<PDFInteger>(objects.size()))
+    {
+        return Entry();
+    }
+
+    LazyLoadingState* state = m_lazyLoadingState.get();
+    const size_t index = static_cast<size_t>(objectNumber);
+    if (!state || index >= state->loaded.size() || state->loaded[index].load(std::memory_order_acquire))
+    {
+        return objects[index];
+    }
+
+    QMutexLocker lock(&state->mutex);
+
+    const PDFInteger generation = objects[index].generation;
+    if (state->loaded[index].load(std::memory_order_relaxed))
+    {
+        // Object was loaded by another thread meanwhile
+        return objects[index];
+    }
+
+    if (state->loadingObjects.count(objectNumber))
+    {
+        // Cyclic reference, object is being loaded by this thread
+        return Entry(generation, PDFObject());
+    }
+
+    state->loadingObjects.insert(objectNumber);
+
+    PDFObject object;
+    try
+    {
+        object = state->loader->loadObject(this, PDFObjectReference(objectNumber, generation));
+    }
+    catch (const PDFException&)
+    {
+        // Object can't be loaded, it will be null object
+        object = PDFObject();
+    }
+
+    state->loadingObjects.erase(objectNumber);
+    return Entry(generation, qMove(object));
+}
+
+const PDFObjectStorage::PDFObjects& PDFObjectStorage::getObjects() const
+{
+    loadAllObjects();
+    return m_objects;
+}
+
+static qint64 getObjectMemoryConsumptionEstimate(const PDFObject& object);
+
+static qint64 getDictionaryMemoryConsumptionEstimate(const PDFDictionary* dictionary)
+{
+    qint64 result = 0;
+
+    for (size_t i = 0; i < dictionary->getCount(); ++i)
+    {
+        result += sizeof(PDFInplaceOrMemoryString) + getObjectMemoryConsumptionEstimate(dictionary->getValue(i));
+    }
+
+    return result;
+}
+
+static qint64 getObjectMemoryConsumptionEstimate(const PDFObject& object)
+{
+    qint64 result = sizeof(PDFObject);
+
+    switch (object.getType())
+    {
+        case PDFObject::Type::String:
+        case PDFObject::Type::Name:
+            result += object.getString().size();
+            break;
+
+        case PDFObject::Type::Array:
+        {
+            const PDFArray* array = object.getArray();
+            for (size_t i = 0; i < array->getCount(); ++i)
+            {
+                result += getObjectMemoryConsumptionEstimate(array->getItem(i));
+            }
+            break;
+        }
+
+        case PDFObject::Type::Dictionary:
+            result += getDictionaryMemoryConsumptionEstimate(object.getDictionary());
+            break;
+
+        case PDFObject::Type::Stream:
+        {
+            const PDFStream* stream = object.getStream();
+            result += getDictionaryMemoryConsumptionEstimate(stream->getDictionary());
+
+            if (!stream->isContentExternal())
+            {
+                result += stream->getContent()->size();
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    return result;
+}
+
+/// Returns true, if objects have the same content. Contents of arrays,
+/// dictionaries and streams are compared by identity, not by value.
+static bool isSameObjectContent(const PDFObject& left, const PDFObject& right)
+{
+    if (left.getType() != right.getType())
+    {
+        return false;
+    }
+
+    switch (left.getType())
+    {
+        case PDFObject::Type::Array:
+            return left.getArray() == right.getArray();
+
+        case PDFObject::Type::Dictionary:
+            return left.getDictionary() == right.getDictionary();
+
+        case PDFObject::Type::Stream:
+            return left.getStream() == right.getStream();
+
+        default:
+            return left == right;
+    }
+}
+
+qint64 PDFObjectStorage::getMemoryConsumptionEstimate(const PDFObjectStorage* baseStorage) const
+{
+    const PDFObjects& objects = getObjects();
+    const PDFObjects* baseObjects = baseStorage ? &baseStorage->getObjects() : nullptr;
+    constexpr size_t chunkSize = PDFObjects::getChunkSize();
+
+    qint64 result = 0;
+    size_t index = 0;
+    while (index < objects.size())
+    {
+        if (baseObjects && objects.isSharedWith(index, *baseObjects))
+        {
+            // Whole chunk is shared with the base storage
+            index = (index / chunkSize + 1) * chunkSize;
+            continue;
+        }
+
+        const PDFObject& object = objects[index].object;
+        result += sizeof(Entry);
+
+        if (!baseObjects || index >= baseObjects->size() || !isSameObjectContent(object, (*baseObjects)[index].object))
+        {
+            // Object itself is already counted in the entry
+            result += getObjectMemoryConsumptionEstimate(object) - qint64(sizeof(PDFObject));
+        }
+
+        ++index;
+    }
+
+    return result;
+}
+
+void PDFObjectStorage::collectMemoryUsage(PDFMemoryReport* report) const
+{
+    qint64 bytes = 0;
+    qint64 count = 0;
+
+    {
+        // Objects of the lazy storage are written under the lock, so we must
+        // hold it, while we are reading them. Objects are not loaded.
+        std::optional<QMutexLocker<QRecursiveMutex>> lock;
+        if (m_lazyLoadingState)
+        {
+            lock.emplace(&m_lazyLoadingState->mutex);
+        }
+
+        const PDFObjects& objects = std::as_const(m_objects);
+        for (size_t i = 0; i < objects.size(); ++i)
+        {
+            const PDFObject& object = objects[i].object;
+            bytes += sizeof(Entry) + getObjectMemoryConsumptionEstimate(object) - qint64(sizeof(PDFObject));
+
+            if (!object.isNull())
+            {
+                ++count;
+            }
+        }
+    }
+
+    report->addItem(PDFTranslationContext::tr("Objects"), bytes, count);
+
+    if (m_decodedStreamCache)
+    {
+        m_decodedStreamCache->collectMemoryUsage(report);
+    }
+}
+
+void PDFObjectStorage::setObjects(PDFObjects&& objects)
+{
+    m_lazyLoadingState.reset();
+    m_objects = qMove(objects);
+}
+
 PDFObjectReference PDFObjectStorage::addObject(PDFObject object)
 {
+    detachLazyLoading();
+
     PDFObjectReference reference(m_objects.size(), 0);
     m_objects.emplace_back(0, qMove(object));
     return reference;
@@ -157,9 +897,72 @@ PDFObjectReference PDFObjectStorage::addObject(PDFObject object)
 
 void PDFObjectStorage::setObject(PDFObjectReference reference, PDFObject object)
 {
+    detachLazyLoading();
+
     m_objects[reference.objectNumber] = Entry(reference.generation, qMove(object));
 }
 
+void PDFObjectStorage::loadObject(PDFObjectReference reference) const
+{
+    LazyLoadingState* state = m_lazyLoadingState.get();
+    Q_ASSERT(state);
+
+    const size_t index = static_cast<size_t>(reference.objectNumber);
+    if (index >= state->loaded.size() || state->loaded[index].load(std::memory_order_acquire))
+    {
+        // Object is already loaded
+        return;
+    }
+
+    // Mutex is recursive, because loading of the object can request
+    // another object (for example, length of the stream).
+    QMutexLocker lock(&state->mutex);
+
+    // Object can be loaded by another thread meanwhile. If object is being loaded
+    // by this thread (cyclic reference), then we return it unloaded, i.e. null object.
+    if (state->loaded[index].load(std::memory_order_relaxed) || state->loadingObjects.count(reference.objectNumber))
+    {
+        return;
+    }
+
+    state->loadingObjects.insert(reference.objectNumber);
+
+    PDFObject object;
+    try
+    {
+        object = state->loader->loadObject(this, reference);
+    }
+    catch (const PDFException&)
+    {
+        // Object can't be loaded, it will be null object
+        object = PDFObject();
+    }
+
+    state->loadingObjects.erase(reference.objectNumber);
+    m_objects[index].object = qMove(object);
+    state->loaded[index].store(true, std::memory_order_release);
+}
+
+void PDFObjectStorage::loadAllObjects() const
+{
+    if (!m_lazyLoadingState)
+    {
+        return;
+    }
+
+    const PDFInteger count = static_cast<PDFInteger>(m_objects.size());
+    for (PDFInteger objectNumber = 0; objectNumber < count; ++objectNumber)
+    {
+        loadObject(PDFObjectReference(objectNumber, std::as_const(m_objects)[objectNumber].generation));
+    }
+}
+
+void PDFObjectStorage::detachLazyLoading()
+{
+    loadAllObjects();
+    m_lazyLoadingState.reset();
+}
+
 void PDFObjectStorage::updateTrailerDictionary(PDFObject trailerDictionary)
 {
     m_trailerDictionary = PDFObjectManipulator::merge(m_trailerDictionary, trailerDictionary, PDFObjectManipulator::RemoveNullObjects);
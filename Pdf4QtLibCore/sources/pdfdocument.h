@@ -24,32 +24,392 @@
 #define PDFDOCUMENT_H
 
 #include "pdfglobal.h"
+#include "pdfconstants.h"
 #include "pdfobject.h"
 #include "pdfcatalog.h"
 #include "pdfsecurityhandler.h"
+#include "pdfutils.h"
+#include "pdfmemoryreport.h"
+#include "pdfstreamfilters.h"
 
 #include <QColor>
 #include <QTransform>
 #include <QDateTime>
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+#include <QSharedPointer>
 
 #include <optional>
+#include <functional>
 
 namespace pdf
 {
 class PDFDocument;
 class PDFDocumentBuilder;
+class PDFObjectStorage;
+class PDFJBIG2Globals;
+class PDFMesh;
+class PDFPattern;
+class PDFAbstractColorSpace;
+struct PDFCompiledContentStream;
+
+/// Loader of objects for lazy object storage. Objects are loaded,
+/// when they are accessed for the first time. Loader is always called
+/// under the lock of the storage, so it doesn't need to be thread safe.
+class PDFObjectStorageLoader
+{
+public:
+    virtual ~PDFObjectStorageLoader() = default;
+
+    /// Loads object with given reference. Loader can access other objects
+    /// of the storage, they are loaded recursively. Can throw exception.
+    /// \param storage Storage, which requests the object
+    /// \param reference Reference of the object
+    virtual PDFObject loadObject(const PDFObjectStorage* storage, PDFObjectReference reference) = 0;
+};
+
+struct PDFDecodedStreamCacheStatistics
+{
+    qint64 hits = 0;    ///< Count of decoded streams taken from the cache
+    qint64 misses = 0;  ///< Count of decoded streams, which were not in the cache
+    qint64 size = 0;    ///< Total size of cached decoded streams in bytes
+    qint64 budget = 0;  ///< Maximal total size of cached decoded streams in bytes
+};
+
+/// Cache of decoded stream data. Streams are identified by their unique id,
+/// so copies of the same stream share the cached data. When total size of decoded
+/// data exceeds the budget, least recently used streams are removed from the cache.
+/// Streams, which are larger than the budget, are not cached at all. This class is thread safe.
+class PDF4QTLIBCORESHARED_EXPORT PDFDecodedStreamCache : public PDFMemoryAccountable
+{
+public:
+    /// Creates cache with given budget
+    /// \param budget Maximal total size of decoded data in bytes
+    explicit PDFDecodedStreamCache(qint64 budget);
+
+    /// Returns decoded data of the stream. If stream is not in the cache,
+    /// it is decoded using \p decode function and inserted into the cache.
+    /// Decoding is performed outside the lock, so multiple threads can decode streams
+    /// simultaneously (if two threads decode the same stream, it is decoded twice).
+    /// \param stream Stream
+    /// \param decode Decoding function
+    QByteArray getDecodedStream(const PDFStream* stream, const std::function<QByteArray()>& decode);
+
+    /// Removes all cached data
+    void clear();
+
+    /// Returns statistics of the cache
+    PDFDecodedStreamCacheStatistics getStatistics() const;
+
+    /// Returns budget of the cache in bytes
+    qint64 getBudget() const;
+
+    /// Adds consumed memory of the cache into the report
+    /// \param report Report
+    virtual void collectMemoryUsage(PDFMemoryReport* report) const override;
+
+private:
+    mutable QMutex m_mutex;
+    QCache<quint64, QByteArray> m_cache;
+    qint64 m_hits = 0;
+    qint64 m_misses = 0;
+};
+
+/// Statistics of the image cache
+struct PDFImageCacheStatistics
+{
+    qint64 hits = 0;    ///< Count of images taken from the cache
+    qint64 misses = 0;  ///< Count of images, which were not in the cache
+    qint64 size = 0;    ///< Total size of cached images in bytes
+    qint64 budget = 0;  ///< Maximal total size of cached images in bytes
+};
+
+/// Cache of images converted to the device color space. Image XObjects shared
+/// by multiple pages (logos, page backgrounds) are then decoded and converted only once,
+/// even if pages are compiled in different threads. When total size of images exceeds
+/// the budget, least recently used images are removed from the cache. This class is thread safe.
+class PDF4QTLIBCORESHARED_EXPORT PDFImageCache : public PDFMemoryAccountable
+{
+public:
+    /// Creates cache with given budget
+    /// \param budget Maximal total size of images in bytes
+    explicit PDFImageCache(qint64 budget);
+
+    /// Key of the cached image. Image is identified by the unique id of its stream,
+    /// and by all parameters, which affect the conversion.
+    struct Key
+    {
+        quint64 streamId = 0;       ///< Unique id of the image stream
+        quint64 cmsId = 0;          ///< Unique id of the color management system
+        int renderingIntent = 0;    ///< Rendering intent
+        int scaleDenominator = 1;   ///< Denominator of the reduced resolution of the image
+        QRect visibleArea;          ///< Visible area of the image in image pixels (null rectangle - whole image)
+
+        bool operator==(const Key&) const = default;
+    };
+
+    /// Cached image
+    struct Image
+    {
+        QImage image;       ///< Image converted to the device color space
+        QRectF imageRect;   ///< Part of the image space covered by the image
+    };
+
+    /// Returns cached image. If image is not in the cache, it is created using
+    /// \p create function. Image is inserted into the cache, if \p create succeeds (returns true).
+    /// Image is created outside the lock, so multiple threads can create images simultaneously.
+    /// \param key Key of the image
+    /// \param create Function creating the image
+    Image getImage(const Key& key, const std::function<bool(Image&)>& create);
+
+    /// Removes all cached images
+    void clear();
+
+    /// Returns statistics of the cache
+    PDFImageCacheStatistics getStatistics() const;
+
+    /// Returns budget of the cache in bytes
+    qint64 getBudget() const;
+
+    /// Sets budget of the cache. Zero budget disables the cache.
+    /// \param budget Maximal total size of images in bytes
+    void setBudget(qint64 budget);
+
+    /// Adds consumed memory of the cache into the report
+    /// \param report Report
+    virtual void collectMemoryUsage(PDFMemoryReport* report) const override;
+
+private:
+    mutable QMutex m_mutex;
+    QCache<Key, Image> m_cache;
+    qint64 m_hits = 0;
+    qint64 m_misses = 0;
+};
+
+inline size_t qHash(const PDFImageCache::Key& key, size_t seed = 0)
+{
+    return qHashMulti(seed, key.streamId, key.cmsId, key.renderingIntent, key.scaleDenominator, key.visibleArea.x(), key.visibleArea.y(), key.visibleArea.width(), key.visibleArea.height());
+}
+
+/// Cache of decoded global segments of JBIG2 images (JBIG2Globals streams). Scanned
+/// documents often use one global stream for images of all pages, so symbol dictionaries
+/// and code tables are decoded only once. Global segments are immutable and shared
+/// by all decoders. Streams are identified by their unique id. This class is thread safe.
+class PDF4QTLIBCORESHARED_EXPORT PDFJBIG2GlobalsCache : public PDFMemoryAccountable
+{
+public:
+    /// Creates cache with given budget
+    /// \param budget Maximal total size of decoded global segments in bytes
+    explicit PDFJBIG2GlobalsCache(qint64 budget);
+
+    /// Returns decoded global segments of the stream. If they are not in the cache,
+    /// they are decoded using \p decode function and inserted into the cache, if decoding
+    /// succeeds (returns non-null segments). Decoding is performed outside the lock.
+    /// \param stream Stream containing global segments
+    /// \param decode Decoding function
+    std::shared_ptr<const PDFJBIG2Globals> getGlobals(const PDFStream* stream, const std::function<std::shared_ptr<const PDFJBIG2Globals>()>& decode);
+
+    /// Removes all cached global segments
+    void clear();
+
+    /// Adds consumed memory of the cache into the report
+    /// \param report Report
+    virtual void collectMemoryUsage(PDFMemoryReport* report) const override;
+
+private:
+    mutable QMutex m_mutex;
+    QCache<quint64, std::shared_ptr<const PDFJBIG2Globals>> m_cache;
+};
+
+/// Cache of compiled content streams (content streams of pages and forms). Content stream is
+/// parsed only once to the compact bytecode, which is then shared by all processors of the
+/// document (renderers, text layout generators, etc.), so content stream is not parsed again,
+/// when page is processed repeatedly. Streams are identified by their unique id. This class is thread safe.
+class PDF4QTLIBCORESHARED_EXPORT PDFCompiledContentStreamCache : public PDFMemoryAccountable
+{
+public:
+    /// Creates cache with given budget
+    /// \param budget Maximal total size of compiled content streams in bytes
+    explicit PDFCompiledContentStreamCache(qint64 budget);
+
+    /// Returns compiled content stream. If it is not in the cache, it is compiled using
+    /// \p compile function and inserted into the cache. Compilation is performed outside the lock.
+    /// \param stream Content stream
+    /// \param compile Compilation function
+    std::shared_ptr<const PDFCompiledContentStream> getCompiledContentStream(const PDFStream* stream, const std::function<std::shared_ptr<const PDFCompiledContentStream>()>& compile);
+
+    /// Removes all compiled content streams
+    void clear();
+
+    /// Adds consumed memory of the cache into the report
+    /// \param report Report
+    virtual void collectMemoryUsage(PDFMemoryReport* report) const override;
+
+private:
+    mutable QMutex m_mutex;
+    QCache<quint64, std::shared_ptr<const PDFCompiledContentStream>> m_cache;
+};
+
+/// Cache of meshes of free-form, lattice-form, coons patch and tensor product patch
+/// shadings (shading types 4-7). Meshing of these shadings is expensive, so mesh is
+/// created only once for each resolution bucket and reused, when page is compiled again
+/// (for example, for different zoom). Cached mesh is stored together with the matrix,
+/// which was used to create it, so it can be transformed to the device space of a different
+/// matrix, if mesh resolution in pattern space is similar. This class is thread safe.
+class PDF4QTLIBCORESHARED_EXPORT PDFShadingMeshCache : public PDFMemoryAccountable
+{
+public:
+    /// Creates cache with given budget
+    /// \param budget Maximal total size of cached meshes in bytes
+    explicit PDFShadingMeshCache(qint64 budget);
+
+    /// Key of the cached mesh. Mesh is identified by the unique id of the shading stream,
+    /// and by all parameters, which affect the meshing.
+    struct Key
+    {
+        quint64 streamId = 0;                               ///< Unique id of the shading stream
+        quint64 cmsId = 0;                                  ///< Unique id of the color management system
+        int renderingIntent = 0;                            ///< Rendering intent
+        int resolutionBucket = 0;                           ///< Bucket of the preferred mesh resolution in pattern space
+        PDFReal minimalMeshResolutionRatio = 0.0;           ///< Minimal mesh resolution ratio of the quality settings
+        PDFReal preferredMeshResolutionRatio = 0.0;         ///< Preferred mesh resolution ratio of the quality settings
+        PDFReal tolerance = 0.0;                            ///< Color tolerance of the quality settings
+        PDFInteger patchTestPoints = 0;                     ///< Patch test points of the quality settings
+        PDFReal patchResolutionMappingRatioLow = 0.0;       ///< Lower curvature mapping ratio of the quality settings
+        PDFReal patchResolutionMappingRatioHigh = 0.0;      ///< Higher curvature mapping ratio of the quality settings
+
+        bool operator==(const Key&) const = default;
+    };
+
+    /// Cached mesh
+    struct Mesh
+    {
+        std::shared_ptr<const PDFMesh> mesh;                ///< Mesh in device space
+        QTransform patternSpaceToDeviceSpaceMatrix;         ///< Matrix used to create the mesh
+    };
+
+    /// Returns cached mesh. If mesh is not in the cache, it is created using
+    /// \p create function. Mesh is inserted into the cache, if \p create succeeds (returns true).
+    /// Mesh is created outside the lock, so multiple threads can create meshes simultaneously.
+    /// \param key Key of the mesh
+    /// \param create Function creating the mesh
+    Mesh getMesh(const Key& key, const std::function<bool(Mesh&)>& create);
+
+    /// Removes all cached meshes
+    void clear();
+
+    /// Returns budget of the cache in bytes
+    qint64 getBudget() const;
+
+    /// Adds consumed memory of the cache into the report
+    /// \param report Report
+    virtual void collectMemoryUsage(PDFMemoryReport* report) const override;
+
+private:
+    mutable QMutex m_mutex;
+    QCache<Key, Mesh> m_cache;
+};
+
+inline size_t qHash(const PDFShadingMeshCache::Key& key, size_t seed = 0)
+{
+    return qHashMulti(seed, key.streamId, key.cmsId, key.renderingIntent, key.resolutionBucket, key.minimalMeshResolutionRatio, key.preferredMeshResolutionRatio,
+                      key.tolerance, key.patchTestPoints, key.patchResolutionMappingRatioLow, key.patchResolutionMappingRatioHigh);
+}
+
+/// Cache of resources resolved by content stream processors (color spaces, patterns
+/// and shadings), so they are not created again each time the operator (for example,
+/// cs, scn or sh) refers to them. Resources are identified by the resource dictionary,
+/// which is shared by all pages and forms using the same resources, and by the resource name.
+/// Document is immutable, so resource dictionaries are valid during the whole lifetime
+/// of the document. For this reason, cache is never shared with copies of the document.
+/// This class is thread safe.
+class PDF4QTLIBCORESHARED_EXPORT PDFResourceCache : public PDFMemoryAccountable
+{
+public:
+    /// Creates cache with given budget
+    /// \param budget Maximal total size of cached resources in bytes (estimate)
+    explicit PDFResourceCache(qint64 budget);
+
+    enum class ResourceType
+    {
+        ColorSpace,
+        Pattern,
+        Shading
+    };
+
+    /// Key of the cached resource. Color spaces of patterns and shadings can be
+    /// referenced by name, so color space dictionary is part of the key. Colors
+    /// of patterns (for example, background color) depend on the color management
+    /// system, so it is also part of the key of patterns and shadings.
+    struct Key
+    {
+        ResourceType type = ResourceType::ColorSpace;       ///< Type of the resource
+        const PDFDictionary* dictionary = nullptr;          ///< Resource dictionary (ColorSpace, Pattern or Shading)
+        const PDFDictionary* colorSpaceDictionary = nullptr;///< Color space resource dictionary
+        QByteArray name;                                    ///< Name of the resource
+        quint64 cmsId = 0;                                  ///< Unique id of the color management system
+        int renderingIntent = 0;                            ///< Rendering intent
+
+        bool operator==(const Key&) const = default;
+    };
+
+    /// Returns cached color space. If color space is not in the cache, it is created
+    /// using \p create function and inserted into the cache, if it is valid. Function
+    /// \p create can throw an exception, which is propagated to the caller.
+    /// \param key Key of the color space
+    /// \param create Function creating the color space
+    QSharedPointer<PDFAbstractColorSpace> getColorSpace(const Key& key, const std::function<QSharedPointer<PDFAbstractColorSpace>()>& create);
+
+    /// Returns cached pattern (or shading pattern). If pattern is not in the cache, it is
+    /// created using \p create function and inserted into the cache, if it is valid.
+    /// Function \p create can throw an exception, which is propagated to the caller.
+    /// \param key Key of the pattern
+    /// \param create Function creating the pattern
+    std::shared_ptr<PDFPattern> getPattern(const Key& key, const std::function<std::shared_ptr<PDFPattern>()>& create);
+
+    /// Removes all cached resources
+    void clear();
+
+    /// Adds consumed memory of the cache into the report
+    /// \param report Report
+    virtual void collectMemoryUsage(PDFMemoryReport* report) const override;
+
+private:
+    struct Resource
+    {
+        QSharedPointer<PDFAbstractColorSpace> colorSpace;
+        std::shared_ptr<PDFPattern> pattern;
+    };
+
+    Resource getResource(const Key& key, const std::function<Resource()>& create);
+
+    /// Estimated size of one cached resource in bytes
+    static constexpr qint64 RESOURCE_SIZE_ESTIMATE = 1024;
+
+    mutable QMutex m_mutex;
+    QCache<Key, Resource> m_cache;
+};
+
+inline size_t qHash(const PDFResourceCache::Key& key, size_t seed = 0)
+{
+    return qHashMulti(seed, int(key.type), quintptr(key.dictionary), quintptr(key.colorSpaceDictionary), key.name, key.cmsId, key.renderingIntent);
+}
 
 /// Storage for objects. This class is not thread safe for writing (calling non-const functions). Caller must ensure
 /// locking, if this object is used from multiple threads. Calling const functions should be thread safe.
-class PDF4QTLIBCORESHARED_EXPORT PDFObjectStorage
+class PDF4QTLIBCORESHARED_EXPORT PDFObjectStorage : public PDFMemoryAccountable
 {
 public:
     inline PDFObjectStorage() = default;
 
-    inline PDFObjectStorage(const PDFObjectStorage&) = default;
+    /// Copies the storage. If other storage is lazy, all its objects
+    /// are loaded, and copy is not lazy. Objects are not copied, they are shared
+    /// with the other storage, until they are modified.
+    PDFObjectStorage(const PDFObjectStorage& other);
     inline PDFObjectStorage(PDFObjectStorage&&) = default;
 
-    inline PDFObjectStorage& operator=(const PDFObjectStorage&) = default;
+    PDFObjectStorage& operator=(const PDFObjectStorage& other);
     inline PDFObjectStorage& operator=(PDFObjectStorage&&) = default;
 
     bool operator==(const PDFObjectStorage& other) const;
@@ -67,7 +427,9 @@ public:
         PDFObject object;
     };
 
-    using PDFObjects = std::vector<Entry>;
+    /// Objects are stored in shared chunks. Copy of the storage shares chunks with the
+    /// original storage, and when object is modified, only the chunk containing it is copied.
+    using PDFObjects = PDFSharedChunkedVector<Entry>;
 
     explicit PDFObjectStorage(PDFObjects&& objects, PDFObject&& trailerDictionary, PDFSecurityHandlerPointer&& securityHandler) :
         m_objects(std::move(objects)),
@@ -77,6 +439,12 @@ public:
 
     }
 
+    /// Creates lazy storage. Objects are not loaded, only generation numbers of entries
+    /// must be filled. Object is loaded by \p loader, when it is accessed for the first time.
+    /// Const functions remain thread safe. Calling non-const function, which modifies
+    /// objects, loads all objects and storage ceases to be lazy.
+    explicit PDFObjectStorage(PDFObjects&& objects, PDFObject&& trailerDictionary, PDFSecurityHandlerPointer&& securityHandler, std::unique_ptr<PDFObjectStorageLoader> loader);
+
     /// Returns object from the object storage. If invalid reference is passed,
     /// then null object is returned (no exception is thrown).
     const PDFObject& getObject(PDFObjectReference reference) const;
@@ -95,14 +463,40 @@ public:
     /// is returned (no exception is thrown).
     const PDFObject& getObjectByReference(PDFObjectReference reference) const;
 
-    /// Returns array of objects stored in this storage
-    const PDFObjects& getObjects() const { return m_objects; }
-
-    /// Returns array of objects stored in this storage
-    PDFObjects& getObjects() { return m_objects; }
+    /// Returns array of objects stored in this storage. If storage
+    /// is lazy, then all objects are loaded.
+    const PDFObjects& getObjects() const;
 
     /// Sets array of objects
-    void setObjects(PDFObjects&& objects) { m_objects = qMove(objects); }
+    void setObjects(PDFObjects&& objects);
+
+    /// Returns true, if objects are loaded on demand
+    bool isLazy() const { return m_lazyLoadingState != nullptr; }
+
+    /// Returns count of object entries in this storage (objects are not loaded)
+    size_t getObjectCount() const { return m_objects.size(); }
+
+    /// Returns estimate of memory (in bytes) consumed by objects of this storage,
+    /// which is not shared with the storage \p baseStorage. Chunks of objects shared
+    /// between the storages, and object contents shared between the corresponding
+    /// objects, are not counted. If storage is lazy, then all objects are loaded.
+    /// \param baseStorage Base storage (can be nullptr, then all objects are counted)
+    qint64 getMemoryConsumptionEstimate(const PDFObjectStorage* baseStorage) const;
+
+    /// Returns object with given object number. If storage is lazy and object
+    /// is not loaded yet, it is loaded. This function is thread safe, so it can
+    /// be used to load objects of lazy storage in the background. If invalid
+    /// object number is passed, then null object is returned.
+    /// \param objectNumber Object number
+    const PDFObject& preloadObject(PDFInteger objectNumber) const;
+
+    /// Returns entry with given object number. If storage is lazy and object
+    /// is not loaded yet, it is parsed from the source data, but it is not stored
+    /// in the storage, so objects of large documents can be processed one by one,
+    /// without all of them being held in the memory. If invalid object number
+    /// is passed, then entry with null object is returned.
+    /// \param objectNumber Object number
+    Entry readEntry(PDFInteger objectNumber) const;
 
     /// Returns trailer dictionary
     const PDFObject& getTrailerDictionary() const { return m_trailerDictionary; }
@@ -111,7 +505,7 @@ public:
     const PDFSecurityHandler* getSecurityHandler() const { return m_securityHandler.data(); }
 
     /// Sets security handler associated with these objects
-    void setSecurityHandler(PDFSecurityHandlerPointer handler) { m_securityHandler = qMove(handler); }
+    void setSecurityHandler(PDFSecurityHandlerPointer handler);
 
     /// Adds a new object to the object list. This function
     /// is not thread safe, do not call it from multiple threads.
@@ -131,18 +525,67 @@ public:
     void updateTrailerDictionary(PDFObject trailerDictionary);
 
     /// Returns the decoded stream. If stream data cannot be decoded,
-    /// then empty byte array is returned.
+    /// then empty byte array is returned. If decoded stream cache is
+    /// enabled, then decoded data are taken from the cache, if possible.
     /// \param stream Stream to be decoded
     QByteArray getDecodedStream(const PDFStream* stream) const;
 
+    /// Returns reader, which decodes the stream incrementally, so decoded
+    /// data don't have to be held in the memory. Decoded data are not
+    /// stored in the decoded stream cache. If stream data cannot be decoded,
+    /// exception is thrown during reading.
+    /// \param stream Stream to be decoded
+    PDFStreamReaderPointer createDecodedStreamReader(const PDFStream* stream) const;
+
+    /// Sets budget of the decoded stream cache. Decoded data of streams (for example,
+    /// content streams, fonts or images) are kept in the cache, so streams, which are
+    /// accessed repeatedly, are decoded only once. Zero or negative budget disables
+    /// the cache. Cache is disabled by default.
+    /// \param budget Maximal total size of cached decoded data in bytes
+    void setDecodedStreamCacheBudget(qint64 budget);
+
+    /// Returns statistics of the decoded stream cache. If cache is disabled,
+    /// then empty statistics is returned.
+    PDFDecodedStreamCacheStatistics getDecodedStreamCacheStatistics() const;
+
     /// Set trailer dictionary
     /// \param object Object defining trailer dictionary
     void setTrailerDictionary(const PDFObject& object) { m_trailerDictionary = object; }
 
+    /// Returns owner of the source data (for example, memory mapped file),
+    /// to which objects of this storage can refer.
+    const PDFStreamDataOwner& getSourceDataOwner() const { return m_sourceDataOwner; }
+
+    /// Sets owner of the source data. Source data are kept alive
+    /// as long as this storage exists.
+    /// \param sourceDataOwner Owner of the source data
+    void setSourceDataOwner(PDFStreamDataOwner sourceDataOwner) { m_sourceDataOwner = std::move(sourceDataOwner); }
+
+    /// Adds consumed memory of objects and of the decoded stream cache into the report.
+    /// Objects of the lazy storage, which were not loaded yet, are not loaded.
+    /// \param report Report
+    virtual void collectMemoryUsage(PDFMemoryReport* report) const override;
+
 private:
-    PDFObjects m_objects;
+    struct LazyLoadingState;
+
+    /// Loads object, if storage is lazy and object is not loaded yet
+    /// \param reference Reference of the object
+    void loadObject(PDFObjectReference reference) const;
+
+    /// Loads all objects, which were not loaded yet
+    void loadAllObjects() const;
+
+    /// Loads all objects and turns off lazy loading
+    void detachLazyLoading();
+
+    /// Objects are mutable, because lazy storage loads them in const functions
+    mutable PDFObjects m_objects;
     PDFObject m_trailerDictionary;
     PDFSecurityHandlerPointer m_securityHandler;
+    PDFStreamDataOwner m_sourceDataOwner;
+    std::shared_ptr<LazyLoadingState> m_lazyLoadingState;
+    std::shared_ptr<PDFDecodedStreamCache> m_decodedStreamCache;
 };
 
 /// Loads data from the object contained in the PDF document, such as integers,
@@ -406,7 +849,7 @@ private:
 };
 
 /// PDF document main class.
-class PDF4QTLIBCORESHARED_EXPORT PDFDocument
+class PDF4QTLIBCORESHARED_EXPORT PDFDocument : public PDFMemoryAccountable
 {
     Q_DECLARE_TR_FUNCTIONS(pdf::PDFDocument)
 
@@ -414,6 +857,13 @@ public:
     explicit PDFDocument() = default;
     ~PDFDocument();
 
+    /// Catalog refers to the object storage of the
+    /// document, so it must be rebound, when document is copied or moved.
+    PDFDocument(const PDFDocument& other);
+    PDFDocument(PDFDocument&& other);
+    PDFDocument& operator=(const PDFDocument& other);
+    PDFDocument& operator=(PDFDocument&& other);
+
     bool operator==(const PDFDocument& other) const;
     bool operator!=(const PDFDocument& other) const { return !(*this == other); }
 
@@ -448,6 +898,11 @@ public:
     /// \param stream Stream to be decoded
     QByteArray getDecodedStream(const PDFStream* stream) const;
 
+    /// Returns reader, which decodes the stream incrementally, in chunks.
+    /// If stream data cannot be decoded, exception is thrown during reading.
+    /// \param stream Stream to be decoded
+    PDFStreamReaderPointer createDecodedStreamReader(const PDFStream* stream) const;
+
     /// Returns the trailer dictionary
     const PDFDictionary* getTrailerDictionary() const;
 
@@ -456,6 +911,27 @@ public:
     /// header.
     QByteArray getVersion() const;
 
+    /// Returns cache of images converted to the device color space, which
+    /// is shared by all renderers of the document (it is never nullptr).
+    PDFImageCache* getImageCache() const { return m_imageCache.get(); }
+
+    /// Returns cache of decoded global segments of JBIG2 images, which
+    /// is shared by all renderers of the document (it is never nullptr).
+    PDFJBIG2GlobalsCache* getJBIG2GlobalsCache() const { return m_jbig2GlobalsCache.get(); }
+
+    /// Returns cache of compiled content streams, which is shared
+    /// by all processors of the document (it is never nullptr).
+    PDFCompiledContentStreamCache* getCompiledContentStreamCache() const { return m_compiledContentStreamCache.get(); }
+
+    /// Returns cache of meshes of shadings, which is shared
+    /// by all renderers of the document (it is never nullptr).
+    PDFShadingMeshCache* getShadingMeshCache() const { return m_shadingMeshCache.get(); }
+
+    /// Returns cache of color spaces, patterns and shadings resolved from resource
+    /// dictionaries, which is shared by all processors of the document (it is never nullptr).
+    /// Unlike other caches, this cache is not shared with copies of the document.
+    PDFResourceCache* getResourceCache() const { return m_resourceCache.get(); }
+
     explicit PDFDocument(PDFObjectStorage&& storage, PDFVersion version, QByteArray sourceDataHash) :
         m_pdfObjectStorage(std::move(storage)),
         m_sourceDataHash(std::move(sourceDataHash))
@@ -475,6 +951,11 @@ public:
      */
     const QByteArray& getSourceDataHash() const { return m_sourceDataHash; }
 
+    /// Adds consumed memory of the object storage and of all caches
+    /// of the document into the report
+    /// \param report Report
+    virtual void collectMemoryUsage(PDFMemoryReport* report) const override;
+
 private:
     friend class PDFDocumentReader;
     friend class PDFDocumentBuilder;
@@ -501,6 +982,21 @@ private:
     /// Hash of the source byte array's data,
     /// from which the document was created.
     QByteArray m_sourceDataHash;
+
+    /// Cache of converted images
+    std::shared_ptr<PDFImageCache> m_imageCache = std::make_shared<PDFImageCache>(DEFAULT_IMAGE_CACHE_BUDGET);
+
+    /// Cache of decoded global segments of JBIG2 images
+    std::shared_ptr<PDFJBIG2GlobalsCache> m_jbig2GlobalsCache = std::make_shared<PDFJBIG2GlobalsCache>(DEFAULT_JBIG2_GLOBALS_CACHE_BUDGET);
+
+    /// Cache of compiled content streams
+    std::shared_ptr<PDFCompiledContentStreamCache> m_compiledContentStreamCache = std::make_shared<PDFCompiledContentStreamCache>(DEFAULT_COMPILED_CONTENT_STREAM_CACHE_BUDGET);
+
+    /// Cache of meshes of shadings
+    std::shared_ptr<PDFShadingMeshCache> m_shadingMeshCache = std::make_shared<PDFShadingMeshCache>(DEFAULT_SHADING_MESH_CACHE_BUDGET);
+
+    /// Cache of resolved resources, valid only for this document
+    std::shared_ptr<PDFResourceCache> m_resourceCache = std::make_shared<PDFResourceCache>(DEFAULT_RESOURCE_CACHE_BUDGET);
 };
 
 using PDFDocumentPointer = QSharedPointer<PDFDocument>;
@@ -28,13 +28,22 @@
 #include "pdfnametreeloader.h"
 #include "pdfparser.h"
 #include "pdfstreamfilters.h"
+#include "pdfexecutionpolicy.h"
+#include "pdfutils.h"
+#include "pdfform.h"
+#include "pdfexception.h"
 
 #include <QBuffer>
+#include <QMutex>
 #include <QPainter>
 #include <QPdfWriter>
 
 #include "pdfdbgheap.h"
 
+#include <algorithm>
+#include <optional>
+#include <set>
+
 namespace pdf
 {
 
@@ -695,7 +704,7 @@ void PDFDocumentBuilder::reset()
 
 void PDFDocumentBuilder::createDocument()
 {
-    if (!m_storage.getObjects().empty())
+    if (m_storage.getObjectCount() > 0)
     {
         reset();
     }
@@ -715,7 +724,7 @@ void PDFDocumentBuilder::setDocument(const PDFDocument* document)
 
 PDFDocument PDFDocumentBuilder::build()
 {
-    updateTrailerDictionary(m_storage.getObjects().size());
+    updateTrailerDictionary(m_storage.getObjectCount());
     return PDFDocument(PDFObjectStorage(m_storage), m_version, QByteArray());
 }
 
@@ -1057,31 +1066,32 @@ void PDFPageContentStreamBuilder::replaceResources(PDFObjectReference contentStr
     }
 }
 
-void PDFDocumentBuilder::updateAnnotationAppearanceStreams(PDFObjectReference annotationReference)
+PDFDocumentBuilder::AnnotationAppearanceStreams PDFDocumentBuilder::createAnnotationAppearanceStreams(PDFObjectReference annotationReference) const
 {
+    AnnotationAppearanceStreams result;
+    result.annotationReference = annotationReference;
+
     PDFAnnotationPtr annotation = PDFAnnotation::parse(&m_storage, annotationReference);
     if (!annotation)
     {
-        return;
+        return result;
     }
 
     const PDFDictionary* pageDictionary = m_storage.getDictionaryFromObject(m_storage.getObject(annotation->getPageReference()));
     if (!pageDictionary)
     {
-        return;
+        return result;
     }
 
     PDFDocumentDataLoaderDecorator loader(&m_storage);
     QRectF mediaBox = loader.readRectangle(pageDictionary->get("MediaBox"), QRectF());
     if (!mediaBox.isValid())
     {
-        return;
+        return result;
     }
 
     std::vector<PDFAppeareanceStreams::Key> keys = annotation->getDrawKeys(m_formManager);
-    std::map<PDFAppeareanceStreams::Key, PDFObjectReference> appearanceStreams;
 
-    QRectF boundingRectangle;
     for (const PDFAppeareanceStreams::Key& key : keys)
     {
         PDFContentStreamBuilder builder(mediaBox.size(), PDFContentStreamBuilder::CoordinateSystem::PDF);
@@ -1100,7 +1110,24 @@ void PDFDocumentBuilder::updateAnnotationAppearanceStreams(PDFObjectReference an
             continue;
         }
 
-        boundingRectangle = boundingRectangle.united(parameters.boundingRectangle);
+        result.streams.push_back({ key, parameters.boundingRectangle, std::move(contentStream) });
+    }
+
+    return result;
+}
+
+void PDFDocumentBuilder::setAnnotationAppearanceStreams(AnnotationAppearanceStreams appearanceStreamsData)
+{
+    const PDFObjectReference annotationReference = appearanceStreamsData.annotationReference;
+    std::map<PDFAppeareanceStreams::Key, PDFObjectReference> appearanceStreams;
+
+    QRectF boundingRectangle;
+    for (AnnotationAppearanceStreams::Stream& stream : appearanceStreamsData.streams)
+    {
+        const PDFAppeareanceStreams::Key& key = stream.key;
+        PDFContentStreamBuilder::ContentStream& contentStream = stream.contentStream;
+
+        boundingRectangle = boundingRectangle.united(stream.boundingRectangle);
 
         std::vector<PDFObject> copiedObjects = copyFrom({ contentStream.resources, contentStream.contents }, contentStream.document.getStorage(), true);
         Q_ASSERT(copiedObjects.size() == 2);
@@ -1122,7 +1149,7 @@ void PDFDocumentBuilder::updateAnnotationAppearanceStreams(PDFObjectReference an
         formFactory.endDictionaryItem();
 
         formFactory.beginDictionaryItem("BBox");
-        formFactory << parameters.boundingRectangle;
+        formFactory << stream.boundingRectangle;
         formFactory.endDictionaryItem();
 
         formFactory.beginDictionaryItem("Resources");
@@ -1210,6 +1237,95 @@ void PDFDocumentBuilder::updateAnnotationAppearanceStreams(PDFObjectReference an
     }
 }
 
+void PDFDocumentBuilder::updateAnnotationAppearanceStreams(PDFObjectReference annotationReference)
+{
+    if (m_appearanceStreamsBatchUpdateLevel > 0)
+    {
+        m_appearanceStreamsBatch.push_back(annotationReference);
+        return;
+    }
+
+    setAnnotationAppearanceStreams(createAnnotationAppearanceStreams(annotationReference));
+}
+
+void PDFDocumentBuilder::updateAnnotationAppearanceStreams(std::vector<PDFObjectReference> annotationReferences)
+{
+    // Remove duplicates, but keep the order of annotations
+    std::set<PDFObjectReference> usedReferences;
+    annotationReferences.erase(std::remove_if(annotationReferences.begin(), annotationReferences.end(), [&usedReferences](PDFObjectReference reference) { return !usedReferences.insert(reference).second; }), annotationReferences.end());
+
+    if (m_appearanceStreamsBatchUpdateLevel > 0)
+    {
+        m_appearanceStreamsBatch.insert(m_appearanceStreamsBatch.end(), annotationReferences.cbegin(), annotationReferences.cend());
+        return;
+    }
+
+    // Form field editors, which are being edited, draw using GUI
+    // widgets style, so these must be created in the calling thread.
+    std::vector<AnnotationAppearanceStreams> appearanceStreams(annotationReferences.size());
+    std::vector<size_t> parallelIndices;
+    parallelIndices.reserve(annotationReferences.size());
+    for (size_t i = 0; i < annotationReferences.size(); ++i)
+    {
+        if (m_formManager && m_formManager->isEditorDrawEnabled(annotationReferences[i]))
+        {
+            appearanceStreams[i] = createAnnotationAppearanceStreams(annotationReferences[i]);
+        }
+        else
+        {
+            parallelIndices.push_back(i);
+        }
+    }
+
+    QMutex exceptionMutex;
+    std::optional<PDFException> exception;
+
+    auto createAppearanceStreams = [&](size_t index)
+    {
+        try
+        {
+            appearanceStreams[index] = createAnnotationAppearanceStreams(annotationReferences[index]);
+        }
+        catch (const PDFException& e)
+        {
+            QMutexLocker lock(&exceptionMutex);
+            if (!exception)
+            {
+                exception = e;
+            }
+        }
+    };
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, parallelIndices.cbegin(), parallelIndices.cend(), createAppearanceStreams);
+
+    if (exception)
+    {
+        throw *exception;
+    }
+
+    // Appearance streams must be written into the storage sequentially
+    for (AnnotationAppearanceStreams& appearanceStreamsItem : appearanceStreams)
+    {
+        setAnnotationAppearanceStreams(std::move(appearanceStreamsItem));
+    }
+}
+
+void PDFDocumentBuilder::beginAppearanceStreamsBatchUpdate()
+{
+    ++m_appearanceStreamsBatchUpdateLevel;
+}
+
+void PDFDocumentBuilder::endAppearanceStreamsBatchUpdate()
+{
+    Q_ASSERT(m_appearanceStreamsBatchUpdateLevel > 0);
+
+    if (--m_appearanceStreamsBatchUpdateLevel == 0 && !m_appearanceStreamsBatch.empty())
+    {
+        std::vector<PDFObjectReference> annotationReferences = std::move(m_appearanceStreamsBatch);
+        m_appearanceStreamsBatch.clear();
+        updateAnnotationAppearanceStreams(std::move(annotationReferences));
+    }
+}
+
 PDFObjectReference PDFDocumentBuilder::addObject(PDFObject object)
 {
     return m_storage.addObject(PDFObjectManipulator::removeNullObjects(object));
@@ -1808,24 +1924,243 @@ void PDFDocumentBuilder::setOutline(const PDFOutlineItem* root)
     setOutline(createOutlineItem(root, false));
 }
 
+std::vector<PDFObjectReference> PDFDocumentBuilder::appendPages(size_t pageCount, const BatchPageGenerator& generator, bool parallel)
+{
+    // Maximal count of kids of the page tree node
+    constexpr size_t MAX_KIDS = 32;
+
+    const PDFObjectReference pageTreeRoot = getPageTreeRoot();
+    const std::vector<PDFObjectReference> pageReferences = reserveObjects(pageCount);
+
+    // Create page tree levels bottom-up. Each node of the level has at most MAX_KIDS kids,
+    // and kids are evenly distributed between nodes. When level has at most MAX_KIDS
+    // nodes, then these nodes becomes kids of the page tree root.
+    struct PageTreeNode
+    {
+        PDFObjectReference reference;
+        size_t firstKid = 0;
+        size_t kidCount = 0;
+        PDFInteger pageCount = 0;
+    };
+
+    std::vector<std::vector<PageTreeNode>> levels;
+    std::vector<PDFInteger> kidPageCounts(pageCount, 1);
+    size_t kidCount = pageCount;
+    while (kidCount > MAX_KIDS)
+    {
+        const size_t nodeCount = (kidCount + MAX_KIDS - 1) / MAX_KIDS;
+        const std::vector<PDFObjectReference> nodeReferences = reserveObjects(nodeCount);
+
+        std::vector<PageTreeNode> level(nodeCount);
+        std::vector<PDFInteger> nodePageCounts(nodeCount, 0);
+        for (size_t i = 0; i < nodeCount; ++i)
+        {
+            PageTreeNode& node = level[i];
+            node.reference = nodeReferences[i];
+            node.firstKid = i * kidCount / nodeCount;
+            node.kidCount = (i + 1) * kidCount / nodeCount - node.firstKid;
+
+            for (size_t j = node.firstKid; j < node.firstKid + node.kidCount; ++j)
+            {
+                node.pageCount += kidPageCounts[j];
+            }
+            nodePageCounts[i] = node.pageCount;
+        }
+
+        levels.emplace_back(qMove(level));
+        kidPageCounts = qMove(nodePageCounts);
+        kidCount = nodeCount;
+    }
+
+    // Finds parent of the kid in the level (parents are in the next level)
+    auto getParent = [&](size_t levelIndex, size_t kidIndex)
+    {
+        if (levelIndex >= levels.size())
+        {
+            return pageTreeRoot;
+        }
+
+        const std::vector<PageTreeNode>& parents = levels[levelIndex];
+        auto it = std::upper_bound(parents.cbegin(), parents.cend(), kidIndex, [](size_t index, const PageTreeNode& node) { return index < node.firstKid; });
+        Q_ASSERT(it != parents.cbegin());
+        return std::prev(it)->reference;
+    };
+
+    // Create pages, content streams are compressed here, so it can take some time
+    std::vector<PDFObject> pageObjects(pageCount);
+    std::vector<PDFObject> contentStreams(pageCount);
+    auto createPage = [&](size_t index)
+    {
+        BatchPage page = generator(index);
+
+        PDFObjectFactory objectBuilder;
+        objectBuilder.beginDictionary();
+        objectBuilder.beginDictionaryItem("Type");
+        objectBuilder << WrapName("Page");
+        objectBuilder.endDictionaryItem();
+        objectBuilder.beginDictionaryItem("Parent");
+        objectBuilder << getParent(0, index);
+        objectBuilder.endDictionaryItem();
+        objectBuilder.beginDictionaryItem("MediaBox");
+        objectBuilder << page.mediaBox;
+        objectBuilder.endDictionaryItem();
+        objectBuilder.beginDictionaryItem("Resources");
+        objectBuilder << page.resources;
+        objectBuilder.endDictionaryItem();
+        objectBuilder.endDictionary();
+        pageObjects[index] = PDFObjectManipulator::removeNullObjects(objectBuilder.takeObject());
+
+        if (!page.contents.isEmpty())
+        {
+            QByteArray compressedData = PDFFlateDecodeFilter::compress(page.contents);
+
+            PDFDictionary contentDictionary;
+            contentDictionary.addEntry(PDFInplaceOrMemoryString(PDF_STREAM_DICT_LENGTH), PDFObject::createInteger(compressedData.size()));
+            contentDictionary.addEntry(PDFInplaceOrMemoryString(PDF_STREAM_DICT_FILTER), PDFObject::createName("FlateDecode"));
+            contentStreams[index] = PDFObject::createStream(std::make_shared<PDFStream>(qMove(contentDictionary), qMove(compressedData)));
+        }
+    };
+
+    if (parallel)
+    {
+        PDFIntegerRange<size_t> range(0, pageCount);
+        PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, range.begin(), range.end(), createPage);
+    }
+    else
+    {
+        for (size_t i = 0; i < pageCount; ++i)
+        {
+            createPage(i);
+        }
+    }
+
+    for (size_t i = 0; i < pageCount; ++i)
+    {
+        if (!contentStreams[i].isNull())
+        {
+            PDFDictionary pageDictionary = *pageObjects[i].getDictionary();
+            pageDictionary.addEntry(PDFInplaceOrMemoryString("Contents"), PDFObject::createReference(addObject(qMove(contentStreams[i]))));
+            pageObjects[i] = PDFObject::createDictionary(std::make_shared<PDFDictionary>(qMove(pageDictionary)));
+        }
+
+        m_storage.setObject(pageReferences[i], qMove(pageObjects[i]));
+    }
+
+    // Create page tree nodes
+    for (size_t levelIndex = 0; levelIndex < levels.size(); ++levelIndex)
+    {
+        const std::vector<PageTreeNode>& level = levels[levelIndex];
+        for (size_t i = 0; i < level.size(); ++i)
+        {
+            const PageTreeNode& node = level[i];
+
+            PDFObjectFactory objectBuilder;
+            objectBuilder.beginDictionary();
+            objectBuilder.beginDictionaryItem("Type");
+            objectBuilder << WrapName("Pages");
+            objectBuilder.endDictionaryItem();
+            objectBuilder.beginDictionaryItem("Parent");
+            objectBuilder << getParent(levelIndex + 1, i);
+            objectBuilder.endDictionaryItem();
+            objectBuilder.beginDictionaryItem("Kids");
+            objectBuilder.beginArray();
+            for (size_t j = node.firstKid; j < node.firstKid + node.kidCount; ++j)
+            {
+                objectBuilder << (levelIndex == 0 ? pageReferences[j] : levels[levelIndex - 1][j].reference);
+            }
+            objectBuilder.endArray();
+            objectBuilder.endDictionaryItem();
+            objectBuilder.beginDictionaryItem("Count");
+            objectBuilder << node.pageCount;
+            objectBuilder.endDictionaryItem();
+            objectBuilder.endDictionary();
+            m_storage.setObject(node.reference, objectBuilder.takeObject());
+        }
+    }
+
+    // Attach new top level nodes (or pages) to the page tree root
+    PDFObjectFactory objectBuilder;
+    objectBuilder.beginDictionary();
+    objectBuilder.beginDictionaryItem("Kids");
+    objectBuilder.beginArray();
+    if (levels.empty())
+    {
+        for (const PDFObjectReference& pageReference : pageReferences)
+        {
+            objectBuilder << pageReference;
+        }
+    }
+    else
+    {
+        for (const PageTreeNode& node : levels.back())
+        {
+            objectBuilder << node.reference;
+        }
+    }
+    objectBuilder.endArray();
+    objectBuilder.endDictionaryItem();
+    objectBuilder.beginDictionaryItem("Count");
+    objectBuilder << getPageTreeRootChildCount() + PDFInteger(pageCount);
+    objectBuilder.endDictionaryItem();
+    objectBuilder.endDictionary();
+    appendTo(pageTreeRoot, objectBuilder.takeObject());
+
+    return pageReferences;
+}
+
+std::vector<PDFObjectReference> PDFDocumentBuilder::reserveObjects(size_t count)
+{
+    std::vector<PDFObjectReference> references;
+    references.reserve(count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        references.push_back(m_storage.addObject(PDFObject()));
+    }
+
+    return references;
+}
+
 std::vector<PDFObject> PDFDocumentBuilder::copyFrom(const std::vector<PDFObject>& objects, const PDFObjectStorage& storage, bool createReferences)
 {
-    // 1) Collect all references, which we must copy. If object is referenced, then
-    //    we must also collect references of referenced object.
-    std::set<PDFObjectReference> references = PDFObjectUtils::getReferences(objects, storage);
+    // 1) Collect all objects, which we must copy. If object is referenced, then
+    //    we must also collect objects referenced by referenced object.
+    const std::vector<bool> reachableObjects = PDFObjectUtils::getReachableObjects(objects, storage);
 
-    // 2) Make room for new objects, together with mapping
-    std::map<PDFObjectReference, PDFObjectReference> referenceMapping;
-    for (const PDFObjectReference& reference : references)
+    std::vector<size_t> sourceIndices;
+    for (size_t i = 0; i < reachableObjects.size(); ++i)
     {
-        referenceMapping[reference] = addObject(PDFObject::createNull());
+        if (reachableObjects[i])
+        {
+            sourceIndices.push_back(i);
+        }
+    }
+
+    // 2) Make room for new objects, together with mapping. Source storage can be
+    //    this storage (when objects are cloned), so source objects are accessed
+    //    after the room for new objects is made.
+    const std::vector<PDFObjectReference> targetReferences = reserveObjects(sourceIndices.size());
+    const PDFObjectStorage::PDFObjects& sourceObjects = storage.getObjects();
+
+    PDFObjectUtils::FlatReferenceMapping referenceMapping(reachableObjects.size());
+    for (size_t i = 0; i < sourceIndices.size(); ++i)
+    {
+        const size_t sourceIndex = sourceIndices[i];
+        referenceMapping[sourceIndex] = std::make_pair(PDFObjectReference(PDFInteger(sourceIndex), sourceObjects[sourceIndex].generation), targetReferences[i]);
     }
 
     // 3) Copy objects from other object to this one
-    for (const PDFObjectReference& sourceReference : references)
+    std::vector<PDFObject> copiedObjects(sourceIndices.size());
+    PDFIntegerRange<size_t> range(0, sourceIndices.size());
+    auto copyObject = [&](size_t i)
+    {
+        copiedObjects[i] = PDFObjectUtils::replaceReferences(sourceObjects[sourceIndices[i]].object, referenceMapping);
+    };
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, range.begin(), range.end(), copyObject);
+
+    for (size_t i = 0; i < sourceIndices.size(); ++i)
     {
-        const PDFObjectReference targetReference = referenceMapping.at(sourceReference);
-        m_storage.setObject(targetReference, PDFObjectUtils::replaceReferences(storage.getObject(sourceReference), referenceMapping));
+        m_storage.setObject(targetReferences[i], qMove(copiedObjects[i]));
     }
 
     std::vector<PDFObject> result;
@@ -1835,7 +2170,17 @@ std::vector<PDFObject> PDFDocumentBuilder::copyFrom(const std::vector<PDFObject>
     {
         if (object.isReference())
         {
-            result.push_back(PDFObject::createReference(referenceMapping.at(object.getReference())));
+            const PDFObjectReference reference = object.getReference();
+            const size_t index = static_cast<size_t>(reference.objectNumber);
+            if (reference.objectNumber >= 0 && index < referenceMapping.size() && referenceMapping[index].first == reference)
+            {
+                result.push_back(PDFObject::createReference(referenceMapping[index].second));
+            }
+            else
+            {
+                // Reference to nonexisting object, so reference to null object is created
+                result.push_back(PDFObject::createReference(addObject(PDFObject::createNull())));
+            }
         }
         else
         {
@@ -324,6 +324,18 @@ private:
 class PDF4QTLIBCORESHARED_EXPORT PDFDocumentBuilder
 {
 public:
+    /// Page of the batch of pages appended by function \p appendPages
+    struct BatchPage
+    {
+        QRectF mediaBox;        ///< Media box of the page (size of paper)
+        PDFObject resources;    ///< Resources of the page, can be null
+        QByteArray contents;    ///< Content stream data (not encoded), can be empty
+    };
+
+    /// Generator of the page of the batch, it gets index of the page in the batch.
+    /// If pages are generated in parallel, generator must be thread safe.
+    using BatchPageGenerator = std::function<BatchPage(size_t)>;
+
     /// Creates a new blank document (with no pages)
     explicit PDFDocumentBuilder();
 
@@ -379,6 +391,23 @@ public:
     /// \param annotationReference Reference to the annotation
     void updateAnnotationAppearanceStreams(PDFObjectReference annotationReference);
 
+    /// Updates appearance streams of all annotations in the list. Appearance streams
+    /// are created in parallel (except form fields, which are being edited), and
+    /// then written to the document.
+    /// \param annotationReferences References to the annotations
+    void updateAnnotationAppearanceStreams(std::vector<PDFObjectReference> annotationReferences);
+
+    /// Begins batch update of annotation appearance streams. Until batch update
+    /// is ended, updates of annotation appearance streams are only collected,
+    /// and they are performed at once (in parallel) when batch update ends.
+    /// Batch updates can be nested, collected annotations are updated when
+    /// outermost batch update ends.
+    void beginAppearanceStreamsBatchUpdate();
+
+    /// Ends batch update of annotation appearance streams,
+    /// see \p beginAppearanceStreamsBatchUpdate.
+    void endAppearanceStreamsBatchUpdate();
+
     const PDFFormManager* getFormManager() const;
     void setFormManager(const PDFFormManager* formManager);
 
@@ -395,6 +424,24 @@ public:
     /// be flattened to use this function. \sa flattenPageTree
     std::vector<PDFObjectReference> getPages() const;
 
+    /// Appends a batch of pages after the last page. Object numbers of pages and
+    /// new page tree nodes are reserved at once, pages are created by \p generator
+    /// (in parallel, if \p parallel is true) and content streams are compressed.
+    /// New pages are arranged into balanced page tree, which is attached to the page
+    /// tree root only once, so appending of pages takes linear time. Because page
+    /// tree is not flat after this function (if there are many pages), it must
+    /// be flattened before functions requiring flat page tree are used.
+    /// \param pageCount Page count
+    /// \param generator Page generator
+    /// \param parallel Generate pages in parallel
+    /// \returns References to appended pages
+    std::vector<PDFObjectReference> appendPages(size_t pageCount, const BatchPageGenerator& generator, bool parallel);
+
+    /// Reserves \p count new objects at the end of the object storage. Reserved objects
+    /// are null and can be set later, using function \p setObject.
+    /// \param count Count of reserved objects
+    std::vector<PDFObjectReference> reserveObjects(size_t count);
+
     /// Sets document outline root item corresponds to invisible root.
     /// Top-level items are children of the root.
     /// \param root Root item
@@ -1583,6 +1630,28 @@ public:
 /* END GENERATED CODE */
 
 private:
+    struct AnnotationAppearanceStreams
+    {
+        struct Stream
+        {
+            PDFAppeareanceStreams::Key key;
+            QRectF boundingRectangle;
+            PDFContentStreamBuilder::ContentStream contentStream;
+        };
+
+        PDFObjectReference annotationReference;
+        std::vector<Stream> streams;
+    };
+
+    /// Draws appearance streams of the annotation. Document isn't modified,
+    /// so this function can be called from multiple threads at once.
+    /// \param annotationReference Reference to the annotation
+    AnnotationAppearanceStreams createAnnotationAppearanceStreams(PDFObjectReference annotationReference) const;
+
+    /// Writes appearance streams to the document and sets them to the annotation
+    /// \param appearanceStreamsData Appearance streams of the annotation
+    void setAnnotationAppearanceStreams(AnnotationAppearanceStreams appearanceStreamsData);
+
     QRectF getPopupWindowRect(const QRectF& rectangle) const;
     QString getProducerString() const;
     PDFObjectReference getPageTreeRoot() const;
@@ -1593,6 +1662,8 @@ private:
     PDFObjectStorage m_storage;
     PDFVersion m_version;
     const PDFFormManager* m_formManager = nullptr;
+    int m_appearanceStreamsBatchUpdateLevel = 0;
+    std::vector<PDFObjectReference> m_appearanceStreamsBatch;
 };
 
 /// This class serves for document modification. While document is modified,
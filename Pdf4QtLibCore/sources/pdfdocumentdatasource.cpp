@@ -0,0 +1,162 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pdfdocumentdatasource.h"
+#include "pdfbytescanner.h"
+#include "pdfexception.h"
+
+#include <QIODevice>
+#include <QCryptographicHash>
+
+#include "pdfdbgheap.h"
+
+#include <cstring>
+
+namespace pdf
+{
+
+PDFDeviceDocumentDataSource::PDFDeviceDocumentDataSource(QIODevice* device) :
+    m_device(device)
+{
+
+}
+
+qint64 PDFDeviceDocumentDataSource::getSize() const
+{
+    return m_device->size();
+}
+
+bool PDFDeviceDocumentDataSource::read(qint64 offset, qint64 size, char* data)
+{
+    if (!m_device->seek(offset))
+    {
+        return false;
+    }
+
+    return m_device->read(data, size) == size;
+}
+
+PDFDocumentDataCache::PDFDocumentDataCache(PDFDocumentDataSourcePointer source, qint64 blockSize) :
+    m_source(std::move(source)),
+    m_size(qMax(m_source->getSize(), qint64(0))),
+    m_blockSize(blockSize),
+    m_data(new char[m_size]),
+    m_fetchedBlocks((m_size + blockSize - 1) / blockSize, false)
+{
+
+}
+
+qint64 PDFDocumentDataCache::getFetchedSize() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_fetchedSize;
+}
+
+void PDFDocumentDataCache::fetch(qint64 offset, qint64 size)
+{
+    offset = qBound(qint64(0), offset, m_size);
+    size = qBound(qint64(0), size, m_size - offset);
+
+    if (size > 0)
+    {
+        QMutexLocker lock(&m_mutex);
+        fetchBlocks(offset / m_blockSize, (offset + size - 1) / m_blockSize);
+    }
+}
+
+qint64 PDFDocumentDataCache::fetchUntil(qint64 offset, const char* what)
+{
+    const size_t length = std::strlen(what);
+    offset = qBound(qint64(0), offset, m_size);
+
+    QMutexLocker lock(&m_mutex);
+
+    qint64 searchOffset = offset;
+    for (qint64 block = offset / m_blockSize; block < qint64(m_fetchedBlocks.size()); ++block)
+    {
+        fetchBlocks(block, block);
+
+        // Found string can span block boundary, so we search again
+        // also in the last few bytes of the previous block.
+        const qint64 blockEnd = qMin((block + 1) * m_blockSize, m_size);
+        const char* begin = m_data.get() + searchOffset;
+        const char* end = m_data.get() + blockEnd;
+        const char* found = PDFByteScanner::find(begin, end, what, length);
+
+        if (found != end)
+        {
+            return std::distance(m_data.get(), found) + qint64(length);
+        }
+
+        searchOffset = qMax(offset, blockEnd - qint64(length) + 1);
+    }
+
+    return m_size;
+}
+
+QByteArray PDFDocumentDataCache::getIdentityHash()
+{
+    fetch(0, m_blockSize);
+    fetch(m_size - m_blockSize, m_blockSize);
+
+    const qint64 firstBlockSize = qMin(m_blockSize, m_size);
+    const qint64 lastBlockSize = qMin(m_blockSize, m_size);
+
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(QByteArray::number(m_size));
+    hash.addData(QByteArrayView(m_data.get(), firstBlockSize));
+    hash.addData(QByteArrayView(m_data.get() + m_size - lastBlockSize, lastBlockSize));
+    return hash.result();
+}
+
+void PDFDocumentDataCache::fetchBlocks(qint64 firstBlock, qint64 lastBlock)
+{
+    qint64 block = firstBlock;
+    while (block <= lastBlock)
+    {
+        if (m_fetchedBlocks[block])
+        {
+            ++block;
+            continue;
+        }
+
+        // Read consecutive missing blocks in one request
+        qint64 lastMissingBlock = block;
+        while (lastMissingBlock + 1 <= lastBlock && !m_fetchedBlocks[lastMissingBlock + 1])
+        {
+            ++lastMissingBlock;
+        }
+
+        const qint64 offset = block * m_blockSize;
+        const qint64 size = qMin((lastMissingBlock + 1) * m_blockSize, m_size) - offset;
+        if (!m_source->read(offset, size, m_data.get() + offset))
+        {
+            throw PDFException(PDFTranslationContext::tr("Can't read document data at position %1.").arg(offset));
+        }
+
+        std::fill(std::next(m_fetchedBlocks.begin(), block), std::next(m_fetchedBlocks.begin(), lastMissingBlock + 1), true);
+        m_fetchedSize += size;
+        block = lastMissingBlock + 1;
+    }
+}
+
+}   // namespace pdf
@@ -0,0 +1,136 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef PDFDOCUMENTDATASOURCE_H
+#define PDFDOCUMENTDATASOURCE_H
+
+#include "pdfglobal.h"
+
+#include <QMutex>
+#include <QByteArray>
+
+#include <memory>
+#include <vector>
+
+class QIODevice;
+
+namespace pdf
+{
+
+/// Random access source of document data. Data are read by ranges, so only
+/// parts of the document, which are really needed, are read. Implementation
+/// can read the data for example from the device, or using HTTP range requests
+/// from the remote storage. Reading functions are always called from one thread
+/// at a time.
+class PDF4QTLIBCORESHARED_EXPORT PDFDocumentDataSource
+{
+public:
+    virtual ~PDFDocumentDataSource() = default;
+
+    /// Returns size of the document data in bytes
+    virtual qint64 getSize() const = 0;
+
+    /// Reads range of the document data. Returns true, if whole range
+    /// was successfully read.
+    /// \param offset Offset of the range
+    /// \param size Size of the range
+    /// \param data Target buffer (it has at least \p size bytes)
+    virtual bool read(qint64 offset, qint64 size, char* data) = 0;
+};
+
+using PDFDocumentDataSourcePointer = std::shared_ptr<PDFDocumentDataSource>;
+
+/// Document data source reading data from random access device. Device
+/// must be opened for reading and it must exist as long as data source exists.
+class PDF4QTLIBCORESHARED_EXPORT PDFDeviceDocumentDataSource : public PDFDocumentDataSource
+{
+public:
+    explicit PDFDeviceDocumentDataSource(QIODevice* device);
+
+    virtual qint64 getSize() const override;
+    virtual bool read(qint64 offset, qint64 size, char* data) override;
+
+private:
+    QIODevice* m_device;
+};
+
+/// Block cache of document data source. It provides contiguous buffer with
+/// whole document, in which only fetched blocks contain valid data. Memory
+/// for the whole buffer is reserved, but it is not initialized, so operating
+/// system commits only pages of fetched blocks. Buffer never moves, so data
+/// of fetched blocks can be referred directly. Fetching is thread safe.
+class PDF4QTLIBCORESHARED_EXPORT PDFDocumentDataCache
+{
+public:
+    static constexpr const qint64 DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+    explicit PDFDocumentDataCache(PDFDocumentDataSourcePointer source, qint64 blockSize = DEFAULT_BLOCK_SIZE);
+
+    PDFDocumentDataCache(const PDFDocumentDataCache&) = delete;
+    PDFDocumentDataCache& operator=(const PDFDocumentDataCache&) = delete;
+
+    /// Returns buffer with whole document. Only fetched
+    /// ranges of the buffer contain valid data.
+    QByteArray getData() const { return QByteArray::fromRawData(m_data.get(), m_size); }
+
+    /// Returns size of the document
+    qint64 getSize() const { return m_size; }
+
+    /// Returns count of bytes fetched from the data source
+    qint64 getFetchedSize() const;
+
+    /// Fetches range of the document, if it is not already fetched.
+    /// Range is clamped to the document. Throws exception, if data
+    /// can't be read from the data source.
+    /// \param offset Offset of the range
+    /// \param size Size of the range
+    void fetch(qint64 offset, qint64 size);
+
+    /// Fetches blocks starting from the \p offset, until string \p what
+    /// is found, or end of the document is reached. Returns offset just
+    /// after the found string, or size of the document, if string was
+    /// not found. Throws exception, if data can't be read.
+    /// \param offset Offset, from which string is searched
+    /// \param what String to be found
+    qint64 fetchUntil(qint64 offset, const char* what);
+
+    /// Returns identification hash of the document, which is computed from
+    /// the size and from the first and the last block of the document
+    /// (whole document is never read).
+    QByteArray getIdentityHash();
+
+private:
+    /// Fetches blocks in the range, mutex must be locked
+    void fetchBlocks(qint64 firstBlock, qint64 lastBlock);
+
+    mutable QMutex m_mutex;
+    PDFDocumentDataSourcePointer m_source;
+    qint64 m_size;
+    qint64 m_blockSize;
+    std::unique_ptr<char[]> m_data;
+    std::vector<bool> m_fetchedBlocks;
+    qint64 m_fetchedSize = 0;
+};
+
+}   // namespace pdf
+
+#endif // PDFDOCUMENTDATASOURCE_H
@@ -23,6 +23,7 @@
 #include "pdfdocumentmanipulator.h"
 #include "pdfdocumentbuilder.h"
 #include "pdfoptimizer.h"
+#include "pdfexecutionpolicy.h"
 #include "pdfdbgheap.h"
 
 namespace pdf
@@ -264,6 +265,19 @@ PDFDocumentManipulator::ProcessedPages PDFDocumentManipulator::collectObjectsAnd
         }
     }
 
+    // Source document, from which we are copying pages. Source documents are
+    // prepared in parallel, but their objects are merged sequentially.
+    struct SourceDocument
+    {
+        int documentIndex = -1;
+        std::map<std::pair<int, int>, PDFObjectReference>::iterator it;
+        std::map<std::pair<int, int>, PDFObjectReference>::iterator itEnd;
+        std::unique_ptr<PDFDocumentBuilder> temporaryBuilder;
+        std::vector<PDFObjectReference> objectsToMerge;
+        QString errorMessage;
+    };
+
+    std::vector<SourceDocument> sourceDocuments;
     for (auto it = documentPages.begin(); it != documentPages.end();)
     {
         const int documentIndex = it->first.first;
@@ -282,21 +296,38 @@ PDFDocumentManipulator::ProcessedPages PDFDocumentManipulator::collectObjectsAnd
             {
                 throw PDFException(tr("Invalid document."));
             }
-            const PDFDocument* document = m_documents.at(documentIndex);
+
+            SourceDocument sourceDocument;
+            sourceDocument.documentIndex = documentIndex;
+            sourceDocument.it = it;
+            sourceDocument.itEnd = itEnd;
+            sourceDocuments.emplace_back(qMove(sourceDocument));
+        }
+
+        // Advance the index
+        it = itEnd;
+    }
+
+    auto prepareSourceDocument = [this](SourceDocument& sourceDocument)
+    {
+        try
+        {
+            const PDFDocument* document = m_documents.at(sourceDocument.documentIndex);
 
             // Copy the pages into the target document builder
             std::vector<PDFInteger> pageIndices;
-            for (auto currentIt = it; currentIt != itEnd; ++currentIt)
+            for (auto currentIt = sourceDocument.it; currentIt != sourceDocument.itEnd; ++currentIt)
             {
                 pageIndices.push_back(currentIt->first.second);
             }
 
-            pdf::PDFDocumentBuilder temporaryBuilder(document);
+            sourceDocument.temporaryBuilder = std::make_unique<PDFDocumentBuilder>(document);
+            PDFDocumentBuilder& temporaryBuilder = *sourceDocument.temporaryBuilder;
             temporaryBuilder.flattenPageTree();
 
             std::vector<pdf::PDFObjectReference> currentPages = temporaryBuilder.getPages();
-            std::vector<pdf::PDFObjectReference> objectsToMerge;
-            objectsToMerge.reserve(std::distance(it, itEnd));
+            std::vector<pdf::PDFObjectReference> selectedPages;
+            selectedPages.reserve(pageIndices.size());
 
             for (PDFInteger pageIndex : pageIndices)
             {
@@ -305,9 +336,15 @@ PDFDocumentManipulator::ProcessedPages PDFDocumentManipulator::collectObjectsAnd
                     throw PDFException(tr("Missing page (%1) in a document.").arg(pageIndex));
                 }
 
-                objectsToMerge.push_back(currentPages[pageIndex]);
+                selectedPages.push_back(currentPages[pageIndex]);
             }
 
+            // Pages refer to the page tree root, so we keep only selected pages
+            // in the page tree. Otherwise all pages would be copied.
+            temporaryBuilder.setPages(selectedPages);
+            std::vector<pdf::PDFObjectReference>& objectsToMerge = sourceDocument.objectsToMerge;
+            objectsToMerge = qMove(selectedPages);
+
             pdf::PDFObjectReference acroFormReference;
             pdf::PDFObjectReference namesReference;
             pdf::PDFObjectReference ocPropertiesReference;
@@ -360,35 +397,46 @@ PDFDocumentManipulator::ProcessedPages PDFDocumentManipulator::collectObjectsAnd
             }
 
             objectsToMerge.insert(objectsToMerge.end(), { acroFormReference, namesReference, ocPropertiesReference, outlineReference });
+        }
+        catch (const PDFException& exception)
+        {
+            sourceDocument.errorMessage = exception.getMessage();
+        }
+    };
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, sourceDocuments.begin(), sourceDocuments.end(), prepareSourceDocument);
+
+    for (SourceDocument& sourceDocument : sourceDocuments)
+    {
+        if (!sourceDocument.errorMessage.isEmpty())
+        {
+            throw PDFException(sourceDocument.errorMessage);
+        }
 
-            // Now, we are ready to merge objects into target document builder
-            std::vector<pdf::PDFObjectReference> references = pdf::PDFDocumentBuilder::createReferencesFromObjects(documentBuilder.copyFrom(pdf::PDFDocumentBuilder::createObjectsFromReferences(objectsToMerge), *temporaryBuilder.getStorage(), true));
+        // Now, we are ready to merge objects into target document builder
+        std::vector<pdf::PDFObjectReference> references = pdf::PDFDocumentBuilder::createReferencesFromObjects(documentBuilder.copyFrom(pdf::PDFDocumentBuilder::createObjectsFromReferences(sourceDocument.objectsToMerge), *sourceDocument.temporaryBuilder->getStorage(), true));
+        sourceDocument.temporaryBuilder.reset();
 
-            outlineReference = references.back();
-            references.pop_back();
-            ocPropertiesReference = references.back();
-            references.pop_back();
-            namesReference = references.back();
-            references.pop_back();
-            acroFormReference = references.back();
-            references.pop_back();
+        pdf::PDFObjectReference outlineReference = references.back();
+        references.pop_back();
+        pdf::PDFObjectReference ocPropertiesReference = references.back();
+        references.pop_back();
+        pdf::PDFObjectReference namesReference = references.back();
+        references.pop_back();
+        pdf::PDFObjectReference acroFormReference = references.back();
+        references.pop_back();
 
-            documentBuilder.appendTo(m_mergedObjects[MOT_OCProperties], documentBuilder.getObjectByReference(ocPropertiesReference));
-            documentBuilder.appendTo(m_mergedObjects[MOT_Form], documentBuilder.getObjectByReference(acroFormReference));
-            documentBuilder.mergeNames(m_mergedObjects[MOT_Names], namesReference);
-            m_outlines[documentIndex] = outlineReference;
+        documentBuilder.appendTo(m_mergedObjects[MOT_OCProperties], documentBuilder.getObjectByReference(ocPropertiesReference));
+        documentBuilder.appendTo(m_mergedObjects[MOT_Form], documentBuilder.getObjectByReference(acroFormReference));
+        documentBuilder.mergeNames(m_mergedObjects[MOT_Names], namesReference);
+        m_outlines[sourceDocument.documentIndex] = outlineReference;
 
-            Q_ASSERT(references.size() == size_t(std::distance(it, itEnd)));
+        Q_ASSERT(references.size() == size_t(std::distance(sourceDocument.it, sourceDocument.itEnd)));
 
-            auto referenceIt = references.begin();
-            for (auto currentIt = it; currentIt != itEnd; ++currentIt, ++referenceIt)
-            {
-                currentIt->second = *referenceIt;
-            }
+        auto referenceIt = references.begin();
+        for (auto currentIt = sourceDocument.it; currentIt != sourceDocument.itEnd; ++currentIt, ++referenceIt)
+        {
+            currentIt->second = *referenceIt;
         }
-
-        // Advance the index
-        it = itEnd;
     }
 
     std::set<PDFObjectReference> usedReferences;
@@ -27,20 +27,479 @@
 #include "pdfparser.h"
 #include "pdfstreamfilters.h"
 #include "pdfexecutionpolicy.h"
+#include "pdfbytescanner.h"
+#include "pdfdocumentwriter.h"
+#include "pdfobjectutils.h"
+#include "pdftracing.h"
 
+#include <QDir>
 #include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
 #include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QCache>
+#include <QtConcurrent/QtConcurrent>
 
 #include "pdfdbgheap.h"
 
 #include <regex>
 #include <cctype>
+#include <map>
+#include <set>
 #include <algorithm>
 #include <execution>
+#include <functional>
 
 namespace pdf
 {
 
+/// Memory mapped file, which is used as source data of the document. Mapping
+/// is released, when last object referring to the mapped file is destroyed.
+class PDFMappedFile
+{
+public:
+    explicit PDFMappedFile() = default;
+
+    ~PDFMappedFile()
+    {
+        if (m_data)
+        {
+            m_file.unmap(m_data);
+        }
+    }
+
+    PDFMappedFile(const PDFMappedFile&) = delete;
+    PDFMappedFile& operator=(const PDFMappedFile&) = delete;
+
+    /// Maps whole file into the memory. If file can't be mapped
+    /// (for example, it is empty, or it is not a regular file),
+    /// then nullptr is returned.
+    /// \param fileName File name
+    static std::shared_ptr<PDFMappedFile> map(const QString& fileName)
+    {
+        std::shared_ptr<PDFMappedFile> mappedFile = std::make_shared<PDFMappedFile>();
+        mappedFile->m_file.setFileName(fileName);
+
+        if (!mappedFile->m_file.open(QFile::ReadOnly) || mappedFile->m_file.isSequential())
+        {
+            return nullptr;
+        }
+
+        mappedFile->m_size = mappedFile->m_file.size();
+        if (mappedFile->m_size > 0)
+        {
+            mappedFile->m_data = mappedFile->m_file.map(0, mappedFile->m_size);
+        }
+
+        // Mapping stays valid after file is closed, it is released
+        // by unmap, or when QFile object is destroyed.
+        mappedFile->m_file.close();
+
+        if (!mappedFile->m_data)
+        {
+            return nullptr;
+        }
+
+        return mappedFile;
+    }
+
+    /// Returns mapped data (data are not copied)
+    QByteArray getData() const { return QByteArray::fromRawData(reinterpret_cast<const char*>(m_data), m_size); }
+
+private:
+    QFile m_file;
+    uchar* m_data = nullptr;
+    qint64 m_size = 0;
+};
+
+/// Decoded object stream, with offsets of objects stored in the stream
+struct PDFDecodedObjectStream
+{
+    QByteArray data;
+    std::map<PDFInteger, PDFInteger> offsets;
+
+    /// Decodes object stream. Can throw exception.
+    /// \param object Object stream
+    /// \param objectStreamReference Reference to the object stream
+    /// \param securityHandler Security handler
+    static PDFDecodedObjectStream decode(const PDFObject& object, PDFObjectReference objectStreamReference, const PDFSecurityHandler* securityHandler)
+    {
+        PDFDecodedObjectStream objectStream;
+
+        if (!object.isStream())
+        {
+            throw PDFException(PDFTranslationContext::tr("Object stream %1 is invalid.").arg(objectStreamReference.objectNumber));
+        }
+
+        const PDFStream* stream = object.getStream();
+        const PDFDictionary* dictionary = stream->getDictionary();
+
+        const PDFObject& objectStreamType = dictionary->get("Type");
+        const PDFObject& nObject = dictionary->get("N");
+        const PDFObject& firstObject = dictionary->get("First");
+        if (!objectStreamType.isName() || objectStreamType.getString() != "ObjStm" || !nObject.isInt() || !firstObject.isInt())
+        {
+            throw PDFException(PDFTranslationContext::tr("Object stream %1 is invalid.").arg(objectStreamReference.objectNumber));
+        }
+
+        const PDFInteger n = nObject.getInteger();
+        const PDFInteger first = firstObject.getInteger();
+
+        objectStream.data = PDFStreamFilterStorage::getDecodedStream(stream, securityHandler);
+
+        PDFParsingContext context([](PDFParsingContext*, PDFObjectReference) { return PDFObject(); });
+        PDFParser parser(objectStream.data, &context, PDFParser::None);
+        for (PDFInteger i = 0; i < n; ++i)
+        {
+            PDFObject currentObjectNumber = parser.getObject();
+            PDFObject currentOffset = parser.getObject();
+
+            if (!currentObjectNumber.isInt() || !currentOffset.isInt())
+            {
+                throw PDFException(PDFTranslationContext::tr("Object stream %1 is invalid.").arg(objectStreamReference.objectNumber));
+            }
+
+            objectStream.offsets.emplace(currentObjectNumber.getInteger(), currentOffset.getInteger() + first);
+        }
+
+        return objectStream;
+    }
+};
+
+/// Snapshot of the parsed structure of the document (reference table, trailer
+/// dictionary and decoded object streams), which is stored in the snapshot cache
+/// directory. Snapshot is identified by the hash of the source data. When snapshot
+/// is loaded, it is memory mapped and object stream data refer to the mapping.
+class PDFDocumentSnapshot
+{
+public:
+    static constexpr const quint32 SNAPSHOT_MAGIC = 0x50345153;
+    static constexpr const quint32 SNAPSHOT_VERSION = 1;
+
+    /// Returns file name of the snapshot of the document with given source hash
+    /// \param directory Snapshot cache directory
+    /// \param sourceHash Hash of the source data
+    static QString getFileName(const QString& directory, const QByteArray& sourceHash)
+    {
+        return QDir(directory).filePath(QString::fromLatin1(sourceHash.toHex()) + QLatin1String(".pdfsnapshot"));
+    }
+
+    /// Loads snapshot from the file. Returns true, if snapshot was loaded
+    /// and it corresponds to the source data with given hash and size.
+    /// \param fileName Snapshot file name
+    /// \param sourceHash Hash of the source data
+    /// \param sourceSize Size of the source data
+    bool load(const QString& fileName, const QByteArray& sourceHash, qint64 sourceSize)
+    {
+        std::shared_ptr<PDFMappedFile> mappedFile = PDFMappedFile::map(fileName);
+        if (!mappedFile)
+        {
+            return false;
+        }
+
+        const QByteArray data = mappedFile->getData();
+        QDataStream stream(data);
+        stream.setVersion(QDataStream::Qt_6_0);
+
+        quint32 magic = 0;
+        quint32 snapshotVersion = 0;
+        QByteArray hash;
+        qint64 size = 0;
+        stream >> magic >> snapshotVersion >> hash >> size;
+
+        if (stream.status() != QDataStream::Ok || magic != SNAPSHOT_MAGIC || snapshotVersion != SNAPSHOT_VERSION || hash != sourceHash || size != sourceSize)
+        {
+            return false;
+        }
+
+        QByteArray trailer;
+        quint64 entryCount = 0;
+        quint64 occupiedEntryCount = 0;
+        stream >> version.major >> version.minor >> trailer >> entryCount >> occupiedEntryCount;
+
+        if (stream.status() != QDataStream::Ok || entryCount > quint64(data.size()) || occupiedEntryCount > entryCount)
+        {
+            return false;
+        }
+
+        std::vector<PDFXRefTable::Entry> entries(entryCount);
+        for (quint64 i = 0; i < occupiedEntryCount; ++i)
+        {
+            quint64 index = 0;
+            quint8 type = 0;
+            qint64 objectNumber = 0;
+            qint64 generation = 0;
+            qint64 offset = 0;
+            qint64 objectStreamNumber = 0;
+            qint64 objectStreamGeneration = 0;
+            qint64 indexInObjectStream = 0;
+            stream >> index >> type >> objectNumber >> generation >> offset >> objectStreamNumber >> objectStreamGeneration >> indexInObjectStream;
+
+            PDFXRefTable::Entry entry;
+            entry.reference = PDFObjectReference(objectNumber, generation);
+            entry.objectStream = PDFObjectReference(objectStreamNumber, objectStreamGeneration);
+            entry.offset = offset;
+            entry.indexInObjectStream = indexInObjectStream;
+            entry.type = static_cast<PDFXRefTable::EntryType>(type);
+
+            if (stream.status() != QDataStream::Ok || index >= entryCount || type > quint8(PDFXRefTable::EntryType::InObjectStream))
+            {
+                return false;
+            }
+
+            entries[index] = entry;
+        }
+
+        quint64 objectStreamCount = 0;
+        stream >> objectStreamCount;
+        for (quint64 i = 0; i < objectStreamCount && stream.status() == QDataStream::Ok; ++i)
+        {
+            qint64 objectNumber = 0;
+            quint64 offsetCount = 0;
+            stream >> objectNumber >> offsetCount;
+
+            PDFDecodedObjectStream objectStream;
+            for (quint64 j = 0; j < offsetCount && stream.status() == QDataStream::Ok; ++j)
+            {
+                qint64 currentObjectNumber = 0;
+                qint64 currentOffset = 0;
+                stream >> currentObjectNumber >> currentOffset;
+                objectStream.offsets.emplace(currentObjectNumber, currentOffset);
+            }
+
+            // Object stream data are not copied, they refer to the mapped file
+            qint64 dataSize = 0;
+            stream >> dataSize;
+            const qint64 dataOffset = stream.device()->pos();
+            if (stream.status() != QDataStream::Ok || dataSize < 0 || dataSize > data.size() - dataOffset)
+            {
+                return false;
+            }
+
+            objectStream.data = QByteArray::fromRawData(data.constData() + dataOffset, dataSize);
+            stream.skipRawData(dataSize);
+            objectStreams.emplace(objectNumber, std::move(objectStream));
+        }
+
+        if (stream.status() != QDataStream::Ok)
+        {
+            return false;
+        }
+
+        try
+        {
+            PDFParsingContext context([](PDFParsingContext*, PDFObjectReference) { return PDFObject(); });
+            PDFParser parser(trailer, &context, PDFParser::AllowStreams);
+            xrefTable.setEntries(std::move(entries), parser.getObject());
+        }
+        catch (const PDFException&)
+        {
+            return false;
+        }
+
+        dataOwner = std::move(mappedFile);
+        return true;
+    }
+
+    /// Saves snapshot into the file. File is replaced atomically, so
+    /// snapshot can be read by another process in the same time.
+    /// \param fileName Snapshot file name
+    /// \param sourceHash Hash of the source data
+    /// \param sourceSize Size of the source data
+    bool save(const QString& fileName, const QByteArray& sourceHash, qint64 sourceSize) const
+    {
+        QDir().mkpath(QFileInfo(fileName).path());
+
+        QSaveFile file(fileName);
+        if (!file.open(QFile::WriteOnly))
+        {
+            return false;
+        }
+
+        const std::vector<PDFXRefTable::Entry>& entries = xrefTable.getEntries();
+        const quint64 occupiedEntryCount = std::count_if(entries.cbegin(), entries.cend(), [](const PDFXRefTable::Entry& entry) { return entry.type != PDFXRefTable::EntryType::Free; });
+
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_6_0);
+        stream << SNAPSHOT_MAGIC << SNAPSHOT_VERSION << sourceHash << sourceSize;
+        stream << version.major << version.minor << PDFDocumentWriter::getSerializedObject(xrefTable.getTrailerDictionary());
+        stream << quint64(entries.size()) << occupiedEntryCount;
+
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            const PDFXRefTable::Entry& entry = entries[i];
+            if (entry.type == PDFXRefTable::EntryType::Free)
+            {
+                continue;
+            }
+
+            stream << quint64(i) << quint8(entry.type) << qint64(entry.reference.objectNumber) << qint64(entry.reference.generation) << qint64(entry.offset);
+            stream << qint64(entry.objectStream.objectNumber) << qint64(entry.objectStream.generation) << qint64(entry.indexInObjectStream);
+        }
+
+        stream << quint64(objectStreams.size());
+        for (const auto& [objectNumber, objectStream] : objectStreams)
+        {
+            stream << qint64(objectNumber) << quint64(objectStream.offsets.size());
+            for (const auto& [currentObjectNumber, currentOffset] : objectStream.offsets)
+            {
+                stream << qint64(currentObjectNumber) << qint64(currentOffset);
+            }
+
+            stream << qint64(objectStream.data.size());
+            stream.writeRawData(objectStream.data.constData(), objectStream.data.size());
+        }
+
+        return stream.status() == QDataStream::Ok && file.commit();
+    }
+
+    PDFVersion version;
+    PDFXRefTable xrefTable;
+    std::map<PDFInteger, PDFDecodedObjectStream> objectStreams;
+
+    /// Owner of the data of object streams (mapped snapshot file)
+    PDFStreamDataOwner dataOwner;
+};
+
+/// Loads objects of lazy object storage directly from the source data
+/// of the document, using the reference table. Objects from object streams
+/// are read from decoded object streams. Object stream is decoded, when
+/// object inside it is requested for the first time, and it is kept in the
+/// cache with limited budget. Loader is always called under the lock
+/// of the lazy storage, so it doesn't need its own lock.
+class PDFDocumentReaderObjectLoader : public PDFObjectStorageLoader
+{
+public:
+    explicit PDFDocumentReaderObjectLoader(QByteArray source,
+                                           PDFStreamDataOwner sourceOwner,
+                                           PDFObjectArenaPointer objectArena,
+                                           PDFXRefTable xrefTable,
+                                           PDFSecurityHandlerPointer securityHandler,
+                                           PDFObjectReference encryptObjectReference) :
+        m_source(std::move(source)),
+        m_sourceOwner(std::move(sourceOwner)),
+        m_objectArena(std::move(objectArena)),
+        m_xrefTable(std::move(xrefTable)),
+        m_securityHandler(std::move(securityHandler)),
+        m_streamDecryptor(PDFSecurityHandler::createStreamDecryptor(m_securityHandler)),
+        m_encryptObjectReference(encryptObjectReference)
+    {
+        m_decodedObjectStreams.setMaxCost(DEFAULT_OBJECT_STREAM_CACHE_BUDGET);
+    }
+
+    /// Sets data cache, from which source data are fetched
+    /// \param dataCache Data cache
+    void setDataCache(std::shared_ptr<PDFDocumentDataCache> dataCache) { m_dataCache = std::move(dataCache); }
+
+    /// Sets object streams, which were decoded previously (for example, they
+    /// were read from the document snapshot). These object streams are
+    /// not limited by the cache budget, because their data are usually
+    /// owned by the memory mapped snapshot file.
+    /// \param objectStreams Decoded object streams
+    /// \param owner Owner of the data of object streams (can be nullptr)
+    void setDecodedObjectStreams(std::map<PDFInteger, PDFDecodedObjectStream> objectStreams, PDFStreamDataOwner owner)
+    {
+        m_objectStreams = std::move(objectStreams);
+        m_objectStreamsOwner = std::move(owner);
+    }
+
+    virtual PDFObject loadObject(const PDFObjectStorage* storage, PDFObjectReference reference) override
+    {
+        const PDFXRefTable::Entry& entry = m_xrefTable.getEntry(reference);
+        switch (entry.type)
+        {
+            case PDFXRefTable::EntryType::Free:
+                return PDFObject();
+
+            case PDFXRefTable::EntryType::Occupied:
+            {
+                auto objectFetcher = [storage](PDFParsingContext*, PDFObjectReference reference) { return storage->getObject(reference); };
+                PDFParsingContext context(objectFetcher);
+                PDFObject object = PDFDocumentReader::readObject(m_source, m_sourceOwner, m_objectArena, m_dataCache.get(), &context, entry.offset, reference);
+
+                // Encryption dictionary is never encrypted, see PDFDocumentReader::processSecurityHandler
+                const bool isEncryptDictionary = m_encryptObjectReference.objectNumber != 0 && m_encryptObjectReference == reference;
+                if (m_securityHandler && m_securityHandler->getMode() != EncryptionMode::None && !isEncryptDictionary)
+                {
+                    object = m_securityHandler->decryptObject(object, reference, m_streamDecryptor);
+                }
+
+                return object;
+            }
+
+            case PDFXRefTable::EntryType::InObjectStream:
+                return loadObjectFromObjectStream(storage, entry);
+        }
+
+        return PDFObject();
+    }
+
+private:
+    using PDFDecodedObjectStreamPointer = std::shared_ptr<const PDFDecodedObjectStream>;
+
+    /// Estimated size of one entry of the object offset table
+    static constexpr qint64 OFFSET_ENTRY_SIZE_ESTIMATE = 48;
+
+    PDFDecodedObjectStreamPointer getObjectStream(const PDFObjectStorage* storage, PDFObjectReference objectStreamReference)
+    {
+        auto it = m_objectStreams.find(objectStreamReference.objectNumber);
+        if (it != m_objectStreams.cend())
+        {
+            // Object stream is owned by the map, which lives as long as the loader
+            return PDFDecodedObjectStreamPointer(PDFDecodedObjectStreamPointer(), &it->second);
+        }
+
+        if (const PDFDecodedObjectStreamPointer* cachedObjectStream = m_decodedObjectStreams.object(objectStreamReference.objectNumber))
+        {
+            return *cachedObjectStream;
+        }
+
+        // Decoding can throw an exception, in that case, object will be null
+        // and object stream will be decoded again next time.
+        auto objectStream = std::make_shared<PDFDecodedObjectStream>(PDFDecodedObjectStream::decode(storage->getObject(objectStreamReference), objectStreamReference, m_securityHandler.data()));
+        const qint64 cost = qMax<qint64>(objectStream->data.size() + qint64(objectStream->offsets.size()) * OFFSET_ENTRY_SIZE_ESTIMATE, 1);
+        m_decodedObjectStreams.insert(objectStreamReference.objectNumber, new PDFDecodedObjectStreamPointer(objectStream), cost);
+        return objectStream;
+    }
+
+    PDFObject loadObjectFromObjectStream(const PDFObjectStorage* storage, const PDFXRefTable::Entry& entry)
+    {
+        // Object stream is held by the pointer, because it can be evicted
+        // from the cache, when another object stream is decoded during parsing.
+        const PDFDecodedObjectStreamPointer objectStreamPointer = getObjectStream(storage, entry.objectStream);
+        const PDFDecodedObjectStream& objectStream = *objectStreamPointer;
+
+        auto it = objectStream.offsets.find(entry.reference.objectNumber);
+        if (it == objectStream.offsets.cend())
+        {
+            // Silently ignore this error, object will be null
+            return PDFObject();
+        }
+
+        auto objectFetcher = [storage](PDFParsingContext*, PDFObjectReference reference) { return storage->getObject(reference); };
+        PDFParsingContext context(objectFetcher);
+        PDFParsingContext::PDFParsingContextGuard guard(&context, entry.objectStream);
+        PDFParser parser(objectStream.data, &context, PDFParser::AllowStreams);
+        parser.setObjectArena(m_objectArena);
+        parser.seek(it->second);
+        return parser.getObject();
+    }
+
+    QByteArray m_source;
+    PDFStreamDataOwner m_sourceOwner;
+    PDFObjectArenaPointer m_objectArena;
+    std::shared_ptr<PDFDocumentDataCache> m_dataCache;
+    PDFXRefTable m_xrefTable;
+    PDFSecurityHandlerPointer m_securityHandler;
+    PDFStreamDecryptorPointer m_streamDecryptor;
+    PDFObjectReference m_encryptObjectReference;
+    std::map<PDFInteger, PDFDecodedObjectStream> m_objectStreams;
+    PDFStreamDataOwner m_objectStreamsOwner;
+    QCache<PDFInteger, PDFDecodedObjectStreamPointer> m_decodedObjectStreams;
+};
+
 PDFDocumentReader::PDFDocumentReader(PDFProgress* progress, const std::function<QString(bool*)>& getPasswordCallback, bool permissive, bool authorizeOwnerOnly) :
     m_result(Result::OK),
     m_getPasswordCallback(getPasswordCallback),
@@ -59,30 +518,17 @@ PDFDocument PDFDocumentReader::readFromFile(const QString& fileName)
 
     if (file.exists())
     {
+        // Map the file into the memory, if it is possible. Stream data of the document
+        // then refer directly to the mapped memory, so document costs page cache
+        // instead of heap memory, and no data are copied.
+        if (std::shared_ptr<PDFMappedFile> mappedFile = PDFMappedFile::map(fileName))
+        {
+            QByteArray fileData = mappedFile->getData();
+            return readFromSource(fileData, std::move(mappedFile));
+        }
+
         if (file.open(QFile::ReadOnly))
         {
-            // OPTIMIZATION: Use memory mapping for large files (>10MB)
-            // This reduces memory allocation overhead and allows the OS to manage paging
-            constexpr qint64 MEMORY_MAP_THRESHOLD = 10 * 1024 * 1024; // 10 MB
-            
-            QByteArray fileData;
-            if (file.size() >= MEMORY_MAP_THRESHOLD)
-            {
-                // Try memory mapping for large files
-                uchar* mappedData = file.map(0, file.size());
-                if (mappedData)
-                {
-                    // Create a QByteArray that references the mapped memory without copying
-                    fileData = QByteArray::fromRawData(reinterpret_cast<const char*>(mappedData), file.size());
-                    PDFDocument document = readFromBuffer(fileData);
-                    file.unmap(mappedData);
-                    file.close();
-                    return document;
-                }
-                // Fall through to standard read if mapping failed
-            }
-            
-            // Standard read for small files or if mapping failed
             PDFDocument document = readFromDevice(&file);
             file.close();
             return document;
@@ -106,12 +552,26 @@ PDFDocument PDFDocumentReader::readFromDevice(QIODevice* device)
 {
     reset();
 
+    // Regular files are memory mapped. We map the file by its name, because mapping
+    // made by the device itself would be released together with the device. Files
+    // opened for writing are read from the device, because they can contain
+    // data, which were not yet flushed.
+    QFile* file = qobject_cast<QFile*>(device);
+    if (file && !file->fileName().isEmpty() && !file->isSequential() && (!file->isOpen() || (file->isReadable() && !file->isWritable())))
+    {
+        if (std::shared_ptr<PDFMappedFile> mappedFile = PDFMappedFile::map(file->fileName()))
+        {
+            QByteArray fileData = mappedFile->getData();
+            return readFromSource(fileData, std::move(mappedFile));
+        }
+    }
+
     if (device->isOpen())
     {
         if (device->isReadable())
         {
             // Do not close the device, it was not opened by us.
-            return readFromBuffer(device->readAll());
+            return readFromSource(device->readAll(), nullptr);
         }
         else
         {
@@ -123,7 +583,7 @@ PDFDocument PDFDocumentReader::readFromDevice(QIODevice* device)
     {
         QByteArray byteArray = device->readAll();
         device->close();
-        return readFromBuffer(byteArray);
+        return readFromSource(byteArray, nullptr);
     }
     else
     {
@@ -193,7 +653,7 @@ void PDFDocumentReader::checkHeader(const QByteArray& buffer)
 
 PDFInteger PDFDocumentReader::findXrefTableOffset(const QByteArray& buffer)
 {
-    const int startXRefPosition = findFromEnd(PDF_START_OF_XREF_MARK, buffer, PDF_FOOTER_SCAN_LIMIT);
+    const PDFInteger startXRefPosition = findFromEnd(PDF_START_OF_XREF_MARK, buffer, PDF_FOOTER_SCAN_LIMIT);
     if (startXRefPosition == FIND_NOT_FOUND_RESULT)
     {
         throw PDFException(tr("Start of object reference table not found."));
@@ -213,9 +673,50 @@ PDFInteger PDFDocumentReader::findXrefTableOffset(const QByteArray& buffer)
 
 PDFObject PDFDocumentReader::getObject(PDFParsingContext* context, PDFInteger offset, PDFObjectReference reference) const
 {
+    return readObject(m_source, m_sourceOwner, m_objectArena, m_dataCache.get(), context, offset, reference);
+}
+
+PDFObject PDFDocumentReader::readObject(const QByteArray& source,
+                                        const PDFStreamDataOwner& sourceOwner,
+                                        const PDFObjectArenaPointer& objectArena,
+                                        PDFDocumentDataCache* dataCache,
+                                        PDFParsingContext* context,
+                                        PDFInteger offset,
+                                        PDFObjectReference reference)
+{
+    if (dataCache)
+    {
+        // We fetch data until end of object mark is found, and we parse the object
+        // only from the data before the mark, so unfetched data are never parsed.
+        // If parsing fails, end of object mark can be a part of stream data,
+        // so we try it again with the next mark.
+        PDFInteger searchOffset = offset;
+        while (true)
+        {
+            const PDFInteger endOffset = dataCache->fetchUntil(searchOffset, PDF_OBJECT_END_MARK);
+            const QByteArray data = QByteArray::fromRawData(source.constData(), endOffset);
+
+            try
+            {
+                return readObject(data, sourceOwner, objectArena, nullptr, context, offset, reference);
+            }
+            catch (const PDFException&)
+            {
+                if (endOffset >= source.size())
+                {
+                    throw;
+                }
+
+                searchOffset = endOffset;
+            }
+        }
+    }
+
     PDFParsingContext::PDFParsingContextGuard guard(context, reference);
 
-    PDFParser parser(m_source, context, PDFParser::AllowStreams);
+    PDFParser parser(source, context, PDFParser::AllowStreams);
+    parser.setDataOwner(sourceOwner);
+    parser.setObjectArena(objectArena);
     parser.seek(offset);
 
     PDFObject objectNumber = parser.getObject();
@@ -247,7 +748,7 @@ PDFObject PDFDocumentReader::getObject(PDFParsingContext* context, PDFInteger of
     return object;
 }
 
-PDFObject PDFDocumentReader::getObjectFromXrefTable(PDFXRefTable* xrefTable, PDFParsingContext* context, PDFObjectReference reference) const
+PDFObject PDFDocumentReader::getObjectFromXrefTable(const PDFXRefTable* xrefTable, PDFParsingContext* context, PDFObjectReference reference) const
 {
     const PDFXRefTable::Entry& entry = xrefTable->getEntry(reference);
     switch (entry.type)
@@ -429,9 +930,21 @@ PDFDocumentReader::Result PDFDocumentReader::processSecurityHandler(const PDFObj
     // because it needs object number and generation for generating the decrypt key. So 1) is handled
     // automatically. 2) is handled in the code below. 3) is handled also automatically, because we do not
     // decipher object streams here. 4) must be handled in the security handler.
+    //
+    // Stream contents are not decrypted here, they are decrypted lazily, when stream
+    // is accessed or decoded, so streams, which are never used, are never decrypted.
+    decryptObjects(encryptObjectReference, occupiedEntries, objects);
+    return m_result;
+}
+
+void PDFDocumentReader::decryptObjects(PDFObjectReference encryptObjectReference,
+                                       const std::vector<PDFXRefTable::Entry>& occupiedEntries,
+                                       PDFObjectStorage::PDFObjects& objects)
+{
     if (m_securityHandler->getMode() != EncryptionMode::None)
     {
-        auto decryptEntry = [this, encryptObjectReference, &objects](const PDFXRefTable::Entry& entry)
+        PDFStreamDecryptorPointer streamDecryptor = PDFSecurityHandler::createStreamDecryptor(m_securityHandler);
+        auto decryptEntry = [this, encryptObjectReference, &objects, &streamDecryptor](const PDFXRefTable::Entry& entry)
         {
             progressStep();
 
@@ -441,21 +954,18 @@ PDFDocumentReader::Result PDFDocumentReader::processSecurityHandler(const PDFObj
                 return;
             }
 
-            objects[entry.reference.objectNumber].object = m_securityHandler->decryptObject(objects[entry.reference.objectNumber].object, entry.reference);
+            objects[entry.reference.objectNumber].object = m_securityHandler->decryptObject(objects[entry.reference.objectNumber].object, entry.reference, streamDecryptor);
         };
 
         progressStart(occupiedEntries.size(), PDFTranslationContext::tr("Decrypting encrypted contents of document..."));
         PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, occupiedEntries.cbegin(), occupiedEntries.cend(), decryptEntry);
         progressFinish();
     }
-
-    return m_result;
 }
 
-void PDFDocumentReader::processObjectStreams(PDFXRefTable* xrefTable, PDFObjectStorage::PDFObjects& objects)
+void PDFDocumentReader::processObjectStreams(PDFXRefTable* xrefTable, const std::vector<PDFXRefTable::Entry>& objectStreamEntries, PDFObjectStorage::PDFObjects& objects)
 {
     // Then process object streams
-    std::vector<PDFXRefTable::Entry> objectStreamEntries = xrefTable->getObjectStreamEntries();
     std::set<PDFObjectReference> objectStreams;
     for (const PDFXRefTable::Entry& entry : objectStreamEntries)
     {
@@ -509,6 +1019,7 @@ void PDFDocumentReader::processObjectStreams(PDFXRefTable* xrefTable, PDFObjectS
 
             PDFParsingContext::PDFParsingContextGuard guard(&context, objectStreamReference);
             PDFParser parser(objectStreamData, &context, PDFParser::AllowStreams);
+            parser.setObjectArena(m_objectArena);
 
             std::vector<std::pair<PDFInteger, PDFInteger>> objectNumberAndOffset;
             objectNumberAndOffset.reserve(n);
@@ -560,11 +1071,68 @@ void PDFDocumentReader::processObjectStreams(PDFXRefTable* xrefTable, PDFObjectS
 
 PDFDocument PDFDocumentReader::readFromBuffer(const QByteArray& buffer)
 {
-    bool shouldTryPermissiveReading = true;
+    m_dataCache.reset();
+    return readFromSource(buffer, nullptr);
+}
+
+PDFDocument PDFDocumentReader::readFromDataSource(PDFDocumentDataSourcePointer source)
+{
+    reset();
+
+    if (!source)
+    {
+        m_result = Result::Failed;
+        m_errorMessage = tr("Invalid document data source.");
+        return PDFDocument();
+    }
+
+    try
+    {
+        m_dataCache = std::make_shared<PDFDocumentDataCache>(std::move(source));
+
+        // Header and footer of the document are always needed
+        m_dataCache->fetch(0, PDF_HEADER_SCAN_LIMIT);
+        m_dataCache->fetch(m_dataCache->getSize() - PDF_FOOTER_SCAN_LIMIT, PDF_FOOTER_SCAN_LIMIT);
+    }
+    catch (const PDFException& exception)
+    {
+        m_result = Result::Failed;
+        m_errorMessage = exception.getMessage();
+        return PDFDocument();
+    }
+
+    QByteArray data = m_dataCache->getData();
+    return readFromSource(data, m_dataCache);
+}
+
+PDFDocument PDFDocumentReader::readFromSource(const QByteArray& buffer, PDFStreamDataOwner sourceOwner)
+{
+    PDF_TRACE_ZONE("ReadDocument", "io");
+
+    // Damaged document can't be restored from the data source,
+    // because whole document would have to be read.
+    bool shouldTryPermissiveReading = !m_dataCache;
 
     try
     {
         m_source = buffer;
+        m_sourceOwner = std::move(sourceOwner);
+        m_objectArena = m_objectArenaAllocation ? std::make_shared<PDFObjectArena>() : nullptr;
+        m_sourceHash = m_dataCache ? m_dataCache->getIdentityHash() : hash(buffer);
+        readLinearizationInfo(buffer);
+
+        // If we have a snapshot of this document, then we use it
+        // instead of reading the reference table and object streams.
+        if (!m_snapshotCacheDirectory.isEmpty() && !m_dataCache)
+        {
+            PDFDocumentSnapshot snapshot;
+            if (snapshot.load(PDFDocumentSnapshot::getFileName(m_snapshotCacheDirectory, m_sourceHash), m_sourceHash, buffer.size()))
+            {
+                m_version = snapshot.version;
+                shouldTryPermissiveReading = false;
+                return readLazyDocument(snapshot.xrefTable, &snapshot);
+            }
+        }
 
         // FOOTER CHECKING
         //  1) Check, if EOF marking is present
@@ -579,13 +1147,29 @@ PDFDocument PDFDocumentReader::readFromBuffer(const QByteArray& buffer)
 
         // Now, we are ready to scan xref table
         PDFXRefTable xrefTable;
-        xrefTable.readXRefTable(nullptr, buffer, firstXrefTableOffset);
+        std::function<void(PDFInteger)> sectionDataRequest;
+        if (m_dataCache)
+        {
+            // Each section of the reference table is followed by the offset of the section
+            sectionDataRequest = [this](PDFInteger offset) { m_dataCache->fetchUntil(offset, PDF_START_OF_XREF_MARK); };
+        }
+        xrefTable.readXRefTable(nullptr, buffer, firstXrefTableOffset, sectionDataRequest);
 
         if (xrefTable.getSize() == 0)
         {
             throw PDFException(tr("Empty xref table."));
         }
 
+        readRevisions(xrefTable);
+
+        if (m_lazyObjectLoading || m_dataCache)
+        {
+            // Security handler is created using encryption dictionary, we can't
+            // restore the document after this point (see below).
+            shouldTryPermissiveReading = false;
+            return readLazyDocument(xrefTable, nullptr);
+        }
+
         PDFObjectStorage::PDFObjects objects;
         objects.resize(xrefTable.getSize());
 
@@ -607,10 +1191,17 @@ PDFDocument PDFDocumentReader::readFromBuffer(const QByteArray& buffer)
         // this point. After this point, security is decrypted. If something fails here,
         // then document can't be restored (user can't be asked multiple times for password).
         shouldTryPermissiveReading = !m_securityHandler || m_securityHandler->getMode() == EncryptionMode::None;
-        processObjectStreams(&xrefTable, objects);
+        processObjectStreams(&xrefTable, xrefTable.getObjectStreamEntries(), objects);
+
+        if (!m_snapshotCacheDirectory.isEmpty())
+        {
+            writeSnapshot(xrefTable);
+        }
 
         PDFObjectStorage storage(std::move(objects), PDFObject(xrefTable.getTrailerDictionary()), qMove(m_securityHandler));
-        return PDFDocument(std::move(storage), m_version, hash(buffer));
+        storage.setSourceDataOwner(m_sourceOwner);
+        storage.setDecodedStreamCacheBudget(m_decodedStreamCacheBudget);
+        return PDFDocument(std::move(storage), m_version, m_sourceHash);
     }
     catch (const PDFException &parserException)
     {
@@ -627,80 +1218,495 @@ PDFDocument PDFDocumentReader::readFromBuffer(const QByteArray& buffer)
     return PDFDocument();
 }
 
-QByteArray PDFDocumentReader::hash(const QByteArray& sourceData)
+PDFXRefTable PDFDocumentReader::readReferenceTableFromFile(const QString& fileName)
 {
-    return QCryptographicHash::hash(sourceData, QCryptographicHash::Sha256);
-}
+    reset();
 
-std::vector<std::pair<int, int>> PDFDocumentReader::findObjectByteOffsets(const QByteArray& buffer) const
-{
-    std::vector<std::pair<int, int>> offsets;
-    int lastOffset = 0;
-    const int shift = static_cast<int>(std::strlen(PDF_OBJECT_END_MARK));
-    while (lastOffset < buffer.size())
+    QByteArray buffer;
+    if (std::shared_ptr<PDFMappedFile> mappedFile = PDFMappedFile::map(fileName))
     {
-        int offset = buffer.indexOf(PDF_OBJECT_END_MARK, lastOffset);
-
-        // Object end mark was not found
-        if (offset == -1)
+        buffer = mappedFile->getData();
+        m_sourceOwner = std::move(mappedFile);
+    }
+    else
+    {
+        QFile file(fileName);
+        if (!file.open(QFile::ReadOnly))
         {
-            break;
+            m_result = Result::Failed;
+            m_errorMessage = tr("File '%1' cannot be opened for reading. %2").arg(fileName, file.errorString());
+            return PDFXRefTable();
         }
 
-        offset += shift;
+        buffer = file.readAll();
+        file.close();
+    }
 
-        int startOffset = buffer.indexOf(PDF_OBJECT_START_MARK, lastOffset);
-        if (startOffset != -1 && startOffset < offset)
-        {
-            --startOffset;
+    try
+    {
+        m_source = buffer;
+        readLinearizationInfo(buffer);
 
-            // Skip whitespace between obj and generation number
-            while (startOffset >= 0 && PDFLexicalAnalyzer::isWhitespace(buffer[startOffset]))
-            {
-                --startOffset;
-            }
+        checkFooter(buffer);
+        const PDFInteger firstXrefTableOffset = findXrefTableOffset(buffer);
+        checkHeader(buffer);
 
-            // Skip generation number
-            while (startOffset >= 0 && std::isdigit(buffer[startOffset]))
-            {
-                --startOffset;
-            }
+        PDFXRefTable xrefTable;
+        xrefTable.readXRefTable(nullptr, buffer, firstXrefTableOffset, nullptr);
 
-            // Skip whitespace between generation number and object number
-            while (startOffset >= 0 && PDFLexicalAnalyzer::isWhitespace(buffer[startOffset]))
-            {
-                --startOffset;
-            }
+        if (xrefTable.getSize() == 0)
+        {
+            throw PDFException(tr("Empty xref table."));
+        }
+
+        readRevisions(xrefTable);
+        return xrefTable;
+    }
+    catch (const PDFException &parserException)
+    {
+        m_result = Result::Failed;
+        m_errorMessage = parserException.getMessage();
+        m_warnings << m_errorMessage;
+    }
+
+    return PDFXRefTable();
+}
+
+PDFDocument PDFDocumentReader::readIncrementalUpdate(const QByteArray& buffer, const PDFDocument& baseDocument, const PDFDocumentRevision& baseRevision)
+{
+    reset();
 
-            // Skip object number
-            while (startOffset >= 0 && std::isdigit(buffer[startOffset]))
+    try
+    {
+        m_source = buffer;
+        m_objectArena = m_objectArenaAllocation ? std::make_shared<PDFObjectArena>() : nullptr;
+        m_sourceHash = hash(buffer);
+        readLinearizationInfo(buffer);
+
+        checkFooter(buffer);
+        const PDFInteger firstXrefTableOffset = findXrefTableOffset(buffer);
+        checkHeader(buffer);
+
+        // Reference table is always read completely, it is cheap, and we
+        // need to know, in which revision each object was defined.
+        PDFXRefTable xrefTable;
+        xrefTable.readXRefTable(nullptr, buffer, firstXrefTableOffset, nullptr);
+
+        if (xrefTable.getSize() == 0)
+        {
+            throw PDFException(tr("Empty xref table."));
+        }
+
+        readRevisions(xrefTable);
+
+        const std::vector<PDFXRefTable::Revision>& revisions = xrefTable.getRevisions();
+        auto isBaseRevision = [&baseRevision](const PDFXRefTable::Revision& revision) { return revision.xrefOffset == baseRevision.xrefOffset; };
+        auto baseRevisionIt = std::find_if(revisions.cbegin(), revisions.cend(), isBaseRevision);
+        if (!baseRevision.isValid() || baseRevisionIt == revisions.cend() || baseRevisionIt->endOffset != baseRevision.endOffset)
+        {
+            m_warnings << tr("Base revision of the document was not found, document is read completely.");
+            return readFromBuffer(buffer);
+        }
+
+        const int baseRevisionIndex = static_cast<int>(std::distance(revisions.cbegin(), baseRevisionIt));
+        const PDFObjectStorage& baseStorage = baseDocument.getStorage();
+
+        // Objects of the base document are shared with this document
+        PDFObjectStorage::PDFObjects objects = baseStorage.getObjects();
+        objects.resize(qMax(objects.size(), xrefTable.getSize()));
+
+        auto isUpdated = [&xrefTable, baseRevisionIndex](const PDFXRefTable::Entry& entry) { return xrefTable.getEntryRevision(entry.reference.objectNumber) > baseRevisionIndex; };
+        std::vector<PDFXRefTable::Entry> occupiedEntries = xrefTable.getOccupiedEntries();
+        std::vector<PDFXRefTable::Entry> objectStreamEntries = xrefTable.getObjectStreamEntries();
+        occupiedEntries.erase(std::remove_if(occupiedEntries.begin(), occupiedEntries.end(), std::not_fn(isUpdated)), occupiedEntries.end());
+        objectStreamEntries.erase(std::remove_if(objectStreamEntries.begin(), objectStreamEntries.end(), std::not_fn(isUpdated)), objectStreamEntries.end());
+
+        // Objects defined (or freed) in newer revisions replace objects of the base document
+        for (size_t objectNumber = 0; objectNumber < xrefTable.getSize(); ++objectNumber)
+        {
+            if (xrefTable.getEntryRevision(static_cast<PDFInteger>(objectNumber)) > baseRevisionIndex)
             {
-                --startOffset;
+                objects[objectNumber] = PDFObjectStorage::Entry();
             }
+        }
+
+        if (processReferenceTableEntries(&xrefTable, occupiedEntries, objects) != Result::OK)
+        {
+            return PDFDocument();
+        }
+
+        // Updated objects are encrypted in the same way as the base document
+        const PDFSecurityHandler* baseSecurityHandler = baseStorage.getSecurityHandler();
+        m_securityHandler = PDFSecurityHandlerPointer(baseSecurityHandler ? baseSecurityHandler->clone() : new PDFNoneSecurityHandler());
+
+        PDFObjectReference encryptObjectReference;
+        const PDFObject& trailerDictionaryObject = xrefTable.getTrailerDictionary();
+        const PDFDictionary* trailerDictionary = nullptr;
+        if (trailerDictionaryObject.isDictionary())
+        {
+            trailerDictionary = trailerDictionaryObject.getDictionary();
+        }
+        else if (trailerDictionaryObject.isStream())
+        {
+            trailerDictionary = trailerDictionaryObject.getStream()->getDictionary();
+        }
+
+        if (trailerDictionary && trailerDictionary->get("Encrypt").isReference())
+        {
+            encryptObjectReference = trailerDictionary->get("Encrypt").getReference();
+        }
+        decryptObjects(encryptObjectReference, occupiedEntries, objects);
+
+        processObjectStreams(&xrefTable, objectStreamEntries, objects);
+
+        if (m_result != Result::OK)
+        {
+            return PDFDocument();
+        }
+
+        PDFObjectStorage storage(std::move(objects), PDFObject(trailerDictionaryObject), qMove(m_securityHandler));
+        storage.setSourceDataOwner(baseStorage.getSourceDataOwner());
+        storage.setDecodedStreamCacheBudget(m_decodedStreamCacheBudget);
+        return PDFDocument(std::move(storage), m_version, m_sourceHash);
+    }
+    catch (const PDFException &parserException)
+    {
+        m_result = Result::Failed;
+        m_errorMessage = parserException.getMessage();
+        m_warnings << m_errorMessage;
+    }
+
+    return PDFDocument();
+}
+
+void PDFDocumentReader::readRevisions(const PDFXRefTable& xrefTable)
+{
+    const std::vector<PDFXRefTable::Revision>& revisions = xrefTable.getRevisions();
+
+    m_revisions.clear();
+    m_revisions.resize(revisions.size());
+    for (size_t i = 0; i < revisions.size(); ++i)
+    {
+        m_revisions[i].xrefOffset = revisions[i].xrefOffset;
+        m_revisions[i].endOffset = revisions[i].endOffset;
+    }
+
+    for (size_t objectNumber = 0; objectNumber < xrefTable.getSize(); ++objectNumber)
+    {
+        const int revision = xrefTable.getEntryRevision(static_cast<PDFInteger>(objectNumber));
+        if (revision >= 0 && revision < static_cast<int>(m_revisions.size()))
+        {
+            ++m_revisions[revision].objectCount;
+        }
+    }
+}
 
-            ++startOffset;
+PDFDocument PDFDocumentReader::readLazyDocument(const PDFXRefTable& xrefTable, PDFDocumentSnapshot* snapshot)
+{
+    PDFObjectStorage::PDFObjects objects;
+    objects.resize(xrefTable.getSize());
+
+    for (const PDFXRefTable::Entry& entry : xrefTable.getOccupiedEntries())
+    {
+        objects[entry.reference.objectNumber].generation = entry.reference.generation;
+    }
+
+    // Only encryption dictionary is needed to create the security handler. It is
+    // never encrypted and never stored in the object stream.
+    const PDFObject& trailerDictionaryObject = xrefTable.getTrailerDictionary();
+    const PDFDictionary* trailerDictionary = nullptr;
+    if (trailerDictionaryObject.isDictionary())
+    {
+        trailerDictionary = trailerDictionaryObject.getDictionary();
+    }
+    else if (trailerDictionaryObject.isStream())
+    {
+        trailerDictionary = trailerDictionaryObject.getStream()->getDictionary();
+    }
+
+    PDFObjectReference encryptObjectReference;
+    if (trailerDictionary && trailerDictionary->get("Encrypt").isReference())
+    {
+        encryptObjectReference = trailerDictionary->get("Encrypt").getReference();
+        if (static_cast<size_t>(encryptObjectReference.objectNumber) < objects.size() && objects[encryptObjectReference.objectNumber].generation == encryptObjectReference.generation)
+        {
+            auto objectFetcher = [this, &xrefTable](PDFParsingContext* context, PDFObjectReference reference) { return getObjectFromXrefTable(&xrefTable, context, reference); };
+            PDFParsingContext context(objectFetcher);
+            objects[encryptObjectReference.objectNumber].object = getObjectFromXrefTable(&xrefTable, &context, encryptObjectReference);
+        }
+    }
+
+    if (processSecurityHandler(trailerDictionaryObject, std::vector<PDFXRefTable::Entry>(), objects) == Result::Cancelled)
+    {
+        return PDFDocument();
+    }
+
+    if (!snapshot && !m_snapshotCacheDirectory.isEmpty() && !m_dataCache)
+    {
+        writeSnapshot(xrefTable);
+    }
+
+    auto loader = std::make_unique<PDFDocumentReaderObjectLoader>(m_source, m_sourceOwner, m_objectArena, xrefTable, m_securityHandler, encryptObjectReference);
+    loader->setDataCache(m_dataCache);
+    if (snapshot)
+    {
+        loader->setDecodedObjectStreams(std::move(snapshot->objectStreams), std::move(snapshot->dataOwner));
+    }
+
+    PDFObjectStorage storage(std::move(objects), PDFObject(trailerDictionaryObject), qMove(m_securityHandler), std::move(loader));
+    storage.setSourceDataOwner(m_sourceOwner);
+    storage.setDecodedStreamCacheBudget(m_decodedStreamCacheBudget);
+    return PDFDocument(std::move(storage), m_version, m_sourceHash);
+}
+
+void PDFDocumentReader::readLinearizationInfo(const QByteArray& buffer)
+{
+    m_linearizationInfo = PDFLinearizationInfo();
+
+    try
+    {
+        // Linearization dictionary must be entirely contained in the first 1024 bytes
+        const QByteArray header = QByteArray::fromRawData(buffer.constData(), qMin(buffer.size(), qsizetype(1024)));
+
+        PDFParsingContext context([](PDFParsingContext*, PDFObjectReference) { return PDFObject(); });
+        PDFParser parser(header, &context, PDFParser::None);
+
+        PDFObject objectNumber = parser.getObject();
+        PDFObject generation = parser.getObject();
+
+        if (!objectNumber.isInt() || !generation.isInt() || !parser.fetchCommand(PDF_OBJECT_START_MARK))
+        {
+            return;
+        }
 
-            if (startOffset < offset)
+        PDFObject object = parser.getObject();
+        if (!object.isDictionary() || !parser.fetchCommand(PDF_OBJECT_END_MARK))
+        {
+            return;
+        }
+
+        const PDFDictionary* dictionary = object.getDictionary();
+        const PDFObject& linearized = dictionary->get("Linearized");
+        const PDFObject& length = dictionary->get("L");
+        const PDFObject& hint = dictionary->get("H");
+        const PDFObject& firstPage = dictionary->get("O");
+        const PDFObject& firstPageEnd = dictionary->get("E");
+        const PDFObject& pageCount = dictionary->get("N");
+        const PDFObject& mainXRefTableEntry = dictionary->get("T");
+
+        if (!(linearized.isInt() || linearized.isReal()) || !length.isInt() || !firstPage.isInt() ||
+            !firstPageEnd.isInt() || !pageCount.isInt() || !mainXRefTableEntry.isInt())
+        {
+            return;
+        }
+
+        // If file was updated incrementally, then linearization is no longer valid
+        if (length.getInteger() != buffer.size())
+        {
+            return;
+        }
+
+        const PDFArray* hintArray = hint.isArray() ? hint.getArray() : nullptr;
+        if (!hintArray || hintArray->getCount() < 2 || !hintArray->getItem(0).isInt() || !hintArray->getItem(1).isInt())
+        {
+            return;
+        }
+
+        m_linearizationInfo.fileLength = length.getInteger();
+        m_linearizationInfo.hintStreamOffset = hintArray->getItem(0).getInteger();
+        m_linearizationInfo.hintStreamLength = hintArray->getItem(1).getInteger();
+        m_linearizationInfo.firstPageObjectNumber = firstPage.getInteger();
+        m_linearizationInfo.firstPageEndOffset = firstPageEnd.getInteger();
+        m_linearizationInfo.pageCount = pageCount.getInteger();
+        m_linearizationInfo.mainXRefTableEntryOffset = mainXRefTableEntry.getInteger();
+    }
+    catch (const PDFException&)
+    {
+        // Document is not linearized
+        m_linearizationInfo = PDFLinearizationInfo();
+    }
+}
+
+void PDFDocumentReader::writeSnapshot(const PDFXRefTable& xrefTable)
+{
+    PDFDocumentSnapshot snapshot;
+    snapshot.version = m_version;
+    snapshot.xrefTable = xrefTable;
+
+    // Decoded object streams of encrypted documents are not stored,
+    // because they contain decrypted data.
+    if (!m_securityHandler || m_securityHandler->getMode() == EncryptionMode::None)
+    {
+        auto objectFetcher = [this, &xrefTable](PDFParsingContext* context, PDFObjectReference reference) { return getObjectFromXrefTable(&xrefTable, context, reference); };
+
+        std::set<PDFObjectReference> objectStreamReferences;
+        for (const PDFXRefTable::Entry& entry : xrefTable.getObjectStreamEntries())
+        {
+            objectStreamReferences.insert(entry.objectStream);
+        }
+
+        for (const PDFObjectReference& objectStreamReference : objectStreamReferences)
+        {
+            try
             {
-                offsets.emplace_back(startOffset, offset);
+                PDFParsingContext context(objectFetcher);
+                PDFObject object = getObjectFromXrefTable(&xrefTable, &context, objectStreamReference);
+                snapshot.objectStreams.emplace(objectStreamReference.objectNumber, PDFDecodedObjectStream::decode(object, objectStreamReference, nullptr));
             }
+            catch (const PDFException&)
+            {
+                // Invalid object stream is decoded again, when it is needed
+            }
+        }
+    }
+
+    snapshot.save(PDFDocumentSnapshot::getFileName(m_snapshotCacheDirectory, m_sourceHash), m_sourceHash, m_source.size());
+}
+
+QByteArray PDFDocumentReader::hash(const QByteArray& sourceData)
+{
+    return QCryptographicHash::hash(sourceData, QCryptographicHash::Sha256);
+}
+
+std::vector<std::pair<int, int>> PDFDocumentReader::findObjectByteOffsets(const QByteArray& buffer) const
+{
+    const int bufferSize = static_cast<int>(buffer.size());
+    const int endMarkLength = static_cast<int>(std::strlen(PDF_OBJECT_END_MARK));
+    const int startMarkLength = static_cast<int>(std::strlen(PDF_OBJECT_START_MARK));
+    const char* begin = buffer.constData();
+
+    struct ScanChunk
+    {
+        int startOffset = 0;
+        int endOffset = 0;
+        std::vector<int> endMarkOffsets;
+    };
+
+    // Split the buffer into chunks, which are scanned for object end marks in parallel.
+    // Mark belongs to the chunk, in which it begins, so scanned ranges overlap by mark
+    // length. Object end mark can't overlap with itself, so we find all marks in this way.
+    std::vector<ScanChunk> chunks;
+    for (int chunkStart = 0; chunkStart < bufferSize;)
+    {
+        ScanChunk chunk;
+        chunk.startOffset = chunkStart;
+        chunk.endOffset = chunkStart + qMin(RECOVERY_SCAN_CHUNK_SIZE, bufferSize - chunkStart);
+        chunkStart = chunk.endOffset;
+        chunks.push_back(std::move(chunk));
+    }
+
+    auto scanChunk = [begin, bufferSize, endMarkLength](ScanChunk& chunk)
+    {
+        const char* chunkEnd = begin + qMin(chunk.endOffset + endMarkLength - 1, bufferSize);
+        const char* position = begin + chunk.startOffset;
+
+        while ((position = PDFByteScanner::find(position, chunkEnd, PDF_OBJECT_END_MARK, endMarkLength)) != chunkEnd)
+        {
+            position += endMarkLength;
+            chunk.endMarkOffsets.push_back(static_cast<int>(std::distance(begin, position)));
         }
+    };
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, chunks.begin(), chunks.end(), scanChunk);
+
+    struct ObjectCandidate
+    {
+        int searchOffset = 0;
+        int startOffset = -1;
+        int endOffset = 0;
+    };
 
-        lastOffset = offset;
+    // Each object is searched between end of previous object and its end mark,
+    // so we can find start of each object independently.
+    std::vector<ObjectCandidate> candidates;
+    int lastOffset = 0;
+    for (const ScanChunk& chunk : chunks)
+    {
+        for (int endMarkOffset : chunk.endMarkOffsets)
+        {
+            ObjectCandidate candidate;
+            candidate.searchOffset = lastOffset;
+            candidate.endOffset = endMarkOffset;
+            candidates.push_back(candidate);
+            lastOffset = endMarkOffset;
+        }
+    }
+
+    auto findObjectStart = [&buffer, begin, startMarkLength](ObjectCandidate& candidate)
+    {
+        const char* end = begin + candidate.endOffset;
+        const char* found = PDFByteScanner::find(begin + candidate.searchOffset, end, PDF_OBJECT_START_MARK, startMarkLength);
+        if (found == end)
+        {
+            return;
+        }
+
+        int startOffset = static_cast<int>(std::distance(begin, found)) - 1;
+
+        // Skip whitespace between obj and generation number
+        while (startOffset >= 0 && PDFLexicalAnalyzer::isWhitespace(buffer[startOffset]))
+        {
+            --startOffset;
+        }
+
+        // Skip generation number
+        while (startOffset >= 0 && std::isdigit(buffer[startOffset]))
+        {
+            --startOffset;
+        }
+
+        // Skip whitespace between generation number and object number
+        while (startOffset >= 0 && PDFLexicalAnalyzer::isWhitespace(buffer[startOffset]))
+        {
+            --startOffset;
+        }
+
+        // Skip object number
+        while (startOffset >= 0 && std::isdigit(buffer[startOffset]))
+        {
+            --startOffset;
+        }
+
+        candidate.startOffset = startOffset + 1;
+    };
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, candidates.begin(), candidates.end(), findObjectStart);
+
+    std::vector<std::pair<int, int>> offsets;
+    offsets.reserve(candidates.size());
+    for (const ObjectCandidate& candidate : candidates)
+    {
+        if (candidate.startOffset != -1 && candidate.startOffset < candidate.endOffset)
+        {
+            offsets.emplace_back(candidate.startOffset, candidate.endOffset);
+        }
     }
 
     return offsets;
 }
 
-bool PDFDocumentReader::restoreObjects(std::map<PDFObjectReference, PDFObject>& restoredObjects, const std::vector<std::pair<int, int>>& offsets)
+void PDFDocumentReader::restoreObjects(std::map<PDFObjectReference, PDFObject>& restoredObjects, const std::vector<std::pair<int, int>>& offsets)
 {
-    QMutex restoredObjectsMutex;
-    std::atomic_bool succesfull = true;
+    struct RestoredObject
+    {
+        int startOffset = 0;
+        int endOffset = 0;
+        bool failed = false;
+        PDFObjectReference reference;
+        PDFObject object;
+    };
 
-    auto getObject = [&restoredObjects, &restoredObjectsMutex](PDFParsingContext*, PDFObjectReference reference)
+    std::vector<RestoredObject> candidates;
+    candidates.reserve(offsets.size());
+    for (const auto& offset : offsets)
     {
-        QMutexLocker lock(&restoredObjectsMutex);
+        RestoredObject candidate;
+        candidate.startOffset = offset.first;
+        candidate.endOffset = offset.second;
+        candidates.push_back(std::move(candidate));
+    }
 
+    // Restored objects are not modified during the pass, so they can be read without locking
+    auto getObject = [&restoredObjects](PDFParsingContext*, PDFObjectReference reference)
+    {
         auto it = restoredObjects.find(reference);
         if (it != restoredObjects.cend())
         {
@@ -710,22 +1716,26 @@ bool PDFDocumentReader::restoreObjects(std::map<PDFObjectReference, PDFObject>&
         return PDFObject();
     };
 
-    auto processOffsetEntry = [&, this](const std::pair<int, int>& offset)
+    auto processCandidate = [&, this](RestoredObject* candidate)
     {
         PDFParsingContext context(getObject);
-        const int startOffset = offset.first;
-        const int endOffset = offset.second;
+        const int startOffset = candidate->startOffset;
+        const int endOffset = candidate->endOffset;
 
         Q_ASSERT(startOffset >= 0 && startOffset < m_source.size());
         Q_ASSERT(endOffset >= 0 && endOffset <= m_source.size());
         Q_ASSERT(startOffset <= endOffset);
 
+        candidate->failed = false;
+
         try
         {
             const char* begin = m_source.constData() + startOffset;
             const char* end = m_source.constData() + endOffset;
 
             PDFParser parser(begin, end, &context, PDFParser::AllowStreams);
+            parser.setDataOwner(m_sourceOwner);
+            parser.setObjectArena(m_objectArena);
             PDFObject objectNumberObject = parser.getObject();
             PDFObject objectGenerationObject = parser.getObject();
             parser.fetchCommand(PDF_OBJECT_START_MARK);
@@ -736,22 +1746,83 @@ bool PDFDocumentReader::restoreObjects(std::map<PDFObjectReference, PDFObject>&
                 PDFObjectReference reference(objectNumberObject.getInteger(), objectGenerationObject.getInteger());
                 if (reference.isValid())
                 {
-                    QMutexLocker lock(&restoredObjectsMutex);
-                    if (!restoredObjects.count(reference))
-                    {
-                        restoredObjects[reference] = qMove(object);
-                    }
+                    candidate->reference = reference;
+                    candidate->object = qMove(object);
                 }
             }
         }
         catch (const PDFException&)
         {
-            // Do nothing
-            succesfull = false;
+            // Try it again in the next pass
+            candidate->failed = true;
         }
     };
-    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, offsets.cbegin(), offsets.cend(), processOffsetEntry);
-    return succesfull;
+
+    // Start offset of the restored objects, newer objects (with greater offset) are preferred
+    std::map<PDFObjectReference, int> restoredObjectOffsets;
+
+    std::vector<RestoredObject*> pendingCandidates;
+    pendingCandidates.reserve(candidates.size());
+    for (RestoredObject& candidate : candidates)
+    {
+        pendingCandidates.push_back(&candidate);
+    }
+
+    while (!pendingCandidates.empty())
+    {
+        ++m_recoveryStatistics.passCount;
+        PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, pendingCandidates.cbegin(), pendingCandidates.cend(), processCandidate);
+
+        bool isNewObjectRestored = false;
+        std::vector<RestoredObject*> failedCandidates;
+
+        for (RestoredObject* candidate : pendingCandidates)
+        {
+            if (candidate->failed)
+            {
+                failedCandidates.push_back(candidate);
+                continue;
+            }
+
+            if (candidate->object.isNull())
+            {
+                continue;
+            }
+
+            auto it = restoredObjectOffsets.find(candidate->reference);
+            if (it == restoredObjectOffsets.cend())
+            {
+                restoredObjectOffsets[candidate->reference] = candidate->startOffset;
+                restoredObjects[candidate->reference] = qMove(candidate->object);
+                isNewObjectRestored = true;
+            }
+            else
+            {
+                ++m_recoveryStatistics.duplicateObjectCount;
+
+                if (it->second < candidate->startOffset)
+                {
+                    it->second = candidate->startOffset;
+                    restoredObjects[candidate->reference] = qMove(candidate->object);
+                    isNewObjectRestored = true;
+                }
+            }
+
+            candidate->object = PDFObject();
+        }
+
+        if (!isNewObjectRestored)
+        {
+            // Failed objects can't be read using the objects restored so far
+            m_recoveryStatistics.failedObjectCount = static_cast<PDFInteger>(failedCandidates.size());
+            break;
+        }
+
+        pendingCandidates = std::move(failedCandidates);
+    }
+
+    m_recoveryStatistics.candidateCount = static_cast<PDFInteger>(offsets.size());
+    m_recoveryStatistics.restoredObjectCount = static_cast<PDFInteger>(restoredObjects.size());
 }
 
 PDFDocument PDFDocumentReader::readDamagedDocumentFromBuffer(const QByteArray& buffer)
@@ -770,12 +1841,22 @@ PDFDocument PDFDocumentReader::readDamagedDocumentFromBuffer(const QByteArray& b
         }
 
         // Jakub Melka: Try to parse objects - read offsets of objects. We must probably
-        // try second pass, if some streams have referenced objects.
+        // try more passes, if some streams have referenced objects.
+        m_recoveryStatistics = PDFDocumentRecoveryStatistics();
+        m_revisions.clear();
+
+        QElapsedTimer timer;
+        timer.start();
         std::vector<std::pair<int, int>> offsets = findObjectByteOffsets(buffer);
-        if (!restoreObjects(restoredObjects, offsets))
-        {
-            restoreObjects(restoredObjects, offsets);
-        }
+        m_recoveryStatistics.scanTime = timer.restart();
+        restoreObjects(restoredObjects, offsets);
+        m_recoveryStatistics.restoreTime = timer.elapsed();
+
+        m_warnings << PDFTranslationContext::tr("Document is damaged. %1 objects were restored from %2 object candidates (%3 failed) in %4 passes.")
+                      .arg(m_recoveryStatistics.restoredObjectCount)
+                      .arg(m_recoveryStatistics.candidateCount)
+                      .arg(m_recoveryStatistics.failedObjectCount)
+                      .arg(m_recoveryStatistics.passCount);
 
         // We will create security handler.
         PDFObjectStorage::PDFObjects objects;
@@ -800,6 +1881,8 @@ PDFDocument PDFDocumentReader::readDamagedDocumentFromBuffer(const QByteArray& b
         }
 
         PDFObjectStorage storage(std::move(objects), PDFObject(trailerDictionaryObject), qMove(m_securityHandler));
+        storage.setSourceDataOwner(m_sourceOwner);
+        storage.setDecodedStreamCacheBudget(m_decodedStreamCacheBudget);
         return PDFDocument(std::move(storage), m_version, QByteArray());
     }
     catch (const PDFException &parserException)
@@ -817,10 +1900,17 @@ void PDFDocumentReader::reset()
     m_errorMessage = QString();
     m_version = PDFVersion();
     m_source = QByteArray();
+    m_sourceOwner.reset();
+    m_objectArena.reset();
+    m_sourceHash = QByteArray();
+    m_dataCache.reset();
+    m_linearizationInfo = PDFLinearizationInfo();
+    m_recoveryStatistics = PDFDocumentRecoveryStatistics();
+    m_revisions.clear();
     m_securityHandler = nullptr;
 }
 
-int PDFDocumentReader::findFromEnd(const char* what, const QByteArray& byteArray, int limit)
+PDFInteger PDFDocumentReader::findFromEnd(const char* what, const QByteArray& byteArray, PDFInteger limit)
 {
     if (byteArray.isEmpty())
     {
@@ -828,9 +1918,9 @@ int PDFDocumentReader::findFromEnd(const char* what, const QByteArray& byteArray
         return FIND_NOT_FOUND_RESULT;
     }
 
-    const int size = byteArray.size();
-    const int adjustedLimit = qMin(byteArray.size(), limit);
-    const int whatLength = static_cast<int>(std::strlen(what));
+    const PDFInteger size = byteArray.size();
+    const PDFInteger adjustedLimit = qMin(size, limit);
+    const PDFInteger whatLength = static_cast<PDFInteger>(std::strlen(what));
 
     if (adjustedLimit < whatLength)
     {
@@ -878,4 +1968,151 @@ void PDFDocumentReader::progressFinish()
     }
 }
 
+PDFDocumentPreloader::PDFDocumentPreloader(QObject* parent) :
+    BaseClass(parent),
+    m_progress(nullptr),
+    m_document(nullptr),
+    m_cancelled(false)
+{
+
+}
+
+PDFDocumentPreloader::~PDFDocumentPreloader()
+{
+    stop();
+}
+
+void PDFDocumentPreloader::setDocument(const PDFDocument* document)
+{
+    if (m_document != document)
+    {
+        stop();
+        m_document = document;
+    }
+}
+
+void PDFDocumentPreloader::setLinearizationInfo(const PDFLinearizationInfo& linearizationInfo)
+{
+    m_priorityObjects.clear();
+
+    if (linearizationInfo.isValid())
+    {
+        m_priorityObjects.push_back(linearizationInfo.firstPageObjectNumber);
+    }
+}
+
+void PDFDocumentPreloader::start()
+{
+    stop();
+
+    m_cancelled = false;
+    m_futureWatcher = std::nullopt;
+    m_futureWatcher.emplace();
+
+    m_future = QtConcurrent::run(std::bind(&PDFDocumentPreloader::perform, this));
+    connect(&*m_futureWatcher, &QFutureWatcher<void>::finished, this, &PDFDocumentPreloader::onPreloadingPerformed);
+    m_futureWatcher->setFuture(m_future);
+}
+
+void PDFDocumentPreloader::stop()
+{
+    if (m_futureWatcher && !m_futureWatcher->isFinished())
+    {
+        m_cancelled = true;
+        m_futureWatcher->waitForFinished();
+    }
+}
+
+void PDFDocumentPreloader::perform()
+{
+    if (!m_document || !m_document->getStorage().isLazy())
+    {
+        return;
+    }
+
+    const PDFObjectStorage& storage = m_document->getStorage();
+    const size_t count = storage.getObjectCount();
+    std::vector<bool> visited(count, false);
+
+    if (m_progress)
+    {
+        ProgressStartupInfo info;
+        info.showDialog = false;
+        info.text = PDFTranslationContext::tr("Loading document objects.");
+        m_progress->start(count, std::move(info));
+    }
+
+    auto preload = [&](PDFInteger objectNumber) -> const PDFObject*
+    {
+        if (objectNumber < 0 || objectNumber >= static_cast<PDFInteger>(count) || visited[objectNumber])
+        {
+            return nullptr;
+        }
+
+        visited[objectNumber] = true;
+        const PDFObject* object = &storage.preloadObject(objectNumber);
+
+        if (m_progress)
+        {
+            m_progress->step();
+        }
+
+        return object;
+    };
+
+    // First, load priority objects and objects referenced by them. We do not follow
+    // parents, because then whole page tree (and all pages) would be loaded.
+    std::vector<PDFInteger> stack(m_priorityObjects.rbegin(), m_priorityObjects.rend());
+    while (!stack.empty() && !m_cancelled)
+    {
+        const PDFInteger objectNumber = stack.back();
+        stack.pop_back();
+
+        const PDFObject* object = preload(objectNumber);
+        if (!object)
+        {
+            continue;
+        }
+
+        std::set<PDFObjectReference> references;
+        const PDFDictionary* dictionary = storage.getDictionaryFromObject(*object);
+        if (dictionary)
+        {
+            for (size_t i = 0, dictionaryCount = dictionary->getCount(); i < dictionaryCount; ++i)
+            {
+                if (!(dictionary->getKey(i) == "Parent"))
+                {
+                    references.merge(PDFObjectUtils::getDirectReferences(dictionary->getValue(i)));
+                }
+            }
+        }
+        else
+        {
+            references = PDFObjectUtils::getDirectReferences(*object);
+        }
+
+        for (const PDFObjectReference& reference : references)
+        {
+            stack.push_back(reference.objectNumber);
+        }
+    }
+
+    // Then load remaining objects
+    for (size_t i = 0; i < count && !m_cancelled; ++i)
+    {
+        preload(static_cast<PDFInteger>(i));
+    }
+
+    if (m_progress)
+    {
+        m_progress->finish();
+    }
+}
+
+void PDFDocumentPreloader::onPreloadingPerformed()
+{
+    m_cancelled = false;
+    Q_EMIT preloadingFinished();
+}
+
 }   // namespace pdf
@@ -27,14 +27,67 @@
 #include "pdfdocument.h"
 #include "pdfprogress.h"
 #include "pdfxreftable.h"
+#include "pdfdocumentdatasource.h"
 
 #include <QMutex>
+#include <QObject>
+#include <QFuture>
 #include <QIODevice>
+#include <QFutureWatcher>
+
+#include <atomic>
+#include <optional>
 
 namespace pdf
 {
 class PDFXRefTable;
 class PDFParsingContext;
+class PDFDocumentSnapshot;
+
+/// Parameters of linearized (Fast Web View) document, read from the
+/// linearization parameter dictionary, see PDF specification, Annex F.
+struct PDFLinearizationInfo
+{
+    PDFInteger fileLength = 0;                  ///< Length of the file (L)
+    PDFInteger hintStreamOffset = 0;            ///< Offset of primary hint stream (H)
+    PDFInteger hintStreamLength = 0;            ///< Length of primary hint stream (H)
+    PDFInteger firstPageObjectNumber = 0;       ///< Object number of first page's page object (O)
+    PDFInteger firstPageEndOffset = 0;          ///< Offset of the end of first page (E)
+    PDFInteger pageCount = 0;                   ///< Number of pages in the document (N)
+    PDFInteger mainXRefTableEntryOffset = 0;    ///< Offset of the first entry of main reference table (T)
+
+    /// Returns true, if document is linearized and linearization
+    /// is valid (document was not updated incrementally)
+    bool isValid() const { return fileLength > 0; }
+};
+
+/// Statistics of recovery of damaged document. Objects of damaged document
+/// are restored by scanning the source data for object marks.
+struct PDFDocumentRecoveryStatistics
+{
+    PDFInteger candidateCount = 0;      ///< Count of found object candidates (pairs of object start/end marks)
+    PDFInteger restoredObjectCount = 0; ///< Count of restored objects
+    PDFInteger failedObjectCount = 0;   ///< Count of object candidates, which failed to be read in all passes
+    PDFInteger duplicateObjectCount = 0;///< Count of object candidates, which were superseded by newer version of the object
+    PDFInteger passCount = 0;           ///< Count of passes of object restoration
+    qint64 scanTime = 0;                ///< Time of scanning for object marks in milliseconds
+    qint64 restoreTime = 0;             ///< Time of object restoration in milliseconds
+
+    /// Returns true, if document was recovered
+    bool isValid() const { return passCount > 0; }
+};
+
+/// Revision of the read document. Original document is the first revision,
+/// each incremental update appended to the document creates a new revision.
+struct PDFDocumentRevision
+{
+    PDFInteger xrefOffset = -1;     ///< Offset of the reference table section of the revision
+    PDFInteger endOffset = -1;      ///< End of the revision data (offset after end of file mark)
+    PDFInteger objectCount = 0;     ///< Count of objects, whose current entry is defined (or freed) in the revision
+
+    /// Returns true, if revision is valid
+    bool isValid() const { return xrefOffset >= 0; }
+};
 
 /// This class is a reader of PDF document from various devices (file, io device,
 /// byte buffer). This class doesn't throw exceptions, to check errors, use
@@ -60,39 +113,146 @@ public:
 
     /// Reads a PDF document from the specified file. If file doesn't exist,
     /// cannot be opened or contain invalid pdf, empty PDF file is returned.
-    /// No exception is thrown.
+    /// File is memory mapped, if it is possible, and stream data of the document
+    /// refer directly to the mapped memory. No exception is thrown.
     PDFDocument readFromFile(const QString& fileName);
 
     /// Reads a PDF document from the specified device. If device is not opened
     /// for reading, then function tries it to open for reading. If it is opened,
     /// but not for reading, empty PDF document is returned. This also occurs
-    /// when incorrect PDF is read. No exception is thrown.
+    /// when incorrect PDF is read. If device is a regular file, it is memory mapped
+    /// in the same way as in \p readFromFile. No exception is thrown.
     PDFDocument readFromDevice(QIODevice* device);
 
     /// Reads a PDF document from the specified buffer (byte array). If incorrect
     /// PDF is read, then empty PDF document is returned. No exception is thrown.
     PDFDocument readFromBuffer(const QByteArray& buffer);
 
+    /// Reads a PDF document from the random access data source. Only data, which
+    /// are needed, are read from the source (header, trailer, reference table and
+    /// objects, which are accessed), so document is always loaded lazily. Read data
+    /// are cached, and cache exists as long as the document exists. Snapshot cache
+    /// is not used, and damaged documents are not restored. No exception is thrown.
+    /// \param source Data source
+    PDFDocument readFromDataSource(PDFDocumentDataSourcePointer source);
+
+    /// Reads incrementally updated PDF document from the buffer, which contains
+    /// data of the base document followed by the incremental updates. Objects of the base
+    /// document, which were not changed by the updates, are taken from the base document,
+    /// only reference table and objects of newer revisions are parsed. Security handler
+    /// of the base document is used (user is not asked for a password again). If base
+    /// revision is not found in the buffer, then whole document is read. Objects are
+    /// always loaded eagerly. No exception is thrown.
+    /// \param buffer Source data (data of base document with appended updates)
+    /// \param baseDocument Base document, which was read from the beginning of the buffer
+    /// \param baseRevision Newest revision of the base document
+    PDFDocument readIncrementalUpdate(const QByteArray& buffer, const PDFDocument& baseDocument, const PDFDocumentRevision& baseRevision);
+
+    /// Reads only the reference table of the document from the specified file.
+    /// File is memory mapped, if it is possible, objects are not parsed and security
+    /// handler is not created, so reference table of even very large document is read
+    /// quickly. Source data and its owner can be retrieved by \p getSource and
+    /// \p getSourceOwner. Damaged documents are not restored. If error occurs,
+    /// empty reference table is returned. No exception is thrown.
+    /// \param fileName File name
+    PDFXRefTable readReferenceTableFromFile(const QString& fileName);
+
     /// Returns result code for reading document from the device
     Result getReadingResult() const { return m_result; }
 
     /// Returns error message, if document reading was unsuccessfull
     const QString& getErrorMessage() const { return m_errorMessage; }
 
-    /// Get source data of the document
+    /// Get source data of the document. If document was read from memory mapped
+    /// file, then source data refer to the mapped memory, which is valid as long
+    /// as this reader, or document read by this reader, exists.
     const QByteArray& getSource() const { return m_source; }
 
+    /// Returns owner of the source data (for example, memory mapped file),
+    /// or nullptr, if source data are not owned by any object.
+    const PDFStreamDataOwner& getSourceOwner() const { return m_sourceOwner; }
+
     /// Returns warning messages
     const QStringList& getWarnings() const { return m_warnings; }
 
+    /// Returns linearization parameters of read document. If document
+    /// is not linearized, then invalid parameters are returned.
+    const PDFLinearizationInfo& getLinearizationInfo() const { return m_linearizationInfo; }
+
+    /// Returns revisions of read document, sorted from the oldest to the newest.
+    /// Revisions are unknown (empty array is returned), if document was read
+    /// from the snapshot, or if it was damaged.
+    const std::vector<PDFDocumentRevision>& getRevisions() const { return m_revisions; }
+
+    /// Returns statistics of recovery of damaged document. If document
+    /// was not damaged, then invalid statistics is returned.
+    const PDFDocumentRecoveryStatistics& getRecoveryStatistics() const { return m_recoveryStatistics; }
+
+    /// Returns true, if objects of read documents are loaded on demand
+    bool isLazyObjectLoading() const { return m_lazyObjectLoading; }
+
+    /// Enables or disables lazy object loading. If it is enabled, then only
+    /// reference table is read, when document is opened, and objects are parsed,
+    /// when they are accessed for the first time. Lazy loading is not used
+    /// for damaged documents.
+    /// \param lazyObjectLoading Enable lazy object loading
+    void setLazyObjectLoading(bool lazyObjectLoading) { m_lazyObjectLoading = lazyObjectLoading; }
+
+    /// Returns true, if parsed objects are allocated in the object arena
+    bool isObjectArenaAllocation() const { return m_objectArenaAllocation; }
+
+    /// Enables or disables allocation of parsed objects in the object arena. If it
+    /// is enabled, then object contents of the document are allocated from large
+    /// memory chunks, which are released at once, when document is destroyed.
+    /// This speeds up loading of documents with many small objects, but memory
+    /// of objects, which are no longer used, is not released until the document
+    /// is destroyed.
+    /// \param objectArenaAllocation Enable arena allocation
+    void setObjectArenaAllocation(bool objectArenaAllocation) { m_objectArenaAllocation = objectArenaAllocation; }
+
+    /// Returns snapshot cache directory (empty string, if snapshot cache is disabled)
+    const QString& getSnapshotCacheDirectory() const { return m_snapshotCacheDirectory; }
+
+    /// Sets snapshot cache directory. If it is set, then parsed structure of the
+    /// document (reference table, trailer dictionary and decoded object streams
+    /// of unencrypted documents) is stored in this directory, as a snapshot identified
+    /// by the hash of the document. When the same document is read again, snapshot
+    /// is memory mapped, and document is loaded lazily using the snapshot, without
+    /// scanning the reference table and decoding object streams. Empty directory
+    /// disables snapshot cache.
+    /// \param snapshotCacheDirectory Snapshot cache directory
+    void setSnapshotCacheDirectory(const QString& snapshotCacheDirectory) { m_snapshotCacheDirectory = snapshotCacheDirectory; }
+
+    /// Returns budget of the decoded stream cache of read documents in bytes
+    qint64 getDecodedStreamCacheBudget() const { return m_decodedStreamCacheBudget; }
+
+    /// Sets budget of the decoded stream cache of read documents. Decoded
+    /// data of streams, which are accessed repeatedly, are then kept in the cache
+    /// up to this size. Zero or negative value disables the cache.
+    /// \param decodedStreamCacheBudget Budget in bytes
+    void setDecodedStreamCacheBudget(qint64 decodedStreamCacheBudget) { m_decodedStreamCacheBudget = decodedStreamCacheBudget; }
+
     static QByteArray hash(const QByteArray& sourceData);
 
 private:
-    static constexpr const int FIND_NOT_FOUND_RESULT = -1;
+    friend class PDFDocumentReaderObjectLoader;
+
+    static constexpr const PDFInteger FIND_NOT_FOUND_RESULT = -1;
+
+    /// Size of chunks of source data, which are scanned for object marks
+    /// in parallel, when damaged document is being restored
+    static constexpr const int RECOVERY_SCAN_CHUNK_SIZE = 1024 * 1024;
 
     /// Resets the internal state and prepares it for new reading cycle
     void reset();
 
+    /// Reads a PDF document from the source data. If \p sourceOwner is set,
+    /// then stream data of the document refer directly to the source data,
+    /// and owner is kept alive by the document.
+    /// \param buffer Source data
+    /// \param sourceOwner Owner of the source data (can be nullptr)
+    PDFDocument readFromSource(const QByteArray& buffer, PDFStreamDataOwner sourceOwner);
+
     /// Find a last string in the byte array, scan only \p limit bytes. If string
     /// is not found, then FIND_NOT_FOUND_RESULT is returned, if it is found, then
     /// it position from the beginning of byte array is returned.
@@ -100,14 +260,42 @@ private:
     /// \param byteArray Byte array to be scanned from the end
     /// \param limit Scan up to this value bytes from the end
     /// \returns Position of string, or FIND_NOT_FOUND_RESULT
-    int findFromEnd(const char* what, const QByteArray& byteArray, int limit);
+    PDFInteger findFromEnd(const char* what, const QByteArray& byteArray, PDFInteger limit);
+
+    /// Reads linearization parameter dictionary, if it is present. Linearization
+    /// dictionary must be the first object of the file, and it must be in the first
+    /// 1024 bytes of the file. No exception is thrown.
+    /// \param buffer Source data
+    void readLinearizationInfo(const QByteArray& buffer);
 
     void checkFooter(const QByteArray& buffer);
     void checkHeader(const QByteArray& buffer);
     PDFInteger findXrefTableOffset(const QByteArray& buffer);
     Result processReferenceTableEntries(PDFXRefTable* xrefTable, const std::vector<PDFXRefTable::Entry>& occupiedEntries, PDFObjectStorage::PDFObjects& objects);
     Result processSecurityHandler(const PDFObject& trailerDictionaryObject, const std::vector<PDFXRefTable::Entry>& occupiedEntries, PDFObjectStorage::PDFObjects& objects);
-    void processObjectStreams(PDFXRefTable* xrefTable, PDFObjectStorage::PDFObjects& objects);
+    void processObjectStreams(PDFXRefTable* xrefTable, const std::vector<PDFXRefTable::Entry>& objectStreamEntries, PDFObjectStorage::PDFObjects& objects);
+
+    /// Decrypts objects of given entries using current security handler. Encryption
+    /// dictionary is never decrypted. Stream contents are decrypted lazily.
+    /// \param encryptObjectReference Reference to the encryption dictionary
+    /// \param occupiedEntries Entries of objects to be decrypted
+    /// \param objects Objects
+    void decryptObjects(PDFObjectReference encryptObjectReference, const std::vector<PDFXRefTable::Entry>& occupiedEntries, PDFObjectStorage::PDFObjects& objects);
+
+    /// Fills revisions of the document from the reference table
+    /// \param xrefTable Reference table
+    void readRevisions(const PDFXRefTable& xrefTable);
+
+    /// Creates lazy document from the reference table. Only encryption dictionary
+    /// is read, other objects are loaded on demand.
+    /// \param xrefTable Reference table
+    /// \param snapshot Snapshot, from which reference table was read (can be nullptr)
+    PDFDocument readLazyDocument(const PDFXRefTable& xrefTable, PDFDocumentSnapshot* snapshot);
+
+    /// Writes snapshot of the document into the snapshot cache directory. Errors
+    /// are ignored, snapshot is not written in that case.
+    /// \param xrefTable Reference table
+    void writeSnapshot(const PDFXRefTable& xrefTable);
 
     /// This function fetches object from the buffer from the specified offset.
     /// Can throw exception, returns a pair of scanned reference and object content.
@@ -116,15 +304,35 @@ private:
     /// \param reference Reference to parsed object
     PDFObject getObject(PDFParsingContext* context, PDFInteger offset, PDFObjectReference reference) const;
 
-    /// Tries to restore objects from object list. This function can be used in multiple pass, because
-    /// for example streams, can have length defined in referred object. If such is the case, then
-    /// second pass is needed. Returns true, if all object were correctly read.
+    /// This function fetches object from the source data from the specified offset.
+    /// Can throw exception.
+    /// \param source Source data
+    /// \param sourceOwner Owner of the source data (can be nullptr)
+    /// \param objectArena Object arena (can be nullptr)
+    /// \param dataCache Data cache, from which source data are fetched (can be nullptr)
+    /// \param context Context
+    /// \param offset Offset
+    /// \param reference Reference to parsed object
+    static PDFObject readObject(const QByteArray& source,
+                                const PDFStreamDataOwner& sourceOwner,
+                                const PDFObjectArenaPointer& objectArena,
+                                PDFDocumentDataCache* dataCache,
+                                PDFParsingContext* context,
+                                PDFInteger offset,
+                                PDFObjectReference reference);
+
+    /// Tries to restore objects from object list. Objects are read in parallel in multiple passes, because
+    /// for example streams, can have length defined in referred object. First pass reads all objects,
+    /// each next pass reads only objects, which failed in previous pass, using objects restored so far.
+    /// Passes are repeated, while new objects are being restored. Objects restored in a pass become
+    /// visible in the next pass, so result doesn't depend on the order of processing. If object is
+    /// found multiple times (document was updated incrementally), the last one in the file is used.
     /// \param restoredObjects Map of restored objects
     /// \param offsets Offsets, from which are objects being read
-    bool restoreObjects(std::map<PDFObjectReference, PDFObject>& restoredObjects, const std::vector<std::pair<int, int>>& offsets);
+    void restoreObjects(std::map<PDFObjectReference, PDFObject>& restoredObjects, const std::vector<std::pair<int, int>>& offsets);
 
     /// Fetch object from reference table
-    PDFObject getObjectFromXrefTable(PDFXRefTable* xrefTable, PDFParsingContext* context, PDFObjectReference reference) const;
+    PDFObject getObjectFromXrefTable(const PDFXRefTable* xrefTable, PDFParsingContext* context, PDFObjectReference reference) const;
 
     /// Tries to read damaged trailer dictionary
     PDFObject readDamagedTrailerDictionary() const;
@@ -136,7 +344,8 @@ private:
     /// This function is used, when damaged pdf document is being restored. It returns
     /// array of hints, where objects should appear. It constists of pair of start offset,
     /// and end offset. Start offset is always a valid index to the buffer, end offset
-    /// can be one index after the buffers end (it is end iterator).
+    /// can be one index after the buffers end (it is end iterator). Buffer is scanned
+    /// in parallel, in chunks of size RECOVERY_SCAN_CHUNK_SIZE.
     /// \param buffer Buffer
     std::vector<std::pair<int, int>> findObjectByteOffsets(const QByteArray& buffer) const;
 
@@ -166,6 +375,10 @@ private:
     /// Raw document data (byte array containing source data for created document)
     QByteArray m_source;
 
+    /// Owner of raw document data, if raw document data are not owned
+    /// by the byte array (for example, memory mapped file)
+    PDFStreamDataOwner m_sourceOwner;
+
     /// Security handler
     PDFSecurityHandlerPointer m_securityHandler;
 
@@ -178,6 +391,94 @@ private:
 
     /// Warnings
     QStringList m_warnings;
+
+    /// Linearization parameters of the document
+    PDFLinearizationInfo m_linearizationInfo;
+
+    /// Statistics of recovery of damaged document
+    PDFDocumentRecoveryStatistics m_recoveryStatistics;
+
+    /// Revisions of the document
+    std::vector<PDFDocumentRevision> m_revisions;
+
+    /// Load objects on demand
+    bool m_lazyObjectLoading = false;
+
+    /// Allocate parsed objects in the object arena
+    bool m_objectArenaAllocation = false;
+
+    /// Object arena of currently read document (can be nullptr)
+    PDFObjectArenaPointer m_objectArena;
+
+    /// Hash of the source data of currently read document
+    QByteArray m_sourceHash;
+
+    /// Data cache, if document is read from the data source
+    std::shared_ptr<PDFDocumentDataCache> m_dataCache;
+
+    /// Directory of the document snapshots (empty, if snapshots are disabled)
+    QString m_snapshotCacheDirectory;
+
+    /// Budget of the decoded stream cache (zero, if cache is disabled)
+    qint64 m_decodedStreamCacheBudget = 0;
+};
+
+/// Loads objects of lazily loaded document in the background, so document
+/// can be used immediately, and objects are already loaded, when they are
+/// accessed later. Objects of the first page of the linearized document
+/// are loaded first. Document must exist and must not be modified
+/// while preloader is running.
+class PDF4QTLIBCORESHARED_EXPORT PDFDocumentPreloader : public QObject
+{
+    Q_OBJECT
+
+private:
+    using BaseClass = QObject;
+
+public:
+    explicit PDFDocumentPreloader(QObject* parent);
+    virtual ~PDFDocumentPreloader() override;
+
+    /// Sets document, whose objects are loaded
+    /// \param document Document
+    void setDocument(const PDFDocument* document);
+
+    /// Sets objects, which are loaded first, together with objects
+    /// referenced by them (parents of page tree nodes are not followed).
+    /// \param objectNumbers Object numbers
+    void setPriorityObjects(std::vector<PDFInteger> objectNumbers) { m_priorityObjects = std::move(objectNumbers); }
+
+    /// Sets priority objects from linearization parameters, so first
+    /// page of the linearized document is loaded first.
+    /// \param linearizationInfo Linearization parameters
+    void setLinearizationInfo(const PDFLinearizationInfo& linearizationInfo);
+
+    /// Sets progress object
+    /// \param progress Progress object
+    void setProgress(PDFProgress* progress) { m_progress = progress; }
+
+    /// Starts loading of objects in separate thread. When all objects
+    /// are loaded, signal \p preloadingFinished is emitted. If document
+    /// is not lazy, then nothing is loaded.
+    void start();
+
+    /// Stops loading of objects, waits until thread is finished
+    void stop();
+
+signals:
+    void preloadingFinished();
+
+private:
+    void perform();
+    void onPreloadingPerformed();
+
+    PDFProgress* m_progress;
+    const PDFDocument* m_document;
+    std::vector<PDFInteger> m_priorityObjects;
+    std::atomic_bool m_cancelled;
+
+    QFuture<void> m_future;
+    std::optional<QFutureWatcher<void>> m_futureWatcher;
 };
 
 }   // namespace pdf
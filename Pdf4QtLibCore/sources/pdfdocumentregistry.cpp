@@ -0,0 +1,161 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pdfdocumentregistry.h"
+#include "pdfsecurityhandler.h"
+
+#include <QFileInfo>
+
+#include "pdfdbgheap.h"
+
+#include <algorithm>
+
+namespace pdf
+{
+
+PDFDocumentRegistry* PDFDocumentRegistry::getInstance()
+{
+    static PDFDocumentRegistry registry;
+    return &registry;
+}
+
+PDFDocumentPointer PDFDocumentRegistry::getDocument(const QString& fileName)
+{
+    const FileIdentity identity = getFileIdentity(fileName);
+    if (!identity.isValid())
+    {
+        return PDFDocumentPointer();
+    }
+
+    QMutexLocker lock(&m_mutex);
+    removeExpiredEntries();
+
+    for (const Entry& entry : m_entries)
+    {
+        if (entry.identity == identity)
+        {
+            PDFDocumentPointer document = entry.document.toStrongRef();
+            if (document)
+            {
+                retainDocument(document);
+                return document;
+            }
+        }
+    }
+
+    return PDFDocumentPointer();
+}
+
+PDFDocumentPointer PDFDocumentRegistry::registerDocument(const QString& fileName, PDFDocumentPointer document)
+{
+    const FileIdentity identity = getFileIdentity(fileName);
+    if (!document || !identity.isValid() || document->getSourceDataHash().isEmpty())
+    {
+        return document;
+    }
+
+    const PDFSecurityHandler* securityHandler = document->getStorage().getSecurityHandler();
+    if (securityHandler && securityHandler->getMode() != EncryptionMode::None)
+    {
+        return document;
+    }
+
+    QMutexLocker lock(&m_mutex);
+    removeExpiredEntries();
+
+    auto it = std::find_if(m_entries.cbegin(), m_entries.cend(), [&document](const Entry& entry) { return entry.sourceDataHash == document->getSourceDataHash(); });
+    if (it != m_entries.cend())
+    {
+        if (PDFDocumentPointer registeredDocument = it->document.toStrongRef())
+        {
+            document = std::move(registeredDocument);
+        }
+    }
+
+    // Entries of the file, which was changed, are obsolete
+    std::erase_if(m_entries, [&identity](const Entry& entry) { return entry.identity.canonicalFilePath == identity.canonicalFilePath; });
+
+    Entry entry;
+    entry.identity = identity;
+    entry.sourceDataHash = document->getSourceDataHash();
+    entry.document = document;
+    m_entries.emplace_back(std::move(entry));
+
+    retainDocument(document);
+    return document;
+}
+
+void PDFDocumentRegistry::setRetainedDocumentCount(size_t count)
+{
+    QMutexLocker lock(&m_mutex);
+    m_retainedDocumentCount = count;
+
+    while (m_retainedDocuments.size() > m_retainedDocumentCount)
+    {
+        m_retainedDocuments.pop_back();
+    }
+}
+
+void PDFDocumentRegistry::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_entries.clear();
+    m_retainedDocuments.clear();
+}
+
+PDFDocumentRegistry::FileIdentity PDFDocumentRegistry::getFileIdentity(const QString& fileName)
+{
+    FileIdentity identity;
+
+    QFileInfo fileInfo(fileName);
+    if (fileInfo.exists() && fileInfo.isFile())
+    {
+        identity.canonicalFilePath = fileInfo.canonicalFilePath();
+        identity.size = fileInfo.size();
+        identity.lastModified = fileInfo.lastModified();
+    }
+
+    return identity;
+}
+
+void PDFDocumentRegistry::removeExpiredEntries()
+{
+    std::erase_if(m_entries, [](const Entry& entry) { return entry.document.isNull(); });
+}
+
+void PDFDocumentRegistry::retainDocument(const PDFDocumentPointer& document)
+{
+    auto it = std::find(m_retainedDocuments.begin(), m_retainedDocuments.end(), document);
+    if (it != m_retainedDocuments.end())
+    {
+        m_retainedDocuments.erase(it);
+    }
+
+    m_retainedDocuments.push_front(document);
+
+    while (m_retainedDocuments.size() > m_retainedDocumentCount)
+    {
+        m_retainedDocuments.pop_back();
+    }
+}
+
+}   // namespace pdf
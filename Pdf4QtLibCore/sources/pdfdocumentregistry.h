@@ -0,0 +1,120 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef PDFDOCUMENTREGISTRY_H
+#define PDFDOCUMENTREGISTRY_H
+
+#include "pdfdocument.h"
+
+#include <QMutex>
+#include <QString>
+#include <QDateTime>
+#include <QWeakPointer>
+
+#include <deque>
+#include <vector>
+
+namespace pdf
+{
+
+/// Process wide registry of documents opened from files. When the same file
+/// is opened again (in another window, or after it was closed), already parsed
+/// document is returned, so file is not parsed again, and the document, together
+/// with its caches (decoded streams, images, compiled content streams), is shared.
+/// Documents are never modified, each modification creates a new document,
+/// so sharing is safe - modified document is simply not registered. Files
+/// are identified by canonical path, size and time of last modification,
+/// documents with the same content (for example, copies of the file) are
+/// identified by hash of the source data. Registry holds weak references,
+/// and strong references only to a few recently registered documents,
+/// so reopening of closed document is immediate too.
+class PDF4QTLIBCORESHARED_EXPORT PDFDocumentRegistry
+{
+public:
+    /// Returns instance of the document registry
+    static PDFDocumentRegistry* getInstance();
+
+    /// Returns registered document of the file. If document of the file
+    /// isn't registered, or the file was changed since the document was
+    /// registered, null pointer is returned.
+    /// \param fileName File name
+    PDFDocumentPointer getDocument(const QString& fileName);
+
+    /// Registers document read from the file. If document with the same
+    /// content is already registered, then registered document is returned
+    /// instead of \p document (and the file is associated with it), otherwise
+    /// \p document is returned. Encrypted documents are not registered,
+    /// because they would be accessible without the password.
+    /// \param fileName File name
+    /// \param document Document read from the file
+    PDFDocumentPointer registerDocument(const QString& fileName, PDFDocumentPointer document);
+
+    /// Sets count of recently registered documents, which are kept alive
+    /// even if no one uses them.
+    /// \param count Count of retained documents
+    void setRetainedDocumentCount(size_t count);
+
+    /// Removes all documents from the registry. Documents in use are not
+    /// affected, they are just not shared anymore.
+    void clear();
+
+private:
+    explicit PDFDocumentRegistry() = default;
+
+    struct FileIdentity
+    {
+        QString canonicalFilePath;
+        qint64 size = 0;
+        QDateTime lastModified;
+
+        bool isValid() const { return !canonicalFilePath.isEmpty(); }
+        bool operator==(const FileIdentity&) const = default;
+    };
+
+    struct Entry
+    {
+        FileIdentity identity;
+        QByteArray sourceDataHash;
+        QWeakPointer<PDFDocument> document;
+    };
+
+    /// Returns identity of the file. If file doesn't exist,
+    /// invalid identity is returned.
+    /// \param fileName File name
+    static FileIdentity getFileIdentity(const QString& fileName);
+
+    /// Removes entries with expired documents
+    void removeExpiredEntries();
+
+    /// Adds document to the recently registered documents
+    /// \param document Document
+    void retainDocument(const PDFDocumentPointer& document);
+
+    QMutex m_mutex;
+    std::vector<Entry> m_entries;
+    std::deque<PDFDocumentPointer> m_retainedDocuments;
+    size_t m_retainedDocumentCount = 1;
+};
+
+}   // namespace pdf
+
+#endif // PDFDOCUMENTREGISTRY_H
@@ -33,58 +33,6 @@
 namespace pdf
 {
 
-class PDFStructureTreeReferenceCollector : public PDFStructureTreeAbstractVisitor
-{
-public:
-    explicit inline PDFStructureTreeReferenceCollector(std::map<PDFObjectReference, const PDFStructureItem*>* mapping) :
-        m_mapping(mapping)
-    {
-
-    }
-
-    virtual void visitStructureTree(const PDFStructureTree* structureTree) override;
-    virtual void visitStructureElement(const PDFStructureElement* structureElement) override;
-    virtual void visitStructureMarkedContentReference(const PDFStructureMarkedContentReference* structureMarkedContentReference) override;
-    virtual void visitStructureObjectReference(const PDFStructureObjectReference* structureObjectReference) override;
-
-private:
-    void addReference(const PDFStructureItem* structureObjectReference);
-
-    std::map<PDFObjectReference, const PDFStructureItem*>* m_mapping;
-};
-
-void PDFStructureTreeReferenceCollector::visitStructureTree(const PDFStructureTree* structureTree)
-{
-    addReference(structureTree);
-    acceptChildren(structureTree);
-}
-
-void PDFStructureTreeReferenceCollector::visitStructureElement(const PDFStructureElement* structureElement)
-{
-    addReference(structureElement);
-    acceptChildren(structureElement);
-}
-
-void PDFStructureTreeReferenceCollector::visitStructureMarkedContentReference(const PDFStructureMarkedContentReference* structureMarkedContentReference)
-{
-    addReference(structureMarkedContentReference);
-    acceptChildren(structureMarkedContentReference);
-}
-
-void PDFStructureTreeReferenceCollector::visitStructureObjectReference(const PDFStructureObjectReference* structureObjectReference)
-{
-    addReference(structureObjectReference);
-    acceptChildren(structureObjectReference);
-}
-
-void PDFStructureTreeReferenceCollector::addReference(const PDFStructureItem* structureItem)
-{
-    if (structureItem->getSelfReference().isValid())
-    {
-        (*m_mapping)[structureItem->getSelfReference()] = structureItem;
-    }
-}
-
 struct PDFStructureTreeTextItem
 {
     enum class Type
@@ -191,12 +139,10 @@ public:
                                                   QTransform pagePointToDevicePointMatrix,
                                                   const PDFMeshQualitySettings& meshQualitySettings,
                                                   const PDFStructureTree* tree,
-                                                  const std::map<PDFObjectReference, const PDFStructureItem*>* mapping,
                                                   PDFStructureTreeTextExtractor::Options extractorOptions) :
         BaseClass(page, document, fontCache, cms, optionalContentActivity, pagePointToDevicePointMatrix, meshQualitySettings),
         m_features(features),
         m_tree(tree),
-        m_mapping(mapping),
         m_extractorOptions(extractorOptions),
         m_pageIndex(document->getCatalog()->getPageIndexFromPageReference(page->getPageReference()))
     {
@@ -231,7 +177,6 @@ private:
 
     PDFRenderer::Features m_features;
     const PDFStructureTree* m_tree;
-    const std::map<PDFObjectReference, const PDFStructureItem*>* m_mapping;
     std::vector<MarkedContentInfo> m_markedContentInfoStack;
     QString m_currentText;
     QRectF m_currentBoundingBox;
@@ -354,12 +299,7 @@ void PDFStructureTreeTextContentProcessor::performMarkedContentEnd()
 
 const PDFStructureItem* PDFStructureTreeTextContentProcessor::getStructureTreeItemFromMCID(PDFInteger mcid) const
 {
-    auto it = m_mapping->find(m_tree->getParent(getStructuralParentKey(), mcid));
-    if (it != m_mapping->cend())
-    {
-        return it->second;
-    }
-    return nullptr;
+    return m_tree->getItem(m_tree->getParent(getStructuralParentKey(), mcid));
 }
 
 bool PDFStructureTreeTextContentProcessor::isContentSuppressedByOC(PDFObjectReference ocgOrOcmd)
@@ -428,10 +368,6 @@ PDFStructureTreeTextExtractor::PDFStructureTreeTextExtractor(const PDFDocument*
 
 void PDFStructureTreeTextExtractor::perform(const std::vector<PDFInteger>& pageIndices)
 {
-    std::map<PDFObjectReference, const PDFStructureItem*> mapping;
-    PDFStructureTreeReferenceCollector referenceCollector(&mapping);
-    m_tree->accept(&referenceCollector);
-
     PDFFontCache fontCache(DEFAULT_FONT_CACHE_LIMIT, DEFAULT_REALIZED_FONT_CACHE_LIMIT);
 
     QMutex mutex;
@@ -454,7 +390,7 @@ void PDFStructureTreeTextExtractor::perform(const std::vector<PDFInteger>& pageI
         const PDFPage* page = catalog->getPage(pageIndex);
         Q_ASSERT(page);
 
-        PDFStructureTreeTextContentProcessor processor(PDFRenderer::IgnoreOptionalContent, page, m_document, &fontCache, &cms, &oca, QTransform(), mqs, m_tree, &mapping, m_options);
+        PDFStructureTreeTextContentProcessor processor(PDFRenderer::IgnoreOptionalContent, page, m_document, &fontCache, &cms, &oca, QTransform(), mqs, m_tree, m_options);
         QList<PDFRenderError> errors = processor.processContents();
 
         QMutexLocker lock(&mutex);
@@ -647,6 +583,39 @@ void PDFStructureTreeTextFlowCollector::visitStructureObjectReference(const PDFS
     acceptChildren(structureObjectReference);
 }
 
+/// Creates text flow items of a single page using text layout algorithm
+static PDFDocumentTextFlow::Items createLayoutPageItems(const PDFDocument* document,
+                                                        PDFInteger pageIndex,
+                                                        PDFFontCache* fontCache,
+                                                        const PDFCMS* cms,
+                                                        const PDFOptionalContentActivity* oca,
+                                                        const PDFMeshQualitySettings& mqs,
+                                                        QList<PDFRenderError>& errors)
+{
+    PDFDocumentTextFlow::Items flowItems;
+
+    const PDFPage* page = document->getCatalog()->getPage(pageIndex);
+    if (!page)
+    {
+        // Invalid page index
+        return flowItems;
+    }
+
+    PDFTextLayoutGenerator generator(PDFRenderer::IgnoreOptionalContent, page, document, fontCache, cms, oca, QTransform(), mqs);
+    errors = generator.processContents();
+    PDFTextLayout textLayout = generator.createTextLayout();
+    PDFTextFlows textFlows = PDFTextFlow::createTextFlows(textLayout, PDFTextFlow::FlowFlags(PDFTextFlow::SeparateBlocks) | PDFTextFlow::RemoveSoftHyphen, pageIndex);
+
+    flowItems.emplace_back(PDFDocumentTextFlow::Item{ QRectF(), pageIndex, PDFTranslationContext::tr("Page %1").arg(pageIndex + 1), PDFDocumentTextFlow::PageStart, {} });
+    for (const PDFTextFlow& textFlow : textFlows)
+    {
+        flowItems.emplace_back(PDFDocumentTextFlow::Item{ textFlow.getBoundingBox(), pageIndex, textFlow.getText(), PDFDocumentTextFlow::Text, textFlow.getBoundingBoxes() });
+    }
+    flowItems.emplace_back(PDFDocumentTextFlow::Item{ QRectF(), pageIndex, QString(), PDFDocumentTextFlow::PageEnd, {} });
+
+    return flowItems;
+}
+
 PDFDocumentTextFlow PDFDocumentTextFlowFactory::create(const PDFDocument* document, const std::vector<PDFInteger>& pageIndices, Algorithm algorithm)
 {
     PDFDocumentTextFlow result;
@@ -698,21 +667,8 @@ PDFDocumentTextFlow PDFDocumentTextFlowFactory::create(const PDFDocument* docume
                     return;
                 }
 
-                const PDFPage* page = catalog->getPage(pageIndex);
-                Q_ASSERT(page);
-
-                PDFTextLayoutGenerator generator(PDFRenderer::IgnoreOptionalContent, page, document, &fontCache, &cms, &oca, QTransform(), mqs);
-                QList<PDFRenderError> errors = generator.processContents();
-                PDFTextLayout textLayout = generator.createTextLayout();
-                PDFTextFlows textFlows = PDFTextFlow::createTextFlows(textLayout, PDFTextFlow::FlowFlags(PDFTextFlow::SeparateBlocks) | PDFTextFlow::RemoveSoftHyphen, pageIndex);
-
-                PDFDocumentTextFlow::Items flowItems;
-                flowItems.emplace_back(PDFDocumentTextFlow::Item{ QRectF(), pageIndex, PDFTranslationContext::tr("Page %1").arg(pageIndex + 1), PDFDocumentTextFlow::PageStart, {} });
-                for (const PDFTextFlow& textFlow : textFlows)
-                {
-                    flowItems.emplace_back(PDFDocumentTextFlow::Item{ textFlow.getBoundingBox(), pageIndex, textFlow.getText(), PDFDocumentTextFlow::Text, textFlow.getBoundingBoxes() });
-                }
-                flowItems.emplace_back(PDFDocumentTextFlow::Item{ QRectF(), pageIndex, QString(), PDFDocumentTextFlow::PageEnd, {} });
+                QList<PDFRenderError> errors;
+                PDFDocumentTextFlow::Items flowItems = createLayoutPageItems(document, pageIndex, &fontCache, &cms, &oca, mqs, errors);
 
                 QMutexLocker lock(&mutex);
                 items[pageIndex] = qMove(flowItems);
@@ -798,6 +754,139 @@ PDFDocumentTextFlow PDFDocumentTextFlowFactory::create(const PDFDocument* docume
     return create(document, pageIndices, algorithm);
 }
 
+void PDFDocumentTextFlowFactory::createStreaming(const PDFDocument* document,
+                                                 const std::vector<PDFInteger>& pageIndices,
+                                                 Algorithm algorithm,
+                                                 size_t windowSize,
+                                                 const PageItemsCallback& callback)
+{
+    windowSize = qMax(windowSize, size_t(1));
+
+    PDFStructureTree structureTree;
+    const PDFCatalog* catalog = document->getCatalog();
+    if (algorithm != Algorithm::Layout)
+    {
+        structureTree = PDFStructureTree::parse(&document->getStorage(), catalog->getStructureTreeRoot());
+    }
+
+    if (algorithm == Algorithm::Auto)
+    {
+        // Determine algorithm
+        if (catalog->isLogicalStructureMarked() && structureTree.isValid())
+        {
+            algorithm = Algorithm::Structure;
+        }
+        else
+        {
+            algorithm = Algorithm::Layout;
+        }
+    }
+
+    Q_ASSERT(algorithm != Algorithm::Auto);
+
+    switch (algorithm)
+    {
+        case Algorithm::Layout:
+        {
+            PDFFontCache fontCache(DEFAULT_FONT_CACHE_LIMIT, DEFAULT_REALIZED_FONT_CACHE_LIMIT);
+
+            PDFCMSGeneric cms;
+            PDFMeshQualitySettings mqs;
+            PDFOptionalContentActivity oca(document, OCUsage::Export, nullptr);
+            pdf::PDFModifiedDocument md(const_cast<PDFDocument*>(document), &oca);
+            fontCache.setDocument(md);
+            fontCache.setCacheShrinkEnabled(nullptr, false);
+
+            for (size_t windowStart = 0; windowStart < pageIndices.size(); windowStart += windowSize)
+            {
+                const size_t windowEnd = qMin(windowStart + windowSize, pageIndices.size());
+
+                // Pages finished out of order wait in the map, until all preceding
+                // pages are finished, then they are passed to the callback.
+                QMutex mutex;
+                std::map<size_t, PDFDocumentTextFlow::Items> pendingItems;
+                size_t nextPosition = windowStart;
+
+                auto generateTextLayout = [&, this, document](size_t position)
+                {
+                    QList<PDFRenderError> errors;
+                    PDFDocumentTextFlow::Items flowItems = createLayoutPageItems(document, pageIndices[position], &fontCache, &cms, &oca, mqs, errors);
+
+                    QMutexLocker lock(&mutex);
+                    m_errors.append(qMove(errors));
+                    pendingItems[position] = qMove(flowItems);
+
+                    for (auto it = pendingItems.begin(); it != pendingItems.end() && it->first == nextPosition; it = pendingItems.erase(it))
+                    {
+                        ++nextPosition;
+                        callback(pageIndices[it->first], qMove(it->second));
+                    }
+                };
+
+                auto range = PDFIntegerRange<size_t>(windowStart, windowEnd);
+                PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, range.begin(), range.end(), generateTextLayout);
+                Q_ASSERT(pendingItems.empty());
+            }
+
+            fontCache.setCacheShrinkEnabled(nullptr, true);
+            break;
+        }
+
+        case Algorithm::Structure:
+        {
+            PDFDocumentTextFlow textFlow = create(document, pageIndices, algorithm);
+            const PDFDocumentTextFlow::Items& items = textFlow.getItems();
+
+            // Pass consecutive items of the same page together
+            for (auto it = items.cbegin(); it != items.cend();)
+            {
+                const PDFInteger pageIndex = it->pageIndex;
+                auto itEnd = std::find_if(it, items.cend(), [pageIndex](const PDFDocumentTextFlow::Item& item) { return item.pageIndex != pageIndex; });
+                callback(pageIndex, PDFDocumentTextFlow::Items(it, itEnd));
+                it = itEnd;
+            }
+            break;
+        }
+
+        case Algorithm::Content:
+        {
+            PDFStructureTreeTextExtractor::Options options = PDFStructureTreeTextExtractor::None;
+            options.setFlag(PDFStructureTreeTextExtractor::BoundingBoxes, m_calculateBoundingBoxes);
+
+            for (size_t windowStart = 0; windowStart < pageIndices.size(); windowStart += windowSize)
+            {
+                const size_t windowEnd = qMin(windowStart + windowSize, pageIndices.size());
+                const std::vector<PDFInteger> windowPageIndices(std::next(pageIndices.cbegin(), windowStart), std::next(pageIndices.cbegin(), windowEnd));
+
+                PDFStructureTreeTextExtractor extractor(document, &structureTree, options);
+                extractor.perform(windowPageIndices);
+
+                for (PDFInteger pageIndex : windowPageIndices)
+                {
+                    PDFDocumentTextFlow::Items flowItems;
+                    flowItems.emplace_back(PDFDocumentTextFlow::Item{ QRectF(), pageIndex, PDFTranslationContext::tr("Page %1").arg(pageIndex + 1), PDFDocumentTextFlow::PageStart, {} });
+                    for (const PDFStructureTreeTextItem& sequenceItem : extractor.getTextSequence(pageIndex))
+                    {
+                        if (sequenceItem.type == PDFStructureTreeTextItem::Type::Text)
+                        {
+                            flowItems.emplace_back(PDFDocumentTextFlow::Item{ sequenceItem.boundingRect, pageIndex, sequenceItem.text, PDFDocumentTextFlow::Text, sequenceItem.characterBoundingRects });
+                        }
+                    }
+                    flowItems.emplace_back(PDFDocumentTextFlow::Item{ QRectF(), pageIndex, QString(), PDFDocumentTextFlow::PageEnd, {} });
+                    callback(pageIndex, qMove(flowItems));
+                }
+
+                m_errors.append(extractor.getErrors());
+            }
+            break;
+        }
+
+        default:
+            Q_ASSERT(false);
+            break;
+    }
+}
+
 void PDFDocumentTextFlowFactory::setCalculateBoundingBoxes(bool calculateBoundingBoxes)
 {
     m_calculateBoundingBoxes = calculateBoundingBoxes;
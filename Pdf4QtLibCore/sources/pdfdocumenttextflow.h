@@ -137,6 +137,27 @@ public:
     /// \param algorithm Algorithm
     PDFDocumentTextFlow create(const PDFDocument* document, Algorithm algorithm);
 
+    /// Callback receiving text flow items of a single page
+    using PageItemsCallback = std::function<void(PDFInteger, PDFDocumentTextFlow::Items)>;
+
+    /// Performs document text flow analysis page by page. Items of each page are passed
+    /// to the \p callback in order of \p pageIndices, as soon as the page and all
+    /// preceding pages are processed. Pages are processed in windows of \p windowSize
+    /// pages, so only items of the pages in the current window are held in memory.
+    /// Callback is never called concurrently. Structure algorithm requires the whole
+    /// structure tree, so its text flow is created for all pages at once, and then it is
+    /// passed to the callback page by page.
+    /// \param document Document
+    /// \param pageIndices Analyzed page indices
+    /// \param algorithm Algorithm
+    /// \param windowSize Maximal number of pages processed at once
+    /// \param callback Callback receiving items of single page
+    void createStreaming(const PDFDocument* document,
+                         const std::vector<PDFInteger>& pageIndices,
+                         Algorithm algorithm,
+                         size_t windowSize,
+                         const PageItemsCallback& callback);
+
     /// Has some error/warning occured during text layout creation?
     bool hasError() const { return !m_errors.isEmpty(); }
 
@@ -21,16 +21,28 @@
 // SOFTWARE.
 
 #include "pdfdocumentwriter.h"
+#include "pdfdocumentreader.h"
 #include "pdfconstants.h"
 #include "pdfvisitor.h"
 #include "pdfparser.h"
+#include "pdfstreamfilters.h"
+#include "pdfexecutionpolicy.h"
+#include "pdfexception.h"
+#include "pdfsecurityhandler.h"
+#include "pdfobjectutils.h"
 
 #include <QFile>
+#include <QMutex>
 #include <QBuffer>
 #include <QSaveFile>
 
 #include "pdfdbgheap.h"
 
+#include <map>
+#include <algorithm>
+#include <numeric>
+#include <optional>
+
 namespace pdf
 {
 
@@ -255,15 +267,18 @@ PDFOperationResult PDFDocumentWriter::write(QIODevice* device, const PDFDocument
         return tr("Writing of encrypted documents is not supported.");
     }
 
+    if (m_mode == Mode::Compressed)
+    {
+        return writeCompressed(device, document);
+    }
+
+    if (m_mode == Mode::Linearized)
+    {
+        return writeLinearized(device, document);
+    }
+
     // Write header
-    PDFVersion version = document->getInfo()->version;
-    device->write(QString("%PDF-%1.%2").arg(version.major).arg(version.minor).toLatin1());
-    writeCRLF(device);
-    device->write("% PDF producer: ");
-    device->write(PDF_LIBRARY_NAME);
-    writeCRLF(device);
-    writeCRLF(device);
-    writeCRLF(device);
+    writeHeader(device, document->getInfo()->version);
 
     PDFObjectReference encryptObjectReference;
     PDFObject encryptObject = document->getTrailerDictionary()->get("Encrypt");
@@ -274,34 +289,43 @@ PDFOperationResult PDFDocumentWriter::write(QIODevice* device, const PDFDocument
 
     // Write objects
     std::vector<PDFInteger> offsets(objectCount, -1);
-    for (size_t i = 0; i < objectCount; ++i)
+    if (isEncrypted)
     {
-        const PDFObjectStorage::Entry& entry = objects[i];
-        if (entry.object.isNull())
+        std::vector<size_t> objectNumbers;
+        objectNumbers.reserve(objectCount);
+        for (size_t i = 0; i < objectCount; ++i)
         {
-            continue;
+            if (!objects[i].object.isNull())
+            {
+                objectNumbers.push_back(i);
+            }
         }
 
-        // Jakub Melka: we must mark actual position of object
-        offsets[i] = device->pos();
-
-        if (isEncrypted)
+        auto writeObject = [&](PDFObjectReference reference, const PDFObject& object)
         {
-            PDFObjectReference reference(i, entry.generation);
-            PDFObject objectToWrite = entry.object;
-
-            if (reference != encryptObjectReference)
-            {
-                objectToWrite = storage.getSecurityHandler()->encryptObject(objectToWrite, reference);
-            }
+            // Jakub Melka: we must mark actual position of object
+            offsets[reference.objectNumber] = device->pos();
 
             PDFWriteObjectVisitor visitor(device);
             writeObjectHeader(device, reference);
-            objectToWrite.accept(&visitor);
+            object.accept(&visitor);
             writeObjectFooter(device);
-        }
-        else
+        };
+        encryptObjects(storage, encryptObjectReference, objectNumbers, writeObject);
+    }
+    else
+    {
+        for (size_t i = 0; i < objectCount; ++i)
         {
+            const PDFObjectStorage::Entry& entry = objects[i];
+            if (entry.object.isNull())
+            {
+                continue;
+            }
+
+            // Jakub Melka: we must mark actual position of object
+            offsets[i] = device->pos();
+
             PDFWriteObjectVisitor visitor(device);
             writeObjectHeader(device, PDFObjectReference(i, entry.generation));
             entry.object.accept(&visitor);
@@ -374,22 +398,1254 @@ PDFOperationResult PDFDocumentWriter::write(QIODevice* device, const PDFDocument
     return true;
 }
 
-void PDFDocumentWriter::writeCRLF(QIODevice* device)
+PDFOperationResult PDFDocumentWriter::writeCompressed(QIODevice* device, const PDFDocument* document)
 {
-    device->write("\x0D\x0A");
-}
+    const PDFObjectStorage& storage = document->getStorage();
+    const PDFObjectStorage::PDFObjects& objects = storage.getObjects();
+    const size_t objectCount = objects.size();
+    const PDFSecurityHandler* securityHandler = storage.getSecurityHandler();
+    const bool isEncrypted = securityHandler->getMode() != EncryptionMode::None;
 
-void PDFDocumentWriter::writeObjectHeader(QIODevice* device, PDFObjectReference reference)
-{
-    QString objectHeader = QString("%1 %2 obj").arg(QString::number(reference.objectNumber), QString::number(reference.generation));
-    device->write(objectHeader.toLatin1());
+    // Object streams and cross-reference streams were introduced in PDF 1.5
+    PDFVersion version = document->getInfo()->version;
+    if (version.major < 1 || (version.major == 1 && version.minor < 5))
+    {
+        version = PDFVersion(1, 5);
+    }
+    writeHeader(device, version);
+
+    PDFObjectReference encryptObjectReference;
+    PDFObject encryptObject = document->getTrailerDictionary()->get("Encrypt");
+    if (encryptObject.isReference())
+    {
+        encryptObjectReference = encryptObject.getReference();
+    }
+
+    // Streams, objects with nonzero generation number and encryption
+    // dictionary can't be stored in the object stream.
+    auto isCompressedObject = [&](size_t objectNumber)
+    {
+        const PDFObjectStorage::Entry& entry = objects[objectNumber];
+        return !entry.object.isNull() &&
+               !entry.object.isStream() &&
+               entry.generation == 0 &&
+               PDFObjectReference(objectNumber, 0) != encryptObjectReference;
+    };
+
+    // Serialize objects in parallel. Objects stored in object streams are not
+    // encrypted, as whole object stream is encrypted.
+    std::vector<QByteArray> serializedObjects(objectCount);
+    std::vector<size_t> objectNumbers(objectCount, 0);
+    std::iota(objectNumbers.begin(), objectNumbers.end(), 0);
+
+    auto serializeObject = [&](size_t objectNumber)
+    {
+        const PDFObjectStorage::Entry& entry = objects[objectNumber];
+        if (entry.object.isNull())
+        {
+            return;
+        }
+
+        PDFObject object = entry.object;
+
+        // Stream length is written as direct object, because referenced
+        // length object can be stored in the object stream, and stream
+        // must be parsed before object streams are accessible.
+        if (object.isStream())
+        {
+            const PDFStream* stream = object.getStream();
+            PDFDictionary dictionary = *stream->getDictionary();
+            dictionary.setEntry(PDFInplaceOrMemoryString("Length"), PDFObject::createInteger(stream->getContent()->size()));
+            object = PDFObject::createStream(std::make_shared<PDFStream>(qMove(dictionary), QByteArray(*stream->getContent())));
+        }
+
+        const PDFObjectReference reference(objectNumber, entry.generation);
+        if (isEncrypted && reference != encryptObjectReference && !isCompressedObject(objectNumber))
+        {
+            object = securityHandler->encryptObject(object, reference);
+        }
+
+        serializedObjects[objectNumber] = getSerializedObject(object);
+    };
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, objectNumbers.begin(), objectNumbers.end(), serializeObject);
+
+    // Pack objects into object streams, object numbers of object streams
+    // and cross-reference stream are placed after document objects.
+    struct ObjectStream
+    {
+        PDFObjectReference reference;
+        std::vector<size_t> objectNumbers;
+        QByteArray serializedObject;
+    };
+
+    std::vector<ObjectStream> objectStreams;
+    PDFInteger nextObjectNumber = objectCount;
+    for (size_t i = 0; i < objectCount; ++i)
+    {
+        if (!isCompressedObject(i))
+        {
+            continue;
+        }
+
+        if (objectStreams.empty() || objectStreams.back().objectNumbers.size() == OBJECT_STREAM_MAX_OBJECTS)
+        {
+            objectStreams.emplace_back();
+            objectStreams.back().reference = PDFObjectReference(nextObjectNumber++, 0);
+        }
+
+        objectStreams.back().objectNumbers.push_back(i);
+    }
+
+    const PDFObjectReference xrefStreamReference(nextObjectNumber++, 0);
+    const size_t totalObjectCount = nextObjectNumber;
+
+    auto createObjectStream = [&](ObjectStream& objectStream)
+    {
+        QByteArray offsets;
+        QByteArray content;
+
+        for (const size_t objectNumber : objectStream.objectNumbers)
+        {
+            offsets.append(QByteArray::number(objectNumber));
+            offsets.append(' ');
+            offsets.append(QByteArray::number(content.size()));
+            offsets.append(' ');
+
+            content.append(serializedObjects[objectNumber]);
+            serializedObjects[objectNumber] = QByteArray();
+        }
+
+        const PDFInteger first = offsets.size();
+        QByteArray compressedData = PDFFlateDecodeFilter::compress(offsets + content);
+
+        PDFDictionary dictionary;
+        dictionary.addEntry(PDFInplaceOrMemoryString("Type"), PDFObject::createName("ObjStm"));
+        dictionary.addEntry(PDFInplaceOrMemoryString("N"), PDFObject::createInteger(PDFInteger(objectStream.objectNumbers.size())));
+        dictionary.addEntry(PDFInplaceOrMemoryString("First"), PDFObject::createInteger(first));
+        dictionary.addEntry(PDFInplaceOrMemoryString("Filter"), PDFObject::createName("FlateDecode"));
+        dictionary.addEntry(PDFInplaceOrMemoryString("Length"), PDFObject::createInteger(compressedData.size()));
+
+        PDFObject streamObject = PDFObject::createStream(std::make_shared<PDFStream>(qMove(dictionary), qMove(compressedData)));
+        if (isEncrypted)
+        {
+            streamObject = securityHandler->encryptObject(streamObject, objectStream.reference);
+        }
+
+        objectStream.serializedObject = getSerializedObject(streamObject);
+    };
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, objectStreams.begin(), objectStreams.end(), createObjectStream);
+
+    // Cross-reference stream entries - type (0 - free, 1 - uncompressed,
+    // 2 - compressed), offset/object stream number, generation/index.
+    struct XRefEntry
+    {
+        PDFInteger type = 0;
+        PDFInteger field2 = 0;
+        PDFInteger field3 = 0;
+    };
+
+    std::vector<XRefEntry> xrefEntries(totalObjectCount);
+    xrefEntries[0].field3 = 65535;
+
+    for (size_t i = 1; i < objectCount; ++i)
+    {
+        xrefEntries[i].field3 = objects[i].generation;
+    }
+
+    // Write uncompressed objects in the order of object numbers
+    for (size_t i = 0; i < objectCount; ++i)
+    {
+        const PDFObjectStorage::Entry& entry = objects[i];
+        if (entry.object.isNull() || isCompressedObject(i))
+        {
+            continue;
+        }
+
+        xrefEntries[i] = XRefEntry{ 1, device->pos(), entry.generation };
+        writeObjectHeader(device, PDFObjectReference(i, entry.generation));
+        device->write(serializedObjects[i]);
+        writeObjectFooter(device);
+        serializedObjects[i] = QByteArray();
+    }
+
+    // Write object streams
+    for (const ObjectStream& objectStream : objectStreams)
+    {
+        xrefEntries[objectStream.reference.objectNumber] = XRefEntry{ 1, device->pos(), 0 };
+        writeObjectHeader(device, objectStream.reference);
+        device->write(objectStream.serializedObject);
+        writeObjectFooter(device);
+
+        for (size_t i = 0; i < objectStream.objectNumbers.size(); ++i)
+        {
+            xrefEntries[objectStream.objectNumbers[i]] = XRefEntry{ 2, objectStream.reference.objectNumber, PDFInteger(i) };
+        }
+    }
+
+    // Write cross-reference stream
+    const PDFInteger xrefOffset = device->pos();
+    xrefEntries[xrefStreamReference.objectNumber] = XRefEntry{ 1, xrefOffset, 0 };
+
+    auto getByteCount = [](PDFInteger value)
+    {
+        int count = 1;
+        while (value > 0xFF)
+        {
+            value >>= 8;
+            ++count;
+        }
+        return count;
+    };
+
+    PDFInteger maxField2 = 0;
+    PDFInteger maxField3 = 0;
+    for (const XRefEntry& entry : xrefEntries)
+    {
+        maxField2 = qMax(maxField2, entry.field2);
+        maxField3 = qMax(maxField3, entry.field3);
+    }
+
+    const int widthField2 = getByteCount(maxField2);
+    const int widthField3 = getByteCount(maxField3);
+
+    auto writeField = [](QByteArray& data, PDFInteger value, int width)
+    {
+        for (int i = width - 1; i >= 0; --i)
+        {
+            data.append(char((value >> (8 * i)) & 0xFF));
+        }
+    };
+
+    QByteArray xrefData;
+    xrefData.reserve(totalObjectCount * (1 + widthField2 + widthField3));
+    for (const XRefEntry& entry : xrefEntries)
+    {
+        writeField(xrefData, entry.type, 1);
+        writeField(xrefData, entry.field2, widthField2);
+        writeField(xrefData, entry.field3, widthField3);
+    }
+    QByteArray compressedXrefData = PDFFlateDecodeFilter::compress(xrefData);
+
+    PDFArray widths;
+    widths.appendItem(PDFObject::createInteger(1));
+    widths.appendItem(PDFObject::createInteger(widthField2));
+    widths.appendItem(PDFObject::createInteger(widthField3));
+
+    PDFDictionary xrefDictionary;
+    xrefDictionary.addEntry(PDFInplaceOrMemoryString("Type"), PDFObject::createName("XRef"));
+    xrefDictionary.addEntry(PDFInplaceOrMemoryString("Size"), PDFObject::createInteger(PDFInteger(totalObjectCount)));
+    xrefDictionary.addEntry(PDFInplaceOrMemoryString("W"), PDFObject::createArray(std::make_shared<PDFArray>(qMove(widths))));
+
+    const PDFDictionary* trailerDictionary = document->getTrailerDictionary();
+    for (const char* entry : { "Root", "Encrypt", "Info", "ID"})
+    {
+        PDFObject object = trailerDictionary->get(entry);
+        if (!object.isNull())
+        {
+            xrefDictionary.addEntry(PDFInplaceOrMemoryString(entry), qMove(object));
+        }
+    }
+
+    xrefDictionary.addEntry(PDFInplaceOrMemoryString("Filter"), PDFObject::createName("FlateDecode"));
+    xrefDictionary.addEntry(PDFInplaceOrMemoryString("Length"), PDFObject::createInteger(compressedXrefData.size()));
+
+    // Cross-reference stream is never encrypted
+    PDFObject xrefStreamObject = PDFObject::createStream(std::make_shared<PDFStream>(qMove(xrefDictionary), qMove(compressedXrefData)));
+    PDFWriteObjectVisitor xrefVisitor(device);
+    writeObjectHeader(device, xrefStreamReference);
+    xrefStreamObject.accept(&xrefVisitor);
+    writeObjectFooter(device);
+
+    device->write("startxref");
+    writeCRLF(device);
+    device->write(QString::number(xrefOffset).toLatin1());
     writeCRLF(device);
+
+    // Write footer
+    device->write("%%EOF");
+
+    return true;
 }
 
-void PDFDocumentWriter::writeObjectFooter(QIODevice* device)
+PDFOperationResult PDFDocumentWriter::writeLinearized(QIODevice* device, const PDFDocument* document)
 {
-    device->write("endobj");
-    writeCRLF(device);
+    const PDFObjectStorage& storage = document->getStorage();
+    const PDFObjectStorage::PDFObjects& objects = storage.getObjects();
+    const size_t objectCount = objects.size();
+
+    if (storage.getSecurityHandler()->getMode() != EncryptionMode::None)
+    {
+        return tr("Encrypted document can't be written as linearized document.");
+    }
+
+    const PDFCatalog* catalog = document->getCatalog();
+    const size_t pageCount = catalog->getPageCount();
+    const PDFDictionary* trailerDictionary = document->getTrailerDictionary();
+    PDFObject rootObject = trailerDictionary->get("Root");
+
+    auto isValidReference = [&](PDFObjectReference reference)
+    {
+        const size_t objectNumber = static_cast<size_t>(reference.objectNumber);
+        return reference.objectNumber > 0 &&
+               objectNumber < objectCount &&
+               objects[objectNumber].generation == reference.generation &&
+               !objects[objectNumber].object.isNull();
+    };
+
+    if (pageCount == 0 || !rootObject.isReference() || !isValidReference(rootObject.getReference()))
+    {
+        return tr("Document has no pages or invalid catalog, it can't be written as linearized document.");
+    }
+
+    // Catalog, page tree nodes and page objects are structure objects. They are
+    // placed to the sections explicitly and object closures never pass through them.
+    const size_t catalogObjectNumber = rootObject.getReference().objectNumber;
+    std::vector<bool> isStructureObject(objectCount, false);
+    isStructureObject[catalogObjectNumber] = true;
+
+    std::vector<size_t> pageObjectNumbers(pageCount, 0);
+    for (size_t i = 0; i < pageCount; ++i)
+    {
+        const PDFObjectReference pageReference = catalog->getPage(i)->getPageReference();
+        if (!isValidReference(pageReference) || isStructureObject[pageReference.objectNumber])
+        {
+            return tr("Page %1 is not a unique indirect object, document can't be written as linearized document.").arg(i + 1);
+        }
+
+        pageObjectNumbers[i] = pageReference.objectNumber;
+        isStructureObject[pageReference.objectNumber] = true;
+    }
+
+    const PDFObject& catalogObject = objects[catalogObjectNumber].object;
+    if (!catalogObject.isDictionary())
+    {
+        return tr("Document has no pages or invalid catalog, it can't be written as linearized document.");
+    }
+    const PDFDictionary* catalogDictionary = catalogObject.getDictionary();
+
+    std::vector<size_t> pageTreeNodes;
+    std::vector<PDFObjectReference> pageTreeNodeReferences;
+    PDFObject pagesObject = catalogDictionary->get("Pages");
+    if (pagesObject.isReference())
+    {
+        pageTreeNodeReferences.push_back(pagesObject.getReference());
+    }
+
+    for (size_t i = 0; i < pageTreeNodeReferences.size(); ++i)
+    {
+        const PDFObjectReference reference = pageTreeNodeReferences[i];
+        if (!isValidReference(reference) || isStructureObject[reference.objectNumber])
+        {
+            continue;
+        }
+
+        isStructureObject[reference.objectNumber] = true;
+        pageTreeNodes.push_back(reference.objectNumber);
+
+        const PDFObject& nodeObject = objects[reference.objectNumber].object;
+        if (nodeObject.isDictionary())
+        {
+            const PDFObject& kidsObject = document->getObject(nodeObject.getDictionary()->get("Kids"));
+            if (kidsObject.isArray())
+            {
+                const PDFArray* kids = kidsObject.getArray();
+                for (size_t j = 0; j < kids->getCount(); ++j)
+                {
+                    const PDFObject& kid = kids->getItem(j);
+                    if (kid.isReference())
+                    {
+                        pageTreeNodeReferences.push_back(kid.getReference());
+                    }
+                }
+            }
+        }
+    }
+
+    enum class Section : uint8_t
+    {
+        None,       ///< Object is not yet assigned to a section
+        Document,   ///< Catalog and document level objects
+        FirstPage,  ///< Objects of the first page
+        Page,       ///< Objects used exclusively by one of the remaining pages
+        Shared,     ///< Objects shared by remaining pages
+        Other       ///< All other objects
+    };
+
+    std::vector<Section> sections(objectCount, Section::None);
+    std::vector<size_t> visitMarks(objectCount, 0);
+    size_t currentVisitMark = 0;
+
+    // Collects objects reachable from given objects in breadth-first order. Structure
+    // objects and objects of the document section are not visited.
+    auto collectClosure = [&](const PDFObject& object)
+    {
+        ++currentVisitMark;
+        std::vector<size_t> result;
+
+        auto addReferences = [&](const PDFObject& referencingObject)
+        {
+            for (const PDFObjectReference& reference : PDFObjectUtils::getDirectReferences(referencingObject))
+            {
+                if (!isValidReference(reference))
+                {
+                    continue;
+                }
+
+                const size_t objectNumber = reference.objectNumber;
+                if (visitMarks[objectNumber] != currentVisitMark && !isStructureObject[objectNumber] && sections[objectNumber] != Section::Document)
+                {
+                    visitMarks[objectNumber] = currentVisitMark;
+                    result.push_back(objectNumber);
+                }
+            }
+        };
+
+        addReferences(object);
+        for (size_t i = 0; i < result.size(); ++i)
+        {
+            addReferences(objects[result[i]].object);
+        }
+
+        return result;
+    };
+
+    // Document section - catalog, page tree nodes and objects needed to
+    // open the document (inherited page attributes are placed here too).
+    std::vector<size_t> documentSection = { catalogObjectNumber };
+    documentSection.insert(documentSection.end(), pageTreeNodes.cbegin(), pageTreeNodes.cend());
+
+    PDFArray documentRoots;
+    for (const char* key : { "ViewerPreferences", "OpenAction", "AcroForm", "OCProperties", "Outlines" })
+    {
+        if (qstrcmp(key, "Outlines") == 0 && catalog->getPageMode() != PageMode::UseOutlines)
+        {
+            continue;
+        }
+
+        documentRoots.appendItem(catalogDictionary->get(key));
+    }
+    for (const size_t objectNumber : pageTreeNodes)
+    {
+        documentRoots.appendItem(objects[objectNumber].object);
+    }
+
+    std::vector<size_t> documentClosure = collectClosure(PDFObject::createArray(std::make_shared<PDFArray>(qMove(documentRoots))));
+    documentSection.insert(documentSection.end(), documentClosure.cbegin(), documentClosure.cend());
+    for (const size_t objectNumber : documentSection)
+    {
+        sections[objectNumber] = Section::Document;
+    }
+
+    // Page closures and number of pages, which use each object
+    std::vector<std::vector<size_t>> pageClosures(pageCount);
+    std::vector<size_t> usageCount(objectCount, 0);
+    for (size_t i = 0; i < pageCount; ++i)
+    {
+        pageClosures[i] = collectClosure(objects[pageObjectNumbers[i]].object);
+        for (const size_t objectNumber : pageClosures[i])
+        {
+            ++usageCount[objectNumber];
+        }
+    }
+
+    // First page section contains all objects needed to display the first page
+    std::vector<size_t> firstPageSection = { pageObjectNumbers.front() };
+    firstPageSection.insert(firstPageSection.end(), pageClosures.front().cbegin(), pageClosures.front().cend());
+
+    // Index of the object in the shared object hint table
+    std::vector<size_t> sharedObjectIndices(objectCount, 0);
+    for (size_t i = 0; i < firstPageSection.size(); ++i)
+    {
+        sections[firstPageSection[i]] = Section::FirstPage;
+        sharedObjectIndices[firstPageSection[i]] = i;
+    }
+
+    std::vector<std::vector<size_t>> pageSections(pageCount);
+    for (size_t i = 1; i < pageCount; ++i)
+    {
+        pageSections[i].push_back(pageObjectNumbers[i]);
+        sections[pageObjectNumbers[i]] = Section::Page;
+
+        for (const size_t objectNumber : pageClosures[i])
+        {
+            if (usageCount[objectNumber] == 1 && sections[objectNumber] == Section::None)
+            {
+                sections[objectNumber] = Section::Page;
+                pageSections[i].push_back(objectNumber);
+            }
+        }
+    }
+
+    std::vector<size_t> sharedSection;
+    for (size_t i = 1; i < pageCount; ++i)
+    {
+        for (const size_t objectNumber : pageClosures[i])
+        {
+            if (sections[objectNumber] == Section::None)
+            {
+                sections[objectNumber] = Section::Shared;
+                sharedObjectIndices[objectNumber] = firstPageSection.size() + sharedSection.size();
+                sharedSection.push_back(objectNumber);
+            }
+        }
+    }
+
+    std::vector<size_t> otherSection;
+    for (size_t i = 1; i < objectCount; ++i)
+    {
+        if (!objects[i].object.isNull() && sections[i] == Section::None)
+        {
+            sections[i] = Section::Other;
+            otherSection.push_back(i);
+        }
+    }
+
+    // Renumber objects. Objects of the first page cross-reference section (linearization
+    // dictionary, document section, hint stream and first page section) are numbered
+    // last, so main cross-reference section starts with object 0.
+    PDFObjectUtils::FlatReferenceMapping referenceMapping(objectCount);
+    PDFInteger nextObjectNumber = 1;
+    auto assignObjectNumber = [&](size_t objectNumber)
+    {
+        referenceMapping[objectNumber] = std::make_pair(PDFObjectReference(objectNumber, objects[objectNumber].generation), PDFObjectReference(nextObjectNumber++, 0));
+    };
+
+    for (size_t i = 1; i < pageCount; ++i)
+    {
+        std::for_each(pageSections[i].cbegin(), pageSections[i].cend(), assignObjectNumber);
+    }
+    std::for_each(sharedSection.cbegin(), sharedSection.cend(), assignObjectNumber);
+    std::for_each(otherSection.cbegin(), otherSection.cend(), assignObjectNumber);
+
+    const PDFInteger firstPageXRefStart = nextObjectNumber;
+    const PDFObjectReference linearizationDictionaryReference(nextObjectNumber++, 0);
+    std::for_each(documentSection.cbegin(), documentSection.cend(), assignObjectNumber);
+    const PDFObjectReference hintStreamReference(nextObjectNumber++, 0);
+    std::for_each(firstPageSection.cbegin(), firstPageSection.cend(), assignObjectNumber);
+    const PDFInteger totalObjectCount = nextObjectNumber;
+
+    // Serialize renumbered objects in parallel, including object header and footer
+    std::vector<QByteArray> serializedObjects(objectCount);
+    std::vector<size_t> objectNumbers(objectCount, 0);
+    std::iota(objectNumbers.begin(), objectNumbers.end(), 0);
+
+    auto serializeObject = [&](size_t objectNumber)
+    {
+        if (sections[objectNumber] == Section::None)
+        {
+            return;
+        }
+
+        PDFObject object = PDFObjectUtils::replaceReferences(objects[objectNumber].object, referenceMapping);
+
+        // Stream length is written as direct object, so stream can be
+        // read without accessing objects from other sections.
+        if (object.isStream())
+        {
+            const PDFStream* stream = object.getStream();
+            PDFDictionary dictionary = *stream->getDictionary();
+            dictionary.setEntry(PDFInplaceOrMemoryString("Length"), PDFObject::createInteger(stream->getContent()->size()));
+            object = PDFObject::createStream(std::make_shared<PDFStream>(qMove(dictionary), QByteArray(*stream->getContent())));
+        }
+
+        QByteArray data;
+        QBuffer buffer(&data);
+        buffer.open(QBuffer::WriteOnly);
+        writeObjectHeader(&buffer, referenceMapping[objectNumber].second);
+        buffer.write(getSerializedObject(object));
+        writeObjectFooter(&buffer);
+        buffer.close();
+
+        serializedObjects[objectNumber] = qMove(data);
+    };
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, objectNumbers.begin(), objectNumbers.end(), serializeObject);
+
+    // Linearization requires PDF 1.2
+    PDFVersion version = document->getInfo()->version;
+    if (version.major < 1 || (version.major == 1 && version.minor < 2))
+    {
+        version = PDFVersion(1, 2);
+    }
+
+    QByteArray headerData;
+    {
+        QBuffer buffer(&headerData);
+        buffer.open(QBuffer::WriteOnly);
+        writeHeader(&buffer, version);
+        buffer.close();
+    }
+
+    // Numbers in the linearization dictionary and first page trailer are
+    // written with fixed width, so their byte size doesn't depend on values.
+    auto getFixedWidthNumber = [](PDFInteger value)
+    {
+        return QByteArray::number(value).leftJustified(10, ' ');
+    };
+
+    auto createLinearizationDictionary = [&](PDFInteger fileLength,
+                                             PDFInteger hintStreamOffset,
+                                             PDFInteger hintStreamLength,
+                                             PDFInteger firstPageEndOffset,
+                                             PDFInteger mainXRefEntriesOffset)
+    {
+        QByteArray data;
+        QBuffer buffer(&data);
+        buffer.open(QBuffer::WriteOnly);
+        writeObjectHeader(&buffer, linearizationDictionaryReference);
+        buffer.write("<< /Linearized 1 /L ");
+        buffer.write(getFixedWidthNumber(fileLength));
+        buffer.write(" /H [ ");
+        buffer.write(getFixedWidthNumber(hintStreamOffset));
+        buffer.write(" ");
+        buffer.write(getFixedWidthNumber(hintStreamLength));
+        buffer.write(" ] /O ");
+        buffer.write(QByteArray::number(referenceMapping[pageObjectNumbers.front()].second.objectNumber));
+        buffer.write(" /E ");
+        buffer.write(getFixedWidthNumber(firstPageEndOffset));
+        buffer.write(" /N ");
+        buffer.write(QByteArray::number(qint64(pageCount)));
+        buffer.write(" /T ");
+        buffer.write(getFixedWidthNumber(mainXRefEntriesOffset));
+        buffer.write(" >>");
+        writeCRLF(&buffer);
+        writeObjectFooter(&buffer);
+        buffer.close();
+        return data;
+    };
+
+    auto writeXRefEntry = [](QIODevice* xrefDevice, PDFInteger offset, PDFInteger generation, bool isFree)
+    {
+        xrefDevice->write(QString::number(offset).rightJustified(10, QChar('0'), true).toLatin1());
+        xrefDevice->write(" ");
+        xrefDevice->write(QString::number(generation).rightJustified(5, QChar('0'), true).toLatin1());
+        xrefDevice->write(isFree ? " f" : " n");
+        writeCRLF(xrefDevice);
+    };
+
+    auto createFirstPageXRef = [&](const std::vector<PDFInteger>& entryOffsets, PDFInteger mainXRefOffset)
+    {
+        QByteArray data;
+        QBuffer buffer(&data);
+        buffer.open(QBuffer::WriteOnly);
+        buffer.write("xref");
+        writeCRLF(&buffer);
+        buffer.write(QString("%1 %2").arg(firstPageXRefStart).arg(totalObjectCount - firstPageXRefStart).toLatin1());
+        writeCRLF(&buffer);
+
+        for (const PDFInteger offset : entryOffsets)
+        {
+            writeXRefEntry(&buffer, offset, 0, false);
+        }
+
+        buffer.write("trailer");
+        writeCRLF(&buffer);
+        buffer.write("<< /Size ");
+        buffer.write(QByteArray::number(totalObjectCount));
+        for (const char* entry : { "Root", "Info", "ID" })
+        {
+            PDFObject object = trailerDictionary->get(entry);
+            if (!object.isNull())
+            {
+                buffer.write(" /");
+                buffer.write(entry);
+                buffer.write(" ");
+                buffer.write(getSerializedObject(PDFObjectUtils::replaceReferences(object, referenceMapping)));
+            }
+        }
+        buffer.write(" /Prev ");
+        buffer.write(getFixedWidthNumber(mainXRefOffset));
+        buffer.write(" >>");
+        writeCRLF(&buffer);
+        buffer.write("startxref");
+        writeCRLF(&buffer);
+        buffer.write("0");
+        writeCRLF(&buffer);
+        buffer.write("%%EOF");
+        writeCRLF(&buffer);
+        buffer.close();
+        return data;
+    };
+
+    const std::vector<PDFInteger> firstPageXRefPlaceholder(totalObjectCount - firstPageXRefStart, 0);
+    const qint64 linearizationDictionarySize = createLinearizationDictionary(0, 0, 0, 0, 0).size();
+    const qint64 firstPageXRefSize = createFirstPageXRef(firstPageXRefPlaceholder, 0).size();
+
+    // Calculate object offsets as if hint stream is not present. Hint tables
+    // use these offsets, real offsets are adjusted after hint stream is created.
+    std::vector<PDFInteger> offsets(objectCount, 0);
+    PDFInteger offset = headerData.size() + linearizationDictionarySize + firstPageXRefSize;
+
+    auto placeObjects = [&](const std::vector<size_t>& objectNumbersToPlace)
+    {
+        for (const size_t objectNumber : objectNumbersToPlace)
+        {
+            offsets[objectNumber] = offset;
+            offset += serializedObjects[objectNumber].size();
+        }
+    };
+
+    auto getSectionLength = [&](const std::vector<size_t>& objectNumbersInSection)
+    {
+        PDFInteger length = 0;
+        for (const size_t objectNumber : objectNumbersInSection)
+        {
+            length += serializedObjects[objectNumber].size();
+        }
+        return length;
+    };
+
+    placeObjects(documentSection);
+    const PDFInteger hintStreamOffset = offset;
+    placeObjects(firstPageSection);
+    for (size_t i = 1; i < pageCount; ++i)
+    {
+        placeObjects(pageSections[i]);
+    }
+    placeObjects(sharedSection);
+    placeObjects(otherSection);
+
+    auto getBitCount = [](PDFInteger value)
+    {
+        PDFBitWriter::Value bits = 0;
+        while (value > 0)
+        {
+            ++bits;
+            value >>= 1;
+        }
+        return bits;
+    };
+
+    // Page offset hint table. Content stream offsets and lengths are
+    // approximated by the whole page, as all page objects are loaded.
+    std::vector<PDFInteger> pageObjectCounts(pageCount, 0);
+    std::vector<PDFInteger> pageLengths(pageCount, 0);
+    std::vector<std::vector<PDFInteger>> pageSharedIdentifiers(pageCount);
+    pageObjectCounts[0] = firstPageSection.size();
+    pageLengths[0] = getSectionLength(firstPageSection);
+    for (size_t i = 1; i < pageCount; ++i)
+    {
+        pageObjectCounts[i] = pageSections[i].size();
+        pageLengths[i] = getSectionLength(pageSections[i]);
+
+        for (const size_t objectNumber : pageClosures[i])
+        {
+            if (sections[objectNumber] == Section::FirstPage || sections[objectNumber] == Section::Shared)
+            {
+                pageSharedIdentifiers[i].push_back(sharedObjectIndices[objectNumber]);
+            }
+        }
+    }
+
+    const PDFInteger minPageObjectCount = *std::min_element(pageObjectCounts.cbegin(), pageObjectCounts.cend());
+    const PDFInteger maxPageObjectCount = *std::max_element(pageObjectCounts.cbegin(), pageObjectCounts.cend());
+    const PDFInteger minPageLength = *std::min_element(pageLengths.cbegin(), pageLengths.cend());
+    const PDFInteger maxPageLength = *std::max_element(pageLengths.cbegin(), pageLengths.cend());
+
+    PDFInteger maxSharedReferenceCount = 0;
+    for (const std::vector<PDFInteger>& sharedIdentifiers : pageSharedIdentifiers)
+    {
+        maxSharedReferenceCount = qMax(maxSharedReferenceCount, PDFInteger(sharedIdentifiers.size()));
+    }
+
+    const PDFInteger sharedObjectCount = firstPageSection.size() + sharedSection.size();
+    const PDFBitWriter::Value objectCountBits = getBitCount(maxPageObjectCount - minPageObjectCount);
+    const PDFBitWriter::Value pageLengthBits = getBitCount(maxPageLength - minPageLength);
+    const PDFBitWriter::Value sharedReferenceCountBits = getBitCount(maxSharedReferenceCount);
+    const PDFBitWriter::Value sharedIdentifierBits = getBitCount(sharedObjectCount - 1);
+
+    PDFBitWriter hintWriter(8);
+    hintWriter.write(minPageObjectCount, 32);
+    hintWriter.write(offsets[firstPageSection.front()], 32);
+    hintWriter.write(objectCountBits, 16);
+    hintWriter.write(minPageLength, 32);
+    hintWriter.write(pageLengthBits, 16);
+    hintWriter.write(0, 32);                           // Least content stream offset
+    hintWriter.write(0, 16);                           // Bits for content stream offset
+    hintWriter.write(minPageLength, 32);               // Least content stream length
+    hintWriter.write(pageLengthBits, 16);              // Bits for content stream length
+    hintWriter.write(sharedReferenceCountBits, 16);
+    hintWriter.write(sharedIdentifierBits, 16);
+    hintWriter.write(0, 16);                           // Bits for numerator of fractional position
+    hintWriter.write(1, 16);                           // Denominator of fractional position
+
+    auto writePageItems = [&](const std::function<void(size_t)>& writeItem)
+    {
+        for (size_t i = 0; i < pageCount; ++i)
+        {
+            writeItem(i);
+        }
+        hintWriter.finishLine();
+    };
+
+    writePageItems([&](size_t i) { hintWriter.write(pageObjectCounts[i] - minPageObjectCount, objectCountBits); });
+    writePageItems([&](size_t i) { hintWriter.write(pageLengths[i] - minPageLength, pageLengthBits); });
+    writePageItems([&](size_t i) { hintWriter.write(pageSharedIdentifiers[i].size(), sharedReferenceCountBits); });
+    writePageItems([&](size_t i)
+    {
+        for (const PDFInteger identifier : pageSharedIdentifiers[i])
+        {
+            hintWriter.write(identifier, sharedIdentifierBits);
+        }
+    });
+    writePageItems([&](size_t) { });                   // Numerators of fractional position use zero bits
+    writePageItems([&](size_t) { });                   // Content stream offsets use zero bits
+    writePageItems([&](size_t i) { hintWriter.write(pageLengths[i] - minPageLength, pageLengthBits); });
+
+    QByteArray hintData = hintWriter.takeByteArray();
+    const PDFInteger sharedObjectTableOffset = hintData.size();
+
+    // Shared object hint table, each group contains exactly one object
+    std::vector<size_t> sharedObjects = firstPageSection;
+    sharedObjects.insert(sharedObjects.end(), sharedSection.cbegin(), sharedSection.cend());
+
+    std::vector<PDFInteger> sharedObjectLengths;
+    sharedObjectLengths.reserve(sharedObjects.size());
+    for (const size_t objectNumber : sharedObjects)
+    {
+        sharedObjectLengths.push_back(serializedObjects[objectNumber].size());
+    }
+
+    const PDFInteger minSharedObjectLength = *std::min_element(sharedObjectLengths.cbegin(), sharedObjectLengths.cend());
+    const PDFInteger maxSharedObjectLength = *std::max_element(sharedObjectLengths.cbegin(), sharedObjectLengths.cend());
+    const PDFBitWriter::Value sharedObjectLengthBits = getBitCount(maxSharedObjectLength - minSharedObjectLength);
+
+    PDFBitWriter sharedObjectWriter(8);
+    sharedObjectWriter.write(!sharedSection.empty() ? referenceMapping[sharedSection.front()].second.objectNumber : 0, 32);
+    sharedObjectWriter.write(!sharedSection.empty() ? offsets[sharedSection.front()] : 0, 32);
+    sharedObjectWriter.write(firstPageSection.size(), 32);
+    sharedObjectWriter.write(sharedObjects.size(), 32);
+    sharedObjectWriter.write(0, 16);                   // Bits for number of objects in the group
+    sharedObjectWriter.write(minSharedObjectLength, 32);
+    sharedObjectWriter.write(sharedObjectLengthBits, 16);
+
+    for (const PDFInteger length : sharedObjectLengths)
+    {
+        sharedObjectWriter.write(length - minSharedObjectLength, sharedObjectLengthBits);
+    }
+    sharedObjectWriter.finishLine();
+    for (size_t i = 0; i < sharedObjects.size(); ++i)
+    {
+        sharedObjectWriter.write(0, 1);                // Signature of the group is not present
+    }
+    sharedObjectWriter.finishLine();
+    hintData.append(sharedObjectWriter.takeByteArray());
+
+    PDFDictionary hintStreamDictionary;
+    hintStreamDictionary.addEntry(PDFInplaceOrMemoryString("Length"), PDFObject::createInteger(hintData.size()));
+    hintStreamDictionary.addEntry(PDFInplaceOrMemoryString("S"), PDFObject::createInteger(sharedObjectTableOffset));
+    PDFObject hintStreamObject = PDFObject::createStream(std::make_shared<PDFStream>(qMove(hintStreamDictionary), qMove(hintData)));
+
+    QByteArray hintStreamData;
+    {
+        QBuffer buffer(&hintStreamData);
+        buffer.open(QBuffer::WriteOnly);
+        writeObjectHeader(&buffer, hintStreamReference);
+        buffer.write(getSerializedObject(hintStreamObject));
+        writeObjectFooter(&buffer);
+        buffer.close();
+    }
+
+    // Adjust offsets of objects placed after the hint stream
+    const PDFInteger hintStreamLength = hintStreamData.size();
+    for (size_t i = 0; i < objectCount; ++i)
+    {
+        if (sections[i] != Section::None && sections[i] != Section::Document)
+        {
+            offsets[i] += hintStreamLength;
+        }
+    }
+
+    const PDFInteger firstPageXRefOffset = headerData.size() + linearizationDictionarySize;
+    const PDFInteger firstPageEndOffset = offsets[firstPageSection.back()] + serializedObjects[firstPageSection.back()].size();
+    const PDFInteger mainXRefOffset = offset + hintStreamLength;
+
+    QByteArray mainXRefData;
+    PDFInteger mainXRefEntriesOffset = 0;
+    {
+        QBuffer buffer(&mainXRefData);
+        buffer.open(QBuffer::WriteOnly);
+        buffer.write("xref");
+        writeCRLF(&buffer);
+        buffer.write(QString("0 %1").arg(firstPageXRefStart).toLatin1());
+        writeCRLF(&buffer);
+
+        // Offset of the white-space character preceding the first entry
+        mainXRefEntriesOffset = mainXRefOffset + buffer.pos() - 1;
+
+        std::vector<PDFInteger> mainXRefOffsets(firstPageXRefStart, 0);
+        for (size_t i = 0; i < objectCount; ++i)
+        {
+            const PDFInteger objectNumber = referenceMapping[i].second.objectNumber;
+            if (sections[i] != Section::None && objectNumber < firstPageXRefStart)
+            {
+                mainXRefOffsets[objectNumber] = offsets[i];
+            }
+        }
+
+        writeXRefEntry(&buffer, 0, 65535, true);
+        for (PDFInteger i = 1; i < firstPageXRefStart; ++i)
+        {
+            writeXRefEntry(&buffer, mainXRefOffsets[i], 0, false);
+        }
+
+        buffer.write("trailer");
+        writeCRLF(&buffer);
+        buffer.write("<< /Size ");
+        buffer.write(QByteArray::number(firstPageXRefStart));
+        buffer.write(" >>");
+        writeCRLF(&buffer);
+        buffer.write("startxref");
+        writeCRLF(&buffer);
+        buffer.write(QByteArray::number(firstPageXRefOffset));
+        writeCRLF(&buffer);
+        buffer.write("%%EOF");
+        buffer.close();
+    }
+
+    const PDFInteger fileLength = mainXRefOffset + mainXRefData.size();
+
+    // First page cross-reference section contains linearization dictionary,
+    // document section, hint stream and first page section, in this order.
+    std::vector<PDFInteger> firstPageXRefOffsets(totalObjectCount - firstPageXRefStart, 0);
+    firstPageXRefOffsets[linearizationDictionaryReference.objectNumber - firstPageXRefStart] = headerData.size();
+    firstPageXRefOffsets[hintStreamReference.objectNumber - firstPageXRefStart] = hintStreamOffset;
+    for (const std::vector<size_t>* section : { &documentSection, &firstPageSection })
+    {
+        for (const size_t objectNumber : *section)
+        {
+            firstPageXRefOffsets[referenceMapping[objectNumber].second.objectNumber - firstPageXRefStart] = offsets[objectNumber];
+        }
+    }
+
+    QByteArray linearizationDictionaryData = createLinearizationDictionary(fileLength, hintStreamOffset, hintStreamLength, firstPageEndOffset, mainXRefEntriesOffset);
+    QByteArray firstPageXRefData = createFirstPageXRef(firstPageXRefOffsets, mainXRefOffset);
+    Q_ASSERT(linearizationDictionaryData.size() == linearizationDictionarySize);
+    Q_ASSERT(firstPageXRefData.size() == firstPageXRefSize);
+
+    // Write the file
+    device->write(headerData);
+    device->write(linearizationDictionaryData);
+    device->write(firstPageXRefData);
+
+    auto writeObjects = [&](const std::vector<size_t>& objectNumbersToWrite)
+    {
+        for (const size_t objectNumber : objectNumbersToWrite)
+        {
+            device->write(serializedObjects[objectNumber]);
+        }
+    };
+
+    writeObjects(documentSection);
+    device->write(hintStreamData);
+    writeObjects(firstPageSection);
+    for (size_t i = 1; i < pageCount; ++i)
+    {
+        writeObjects(pageSections[i]);
+    }
+    writeObjects(sharedSection);
+    writeObjects(otherSection);
+    device->write(mainXRefData);
+
+    return true;
+}
+
+PDFOperationResult PDFDocumentWriter::writeIncremental(QIODevice* device,
+                                                       const QByteArray& originalData,
+                                                       const PDFDocumentRevision& originalRevision,
+                                                       const PDFDocument* originalDocument,
+                                                       const PDFDocument* document)
+{
+    Q_ASSERT(originalDocument);
+    Q_ASSERT(document);
+
+    if (!device->isWritable())
+    {
+        return tr("Device is not writable.");
+    }
+
+    if (!originalRevision.isValid() || originalRevision.xrefOffset >= originalData.size())
+    {
+        return tr("Revision of the original document is invalid.");
+    }
+
+    const PDFObjectStorage& storage = document->getStorage();
+    const PDFObjectStorage::PDFObjects& objects = storage.getObjects();
+    const PDFObjectStorage::PDFObjects& originalObjects = originalDocument->getStorage().getObjects();
+    const PDFSecurityHandler* securityHandler = storage.getSecurityHandler();
+    const bool isEncrypted = securityHandler->getMode() != EncryptionMode::None;
+    if (!securityHandler->isEncryptionAllowed())
+    {
+        return tr("Writing of encrypted documents is not supported.");
+    }
+
+    const PDFDictionary* trailerDictionary = document->getTrailerDictionary();
+    const PDFObject encryptObject = trailerDictionary->get("Encrypt");
+    if (encryptObject != originalDocument->getTrailerDictionary()->get("Encrypt"))
+    {
+        return tr("Encryption of the document can't be changed by incremental update.");
+    }
+
+    PDFObjectReference encryptObjectReference;
+    if (encryptObject.isReference())
+    {
+        encryptObjectReference = encryptObject.getReference();
+    }
+
+    // Find changed, new and freed objects
+    const size_t objectCount = qMax(objects.size(), originalObjects.size());
+    std::vector<size_t> changedObjects;
+    std::vector<size_t> freedObjects;
+    for (size_t i = 1; i < objectCount; ++i)
+    {
+        const PDFObjectStorage::Entry entry = i < objects.size() ? objects[i] : PDFObjectStorage::Entry();
+        const PDFObjectStorage::Entry originalEntry = i < originalObjects.size() ? originalObjects[i] : PDFObjectStorage::Entry();
+
+        if (entry.object.isNull())
+        {
+            if (!originalEntry.object.isNull())
+            {
+                freedObjects.push_back(i);
+            }
+        }
+        else if (entry != originalEntry)
+        {
+            changedObjects.push_back(i);
+        }
+    }
+
+    PDFDictionary newTrailerDictionary;
+    newTrailerDictionary.addEntry(PDFInplaceOrMemoryString("Size"), PDFObject::createInteger(PDFInteger(objectCount)));
+    for (const char* entry : { "Root", "Encrypt", "Info", "ID"})
+    {
+        PDFObject object = trailerDictionary->get(entry);
+        if (!object.isNull())
+        {
+            newTrailerDictionary.addEntry(PDFInplaceOrMemoryString(entry), qMove(object));
+        }
+    }
+
+    bool isTrailerChanged = false;
+    const PDFDictionary* originalTrailerDictionary = originalDocument->getTrailerDictionary();
+    for (const char* entry : { "Root", "Info", "ID"})
+    {
+        isTrailerChanged = isTrailerChanged || newTrailerDictionary.get(entry) != originalTrailerDictionary->get(entry);
+    }
+
+    // Original data are always copied unchanged
+    device->write(originalData);
+
+    if (changedObjects.empty() && freedObjects.empty() && !isTrailerChanged && objects.size() <= originalObjects.size())
+    {
+        return true;
+    }
+
+    if (!originalData.endsWith('\n') && !originalData.endsWith('\r'))
+    {
+        writeCRLF(device);
+    }
+
+    // Write changed objects
+    std::vector<PDFInteger> offsets(objectCount, -1);
+    auto writeObject = [&](PDFObjectReference reference, const PDFObject& object)
+    {
+        offsets[reference.objectNumber] = device->pos();
+        PDFWriteObjectVisitor visitor(device);
+        writeObjectHeader(device, reference);
+        object.accept(&visitor);
+        writeObjectFooter(device);
+    };
+
+    if (isEncrypted)
+    {
+        encryptObjects(storage, encryptObjectReference, changedObjects, writeObject);
+    }
+    else
+    {
+        for (const size_t i : changedObjects)
+        {
+            const PDFObjectStorage::Entry& entry = objects[i];
+            writeObject(PDFObjectReference(i, entry.generation), entry.object);
+        }
+    }
+
+    // Write cross-reference table section. Freed objects are linked
+    // to the list of free objects, starting at object zero.
+    struct XRefEntry
+    {
+        PDFInteger offset = 0;
+        PDFInteger generation = 0;
+        bool isFree = false;
+    };
+
+    std::map<size_t, XRefEntry> xrefEntries;
+    for (const size_t i : changedObjects)
+    {
+        xrefEntries[i] = XRefEntry{ offsets[i], objects[i].generation, false };
+    }
+
+    if (!freedObjects.empty())
+    {
+        xrefEntries[0] = XRefEntry{ PDFInteger(freedObjects.front()), 65535, true };
+        for (size_t i = 0; i < freedObjects.size(); ++i)
+        {
+            const size_t objectNumber = freedObjects[i];
+            const PDFInteger nextFreeObject = (i + 1 < freedObjects.size()) ? PDFInteger(freedObjects[i + 1]) : 0;
+            xrefEntries[objectNumber] = XRefEntry{ nextFreeObject, originalObjects[objectNumber].generation + 1, true };
+        }
+    }
+
+    const PDFInteger xrefOffset = device->pos();
+    device->write("xref");
+    writeCRLF(device);
+
+    for (auto it = xrefEntries.cbegin(); it != xrefEntries.cend();)
+    {
+        // Find contiguous subsection of entries
+        auto itEnd = std::next(it);
+        size_t subsectionSize = 1;
+        while (itEnd != xrefEntries.cend() && itEnd->first == it->first + subsectionSize)
+        {
+            ++itEnd;
+            ++subsectionSize;
+        }
+
+        device->write(QString("%1 %2").arg(it->first).arg(subsectionSize).toLatin1());
+        writeCRLF(device);
+
+        for (; it != itEnd; ++it)
+        {
+            const XRefEntry& entry = it->second;
+            QString offsetString = QString::number(entry.offset).rightJustified(10, QChar('0'), true);
+            QString generationString = QString::number(entry.generation).rightJustified(5, QChar('0'), true);
+
+            device->write(offsetString.toLatin1());
+            device->write(" ");
+            device->write(generationString.toLatin1());
+            device->write(" ");
+            device->write(entry.isFree ? "f" : "n");
+            writeCRLF(device);
+        }
+    }
+
+    newTrailerDictionary.addEntry(PDFInplaceOrMemoryString("Prev"), PDFObject::createInteger(originalRevision.xrefOffset));
+    PDFObject trailerDictionaryObject = PDFObject::createDictionary(std::make_shared<PDFDictionary>(qMove(newTrailerDictionary)));
+
+    device->write("trailer");
+    writeCRLF(device);
+    PDFWriteObjectVisitor trailerVisitor(device);
+    trailerDictionaryObject.accept(&trailerVisitor);
+    writeCRLF(device);
+    device->write("startxref");
+    writeCRLF(device);
+    device->write(QString::number(xrefOffset).toLatin1());
+    writeCRLF(device);
+
+    // Write footer
+    device->write("%%EOF");
+
+    return true;
+}
+
+void PDFDocumentWriter::writeHeader(QIODevice* device, PDFVersion version)
+{
+    device->write(QString("%PDF-%1.%2").arg(version.major).arg(version.minor).toLatin1());
+    writeCRLF(device);
+    device->write("% PDF producer: ");
+    device->write(PDF_LIBRARY_NAME);
+    writeCRLF(device);
+    writeCRLF(device);
+    writeCRLF(device);
+}
+
+void PDFDocumentWriter::writeCRLF(QIODevice* device)
+{
+    device->write("\x0D\x0A");
+}
+
+void PDFDocumentWriter::writeObjectHeader(QIODevice* device, PDFObjectReference reference)
+{
+    QString objectHeader = QString("%1 %2 obj").arg(QString::number(reference.objectNumber), QString::number(reference.generation));
+    device->write(objectHeader.toLatin1());
+    writeCRLF(device);
+}
+
+void PDFDocumentWriter::writeObjectFooter(QIODevice* device)
+{
+    device->write("endobj");
+    writeCRLF(device);
+}
+
+void PDFDocumentWriter::encryptObjects(const PDFObjectStorage& storage,
+                                       PDFObjectReference encryptObjectReference,
+                                       const std::vector<size_t>& objectNumbers,
+                                       const std::function<void(PDFObjectReference, const PDFObject&)>& writeObject)
+{
+    // Batch is limited both by object count and by size of stream data
+    constexpr size_t BATCH_MAX_OBJECTS = 1024;
+    constexpr qint64 BATCH_MAX_DATA_SIZE = 64 * 1024 * 1024;
+
+    const PDFObjectStorage::PDFObjects& objects = storage.getObjects();
+    const PDFSecurityHandler* securityHandler = storage.getSecurityHandler();
+
+    std::vector<PDFObject> encryptedObjects;
+    encryptedObjects.reserve(qMin(objectNumbers.size(), BATCH_MAX_OBJECTS));
+
+    auto it = objectNumbers.cbegin();
+    while (it != objectNumbers.cend())
+    {
+        auto batchBegin = it;
+        qint64 batchDataSize = 0;
+        while (it != objectNumbers.cend() && size_t(std::distance(batchBegin, it)) < BATCH_MAX_OBJECTS && batchDataSize < BATCH_MAX_DATA_SIZE)
+        {
+            const PDFObject& object = objects[*it].object;
+            if (object.isStream())
+            {
+                batchDataSize += object.getStream()->getContent()->size();
+            }
+            ++it;
+        }
+        auto batchEnd = it;
+
+        encryptedObjects.clear();
+        encryptedObjects.resize(std::distance(batchBegin, batchEnd));
+
+        QMutex exceptionMutex;
+        std::optional<PDFException> exception;
+
+        auto encryptObject = [&](size_t index)
+        {
+            const size_t objectNumber = *std::next(batchBegin, index);
+            const PDFObjectStorage::Entry& entry = objects[objectNumber];
+            const PDFObjectReference reference(objectNumber, entry.generation);
+
+            try
+            {
+                encryptedObjects[index] = (reference != encryptObjectReference) ? securityHandler->encryptObject(entry.object, reference) : entry.object;
+            }
+            catch (const PDFException& e)
+            {
+                QMutexLocker lock(&exceptionMutex);
+                if (!exception)
+                {
+                    exception = e;
+                }
+            }
+        };
+
+        PDFIntegerRange<size_t> indices(0, encryptedObjects.size());
+        PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, indices.begin(), indices.end(), encryptObject);
+
+        if (exception)
+        {
+            throw *exception;
+        }
+
+        for (size_t i = 0; i < encryptedObjects.size(); ++i)
+        {
+            const size_t objectNumber = *std::next(batchBegin, i);
+            writeObject(PDFObjectReference(objectNumber, objects[objectNumber].generation), encryptedObjects[i]);
+        }
+    }
 }
 
 class PDFSizeCounterIODevice : public QIODevice
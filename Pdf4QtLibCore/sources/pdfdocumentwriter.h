@@ -29,8 +29,11 @@
 
 #include <QIODevice>
 
+#include <functional>
+
 namespace pdf
 {
+struct PDFDocumentRevision;
 
 /// Class used for writing PDF documents to the desired target device (or file,
 /// buffer, etc.). If writing is not successful, then error message is returned.
@@ -39,11 +42,35 @@ class PDF4QTLIBCORESHARED_EXPORT PDFDocumentWriter
     Q_DECLARE_TR_FUNCTIONS(pdf::PDFDocumentWriter)
 
 public:
-    explicit inline PDFDocumentWriter(PDFProgress* progress)
+    explicit inline PDFDocumentWriter(PDFProgress* progress) :
+        m_mode(Mode::Classic)
     {
         Q_UNUSED(progress);
     }
 
+    enum class Mode
+    {
+        Classic,    ///< Objects are written sequentially as indirect objects, cross-reference table is written
+        Compressed, ///< Objects are serialized in parallel, non-stream objects are packed into object streams, cross-reference stream is written
+        Linearized  ///< Objects are reordered and renumbered for page-at-a-time access (Fast Web View), hint stream is written
+    };
+
+    /// Maximal number of objects packed into one object stream
+    static constexpr size_t OBJECT_STREAM_MAX_OBJECTS = 100;
+
+    /// Sets writing mode. Object streams and cross-reference streams
+    /// require PDF 1.5, so in compressed mode, version in the file header
+    /// is raised to 1.5, if document has lower version. Linearized mode
+    /// places objects needed to display the first page at the beginning
+    /// of the file, followed by remaining pages and shared objects, so
+    /// the first page can be displayed before whole file is downloaded.
+    /// Encrypted documents can't be written in linearized mode.
+    /// \param mode Mode
+    void setMode(Mode mode) { m_mode = mode; }
+
+    /// Returns writing mode
+    Mode getMode() const { return m_mode; }
+
     /// Writes document to the file. If \p safeWrite is true, then document is first
     /// written to the temporary file, and then renamed to original file name atomically,
     /// so no data can be lost on, for example, power failure. If it is not possible to
@@ -60,6 +87,24 @@ public:
     /// \param document Document
     PDFOperationResult write(QIODevice* device, const PDFDocument* document);
 
+    /// Writes document as incremental update of the original document. Original
+    /// data are copied to the device unchanged, and only objects, which were changed,
+    /// added or freed in comparison with the original document, are appended, followed
+    /// by new cross-reference table section and trailer, which refers to the newest
+    /// revision of the original data. Encryption of the document can't be changed
+    /// by incremental update. Writing mode is not used, objects are always
+    /// written as indirect objects.
+    /// \param device Output device
+    /// \param originalData Data of the original document
+    /// \param originalRevision Newest revision of the original data
+    /// \param originalDocument Original document, which was read from \p originalData
+    /// \param document Modified document
+    PDFOperationResult writeIncremental(QIODevice* device,
+                                        const QByteArray& originalData,
+                                        const PDFDocumentRevision& originalRevision,
+                                        const PDFDocument* originalDocument,
+                                        const PDFDocument* document);
+
     /// Calculates document file size, as if it is written to the disk.
     /// No file is accessed by this function; document is written
     /// to fake stream, which counts operations. If error occurs, and
@@ -77,9 +122,27 @@ public:
     static QByteArray getSerializedObject(const PDFObject& object);
 
 private:
+    PDFOperationResult writeCompressed(QIODevice* device, const PDFDocument* document);
+    PDFOperationResult writeLinearized(QIODevice* device, const PDFDocument* document);
+
+    static void writeHeader(QIODevice* device, PDFVersion version);
     static void writeCRLF(QIODevice* device);
     static void writeObjectHeader(QIODevice* device, PDFObjectReference reference);
     static void writeObjectFooter(QIODevice* device);
+
+    /// Encrypts objects in parallel and passes them to the callback in the order
+    /// of object numbers. Objects are encrypted in batches, so only objects of
+    /// one batch are held in the memory. Encryption dictionary isn't encrypted.
+    /// \param storage Object storage
+    /// \param encryptObjectReference Reference of the encryption dictionary
+    /// \param objectNumbers Object numbers of objects to be encrypted
+    /// \param writeObject Callback, which writes encrypted object
+    static void encryptObjects(const PDFObjectStorage& storage,
+                               PDFObjectReference encryptObjectReference,
+                               const std::vector<size_t>& objectNumbers,
+                               const std::function<void(PDFObjectReference, const PDFObject&)>& writeObject);
+
+    Mode m_mode;
 };
 
 }   // namespace pdf
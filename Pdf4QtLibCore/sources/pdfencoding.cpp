@@ -25,6 +25,16 @@
 #include <QTimeZone>
 #include <QStringDecoder>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PDF4QT_ENCODING_SSE2
+#define PDF4QT_ENCODING_SIMD
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define PDF4QT_ENCODING_NEON
+#define PDF4QT_ENCODING_SIMD
+#include <arm_neon.h>
+#endif
+
 #include "pdfdbgheap.h"
 
 #include <cctype>
@@ -2118,7 +2128,96 @@ static const EncodingTable MAC_OS_ENCODING_CONVERSION_TABLE = {
 
 } // namespace encoding
 
+namespace
+{
+
+constexpr qsizetype VECTOR_SIZE = 16;
+
+#if defined(PDF4QT_ENCODING_SSE2)
+
+using Vector = __m128i;
+
+inline Vector load(const char* data) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)); }
+inline void store(char16_t* data, Vector vector) { _mm_storeu_si128(reinterpret_cast<__m128i*>(data), vector); }
+
+/// Returns bit mask of bytes, which are printable ASCII characters (bit per byte)
+inline uint32_t printableAsciiMask(Vector vector)
+{
+    // Signed comparison, bytes 0x80-0xFF are negative, so they are not printable
+    const Vector isPrintable = _mm_and_si128(_mm_cmpgt_epi8(vector, _mm_set1_epi8(0x1F)), _mm_cmplt_epi8(vector, _mm_set1_epi8(0x7F)));
+    return static_cast<uint32_t>(_mm_movemask_epi8(isPrintable));
+}
+
+/// Widens 16 bytes to 16 characters
+inline void widen(char16_t* output, Vector vector)
+{
+    store(output, _mm_unpacklo_epi8(vector, _mm_setzero_si128()));
+    store(output + 8, _mm_unpackhi_epi8(vector, _mm_setzero_si128()));
+}
+
+inline Vector swapBytes16(Vector vector) { return _mm_or_si128(_mm_slli_epi16(vector, 8), _mm_srli_epi16(vector, 8)); }
+
+constexpr uint32_t FULL_MASK = 0xFFFF;
+
+#endif
+
+#if defined(PDF4QT_ENCODING_NEON)
+
+using Vector = uint8x16_t;
+
+inline Vector load(const char* data) { return vld1q_u8(reinterpret_cast<const uint8_t*>(data)); }
+inline void store(char16_t* data, Vector vector) { vst1q_u8(reinterpret_cast<uint8_t*>(data), vector); }
+
+/// Returns mask of bytes, which are printable ASCII characters. NEON doesn't have
+/// movemask instruction, so mask has four bits per byte.
+inline uint64_t printableAsciiMask(Vector vector)
+{
+    const Vector isPrintable = vandq_u8(vcgeq_u8(vector, vdupq_n_u8(0x20)), vcleq_u8(vector, vdupq_n_u8(0x7E)));
+    return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(isPrintable), 4)), 0);
+}
+
+/// Widens 16 bytes to 16 characters
+inline void widen(char16_t* output, Vector vector)
+{
+    vst1q_u16(reinterpret_cast<uint16_t*>(output), vmovl_u8(vget_low_u8(vector)));
+    vst1q_u16(reinterpret_cast<uint16_t*>(output + 8), vmovl_u8(vget_high_u8(vector)));
+}
+
+inline Vector swapBytes16(Vector vector) { return vrev16q_u8(vector); }
+
+constexpr uint64_t FULL_MASK = 0xFFFFFFFFFFFFFFFFULL;
+
+#endif
+
+inline bool isPrintableAsciiCharacter(unsigned char character)
+{
+    return character >= 0x20 && character <= 0x7E;
+}
+
+/// Returns true, if encoding maps all printable ASCII characters to themselves
+inline bool hasPrintableAsciiIdentity(const encoding::EncodingTable& table)
+{
+    for (char16_t character = 0x20; character <= 0x7E; ++character)
+    {
+        if (table[character] != QChar(character))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace
+
 QString PDFEncoding::convert(const QByteArray& stream, PDFEncoding::Encoding encoding)
+{
+    QString result(stream.size(), Qt::Uninitialized);
+    convert(QByteArrayView(stream), encoding, result.data());
+    return result;
+}
+
+void PDFEncoding::convert(QByteArrayView stream, Encoding encoding, QChar* output)
 {
     const encoding::EncodingTable* table = getTableForEncoding(encoding);
     Q_ASSERT(table);
@@ -2126,18 +2225,104 @@ QString PDFEncoding::convert(const QByteArray& stream, PDFEncoding::Encoding enc
     // Test by assert, than table has enough items for encoded byte stream
     Q_ASSERT(table->size() == std::numeric_limits<unsigned char>::max() + 1);
 
-    const int size = stream.size();
-    const char* data = stream.constData();
+    const qsizetype size = stream.size();
+    const char* data = stream.data();
+    char16_t* outputData = reinterpret_cast<char16_t*>(output);
 
-    QString result;
-    result.resize(size, QChar());
+    qsizetype i = 0;
 
-    for (int i = 0; i < size; ++i)
+#if defined(PDF4QT_ENCODING_SIMD)
+    // Tables are immutable, so we can determine only once, which of them
+    // maps printable ASCII characters to themselves.
+    static const std::array<bool, size_t(Encoding::Invalid)> printableAsciiIdentity = []()
     {
-        result[i] = (*table)[static_cast<unsigned char>(data[i])];
+        std::array<bool, size_t(Encoding::Invalid)> flags = { };
+        for (size_t index = 0; index < flags.size(); ++index)
+        {
+            const Encoding currentEncoding = static_cast<Encoding>(index);
+            if (currentEncoding != Encoding::Custom)
+            {
+                flags[index] = hasPrintableAsciiIdentity(*getTableForEncoding(currentEncoding));
+            }
+        }
+        return flags;
+    }();
+
+    if (size_t(encoding) < printableAsciiIdentity.size() && printableAsciiIdentity[size_t(encoding)])
+    {
+        for (; i + VECTOR_SIZE <= size; i += VECTOR_SIZE)
+        {
+            const Vector vector = load(data + i);
+            if (printableAsciiMask(vector) == FULL_MASK)
+            {
+                widen(outputData + i, vector);
+                continue;
+            }
+
+            for (qsizetype j = i; j < i + VECTOR_SIZE; ++j)
+            {
+                outputData[j] = (*table)[static_cast<unsigned char>(data[j])].unicode();
+            }
+        }
     }
+#endif
 
-    return result;
+    for (; i < size; ++i)
+    {
+        outputData[i] = (*table)[static_cast<unsigned char>(data[i])].unicode();
+    }
+}
+
+qsizetype PDFEncoding::convertFromUTF16BE(QByteArrayView stream, QChar* output)
+{
+    const qsizetype count = stream.size() / 2;
+    const char* data = stream.data();
+    char16_t* outputData = reinterpret_cast<char16_t*>(output);
+
+    qsizetype i = 0;
+
+#if defined(PDF4QT_ENCODING_SIMD)
+    // Each vector contains 8 characters
+    for (; i + VECTOR_SIZE / 2 <= count; i += VECTOR_SIZE / 2)
+    {
+        store(outputData + i, swapBytes16(load(data + 2 * i)));
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        outputData[i] = char16_t((static_cast<unsigned char>(data[2 * i]) << 8) | static_cast<unsigned char>(data[2 * i + 1]));
+    }
+
+    return count;
+}
+
+bool PDFEncoding::isPrintableAscii(QByteArrayView stream)
+{
+    const qsizetype size = stream.size();
+    const char* data = stream.data();
+
+    qsizetype i = 0;
+
+#if defined(PDF4QT_ENCODING_SIMD)
+    for (; i + VECTOR_SIZE <= size; i += VECTOR_SIZE)
+    {
+        if (printableAsciiMask(load(data + i)) != FULL_MASK)
+        {
+            return false;
+        }
+    }
+#endif
+
+    for (; i < size; ++i)
+    {
+        if (!isPrintableAsciiCharacter(static_cast<unsigned char>(data[i])))
+        {
+            return false;
+        }
+    }
+
+    return true;
 }
 
 QByteArray PDFEncoding::convertToEncoding(const QString& string, Encoding encoding)
@@ -2231,6 +2416,11 @@ QString PDFEncoding::convertTextString(const QByteArray& stream)
     {
         return QString::fromUtf8(stream);
     }
+    else if (isPrintableAscii(stream))
+    {
+        // PDFDocEncoding maps printable ASCII characters to themselves
+        return QString::fromLatin1(stream);
+    }
     else
     {
         return convert(stream, Encoding::PDFDoc);
@@ -2239,6 +2429,14 @@ QString PDFEncoding::convertTextString(const QByteArray& stream)
 
 QString PDFEncoding::convertFromUnicode(const QByteArray& stream)
 {
+    if (stream.size() >= 2 && static_cast<unsigned char>(stream[0]) == 0xFE && static_cast<unsigned char>(stream[1]) == 0xFF)
+    {
+        // UTF-16BE is decoded directly, without byte order mark
+        QString result((stream.size() - 2) / 2, Qt::Uninitialized);
+        convertFromUTF16BE(QByteArrayView(stream).sliced(2), result.data());
+        return result;
+    }
+
     const char16_t* bytes = reinterpret_cast<const char16_t*>(stream.data());
     const int sizeInChars = stream.size();
     const size_t sizeSizeInUShorts = sizeInChars / sizeof(const ushort) * sizeof(char);
@@ -2411,6 +2609,11 @@ QString PDFEncoding::convertSmartFromByteStringToUnicode(const QByteArray& strea
         }
     }
 
+    if (isPrintableAscii(stream))
+    {
+        return QString::fromLatin1(stream);
+    }
+
     if (canConvertFromEncoding(stream, Encoding::PDFDoc))
     {
         return convert(stream, Encoding::PDFDoc);
@@ -27,6 +27,7 @@
 
 #include <QString>
 #include <QDateTime>
+#include <QByteArrayView>
 
 #include <array>
 
@@ -67,6 +68,27 @@ public:
     /// \returns Converted unicode string
     static QString convert(const QByteArray& stream, Encoding encoding);
 
+    /// Converts byte span to the unicode characters using specified encoding.
+    /// Output buffer must have space for at least \p stream.size() characters.
+    /// Runs of printable ASCII characters are converted without table lookups,
+    /// if the encoding maps them to themselves.
+    /// \param stream Stream (byte array string) to be processed
+    /// \param encoding Encoding used to convert to unicode string
+    /// \param output Output buffer
+    static void convert(QByteArrayView stream, Encoding encoding, QChar* output);
+
+    /// Converts UTF-16BE byte span (without byte order mark) to the unicode
+    /// characters. Output buffer must have space for at least \p stream.size() / 2
+    /// characters, odd trailing byte is ignored.
+    /// \param stream Stream in UTF-16BE
+    /// \param output Output buffer
+    /// \returns Number of characters written to the output buffer
+    static qsizetype convertFromUTF16BE(QByteArrayView stream, QChar* output);
+
+    /// Returns true, if stream contains only printable ASCII characters (0x20-0x7E)
+    /// \param stream Stream to be checked
+    static bool isPrintableAscii(QByteArrayView stream);
+
     /// Converts unicode string to the byte array using the specified encoding.
     /// It performs reverse functionality than function \p convert. If the character
     /// in the encoding is not found, then it is converted to character code 0.
@@ -140,7 +162,6 @@ public:
     /// Returns all printable characters
     static QByteArray getPrintableCharacters();
 
-private:
     /// Returns true, if byte array has UTF-16BE/LE unicode marking bytes at the
     /// stream start. If they are present, then byte stream is probably encoded
     /// as unicode.
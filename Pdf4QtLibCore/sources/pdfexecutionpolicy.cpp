@@ -22,11 +22,15 @@
 
 #include "pdfexecutionpolicy.h"
 
+#include <QMutex>
 #include <QThread>
+#include <QWaitCondition>
 #include <QCoreApplication>
 
 #include "pdfdbgheap.h"
 
+#include <deque>
+
 namespace pdf
 {
 
@@ -47,6 +51,8 @@ struct PDFExecutionPolicyHolder
     QThreadPool auxiliary;
 } s_execution_policy;
 
+static thread_local PDFExecutionPolicy::Priority s_currentPriority = PDFExecutionPolicy::Priority::Normal;
+
 void PDFExecutionPolicy::setStrategy(Strategy strategy)
 {
     s_execution_policy.policy.m_strategy.store(strategy, std::memory_order_relaxed);
@@ -84,6 +90,51 @@ bool PDFExecutionPolicy::isParallelizing(Scope scope)
     return false;
 }
 
+PDFExecutionPolicy::Priority PDFExecutionPolicy::getCurrentPriority()
+{
+    return s_currentPriority;
+}
+
+PDFExecutionPolicy::Priority PDFExecutionPolicy::setCurrentPriority(Priority priority)
+{
+    const Priority previousPriority = s_currentPriority;
+    s_currentPriority = priority;
+    return previousPriority;
+}
+
+bool PDFExecutionPolicy::isInteractiveWorkActive()
+{
+    return s_execution_policy.policy.m_interactiveWorkCount.load(std::memory_order_relaxed) > 0;
+}
+
+int PDFExecutionPolicy::getThreadPoolPriority(Priority priority)
+{
+    switch (priority)
+    {
+        case Priority::Interactive:
+            return 2;
+
+        case Priority::Normal:
+            return 1;
+
+        case Priority::Background:
+            return 0;
+    }
+
+    Q_ASSERT(false);
+    return 1;
+}
+
+void PDFExecutionPolicy::beginInteractiveWork()
+{
+    ++s_execution_policy.policy.m_interactiveWorkCount;
+}
+
+void PDFExecutionPolicy::endInteractiveWork()
+{
+    --s_execution_policy.policy.m_interactiveWorkCount;
+}
+
 int PDFExecutionPolicy::getActiveThreadCount(Scope scope)
 {
     return getThreadPool(scope)->activeThreadCount();
@@ -149,9 +200,170 @@ QThreadPool* PDFExecutionPolicy::getThreadPool(PDFExecutionPolicy::Scope scope)
 
 PDFExecutionPolicy::PDFExecutionPolicy() :
     m_contentStreamsCount(0),
+    m_interactiveWorkCount(0),
     m_strategy(Strategy::PageMultithreaded)
 {
 
 }
 
+PDFExecutionPriorityGuard::PDFExecutionPriorityGuard(PDFExecutionPolicy::Priority priority) :
+    m_priority(priority),
+    m_previousPriority(PDFExecutionPolicy::setCurrentPriority(priority))
+{
+    if (m_priority == PDFExecutionPolicy::Priority::Interactive)
+    {
+        PDFExecutionPolicy::beginInteractiveWork();
+    }
+}
+
+PDFExecutionPriorityGuard::~PDFExecutionPriorityGuard()
+{
+    if (m_priority == PDFExecutionPolicy::Priority::Interactive)
+    {
+        PDFExecutionPolicy::endInteractiveWork();
+    }
+
+    PDFExecutionPolicy::setCurrentPriority(m_previousPriority);
+}
+
+struct PDFExecutionTaskGroupData
+{
+    /// Takes one pending task and executes it. Returns false,
+    /// if there is no pending task.
+    bool executePendingTask();
+
+    /// Finishes the task (executes continuation, if it was the last one)
+    void finishTask(QMutexLocker<QMutex>& lock);
+
+    QMutex mutex;
+    QWaitCondition finishedCondition;
+    std::deque<std::function<void()>> pendingTasks;
+    std::function<void()> continuation;
+    int unfinishedTaskCount = 0;
+};
+
+bool PDFExecutionTaskGroupData::executePendingTask()
+{
+    QMutexLocker lock(mutex);
+    if (pendingTasks.empty())
+    {
+        return false;
+    }
+
+    std::function<void()> task = std::move(pendingTasks.front());
+    pendingTasks.pop_front();
+    lock.unlock();
+
+    task();
+
+    lock.relock();
+    finishTask(lock);
+    return true;
+}
+
+void PDFExecutionTaskGroupData::finishTask(QMutexLocker<QMutex>& lock)
+{
+    if (unfinishedTaskCount == 1 && continuation)
+    {
+        // Continuation is executed as a part of the last task
+        std::function<void()> currentContinuation = std::move(continuation);
+        continuation = nullptr;
+        lock.unlock();
+        currentContinuation();
+        lock.relock();
+    }
+
+    if (--unfinishedTaskCount == 0)
+    {
+        finishedCondition.wakeAll();
+    }
+}
+
+class PDFExecutionTaskGroupRunnable : public QRunnable
+{
+public:
+    explicit PDFExecutionTaskGroupRunnable(std::shared_ptr<PDFExecutionTaskGroupData> data, PDFExecutionPolicy::Priority priority) :
+        m_data(std::move(data)),
+        m_priority(priority)
+    {
+        setAutoDelete(true);
+    }
+
+    virtual void run() override
+    {
+        // Task could have been already executed by the waiting thread
+        const PDFExecutionPolicy::Priority previousPriority = PDFExecutionPolicy::setCurrentPriority(m_priority);
+        m_data->executePendingTask();
+        PDFExecutionPolicy::setCurrentPriority(previousPriority);
+    }
+
+private:
+    std::shared_ptr<PDFExecutionTaskGroupData> m_data;
+    PDFExecutionPolicy::Priority m_priority;
+};
+
+PDFExecutionTaskGroup::PDFExecutionTaskGroup(PDFExecutionPolicy::Scope scope) :
+    m_scope(scope),
+    m_data(std::make_shared<PDFExecutionTaskGroupData>())
+{
+
+}
+
+PDFExecutionTaskGroup::~PDFExecutionTaskGroup()
+{
+    wait();
+}
+
+void PDFExecutionTaskGroup::run(std::function<void()> task)
+{
+    if (!PDFExecutionPolicy::isParallelizing(m_scope))
+    {
+        QMutexLocker lock(m_data->mutex);
+        ++m_data->unfinishedTaskCount;
+        lock.unlock();
+
+        task();
+
+        lock.relock();
+        m_data->finishTask(lock);
+        return;
+    }
+
+    {
+        QMutexLocker lock(m_data->mutex);
+        ++m_data->unfinishedTaskCount;
+        m_data->pendingTasks.push_back(std::move(task));
+    }
+
+    const PDFExecutionPolicy::Priority priority = PDFExecutionPolicy::getCurrentPriority();
+    PDFExecutionPolicy::getThreadPool(m_scope)->start(new PDFExecutionTaskGroupRunnable(m_data, priority), PDFExecutionPolicy::getThreadPoolPriority(priority));
+}
+
+void PDFExecutionTaskGroup::then(std::function<void()> continuation)
+{
+    QMutexLocker lock(m_data->mutex);
+    if (m_data->unfinishedTaskCount == 0)
+    {
+        lock.unlock();
+        continuation();
+        return;
+    }
+
+    m_data->continuation = std::move(continuation);
+}
+
+void PDFExecutionTaskGroup::wait()
+{
+    while (m_data->executePendingTask())
+    {
+        // Help to execute tasks, which were not yet started
+    }
+
+    QMutexLocker lock(m_data->mutex);
+    while (m_data->unfinishedTaskCount > 0)
+    {
+        m_data->finishedCondition.wait(&m_data->mutex);
+    }
+}
+
 }   // namespace pdf
@@ -24,12 +24,18 @@
 #define PDFEXECUTIONPOLICY_H
 
 #include "pdfglobal.h"
+#include "pdftracing.h"
 
 #include <QSemaphore>
 #include <QThreadPool>
 
 #include <atomic>
+#include <memory>
+#include <vector>
+#include <optional>
+#include <algorithm>
 #include <execution>
+#include <functional>
 
 namespace pdf
 {
@@ -56,6 +62,18 @@ public:
         AlwaysMultithreaded
     };
 
+    /// Priority class of the work. Priority is a property of the thread
+    /// (see \p PDFExecutionPriorityGuard), and it is inherited by the work
+    /// executed in parallel from this thread. Queued work with higher priority
+    /// is started first, and background work yields the worker threads
+    /// (at task boundaries), while interactive work is being executed.
+    enum class Priority
+    {
+        Interactive,    ///< Work, for which user is waiting (for example, compilation of visible pages)
+        Normal,         ///< Default priority
+        Background      ///< Work, which can be delayed (indexing, thumbnails, prefetch)
+    };
+
     /// Sets multithreading strategy
     /// \param strategy Strategy
     static void setStrategy(Strategy strategy);
@@ -64,91 +82,347 @@ public:
     /// \param scope Scope for which we want to determine execution policy
     static bool isParallelizing(Scope scope);
 
-    template<typename ForwardIt, typename UnaryFunction>
-    class Runnable : public QRunnable
+    /// Returns priority of the work executed by the current thread
+    static Priority getCurrentPriority();
+
+    /// Sets priority of the work executed by the current thread
+    /// and returns previous priority.
+    /// \param priority Priority
+    static Priority setCurrentPriority(Priority priority);
+
+    /// Returns true, if some interactive work is being executed
+    static bool isInteractiveWorkActive();
+
+    /// Shared state of the parallel execution. Work is divided into buckets,
+    /// which are claimed dynamically by the worker threads and also by the
+    /// calling thread, so uneven work is balanced between threads, and calling
+    /// thread helps to execute the work instead of just waiting. If all threads
+    /// of the pool are busy (for example, in nested parallel execution), calling
+    /// thread executes all buckets by itself, so nothing is blocked. Bucket
+    /// function is called with bucket index and range of the bucket.
+    template<typename ForwardIt, typename BucketFunction>
+    class ExecutionContext
     {
     public:
-        explicit inline Runnable(ForwardIt it, ForwardIt itEnd, UnaryFunction* function, QSemaphore* semaphore) :
-            m_forwardIt(qMove(it)),
-            m_forwardItEnd(qMove(itEnd)),
+        explicit inline ExecutionContext(std::vector<ForwardIt> bucketLimits, BucketFunction* function, Priority priority, quint64 traceFlowId) :
+            m_bucketLimits(qMove(bucketLimits)),
             m_function(function),
-            m_semaphore(semaphore),
-            m_packSize(static_cast<int>(std::distance(m_forwardIt, m_forwardItEnd)))
+            m_priority(priority),
+            m_traceFlowId(traceFlowId),
+            m_bucketCount(static_cast<int>(m_bucketLimits.size()) - 1),
+            m_nextBucket(0),
+            m_remainingBuckets(m_bucketCount),
+            m_semaphore(0)
         {
-            setAutoDelete(true);
+
         }
 
-        virtual void run() override
+        /// Executes buckets, until there is no unclaimed bucket left. Worker
+        /// thread executing background work stops claiming buckets, when interactive
+        /// work is active (remaining buckets are executed by the calling thread).
+        /// \param isWorker Is executed by worker thread (not calling thread)
+        void executeBuckets(bool isWorker)
         {
-            QSemaphoreReleaser semaphoreReleaser(m_semaphore, m_packSize);
-            for (auto it = m_forwardIt; it != m_forwardItEnd; ++it)
+            auto isYielding = [this, isWorker]()
             {
-                (*m_function)(*it);
+                return isWorker && m_priority == Priority::Background && isInteractiveWorkActive();
+            };
+
+            if (isYielding())
+            {
+                return;
+            }
+
+            PDF_TRACE_ZONE("ExecuteBuckets", "execution");
+            if (isWorker)
+            {
+                PDF_TRACE_FLOW(Step, "ParallelExecution", m_traceFlowId);
+            }
+
+            int bucket = m_nextBucket.fetch_add(1, std::memory_order_relaxed);
+            while (bucket < m_bucketCount)
+            {
+                (*m_function)(bucket, m_bucketLimits[bucket], m_bucketLimits[bucket + 1]);
+
+                if (m_remainingBuckets.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    m_semaphore.release();
+                }
+
+                if (isYielding())
+                {
+                    return;
+                }
+
+                bucket = m_nextBucket.fetch_add(1, std::memory_order_relaxed);
             }
         }
 
+        /// Waits until all buckets are executed
+        void wait() { m_semaphore.acquire(); }
+
+        Priority getPriority() const { return m_priority; }
+
     private:
-        ForwardIt m_forwardIt;
-        ForwardIt m_forwardItEnd;
-        UnaryFunction* m_function;
-        QSemaphore* m_semaphore;
-        int m_packSize;
+        std::vector<ForwardIt> m_bucketLimits;
+        BucketFunction* m_function;
+        Priority m_priority;
+        quint64 m_traceFlowId;
+        int m_bucketCount;
+        std::atomic<int> m_nextBucket;
+        std::atomic<int> m_remainingBuckets;
+        QSemaphore m_semaphore;
     };
 
+    template<typename ForwardIt, typename BucketFunction>
+    class Runnable : public QRunnable
+    {
+    public:
+        explicit inline Runnable(std::shared_ptr<ExecutionContext<ForwardIt, BucketFunction>> context) :
+            m_context(qMove(context))
+        {
+            setAutoDelete(true);
+        }
+
+        virtual void run() override
+        {
+            // Runnable can be started after all buckets are executed,
+            // then it doesn't touch the function anymore.
+            const Priority previousPriority = setCurrentPriority(m_context->getPriority());
+            m_context->executeBuckets(true);
+            setCurrentPriority(previousPriority);
+        }
+
+    private:
+        std::shared_ptr<ExecutionContext<ForwardIt, BucketFunction>> m_context;
+    };
+
+    /// Returns bucket size for parallel processing of given count of items.
+    /// For page scope, we do not divide the tasks into buckets, i.e.
+    /// each bucket will have size 1. But if we are in a content scope,
+    /// then we are processing smaller task, so we divide the work
+    /// into buckets of appropriate size. Bucket is never smaller than grain size.
+    /// \param scope Scope
+    /// \param count Count of items
+    /// \param grainSize Minimal size of the bucket
+    static int getBucketSize(Scope scope, int count, int grainSize)
+    {
+        int bucketSize = 1;
+
+        if (scope != Scope::Page)
+        {
+            const int buckets = 8 * QThread::idealThreadCount();
+            bucketSize = qMax(1, count / buckets);
+        }
+
+        return qMax(bucketSize, grainSize);
+    }
+
+    /// Divides range into buckets of given size and executes bucket function
+    /// for each bucket in parallel. Calling thread participates on the execution.
+    template<typename ForwardIt, typename BucketFunction>
+    static void executeBuckets(Scope scope, ForwardIt first, ForwardIt last, int bucketSize, BucketFunction f)
+    {
+        const int count = static_cast<int>(std::distance(first, last));
+        if (count == 0)
+        {
+            return;
+        }
+
+        // Divide tasks into buckets with given bucket size
+        std::vector<ForwardIt> bucketLimits;
+        bucketLimits.reserve(count / bucketSize + 2);
+
+        int remainder = count;
+        auto it = first;
+        bucketLimits.push_back(it);
+        while (remainder > 0)
+        {
+            const int currentSize = qMin(remainder, bucketSize);
+            std::advance(it, currentSize);
+            bucketLimits.push_back(it);
+            remainder -= currentSize;
+        }
+
+        Q_ASSERT(it == last);
+
+        const int bucketCount = static_cast<int>(bucketLimits.size()) - 1;
+        if (bucketCount == 1)
+        {
+            f(0, first, last);
+            return;
+        }
+
+        PDF_TRACE_ZONE("ParallelExecution", "execution");
+        PDF_TRACE_COUNTER("ParallelBuckets", bucketCount);
+
+        const quint64 traceFlowId = PDF_TRACE_FLOW_ID();
+        PDF_TRACE_FLOW(Begin, "ParallelExecution", traceFlowId);
+
+        const Priority priority = getCurrentPriority();
+        auto context = std::make_shared<ExecutionContext<ForwardIt, BucketFunction>>(qMove(bucketLimits), &f, priority, traceFlowId);
+
+        // Calling thread is also a worker, so we need one runnable less
+        QThreadPool* pool = getThreadPool(scope);
+        const int runnableCount = qMin(bucketCount - 1, pool->maxThreadCount());
+        for (int i = 0; i < runnableCount; ++i)
+        {
+            pool->start(new Runnable<ForwardIt, BucketFunction>(context), getThreadPoolPriority(priority));
+        }
+
+        context->executeBuckets(false);
+        context->wait();
+    }
+
     template<typename ForwardIt, typename UnaryFunction>
     static void execute(Scope scope, ForwardIt first, ForwardIt last, UnaryFunction f)
     {
         if (isParallelizing(scope))
         {
-            QSemaphore semaphore(0);
-            int count = static_cast<int>(std::distance(first, last));
-            int remainder = count;
+            const int count = static_cast<int>(std::distance(first, last));
+            auto processBucket = [&f](int, ForwardIt it, ForwardIt itEnd)
+            {
+                for (; it != itEnd; ++it)
+                {
+                    f(*it);
+                }
+            };
+            executeBuckets(scope, first, last, getBucketSize(scope, count, 1), processBucket);
+        }
+        else
+        {
+            std::for_each(std::execution::seq, first, last, f);
+        }
+    }
 
-            int bucketSize = 1;
+    /// Divides range into partitions containing at least \p grainSize items
+    /// and executes range function for each partition (in parallel, if scope
+    /// is parallelized). Range function is called with the range of the partition.
+    /// If scope is not parallelized, range function is called once for whole range.
+    /// \param scope Scope
+    /// \param first First item
+    /// \param last End of the range
+    /// \param grainSize Minimal count of items in one partition
+    /// \param f Range function
+    template<typename ForwardIt, typename RangeFunction>
+    static void executePartitioned(Scope scope, ForwardIt first, ForwardIt last, int grainSize, RangeFunction f)
+    {
+        if (isParallelizing(scope))
+        {
+            const int count = static_cast<int>(std::distance(first, last));
+            auto processBucket = [&f](int, ForwardIt it, ForwardIt itEnd) { f(it, itEnd); };
+            executeBuckets(scope, first, last, getBucketSize(scope, count, grainSize), processBucket);
+        }
+        else if (first != last)
+        {
+            f(first, last);
+        }
+    }
 
-            // For page scope, we do not divide the tasks into buckets, i.e.
-            // each bucket will have size 1. But if we are in a content scope,
-            // then we are processing smaller task, so we divide the work
-            // into buckets of appropriate size.
-            if (scope != Scope::Page)
+    /// Transforms each item of the range and reduces transformed values. Range is
+    /// divided into partitions containing at least \p grainSize items, which are
+    /// reduced in parallel (if scope is parallelized), and partial results
+    /// are then reduced in the order of partitions, so reduce operation
+    /// must be associative, but it need not to be commutative.
+    /// \param scope Scope
+    /// \param first First item
+    /// \param last End of the range
+    /// \param init Initial value
+    /// \param reduce Reduce operation
+    /// \param transform Transform operation
+    /// \param grainSize Minimal count of items in one partition
+    template<typename ForwardIt, typename T, typename BinaryReduceOp, typename UnaryTransformOp>
+    static T transformReduce(Scope scope, ForwardIt first, ForwardIt last, T init, BinaryReduceOp reduce, UnaryTransformOp transform, int grainSize = 1)
+    {
+        if (!isParallelizing(scope))
+        {
+            for (auto it = first; it != last; ++it)
             {
-                const int buckets = 8 * QThread::idealThreadCount();
-                bucketSize = qMax(1, count / buckets);
+                init = reduce(std::move(init), transform(*it));
             }
 
-            QThreadPool* pool = getThreadPool(scope);
+            return init;
+        }
+
+        const int count = static_cast<int>(std::distance(first, last));
+        const int bucketSize = getBucketSize(scope, count, grainSize);
+        const int bucketCount = (count + bucketSize - 1) / bucketSize;
 
-            // Divide tasks into buckets with given bucket size
-            auto it = first;
-            while (remainder > 0)
+        std::vector<std::optional<T>> partialResults(bucketCount);
+        auto processBucket = [&](int bucket, ForwardIt it, ForwardIt itEnd)
+        {
+            std::optional<T> partialResult(transform(*it));
+            for (++it; it != itEnd; ++it)
             {
-                const int currentSize = qMin(remainder, bucketSize);
+                partialResult = reduce(std::move(*partialResult), transform(*it));
+            }
+            partialResults[bucket] = std::move(partialResult);
+        };
+        executeBuckets(scope, first, last, bucketSize, processBucket);
 
-                auto itStart = it;
-                auto itEnd = std::next(it, currentSize);
-                pool->start(new Runnable(itStart, itEnd, &f, &semaphore));
+        for (std::optional<T>& partialResult : partialResults)
+        {
+            init = reduce(std::move(init), std::move(*partialResult));
+        }
 
-                remainder -= currentSize;
-                std::advance(it, currentSize);
-            }
+        return init;
+    }
 
-            Q_ASSERT(it == last);
+    /// Sorts the range. If scope is parallelized and range is large enough,
+    /// parallel merge sort is used: range is divided into at most maximal thread
+    /// count partitions, which are sorted in parallel, and then they are merged
+    /// (merges of each level are also performed in parallel). Sort is not stable.
+    /// \param scope Scope
+    /// \param first First item
+    /// \param last End of the range
+    /// \param f Comparator
+    /// \param grainSize Minimal count of items in one sorted partition
+    template<typename RandomIt, typename Comparator>
+    static void sort(Scope scope, RandomIt first, RandomIt last, Comparator f, int grainSize = 4096)
+    {
+        const int count = static_cast<int>(std::distance(first, last));
+        const int partitionCount = qMin(getMaxThreadCount(scope), count / qMax(grainSize, 1));
 
-            semaphore.acquire(count);
+        if (!isParallelizing(scope) || partitionCount < 2)
+        {
+            std::sort(std::execution::seq, first, last, f);
+            return;
         }
-        else
+
+        // Sort partitions
+        std::vector<int> limits(partitionCount + 1, 0);
+        for (int i = 0; i <= partitionCount; ++i)
         {
-            std::for_each(std::execution::seq, first, last, f);
+            limits[i] = static_cast<int>(qint64(count) * i / partitionCount);
         }
-    }
 
-    template<typename ForwardIt, typename Comparator>
-    static void sort(Scope scope, ForwardIt first, ForwardIt last, Comparator f)
-    {
-        Q_UNUSED(scope);
+        auto sortPartition = [&](int, std::vector<int>::iterator it, std::vector<int>::iterator)
+        {
+            std::sort(std::execution::seq, first + *it, first + *std::next(it), f);
+        };
+        executeBuckets(scope, limits.begin(), std::prev(limits.end()), 1, sortPartition);
+
+        // Merge sorted partitions, pair by pair
+        for (int width = 1; width < partitionCount; width *= 2)
+        {
+            std::vector<int> mergeStarts;
+            for (int i = 0; i + width < partitionCount; i += 2 * width)
+            {
+                mergeStarts.push_back(i);
+            }
 
-        // We always sort by single thread
-        std::sort(std::execution::seq, first, last, f);
+            auto mergePartitions = [&](int, std::vector<int>::iterator it, std::vector<int>::iterator itEnd)
+            {
+                for (; it != itEnd; ++it)
+                {
+                    const int start = *it;
+                    const int middle = start + width;
+                    const int end = qMin(start + 2 * width, partitionCount);
+                    std::inplace_merge(first + limits[start], first + limits[middle], first + limits[end], f);
+                }
+            };
+            executeBuckets(scope, mergeStarts.begin(), mergeStarts.end(), 1, mergePartitions);
+        }
     }
 
     /// Returns number of active threads for given scope
@@ -177,16 +451,81 @@ public:
 
 private:
     friend struct PDFExecutionPolicyHolder;
+    friend class PDFExecutionTaskGroup;
+    friend class PDFExecutionPriorityGuard;
 
     /// Returns thread pool based on scope
     static QThreadPool* getThreadPool(Scope scope);
 
+    /// Returns priority of runnables in the thread pool queue
+    static int getThreadPoolPriority(Priority priority);
+
+    /// Increments/decrements count of active interactive work
+    static void beginInteractiveWork();
+    static void endInteractiveWork();
+
     explicit PDFExecutionPolicy();
 
     std::atomic<int> m_contentStreamsCount;
+    std::atomic<int> m_interactiveWorkCount;
     std::atomic<Strategy> m_strategy;
 };
 
+/// Sets priority of the work executed by the current thread, and restores
+/// previous priority, when destroyed. While guard with interactive priority
+/// exists, background work yields the worker threads.
+class PDF4QTLIBCORESHARED_EXPORT PDFExecutionPriorityGuard
+{
+public:
+    explicit PDFExecutionPriorityGuard(PDFExecutionPolicy::Priority priority);
+    ~PDFExecutionPriorityGuard();
+
+    PDFExecutionPriorityGuard(const PDFExecutionPriorityGuard&) = delete;
+    PDFExecutionPriorityGuard& operator=(const PDFExecutionPriorityGuard&) = delete;
+
+private:
+    PDFExecutionPolicy::Priority m_priority;
+    PDFExecutionPolicy::Priority m_previousPriority;
+};
+
+struct PDFExecutionTaskGroupData;
+
+/// Group of tasks executed in the thread pool of given scope. Tasks can be added
+/// to the group at any time (also from running tasks), \p wait waits for all
+/// tasks of the group, and calling thread helps to execute tasks, which were
+/// not yet started. Continuation can be set, which is executed once all
+/// tasks of the group are finished. If scope is not parallelized, tasks are
+/// executed immediately by the calling thread.
+class PDF4QTLIBCORESHARED_EXPORT PDFExecutionTaskGroup
+{
+public:
+    explicit PDFExecutionTaskGroup(PDFExecutionPolicy::Scope scope);
+
+    /// Waits for all tasks of the group
+    ~PDFExecutionTaskGroup();
+
+    PDFExecutionTaskGroup(const PDFExecutionTaskGroup&) = delete;
+    PDFExecutionTaskGroup& operator=(const PDFExecutionTaskGroup&) = delete;
+
+    /// Adds task to the group
+    /// \param task Task
+    void run(std::function<void()> task);
+
+    /// Sets continuation, which is executed by the thread finishing
+    /// the last task of the group. If group has no running or pending tasks,
+    /// continuation is executed immediately. Continuation is executed only once.
+    /// \param continuation Continuation
+    void then(std::function<void()> continuation);
+
+    /// Waits until all tasks of the group are finished (including the continuation).
+    /// Calling thread executes pending tasks of the group meanwhile.
+    void wait();
+
+private:
+    PDFExecutionPolicy::Scope m_scope;
+    std::shared_ptr<PDFExecutionTaskGroupData> m_data;
+};
+
 }   // namespace pdf
 
 #endif // PDFEXECUTIONPOLICY_H
@@ -26,6 +26,8 @@
 #include "pdfnametounicode.h"
 #include "pdfexception.h"
 #include "pdfutils.h"
+#include "pdfconstants.h"
+#include "pdftracing.h"
 
 #include <ft2build.h>
 #include <freetype/freetype.h>
@@ -33,12 +35,21 @@
 #include <freetype/fterrors.h>
 #include <freetype/ftoutln.h>
 #include <freetype/t1tables.h>
+#include <freetype/tttables.h>
 
+#include <QDir>
+#include <QDirIterator>
 #include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
 #include <QMutex>
 #include <QReadWriteLock>
+#include <QCache>
 #include <QPainterPath>
 #include <QDataStream>
+#include <QCoreApplication>
+#include <QStandardPaths>
+#include <QtConcurrent/QtConcurrent>
 
 #include "pdfdbgheap.h"
 
@@ -117,6 +128,308 @@ static constexpr std::array S_FONT_REPLACEMENTS
     PDF_Font_Replacement{"Utopia", "Georgia"}
 };
 
+/// Persistent index of the system fonts. Index is built in the background by scanning
+/// the font directories using FreeType and it is stored in the cache directory, so font
+/// substitution can be done by a hash lookup instead of querying the platform font
+/// interface. Index is invalidated, when modification time of some font directory
+/// changes. Until the index is available, substitution uses the platform font
+/// interface. This class is thread safe.
+class PDFSystemFontIndex
+{
+public:
+    explicit PDFSystemFontIndex();
+    ~PDFSystemFontIndex();
+
+    /// Loads data of the font, whose postscript name or family name exactly matches
+    /// the font name (names are compared adjusted, see \p getFontPostscriptName).
+    /// Font with matching weight and italic flag is preferred. If index is not
+    /// yet available, or font is not found, empty byte array is returned.
+    /// \param fontName Font name
+    /// \param weight Font weight (400 is normal, 700 is bold)
+    /// \param italic Is font italic?
+    QByteArray loadFont(const QString& fontName, int weight, bool italic) const;
+
+    /// Create a postscript name for comparation purposes
+    static QString getFontPostscriptName(QString fontName);
+
+private:
+    struct Entry
+    {
+        QString fileName;
+        int weight = 400;
+        bool italic = false;
+    };
+
+    /// Modification times of font directories, they are used to invalidate the index
+    using DirectoryStamps = std::vector<std::pair<QString, qint64>>;
+    using Entries = std::unordered_multimap<QString, Entry>;
+
+    static constexpr quint32 INDEX_VERSION = 1;
+
+    static QString getIndexFileName();
+    static DirectoryStamps getDirectoryStamps();
+
+    /// Loads index from the file. If index in the file is outdated,
+    /// or it doesn't exist, false is returned.
+    bool load(const DirectoryStamps& stamps);
+
+    /// Scans font directories and saves the index to the file
+    void build(const DirectoryStamps& stamps);
+
+    QFuture<void> m_future;
+    std::atomic_bool m_cancelled;
+
+    mutable QMutex m_mutex;
+    Entries m_entries;
+};
+
+PDFSystemFontIndex::PDFSystemFontIndex() :
+    m_cancelled(false)
+{
+    DirectoryStamps stamps = getDirectoryStamps();
+    if (!load(stamps))
+    {
+        m_future = QtConcurrent::run([this, stamps]() { build(stamps); });
+    }
+}
+
+PDFSystemFontIndex::~PDFSystemFontIndex()
+{
+    m_cancelled = true;
+    m_future.waitForFinished();
+}
+
+QByteArray PDFSystemFontIndex::loadFont(const QString& fontName, int weight, bool italic) const
+{
+    QString fileName;
+
+    {
+        QMutexLocker lock(&m_mutex);
+
+        int bestDistance = std::numeric_limits<int>::max();
+        auto range = m_entries.equal_range(getFontPostscriptName(fontName));
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            const Entry& entry = it->second;
+            const int distance = qAbs(entry.weight - weight) + (entry.italic != italic ? 1000 : 0);
+
+            if (distance < bestDistance)
+            {
+                bestDistance = distance;
+                fileName = entry.fileName;
+            }
+        }
+    }
+
+    QByteArray result;
+    if (!fileName.isEmpty())
+    {
+        QFile file(fileName);
+        if (file.open(QFile::ReadOnly))
+        {
+            result = file.readAll();
+            file.close();
+        }
+    }
+
+    return result;
+}
+
+QString PDFSystemFontIndex::getFontPostscriptName(QString fontName)
+{
+    for (const char* string : { "PS", "MT", "Regular", "Bold", "Italic", "Oblique" })
+    {
+        fontName.remove(QLatin1String(string), Qt::CaseInsensitive);
+    }
+
+    return fontName.remove(QChar(' ')).remove(QChar('-')).remove(QChar(',')).trimmed();
+}
+
+QString PDFSystemFontIndex::getIndexFileName()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/SystemFontIndex.bin";
+}
+
+PDFSystemFontIndex::DirectoryStamps PDFSystemFontIndex::getDirectoryStamps()
+{
+    DirectoryStamps stamps;
+
+    // Modification time of the directory changes only if its direct content
+    // changes, so we must also check all subdirectories.
+    for (const QString& directory : QStandardPaths::standardLocations(QStandardPaths::FontsLocation))
+    {
+        QFileInfo directoryInfo(directory);
+        if (!directoryInfo.isDir())
+        {
+            continue;
+        }
+
+        stamps.emplace_back(directoryInfo.absoluteFilePath(), directoryInfo.lastModified().toMSecsSinceEpoch());
+
+        QDirIterator it(directory, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+        while (it.hasNext())
+        {
+            it.next();
+            stamps.emplace_back(it.fileInfo().absoluteFilePath(), it.fileInfo().lastModified().toMSecsSinceEpoch());
+        }
+    }
+
+    std::sort(stamps.begin(), stamps.end());
+    return stamps;
+}
+
+bool PDFSystemFontIndex::load(const DirectoryStamps& stamps)
+{
+    QFile file(getIndexFileName());
+    if (!file.open(QFile::ReadOnly))
+    {
+        return false;
+    }
+
+    QDataStream stream(&file);
+
+    quint32 version = 0;
+    stream >> version;
+    if (version != INDEX_VERSION)
+    {
+        return false;
+    }
+
+    qint64 stampCount = 0;
+    stream >> stampCount;
+    if (stampCount != qint64(stamps.size()))
+    {
+        return false;
+    }
+
+    for (const auto& stamp : stamps)
+    {
+        QString directory;
+        qint64 modified = 0;
+        stream >> directory;
+        stream >> modified;
+
+        if (directory != stamp.first || modified != stamp.second)
+        {
+            return false;
+        }
+    }
+
+    Entries entries;
+    qint64 entryCount = 0;
+    stream >> entryCount;
+    for (qint64 i = 0; i < entryCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        QString key;
+        Entry entry;
+        stream >> key;
+        stream >> entry.fileName;
+        stream >> entry.weight;
+        stream >> entry.italic;
+        entries.emplace(qMove(key), qMove(entry));
+    }
+
+    if (stream.status() != QDataStream::Ok)
+    {
+        return false;
+    }
+
+    QMutexLocker lock(&m_mutex);
+    m_entries = qMove(entries);
+    return true;
+}
+
+void PDFSystemFontIndex::build(const DirectoryStamps& stamps)
+{
+    FT_Library library = nullptr;
+    if (FT_Init_FreeType(&library))
+    {
+        return;
+    }
+
+    Entries entries;
+    const QStringList nameFilters = { "*.ttf", "*.otf", "*.ttc", "*.otc", "*.pfb" };
+
+    for (const QString& directory : QStandardPaths::standardLocations(QStandardPaths::FontsLocation))
+    {
+        QDirIterator it(directory, nameFilters, QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext() && !m_cancelled)
+        {
+            const QString fileName = it.next();
+
+            // Only first face of the font collection is indexed, because
+            // system fonts are always loaded using face index 0.
+            FT_Face face = nullptr;
+            if (FT_New_Face(library, QFile::encodeName(fileName).constData(), 0, &face))
+            {
+                continue;
+            }
+
+            Entry entry;
+            entry.fileName = fileName;
+            entry.italic = face->style_flags & FT_STYLE_FLAG_ITALIC;
+            entry.weight = (face->style_flags & FT_STYLE_FLAG_BOLD) ? 700 : 400;
+
+            if (const TT_OS2* os2 = static_cast<const TT_OS2*>(FT_Get_Sfnt_Table(face, FT_SFNT_OS2)))
+            {
+                entry.weight = os2->usWeightClass;
+            }
+
+            QString postscriptName = getFontPostscriptName(QString::fromLatin1(FT_Get_Postscript_Name(face)));
+            QString familyName = getFontPostscriptName(QString::fromLatin1(face->family_name));
+
+            if (!postscriptName.isEmpty())
+            {
+                entries.emplace(postscriptName, entry);
+            }
+
+            if (!familyName.isEmpty() && familyName != postscriptName)
+            {
+                entries.emplace(familyName, entry);
+            }
+
+            FT_Done_Face(face);
+        }
+    }
+
+    FT_Done_FreeType(library);
+
+    if (m_cancelled)
+    {
+        return;
+    }
+
+    QString fileName = getIndexFileName();
+    QDir().mkpath(QFileInfo(fileName).path());
+
+    QSaveFile file(fileName);
+    if (file.open(QFile::WriteOnly))
+    {
+        QDataStream stream(&file);
+        stream << INDEX_VERSION;
+        stream << qint64(stamps.size());
+        for (const auto& stamp : stamps)
+        {
+            stream << stamp.first;
+            stream << stamp.second;
+        }
+
+        stream << qint64(entries.size());
+        for (const auto& item : entries)
+        {
+            stream << item.first;
+            stream << item.second.fileName;
+            stream << item.second.weight;
+            stream << item.second.italic;
+        }
+
+        file.commit();
+    }
+
+    QMutexLocker lock(&m_mutex);
+    m_entries = qMove(entries);
+}
+
 /// Storage class for system fonts
 class PDFSystemFontInfoStorage
 {
@@ -135,6 +448,13 @@ public:
 private:
     explicit PDFSystemFontInfoStorage();
 
+    /// Loads font from descriptor, substitution decision is not cached
+    /// \param descriptor Descriptor describing the font
+    QByteArray loadFontUncached(const CIDSystemInfo* cidSystemInfo,
+                                const FontDescriptor* descriptor,
+                                StandardFontType standardFontType,
+                                PDFRenderErrorReporter* reporter) const;
+
     /// Loads font from descriptor
     /// \param descriptor Descriptor describing the font
     QByteArray loadFontImpl(const FontDescriptor* descriptor,
@@ -146,9 +466,6 @@ private:
     static void checkFontConfigError(FcBool result);
 #endif
 
-    /// Create a postscript name for comparation purposes
-    static QString getFontPostscriptName(QString fontName);
-
 #ifdef Q_OS_WIN
     /// Callback for enumerating fonts
     static int CALLBACK enumerateFontProc(const LOGFONT* font, const TEXTMETRIC* textMetrics, DWORD fontType, LPARAM lParam);
@@ -173,6 +490,51 @@ private:
 
     std::vector<FontInfo> m_fontInfos;
 #endif
+
+    /// Substitution decision, warnings are reported again, when decision is reused
+    struct Substitution
+    {
+        QByteArray fontData;
+        std::vector<std::pair<RenderErrorType, QString>> warnings;
+    };
+
+    /// Reporter, which records reported warnings of the substitution
+    class SubstitutionReporter : public PDFRenderErrorReporter
+    {
+    public:
+        explicit SubstitutionReporter(PDFRenderErrorReporter* reporter, Substitution* substitution) :
+            m_reporter(reporter),
+            m_substitution(substitution)
+        {
+
+        }
+
+        virtual void reportRenderError(RenderErrorType type, QString message) override
+        {
+            m_substitution->warnings.emplace_back(type, message);
+            m_reporter->reportRenderError(type, qMove(message));
+        }
+
+        virtual void reportRenderErrorOnce(RenderErrorType type, QString message) override
+        {
+            m_substitution->warnings.emplace_back(type, message);
+            m_reporter->reportRenderErrorOnce(type, qMove(message));
+        }
+
+    private:
+        PDFRenderErrorReporter* m_reporter;
+        Substitution* m_substitution;
+    };
+
+    PDFSystemFontIndex m_fontIndex;
+
+    /// Fonts are loaded one at a time, because system font
+    /// interface is not guaranteed to be thread safe
+    mutable QMutex m_mutex;
+
+    /// Substitution decisions, key is composed from descriptor attributes, which are
+    /// used to select the font, so same decision is made for same descriptors.
+    mutable QCache<QByteArray, Substitution> m_substitutions;
 };
 
 const PDFSystemFontInfoStorage* PDFSystemFontInfoStorage::getInstance()
@@ -185,6 +547,41 @@ QByteArray PDFSystemFontInfoStorage::loadFont(const CIDSystemInfo* cidSystemInfo
                                               const FontDescriptor* descriptor,
                                               StandardFontType standardFontType,
                                               PDFRenderErrorReporter* reporter) const
+{
+    QMutexLocker lock(&m_mutex);
+
+    QByteArray key;
+    {
+        QDataStream stream(&key, QIODevice::WriteOnly);
+        stream << cidSystemInfo->registry << cidSystemInfo->ordering;
+        stream << descriptor->fontName << descriptor->fontFamily << descriptor->fontWeight;
+        stream << descriptor->italicAngle << descriptor->flags << int(descriptor->fontStretch);
+        stream << int(standardFontType);
+    }
+
+    if (const Substitution* substitution = m_substitutions.object(key))
+    {
+        for (const auto& warning : substitution->warnings)
+        {
+            reporter->reportRenderError(warning.first, warning.second);
+        }
+
+        return substitution->fontData;
+    }
+
+    auto substitution = std::make_unique<Substitution>();
+    SubstitutionReporter substitutionReporter(reporter, substitution.get());
+    substitution->fontData = loadFontUncached(cidSystemInfo, descriptor, standardFontType, &substitutionReporter);
+
+    QByteArray fontData = substitution->fontData;
+    m_substitutions.insert(key, substitution.release(), qMax<qsizetype>(fontData.size(), 1));
+    return fontData;
+}
+
+QByteArray PDFSystemFontInfoStorage::loadFontUncached(const CIDSystemInfo* cidSystemInfo,
+                                                      const FontDescriptor* descriptor,
+                                                      StandardFontType standardFontType,
+                                                      PDFRenderErrorReporter* reporter) const
 {
     QString fontName;
     QString standardFontSubstituteFileName;
@@ -302,7 +699,7 @@ QByteArray PDFSystemFontInfoStorage::loadFont(const CIDSystemInfo* cidSystemInfo
 
         default:
         {
-            fontName = getFontPostscriptName(descriptor->fontName);
+            fontName = PDFSystemFontIndex::getFontPostscriptName(descriptor->fontName);
             break;
         }
     }
@@ -373,7 +770,11 @@ QByteArray PDFSystemFontInfoStorage::loadFontImpl(const FontDescriptor* descript
                                                   StandardFontType standardFontType,
                                                   PDFRenderErrorReporter* reporter) const
 {
-    QByteArray result;
+    QByteArray result = m_fontIndex.loadFont(fontName, qRound(descriptor->fontWeight), descriptor->italicAngle != 0.0);
+    if (!result.isEmpty())
+    {
+        return result;
+    }
 
 #if defined(Q_OS_WIN)
 
@@ -551,7 +952,8 @@ QByteArray PDFSystemFontInfoStorage::loadFontImpl(const FontDescriptor* descript
 #endif
 }
 
-PDFSystemFontInfoStorage::PDFSystemFontInfoStorage()
+PDFSystemFontInfoStorage::PDFSystemFontInfoStorage() :
+    m_substitutions(DEFAULT_SYSTEM_FONT_SUBSTITUTION_CACHE_BUDGET)
 {
 #ifdef Q_OS_WIN
     LOGFONT logfont;
@@ -580,7 +982,7 @@ int PDFSystemFontInfoStorage::enumerateFontProc(const LOGFONT* font, const TEXTM
         fontInfo.logFont = *font;
         fontInfo.textMetric = *textMetrics;
         fontInfo.faceName = QString::fromWCharArray(font->lfFaceName);
-        fontInfo.faceNameAdjusted = getFontPostscriptName(fontInfo.faceName);
+        fontInfo.faceNameAdjusted = PDFSystemFontIndex::getFontPostscriptName(fontInfo.faceName);
 
         if (callbackInfo->usedFonts.count(fontInfo.faceName))
         {
@@ -636,20 +1038,52 @@ void PDFSystemFontInfoStorage::checkFontConfigError(FcBool result)
 }
 #endif
 
-QString PDFSystemFontInfoStorage::getFontPostscriptName(QString fontName)
+/// Cache of unhinted glyph outlines of the font, which is shared by all realized fonts
+/// of the font. Glyphs are loaded by FreeType only once, regardless of how many pixel
+/// sizes of the font are used. Outlines are stored for pixel size 1.0, realized fonts
+/// scale them to their pixel size. Least recently used glyphs are removed, if glyph
+/// count limit is exceeded. This class is thread safe.
+class PDFGlyphOutlineCache
 {
-    for (const char* string : { "PS", "MT", "Regular", "Bold", "Italic", "Oblique" })
+public:
+    explicit PDFGlyphOutlineCache(int glyphLimit);
+    ~PDFGlyphOutlineCache();
+
+    /// Creates font face from the font data, if it was not created yet
+    /// \param fontData Font data (embedded font data, or system font data)
+    void initialize(const QByteArray& fontData);
+
+    /// Retrieves glyph outline and glyph advance for pixel size 1.0. If glyph can't be
+    /// loaded (or font face can't be created), false is returned.
+    /// \param glyphIndex Glyph index
+    /// \param[out] outline Glyph outline
+    /// \param[out] advance Glyph advance
+    bool getGlyph(unsigned int glyphIndex, QPainterPath& outline, QPointF& advance);
+
+private:
+    struct Glyph
     {
-        fontName.remove(QLatin1String(string), Qt::CaseInsensitive);
-    }
+        QPainterPath outline;
+        QPointF advance;
+    };
 
-    return fontName.remove(QChar(' ')).remove(QChar('-')).remove(QChar(',')).trimmed();
-}
+    /// Pixel size, for which glyphs are loaded. It is large enough
+    /// to make rounding of FreeType coordinates negligible.
+    static constexpr const PDFReal REFERENCE_PIXEL_SIZE = 10.0;
+
+    QMutex m_mutex;
+    QCache<unsigned int, Glyph> m_cache;
+    QByteArray m_fontData;
+    FT_Library m_library;
+    FT_Face m_face;
+    bool m_isInitialized;
+};
 
 PDFFont::PDFFont(CIDSystemInfo CIDSystemInfo, QByteArray fontId, FontDescriptor fontDescriptor) :
     m_CIDSystemInfo(qMove(CIDSystemInfo)),
     m_fontDescriptor(qMove(fontDescriptor)),
-    m_fontId(qMove(fontId))
+    m_fontId(qMove(fontId)),
+    m_glyphOutlineCache(std::make_shared<PDFGlyphOutlineCache>(DEFAULT_GLYPH_OUTLINE_CACHE_LIMIT))
 {
 
 }
@@ -677,6 +1111,9 @@ public:
 
     /// Returns character info
     virtual CharacterInfos getCharacterInfos() const = 0;
+
+    /// Returns estimate of memory (in bytes) consumed by cached glyphs
+    virtual qint64 getMemoryConsumptionEstimate() const { return 0; }
 };
 
 /// Implementation of the PDFRealizedFont class using PIMPL pattern for Type 3 fonts
@@ -712,11 +1149,14 @@ public:
     virtual void dumpFontToTreeItem(ITreeFactory* treeFactory) const override;
     virtual QString getPostScriptName() const override { return m_postScriptName; }
     virtual CharacterInfos getCharacterInfos() const override;
+    virtual qint64 getMemoryConsumptionEstimate() const override;
 
     static constexpr const PDFReal PIXEL_SIZE_MULTIPLIER = 100.0;
 
 private:
     friend class PDFRealizedFont;
+    friend class PDFGlyphOutlineCache;
+    friend class PDFSharedSystemFontCache;
 
     static constexpr const PDFReal FONT_WIDTH_MULTIPLIER = 1.0 / 1000.0;
     static constexpr const PDFReal FORMAT_26_6_MULTIPLIER = 1 / 64.0;
@@ -739,11 +1179,25 @@ private:
     /// Function checks, if error occured, and if yes, then exception is thrown
     static void checkFreeTypeError(FT_Error error);
 
-    /// Read/write lock for accessing the glyph data
-    QReadWriteLock m_readWriteLock;
+    /// Glyphs realized for the pixel size of the font. Glyphs of system fonts
+    /// are shared by realized fonts of all documents (see PDFSharedSystemFontCache).
+    struct GlyphStore
+    {
+        /// Font data, glyphs are realized from
+        QByteArray fontData;
+
+        /// Read/write lock for accessing the glyph data
+        mutable QReadWriteLock readWriteLock;
+
+        /// Glyph cache, must be protected by the mutex above
+        std::unordered_map<unsigned int, Glyph> glyphs;
 
-    /// Glyph cache, must be protected by the mutex above
-    std::unordered_map<unsigned int, Glyph> m_glyphCache;
+        /// Glyph atlas of the realized glyphs
+        PDFGlyphAtlasPointer glyphAtlas;
+    };
+
+    /// Glyphs of the font
+    std::shared_ptr<GlyphStore> m_glyphStore;
 
     /// For embedded fonts, this byte array contains embedded font data
     QByteArray m_embeddedFontData;
@@ -763,6 +1217,10 @@ private:
     /// Parent font
     PDFFontPointer m_parentFont;
 
+    /// Glyph outline cache of the parent font (or shared
+    /// glyph outline cache of the system font)
+    std::shared_ptr<PDFGlyphOutlineCache> m_glyphOutlineCache;
+
     /// True, if font is embedded
     bool m_isEmbedded;
 
@@ -778,6 +1236,8 @@ PDFRealizedFontImpl::PDFRealizedFontImpl() :
     m_face(nullptr),
     m_pixelSize(0.0),
     m_parentFont(nullptr),
+    m_glyphOutlineCache(nullptr),
+    m_glyphStore(std::make_shared<GlyphStore>()),
     m_isEmbedded(false),
     m_isVertical(false)
 {
@@ -1090,90 +1550,317 @@ void PDFRealizedFontImpl::dumpFontToTreeItem(ITreeFactory* treeFactory) const
                     encodingName = PDFTranslationContext::tr("Apple Roman");
                     break;
 
-                default:
-                    encodingName = PDFTranslationContext::tr("Unknown");
-                    break;
-            }
+                default:
+                    encodingName = PDFTranslationContext::tr("Unknown");
+                    break;
+            }
+
+            QString encodingString = PDFTranslationContext::tr("Platform/Encoding = %1 %2").arg(charMap->platform_id).arg(charMap->encoding_id);
+            treeFactory->addItem({ encodingName, encodingString });
+        }
+        treeFactory->popItem();
+    }
+
+    treeFactory->popItem();
+}
+
+int PDFRealizedFontImpl::outlineMoveTo(const FT_Vector* to, void* user)
+{
+    Glyph* glyph = reinterpret_cast<Glyph*>(user);
+    glyph->glyph.moveTo(to->x * FONT_MULTIPLIER, to->y * FONT_MULTIPLIER);
+    return 0;
+}
+
+int PDFRealizedFontImpl::outlineLineTo(const FT_Vector* to, void* user)
+{
+    Glyph* glyph = reinterpret_cast<Glyph*>(user);
+    glyph->glyph.lineTo(to->x * FONT_MULTIPLIER, to->y * FONT_MULTIPLIER);
+    return 0;
+}
+
+int PDFRealizedFontImpl::outlineConicTo(const FT_Vector* control, const FT_Vector* to, void* user)
+{
+    Glyph* glyph = reinterpret_cast<Glyph*>(user);
+    glyph->glyph.quadTo(control->x * FONT_MULTIPLIER, control->y * FONT_MULTIPLIER, to->x * FONT_MULTIPLIER, to->y * FONT_MULTIPLIER);
+    return 0;
+}
+
+int PDFRealizedFontImpl::outlineCubicTo(const FT_Vector* control1, const FT_Vector* control2, const FT_Vector* to, void* user)
+{
+    Glyph* glyph = reinterpret_cast<Glyph*>(user);
+    glyph->glyph.cubicTo(control1->x * FONT_MULTIPLIER, control1->y * FONT_MULTIPLIER, control2->x * FONT_MULTIPLIER, control2->y * FONT_MULTIPLIER, to->x * FONT_MULTIPLIER, to->y * FONT_MULTIPLIER);
+    return 0;
+}
+
+qint64 PDFRealizedFontImpl::getMemoryConsumptionEstimate() const
+{
+    QReadLocker readLock(&m_glyphStore->readWriteLock);
+
+    // System font data are counted to this font, embedded font data are shared with the font descriptor
+    qint64 result = m_systemFontData.size();
+    for (const auto& item : m_glyphStore->glyphs)
+    {
+        result += sizeof(item) + item.second.glyph.elementCount() * sizeof(QPainterPath::Element);
+    }
+
+    return result;
+}
+
+const PDFRealizedFontImpl::Glyph& PDFRealizedFontImpl::getGlyph(unsigned int glyphIndex)
+{
+    if (glyphIndex)
+    {
+        {
+            QReadLocker readLock(&m_glyphStore->readWriteLock);
+
+            // First look into cache
+            auto it = m_glyphStore->glyphs.find(glyphIndex);
+            if (it != m_glyphStore->glyphs.cend())
+            {
+                return it->second;
+            }
+        }
+
+        QWriteLocker writeLock(&m_glyphStore->readWriteLock);
+        Glyph glyph;
+
+        QPainterPath outline;
+        QPointF advance;
+        if (m_glyphOutlineCache && m_glyphOutlineCache->getGlyph(glyphIndex, outline, advance))
+        {
+            // Outlines are not hinted, so we just scale them to our pixel size
+            glyph.glyph = QTransform::fromScale(m_pixelSize, m_pixelSize).map(outline);
+            glyph.advance = (!m_isVertical ? advance.x() : advance.y()) * m_pixelSize;
+        }
+        else
+        {
+            FT_Outline_Funcs glyphOutlineInterface;
+            glyphOutlineInterface.delta = 0;
+            glyphOutlineInterface.shift = 0;
+            glyphOutlineInterface.move_to = PDFRealizedFontImpl::outlineMoveTo;
+            glyphOutlineInterface.line_to = PDFRealizedFontImpl::outlineLineTo;
+            glyphOutlineInterface.conic_to = PDFRealizedFontImpl::outlineConicTo;
+            glyphOutlineInterface.cubic_to = PDFRealizedFontImpl::outlineCubicTo;
+
+            checkFreeTypeError(FT_Load_Glyph(m_face, glyphIndex, FT_LOAD_NO_BITMAP | FT_LOAD_NO_HINTING));
+            checkFreeTypeError(FT_Outline_Decompose(&m_face->glyph->outline, &glyphOutlineInterface, &glyph));
+            glyph.glyph.closeSubpath();
+            glyph.advance = !m_isVertical ? m_face->glyph->advance.x : m_face->glyph->advance.y;
+            glyph.advance *= FONT_MULTIPLIER;
+        }
+
+        auto it = m_glyphStore->glyphs.find(glyphIndex);
+        if (it == m_glyphStore->glyphs.cend())
+        {
+            it = m_glyphStore->glyphs.insert(std::make_pair(glyphIndex, qMove(glyph))).first;
+        }
+        return it->second;
+    }
+
+    static Glyph dummy;
+    return dummy;
+}
+
+PDFGlyphOutlineCache::PDFGlyphOutlineCache(int glyphLimit) :
+    m_cache(glyphLimit),
+    m_library(nullptr),
+    m_face(nullptr),
+    m_isInitialized(false)
+{
+
+}
+
+PDFGlyphOutlineCache::~PDFGlyphOutlineCache()
+{
+    if (m_face)
+    {
+        FT_Done_Face(m_face);
+        m_face = nullptr;
+    }
+
+    if (m_library)
+    {
+        FT_Done_FreeType(m_library);
+        m_library = nullptr;
+    }
+}
+
+void PDFGlyphOutlineCache::initialize(const QByteArray& fontData)
+{
+    QMutexLocker lock(&m_mutex);
+
+    if (m_isInitialized)
+    {
+        return;
+    }
+
+    // Errors are not reported, realized fonts then load glyphs by themselves
+    m_isInitialized = true;
+    m_fontData = fontData;
+
+    if (m_fontData.isEmpty() || FT_Init_FreeType(&m_library))
+    {
+        m_library = nullptr;
+        return;
+    }
+
+    if (FT_New_Memory_Face(m_library, reinterpret_cast<const FT_Byte*>(m_fontData.constData()), m_fontData.size(), 0, &m_face))
+    {
+        m_face = nullptr;
+        return;
+    }
+
+    if (FT_Set_Pixel_Sizes(m_face, 0, qRound(REFERENCE_PIXEL_SIZE * PDFRealizedFontImpl::PIXEL_SIZE_MULTIPLIER)))
+    {
+        FT_Done_Face(m_face);
+        m_face = nullptr;
+    }
+}
+
+bool PDFGlyphOutlineCache::getGlyph(unsigned int glyphIndex, QPainterPath& outline, QPointF& advance)
+{
+    QMutexLocker lock(&m_mutex);
+
+    if (!m_face)
+    {
+        return false;
+    }
+
+    if (const Glyph* glyph = m_cache.object(glyphIndex))
+    {
+        outline = glyph->outline;
+        advance = glyph->advance;
+        return true;
+    }
+
+    FT_Outline_Funcs glyphOutlineInterface;
+    glyphOutlineInterface.delta = 0;
+    glyphOutlineInterface.shift = 0;
+    glyphOutlineInterface.move_to = PDFRealizedFontImpl::outlineMoveTo;
+    glyphOutlineInterface.line_to = PDFRealizedFontImpl::outlineLineTo;
+    glyphOutlineInterface.conic_to = PDFRealizedFontImpl::outlineConicTo;
+    glyphOutlineInterface.cubic_to = PDFRealizedFontImpl::outlineCubicTo;
 
-            QString encodingString = PDFTranslationContext::tr("Platform/Encoding = %1 %2").arg(charMap->platform_id).arg(charMap->encoding_id);
-            treeFactory->addItem({ encodingName, encodingString });
-        }
-        treeFactory->popItem();
+    PDFRealizedFontImpl::Glyph loadedGlyph;
+    if (FT_Load_Glyph(m_face, glyphIndex, FT_LOAD_NO_BITMAP | FT_LOAD_NO_HINTING) ||
+        FT_Outline_Decompose(&m_face->glyph->outline, &glyphOutlineInterface, &loadedGlyph))
+    {
+        return false;
     }
+    loadedGlyph.glyph.closeSubpath();
 
-    treeFactory->popItem();
-}
+    constexpr PDFReal scale = PDFRealizedFontImpl::FONT_MULTIPLIER / REFERENCE_PIXEL_SIZE;
+    std::unique_ptr<Glyph> glyph = std::make_unique<Glyph>();
+    glyph->outline = QTransform::fromScale(1.0 / REFERENCE_PIXEL_SIZE, 1.0 / REFERENCE_PIXEL_SIZE).map(loadedGlyph.glyph);
+    glyph->advance = QPointF(m_face->glyph->advance.x * scale, m_face->glyph->advance.y * scale);
 
-int PDFRealizedFontImpl::outlineMoveTo(const FT_Vector* to, void* user)
-{
-    Glyph* glyph = reinterpret_cast<Glyph*>(user);
-    glyph->glyph.moveTo(to->x * FONT_MULTIPLIER, to->y * FONT_MULTIPLIER);
-    return 0;
+    outline = glyph->outline;
+    advance = glyph->advance;
+    m_cache.insert(glyphIndex, glyph.release(), 1);
+    return true;
 }
 
-int PDFRealizedFontImpl::outlineLineTo(const FT_Vector* to, void* user)
+/// Process-wide cache of glyphs of system fonts (standard 14 fonts and substituted
+/// system fonts). Unlike embedded fonts, system fonts do not depend on the document, so glyph
+/// outlines, glyphs realized for given pixel size and glyph atlases of the same font program
+/// are shared by realized fonts of all documents and all font caches. Font program is identified
+/// by its data, because system font storage returns the same (implicitly shared) data for the same
+/// font. Entries are kept only as long as some realized font uses them. This class is thread safe.
+class PDFSharedSystemFontCache
 {
-    Glyph* glyph = reinterpret_cast<Glyph*>(user);
-    glyph->glyph.lineTo(to->x * FONT_MULTIPLIER, to->y * FONT_MULTIPLIER);
-    return 0;
-}
+public:
+    /// Returns instance of the cache
+    static PDFSharedSystemFontCache* getInstance();
 
-int PDFRealizedFontImpl::outlineConicTo(const FT_Vector* control, const FT_Vector* to, void* user)
-{
-    Glyph* glyph = reinterpret_cast<Glyph*>(user);
-    glyph->glyph.quadTo(control->x * FONT_MULTIPLIER, control->y * FONT_MULTIPLIER, to->x * FONT_MULTIPLIER, to->y * FONT_MULTIPLIER);
-    return 0;
-}
+    /// Returns glyph outline cache of the font program
+    /// \param fontData Font data
+    std::shared_ptr<PDFGlyphOutlineCache> getGlyphOutlineCache(const QByteArray& fontData);
 
-int PDFRealizedFontImpl::outlineCubicTo(const FT_Vector* control1, const FT_Vector* control2, const FT_Vector* to, void* user)
+    /// Returns glyphs of the font program realized for given pixel size
+    /// \param fontData Font data
+    /// \param pixelSize Pixel size
+    /// \param isVertical Is vertical writing system used?
+    std::shared_ptr<PDFRealizedFontImpl::GlyphStore> getGlyphStore(const QByteArray& fontData, PDFReal pixelSize, bool isVertical);
+
+private:
+    explicit PDFSharedSystemFontCache() = default;
+
+    using GlyphStoreKey = std::tuple<const char*, PDFReal, bool>;
+
+    /// Removes entries, which are no longer used. Mutex must be locked.
+    template<typename Key, typename Value>
+    static void removeExpiredEntries(std::map<Key, std::weak_ptr<Value>>& entries);
+
+    QMutex m_mutex;
+
+    /// Entries are identified by the pointer to the font data. Pointer can't be
+    /// reused by another data, while entry is alive, because entry holds the data.
+    std::map<const char*, std::weak_ptr<PDFGlyphOutlineCache>> m_glyphOutlineCaches;
+    std::map<GlyphStoreKey, std::weak_ptr<PDFRealizedFontImpl::GlyphStore>> m_glyphStores;
+};
+
+PDFSharedSystemFontCache* PDFSharedSystemFontCache::getInstance()
 {
-    Glyph* glyph = reinterpret_cast<Glyph*>(user);
-    glyph->glyph.cubicTo(control1->x * FONT_MULTIPLIER, control1->y * FONT_MULTIPLIER, control2->x * FONT_MULTIPLIER, control2->y * FONT_MULTIPLIER, to->x * FONT_MULTIPLIER, to->y * FONT_MULTIPLIER);
-    return 0;
+    static PDFSharedSystemFontCache instance;
+    return &instance;
 }
 
-const PDFRealizedFontImpl::Glyph& PDFRealizedFontImpl::getGlyph(unsigned int glyphIndex)
+std::shared_ptr<PDFGlyphOutlineCache> PDFSharedSystemFontCache::getGlyphOutlineCache(const QByteArray& fontData)
 {
-    if (glyphIndex)
+    std::shared_ptr<PDFGlyphOutlineCache> glyphOutlineCache;
+
     {
-        {
-            QReadLocker readLock(&m_readWriteLock);
+        QMutexLocker lock(&m_mutex);
 
-            // First look into cache
-            auto it = m_glyphCache.find(glyphIndex);
-            if (it != m_glyphCache.cend())
-            {
-                return it->second;
-            }
+        std::weak_ptr<PDFGlyphOutlineCache>& entry = m_glyphOutlineCaches[fontData.constData()];
+        glyphOutlineCache = entry.lock();
+
+        if (!glyphOutlineCache)
+        {
+            removeExpiredEntries(m_glyphOutlineCaches);
+            glyphOutlineCache = std::make_shared<PDFGlyphOutlineCache>(DEFAULT_GLYPH_OUTLINE_CACHE_LIMIT);
+            m_glyphOutlineCaches[fontData.constData()] = glyphOutlineCache;
         }
+    }
 
-        QWriteLocker writeLock(&m_readWriteLock);
-        Glyph glyph;
+    // Font face is created without locked mutex, initialization is thread safe
+    glyphOutlineCache->initialize(fontData);
+    return glyphOutlineCache;
+}
 
-        FT_Outline_Funcs glyphOutlineInterface;
-        glyphOutlineInterface.delta = 0;
-        glyphOutlineInterface.shift = 0;
-        glyphOutlineInterface.move_to = PDFRealizedFontImpl::outlineMoveTo;
-        glyphOutlineInterface.line_to = PDFRealizedFontImpl::outlineLineTo;
-        glyphOutlineInterface.conic_to = PDFRealizedFontImpl::outlineConicTo;
-        glyphOutlineInterface.cubic_to = PDFRealizedFontImpl::outlineCubicTo;
+std::shared_ptr<PDFRealizedFontImpl::GlyphStore> PDFSharedSystemFontCache::getGlyphStore(const QByteArray& fontData, PDFReal pixelSize, bool isVertical)
+{
+    QMutexLocker lock(&m_mutex);
+
+    const GlyphStoreKey key(fontData.constData(), pixelSize, isVertical);
+    std::shared_ptr<PDFRealizedFontImpl::GlyphStore> glyphStore = m_glyphStores[key].lock();
+
+    if (!glyphStore)
+    {
+        removeExpiredEntries(m_glyphStores);
+        glyphStore = std::make_shared<PDFRealizedFontImpl::GlyphStore>();
+        glyphStore->fontData = fontData;
+        glyphStore->glyphAtlas = std::make_shared<PDFGlyphAtlas>(DEFAULT_GLYPH_ATLAS_BUDGET);
+        m_glyphStores[key] = glyphStore;
+    }
 
-        checkFreeTypeError(FT_Load_Glyph(m_face, glyphIndex, FT_LOAD_NO_BITMAP | FT_LOAD_NO_HINTING));
-        checkFreeTypeError(FT_Outline_Decompose(&m_face->glyph->outline, &glyphOutlineInterface, &glyph));
-        glyph.glyph.closeSubpath();
-        glyph.advance = !m_isVertical ? m_face->glyph->advance.x : m_face->glyph->advance.y;
-        glyph.advance *= FONT_MULTIPLIER;
+    return glyphStore;
+}
 
-        auto it = m_glyphCache.find(glyphIndex);
-        if (it == m_glyphCache.cend())
+template<typename Key, typename Value>
+void PDFSharedSystemFontCache::removeExpiredEntries(std::map<Key, std::weak_ptr<Value>>& entries)
+{
+    for (auto it = entries.begin(); it != entries.end();)
+    {
+        if (it->second.expired())
         {
-            it = m_glyphCache.insert(std::make_pair(glyphIndex, qMove(glyph))).first;
+            it = entries.erase(it);
+        }
+        else
+        {
+            ++it;
         }
-        return it->second;
     }
-
-    static Glyph dummy;
-    return dummy;
 }
 
 void PDFRealizedFontImpl::checkFreeTypeError(FT_Error error)
@@ -1220,8 +1907,15 @@ CharacterInfos PDFRealizedFont::getCharacterInfos() const
     return m_impl->getCharacterInfos();
 }
 
+qint64 PDFRealizedFont::getMemoryConsumptionEstimate() const
+{
+    return m_impl->getMemoryConsumptionEstimate() + (m_glyphAtlas ? m_glyphAtlas->getCacheCost() : 0);
+}
+
 PDFRealizedFontPointer PDFRealizedFont::createRealizedFont(PDFFontPointer font, PDFReal pixelSize, PDFRenderErrorReporter* reporter)
 {
+    PDF_TRACE_ZONE("RealizeFont", "font");
+
     PDFRealizedFontPointer result;
 
     if (pixelSize < 0.0)
@@ -1258,7 +1952,11 @@ PDFRealizedFontPointer PDFRealizedFont::createRealizedFont(PDFFontPointer font,
             PDFRealizedFontImpl::checkFreeTypeError(FT_Set_Pixel_Sizes(impl->m_face, 0, qRound(pixelSize * PDFRealizedFontImpl::PIXEL_SIZE_MULTIPLIER)));
             impl->m_isVertical = cmap ? cmap->isVertical() : false;
             impl->m_isEmbedded = true;
+            impl->m_glyphOutlineCache = font->getGlyphOutlineCache();
+            impl->m_glyphOutlineCache->initialize(impl->m_embeddedFontData);
+            impl->m_glyphStore->glyphAtlas = std::make_shared<PDFGlyphAtlas>(DEFAULT_GLYPH_ATLAS_BUDGET);
             result.reset(new PDFRealizedFont(implPtr.release()));
+            result->m_glyphAtlas = impl->m_glyphStore->glyphAtlas;
         }
         else
         {
@@ -1282,11 +1980,17 @@ PDFRealizedFontPointer PDFRealizedFont::createRealizedFont(PDFFontPointer font,
             PDFRealizedFontImpl::checkFreeTypeError(FT_Set_Pixel_Sizes(impl->m_face, 0, qRound(pixelSize * PDFRealizedFontImpl::PIXEL_SIZE_MULTIPLIER)));
             impl->m_isVertical = cmap ? cmap->isVertical() : false;
             impl->m_isEmbedded = false;
+
+            // System fonts do not depend on the document, so glyphs are shared by all documents
+            PDFSharedSystemFontCache* sharedCache = PDFSharedSystemFontCache::getInstance();
+            impl->m_glyphOutlineCache = sharedCache->getGlyphOutlineCache(impl->m_systemFontData);
+            impl->m_glyphStore = sharedCache->getGlyphStore(impl->m_systemFontData, pixelSize, impl->m_isVertical);
             if (const char* postScriptName = FT_Get_Postscript_Name(impl->m_face))
             {
                 impl->m_postScriptName = QString::fromLatin1(postScriptName);
             }
             result.reset(new PDFRealizedFont(implPtr.release()));
+            result->m_glyphAtlas = impl->m_glyphStore->glyphAtlas;
         }
     }
 
@@ -2233,6 +2937,110 @@ FontType PDFTrueTypeFont::getFontType() const
     return FontType::TrueType;
 }
 
+static size_t getFontCacheKeyHash(const PDFObjectReference& reference)
+{
+    return std::hash<PDFInteger>()(reference.objectNumber) ^ std::hash<PDFInteger>()(reference.generation);
+}
+
+static size_t getFontCacheKeyHash(const std::pair<PDFFontPointer, PDFReal>& key)
+{
+    return std::hash<const void*>()(key.first.get()) ^ std::hash<PDFReal>()(key.second);
+}
+
+template<typename Key, typename Value, typename Create>
+Value PDFFontCache::getOrCreate(Shards<Key, Value>& shards,
+                                const Key& key,
+                                std::atomic<qint64>& count,
+                                size_t limit,
+                                std::atomic<qint64>& hits,
+                                std::atomic<qint64>& misses,
+                                Create create) const
+{
+    Shard<Key, Value>& shard = shards[getFontCacheKeyHash(key) % SHARD_COUNT];
+    std::shared_ptr<Entry<Value>> entry;
+
+    {
+        if (!shard.lock.tryLockForRead())
+        {
+            ++m_contentions;
+            shard.lock.lockForRead();
+        }
+
+        auto it = shard.entries.find(key);
+        if (it != shard.entries.cend())
+        {
+            entry = it->second;
+        }
+
+        shard.lock.unlock();
+    }
+
+    if (!entry)
+    {
+        // We have exceeded the cache limit. Clear the cache.
+        clearShards(shards, count, limit, false);
+
+        if (!shard.lock.tryLockForWrite())
+        {
+            ++m_contentions;
+            shard.lock.lockForWrite();
+        }
+
+        std::shared_ptr<Entry<Value>>& newEntry = shard.entries[key];
+        if (!newEntry)
+        {
+            newEntry = std::make_shared<Entry<Value>>();
+            ++count;
+        }
+        entry = newEntry;
+
+        shard.lock.unlock();
+    }
+
+    // Value is created outside of the lock, other threads requesting
+    // the same value wait, until it is created. If creation fails, then
+    // exception is propagated, and next request tries to create value again.
+    bool isCreated = false;
+    std::call_once(entry->flag, [&]()
+    {
+        entry->value = create();
+        entry->isCreated.store(true, std::memory_order_release);
+        isCreated = true;
+    });
+
+    ++(isCreated ? misses : hits);
+    return entry->value;
+}
+
+template<typename Key, typename Value>
+void PDFFontCache::clearShards(Shards<Key, Value>& shards, std::atomic<qint64>& count, size_t limit, bool force) const
+{
+    if (!force)
+    {
+        if (count.load() < static_cast<qint64>(limit))
+        {
+            return;
+        }
+
+        QMutexLocker lock(&m_mutex);
+        if (!m_fontCacheShrinkDisabledObjects.empty())
+        {
+            return;
+        }
+
+        clearShards(shards, count, limit, true);
+        return;
+    }
+
+    for (Shard<Key, Value>& shard : shards)
+    {
+        shard.lock.lockForWrite();
+        count -= static_cast<qint64>(shard.entries.size());
+        shard.entries.clear();
+        shard.lock.unlock();
+    }
+}
+
 void PDFFontCache::setDocument(const PDFModifiedDocument& document)
 {
     QMutexLocker lock(&m_mutex);
@@ -2244,8 +3052,8 @@ void PDFFontCache::setDocument(const PDFModifiedDocument& document)
         // document remains the same. So it is not needed to clear font cache.
         if (document.hasReset() || document.hasPageContentsChanged())
         {
-            m_fontCache.clear();
-            m_realizedFontCache.clear();
+            clearShards(m_fontCache, m_fontCount, m_fontCacheLimit, true);
+            clearShards(m_realizedFontCache, m_realizedFontCount, m_realizedFontCacheLimit, true);
         }
     }
 }
@@ -2255,25 +3063,10 @@ PDFFontPointer PDFFontCache::getFont(const PDFObject& fontObject, const QByteArr
     if (fontObject.isReference())
     {
         // Font is object reference. Look in the cache, if we have it, then return it.
-
-        QMutexLocker lock(&m_mutex);
         PDFObjectReference reference = fontObject.getReference();
+        const PDFDocument* document = m_document;
 
-        auto it = m_fontCache.find(reference);
-        if (it == m_fontCache.cend())
-        {
-            // We must create the font
-            PDFFontPointer font = PDFFont::createFont(fontObject, fontId, m_document);
-
-            if (m_fontCacheShrinkDisabledObjects.empty() && m_fontCache.size() >= m_fontCacheLimit)
-            {
-                // We have exceeded the cache limit. Clear the cache.
-                m_fontCache.clear();
-            }
-
-            it = m_fontCache.insert(std::make_pair(reference, qMove(font))).first;
-        }
-        return it->second;
+        return getOrCreate(m_fontCache, reference, m_fontCount, m_fontCacheLimit, m_fontHits, m_fontMisses, [&]() { return PDFFont::createFont(fontObject, fontId, document); });
     }
     else
     {
@@ -2286,22 +3079,8 @@ PDFRealizedFontPointer PDFFontCache::getRealizedFont(const PDFFontPointer& font,
 {
     Q_ASSERT(font);
 
-    QMutexLocker lock(&m_mutex);
-    auto it = m_realizedFontCache.find(std::make_pair(font, size));
-    if (it == m_realizedFontCache.cend())
-    {
-        // We must create the realized font
-        PDFRealizedFontPointer realizedFont = PDFRealizedFont::createRealizedFont(font, size, reporter);
-
-        if (m_fontCacheShrinkDisabledObjects.empty() && m_realizedFontCache.size() >= m_realizedFontCacheLimit)
-        {
-            m_realizedFontCache.clear();
-        }
-
-        it = m_realizedFontCache.insert(std::make_pair(std::make_pair(font, size), qMove(realizedFont))).first;
-    }
-
-    return it->second;
+    return getOrCreate(m_realizedFontCache, std::make_pair(font, size), m_realizedFontCount, m_realizedFontCacheLimit, m_realizedFontHits, m_realizedFontMisses,
+                       [&]() { return PDFRealizedFont::createRealizedFont(font, size, reporter); });
 }
 
 void PDFFontCache::setCacheShrinkEnabled(const void* source, bool enabled)
@@ -2331,18 +3110,57 @@ void PDFFontCache::setCacheLimits(std::size_t fontCacheLimit, std::size_t instan
 
 void PDFFontCache::shrink()
 {
-    QMutexLocker lock(&m_mutex);
-    if (m_fontCacheShrinkDisabledObjects.empty())
+    clearShards(m_fontCache, m_fontCount, m_fontCacheLimit, false);
+    clearShards(m_realizedFontCache, m_realizedFontCount, m_realizedFontCacheLimit, false);
+}
+
+PDFFontCacheStatistics PDFFontCache::getStatistics() const
+{
+    PDFFontCacheStatistics statistics;
+    statistics.fontHits = m_fontHits.load();
+    statistics.fontMisses = m_fontMisses.load();
+    statistics.realizedFontHits = m_realizedFontHits.load();
+    statistics.realizedFontMisses = m_realizedFontMisses.load();
+    statistics.contentions = m_contentions.load();
+    statistics.fontCount = m_fontCount.load();
+    statistics.realizedFontCount = m_realizedFontCount.load();
+    return statistics;
+}
+
+void PDFFontCache::collectMemoryUsage(PDFMemoryReport* report) const
+{
+    // Values of the entries can be created concurrently (outside of the lock),
+    // so we take only values, which were already created.
+    auto collect = [](const auto& shards, auto getSize)
     {
-        if (m_fontCache.size() >= m_fontCacheLimit)
-        {
-            m_fontCache.clear();
-        }
-        if (m_realizedFontCache.size() >= m_realizedFontCacheLimit)
+        std::pair<qint64, qint64> result(0, 0);
+        for (const auto& shard : shards)
         {
-            m_realizedFontCache.clear();
+            QReadLocker lock(&shard.lock);
+            for (const auto& item : shard.entries)
+            {
+                if (item.second->isCreated.load(std::memory_order_acquire) && item.second->value)
+                {
+                    result.first += getSize(item.second->value);
+                    ++result.second;
+                }
+            }
         }
-    }
+        return result;
+    };
+
+    auto [fontBytes, fontCount] = collect(m_fontCache, [](const PDFFontPointer& font)
+    {
+        const QByteArray* data = font->getFontDescriptor()->getEmbeddedFontData();
+        return qint64(sizeof(PDFFont)) + (data ? data->size() : 0);
+    });
+    auto [realizedFontBytes, realizedFontCount] = collect(m_realizedFontCache, [](const PDFRealizedFontPointer& font)
+    {
+        return qint64(sizeof(PDFRealizedFont)) + font->getMemoryConsumptionEstimate();
+    });
+
+    report->addItem(PDFTranslationContext::tr("Fonts"), fontBytes, fontCount);
+    report->addItem(PDFTranslationContext::tr("Realized fonts"), realizedFontBytes, realizedFontCount);
 }
 
 const QByteArray* FontDescriptor::getEmbeddedFontData() const
@@ -2364,6 +3182,11 @@ const QByteArray* FontDescriptor::getEmbeddedFontData() const
 }
 
 PDFFontCMap PDFFontCMap::createFromName(const QByteArray& name)
+{
+    return PDFFontCMapRepository::getInstance()->getCMap(name);
+}
+
+PDFFontCMap PDFFontCMap::createFromResource(const QByteArray& name)
 {
     QFile file(QString(":/cmaps/%1").arg(QString::fromLatin1(name)));
     if (file.exists())
@@ -2582,7 +3405,7 @@ PDFFontCMap PDFFontCMap::createFromData(const QByteArray& data)
     {
         for (const PDFFontCMap& map : additionalMappings)
         {
-            entries.insert(entries.cend(), map.m_entries.cbegin(), map.m_entries.cend());
+            entries.insert(entries.cend(), map.m_entries.begin(), map.m_entries.end());
         }
     }
 
@@ -2612,15 +3435,18 @@ QByteArray PDFFontCMap::serialize() const
 
 PDFFontCMap PDFFontCMap::deserialize(const QByteArray& byteArray)
 {
-    PDFFontCMap result;
     QByteArray decompressed = qUncompress(byteArray);
     QDataStream stream(&decompressed, QIODevice::ReadOnly);
-    stream >> result.m_maxKeyLength;
-    stream >> result.m_vertical;
+    unsigned int maxKeyLength = 0;
+    bool vertical = false;
+    stream >> maxKeyLength;
+    stream >> vertical;
 
     Entries::size_type size = 0;
     stream >> size;
-    result.m_entries.reserve(size);
+
+    Entries entries;
+    entries.reserve(size);
     for (Entries::size_type i = 0; i < size; ++i)
     {
         Entry entry;
@@ -2628,10 +3454,10 @@ PDFFontCMap PDFFontCMap::deserialize(const QByteArray& byteArray)
         stream >> entry.to;
         stream >> entry.byteCount;
         stream >> entry.cid;
-        result.m_entries.push_back(entry);
+        entries.push_back(entry);
     }
 
-    return result;
+    return PDFFontCMap(qMove(entries), vertical);
 }
 
 std::vector<CID> PDFFontCMap::interpret(const QByteArray& byteArray) const
@@ -2648,8 +3474,8 @@ std::vector<CID> PDFFontCMap::interpret(const QByteArray& byteArray) const
         ++scannedBytes;
 
         // Find suitable mapping
-        auto it = std::find_if(m_entries.cbegin(), m_entries.cend(), [value, scannedBytes](const Entry& entry) { return entry.from <= value && entry.to >= value && entry.byteCount == scannedBytes; });
-        if (it != m_entries.cend())
+        auto it = std::find_if(m_entries.begin(), m_entries.end(), [value, scannedBytes](const Entry& entry) { return entry.from <= value && entry.to >= value && entry.byteCount == scannedBytes; });
+        if (it != m_entries.end())
         {
             const Entry& entry = *it;
             const CID cid = value - entry.from + entry.cid;
@@ -2703,8 +3529,8 @@ QChar PDFFontCMap::getToUnicode(CID cid) const
 {
     if (isValid())
     {
-        auto it = std::find_if(m_entries.cbegin(), m_entries.cend(), [cid](const Entry& entry) { return entry.from <= cid && entry.to >= cid; });
-        if (it != m_entries.cend())
+        auto it = std::find_if(m_entries.begin(), m_entries.end(), [cid](const Entry& entry) { return entry.from <= cid && entry.to >= cid; });
+        if (it != m_entries.end())
         {
             const Entry& entry = *it;
             const CID unicodeCID = cid - entry.from + entry.cid;
@@ -2739,11 +3565,22 @@ CID PDFFontCMap::getFromUnicode(QChar character) const
 }
 
 PDFFontCMap::PDFFontCMap(Entries&& entries, bool vertical) :
-    m_entries(qMove(entries)),
     m_maxKeyLength(0),
     m_vertical(vertical)
 {
-    m_maxKeyLength = std::accumulate(m_entries.cbegin(), m_entries.cend(), 0, [](unsigned int a, const Entry& b) { return qMax(a, b.byteCount); });
+    std::shared_ptr<const Entries> storage = std::make_shared<const Entries>(qMove(entries));
+    m_entries = std::span<const Entry>(storage->data(), storage->size());
+    m_storage = qMove(storage);
+    m_maxKeyLength = std::accumulate(m_entries.begin(), m_entries.end(), 0, [](unsigned int a, const Entry& b) { return qMax(a, b.byteCount); });
+}
+
+PDFFontCMap::PDFFontCMap(std::shared_ptr<const void> storage, std::span<const Entry> entries, unsigned int maxKeyLength, bool vertical) :
+    m_storage(qMove(storage)),
+    m_entries(entries),
+    m_maxKeyLength(maxKeyLength),
+    m_vertical(vertical)
+{
+
 }
 
 PDFFontCMap::Entries PDFFontCMap::optimize(const PDFFontCMap::Entries& entries)
@@ -2775,27 +3612,132 @@ PDFFontCMap::Entries PDFFontCMap::optimize(const PDFFontCMap::Entries& entries)
     return result;
 }
 
+/// Header of the compiled CMap repository file. File is a memory image - header
+/// is followed by the records and then by sorted entries of each CMap, so
+/// the entries can be searched in place in the mapped file.
+struct PDFFontCMapRepositoryHeader
+{
+    char magic[8];
+    quint32 byteOrderMark;
+    quint32 version;
+    quint32 count;
+    quint32 reserved;
+};
+
+/// Record of single CMap in the compiled CMap repository file
+struct PDFFontCMapRepositoryRecord
+{
+    char name[48];
+    quint32 offset;
+    quint32 count;
+    quint32 maxKeyLength;
+    quint32 vertical;
+};
+
+static constexpr const char CMAP_REPOSITORY_MAGIC[8] = { 'P', 'D', 'F', '4', 'Q', 'T', 'C', 'M' };
+static constexpr quint32 CMAP_REPOSITORY_BYTE_ORDER_MARK = 0x01020304;
+static constexpr quint32 CMAP_REPOSITORY_VERSION = 1;
+static constexpr const char* CMAP_REPOSITORY_FILE_NAME = "cmaps.bin";
+
 PDFFontCMapRepository* PDFFontCMapRepository::getInstance()
 {
     static PDFFontCMapRepository repository;
     return &repository;
 }
 
+PDFFontCMap PDFFontCMapRepository::getCMap(const QByteArray& name)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        auto it = m_cmaps.find(name);
+        if (it != m_cmaps.cend())
+        {
+            return it->second;
+        }
+    }
+
+    // Parse the CMap outside of the lock, because it can
+    // refer to other predefined CMaps using 'usecmap' operator.
+    PDFFontCMap cmap = PDFFontCMap::createFromResource(name);
+
+    QMutexLocker lock(&m_mutex);
+    return m_cmaps.try_emplace(name, qMove(cmap)).first->second;
+}
+
+void PDFFontCMapRepository::add(const QByteArray& key, PDFFontCMap value)
+{
+    QMutexLocker lock(&m_mutex);
+    m_cmaps.insert_or_assign(key, qMove(value));
+}
+
+void PDFFontCMapRepository::compile()
+{
+    QDir directory(":/cmaps");
+    const QStringList fileNames = directory.entryList(QDir::Files, QDir::Name);
+    for (const QString& fileName : fileNames)
+    {
+        getCMap(fileName.toLatin1());
+    }
+}
+
+void PDFFontCMapRepository::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_cmaps.clear();
+}
+
 void PDFFontCMapRepository::saveToFile(const QString& fileName) const
 {
+    static_assert(std::is_trivially_copyable_v<PDFFontCMap::Entry>, "Entry must be stored as plain memory image");
+    static_assert(sizeof(PDFFontCMapRepositoryHeader) % alignof(PDFFontCMap::Entry) == 0);
+    static_assert(sizeof(PDFFontCMapRepositoryRecord) % alignof(PDFFontCMap::Entry) == 0);
+
+    QMutexLocker lock(&m_mutex);
+
+    std::vector<PDFFontCMapRepositoryRecord> records;
+    std::vector<const PDFFontCMap*> cmaps;
+    records.reserve(m_cmaps.size());
+    cmaps.reserve(m_cmaps.size());
+
+    for (const auto& item : m_cmaps)
+    {
+        PDFFontCMapRepositoryRecord record = { };
+        if (size_t(item.first.size()) >= sizeof(record.name))
+        {
+            // Name is too long, CMap can't be stored
+            continue;
+        }
+
+        std::copy(item.first.cbegin(), item.first.cend(), record.name);
+        record.count = quint32(item.second.m_entries.size());
+        record.maxKeyLength = item.second.m_maxKeyLength;
+        record.vertical = item.second.m_vertical ? 1 : 0;
+        records.push_back(record);
+        cmaps.push_back(&item.second);
+    }
+
+    quint32 offset = quint32(sizeof(PDFFontCMapRepositoryHeader) + records.size() * sizeof(PDFFontCMapRepositoryRecord));
+    for (PDFFontCMapRepositoryRecord& record : records)
+    {
+        record.offset = offset;
+        offset += record.count * quint32(sizeof(PDFFontCMap::Entry));
+    }
+
+    PDFFontCMapRepositoryHeader header = { };
+    std::copy(std::begin(CMAP_REPOSITORY_MAGIC), std::end(CMAP_REPOSITORY_MAGIC), header.magic);
+    header.byteOrderMark = CMAP_REPOSITORY_BYTE_ORDER_MARK;
+    header.version = CMAP_REPOSITORY_VERSION;
+    header.count = quint32(records.size());
+
     QFile file(fileName);
     if (file.open(QFile::WriteOnly | QFile::Truncate))
     {
-        size_t size = m_cmaps.size();
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(PDFFontCMapRepositoryRecord));
 
+        for (const PDFFontCMap* cmap : cmaps)
         {
-            QDataStream stream(&file);
-            stream << size;
-            for (const auto& item : m_cmaps)
-            {
-                stream << item.first;
-                stream << item.second;
-            }
+            file.write(reinterpret_cast<const char*>(cmap->m_entries.data()), cmap->m_entries.size_bytes());
         }
 
         file.close();
@@ -2804,33 +3746,69 @@ void PDFFontCMapRepository::saveToFile(const QString& fileName) const
 
 bool PDFFontCMapRepository::loadFromFile(const QString& fileName)
 {
-    QFile file(fileName);
-    if (file.open(QFile::ReadOnly))
+    std::shared_ptr<QFile> file = std::make_shared<QFile>(fileName);
+    if (!file->open(QFile::ReadOnly))
+    {
+        return false;
+    }
+
+    const qint64 size = file->size();
+    if (size < qint64(sizeof(PDFFontCMapRepositoryHeader)))
+    {
+        return false;
+    }
+
+    // Mapping remains valid as long as the file object exists, it is
+    // owned by all CMaps, which search their entries in the mapped memory.
+    const uchar* data = file->map(0, size);
+    if (!data)
+    {
+        return false;
+    }
+
+    const PDFFontCMapRepositoryHeader* header = reinterpret_cast<const PDFFontCMapRepositoryHeader*>(data);
+    if (!std::equal(std::begin(CMAP_REPOSITORY_MAGIC), std::end(CMAP_REPOSITORY_MAGIC), header->magic) ||
+        header->byteOrderMark != CMAP_REPOSITORY_BYTE_ORDER_MARK ||
+        header->version != CMAP_REPOSITORY_VERSION ||
+        qint64(sizeof(PDFFontCMapRepositoryHeader)) + qint64(header->count) * qint64(sizeof(PDFFontCMapRepositoryRecord)) > size)
+    {
+        return false;
+    }
+
+    const PDFFontCMapRepositoryRecord* records = reinterpret_cast<const PDFFontCMapRepositoryRecord*>(data + sizeof(PDFFontCMapRepositoryHeader));
+
+    std::map<QByteArray, PDFFontCMap> cmaps;
+    for (quint32 i = 0; i < header->count; ++i)
     {
+        const PDFFontCMapRepositoryRecord& record = records[i];
+        if (record.offset % alignof(PDFFontCMap::Entry) != 0 ||
+            qint64(record.offset) + qint64(record.count) * qint64(sizeof(PDFFontCMap::Entry)) > size)
         {
-            QDataStream stream(&file);
-            size_t size = 0;
-            stream >> size;
-            for (size_t i = 0; i < size; ++i)
-            {
-                QByteArray key;
-                QByteArray value;
-                stream >> key;
-                stream >> value;
-                m_cmaps[qMove(key)] = qMove(value);
-            }
+            return false;
         }
 
-        file.close();
-        return true;
+        QByteArray name(record.name, int(qstrnlen(record.name, sizeof(record.name))));
+        std::span<const PDFFontCMap::Entry> entries(reinterpret_cast<const PDFFontCMap::Entry*>(data + record.offset), record.count);
+        cmaps.insert_or_assign(qMove(name), PDFFontCMap(file, entries, record.maxKeyLength, record.vertical != 0));
+    }
+
+    QMutexLocker lock(&m_mutex);
+    for (auto& item : cmaps)
+    {
+        m_cmaps.insert_or_assign(item.first, qMove(item.second));
     }
 
-    return false;
+    return true;
 }
 
 PDFFontCMapRepository::PDFFontCMapRepository()
 {
-
+    // Use compiled repository, if it is deployed with the application,
+    // otherwise CMaps are parsed from the resources on demand.
+    if (QCoreApplication::instance())
+    {
+        loadFromFile(QCoreApplication::applicationDirPath() + "/" + CMAP_REPOSITORY_FILE_NAME);
+    }
 }
 
 PDFReal PDFType0Font::getGlyphAdvance(CID cid) const
@@ -2900,6 +3878,26 @@ const QByteArray* PDFType3Font::getContentStream(int characterIndex) const
     return nullptr;
 }
 
+std::shared_ptr<const PDFCompiledContentStream> PDFType3Font::getCompiledContentStream(const QByteArray* contentStream,
+                                                                                     const std::function<std::shared_ptr<const PDFCompiledContentStream>()>& compile) const
+{
+    {
+        QMutexLocker lock(&m_compiledContentStreamsMutex);
+        auto it = m_compiledContentStreams.find(contentStream);
+        if (it != m_compiledContentStreams.cend())
+        {
+            return it->second;
+        }
+    }
+
+    // Compile the content stream outside the lock, so other
+    // glyphs can be used by other threads in the meantime.
+    std::shared_ptr<const PDFCompiledContentStream> compiledContentStream = compile();
+
+    QMutexLocker lock(&m_compiledContentStreamsMutex);
+    return m_compiledContentStreams.try_emplace(contentStream, qMove(compiledContentStream)).first->second;
+}
+
 void PDFRealizedType3FontImpl::fillTextSequence(const QByteArray& byteArray, TextSequence& textSequence, PDFRenderErrorReporter* reporter)
 {
     Q_ASSERT(dynamic_cast<const PDFType3Font*>(m_parentFont.get()));
@@ -26,14 +26,24 @@
 #include "pdfglobal.h"
 #include "pdfencoding.h"
 #include "pdfobject.h"
+#include "pdfglyphatlas.h"
+#include "pdfmemoryreport.h"
 
 #include <QFont>
 #include <QMutex>
 #include <QTransform>
 #include <QSharedPointer>
+#include <QReadWriteLock>
 
 #include <set>
+#include <map>
+#include <span>
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <functional>
 #include <unordered_map>
+#include <memory_resource>
 
 class QPainterPath;
 
@@ -43,6 +53,7 @@ class PDFDocument;
 class PDFModifiedDocument;
 class PDFRenderErrorReporter;
 class PDFFontCMap;
+struct PDFCompiledContentStream;
 
 using CID = unsigned int;
 using GID = unsigned int;
@@ -93,7 +104,10 @@ struct TextSequenceItem
 
 struct TextSequence
 {
-    std::vector<TextSequenceItem> items;
+    TextSequence() = default;
+    explicit TextSequence(std::pmr::memory_resource* resource) : items(resource) { }
+
+    std::pmr::vector<TextSequenceItem> items;
 };
 
 constexpr bool isTextRenderingModeFilled(TextRenderingMode mode)
@@ -249,6 +263,7 @@ using PDFFontPointer = QSharedPointer<PDFFont>;
 
 class PDFRealizedFont;
 class IRealizedFontImpl;
+class PDFGlyphOutlineCache;
 
 using PDFRealizedFontPointer = QSharedPointer<PDFRealizedFont>;
 
@@ -285,6 +300,14 @@ public:
     /// Returns character info
     CharacterInfos getCharacterInfos() const;
 
+    /// Returns atlas of glyph coverage masks, or nullptr, if glyphs
+    /// of this font can't be drawn using glyph atlas (Type 3 fonts)
+    const PDFGlyphAtlasPointer& getGlyphAtlas() const { return m_glyphAtlas; }
+
+    /// Returns estimate of memory (in bytes) consumed by cached glyphs
+    /// of the font (outlines and coverage masks of the glyph atlas)
+    qint64 getMemoryConsumptionEstimate() const;
+
     /// Creates new realized font from the standard font. If font can't be created,
     /// then exception is thrown.
     static PDFRealizedFontPointer createRealizedFont(PDFFontPointer font, PDFReal pixelSize, PDFRenderErrorReporter* reporter);
@@ -294,6 +317,7 @@ private:
     explicit PDFRealizedFont(IRealizedFontImpl* impl) : m_impl(impl) { }
 
     IRealizedFontImpl* m_impl;
+    PDFGlyphAtlasPointer m_glyphAtlas;
 };
 
 struct PDFEncodedText
@@ -350,10 +374,17 @@ public:
     /// Encodes text into font encoding
     virtual PDFEncodedText encodeText(const QString& text) const;
 
+    /// Returns cache of glyph outlines, which is shared by all realized
+    /// fonts of this font (regardless of their pixel size)
+    const std::shared_ptr<PDFGlyphOutlineCache>& getGlyphOutlineCache() const { return m_glyphOutlineCache; }
+
 protected:
     CIDSystemInfo m_CIDSystemInfo;
     FontDescriptor m_fontDescriptor;
     QByteArray m_fontId;
+
+private:
+    std::shared_ptr<PDFGlyphOutlineCache> m_glyphOutlineCache;
 };
 
 /// Simple font, see PDF reference 1.7, chapter 5.5. Simple fonts have encoding table,
@@ -438,9 +469,24 @@ public:
     virtual FontType getFontType() const override;
 };
 
+/// Statistics of the font cache
+struct PDFFontCacheStatistics
+{
+    qint64 fontHits = 0;            ///< Count of fonts taken from the cache
+    qint64 fontMisses = 0;          ///< Count of fonts, which were created
+    qint64 realizedFontHits = 0;    ///< Count of realized fonts taken from the cache
+    qint64 realizedFontMisses = 0;  ///< Count of realized fonts, which were created
+    qint64 contentions = 0;         ///< Count of lookups, which had to wait for a lock held by another thread
+    qint64 fontCount = 0;           ///< Count of fonts in the cache
+    qint64 realizedFontCount = 0;   ///< Count of realized fonts in the cache
+};
+
 /// Font cache which caches both fonts, and realized fonts. Cache has individual limit
-/// for fonts, and realized fonts.
-class PDF4QTLIBCORESHARED_EXPORT PDFFontCache
+/// for fonts, and realized fonts. Cache is divided into shards, each protected by its
+/// own read/write lock, so lookups of fonts already in the cache from multiple threads
+/// take only shared locks. Each font is created only once, by the first thread,
+/// which requests it, and other threads requesting the same font wait for it.
+class PDF4QTLIBCORESHARED_EXPORT PDFFontCache : public PDFMemoryAccountable
 {
 public:
     inline explicit PDFFontCache(size_t fontCacheLimit, size_t realizedFontCacheLimit) :
@@ -484,13 +530,74 @@ public:
     /// If shrinking is enabled, then erase font, if cache limit is exceeded.
     void shrink();
 
+    /// Returns statistics of the cache
+    PDFFontCacheStatistics getStatistics() const;
+
+    /// Adds consumed memory of fonts and realized fonts into the report.
+    /// Embedded font programs are counted in fonts, cached glyphs in realized fonts.
+    /// \param report Report
+    virtual void collectMemoryUsage(PDFMemoryReport* report) const override;
+
 private:
+    static constexpr size_t SHARD_COUNT = 16;
+
+    using RealizedFontKey = std::pair<PDFFontPointer, PDFReal>;
+
+    /// Cache entry, value is created only once using the flag
+    template<typename Value>
+    struct Entry
+    {
+        std::once_flag flag;
+        std::atomic_bool isCreated = false;
+        Value value;
+    };
+
+    /// Part of the cache protected by its own lock
+    template<typename Key, typename Value>
+    struct Shard
+    {
+        mutable QReadWriteLock lock;
+        std::map<Key, std::shared_ptr<Entry<Value>>> entries;
+    };
+
+    template<typename Key, typename Value>
+    using Shards = std::array<Shard<Key, Value>, SHARD_COUNT>;
+
+    /// Finds value in the cache, or creates it, if it is not present
+    /// \param shards Shards of the cache
+    /// \param key Key of the value
+    /// \param count Count of values in the cache
+    /// \param limit Limit of count of values in the cache
+    /// \param hits Hit counter
+    /// \param misses Miss counter
+    /// \param create Function, which creates the value
+    template<typename Key, typename Value, typename Create>
+    Value getOrCreate(Shards<Key, Value>& shards,
+                      const Key& key,
+                      std::atomic<qint64>& count,
+                      size_t limit,
+                      std::atomic<qint64>& hits,
+                      std::atomic<qint64>& misses,
+                      Create create) const;
+
+    /// Clears all shards, if shrinking is enabled and count exceeds the limit. If
+    /// \p force is true, shards are cleared regardless of shrinking and limit.
+    template<typename Key, typename Value>
+    void clearShards(Shards<Key, Value>& shards, std::atomic<qint64>& count, size_t limit, bool force) const;
+
+    mutable QMutex m_mutex;
     size_t m_fontCacheLimit;
     size_t m_realizedFontCacheLimit;
-    mutable QMutex m_mutex;
     const PDFDocument* m_document;
-    mutable std::map<PDFObjectReference, PDFFontPointer> m_fontCache;
-    mutable std::map<std::pair<PDFFontPointer, PDFReal>, PDFRealizedFontPointer> m_realizedFontCache;
+    mutable Shards<PDFObjectReference, PDFFontPointer> m_fontCache;
+    mutable Shards<RealizedFontKey, PDFRealizedFontPointer> m_realizedFontCache;
+    mutable std::atomic<qint64> m_fontCount = 0;
+    mutable std::atomic<qint64> m_realizedFontCount = 0;
+    mutable std::atomic<qint64> m_fontHits = 0;
+    mutable std::atomic<qint64> m_fontMisses = 0;
+    mutable std::atomic<qint64> m_realizedFontHits = 0;
+    mutable std::atomic<qint64> m_realizedFontMisses = 0;
+    mutable std::atomic<qint64> m_contentions = 0;
     mutable std::set<const void*> m_fontCacheShrinkDisabledObjects;
 };
 
@@ -584,6 +691,10 @@ public:
     CID getFromUnicode(QChar character) const;
 
 private:
+    friend class PDFFontCMapRepository;
+
+    /// Creates mapping from predefined CMap stored in the resources
+    static PDFFontCMap createFromResource(const QByteArray& name);
 
     struct Entry
     {
@@ -619,11 +730,17 @@ private:
 
     explicit PDFFontCMap(Entries&& entries, bool vertical);
 
+    /// Creates mapping, whose entries are searched in place in the storage,
+    /// which is owned by someone else (for example, memory mapped file).
+    explicit PDFFontCMap(std::shared_ptr<const void> storage, std::span<const Entry> entries, unsigned int maxKeyLength, bool vertical);
+
     /// Optimizes the entries - merges entries, which can be merged. This function
     /// requires, that entries are sorted.
     static Entries optimize(const Entries& entries);
 
-    Entries m_entries;
+    /// Storage of the entries, it is shared between copies of the mapping
+    std::shared_ptr<const void> m_storage;
+    std::span<const Entry> m_entries;
     unsigned int m_maxKeyLength = 0;
     bool m_vertical = false;
 };
@@ -652,6 +769,15 @@ public:
     /// is returned.
     const QByteArray* getContentStream(int characterIndex) const;
 
+    /// Returns compiled content stream of the character. Content stream is compiled only once
+    /// using \p compile function, and compiled content stream is shared by all pages. Compiled
+    /// content stream doesn't depend on the graphic state, so it can be used for colored and
+    /// uncolored glyphs regardless of the current fill color.
+    /// \param contentStream Content stream of the character (see \p getContentStream)
+    /// \param compile Function, which compiles the content stream
+    std::shared_ptr<const PDFCompiledContentStream> getCompiledContentStream(const QByteArray* contentStream,
+                                                                             const std::function<std::shared_ptr<const PDFCompiledContentStream>()>& compile) const;
+
     const QTransform& getFontMatrix() const { return m_fontMatrix; }
     const PDFObject& getResources() const { return m_resources; }
     const std::map<int, QByteArray>& getContentStreams() const { return m_characterContentStreams; }
@@ -668,6 +794,9 @@ private:
     std::vector<double> m_widths;
     PDFObject m_resources;
     PDFFontCMap m_toUnicode;
+
+    mutable QMutex m_compiledContentStreamsMutex;
+    mutable std::map<const QByteArray*, std::shared_ptr<const PDFCompiledContentStream>> m_compiledContentStreams;
 };
 
 /// Composite font (CID-keyed font)
@@ -720,23 +849,37 @@ public:
     /// Returns instance of CMAP repository
     static PDFFontCMapRepository* getInstance();
 
+    /// Returns predefined CMAP with given name. Each CMAP is parsed at most once
+    /// per process and its entries are shared by all fonts using it. If compiled
+    /// repository was loaded, entries are searched in place in the mapped file.
+    /// If CMAP doesn't exist, exception is thrown.
+    /// \param name Name of the predefined CMAP
+    PDFFontCMap getCMap(const QByteArray& name);
+
     /// Adds CMAP to the repository
-    void add(const QByteArray& key, QByteArray value) { m_cmaps[key] = qMove(value); }
+    void add(const QByteArray& key, PDFFontCMap value);
+
+    /// Parses all predefined CMAPs from the resources and adds them
+    /// to the repository, so they can be saved to the compiled file.
+    void compile();
 
     /// Clears the repository
-    void clear() { m_cmaps.clear(); }
+    void clear();
 
-    /// Saves the repository content to the file
+    /// Saves the repository content to the file as compiled binary image
+    /// of sorted ranges, which can be memory mapped by \p loadFromFile.
     void saveToFile(const QString& fileName) const;
 
-    /// Loads the repository content from the file
+    /// Memory maps compiled repository content from the file. Returns
+    /// false, if file doesn't exist or it is not valid compiled repository.
     bool loadFromFile(const QString& fileName);
 
 private:
     explicit PDFFontCMapRepository();
 
     /// Storage for predefined cmaps
-    std::map<QByteArray, QByteArray> m_cmaps;
+    mutable QMutex m_mutex;
+    std::map<QByteArray, PDFFontCMap> m_cmaps;
 };
 
 class PDF4QTLIBCORESHARED_EXPORT PDFSystemFont
@@ -0,0 +1,1037 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pdffontsubsetter.h"
+
+#include <QCryptographicHash>
+
+#include "pdfdbgheap.h"
+
+#include <map>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+
+namespace pdf
+{
+
+namespace
+{
+
+constexpr uint32_t makeTag(char a, char b, char c, char d)
+{
+    return (uint32_t(uint8_t(a)) << 24) | (uint32_t(uint8_t(b)) << 16) | (uint32_t(uint8_t(c)) << 8) | uint32_t(uint8_t(d));
+}
+
+constexpr uint32_t TAG_HEAD = makeTag('h', 'e', 'a', 'd');
+constexpr uint32_t TAG_MAXP = makeTag('m', 'a', 'x', 'p');
+constexpr uint32_t TAG_LOCA = makeTag('l', 'o', 'c', 'a');
+constexpr uint32_t TAG_GLYF = makeTag('g', 'l', 'y', 'f');
+constexpr uint32_t TRUETYPE_VERSION = 0x00010000;
+constexpr uint32_t TRUETYPE_VERSION_APPLE = makeTag('t', 'r', 'u', 'e');
+
+/// Tables, which are not used, when font is used in PDF. Layout tables are not
+/// used, because PDF content stream contains already positioned glyphs, bitmaps
+/// are not used, because glyphs are rendered from outlines, and digital signature
+/// becomes invalid, when font is changed.
+constexpr std::array REMOVED_TABLES = {
+    makeTag('D', 'S', 'I', 'G'),
+    makeTag('G', 'S', 'U', 'B'),
+    makeTag('G', 'P', 'O', 'S'),
+    makeTag('G', 'D', 'E', 'F'),
+    makeTag('B', 'A', 'S', 'E'),
+    makeTag('J', 'S', 'T', 'F'),
+    makeTag('M', 'A', 'T', 'H'),
+    makeTag('m', 'o', 'r', 't'),
+    makeTag('m', 'o', 'r', 'x'),
+    makeTag('k', 'e', 'r', 'n'),
+    makeTag('k', 'e', 'r', 'x'),
+    makeTag('h', 'd', 'm', 'x'),
+    makeTag('L', 'T', 'S', 'H'),
+    makeTag('V', 'D', 'M', 'X'),
+    makeTag('E', 'B', 'D', 'T'),
+    makeTag('E', 'B', 'L', 'C'),
+    makeTag('E', 'B', 'S', 'C'),
+    makeTag('C', 'B', 'D', 'T'),
+    makeTag('C', 'B', 'L', 'C'),
+    makeTag('s', 'b', 'i', 'x')
+};
+
+// Composite glyph flags
+constexpr uint16_t ARG_1_AND_2_ARE_WORDS = 0x0001;
+constexpr uint16_t WE_HAVE_A_SCALE = 0x0008;
+constexpr uint16_t MORE_COMPONENTS = 0x0020;
+constexpr uint16_t WE_HAVE_AN_X_AND_Y_SCALE = 0x0040;
+constexpr uint16_t WE_HAVE_A_TWO_BY_TWO = 0x0080;
+
+// CFF dictionary operators
+constexpr int CFF_OPERATOR_ESCAPE = 12;
+constexpr int CFF_OPERATOR_CHARSET = 15;
+constexpr int CFF_OPERATOR_ENCODING = 16;
+constexpr int CFF_OPERATOR_CHARSTRINGS = 17;
+constexpr int CFF_OPERATOR_PRIVATE = 18;
+constexpr int CFF_OPERATOR_SUBRS = 19;
+constexpr int CFF_OPERATOR_CHARSTRING_TYPE = 1206;
+constexpr int CFF_OPERATOR_ROS = 1230;
+constexpr int CFF_OPERATOR_FDARRAY = 1236;
+constexpr int CFF_OPERATOR_FDSELECT = 1237;
+constexpr char CFF_CHARSTRING_ENDCHAR = 14;
+
+inline uint16_t readUInt16(const QByteArray& data, qsizetype offset)
+{
+    return static_cast<uint16_t>((uint8_t(data[offset]) << 8) | uint8_t(data[offset + 1]));
+}
+
+inline uint32_t readUInt32(const QByteArray& data, qsizetype offset)
+{
+    return (uint32_t(uint8_t(data[offset])) << 24) | (uint32_t(uint8_t(data[offset + 1])) << 16) |
+           (uint32_t(uint8_t(data[offset + 2])) << 8) | uint32_t(uint8_t(data[offset + 3]));
+}
+
+inline uint32_t readOffset(const QByteArray& data, qsizetype offset, int offsetSize)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < offsetSize; ++i)
+    {
+        value = (value << 8) | uint8_t(data[offset + i]);
+    }
+    return value;
+}
+
+inline void writeUInt16(QByteArray& data, qsizetype offset, uint16_t value)
+{
+    data[offset] = char(value >> 8);
+    data[offset + 1] = char(value);
+}
+
+inline void writeUInt32(QByteArray& data, qsizetype offset, uint32_t value)
+{
+    data[offset] = char(value >> 24);
+    data[offset + 1] = char(value >> 16);
+    data[offset + 2] = char(value >> 8);
+    data[offset + 3] = char(value);
+}
+
+inline void appendUInt16(QByteArray& data, uint16_t value)
+{
+    data.append(char(value >> 8));
+    data.append(char(value));
+}
+
+inline void appendUInt32(QByteArray& data, uint32_t value)
+{
+    data.append(char(value >> 24));
+    data.append(char(value >> 16));
+    data.append(char(value >> 8));
+    data.append(char(value));
+}
+
+inline void alignToFourBytes(QByteArray& data)
+{
+    while (data.size() % 4 != 0)
+    {
+        data.append(char(0));
+    }
+}
+
+uint32_t calculateTableChecksum(const QByteArray& data, qsizetype offset, qsizetype length)
+{
+    uint32_t checksum = 0;
+    const qsizetype end = offset + length;
+    for (qsizetype i = offset; i < end; i += 4)
+    {
+        uint32_t value = 0;
+        for (qsizetype j = 0; j < 4; ++j)
+        {
+            value = (value << 8) | (i + j < end ? uint8_t(data[i + j]) : 0);
+        }
+        checksum += value;
+    }
+    return checksum;
+}
+
+using SfntTables = std::map<uint32_t, QByteArray>;
+
+bool readSfntTables(const QByteArray& fontData, uint32_t& sfntVersion, SfntTables& tables)
+{
+    if (fontData.size() < 12)
+    {
+        return false;
+    }
+
+    sfntVersion = readUInt32(fontData, 0);
+    const uint16_t numTables = readUInt16(fontData, 4);
+    if (fontData.size() < 12 + 16 * qsizetype(numTables))
+    {
+        return false;
+    }
+
+    for (uint16_t i = 0; i < numTables; ++i)
+    {
+        const qsizetype recordOffset = 12 + 16 * qsizetype(i);
+        const uint32_t tag = readUInt32(fontData, recordOffset);
+        const qsizetype offset = readUInt32(fontData, recordOffset + 8);
+        const qsizetype length = readUInt32(fontData, recordOffset + 12);
+
+        if (offset + length > fontData.size() || tables.count(tag))
+        {
+            return false;
+        }
+
+        tables[tag] = fontData.mid(offset, length);
+    }
+
+    return true;
+}
+
+QByteArray writeSfntTables(uint32_t sfntVersion, const SfntTables& tables)
+{
+    const uint16_t numTables = uint16_t(tables.size());
+
+    uint16_t entrySelector = 0;
+    while ((2u << entrySelector) <= numTables)
+    {
+        ++entrySelector;
+    }
+    const uint16_t searchRange = uint16_t((1u << entrySelector) * 16);
+    const uint16_t rangeShift = uint16_t(numTables * 16 - searchRange);
+
+    QByteArray result;
+    appendUInt32(result, sfntVersion);
+    appendUInt16(result, numTables);
+    appendUInt16(result, searchRange);
+    appendUInt16(result, entrySelector);
+    appendUInt16(result, rangeShift);
+
+    const qsizetype recordsOffset = result.size();
+    result.append(16 * qsizetype(numTables), char(0));
+
+    qsizetype headOffset = -1;
+    qsizetype recordOffset = recordsOffset;
+
+    // Map is sorted by tag, as required by specification
+    for (const auto& table : tables)
+    {
+        const qsizetype offset = result.size();
+        result.append(table.second);
+        alignToFourBytes(result);
+
+        if (table.first == TAG_HEAD)
+        {
+            headOffset = offset;
+        }
+
+        writeUInt32(result, recordOffset, table.first);
+        writeUInt32(result, recordOffset + 4, calculateTableChecksum(result, offset, table.second.size()));
+        writeUInt32(result, recordOffset + 8, uint32_t(offset));
+        writeUInt32(result, recordOffset + 12, uint32_t(table.second.size()));
+        recordOffset += 16;
+    }
+
+    if (headOffset != -1)
+    {
+        // Checksum adjustment is calculated with zero adjustment in the head table
+        const uint32_t checksum = calculateTableChecksum(result, 0, result.size());
+        writeUInt32(result, headOffset + 8, 0xB1B0AFBA - checksum);
+    }
+
+    return result;
+}
+
+/// Index structure of the CFF font. Items are ranges of data in the font program.
+struct CFFIndex
+{
+    qsizetype begin = 0;
+    qsizetype end = 0;
+    std::vector<std::pair<qsizetype, qsizetype>> items;
+};
+
+bool readCFFIndex(const QByteArray& data, qsizetype offset, CFFIndex& index)
+{
+    if (offset < 0 || offset + 2 > data.size())
+    {
+        return false;
+    }
+
+    index.begin = offset;
+    index.items.clear();
+
+    const uint16_t count = readUInt16(data, offset);
+    if (count == 0)
+    {
+        index.end = offset + 2;
+        return true;
+    }
+
+    if (offset + 3 > data.size())
+    {
+        return false;
+    }
+
+    const int offsetSize = uint8_t(data[offset + 2]);
+    if (offsetSize < 1 || offsetSize > 4)
+    {
+        return false;
+    }
+
+    const qsizetype offsetArray = offset + 3;
+    const qsizetype dataStart = offsetArray + (qsizetype(count) + 1) * offsetSize - 1;
+    if (dataStart + 1 > data.size())
+    {
+        return false;
+    }
+
+    index.items.reserve(count);
+    qsizetype previousOffset = readOffset(data, offsetArray, offsetSize);
+    if (previousOffset != 1)
+    {
+        return false;
+    }
+
+    for (uint16_t i = 1; i <= count; ++i)
+    {
+        const qsizetype currentOffset = readOffset(data, offsetArray + i * offsetSize, offsetSize);
+        if (currentOffset < previousOffset || dataStart + currentOffset > data.size())
+        {
+            return false;
+        }
+
+        index.items.emplace_back(dataStart + previousOffset, dataStart + currentOffset);
+        previousOffset = currentOffset;
+    }
+
+    index.end = dataStart + previousOffset;
+    return true;
+}
+
+QByteArray writeCFFIndex(const std::vector<QByteArray>& items)
+{
+    QByteArray result;
+    appendUInt16(result, uint16_t(items.size()));
+
+    if (items.empty())
+    {
+        return result;
+    }
+
+    qsizetype dataSize = 0;
+    for (const QByteArray& item : items)
+    {
+        dataSize += item.size();
+    }
+
+    int offsetSize = 1;
+    while (offsetSize < 4 && (dataSize + 1) >> (8 * offsetSize))
+    {
+        ++offsetSize;
+    }
+
+    result.append(char(offsetSize));
+
+    qsizetype offset = 1;
+    auto appendOffset = [&result, offsetSize](qsizetype value)
+    {
+        for (int i = offsetSize - 1; i >= 0; --i)
+        {
+            result.append(char(value >> (8 * i)));
+        }
+    };
+
+    appendOffset(offset);
+    for (const QByteArray& item : items)
+    {
+        offset += item.size();
+        appendOffset(offset);
+    }
+
+    for (const QByteArray& item : items)
+    {
+        result.append(item);
+    }
+
+    return result;
+}
+
+/// Entry of CFF dictionary. Operands are stored as raw data (so they can be
+/// written back unchanged), integer operands are also parsed.
+struct CFFDictionaryEntry
+{
+    int op = 0;
+    QByteArray operandData;
+    std::vector<int64_t> operands;
+};
+
+using CFFDictionary = std::vector<CFFDictionaryEntry>;
+
+bool readCFFDictionary(const QByteArray& data, qsizetype begin, qsizetype end, CFFDictionary& dictionary)
+{
+    if (begin < 0 || end > data.size() || begin > end)
+    {
+        return false;
+    }
+
+    dictionary.clear();
+
+    qsizetype position = begin;
+    qsizetype operandStart = begin;
+    std::vector<int64_t> operands;
+
+    while (position < end)
+    {
+        const uint8_t b0 = uint8_t(data[position]);
+
+        if (b0 <= 21)
+        {
+            int op = b0;
+            const qsizetype operatorPosition = position;
+            if (b0 == CFF_OPERATOR_ESCAPE)
+            {
+                if (position + 1 >= end)
+                {
+                    return false;
+                }
+                op = 1200 + uint8_t(data[position + 1]);
+                position += 2;
+            }
+            else
+            {
+                position += 1;
+            }
+
+            CFFDictionaryEntry entry;
+            entry.op = op;
+            entry.operandData = data.mid(operandStart, operatorPosition - operandStart);
+            entry.operands = qMove(operands);
+            dictionary.emplace_back(qMove(entry));
+
+            operands.clear();
+            operandStart = position;
+        }
+        else if (b0 == 28)
+        {
+            if (position + 3 > end)
+            {
+                return false;
+            }
+            operands.push_back(int16_t(readUInt16(data, position + 1)));
+            position += 3;
+        }
+        else if (b0 == 29)
+        {
+            if (position + 5 > end)
+            {
+                return false;
+            }
+            operands.push_back(int32_t(readUInt32(data, position + 1)));
+            position += 5;
+        }
+        else if (b0 == 30)
+        {
+            // Real number, we do not need its value, only skip it
+            ++position;
+            bool finished = false;
+            while (!finished && position < end)
+            {
+                const uint8_t value = uint8_t(data[position++]);
+                finished = (value >> 4) == 0x0F || (value & 0x0F) == 0x0F;
+            }
+
+            if (!finished)
+            {
+                return false;
+            }
+            operands.push_back(0);
+        }
+        else if (b0 >= 32 && b0 <= 246)
+        {
+            operands.push_back(int64_t(b0) - 139);
+            position += 1;
+        }
+        else if (b0 >= 247 && b0 <= 250)
+        {
+            if (position + 2 > end)
+            {
+                return false;
+            }
+            operands.push_back((int64_t(b0) - 247) * 256 + uint8_t(data[position + 1]) + 108);
+            position += 2;
+        }
+        else if (b0 >= 251 && b0 <= 254)
+        {
+            if (position + 2 > end)
+            {
+                return false;
+            }
+            operands.push_back(-(int64_t(b0) - 251) * 256 - uint8_t(data[position + 1]) - 108);
+            position += 2;
+        }
+        else
+        {
+            // Reserved value
+            return false;
+        }
+    }
+
+    // Operands without operator are not allowed
+    return operandStart == end;
+}
+
+const CFFDictionaryEntry* findCFFDictionaryEntry(const CFFDictionary& dictionary, int op)
+{
+    auto it = std::find_if(dictionary.cbegin(), dictionary.cend(), [op](const CFFDictionaryEntry& entry) { return entry.op == op; });
+    return it != dictionary.cend() ? &*it : nullptr;
+}
+
+/// Writes CFF dictionary. Operands of operators from \p rewrittenOperands are replaced
+/// by given values, encoded as 5 byte integers, so size of the dictionary doesn't depend
+/// on the values (and offsets can be calculated before values are known).
+QByteArray writeCFFDictionary(const CFFDictionary& dictionary, const std::map<int, std::vector<int64_t>>& rewrittenOperands)
+{
+    QByteArray result;
+
+    for (const CFFDictionaryEntry& entry : dictionary)
+    {
+        auto it = rewrittenOperands.find(entry.op);
+        if (it != rewrittenOperands.cend())
+        {
+            for (int64_t value : it->second)
+            {
+                result.append(char(29));
+                appendUInt32(result, uint32_t(int32_t(value)));
+            }
+        }
+        else
+        {
+            result.append(entry.operandData);
+        }
+
+        if (entry.op >= 1200)
+        {
+            result.append(char(CFF_OPERATOR_ESCAPE));
+            result.append(char(entry.op - 1200));
+        }
+        else
+        {
+            result.append(char(entry.op));
+        }
+    }
+
+    return result;
+}
+
+}   // namespace
+
+QByteArray PDFFontSubsetter::createTrueTypeSubset(const QByteArray& fontData, const std::set<GID>& glyphs)
+{
+    uint32_t sfntVersion = 0;
+    SfntTables tables;
+    if (!readSfntTables(fontData, sfntVersion, tables))
+    {
+        return QByteArray();
+    }
+
+    if (sfntVersion != TRUETYPE_VERSION && sfntVersion != TRUETYPE_VERSION_APPLE)
+    {
+        // Font collections and CFF based OpenType fonts are not supported
+        return QByteArray();
+    }
+
+    if (!tables.count(TAG_HEAD) || !tables.count(TAG_MAXP) || !tables.count(TAG_LOCA) || !tables.count(TAG_GLYF))
+    {
+        return QByteArray();
+    }
+
+    QByteArray& head = tables[TAG_HEAD];
+    const QByteArray& maxp = tables[TAG_MAXP];
+    const QByteArray& loca = tables[TAG_LOCA];
+    const QByteArray& glyf = tables[TAG_GLYF];
+
+    if (head.size() < 54 || maxp.size() < 6)
+    {
+        return QByteArray();
+    }
+
+    const GID glyphCount = readUInt16(maxp, 4);
+    const int16_t indexToLocFormat = int16_t(readUInt16(head, 50));
+    if (glyphCount == 0 || (indexToLocFormat != 0 && indexToLocFormat != 1))
+    {
+        return QByteArray();
+    }
+
+    const bool isLongFormat = indexToLocFormat == 1;
+    if (loca.size() < (qsizetype(glyphCount) + 1) * (isLongFormat ? 4 : 2))
+    {
+        return QByteArray();
+    }
+
+    auto getGlyphOffset = [&loca, isLongFormat](GID glyph) -> qsizetype
+    {
+        return isLongFormat ? qsizetype(readUInt32(loca, qsizetype(glyph) * 4)) : qsizetype(readUInt16(loca, qsizetype(glyph) * 2)) * 2;
+    };
+
+    for (GID glyph = 0; glyph < glyphCount; ++glyph)
+    {
+        const qsizetype begin = getGlyphOffset(glyph);
+        const qsizetype end = getGlyphOffset(glyph + 1);
+        if (begin > end || end > glyf.size())
+        {
+            return QByteArray();
+        }
+    }
+
+    // Find used glyphs, including components of composite glyphs
+    std::vector<bool> isGlyphUsed(glyphCount, false);
+    std::vector<GID> glyphStack = { 0 };
+    for (GID glyph : glyphs)
+    {
+        if (glyph < glyphCount)
+        {
+            glyphStack.push_back(glyph);
+        }
+    }
+
+    while (!glyphStack.empty())
+    {
+        const GID glyph = glyphStack.back();
+        glyphStack.pop_back();
+
+        if (isGlyphUsed[glyph])
+        {
+            continue;
+        }
+        isGlyphUsed[glyph] = true;
+
+        const qsizetype begin = getGlyphOffset(glyph);
+        const qsizetype end = getGlyphOffset(glyph + 1);
+        if (end - begin < 10 || int16_t(readUInt16(glyf, begin)) >= 0)
+        {
+            // Empty or simple glyph
+            continue;
+        }
+
+        qsizetype position = begin + 10;
+        uint16_t flags = MORE_COMPONENTS;
+        while (flags & MORE_COMPONENTS)
+        {
+            if (position + 4 > end)
+            {
+                return QByteArray();
+            }
+
+            flags = readUInt16(glyf, position);
+            const GID component = readUInt16(glyf, position + 2);
+            if (component < glyphCount)
+            {
+                glyphStack.push_back(component);
+            }
+
+            position += 4;
+            position += (flags & ARG_1_AND_2_ARE_WORDS) ? 4 : 2;
+
+            if (flags & WE_HAVE_A_SCALE)
+            {
+                position += 2;
+            }
+            else if (flags & WE_HAVE_AN_X_AND_Y_SCALE)
+            {
+                position += 4;
+            }
+            else if (flags & WE_HAVE_A_TWO_BY_TWO)
+            {
+                position += 8;
+            }
+        }
+    }
+
+    // Create new glyph data and glyph locations (always in long format)
+    QByteArray newGlyf;
+    QByteArray newLoca;
+    newLoca.reserve((qsizetype(glyphCount) + 1) * 4);
+
+    for (GID glyph = 0; glyph < glyphCount; ++glyph)
+    {
+        appendUInt32(newLoca, uint32_t(newGlyf.size()));
+
+        if (isGlyphUsed[glyph])
+        {
+            const qsizetype begin = getGlyphOffset(glyph);
+            const qsizetype end = getGlyphOffset(glyph + 1);
+            newGlyf.append(glyf.constData() + begin, end - begin);
+            alignToFourBytes(newGlyf);
+        }
+    }
+    appendUInt32(newLoca, uint32_t(newGlyf.size()));
+
+    writeUInt16(head, 50, 1);
+    writeUInt32(head, 8, 0);
+    tables[TAG_GLYF] = qMove(newGlyf);
+    tables[TAG_LOCA] = qMove(newLoca);
+
+    for (uint32_t tag : REMOVED_TABLES)
+    {
+        tables.erase(tag);
+    }
+
+    QByteArray result = writeSfntTables(sfntVersion, tables);
+    if (result.size() >= fontData.size())
+    {
+        return QByteArray();
+    }
+
+    return result;
+}
+
+QByteArray PDFFontSubsetter::createCIDKeyedCFFSubset(const QByteArray& fontData, const std::set<CID>& cids)
+{
+    if (fontData.size() < 4 || uint8_t(fontData[0]) != 1)
+    {
+        // Only CFF version 1 is supported
+        return QByteArray();
+    }
+
+    const qsizetype headerSize = uint8_t(fontData[2]);
+
+    CFFIndex nameIndex;
+    CFFIndex topDictionaryIndex;
+    CFFIndex stringIndex;
+    CFFIndex globalSubroutineIndex;
+    if (!readCFFIndex(fontData, headerSize, nameIndex) ||
+        !readCFFIndex(fontData, nameIndex.end, topDictionaryIndex) ||
+        !readCFFIndex(fontData, topDictionaryIndex.end, stringIndex) ||
+        !readCFFIndex(fontData, stringIndex.end, globalSubroutineIndex) ||
+        topDictionaryIndex.items.size() != 1)
+    {
+        return QByteArray();
+    }
+
+    CFFDictionary topDictionary;
+    if (!readCFFDictionary(fontData, topDictionaryIndex.items.front().first, topDictionaryIndex.items.front().second, topDictionary))
+    {
+        return QByteArray();
+    }
+
+    const CFFDictionaryEntry* rosEntry = findCFFDictionaryEntry(topDictionary, CFF_OPERATOR_ROS);
+    const CFFDictionaryEntry* charStringsEntry = findCFFDictionaryEntry(topDictionary, CFF_OPERATOR_CHARSTRINGS);
+    const CFFDictionaryEntry* charsetEntry = findCFFDictionaryEntry(topDictionary, CFF_OPERATOR_CHARSET);
+    const CFFDictionaryEntry* fdArrayEntry = findCFFDictionaryEntry(topDictionary, CFF_OPERATOR_FDARRAY);
+    const CFFDictionaryEntry* fdSelectEntry = findCFFDictionaryEntry(topDictionary, CFF_OPERATOR_FDSELECT);
+    const CFFDictionaryEntry* charStringTypeEntry = findCFFDictionaryEntry(topDictionary, CFF_OPERATOR_CHARSTRING_TYPE);
+
+    if (!rosEntry || !charStringsEntry || !charsetEntry || !fdArrayEntry || !fdSelectEntry ||
+        charStringsEntry->operands.size() != 1 || charsetEntry->operands.size() != 1 ||
+        fdArrayEntry->operands.size() != 1 || fdSelectEntry->operands.size() != 1 ||
+        (charStringTypeEntry && charStringTypeEntry->operands != std::vector<int64_t>{ 2 }) ||
+        findCFFDictionaryEntry(topDictionary, CFF_OPERATOR_ENCODING) ||
+        findCFFDictionaryEntry(topDictionary, CFF_OPERATOR_PRIVATE))
+    {
+        // Font is not CID-keyed font, or it is not well-formed
+        return QByteArray();
+    }
+
+    CFFIndex charStringsIndex;
+    if (!readCFFIndex(fontData, charStringsEntry->operands.front(), charStringsIndex) || charStringsIndex.items.empty())
+    {
+        return QByteArray();
+    }
+
+    const GID glyphCount = GID(charStringsIndex.items.size());
+
+    // Read charset (mapping of glyph indices to CIDs)
+    const qsizetype charsetBegin = charsetEntry->operands.front();
+    if (charsetBegin <= 2 || charsetBegin >= fontData.size())
+    {
+        // Predefined charsets can't be used in CID-keyed fonts
+        return QByteArray();
+    }
+
+    std::unordered_map<CID, GID> cidToGid;
+    cidToGid.reserve(glyphCount);
+    cidToGid[0] = 0;
+
+    qsizetype charsetEnd = charsetBegin + 1;
+    const uint8_t charsetFormat = uint8_t(fontData[charsetBegin]);
+    GID glyph = 1;
+    while (glyph < glyphCount)
+    {
+        switch (charsetFormat)
+        {
+            case 0:
+            {
+                if (charsetEnd + 2 > fontData.size())
+                {
+                    return QByteArray();
+                }
+                cidToGid.emplace(readUInt16(fontData, charsetEnd), glyph++);
+                charsetEnd += 2;
+                break;
+            }
+
+            case 1:
+            case 2:
+            {
+                const qsizetype rangeSize = charsetFormat == 1 ? 3 : 4;
+                if (charsetEnd + rangeSize > fontData.size())
+                {
+                    return QByteArray();
+                }
+
+                const CID first = readUInt16(fontData, charsetEnd);
+                const CID left = charsetFormat == 1 ? uint8_t(fontData[charsetEnd + 2]) : readUInt16(fontData, charsetEnd + 2);
+                for (CID cid = first; cid <= first + left && glyph < glyphCount; ++cid)
+                {
+                    cidToGid.emplace(cid, glyph++);
+                }
+                charsetEnd += rangeSize;
+                break;
+            }
+
+            default:
+                return QByteArray();
+        }
+    }
+
+    // Read FDSelect, we just need its size
+    const qsizetype fdSelectBegin = fdSelectEntry->operands.front();
+    if (fdSelectBegin <= 0 || fdSelectBegin >= fontData.size())
+    {
+        return QByteArray();
+    }
+
+    qsizetype fdSelectEnd = 0;
+    switch (uint8_t(fontData[fdSelectBegin]))
+    {
+        case 0:
+            fdSelectEnd = fdSelectBegin + 1 + qsizetype(glyphCount);
+            break;
+
+        case 3:
+        {
+            if (fdSelectBegin + 3 > fontData.size())
+            {
+                return QByteArray();
+            }
+
+            const qsizetype rangeCount = readUInt16(fontData, fdSelectBegin + 1);
+            fdSelectEnd = fdSelectBegin + 3 + rangeCount * 3 + 2;
+            break;
+        }
+
+        default:
+            return QByteArray();
+    }
+
+    if (fdSelectEnd > fontData.size())
+    {
+        return QByteArray();
+    }
+
+    // Read font dictionaries with their private dictionaries and local subroutines
+    struct FontDictionary
+    {
+        CFFDictionary dictionary;
+        CFFDictionary privateDictionary;
+        CFFIndex localSubroutineIndex;
+        bool hasPrivateDictionary = false;
+        bool hasLocalSubroutines = false;
+    };
+
+    CFFIndex fdArrayIndex;
+    if (!readCFFIndex(fontData, fdArrayEntry->operands.front(), fdArrayIndex) || fdArrayIndex.items.empty())
+    {
+        return QByteArray();
+    }
+
+    std::vector<FontDictionary> fontDictionaries(fdArrayIndex.items.size());
+    for (size_t i = 0; i < fontDictionaries.size(); ++i)
+    {
+        FontDictionary& fontDictionary = fontDictionaries[i];
+        if (!readCFFDictionary(fontData, fdArrayIndex.items[i].first, fdArrayIndex.items[i].second, fontDictionary.dictionary))
+        {
+            return QByteArray();
+        }
+
+        const CFFDictionaryEntry* privateEntry = findCFFDictionaryEntry(fontDictionary.dictionary, CFF_OPERATOR_PRIVATE);
+        if (!privateEntry)
+        {
+            continue;
+        }
+
+        if (privateEntry->operands.size() != 2)
+        {
+            return QByteArray();
+        }
+
+        const qsizetype privateSize = privateEntry->operands[0];
+        const qsizetype privateOffset = privateEntry->operands[1];
+        if (privateSize < 0 || !readCFFDictionary(fontData, privateOffset, privateOffset + privateSize, fontDictionary.privateDictionary))
+        {
+            return QByteArray();
+        }
+        fontDictionary.hasPrivateDictionary = true;
+
+        if (const CFFDictionaryEntry* subroutinesEntry = findCFFDictionaryEntry(fontDictionary.privateDictionary, CFF_OPERATOR_SUBRS))
+        {
+            if (subroutinesEntry->operands.size() != 1 || !readCFFIndex(fontData, privateOffset + subroutinesEntry->operands.front(), fontDictionary.localSubroutineIndex))
+            {
+                return QByteArray();
+            }
+            fontDictionary.hasLocalSubroutines = true;
+        }
+    }
+
+    // Create new char strings, unused glyphs contain just endchar operator
+    std::vector<bool> isGlyphUsed(glyphCount, false);
+    isGlyphUsed[0] = true;
+    for (CID cid : cids)
+    {
+        auto it = cidToGid.find(cid);
+        if (it != cidToGid.cend())
+        {
+            isGlyphUsed[it->second] = true;
+        }
+    }
+
+    std::vector<QByteArray> charStrings;
+    charStrings.reserve(glyphCount);
+    for (GID currentGlyph = 0; currentGlyph < glyphCount; ++currentGlyph)
+    {
+        if (isGlyphUsed[currentGlyph])
+        {
+            const auto& item = charStringsIndex.items[currentGlyph];
+            charStrings.emplace_back(fontData.mid(item.first, item.second - item.first));
+        }
+        else
+        {
+            charStrings.emplace_back(1, CFF_CHARSTRING_ENDCHAR);
+        }
+    }
+    const QByteArray newCharStringsIndex = writeCFFIndex(charStrings);
+    charStrings.clear();
+
+    // Calculate layout of the new font. All offsets are written as 5 byte
+    // integers, so we can calculate sizes of dictionaries before we know offsets.
+    const std::map<int, std::vector<int64_t>> topDictionaryPlaceholders = {
+        { CFF_OPERATOR_CHARSET, { 0 } },
+        { CFF_OPERATOR_CHARSTRINGS, { 0 } },
+        { CFF_OPERATOR_FDARRAY, { 0 } },
+        { CFF_OPERATOR_FDSELECT, { 0 } }
+    };
+    const qsizetype topDictionaryIndexSize = writeCFFIndex({ writeCFFDictionary(topDictionary, topDictionaryPlaceholders) }).size();
+
+    const qsizetype charsetOffset = headerSize + (nameIndex.end - nameIndex.begin) + topDictionaryIndexSize +
+                                    (stringIndex.end - stringIndex.begin) + (globalSubroutineIndex.end - globalSubroutineIndex.begin);
+    const qsizetype fdSelectOffset = charsetOffset + (charsetEnd - charsetBegin);
+    const qsizetype charStringsOffset = fdSelectOffset + (fdSelectEnd - fdSelectBegin);
+    const qsizetype fdArrayOffset = charStringsOffset + newCharStringsIndex.size();
+
+    const std::map<int, std::vector<int64_t>> fontDictionaryPlaceholders = { { CFF_OPERATOR_PRIVATE, { 0, 0 } } };
+    const std::map<int, std::vector<int64_t>> privateDictionaryPlaceholders = { { CFF_OPERATOR_SUBRS, { 0 } } };
+
+    std::vector<QByteArray> fontDictionaryData(fontDictionaries.size());
+    for (size_t i = 0; i < fontDictionaries.size(); ++i)
+    {
+        fontDictionaryData[i] = writeCFFDictionary(fontDictionaries[i].dictionary, fontDictionaryPlaceholders);
+    }
+    qsizetype privateOffset = fdArrayOffset + writeCFFIndex(fontDictionaryData).size();
+
+    QByteArray privateData;
+    for (size_t i = 0; i < fontDictionaries.size(); ++i)
+    {
+        const FontDictionary& fontDictionary = fontDictionaries[i];
+        if (!fontDictionary.hasPrivateDictionary)
+        {
+            continue;
+        }
+
+        // Local subroutines are placed right after the private dictionary
+        const qsizetype privateSize = writeCFFDictionary(fontDictionary.privateDictionary, privateDictionaryPlaceholders).size();
+        const QByteArray privateDictionary = writeCFFDictionary(fontDictionary.privateDictionary, { { CFF_OPERATOR_SUBRS, { privateSize } } });
+        Q_ASSERT(privateDictionary.size() == privateSize);
+
+        fontDictionaryData[i] = writeCFFDictionary(fontDictionary.dictionary, { { CFF_OPERATOR_PRIVATE, { privateSize, privateOffset } } });
+        privateData.append(privateDictionary);
+        privateOffset += privateSize;
+
+        if (fontDictionary.hasLocalSubroutines)
+        {
+            const qsizetype subroutinesSize = fontDictionary.localSubroutineIndex.end - fontDictionary.localSubroutineIndex.begin;
+            privateData.append(fontData.constData() + fontDictionary.localSubroutineIndex.begin, subroutinesSize);
+            privateOffset += subroutinesSize;
+        }
+    }
+
+    const std::map<int, std::vector<int64_t>> topDictionaryOffsets = {
+        { CFF_OPERATOR_CHARSET, { charsetOffset } },
+        { CFF_OPERATOR_CHARSTRINGS, { charStringsOffset } },
+        { CFF_OPERATOR_FDARRAY, { fdArrayOffset } },
+        { CFF_OPERATOR_FDSELECT, { fdSelectOffset } }
+    };
+
+    QByteArray result;
+    result.reserve(privateOffset);
+    result.append(fontData.constData(), headerSize);
+    result.append(fontData.constData() + nameIndex.begin, nameIndex.end - nameIndex.begin);
+    result.append(writeCFFIndex({ writeCFFDictionary(topDictionary, topDictionaryOffsets) }));
+    result.append(fontData.constData() + stringIndex.begin, stringIndex.end - stringIndex.begin);
+    result.append(fontData.constData() + globalSubroutineIndex.begin, globalSubroutineIndex.end - globalSubroutineIndex.begin);
+    Q_ASSERT(result.size() == charsetOffset);
+    result.append(fontData.constData() + charsetBegin, charsetEnd - charsetBegin);
+    result.append(fontData.constData() + fdSelectBegin, fdSelectEnd - fdSelectBegin);
+    result.append(newCharStringsIndex);
+    Q_ASSERT(result.size() == fdArrayOffset);
+    result.append(writeCFFIndex(fontDictionaryData));
+    result.append(privateData);
+    Q_ASSERT(result.size() == privateOffset);
+
+    if (result.size() >= fontData.size())
+    {
+        return QByteArray();
+    }
+
+    return result;
+}
+
+QByteArray PDFFontSubsetter::createSubsetTag(const QByteArray& fontData)
+{
+    const QByteArray hash = QCryptographicHash::hash(fontData, QCryptographicHash::Sha1);
+
+    QByteArray tag(6, 'A');
+    for (int i = 0; i < tag.size(); ++i)
+    {
+        tag[i] = char('A' + uint8_t(hash[i]) % 26);
+    }
+
+    return tag;
+}
+
+bool PDFFontSubsetter::hasSubsetTag(const QByteArray& fontName)
+{
+    if (fontName.size() < 7 || fontName[6] != '+')
+    {
+        return false;
+    }
+
+    return std::all_of(fontName.cbegin(), fontName.cbegin() + 6, [](char c) { return c >= 'A' && c <= 'Z'; });
+}
+
+}   // namespace pdf
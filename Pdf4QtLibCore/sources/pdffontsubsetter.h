@@ -0,0 +1,72 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef PDFFONTSUBSETTER_H
+#define PDFFONTSUBSETTER_H
+
+#include "pdffont.h"
+
+#include <QByteArray>
+
+#include <set>
+
+namespace pdf
+{
+
+/// Creates subsets of embedded font programs. Glyph identifiers are preserved,
+/// data of unused glyphs are just removed (glyphs become empty), so mappings
+/// in the PDF, which refer to glyphs (such as CIDToGIDMap, or W arrays), remain
+/// valid and don't have to be updated.
+class PDF4QTLIBCORESHARED_EXPORT PDFFontSubsetter
+{
+public:
+    /// Creates subset of the TrueType font program (FontFile2). Glyphs used
+    /// by composite glyphs are kept too, glyph 0 (.notdef) is always kept. Tables,
+    /// which are not used in PDF (layout tables, bitmaps, digital signature), are
+    /// removed. If font program can't be subsetted, empty byte array is returned.
+    /// \param fontData Decoded font program
+    /// \param glyphs Glyph indices of used glyphs
+    static QByteArray createTrueTypeSubset(const QByteArray& fontData, const std::set<GID>& glyphs);
+
+    /// Creates subset of the CID-keyed CFF font program (FontFile3 with subtype
+    /// CIDFontType0C). Glyphs are identified by CIDs, which are mapped to glyph
+    /// indices by charset of the font. Glyph with CID 0 (.notdef) is always kept.
+    /// If font program can't be subsetted, empty byte array is returned.
+    /// \param fontData Decoded font program
+    /// \param cids CIDs of used glyphs
+    static QByteArray createCIDKeyedCFFSubset(const QByteArray& fontData, const std::set<CID>& cids);
+
+    /// Creates subset tag (six uppercase letters) from the subsetted font program.
+    /// \param fontData Subsetted font program
+    static QByteArray createSubsetTag(const QByteArray& fontData);
+
+    /// Returns true, if font name starts with subset tag (six uppercase letters, followed by '+')
+    /// \param fontName Font name
+    static bool hasSubsetTag(const QByteArray& fontName);
+
+private:
+    PDFFontSubsetter() = delete;
+};
+
+}   // namespace pdf
+
+#endif // PDFFONTSUBSETTER_H
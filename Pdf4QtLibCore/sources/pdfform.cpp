@@ -26,6 +26,8 @@
 #include "pdfpainterutils.h"
 #include "pdfdbgheap.h"
 
+#include <unordered_set>
+
 namespace pdf
 {
 
@@ -61,7 +63,7 @@ PDFForm PDFForm::parse(const PDFDocument* document, PDFObject object)
 
         // As post-processing, delete all form fields, which are nullptr (are incorrectly defined)
         form.m_formFields.erase(std::remove_if(form.m_formFields.begin(), form.m_formFields.end(), [](const auto& field){ return !field; }), form.m_formFields.end());
-        form.updateWidgetToFormFieldMapping();
+        form.updateFormFieldIndices();
 
         // If we have form, then we must also look for 'rogue' form fields, which are
         // incorrectly not in the 'Fields' entry of this form. We do this by iterating
@@ -95,22 +97,36 @@ PDFForm PDFForm::parse(const PDFDocument* document, PDFObject object)
 
         if (rogueFieldFound)
         {
-            form.updateWidgetToFormFieldMapping();
+            form.updateFormFieldIndices();
         }
     }
 
     return form;
 }
 
-void PDFForm::updateWidgetToFormFieldMapping()
+void PDFForm::updateFormFieldIndices()
 {
     m_widgetToFormField.clear();
+    m_referenceToFormField.clear();
+    m_qualifiedNameToFormFields.clear();
 
     if (isAcroForm() || isXFAForm())
     {
+        auto fillIndices = [this](PDFFormField* formField)
+        {
+            m_referenceToFormField.emplace(formField->getSelfReference(), formField);
+
+            const QString& qualifiedName = formField->getName(PDFFormField::NameType::FullyQualified);
+            if (!qualifiedName.isEmpty())
+            {
+                m_qualifiedNameToFormFields[qualifiedName].push_back(formField);
+            }
+        };
+
         for (const PDFFormFieldPointer& formFieldPtr : getFormFields())
         {
             formFieldPtr->fillWidgetToFormFieldMapping(m_widgetToFormField);
+            formFieldPtr->modify(fillIndices);
         }
     }
 }
@@ -160,6 +176,47 @@ PDFFormField* PDFForm::getFormFieldForWidget(PDFObjectReference widget)
     return nullptr;
 }
 
+const PDFFormField* PDFForm::getFormFieldByReference(PDFObjectReference reference) const
+{
+    auto it = m_referenceToFormField.find(reference);
+    if (it != m_referenceToFormField.cend())
+    {
+        return it->second;
+    }
+
+    return nullptr;
+}
+
+PDFFormField* PDFForm::getFormFieldByReference(PDFObjectReference reference)
+{
+    auto it = m_referenceToFormField.find(reference);
+    if (it != m_referenceToFormField.cend())
+    {
+        return it->second;
+    }
+
+    return nullptr;
+}
+
+const PDFFormField* PDFForm::getFormFieldByQualifiedName(const QString& qualifiedName) const
+{
+    const std::vector<PDFFormField*>& formFields = getFormFieldsByQualifiedName(qualifiedName);
+    return !formFields.empty() ? formFields.front() : nullptr;
+}
+
+const std::vector<PDFFormField*>& PDFForm::getFormFieldsByQualifiedName(const QString& qualifiedName) const
+{
+    static const std::vector<PDFFormField*> dummy;
+
+    auto it = m_qualifiedNameToFormFields.find(qualifiedName);
+    if (it != m_qualifiedNameToFormFields.cend())
+    {
+        return it->second;
+    }
+
+    return dummy;
+}
+
 void PDFForm::apply(const std::function<void (const PDFFormField*)>& functor) const
 {
     for (const PDFFormFieldPointer& childField : getFormFields())
@@ -772,34 +829,73 @@ void PDFFormManager::setFormFieldValue(PDFFormField::SetValueParameters paramete
     modifier.getBuilder()->setFormManager(this);
     parameters.modifier = &modifier;
 
-    if (parameters.invokingFormField->setValue(parameters))
+    if (applyFormFieldValue(std::move(parameters)))
     {
-        // We must also set dependent fields with same name
-        QString qualifiedFormFieldName = parameters.invokingFormField->getName(PDFFormField::NameType::FullyQualified);
-        if (!qualifiedFormFieldName.isEmpty())
+        if (modifier.finalize())
         {
-            parameters.scope = PDFFormField::SetValueParameters::Scope::Internal;
-            auto updateDependentField = [&parameters, &qualifiedFormFieldName](PDFFormField* formField)
-            {
-                if (parameters.invokingFormField == formField)
-                {
-                    // Do not update self
-                    return;
-                }
-
-                if (qualifiedFormFieldName == formField->getName(PDFFormField::NameType::FullyQualified))
-                {
-                    formField->setValue(parameters);
-                }
-            };
-            modify(updateDependentField);
+            Q_EMIT documentModified(PDFModifiedDocument(modifier.getDocument(), nullptr, modifier.getFlags()));
         }
+    }
+}
 
-        if (modifier.finalize())
+void PDFFormManager::setFormFieldValues(std::vector<PDFFormField::SetValueParameters> parameters)
+{
+    if (!m_document || parameters.empty())
+    {
+        return;
+    }
+
+    PDFDocumentModifier modifier(m_document);
+    PDFDocumentBuilder* builder = modifier.getBuilder();
+    builder->setFormManager(this);
+
+    // Appearance streams are regenerated after all values are set
+    bool isAnyValueSet = false;
+    builder->beginAppearanceStreamsBatchUpdate();
+    for (PDFFormField::SetValueParameters& fieldParameters : parameters)
+    {
+        Q_ASSERT(fieldParameters.invokingFormField);
+
+        fieldParameters.formManager = this;
+        fieldParameters.modifier = &modifier;
+        isAnyValueSet = applyFormFieldValue(std::move(fieldParameters)) || isAnyValueSet;
+    }
+    builder->endAppearanceStreamsBatchUpdate();
+
+    if (isAnyValueSet && modifier.finalize())
+    {
+        Q_EMIT documentModified(PDFModifiedDocument(modifier.getDocument(), nullptr, modifier.getFlags()));
+    }
+}
+
+bool PDFFormManager::applyFormFieldValue(PDFFormField::SetValueParameters parameters)
+{
+    Q_ASSERT(parameters.formManager);
+    Q_ASSERT(parameters.modifier);
+
+    if (!parameters.invokingFormField->setValue(parameters))
+    {
+        return false;
+    }
+
+    // We must also set dependent fields with same name
+    QString qualifiedFormFieldName = parameters.invokingFormField->getName(PDFFormField::NameType::FullyQualified);
+    if (!qualifiedFormFieldName.isEmpty())
+    {
+        parameters.scope = PDFFormField::SetValueParameters::Scope::Internal;
+        for (PDFFormField* formField : m_form.getFormFieldsByQualifiedName(qualifiedFormFieldName))
         {
-            Q_EMIT documentModified(PDFModifiedDocument(modifier.getDocument(), nullptr, modifier.getFlags()));
+            if (parameters.invokingFormField == formField)
+            {
+                // Do not update self
+                continue;
+            }
+
+            formField->setValue(parameters);
         }
     }
+
+    return true;
 }
 
 QRectF PDFFormManager::getWidgetRectangle(const PDFFormWidget& widget) const
@@ -937,14 +1033,30 @@ void PDFFormManager::performResetAction(const PDFActionResetForm* action)
     PDFDocumentModifier modifier(m_document);
     modifier.getBuilder()->setFormManager(this);
 
-    auto resetFieldValue = [this, action, &modifier](PDFFormField* formField)
+    // Resolve field list using form field indices
+    std::unordered_set<const PDFFormField*> fieldListFields;
+    const PDFFormAction::FieldList& fieldList = action->getFieldList();
+    for (const PDFObjectReference& fieldReference : fieldList.fieldReferences)
+    {
+        if (const PDFFormField* formField = m_form.getFormFieldByReference(fieldReference))
+        {
+            fieldListFields.insert(formField);
+        }
+    }
+    for (const QString& qualifiedName : fieldList.qualifiedNames)
     {
-        const PDFFormAction::FieldList& fieldList = action->getFieldList();
+        const std::vector<PDFFormField*>& formFields = m_form.getFormFieldsByQualifiedName(qualifiedName);
+        fieldListFields.insert(formFields.cbegin(), formFields.cend());
+    }
 
+    // Appearance streams are regenerated after all values are reset
+    modifier.getBuilder()->beginAppearanceStreamsBatchUpdate();
+
+    auto resetFieldValue = [this, action, &modifier, &fieldListFields](PDFFormField* formField)
+    {
         // Akceptujeme form field dle daného filtru?
         bool accept = false;
-        bool isInFieldList = std::find(fieldList.fieldReferences.cbegin(), fieldList.fieldReferences.cend(), formField->getSelfReference()) != fieldList.fieldReferences.cend() ||
-                             fieldList.qualifiedNames.contains(formField->getName(PDFFormField::NameType::FullyQualified));
+        bool isInFieldList = fieldListFields.count(formField);
         switch (action->getFieldScope())
         {
             case PDFFormAction::FieldScope::All:
@@ -973,6 +1085,7 @@ void PDFFormManager::performResetAction(const PDFActionResetForm* action)
         }
     };
     modify(resetFieldValue);
+    modifier.getBuilder()->endAppearanceStreamsBatchUpdate();
 
     if (modifier.finalize())
     {
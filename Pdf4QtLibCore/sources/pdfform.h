@@ -32,6 +32,7 @@
 #include <QTextLayout>
 
 #include <optional>
+#include <unordered_map>
 
 namespace pdf
 {
@@ -43,7 +44,9 @@ class PDFDocumentModifier;
 
 using PDFFormFieldPointer = QSharedPointer<PDFFormField>;
 using PDFFormFields = std::vector<PDFFormFieldPointer>;
-using PDFWidgetToFormFieldMapping = std::map<PDFObjectReference, PDFFormField*>;
+using PDFWidgetToFormFieldMapping = std::unordered_map<PDFObjectReference, PDFFormField*, PDFObjectReferenceHash>;
+using PDFReferenceToFormFieldMapping = std::unordered_map<PDFObjectReference, PDFFormField*, PDFObjectReferenceHash>;
+using PDFQualifiedNameToFormFieldsMapping = std::unordered_map<QString, std::vector<PDFFormField*>>;
 
 /// A simple proxy to the widget annotation
 class PDFFormWidget
@@ -462,6 +465,27 @@ public:
     /// \param widget Widget annotation
     PDFFormField* getFormFieldForWidget(PDFObjectReference widget);
 
+    /// Returns form field with given reference. If form field
+    /// doesn't exist, then nullptr is returned.
+    /// \param reference Form field reference
+    const PDFFormField* getFormFieldByReference(PDFObjectReference reference) const;
+
+    /// Returns form field with given reference. If form field
+    /// doesn't exist, then nullptr is returned.
+    /// \param reference Form field reference
+    PDFFormField* getFormFieldByReference(PDFObjectReference reference);
+
+    /// Returns first form field with given fully qualified name. If form
+    /// field with this name doesn't exist, then nullptr is returned.
+    /// \param qualifiedName Fully qualified name of the form field
+    const PDFFormField* getFormFieldByQualifiedName(const QString& qualifiedName) const;
+
+    /// Returns all form fields with given fully qualified name (for example,
+    /// rogue form fields can have same name as regular form field). Form fields
+    /// are in pre-order. If no form field has this name, empty list is returned.
+    /// \param qualifiedName Fully qualified name of the form field
+    const std::vector<PDFFormField*>& getFormFieldsByQualifiedName(const QString& qualifiedName) const;
+
     /// Applies function to all form fields present in the form,
     /// in pre-order (first application is to the parent, following
     /// calls to apply for children).
@@ -475,7 +499,9 @@ public:
     static PDFForm parse(const PDFDocument* document, PDFObject object);
 
 private:
-    void updateWidgetToFormFieldMapping();
+    /// Rebuilds indices (widget to form field, reference to form field
+    /// and qualified name to form fields mappings) from the form field tree
+    void updateFormFieldIndices();
 
     FormType m_formType = FormType::None;
     PDFFormFields m_formFields;
@@ -487,6 +513,8 @@ private:
     std::optional<PDFInteger> m_quadding;
     PDFObject m_xfa;
     PDFWidgetToFormFieldMapping m_widgetToFormField;
+    PDFReferenceToFormFieldMapping m_referenceToFormField;
+    PDFQualifiedNameToFormFieldsMapping m_qualifiedNameToFormFields;
 };
 
 /// Form manager. Manages all form widgets functionality - triggers actions,
@@ -527,6 +555,11 @@ public:
     /// \param widget Widget annotation
     PDFFormField* getFormFieldForWidget(PDFObjectReference widget) { return m_form.getFormFieldForWidget(widget); }
 
+    /// Returns first form field with given fully qualified name. If form
+    /// field with this name doesn't exist, then nullptr is returned.
+    /// \param qualifiedName Fully qualified name of the form field
+    const PDFFormField* getFormFieldByQualifiedName(const QString& qualifiedName) const { return m_form.getFormFieldByQualifiedName(qualifiedName); }
+
     const PDFDocument* getDocument() const;
     void setDocument(const PDFModifiedDocument& document);
 
@@ -566,6 +599,14 @@ public:
     /// Tries to set value to the form field
     void setFormFieldValue(PDFFormField::SetValueParameters parameters);
 
+    /// Tries to set values to multiple form fields at once (for example,
+    /// when form data are imported). All values are set in one document
+    /// modification, and appearance streams of all affected widgets are
+    /// regenerated at once, in parallel. Scope of each value is preserved,
+    /// so values can be set as internal (not by the user).
+    /// \param parameters Parameters for each form field
+    void setFormFieldValues(std::vector<PDFFormField::SetValueParameters> parameters);
+
     /// Get widget rectangle (from annotation)
     QRectF getWidgetRectangle(const PDFFormWidget& widget) const;
 
@@ -617,6 +658,11 @@ signals:
     void documentModified(pdf::PDFModifiedDocument document);
 
 private:
+    /// Sets value to the form field and to all dependent form fields
+    /// (with same qualified name). Returns true, if value was set.
+    /// \param parameters Parameters (form manager and modifier must be set)
+    bool applyFormFieldValue(PDFFormField::SetValueParameters parameters);
+
     const PDFDocument* m_document;
     FormAppearanceFlags m_flags;
     PDFForm m_form;
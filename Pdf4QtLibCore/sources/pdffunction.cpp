@@ -32,6 +32,8 @@
 
 #include "pdfdbgheap.h"
 
+#include <array>
+#include <limits>
 #include <stack>
 #include <iterator>
 #include <type_traits>
@@ -48,6 +50,33 @@ PDFFunction::PDFFunction(uint32_t m, uint32_t n, std::vector<PDFReal>&& domain,
 
 }
 
+PDFFunction::FunctionResult PDFFunction::applyMany(const const_iterator* x, const iterator* y, size_t count) const
+{
+    std::vector<PDFReal> input(m_m, 0.0);
+    std::vector<PDFReal> output(m_n, 0.0);
+
+    for (size_t k = 0; k < count; ++k)
+    {
+        for (uint32_t i = 0; i < m_m; ++i)
+        {
+            input[i] = x[i][k];
+        }
+
+        FunctionResult result = apply(input.data(), input.data() + input.size(), output.data(), output.data() + output.size());
+        if (!result)
+        {
+            return result;
+        }
+
+        for (uint32_t j = 0; j < m_n; ++j)
+        {
+            y[j][k] = output[j];
+        }
+    }
+
+    return true;
+}
+
 PDFFunctionPtr PDFFunction::createFunction(const PDFDocument* document, const PDFObject& object)
 {
     PDFParsingContext context(nullptr);
@@ -520,6 +549,61 @@ PDFExponentialFunction::PDFExponentialFunction(uint32_t m, uint32_t n,
     Q_ASSERT(m_c1.size() == n);
 }
 
+PDFFunction::FunctionResult PDFSampledFunction::applyMany(const const_iterator* x, const iterator* y, size_t count) const
+{
+    if (m_m != 1)
+    {
+        // Multidimensional hypercube interpolation is evaluated tuple by tuple
+        return PDFFunction::applyMany(x, y, count);
+    }
+
+    // Function of one variable (the most common case, for example, tint transform
+    // of the Separation color space, or shading function) - interpolate between two
+    // neighbouring samples.
+    const PDFReal domainMin = m_domain[0];
+    const PDFReal domainMax = m_domain[1];
+    const PDFReal encoderMin = m_encoder[0];
+    const PDFReal encoderMax = m_encoder[1];
+    const uint32_t size = m_size[0];
+    const uint32_t offset0 = m_hypercubeNodeOffsets[0];
+    const uint32_t offset1 = m_hypercubeNodeOffsets[1];
+    const size_t sampleCount = m_samples.size();
+    const PDFReal* samples = m_samples.data();
+
+    const PDFReal* xValues = x[0];
+    for (size_t k = 0; k < count; ++k)
+    {
+        const PDFReal xClamped = qBound<PDFReal>(domainMin, xValues[k], domainMax);
+        const PDFReal xEncoded = interpolate(xClamped, domainMin, domainMax, encoderMin, encoderMax);
+        const PDFReal xClampedToSamples = qBound<PDFReal>(0, xEncoded, size);
+
+        uint32_t xRounded = static_cast<uint32_t>(xClampedToSamples);
+        if (xRounded == size && size > 1)
+        {
+            // We want one value before the end (so we can use the "hypercube" algorithm)
+            xRounded = size - 2;
+        }
+
+        const PDFReal x1 = xClampedToSamples - static_cast<PDFReal>(xRounded);
+        const PDFReal x0 = 1.0 - x1;
+        const uint32_t baseOffset = xRounded * m_n;
+
+        for (uint32_t outputIndex = 0; outputIndex < m_n; ++outputIndex)
+        {
+            const uint32_t sampleOffset0 = baseOffset + offset0 + outputIndex;
+            const uint32_t sampleOffset1 = baseOffset + offset1 + outputIndex;
+            const PDFReal sample0 = (sampleOffset0 < sampleCount) ? samples[sampleOffset0] : 0.0;
+            const PDFReal sample1 = (sampleOffset1 < sampleCount) ? samples[sampleOffset1] : 0.0;
+
+            const PDFReal outputValue = x0 * sample0 + x1 * sample1;
+            const PDFReal outputValueDecoded = interpolate(outputValue, 0.0, m_sampleMaximalValue, m_decoder[2 * outputIndex], m_decoder[2 * outputIndex + 1]);
+            y[outputIndex][k] = clampOutput(outputIndex, outputValueDecoded);
+        }
+    }
+
+    return true;
+}
+
 PDFFunction::FunctionResult PDFExponentialFunction::apply(PDFFunction::const_iterator x_1,
                                                           PDFFunction::const_iterator x_m,
                                                           PDFFunction::iterator y_1,
@@ -586,6 +670,57 @@ PDFStitchingFunction::~PDFStitchingFunction()
 
 }
 
+PDFFunction::FunctionResult PDFExponentialFunction::applyMany(const const_iterator* x, const iterator* y, size_t count) const
+{
+    Q_ASSERT(m_m == 1);
+    const PDFReal* xValues = x[0];
+
+    // Power is computed only once for each tuple, it is stored
+    // in the buffer and shared by all output variables.
+    std::vector<PDFReal> factors(count, 0.0);
+    for (size_t k = 0; k < count; ++k)
+    {
+        const PDFReal xClamped = clampInput(0, xValues[k]);
+        factors[k] = m_isLinear ? xClamped : std::pow(xClamped, m_exponent);
+    }
+
+    for (uint32_t index = 0; index < m_n; ++index)
+    {
+        const PDFReal c0 = m_c0[index];
+        const PDFReal c1 = m_c1[index];
+        PDFReal* yValues = y[index];
+
+        if (!m_isLinear)
+        {
+            // Perform exponential interpolation
+            for (size_t k = 0; k < count; ++k)
+            {
+                yValues[k] = c0 + factors[k] * (c1 - c0);
+            }
+        }
+        else
+        {
+            // Perform linear interpolation
+            for (size_t k = 0; k < count; ++k)
+            {
+                yValues[k] = mix(factors[k], c0, c1);
+            }
+        }
+
+        if (hasRange())
+        {
+            const PDFReal rangeMin = m_range[2 * index];
+            const PDFReal rangeMax = m_range[2 * index + 1];
+            for (size_t k = 0; k < count; ++k)
+            {
+                yValues[k] = qBound<PDFReal>(rangeMin, yValues[k], rangeMax);
+            }
+        }
+    }
+
+    return true;
+}
+
 PDFFunction::FunctionResult PDFStitchingFunction::apply(const_iterator x_1,
                                                         const_iterator x_m,
                                                         iterator y_1,
@@ -637,6 +772,78 @@ PDFIdentityFunction::PDFIdentityFunction() :
 
 }
 
+PDFFunction::FunctionResult PDFStitchingFunction::applyMany(const const_iterator* x, const iterator* y, size_t count) const
+{
+    Q_ASSERT(m_m == 1);
+    const PDFReal* xValues = x[0];
+
+    // Input values are encoded into the input range of the partial functions. Then,
+    // runs of consecutive tuples using the same partial function are evaluated by
+    // one call of this function (for shadings, input is usually monotonic, so runs are long).
+    std::vector<PDFReal> encoded(count, 0.0);
+    std::vector<iterator> runOutputs(m_n, nullptr);
+
+    size_t runStart = 0;
+    auto runFunction = m_partialFunctions.cend();
+
+    auto evaluateRun = [&](size_t runEnd) -> FunctionResult
+    {
+        if (runStart == runEnd)
+        {
+            return true;
+        }
+
+        for (uint32_t j = 0; j < m_n; ++j)
+        {
+            runOutputs[j] = y[j] + runStart;
+        }
+
+        const const_iterator runInput = encoded.data() + runStart;
+        return runFunction->function->applyMany(&runInput, runOutputs.data(), runEnd - runStart);
+    };
+
+    for (size_t k = 0; k < count; ++k)
+    {
+        const PDFReal xClamped = clampInput(0, xValues[k]);
+
+        auto it = std::lower_bound(m_partialFunctions.cbegin(), m_partialFunctions.cend(), xClamped, [](const auto& partialFunction, PDFReal value) { return partialFunction.bound1 < value; });
+        if (it == m_partialFunctions.cend())
+        {
+            --it;
+        }
+
+        if (it != runFunction)
+        {
+            FunctionResult result = evaluateRun(k);
+            if (!result)
+            {
+                return result;
+            }
+
+            runStart = k;
+            runFunction = it;
+        }
+
+        encoded[k] = interpolate(xClamped, it->bound0, it->bound1, it->encode0, it->encode1);
+    }
+
+    FunctionResult result = evaluateRun(count);
+
+    if (hasRange())
+    {
+        for (uint32_t index = 0; index < m_n; ++index)
+        {
+            PDFReal* yValues = y[index];
+            for (size_t k = 0; k < count; ++k)
+            {
+                yValues[k] = clampOutput(index, yValues[k]);
+            }
+        }
+    }
+
+    return result;
+}
+
 PDFFunction::FunctionResult PDFIdentityFunction::apply(const_iterator x_1,
                                                        const_iterator x_m,
                                                        iterator y_1,
@@ -726,6 +933,9 @@ public:
     /// Pushes the operand onto the stack
     void push(const OperandObject& operand) { m_stack.push_back(operand); checkOverflow(); }
 
+    /// Pops the operand from the stack (throw exception, if stack underflow occurs)
+    inline OperandObject popOperand() { checkUnderflow(); OperandObject operand = m_stack.back(); m_stack.pop_back(); return operand; }
+
     /// Returns true, if stack is empty
     bool empty() const { return m_stack.empty(); }
 
@@ -1585,132 +1795,1272 @@ void PDFPostScriptFunctionStack::checkUnderflow(size_t n) const
     }
 }
 
-PDFPostScriptFunction::Code PDFPostScriptFunction::getCode(const QByteArray& byteArray)
+/// Program of the postscript function compiled to the straight-line code operating
+/// on registers. Stack operations are resolved during the compilation, constant expressions
+/// are folded, and conditional blocks are replaced by selection of values computed by both
+/// blocks. Instructions, which can fail, are guarded by the predicate of the block, in which
+/// they are executed, so failure is reported only, if the block is really executed.
+class PDFPostScriptFunctionCompiledProgram
 {
-    static constexpr const std::pair<Code, const  char*> codes[] =
-    {
-        // B.1 Arithmetic operators
-        std::pair<Code, const  char*>{ Code::Add, "add" },
-        std::pair<Code, const  char*>{ Code::Sub, "sub" },
-        std::pair<Code, const  char*>{ Code::Mul, "mul" },
-        std::pair<Code, const  char*>{ Code::Div, "div" },
-        std::pair<Code, const  char*>{ Code::Idiv, "idiv" },
-        std::pair<Code, const  char*>{ Code::Mod, "mod" },
-        std::pair<Code, const  char*>{ Code::Neg, "neg" },
-        std::pair<Code, const  char*>{ Code::Abs, "abs" },
-        std::pair<Code, const  char*>{ Code::Ceiling, "ceiling" },
-        std::pair<Code, const  char*>{ Code::Floor, "floor" },
-        std::pair<Code, const  char*>{ Code::Round, "round" },
-        std::pair<Code, const  char*>{ Code::Truncate, "truncate" },
-        std::pair<Code, const  char*>{ Code::Sqrt, "sqrt" },
-        std::pair<Code, const  char*>{ Code::Sin, "sin" },
-        std::pair<Code, const  char*>{ Code::Cos, "cos" },
-        std::pair<Code, const  char*>{ Code::Atan, "atan" },
-        std::pair<Code, const  char*>{ Code::Exp, "exp" },
-        std::pair<Code, const  char*>{ Code::Ln, "ln" },
-        std::pair<Code, const  char*>{ Code::Log, "log" },
-        std::pair<Code, const  char*>{ Code::Cvi, "cvi" },
-        std::pair<Code, const  char*>{ Code::Cvr, "cvr" },
+public:
+    static constexpr uint16_t NO_REGISTER = std::numeric_limits<uint16_t>::max();
+    static constexpr size_t MAX_REGISTER_COUNT = 1024;
 
-        // B.2 Relational, Boolean and Bitwise operators
-        std::pair<Code, const  char*>{ Code::Eq, "eq" },
-        std::pair<Code, const  char*>{ Code::Ne, "ne" },
-        std::pair<Code, const  char*>{ Code::Gt, "gt" },
-        std::pair<Code, const  char*>{ Code::Ge, "ge" },
-        std::pair<Code, const  char*>{ Code::Lt, "lt" },
-        std::pair<Code, const  char*>{ Code::Le, "le" },
-        std::pair<Code, const  char*>{ Code::And, "and" },
-        std::pair<Code, const  char*>{ Code::Or, "or" },
-        std::pair<Code, const  char*>{ Code::Xor, "xor" },
-        std::pair<Code, const  char*>{ Code::Not, "not" },
-        std::pair<Code, const  char*>{ Code::Bitshift, "bitshift" },
-        std::pair<Code, const  char*>{ Code::True, "true" },
-        std::pair<Code, const  char*>{ Code::False, "false" },
+    enum class OpCode : uint8_t
+    {
+        AddInteger,
+        AddReal,
+        SubInteger,
+        SubReal,
+        MulInteger,
+        MulReal,
+        DivReal,
+        IdivInteger,
+        ModInteger,
+        NegInteger,
+        NegReal,
+        AbsInteger,
+        AbsReal,
+        CeilingReal,
+        FloorReal,
+        RoundReal,
+        TruncateReal,
+        SqrtReal,
+        SinReal,
+        CosReal,
+        AtanReal,
+        ExpReal,
+        LnReal,
+        LogReal,
+        CviReal,
+        CvrInteger,
+        EqInteger,
+        EqBoolean,
+        EqReal,
+        NeInteger,
+        NeBoolean,
+        NeReal,
+        GtInteger,
+        GtReal,
+        GeInteger,
+        GeReal,
+        LtInteger,
+        LtReal,
+        LeInteger,
+        LeReal,
+        AndInteger,
+        AndBoolean,
+        OrInteger,
+        OrBoolean,
+        XorInteger,
+        XorBoolean,
+        NotInteger,
+        NotBoolean,
+        Bitshift,
+        Select
+    };
 
-        // B.3 Conditional operators
-        std::pair<Code, const  char*>{ Code::If, "if" },
-        std::pair<Code, const  char*>{ Code::IfElse, "ifelse" },
+    union Register
+    {
+        PDFReal real;
+        PDFInteger integer;
+        bool boolean;
+    };
 
-        // B.4 Stack operators
-        std::pair<Code, const  char*>{ Code::Pop, "pop" },
-        std::pair<Code, const  char*>{ Code::Exch, "exch" },
-        std::pair<Code, const  char*>{ Code::Dup, "dup" },
-        std::pair<Code, const  char*>{ Code::Copy, "copy" },
-        std::pair<Code, const  char*>{ Code::Index, "index" },
-        std::pair<Code, const  char*>{ Code::Roll, "roll" }
+    struct Instruction
+    {
+        OpCode code = OpCode::Select;
+        uint16_t result = 0;            ///< Register of the result
+        uint16_t a = 0;                 ///< Register of the first operand
+        uint16_t b = 0;                 ///< Register of the second operand
+        uint16_t c = NO_REGISTER;       ///< Register of the predicate (condition for select)
     };
 
-    for (const std::pair<Code, const  char*>& codeItem : codes)
+    /// Executes the program. Returns false, if runtime error occurs.
+    /// \param inputs Input values (clamped to the domain)
+    /// \param outputs Output values (not clamped to the range)
+    bool execute(const PDFReal* inputs, PDFReal* outputs) const;
+
+    /// Executes single instruction. Returns false, if instruction fails
+    /// and its predicate is true.
+    /// \param instruction Instruction
+    /// \param registers Registers
+    static bool executeInstruction(const Instruction& instruction, Register* registers);
+
+    /// Initial values of registers (values of constants)
+    std::vector<Register> registers;
+
+    /// Instructions of the program
+    std::vector<Instruction> instructions;
+
+    /// Registers of the output values
+    std::vector<uint16_t> outputs;
+
+    /// Number of input values (they occupy first registers)
+    size_t inputCount = 0;
+};
+
+bool PDFPostScriptFunctionCompiledProgram::execute(const PDFReal* inputs, PDFReal* outputs) const
+{
+    std::array<Register, MAX_REGISTER_COUNT> currentRegisters;
+    std::copy(registers.cbegin(), registers.cend(), currentRegisters.begin());
+
+    for (size_t i = 0; i < inputCount; ++i)
     {
-        if (byteArray == codeItem.second)
+        currentRegisters[i].real = inputs[i];
+    }
+
+    for (const Instruction& instruction : instructions)
+    {
+        if (!executeInstruction(instruction, currentRegisters.data()))
         {
-            return codeItem.first;
+            return false;
         }
     }
 
-    throw PDFException(PDFTranslationContext::tr("Invalid operator (PostScript function) '%1'.").arg(QString::fromLatin1(byteArray)));
-}
+    for (size_t i = 0; i < this->outputs.size(); ++i)
+    {
+        outputs[i] = currentRegisters[this->outputs[i]].real;
+    }
 
-PDFPostScriptFunction::PDFPostScriptFunction(uint32_t m, uint32_t n, std::vector<PDFReal>&& domain, std::vector<PDFReal>&& range, PDFPostScriptFunction::Program&& program) :
-    PDFFunction(m, n, std::move(domain), std::move(range)),
-    m_program(std::move(program))
-{
-    Q_ASSERT(!m_program.empty());
+    return true;
 }
 
-PDFPostScriptFunction::~PDFPostScriptFunction()
+bool PDFPostScriptFunctionCompiledProgram::executeInstruction(const Instruction& instruction, Register* registers)
 {
+    using PDFIntegerUnsigned = std::make_unsigned<PDFInteger>::type;
 
-}
+    const Register a = registers[instruction.a];
+    const Register b = registers[instruction.b];
+    const bool isPredicateTrue = instruction.c == NO_REGISTER || registers[instruction.c].boolean;
+    Register& result = registers[instruction.result];
 
-PDFPostScriptFunction::Program PDFPostScriptFunction::parseProgram(const QByteArray& byteArray)
-{
-    // Lexical analyzer can't handle when '{' or '}' is near next token (for example '{0' etc.)
-    QByteArray adjustedArray = byteArray;
-    adjustedArray.replace('{', " { ").replace('}', " } ");
+    switch (instruction.code)
+    {
+        case OpCode::AddInteger:
+            result.integer = a.integer + b.integer;
+            break;
 
-    Program result;
-    PDFLexicalAnalyzer parser(adjustedArray.constBegin(), adjustedArray.constEnd());
-    parser.setTokenizingPostScriptFunction();
+        case OpCode::AddReal:
+            result.real = a.real + b.real;
+            break;
 
-    std::stack<InstructionPointer> blockCallStack;
-    while (true)
-    {
-        PDFLexicalAnalyzer::Token token = parser.fetch();
-        if (token.type == PDFLexicalAnalyzer::TokenType::EndOfFile)
+        case OpCode::SubInteger:
+            result.integer = a.integer - b.integer;
+            break;
+
+        case OpCode::SubReal:
+            result.real = a.real - b.real;
+            break;
+
+        case OpCode::MulInteger:
+            result.integer = a.integer * b.integer;
+            break;
+
+        case OpCode::MulReal:
+            result.real = a.real * b.real;
+            break;
+
+        case OpCode::DivReal:
         {
-            // We are at end, stop the parsing
+            if (qFuzzyIsNull(b.real))
+            {
+                result.real = 0.0;
+                return !isPredicateTrue;
+            }
+
+            result.real = a.real / b.real;
             break;
         }
 
-        switch (token.type)
+        case OpCode::IdivInteger:
         {
-            case PDFLexicalAnalyzer::TokenType::Boolean:
+            if (b.integer == 0)
             {
-                result.emplace_back(OperandObject::createBoolean(token.data.toBool()), result.size() + 1);
-                break;
+                result.integer = 0;
+                return !isPredicateTrue;
             }
 
-            case PDFLexicalAnalyzer::TokenType::Integer:
+            // Avoid overflow of the minimal integer value divided by -1
+            result.integer = (b.integer != -1) ? a.integer / b.integer : static_cast<PDFInteger>(PDFIntegerUnsigned(0) - static_cast<PDFIntegerUnsigned>(a.integer));
+            break;
+        }
+
+        case OpCode::ModInteger:
+        {
+            if (b.integer == 0)
             {
-                result.emplace_back(OperandObject::createInteger(token.data.toLongLong()), result.size() + 1);
-                break;
+                result.integer = 0;
+                return !isPredicateTrue;
             }
 
-            case PDFLexicalAnalyzer::TokenType::Real:
+            result.integer = (b.integer != -1) ? a.integer % b.integer : 0;
+            break;
+        }
+
+        case OpCode::NegInteger:
+            result.integer = -a.integer;
+            break;
+
+        case OpCode::NegReal:
+            result.real = -a.real;
+            break;
+
+        case OpCode::AbsInteger:
+            result.integer = qAbs(a.integer);
+            break;
+
+        case OpCode::AbsReal:
+            result.real = qAbs(a.real);
+            break;
+
+        case OpCode::CeilingReal:
+            result.real = std::ceil(a.real);
+            break;
+
+        case OpCode::FloorReal:
+            result.real = std::floor(a.real);
+            break;
+
+        case OpCode::RoundReal:
+            result.real = qRound(a.real);
+            break;
+
+        case OpCode::TruncateReal:
+            result.real = std::trunc(a.real);
+            break;
+
+        case OpCode::SqrtReal:
+        {
+            if (a.real < 0.0)
             {
-                result.emplace_back(OperandObject::createReal(token.data.toDouble()), result.size() + 1);
-                break;
+                result.real = 0.0;
+                return !isPredicateTrue;
             }
 
-            case PDFLexicalAnalyzer::TokenType::Command:
-            {
-                QByteArray command = token.data.toByteArray();
-                if (command == "{")
-                {
-                    // Opening bracket - means start of block
-                    blockCallStack.push(result.size());
-                    result.emplace_back(Code::Call, INVALID_INSTRUCTION_POINTER);
+            result.real = std::sqrt(a.real);
+            break;
+        }
+
+        case OpCode::SinReal:
+            result.real = qSin(qDegreesToRadians(a.real));
+            break;
+
+        case OpCode::CosReal:
+            result.real = qCos(qDegreesToRadians(a.real));
+            break;
+
+        case OpCode::AtanReal:
+        {
+            const PDFReal angles = qRadiansToDegrees(qAtan2(a.real, b.real));
+            result.real = angles < 0.0 ? (angles + 360.0) : angles;
+            break;
+        }
+
+        case OpCode::ExpReal:
+            result.real = qPow(a.real, b.real);
+            break;
+
+        case OpCode::LnReal:
+        case OpCode::LogReal:
+        {
+            if (a.real < 0.0 || qFuzzyIsNull(a.real))
+            {
+                result.real = 0.0;
+                return !isPredicateTrue;
+            }
+
+            result.real = (instruction.code == OpCode::LnReal) ? qLn(a.real) : std::log10(a.real);
+            break;
+        }
+
+        case OpCode::CviReal:
+            result.integer = static_cast<PDFInteger>(a.real);
+            break;
+
+        case OpCode::CvrInteger:
+            result.real = a.integer;
+            break;
+
+        case OpCode::EqInteger:
+            result.boolean = a.integer == b.integer;
+            break;
+
+        case OpCode::EqBoolean:
+            result.boolean = a.boolean == b.boolean;
+            break;
+
+        case OpCode::EqReal:
+            result.boolean = a.real == b.real;
+            break;
+
+        case OpCode::NeInteger:
+            result.boolean = a.integer != b.integer;
+            break;
+
+        case OpCode::NeBoolean:
+            result.boolean = a.boolean != b.boolean;
+            break;
+
+        case OpCode::NeReal:
+            result.boolean = a.real != b.real;
+            break;
+
+        case OpCode::GtInteger:
+            result.boolean = a.integer > b.integer;
+            break;
+
+        case OpCode::GtReal:
+            result.boolean = a.real > b.real;
+            break;
+
+        case OpCode::GeInteger:
+            result.boolean = a.integer >= b.integer;
+            break;
+
+        case OpCode::GeReal:
+            result.boolean = a.real >= b.real;
+            break;
+
+        case OpCode::LtInteger:
+            result.boolean = a.integer < b.integer;
+            break;
+
+        case OpCode::LtReal:
+            result.boolean = a.real < b.real;
+            break;
+
+        case OpCode::LeInteger:
+            result.boolean = a.integer <= b.integer;
+            break;
+
+        case OpCode::LeReal:
+            result.boolean = a.real <= b.real;
+            break;
+
+        case OpCode::AndInteger:
+            result.integer = static_cast<PDFInteger>(static_cast<PDFIntegerUnsigned>(a.integer) & static_cast<PDFIntegerUnsigned>(b.integer));
+            break;
+
+        case OpCode::AndBoolean:
+            result.boolean = a.boolean && b.boolean;
+            break;
+
+        case OpCode::OrInteger:
+            result.integer = static_cast<PDFInteger>(static_cast<PDFIntegerUnsigned>(a.integer) | static_cast<PDFIntegerUnsigned>(b.integer));
+            break;
+
+        case OpCode::OrBoolean:
+            result.boolean = a.boolean || b.boolean;
+            break;
+
+        case OpCode::XorInteger:
+            result.integer = static_cast<PDFInteger>(static_cast<PDFIntegerUnsigned>(a.integer) ^ static_cast<PDFIntegerUnsigned>(b.integer));
+            break;
+
+        case OpCode::XorBoolean:
+            result.boolean = a.boolean != b.boolean;
+            break;
+
+        case OpCode::NotInteger:
+            result.integer = static_cast<PDFInteger>(~static_cast<PDFIntegerUnsigned>(a.integer));
+            break;
+
+        case OpCode::NotBoolean:
+            result.boolean = !a.boolean;
+            break;
+
+        case OpCode::Bitshift:
+        {
+            const PDFIntegerUnsigned value = static_cast<PDFIntegerUnsigned>(a.integer);
+            const PDFInteger shift = b.integer;
+            const PDFInteger bitCount = std::numeric_limits<PDFIntegerUnsigned>::digits;
+
+            PDFIntegerUnsigned shiftedValue = value;
+            if (shift > 0)
+            {
+                // Positive is left
+                shiftedValue = (shift < bitCount) ? (value << shift) : 0;
+            }
+            else if (shift < 0)
+            {
+                // Negative is right
+                shiftedValue = (-shift < bitCount) ? (value >> -shift) : 0;
+            }
+
+            result.integer = static_cast<PDFInteger>(shiftedValue);
+            break;
+        }
+
+        case OpCode::Select:
+            result = isPredicateTrue ? a : b;
+            break;
+    }
+
+    return true;
+}
+
+/// Compiles the postscript program to the straight-line code. Program is executed
+/// symbolically - operands on the stack are registers instead of values, and their
+/// types must be known at compile time. Only programs, which are executed without errors
+/// by the interpreter (except errors depending on input values), can be compiled.
+class PDFPostScriptFunctionCompiler
+{
+public:
+    using Program = PDFPostScriptFunction::Program;
+    using CodeObject = PDFPostScriptFunction::CodeObject;
+    using OperandObject = PDFPostScriptFunction::OperandObject;
+    using OperandType = PDFPostScriptFunction::OperandType;
+    using InstructionPointer = PDFPostScriptFunction::InstructionPointer;
+    using CompiledProgram = PDFPostScriptFunctionCompiledProgram;
+    using OpCode = CompiledProgram::OpCode;
+    using Register = CompiledProgram::Register;
+    using Instruction = CompiledProgram::Instruction;
+    using Stack = PDFPostScriptFunctionStack;
+
+    explicit inline PDFPostScriptFunctionCompiler(const Program& program) :
+        m_program(program)
+    {
+
+    }
+
+    /// Compiles the program. If program can't be compiled, nullptr is returned.
+    /// \param m Number of input variables
+    /// \param n Number of output variables
+    std::unique_ptr<const CompiledProgram> compile(uint32_t m, uint32_t n);
+
+private:
+    static constexpr size_t MAX_INSTRUCTION_COUNT = 4096;
+    static constexpr size_t MAX_BLOCK_DEPTH = 64;
+
+    /// Stops the compilation, program can't be compiled
+    [[noreturn]] static void fail() { throw PDFPostScriptFunction::PDFPostScriptFunctionException(QString()); }
+
+    /// Creates operand on the symbolic stack, which refers to the register
+    static OperandObject createOperand(OperandType type, uint16_t registerIndex);
+
+    /// Returns register referred by the operand
+    static uint16_t getRegister(const OperandObject& operand) { return static_cast<uint16_t>(operand.instructionPointer); }
+
+    /// Compiles the block of instructions starting at given instruction pointer
+    /// \param ip Instruction pointer of the first instruction
+    /// \param stack Symbolic stack
+    /// \param predicate Predicate of the block
+    /// \param depth Depth of the block (zero for the program)
+    void compileBlock(InstructionPointer ip, Stack& stack, uint16_t predicate, size_t depth);
+
+    /// Creates new register
+    /// \param value Value of the register
+    /// \param isConstant Is value of the register known at compile time?
+    uint16_t createRegister(Register value, bool isConstant);
+
+    /// Emits instruction and returns register of its result. If all operands are
+    /// constant, instruction is evaluated at compile time and isn't emitted.
+    uint16_t emit(OpCode code, uint16_t a, uint16_t b, uint16_t c = CompiledProgram::NO_REGISTER);
+
+    /// Creates predicate of the nested block
+    uint16_t createPredicate(uint16_t predicate, uint16_t condition);
+
+    uint16_t popReal(Stack& stack);
+    uint16_t popInteger(Stack& stack);
+    uint16_t popBoolean(Stack& stack);
+    uint16_t popNumber(Stack& stack);
+    PDFInteger popConstantInteger(Stack& stack);
+
+    void compileArithmeticOperator(Stack& stack, OpCode integerCode, OpCode realCode);
+    void compileEqualityOperator(Stack& stack, OpCode integerCode, OpCode booleanCode, OpCode realCode);
+    void compileRelationOperator(Stack& stack, OpCode integerCode, OpCode realCode);
+    void compileLogicalOperator(Stack& stack, OpCode integerCode, OpCode booleanCode);
+
+    /// Merges stacks of the conditional blocks. Each operand of the resulting stack is
+    /// selected from \p trueStack, or from \p stack, according to the condition.
+    /// \param stack Stack of the false block, it receives the result
+    /// \param trueStack Stack of the true block
+    /// \param condition Condition register
+    void merge(Stack& stack, Stack trueStack, uint16_t condition);
+
+    const Program& m_program;
+    std::vector<Register> m_registers;
+    std::vector<bool> m_isConstant;
+    std::vector<Instruction> m_instructions;
+};
+
+std::unique_ptr<const PDFPostScriptFunctionCompiledProgram> PDFPostScriptFunctionCompiler::compile(uint32_t m, uint32_t n)
+{
+    try
+    {
+        Stack stack;
+
+        // Inputs occupy first registers
+        for (uint32_t i = 0; i < m; ++i)
+        {
+            stack.push(createOperand(OperandType::Real, createRegister(Register(), false)));
+        }
+
+        compileBlock(0, stack, CompiledProgram::NO_REGISTER, 0);
+
+        if (stack.size() != n)
+        {
+            fail();
+        }
+
+        std::vector<uint16_t> outputs(n, 0);
+        for (size_t i = n; i > 0; --i)
+        {
+            outputs[i - 1] = popNumber(stack);
+        }
+
+        std::unique_ptr<CompiledProgram> compiledProgram = std::make_unique<CompiledProgram>();
+        compiledProgram->registers = std::move(m_registers);
+        compiledProgram->instructions = std::move(m_instructions);
+        compiledProgram->outputs = std::move(outputs);
+        compiledProgram->inputCount = m;
+        compiledProgram->instructions.shrink_to_fit();
+        return compiledProgram;
+    }
+    catch (const PDFPostScriptFunction::PDFPostScriptFunctionException&)
+    {
+        // Program can't be compiled, interpreter will be used
+    }
+
+    return nullptr;
+}
+
+PDFPostScriptFunction::OperandObject PDFPostScriptFunctionCompiler::createOperand(OperandType type, uint16_t registerIndex)
+{
+    OperandObject operand = OperandObject::createInstructionPointer(registerIndex);
+    operand.type = type;
+    return operand;
+}
+
+void PDFPostScriptFunctionCompiler::compileBlock(InstructionPointer ip, Stack& stack, uint16_t predicate, size_t depth)
+{
+    if (depth > MAX_BLOCK_DEPTH)
+    {
+        fail();
+    }
+
+    while (ip != PDFPostScriptFunction::INVALID_INSTRUCTION_POINTER)
+    {
+        if (ip >= m_program.size())
+        {
+            fail();
+        }
+
+        const CodeObject& instruction = m_program[ip];
+        switch (instruction.code)
+        {
+            case PDFPostScriptFunction::Code::Add:
+                compileArithmeticOperator(stack, OpCode::AddInteger, OpCode::AddReal);
+                break;
+
+            case PDFPostScriptFunction::Code::Sub:
+                compileArithmeticOperator(stack, OpCode::SubInteger, OpCode::SubReal);
+                break;
+
+            case PDFPostScriptFunction::Code::Mul:
+                compileArithmeticOperator(stack, OpCode::MulInteger, OpCode::MulReal);
+                break;
+
+            case PDFPostScriptFunction::Code::Div:
+            {
+                const uint16_t b = popNumber(stack);
+                const uint16_t a = popNumber(stack);
+                stack.push(createOperand(OperandType::Real, emit(OpCode::DivReal, a, b, predicate)));
+                break;
+            }
+
+            case PDFPostScriptFunction::Code::Idiv:
+            case PDFPostScriptFunction::Code::Mod:
+            {
+                const uint16_t b = popInteger(stack);
+                const uint16_t a = popInteger(stack);
+                const OpCode code = (instruction.code == PDFPostScriptFunction::Code::Idiv) ? OpCode::IdivInteger : OpCode::ModInteger;
+                stack.push(createOperand(OperandType::Integer, emit(code, a, b, predicate)));
+                break;
+            }
+
+            case PDFPostScriptFunction::Code::Neg:
+            case PDFPostScriptFunction::Code::Abs:
+            {
+                const bool isNeg = instruction.code == PDFPostScriptFunction::Code::Neg;
+                if (stack.isInteger())
+                {
+                    const uint16_t a = popInteger(stack);
+                    stack.push(createOperand(OperandType::Integer, emit(isNeg ? OpCode::NegInteger : OpCode::AbsInteger, a, a)));
+                }
+                else
+                {
+                    const uint16_t a = popReal(stack);
+                    stack.push(createOperand(OperandType::Real, emit(isNeg ? OpCode::NegReal : OpCode::AbsReal, a, a)));
+                }
+                break;
+            }
+
+            case PDFPostScriptFunction::Code::Ceiling:
+            case PDFPostScriptFunction::Code::Floor:
+            case PDFPostScriptFunction::Code::Round:
+            case PDFPostScriptFunction::Code::Truncate:
+            {
+                if (stack.isReal())
+                {
+                    OpCode code = OpCode::CeilingReal;
+                    switch (instruction.code)
+                    {
+                        case PDFPostScriptFunction::Code::Floor:
+                            code = OpCode::FloorReal;
+                            break;
+
+                        case PDFPostScriptFunction::Code::Round:
+                            code = OpCode::RoundReal;
+                            break;
+
+                        case PDFPostScriptFunction::Code::Truncate:
+                            code = OpCode::TruncateReal;
+                            break;
+
+                        default:
+                            break;
+                    }
+
+                    const uint16_t a = popReal(stack);
+                    stack.push(createOperand(OperandType::Real, emit(code, a, a)));
+                }
+                else if (!stack.isInteger())
+                {
+                    fail();
+                }
+                break;
+            }
+
+            case PDFPostScriptFunction::Code::Sqrt:
+            case PDFPostScriptFunction::Code::Ln:
+            case PDFPostScriptFunction::Code::Log:
+            {
+                OpCode code = OpCode::SqrtReal;
+                if (instruction.code != PDFPostScriptFunction::Code::Sqrt)
+                {
+                    code = (instruction.code == PDFPostScriptFunction::Code::Ln) ? OpCode::LnReal : OpCode::LogReal;
+                }
+
+                const uint16_t a = popNumber(stack);
+                stack.push(createOperand(OperandType::Real, emit(code, a, a, predicate)));
+                break;
+            }
+
+            case PDFPostScriptFunction::Code::Sin:
+            case PDFPostScriptFunction::Code::Cos:
+            {
+                const uint16_t a = popNumber(stack);
+                stack.push(createOperand(OperandType::Real, emit(instruction.code == PDFPostScriptFunction::Code::Sin ? OpCode::SinReal : OpCode::CosReal, a, a)));
+                break;
+            }
+
+            case PDFPostScriptFunction::Code::Atan:
+            case PDFPostScriptFunction::Code::Exp:
+            {
+                const uint16_t b = popNumber(stack);
+                const uint16_t a = popNumber(stack);
+                stack.push(createOperand(OperandType::Real, emit(instruction.code == PDFPostScriptFunction::Code::Atan ? OpCode::AtanReal : OpCode::ExpReal, a, b)));
+                break;
+            }
+
+            case PDFPostScriptFunction::Code::Cvi:
+            {
+                if (stack.isReal())
+                {
+                    const uint16_t a = popReal(stack);
+                    stack.push(createOperand(OperandType::Integer, emit(OpCode::CviReal, a, a)));
+                }
+                else if (!stack.isInteger())
+                {
+                    fail();
+                }
+                break;
+            }
+
+            case PDFPostScriptFunction::Code::Cvr:
+            {
+                if (stack.isInteger())
+                {
+                    const uint16_t a = popInteger(stack);
+                    stack.push(createOperand(OperandType::Real, emit(OpCode::CvrInteger, a, a)));
+                }
+                else if (!stack.isReal())
+                {
+                    fail();
+                }
+                break;
+            }
+
+            case PDFPostScriptFunction::Code::Eq:
+                compileEqualityOperator(stack, OpCode::EqInteger, OpCode::EqBoolean, OpCode::EqReal);
+                break;
+
+            case PDFPostScriptFunction::Code::Ne:
+                compileEqualityOperator(stack, OpCode::NeInteger, OpCode::NeBoolean, OpCode::NeReal);
+                break;
+
+            case PDFPostScriptFunction::Code::Gt:
+                compileRelationOperator(stack, OpCode::GtInteger, OpCode::GtReal);
+                break;
+
+            case PDFPostScriptFunction::Code::Ge:
+                compileRelationOperator(stack, OpCode::GeInteger, OpCode::GeReal);
+                break;
+
+            case PDFPostScriptFunction::Code::Lt:
+                compileRelationOperator(stack, OpCode::LtInteger, OpCode::LtReal);
+                break;
+
+            case PDFPostScriptFunction::Code::Le:
+                compileRelationOperator(stack, OpCode::LeInteger, OpCode::LeReal);
+                break;
+
+            case PDFPostScriptFunction::Code::And:
+                compileLogicalOperator(stack, OpCode::AndInteger, OpCode::AndBoolean);
+                break;
+
+            case PDFPostScriptFunction::Code::Or:
+                compileLogicalOperator(stack, OpCode::OrInteger, OpCode::OrBoolean);
+                break;
+
+            case PDFPostScriptFunction::Code::Xor:
+                compileLogicalOperator(stack, OpCode::XorInteger, OpCode::XorBoolean);
+                break;
+
+            case PDFPostScriptFunction::Code::Not:
+            {
+                if (stack.isInteger())
+                {
+                    const uint16_t a = popInteger(stack);
+                    stack.push(createOperand(OperandType::Integer, emit(OpCode::NotInteger, a, a)));
+                }
+                else
+                {
+                    const uint16_t a = popBoolean(stack);
+                    stack.push(createOperand(OperandType::Boolean, emit(OpCode::NotBoolean, a, a)));
+                }
+                break;
+            }
+
+            case PDFPostScriptFunction::Code::Bitshift:
+            {
+                const uint16_t shift = popInteger(stack);
+                const uint16_t value = popInteger(stack);
+                stack.push(createOperand(OperandType::Integer, emit(OpCode::Bitshift, value, shift)));
+                break;
+            }
+
+            case PDFPostScriptFunction::Code::True:
+            case PDFPostScriptFunction::Code::False:
+            {
+                Register value = Register();
+                value.boolean = instruction.code == PDFPostScriptFunction::Code::True;
+                stack.push(createOperand(OperandType::Boolean, createRegister(value, true)));
+                break;
+            }
+
+            case PDFPostScriptFunction::Code::If:
+            {
+                const InstructionPointer blockIp = stack.popInstructionPointer();
+                const uint16_t condition = popBoolean(stack);
+
+                if (m_isConstant[condition])
+                {
+                    if (m_registers[condition].boolean)
+                    {
+                        compileBlock(blockIp, stack, predicate, depth + 1);
+                    }
+                }
+                else
+                {
+                    Stack trueStack = stack;
+                    compileBlock(blockIp, trueStack, createPredicate(predicate, condition), depth + 1);
+                    merge(stack, std::move(trueStack), condition);
+                }
+                break;
+            }
+
+            case PDFPostScriptFunction::Code::IfElse:
+            {
+                const InstructionPointer falsePartIp = stack.popInstructionPointer();
+                const InstructionPointer truePartIp = stack.popInstructionPointer();
+                const uint16_t condition = popBoolean(stack);
+
+                if (m_isConstant[condition])
+                {
+                    compileBlock(m_registers[condition].boolean ? truePartIp : falsePartIp, stack, predicate, depth + 1);
+                }
+                else
+                {
+                    Stack trueStack = stack;
+                    compileBlock(truePartIp, trueStack, createPredicate(predicate, condition), depth + 1);
+                    compileBlock(falsePartIp, stack, createPredicate(predicate, emit(OpCode::NotBoolean, condition, condition)), depth + 1);
+                    merge(stack, std::move(trueStack), condition);
+                }
+                break;
+            }
+
+            case PDFPostScriptFunction::Code::Pop:
+                stack.pop();
+                break;
+
+            case PDFPostScriptFunction::Code::Exch:
+                stack.exch();
+                break;
+
+            case PDFPostScriptFunction::Code::Dup:
+                stack.dup();
+                break;
+
+            case PDFPostScriptFunction::Code::Copy:
+            {
+                const PDFInteger count = popConstantInteger(stack);
+
+                if (count < 0)
+                {
+                    fail();
+                }
+
+                if (count > 0)
+                {
+                    stack.copy(count);
+                }
+                break;
+            }
+
+            case PDFPostScriptFunction::Code::Index:
+            {
+                const PDFInteger index = popConstantInteger(stack);
+
+                if (index < 0)
+                {
+                    fail();
+                }
+
+                stack.index(index);
+                break;
+            }
+
+            case PDFPostScriptFunction::Code::Roll:
+            {
+                const PDFInteger j = popConstantInteger(stack);
+                const PDFInteger count = popConstantInteger(stack);
+
+                if (count < 0)
+                {
+                    fail();
+                }
+
+                stack.roll(count, j);
+                break;
+            }
+
+            case PDFPostScriptFunction::Code::Call:
+                stack.pushInstructionPointer(instruction.operand.instructionPointer);
+                break;
+
+            case PDFPostScriptFunction::Code::Execute:
+                compileBlock(stack.popInstructionPointer(), stack, predicate, depth + 1);
+                break;
+
+            case PDFPostScriptFunction::Code::Return:
+            {
+                if (depth == 0)
+                {
+                    fail();
+                }
+                return;
+            }
+
+            case PDFPostScriptFunction::Code::Push:
+            {
+                Register value = Register();
+                switch (instruction.operand.type)
+                {
+                    case OperandType::Real:
+                        value.real = instruction.operand.realNumber;
+                        break;
+
+                    case OperandType::Integer:
+                        value.integer = instruction.operand.integerNumber;
+                        break;
+
+                    case OperandType::Boolean:
+                        value.boolean = instruction.operand.boolean;
+                        break;
+
+                    case OperandType::InstructionPointer:
+                        stack.push(instruction.operand);
+                        ip = instruction.next;
+                        continue;
+                }
+
+                stack.push(createOperand(instruction.operand.type, createRegister(value, true)));
+                break;
+            }
+        }
+
+        // Move to the next instruction
+        ip = instruction.next;
+    }
+
+    // Only the program can end without return instruction
+    if (depth > 0)
+    {
+        fail();
+    }
+}
+
+uint16_t PDFPostScriptFunctionCompiler::createRegister(Register value, bool isConstant)
+{
+    if (m_registers.size() >= CompiledProgram::MAX_REGISTER_COUNT)
+    {
+        fail();
+    }
+
+    m_registers.push_back(value);
+    m_isConstant.push_back(isConstant);
+    return static_cast<uint16_t>(m_registers.size() - 1);
+}
+
+uint16_t PDFPostScriptFunctionCompiler::emit(OpCode code, uint16_t a, uint16_t b, uint16_t c)
+{
+    Instruction instruction;
+    instruction.code = code;
+    instruction.result = createRegister(Register(), false);
+    instruction.a = a;
+    instruction.b = b;
+    instruction.c = c;
+
+    const bool isFoldable = m_isConstant[a] && m_isConstant[b] && (c == CompiledProgram::NO_REGISTER || m_isConstant[c]);
+    if (isFoldable && CompiledProgram::executeInstruction(instruction, m_registers.data()))
+    {
+        // Constant expression, value is known at compile time
+        m_isConstant[instruction.result] = true;
+    }
+    else
+    {
+        if (m_instructions.size() >= MAX_INSTRUCTION_COUNT)
+        {
+            fail();
+        }
+
+        m_instructions.push_back(instruction);
+    }
+
+    return instruction.result;
+}
+
+uint16_t PDFPostScriptFunctionCompiler::createPredicate(uint16_t predicate, uint16_t condition)
+{
+    if (predicate == CompiledProgram::NO_REGISTER)
+    {
+        return condition;
+    }
+
+    return emit(OpCode::AndBoolean, predicate, condition);
+}
+
+uint16_t PDFPostScriptFunctionCompiler::popReal(Stack& stack)
+{
+    const OperandObject operand = stack.popOperand();
+    if (operand.type != OperandType::Real)
+    {
+        fail();
+    }
+    return getRegister(operand);
+}
+
+uint16_t PDFPostScriptFunctionCompiler::popInteger(Stack& stack)
+{
+    const OperandObject operand = stack.popOperand();
+    if (operand.type != OperandType::Integer)
+    {
+        fail();
+    }
+    return getRegister(operand);
+}
+
+uint16_t PDFPostScriptFunctionCompiler::popBoolean(Stack& stack)
+{
+    const OperandObject operand = stack.popOperand();
+    if (operand.type != OperandType::Boolean)
+    {
+        fail();
+    }
+    return getRegister(operand);
+}
+
+uint16_t PDFPostScriptFunctionCompiler::popNumber(Stack& stack)
+{
+    const OperandObject operand = stack.popOperand();
+    switch (operand.type)
+    {
+        case OperandType::Real:
+            return getRegister(operand);
+
+        case OperandType::Integer:
+            return emit(OpCode::CvrInteger, getRegister(operand), getRegister(operand));
+
+        default:
+            fail();
+    }
+}
+
+PDFInteger PDFPostScriptFunctionCompiler::popConstantInteger(Stack& stack)
+{
+    const uint16_t registerIndex = popInteger(stack);
+    if (!m_isConstant[registerIndex])
+    {
+        // Stack operations must be resolved at compile time
+        fail();
+    }
+    return m_registers[registerIndex].integer;
+}
+
+void PDFPostScriptFunctionCompiler::compileArithmeticOperator(Stack& stack, OpCode integerCode, OpCode realCode)
+{
+    if (stack.isBinaryOperationInteger())
+    {
+        const uint16_t b = popInteger(stack);
+        const uint16_t a = popInteger(stack);
+        stack.push(createOperand(OperandType::Integer, emit(integerCode, a, b)));
+    }
+    else
+    {
+        const uint16_t b = popNumber(stack);
+        const uint16_t a = popNumber(stack);
+        stack.push(createOperand(OperandType::Real, emit(realCode, a, b)));
+    }
+}
+
+void PDFPostScriptFunctionCompiler::compileEqualityOperator(Stack& stack, OpCode integerCode, OpCode booleanCode, OpCode realCode)
+{
+    if (stack.isBinaryOperationInteger())
+    {
+        const uint16_t b = popInteger(stack);
+        const uint16_t a = popInteger(stack);
+        stack.push(createOperand(OperandType::Boolean, emit(integerCode, a, b)));
+    }
+    else if (stack.isBinaryOperationBoolean())
+    {
+        const uint16_t b = popBoolean(stack);
+        const uint16_t a = popBoolean(stack);
+        stack.push(createOperand(OperandType::Boolean, emit(booleanCode, a, b)));
+    }
+    else
+    {
+        const uint16_t b = popNumber(stack);
+        const uint16_t a = popNumber(stack);
+        stack.push(createOperand(OperandType::Boolean, emit(realCode, a, b)));
+    }
+}
+
+void PDFPostScriptFunctionCompiler::compileRelationOperator(Stack& stack, OpCode integerCode, OpCode realCode)
+{
+    if (stack.isBinaryOperationInteger())
+    {
+        const uint16_t b = popInteger(stack);
+        const uint16_t a = popInteger(stack);
+        stack.push(createOperand(OperandType::Boolean, emit(integerCode, a, b)));
+    }
+    else
+    {
+        const uint16_t b = popNumber(stack);
+        const uint16_t a = popNumber(stack);
+        stack.push(createOperand(OperandType::Boolean, emit(realCode, a, b)));
+    }
+}
+
+void PDFPostScriptFunctionCompiler::compileLogicalOperator(Stack& stack, OpCode integerCode, OpCode booleanCode)
+{
+    if (stack.isBinaryOperationBoolean())
+    {
+        const uint16_t b = popBoolean(stack);
+        const uint16_t a = popBoolean(stack);
+        stack.push(createOperand(OperandType::Boolean, emit(booleanCode, a, b)));
+    }
+    else
+    {
+        const uint16_t b = popInteger(stack);
+        const uint16_t a = popInteger(stack);
+        stack.push(createOperand(OperandType::Integer, emit(integerCode, a, b)));
+    }
+}
+
+void PDFPostScriptFunctionCompiler::merge(Stack& stack, Stack trueStack, uint16_t condition)
+{
+    if (stack.size() != trueStack.size())
+    {
+        fail();
+    }
+
+    std::vector<OperandObject> operands(stack.size());
+    for (size_t i = operands.size(); i > 0; --i)
+    {
+        const OperandObject falseOperand = stack.popOperand();
+        const OperandObject trueOperand = trueStack.popOperand();
+
+        if (falseOperand.type != trueOperand.type)
+        {
+            fail();
+        }
+
+        if (falseOperand.instructionPointer == trueOperand.instructionPointer)
+        {
+            // Same register (or same block) in both stacks
+            operands[i - 1] = falseOperand;
+        }
+        else if (falseOperand.type == OperandType::InstructionPointer)
+        {
+            // Blocks are not registers, they can't be selected at runtime
+            fail();
+        }
+        else
+        {
+            operands[i - 1] = createOperand(falseOperand.type, emit(OpCode::Select, getRegister(trueOperand), getRegister(falseOperand), condition));
+        }
+    }
+
+    for (const OperandObject& operand : operands)
+    {
+        stack.push(operand);
+    }
+}
+
+PDFPostScriptFunction::Code PDFPostScriptFunction::getCode(const QByteArray& byteArray)
+{
+    static constexpr const std::pair<Code, const  char*> codes[] =
+    {
+        // B.1 Arithmetic operators
+        std::pair<Code, const  char*>{ Code::Add, "add" },
+        std::pair<Code, const  char*>{ Code::Sub, "sub" },
+        std::pair<Code, const  char*>{ Code::Mul, "mul" },
+        std::pair<Code, const  char*>{ Code::Div, "div" },
+        std::pair<Code, const  char*>{ Code::Idiv, "idiv" },
+        std::pair<Code, const  char*>{ Code::Mod, "mod" },
+        std::pair<Code, const  char*>{ Code::Neg, "neg" },
+        std::pair<Code, const  char*>{ Code::Abs, "abs" },
+        std::pair<Code, const  char*>{ Code::Ceiling, "ceiling" },
+        std::pair<Code, const  char*>{ Code::Floor, "floor" },
+        std::pair<Code, const  char*>{ Code::Round, "round" },
+        std::pair<Code, const  char*>{ Code::Truncate, "truncate" },
+        std::pair<Code, const  char*>{ Code::Sqrt, "sqrt" },
+        std::pair<Code, const  char*>{ Code::Sin, "sin" },
+        std::pair<Code, const  char*>{ Code::Cos, "cos" },
+        std::pair<Code, const  char*>{ Code::Atan, "atan" },
+        std::pair<Code, const  char*>{ Code::Exp, "exp" },
+        std::pair<Code, const  char*>{ Code::Ln, "ln" },
+        std::pair<Code, const  char*>{ Code::Log, "log" },
+        std::pair<Code, const  char*>{ Code::Cvi, "cvi" },
+        std::pair<Code, const  char*>{ Code::Cvr, "cvr" },
+
+        // B.2 Relational, Boolean and Bitwise operators
+        std::pair<Code, const  char*>{ Code::Eq, "eq" },
+        std::pair<Code, const  char*>{ Code::Ne, "ne" },
+        std::pair<Code, const  char*>{ Code::Gt, "gt" },
+        std::pair<Code, const  char*>{ Code::Ge, "ge" },
+        std::pair<Code, const  char*>{ Code::Lt, "lt" },
+        std::pair<Code, const  char*>{ Code::Le, "le" },
+        std::pair<Code, const  char*>{ Code::And, "and" },
+        std::pair<Code, const  char*>{ Code::Or, "or" },
+        std::pair<Code, const  char*>{ Code::Xor, "xor" },
+        std::pair<Code, const  char*>{ Code::Not, "not" },
+        std::pair<Code, const  char*>{ Code::Bitshift, "bitshift" },
+        std::pair<Code, const  char*>{ Code::True, "true" },
+        std::pair<Code, const  char*>{ Code::False, "false" },
+
+        // B.3 Conditional operators
+        std::pair<Code, const  char*>{ Code::If, "if" },
+        std::pair<Code, const  char*>{ Code::IfElse, "ifelse" },
+
+        // B.4 Stack operators
+        std::pair<Code, const  char*>{ Code::Pop, "pop" },
+        std::pair<Code, const  char*>{ Code::Exch, "exch" },
+        std::pair<Code, const  char*>{ Code::Dup, "dup" },
+        std::pair<Code, const  char*>{ Code::Copy, "copy" },
+        std::pair<Code, const  char*>{ Code::Index, "index" },
+        std::pair<Code, const  char*>{ Code::Roll, "roll" }
+    };
+
+    for (const std::pair<Code, const  char*>& codeItem : codes)
+    {
+        if (byteArray == codeItem.second)
+        {
+            return codeItem.first;
+        }
+    }
+
+    throw PDFException(PDFTranslationContext::tr("Invalid operator (PostScript function) '%1'.").arg(QString::fromLatin1(byteArray)));
+}
+
+PDFPostScriptFunction::PDFPostScriptFunction(uint32_t m, uint32_t n, std::vector<PDFReal>&& domain, std::vector<PDFReal>&& range, PDFPostScriptFunction::Program&& program) :
+    PDFFunction(m, n, std::move(domain), std::move(range)),
+    m_program(std::move(program))
+{
+    Q_ASSERT(!m_program.empty());
+
+    if (m <= DEFAULT_OPERAND_COUNT && n <= DEFAULT_OPERAND_COUNT)
+    {
+        m_compiledProgram = PDFPostScriptFunctionCompiler(m_program).compile(m, n);
+    }
+}
+
+PDFPostScriptFunction::~PDFPostScriptFunction()
+{
+
+}
+
+PDFPostScriptFunction::Program PDFPostScriptFunction::parseProgram(const QByteArray& byteArray)
+{
+    // Lexical analyzer can't handle when '{' or '}' is near next token (for example '{0' etc.)
+    QByteArray adjustedArray = byteArray;
+    adjustedArray.replace('{', " { ").replace('}', " } ");
+
+    Program result;
+    PDFLexicalAnalyzer parser(adjustedArray.constBegin(), adjustedArray.constEnd());
+    parser.setTokenizingPostScriptFunction();
+
+    std::stack<InstructionPointer> blockCallStack;
+    while (true)
+    {
+        PDFLexicalAnalyzer::Token token = parser.fetch();
+        if (token.type == PDFLexicalAnalyzer::TokenType::EndOfFile)
+        {
+            // We are at end, stop the parsing
+            break;
+        }
+
+        switch (token.type)
+        {
+            case PDFLexicalAnalyzer::TokenType::Boolean:
+            {
+                result.emplace_back(OperandObject::createBoolean(token.data.toBool()), result.size() + 1);
+                break;
+            }
+
+            case PDFLexicalAnalyzer::TokenType::Integer:
+            {
+                result.emplace_back(OperandObject::createInteger(token.data.toLongLong()), result.size() + 1);
+                break;
+            }
+
+            case PDFLexicalAnalyzer::TokenType::Real:
+            {
+                result.emplace_back(OperandObject::createReal(token.data.toDouble()), result.size() + 1);
+                break;
+            }
+
+            case PDFLexicalAnalyzer::TokenType::Command:
+            {
+                QByteArray command = token.data.toByteArray();
+                if (command == "{")
+                {
+                    // Opening bracket - means start of block
+                    blockCallStack.push(result.size());
+                    result.emplace_back(Code::Call, INVALID_INSTRUCTION_POINTER);
                     result.back().operand = OperandObject::createInstructionPointer(result.size());
                 }
                 else if (command == "}")
@@ -1843,6 +3193,201 @@ PDFFunction::FunctionResult PDFPostScriptFunction::apply(const_iterator x_1, con
         return PDFTranslationContext::tr("Invalid number of output variables for function. Expected %1, provided %2.").arg(m_n).arg(n);
     }
 
+    if (m_compiledProgram)
+    {
+        std::array<PDFReal, DEFAULT_OPERAND_COUNT> x = { };
+        for (uint32_t i = 0; i < m_m; ++i)
+        {
+            x[i] = clampInput(i, *std::next(x_1, i));
+        }
+
+        if (m_lookupTableReady.load(std::memory_order_acquire))
+        {
+            applyLookupTable(x.data(), y_1);
+            return true;
+        }
+
+        if (applyCompiled(x.data(), y_1))
+        {
+            // Create lookup table, if function is evaluated many times
+            if (m_m <= 2 && m_evaluationCount.load(std::memory_order_relaxed) < getLookupTableEvaluationThreshold() &&
+                m_evaluationCount.fetch_add(1, std::memory_order_relaxed) + 1 == getLookupTableEvaluationThreshold())
+            {
+                buildLookupTable();
+            }
+
+            return true;
+        }
+    }
+
+    return applyInterpreted(x_1, y_1, y_n);
+}
+
+bool PDFPostScriptFunction::applyCompiled(const PDFReal* x, PDFReal* y) const
+{
+    if (!m_compiledProgram || !m_compiledProgram->execute(x, y))
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < m_n; ++i)
+    {
+        y[i] = clampOutput(i, y[i]);
+    }
+
+    return true;
+}
+
+void PDFPostScriptFunction::applyLookupTable(const PDFReal* x, PDFReal* y) const
+{
+    const uint32_t size = (m_m == 1) ? LOOKUP_TABLE_SIZE_1D : LOOKUP_TABLE_SIZE_2D;
+
+    std::array<uint32_t, 2> indices = { };
+    std::array<PDFReal, 2> fractions = { };
+    for (uint32_t i = 0; i < m_m; ++i)
+    {
+        const PDFReal domainMin = m_domain[2 * i];
+        const PDFReal domainMax = m_domain[2 * i + 1];
+        const PDFReal position = qBound<PDFReal>(0.0, (x[i] - domainMin) / (domainMax - domainMin), 1.0) * (size - 1);
+        indices[i] = qMin(static_cast<uint32_t>(position), size - 2);
+        fractions[i] = position - indices[i];
+    }
+
+    if (m_m == 1)
+    {
+        const PDFReal* y0 = m_lookupTable.data() + indices[0] * m_n;
+        const PDFReal* y1 = y0 + m_n;
+
+        for (uint32_t i = 0; i < m_n; ++i)
+        {
+            y[i] = mix(fractions[0], y0[i], y1[i]);
+        }
+    }
+    else
+    {
+        const PDFReal* y00 = m_lookupTable.data() + (indices[1] * size + indices[0]) * m_n;
+        const PDFReal* y01 = y00 + m_n;
+        const PDFReal* y10 = y00 + size * m_n;
+        const PDFReal* y11 = y10 + m_n;
+
+        for (uint32_t i = 0; i < m_n; ++i)
+        {
+            y[i] = mix(fractions[1], mix(fractions[0], y00[i], y01[i]), mix(fractions[0], y10[i], y11[i]));
+        }
+    }
+}
+
+uint32_t PDFPostScriptFunction::getLookupTableEvaluationThreshold() const
+{
+    // Function is evaluated at samples and at the midpoints between them during
+    // creation of the lookup table. We create the table after the function was
+    // evaluated twice as many times, so the creation doesn't degrade performance.
+    if (m_m == 1)
+    {
+        return 2 * (2 * LOOKUP_TABLE_SIZE_1D - 1);
+    }
+
+    const uint32_t sampleCount = LOOKUP_TABLE_SIZE_2D * LOOKUP_TABLE_SIZE_2D;
+    const uint32_t edgeCount = 2 * LOOKUP_TABLE_SIZE_2D * (LOOKUP_TABLE_SIZE_2D - 1);
+    const uint32_t cellCount = (LOOKUP_TABLE_SIZE_2D - 1) * (LOOKUP_TABLE_SIZE_2D - 1);
+    return 2 * (sampleCount + edgeCount + cellCount);
+}
+
+void PDFPostScriptFunction::buildLookupTable() const
+{
+    if (m_m < 1 || m_m > 2 || m_n == 0 || !hasRange())
+    {
+        return;
+    }
+
+    for (uint32_t i = 0; i < m_m; ++i)
+    {
+        const PDFReal domainMin = m_domain[2 * i];
+        const PDFReal domainMax = m_domain[2 * i + 1];
+        if (!std::isfinite(domainMin) || !std::isfinite(domainMax) || domainMax <= domainMin)
+        {
+            return;
+        }
+    }
+
+    const uint32_t size = (m_m == 1) ? LOOKUP_TABLE_SIZE_1D : LOOKUP_TABLE_SIZE_2D;
+    const uint32_t sizeY = (m_m == 1) ? 1 : LOOKUP_TABLE_SIZE_2D;
+
+    auto getInput = [this, size](uint32_t index, PDFReal position)
+    {
+        return mix(position / (size - 1), m_domain[2 * index], m_domain[2 * index + 1]);
+    };
+
+    // Sample the function
+    std::vector<PDFReal> lookupTable(size * sizeY * m_n, 0.0);
+    for (uint32_t yIndex = 0; yIndex < sizeY; ++yIndex)
+    {
+        for (uint32_t xIndex = 0; xIndex < size; ++xIndex)
+        {
+            std::array<PDFReal, 2> x = { getInput(0, xIndex), (m_m == 2) ? getInput(1, yIndex) : 0.0 };
+            if (!applyCompiled(x.data(), lookupTable.data() + (yIndex * size + xIndex) * m_n))
+            {
+                return;
+            }
+        }
+    }
+
+    m_lookupTable = std::move(lookupTable);
+
+    // Verify, that interpolated values between samples are within the tolerance
+    std::array<PDFReal, DEFAULT_OPERAND_COUNT> exact = { };
+    std::array<PDFReal, DEFAULT_OPERAND_COUNT> interpolated = { };
+    auto verify = [&](PDFReal xPosition, PDFReal yPosition)
+    {
+        std::array<PDFReal, 2> x = { getInput(0, xPosition), (m_m == 2) ? getInput(1, yPosition) : 0.0 };
+        if (!applyCompiled(x.data(), exact.data()))
+        {
+            return false;
+        }
+
+        applyLookupTable(x.data(), interpolated.data());
+        for (uint32_t i = 0; i < m_n; ++i)
+        {
+            const PDFReal tolerance = LOOKUP_TABLE_TOLERANCE * qAbs(m_range[2 * i + 1] - m_range[2 * i]);
+            if (!(qAbs(exact[i] - interpolated[i]) <= tolerance))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    };
+
+    for (uint32_t yIndex = 0; yIndex < sizeY; ++yIndex)
+    {
+        for (uint32_t xIndex = 0; xIndex < size; ++xIndex)
+        {
+            const PDFReal xPosition = xIndex;
+            const PDFReal yPosition = yIndex;
+            const bool hasNextX = xIndex + 1 < size;
+            const bool hasNextY = yIndex + 1 < sizeY;
+
+            const bool isValid = (!hasNextX || verify(xPosition + 0.5, yPosition)) &&
+                                 (!hasNextY || verify(xPosition, yPosition + 0.5)) &&
+                                 (!hasNextX || !hasNextY || verify(xPosition + 0.5, yPosition + 0.5));
+
+            if (!isValid)
+            {
+                m_lookupTable.clear();
+                m_lookupTable.shrink_to_fit();
+                return;
+            }
+        }
+    }
+
+    m_lookupTableReady.store(true, std::memory_order_release);
+}
+
+PDFFunction::FunctionResult PDFPostScriptFunction::applyInterpreted(const_iterator x_1, iterator y_1, iterator y_n) const
+{
+    const size_t m = m_m;
+    const size_t n = std::distance(y_1, y_n);
+
     try
     {
         PDFPostScriptFunctionStack stack;
@@ -26,6 +26,7 @@
 #include "pdfglobal.h"
 
 #include <memory>
+#include <atomic>
 
 namespace pdf
 {
@@ -33,6 +34,7 @@ class PDFObject;
 class PDFFunction;
 class PDFDocument;
 class PDFParsingContext;
+class PDFPostScriptFunctionCompiledProgram;
 
 enum class FunctionType
 {
@@ -90,6 +92,16 @@ public:
     /// \param y_n Iterator to the end of the output values (one item after last value)
     virtual FunctionResult apply(const_iterator x_1, const_iterator x_m, iterator y_1, iterator y_n) const = 0;
 
+    /// Transforms multiple input tuples to the output tuples at once. Values are stored
+    /// as structure of arrays, i.e. i-th input variable of all tuples is stored in
+    /// the array x[i], and j-th output variable of all tuples is stored in the array y[j].
+    /// Output arrays must not overlap input arrays. Default implementation evaluates
+    /// tuples one by one using \p apply.
+    /// \param x Array of m input arrays, each of them has \p count values
+    /// \param y Array of n output arrays, each of them has \p count values
+    /// \param count Number of tuples
+    virtual FunctionResult applyMany(const const_iterator* x, const iterator* y, size_t count) const;
+
     /// Creates function from the object. If error occurs, exception is thrown.
     /// \param document Document, owning the pdf object
     /// \param object Object defining the function
@@ -186,6 +198,12 @@ public:
     /// \param y_n Iterator to the end of the output values (one item after last value)
     virtual FunctionResult apply(const_iterator x_1, const_iterator x_m, iterator y_1, iterator y_n) const override;
 
+    /// Transforms multiple input tuples to the output tuples at once, see \p PDFFunction::applyMany
+    /// \param x Array of m input arrays, each of them has \p count values
+    /// \param y Array of n output arrays, each of them has \p count values
+    /// \param count Number of tuples
+    virtual FunctionResult applyMany(const const_iterator* x, const iterator* y, size_t count) const override;
+
     PDFInteger getOrder() const { return m_order; }
 
 private:
@@ -248,6 +266,12 @@ public:
     /// \param y_n Iterator to the end of the output values (one item after last value)
     virtual FunctionResult apply(const_iterator x_1, const_iterator x_m, iterator y_1, iterator y_n) const override;
 
+    /// Transforms multiple input tuples to the output tuples at once, see \p PDFFunction::applyMany
+    /// \param x Array of m input arrays, each of them has \p count values
+    /// \param y Array of n output arrays, each of them has \p count values
+    /// \param count Number of tuples
+    virtual FunctionResult applyMany(const const_iterator* x, const iterator* y, size_t count) const override;
+
 private:
     std::vector<PDFReal> m_c0;
     std::vector<PDFReal> m_c1;
@@ -310,13 +334,22 @@ public:
     /// \param y_n Iterator to the end of the output values (one item after last value)
     virtual FunctionResult apply(const_iterator x_1, const_iterator x_m, iterator y_1, iterator y_n) const override;
 
+    /// Transforms multiple input tuples to the output tuples at once, see \p PDFFunction::applyMany
+    /// \param x Array of m input arrays, each of them has \p count values
+    /// \param y Array of n output arrays, each of them has \p count values
+    /// \param count Number of tuples
+    virtual FunctionResult applyMany(const const_iterator* x, const iterator* y, size_t count) const override;
+
 private:
     /// Partial function definitions
     std::vector<PartialFunction> m_partialFunctions;
 };
 
 /// Postscript function (Type 4 function)
-/// Implements subset of postscript language
+/// Implements subset of postscript language. Program is compiled to the straight-line
+/// code operating on registers, if possible, otherwise it is interpreted. If function
+/// has one or two inputs and is evaluated many times, then function is sampled to the
+/// lookup table, which is used, if interpolated values are within the tolerance.
 class PDF4QTLIBCORESHARED_EXPORT PDFPostScriptFunction : public PDFFunction
 {
 public:
@@ -471,8 +504,46 @@ public:
     virtual FunctionResult apply(const_iterator x_1, const_iterator x_m, iterator y_1, iterator y_n) const override;
 
 private:
+    /// Size of the lookup table of functions with one input
+    static constexpr uint32_t LOOKUP_TABLE_SIZE_1D = 257;
+
+    /// Size of the lookup table of functions with two inputs (in each dimension)
+    static constexpr uint32_t LOOKUP_TABLE_SIZE_2D = 65;
+
+    /// Maximal error of the interpolated values of the lookup table (relative to the output range)
+    static constexpr PDFReal LOOKUP_TABLE_TOLERANCE = 1.0 / 1024.0;
+
+    /// Executes the program using the interpreter
+    FunctionResult applyInterpreted(const_iterator x_1, iterator y_1, iterator y_n) const;
+
+    /// Executes the compiled program. Returns false, if program is not compiled,
+    /// or runtime error occured (then interpreter must be used to report the error).
+    /// \param x Clamped input values
+    /// \param y Clamped output values
+    bool applyCompiled(const PDFReal* x, PDFReal* y) const;
+
+    /// Interpolates output values from the lookup table
+    /// \param x Clamped input values
+    /// \param y Output values
+    void applyLookupTable(const PDFReal* x, PDFReal* y) const;
+
+    /// Returns number of evaluations of the function, after which lookup table is created
+    uint32_t getLookupTableEvaluationThreshold() const;
+
+    /// Samples the function to the lookup table. Lookup table is used only, if
+    /// interpolated values between samples are within the tolerance.
+    void buildLookupTable() const;
+
     Program m_program;
 
+    /// Compiled program (nullptr, if program can't be compiled)
+    std::unique_ptr<const PDFPostScriptFunctionCompiledProgram> m_compiledProgram;
+
+    /// Lookup table of sampled function values (valid only, if m_lookupTableReady is true)
+    mutable std::vector<PDFReal> m_lookupTable;
+    mutable std::atomic_bool m_lookupTableReady = false;
+    mutable std::atomic_uint32_t m_evaluationCount = 0;
+
     friend class PDFPostScriptFunctionStack;
     friend class PDFPostScriptFunctionExecutor;
 };
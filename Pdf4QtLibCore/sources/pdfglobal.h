@@ -130,6 +130,16 @@ struct PDFObjectReference
     constexpr bool isValid() const { return objectNumber > 0; }
 };
 
+/// Hash function for object references, so they can be used
+/// as keys in unordered containers.
+struct PDFObjectReferenceHash
+{
+    constexpr size_t operator()(const PDFObjectReference& reference) const
+    {
+        return static_cast<size_t>(reference.objectNumber) * 31 + static_cast<size_t>(reference.generation);
+    }
+};
+
 /// Represents version identification
 struct PDFVersion
 {
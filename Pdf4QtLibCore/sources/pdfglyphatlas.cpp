@@ -0,0 +1,151 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pdfglyphatlas.h"
+
+#include <QBrush>
+#include <QPainter>
+#include <QtMath>
+
+#include "pdfdbgheap.h"
+
+namespace pdf
+{
+
+PDFGlyphAtlas::PDFGlyphAtlas(qint64 budget)
+{
+    m_cache.setMaxCost(qMax<qint64>(budget, 0));
+}
+
+bool PDFGlyphAtlas::drawGlyph(QPainter* painter, const PDFGlyphAtlasGlyph& glyph, const QBrush& brush)
+{
+    if (brush.style() != Qt::SolidPattern || glyph.outline.isEmpty())
+    {
+        return false;
+    }
+
+    const QTransform transform = glyph.matrix * painter->worldTransform();
+    if (transform.type() > QTransform::TxScale)
+    {
+        // Glyph is rotated, skewed or projected
+        return false;
+    }
+
+    const QRectF glyphRect = transform.mapRect(glyph.outline.boundingRect());
+    if (glyphRect.width() > MAX_GLYPH_SIZE || glyphRect.height() > MAX_GLYPH_SIZE)
+    {
+        return false;
+    }
+
+    // Glyph origin is snapped to the nearest lower subpixel position
+    const PDFReal originX = qFloor(transform.dx());
+    const PDFReal originY = qFloor(transform.dy());
+
+    Key key;
+    key.glyphId = glyph.glyphId;
+    key.scaleX = transform.m11();
+    key.scaleY = transform.m22();
+    key.subpixelX = qBound(0, int((transform.dx() - originX) * SUBPIXEL_POSITIONS), SUBPIXEL_POSITIONS - 1);
+    key.subpixelY = qBound(0, int((transform.dy() - originY) * SUBPIXEL_POSITIONS), SUBPIXEL_POSITIONS - 1);
+
+    Mask mask;
+    bool isMaskFound = false;
+
+    {
+        QMutexLocker lock(&m_mutex);
+        if (const Mask* cachedMask = m_cache.object(key))
+        {
+            mask = *cachedMask;
+            isMaskFound = true;
+        }
+    }
+
+    if (!isMaskFound)
+    {
+        // Mask is rasterized outside the lock
+        mask = createMask(glyph, key);
+
+        QMutexLocker lock(&m_mutex);
+        if (!m_cache.contains(key))
+        {
+            m_cache.insert(key, new Mask(mask), qMax<qint64>(mask.image.sizeInBytes(), 1));
+        }
+    }
+
+    if (mask.image.isNull())
+    {
+        return true;
+    }
+
+    QImage image(mask.image.size(), QImage::Format_ARGB32_Premultiplied);
+    image.fill(brush.color());
+
+    QPainter imagePainter(&image);
+    imagePainter.setCompositionMode(QPainter::CompositionMode_DestinationIn);
+    imagePainter.drawImage(0, 0, mask.image);
+    imagePainter.end();
+
+    painter->save();
+    painter->setWorldTransform(QTransform());
+    painter->drawImage(QPointF(originX + mask.offset.x(), originY + mask.offset.y()), image);
+    painter->restore();
+    return true;
+}
+
+qint64 PDFGlyphAtlas::getCacheCost() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_cache.totalCost();
+}
+
+PDFGlyphAtlas::Mask PDFGlyphAtlas::createMask(const PDFGlyphAtlasGlyph& glyph, const Key& key)
+{
+    Mask mask;
+
+    const QTransform transform(key.scaleX, 0.0, 0.0, key.scaleY, PDFReal(key.subpixelX) / SUBPIXEL_POSITIONS, PDFReal(key.subpixelY) / SUBPIXEL_POSITIONS);
+    const QRectF rect = transform.mapRect(glyph.outline.boundingRect());
+
+    // Add one pixel border for antialiasing
+    const int left = qFloor(rect.left()) - 1;
+    const int top = qFloor(rect.top()) - 1;
+    const int right = qCeil(rect.right()) + 1;
+    const int bottom = qCeil(rect.bottom()) + 1;
+
+    QImage image(right - left, bottom - top, QImage::Format_Alpha8);
+    if (image.isNull())
+    {
+        return mask;
+    }
+    image.fill(Qt::transparent);
+
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setWorldTransform(transform * QTransform::fromTranslate(-left, -top));
+    painter.fillPath(glyph.outline, Qt::black);
+    painter.end();
+
+    mask.image = qMove(image);
+    mask.offset = QPoint(left, top);
+    return mask;
+}
+
+}   // namespace pdf
@@ -0,0 +1,118 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef PDFGLYPHATLAS_H
+#define PDFGLYPHATLAS_H
+
+#include "pdfglobal.h"
+
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+#include <QTransform>
+#include <QPainterPath>
+
+#include <memory>
+
+class QBrush;
+class QPainter;
+
+namespace pdf
+{
+class PDFGlyphAtlas;
+
+using PDFGlyphAtlasPointer = std::shared_ptr<PDFGlyphAtlas>;
+
+/// Glyph of the realized font, which can be drawn using glyph atlas
+struct PDFGlyphAtlasGlyph
+{
+    PDFGlyphAtlasPointer atlas;     ///< Glyph atlas of the realized font
+    QPainterPath outline;           ///< Outline of the glyph (in the text space of the realized font)
+    QTransform matrix;              ///< Transformation from the glyph outline to the user space
+    quintptr glyphId = 0;           ///< Identifier of the glyph in the atlas
+
+    bool isValid() const { return atlas != nullptr; }
+};
+
+/// Cache of glyph coverage masks of the realized font. Small glyphs, which are neither
+/// rotated nor skewed, are rasterized only once (for each scale and quarter pixel position)
+/// and are then drawn as images, instead of filling their outlines again. When total size
+/// of masks exceeds the budget, least recently used masks are removed. This class is thread safe.
+class PDF4QTLIBCORESHARED_EXPORT PDFGlyphAtlas
+{
+public:
+    /// Creates glyph atlas with given budget
+    /// \param budget Maximal total size of coverage masks in bytes
+    explicit PDFGlyphAtlas(qint64 budget);
+
+    /// Glyphs larger than this size (in device pixels) are always drawn as paths
+    static constexpr PDFReal MAX_GLYPH_SIZE = 64.0;
+
+    /// Count of subpixel positions of the glyph in each axis
+    static constexpr int SUBPIXEL_POSITIONS = 4;
+
+    /// Draws the glyph using painter's world transformation, if it is possible.
+    /// If glyph can't be drawn using the atlas (it is too large, rotated, skewed,
+    /// or brush has not a solid color), nothing is drawn and false is returned.
+    /// \param painter Painter
+    /// \param glyph Glyph to be drawn
+    /// \param brush Brush, which fills the glyph
+    bool drawGlyph(QPainter* painter, const PDFGlyphAtlasGlyph& glyph, const QBrush& brush);
+
+    /// Returns total size of cached coverage masks in bytes
+    qint64 getCacheCost() const;
+
+private:
+    struct Key
+    {
+        quintptr glyphId = 0;
+        PDFReal scaleX = 0.0;
+        PDFReal scaleY = 0.0;
+        int subpixelX = 0;
+        int subpixelY = 0;
+
+        bool operator==(const Key&) const = default;
+    };
+
+    struct Mask
+    {
+        QImage image;   ///< Coverage of the glyph (alpha channel only)
+        QPoint offset;  ///< Offset of the image from the glyph origin (in device pixels)
+    };
+
+    friend size_t qHash(const Key& key, size_t seed);
+
+    /// Rasterizes coverage mask of the glyph
+    static Mask createMask(const PDFGlyphAtlasGlyph& glyph, const Key& key);
+
+    mutable QMutex m_mutex;
+    QCache<Key, Mask> m_cache;
+};
+
+inline size_t qHash(const PDFGlyphAtlas::Key& key, size_t seed = 0)
+{
+    return qHashMulti(seed, key.glyphId, key.scaleX, key.scaleY, key.subpixelX, key.subpixelY);
+}
+
+}   // namespace pdf
+
+#endif // PDFGLYPHATLAS_H
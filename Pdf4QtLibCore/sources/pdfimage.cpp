@@ -27,12 +27,18 @@
 #include "pdfutils.h"
 #include "pdfjbig2decoder.h"
 #include "pdfccittfaxdecoder.h"
+#include "pdfexecutionpolicy.h"
+
+#include <QtMath>
+#include <QImage>
 
 #include <openjpeg.h>
 #include <jpeglib.h>
 
 #include "pdfdbgheap.h"
 
+#include <bit>
+
 namespace pdf
 {
 
@@ -59,7 +65,8 @@ PDFImage PDFImage::createImage(const PDFDocument* document,
                                PDFColorSpacePointer colorSpace,
                                bool isSoftMask,
                                RenderingIntent renderingIntent,
-                               PDFRenderErrorReporter* errorReporter)
+                               PDFRenderErrorReporter* errorReporter,
+                               const PDFImageDecodeHints& decodeHints)
 {
     PDFImage image;
     image.m_colorSpace = colorSpace;
@@ -344,6 +351,15 @@ PDFImage PDFImage::createImage(const PDFDocument* document,
                 }
             }
 
+            // Decode image at reduced resolution, if it is painted smaller. Scaled
+            // inverse DCT is much faster, than decoding the whole image.
+            const int scaleDenominator = getDownscaleDenominator(QSize(static_cast<int>(codec.image_width), static_cast<int>(codec.image_height)), decodeHints.targetSize);
+            if (scaleDenominator > 1)
+            {
+                codec.scale_num = 1;
+                codec.scale_denom = scaleDenominator;
+            }
+
             jpeg_start_decompress(&codec);
 
             const JDIMENSION rowStride = codec.output_width * codec.output_components;
@@ -431,11 +447,74 @@ PDFImage PDFImage::createImage(const PDFDocument* document,
             // Setup the decoder
             if (opj_setup_decoder(codec, &decompressParameters))
             {
+                // Tiles are decoded in parallel, if content is processed in parallel
+                if (PDFExecutionPolicy::isParallelizing(PDFExecutionPolicy::Scope::Content))
+                {
+                    opj_codec_set_threads(codec, PDFExecutionPolicy::getIdealThreadCount(PDFExecutionPolicy::Scope::Content));
+                }
+
                 // Try to read the header
 
                 if (opj_read_header(opjStream, codec, &jpegImage))
                 {
-                    if (opj_set_decode_area(codec, jpegImage, decompressParameters.DA_x0, decompressParameters.DA_y0, decompressParameters.DA_x1, decompressParameters.DA_y1))
+                    OPJ_INT32 decodeAreaX0 = decompressParameters.DA_x0;
+                    OPJ_INT32 decodeAreaY0 = decompressParameters.DA_y0;
+                    OPJ_INT32 decodeAreaX1 = decompressParameters.DA_x1;
+                    OPJ_INT32 decodeAreaY1 = decompressParameters.DA_y1;
+                    image.m_imageRect = QRectF(0.0, 0.0, 1.0, 1.0);
+
+                    const OPJ_INT32 imageX0 = static_cast<OPJ_INT32>(jpegImage->x0);
+                    const OPJ_INT32 imageY0 = static_cast<OPJ_INT32>(jpegImage->y0);
+                    const OPJ_INT32 imageWidth = static_cast<OPJ_INT32>(jpegImage->x1 - jpegImage->x0);
+                    const OPJ_INT32 imageHeight = static_cast<OPJ_INT32>(jpegImage->y1 - jpegImage->y0);
+
+                    // Decode image at reduced resolution, if it is painted smaller. Resolution can be
+                    // reduced only by the number of resolution levels (wavelet decompositions) of the image.
+                    OPJ_UINT32 resolutionCount = 1;
+                    if (opj_codestream_info_v2_t* codestreamInfo = opj_get_cstr_info(codec))
+                    {
+                        if (codestreamInfo->m_default_tile_info.tccp_info && codestreamInfo->nbcomps > 0)
+                        {
+                            resolutionCount = codestreamInfo->m_default_tile_info.tccp_info[0].numresolutions;
+                            for (OPJ_UINT32 i = 1; i < codestreamInfo->nbcomps; ++i)
+                            {
+                                resolutionCount = qMin(resolutionCount, codestreamInfo->m_default_tile_info.tccp_info[i].numresolutions);
+                            }
+                        }
+                        opj_destroy_cstr_info(&codestreamInfo);
+                    }
+
+                    const int maxDenominator = 1 << qBound(0, static_cast<int>(resolutionCount) - 1, 16);
+                    const int denominator = getDownscaleDenominator(QSize(imageWidth, imageHeight), decodeHints.targetSize, maxDenominator);
+                    if (denominator > 1)
+                    {
+                        opj_set_decoded_resolution_factor(codec, static_cast<OPJ_UINT32>(qCountTrailingZeroBits(static_cast<quint32>(denominator))));
+                    }
+
+                    // Decode only visible part of the image. Masks are not decoded partially,
+                    // so image can be decoded partially only, if it has no mask image.
+                    const bool canDecodePartially = maskingType == PDFImageData::MaskingType::None || maskingType == PDFImageData::MaskingType::ColorKeyMasking;
+                    const QRectF visibleRect = decodeHints.visibleRect.intersected(QRectF(0.0, 0.0, 1.0, 1.0));
+                    if (canDecodePartially && decodeHints.visibleRect.isValid() && !visibleRect.isEmpty() && imageWidth > 0 && imageHeight > 0)
+                    {
+                        // Image space has y axis pointing up, image rows go down
+                        const OPJ_INT32 x0 = imageX0 + qFloor(visibleRect.left() * imageWidth);
+                        const OPJ_INT32 x1 = imageX0 + qCeil(visibleRect.right() * imageWidth);
+                        const OPJ_INT32 y0 = imageY0 + qFloor((1.0 - visibleRect.bottom()) * imageHeight);
+                        const OPJ_INT32 y1 = imageY0 + qCeil((1.0 - visibleRect.top()) * imageHeight);
+
+                        if (x1 > x0 && y1 > y0 && qint64(x1 - x0) * qint64(y1 - y0) < qint64(imageWidth) * qint64(imageHeight))
+                        {
+                            decodeAreaX0 = x0;
+                            decodeAreaY0 = y0;
+                            decodeAreaX1 = x1;
+                            decodeAreaY1 = y1;
+                            image.m_imageRect = QRectF(qreal(x0 - imageX0) / imageWidth, 1.0 - qreal(y1 - imageY0) / imageHeight,
+                                                       qreal(x1 - x0) / imageWidth, qreal(y1 - y0) / imageHeight);
+                        }
+                    }
+
+                    if (opj_set_decode_area(codec, jpegImage, decodeAreaX0, decodeAreaY0, decodeAreaX1, decodeAreaY1))
                     {
                         if (opj_decode(codec, opjStream, jpegImage))
                         {
@@ -685,16 +764,28 @@ PDFImage PDFImage::createImage(const PDFDocument* document,
     {
         QByteArray data = document->getDecodedStream(stream);
         QByteArray globalData;
+        PDFJBIG2GlobalsPointer globals;
         if (filterParamsDictionary)
         {
             const PDFObject& globalDataObject = document->getObject(filterParamsDictionary->get("JBIG2Globals"));
             if (globalDataObject.isStream())
             {
-                globalData = document->getDecodedStream(globalDataObject.getStream());
+                // Global segments are usually shared by images of all pages, so decode them only once
+                const PDFStream* globalStream = globalDataObject.getStream();
+                globals = document->getJBIG2GlobalsCache()->getGlobals(globalStream, [document, globalStream, errorReporter]() { return PDFJBIG2Decoder::decodeGlobals(document->getDecodedStream(globalStream), errorReporter); });
+
+                if (!globals)
+                {
+                    globalData = document->getDecodedStream(globalStream);
+                }
             }
         }
 
         PDFJBIG2Decoder decoder(qMove(data), qMove(globalData), errorReporter);
+        if (globals)
+        {
+            decoder.setGlobals(qMove(globals));
+        }
         image.m_imageData = decoder.decode(maskingType);
         image.m_imageData.setDecode(!decode.empty() ? qMove(decode) : std::vector<PDFReal>({ 0.0, 1.0 }));
     }
@@ -795,6 +886,34 @@ QImage PDFImage::getImage(const PDFCMS* cms,
     return QImage();
 }
 
+int PDFImage::getDownscaleDenominator(QSize imageSize, QSize targetSize, int maxDenominator)
+{
+    if (!targetSize.isValid() || targetSize.isEmpty() || imageSize.isEmpty())
+    {
+        return 1;
+    }
+
+    int maxPowerOfTwoDenominator = 1;
+    while (maxPowerOfTwoDenominator <= maxDenominator / 2)
+    {
+        maxPowerOfTwoDenominator *= 2;
+    }
+
+    for (int denominator = maxPowerOfTwoDenominator; denominator > 1; denominator /= 2)
+    {
+        // Scaled dimensions are rounded up, in the same way as in libjpeg
+        const int scaledWidth = (imageSize.width() + denominator - 1) / denominator;
+        const int scaledHeight = (imageSize.height() + denominator - 1) / denominator;
+
+        if (scaledWidth >= targetSize.width() && scaledHeight >= targetSize.height())
+        {
+            return denominator;
+        }
+    }
+
+    return 1;
+}
+
 bool PDFImage::canBeConvertedToMonochromatic(const QImage& image)
 {
     for (int y = 0; y < image.height(); ++y)
@@ -901,4 +1020,103 @@ PDFAlternateImage PDFAlternateImage::parse(const PDFObjectStorage* storage, PDFO
     return result;
 }
 
+bool PDFImagePerceptualHash::isSimilar(const PDFImagePerceptualHash& other) const
+{
+    const int differentBits = std::popcount(differenceHash ^ other.differenceHash);
+    const int luminanceDifference = std::abs(int(meanLuminance) - int(other.meanLuminance));
+    return differentBits <= MAX_DIFFERENCE_BITS && luminanceDifference <= MAX_LUMINANCE_DIFFERENCE;
+}
+
+QByteArray PDFImagePerceptualHash::getKey() const
+{
+    QByteArray key(reinterpret_cast<const char*>(&differenceHash), sizeof(differenceHash));
+    key.append(char(meanLuminance / 32));
+    return key;
+}
+
+PDFImagePerceptualHash PDFImagePerceptualHash::calculate(const QImage& image)
+{
+    PDFImagePerceptualHash hash;
+
+    if (image.isNull())
+    {
+        return hash;
+    }
+
+    // Sample image in reduced resolution (nearest neighbour sampling
+    // doesn't touch the whole bitmap), and then average samples
+    // in a grid of 9 x 8 cells.
+    constexpr int GRID_WIDTH = 9;
+    constexpr int GRID_HEIGHT = 8;
+    constexpr int MAX_SAMPLE_SIZE = 128;
+
+    const int sampleWidth = qBound(GRID_WIDTH, image.width(), MAX_SAMPLE_SIZE);
+    const int sampleHeight = qBound(GRID_HEIGHT, image.height(), MAX_SAMPLE_SIZE);
+
+    QImage sampledImage = image;
+    if (sampledImage.width() != sampleWidth || sampledImage.height() != sampleHeight)
+    {
+        sampledImage = sampledImage.scaled(sampleWidth, sampleHeight, Qt::IgnoreAspectRatio, Qt::FastTransformation);
+    }
+    sampledImage = sampledImage.convertToFormat(QImage::Format_Grayscale8);
+
+    std::array<uint32_t, GRID_WIDTH * GRID_HEIGHT> sums = { };
+    std::array<uint32_t, GRID_WIDTH * GRID_HEIGHT> counts = { };
+    uint64_t totalSum = 0;
+
+    for (int y = 0; y < sampleHeight; ++y)
+    {
+        const uchar* scanLine = sampledImage.constScanLine(y);
+        const int cellY = y * GRID_HEIGHT / sampleHeight;
+
+        for (int x = 0; x < sampleWidth; ++x)
+        {
+            const int cellIndex = cellY * GRID_WIDTH + x * GRID_WIDTH / sampleWidth;
+            sums[cellIndex] += scanLine[x];
+            ++counts[cellIndex];
+            totalSum += scanLine[x];
+        }
+    }
+
+    for (int y = 0; y < GRID_HEIGHT; ++y)
+    {
+        for (int x = 0; x + 1 < GRID_WIDTH; ++x)
+        {
+            // Compare cell averages without division
+            const size_t index = y * GRID_WIDTH + x;
+            const uint64_t left = uint64_t(sums[index]) * counts[index + 1];
+            const uint64_t right = uint64_t(sums[index + 1]) * counts[index];
+
+            hash.differenceHash <<= 1;
+            if (left < right)
+            {
+                hash.differenceHash |= 1;
+            }
+        }
+    }
+
+    hash.meanLuminance = uint8_t(totalSum / (uint64_t(sampleWidth) * uint64_t(sampleHeight)));
+    return hash;
+}
+
+PDFImagePerceptualHash PDFImagePerceptualHashCache::getHash(const QImage& image)
+{
+    const qint64 key = image.cacheKey();
+
+    {
+        QMutexLocker lock(&m_mutex);
+        auto it = m_hashes.constFind(key);
+        if (it != m_hashes.cend())
+        {
+            return it.value();
+        }
+    }
+
+    PDFImagePerceptualHash hash = PDFImagePerceptualHash::calculate(image);
+
+    QMutexLocker lock(&m_mutex);
+    m_hashes.insert(key, hash);
+    return hash;
+}
+
 }   // namespace pdf
@@ -27,6 +27,10 @@
 #include "pdfcolorspaces.h"
 #include "pdfoperationcontrol.h"
 
+#include <QSize>
+#include <QHash>
+#include <QMutex>
+#include <QRectF>
 #include <QByteArray>
 
 class QByteArray;
@@ -60,6 +64,14 @@ private:
     bool m_defaultForPrinting = false;
 };
 
+/// Hints for decoding of the image. Image can be decoded at reduced
+/// resolution, or only its visible part can be decoded (JPEG 2000 only).
+struct PDFImageDecodeHints
+{
+    QSize targetSize;   ///< Size of the painted image in device pixels (invalid size - full resolution)
+    QRectF visibleRect; ///< Visible part of the image space (unit square), null rectangle - whole image
+};
+
 class PDF4QTLIBCORESHARED_EXPORT PDFImage
 {
 public:
@@ -72,12 +84,30 @@ public:
     /// \param isSoftMask Is it a soft mask image?
     /// \param renderingIntent Default rendering intent of the image
     /// \param errorReporter Error reporter for reporting errors (or warnings)
+    /// \param decodeHints Decode hints. If target size is valid, then JPEG (DCT) and JPEG 2000
+    ///        images are decoded at the smallest reduced resolution, which is not smaller
+    ///        than target size (see \p getDownscaleDenominator). If visible rectangle is set,
+    ///        then only visible part of JPEG 2000 image without mask is decoded (see \p getImageRect).
     static PDFImage createImage(const PDFDocument* document,
                                 const PDFStream* stream,
                                 PDFColorSpacePointer colorSpace,
                                 bool isSoftMask,
                                 RenderingIntent renderingIntent,
-                                PDFRenderErrorReporter* errorReporter);
+                                PDFRenderErrorReporter* errorReporter,
+                                const PDFImageDecodeHints& decodeHints = PDFImageDecodeHints());
+
+    /// Returns denominator of the scale (power of two up to \p maxDenominator), at which image
+    /// of given size can be decoded, so that decoded image is not smaller than target size. Images
+    /// decoded with different denominators differ, so caches of decoded images must distinguish them.
+    /// If target size is invalid, then 1 is returned (image is decoded at full resolution).
+    /// \param imageSize Size of the image
+    /// \param targetSize Size of the painted image in device pixels
+    /// \param maxDenominator Maximal denominator
+    static int getDownscaleDenominator(QSize imageSize, QSize targetSize, int maxDenominator = 8);
+
+    /// Returns part of the image space (unit square), which is covered by the image
+    /// data. It is the whole unit square, unless only part of the image was decoded.
+    const QRectF& getImageRect() const { return m_imageRect; }
 
     /// Returns image transformed from image data and color space
     QImage getImage(const PDFCMS* cms,
@@ -122,6 +152,7 @@ public:
 private:
     PDFImageData m_imageData;
     PDFImageData m_softMask;
+    QRectF m_imageRect = QRectF(0.0, 0.0, 1.0, 1.0);
     PDFColorSpacePointer m_colorSpace;
     RenderingIntent m_renderingIntent = RenderingIntent::Perceptual;
     bool m_interpolate = false;
@@ -137,6 +168,53 @@ private:
     PDFObject m_pointData;
 };
 
+/// Perceptual hash of an image. It consists of difference hash (dHash) computed
+/// on reduced resolution grayscale image and of the mean luminance. Hashes of
+/// resampled or recompressed images (the same picture, which was re-exported)
+/// are equal, or differ only in a few bits.
+struct PDF4QTLIBCORESHARED_EXPORT PDFImagePerceptualHash
+{
+    uint64_t differenceHash = 0;
+    uint8_t meanLuminance = 0;
+
+    static constexpr int MAX_DIFFERENCE_BITS = 10;
+    static constexpr int MAX_LUMINANCE_DIFFERENCE = 24;
+
+    bool operator==(const PDFImagePerceptualHash&) const = default;
+
+    /// Returns true, if images are perceptually similar, i.e. difference
+    /// hashes differ in a few bits and mean luminance is almost the same.
+    /// \param other Other hash
+    bool isSimilar(const PDFImagePerceptualHash& other) const;
+
+    /// Returns quantized value of the hash, images with the same
+    /// key are considered to be equal.
+    QByteArray getKey() const;
+
+    /// Calculates perceptual hash of the image. Image is sampled
+    /// in a reduced resolution, so the whole bitmap is not processed.
+    /// \param image Image
+    static PDFImagePerceptualHash calculate(const QImage& image);
+};
+
+/// Thread safe cache of perceptual hashes. Images are identified by their
+/// cache key, so image shared by multiple draw operations (for example,
+/// image XObject stored in the document image cache) is hashed only once.
+class PDF4QTLIBCORESHARED_EXPORT PDFImagePerceptualHashCache
+{
+public:
+    explicit PDFImagePerceptualHashCache() = default;
+
+    /// Returns perceptual hash of the image, if it is not
+    /// cached, it is calculated and stored in the cache.
+    /// \param image Image
+    PDFImagePerceptualHash getHash(const QImage& image);
+
+private:
+    QMutex m_mutex;
+    QHash<qint64, PDFImagePerceptualHash> m_hashes;
+};
+
 }   // namespace pdf
 
 #endif // PDFIMAGE_H
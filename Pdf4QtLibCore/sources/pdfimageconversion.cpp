@@ -1,8 +1,199 @@
 #include "pdfimageconversion.h"
+#include "pdfexecutionpolicy.h"
+#include "pdfutils.h"
+
+#include <QMutex>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PDF4QT_IMAGECONVERSION_SSE2
+#define PDF4QT_IMAGECONVERSION_SIMD
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define PDF4QT_IMAGECONVERSION_NEON
+#define PDF4QT_IMAGECONVERSION_SIMD
+#include <arm_neon.h>
+#endif
+
 #include "pdfdbgheap.h"
 
+#include <array>
 #include <cmath>
 
+namespace
+{
+
+/// Count of pixels processed at once by vector kernels
+constexpr int VECTOR_PIXEL_COUNT = 16;
+
+/// Minimal count of rows processed by one worker
+constexpr int ROW_GRAIN_SIZE = 16;
+
+using Histogram = std::array<int, 256>;
+
+/// Table of reversed bits of bytes, bit masks of the vector kernels contain
+/// first pixel in the lowest bit, but 1-bpp rows have first pixel in the highest bit.
+constexpr std::array<uchar, 256> REVERSED_BITS = []()
+{
+    std::array<uchar, 256> table = { };
+    for (int i = 0; i < 256; ++i)
+    {
+        int reversed = 0;
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            if (i & (1 << bit))
+            {
+                reversed |= 0x80 >> bit;
+            }
+        }
+        table[i] = uchar(reversed);
+    }
+    return table;
+}();
+
+/// Returns lightness of the color (as in HSL color model)
+inline uchar getLightness(QRgb rgb)
+{
+    const int red = qRed(rgb);
+    const int green = qGreen(rgb);
+    const int blue = qBlue(rgb);
+    return uchar((qMax(qMax(red, green), blue) + qMin(qMin(red, green), blue) + 1) / 2);
+}
+
+#if defined(PDF4QT_IMAGECONVERSION_SSE2)
+
+/// Calculates lightness of 16 pixels in 32-bit (A)RGB format
+inline __m128i getLightness16(const uchar* pixels)
+{
+    const __m128i lowByteMask = _mm_set1_epi32(0xFF);
+    __m128i lightness[4];
+
+    for (int i = 0; i < 4; ++i)
+    {
+        // Pixels are stored as blue, green, red, alpha bytes
+        const __m128i bgra = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + 16 * i));
+        const __m128i gra = _mm_srli_epi32(bgra, 8);
+        const __m128i ra = _mm_srli_epi32(bgra, 16);
+        const __m128i maximum = _mm_max_epu8(_mm_max_epu8(bgra, gra), ra);
+        const __m128i minimum = _mm_min_epu8(_mm_min_epu8(bgra, gra), ra);
+        lightness[i] = _mm_and_si128(_mm_avg_epu8(maximum, minimum), lowByteMask);
+    }
+
+    return _mm_packus_epi16(_mm_packs_epi32(lightness[0], lightness[1]), _mm_packs_epi32(lightness[2], lightness[3]));
+}
+
+/// Writes 16 pixels (two bytes) of 1-bpp row, bit is set, if value is greater or equal to threshold
+inline void packThreshold16(const uchar* values, __m128i threshold, uchar* output)
+{
+    const __m128i vector = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values));
+    const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(vector, threshold), vector));
+    output[0] = REVERSED_BITS[mask & 0xFF];
+    output[1] = REVERSED_BITS[(mask >> 8) & 0xFF];
+}
+
+#endif
+
+#if defined(PDF4QT_IMAGECONVERSION_NEON)
+
+/// Calculates lightness of 16 pixels in 32-bit (A)RGB format
+inline uint8x16_t getLightness16(const uchar* pixels)
+{
+    // Pixels are stored as blue, green, red, alpha bytes
+    const uint8x16x4_t bgra = vld4q_u8(pixels);
+    const uint8x16_t maximum = vmaxq_u8(vmaxq_u8(bgra.val[0], bgra.val[1]), bgra.val[2]);
+    const uint8x16_t minimum = vminq_u8(vminq_u8(bgra.val[0], bgra.val[1]), bgra.val[2]);
+    return vrhaddq_u8(maximum, minimum);
+}
+
+/// Writes 16 pixels (two bytes) of 1-bpp row, bit is set, if value is greater or equal to threshold
+inline void packThreshold16(const uchar* values, uint8x16_t threshold, uchar* output)
+{
+    static const uint8_t weightsData[16] = { 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+                                             0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01 };
+    const uint8x16_t weights = vld1q_u8(weightsData);
+    const uint8x16_t bits = vandq_u8(vcgeq_u8(vld1q_u8(values), threshold), weights);
+    const uint64x2_t sums = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(bits)));
+    output[0] = uchar(vgetq_lane_u64(sums, 0));
+    output[1] = uchar(vgetq_lane_u64(sums, 1));
+}
+
+#endif
+
+/// Calculates lightness of the row of pixels in 32-bit (A)RGB format
+void calculateLightnessRow(const uchar* pixels, uchar* lightness, int width)
+{
+    int x = 0;
+
+#if defined(PDF4QT_IMAGECONVERSION_SSE2)
+    for (; x + VECTOR_PIXEL_COUNT <= width; x += VECTOR_PIXEL_COUNT)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lightness + x), getLightness16(pixels + 4 * x));
+    }
+#elif defined(PDF4QT_IMAGECONVERSION_NEON)
+    for (; x + VECTOR_PIXEL_COUNT <= width; x += VECTOR_PIXEL_COUNT)
+    {
+        vst1q_u8(lightness + x, getLightness16(pixels + 4 * x));
+    }
+#endif
+
+    const QRgb* rgbPixels = reinterpret_cast<const QRgb*>(pixels);
+    for (; x < width; ++x)
+    {
+        lightness[x] = getLightness(rgbPixels[x]);
+    }
+}
+
+/// Adds values to the histogram. Four partial histograms are used, so
+/// increments of the same bin in consecutive values don't depend on each other.
+void addToHistogram(const uchar* values, int count, std::array<Histogram, 4>& histograms)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        ++histograms[0][values[i + 0]];
+        ++histograms[1][values[i + 1]];
+        ++histograms[2][values[i + 2]];
+        ++histograms[3][values[i + 3]];
+    }
+
+    for (; i < count; ++i)
+    {
+        ++histograms[0][values[i]];
+    }
+}
+
+/// Packs the row of values into 1-bpp row (first pixel is in the highest bit),
+/// bit is set, if value is greater or equal to threshold. Output must be zeroed.
+void packThresholdRow(const uchar* values, uchar* output, int width, int threshold)
+{
+    int x = 0;
+
+#if defined(PDF4QT_IMAGECONVERSION_SIMD)
+    if (threshold >= 0 && threshold <= 255)
+    {
+#if defined(PDF4QT_IMAGECONVERSION_SSE2)
+        const __m128i thresholdVector = _mm_set1_epi8(char(threshold));
+#else
+        const uint8x16_t thresholdVector = vdupq_n_u8(uint8_t(threshold));
+#endif
+
+        for (; x + VECTOR_PIXEL_COUNT <= width; x += VECTOR_PIXEL_COUNT)
+        {
+            packThreshold16(values + x, thresholdVector, output + x / 8);
+        }
+    }
+#endif
+
+    for (; x < width; ++x)
+    {
+        if (values[x] >= threshold)
+        {
+            output[x / 8] |= uchar(0x80 >> (x % 8));
+        }
+    }
+}
+
+} // namespace
+
 namespace pdf
 {
 
@@ -35,8 +226,70 @@ bool PDFImageConversion::convert()
         return false;
     }
 
-    QImage bitonal(m_image.width(), m_image.height(), QImage::Format_Mono);
-    bitonal.fill(0);
+    const int width = m_image.width();
+    const int height = m_image.height();
+    const bool isAutomatic = m_conversionMethod == ConversionMethod::Automatic;
+
+    QImage image = m_image;
+    if (image.format() != QImage::Format_Grayscale8 &&
+        image.format() != QImage::Format_RGB32 &&
+        image.format() != QImage::Format_ARGB32)
+    {
+        image.convertTo(QImage::Format_ARGB32);
+    }
+
+    // Lightness of pixels. Grayscale image has lightness equal to pixel values,
+    // so we use its rows directly, otherwise lightness of rows is calculated
+    // in parallel, together with histogram for automatic threshold.
+    const bool isGrayscale = image.format() == QImage::Format_Grayscale8;
+    std::vector<uchar> lightness;
+    if (!isGrayscale)
+    {
+        lightness.resize(size_t(width) * size_t(height), 0);
+    }
+
+    auto getLightnessRow = [&](int y) -> const uchar*
+    {
+        return isGrayscale ? image.constScanLine(y) : lightness.data() + size_t(y) * size_t(width);
+    };
+
+    Histogram histogram = { };
+    QMutex histogramMutex;
+
+    PDFIntegerRange<int> rows(0, height);
+    auto processRows = [&](auto it, auto itEnd)
+    {
+        std::array<Histogram, 4> histograms = { };
+
+        for (; it != itEnd; ++it)
+        {
+            const int y = *it;
+
+            if (!isGrayscale)
+            {
+                calculateLightnessRow(image.constScanLine(y), lightness.data() + size_t(y) * size_t(width), width);
+            }
+
+            if (isAutomatic)
+            {
+                addToHistogram(getLightnessRow(y), width, histograms);
+            }
+        }
+
+        if (isAutomatic)
+        {
+            QMutexLocker lock(&histogramMutex);
+            for (size_t i = 0; i < histogram.size(); ++i)
+            {
+                histogram[i] += histograms[0][i] + histograms[1][i] + histograms[2][i] + histograms[3][i];
+            }
+        }
+    };
+
+    if (!isGrayscale || isAutomatic)
+    {
+        PDFExecutionPolicy::executePartitioned(PDFExecutionPolicy::Scope::Content, rows.begin(), rows.end(), ROW_GRAIN_SIZE, processRows);
+    }
 
     // Thresholding
     int threshold = DEFAULT_THRESHOLD;
@@ -44,7 +297,7 @@ bool PDFImageConversion::convert()
     switch (m_conversionMethod)
     {
         case pdf::PDFImageConversion::ConversionMethod::Automatic:
-            m_automaticThreshold = calculateOtsu1DThreshold();
+            m_automaticThreshold = calculateOtsu1DThreshold(histogram);
             threshold = m_automaticThreshold;
             break;
 
@@ -57,16 +310,23 @@ bool PDFImageConversion::convert()
             break;
     }
 
-    for (int y = 0; y < m_image.height(); ++y)
+    QImage bitonal(width, height, QImage::Format_Mono);
+    bitonal.setColorTable({ qRgb(0, 0, 0), qRgb(255, 255, 255) });
+    bitonal.fill(0);
+
+    uchar* bitonalData = bitonal.bits();
+    const qsizetype bitonalBytesPerLine = bitonal.bytesPerLine();
+
+    auto packRows = [&](auto it, auto itEnd)
     {
-        for (int x = 0; x < m_image.width(); ++x)
+        for (; it != itEnd; ++it)
         {
-            QColor pixelColor = m_image.pixelColor(x, y);
-            int pixelValue = pixelColor.lightness();
-            bool bit = (pixelValue >= threshold);
-            bitonal.setPixel(x, y, bit);
+            const int y = *it;
+            packThresholdRow(getLightnessRow(y), bitonalData + y * bitonalBytesPerLine, width, threshold);
         }
-    }
+    };
+
+    PDFExecutionPolicy::executePartitioned(PDFExecutionPolicy::Scope::Content, rows.begin(), rows.end(), ROW_GRAIN_SIZE, packRows);
 
     m_convertedImage = std::move(bitonal);
     return true;
@@ -95,94 +355,78 @@ QImage PDFImageConversion::getConvertedImage() const
     return m_convertedImage;
 }
 
-int PDFImageConversion::calculateOtsu1DThreshold() const
+QByteArray PDFImageConversion::getConvertedImageData() const
 {
-    if (m_image.isNull())
+    if (m_convertedImage.isNull())
     {
-        return 128;
+        return QByteArray();
     }
 
-    // Histogram of lightness occurences
-    std::array<int, 256> histogram = { };
+    Q_ASSERT(m_convertedImage.format() == QImage::Format_Mono);
 
-    for (int x = 0; x < m_image.width(); ++x)
+    const qsizetype bytesPerLine = (m_convertedImage.width() + 7) / 8;
+    QByteArray data(bytesPerLine * m_convertedImage.height(), Qt::Uninitialized);
+
+    for (int y = 0; y < m_convertedImage.height(); ++y)
     {
-        for (int y = 0; y < m_image.height(); ++y)
-        {
-            int lightness = m_image.pixelColor(x, y).lightness();
-            Q_ASSERT(lightness >= 0 && lightness <= 255);
+        memcpy(data.data() + y * bytesPerLine, m_convertedImage.constScanLine(y), bytesPerLine);
+    }
 
-            int clampedLightness = qBound(0, lightness, 255);
-            histogram[clampedLightness] += 1;
-        }
+    return data;
+}
+
+int PDFImageConversion::calculateOtsu1DThreshold(const std::array<int, 256>& histogram)
+{
+    qint64 pixelCount = 0;
+    for (int count : histogram)
+    {
+        pixelCount += count;
     }
 
-    float factor = 1.0f / float(m_image.width() * m_image.height());
+    if (pixelCount == 0)
+    {
+        return DEFAULT_THRESHOLD;
+    }
 
-    std::array<float, 256> normalizedHistogram = { };
-    std::array<float, 256> cumulativeProbabilities = { };
-    std::array<float, 256> interClassVariance = { };
+    const double factor = 1.0 / double(pixelCount);
 
-    // Compute probabilities
+    // Total mean intensity value of the image
+    double totalMean = 0.0;
     for (size_t i = 0; i < histogram.size(); ++i)
     {
-        normalizedHistogram[i] = histogram[i] * factor;
-        cumulativeProbabilities[i] = normalizedHistogram[i];
-
-        if (i > 0)
-        {
-            cumulativeProbabilities[i] += cumulativeProbabilities[i - 1];
-        }
+        totalMean += i * histogram[i] * factor;
     }
 
     // Calculate the inter-class variance for each threshold. Variables
-    // with the subscript 0 denote the background, while those with
-    // subscript 1 denote the foreground.
-    for (size_t i = 0; i < histogram.size(); ++i)
-    {
-        const float w0 = cumulativeProbabilities[i] - normalizedHistogram[i];
-        const float w1 = 1.0f - w0;
+    // with the subscript 0 denote the background (values below the threshold),
+    // while those with subscript 1 denote the foreground. Probabilities and
+    // means of the classes are accumulated, so each threshold is evaluated
+    // in constant time.
+    size_t maxVarianceIndex = 0;
+    double maxVarianceValue = 0.0;
 
-        float u0 = 0.0f;
-        float u1 = 0.0f;
+    qint64 pixelCount0 = 0;
+    double sum0 = 0.0;
 
-        // Calculate mean intensity value of the background.
-        if (!qFuzzyIsNull(w0))
+    for (size_t i = 0; i < histogram.size(); ++i)
+    {
+        if (pixelCount0 > 0 && pixelCount0 < pixelCount)
         {
-            for (size_t j = 0; j < i; ++j)
-            {
-                u0 += j * normalizedHistogram[j];
-            }
-
-            u0 /= w0;
-        }
+            const double w0 = pixelCount0 * factor;
+            const double w1 = 1.0 - w0;
+            const double u0 = sum0 / w0;
+            const double u1 = (totalMean - sum0) / w1;
+            const double variance = w0 * w1 * (u0 - u1) * (u0 - u1);
 
-        // Calculate mean intensity value of the foreground.
-        if (!qFuzzyIsNull(w1))
-        {
-            for (size_t j = i; j < histogram.size(); ++j)
+            if (variance > maxVarianceValue)
             {
-                u1 += j * normalizedHistogram[j];
+                maxVarianceValue = variance;
+                maxVarianceIndex = i;
             }
-
-            u1 /= w1;
         }
 
-        const float variance = w0 * w1 * std::pow(u0 - u1, 2);
-        interClassVariance[i] = variance;
-    }
-
-    // Find maximal value of the variance
-    size_t maxVarianceIndex = 0;
-    float maxVarianceValue = 0.0f;
-
-    for (size_t i = 0; i < interClassVariance.size(); ++i)
-    {
-        if (interClassVariance[i] > maxVarianceValue)
-        {
-            maxVarianceValue = interClassVariance[i];
-            maxVarianceIndex = i;
-        }
+        pixelCount0 += histogram[i];
+        sum0 += i * histogram[i] * factor;
     }
 
     return int(maxVarianceIndex);
@@ -27,6 +27,8 @@
 
 #include <QImage>
 
+#include <array>
+
 namespace pdf
 {
 
@@ -85,8 +87,15 @@ public:
     /// is undefined.
     QImage getConvertedImage() const;
 
+    /// Returns data of the converted image as 1 bit per pixel rows, each row
+    /// starts at byte boundary, first pixel of the row is in the highest bit.
+    /// Bit value 1 means white pixel, 0 black pixel, so data can be directly
+    /// used as image data of DeviceGray image with 1 bit per component. This
+    /// method should only be called after successful convert() method.
+    QByteArray getConvertedImageData() const;
+
 private:
-    int calculateOtsu1DThreshold() const;
+    static int calculateOtsu1DThreshold(const std::array<int, 256>& histogram);
 
     static constexpr int DEFAULT_THRESHOLD = 128;
 
@@ -1111,6 +1111,83 @@ PDFJBIG2Decoder::~PDFJBIG2Decoder()
 
 }
 
+PDFJBIG2Globals::~PDFJBIG2Globals()
+{
+
+}
+
+const PDFJBIG2Segment* PDFJBIG2Globals::getSegment(uint32_t segmentNumber) const
+{
+    auto it = m_segments.find(segmentNumber);
+    if (it != m_segments.cend())
+    {
+        return it->second.get();
+    }
+
+    return nullptr;
+}
+
+void PDFJBIG2Decoder::setGlobals(PDFJBIG2GlobalsPointer globals)
+{
+    m_globals = qMove(globals);
+    m_globalData.clear();
+}
+
+PDFJBIG2GlobalsPointer PDFJBIG2Decoder::decodeGlobals(QByteArray globalData, PDFRenderErrorReporter* errorReporter)
+{
+    PDFJBIG2Decoder decoder(QByteArray(), qMove(globalData), errorReporter);
+
+    if (!decoder.m_globalData.isEmpty())
+    {
+        decoder.m_reader = PDFBitReader(&decoder.m_globalData, 8);
+        decoder.processStream();
+    }
+
+    if (decoder.m_pageBitmap.isValid())
+    {
+        // Global data contain page, it is not just a set of global segments
+        return nullptr;
+    }
+
+    std::shared_ptr<PDFJBIG2Globals> globals = std::make_shared<PDFJBIG2Globals>();
+    globals->m_segments = qMove(decoder.m_segments);
+
+    auto getBitmapSize = [](const PDFJBIG2Bitmap& bitmap) -> qint64
+    {
+        return qint64(bitmap.getWordsPerRow()) * bitmap.getHeight() * sizeof(uint64_t) + sizeof(PDFJBIG2Bitmap);
+    };
+
+    auto getBitmapsSize = [&getBitmapSize](const std::vector<PDFJBIG2Bitmap>& bitmaps)
+    {
+        qint64 size = 0;
+        for (const PDFJBIG2Bitmap& bitmap : bitmaps)
+        {
+            size += getBitmapSize(bitmap);
+        }
+        return size;
+    };
+
+    for (const auto& segment : globals->m_segments)
+    {
+        globals->m_size += sizeof(PDFJBIG2Segment);
+
+        if (const PDFJBIG2Bitmap* bitmap = segment.second->asBitmap())
+        {
+            globals->m_size += getBitmapSize(*bitmap);
+        }
+        else if (const PDFJBIG2SymbolDictionary* symbolDictionary = segment.second->asSymbolDictionary())
+        {
+            globals->m_size += getBitmapsSize(symbolDictionary->getBitmaps());
+        }
+        else if (const PDFJBIG2PatternDictionary* patternDictionary = segment.second->asPatternDictionary())
+        {
+            globals->m_size += getBitmapsSize(patternDictionary->getBitmaps());
+        }
+    }
+
+    return globals;
+}
+
 PDFImageData PDFJBIG2Decoder::decode(PDFImageData::MaskingType maskingType)
 {
     for (const QByteArray* data :  { &m_globalData, &m_data })
@@ -1124,21 +1201,7 @@ PDFImageData PDFJBIG2Decoder::decode(PDFImageData::MaskingType maskingType)
 
     if (m_pageBitmap.isValid())
     {
-        PDFBitWriter writer(1);
-
-        const int columns = m_pageBitmap.getWidth();
-        const int rows = m_pageBitmap.getHeight();
-
-        for (int row = 0; row < rows; ++row)
-        {
-            for (int column = 0; column < columns; ++column)
-            {
-                writer.write(!m_pageBitmap.getPixel(column, row));
-            }
-            writer.finishLine();
-        }
-
-        return PDFImageData(1, 1, static_cast<uint32_t>(columns), static_cast<uint32_t>(rows), static_cast<uint32_t>((columns + 7) / 8), maskingType, writer.takeByteArray(), { }, { }, { });
+        return m_pageBitmap.toImageData(maskingType);
     }
 
     return PDFImageData();
@@ -2386,7 +2449,7 @@ void PDFJBIG2Decoder::processHalftoneRegion(const PDFJBIG2SegmentHeader& header)
     parameters.arithmeticDecoderState = &genericState;
     parameters.data = qMove(mmrData);
 
-    PDFJBIG2Bitmap GI(HGW, HGH, 0x00);
+    std::vector<uint8_t> GI(HGW * HGH, 0x00);
     for (int J = HBPP - 1; J >= 0; --J)
     {
         PDFJBIG2Bitmap PLANE = readBitmap(parameters);
@@ -2423,9 +2486,9 @@ void PDFJBIG2Decoder::processHalftoneRegion(const PDFJBIG2SegmentHeader& header)
             for (int y = 0; y < static_cast<int>(HGH); ++y)
             {
                 // Old bit is in the first position of grayscale image
-                const uint8_t oldPixel = GI.getPixel(x, y);
-                const uint8_t bit = (oldPixel ^ PLANE.getPixel(x, y)) & 0x01;
-                GI.setPixel(x, y, (oldPixel << 1) | bit);
+                uint8_t& grayValue = GI[y * HGW + x];
+                const uint8_t bit = (grayValue ^ PLANE.getPixel(x, y)) & 0x01;
+                grayValue = (grayValue << 1) | bit;
             }
         }
     }
@@ -2440,7 +2503,7 @@ void PDFJBIG2Decoder::processHalftoneRegion(const PDFJBIG2SegmentHeader& header)
             const int y = (static_cast<int>(HGY) + MG * static_cast<int>(HRX) - NG * static_cast<int>(HRY)) / 256;
 
             /* 6.6.5.1 1) a) ii) */
-            const uint8_t index = GI.getPixel(NG, MG);
+            const uint8_t index = GI[MG * HGW + NG];
             if (Q_UNLIKELY(index >= HNUMPATS))
             {
                 throw PDFException(PDFTranslationContext::tr("JBIG2 halftoning pattern index %1 out of bounds [0, %2]").arg(index).arg(HNUMPATS));
@@ -2847,6 +2910,20 @@ PDFJBIG2Bitmap PDFJBIG2Decoder::getBitmap(const uint32_t segmentIndex, bool remo
         return result;
     }
 
+    // Global segments are shared, so bitmap is always copied
+    if (const PDFJBIG2Segment* segment = m_globals ? m_globals->getSegment(segmentIndex) : nullptr)
+    {
+        const PDFJBIG2Bitmap* bitmap = segment->asBitmap();
+
+        if (!bitmap)
+        {
+            throw PDFException(PDFTranslationContext::tr("JBIG2 segment %1 is not a bitmap.").arg(segmentIndex));
+        }
+
+        result = *bitmap;
+        return result;
+    }
+
     throw PDFException(PDFTranslationContext::tr("JBIG2 bitmap segment %1 not found.").arg(segmentIndex));
 }
 
@@ -2869,16 +2946,40 @@ PDFJBIG2Bitmap PDFJBIG2Decoder::readBitmap(PDFJBIG2BitmapDecodingParameters& par
 
         PDFJBIG2Bitmap bitmap(data.getWidth(), data.getHeight(), m_pageDefaultPixelValue);
 
-        // Copy the data
-        PDFBitReader reader(&data.getData(), data.getBitsPerComponent());
-        for (unsigned int row = 0; row < data.getHeight(); ++row)
+        // Copy the data, whole bytes of the rows are copied at once, if the data are complete
+        const unsigned int rowBytes = (data.getWidth() + 7) / 8;
+        if (data.getBitsPerComponent() == 1 && size_t(data.getStride()) * data.getHeight() <= size_t(data.getData().size()))
         {
-            for (unsigned int column = 0; column < data.getWidth(); ++column)
+            for (unsigned int row = 0; row < data.getHeight(); ++row)
             {
-                bitmap.setPixel(column, row, (reader.read()) ? 0x00 : 0xFF);
+                const unsigned char* sourceRow = data.getRow(row);
+                uint64_t* targetRow = bitmap.getRow(row);
+                std::fill(targetRow, targetRow + bitmap.getWordsPerRow(), 0);
+
+                for (unsigned int i = 0; i < rowBytes; ++i)
+                {
+                    targetRow[i >> 3] |= uint64_t(uint8_t(~sourceRow[i])) << (56 - 8 * (i & 7));
+                }
+
+                // Clear unused bits at the end of the row
+                if (const unsigned int usedBits = data.getWidth() & 63)
+                {
+                    targetRow[bitmap.getWordsPerRow() - 1] &= ~(~uint64_t(0) >> usedBits);
+                }
             }
+        }
+        else
+        {
+            PDFBitReader reader(&data.getData(), data.getBitsPerComponent());
+            for (unsigned int row = 0; row < data.getHeight(); ++row)
+            {
+                for (unsigned int column = 0; column < data.getWidth(); ++column)
+                {
+                    bitmap.setPixel(column, row, (reader.read()) ? 0x00 : 0xFF);
+                }
 
-            reader.alignToBytes();
+                reader.alignToBytes();
+            }
         }
 
         return bitmap;
@@ -3014,15 +3115,18 @@ PDFJBIG2Bitmap PDFJBIG2Decoder::readBitmap(PDFJBIG2BitmapDecodingParameters& par
                     continue;
                 }
 
-                uint16_t pixelContext = 0;
-                uint16_t pixelContextShift = 0;
-                auto createContextBit = [&](int offsetX, int offsetY)
+                // Pixels of the template lying in the same row are read at once as a bit window,
+                // where the leftmost pixel is in the highest bit. Adaptive pixels are read separately.
+                auto getPixels = [&bitmap, x, y](int offsetX, int offsetY, int count) -> uint32_t
                 {
-                    uint16_t bit = bitmap.getPixelSafe(offsetX, offsetY) ? 1 : 0;
-                    bit = bit << pixelContextShift;
-                    pixelContext |= bit;
-                    ++pixelContextShift;
+                    return static_cast<uint32_t>(bitmap.getPixels(x + offsetX, y + offsetY) >> (64 - count));
                 };
+                auto getATPixel = [&bitmap, &parameters, x, y](int index) -> uint32_t
+                {
+                    return bitmap.getPixelSafe(x + parameters.GBAT[index].x, y + parameters.GBAT[index].y) ? 1 : 0;
+                };
+
+                uint16_t pixelContext = 0;
 
                 // Create pixel context based on used template
                 switch (parameters.GBTEMPLATE)
@@ -3040,22 +3144,13 @@ PDFJBIG2Bitmap PDFJBIG2Decoder::readBitmap(PDFJBIG2BitmapDecodingParameters& par
                         //  └───┴───┴───┴───┴───┘
 
                         // 16-bit context
-                        createContextBit(x - 1, y);
-                        createContextBit(x - 2, y);
-                        createContextBit(x - 3, y);
-                        createContextBit(x - 4, y);
-                        createContextBit(x + parameters.GBAT[0].x, y + parameters.GBAT[0].y);
-                        createContextBit(x + 2, y - 1);
-                        createContextBit(x + 1, y - 1);
-                        createContextBit(x + 0, y - 1);
-                        createContextBit(x - 1, y - 1);
-                        createContextBit(x - 2, y - 1);
-                        createContextBit(x + parameters.GBAT[1].x, y + parameters.GBAT[1].y);
-                        createContextBit(x + parameters.GBAT[2].x, y + parameters.GBAT[2].y);
-                        createContextBit(x + 1, y - 2);
-                        createContextBit(x + 0, y - 2);
-                        createContextBit(x - 1, y - 2);
-                        createContextBit(x + parameters.GBAT[3].x, y + parameters.GBAT[3].y);
+                        pixelContext = static_cast<uint16_t>(getPixels(-4, 0, 4) |
+                                                             (getATPixel(0) << 4) |
+                                                             (getPixels(-2, -1, 5) << 5) |
+                                                             (getATPixel(1) << 10) |
+                                                             (getATPixel(2) << 11) |
+                                                             (getPixels(-1, -2, 3) << 12) |
+                                                             (getATPixel(3) << 15));
                         break;
                     }
 
@@ -3072,19 +3167,10 @@ PDFJBIG2Bitmap PDFJBIG2Decoder::readBitmap(PDFJBIG2BitmapDecodingParameters& par
                         //  └───┴───┴───┴───┘
 
                         // 13-bit context
-                        createContextBit(x - 1, y);
-                        createContextBit(x - 2, y);
-                        createContextBit(x - 3, y);
-                        createContextBit(x + parameters.GBAT[0].x, y + parameters.GBAT[0].y);
-                        createContextBit(x + 2, y - 1);
-                        createContextBit(x + 1, y - 1);
-                        createContextBit(x + 0, y - 1);
-                        createContextBit(x - 1, y - 1);
-                        createContextBit(x - 2, y - 1);
-                        createContextBit(x + 2, y - 2);
-                        createContextBit(x + 1, y - 2);
-                        createContextBit(x + 0, y - 2);
-                        createContextBit(x - 1, y - 2);
+                        pixelContext = static_cast<uint16_t>(getPixels(-3, 0, 3) |
+                                                             (getATPixel(0) << 3) |
+                                                             (getPixels(-2, -1, 5) << 4) |
+                                                             (getPixels(-1, -2, 4) << 9));
                         break;
                     }
 
@@ -3101,16 +3187,10 @@ PDFJBIG2Bitmap PDFJBIG2Decoder::readBitmap(PDFJBIG2BitmapDecodingParameters& par
                         //      └───┴───┴───┘
 
                         // 10-bit context
-                        createContextBit(x - 1, y);
-                        createContextBit(x - 2, y);
-                        createContextBit(x + parameters.GBAT[0].x, y + parameters.GBAT[0].y);
-                        createContextBit(x + 1, y - 1);
-                        createContextBit(x + 0, y - 1);
-                        createContextBit(x - 1, y - 1);
-                        createContextBit(x - 2, y - 1);
-                        createContextBit(x + 1, y - 2);
-                        createContextBit(x + 0, y - 2);
-                        createContextBit(x - 1, y - 2);
+                        pixelContext = static_cast<uint16_t>(getPixels(-2, 0, 2) |
+                                                             (getATPixel(0) << 2) |
+                                                             (getPixels(-2, -1, 4) << 3) |
+                                                             (getPixels(-1, -2, 3) << 7));
                         break;
                     }
 
@@ -3125,16 +3205,9 @@ PDFJBIG2Bitmap PDFJBIG2Decoder::readBitmap(PDFJBIG2BitmapDecodingParameters& par
                         //      └───┴───┴───┴───┴───┘
 
                         // 10-bit context
-                        createContextBit(x - 1, y);
-                        createContextBit(x - 2, y);
-                        createContextBit(x - 3, y);
-                        createContextBit(x - 4, y);
-                        createContextBit(x + parameters.GBAT[0].x, y + parameters.GBAT[0].y);
-                        createContextBit(x + 1, y - 1);
-                        createContextBit(x + 0, y - 1);
-                        createContextBit(x - 1, y - 1);
-                        createContextBit(x - 2, y - 1);
-                        createContextBit(x - 3, y - 1);
+                        pixelContext = static_cast<uint16_t>(getPixels(-4, 0, 4) |
+                                                             (getATPixel(0) << 4) |
+                                                             (getPixels(-3, -1, 5) << 5));
                         break;
                     }
 
@@ -3567,10 +3640,20 @@ PDFJBIG2ReferencedSegments PDFJBIG2Decoder::getReferencedSegments(const PDFJBIG2
 
     for (const uint32_t referredSegmentId : header.getReferredSegments())
     {
+        const PDFJBIG2Segment* referredSegment = nullptr;
+
         auto it = m_segments.find(referredSegmentId);
-        if (it != m_segments.cend() && it->second)
+        if (it != m_segments.cend())
+        {
+            referredSegment = it->second.get();
+        }
+        else if (m_globals)
+        {
+            referredSegment = m_globals->getSegment(referredSegmentId);
+        }
+
+        if (referredSegment)
         {
-            const PDFJBIG2Segment* referredSegment = it->second.get();
             if (const PDFJBIG2Bitmap* bitmap = referredSegment->asBitmap())
             {
                 segments.bitmaps.push_back(bitmap);
@@ -3641,23 +3724,27 @@ int32_t PDFJBIG2Decoder::checkInteger(std::optional<int32_t> value)
 
 PDFJBIG2Bitmap::PDFJBIG2Bitmap() :
     m_width(0),
-    m_height(0)
+    m_height(0),
+    m_wordsPerRow(0)
 {
 
 }
 
 PDFJBIG2Bitmap::PDFJBIG2Bitmap(int width, int height) :
     m_width(width),
-    m_height(height)
+    m_height(height),
+    m_wordsPerRow((width + 63) / 64)
 {
-    m_data.resize(width * height, 0);
+    m_data.resize(m_wordsPerRow * height, 0);
 }
 
 PDFJBIG2Bitmap::PDFJBIG2Bitmap(int width, int height, uint8_t fill) :
     m_width(width),
-    m_height(height)
+    m_height(height),
+    m_wordsPerRow((width + 63) / 64)
 {
-    m_data.resize(width * height, fill);
+    m_data.resize(m_wordsPerRow * height, fill ? ~uint64_t(0) : uint64_t(0));
+    clearUnusedBits(0);
 }
 
 PDFJBIG2Bitmap::~PDFJBIG2Bitmap()
@@ -3665,18 +3752,49 @@ PDFJBIG2Bitmap::~PDFJBIG2Bitmap()
 
 }
 
+void PDFJBIG2Bitmap::fill(uint8_t value)
+{
+    std::fill(m_data.begin(), m_data.end(), value ? ~uint64_t(0) : uint64_t(0));
+    clearUnusedBits(0);
+}
+
+void PDFJBIG2Bitmap::clearUnusedBits(int firstRow)
+{
+    const int usedBits = m_width & 63;
+    if (usedBits == 0)
+    {
+        return;
+    }
+
+    const uint64_t mask = ~(~uint64_t(0) >> usedBits);
+    for (int y = firstRow; y < m_height; ++y)
+    {
+        getRow(y)[m_wordsPerRow - 1] &= mask;
+    }
+}
+
 PDFJBIG2Bitmap PDFJBIG2Bitmap::getSubbitmap(int offsetX, int offsetY, int width, int height) const
 {
     PDFJBIG2Bitmap result(width, height, 0x00);
 
     for (int y = 0; y < height; ++y)
     {
-        for (int x = 0; x < width; ++x)
+        const int sourceY = y + offsetY;
+        if (sourceY < 0 || sourceY >= m_height)
+        {
+            continue;
+        }
+
+        const uint64_t* sourceRow = getRow(sourceY);
+        uint64_t* targetRow = result.getRow(y);
+        for (int i = 0; i < result.m_wordsPerRow; ++i)
         {
-            result.setPixel(x, y, getPixelSafe(x + offsetX, y + offsetY));
+            targetRow[i] = getRowPixels(sourceRow, m_wordsPerRow, offsetX + i * 64);
         }
     }
 
+    // Pixels from the right of the subbitmap area can be copied to unused bits
+    result.clearUnusedBits(0);
     return result;
 }
 
@@ -3690,8 +3808,10 @@ void PDFJBIG2Bitmap::paint(const PDFJBIG2Bitmap& bitmap, int offsetX, int offset
     // Expand, if it is allowed and target bitmap has too low height
     if (expandY && offsetY + bitmap.getHeight() > m_height)
     {
+        const int oldHeight = m_height;
         m_height = offsetY + bitmap.getHeight();
-        m_data.resize(getPixelCount(), expandPixel);
+        m_data.resize(m_wordsPerRow * m_height, expandPixel ? ~uint64_t(0) : uint64_t(0));
+        clearUnusedBits(oldHeight);
     }
 
     // Check out pathological cases
@@ -3700,48 +3820,81 @@ void PDFJBIG2Bitmap::paint(const PDFJBIG2Bitmap& bitmap, int offsetX, int offset
         return;
     }
 
-    const int targetStartX = offsetX;
+    const int targetStartX = qMax(offsetX, 0);
     const int targetEndX = qMin(offsetX + bitmap.getWidth(), m_width);
-    const int targetStartY = offsetY;
+    const int targetStartY = qMax(offsetY, 0);
     const int targetEndY = qMin(offsetY + bitmap.getHeight(), m_height);
 
+    if (targetStartX >= targetEndX)
+    {
+        return;
+    }
+
+    const int startWord = targetStartX >> 6;
+    const int endWord = (targetEndX - 1) >> 6;
+
+    // Returns mask of pixels of the word, which lie in the paint area
+    auto getMask = [targetStartX, targetEndX](int wordIndex) -> uint64_t
+    {
+        const int wordStartX = wordIndex * 64;
+        const int startBit = qMax(targetStartX - wordStartX, 0);
+        const int endBit = qMin(targetEndX - wordStartX, 64);
+        const uint64_t startMask = ~uint64_t(0) >> startBit;
+        const uint64_t endMask = (endBit < 64) ? ~(~uint64_t(0) >> endBit) : ~uint64_t(0);
+        return startMask & endMask;
+    };
+
+    const uint64_t startMask = getMask(startWord);
+    const uint64_t endMask = getMask(endWord);
+
     for (int targetY = targetStartY; targetY < targetEndY; ++targetY)
     {
-        for (int targetX = targetStartX; targetX < targetEndX; ++targetX)
-        {
-            const int sourceX = targetX - targetStartX;
-            const int sourceY = targetY - targetStartY;
+        const uint64_t* sourceRow = bitmap.getRow(targetY - offsetY);
+        uint64_t* targetRow = getRow(targetY);
 
-            if (targetX < 0 || targetX >= m_width || targetY < 0 || targetY >= m_height)
-            {
-                continue;
-            }
+        for (int wordIndex = startWord; wordIndex <= endWord; ++wordIndex)
+        {
+            const uint64_t source = getRowPixels(sourceRow, bitmap.m_wordsPerRow, wordIndex * 64 - offsetX);
+            const uint64_t target = targetRow[wordIndex];
 
+            uint64_t value = 0;
             switch (operation)
             {
                 case PDFJBIG2BitOperation::Or:
-                    setPixel(targetX, targetY, getPixel(targetX, targetY) | bitmap.getPixel(sourceX, sourceY));
+                    value = target | source;
                     break;
 
                 case PDFJBIG2BitOperation::And:
-                    setPixel(targetX, targetY, getPixel(targetX, targetY) & bitmap.getPixel(sourceX, sourceY));
+                    value = target & source;
                     break;
 
                 case PDFJBIG2BitOperation::Xor:
-                    setPixel(targetX, targetY, getPixel(targetX, targetY) ^ bitmap.getPixel(sourceX, sourceY));
+                    value = target ^ source;
                     break;
 
                 case PDFJBIG2BitOperation::NotXor:
-                    setPixel(targetX, targetY, getPixel(targetX, targetY) ^ (~bitmap.getPixel(sourceX, sourceY)));
+                    value = target ^ (~source);
                     break;
 
                 case PDFJBIG2BitOperation::Replace:
-                    setPixel(targetX, targetY, bitmap.getPixel(sourceX, sourceY));
+                    value = source;
                     break;
 
                 default:
                     throw PDFException(PDFTranslationContext::tr("JBIG2 - invalid bitmap paint operation."));
             }
+
+            uint64_t mask = ~uint64_t(0);
+            if (wordIndex == startWord)
+            {
+                mask &= startMask;
+            }
+            if (wordIndex == endWord)
+            {
+                mask &= endMask;
+            }
+
+            targetRow[wordIndex] = (target & ~mask) | (value & mask);
         }
     }
 }
@@ -3753,10 +3906,34 @@ void PDFJBIG2Bitmap::copyRow(int target, int source)
         throw PDFException(PDFTranslationContext::tr("JBIG2 - invalid bitmap copy row operation."));
     }
 
-    auto itSource = std::next(m_data.cbegin(), source * m_width);
-    auto itSourceEnd = std::next(itSource, m_width);
-    auto itTarget = std::next(m_data.begin(), target * m_width);
-    std::copy(itSource, itSourceEnd, itTarget);
+    const uint64_t* sourceRow = getRow(source);
+    std::copy(sourceRow, sourceRow + m_wordsPerRow, getRow(target));
+}
+
+PDFImageData PDFJBIG2Bitmap::toImageData(PDFImageData::MaskingType maskingType) const
+{
+    const int stride = (m_width + 7) / 8;
+    QByteArray data(stride * m_height, 0);
+    unsigned char* output = reinterpret_cast<unsigned char*>(data.data());
+
+    // Unused bits at the end of the row are zero
+    const uint8_t lastByteMask = (m_width & 7) ? uint8_t(0xFF << (8 - (m_width & 7))) : uint8_t(0xFF);
+
+    for (int y = 0; y < m_height; ++y)
+    {
+        const uint64_t* row = getRow(y);
+        unsigned char* outputRow = output + y * stride;
+
+        for (int i = 0; i < stride; ++i)
+        {
+            const uint64_t word = row[i >> 3];
+            outputRow[i] = ~uint8_t(word >> (56 - 8 * (i & 7)));
+        }
+
+        outputRow[stride - 1] &= lastByteMask;
+    }
+
+    return PDFImageData(1, 1, static_cast<uint32_t>(m_width), static_cast<uint32_t>(m_height), static_cast<uint32_t>(stride), maskingType, qMove(data), { }, { }, { });
 }
 
 PDFJBIG2HuffmanCodeTable::PDFJBIG2HuffmanCodeTable(std::vector<PDFJBIG2HuffmanTableEntry>&& entries) :
@@ -26,6 +26,8 @@
 #include "pdfutils.h"
 #include "pdfcolorspaces.h"
 
+#include <map>
+#include <memory>
 #include <optional>
 
 namespace pdf
@@ -35,12 +37,15 @@ class PDFRenderErrorReporter;
 class PDFJBIG2HuffmanCodeTable;
 class PDFJBIG2SymbolDictionary;
 class PDFJBIG2PatternDictionary;
+class PDFJBIG2Globals;
 
 struct PDFJBIG2HuffmanTableEntry;
 struct PDFJBIG2BitmapDecodingParameters;
 struct PDFJBIG2TextRegionDecodingParameters;
 struct PDFJBIG2BitmapRefinementDecodingParameters;
 
+using PDFJBIG2GlobalsPointer = std::shared_ptr<const PDFJBIG2Globals>;
+
 enum class PDFJBIG2BitOperation
 {
     Invalid,
@@ -328,6 +333,10 @@ private:
     std::vector<PDFJBIG2HuffmanTableEntry> m_entries;
 };
 
+/// Bitonal bitmap of the JBIG2 decoder. Pixels are packed to 64-bit words, first pixel
+/// of the word is stored in the highest bit. Each row starts with new word and unused
+/// bits at the end of the row are always zero, so rows can be processed word by word.
+/// Pixel accessors return 0xFF for set pixels and 0x00 for unset pixels.
 class PDF4QTLIBCORESHARED_EXPORT PDFJBIG2Bitmap : public PDFJBIG2Segment
 {
 public:
@@ -342,8 +351,13 @@ public:
     inline int getWidth() const { return m_width; }
     inline int getHeight() const { return m_height; }
     inline int getPixelCount() const { return m_width * m_height; }
-    inline uint8_t getPixel(int x, int y) const { return m_data[y * m_width + x]; }
-    inline void setPixel(int x, int y, uint8_t value) { m_data[y * m_width + x] = value; }
+    inline uint8_t getPixel(int x, int y) const { return (m_data[y * m_wordsPerRow + (x >> 6)] & getPixelMask(x)) ? 0xFF : 0x00; }
+
+    inline void setPixel(int x, int y, uint8_t value)
+    {
+        uint64_t& word = m_data[y * m_wordsPerRow + (x >> 6)];
+        word = value ? (word | getPixelMask(x)) : (word & ~getPixelMask(x));
+    }
 
     inline uint8_t getPixelSafe(int x, int y) const
     {
@@ -355,7 +369,28 @@ public:
         return getPixel(x, y);
     }
 
-    inline void fill(uint8_t value) { std::fill(m_data.begin(), m_data.end(), value); }
+    /// Returns 64 pixels of the row starting at given position packed to the word,
+    /// first pixel is stored in the highest bit. Pixels outside of the bitmap are zero.
+    /// \param x Horizontal position of the first pixel
+    /// \param y Row
+    inline uint64_t getPixels(int x, int y) const
+    {
+        if (y < 0 || y >= m_height)
+        {
+            return 0;
+        }
+
+        return getRowPixels(getRow(y), m_wordsPerRow, x);
+    }
+
+    /// Returns number of 64-bit words in each row
+    inline int getWordsPerRow() const { return m_wordsPerRow; }
+
+    /// Returns words of the row
+    inline const uint64_t* getRow(int y) const { return m_data.data() + y * m_wordsPerRow; }
+    inline uint64_t* getRow(int y) { return m_data.data() + y * m_wordsPerRow; }
+
+    void fill(uint8_t value);
     inline void fillZero() { fill(0); }
     inline void fillOne() { fill(0xFF); }
 
@@ -385,10 +420,41 @@ public:
     /// \param source Source row
     void copyRow(int target, int source);
 
+    /// Converts the bitmap to 1-bit image data, where set pixels of the bitmap
+    /// are zero (black) and unset pixels are one (white).
+    /// \param maskingType Masking type of the image data
+    PDFImageData toImageData(PDFImageData::MaskingType maskingType) const;
+
 private:
+    static inline uint64_t getPixelMask(int x) { return uint64_t(0x8000000000000000ULL) >> (x & 63); }
+
+    /// Returns 64 pixels of the row starting at given position packed to the word.
+    /// Pixels outside of the row are zero.
+    /// \param row Row words
+    /// \param wordCount Number of words in the row
+    /// \param x Horizontal position of the first pixel
+    static inline uint64_t getRowPixels(const uint64_t* row, int wordCount, int x)
+    {
+        const int wordIndex = x >> 6;
+        const int shift = x & 63;
+
+        auto getWord = [row, wordCount](int index) -> uint64_t { return (index >= 0 && index < wordCount) ? row[index] : 0; };
+
+        if (shift == 0)
+        {
+            return getWord(wordIndex);
+        }
+
+        return (getWord(wordIndex) << shift) | (getWord(wordIndex + 1) >> (64 - shift));
+    }
+
+    /// Clears unused bits at the end of the rows, starting from given row
+    void clearUnusedBits(int firstRow);
+
     int m_width;
     int m_height;
-    std::vector<uint8_t> m_data;
+    int m_wordsPerRow;
+    std::vector<uint64_t> m_data;
 };
 
 struct PDFJBIG2ReferencedSegments
@@ -429,6 +495,32 @@ struct PDFJBIG2ATPosition
 
 using PDFJBIG2ATPositions = std::array<PDFJBIG2ATPosition, 4>;
 
+/// Decoded global segments of the JBIG2 images (JBIG2Globals stream). Segments
+/// are immutable after decoding, so they can be shared by decoders of multiple
+/// images, even if images are decoded in different threads.
+class PDF4QTLIBCORESHARED_EXPORT PDFJBIG2Globals
+{
+public:
+    explicit inline PDFJBIG2Globals() = default;
+    ~PDFJBIG2Globals();
+
+    PDFJBIG2Globals(const PDFJBIG2Globals&) = delete;
+    PDFJBIG2Globals& operator=(const PDFJBIG2Globals&) = delete;
+
+    /// Returns segment with given number. If segment doesn't exist, nullptr is returned.
+    /// \param segmentNumber Segment number
+    const PDFJBIG2Segment* getSegment(uint32_t segmentNumber) const;
+
+    /// Returns approximate size of the decoded segments in bytes
+    qint64 getSize() const { return m_size; }
+
+private:
+    friend class PDFJBIG2Decoder;
+
+    std::map<uint32_t, std::unique_ptr<PDFJBIG2Segment>> m_segments;
+    qint64 m_size = 0;
+};
+
 /// Decoder of JBIG2 data streams. Decodes the black/white monochrome image.
 /// Handles also global segments. Decoder decodes data using the specification
 /// ISO/IEC 14492:2001, T.88.
@@ -461,6 +553,18 @@ public:
     /// \param maskingType Image masking type
     PDFImageData decode(PDFImageData::MaskingType maskingType);
 
+    /// Sets already decoded global segments. Global data passed in the constructor
+    /// are then ignored, only segments of the image data are decoded.
+    /// \param globals Decoded global segments
+    void setGlobals(PDFJBIG2GlobalsPointer globals);
+
+    /// Decodes global segments, so they can be shared by multiple decoders. If global
+    /// data contain also page segments, they can't be shared and nullptr is returned.
+    /// Exception is thrown, if global segments can't be decoded.
+    /// \param globalData Data of the global segments (JBIG2Globals stream)
+    /// \param errorReporter Error reporter
+    static PDFJBIG2GlobalsPointer decodeGlobals(QByteArray globalData, PDFRenderErrorReporter* errorReporter);
+
     /// Decodes image interpreting the data as JBIG2 file stream (not data stream).
     /// Decoding procedure also handles file header/file flags and number of pages.
     /// If number of pages is invalid, then exception is thrown.
@@ -528,6 +632,7 @@ private:
     PDFRenderErrorReporter* m_errorReporter;
     PDFBitReader m_reader;
     std::map<uint32_t, std::unique_ptr<PDFJBIG2Segment>> m_segments;
+    PDFJBIG2GlobalsPointer m_globals;
     uint8_t m_pageDefaultPixelValue;
     PDFJBIG2BitOperation m_pageDefaultCompositionOperator;
     bool m_pageDefaultCompositionOperatorOverriden;
@@ -0,0 +1,169 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pdfmemoryreport.h"
+
+#include <QFile>
+#include <QMutex>
+#include <QLocale>
+#include "pdfdbgheap.h"
+
+#ifdef Q_OS_WIN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#include <psapi.h>
+#endif
+
+#include <numeric>
+#include <algorithm>
+
+namespace pdf
+{
+
+void PDFMemoryReport::addItem(QString name, qint64 bytes, qint64 count)
+{
+    Item item;
+    item.name = qMove(name);
+    item.bytes = bytes;
+    item.count = count;
+    m_items.emplace_back(qMove(item));
+}
+
+void PDFMemoryReport::addReport(const QString& prefix, const PDFMemoryReport& report)
+{
+    for (const Item& item : report.getItems())
+    {
+        addItem(prefix.isEmpty() ? item.name : QString("%1 / %2").arg(prefix, item.name), item.bytes, item.count);
+    }
+}
+
+qint64 PDFMemoryReport::getTotalBytes() const
+{
+    return std::accumulate(m_items.cbegin(), m_items.cend(), qint64(0), [](qint64 value, const Item& item) { return value + item.bytes; });
+}
+
+QString PDFMemoryReport::formatBytes(qint64 bytes)
+{
+    return QLocale::system().formattedDataSize(bytes, 1, QLocale::DataSizeTraditionalFormat);
+}
+
+namespace
+{
+
+struct PDFMemoryAccountingRegistry
+{
+    struct Entry
+    {
+        const PDFMemoryAccountable* accountable = nullptr;
+        QString name;
+    };
+
+    static PDFMemoryAccountingRegistry* getInstance()
+    {
+        static PDFMemoryAccountingRegistry registry;
+        return &registry;
+    }
+
+    QMutex mutex;
+    std::vector<Entry> entries;
+};
+
+}   // namespace
+
+void PDFMemoryAccounting::registerAccountable(const PDFMemoryAccountable* accountable, QString name)
+{
+    Q_ASSERT(accountable);
+
+    PDFMemoryAccountingRegistry* registry = PDFMemoryAccountingRegistry::getInstance();
+    QMutexLocker lock(&registry->mutex);
+    registry->entries.push_back({ accountable, qMove(name) });
+}
+
+void PDFMemoryAccounting::unregisterAccountable(const PDFMemoryAccountable* accountable)
+{
+    PDFMemoryAccountingRegistry* registry = PDFMemoryAccountingRegistry::getInstance();
+    QMutexLocker lock(&registry->mutex);
+    auto& entries = registry->entries;
+    entries.erase(std::remove_if(entries.begin(), entries.end(), [accountable](const auto& entry) { return entry.accountable == accountable; }), entries.end());
+}
+
+PDFMemoryReport PDFMemoryAccounting::createProcessReport()
+{
+    PDFMemoryReport report;
+
+    {
+        PDFMemoryAccountingRegistry* registry = PDFMemoryAccountingRegistry::getInstance();
+        QMutexLocker lock(&registry->mutex);
+        for (const auto& entry : registry->entries)
+        {
+            PDFMemoryReport accountableReport;
+            entry.accountable->collectMemoryUsage(&accountableReport);
+            report.addReport(entry.name, accountableReport);
+        }
+    }
+
+    const qint64 processMemoryUsage = getProcessMemoryUsage();
+    if (processMemoryUsage >= 0)
+    {
+        // Process memory contains memory of all items, so it is reported as untracked rest
+        const qint64 trackedMemory = report.getTotalBytes();
+        report.addItem(PDFTranslationContext::tr("Other process memory"), qMax(processMemoryUsage - trackedMemory, qint64(0)));
+    }
+
+    return report;
+}
+
+qint64 PDFMemoryAccounting::getProcessMemoryUsage()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters = { };
+    if (K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return qint64(counters.WorkingSetSize);
+    }
+#elif defined(Q_OS_LINUX)
+    QFile file(QLatin1String("/proc/self/status"));
+    if (file.open(QFile::ReadOnly | QFile::Text))
+    {
+        // Line is in format "VmRSS:     123456 kB"
+        QByteArray line;
+        while (!(line = file.readLine()).isEmpty())
+        {
+            if (line.startsWith("VmRSS:"))
+            {
+                QByteArray value = line.mid(line.indexOf(':') + 1).trimmed();
+                value.chop(value.endsWith("kB") ? 2 : 0);
+                bool ok = false;
+                const qint64 kiloBytes = value.trimmed().toLongLong(&ok);
+                return ok ? kiloBytes * 1024 : -1;
+            }
+        }
+    }
+#endif
+
+    return -1;
+}
+
+}   // namespace pdf
@@ -0,0 +1,121 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef PDFMEMORYREPORT_H
+#define PDFMEMORYREPORT_H
+
+#include "pdfglobal.h"
+
+#include <QString>
+
+#include <vector>
+
+namespace pdf
+{
+
+/// Report of memory consumed by storages and caches. Report consists of items,
+/// each item describes one component (for example, object storage, or cache
+/// of compiled pages). Sizes are estimates, data shared between components
+/// (for example, implicitly shared byte arrays) may be counted multiple times.
+class PDF4QTLIBCORESHARED_EXPORT PDFMemoryReport
+{
+public:
+    explicit PDFMemoryReport() = default;
+
+    struct Item
+    {
+        QString name;           ///< Name of the component
+        qint64 bytes = 0;       ///< Estimate of consumed memory [bytes]
+        qint64 count = -1;      ///< Count of items of the component (-1, if not applicable)
+    };
+
+    /// Adds item to the report
+    /// \param name Name of the component
+    /// \param bytes Estimate of consumed memory [bytes]
+    /// \param count Count of items of the component (-1, if not applicable)
+    void addItem(QString name, qint64 bytes, qint64 count = -1);
+
+    /// Adds all items of another report. Names of the items are prefixed
+    /// by \p prefix (if it is not empty), separated by slash.
+    /// \param prefix Prefix of the names
+    /// \param report Report
+    void addReport(const QString& prefix, const PDFMemoryReport& report);
+
+    /// Returns items of the report
+    const std::vector<Item>& getItems() const { return m_items; }
+
+    /// Returns true, if report has no items
+    bool isEmpty() const { return m_items.empty(); }
+
+    /// Returns total memory of all items [bytes]
+    qint64 getTotalBytes() const;
+
+    /// Formats size in bytes in human readable form (B, kB, MB, GB)
+    /// \param bytes Size [bytes]
+    static QString formatBytes(qint64 bytes);
+
+private:
+    std::vector<Item> m_items;
+};
+
+/// Interface of storages and caches, which can report memory they consume
+class PDF4QTLIBCORESHARED_EXPORT PDFMemoryAccountable
+{
+public:
+    virtual ~PDFMemoryAccountable() = default;
+
+    /// Adds items describing consumed memory into the report
+    /// \param report Report
+    virtual void collectMemoryUsage(PDFMemoryReport* report) const = 0;
+};
+
+/// Registry of memory accountable objects of the process (for example, document
+/// sessions of the viewer). It creates the report of the whole process. Registered
+/// objects must be unregistered before they are destroyed. This class is thread safe.
+class PDF4QTLIBCORESHARED_EXPORT PDFMemoryAccounting
+{
+public:
+    /// Registers object, whose memory is included in the process report
+    /// \param accountable Object
+    /// \param name Name of the object in the report
+    static void registerAccountable(const PDFMemoryAccountable* accountable, QString name);
+
+    /// Unregisters object, which was registered by \p registerAccountable
+    /// \param accountable Object
+    static void unregisterAccountable(const PDFMemoryAccountable* accountable);
+
+    /// Creates report of all registered objects. If it is possible to determine
+    /// physical memory used by the process, it is added as a last item.
+    static PDFMemoryReport createProcessReport();
+
+    /// Returns physical memory used by the process (resident set size) in bytes,
+    /// or -1, if it can't be determined on this platform.
+    static qint64 getProcessMemoryUsage();
+
+private:
+    PDFMemoryAccounting() = delete;
+};
+
+}   // namespace pdf
+
+#endif // PDFMEMORYREPORT_H
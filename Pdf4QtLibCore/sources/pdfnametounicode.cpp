@@ -24,6 +24,8 @@
 #include "pdfdbgheap.h"
 
 #include <array>
+#include <bit>
+#include <limits>
 
 namespace pdf
 {
@@ -4520,38 +4522,175 @@ static constexpr const std::array<std::pair<QChar, const char*>, 201> glyphNameZ
     std::pair<QChar, const char*>{ QChar(0x275D), "a99" }                           // Character '❝' Symbol
 };
 
-QChar PDFNameToUnicode::getUnicodeForName(const QByteArray& name)
+/// Hash tables over glyph name table, both for name to unicode and unicode to name
+/// lookups. Tables use open addressing with linear probing, their size is a power
+/// of two with load factor at most 1/2, so probe sequences are very short. Slots
+/// contain index of the entry in the glyph name table plus one, zero means empty slot.
+/// Glyph name table is immutable, so hash tables are built only once, when they
+/// are used for the first time.
+template<std::size_t Count>
+class PDFGlyphNameHashTable
 {
-    Q_ASSERT(std::is_sorted(glyphNameToUnicode.cbegin(), glyphNameToUnicode.cend(), Comparator()));
+public:
+    using GlyphNameTable = std::array<std::pair<QChar, const char*>, Count>;
 
-    auto [it, itEnd] = std::equal_range(glyphNameToUnicode.cbegin(), glyphNameToUnicode.cend(), name, Comparator());
-    if (it != itEnd)
+    explicit PDFGlyphNameHashTable(const GlyphNameTable& table) :
+        m_table(table),
+        m_nameSlots(),
+        m_unicodeSlots()
     {
-        return it->first;
+        static_assert(Count < std::numeric_limits<uint16_t>::max(), "Glyph name table is too large.");
+
+        for (std::size_t i = 0; i < Count; ++i)
+        {
+            const char* name = m_table[i].second;
+            std::size_t slot = getNameHash(QByteArrayView(name)) & MASK;
+            while (m_nameSlots[slot])
+            {
+                slot = (slot + 1) & MASK;
+            }
+            m_nameSlots[slot] = static_cast<uint16_t>(i + 1);
+
+            // Glyph name table is sorted by names, so for unicode to name mapping,
+            // first name in alphabetical order is stored.
+            const QChar character = m_table[i].first;
+            slot = getUnicodeHash(character) & MASK;
+            while (m_unicodeSlots[slot] && m_table[m_unicodeSlots[slot] - 1].first != character)
+            {
+                slot = (slot + 1) & MASK;
+            }
+            if (!m_unicodeSlots[slot])
+            {
+                m_unicodeSlots[slot] = static_cast<uint16_t>(i + 1);
+            }
+        }
     }
-    else
+
+    QChar getUnicode(QByteArrayView name) const
     {
+        for (std::size_t slot = getNameHash(name) & MASK; m_nameSlots[slot]; slot = (slot + 1) & MASK)
+        {
+            const auto& entry = m_table[m_nameSlots[slot] - 1];
+            if (name == QByteArrayView(entry.second))
+            {
+                return entry.first;
+            }
+        }
+
         return QChar();
     }
-}
 
-QChar PDFNameToUnicode::getUnicodeForNameZapfDingbats(const QByteArray& name)
-{
-    Q_ASSERT(std::is_sorted(glyphNameZapfDingbatsToUnicode.cbegin(), glyphNameZapfDingbatsToUnicode.cend(), Comparator()));
+    QByteArray getName(QChar character) const
+    {
+        for (std::size_t slot = getUnicodeHash(character) & MASK; m_unicodeSlots[slot]; slot = (slot + 1) & MASK)
+        {
+            const auto& entry = m_table[m_unicodeSlots[slot] - 1];
+            if (entry.first == character)
+            {
+                return QByteArray(entry.second);
+            }
+        }
+
+        return QByteArray();
+    }
+
+private:
+    static constexpr std::size_t SIZE = std::bit_ceil(2 * Count);
+    static constexpr std::size_t MASK = SIZE - 1;
 
-    auto [it, itEnd] = std::equal_range(glyphNameZapfDingbatsToUnicode.cbegin(), glyphNameZapfDingbatsToUnicode.cend(), name, Comparator());
-    if (it != itEnd)
+    /// FNV-1a hash of the glyph name
+    static std::size_t getNameHash(QByteArrayView name)
     {
-        return it->first;
+        uint32_t hash = 2166136261u;
+        for (const char c : name)
+        {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+        }
+        return hash ^ (hash >> 15);
     }
-    else
+
+    /// Fibonacci hash of the unicode character, higher bits are folded
+    /// into the lower ones, because mask selects only lower bits.
+    static std::size_t getUnicodeHash(QChar character)
     {
-        return QChar();
+        const uint32_t hash = character.unicode() * 2654435769u;
+        return hash ^ (hash >> 16);
     }
+
+    const GlyphNameTable& m_table;
+    std::array<uint16_t, SIZE> m_nameSlots;
+    std::array<uint16_t, SIZE> m_unicodeSlots;
+};
+
+static const PDFGlyphNameHashTable<glyphNameToUnicode.size()>& getGlyphNameHashTable()
+{
+    static const PDFGlyphNameHashTable<glyphNameToUnicode.size()> table(glyphNameToUnicode);
+    return table;
+}
+
+static const PDFGlyphNameHashTable<glyphNameZapfDingbatsToUnicode.size()>& getGlyphNameZapfDingbatsHashTable()
+{
+    static const PDFGlyphNameHashTable<glyphNameZapfDingbatsToUnicode.size()> table(glyphNameZapfDingbatsToUnicode);
+    return table;
+}
+
+/// Decodes hexadecimal digits of uniXXXX or uXXXXXX glyph names. Returns true,
+/// if all digits are valid hexadecimal digits and value is stored in \p value.
+static bool parseHexadecimalName(QByteArrayView digits, char32_t& value)
+{
+    value = 0;
+    for (const char c : digits)
+    {
+        int digit = 0;
+        if (c >= '0' && c <= '9')
+        {
+            digit = c - '0';
+        }
+        else if (c >= 'A' && c <= 'F')
+        {
+            digit = c - 'A' + 10;
+        }
+        else if (c >= 'a' && c <= 'f')
+        {
+            digit = c - 'a' + 10;
+        }
+        else
+        {
+            return false;
+        }
+
+        value = (value << 4) | static_cast<char32_t>(digit);
+    }
+
+    return true;
+}
+
+QChar PDFNameToUnicode::getUnicodeForName(const QByteArray& name)
+{
+    return getGlyphNameHashTable().getUnicode(QByteArrayView(name));
+}
+
+QChar PDFNameToUnicode::getUnicodeForNameZapfDingbats(const QByteArray& name)
+{
+    return getGlyphNameZapfDingbatsHashTable().getUnicode(QByteArrayView(name));
 }
 
 QChar PDFNameToUnicode::getUnicodeUsingResolvedName(const QByteArray& name)
 {
+    // Fast path for names containing hexadecimal code of the character. Glyph
+    // name tables doesn't contain any such name, so tables can be skipped.
+    char32_t value = 0;
+    if (name.size() == 7 && name.startsWith("uni") && parseHexadecimalName(QByteArrayView(name).sliced(3), value))
+    {
+        return QChar(static_cast<char16_t>(value));
+    }
+
+    if (name.size() >= 5 && name.size() <= 7 && name.startsWith('u') && parseHexadecimalName(QByteArrayView(name).sliced(1), value))
+    {
+        // Only characters from basic multilingual plane can be represented by single QChar
+        return value <= 0xFFFF ? QChar(static_cast<char16_t>(value)) : QChar();
+    }
+
     QChar character = getUnicodeForName(name);
 
     // Try ZapfDingbats, if this fails
@@ -4560,17 +4699,17 @@ QChar PDFNameToUnicode::getUnicodeUsingResolvedName(const QByteArray& name)
         character = getUnicodeForNameZapfDingbats(name);
     }
 
-    if (character.isNull() && name.startsWith("uni"))
-    {
-        QByteArray hexValue = QByteArray::fromHex(name.mid(3, -1));
-        if (hexValue.size() == 2)
-        {
-            unsigned short value = (static_cast<unsigned char>(hexValue[0]) << 8) + static_cast<unsigned char>(hexValue[1]);
-            character = QChar(value);
-        }
-    }
-
     return character;
 }
 
+QByteArray PDFNameToUnicode::getNameForUnicode(QChar character)
+{
+    return getGlyphNameHashTable().getName(character);
+}
+
+QByteArray PDFNameToUnicode::getNameForUnicodeZapfDingbats(QChar character)
+{
+    return getGlyphNameZapfDingbatsHashTable().getName(character);
+}
+
 }   // namespace pdf
@@ -42,25 +42,19 @@ public:
     /// Returns unicode character for name (for ZapfDingbats). If name is not found, then null character is returned.
     static QChar getUnicodeForNameZapfDingbats(const QByteArray& name);
 
-    /// Tries to resolve unicode name
+    /// Tries to resolve unicode name. Names of form uniXXXX and uXXXX to uXXXXXX
+    /// (hexadecimal code of the character) are decoded directly, other names
+    /// are looked up in glyph name tables.
     static QChar getUnicodeUsingResolvedName(const QByteArray& name);
 
-private:
-    struct Comparator
-    {
-        inline bool operator()(const QByteArray& left, const std::pair<QChar, const char*>& right)
-        {
-            return left < right.second;
-        }
-        inline bool operator()(const std::pair<QChar, const char*>& left, const QByteArray& right)
-        {
-            return left.second < right;
-        }
-        inline bool operator()(const std::pair<QChar, const char*>& left, const std::pair<QChar, const char*>& right)
-        {
-            return QLatin1String(left.second) < QLatin1String(right.second);
-        }
-    };
+    /// Returns glyph name for unicode character. If more names are mapped
+    /// to the same character, first one in alphabetical order is returned.
+    /// If character has no name, then empty byte array is returned.
+    static QByteArray getNameForUnicode(QChar character);
+
+    /// Returns glyph name for unicode character (for ZapfDingbats). If character
+    /// has no name, then empty byte array is returned.
+    static QByteArray getNameForUnicodeZapfDingbats(QChar character);
 };
 
 }   // namespace pdf
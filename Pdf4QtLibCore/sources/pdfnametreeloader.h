@@ -26,6 +26,8 @@
 #include "pdfdocument.h"
 
 #include <map>
+#include <set>
+#include <optional>
 #include <functional>
 
 namespace pdf
@@ -53,7 +55,170 @@ public:
         return result;
     }
 
+    /// Finds item with given key in the name tree. Kids of intermediate nodes
+    /// are binary searched using their /Limits entries, so only nodes on the path
+    /// to the key are loaded. If kid has no valid /Limits, its subtree is searched
+    /// sequentially. If item is not found, then std::nullopt is returned.
+    /// \param storage Object storage
+    /// \param root Root of the name tree
+    /// \param key Key of the item
+    /// \param loadMethod Parsing method, which retrieves parsed object
+    static std::optional<Type> find(const PDFObjectStorage* storage, const PDFObject& root, const QByteArray& key, const LoadMethod& loadMethod)
+    {
+        std::set<PDFObjectReference> visited;
+        std::optional<PDFObject> object = findImpl(visited, storage, root, key);
+
+        if (object)
+        {
+            return loadMethod(storage, *object);
+        }
+
+        return std::nullopt;
+    }
+
 private:
+    /// Result of comparison of the key with limits of the node
+    enum class LimitsResult
+    {
+        Invalid,    ///< Node doesn't have valid limits
+        Less,       ///< Key is less than lower limit
+        Inside,     ///< Key is inside the limits
+        Greater     ///< Key is greater than upper limit
+    };
+
+    static LimitsResult compareLimits(const PDFObjectStorage* storage, const PDFDictionary* dictionary, const QByteArray& key)
+    {
+        const PDFObject& limits = storage->getObject(dictionary->get("Limits"));
+        if (limits.isArray() && limits.getArray()->getCount() == 2)
+        {
+            const PDFObject& lowerLimit = storage->getObject(limits.getArray()->getItem(0));
+            const PDFObject& upperLimit = storage->getObject(limits.getArray()->getItem(1));
+
+            if (lowerLimit.isString() && upperLimit.isString())
+            {
+                if (key < lowerLimit.getString())
+                {
+                    return LimitsResult::Less;
+                }
+                if (upperLimit.getString() < key)
+                {
+                    return LimitsResult::Greater;
+                }
+                return LimitsResult::Inside;
+            }
+        }
+
+        return LimitsResult::Invalid;
+    }
+
+    static std::optional<PDFObject> findImpl(std::set<PDFObjectReference>& visited, const PDFObjectStorage* storage, const PDFObject& root, const QByteArray& key)
+    {
+        if (root.isReference() && !visited.insert(root.getReference()).second)
+        {
+            // Cycle in the name tree
+            return std::nullopt;
+        }
+
+        const PDFDictionary* dictionary = storage->getDictionaryFromObject(root);
+        if (!dictionary)
+        {
+            return std::nullopt;
+        }
+
+        const PDFObject& namedItems = storage->getObject(dictionary->get("Names"));
+        if (namedItems.isArray())
+        {
+            // Names should be sorted, so try binary search first. If it fails,
+            // search the items sequentially, because the array may be not sorted.
+            const PDFArray* namedItemsArray = namedItems.getArray();
+            const size_t count = namedItemsArray->getCount() / 2;
+
+            auto getName = [storage, namedItemsArray](size_t i) -> QByteArray
+            {
+                const PDFObject& name = storage->getObject(namedItemsArray->getItem(2 * i));
+                return name.isString() ? name.getString() : QByteArray();
+            };
+
+            size_t low = 0;
+            size_t high = count;
+            while (low < high)
+            {
+                const size_t middle = low + (high - low) / 2;
+                const QByteArray name = getName(middle);
+
+                if (name == key)
+                {
+                    return namedItemsArray->getItem(2 * middle + 1);
+                }
+
+                if (name < key)
+                {
+                    low = middle + 1;
+                }
+                else
+                {
+                    high = middle;
+                }
+            }
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                const PDFObject& name = storage->getObject(namedItemsArray->getItem(2 * i));
+                if (name.isString() && name.getString() == key)
+                {
+                    return namedItemsArray->getItem(2 * i + 1);
+                }
+            }
+        }
+
+        const PDFObject& kids = storage->getObject(dictionary->get("Kids"));
+        if (kids.isArray())
+        {
+            const PDFArray* kidsArray = kids.getArray();
+            const size_t count = kidsArray->getCount();
+
+            size_t low = 0;
+            size_t high = count;
+            while (low < high)
+            {
+                const size_t middle = low + (high - low) / 2;
+                const PDFObject& kid = kidsArray->getItem(middle);
+                const PDFDictionary* kidDictionary = storage->getDictionaryFromObject(kid);
+
+                switch (kidDictionary ? compareLimits(storage, kidDictionary, key) : LimitsResult::Invalid)
+                {
+                    case LimitsResult::Less:
+                        high = middle;
+                        break;
+
+                    case LimitsResult::Greater:
+                        low = middle + 1;
+                        break;
+
+                    case LimitsResult::Inside:
+                        return findImpl(visited, storage, kid, key);
+
+                    case LimitsResult::Invalid:
+                    {
+                        // We can't decide, go through all kids sequentially
+                        for (size_t i = 0; i < count; ++i)
+                        {
+                            std::optional<PDFObject> object = findImpl(visited, storage, kidsArray->getItem(i), key);
+                            if (object)
+                            {
+                                return object;
+                            }
+                        }
+
+                        return std::nullopt;
+                    }
+                }
+            }
+        }
+
+        return std::nullopt;
+    }
+
     static void parseImpl(MappedObjects& objects, const PDFObjectStorage* storage, const PDFObject& root, const LoadMethod& loadMethod)
     {
         if (const PDFDictionary* dictionary = storage->getDictionaryFromObject(root))
@@ -25,7 +25,9 @@
 
 #include "pdfdocument.h"
 
+#include <set>
 #include <vector>
+#include <optional>
 
 namespace pdf
 {
@@ -54,7 +56,129 @@ public:
         return result;
     }
 
+    /// Finds item with given number in the number tree. Kids of intermediate nodes
+    /// are binary searched using their /Limits entries, so only nodes on the path
+    /// to the number are loaded. If kid has no valid /Limits, its subtree is searched
+    /// sequentially. If item is not found, then std::nullopt is returned.
+    /// \param storage Object storage
+    /// \param root Root of the number tree
+    /// \param number Number (key) of the item
+    static std::optional<Type> find(const PDFObjectStorage* storage, const PDFObject& root, PDFInteger number)
+    {
+        std::set<PDFObjectReference> visited;
+        std::optional<PDFObject> object = findImpl(visited, storage, root, number);
+
+        if (object)
+        {
+            return Type::parse(number, storage, *object);
+        }
+
+        return std::nullopt;
+    }
+
 private:
+    static std::optional<PDFObject> findImpl(std::set<PDFObjectReference>& visited, const PDFObjectStorage* storage, const PDFObject& root, PDFInteger number)
+    {
+        if (root.isReference() && !visited.insert(root.getReference()).second)
+        {
+            // Cycle in the number tree
+            return std::nullopt;
+        }
+
+        const PDFDictionary* dictionary = storage->getDictionaryFromObject(root);
+        if (!dictionary)
+        {
+            return std::nullopt;
+        }
+
+        const PDFObject& numberedItems = storage->getObject(dictionary->get("Nums"));
+        if (numberedItems.isArray())
+        {
+            const PDFArray* numberedItemsArray = numberedItems.getArray();
+            const size_t count = numberedItemsArray->getCount() / 2;
+            for (size_t i = 0; i < count; ++i)
+            {
+                const PDFObject& itemNumber = storage->getObject(numberedItemsArray->getItem(2 * i));
+                if (itemNumber.isInt() && itemNumber.getInteger() == number)
+                {
+                    return numberedItemsArray->getItem(2 * i + 1);
+                }
+            }
+        }
+
+        const PDFObject& kids = storage->getObject(dictionary->get("Kids"));
+        if (kids.isArray())
+        {
+            const PDFArray* kidsArray = kids.getArray();
+            const size_t count = kidsArray->getCount();
+
+            // Returns -1, 0, 1 if number is less, inside or greater than the limits
+            // of the kid, or std::nullopt, if kid doesn't have valid limits.
+            auto compareLimits = [storage, number](const PDFObject& kid) -> std::optional<int>
+            {
+                if (const PDFDictionary* kidDictionary = storage->getDictionaryFromObject(kid))
+                {
+                    const PDFObject& limits = storage->getObject(kidDictionary->get("Limits"));
+                    if (limits.isArray() && limits.getArray()->getCount() == 2)
+                    {
+                        const PDFObject& lowerLimit = storage->getObject(limits.getArray()->getItem(0));
+                        const PDFObject& upperLimit = storage->getObject(limits.getArray()->getItem(1));
+                        if (lowerLimit.isInt() && upperLimit.isInt())
+                        {
+                            if (number < lowerLimit.getInteger())
+                            {
+                                return -1;
+                            }
+                            return number > upperLimit.getInteger() ? 1 : 0;
+                        }
+                    }
+                }
+
+                return std::nullopt;
+            };
+
+            size_t low = 0;
+            size_t high = count;
+            while (low < high)
+            {
+                const size_t middle = low + (high - low) / 2;
+                const PDFObject& kid = kidsArray->getItem(middle);
+                std::optional<int> comparison = compareLimits(kid);
+
+                if (!comparison)
+                {
+                    // We can't decide, go through all kids sequentially
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        std::optional<PDFObject> object = findImpl(visited, storage, kidsArray->getItem(i), number);
+                        if (object)
+                        {
+                            return object;
+                        }
+                    }
+
+                    return std::nullopt;
+                }
+
+                switch (*comparison)
+                {
+                    case -1:
+                        high = middle;
+                        break;
+
+                    case 1:
+                        low = middle + 1;
+                        break;
+
+                    default:
+                        return findImpl(visited, storage, kid, number);
+                }
+            }
+        }
+
+        return std::nullopt;
+    }
+
     static void parseImpl(Objects& objects, const PDFObjectStorage* storage, const PDFObject& root)
     {
         if (const PDFDictionary* dictionary = storage->getDictionaryFromObject(root))
@@ -22,8 +22,18 @@
 
 #include "pdfobject.h"
 #include "pdfvisitor.h"
+
+#include <QReadWriteLock>
+
 #include "pdfdbgheap.h"
 
+#include <limits>
+#include <atomic>
+#include <cstdint>
+#include <numeric>
+#include <algorithm>
+#include <unordered_set>
+
 namespace pdf
 {
 
@@ -190,6 +200,30 @@ PDFObject PDFObject::createString(QByteArray name)
     }
 }
 
+PDFObject PDFObject::createName(QByteArray name, const PDFObjectArenaPointer& arena)
+{
+    if (name.size() > PDFInplaceString::MAX_STRING_SIZE)
+    {
+        return PDFObject(Type::Name, makeSharedInArena<PDFString>(arena, qMove(name)));
+    }
+    else
+    {
+        return PDFObject(Type::Name, PDFInplaceString(qMove(name)));
+    }
+}
+
+PDFObject PDFObject::createString(QByteArray string, const PDFObjectArenaPointer& arena)
+{
+    if (string.size() > PDFInplaceString::MAX_STRING_SIZE)
+    {
+        return PDFObject(Type::String, makeSharedInArena<PDFString>(arena, qMove(string)));
+    }
+    else
+    {
+        return PDFObject(Type::String, PDFInplaceString(qMove(string)));
+    }
+}
+
 PDFObject PDFObject::createName(PDFStringRef name)
 {
     if (name.memoryString)
@@ -218,6 +252,13 @@ bool PDFString::equals(const PDFObjectContent* other) const
 {
     Q_ASSERT(dynamic_cast<const PDFString*>(other));
     const PDFString* otherString = static_cast<const PDFString*>(other);
+
+    // Interned names share the data
+    if (m_string.constData() == otherString->m_string.constData())
+    {
+        return m_string.size() == otherString->m_string.size();
+    }
+
     return m_string == otherString->m_string;
 }
 
@@ -228,7 +269,11 @@ void PDFString::setString(const QByteArray& string)
 
 void PDFString::optimize()
 {
-    m_string.shrink_to_fit();
+    // Shrinking of shared string (for example, interned name) would create a copy
+    if (m_string.isDetached())
+    {
+        m_string.shrink_to_fit();
+    }
 }
 
 bool PDFArray::equals(const PDFObjectContent* other) const
@@ -307,6 +352,7 @@ void PDFDictionary::removeEntry(const char* key)
     auto it = find(key);
     if (it != m_dictionary.end())
     {
+        m_index.reset();
         m_dictionary.erase(it);
     }
 }
@@ -326,50 +372,188 @@ void PDFDictionary::setEntry(const PDFInplaceOrMemoryString& key, PDFObject&& va
 
 void PDFDictionary::removeNullObjects()
 {
-    m_dictionary.erase(std::remove_if(m_dictionary.begin(), m_dictionary.end(), [](const DictionaryEntry& entry) { return entry.second.isNull(); }), m_dictionary.end());
+    auto it = std::remove_if(m_dictionary.begin(), m_dictionary.end(), [](const DictionaryEntry& entry) { return entry.second.isNull(); });
+    if (it != m_dictionary.end())
+    {
+        m_index.reset();
+        m_dictionary.erase(it, m_dictionary.end());
+    }
     m_dictionary.shrink_to_fit();
 }
 
+// Compares keys as byte strings
+static inline int compareDictionaryKeys(QByteArrayView left, QByteArrayView right)
+{
+    const qsizetype commonSize = qMin(left.size(), right.size());
+    if (commonSize > 0)
+    {
+        if (const int result = std::memcmp(left.data(), right.data(), commonSize))
+        {
+            return result;
+        }
+    }
+
+    return left.size() < right.size() ? -1 : (left.size() > right.size() ? 1 : 0);
+}
+
 void PDFDictionary::optimize()
 {
     m_dictionary.shrink_to_fit();
+
+    if (!m_index && m_dictionary.size() >= INDEX_THRESHOLD && m_dictionary.size() <= std::numeric_limits<uint32_t>::max())
+    {
+        std::vector<uint32_t> index(m_dictionary.size());
+        std::iota(index.begin(), index.end(), 0);
+        std::stable_sort(index.begin(), index.end(), [this](uint32_t left, uint32_t right) { return compareDictionaryKeys(m_dictionary[left].first.getView(), m_dictionary[right].first.getView()) < 0; });
+        m_index = std::make_shared<const std::vector<uint32_t>>(std::move(index));
+    }
+}
+
+size_t PDFDictionary::findIndex(QByteArrayView key) const
+{
+    if (m_index)
+    {
+        // Binary search, first of the entries with the same key is found,
+        // because sorting of the index is stable.
+        const std::vector<uint32_t>& index = *m_index;
+        auto it = std::lower_bound(index.cbegin(), index.cend(), key, [this](uint32_t entryIndex, QByteArrayView value) { return compareDictionaryKeys(m_dictionary[entryIndex].first.getView(), value) < 0; });
+        if (it != index.cend() && compareDictionaryKeys(m_dictionary[*it].first.getView(), key) == 0)
+        {
+            return *it;
+        }
+
+        return m_dictionary.size();
+    }
+
+    for (size_t i = 0, count = m_dictionary.size(); i < count; ++i)
+    {
+        if (m_dictionary[i].first.equals(key.data(), key.size()))
+        {
+            return i;
+        }
+    }
+
+    return m_dictionary.size();
 }
 
 std::vector<PDFDictionary::DictionaryEntry>::const_iterator PDFDictionary::find(const QByteArray& key) const
 {
-    return std::find_if(m_dictionary.cbegin(), m_dictionary.cend(), [&key](const DictionaryEntry& entry) { return entry.first == key; });
+    return std::next(m_dictionary.cbegin(), findIndex(QByteArrayView(key)));
 }
 
 std::vector<PDFDictionary::DictionaryEntry>::iterator PDFDictionary::find(const QByteArray& key)
 {
-    return std::find_if(m_dictionary.begin(), m_dictionary.end(), [&key](const DictionaryEntry& entry) { return entry.first == key; });
+    return std::next(m_dictionary.begin(), findIndex(QByteArrayView(key)));
 }
 
 std::vector<PDFDictionary::DictionaryEntry>::const_iterator PDFDictionary::find(const char* key) const
 {
-    return std::find_if(m_dictionary.cbegin(), m_dictionary.cend(), [key](const DictionaryEntry& entry) { return entry.first == key; });
+    return std::next(m_dictionary.cbegin(), findIndex(QByteArrayView(key, std::strlen(key))));
 }
 
 std::vector<PDFDictionary::DictionaryEntry>::const_iterator PDFDictionary::find(const PDFInplaceOrMemoryString& key) const
 {
-    return std::find_if(m_dictionary.cbegin(), m_dictionary.cend(), [&key](const DictionaryEntry& entry) { return entry.first == key; });
+    return std::next(m_dictionary.cbegin(), findIndex(key.getView()));
 }
 
 std::vector<PDFDictionary::DictionaryEntry>::iterator PDFDictionary::find(const PDFInplaceOrMemoryString& key)
 {
-    return std::find_if(m_dictionary.begin(), m_dictionary.end(), [&key](const DictionaryEntry& entry) { return entry.first == key; });
+    return std::next(m_dictionary.begin(), findIndex(key.getView()));
 }
 
 std::vector<PDFDictionary::DictionaryEntry>::iterator PDFDictionary::find(const char* key)
 {
-    return std::find_if(m_dictionary.begin(), m_dictionary.end(), [key](const DictionaryEntry& entry) { return entry.first == key; });
+    return std::next(m_dictionary.begin(), findIndex(QByteArrayView(key, std::strlen(key))));
+}
+
+struct PDFStream::LazyDecryption
+{
+    explicit LazyDecryption(PDFStreamDecryptorPointer decryptor, PDFObjectReference reference, bool isEmbeddedFile) :
+        decryptor(std::move(decryptor)),
+        reference(reference),
+        isEmbeddedFile(isEmbeddedFile)
+    {
+
+    }
+
+    PDFStreamDecryptorPointer decryptor;
+    PDFObjectReference reference;
+    bool isEmbeddedFile = false;
+    std::atomic_bool isDecrypted = false;
+    QMutex mutex;
+    QByteArray decryptedContent;
+};
+
+PDFStream::PDFStream(PDFDictionary&& dictionary,
+                     QByteArray&& content,
+                     PDFStreamDataOwner dataOwner,
+                     PDFStreamDecryptorPointer decryptor,
+                     PDFObjectReference reference,
+                     bool isEmbeddedFile) :
+    m_dictionary(std::move(dictionary)),
+    m_content(std::move(content)),
+    m_dataOwner(std::move(dataOwner))
+{
+    if (decryptor)
+    {
+        m_lazyDecryption = std::make_shared<LazyDecryption>(std::move(decryptor), reference, isEmbeddedFile);
+    }
 }
 
 bool PDFStream::equals(const PDFObjectContent* other) const
 {
     Q_ASSERT(dynamic_cast<const PDFStream*>(other));
     const PDFStream* otherStream = static_cast<const PDFStream*>(other);
-    return m_dictionary.equals(&otherStream->m_dictionary) && m_content == otherStream->m_content;
+
+    if (!m_lazyDecryption && !otherStream->m_lazyDecryption)
+    {
+        return m_dictionary.equals(&otherStream->m_dictionary) && m_content == otherStream->m_content;
+    }
+
+    return m_dictionary.equals(&otherStream->m_dictionary) && *getContent() == *otherStream->getContent();
+}
+
+const QByteArray* PDFStream::getContent() const
+{
+    LazyDecryption* lazyDecryption = m_lazyDecryption.get();
+    if (!lazyDecryption)
+    {
+        return &m_content;
+    }
+
+    if (!lazyDecryption->isDecrypted.load(std::memory_order_acquire))
+    {
+        QMutexLocker lock(&lazyDecryption->mutex);
+        if (!lazyDecryption->isDecrypted.load(std::memory_order_relaxed))
+        {
+            lazyDecryption->decryptedContent = lazyDecryption->decryptor->decrypt(m_content, lazyDecryption->reference, lazyDecryption->isEmbeddedFile);
+            lazyDecryption->isDecrypted.store(true, std::memory_order_release);
+        }
+    }
+
+    return &lazyDecryption->decryptedContent;
+}
+
+QByteArray PDFStream::getDecryptedContent() const
+{
+    const LazyDecryption* lazyDecryption = m_lazyDecryption.get();
+    if (!lazyDecryption)
+    {
+        return m_content;
+    }
+
+    if (lazyDecryption->isDecrypted.load(std::memory_order_acquire))
+    {
+        return lazyDecryption->decryptedContent;
+    }
+
+    return lazyDecryption->decryptor->decrypt(m_content, lazyDecryption->reference, lazyDecryption->isEmbeddedFile);
+}
+
+quint64 PDFStream::createUniqueId()
+{
+    static std::atomic<quint64> s_lastUniqueId = 0;
+    return s_lastUniqueId.fetch_add(1, std::memory_order_relaxed) + 1;
 }
 
 PDFObject PDFObjectManipulator::merge(PDFObject left, PDFObject right, MergeFlags flags)
@@ -550,6 +734,19 @@ PDFInplaceOrMemoryString::PDFInplaceOrMemoryString(QByteArray string)
     }
 }
 
+PDFInplaceOrMemoryString::PDFInplaceOrMemoryString(QByteArrayView string)
+{
+    const int size = static_cast<int>(string.size());
+    if (size > PDFInplaceString::MAX_STRING_SIZE)
+    {
+        m_value = string.toByteArray();
+    }
+    else
+    {
+        m_value = PDFInplaceString(string.data(), size);
+    }
+}
+
 bool PDFInplaceOrMemoryString::equals(const char* value, size_t length) const
 {
     if (std::holds_alternative<PDFInplaceString>(m_value))
@@ -561,6 +758,13 @@ bool PDFInplaceOrMemoryString::equals(const char* value, size_t length) const
     if (std::holds_alternative<QByteArray>(m_value))
     {
         const QByteArray& string = std::get<QByteArray>(m_value);
+
+        // Interned names share the data
+        if (string.constData() == value)
+        {
+            return static_cast<size_t>(string.size()) == length;
+        }
+
         return std::equal(string.constData(), string.constData() + string.size(), value, value + length);
     }
 
@@ -587,4 +791,129 @@ QByteArray PDFInplaceOrMemoryString::getString() const
     return QByteArray();
 }
 
+namespace
+{
+
+struct PDFNameTableHash
+{
+    using is_transparent = void;
+
+    size_t operator()(QByteArrayView name) const { return qHash(name); }
+};
+
+struct PDFNameTableEqual
+{
+    using is_transparent = void;
+
+    bool operator()(QByteArrayView left, QByteArrayView right) const
+    {
+        return left.size() == right.size() && (left.isEmpty() || std::memcmp(left.data(), right.data(), left.size()) == 0);
+    }
+};
+
+struct PDFNameTableStorage
+{
+    QReadWriteLock lock;
+    std::unordered_set<QByteArray, PDFNameTableHash, PDFNameTableEqual> names;
+};
+
+}   // namespace
+
+PDFObjectArena::PDFObjectArena(size_t chunkSize) :
+    m_chunkSize(chunkSize)
+{
+
+}
+
+void* PDFObjectArena::allocate(size_t size, size_t alignment)
+{
+    Q_ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+    QMutexLocker lock(&m_mutex);
+
+    // Large blocks have their own chunk, so the rest of current chunk is not wasted
+    if (size + alignment > m_chunkSize / 4)
+    {
+        std::byte* chunk = allocateChunk(size + alignment);
+        return reinterpret_cast<void*>((reinterpret_cast<std::uintptr_t>(chunk) + alignment - 1) & ~std::uintptr_t(alignment - 1));
+    }
+
+    std::uintptr_t address = (reinterpret_cast<std::uintptr_t>(m_current) + alignment - 1) & ~std::uintptr_t(alignment - 1);
+    if (!m_current || address + size > reinterpret_cast<std::uintptr_t>(m_end))
+    {
+        m_current = allocateChunk(m_chunkSize);
+        m_end = m_current + m_chunkSize;
+        address = (reinterpret_cast<std::uintptr_t>(m_current) + alignment - 1) & ~std::uintptr_t(alignment - 1);
+    }
+
+    m_current = reinterpret_cast<std::byte*>(address + size);
+    return reinterpret_cast<void*>(address);
+}
+
+size_t PDFObjectArena::getAllocatedSize() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_allocatedSize;
+}
+
+std::byte* PDFObjectArena::allocateChunk(size_t size)
+{
+    // Memory is not initialized, objects are constructed in it later
+    m_chunks.emplace_back(new std::byte[size]);
+    m_allocatedSize += size;
+    return m_chunks.back().get();
+}
+
+QByteArray PDFNameTable::intern(QByteArrayView name)
+{
+    if (name.size() <= PDFInplaceString::MAX_STRING_SIZE || name.size() > MAX_NAME_LENGTH)
+    {
+        return name.toByteArray();
+    }
+
+    static PDFNameTableStorage storage;
+
+    {
+        QReadLocker lock(&storage.lock);
+        auto it = storage.names.find(name);
+        if (it != storage.names.cend())
+        {
+            return *it;
+        }
+    }
+
+    QWriteLocker lock(&storage.lock);
+
+    // Name can be inserted by another thread in the meantime
+    auto it = storage.names.find(name);
+    if (it != storage.names.cend())
+    {
+        return *it;
+    }
+
+    QByteArray internedName = name.toByteArray();
+    if (storage.names.size() < MAX_NAME_COUNT)
+    {
+        storage.names.insert(internedName);
+    }
+
+    return internedName;
+}
+
+QByteArrayView PDFInplaceOrMemoryString::getView() const
+{
+    if (std::holds_alternative<PDFInplaceString>(m_value))
+    {
+        const PDFInplaceString& string = std::get<PDFInplaceString>(m_value);
+        return QByteArrayView(string.string.data(), string.size);
+    }
+
+    if (std::holds_alternative<QByteArray>(m_value))
+    {
+        return QByteArrayView(std::get<QByteArray>(m_value));
+    }
+
+    return QByteArrayView();
+}
+
 }   // namespace pdf
@@ -25,7 +25,9 @@
 
 #include "pdfglobal.h"
 
+#include <QMutex>
 #include <QByteArray>
+#include <QByteArrayView>
 
 #include <memory>
 #include <vector>
@@ -33,6 +35,7 @@
 #include <array>
 #include <initializer_list>
 #include <cstring>
+#include <cstddef>
 
 namespace pdf
 {
@@ -58,6 +61,84 @@ public:
     virtual void optimize() = 0;
 };
 
+/// Monotonic arena for allocation of immutable objects loaded from the document.
+/// Memory is allocated from large chunks, individual deallocations do nothing,
+/// and all chunks are released at once, when the arena is destroyed. Objects
+/// allocated from the arena hold the arena alive, so arena is destroyed, when
+/// last of its objects (usually together with the document) is destroyed.
+/// Allocation is thread safe.
+class PDF4QTLIBCORESHARED_EXPORT PDFObjectArena
+{
+public:
+    static constexpr const size_t DEFAULT_CHUNK_SIZE = 1024 * 1024;
+
+    explicit PDFObjectArena(size_t chunkSize = DEFAULT_CHUNK_SIZE);
+
+    PDFObjectArena(const PDFObjectArena&) = delete;
+    PDFObjectArena& operator=(const PDFObjectArena&) = delete;
+
+    /// Allocates memory block from the arena
+    /// \param size Size of the block
+    /// \param alignment Alignment of the block (power of two)
+    void* allocate(size_t size, size_t alignment);
+
+    /// Returns total size of memory chunks allocated by this arena
+    size_t getAllocatedSize() const;
+
+private:
+    /// Allocates new chunk of given size
+    std::byte* allocateChunk(size_t size);
+
+    mutable QMutex m_mutex;
+    size_t m_chunkSize;
+    size_t m_allocatedSize = 0;
+    std::byte* m_current = nullptr;
+    std::byte* m_end = nullptr;
+    std::vector<std::unique_ptr<std::byte[]>> m_chunks;
+};
+
+using PDFObjectArenaPointer = std::shared_ptr<PDFObjectArena>;
+
+/// Standard allocator allocating from the object arena (it can be used
+/// for example with std::allocate_shared).
+template<typename T>
+class PDFObjectArenaAllocator
+{
+public:
+    using value_type = T;
+
+    explicit PDFObjectArenaAllocator(PDFObjectArenaPointer arena) : m_arena(std::move(arena)) { }
+
+    template<typename U>
+    PDFObjectArenaAllocator(const PDFObjectArenaAllocator<U>& other) : m_arena(other.getArena()) { }
+
+    T* allocate(size_t count) { return static_cast<T*>(m_arena->allocate(count * sizeof(T), alignof(T))); }
+    void deallocate(T*, size_t) { /* Memory is released together with the arena */ }
+
+    const PDFObjectArenaPointer& getArena() const { return m_arena; }
+
+    template<typename U>
+    bool operator==(const PDFObjectArenaAllocator<U>& other) const { return m_arena == other.getArena(); }
+
+private:
+    PDFObjectArenaPointer m_arena;
+};
+
+/// Creates shared object in the arena. If arena is nullptr, then
+/// standard allocator is used.
+/// \param arena Arena (can be nullptr)
+/// \param arguments Constructor arguments
+template<typename T, typename... Arguments>
+inline std::shared_ptr<T> makeSharedInArena(const PDFObjectArenaPointer& arena, Arguments&&... arguments)
+{
+    if (arena)
+    {
+        return std::allocate_shared<T>(PDFObjectArenaAllocator<T>(arena), std::forward<Arguments>(arguments)...);
+    }
+
+    return std::make_shared<T>(std::forward<Arguments>(arguments)...);
+}
+
 /// This class represents inplace string in the PDF object. To avoid too much
 /// memory allocation, we store small strings inplace as small objects, so
 /// we do not use memory allocator, so this doesn't cause performance downgrade.
@@ -132,6 +213,7 @@ public:
     constexpr PDFInplaceOrMemoryString() = default;
     explicit PDFInplaceOrMemoryString(const char* string);
     explicit PDFInplaceOrMemoryString(QByteArray string);
+    explicit PDFInplaceOrMemoryString(QByteArrayView string);
 
     // Default destructor should be OK
     inline ~PDFInplaceOrMemoryString() = default;
@@ -158,10 +240,36 @@ public:
     /// Returns string. If string is inplace, byte array is constructed.
     QByteArray getString() const;
 
+    /// Returns view of the string data (no memory is allocated)
+    QByteArrayView getView() const;
+
 private:
     std::variant<typename std::monostate, PDFInplaceString, QByteArray> m_value;
 };
 
+/// Process-wide table of interned names. Short names are stored inplace (they
+/// don't allocate memory), but names, which don't fit into inplace string,
+/// are stored in the table only once and the string data are shared (using
+/// implicit sharing of byte arrays) by all objects and dictionary keys, which
+/// use them. Equal interned names have the same data pointer, so they can be
+/// compared quickly. Table is thread safe.
+class PDF4QTLIBCORESHARED_EXPORT PDFNameTable
+{
+public:
+    /// Names longer than this value are not interned (maximal name
+    /// length of PDF specification is 127 bytes).
+    static constexpr const qsizetype MAX_NAME_LENGTH = 127;
+
+    /// Maximal number of interned names, if table is full, names are
+    /// not interned anymore (table is never shrinked).
+    static constexpr const size_t MAX_NAME_COUNT = 65536;
+
+    /// Returns interned name. If name cannot be interned (it is too short,
+    /// too long, or table is full), then copy of the name is returned.
+    /// \param name Name
+    static QByteArray intern(QByteArrayView name);
+};
+
 class PDF4QTLIBCORESHARED_EXPORT PDFObject
 {
 public:
@@ -274,6 +382,16 @@ public:
     /// Creates a string object
     static PDFObject createString(PDFStringRef name);
 
+    /// Creates a name object, memory string is allocated in the arena
+    /// \param name Name
+    /// \param arena Object arena (can be nullptr)
+    static PDFObject createName(QByteArray name, const PDFObjectArenaPointer& arena);
+
+    /// Creates a string object, memory string is allocated in the arena
+    /// \param string String
+    /// \param arena Object arena (can be nullptr)
+    static PDFObject createString(QByteArray string, const PDFObjectArenaPointer& arena);
+
 private:
     template<typename T>
     inline PDFObject(Type type, T&& value) :
@@ -362,6 +480,10 @@ class PDF4QTLIBCORESHARED_EXPORT PDFDictionary : public PDFObjectContent
 public:
     using DictionaryEntry = std::pair<PDFInplaceOrMemoryString, PDFObject>;
 
+    /// Dictionaries with at least this count of entries have sorted index of keys,
+    /// which is used to find the keys, smaller dictionaries are searched linearly.
+    static constexpr size_t INDEX_THRESHOLD = 32;
+
     inline PDFDictionary() = default;
     inline PDFDictionary(std::vector<DictionaryEntry>&& dictionary) : m_dictionary(qMove(dictionary)) { }
     virtual ~PDFDictionary() override = default;
@@ -401,12 +523,12 @@ public:
     /// Adds a new entry to the dictionary.
     /// \param key Key
     /// \param value Value
-    void addEntry(PDFInplaceOrMemoryString&& key, PDFObject&& value) { m_dictionary.emplace_back(std::move(key), std::move(value)); }
+    void addEntry(PDFInplaceOrMemoryString&& key, PDFObject&& value) { m_index.reset(); m_dictionary.emplace_back(std::move(key), std::move(value)); }
 
     /// Adds a new entry to the dictionary.
     /// \param key Key
     /// \param value Value
-    void addEntry(const PDFInplaceOrMemoryString& key, PDFObject&& value) { m_dictionary.emplace_back(key, std::move(value)); }
+    void addEntry(const PDFInplaceOrMemoryString& key, PDFObject&& value) { m_index.reset(); m_dictionary.emplace_back(key, std::move(value)); }
 
     /// Sets entry value. If entry with given key doesn't exist,
     /// then it is created.
@@ -433,10 +555,17 @@ public:
 
     bool isEmpty() const { return getCount() == 0; }
 
-    /// Optimizes the dictionary for memory consumption
+    /// Optimizes the dictionary for memory consumption. If dictionary is large,
+    /// then index of keys is built for fast lookup.
     virtual void optimize() override;
 
 private:
+    /// Finds index of the key in the dictionary. Uses the sorted index of keys,
+    /// if it exists, otherwise linear search is performed. If key is not found,
+    /// then count of items is returned.
+    /// \param key Key to be found
+    size_t findIndex(QByteArrayView key) const;
+
     /// Finds an item in the dictionary array, if the item is not in the dictionary,
     /// then end iterator is returned.
     /// \param key Key to be found
@@ -468,8 +597,34 @@ private:
     std::vector<DictionaryEntry>::iterator find(const PDFInplaceOrMemoryString& key);
 
     std::vector<DictionaryEntry> m_dictionary;
+
+    /// Indices of entries sorted by keys (entries with the same key keep
+    /// insertion order). Index is immutable, so it can be shared by copies
+    /// of the dictionary. It is discarded, when key is added or removed.
+    std::shared_ptr<const std::vector<uint32_t>> m_index;
+};
+
+/// Owner of external memory, to which stream content can refer (for example,
+/// memory mapped file). Memory is kept alive as long as some object holds the owner.
+using PDFStreamDataOwner = std::shared_ptr<const void>;
+
+/// Decryptor of stream contents of encrypted document. Streams of encrypted
+/// documents can keep their encrypted content, it is then decrypted using
+/// the decryptor, when it is accessed. Decryptor must be thread safe.
+class PDFStreamDecryptor
+{
+public:
+    virtual ~PDFStreamDecryptor() = default;
+
+    /// Decrypts the stream content
+    /// \param content Encrypted content
+    /// \param reference Reference of the object containing the stream
+    /// \param isEmbeddedFile Is stream an embedded file stream?
+    virtual QByteArray decrypt(const QByteArray& content, PDFObjectReference reference, bool isEmbeddedFile) const = 0;
 };
 
+using PDFStreamDecryptorPointer = std::shared_ptr<const PDFStreamDecryptor>;
+
 /// Represents a stream object in the PDF file. Stream consists of dictionary
 /// and stream content - byte array.
 class PDF4QTLIBCORESHARED_EXPORT PDFStream : public PDFObjectContent
@@ -483,6 +638,34 @@ public:
 
     }
 
+    /// Creates stream, whose content is not owned by the stream (it is created
+    /// by QByteArray::fromRawData), but refers to memory owned by \p dataOwner.
+    /// \param dictionary Stream dictionary
+    /// \param content Stream content (referring to the external memory)
+    /// \param dataOwner Owner of the external memory
+    inline explicit PDFStream(PDFDictionary&& dictionary, QByteArray&& content, PDFStreamDataOwner dataOwner) :
+        m_dictionary(std::move(dictionary)),
+        m_content(std::move(content)),
+        m_dataOwner(std::move(dataOwner))
+    {
+
+    }
+
+    /// Creates stream, whose content is encrypted. Content is decrypted lazily,
+    /// when it is accessed for the first time. Dictionary must be already decrypted.
+    /// \param dictionary Stream dictionary
+    /// \param content Encrypted stream content (can refer to the external memory)
+    /// \param dataOwner Owner of the external memory (can be nullptr)
+    /// \param decryptor Decryptor of the content
+    /// \param reference Reference of the object containing the stream
+    /// \param isEmbeddedFile Is stream an embedded file stream?
+    explicit PDFStream(PDFDictionary&& dictionary,
+                       QByteArray&& content,
+                       PDFStreamDataOwner dataOwner,
+                       PDFStreamDecryptorPointer decryptor,
+                       PDFObjectReference reference,
+                       bool isEmbeddedFile);
+
     virtual ~PDFStream() override = default;
 
     virtual bool equals(const PDFObjectContent* other) const override;
@@ -490,15 +673,45 @@ public:
     /// Returns dictionary for this content stream
     const PDFDictionary* getDictionary() const { return &m_dictionary; }
 
-    /// Optimizes the stream for memory consumption
-    virtual void optimize() override { m_dictionary.optimize(); m_content.shrink_to_fit(); }
+    /// Optimizes the stream for memory consumption. Content referring
+    /// to the external memory is left untouched, because shrinking
+    /// would create a deep copy of it.
+    virtual void optimize() override { m_dictionary.optimize(); if (!m_dataOwner) { m_content.shrink_to_fit(); } }
 
-    /// Returns content of the stream
-    const QByteArray* getContent() const { return &m_content; }
+    /// Returns content of the stream. If content is decrypted lazily,
+    /// then it is decrypted and stored in the stream, when this function
+    /// is called for the first time. This function is thread safe.
+    const QByteArray* getContent() const;
+
+    /// Returns content of the stream. Unlike \p getContent, lazily decrypted
+    /// content is not stored in the stream, so data, which are decoded by the
+    /// stream filters, are not kept in memory in both encrypted and decrypted form.
+    QByteArray getDecryptedContent() const;
+
+    /// Returns true, if stream content is encrypted and is decrypted lazily
+    bool isContentDecryptedLazily() const { return m_lazyDecryption != nullptr; }
+
+    /// Returns true, if stream content refers to the external memory
+    bool isContentExternal() const { return m_dataOwner != nullptr; }
+
+    /// Returns owner of the external memory, to which stream content refers
+    const PDFStreamDataOwner& getDataOwner() const { return m_dataOwner; }
+
+    /// Returns identifier of the stream, which is unique during the lifetime of the
+    /// application (copies of the stream share the identifier). Unlike the address
+    /// of the stream, it is never reused, so it can be used as a key in caches.
+    quint64 getUniqueId() const { return m_uniqueId; }
 
 private:
+    struct LazyDecryption;
+
+    static quint64 createUniqueId();
+
     PDFDictionary m_dictionary;
     QByteArray m_content;
+    PDFStreamDataOwner m_dataOwner;
+    std::shared_ptr<LazyDecryption> m_lazyDecryption;
+    quint64 m_uniqueId = createUniqueId();
 };
 
 class PDF4QTLIBCORESHARED_EXPORT PDFObjectManipulator
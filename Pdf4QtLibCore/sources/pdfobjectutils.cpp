@@ -24,8 +24,14 @@
 #include "pdfvisitor.h"
 #include "pdfexecutionpolicy.h"
 #include "pdfdocumentwriter.h"
+#include "pdfstreamfilters.h"
+#include "pdfconstants.h"
+#include "pdfxreftable.h"
+#include "pdfparser.h"
 #include "pdfdbgheap.h"
 
+#include <deque>
+#include <algorithm>
 #include <unordered_set>
 
 namespace pdf
@@ -69,11 +75,56 @@ void PDFCollectReferencesVisitor::visitReference(const PDFObjectReference refere
     m_references.insert(reference);
 }
 
+/// Marks objects referenced from visited object in the dense bitset. Objects, which
+/// were not marked before, are added to the frontier (to be visited in the next step).
+class PDFMarkReachableObjectsVisitor : public PDFAbstractVisitor
+{
+public:
+    explicit PDFMarkReachableObjectsVisitor(const PDFObjectStorage::PDFObjects& objects,
+                                            std::vector<std::atomic<uint64_t>>& words,
+                                            std::vector<size_t>& frontier) :
+        m_objects(objects),
+        m_words(words),
+        m_frontier(frontier)
+    {
+
+    }
+
+    virtual void visitArray(const PDFArray* array) override { acceptArray(array); }
+    virtual void visitDictionary(const PDFDictionary* dictionary) override { acceptDictionary(dictionary); }
+    virtual void visitStream(const PDFStream* stream) override { acceptStream(stream); }
+    virtual void visitReference(const PDFObjectReference reference) override;
+
+private:
+    const PDFObjectStorage::PDFObjects& m_objects;
+    std::vector<std::atomic<uint64_t>>& m_words;
+    std::vector<size_t>& m_frontier;
+};
+
+void PDFMarkReachableObjectsVisitor::visitReference(const PDFObjectReference reference)
+{
+    if (reference.objectNumber < 0 ||
+        reference.objectNumber >= static_cast<PDFInteger>(m_objects.size()) ||
+        m_objects[reference.objectNumber].generation != reference.generation)
+    {
+        return;
+    }
+
+    const size_t index = static_cast<size_t>(reference.objectNumber);
+    const uint64_t bit = uint64_t(1) << (index % 64);
+    if (!(m_words[index / 64].fetch_or(bit, std::memory_order_relaxed) & bit))
+    {
+        m_frontier.push_back(index);
+    }
+}
+
 class PDFReplaceReferencesVisitor : public PDFAbstractVisitor
 {
 public:
-    explicit PDFReplaceReferencesVisitor(const std::map<PDFObjectReference, PDFObjectReference>& replacements) :
-        m_replacements(replacements)
+    explicit PDFReplaceReferencesVisitor(const std::map<PDFObjectReference, PDFObjectReference>* replacements,
+                                         const PDFObjectUtils::FlatReferenceMapping* flatReplacements) :
+        m_replacements(replacements),
+        m_flatReplacements(flatReplacements)
     {
         m_objectStack.reserve(32);
     }
@@ -92,7 +143,8 @@ public:
     PDFObject getObject();
 
 private:
-    const std::map<PDFObjectReference, PDFObjectReference>& m_replacements;
+    const std::map<PDFObjectReference, PDFObjectReference>* m_replacements;
+    const PDFObjectUtils::FlatReferenceMapping* m_flatReplacements;
     std::vector<PDFObject> m_objectStack;
 };
 
@@ -168,8 +220,23 @@ void PDFReplaceReferencesVisitor::visitStream(const PDFStream* stream)
 
 void PDFReplaceReferencesVisitor::visitReference(const PDFObjectReference reference)
 {
-    auto it = m_replacements.find(reference);
-    if (it != m_replacements.cend())
+    if (m_flatReplacements)
+    {
+        const size_t index = static_cast<size_t>(reference.objectNumber);
+        if (reference.objectNumber >= 0 && index < m_flatReplacements->size() && (*m_flatReplacements)[index].first == reference)
+        {
+            m_objectStack.push_back(PDFObject::createReference((*m_flatReplacements)[index].second));
+        }
+        else
+        {
+            // Reference points to object, which is not mapped
+            m_objectStack.push_back(PDFObject::createNull());
+        }
+        return;
+    }
+
+    auto it = m_replacements->find(reference);
+    if (it != m_replacements->cend())
     {
         // Replace the reference
         m_objectStack.push_back(PDFObject::createReference(it->second));
@@ -246,6 +313,56 @@ std::set<PDFObjectReference> PDFObjectUtils::getReferences(const std::vector<PDF
     return references;
 }
 
+std::vector<bool> PDFObjectUtils::getReachableObjects(const std::vector<PDFObject>& objects, const PDFObjectStorage& storage)
+{
+    // Frontier is processed in chunks, each chunk has its own part of the next frontier,
+    // so threads don't need to synchronize anything except the bitset itself.
+    constexpr size_t CHUNK_SIZE = 256;
+
+    const PDFObjectStorage::PDFObjects& storageObjects = storage.getObjects();
+    std::vector<std::atomic<uint64_t>> words((storageObjects.size() + 63) / 64);
+    std::vector<size_t> frontier;
+
+    PDFMarkReachableObjectsVisitor visitor(storageObjects, words, frontier);
+    for (const PDFObject& object : objects)
+    {
+        object.accept(&visitor);
+    }
+
+    while (!frontier.empty())
+    {
+        const size_t chunkCount = (frontier.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        std::vector<std::vector<size_t>> nextFrontiers(chunkCount);
+
+        auto processChunk = [&](size_t chunk)
+        {
+            PDFMarkReachableObjectsVisitor chunkVisitor(storageObjects, words, nextFrontiers[chunk]);
+            const size_t end = qMin(frontier.size(), (chunk + 1) * CHUNK_SIZE);
+            for (size_t i = chunk * CHUNK_SIZE; i < end; ++i)
+            {
+                storageObjects[frontier[i]].object.accept(&chunkVisitor);
+            }
+        };
+
+        PDFIntegerRange<size_t> range(0, chunkCount);
+        PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, range.begin(), range.end(), processChunk);
+
+        frontier.clear();
+        for (const std::vector<size_t>& nextFrontier : nextFrontiers)
+        {
+            frontier.insert(frontier.end(), nextFrontier.cbegin(), nextFrontier.cend());
+        }
+    }
+
+    std::vector<bool> reachableObjects(storageObjects.size(), false);
+    for (size_t i = 0; i < reachableObjects.size(); ++i)
+    {
+        reachableObjects[i] = words[i / 64].load(std::memory_order_relaxed) & (uint64_t(1) << (i % 64));
+    }
+
+    return reachableObjects;
+}
+
 std::set<PDFObjectReference> PDFObjectUtils::getDirectReferences(const PDFObject& object)
 {
     std::set<PDFObjectReference> references;
@@ -258,7 +375,14 @@ std::set<PDFObjectReference> PDFObjectUtils::getDirectReferences(const PDFObject
 
 PDFObject PDFObjectUtils::replaceReferences(const PDFObject& object, const std::map<PDFObjectReference, PDFObjectReference>& referenceMapping)
 {
-    PDFReplaceReferencesVisitor replaceReferencesVisitor(referenceMapping);
+    PDFReplaceReferencesVisitor replaceReferencesVisitor(&referenceMapping, nullptr);
+    object.accept(&replaceReferencesVisitor);
+    return replaceReferencesVisitor.getObject();
+}
+
+PDFObject PDFObjectUtils::replaceReferences(const PDFObject& object, const FlatReferenceMapping& referenceMapping)
+{
+    PDFReplaceReferencesVisitor replaceReferencesVisitor(nullptr, &referenceMapping);
     object.accept(&replaceReferencesVisitor);
     return replaceReferencesVisitor.getObject();
 }
@@ -516,4 +640,198 @@ void PDFObjectClassifier::markDictionary(const PDFDocument* document, PDFObject
     }
 }
 
+PDFObjectStreamingStatistics::Statistics PDFObjectStreamingStatistics::calculate(const QByteArray& source,
+                                                                              const PDFStreamDataOwner& sourceOwner,
+                                                                              const PDFXRefTable& xrefTable,
+                                                                              Flags flags)
+{
+    Statistics statistics;
+
+    const PDFObject& trailerDictionaryObject = xrefTable.getTrailerDictionary();
+    const PDFDictionary* trailerDictionary = nullptr;
+    if (trailerDictionaryObject.isDictionary())
+    {
+        trailerDictionary = trailerDictionaryObject.getDictionary();
+    }
+    else if (trailerDictionaryObject.isStream())
+    {
+        trailerDictionary = trailerDictionaryObject.getStream()->getDictionary();
+    }
+
+    // Streams of encrypted documents can't be decoded, because
+    // security handler isn't created (user can be asked for a password)
+    statistics.isEncrypted = trailerDictionary && trailerDictionary->hasKey("Encrypt");
+    const bool decodeStreams = flags.testFlag(DecodeStreams) && !statistics.isEncrypted;
+
+    std::vector<PDFXRefTable::Entry> occupiedEntries = xrefTable.getOccupiedEntries();
+    statistics.compressedObjectCount = xrefTable.getObjectStreamEntries().size();
+
+    // Object ends, where the next object, or section of the reference
+    // table, starts. Last object ends at the end of source data.
+    std::vector<PDFInteger> offsets;
+    offsets.reserve(occupiedEntries.size() + xrefTable.getRevisions().size());
+    for (const PDFXRefTable::Entry& entry : occupiedEntries)
+    {
+        offsets.push_back(entry.offset);
+    }
+    for (const PDFXRefTable::Revision& revision : xrefTable.getRevisions())
+    {
+        offsets.push_back(revision.xrefOffset);
+    }
+    std::sort(offsets.begin(), offsets.end());
+
+    std::function<PDFObject(PDFParsingContext*, PDFObjectReference)> readObject = [&](PDFParsingContext* context, PDFObjectReference reference) -> PDFObject
+    {
+        const PDFXRefTable::Entry& entry = xrefTable.getEntry(reference);
+        if (entry.type != PDFXRefTable::EntryType::Occupied)
+        {
+            // Objects in object streams are not read
+            return PDFObject();
+        }
+
+        PDFParsingContext::PDFParsingContextGuard guard(context, reference);
+
+        PDFParser parser(source, context, PDFParser::AllowStreams);
+        parser.setDataOwner(sourceOwner);
+        parser.seek(entry.offset);
+
+        PDFObject objectNumber = parser.getObject();
+        PDFObject generation = parser.getObject();
+
+        if (!objectNumber.isInt() || !generation.isInt() || !parser.fetchCommand(PDF_OBJECT_START_MARK))
+        {
+            throw PDFException(PDFTranslationContext::tr("Can't read object at position %1.").arg(entry.offset));
+        }
+
+        return parser.getObject();
+    };
+
+    PDFParsingContext context(readObject);
+    PDFStatisticsCollector collector;
+
+    // Fetched objects must live until the stream is processed, so we store
+    // them in the deque, which doesn't invalidate references to its items.
+    std::deque<PDFObject> fetchedObjects;
+    PDFObjectFetcher objectFetcher = [&](const PDFObject& object) -> const PDFObject&
+    {
+        if (!object.isReference())
+        {
+            return object;
+        }
+
+        fetchedObjects.push_back(readObject(&context, object.getReference()));
+        return fetchedObjects.back();
+    };
+
+    auto getClassName = [](const PDFDictionary* dictionary)
+    {
+        const PDFObject& type = dictionary->get("Type");
+        const PDFObject& subtype = dictionary->get("Subtype");
+
+        if (type.isName() && type.getString() == "XObject" && subtype.isName())
+        {
+            return QByteArray("XObject/") + subtype.getString();
+        }
+
+        if (type.isName())
+        {
+            return type.getString();
+        }
+
+        return QByteArray();
+    };
+
+    auto getFilterName = [&objectFetcher](const PDFDictionary* dictionary)
+    {
+        const PDFObject& filters = objectFetcher(dictionary->get(PDF_STREAM_DICT_FILTER));
+
+        if (filters.isName())
+        {
+            return filters.getString();
+        }
+
+        QByteArrayList filterNames;
+        if (filters.isArray())
+        {
+            const PDFArray* filterArray = filters.getArray();
+            for (size_t i = 0; i < filterArray->getCount(); ++i)
+            {
+                const PDFObject& filter = objectFetcher(filterArray->getItem(i));
+                filterNames << (filter.isName() ? filter.getString() : QByteArray("?"));
+            }
+        }
+
+        return filterNames.join(' ');
+    };
+
+    for (const PDFXRefTable::Entry& entry : occupiedEntries)
+    {
+        auto nextOffsetIt = std::upper_bound(offsets.cbegin(), offsets.cend(), entry.offset);
+        const qint64 objectSize = qMax<qint64>((nextOffsetIt != offsets.cend()) ? *nextOffsetIt : source.size(), entry.offset) - entry.offset;
+
+        ++statistics.objectCount;
+        statistics.bytes += objectSize;
+
+        const size_t bucket = std::distance(SIZE_HISTOGRAM_BOUNDS.cbegin(), std::upper_bound(SIZE_HISTOGRAM_BOUNDS.cbegin(), SIZE_HISTOGRAM_BOUNDS.cend(), objectSize));
+        Item& sizeItem = statistics.sizeHistogram[bucket];
+        ++sizeItem.count;
+        sizeItem.bytes += objectSize;
+
+        try
+        {
+            PDFObject object = readObject(&context, entry.reference);
+            object.accept(&collector);
+
+            const PDFDictionary* dictionary = object.isDictionary() ? object.getDictionary() : (object.isStream() ? object.getStream()->getDictionary() : nullptr);
+            Item& classItem = statistics.objectsByClass[dictionary ? getClassName(dictionary) : QByteArray()];
+            ++classItem.count;
+            classItem.bytes += objectSize;
+
+            if (object.isStream())
+            {
+                const PDFStream* stream = object.getStream();
+                Item& filterItem = statistics.streamsByFilter[getFilterName(dictionary)];
+                ++filterItem.count;
+                filterItem.bytes += stream->getContent()->size();
+
+                if (decodeStreams)
+                {
+                    try
+                    {
+                        // Decoded data are pulled in chunks, so they are not held in memory
+                        PDFStreamReaderPointer reader = PDFStreamFilterStorage::createDecodedStreamReader(stream, objectFetcher, nullptr);
+
+                        QByteArray buffer(65536, Qt::Uninitialized);
+                        qint64 decodedBytes = 0;
+                        while (qint64 readBytes = reader->read(buffer.data(), buffer.size()))
+                        {
+                            decodedBytes += readBytes;
+                        }
+
+                        filterItem.decodedBytes += decodedBytes;
+                        classItem.decodedBytes += decodedBytes;
+                    }
+                    catch (const PDFException&)
+                    {
+                        ++statistics.decodingErrorCount;
+                    }
+                }
+            }
+        }
+        catch (const PDFException&)
+        {
+            ++statistics.invalidObjectCount;
+        }
+
+        fetchedObjects.clear();
+    }
+
+    for (PDFObject::Type objectType : PDFObject::getTypes())
+    {
+        statistics.objectCountByType[size_t(objectType)] = collector.getObjectCount(objectType);
+    }
+
+    return statistics;
+}
+
 }   // namespace pdf
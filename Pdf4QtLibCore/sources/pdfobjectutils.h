@@ -26,6 +26,8 @@
 #include "pdfobject.h"
 
 #include <set>
+#include <map>
+#include <array>
 #include <vector>
 #include <atomic>
 
@@ -33,11 +35,16 @@ namespace pdf
 {
 class PDFObjectStorage;
 class PDFDocument;
+class PDFXRefTable;
 
 /// Utilities for manipulation with objects
 class PDF4QTLIBCORESHARED_EXPORT PDFObjectUtils
 {
 public:
+    /// Mapping of references indexed by object number of the source reference. Each item
+    /// contains source reference (with generation number) and target reference.
+    using FlatReferenceMapping = std::vector<std::pair<PDFObjectReference, PDFObjectReference>>;
+
     /// Returns a list of references referenced by \p objects. So, all references, which are present
     /// in objects, appear in the result set, including objects, which are referenced by referenced
     /// objects (so, transitive closure above reference graph is returned).
@@ -45,11 +52,26 @@ public:
     /// \param storage Storage
     static std::set<PDFObjectReference> getReferences(const std::vector<PDFObject>& objects, const PDFObjectStorage& storage);
 
+    /// Returns dense bitset indexed by object number, in which objects reachable from \p objects
+    /// are marked. Object is reachable, if it is referenced by reference with the same generation
+    /// number, either directly from \p objects, or from another reachable object. Traversal is
+    /// performed in parallel, frontier by frontier (breadth-first).
+    /// \param objects Objects
+    /// \param storage Storage
+    static std::vector<bool> getReachableObjects(const std::vector<PDFObject>& objects, const PDFObjectStorage& storage);
+
     /// Returns a list of references directly referenced from object. References itself are not followed.
     static std::set<PDFObjectReference> getDirectReferences(const PDFObject& object);
 
     static PDFObject replaceReferences(const PDFObject& object, const std::map<PDFObjectReference, PDFObjectReference>& referenceMapping);
 
+    /// Replaces references in the object using flat mapping. References, which are
+    /// not present in the mapping (or generation number doesn't match), are replaced
+    /// by null objects, because they don't point to any object in the target storage.
+    /// \param object Object
+    /// \param referenceMapping Flat reference mapping
+    static PDFObject replaceReferences(const PDFObject& object, const FlatReferenceMapping& referenceMapping);
+
     /// Returns name for object type
     /// \param type Type
     static QString getObjectTypeName(PDFObject::Type type);
@@ -198,6 +220,59 @@ private:
     Types m_allTypesUsed;
 };
 
+/// Calculates statistics of objects in one pass over the reference table, without
+/// loading the document. Objects are parsed directly from the source data one by one
+/// and are released immediately. Stream data are not copied (if source data have
+/// an owner, for example, memory mapped file) and are not decoded, unless it is
+/// requested. Size of the object is determined from the offsets of objects in the
+/// source data. Objects stored in object streams are counted, but they are not parsed,
+/// their data are part of data of the object stream.
+class PDF4QTLIBCORESHARED_EXPORT PDFObjectStreamingStatistics
+{
+public:
+    enum Flag
+    {
+        None            = 0x0000,
+        DecodeStreams   = 0x0001,   ///< Decode streams to obtain size of decoded data (streams of encrypted documents are never decoded)
+    };
+    Q_DECLARE_FLAGS(Flags, Flag)
+
+    struct Item
+    {
+        qint64 count = 0;
+        qint64 bytes = 0;
+        qint64 decodedBytes = 0;    ///< Size of decoded data of streams (only if streams are decoded)
+    };
+
+    /// Upper bounds (exclusive) of the buckets of object size histogram in bytes,
+    /// last bucket of the histogram contains objects of greater size.
+    static constexpr std::array<qint64, 8> SIZE_HISTOGRAM_BOUNDS = { 256, 1024, 4096, 16384, 65536, 262144, 1048576, 4194304 };
+
+    struct Statistics
+    {
+        qint64 objectCount = 0;             ///< Count of objects stored directly in the source data
+        qint64 compressedObjectCount = 0;   ///< Count of objects stored in object streams
+        qint64 invalidObjectCount = 0;      ///< Count of objects, which can't be parsed
+        qint64 decodingErrorCount = 0;      ///< Count of streams, which can't be decoded
+        qint64 bytes = 0;                   ///< Total size of objects
+        bool isEncrypted = false;
+        std::array<qint64, size_t(PDFObject::Type::LastType)> objectCountByType = { };
+        std::map<QByteArray, Item> objectsByClass;      ///< Objects by their type (value of /Type, or /Subtype for XObjects)
+        std::map<QByteArray, Item> streamsByFilter;     ///< Streams by their filters (names separated by space)
+        std::array<Item, SIZE_HISTOGRAM_BOUNDS.size() + 1> sizeHistogram = { };
+    };
+
+    /// Calculates statistics of objects of the reference table
+    /// \param source Source data of the document
+    /// \param sourceOwner Owner of the source data (can be nullptr, then stream data are copied)
+    /// \param xrefTable Reference table of the document
+    /// \param flags Flags
+    static Statistics calculate(const QByteArray& source, const PDFStreamDataOwner& sourceOwner, const PDFXRefTable& xrefTable, Flags flags);
+
+private:
+    PDFObjectStreamingStatistics() = delete;
+};
+
 } // namespace pdf
 
 #endif // PDFOBJECTUTILS_H
@@ -25,6 +25,8 @@
 
 #include "pdfglobal.h"
 
+#include <atomic>
+
 namespace pdf
 {
 
@@ -51,6 +53,25 @@ public:
     }
 };
 
+/// Cancellation token, which can be shared between the thread, which
+/// controls the operation, and threads performing the operation. Operation is
+/// cancelled by calling \p cancel, and token can be reused after \p reset.
+class PDFCancellationToken : public PDFOperationControl
+{
+public:
+    /// Cancels the operation. This function is thread safe.
+    void cancel() { m_isCancelled.store(true, std::memory_order_release); }
+
+    /// Resets the token, so new operation can be started.
+    /// Do not call this function while operation is running.
+    void reset() { m_isCancelled.store(false, std::memory_order_release); }
+
+    virtual bool isOperationCancelled() const override { return m_isCancelled.load(std::memory_order_acquire); }
+
+private:
+    std::atomic<bool> m_isCancelled = false;
+};
+
 }
 
 #endif // PDFOPERATIONCONTROL_H
@@ -29,8 +29,26 @@
 #include "pdfdocumentbuilder.h"
 #include "pdfstreamfilters.h"
 #include "pdfdocumentwriter.h"
+#include "pdfpagecontentprocessor.h"
+#include "pdfoptionalcontent.h"
+#include "pdfimage.h"
+#include "pdffont.h"
+#include "pdfcms.h"
+#include "pdffontsubsetter.h"
+#include "pdfdocumentreader.h"
+
+#include <QMutex>
+#include <QCryptographicHash>
+#include <QBuffer>
+#include <QImageWriter>
+
 #include "pdfdbgheap.h"
 
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+
 namespace pdf
 {
 
@@ -72,6 +90,30 @@ void PDFRemoveSimpleObjectsVisitor::visitReference(const PDFObjectReference refe
     }
 }
 
+/// Creates copy of the object, in which all references are replaced
+/// by invalid reference. Original references are collected in the order,
+/// in which they were visited.
+class PDFStructuralKeyVisitor : public PDFUpdateObjectVisitor
+{
+public:
+    explicit inline PDFStructuralKeyVisitor(const PDFObjectStorage* storage) :
+        PDFUpdateObjectVisitor(storage)
+    {
+
+    }
+
+    virtual void visitReference(const PDFObjectReference reference) override
+    {
+        m_references.push_back(reference);
+        m_objectStack.push_back(PDFObject::createReference(PDFObjectReference()));
+    }
+
+    std::vector<PDFObjectReference> takeReferences() { return qMove(m_references); }
+
+private:
+    std::vector<PDFObjectReference> m_references;
+};
+
 class PDFRemoveNullDictionaryEntriesVisitor : public PDFUpdateObjectVisitor
 {
 public:
@@ -113,6 +155,430 @@ void PDFRemoveNullDictionaryEntriesVisitor::visitDictionary(const PDFDictionary*
     m_objectStack.push_back(PDFObject::createDictionary(std::make_shared<PDFDictionary>(qMove(entries))));
 }
 
+/// Collects largest placement sizes (in inches) of image XObjects on the page.
+/// Images are not decoded, only their placement is recorded.
+class PDFImagePlacementCollector : public PDFPageContentProcessor
+{
+public:
+    explicit PDFImagePlacementCollector(const PDFPage* page,
+                                        const PDFDocument* document,
+                                        const PDFFontCache* fontCache,
+                                        const PDFCMS* CMS,
+                                        const PDFOptionalContentActivity* optionalContentActivity,
+                                        const PDFMeshQualitySettings& meshQualitySettings,
+                                        const std::map<const PDFStream*, PDFObjectReference>* images,
+                                        std::map<PDFObjectReference, QSizeF>* placements,
+                                        QMutex* mutex) :
+        PDFPageContentProcessor(page, document, fontCache, CMS, optionalContentActivity, QTransform(), meshQualitySettings),
+        m_images(images),
+        m_placements(placements),
+        m_mutex(mutex)
+    {
+
+    }
+
+protected:
+    virtual bool isContentSuppressedByOC(PDFObjectReference ocgOrOcmd) override;
+    virtual bool isContentKindSuppressed(ContentKind kind) const override;
+    virtual bool performImageXObjectPlacement(const PDFStream* stream) override;
+
+private:
+    const std::map<const PDFStream*, PDFObjectReference>* m_images;
+    std::map<PDFObjectReference, QSizeF>* m_placements;
+    QMutex* m_mutex;
+};
+
+bool PDFImagePlacementCollector::isContentSuppressedByOC(PDFObjectReference ocgOrOcmd)
+{
+    Q_UNUSED(ocgOrOcmd);
+
+    // Hidden content can be turned on, so its images must respect it too
+    return false;
+}
+
+bool PDFImagePlacementCollector::isContentKindSuppressed(ContentKind kind) const
+{
+    switch (kind)
+    {
+        case ContentKind::Images:
+        case ContentKind::Tiling:
+        case ContentKind::Forms:
+            return false;
+
+        default:
+            return true;
+    }
+}
+
+bool PDFImagePlacementCollector::performImageXObjectPlacement(const PDFStream* stream)
+{
+    auto it = m_images->find(stream);
+    if (it != m_images->cend())
+    {
+        // Image is painted in the unit square, transformed by current matrix
+        const QTransform matrix = getCurrentWorldMatrix();
+        const PDFReal width = std::hypot(matrix.m11(), matrix.m12()) * PDF_POINT_TO_INCH;
+        const PDFReal height = std::hypot(matrix.m21(), matrix.m22()) * PDF_POINT_TO_INCH;
+
+        QMutexLocker lock(m_mutex);
+        QSizeF& size = (*m_placements)[it->second];
+        size.setWidth(qMax(size.width(), width));
+        size.setHeight(qMax(size.height(), height));
+    }
+
+    return true;
+}
+
+/// Collects character codes (or CIDs), which are used in text of fonts. Page contents,
+/// appearance streams of annotations and soft masks are processed, images are not decoded.
+class PDFFontUsageCollector : public PDFPageContentProcessor
+{
+public:
+    explicit PDFFontUsageCollector(const PDFPage* page,
+                                   const PDFDocument* document,
+                                   const PDFFontCache* fontCache,
+                                   const PDFCMS* CMS,
+                                   const PDFOptionalContentActivity* optionalContentActivity,
+                                   const PDFMeshQualitySettings& meshQualitySettings,
+                                   const std::map<const PDFFont*, size_t>* fonts) :
+        PDFPageContentProcessor(page, document, fontCache, CMS, optionalContentActivity, QTransform(), meshQualitySettings),
+        m_fonts(fonts)
+    {
+
+    }
+
+    /// Processes appearance streams of page annotations and
+    /// all soft masks, which were used in processed content.
+    void processAnnotationsAndSoftMasks();
+
+    /// Returns used character codes (or CIDs) for each font index
+    const std::map<size_t, std::set<CID>>& getUsedCharacters() const { return m_usedCharacters; }
+
+protected:
+    virtual bool isContentSuppressedByOC(PDFObjectReference ocgOrOcmd) override;
+    virtual bool isContentKindSuppressed(ContentKind kind) const override;
+    virtual bool performImageXObjectPlacement(const PDFStream* stream) override;
+    virtual void performUpdateGraphicsState(const PDFPageContentProcessorState& state) override;
+    virtual void performProcessTextSequence(const TextSequence& textSequence, ProcessOrder order) override;
+
+private:
+    void processFormStream(const PDFObject& object);
+    void processFormStream(const PDFStream* stream);
+
+    const std::map<const PDFFont*, size_t>* m_fonts;
+    std::map<size_t, std::set<CID>> m_usedCharacters;
+    std::set<const PDFStream*> m_processedSoftMasks;
+    std::vector<const PDFStream*> m_softMasks;
+};
+
+void PDFFontUsageCollector::processAnnotationsAndSoftMasks()
+{
+    const PDFDocument* document = getDocument();
+
+    for (const PDFObjectReference& annotationReference : getPage()->getAnnotations())
+    {
+        const PDFDictionary* annotationDictionary = document->getDictionaryFromObject(document->getObjectByReference(annotationReference));
+        if (!annotationDictionary)
+        {
+            continue;
+        }
+
+        const PDFDictionary* appearanceDictionary = document->getDictionaryFromObject(annotationDictionary->get("AP"));
+        if (!appearanceDictionary)
+        {
+            continue;
+        }
+
+        // Appearance can be a stream, or dictionary of appearance states
+        for (const char* key : { "N", "R", "D" })
+        {
+            const PDFObject& appearance = document->getObject(appearanceDictionary->get(key));
+            if (appearance.isDictionary())
+            {
+                const PDFDictionary* appearanceStates = appearance.getDictionary();
+                for (size_t i = 0; i < appearanceStates->getCount(); ++i)
+                {
+                    processFormStream(appearanceStates->getValue(i));
+                }
+            }
+            else
+            {
+                processFormStream(appearance);
+            }
+        }
+    }
+
+    while (!m_softMasks.empty())
+    {
+        const PDFStream* softMask = m_softMasks.back();
+        m_softMasks.pop_back();
+        processFormStream(softMask);
+    }
+}
+
+void PDFFontUsageCollector::processFormStream(const PDFObject& object)
+{
+    const PDFObject& dereferencedObject = getDocument()->getObject(object);
+    if (dereferencedObject.isStream())
+    {
+        processFormStream(dereferencedObject.getStream());
+    }
+}
+
+void PDFFontUsageCollector::processFormStream(const PDFStream* stream)
+{
+    try
+    {
+        initializeProcessor();
+        processForm(stream);
+    }
+    catch (const PDFException&)
+    {
+        // Form can't be processed, skip it
+    }
+    catch (const PDFRendererException&)
+    {
+        // Form can't be processed, skip it
+    }
+}
+
+bool PDFFontUsageCollector::isContentSuppressedByOC(PDFObjectReference ocgOrOcmd)
+{
+    Q_UNUSED(ocgOrOcmd);
+
+    // Hidden content can be turned on, so its text must respect it too
+    return false;
+}
+
+bool PDFFontUsageCollector::isContentKindSuppressed(ContentKind kind) const
+{
+    switch (kind)
+    {
+        case ContentKind::Images:
+        case ContentKind::Shading:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+bool PDFFontUsageCollector::performImageXObjectPlacement(const PDFStream* stream)
+{
+    Q_UNUSED(stream);
+
+    // We do not need images, so do not decode them
+    return true;
+}
+
+void PDFFontUsageCollector::performUpdateGraphicsState(const PDFPageContentProcessorState& state)
+{
+    PDFPageContentProcessor::performUpdateGraphicsState(state);
+
+    if (state.getStateFlags().testFlag(PDFPageContentProcessorState::StateSoftMask) && state.getSoftMask())
+    {
+        const PDFObject& softMaskGroup = getDocument()->getObject(state.getSoftMask()->get("G"));
+        if (softMaskGroup.isStream() && m_processedSoftMasks.insert(softMaskGroup.getStream()).second)
+        {
+            m_softMasks.push_back(softMaskGroup.getStream());
+        }
+    }
+}
+
+void PDFFontUsageCollector::performProcessTextSequence(const TextSequence& textSequence, ProcessOrder order)
+{
+    if (order != ProcessOrder::BeforeOperation || !getGraphicState()->getTextFont())
+    {
+        return;
+    }
+
+    auto it = m_fonts->find(getGraphicState()->getTextFont().get());
+    if (it == m_fonts->cend())
+    {
+        return;
+    }
+
+    std::set<CID>& usedCharacters = m_usedCharacters[it->second];
+    for (const TextSequenceItem& item : textSequence.items)
+    {
+        // Advance items have zero CID, characters without glyph have valid CID
+        if (item.isCharacter() || item.cid != 0)
+        {
+            usedCharacters.insert(item.cid);
+        }
+    }
+}
+
+/// Class of objects, which can't be merged with other objects
+static constexpr size_t UNMERGEABLE_CLASS = std::numeric_limits<size_t>::max();
+
+/// Class of references, which point to null (or not existing) object
+static constexpr size_t NULL_CLASS = UNMERGEABLE_CLASS - 1;
+
+/// Refines classes of objects by classes of referenced objects, until fixed
+/// point is reached (partition refinement). Refined partition is always finer
+/// (or the same), so count of classes can't decrease. Objects of class
+/// \p UNMERGEABLE_CLASS are not changed.
+/// \param classes Initial classes of objects, refined classes are stored here
+/// \param classCount Count of initial classes
+/// \param references References of objects, in the order of visiting
+/// \param getReferenceClass Returns class of the referenced object for given classes
+/// \returns Count of refined classes
+template<typename GetReferenceClass>
+static size_t refineObjectClasses(std::vector<size_t>& classes,
+                                  size_t classCount,
+                                  const std::vector<std::vector<PDFObjectReference>>& references,
+                                  GetReferenceClass getReferenceClass)
+{
+    struct SignatureHash
+    {
+        size_t operator()(const std::vector<size_t>& signature) const
+        {
+            return qHashRange(signature.cbegin(), signature.cend());
+        }
+    };
+
+    const size_t objectCount = classes.size();
+    PDFIntegerRange<size_t> range(0, objectCount);
+    std::vector<std::vector<size_t>> signatures(objectCount);
+
+    while (true)
+    {
+        auto createSignature = [&](size_t index)
+        {
+            std::vector<size_t>& signature = signatures[index];
+            signature.clear();
+
+            if (classes[index] == UNMERGEABLE_CLASS)
+            {
+                return;
+            }
+
+            signature.reserve(references[index].size() + 1);
+            signature.push_back(classes[index]);
+            for (const PDFObjectReference& reference : references[index])
+            {
+                signature.push_back(getReferenceClass(classes, reference));
+            }
+        };
+        PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, range.begin(), range.end(), createSignature);
+
+        std::unordered_map<std::vector<size_t>, size_t, SignatureHash> signatureToClass;
+        signatureToClass.reserve(classCount);
+
+        std::vector<size_t> newClasses(objectCount, UNMERGEABLE_CLASS);
+        for (size_t i = 0; i < objectCount; ++i)
+        {
+            if (classes[i] != UNMERGEABLE_CLASS)
+            {
+                newClasses[i] = signatureToClass.emplace(qMove(signatures[i]), signatureToClass.size()).first->second;
+            }
+        }
+
+        const size_t newClassCount = signatureToClass.size();
+        classes = qMove(newClasses);
+
+        if (newClassCount == classCount)
+        {
+            break;
+        }
+
+        classCount = newClassCount;
+    }
+
+    return classCount;
+}
+
+/// Recompresses data of the flate stream with maximal compression. If stream
+/// is not flate stream, or recompressed data are not smaller, then empty byte
+/// array is returned.
+/// \param storage Storage
+/// \param stream Stream
+/// \param content Content of the stream (decrypted)
+static QByteArray getRecompressedFlateStreamData(const PDFObjectStorage* storage, const PDFStream* stream, const QByteArray& content)
+{
+    if (stream->getDictionary()->hasKey("F"))
+    {
+        // External file stream, we do not recompress it
+        return QByteArray();
+    }
+
+    PDFStreamFilterStorage::StreamFilters streamFilters = PDFStreamFilterStorage::getStreamFilters(stream, std::bind(QOverload<const PDFObject&>::of(&PDFObjectStorage::getObject), storage, std::placeholders::_1));
+
+    if (streamFilters.filterObjects.empty())
+    {
+        // No filters
+        return QByteArray();
+    }
+
+    const PDFStreamFilter* streamFilter = streamFilters.filterObjects.back();
+    if (dynamic_cast<const PDFFlateDecodeFilter*>(streamFilter))
+    {
+        // Try to recompress. If we end with less data, then we use recompressed stream
+        QByteArray recompressedData = PDFFlateDecodeFilter::recompress(content);
+        if (recompressedData.size() < content.size())
+        {
+            return recompressedData;
+        }
+    }
+
+    return QByteArray();
+}
+
+/// Transforms objects for the streaming optimization. References to simple
+/// objects are replaced by these objects, other references are remapped
+/// to the references of the output document, and references to objects,
+/// which are not written, are replaced by null objects.
+class PDFStreamingOptimizationVisitor : public PDFUpdateObjectVisitor
+{
+public:
+    explicit PDFStreamingOptimizationVisitor(const PDFObjectStorage* storage,
+                                             const std::map<PDFInteger, PDFObject>* simpleObjects,
+                                             const PDFObjectUtils::FlatReferenceMapping* referenceMapping,
+                                             PDFInteger* counter) :
+        PDFUpdateObjectVisitor(storage),
+        m_simpleObjects(simpleObjects),
+        m_referenceMapping(referenceMapping),
+        m_counter(counter)
+    {
+
+    }
+
+    virtual void visitReference(const PDFObjectReference reference) override;
+
+private:
+    const std::map<PDFInteger, PDFObject>* m_simpleObjects;
+    const PDFObjectUtils::FlatReferenceMapping* m_referenceMapping;
+    PDFInteger* m_counter;
+};
+
+void PDFStreamingOptimizationVisitor::visitReference(const PDFObjectReference reference)
+{
+    if (reference.objectNumber < 0 || size_t(reference.objectNumber) >= m_referenceMapping->size())
+    {
+        m_objectStack.push_back(PDFObject());
+        return;
+    }
+
+    const auto& mapping = (*m_referenceMapping)[reference.objectNumber];
+    if (mapping.first != reference)
+    {
+        // Reference to not existing object (generation differs)
+        m_objectStack.push_back(PDFObject());
+        return;
+    }
+
+    auto it = m_simpleObjects->find(reference.objectNumber);
+    if (it != m_simpleObjects->cend())
+    {
+        ++*m_counter;
+        m_objectStack.push_back(it->second);
+        return;
+    }
+
+    m_objectStack.push_back(mapping.second.isValid() ? PDFObject::createReference(mapping.second) : PDFObject());
+}
+
 PDFOptimizer::PDFOptimizer(OptimizationFlags flags, QObject* parent) :
     QObject(parent),
     m_flags(flags)
@@ -124,7 +590,8 @@ void PDFOptimizer::optimize()
 {
     // Jakub Melka: We divide optimization into stages, each
     // stage can consist from multiple passes.
-    constexpr OptimizationFlags stages[] = { OptimizationFlags(DereferenceSimpleObjects),
+    constexpr OptimizationFlags stages[] = { OptimizationFlags(DownsampleImages | SubsetFonts),
+                                             OptimizationFlags(DereferenceSimpleObjects),
                                              OptimizationFlags(RemoveNullObjects),
                                              OptimizationFlags(RemoveUnusedObjects | MergeIdenticalObjects),
                                              OptimizationFlags(ShrinkObjectStorage),
@@ -146,6 +613,14 @@ void PDFOptimizer::optimize()
             Q_EMIT optimizationProgress(tr("Pass %1").arg(passIndex++));
             pass = false;
 
+            if (currentSteps.testFlag(DownsampleImages))
+            {
+                pass = performDownsampleImages() || pass;
+            }
+            if (currentSteps.testFlag(SubsetFonts))
+            {
+                pass = performSubsetFonts() || pass;
+            }
             if (currentSteps.testFlag(DereferenceSimpleObjects))
             {
                 pass = performDereferenceSimpleObjects() || pass;
@@ -185,123 +660,541 @@ void PDFOptimizer::setFlags(OptimizationFlags flags)
     m_flags = flags;
 }
 
-bool PDFOptimizer::performDereferenceSimpleObjects()
+PDFOperationResult PDFOptimizer::optimizeStreaming(const QString& fileName, QIODevice* device, PDFStreamingDocumentWriter::Mode mode)
 {
-    std::atomic<PDFInteger> counter = 0;
+    PDFDocumentReader reader(nullptr, [](bool* ok) { *ok = false; return QString(); }, false, false);
+    reader.setLazyObjectLoading(true);
+    reader.setObjectArenaAllocation(false);
+    PDFDocument document = reader.readFromFile(fileName);
 
-    PDFObjectStorage::PDFObjects objects =  m_storage.getObjects();
-    auto processEntry = [this, &counter](PDFObjectStorage::Entry& entry)
+    if (reader.getReadingResult() != PDFDocumentReader::Result::OK)
     {
-        PDFRemoveSimpleObjectsVisitor visitor(&m_storage, &counter);
-        entry.object.accept(&visitor);
-        entry.object = visitor.getObject();
-    };
+        return tr("Cannot open document '%1'. %2").arg(fileName, reader.getErrorMessage());
+    }
 
-    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, objects.begin(), objects.end(), processEntry);
-    m_storage.setObjects(qMove(objects));
-    Q_EMIT optimizationProgress(tr("Simple objects dereferenced and embedded: %1").arg(counter.load()));
+    const PDFObjectStorage& storage = document.getStorage();
+    const PDFDictionary* trailerDictionary = storage.getDictionaryFromObject(storage.getTrailerDictionary());
+    const PDFObject& catalogObject = trailerDictionary ? trailerDictionary->get("Root") : PDFObject();
+    const PDFObject& infoObject = trailerDictionary ? trailerDictionary->get("Info") : PDFObject();
 
-    return false;
-}
+    if (!catalogObject.isReference())
+    {
+        return tr("Catalog of the document '%1' is not found.").arg(fileName);
+    }
 
-bool PDFOptimizer::performRemoveNullObjects()
-{
-    std::atomic<PDFInteger> counter = 0;
+    Q_EMIT optimizationStarted();
 
-    PDFObjectStorage::PDFObjects objects =  m_storage.getObjects();
-    auto processEntry = [this, &counter](PDFObjectStorage::Entry& entry)
+    if (m_flags & (DownsampleImages | SubsetFonts))
     {
-        PDFRemoveNullDictionaryEntriesVisitor visitor(&m_storage, &counter);
-        entry.object.accept(&visitor);
-        entry.object = visitor.getObject();
-    };
+        Q_EMIT optimizationProgress(tr("Image downsampling and font subsetting are not supported in streaming mode, they are skipped."));
+    }
 
-    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, objects.begin(), objects.end(), processEntry);
-    m_storage.setObjects(qMove(objects));
-    Q_EMIT optimizationProgress(tr("Null objects entries from dictionaries removed: %1").arg(counter.load()));
+    // First pass - objects are read one by one and only their references,
+    // hashes and simple objects are kept. Objects itself are not stored.
+    Q_EMIT optimizationProgress(tr("Pass %1").arg(1));
 
-    return false;
-}
+    const size_t objectCount = storage.getObjectCount();
+    const bool dereferenceSimpleObjects = m_flags.testFlag(DereferenceSimpleObjects);
+    const bool mergeIdenticalObjects = m_flags.testFlag(MergeIdenticalObjects);
 
-bool PDFOptimizer::performRemoveUnusedObjects()
-{
-    std::atomic<PDFInteger> counter = 0;
-    PDFObjectStorage::PDFObjects objects =  m_storage.getObjects();
-    std::set<PDFObjectReference> references = PDFObjectUtils::getReferences({ m_storage.getTrailerDictionary() }, m_storage);
+    std::vector<PDFInteger> generations(objectCount, 0);
+    std::vector<bool> validObjects(objectCount, false);
+    std::vector<std::vector<PDFObjectReference>> references(objectCount);
+    std::vector<QByteArray> hashes(mergeIdenticalObjects ? objectCount : 0);
+    std::map<PDFInteger, PDFObject> simpleObjects;
 
-    PDFIntegerRange<size_t> range(0, objects.size());
-    auto processEntry = [&counter, &objects, &references](size_t index)
+    for (size_t i = 1; i < objectCount; ++i)
     {
-        PDFObjectStorage::Entry& entry = objects[index];
-        PDFObjectReference reference(PDFInteger(index), entry.generation);
-        if (!references.count(reference) && !entry.object.isNull())
+        const PDFObjectStorage::Entry entry = storage.readEntry(PDFInteger(i));
+        generations[i] = entry.generation;
+
+        if (entry.object.isNull())
         {
-            entry.object = PDFObject();
-            ++counter;
+            continue;
         }
-    };
-
-    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, range.begin(), range.end(), processEntry);
-    m_storage.setObjects(qMove(objects));
-    Q_EMIT optimizationProgress(tr("Unused objects removed: %1").arg(counter.load()));
 
-    return counter > 0;
-}
+        validObjects[i] = true;
 
-bool PDFOptimizer::performMergeIdenticalObjects()
-{
-    std::atomic<PDFInteger> counter = 0;
-    std::map<PDFObjectReference, PDFObjectReference> replacementMap;
-    std::map<QByteArray, PDFObjectReference> serializedObjectToReference;
-    PDFObjectStorage::PDFObjects objects =  m_storage.getObjects();
-    std::vector<QByteArray> serializedObjects(objects.size());
+        switch (entry.object.getType())
+        {
+            case PDFObject::Type::Bool:
+            case PDFObject::Type::Int:
+            case PDFObject::Type::Real:
+            case PDFObject::Type::String:
+            case PDFObject::Type::Name:
+            {
+                if (dereferenceSimpleObjects)
+                {
+                    simpleObjects[PDFInteger(i)] = entry.object;
+                    continue;
+                }
+                break;
+            }
 
-    PDFIntegerRange<size_t> range(0, objects.size());
-    auto serializeEntry = [&objects, &serializedObjects](size_t index)
-    {
-        const PDFObjectStorage::Entry& entry = objects[index];
+            default:
+                break;
+        }
+
+        // Stream content is not visited, only the dictionary
+        const PDFStream* stream = entry.object.isStream() ? entry.object.getStream() : nullptr;
+        PDFStructuralKeyVisitor visitor(&storage);
+        if (stream)
+        {
+            PDFObject::createDictionary(std::make_shared<PDFDictionary>(*stream->getDictionary())).accept(&visitor);
+        }
+        else
+        {
+            entry.object.accept(&visitor);
+        }
+        references[i] = visitor.takeReferences();
+
+        if (!mergeIdenticalObjects)
+        {
+            continue;
+        }
 
-        if (!entry.object.isNull())
+        // We do not merge special objects, such as pages
+        if (const PDFDictionary* dictionary = storage.getDictionaryFromObject(entry.object))
         {
-            serializedObjects[index] = PDFDocumentWriter::getSerializedObject(entry.object);
+            PDFObject nameObject = storage.getObject(dictionary->get("Type"));
+            if (nameObject.isName() && nameObject.getString() == "Page")
+            {
+                continue;
+            }
+        }
+
+        QCryptographicHash hash(QCryptographicHash::Sha256);
+        hash.addData(PDFDocumentWriter::getSerializedObject(visitor.getObject()));
+        if (stream)
+        {
+            hash.addData(stream->getDecryptedContent());
         }
+        hashes[i] = hash.result();
+    }
+
+    auto isValidReference = [&](PDFObjectReference reference)
+    {
+        return reference.objectNumber > 0 &&
+               size_t(reference.objectNumber) < objectCount &&
+               validObjects[reference.objectNumber] &&
+               generations[reference.objectNumber] == reference.generation;
     };
-    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, range.begin(), range.end(), serializeEntry);
 
-    // Find same object
-    for (PDFInteger index : range)
+    if (!isValidReference(catalogObject.getReference()))
     {
-        const PDFObjectStorage::Entry& entry = objects[index];
+        Q_EMIT optimizationFinished();
+        return tr("Catalog of the document '%1' is not found.").arg(fileName);
+    }
+
+    // Objects reachable from the catalog and document info are written,
+    // other objects only if unused objects should be kept.
+    std::vector<bool> writtenObjects = validObjects;
+    if (m_flags.testFlag(RemoveUnusedObjects))
+    {
+        std::fill(writtenObjects.begin(), writtenObjects.end(), false);
+
+        std::vector<PDFObjectReference> stack;
+        for (const PDFObject& object : { catalogObject, infoObject })
+        {
+            if (object.isReference())
+            {
+                stack.push_back(object.getReference());
+            }
+        }
+
+        while (!stack.empty())
+        {
+            const PDFObjectReference reference = stack.back();
+            stack.pop_back();
+
+            if (!isValidReference(reference) || writtenObjects[reference.objectNumber])
+            {
+                continue;
+            }
+
+            writtenObjects[reference.objectNumber] = true;
+            stack.insert(stack.end(), references[reference.objectNumber].cbegin(), references[reference.objectNumber].cend());
+        }
+
+        const PDFInteger removedObjectCount = std::count(validObjects.cbegin(), validObjects.cend(), true) - std::count(writtenObjects.cbegin(), writtenObjects.cend(), true);
+        Q_EMIT optimizationProgress(tr("Unused objects removed: %1").arg(removedObjectCount));
+    }
 
-        if (!entry.object.isNull())
+    // Merge identical objects, from the objects, which are written. Representative
+    // of the class is the first object of the class.
+    std::vector<size_t> representatives(objectCount, UNMERGEABLE_CLASS);
+    if (mergeIdenticalObjects)
+    {
+        std::vector<size_t> classes(objectCount, UNMERGEABLE_CLASS);
+        size_t classCount = 0;
         {
-            // We do not merge special objects, such as pages
-            if (const PDFDictionary* dictionary = m_storage.getDictionaryFromObject(entry.object))
+            QHash<QByteArray, size_t> hashToClass;
+            for (size_t i = 0; i < objectCount; ++i)
             {
-                PDFObject nameObject = m_storage.getObject(dictionary->get("Type"));
-                if (nameObject.isName())
+                if (writtenObjects[i] && !hashes[i].isEmpty())
                 {
-                    if (nameObject.getString() == "Page")
+                    auto it = hashToClass.find(hashes[i]);
+                    if (it == hashToClass.end())
                     {
-                        continue;
+                        it = hashToClass.insert(hashes[i], classCount++);
                     }
+                    classes[i] = it.value();
                 }
             }
+            hashes = std::vector<QByteArray>();
+        }
+
+        auto getReferenceClass = [&isValidReference, objectCount](const std::vector<size_t>& currentClasses, PDFObjectReference reference) -> size_t
+        {
+            if (!isValidReference(reference))
+            {
+                return NULL_CLASS;
+            }
+
+            const size_t referenceClass = currentClasses[reference.objectNumber];
+            if (referenceClass == UNMERGEABLE_CLASS)
+            {
+                // Unmergeable object is unique, its identity is given by object number
+                return objectCount + size_t(reference.objectNumber);
+            }
+
+            return referenceClass;
+        };
+
+        classCount = refineObjectClasses(classes, classCount, references, getReferenceClass);
+
+        PDFInteger counter = 0;
+        std::vector<size_t> classRepresentatives(classCount, UNMERGEABLE_CLASS);
+        for (size_t i = 0; i < objectCount; ++i)
+        {
+            const size_t objectClass = classes[i];
+            if (objectClass == UNMERGEABLE_CLASS)
+            {
+                continue;
+            }
 
-            PDFObjectReference currentReference(PDFInteger(index), objects[index].generation);
-            const QByteArray& serializedObject = serializedObjects[index];
-            if (!serializedObjectToReference.count(serializedObject))
+            if (classRepresentatives[objectClass] == UNMERGEABLE_CLASS)
             {
-                serializedObjectToReference[serializedObject] = currentReference;
+                classRepresentatives[objectClass] = i;
             }
             else
             {
-                PDFObjectReference oldReference = currentReference;
-                PDFObjectReference newReference = serializedObjectToReference.at(serializedObject);
-                replacementMap[oldReference] = newReference;
+                representatives[i] = classRepresentatives[objectClass];
                 ++counter;
             }
         }
+
+        Q_EMIT optimizationProgress(tr("Identical objects merged: %1").arg(counter));
+    }
+
+    // Object numbers of the output document are assigned sequentially, so object storage
+    // is always shrinked. Simple objects are not written, if they are dereferenced.
+    PDFVersion version = document.getInfo()->version;
+    if (!version.isValid())
+    {
+        version = PDFVersion(1, 7);
+    }
+
+    PDFStreamingDocumentWriter writer(device);
+    writer.setMode(mode);
+    if (!writer.beginDocument(version))
+    {
+        Q_EMIT optimizationFinished();
+        return tr("Cannot write optimized document.");
+    }
+
+    PDFObjectUtils::FlatReferenceMapping referenceMapping(objectCount);
+    for (size_t i = 1; i < objectCount; ++i)
+    {
+        referenceMapping[i].first = PDFObjectReference(PDFInteger(i), generations[i]);
+
+        if (writtenObjects[i] && representatives[i] == UNMERGEABLE_CLASS && !simpleObjects.count(PDFInteger(i)))
+        {
+            referenceMapping[i].second = writer.reserveObject();
+        }
+    }
+
+    for (size_t i = 1; i < objectCount; ++i)
+    {
+        if (representatives[i] != UNMERGEABLE_CLASS)
+        {
+            referenceMapping[i].second = referenceMapping[representatives[i]].second;
+        }
+    }
+
+    // Second pass - objects are read again and written to the output one by one
+    Q_EMIT optimizationProgress(tr("Pass %1").arg(2));
+
+    PDFInteger dereferencedObjectCount = 0;
+    std::atomic<PDFInteger> nullObjectCount = 0;
+    PDFInteger bytesSaved = 0;
+
+    auto transformObject = [&](const PDFObject& object)
+    {
+        PDFStreamingOptimizationVisitor visitor(&storage, &simpleObjects, &referenceMapping, &dereferencedObjectCount);
+        object.accept(&visitor);
+        PDFObject result = visitor.getObject();
+
+        if (m_flags.testFlag(RemoveNullObjects))
+        {
+            PDFRemoveNullDictionaryEntriesVisitor removeNullVisitor(&storage, &nullObjectCount);
+            result.accept(&removeNullVisitor);
+            result = removeNullVisitor.getObject();
+        }
+
+        return result;
+    };
+
+    for (size_t i = 1; i < objectCount; ++i)
+    {
+        const PDFObjectReference outputReference = referenceMapping[i].second;
+        if (!outputReference.isValid() || representatives[i] != UNMERGEABLE_CLASS)
+        {
+            continue;
+        }
+
+        const PDFObjectStorage::Entry entry = storage.readEntry(PDFInteger(i));
+        PDFObject object;
+
+        if (entry.object.isStream())
+        {
+            // Stream content is taken from the source data, only if it is stored
+            // unencrypted, otherwise decrypted content is owned by the stream.
+            const PDFStream* stream = entry.object.getStream();
+            PDFObject dictionaryObject = transformObject(PDFObject::createDictionary(std::make_shared<PDFDictionary>(*stream->getDictionary())));
+            PDFDictionary dictionary = *dictionaryObject.getDictionary();
+            QByteArray content = stream->getDecryptedContent();
+            PDFStreamDataOwner dataOwner = stream->isContentDecryptedLazily() ? PDFStreamDataOwner() : stream->getDataOwner();
+
+            if (m_flags.testFlag(RecompressFlateStreams))
+            {
+                QByteArray recompressedData = getRecompressedFlateStreamData(&storage, stream, content);
+                if (!recompressedData.isEmpty())
+                {
+                    bytesSaved += content.size() - recompressedData.size();
+                    content = qMove(recompressedData);
+                    dataOwner = PDFStreamDataOwner();
+                }
+            }
+
+            dictionary.setEntry(PDFInplaceOrMemoryString("Length"), PDFObject::createInteger(content.size()));
+            object = PDFObject::createStream(std::make_shared<PDFStream>(qMove(dictionary), qMove(content), qMove(dataOwner)));
+        }
+        else
+        {
+            object = transformObject(entry.object);
+        }
+
+        writer.writeReservedObject(outputReference, object);
+    }
+
+    if (dereferenceSimpleObjects)
+    {
+        Q_EMIT optimizationProgress(tr("Simple objects dereferenced and embedded: %1").arg(dereferencedObjectCount));
+    }
+    if (m_flags.testFlag(RemoveNullObjects))
+    {
+        Q_EMIT optimizationProgress(tr("Null objects entries from dictionaries removed: %1").arg(nullObjectCount.load()));
+    }
+    if (m_flags.testFlag(RecompressFlateStreams))
+    {
+        Q_EMIT optimizationProgress(tr("Bytes saved by recompressing stream: %1").arg(bytesSaved));
+    }
+
+    writer.setCatalogReference(referenceMapping[catalogObject.getReference().objectNumber].second);
+    if (infoObject.isReference() && isValidReference(infoObject.getReference()))
+    {
+        writer.setInfoReference(referenceMapping[infoObject.getReference().objectNumber].second);
+    }
+
+    PDFOperationResult result = writer.endDocument();
+    Q_EMIT optimizationFinished();
+    return result;
+}
+
+bool PDFOptimizer::performDereferenceSimpleObjects()
+{
+    std::atomic<PDFInteger> counter = 0;
+
+    PDFObjectStorage::PDFObjects objects =  m_storage.getObjects();
+    auto processEntry = [this, &counter](PDFObjectStorage::Entry& entry)
+    {
+        PDFRemoveSimpleObjectsVisitor visitor(&m_storage, &counter);
+        entry.object.accept(&visitor);
+        entry.object = visitor.getObject();
+    };
+
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, objects.begin(), objects.end(), processEntry);
+    m_storage.setObjects(qMove(objects));
+    Q_EMIT optimizationProgress(tr("Simple objects dereferenced and embedded: %1").arg(counter.load()));
+
+    return false;
+}
+
+bool PDFOptimizer::performRemoveNullObjects()
+{
+    std::atomic<PDFInteger> counter = 0;
+
+    PDFObjectStorage::PDFObjects objects =  m_storage.getObjects();
+    auto processEntry = [this, &counter](PDFObjectStorage::Entry& entry)
+    {
+        PDFRemoveNullDictionaryEntriesVisitor visitor(&m_storage, &counter);
+        entry.object.accept(&visitor);
+        entry.object = visitor.getObject();
+    };
+
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, objects.begin(), objects.end(), processEntry);
+    m_storage.setObjects(qMove(objects));
+    Q_EMIT optimizationProgress(tr("Null objects entries from dictionaries removed: %1").arg(counter.load()));
+
+    return false;
+}
+
+bool PDFOptimizer::performRemoveUnusedObjects()
+{
+    std::atomic<PDFInteger> counter = 0;
+    PDFObjectStorage::PDFObjects objects =  m_storage.getObjects();
+    const std::vector<bool> reachableObjects = PDFObjectUtils::getReachableObjects({ m_storage.getTrailerDictionary() }, m_storage);
+
+    PDFIntegerRange<size_t> range(0, objects.size());
+    auto processEntry = [&counter, &objects, &reachableObjects](size_t index)
+    {
+        PDFObjectStorage::Entry& entry = objects[index];
+        if (!reachableObjects[index] && !entry.object.isNull())
+        {
+            entry.object = PDFObject();
+            ++counter;
+        }
+    };
+
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, range.begin(), range.end(), processEntry);
+    m_storage.setObjects(qMove(objects));
+    Q_EMIT optimizationProgress(tr("Unused objects removed: %1").arg(counter.load()));
+
+    return counter > 0;
+}
+
+bool PDFOptimizer::performMergeIdenticalObjects()
+{
+    PDFInteger counter = 0;
+    std::map<PDFObjectReference, PDFObjectReference> replacementMap;
+    PDFObjectStorage::PDFObjects objects =  m_storage.getObjects();
+    const size_t objectCount = objects.size();
+
+    // Objects are merged, if they have the same structure and
+    // their references point to objects, which can be merged too. This is
+    // partition refinement - all objects start in one class (given by their
+    // serialization without references) and classes are split by classes
+    // of referenced objects, until fixed point is reached, so also identical
+    // cyclic structures are merged. Classes are found by hashing; hash tables
+    // do full comparison of keys, so hash collisions can't merge different objects.
+    struct ObjectInfo
+    {
+        QByteArray serializedObject;
+        bool isMergeable = false;
+    };
+
+    std::vector<ObjectInfo> objectInfos(objectCount);
+    std::vector<std::vector<PDFObjectReference>> references(objectCount);
+
+    PDFIntegerRange<size_t> range(0, objectCount);
+    auto serializeEntry = [this, &objects, &objectInfos, &references](size_t index)
+    {
+        const PDFObjectStorage::Entry& entry = objects[index];
+
+        if (entry.object.isNull())
+        {
+            return;
+        }
+
+        // We do not merge special objects, such as pages
+        if (const PDFDictionary* dictionary = m_storage.getDictionaryFromObject(entry.object))
+        {
+            PDFObject nameObject = m_storage.getObject(dictionary->get("Type"));
+            if (nameObject.isName() && nameObject.getString() == "Page")
+            {
+                return;
+            }
+        }
+
+        PDFStructuralKeyVisitor visitor(&m_storage);
+        entry.object.accept(&visitor);
+
+        ObjectInfo& info = objectInfos[index];
+        info.serializedObject = PDFDocumentWriter::getSerializedObject(visitor.getObject());
+        info.isMergeable = true;
+        references[index] = visitor.takeReferences();
+    };
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, range.begin(), range.end(), serializeEntry);
+
+    // Initial classes - serialization of the object, without references
+    std::vector<size_t> classes(objectCount, UNMERGEABLE_CLASS);
+    size_t classCount = 0;
+    {
+        QHash<QByteArray, size_t> serializedObjectToClass;
+        for (size_t i = 0; i < objectCount; ++i)
+        {
+            ObjectInfo& info = objectInfos[i];
+            if (info.isMergeable)
+            {
+                auto it = serializedObjectToClass.find(info.serializedObject);
+                if (it == serializedObjectToClass.end())
+                {
+                    it = serializedObjectToClass.insert(info.serializedObject, classCount++);
+                }
+                classes[i] = it.value();
+            }
+            info.serializedObject = QByteArray();
+        }
+    }
+
+    auto getReferenceClass = [&objects, objectCount](const std::vector<size_t>& currentClasses, PDFObjectReference reference) -> size_t
+    {
+        if (reference.objectNumber < 0 || size_t(reference.objectNumber) >= objectCount)
+        {
+            return NULL_CLASS;
+        }
+
+        const PDFObjectStorage::Entry& entry = objects[reference.objectNumber];
+        if (entry.object.isNull() || entry.generation != reference.generation)
+        {
+            return NULL_CLASS;
+        }
+
+        const size_t referenceClass = currentClasses[reference.objectNumber];
+        if (referenceClass == UNMERGEABLE_CLASS)
+        {
+            // Unmergeable object is unique, its identity is given by object number
+            return objectCount + size_t(reference.objectNumber);
+        }
+
+        return referenceClass;
+    };
+
+    classCount = refineObjectClasses(classes, classCount, references, getReferenceClass);
+
+    // Replace objects by the first object of its class
+    std::vector<size_t> classRepresentatives(classCount, UNMERGEABLE_CLASS);
+    for (size_t i = 0; i < objectCount; ++i)
+    {
+        const size_t objectClass = classes[i];
+        if (objectClass == UNMERGEABLE_CLASS)
+        {
+            continue;
+        }
+
+        if (classRepresentatives[objectClass] == UNMERGEABLE_CLASS)
+        {
+            classRepresentatives[objectClass] = i;
+        }
+        else
+        {
+            const size_t representative = classRepresentatives[objectClass];
+            PDFObjectReference oldReference(PDFInteger(i), objects[i].generation);
+            PDFObjectReference newReference(PDFInteger(representative), objects[representative].generation);
+            replacementMap[oldReference] = newReference;
+            ++counter;
+        }
     }
 
     // Replace objects
@@ -316,7 +1209,7 @@ bool PDFOptimizer::performMergeIdenticalObjects()
     }
 
     m_storage.setObjects(qMove(objects));
-    Q_EMIT optimizationProgress(tr("Identical objects merged: %1").arg(counter.load()));
+    Q_EMIT optimizationProgress(tr("Identical objects merged: %1").arg(counter));
 
     return counter > 0;
 }
@@ -427,42 +1320,828 @@ bool PDFOptimizer::performRecompressFlateStreams()
         if (entry.object.isStream())
         {
             const PDFStream* stream = entry.object.getStream();
-            const PDFDictionary* dictionary = stream->getDictionary();
+            QByteArray recompressedData = getRecompressedFlateStreamData(&m_storage, stream, *stream->getContent());
 
-            if (dictionary->hasKey("F"))
+            if (!recompressedData.isEmpty())
             {
-                // External file stream, we do not recompress it
-                return;
+                bytesSaved += stream->getContent()->size() - recompressedData.size();
+                PDFDictionary updatedDictionary = *stream->getDictionary();
+                updatedDictionary.setEntry(PDFInplaceOrMemoryString("Length"), PDFObject::createInteger(recompressedData.size()));
+                entry.object = PDFObject::createStream(std::make_shared<PDFStream>(qMove(updatedDictionary), qMove(recompressedData)));
             }
+        }
+    };
 
-            PDFStreamFilterStorage::StreamFilters streamFilters = PDFStreamFilterStorage::getStreamFilters(stream, std::bind(QOverload<const PDFObject&>::of(&PDFObjectStorage::getObject), &m_storage, std::placeholders::_1));
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, objects.begin(), objects.end(), processEntry);
+    m_storage.setObjects(qMove(objects));
+    Q_EMIT optimizationProgress(tr("Bytes saved by recompressing stream: %1").arg(bytesSaved.load()));
 
-            if (streamFilters.filterObjects.empty())
-            {
-                // No filters
-                return;
-            }
+    return false;
+}
+
+bool PDFOptimizer::performDownsampleImages()
+{
+    if (m_imageSettings.targetResolution <= 0.0)
+    {
+        return false;
+    }
+
+    std::vector<std::pair<PDFObjectReference, PDFReal>> candidates;
+    std::vector<PDFObject> downsampledImages;
+
+    try
+    {
+        // Placements of images are determined by processing page contents,
+        // which needs the document (not just object storage).
+        PDFDocument document(PDFObjectStorage(m_storage), PDFVersion(2, 0), QByteArray());
+        const PDFObjectStorage& storage = document.getStorage();
+        const PDFObjectStorage::PDFObjects& objects = storage.getObjects();
+
+        std::map<const PDFStream*, PDFObjectReference> images;
+        for (size_t i = 0; i < objects.size(); ++i)
+        {
+            const PDFObject& object = objects[i].object;
+            if (!object.isStream())
+            {
+                continue;
+            }
+
+            const PDFStream* stream = object.getStream();
+            const PDFObject& subtype = storage.getObject(stream->getDictionary()->get("Subtype"));
+            if (subtype.isName() && subtype.getString() == "Image")
+            {
+                images[stream] = PDFObjectReference(PDFInteger(i), objects[i].generation);
+            }
+        }
+
+        if (images.empty())
+        {
+            Q_EMIT optimizationProgress(tr("Images downsampled: %1").arg(0));
+            return false;
+        }
+
+        std::map<PDFObjectReference, QSizeF> placements;
+        QMutex mutex;
+
+        PDFFontCache fontCache(DEFAULT_FONT_CACHE_LIMIT, DEFAULT_REALIZED_FONT_CACHE_LIMIT);
+        PDFCMSGeneric cms;
+        PDFMeshQualitySettings mqs;
+        PDFOptionalContentActivity oca(&document, OCUsage::Export, nullptr);
+        PDFModifiedDocument md(&document, &oca);
+        fontCache.setDocument(md);
+        fontCache.setCacheShrinkEnabled(nullptr, false);
+
+        const PDFCatalog* catalog = document.getCatalog();
+        PDFIntegerRange<size_t> pageRange(0, catalog->getPageCount());
+        auto collectPlacements = [&](size_t pageIndex)
+        {
+            const PDFPage* page = catalog->getPage(pageIndex);
+            Q_ASSERT(page);
+
+            PDFImagePlacementCollector collector(page, &document, &fontCache, &cms, &oca, mqs, &images, &placements, &mutex);
+            collector.processContents();
+        };
+        PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, pageRange.begin(), pageRange.end(), collectPlacements);
+
+        fontCache.setCacheShrinkEnabled(nullptr, true);
+
+        // Resolution of the image is given by its largest placement
+        for (const auto& placement : placements)
+        {
+            const QSizeF& size = placement.second;
+            if (size.width() <= 0.0 || size.height() <= 0.0)
+            {
+                continue;
+            }
+
+            const PDFDictionary* dictionary = storage.getObjectByReference(placement.first).getStream()->getDictionary();
+            const PDFObject& widthObject = storage.getObject(dictionary->get("Width"));
+            const PDFObject& heightObject = storage.getObject(dictionary->get("Height"));
+            if (!widthObject.isInt() || !heightObject.isInt())
+            {
+                continue;
+            }
+
+            const PDFReal resolution = qMin(PDFReal(widthObject.getInteger()) / size.width(), PDFReal(heightObject.getInteger()) / size.height());
+            if (resolution > m_imageSettings.thresholdResolution && resolution > m_imageSettings.targetResolution)
+            {
+                candidates.emplace_back(placement.first, resolution);
+            }
+        }
+
+        downsampledImages.resize(candidates.size());
+        PDFIntegerRange<size_t> candidateRange(0, candidates.size());
+        auto downsampleImage = [&](size_t index)
+        {
+            const PDFStream* stream = storage.getObjectByReference(candidates[index].first).getStream();
+
+            try
+            {
+                downsampledImages[index] = createDownsampledImage(&document, stream, candidates[index].second);
+            }
+            catch (const PDFException&)
+            {
+                // Image can't be decoded, leave it as it is
+            }
+            catch (const PDFRendererException&)
+            {
+                // Image can't be decoded, leave it as it is
+            }
+        };
+        PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, candidateRange.begin(), candidateRange.end(), downsampleImage);
+    }
+    catch (const PDFException&)
+    {
+        Q_EMIT optimizationProgress(tr("Images can't be downsampled, document is invalid."));
+        return false;
+    }
+
+    PDFInteger counter = 0;
+    PDFInteger bytesSaved = 0;
+
+    PDFObjectStorage::PDFObjects objects = m_storage.getObjects();
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        if (downsampledImages[i].isNull())
+        {
+            continue;
+        }
+
+        PDFObjectStorage::Entry& entry = objects[candidates[i].first.objectNumber];
+        bytesSaved += entry.object.getStream()->getContent()->size() - downsampledImages[i].getStream()->getContent()->size();
+        entry.object = qMove(downsampledImages[i]);
+        ++counter;
+    }
+
+    m_storage.setObjects(qMove(objects));
+    Q_EMIT optimizationProgress(tr("Images downsampled: %1, bytes saved: %2").arg(counter).arg(bytesSaved));
+
+    return false;
+}
+
+PDFObject PDFOptimizer::createDownsampledImage(const PDFDocument* document, const PDFStream* stream, PDFReal resolution) const
+{
+    const PDFObjectStorage& storage = document->getStorage();
+    const PDFDictionary* dictionary = stream->getDictionary();
+
+    if (dictionary->hasKey("F") || dictionary->hasKey("SMaskInData"))
+    {
+        // External file streams and JPEG 2000 images with soft mask
+        // in data are not supported.
+        return PDFObject();
+    }
 
-            const PDFStreamFilter* streamFilter = streamFilters.filterObjects.back();
-            if (dynamic_cast<const PDFFlateDecodeFilter*>(streamFilter))
+    if (storage.getObject(dictionary->get("Mask")).isArray())
+    {
+        // Color key masking works with exact sample values,
+        // which are not preserved by interpolation.
+        return PDFObject();
+    }
+
+    const PDFObject& imageMaskObject = storage.getObject(dictionary->get("ImageMask"));
+    const bool isImageMask = imageMaskObject.isBool() && imageMaskObject.getBool();
+
+    PDFColorSpacePointer colorSpace;
+    if (!isImageMask)
+    {
+        const PDFObject& colorSpaceObject = storage.getObject(dictionary->get("ColorSpace"));
+        if (colorSpaceObject.isNull())
+        {
+            // Color space is defined in JPEG 2000 data
+            return PDFObject();
+        }
+
+        if (colorSpaceObject.isArray() && colorSpaceObject.getArray()->getCount() > 0)
+        {
+            const PDFObject& colorSpaceName = storage.getObject(colorSpaceObject.getArray()->getItem(0));
+            if (colorSpaceName.isName() && colorSpaceName.getString() == COLOR_SPACE_NAME_INDEXED)
             {
-                // Try to recompress. If we end with less data, then we use recompressed stream
-                QByteArray recompressedData = PDFFlateDecodeFilter::recompress(*stream->getContent());
-                const PDFInteger currentBytesSaved = stream->getContent()->size() - recompressedData.size();
-                if (currentBytesSaved > 0)
+                // Samples of indexed images are not colors, they can't be interpolated
+                return PDFObject();
+            }
+        }
+
+        colorSpace = PDFAbstractColorSpace::createColorSpace(nullptr, document, colorSpaceObject);
+    }
+
+    PDFRenderErrorReporterDummy errorReporter;
+    PDFImage image = PDFImage::createImage(document, stream, colorSpace, false, RenderingIntent::Perceptual, &errorReporter);
+    const PDFImageData& imageData = image.getImageData();
+
+    const unsigned int components = imageData.getComponents();
+    const unsigned int bitsPerComponent = imageData.getBitsPerComponent();
+    const unsigned int width = imageData.getWidth();
+    const unsigned int height = imageData.getHeight();
+    const unsigned int stride = imageData.getStride();
+    const QByteArray& data = imageData.getData();
+
+    const bool isBitonalImage = bitsPerComponent == 1 && components == 1;
+    const bool isSupportedImage = isBitonalImage || (bitsPerComponent == 8 && (components == 1 || components == 3));
+    if (!isSupportedImage || width == 0 || height == 0 || data.size() < qsizetype(stride) * qsizetype(height))
+    {
+        return PDFObject();
+    }
+
+    // Convert image samples to QImage, so we can use its smooth scaling
+    QImage sourceImage(int(width), int(height), components == 3 ? QImage::Format_RGB888 : QImage::Format_Grayscale8);
+    bool isBitonal = true;
+    for (unsigned int y = 0; y < height; ++y)
+    {
+        const unsigned char* sourceRow = reinterpret_cast<const unsigned char*>(data.constData()) + size_t(y) * stride;
+        unsigned char* targetRow = sourceImage.scanLine(int(y));
+
+        if (isBitonalImage)
+        {
+            for (unsigned int x = 0; x < width; ++x)
+            {
+                targetRow[x] = (sourceRow[x / 8] & (0x80 >> (x % 8))) ? 0xFF : 0x00;
+            }
+        }
+        else
+        {
+            std::copy(sourceRow, sourceRow + size_t(width) * components, targetRow);
+
+            if (components == 1 && isBitonal)
+            {
+                isBitonal = std::all_of(sourceRow, sourceRow + width, [](unsigned char value) { return value == 0x00 || value == 0xFF; });
+            }
+        }
+    }
+    isBitonal = isBitonal && components == 1;
+
+    const PDFReal scale = m_imageSettings.targetResolution / resolution;
+    const int targetWidth = qMax(1, qRound(width * scale));
+    const int targetHeight = qMax(1, qRound(height * scale));
+    QImage targetImage = sourceImage.scaled(targetWidth, targetHeight, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+
+    QByteArray filterName;
+    PDFObject filters = storage.getObject(dictionary->get(PDF_STREAM_DICT_FILTER));
+    if (filters.isArray() && filters.getArray()->getCount() > 0)
+    {
+        filters = storage.getObject(filters.getArray()->getItem(filters.getArray()->getCount() - 1));
+    }
+    if (filters.isName())
+    {
+        filterName = filters.getString();
+    }
+
+    QByteArray targetData;
+    QByteArray targetFilter;
+    PDFInteger targetBitsPerComponent = 8;
+
+    if (isBitonal)
+    {
+        // Bitonal images stay bitonal, so they are thresholded and stored as 1 bit image
+        const int targetStride = (targetWidth + 7) / 8;
+        QByteArray samples(targetStride * targetHeight, 0);
+        for (int y = 0; y < targetHeight; ++y)
+        {
+            const unsigned char* sourceRow = targetImage.constScanLine(y);
+            unsigned char* targetRow = reinterpret_cast<unsigned char*>(samples.data()) + y * targetStride;
+            for (int x = 0; x < targetWidth; ++x)
+            {
+                if (sourceRow[x] >= 0x80)
                 {
-                    bytesSaved += currentBytesSaved;
-                    PDFDictionary updatedDictionary = *dictionary;
-                    updatedDictionary.setEntry(PDFInplaceOrMemoryString("Length"), PDFObject::createInteger(recompressedData.size()));
-                    entry.object = PDFObject::createStream(std::make_shared<PDFStream>(qMove(updatedDictionary), qMove(recompressedData)));
+                    targetRow[x / 8] |= (0x80 >> (x % 8));
                 }
             }
         }
+
+        targetData = PDFFlateDecodeFilter::compress(samples);
+        targetFilter = "FlateDecode";
+        targetBitsPerComponent = 1;
+    }
+    else if (filterName == "DCTDecode" || filterName == "DCT" || filterName == "JPXDecode")
+    {
+        // Image was already compressed lossy, so we can use lossy compression too
+        QBuffer buffer(&targetData);
+        buffer.open(QBuffer::WriteOnly);
+
+        QImageWriter writer(&buffer, "jpg");
+        writer.setQuality(m_imageSettings.jpegQuality);
+        if (!writer.write(targetImage))
+        {
+            return PDFObject();
+        }
+
+        buffer.close();
+        targetFilter = "DCTDecode";
+    }
+    else
+    {
+        const int targetStride = targetWidth * int(components);
+        QByteArray samples;
+        samples.reserve(targetStride * targetHeight);
+        for (int y = 0; y < targetHeight; ++y)
+        {
+            samples.append(reinterpret_cast<const char*>(targetImage.constScanLine(y)), targetStride);
+        }
+
+        targetData = PDFFlateDecodeFilter::compress(samples);
+        targetFilter = "FlateDecode";
+    }
+
+    if (targetData.isEmpty() || targetData.size() >= stream->getContent()->size())
+    {
+        return PDFObject();
+    }
+
+    PDFDictionary targetDictionary = *dictionary;
+    targetDictionary.setEntry(PDFInplaceOrMemoryString("Width"), PDFObject::createInteger(targetWidth));
+    targetDictionary.setEntry(PDFInplaceOrMemoryString("Height"), PDFObject::createInteger(targetHeight));
+    if (!isImageMask || dictionary->hasKey("BitsPerComponent"))
+    {
+        targetDictionary.setEntry(PDFInplaceOrMemoryString("BitsPerComponent"), PDFObject::createInteger(targetBitsPerComponent));
+    }
+    targetDictionary.setEntry(PDFInplaceOrMemoryString(PDF_STREAM_DICT_FILTER), PDFObject::createName(targetFilter));
+    targetDictionary.setEntry(PDFInplaceOrMemoryString(PDF_STREAM_DICT_LENGTH), PDFObject::createInteger(targetData.size()));
+    targetDictionary.removeEntry(PDF_STREAM_DICT_DECODE_PARMS);
+
+    return PDFObject::createStream(std::make_shared<PDFStream>(qMove(targetDictionary), qMove(targetData)));
+}
+
+bool PDFOptimizer::performSubsetFonts()
+{
+    // Font program (FontFile2 / FontFile3 stream) with fonts, which are using it
+    struct FontProgram
+    {
+        bool isCFF = false;
+        bool isSafe = true;
+        std::vector<size_t> fonts;
+        std::set<PDFObjectReference> owners;
+        std::set<GID> glyphs;
+        PDFObject subsettedProgram;
+        QByteArray subsetTag;
     };
 
-    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, objects.begin(), objects.end(), processEntry);
+    // Font dictionary with indirect objects between font dictionary and font program
+    struct Font
+    {
+        PDFObjectReference reference;
+        PDFObjectReference program;
+        std::vector<PDFObjectReference> chain;
+        std::set<CID> usedCharacters;
+        PDFFontPointer font;
+    };
+
+    std::vector<Font> fonts;
+    std::map<PDFObjectReference, FontProgram> programs;
+
+    try
+    {
+        PDFDocument document(PDFObjectStorage(m_storage), PDFVersion(2, 0), QByteArray());
+        const PDFObjectStorage& storage = document.getStorage();
+        const PDFObjectStorage::PDFObjects& objects = storage.getObjects();
+
+        auto getName = [&storage](const PDFDictionary* dictionary, const char* key)
+        {
+            const PDFObject& object = storage.getObject(dictionary->get(key));
+            return object.isName() ? object.getString() : QByteArray();
+        };
+
+        // Find fonts with embedded TrueType or CID-keyed CFF font programs
+        for (size_t i = 0; i < objects.size(); ++i)
+        {
+            const PDFObject& object = objects[i].object;
+            if (!object.isDictionary())
+            {
+                continue;
+            }
+
+            const PDFDictionary* fontDictionary = object.getDictionary();
+            if (getName(fontDictionary, "Type") != "Font")
+            {
+                continue;
+            }
+
+            Font font;
+            font.reference = PDFObjectReference(PDFInteger(i), objects[i].generation);
+
+            bool isCFF = false;
+            const QByteArray subtype = getName(fontDictionary, "Subtype");
+            if (subtype == "Type0")
+            {
+                const PDFObject& descendantFonts = storage.getObject(fontDictionary->get("DescendantFonts"));
+                if (!descendantFonts.isArray() || descendantFonts.getArray()->getCount() != 1)
+                {
+                    continue;
+                }
+
+                const PDFObject& descendantFont = descendantFonts.getArray()->getItem(0);
+                if (descendantFont.isReference())
+                {
+                    font.chain.push_back(descendantFont.getReference());
+                }
+
+                fontDictionary = storage.getDictionaryFromObject(storage.getObject(descendantFont));
+                if (!fontDictionary)
+                {
+                    continue;
+                }
+
+                const QByteArray descendantSubtype = getName(fontDictionary, "Subtype");
+                if (descendantSubtype == "CIDFontType0")
+                {
+                    isCFF = true;
+                }
+                else if (descendantSubtype != "CIDFontType2")
+                {
+                    continue;
+                }
+            }
+            else if (subtype != "TrueType")
+            {
+                continue;
+            }
+
+            const PDFObject& fontDescriptor = fontDictionary->get("FontDescriptor");
+            if (fontDescriptor.isReference())
+            {
+                font.chain.push_back(fontDescriptor.getReference());
+            }
+
+            const PDFDictionary* fontDescriptorDictionary = storage.getDictionaryFromObject(storage.getObject(fontDescriptor));
+            if (!fontDescriptorDictionary)
+            {
+                continue;
+            }
+
+            const PDFObject& fontFile = fontDescriptorDictionary->get(isCFF ? "FontFile3" : "FontFile2");
+            const PDFObject& fontFileStream = storage.getObject(fontFile);
+            if (!fontFile.isReference() || !fontFileStream.isStream())
+            {
+                continue;
+            }
+
+            if (isCFF && getName(fontFileStream.getStream()->getDictionary(), "Subtype") != "CIDFontType0C")
+            {
+                // OpenType font programs are not supported
+                continue;
+            }
+
+            font.program = fontFile.getReference();
+
+            FontProgram& program = programs[font.program];
+            program.isCFF = isCFF;
+            program.fonts.push_back(fonts.size());
+            program.owners.insert(font.reference);
+            program.owners.insert(font.chain.cbegin(), font.chain.cend());
+            fonts.emplace_back(qMove(font));
+        }
+
+        if (programs.empty())
+        {
+            Q_EMIT optimizationProgress(tr("Fonts subsetted: %1").arg(0));
+            return false;
+        }
+
+        // Font program can be subsetted only, if we know all its users. So font program,
+        // and all objects between the font program and font dictionaries, must be
+        // referenced only by these objects. Font dictionaries can be referenced from anywhere.
+        std::map<PDFObjectReference, std::vector<PDFObjectReference>> watchedObjects;
+        for (const auto& programItem : programs)
+        {
+            watchedObjects[programItem.first].push_back(programItem.first);
+        }
+        for (const Font& font : fonts)
+        {
+            for (const PDFObjectReference& reference : font.chain)
+            {
+                watchedObjects[reference].push_back(font.program);
+            }
+        }
+
+        QMutex mutex;
+        std::set<PDFObjectReference> unsafePrograms;
+        auto checkReferrer = [&](PDFObjectReference referrer, const PDFObject& object)
+        {
+            for (const PDFObjectReference& reference : PDFObjectUtils::getDirectReferences(object))
+            {
+                auto it = watchedObjects.find(reference);
+                if (it == watchedObjects.cend())
+                {
+                    continue;
+                }
+
+                for (const PDFObjectReference& programReference : it->second)
+                {
+                    if (!programs.at(programReference).owners.count(referrer))
+                    {
+                        QMutexLocker lock(&mutex);
+                        unsafePrograms.insert(programReference);
+                    }
+                }
+            }
+        };
+
+        PDFIntegerRange<size_t> objectRange(0, objects.size());
+        auto checkObject = [&](size_t index)
+        {
+            if (!objects[index].object.isNull())
+            {
+                checkReferrer(PDFObjectReference(PDFInteger(index), objects[index].generation), objects[index].object);
+            }
+        };
+        PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, objectRange.begin(), objectRange.end(), checkObject);
+        checkReferrer(PDFObjectReference(), storage.getTrailerDictionary());
+
+        // Fonts of interactive form can be used to create new appearance streams
+        // with arbitrary text, so we can't subset them.
+        const PDFCatalog* catalog = document.getCatalog();
+        const PDFDictionary* trailerDictionary = document.getTrailerDictionary();
+        if (const PDFDictionary* catalogDictionary = trailerDictionary ? document.getDictionaryFromObject(trailerDictionary->get("Root")) : nullptr)
+        {
+            const PDFDictionary* acroFormDictionary = storage.getDictionaryFromObject(catalogDictionary->get("AcroForm"));
+            const PDFDictionary* resourcesDictionary = acroFormDictionary ? storage.getDictionaryFromObject(acroFormDictionary->get("DR")) : nullptr;
+            const PDFDictionary* fontsDictionary = resourcesDictionary ? storage.getDictionaryFromObject(resourcesDictionary->get("Font")) : nullptr;
+
+            if (fontsDictionary)
+            {
+                for (size_t i = 0; i < fontsDictionary->getCount(); ++i)
+                {
+                    const PDFObject& fontObject = fontsDictionary->getValue(i);
+                    for (const Font& font : fonts)
+                    {
+                        if (fontObject.isReference() && fontObject.getReference() == font.reference)
+                        {
+                            unsafePrograms.insert(font.program);
+                        }
+                    }
+                }
+            }
+        }
+
+        for (const PDFObjectReference& reference : unsafePrograms)
+        {
+            programs[reference].isSafe = false;
+        }
+
+        // Load fonts through the font cache, so same fonts are used, when page content is processed
+        PDFFontCache fontCache(DEFAULT_FONT_CACHE_LIMIT, DEFAULT_REALIZED_FONT_CACHE_LIMIT);
+        PDFCMSGeneric cms;
+        PDFMeshQualitySettings mqs;
+        PDFOptionalContentActivity oca(&document, OCUsage::Export, nullptr);
+        PDFModifiedDocument md(&document, &oca);
+        fontCache.setDocument(md);
+        fontCache.setCacheShrinkEnabled(nullptr, false);
+
+        std::map<const PDFFont*, size_t> fontIndices;
+        PDFRenderErrorReporterDummy errorReporter;
+        for (size_t i = 0; i < fonts.size(); ++i)
+        {
+            Font& font = fonts[i];
+            FontProgram& program = programs[font.program];
+            if (!program.isSafe)
+            {
+                continue;
+            }
+
+            try
+            {
+                // Font, which we can't realize, can't be processed, so we can't determine used glyphs
+                font.font = fontCache.getFont(PDFObject::createReference(font.reference), QByteArray());
+                if (!font.font || !PDFRealizedFont::createRealizedFont(font.font, 12.0, &errorReporter))
+                {
+                    program.isSafe = false;
+                    continue;
+                }
+                fontIndices[font.font.get()] = i;
+            }
+            catch (const PDFException&)
+            {
+                program.isSafe = false;
+            }
+            catch (const PDFRendererException&)
+            {
+                program.isSafe = false;
+            }
+        }
+
+        if (!fontIndices.empty())
+        {
+            PDFIntegerRange<size_t> pageRange(0, catalog->getPageCount());
+            auto collectUsedCharacters = [&](size_t pageIndex)
+            {
+                const PDFPage* page = catalog->getPage(pageIndex);
+                Q_ASSERT(page);
+
+                PDFFontUsageCollector collector(page, &document, &fontCache, &cms, &oca, mqs, &fontIndices);
+                collector.processContents();
+                collector.processAnnotationsAndSoftMasks();
+
+                QMutexLocker lock(&mutex);
+                for (const auto& usedCharacters : collector.getUsedCharacters())
+                {
+                    fonts[usedCharacters.first].usedCharacters.insert(usedCharacters.second.cbegin(), usedCharacters.second.cend());
+                }
+            };
+            PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, pageRange.begin(), pageRange.end(), collectUsedCharacters);
+        }
+
+        fontCache.setCacheShrinkEnabled(nullptr, true);
+
+        // Map used characters to glyphs
+        for (const Font& font : fonts)
+        {
+            FontProgram& program = programs[font.program];
+            if (!program.isSafe)
+            {
+                continue;
+            }
+
+            if (const PDFSimpleFont* simpleFont = dynamic_cast<const PDFSimpleFont*>(font.font.get()))
+            {
+                const GlyphIndices* glyphIndices = simpleFont->getGlyphIndices();
+                for (CID code : font.usedCharacters)
+                {
+                    const GID glyph = code < glyphIndices->size() ? (*glyphIndices)[code] : GID();
+                    if (!glyph)
+                    {
+                        // Glyph is found by other means (for example, by unicode
+                        // mapping), so we can't be sure, which glyph is used.
+                        program.isSafe = false;
+                        break;
+                    }
+                    program.glyphs.insert(glyph);
+                }
+            }
+            else if (const PDFType0Font* compositeFont = dynamic_cast<const PDFType0Font*>(font.font.get()))
+            {
+                for (CID cid : font.usedCharacters)
+                {
+                    // CID-keyed CFF fonts are subsetted by CIDs (glyphs are mapped by charset of the font)
+                    program.glyphs.insert(program.isCFF ? cid : compositeFont->getCIDtoGIDMapper()->map(cid));
+                }
+            }
+            else
+            {
+                program.isSafe = false;
+            }
+        }
+
+        // Create subsets of font programs
+        std::vector<FontProgram*> subsettedPrograms;
+        std::vector<const PDFStream*> subsettedStreams;
+        for (auto& programItem : programs)
+        {
+            if (programItem.second.isSafe)
+            {
+                subsettedPrograms.push_back(&programItem.second);
+                subsettedStreams.push_back(storage.getObjectByReference(programItem.first).getStream());
+            }
+        }
+
+        PDFIntegerRange<size_t> programRange(0, subsettedPrograms.size());
+        auto subsetProgram = [&](size_t index)
+        {
+            FontProgram* program = subsettedPrograms[index];
+            const PDFStream* stream = subsettedStreams[index];
+
+            try
+            {
+                const QByteArray fontData = document.getDecodedStream(stream);
+                QByteArray subsetData = program->isCFF ? PDFFontSubsetter::createCIDKeyedCFFSubset(fontData, program->glyphs)
+                                                       : PDFFontSubsetter::createTrueTypeSubset(fontData, program->glyphs);
+                if (subsetData.isEmpty())
+                {
+                    return;
+                }
+
+                QByteArray compressedData = PDFFlateDecodeFilter::compress(subsetData);
+                if (compressedData.size() >= stream->getContent()->size())
+                {
+                    return;
+                }
+
+                PDFDictionary dictionary = *stream->getDictionary();
+                dictionary.removeEntry(PDF_STREAM_DICT_DECODE_PARMS);
+                dictionary.removeEntry(PDF_STREAM_DICT_DECODED_LENGTH);
+                dictionary.setEntry(PDFInplaceOrMemoryString(PDF_STREAM_DICT_FILTER), PDFObject::createName("FlateDecode"));
+                dictionary.setEntry(PDFInplaceOrMemoryString(PDF_STREAM_DICT_LENGTH), PDFObject::createInteger(compressedData.size()));
+                if (!program->isCFF)
+                {
+                    dictionary.setEntry(PDFInplaceOrMemoryString("Length1"), PDFObject::createInteger(subsetData.size()));
+                }
+
+                program->subsetTag = PDFFontSubsetter::createSubsetTag(subsetData);
+                program->subsettedProgram = PDFObject::createStream(std::make_shared<PDFStream>(qMove(dictionary), qMove(compressedData)));
+            }
+            catch (const PDFException&)
+            {
+                // Font program can't be decoded, leave it as it is
+            }
+        };
+        PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, programRange.begin(), programRange.end(), subsetProgram);
+    }
+    catch (const PDFException&)
+    {
+        Q_EMIT optimizationProgress(tr("Fonts can't be subsetted, document is invalid."));
+        return false;
+    }
+
+    PDFInteger counter = 0;
+    PDFInteger bytesSaved = 0;
+    PDFObjectStorage::PDFObjects objects = m_storage.getObjects();
+
+    // Subsetted fonts should have names prefixed by the subset tag
+    auto addSubsetTag = [this](const PDFObject& object, const char* key, const QByteArray& tag)
+    {
+        if (!object.isDictionary())
+        {
+            return object;
+        }
+
+        const PDFDictionary* dictionary = object.getDictionary();
+
+        const PDFObject& nameObject = m_storage.getObject(dictionary->get(key));
+        if (!nameObject.isName() || PDFFontSubsetter::hasSubsetTag(nameObject.getString()))
+        {
+            return object;
+        }
+
+        PDFDictionary updatedDictionary = *dictionary;
+        updatedDictionary.setEntry(PDFInplaceOrMemoryString(key), PDFObject::createName(tag + "+" + nameObject.getString()));
+        return PDFObject::createDictionary(std::make_shared<PDFDictionary>(qMove(updatedDictionary)));
+    };
+
+    // Updates font descriptor (direct or indirect) of font dictionary
+    auto updateFontDescriptor = [&](const PDFObject& fontObject, const QByteArray& tag)
+    {
+        PDFObject updatedFontObject = addSubsetTag(fontObject, "BaseFont", tag);
+        const PDFDictionary* fontDictionary = updatedFontObject.isDictionary() ? updatedFontObject.getDictionary() : nullptr;
+        if (!fontDictionary)
+        {
+            return updatedFontObject;
+        }
+
+        const PDFObject& fontDescriptor = fontDictionary->get("FontDescriptor");
+        if (fontDescriptor.isReference())
+        {
+            PDFObjectStorage::Entry& entry = objects[fontDescriptor.getReference().objectNumber];
+            entry.object = addSubsetTag(entry.object, "FontName", tag);
+        }
+        else if (fontDescriptor.isDictionary())
+        {
+            PDFDictionary updatedFontDictionary = *fontDictionary;
+            updatedFontDictionary.setEntry(PDFInplaceOrMemoryString("FontDescriptor"), addSubsetTag(fontDescriptor, "FontName", tag));
+            updatedFontObject = PDFObject::createDictionary(std::make_shared<PDFDictionary>(qMove(updatedFontDictionary)));
+        }
+
+        return updatedFontObject;
+    };
+
+    for (auto& programItem : programs)
+    {
+        FontProgram& program = programItem.second;
+        if (program.subsettedProgram.isNull())
+        {
+            continue;
+        }
+
+        PDFObjectStorage::Entry& programEntry = objects[programItem.first.objectNumber];
+        bytesSaved += programEntry.object.getStream()->getContent()->size() - program.subsettedProgram.getStream()->getContent()->size();
+        programEntry.object = qMove(program.subsettedProgram);
+        ++counter;
+
+        for (size_t fontIndex : program.fonts)
+        {
+            PDFObjectStorage::Entry& fontEntry = objects[fonts[fontIndex].reference.objectNumber];
+            PDFObject fontObject = fontEntry.object;
+
+            if (m_storage.getObject(fontObject.getDictionary()->get("Subtype")).getString() == "Type0")
+            {
+                fontObject = addSubsetTag(fontObject, "BaseFont", program.subsetTag);
+
+                const PDFObject& descendantFonts = fontObject.getDictionary()->get("DescendantFonts");
+                const PDFArray* descendantFontsArray = m_storage.getObject(descendantFonts).getArray();
+                const PDFObject& descendantFont = descendantFontsArray->getItem(0);
+
+                if (descendantFont.isReference())
+                {
+                    PDFObjectStorage::Entry& descendantFontEntry = objects[descendantFont.getReference().objectNumber];
+                    descendantFontEntry.object = updateFontDescriptor(descendantFontEntry.object, program.subsetTag);
+                }
+                else if (descendantFonts.isArray())
+                {
+                    PDFArray updatedDescendantFonts;
+                    updatedDescendantFonts.appendItem(updateFontDescriptor(descendantFont, program.subsetTag));
+
+                    PDFDictionary updatedFontDictionary = *fontObject.getDictionary();
+                    updatedFontDictionary.setEntry(PDFInplaceOrMemoryString("DescendantFonts"), PDFObject::createArray(std::make_shared<PDFArray>(qMove(updatedDescendantFonts))));
+                    fontObject = PDFObject::createDictionary(std::make_shared<PDFDictionary>(qMove(updatedFontDictionary)));
+                }
+            }
+            else
+            {
+                fontObject = updateFontDescriptor(fontObject, program.subsetTag);
+            }
+
+            fontEntry.object = qMove(fontObject);
+        }
+    }
+
     m_storage.setObjects(qMove(objects));
-    Q_EMIT optimizationProgress(tr("Bytes saved by recompressing stream: %1").arg(bytesSaved.load()));
+    Q_EMIT optimizationProgress(tr("Fonts subsetted: %1, bytes saved: %2").arg(counter).arg(bytesSaved));
 
     return false;
 }
@@ -24,6 +24,7 @@
 #define PDFOPTIMIZER_H
 
 #include "pdfdocument.h"
+#include "pdfstreamingdocumentwriter.h"
 
 #include <QObject>
 
@@ -49,10 +50,22 @@ public:
         MergeIdenticalObjects       = 0x0008, ///< Merge identical objects
         ShrinkObjectStorage         = 0x0010, ///< Shrink object storage, so unused objects are filled with used (and generation number increased)
         RecompressFlateStreams      = 0x0020, ///< Flate streams are recompressed with maximal compression
-        All                         = 0xFFFF, ///< All optimizations turned on
+        DownsampleImages            = 0x0040, ///< Images with too high resolution are downsampled and recompressed (lossy)
+        SubsetFonts                 = 0x0080, ///< Embedded TrueType and CID-keyed CFF fonts are reduced to used glyphs
+        All                         = 0x003F, ///< All lossless optimizations turned on (images are not downsampled, fonts are not subsetted)
     };
     Q_DECLARE_FLAGS(OptimizationFlags, OptimizationFlag)
 
+    /// Settings of image downsampling. Resolution of the image is determined by
+    /// its largest placement on document pages; images, which are not placed
+    /// on any page (or are used only as masks), are not changed.
+    struct ImageSettings
+    {
+        PDFReal targetResolution = 150.0;       ///< Resolution of downsampled images (in DPI)
+        PDFReal thresholdResolution = 225.0;    ///< Only images with higher resolution are downsampled (in DPI)
+        int jpegQuality = 80;                   ///< Quality of JPEG compression (0-100)
+    };
+
     explicit PDFOptimizer(OptimizationFlags flags, QObject* parent);
 
     /// Set document, which should be optimalized
@@ -67,6 +80,20 @@ public:
     /// signals are emitted to view progress.
     void optimize();
 
+    /// Performs optimization of the document stored in the file, without loading
+    /// the whole document into the memory, and writes optimized document to the
+    /// output device. Document is opened with lazy object loading and it is processed
+    /// in two passes. First pass reads objects one by one and keeps only their
+    /// references and hashes, second pass reads them again and writes them to the output,
+    /// with dereferencing, merging and recompression applied per object. Memory consumption
+    /// depends on the count of objects, not on their size. Objects are always renumbered
+    /// (storage is shrinked). Image downsampling and font subsetting are not supported
+    /// in this mode, they are skipped. Output document is not encrypted.
+    /// \param fileName File name of the source document
+    /// \param device Output device
+    /// \param mode Writing mode of the output document
+    PDFOperationResult optimizeStreaming(const QString& fileName, QIODevice* device, PDFStreamingDocumentWriter::Mode mode);
+
     /// Returns object storage used for optimization
     const PDFObjectStorage& getStorage() const { return m_storage; }
 
@@ -80,6 +107,9 @@ public:
     OptimizationFlags getFlags() const;
     void setFlags(OptimizationFlags flags);
 
+    const ImageSettings& getImageSettings() const { return m_imageSettings; }
+    void setImageSettings(const ImageSettings& imageSettings) { m_imageSettings = imageSettings; }
+
 signals:
     void optimizationStarted();
     void optimizationProgress(QString progressText);
@@ -92,8 +122,18 @@ private:
     bool performMergeIdenticalObjects();
     bool performShrinkObjectStorage();
     bool performRecompressFlateStreams();
+    bool performDownsampleImages();
+    bool performSubsetFonts();
+
+    /// Downsamples image to the given resolution. If image can't be downsampled,
+    /// or downsampled image is not smaller, then null object is returned.
+    /// \param document Document
+    /// \param stream Image stream
+    /// \param resolution Current resolution of the image at its largest placement
+    PDFObject createDownsampledImage(const PDFDocument* document, const PDFStream* stream, PDFReal resolution) const;
 
     OptimizationFlags m_flags;
+    ImageSettings m_imageSettings;
     PDFObjectStorage m_storage;
 };
 
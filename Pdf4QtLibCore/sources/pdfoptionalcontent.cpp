@@ -386,7 +386,75 @@ void PDFOptionalContentActivity::setDocument(const PDFDocument* document)
         Q_ASSERT(document);
         m_document = document;
         m_properties = document->getCatalog()->getOptionalContentProperties();
+
+        QMutexLocker lock(&m_membershipObjectsMutex);
+        m_membershipObjects.clear();
+        advanceGeneration();
+    }
+}
+
+bool PDFOptionalContentActivity::isSuppressed(PDFObjectReference ocgOrOcmd) const
+{
+    if (m_properties && m_properties->hasOptionalContentGroup(ocgOrOcmd))
+    {
+        // Simplest case - we have single optional content group
+        return getState(ocgOrOcmd) == OCState::OFF;
+    }
+
+    // Generation must be read before states are evaluated, so if states
+    // are changed during evaluation, result is not used in the new generation.
+    const quint64 generation = getGeneration();
+    std::shared_ptr<const PDFOptionalContentMembershipObject> membershipObject;
+
+    {
+        QMutexLocker lock(&m_membershipObjectsMutex);
+        auto it = m_membershipObjects.find(ocgOrOcmd);
+        if (it == m_membershipObjects.cend())
+        {
+            try
+            {
+                auto ocmd = std::make_shared<PDFOptionalContentMembershipObject>(PDFOptionalContentMembershipObject::create(m_document, PDFObject::createReference(ocgOrOcmd)));
+                if (ocmd->isValid())
+                {
+                    membershipObject = qMove(ocmd);
+                }
+            }
+            catch (const PDFException&)
+            {
+                // Invalid membership dictionary, content is not suppressed
+            }
+
+            // Invalid membership dictionaries are also stored, so they are not parsed again
+            it = m_membershipObjects.emplace(ocgOrOcmd, MembershipObjectEntry{ qMove(membershipObject), 0, false }).first;
+        }
+
+        const MembershipObjectEntry& entry = it->second;
+        if (!entry.membershipObject)
+        {
+            return false;
+        }
+
+        if (entry.generation == generation)
+        {
+            return entry.isSuppressed;
+        }
+
+        membershipObject = entry.membershipObject;
     }
+
+    const bool isSuppressed = membershipObject->evaluate(this) == OCState::OFF;
+
+    {
+        QMutexLocker lock(&m_membershipObjectsMutex);
+        auto it = m_membershipObjects.find(ocgOrOcmd);
+        if (it != m_membershipObjects.cend() && it->second.membershipObject == membershipObject)
+        {
+            it->second.generation = generation;
+            it->second.isSuppressed = isSuppressed;
+        }
+    }
+
+    return isSuppressed;
 }
 
 void PDFOptionalContentActivity::setState(PDFObjectReference ocg, OCState state, bool preserveRadioButtons)
@@ -411,6 +479,7 @@ void PDFOptionalContentActivity::setState(PDFObjectReference ocg, OCState state,
         }
 
         it->second = state;
+        advanceGeneration();
         Q_EMIT optionalContentGroupStateChanged(ocg, state);
     }
 }
@@ -469,6 +538,9 @@ void PDFOptionalContentActivity::applyConfiguration(const PDFOptionalContentConf
             }
         }
     }
+
+    // States are changed, cached visibility of membership dictionaries is not valid now
+    advanceGeneration();
 }
 
 PDFOptionalContentMembershipObject PDFOptionalContentMembershipObject::create(const PDFDocument* document, const PDFObject& object)
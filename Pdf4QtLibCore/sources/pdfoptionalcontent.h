@@ -25,6 +25,12 @@
 
 #include "pdfobject.h"
 
+#include <QMutex>
+
+#include <map>
+#include <atomic>
+#include <memory>
+
 namespace pdf
 {
 
@@ -194,6 +200,20 @@ public:
     /// Returns the properties of optional content
     const PDFOptionalContentProperties* getProperties() const { return m_properties; }
 
+    /// Returns true, if content belonging to the optional content group or optional
+    /// content membership dictionary is suppressed (i.e. it is turned off). Membership
+    /// dictionaries are parsed only once, and their visibility is evaluated only once
+    /// for each generation of the states. If the object is neither valid optional content
+    /// group, nor valid membership dictionary, then content is not suppressed.
+    /// This function is thread safe.
+    /// \param ocgOrOcmd Optional content group or membership dictionary
+    bool isSuppressed(PDFObjectReference ocgOrOcmd) const;
+
+    /// Returns generation of the optional content group states. Generation
+    /// is changed each time any state is changed (or document is changed),
+    /// so it can be used to invalidate cached visibility.
+    quint64 getGeneration() const { return m_generation.load(std::memory_order_acquire); }
+
 signals:
     void optionalContentGroupStateChanged(PDFObjectReference ocg, OCState state);
 
@@ -202,6 +222,23 @@ private:
     const PDFOptionalContentProperties* m_properties;
     OCUsage m_usage;
     std::map<PDFObjectReference, OCState> m_states;
+
+    /// Advances generation of the states
+    void advanceGeneration() { m_generation.fetch_add(1, std::memory_order_acq_rel); }
+
+    /// Parsed membership dictionary, together with the visibility evaluated
+    /// in the given generation of the states
+    struct MembershipObjectEntry
+    {
+        std::shared_ptr<const PDFOptionalContentMembershipObject> membershipObject;
+        quint64 generation = 0;
+        bool isSuppressed = false;
+    };
+
+    std::atomic<quint64> m_generation = 1;
+
+    mutable QMutex m_membershipObjectsMutex;
+    mutable std::map<PDFObjectReference, MembershipObjectEntry> m_membershipObjects;
 };
 
 /// Configuration of optional content configuration.
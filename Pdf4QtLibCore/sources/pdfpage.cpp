@@ -26,6 +26,8 @@
 #include "pdfencoding.h"
 #include "pdfdbgheap.h"
 
+#include <algorithm>
+
 namespace pdf
 {
 
@@ -247,6 +249,58 @@ QRectF PDFPage::getRotatedBox(const QRectF& rect, PageRotation rotation)
     return rect;
 }
 
+PDFPage PDFPage::createPage(const PDFObjectStorage* storage,
+                            const PDFPageInheritableAttributes& attributes,
+                            const PDFObject& pageObject,
+                            PDFObjectReference reference)
+{
+    const PDFDictionary* dictionary = pageObject.getDictionary();
+
+    PDFPage page;
+
+    page.m_pageObject = pageObject;
+    page.m_pageReference = reference;
+    page.m_mediaBox = attributes.getMediaBox();
+    page.m_cropBox = attributes.getCropBox();
+    page.m_resources = storage->getObject(attributes.getResources());
+    page.m_pageRotation = attributes.getPageRotation();
+
+    if (!page.m_cropBox.isValid())
+    {
+        page.m_cropBox = page.m_mediaBox;
+    }
+
+    PDFDocumentDataLoaderDecorator loader(storage);
+    page.m_bleedBox = loader.readRectangle(dictionary->get("BleedBox"), page.getCropBox());
+    page.m_trimBox = loader.readRectangle(dictionary->get("TrimBox"), page.getCropBox());
+    page.m_artBox = loader.readRectangle(dictionary->get("ArtBox"), page.getCropBox());
+    page.m_contents = storage->getObject(dictionary->get("Contents"));
+    page.m_annots = loader.readReferenceArrayFromDictionary(dictionary, "Annots");
+    page.m_lastModified = PDFEncoding::convertToDateTime(loader.readStringFromDictionary(dictionary, "LastModified"));
+    page.m_thumbnailReference = loader.readReferenceFromDictionary(dictionary, "Thumb");
+    page.m_beads = loader.readReferenceArrayFromDictionary(dictionary, "B");
+    page.m_duration = loader.readIntegerFromDictionary(dictionary, "Dur", 0);
+    page.m_structParent = loader.readIntegerFromDictionary(dictionary, "StructParents", 0);
+    page.m_webCaptureContentSetId = loader.readStringFromDictionary(dictionary, "ID");
+    page.m_preferredZoom = loader.readNumberFromDictionary(dictionary, "PZ", 0.0);
+
+    constexpr const std::array<std::pair<const char*, PageTabOrder>, 5> tabStops =
+    {
+        std::pair<const char*, PageTabOrder>{ "R", PageTabOrder::Row },
+        std::pair<const char*, PageTabOrder>{ "C", PageTabOrder::Column },
+        std::pair<const char*, PageTabOrder>{ "S", PageTabOrder::Structure },
+        std::pair<const char*, PageTabOrder>{ "A", PageTabOrder::Array },
+        std::pair<const char*, PageTabOrder>{ "W", PageTabOrder::Widget }
+    };
+
+    page.m_pageTabOrder = loader.readEnumByName(dictionary->get("Tabs"), tabStops.cbegin(), tabStops.cend(), PageTabOrder::Invalid);
+    page.m_templateName = loader.readNameFromDictionary(dictionary, "TemplateInstantiated");
+    page.m_userUnit = loader.readNumberFromDictionary(dictionary, "UserUnit", 1.0);
+    page.m_documentPart = loader.readReferenceFromDictionary(dictionary, "DPart");
+
+    return page;
+}
+
 void PDFPage::parseImpl(std::vector<PDFPage>& pages,
                         std::set<PDFObjectReference>& visitedReferences,
                         const PDFPageInheritableAttributes& templateAttributes,
@@ -301,49 +355,7 @@ void PDFPage::parseImpl(std::vector<PDFPage>& pages,
             }
             else if (typeString == "Page")
             {
-                PDFPage page;
-
-                page.m_pageObject = dereferenced;
-                page.m_pageReference = objectReference;
-                page.m_mediaBox = currentInheritableAttributes.getMediaBox();
-                page.m_cropBox = currentInheritableAttributes.getCropBox();
-                page.m_resources = storage->getObject(currentInheritableAttributes.getResources());
-                page.m_pageRotation = currentInheritableAttributes.getPageRotation();
-
-                if (!page.m_cropBox.isValid())
-                {
-                    page.m_cropBox = page.m_mediaBox;
-                }
-
-                PDFDocumentDataLoaderDecorator loader(storage);
-                page.m_bleedBox = loader.readRectangle(dictionary->get("BleedBox"), page.getCropBox());
-                page.m_trimBox = loader.readRectangle(dictionary->get("TrimBox"), page.getCropBox());
-                page.m_artBox = loader.readRectangle(dictionary->get("ArtBox"), page.getCropBox());
-                page.m_contents = storage->getObject(dictionary->get("Contents"));
-                page.m_annots = loader.readReferenceArrayFromDictionary(dictionary, "Annots");
-                page.m_lastModified = PDFEncoding::convertToDateTime(loader.readStringFromDictionary(dictionary, "LastModified"));
-                page.m_thumbnailReference = loader.readReferenceFromDictionary(dictionary, "Thumb");
-                page.m_beads = loader.readReferenceArrayFromDictionary(dictionary, "B");
-                page.m_duration = loader.readIntegerFromDictionary(dictionary, "Dur", 0);
-                page.m_structParent = loader.readIntegerFromDictionary(dictionary, "StructParents", 0);
-                page.m_webCaptureContentSetId = loader.readStringFromDictionary(dictionary, "ID");
-                page.m_preferredZoom = loader.readNumberFromDictionary(dictionary, "PZ", 0.0);
-
-                constexpr const std::array<std::pair<const char*, PageTabOrder>, 5> tabStops =
-                {
-                    std::pair<const char*, PageTabOrder>{ "R", PageTabOrder::Row },
-                    std::pair<const char*, PageTabOrder>{ "C", PageTabOrder::Column },
-                    std::pair<const char*, PageTabOrder>{ "S", PageTabOrder::Structure },
-                    std::pair<const char*, PageTabOrder>{ "A", PageTabOrder::Array },
-                    std::pair<const char*, PageTabOrder>{ "W", PageTabOrder::Widget }
-                };
-
-                page.m_pageTabOrder = loader.readEnumByName(dictionary->get("Tabs"), tabStops.cbegin(), tabStops.cend(), PageTabOrder::Invalid);
-                page.m_templateName = loader.readNameFromDictionary(dictionary, "TemplateInstantiated");
-                page.m_userUnit = loader.readNumberFromDictionary(dictionary, "UserUnit", 1.0);
-                page.m_documentPart = loader.readReferenceFromDictionary(dictionary, "DPart");
-
-                pages.emplace_back(std::move(page));
+                pages.emplace_back(createPage(storage, currentInheritableAttributes, dereferenced, objectReference));
             }
             else
             {
@@ -361,4 +373,335 @@ void PDFPage::parseImpl(std::vector<PDFPage>& pages,
     }
 }
 
+PDFPageTree::PDFPageTree(const PDFPageTree& other)
+{
+    *this = other;
+}
+
+PDFPageTree::PDFPageTree(PDFPageTree&& other)
+{
+    *this = std::move(other);
+}
+
+PDFPageTree& PDFPageTree::operator=(const PDFPageTree& other)
+{
+    if (this != &other)
+    {
+        QMutexLocker lock(&other.m_mutex);
+
+        m_storage = other.m_storage;
+        m_root = other.m_root;
+        m_isLazy = other.m_isLazy;
+        m_allPagesLoaded = other.m_allPagesLoaded;
+        m_loadedPageIndices = other.m_loadedPageIndices;
+        m_nodes = other.m_nodes;
+
+        m_pages.clear();
+        m_pages.resize(other.m_pages.size());
+        for (size_t i = 0; i < other.m_pages.size(); ++i)
+        {
+            if (other.m_pages[i])
+            {
+                m_pages[i] = std::make_unique<PDFPage>(*other.m_pages[i]);
+            }
+        }
+    }
+
+    return *this;
+}
+
+PDFPageTree& PDFPageTree::operator=(PDFPageTree&& other)
+{
+    if (this != &other)
+    {
+        QMutexLocker lock(&other.m_mutex);
+
+        m_storage = other.m_storage;
+        m_root = std::move(other.m_root);
+        m_isLazy = other.m_isLazy;
+        m_allPagesLoaded = other.m_allPagesLoaded;
+        m_pages = std::move(other.m_pages);
+        m_loadedPageIndices = std::move(other.m_loadedPageIndices);
+        m_nodes = std::move(other.m_nodes);
+
+        other.m_pages.clear();
+        other.m_isLazy = false;
+        other.m_allPagesLoaded = true;
+    }
+
+    return *this;
+}
+
+PDFPageTree PDFPageTree::parse(const PDFObjectStorage* storage, const PDFObject& root)
+{
+    PDFPageTree tree;
+    tree.m_storage = storage;
+    tree.m_root = root;
+
+    if (root.isReference())
+    {
+        PDFDocumentDataLoaderDecorator loader(storage);
+        const PDFDictionary* dictionary = storage->getDictionaryFromObject(storage->getObject(root));
+
+        // Page count can't exceed the number of objects, so we do not
+        // allocate huge array of pages for corrupted /Count entries.
+        const PDFInteger count = dictionary ? loader.readIntegerFromDictionary(dictionary, "Count", 0) : 0;
+        if (count >= PDFInteger(LAZY_LOADING_PAGE_COUNT) &&
+            count <= PDFInteger(storage->getObjectCount()) &&
+            loader.readNameFromDictionary(dictionary, "Type") == "Pages")
+        {
+            tree.m_isLazy = true;
+            tree.m_allPagesLoaded = false;
+            tree.m_pages.resize(count);
+            return tree;
+        }
+    }
+
+    std::vector<PDFPage> pages = PDFPage::parse(storage, root);
+    tree.m_pages.reserve(pages.size());
+    for (PDFPage& page : pages)
+    {
+        tree.m_pages.emplace_back(std::make_unique<PDFPage>(std::move(page)));
+    }
+
+    return tree;
+}
+
+const PDFPage* PDFPageTree::getPage(size_t index) const
+{
+    if (!m_isLazy)
+    {
+        return m_pages.at(index).get();
+    }
+
+    QMutexLocker lock(&m_mutex);
+
+    if (!m_pages.at(index))
+    {
+        loadPage(index);
+    }
+
+    return m_pages[index].get();
+}
+
+size_t PDFPageTree::getPageIndex(PDFObjectReference reference) const
+{
+    auto findPageIndex = [this, reference]()
+    {
+        auto it = std::find_if(m_pages.cbegin(), m_pages.cend(), [reference](const auto& page) { return page->getPageReference() == reference; });
+        if (it != m_pages.cend())
+        {
+            return size_t(std::distance(m_pages.cbegin(), it));
+        }
+
+        return INVALID_PAGE_INDEX;
+    };
+
+    if (!m_isLazy)
+    {
+        return findPageIndex();
+    }
+
+    QMutexLocker lock(&m_mutex);
+
+    if (m_allPagesLoaded)
+    {
+        return findPageIndex();
+    }
+
+    auto it = m_loadedPageIndices.find(reference);
+    if (it != m_loadedPageIndices.cend())
+    {
+        return it->second;
+    }
+
+    // Walk from the page to the root using /Parent entries and sum
+    // the page counts of the preceding siblings on each level.
+    const PDFObjectReference rootReference = m_root.getReference();
+    PDFObjectReference current = reference;
+    std::set<PDFObjectReference> visited;
+    size_t index = 0;
+
+    while (current != rootReference)
+    {
+        const PDFDictionary* dictionary = m_storage->getDictionaryFromObject(m_storage->getObjectByReference(current));
+        const PDFObject& parentObject = dictionary ? dictionary->get("Parent") : PDFObject();
+
+        if (!visited.insert(current).second || !parentObject.isReference())
+        {
+            return INVALID_PAGE_INDEX;
+        }
+
+        const PDFObjectReference parentReference = parentObject.getReference();
+        const Node& node = getNode(parentReference);
+        auto kidIt = std::find(node.kids.cbegin(), node.kids.cend(), current);
+        if (kidIt == node.kids.cend())
+        {
+            return INVALID_PAGE_INDEX;
+        }
+
+        index += node.offsets[std::distance(node.kids.cbegin(), kidIt)];
+        current = parentReference;
+    }
+
+    if (index >= m_pages.size())
+    {
+        return INVALID_PAGE_INDEX;
+    }
+
+    if (!m_pages[index])
+    {
+        loadPage(index);
+    }
+
+    if (m_pages[index]->getPageReference() == reference)
+    {
+        return index;
+    }
+
+    if (m_allPagesLoaded)
+    {
+        return findPageIndex();
+    }
+
+    return INVALID_PAGE_INDEX;
+}
+
+const PDFPageTree::Node& PDFPageTree::getNode(PDFObjectReference reference) const
+{
+    auto it = m_nodes.find(reference);
+    if (it != m_nodes.cend())
+    {
+        return it->second;
+    }
+
+    Node node;
+    size_t pageCount = 0;
+
+    PDFDocumentDataLoaderDecorator loader(m_storage);
+    const PDFDictionary* dictionary = m_storage->getDictionaryFromObject(m_storage->getObjectByReference(reference));
+    const PDFObject& kidsObject = dictionary ? m_storage->getObject(dictionary->get("Kids")) : PDFObject();
+
+    if (kidsObject.isArray())
+    {
+        const PDFArray* kidsArray = kidsObject.getArray();
+        const size_t count = kidsArray->getCount();
+
+        node.kids.reserve(count);
+        node.offsets.reserve(count + 1);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const PDFObject& kid = kidsArray->getItem(i);
+            PDFObjectReference kidReference = kid.isReference() ? kid.getReference() : PDFObjectReference();
+            size_t kidPageCount = 0;
+
+            if (const PDFDictionary* kidDictionary = kidReference.isValid() ? m_storage->getDictionaryFromObject(m_storage->getObject(kid)) : nullptr)
+            {
+                QByteArray type = loader.readNameFromDictionary(kidDictionary, "Type");
+                if (type == "Page")
+                {
+                    kidPageCount = 1;
+                }
+                else if (type == "Pages")
+                {
+                    kidPageCount = std::max(loader.readIntegerFromDictionary(kidDictionary, "Count", 0), PDFInteger(0));
+                }
+            }
+
+            node.kids.push_back(kidReference);
+            node.offsets.push_back(pageCount);
+            pageCount += kidPageCount;
+        }
+    }
+
+    node.offsets.push_back(pageCount);
+    return m_nodes.emplace(reference, std::move(node)).first->second;
+}
+
+void PDFPageTree::loadPage(size_t index) const
+{
+    try
+    {
+        PDFDocumentDataLoaderDecorator loader(m_storage);
+        PDFPageInheritableAttributes attributes;
+        PDFObjectReference reference = m_root.getReference();
+        std::set<PDFObjectReference> visited;
+        size_t remainingIndex = index;
+
+        while (reference.isValid() && visited.insert(reference).second)
+        {
+            const PDFObject& object = m_storage->getObjectByReference(reference);
+            const PDFDictionary* dictionary = m_storage->getDictionaryFromObject(object);
+
+            if (!dictionary)
+            {
+                break;
+            }
+
+            attributes = PDFPageInheritableAttributes::parse(attributes, PDFObject::createReference(reference), m_storage);
+
+            QByteArray type = loader.readNameFromDictionary(dictionary, "Type");
+            if (type == "Page")
+            {
+                if (remainingIndex == 0)
+                {
+                    m_pages[index] = std::make_unique<PDFPage>(PDFPage::createPage(m_storage, attributes, object, reference));
+                    m_loadedPageIndices[reference] = index;
+                    return;
+                }
+
+                break;
+            }
+
+            if (type != "Pages")
+            {
+                break;
+            }
+
+            // Find the kid, whose subtree contains the page
+            const Node& node = getNode(reference);
+            auto it = std::upper_bound(node.offsets.cbegin(), node.offsets.cend(), remainingIndex);
+            if (it == node.offsets.cbegin() || it == node.offsets.cend())
+            {
+                break;
+            }
+
+            const size_t kidIndex = std::distance(node.offsets.cbegin(), it) - 1;
+            remainingIndex -= node.offsets[kidIndex];
+            reference = node.kids[kidIndex];
+        }
+    }
+    catch (const PDFException&)
+    {
+        // Page tree is malformed, try to parse it at once
+    }
+
+    loadAllPages();
+}
+
+void PDFPageTree::loadAllPages() const
+{
+    std::vector<PDFPage> pages;
+
+    try
+    {
+        pages = PDFPage::parse(m_storage, m_root);
+    }
+    catch (const PDFException&)
+    {
+        pages.clear();
+    }
+
+    for (size_t i = 0; i < m_pages.size(); ++i)
+    {
+        if (!m_pages[i])
+        {
+            m_pages[i] = std::make_unique<PDFPage>(i < pages.size() ? std::move(pages[i]) : PDFPage());
+        }
+    }
+
+    m_allPagesLoaded = true;
+}
+
 }   // namespace pdf
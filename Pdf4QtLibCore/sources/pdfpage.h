@@ -26,9 +26,13 @@
 #include "pdfobject.h"
 
 #include <QRectF>
+#include <QMutex>
 #include <QDateTime>
 
 #include <set>
+#include <map>
+#include <limits>
+#include <memory>
 #include <optional>
 
 namespace pdf
@@ -279,6 +283,18 @@ public:
     static QRectF getRotatedBox(const QRectF& rect, PageRotation rotation);
 
 private:
+    friend class PDFPageTree;
+
+    /// Creates page from the page dictionary (leaf node of the page tree)
+    /// \param storage Storage owning the page tree
+    /// \param attributes Inheritable attributes of the page
+    /// \param pageObject Dereferenced page object
+    /// \param reference Reference to the page object
+    static PDFPage createPage(const PDFObjectStorage* storage,
+                              const PDFPageInheritableAttributes& attributes,
+                              const PDFObject& pageObject,
+                              PDFObjectReference reference);
+
     /// Parses the page tree (implementation). If error occurs, then exception is thrown.
     /// \param pages Page array. Pages are inserted into this array
     /// \param visitedReferences Visited references (to check cycles in page tree and avoid hangup)
@@ -323,6 +339,93 @@ private:
     QByteArray m_templateName;
 };
 
+/// Pages of the document. Page trees of small documents are parsed at once. Page
+/// trees of large documents are loaded lazily, page is located by walking the page
+/// tree using /Count entries of its nodes (so only the path from the root to the
+/// page is visited) and then it is cached. Page count of lazily loaded tree is
+/// taken from the /Count entry of the root. If tree turns out to be inconsistent
+/// during the walk, the whole tree is parsed at once. Pages can be accessed
+/// from multiple threads, pointers to the pages remain valid for the lifetime
+/// of the page tree.
+class PDF4QTLIBCORESHARED_EXPORT PDFPageTree
+{
+public:
+    explicit PDFPageTree() = default;
+
+    PDFPageTree(const PDFPageTree& other);
+    PDFPageTree(PDFPageTree&& other);
+
+    PDFPageTree& operator=(const PDFPageTree& other);
+    PDFPageTree& operator=(PDFPageTree&& other);
+
+    static constexpr const size_t INVALID_PAGE_INDEX = std::numeric_limits<size_t>::max();
+
+    /// Minimal page count of the document, for which pages are loaded lazily
+    static constexpr const size_t LAZY_LOADING_PAGE_COUNT = 1024;
+
+    /// Parses the page tree. Tree is loaded lazily, if root of the tree is a reference
+    /// and it contains at least \p LAZY_LOADING_PAGE_COUNT pages. Otherwise all pages
+    /// are parsed immediately, and if error occurs, then exception is thrown.
+    /// \param storage Storage owning this tree
+    /// \param root Root object of page tree
+    static PDFPageTree parse(const PDFObjectStorage* storage, const PDFObject& root);
+
+    /// Returns the page count
+    size_t getPageCount() const { return m_pages.size(); }
+
+    /// Returns the page. Page is loaded, if it was not loaded yet. If index is
+    /// out of range, then std::out_of_range exception is thrown.
+    /// \param index Page index
+    const PDFPage* getPage(size_t index) const;
+
+    /// Returns page index. If page is not found, then INVALID_PAGE_INDEX is returned.
+    /// \param reference Reference to the page object
+    size_t getPageIndex(PDFObjectReference reference) const;
+
+    /// Returns true, if pages are loaded lazily
+    bool isLazy() const { return m_isLazy; }
+
+    /// Sets storage owning the page tree. It must be called, when
+    /// storage is moved or copied together with the page tree.
+    /// \param storage Storage
+    void setStorage(const PDFObjectStorage* storage) { m_storage = storage; }
+
+private:
+    /// Node of the page tree (dictionary of type /Pages)
+    struct Node
+    {
+        /// References to the kids of the node
+        std::vector<PDFObjectReference> kids;
+
+        /// Number of pages preceding the kid in the subtree of the node,
+        /// last item is the total number of pages in the subtree.
+        std::vector<size_t> offsets;
+    };
+
+    /// Returns node of the page tree, node is created when
+    /// it is accessed for the first time. Must be called under lock.
+    /// \param reference Reference to the node
+    const Node& getNode(PDFObjectReference reference) const;
+
+    /// Loads page with given index, by walking the tree from the root. If page
+    /// can't be found, then all pages are loaded. Must be called under lock.
+    /// \param index Page index
+    void loadPage(size_t index) const;
+
+    /// Parses whole page tree and fills all pages, which were not loaded yet.
+    /// If tree can't be parsed, missing pages are empty. Must be called under lock.
+    void loadAllPages() const;
+
+    const PDFObjectStorage* m_storage = nullptr;
+    PDFObject m_root;
+    bool m_isLazy = false;
+    mutable bool m_allPagesLoaded = true;
+    mutable QMutex m_mutex;
+    mutable std::vector<std::unique_ptr<PDFPage>> m_pages;
+    mutable std::map<PDFObjectReference, size_t> m_loadedPageIndices;
+    mutable std::map<PDFObjectReference, Node> m_nodes;
+};
+
 }   // namespace pdf
 
 #endif // PDFPAGE_H
@@ -27,6 +27,7 @@
 #include "pdfpainterutils.h"
 
 #include <exception>
+#include <numeric>
 #include <QBuffer>
 #include <QStringBuilder>
 #include <QXmlStreamReader>
@@ -534,6 +535,330 @@ void PDFPageContentEditorContentStreamBuilder::writeEditedElement(const PDFEdite
     }
 }
 
+bool PDFPageContentEditorContentStreamBuilder::writeEditedPageContent(const PDFPage* page,
+                                                                      const PDFEditedPageContent& content,
+                                                                      const std::vector<const PDFEditedPageContentElement*>& elements)
+{
+    const std::vector<PDFEditedPageContentSegment>& segments = content.getSegments();
+    const size_t segmentCount = segments.size();
+
+    // Decoded original content streams of the page
+    std::vector<QByteArray> contentStreams;
+    const PDFObject& contents = m_document->getObject(page->getContents());
+    if (contents.isArray())
+    {
+        const PDFArray* array = contents.getArray();
+        for (size_t i = 0; i < array->getCount(); ++i)
+        {
+            const PDFObject& streamObject = m_document->getObject(array->getItem(i));
+            if (!streamObject.isStream())
+            {
+                return false;
+            }
+            contentStreams.emplace_back(m_document->getDecodedStream(streamObject.getStream()));
+        }
+    }
+    else if (contents.isStream())
+    {
+        contentStreams.emplace_back(m_document->getDecodedStream(contents.getStream()));
+    }
+    else
+    {
+        return false;
+    }
+
+    // Segment is dirty, if some of its elements were modified or deleted
+    std::vector<size_t> originalElementCounts(segmentCount, 0);
+    std::vector<std::vector<const PDFEditedPageContentElement*>> segmentElements(segmentCount);
+    std::vector<bool> isSegmentDirty(segmentCount, false);
+
+    for (size_t i = 0; i < content.getElementCount(); ++i)
+    {
+        const PDFInteger segmentIndex = content.getElement(i)->getSegmentIndex();
+        if (segmentIndex < 0 || size_t(segmentIndex) >= segmentCount)
+        {
+            return false;
+        }
+        ++originalElementCounts[segmentIndex];
+    }
+
+    for (const PDFEditedPageContentElement* element : elements)
+    {
+        const PDFInteger segmentIndex = element->getSegmentIndex();
+        if (segmentIndex < 0 || size_t(segmentIndex) >= segmentCount)
+        {
+            return false;
+        }
+        segmentElements[segmentIndex].push_back(element);
+        isSegmentDirty[segmentIndex] = isSegmentDirty[segmentIndex] || element->isModified();
+    }
+
+    for (size_t i = 0; i < segmentCount; ++i)
+    {
+        const PDFPageContentProcessor::ContentStreamRange& range = segments[i].range;
+        if (!range.isValid() || range.contentStreamIndex >= PDFInteger(contentStreams.size()) ||
+            range.begin < 0 || range.begin > range.end ||
+            range.end > contentStreams[range.contentStreamIndex].size())
+        {
+            return false;
+        }
+
+        if (segmentElements[i].size() != originalElementCounts[i])
+        {
+            isSegmentDirty[i] = true;
+        }
+    }
+
+    // Overlapping segments (for example, segments of Type 3 glyphs inside the text
+    // object) are merged into groups, which are replaced at once.
+    struct Group
+    {
+        PDFPageContentProcessor::ContentStreamRange range;
+        std::vector<size_t> segmentIndices;
+        bool isDirty = false;
+    };
+
+    std::vector<size_t> sortedSegmentIndices(segmentCount, 0);
+    std::iota(sortedSegmentIndices.begin(), sortedSegmentIndices.end(), 0);
+    std::stable_sort(sortedSegmentIndices.begin(), sortedSegmentIndices.end(), [&segments](size_t l, size_t r)
+    {
+        const PDFPageContentProcessor::ContentStreamRange& left = segments[l].range;
+        const PDFPageContentProcessor::ContentStreamRange& right = segments[r].range;
+        return std::tie(left.contentStreamIndex, left.begin) < std::tie(right.contentStreamIndex, right.begin);
+    });
+
+    std::vector<Group> groups;
+    for (size_t segmentIndex : sortedSegmentIndices)
+    {
+        const PDFPageContentProcessor::ContentStreamRange& range = segments[segmentIndex].range;
+        if (!groups.empty() &&
+            groups.back().range.contentStreamIndex == range.contentStreamIndex &&
+            range.begin < groups.back().range.end)
+        {
+            Group& group = groups.back();
+            group.range.end = qMax(group.range.end, range.end);
+            group.segmentIndices.push_back(segmentIndex);
+            group.isDirty = group.isDirty || isSegmentDirty[segmentIndex];
+        }
+        else
+        {
+            groups.push_back(Group{ range, { segmentIndex }, isSegmentDirty[segmentIndex] });
+        }
+    }
+
+    // Check all dirty groups first, so nothing is written, if content can't be spliced
+    std::vector<QByteArray> persistentStateOperators(groups.size());
+    for (size_t i = 0; i < groups.size(); ++i)
+    {
+        const Group& group = groups[i];
+        if (!group.isDirty)
+        {
+            continue;
+        }
+
+        const QByteArray& contentStream = contentStreams[group.range.contentStreamIndex];
+        std::optional<QByteArray> operators = getPersistentStateOperators(QByteArrayView(contentStream).sliced(group.range.begin, group.range.end - group.range.begin));
+        if (!operators)
+        {
+            return false;
+        }
+        persistentStateOperators[i] = std::move(*operators);
+    }
+
+    // Resources used by original content must be preserved
+    auto addOriginalResources = [](PDFDictionary& dictionary, const PDFDictionary* originalDictionary)
+    {
+        if (originalDictionary)
+        {
+            for (size_t i = 0; i < originalDictionary->getCount(); ++i)
+            {
+                if (!dictionary.hasKey(originalDictionary->getKey(i).getString()))
+                {
+                    dictionary.addEntry(originalDictionary->getKey(i), PDFObject(originalDictionary->getValue(i)));
+                }
+            }
+        }
+    };
+
+    PDFDictionary originalXObjectDictionary = content.getXObjectDictionary();
+    addOriginalResources(m_xobjectDictionary, &originalXObjectDictionary);
+
+    if (const PDFDictionary* resourcesDictionary = m_document->getDictionaryFromObject(page->getResources()))
+    {
+        addOriginalResources(m_graphicStateDictionary, m_document->getDictionaryFromObject(resourcesDictionary->get("ExtGState")));
+    }
+
+    const PDFPageContentProcessorState defaultState = m_currentState;
+    m_outputContent.append("q\n");
+
+    size_t groupIndex = 0;
+    for (PDFInteger contentStreamIndex = 0; contentStreamIndex < PDFInteger(contentStreams.size()); ++contentStreamIndex)
+    {
+        const QByteArray& contentStream = contentStreams[contentStreamIndex];
+        PDFInteger position = 0;
+
+        for (; groupIndex < groups.size() && groups[groupIndex].range.contentStreamIndex == contentStreamIndex; ++groupIndex)
+        {
+            const Group& group = groups[groupIndex];
+            if (!group.isDirty)
+            {
+                continue;
+            }
+
+            m_outputContent.append(contentStream.constData() + position, group.range.begin - position);
+            position = group.range.end;
+
+            // Remaining elements are written in the order, in which they were created
+            std::vector<size_t> segmentIndices = group.segmentIndices;
+            std::sort(segmentIndices.begin(), segmentIndices.end());
+
+            m_currentState = segments[group.segmentIndices.front()].state;
+            m_currentState.setStateFlags(PDFPageContentProcessorState::StateFlags());
+            m_baseTransformationMatrix = m_currentState.getCurrentTransformationMatrix();
+
+            m_outputContent.append("\nq\n");
+            for (size_t segmentIndex : segmentIndices)
+            {
+                for (const PDFEditedPageContentElement* element : segmentElements[segmentIndex])
+                {
+                    writeEditedElement(element);
+                }
+            }
+            m_outputContent.append("Q\n");
+            m_outputContent.append(persistentStateOperators[groupIndex]);
+        }
+
+        m_outputContent.append(contentStream.constData() + position, contentStream.size() - position);
+        m_outputContent.append("\n");
+    }
+
+    m_outputContent.append("Q\n");
+
+    m_currentState = defaultState;
+    m_currentState.setStateFlags(PDFPageContentProcessorState::StateFlags());
+    m_baseTransformationMatrix = QTransform();
+    return true;
+}
+
+std::optional<QByteArray> PDFPageContentEditorContentStreamBuilder::getPersistentStateOperators(QByteArrayView segment)
+{
+    using Operator = PDFPageContentProcessor::Operator;
+
+    QByteArray operators;
+    int graphicStateDepth = 0;
+    int markedContentDepth = 0;
+    int textObjectDepth = 0;
+
+    try
+    {
+        PDFLexicalAnalyzer parser(segment.data(), segment.data() + segment.size());
+        PDFInteger operationBegin = 0;
+
+        while (!parser.isAtEnd())
+        {
+            PDFLexicalAnalyzer::TypedToken token;
+            parser.fetch(token);
+
+            if (token.type != PDFLexicalAnalyzer::TokenType::Command)
+            {
+                continue;
+            }
+
+            const Operator op = PDFPageContentProcessor::getOperator(token.getString());
+            switch (op)
+            {
+                case Operator::SaveGraphicState:
+                    ++graphicStateDepth;
+                    break;
+
+                case Operator::RestoreGraphicState:
+                    --graphicStateDepth;
+                    break;
+
+                case Operator::MarkedContentBegin:
+                case Operator::MarkedContentBeginWithProperties:
+                    ++markedContentDepth;
+                    break;
+
+                case Operator::MarkedContentEnd:
+                    --markedContentDepth;
+                    break;
+
+                case Operator::TextBegin:
+                    ++textObjectDepth;
+                    break;
+
+                case Operator::TextEnd:
+                    --textObjectDepth;
+                    break;
+
+                case Operator::InlineImageBegin:
+                    // Inline image data can't be scanned by lexical analyzer
+                    return std::nullopt;
+
+                case Operator::SetLineWidth:
+                case Operator::SetLineCap:
+                case Operator::SetLineJoin:
+                case Operator::SetMitterLimit:
+                case Operator::SetLineDashPattern:
+                case Operator::SetRenderingIntent:
+                case Operator::SetFlatness:
+                case Operator::SetGraphicState:
+                case Operator::AdjustCurrentTransformationMatrix:
+                case Operator::TextSetCharacterSpacing:
+                case Operator::TextSetWordSpacing:
+                case Operator::TextSetHorizontalScale:
+                case Operator::TextSetLeading:
+                case Operator::TextSetFontAndFontSize:
+                case Operator::TextSetRenderMode:
+                case Operator::TextSetRise:
+                case Operator::ColorSetStrokingColorSpace:
+                case Operator::ColorSetFillingColorSpace:
+                case Operator::ColorSetStrokingColor:
+                case Operator::ColorSetStrokingColorN:
+                case Operator::ColorSetFillingColor:
+                case Operator::ColorSetFillingColorN:
+                case Operator::ColorSetDeviceGrayStroking:
+                case Operator::ColorSetDeviceGrayFilling:
+                case Operator::ColorSetDeviceRGBStroking:
+                case Operator::ColorSetDeviceRGBFilling:
+                case Operator::ColorSetDeviceCMYKStroking:
+                case Operator::ColorSetDeviceCMYKFilling:
+                {
+                    if (graphicStateDepth == 0)
+                    {
+                        QByteArrayView operation = segment.sliced(operationBegin, parser.pos() - operationBegin).trimmed();
+                        operators.append(operation.data(), operation.size());
+                        operators.append('\n');
+                    }
+                    break;
+                }
+
+                default:
+                    break;
+            }
+
+            if (graphicStateDepth < 0 || markedContentDepth < 0 || textObjectDepth < 0)
+            {
+                return std::nullopt;
+            }
+
+            operationBegin = parser.pos();
+        }
+    }
+    catch (const PDFException&)
+    {
+        return std::nullopt;
+    }
+
+    if (graphicStateDepth != 0 || markedContentDepth != 0 || textObjectDepth != 0)
+    {
+        return std::nullopt;
+    }
+
+    return operators;
+}
+
 const QByteArray& PDFPageContentEditorContentStreamBuilder::getOutputContent() const
 {
     return m_outputContent;
@@ -1134,12 +1459,13 @@ void PDFPageContentEditorContentStreamBuilder::writeImage(const QImage& image, Q
 
 bool PDFPageContentEditorContentStreamBuilder::isNeededToWriteCurrentTransformationMatrix() const
 {
-    return !m_currentState.getCurrentTransformationMatrix().isIdentity();
+    return m_currentState.getCurrentTransformationMatrix() != m_baseTransformationMatrix;
 }
 
 void PDFPageContentEditorContentStreamBuilder::writeCurrentTransformationMatrix(QTextStream& stream)
 {
-    QTransform transform = m_currentState.getCurrentTransformationMatrix();
+    // Matrix is written relative to the transformation matrix of the content, in which it is written
+    QTransform transform = m_currentState.getCurrentTransformationMatrix() * m_baseTransformationMatrix.inverted();
 
     PDFReal m11 = transform.m11();
     PDFReal m12 = transform.m12();
@@ -28,6 +28,8 @@
 #include <QHash>
 #include <QPaintDevice>
 
+#include <optional>
+
 namespace pdf
 {
 class PDFPageContentElement;
@@ -59,6 +61,20 @@ public:
 
     void writeEditedElement(const PDFEditedPageContentElement* element);
 
+    /// Writes page content by splicing edited elements into the original page content
+    /// streams. Segments of the original content streams, whose elements were neither
+    /// modified nor deleted, are copied unchanged, other segments are replaced by content
+    /// written from their remaining elements. Original content is enclosed in save/restore
+    /// of the graphic state, so content written later starts in the default graphic state.
+    /// If original content can't be spliced, nothing is written and false is returned,
+    /// then whole content has to be written from the elements.
+    /// \param page Page, from which edited content was created
+    /// \param content Edited page content
+    /// \param elements Edited elements, elements of the content not present were deleted
+    bool writeEditedPageContent(const PDFPage* page,
+                                const PDFEditedPageContent& content,
+                                const std::vector<const PDFEditedPageContentElement*>& elements);
+
     const QByteArray& getOutputContent() const;
 
     const PDFDictionary& getFontDictionary() const { return m_fontDictionary; }
@@ -105,12 +121,21 @@ private:
     QByteArray selectFont(const QByteArray& font);
     void addError(const QString& error);
 
+    /// Scans segment of the original content stream, which is being replaced, and returns
+    /// operators, which change graphic state persistently (they are not enclosed in save/restore
+    /// of the graphic state in the segment), so they can be written after the replaced content.
+    /// If segment can't be replaced (it contains unbalanced save/restore, text object or marked
+    /// content, or inline image), then std::nullopt is returned.
+    /// \param segment Segment of the decoded content stream
+    static std::optional<QByteArray> getPersistentStateOperators(QByteArrayView segment);
+
     PDFDocument* m_document = nullptr;
     PDFDictionary m_fontDictionary;
     PDFDictionary m_xobjectDictionary;
     PDFDictionary m_graphicStateDictionary;
     QByteArray m_outputContent;
     PDFPageContentProcessorState m_currentState;
+    QTransform m_baseTransformationMatrix;
     PDFFontPointer m_textFont;
     QHash<QByteArray, PDFFontPointer> m_fontOverrides;
     QStringList m_errors;
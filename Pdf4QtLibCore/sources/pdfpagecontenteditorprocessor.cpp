@@ -54,20 +54,81 @@ const PDFEditedPageContent& PDFPageContentEditorProcessor::getEditedPageContent(
 
 PDFEditedPageContent PDFPageContentEditorProcessor::takeEditedPageContent()
 {
+    // Elements are modified during processing, when they are being created
+    m_content.clearModifiedFlags();
     return std::move(m_content);
 }
 
+void PDFPageContentEditorProcessor::assignSegment(PDFInteger begin, const PDFPageContentProcessorState& state)
+{
+    PDFEditedPageContentElement* element = m_content.getBackElement();
+    const ContentStreamRange& currentRange = getCurrentOperationRange();
+
+    if (!element || !currentRange.isValid())
+    {
+        return;
+    }
+
+    if (isPageContentStreamOperation())
+    {
+        ContentStreamRange range = currentRange;
+        if (begin >= 0)
+        {
+            range.begin = begin;
+        }
+
+        element->setSegmentIndex(m_content.addSegment(range, state));
+    }
+    else
+    {
+        // Element was created from the content of the form, so whole operation,
+        // which painted the form, is the segment.
+        element->setSegmentIndex(m_content.addSegment(currentRange, m_paintXObjectState));
+    }
+}
+
 void PDFPageContentEditorProcessor::performInterceptInstruction(Operator currentOperator,
                                                                 ProcessOrder processOrder,
                                                                 const QByteArray& operatorAsText)
 {
     BaseClass::performInterceptInstruction(currentOperator, processOrder, operatorAsText);
 
+    const bool isPageContentStreamOperation = this->isPageContentStreamOperation();
+
     if (processOrder == ProcessOrder::BeforeOperation)
     {
         if (currentOperator == Operator::TextBegin && !isTextProcessing())
         {
             m_contentElementText.reset(new PDFEditedPageContentElementText(*getGraphicState(), getGraphicState()->getCurrentTransformationMatrix()));
+            m_textBegin = isPageContentStreamOperation ? getCurrentOperationRange().begin : -1;
+        }
+
+        if (isPageContentStreamOperation)
+        {
+            switch (currentOperator)
+            {
+                case Operator::MoveCurrentPoint:
+                case Operator::LineTo:
+                case Operator::Bezier123To:
+                case Operator::Bezier23To:
+                case Operator::Bezier13To:
+                case Operator::EndSubpath:
+                case Operator::Rectangle:
+                {
+                    if (m_pathBegin < 0)
+                    {
+                        m_pathBegin = getCurrentOperationRange().begin;
+                    }
+                    break;
+                }
+
+                case Operator::PaintXObject:
+                    m_paintXObjectState = *getGraphicState();
+                    break;
+
+                default:
+                    break;
+            }
         }
     }
     else
@@ -82,11 +143,36 @@ void PDFPageContentEditorProcessor::performInterceptInstruction(Operator current
                 {
                     m_contentElementText->setTextPath(std::move(m_textPath));
                     m_contentElementText->setItemsAsText(PDFEditedPageContentElementText::createItemsAsText(m_contentElementText->getState(), m_contentElementText->getItems()));
+                    PDFPageContentProcessorState textState = m_contentElementText->getState();
                     m_content.addContentElement(std::move(m_contentElementText));
+                    assignSegment(m_textBegin, textState);
                 }
             }
             m_contentElementText.reset();
             m_textPath = QPainterPath();
+            m_textBegin = -1;
+        }
+
+        if (isPageContentStreamOperation)
+        {
+            switch (currentOperator)
+            {
+                case Operator::PathStroke:
+                case Operator::PathCloseStroke:
+                case Operator::PathFillWinding:
+                case Operator::PathFillWinding2:
+                case Operator::PathFillEvenOdd:
+                case Operator::PathFillStrokeWinding:
+                case Operator::PathFillStrokeEvenOdd:
+                case Operator::PathCloseFillStrokeWinding:
+                case Operator::PathCloseFillStrokeEvenOdd:
+                case Operator::PathClear:
+                    m_pathBegin = -1;
+                    break;
+
+                default:
+                    break;
+            }
         }
     }
 }
@@ -107,6 +193,7 @@ void PDFPageContentEditorProcessor::performPathPainting(const QPainterPath& path
     else
     {
         m_content.addContentPath(*getGraphicState(), path, stroke, fill);
+        assignSegment(m_pathBegin, *getGraphicState());
     }
 }
 
@@ -144,6 +231,7 @@ bool PDFPageContentEditorProcessor::performOriginalImagePainting(const PDFImage&
 
     PDFObject imageObject = PDFObject::createStream(std::make_shared<PDFStream>(*stream));
     m_content.addContentImage(*getGraphicState(), std::move(imageObject), QImage());
+    assignSegment(-1, *getGraphicState());
 
     return false;
 }
@@ -487,6 +575,25 @@ void PDFEditedPageContent::setXObjectDictionary(const PDFDictionary& newXobjectD
     m_xobjectDictionary = newXobjectDictionary;
 }
 
+PDFInteger PDFEditedPageContent::addSegment(const PDFPageContentProcessor::ContentStreamRange& range, const PDFPageContentProcessorState& state)
+{
+    if (!m_segments.empty() && m_segments.back().range == range)
+    {
+        return PDFInteger(m_segments.size()) - 1;
+    }
+
+    m_segments.push_back(PDFEditedPageContentSegment{ range, state });
+    return PDFInteger(m_segments.size()) - 1;
+}
+
+void PDFEditedPageContent::clearModifiedFlags()
+{
+    for (const auto& element : m_contentElements)
+    {
+        element->setModified(false);
+    }
+}
+
 PDFEditedPageContentElement::PDFEditedPageContentElement(PDFPageContentProcessorState state, QTransform transform) :
     m_state(std::move(state)),
     m_transform(transform)
@@ -501,6 +608,7 @@ const PDFPageContentProcessorState& PDFEditedPageContentElement::getState() cons
 
 void PDFEditedPageContentElement::setState(const PDFPageContentProcessorState& newState)
 {
+    m_isModified = true;
     m_state = newState;
 }
 
@@ -511,9 +619,16 @@ QTransform PDFEditedPageContentElement::getTransform() const
 
 void PDFEditedPageContentElement::setTransform(const QTransform& newTransform)
 {
+    m_isModified = true;
     m_transform = newTransform;
 }
 
+void PDFEditedPageContentElement::copyEditingInfo(const PDFEditedPageContentElement& other)
+{
+    m_segmentIndex = other.m_segmentIndex;
+    m_isModified = other.m_isModified;
+}
+
 PDFEditedPageContentElementPath::PDFEditedPageContentElementPath(PDFPageContentProcessorState state, QPainterPath path, bool strokePath, bool fillPath, QTransform transform) :
     PDFEditedPageContentElement(std::move(state), transform),
     m_path(std::move(path)),
@@ -530,7 +645,9 @@ PDFEditedPageContentElement::Type PDFEditedPageContentElementPath::getType() con
 
 PDFEditedPageContentElementPath* PDFEditedPageContentElementPath::clone() const
 {
-    return new PDFEditedPageContentElementPath(getState(), getPath(), getStrokePath(), getFillPath(), getTransform());
+    PDFEditedPageContentElementPath* element = new PDFEditedPageContentElementPath(getState(), getPath(), getStrokePath(), getFillPath(), getTransform());
+    element->copyEditingInfo(*this);
+    return element;
 }
 
 QRectF PDFEditedPageContentElementPath::getBoundingBox() const
@@ -546,6 +663,7 @@ QPainterPath PDFEditedPageContentElementPath::getPath() const
 
 void PDFEditedPageContentElementPath::setPath(QPainterPath newPath)
 {
+    m_isModified = true;
     m_path = newPath;
 }
 
@@ -556,6 +674,7 @@ bool PDFEditedPageContentElementPath::getStrokePath() const
 
 void PDFEditedPageContentElementPath::setStrokePath(bool newStrokePath)
 {
+    m_isModified = true;
     m_strokePath = newStrokePath;
 }
 
@@ -566,6 +685,7 @@ bool PDFEditedPageContentElementPath::getFillPath() const
 
 void PDFEditedPageContentElementPath::setFillPath(bool newFillPath)
 {
+    m_isModified = true;
     m_fillPath = newFillPath;
 }
 
@@ -584,7 +704,9 @@ PDFEditedPageContentElement::Type PDFEditedPageContentElementImage::getType() co
 
 PDFEditedPageContentElementImage* PDFEditedPageContentElementImage::clone() const
 {
-    return new PDFEditedPageContentElementImage(getState(), getImageObject(), getImage(), getTransform());
+    PDFEditedPageContentElementImage* element = new PDFEditedPageContentElementImage(getState(), getImageObject(), getImage(), getTransform());
+    element->copyEditingInfo(*this);
+    return element;
 }
 
 QRectF PDFEditedPageContentElementImage::getBoundingBox() const
@@ -599,6 +721,7 @@ PDFObject PDFEditedPageContentElementImage::getImageObject() const
 
 void PDFEditedPageContentElementImage::setImageObject(const PDFObject& newImageObject)
 {
+    m_isModified = true;
     m_imageObject = newImageObject;
 }
 
@@ -609,6 +732,7 @@ QImage PDFEditedPageContentElementImage::getImage() const
 
 void PDFEditedPageContentElementImage::setImage(const QImage& newImage)
 {
+    m_isModified = true;
     m_image = newImage;
 }
 
@@ -638,7 +762,9 @@ PDFEditedPageContentElement::Type PDFEditedPageContentElementText::getType() con
 
 PDFEditedPageContentElementText* PDFEditedPageContentElementText::clone() const
 {
-    return new PDFEditedPageContentElementText(getState(), getItems(), getTextPath(), getTransform(), getItemsAsText());
+    PDFEditedPageContentElementText* element = new PDFEditedPageContentElementText(getState(), getItems(), getTextPath(), getTransform(), getItemsAsText());
+    element->copyEditingInfo(*this);
+    return element;
 }
 
 void PDFEditedPageContentElementText::addItem(Item item)
@@ -653,6 +779,7 @@ const std::vector<PDFEditedPageContentElementText::Item>& PDFEditedPageContentEl
 
 void PDFEditedPageContentElementText::setItems(const std::vector<Item>& newItems)
 {
+    m_isModified = true;
     m_items = newItems;
 }
 
@@ -668,6 +795,7 @@ QPainterPath PDFEditedPageContentElementText::getTextPath() const
 
 void PDFEditedPageContentElementText::setTextPath(QPainterPath newTextPath)
 {
+    m_isModified = true;
     m_textPath = newTextPath;
 }
 
@@ -783,6 +911,7 @@ QString PDFEditedPageContentElementText::getItemsAsText() const
 
 void PDFEditedPageContentElementText::setItemsAsText(const QString& newItemsAsText)
 {
+    m_isModified = true;
     m_itemsAsText = newItemsAsText;
 }
 
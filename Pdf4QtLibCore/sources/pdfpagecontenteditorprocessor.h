@@ -70,9 +70,23 @@ public:
     QTransform getTransform() const;
     void setTransform(const QTransform& newTransform);
 
+    /// Returns index of the segment of the original content stream, from which
+    /// the element was created, or -1, if element was not created from the content stream.
+    PDFInteger getSegmentIndex() const { return m_segmentIndex; }
+    void setSegmentIndex(PDFInteger segmentIndex) { m_segmentIndex = segmentIndex; }
+
+    /// Returns true, if element was modified after it was created from the content stream
+    bool isModified() const { return m_isModified; }
+    void setModified(bool modified) { m_isModified = modified; }
+
 protected:
+    /// Copies segment index and modification flag from the other element (used when cloning)
+    void copyEditingInfo(const PDFEditedPageContentElement& other);
+
     PDFPageContentProcessorState m_state;
     QTransform m_transform;
+    PDFInteger m_segmentIndex = -1;
+    bool m_isModified = false;
 };
 
 class PDF4QTLIBCORESHARED_EXPORT PDFEditedPageContentElementPath : public PDFEditedPageContentElement
@@ -182,6 +196,18 @@ private:
     QString m_itemsAsText;
 };
 
+/// Segment of the original page content stream, from which one or more content
+/// elements were created. Unmodified segments are copied to the new content stream
+/// unchanged, only segments with modified or deleted elements are rewritten.
+struct PDFEditedPageContentSegment
+{
+    /// Byte range of the segment in the decoded page content stream
+    PDFPageContentProcessor::ContentStreamRange range;
+
+    /// Graphic state at the beginning of the segment
+    PDFPageContentProcessorState state;
+};
+
 class PDF4QTLIBCORESHARED_EXPORT PDFEditedPageContent
 {
 public:
@@ -211,8 +237,20 @@ public:
     PDFDictionary getXObjectDictionary() const;
     void setXObjectDictionary(const PDFDictionary& newXobjectDictionary);
 
+    /// Adds segment of the original content stream and returns its index. If last
+    /// segment has the same range, no segment is added and index of the last segment is returned.
+    /// \param range Range of the segment in the page content stream
+    /// \param state Graphic state at the beginning of the segment
+    PDFInteger addSegment(const PDFPageContentProcessor::ContentStreamRange& range, const PDFPageContentProcessorState& state);
+
+    const std::vector<PDFEditedPageContentSegment>& getSegments() const { return m_segments; }
+
+    /// Clears modification flags of all elements
+    void clearModifiedFlags();
+
 private:
     std::vector<std::unique_ptr<PDFEditedPageContentElement>> m_contentElements;
+    std::vector<PDFEditedPageContentSegment> m_segments;
     PDFDictionary m_fontDictionary;
     PDFDictionary m_xobjectDictionary;
 };
@@ -246,10 +284,26 @@ protected:
     virtual void performProcessTextSequence(const TextSequence& textSequence, ProcessOrder order) override;
 
 private:
+    /// Assigns segment of the page content stream to the last added element. Segment
+    /// begins at \p begin and ends with current operation. If element was created from
+    /// form, segment is the operation, which painted the form.
+    /// \param begin Begin of the segment in the current page content stream
+    /// \param state Graphic state at the beginning of the segment
+    void assignSegment(PDFInteger begin, const PDFPageContentProcessorState& state);
+
     PDFEditedPageContent m_content;
     std::stack<QPainterPath> m_clippingPaths;
     std::unique_ptr<PDFEditedPageContentElementText> m_contentElementText;
     QPainterPath m_textPath;
+
+    /// Begin of the path construction in the page content stream, -1 if no path is constructed
+    PDFInteger m_pathBegin = -1;
+
+    /// Begin of the text object in the page content stream
+    PDFInteger m_textBegin = -1;
+
+    /// Graphic state before the painting of the form (forms are painted by single operation)
+    PDFPageContentProcessorState m_paintXObjectState;
 };
 
 }   // namespace pdf
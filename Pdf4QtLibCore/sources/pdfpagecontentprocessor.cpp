@@ -27,13 +27,18 @@
 #include "pdfpattern.h"
 #include "pdfexecutionpolicy.h"
 #include "pdfstreamfilters.h"
+#include "pdftracing.h"
 
 #include <QScopeGuard>
+#include <QPainter>
 #include <QPainterPathStroker>
 #include <QtMath>
 
 #include "pdfdbgheap.h"
 
+#include <limits>
+#include <cmath>
+
 namespace pdf
 {
 
@@ -308,6 +313,11 @@ void PDFPageContentProcessor::initializeProcessor()
 
 QList<PDFRenderError> PDFPageContentProcessor::processContents()
 {
+    PDF_TRACE_ZONE("ProcessContents", "content");
+
+    // Temporary objects of the page are allocated from the arena
+    PDFThreadLocalArena::Scope arenaScope;
+
     const PDFObject& contents = m_page->getContents();
 
     // Initialize stream processor
@@ -329,7 +339,9 @@ QList<PDFRenderError> PDFPageContentProcessor::processContents()
             const PDFObject& streamObject = m_document->getObject(array->getItem(i));
             if (streamObject.isStream())
             {
+                m_contentStreamIndex = PDFInteger(i);
                 processContentStream(streamObject.getStream());
+                m_contentStreamIndex = -1;
             }
             else
             {
@@ -339,7 +351,9 @@ QList<PDFRenderError> PDFPageContentProcessor::processContents()
     }
     else if (contents.isStream())
     {
+        m_contentStreamIndex = 0;
         processContentStream(contents.getStream());
+        m_contentStreamIndex = -1;
     }
     else
     {
@@ -403,6 +417,46 @@ bool PDFPageContentProcessor::performOriginalImagePainting(const PDFImage& image
     return false;
 }
 
+bool PDFPageContentProcessor::performImageXObjectPlacement(const PDFStream* stream)
+{
+    Q_UNUSED(stream);
+    return false;
+}
+
+bool PDFPageContentProcessor::performProcessForm(ProcessOrder order, const PDFStream* stream)
+{
+    Q_UNUSED(order);
+    Q_UNUSED(stream);
+    return false;
+}
+
+QSize PDFPageContentProcessor::getImageTargetSize() const
+{
+    return QSize();
+}
+
+bool PDFPageContentProcessor::isImageCacheUsed() const
+{
+    return false;
+}
+
+PDFImageDecodeHints PDFPageContentProcessor::getImageDecodeHints() const
+{
+    PDFImageDecodeHints hints;
+    hints.targetSize = getImageTargetSize();
+
+    if (hints.targetSize.isValid())
+    {
+        const QTransform matrix = getCurrentWorldMatrix();
+        if (matrix.isInvertible())
+        {
+            hints.visibleRect = matrix.inverted().mapRect(m_pageBoundingRectDeviceSpace);
+        }
+    }
+
+    return hints;
+}
+
 void PDFPageContentProcessor::performImagePainting(const QImage& image)
 {
     Q_UNUSED(image);
@@ -550,157 +604,177 @@ void PDFPageContentProcessor::performInterceptInstruction(Operator currentOperat
     Q_UNUSED(operatorAsText);
 }
 
-void PDFPageContentProcessor::processContent(const QByteArray& content)
+PDFStream PDFPageContentProcessor::createInlineImageStream(PDFLexicalAnalyzer& parser, const QByteArray& content) const
 {
-    PDFLexicalAnalyzer parser(content.constBegin(), content.constEnd());
+    // Strategy: We will try to find position of BI/ID/EI in the stream. If we can determine
+    // length of the stream explicitly, then we use explicit length. We also create a PDFObject
+    // from the inline image dictionary/image content stream and then process it like XObject.
+    PDFInteger operatorBIPosition = parser.pos();
+    PDFInteger operatorIDPosition = parser.findSubstring("ID", operatorBIPosition);
+    PDFInteger operatorEIPosition = parser.findSubstring("EI", operatorIDPosition);
 
-    while (!parser.isAtEnd() && !isProcessingCancelled())
+    // According the PDF 1.7 specification, single white space characters is after ID, then the byte
+    // immediately after it is interpreted as first byte of image data.
+    PDFInteger startDataPosition = operatorIDPosition + 3;
+
+    if (operatorIDPosition == -1 || operatorEIPosition == -1)
     {
-        bool tokenFetched = false;
-        PDFInteger oldParserPosition = parser.pos();
+        throw PDFException(PDFTranslationContext::tr("Invalid inline image dictionary, ID operator is missing."));
+    }
 
-        try
+    Q_ASSERT(operatorBIPosition < content.size());
+    Q_ASSERT(operatorIDPosition < content.size());
+    Q_ASSERT(operatorBIPosition <= operatorIDPosition);
+
+    PDFParser inlineImageParser(content.constBegin() + operatorBIPosition, content.constBegin() + operatorIDPosition, nullptr, PDFParser::None);
+
+    constexpr std::pair<const char*, const char*> replacements[] =
+    {
+        { "BPC", "BitsPerComponent" },
+        { "CS", "ColorSpace" },
+        { "D", "Decode" },
+        { "DP", "DecodeParms" },
+        { "F", "Filter" },
+        { "H", "Height" },
+        { "IM", "ImageMask" },
+        { "I", "Interpolate" },
+        { "W", "Width" },
+        { "L", "Length" },
+        { "G", "DeviceGray" },
+        { "RGB", "DeviceRGB" },
+        { "CMYK", "DeviceCMYK" }
+    };
+
+    std::shared_ptr<PDFDictionary> dictionarySharedPointer = std::make_shared<PDFDictionary>();
+    PDFDictionary* dictionary = dictionarySharedPointer.get();
+
+    while (inlineImageParser.lookahead().type != PDFLexicalAnalyzer::TokenType::EndOfFile)
+    {
+        PDFObject nameObject = inlineImageParser.getObject();
+        PDFObject valueObject = inlineImageParser.getObject();
+
+        if (!nameObject.isName())
         {
-            PDFLexicalAnalyzer::Token token = parser.fetch();
-            tokenFetched = true;
+            throw PDFException(PDFTranslationContext::tr("Expected name in the inline image dictionary stream."));
+        }
 
-            switch (token.type)
+        // Replace the name, if neccessary
+        QByteArray name = nameObject.getString();
+        for (auto [string, replacement] : replacements)
+        {
+            if (name == string)
             {
-                case PDFLexicalAnalyzer::TokenType::Command:
-                {
-                    QByteArray command = token.data.toByteArray();
+                name = replacement;
+                break;
+            }
+        }
 
-                    if (command == "BI")
-                    {
-                        // Strategy: We will try to find position of BI/ID/EI in the stream. If we can determine
-                        // length of the stream explicitly, then we use explicit length. We also create a PDFObject
-                        // from the inline image dictionary/image content stream and then process it like XObject.
-                        PDFInteger operatorBIPosition = parser.pos();
-                        PDFInteger operatorIDPosition = parser.findSubstring("ID", operatorBIPosition);
-                        PDFInteger operatorEIPosition = parser.findSubstring("EI", operatorIDPosition);
-
-                        // According the PDF 1.7 specification, single white space characters is after ID, then the byte
-                        // immediately after it is interpreted as first byte of image data.
-                        PDFInteger startDataPosition = operatorIDPosition + 3;
-
-                        if (operatorIDPosition == -1 || operatorEIPosition == -1)
-                        {
-                            throw PDFException(PDFTranslationContext::tr("Invalid inline image dictionary, ID operator is missing."));
-                        }
+        dictionary->addEntry(PDFInplaceOrMemoryString(qMove(name)), qMove(valueObject));
+    }
 
-                        Q_ASSERT(operatorBIPosition < content.size());
-                        Q_ASSERT(operatorIDPosition < content.size());
-                        Q_ASSERT(operatorBIPosition <= operatorIDPosition);
+    PDFDocumentDataLoaderDecorator loader(m_document);
+    PDFInteger dataLength = 0;
 
-                        PDFLexicalAnalyzer inlineImageLexicalAnalyzer(content.constBegin() + operatorBIPosition, content.constBegin() + operatorIDPosition);
-                        PDFParser inlineImageParser([&inlineImageLexicalAnalyzer]{ return inlineImageLexicalAnalyzer.fetch(); });
+    if (dictionary->hasKey("Length"))
+    {
+        dataLength = loader.readIntegerFromDictionary(dictionary, "Length", 0);
+    }
+    else if (dictionary->hasKey("Filter"))
+    {
+        dataLength = -1;
 
-                        constexpr std::pair<const char*, const char*> replacements[] =
-                        {
-                            { "BPC", "BitsPerComponent" },
-                            { "CS", "ColorSpace" },
-                            { "D", "Decode" },
-                            { "DP", "DecodeParms" },
-                            { "F", "Filter" },
-                            { "H", "Height" },
-                            { "IM", "ImageMask" },
-                            { "I", "Interpolate" },
-                            { "W", "Width" },
-                            { "L", "Length" },
-                            { "G", "DeviceGray" },
-                            { "RGB", "DeviceRGB" },
-                            { "CMYK", "DeviceCMYK" }
-                        };
-
-                        std::shared_ptr<PDFDictionary> dictionarySharedPointer = std::make_shared<PDFDictionary>();
-                        PDFDictionary* dictionary = dictionarySharedPointer.get();
-
-                        while (inlineImageParser.lookahead().type != PDFLexicalAnalyzer::TokenType::EndOfFile)
-                        {
-                            PDFObject nameObject = inlineImageParser.getObject();
-                            PDFObject valueObject = inlineImageParser.getObject();
+        // We will try to use stream filter hint
+        QByteArray filterName = loader.readNameFromDictionary(dictionary, "Filter");
+        if (!filterName.isEmpty())
+        {
+            dataLength = PDFStreamFilterStorage::getStreamDataLength(content, filterName, startDataPosition);
+        }
 
-                            if (!nameObject.isName())
-                            {
-                                throw PDFException(PDFTranslationContext::tr("Expected name in the inline image dictionary stream."));
-                            }
+        if (dataLength == -1)
+        {
+            // We will use EI operator position to determine stream length
+            dataLength = operatorEIPosition - startDataPosition;
+        }
+    }
+    else
+    {
+        // We will calculate stream size from the with/height and bit per component
+        const PDFInteger width = loader.readIntegerFromDictionary(dictionary, "Width", 0);
+        const PDFInteger height = loader.readIntegerFromDictionary(dictionary, "Height", 0);
+        const PDFInteger bpc = loader.readIntegerFromDictionary(dictionary, "BitsPerComponent", 8);
 
-                            // Replace the name, if neccessary
-                            QByteArray name = nameObject.getString();
-                            for (auto [string, replacement] : replacements)
-                            {
-                                if (name == string)
-                                {
-                                    name = replacement;
-                                    break;
-                                }
-                            }
+        if (width <= 0 || height <= 0 || bpc <= 0)
+        {
+            throw PDFException(PDFTranslationContext::tr("Expected name in the inline image dictionary stream."));
+        }
 
-                            dictionary->addEntry(PDFInplaceOrMemoryString(qMove(name)), qMove(valueObject));
-                        }
+        const PDFInteger stride = (width * bpc + 7) / 8;
+        dataLength = stride * height;
+    }
 
-                        PDFDocumentDataLoaderDecorator loader(m_document);
-                        PDFInteger dataLength = 0;
+    // We will once more find the "EI" operator, due to recomputed dataLength.
+    operatorEIPosition = parser.findSubstring("EI", startDataPosition + dataLength);
+    if (operatorEIPosition == -1)
+    {
+        throw PDFException(PDFTranslationContext::tr("Invalid inline image stream."));
+    }
 
-                        if (dictionary->hasKey("Length"))
-                        {
-                            dataLength = loader.readIntegerFromDictionary(dictionary, "Length", 0);
-                        }
-                        else if (dictionary->hasKey("Filter"))
-                        {
-                            dataLength = -1;
+    // We must seek after EI operator. Image is painted by the caller AFTER we seek the position,
+    // because painting of image can throw exception.
+    parser.seek(operatorEIPosition + 2);
 
-                            // We will try to use stream filter hint
-                            QByteArray filterName = loader.readNameFromDictionary(dictionary, "Filter");
-                            if (!filterName.isEmpty())
-                            {
-                                dataLength = PDFStreamFilterStorage::getStreamDataLength(content, filterName, startDataPosition);
-                            }
+    QByteArray buffer = content.mid(startDataPosition, dataLength);
+    return PDFStream(std::move(*dictionary), std::move(buffer));
+}
 
-                            if (dataLength == -1)
-                            {
-                                // We will use EI operator position to determine stream length
-                                dataLength = operatorEIPosition - startDataPosition;
-                            }
-                        }
-                        else
-                        {
-                            // We will calculate stream size from the with/height and bit per component
-                            const PDFInteger width = loader.readIntegerFromDictionary(dictionary, "Width", 0);
-                            const PDFInteger height = loader.readIntegerFromDictionary(dictionary, "Height", 0);
-                            const PDFInteger bpc = loader.readIntegerFromDictionary(dictionary, "BitsPerComponent", 8);
+PDFCompiledContentStream PDFPageContentProcessor::compileContent(const QByteArray& content) const
+{
+    PDFCompiledContentStream compiledContent;
+    compiledContent.operations.reserve(content.size() / 16);
+    compiledContent.operands.reserve(content.size() / 8);
 
-                            if (width <= 0 || height <= 0 || bpc <= 0)
-                            {
-                                throw PDFException(PDFTranslationContext::tr("Expected name in the inline image dictionary stream."));
-                            }
+    PDFLexicalAnalyzer parser(content.constBegin(), content.constEnd());
+    quint32 firstOperand = 0;
+    quint32 operationBegin = 0;
 
-                            const PDFInteger stride = (width * bpc + 7) / 8;
-                            dataLength = stride * height;
-                        }
+    while (!parser.isAtEnd())
+    {
+        bool tokenFetched = false;
+        PDFInteger oldParserPosition = parser.pos();
 
-                        // We will once more find the "EI" operator, due to recomputed dataLength.
-                        operatorEIPosition = parser.findSubstring("EI", startDataPosition + dataLength);
-                        if (operatorEIPosition == -1)
-                        {
-                            throw PDFException(PDFTranslationContext::tr("Invalid inline image stream."));
-                        }
+        try
+        {
+            PDFLexicalAnalyzer::TypedToken token;
+            parser.fetch(token);
+            tokenFetched = true;
 
-                        // We must seek after EI operator. Then we will paint the image. Because painting of image can throw exception,
-                        // then we will paint the image AFTER we seek the position.
-                        parser.seek(operatorEIPosition + 2);
+            switch (token.type)
+            {
+                case PDFLexicalAnalyzer::TokenType::Command:
+                {
+                    PDFCompiledContentStream::Operation operation;
+                    operation.op = getOperator(token.getString());
+                    operation.firstOperand = firstOperand;
+                    operation.operandCount = quint32(compiledContent.operands.size()) - firstOperand;
 
-                        QByteArray buffer = content.mid(startDataPosition, dataLength);
-                        PDFStream imageStream(std::move(*dictionary), std::move(buffer));
-                        paintXObjectImage(&imageStream);
+                    if (operation.op == Operator::InlineImageBegin)
+                    {
+                        operation.dataIndex = quint32(compiledContent.inlineImages.size());
+                        compiledContent.inlineImages.emplace_back(std::make_shared<PDFStream>(createInlineImageStream(parser, content)));
+                        compiledContent.memoryConsumptionEstimate += compiledContent.inlineImages.back()->getContent()->size();
                     }
-                    else
+                    else if (operation.op == Operator::Invalid)
                     {
-                        // Process the command, then clear the operand stack
-                        processCommand(command);
+                        operation.dataIndex = quint32(compiledContent.invalidCommands.size());
+                        compiledContent.invalidCommands.emplace_back(token.getByteArray());
                     }
 
-                    m_operands.clear();
+                    operation.contentBegin = operationBegin;
+                    operation.contentEnd = quint32(parser.pos());
+                    operationBegin = operation.contentEnd;
+
+                    compiledContent.operations.push_back(operation);
+                    firstOperand = quint32(compiledContent.operands.size());
                     break;
                 }
 
@@ -712,8 +786,10 @@ void PDFPageContentProcessor::processContent(const QByteArray& content)
 
                 default:
                 {
-                    // Push the operand onto the operand stack
-                    m_operands.push_back(std::move(token));
+                    // Operands must not refer to the content, compiled content can outlive it
+                    token.detach();
+                    compiledContent.memoryConsumptionEstimate += token.buffer.size();
+                    compiledContent.operands.push_back(std::move(token));
                     break;
                 }
             }
@@ -727,14 +803,85 @@ void PDFPageContentProcessor::processContent(const QByteArray& content)
                 parser.seek(parser.pos() + 1);
             }
 
-            m_operands.clear();
+            // Operands of the failed operation are discarded
+            compiledContent.operands.resize(firstOperand);
+            compiledContent.errors.append(PDFRenderError(RenderErrorType::Error, exception.getMessage()));
+        }
+    }
+
+    compiledContent.trailingOperandCount = quint32(compiledContent.operands.size()) - firstOperand;
+
+    compiledContent.operations.shrink_to_fit();
+    compiledContent.operands.shrink_to_fit();
+    compiledContent.memoryConsumptionEstimate += sizeof(PDFCompiledContentStream);
+    compiledContent.memoryConsumptionEstimate += compiledContent.operations.size() * sizeof(PDFCompiledContentStream::Operation);
+    compiledContent.memoryConsumptionEstimate += compiledContent.operands.size() * sizeof(PDFLexicalAnalyzer::TypedToken);
+    return compiledContent;
+}
+
+void PDFPageContentProcessor::processCompiledContent(const PDFCompiledContentStream& compiledContent)
+{
+    m_errorList.append(compiledContent.errors);
+
+    ++m_compiledContentNestingLevel;
+    auto nestingLevelGuard = qScopeGuard([this](){ --m_compiledContentNestingLevel; });
+    const bool isPageContentStream = m_compiledContentNestingLevel == 1 && m_contentStreamIndex >= 0;
+
+    for (const PDFCompiledContentStream::Operation& operation : compiledContent.operations)
+    {
+        if (isProcessingCancelled())
+        {
+            break;
+        }
+
+        if (isPageContentStream)
+        {
+            m_currentOperationRange = ContentStreamRange{ m_contentStreamIndex, operation.contentBegin, operation.contentEnd };
+        }
+
+        try
+        {
+            for (quint32 i = 0; i < operation.operandCount; ++i)
+            {
+                m_operands.push_back(compiledContent.operands[operation.firstOperand + i]);
+            }
+
+            switch (operation.op)
+            {
+                case Operator::InlineImageBegin:
+                    paintXObjectImage(compiledContent.inlineImages[operation.dataIndex].get());
+                    break;
+
+                case Operator::Invalid:
+                    processOperator(operation.op, compiledContent.invalidCommands[operation.dataIndex]);
+                    break;
+
+                default:
+                    processOperator(operation.op, getOperatorCommand(operation.op));
+                    break;
+            }
+        }
+        catch (const PDFException& exception)
+        {
             m_errorList.append(PDFRenderError(RenderErrorType::Error, exception.getMessage()));
         }
         catch (const PDFRendererException &exception)
         {
-            m_operands.clear();
             m_errorList.append(exception.getError());
         }
+
+        m_operands.clear();
+    }
+
+    if (isPageContentStream)
+    {
+        m_currentOperationRange = ContentStreamRange();
+    }
+
+    // Operands may remain on the operand stack, when content is split into more content streams
+    for (size_t i = compiledContent.operands.size() - compiledContent.trailingOperandCount; i < compiledContent.operands.size(); ++i)
+    {
+        m_operands.push_back(compiledContent.operands[i]);
     }
 }
 
@@ -742,9 +889,7 @@ void PDFPageContentProcessor::processContentStream(const PDFStream* stream)
 {
     try
     {
-        QByteArray content = m_document->getDecodedStream(stream);
-
-        processContent(content);
+        processCompiledContent(*getCompiledContentStream(stream));
     }
     catch (const PDFException& exception)
     {
@@ -753,6 +898,12 @@ void PDFPageContentProcessor::processContentStream(const PDFStream* stream)
     }
 }
 
+std::shared_ptr<const PDFCompiledContentStream> PDFPageContentProcessor::getCompiledContentStream(const PDFStream* stream) const
+{
+    auto compile = [this, stream]() { return std::make_shared<const PDFCompiledContentStream>(compileContent(m_document->getDecodedStream(stream))); };
+    return m_document->getCompiledContentStreamCache()->getCompiledContentStream(stream, compile);
+}
+
 void PDFPageContentProcessor::processForm(const QTransform& matrix,
                                           const QRectF& boundingBox,
                                           const PDFObject& resources,
@@ -766,6 +917,22 @@ void PDFPageContentProcessor::processForm(const QTransform& matrix,
         return;
     }
 
+    processForm(matrix, boundingBox, resources, transparencyGroup, compileContent(content), formStructuralParent);
+}
+
+void PDFPageContentProcessor::processForm(const QTransform& matrix,
+                                          const QRectF& boundingBox,
+                                          const PDFObject& resources,
+                                          const PDFObject& transparencyGroup,
+                                          const PDFCompiledContentStream& compiledContent,
+                                          PDFInteger formStructuralParent)
+{
+    if (isContentKindSuppressed(ContentKind::Forms))
+    {
+        // Process of forms is suppressed
+        return;
+    }
+
     PDFPageContentProcessorStateGuard guard(this);
     PDFTemporaryValueChange structuralParentChangeGuard(&m_structuralParentKey, formStructuralParent);
 
@@ -815,7 +982,7 @@ void PDFPageContentProcessor::processForm(const QTransform& matrix,
         initDictionaries(resources);
     }
 
-    processContent(content);
+    processCompiledContent(compiledContent);
 }
 
 void PDFPageContentProcessor::processPathPainting(const QPainterPath& path, bool stroke, bool fill, bool text, Qt::FillRule fillRule)
@@ -880,7 +1047,7 @@ void PDFPageContentProcessor::processPathPainting(const QPainterPath& path, bool
 
                         if (!performPathPaintingUsingShading(path, false, true, shadingPattern))
                         {
-                            PDFMesh mesh = shadingPattern->createMesh(settings, m_CMS, m_graphicState.getRenderingIntent(), this, m_operationControl);
+                            PDFMesh mesh = createShadingMesh(shadingPattern, settings);
 
                             // Now, merge the current path to the mesh clipping path
                             QPainterPath boundingPath = mesh.getBoundingPath();
@@ -995,7 +1162,7 @@ void PDFPageContentProcessor::processPathPainting(const QPainterPath& path, bool
 
                         if (!performPathPaintingUsingShading(strokedPath, true, false, shadingPattern))
                         {
-                            PDFMesh mesh = shadingPattern->createMesh(settings, m_CMS, m_graphicState.getRenderingIntent(), this, m_operationControl);
+                            PDFMesh mesh = createShadingMesh(shadingPattern, settings);
 
                             QPainterPath boundingPath = mesh.getBoundingPath();
                             if (boundingPath.isEmpty())
@@ -1047,6 +1214,74 @@ void PDFPageContentProcessor::processTillingPatternPainting(const PDFTilingPatte
     PDFPageContentProcessorStateGuard guard(this);
     performClipping(path, path.fillRule());
 
+    Q_ASSERT(m_pagePointToDevicePointMatrix.isInvertible());
+
+    // Initialize rendering matrix
+    QTransform patternMatrix = tilingPattern->getMatrix() * getPatternBaseMatrix();
+    QTransform matrix = patternMatrix * m_pagePointToDevicePointMatrix.inverted();
+    QTransform pathTransformationMatrix = m_graphicState.getCurrentTransformationMatrix() * matrix.inverted();
+    const QRectF tilingArea = pathTransformationMatrix.map(path).boundingRect();
+
+    if (processTilingPatternImagePainting(tilingPattern, tilingArea, patternMatrix, uncoloredPatternColorSpace, uncoloredPatternColor))
+    {
+        return;
+    }
+
+    // Mark uncolored flag, if we drawing uncolored color pattern
+    const int uncoloredTilingPatternFlag = initializeTilingPatternState(tilingPattern, patternMatrix, uncoloredPatternColorSpace, uncoloredPatternColor);
+    PDFTemporaryValueChange guard2(&m_drawingUncoloredTilingPatternState, m_drawingUncoloredTilingPatternState + uncoloredTilingPatternFlag);
+
+    // Tiling parameters
+    const QRectF boundingBox = tilingPattern->getBoundingBox();
+    const PDFReal xStep = qAbs(tilingPattern->getXStep());
+    const PDFReal yStep = qAbs(tilingPattern->getYStep());
+    // Pattern cell is painted repeatedly, so its content is parsed only once
+    const PDFCompiledContentStream compiledContent = compileContent(tilingPattern->getContent());
+    QPainterPath boundingPath;
+    boundingPath.addRect(boundingBox);
+
+    // Draw the tiling
+    const PDFInteger columns = qMax<PDFInteger>(qCeil(tilingArea.width() / xStep), 1);
+    const PDFInteger rows = qMax<PDFInteger>(qCeil(tilingArea.height() / yStep), 1);
+
+    QTransform baseTransformationMatrix = m_graphicState.getCurrentTransformationMatrix();
+    for (PDFInteger column = 0; column < columns; ++column)
+    {
+        for (PDFInteger row = 0; row < rows; ++row)
+        {
+            PDFPageContentProcessorGraphicStateSaveRestoreGuard guard3(this);
+
+            QTransform transformationMatrix = baseTransformationMatrix;
+            transformationMatrix.translate(tilingArea.left(), tilingArea.top());
+            transformationMatrix.translate(column * xStep, row * yStep);
+
+            QTransform currentPatternMatrix = transformationMatrix * m_pagePointToDevicePointMatrix;
+            PDFTemporaryValueChange patternMatrixGuard(&m_patternBaseMatrix, currentPatternMatrix);
+
+            m_graphicState.setCurrentTransformationMatrix(transformationMatrix);
+            updateGraphicState();
+
+            performClipping(boundingPath, boundingPath.fillRule());
+            processCompiledContent(compiledContent);
+
+            if (isProcessingCancelled())
+            {
+                break;
+            }
+        }
+
+        if (isProcessingCancelled())
+        {
+            break;
+        }
+    }
+}
+
+int PDFPageContentProcessor::initializeTilingPatternState(const PDFTilingPattern* tilingPattern,
+                                                          const QTransform& patternMatrix,
+                                                          const PDFColorSpacePointer& uncoloredPatternColorSpace,
+                                                          const PDFColor& uncoloredPatternColor)
+{
     // Initialize resources
     const PDFObject& resources = tilingPattern->getResources();
     if (!resources.isNull())
@@ -1054,13 +1289,7 @@ void PDFPageContentProcessor::processTillingPatternPainting(const PDFTilingPatte
         initDictionaries(resources);
     }
 
-    Q_ASSERT(m_pagePointToDevicePointMatrix.isInvertible());
-
-    // Initialize rendering matrix
-    QTransform patternMatrix = tilingPattern->getMatrix() * getPatternBaseMatrix();
-    QTransform matrix = patternMatrix * m_pagePointToDevicePointMatrix.inverted();
-    QTransform pathTransformationMatrix = m_graphicState.getCurrentTransformationMatrix() * matrix.inverted();
-    m_graphicState.setCurrentTransformationMatrix(matrix);
+    m_graphicState.setCurrentTransformationMatrix(patternMatrix * m_pagePointToDevicePointMatrix.inverted());
 
     int uncoloredTilingPatternFlag = 0;
 
@@ -1093,70 +1322,183 @@ void PDFPageContentProcessor::processTillingPatternPainting(const PDFTilingPatte
     }
 
     updateGraphicState();
+    return uncoloredTilingPatternFlag;
+}
 
-    // Mark uncolored flag, if we drawing uncolored color pattern
+void PDFPageContentProcessor::processTilingPatternCell(const PDFTilingPattern* tilingPattern,
+                                                       const QTransform& patternToDeviceMatrix,
+                                                       PDFColorSpacePointer uncoloredPatternColorSpace,
+                                                       PDFColor uncoloredPatternColor)
+{
+    PDFPageContentProcessorStateGuard guard(this);
+
+    const int uncoloredTilingPatternFlag = initializeTilingPatternState(tilingPattern, patternToDeviceMatrix, uncoloredPatternColorSpace, uncoloredPatternColor);
     PDFTemporaryValueChange guard2(&m_drawingUncoloredTilingPatternState, m_drawingUncoloredTilingPatternState + uncoloredTilingPatternFlag);
+    PDFTemporaryValueChange patternMatrixGuard(&m_patternBaseMatrix, patternToDeviceMatrix);
 
-    // Tiling parameters
-    const QRectF tilingArea = pathTransformationMatrix.map(path).boundingRect();
+    QPainterPath boundingPath;
+    boundingPath.addRect(tilingPattern->getBoundingBox());
+    performClipping(boundingPath, boundingPath.fillRule());
+    processCompiledContent(compileContent(tilingPattern->getContent()));
+}
+
+bool PDFPageContentProcessor::processTilingPatternImagePainting(const PDFTilingPattern* tilingPattern,
+                                                                const QRectF& tilingArea,
+                                                                const QTransform& patternMatrix,
+                                                                const PDFColorSpacePointer& uncoloredPatternColorSpace,
+                                                                const PDFColor& uncoloredPatternColor)
+{
     const QRectF boundingBox = tilingPattern->getBoundingBox();
     const PDFReal xStep = qAbs(tilingPattern->getXStep());
     const PDFReal yStep = qAbs(tilingPattern->getYStep());
-    const QByteArray& content = tilingPattern->getContent();
-    QPainterPath boundingPath;
-    boundingPath.addRect(boundingBox);
 
-    // Draw the tiling
-    const PDFInteger columns = qMax<PDFInteger>(qCeil(tilingArea.width() / xStep), 1);
-    const PDFInteger rows = qMax<PDFInteger>(qCeil(tilingArea.height() / yStep), 1);
-
-    QTransform baseTransformationMatrix = m_graphicState.getCurrentTransformationMatrix();
-    for (PDFInteger column = 0; column < columns; ++column)
+    // Pattern cell image can be used only, if pattern cells do not overlap, pattern
+    // space is not rotated or skewed in the device space, and there are enough tiles.
+    // Pattern content is painted with its own graphic state, so we also require
+    // transparency of the current graphic state to be trivial.
+    if (xStep <= 0.0 || yStep <= 0.0 ||
+        boundingBox.width() > xStep * (1.0 + TILING_PATTERN_IMAGE_TOLERANCE) ||
+        boundingBox.height() > yStep * (1.0 + TILING_PATTERN_IMAGE_TOLERANCE) ||
+        !qFuzzyIsNull(patternMatrix.m12()) || !qFuzzyIsNull(patternMatrix.m21()) ||
+        tilingArea.width() * tilingArea.height() < xStep * yStep * TILING_PATTERN_IMAGE_MIN_TILES ||
+        m_graphicState.getAlphaFilling() != 1.0 || m_graphicState.getAlphaStroking() != 1.0 ||
+        m_graphicState.getBlendMode() != BlendMode::Normal || m_graphicState.getSoftMask())
     {
-        for (PDFInteger row = 0; row < rows; ++row)
-        {
-            PDFPageContentProcessorGraphicStateSaveRestoreGuard guard3(this);
+        return false;
+    }
 
-            QTransform transformationMatrix = baseTransformationMatrix;
-            transformationMatrix.translate(tilingArea.left(), tilingArea.top());
-            transformationMatrix.translate(column * xStep, row * yStep);
+    // Cell must be large enough in device space, otherwise image of the cell would
+    // be imprecise. Too large cells don't need the image, there are not many tiles.
+    const PDFReal cellWidth = xStep * qAbs(patternMatrix.m11());
+    const PDFReal cellHeight = yStep * qAbs(patternMatrix.m22());
+    if (cellWidth < TILING_PATTERN_IMAGE_MIN_CELL_SIZE || cellHeight < TILING_PATTERN_IMAGE_MIN_CELL_SIZE ||
+        cellWidth > TILING_PATTERN_IMAGE_MAX_CELL_SIZE || cellHeight > TILING_PATTERN_IMAGE_MAX_CELL_SIZE)
+    {
+        return false;
+    }
 
-            QTransform currentPatternMatrix = transformationMatrix * m_pagePointToDevicePointMatrix;
-            PDFTemporaryValueChange patternMatrixGuard(&m_patternBaseMatrix, currentPatternMatrix);
+    // Painted area in device space is limited by the page and by the painted path
+    const QRectF deviceArea = patternMatrix.mapRect(tilingArea).intersected(getPageBoundingRectDeviceSpace());
+    const QRect imageArea = deviceArea.toAlignedRect();
+    if (imageArea.isEmpty())
+    {
+        // Nothing is visible
+        return true;
+    }
 
-            m_graphicState.setCurrentTransformationMatrix(transformationMatrix);
-            updateGraphicState();
+    if (qint64(imageArea.width()) * qint64(imageArea.height()) > TILING_PATTERN_IMAGE_MAX_AREA_PIXELS)
+    {
+        return false;
+    }
 
-            performClipping(boundingPath, boundingPath.fillRule());
-            processContent(content);
+    // Image of the cell covers the cell rectangle starting at the origin of the bounding box,
+    // each cell's content is clipped to the bounding box, which is inside this rectangle.
+    const QSize cellImageSize(qCeil(cellWidth), qCeil(cellHeight));
+    const QRectF cellRect(boundingBox.left(), boundingBox.top(), xStep, yStep);
+    QTransform patternToImageMatrix = QTransform::fromTranslate(-cellRect.left(), -cellRect.top());
+    patternToImageMatrix *= QTransform::fromScale(cellImageSize.width() / xStep, cellImageSize.height() / yStep);
 
-            if (isProcessingCancelled())
-            {
-                break;
-            }
-        }
+    QRgb uncoloredColor = 0;
+    if (tilingPattern->getPaintingType() == PDFTilingPattern::PaintType::Uncolored && uncoloredPatternColorSpace)
+    {
+        uncoloredColor = uncoloredPatternColorSpace->getCheckedColor(uncoloredPatternColor, m_CMS, m_graphicState.getRenderingIntent(), this).rgba();
+    }
 
-        if (isProcessingCancelled())
+    const QByteArray& content = tilingPattern->getContent();
+    const TilingPatternCellImageKey key(content.constData(), cellImageSize.width(), cellImageSize.height(), uncoloredColor);
+    auto it = m_tilingPatternCellImages.find(key);
+    if (it == m_tilingPatternCellImages.cend())
+    {
+        QImage cellImage = performTilingPatternCellRendering(tilingPattern, patternToImageMatrix, cellImageSize, uncoloredPatternColorSpace, uncoloredPatternColor);
+        if (cellImage.isNull())
         {
-            break;
+            return false;
         }
+
+        // Content is stored in the entry, so its data can't be reused by another pattern
+        it = m_tilingPatternCellImages.emplace(key, TilingPatternCellImage{ content, qMove(cellImage) }).first;
+    }
+
+    // Fill the painted area with repeated image of the cell. First tile is placed
+    // at the top left corner of the tiling area, as in the tile by tile painting.
+    QTransform cellImageToAreaImageMatrix = patternToImageMatrix.inverted();
+    cellImageToAreaImageMatrix *= QTransform::fromTranslate(tilingArea.left(), tilingArea.top());
+    cellImageToAreaImageMatrix *= patternMatrix;
+    cellImageToAreaImageMatrix *= QTransform::fromTranslate(-imageArea.left(), -imageArea.top());
+
+    QImage areaImage(imageArea.size(), QImage::Format_ARGB32_Premultiplied);
+    areaImage.fill(Qt::transparent);
+
+    {
+        QBrush brush(it->second.image);
+        brush.setTransform(cellImageToAreaImageMatrix);
+
+        QPainter painter(&areaImage);
+        painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
+        painter.fillRect(areaImage.rect(), brush);
     }
+
+    // Image is painted to the unit square, y axis of the image goes in opposite
+    // direction than y axis of the device space.
+    PDFPageContentProcessorGraphicStateSaveRestoreGuard guard(this);
+    const QTransform unitSquareToDeviceMatrix(imageArea.width(), 0.0, 0.0, -imageArea.height(), imageArea.left(), imageArea.top() + imageArea.height());
+    m_graphicState.setCurrentTransformationMatrix(unitSquareToDeviceMatrix * m_pagePointToDevicePointMatrix.inverted());
+    updateGraphicState();
+    performImagePainting(areaImage);
+    return true;
 }
 
-void PDFPageContentProcessor::processCommand(const QByteArray& command)
+QImage PDFPageContentProcessor::performTilingPatternCellRendering(const PDFTilingPattern* tilingPattern,
+                                                                  const QTransform& patternToImageMatrix,
+                                                                  QSize imageSize,
+                                                                  const PDFColorSpacePointer& uncoloredPatternColorSpace,
+                                                                  const PDFColor& uncoloredPatternColor)
 {
-    Operator op = Operator::Invalid;
+    Q_UNUSED(tilingPattern);
+    Q_UNUSED(patternToImageMatrix);
+    Q_UNUSED(imageSize);
+    Q_UNUSED(uncoloredPatternColorSpace);
+    Q_UNUSED(uncoloredPatternColor);
 
+    return QImage();
+}
+
+PDFPageContentProcessor::Operator PDFPageContentProcessor::getOperator(QByteArrayView command)
+{
     // Find the command in the command array
     for (const std::pair<const char*, PDFPageContentProcessor::Operator>& operatorDescriptor : operators)
     {
         if (command == operatorDescriptor.first)
         {
-            op = operatorDescriptor.second;
-            break;
+            return operatorDescriptor.second;
         }
     }
 
+    return Operator::Invalid;
+}
+
+QByteArray PDFPageContentProcessor::getOperatorCommand(Operator op)
+{
+    static const std::array<QByteArray, size_t(Operator::Invalid)> commands = []()
+    {
+        std::array<QByteArray, size_t(Operator::Invalid)> result;
+        for (const std::pair<const char*, PDFPageContentProcessor::Operator>& operatorDescriptor : operators)
+        {
+            result[size_t(operatorDescriptor.second)] = QByteArray::fromRawData(operatorDescriptor.first, int(qstrlen(operatorDescriptor.first)));
+        }
+        return result;
+    }();
+
+    return op < Operator::Invalid ? commands[size_t(op)] : QByteArray();
+}
+
+void PDFPageContentProcessor::processCommand(const QByteArray& command)
+{
+    processOperator(getOperator(command), command);
+}
+
+void PDFPageContentProcessor::processOperator(Operator op, const QByteArray& command)
+{
     performInterceptInstruction(op, ProcessOrder::BeforeOperation, command);
     auto callInterceptInstAtEnd = qScopeGuard([&, this](){ performInterceptInstruction(op, ProcessOrder::AfterOperation, command); });
 
@@ -2146,13 +2488,13 @@ PDFReal PDFPageContentProcessor::readOperand<PDFReal>(size_t index) const
 {
     if (index < m_operands.size())
     {
-        const PDFLexicalAnalyzer::Token& token = m_operands[index];
+        const PDFLexicalAnalyzer::TypedToken& token = m_operands[index];
 
         switch (token.type)
         {
             case PDFLexicalAnalyzer::TokenType::Real:
             case PDFLexicalAnalyzer::TokenType::Integer:
-                return token.data.value<PDFReal>();
+                return token.getNumber();
 
             default:
                 throw PDFRendererException(RenderErrorType::Error, PDFTranslationContext::tr("Can't read operand (real number) on index %1. Operand is of type '%2'.").arg(index + 1).arg(PDFLexicalAnalyzer::getStringFromOperandType(token.type)));
@@ -2169,12 +2511,12 @@ PDFInteger PDFPageContentProcessor::readOperand<PDFInteger>(size_t index) const
 {
     if (index < m_operands.size())
     {
-        const PDFLexicalAnalyzer::Token& token = m_operands[index];
+        const PDFLexicalAnalyzer::TypedToken& token = m_operands[index];
 
         switch (token.type)
         {
             case PDFLexicalAnalyzer::TokenType::Integer:
-                return token.data.value<PDFInteger>();
+                return token.integer;
 
             default:
                 throw PDFRendererException(RenderErrorType::Error, PDFTranslationContext::tr("Can't read operand (integer) on index %1. Operand is of type '%2'.").arg(index + 1).arg(PDFLexicalAnalyzer::getStringFromOperandType(token.type)));
@@ -2191,12 +2533,12 @@ PDFPageContentProcessor::PDFOperandName PDFPageContentProcessor::readOperand<PDF
 {
     if (index < m_operands.size())
     {
-        const PDFLexicalAnalyzer::Token& token = m_operands[index];
+        const PDFLexicalAnalyzer::TypedToken& token = m_operands[index];
 
         switch (token.type)
         {
             case PDFLexicalAnalyzer::TokenType::Name:
-                return PDFOperandName{ token.data.toByteArray() };
+                return PDFOperandName{ token.getByteArray() };
 
             default:
                 throw PDFRendererException(RenderErrorType::Error, PDFTranslationContext::tr("Can't read operand (name) on index %1. Operand is of type '%2'.").arg(index + 1).arg(PDFLexicalAnalyzer::getStringFromOperandType(token.type)));
@@ -2214,12 +2556,12 @@ PDFPageContentProcessor::PDFOperandString PDFPageContentProcessor::readOperand<P
 {
     if (index < m_operands.size())
     {
-        const PDFLexicalAnalyzer::Token& token = m_operands[index];
+        const PDFLexicalAnalyzer::TypedToken& token = m_operands[index];
 
         switch (token.type)
         {
             case PDFLexicalAnalyzer::TokenType::String:
-                return PDFOperandString{ token.data.toByteArray() };
+                return PDFOperandString{ token.getByteArray() };
 
             default:
                 throw PDFRendererException(RenderErrorType::Error, PDFTranslationContext::tr("Can't read operand (string) on index %1. Operand is of type '%2'.").arg(index + 1).arg(PDFLexicalAnalyzer::getStringFromOperandType(token.type)));
@@ -2400,7 +2742,7 @@ void PDFPageContentProcessor::operatorColorSetStrokingColorSpace(PDFPageContentP
         return;
     }
 
-    PDFColorSpacePointer colorSpace = PDFAbstractColorSpace::createColorSpace(m_colorSpaceDictionary, m_document, PDFObject::createName(name.name));
+    PDFColorSpacePointer colorSpace = getColorSpaceFromResources(name.name);
     if (colorSpace)
     {
         // We must also set default color (it can depend on the color space)
@@ -2423,7 +2765,7 @@ void PDFPageContentProcessor::operatorColorSetFillingColorSpace(PDFOperandName n
         return;
     }
 
-    PDFColorSpacePointer colorSpace = PDFAbstractColorSpace::createColorSpace(m_colorSpaceDictionary, m_document, PDFObject::createName(name.name));
+    PDFColorSpacePointer colorSpace = getColorSpaceFromResources(name.name);
     if (colorSpace)
     {
         // We must also set default color (it can depend on the color space)
@@ -2497,7 +2839,7 @@ void PDFPageContentProcessor::operatorColorSetStrokingColorN()
             if (m_patternDictionary && m_patternDictionary->hasKey(name.name))
             {
                 // Create the pattern
-                PDFPatternPtr pattern = PDFPattern::createPattern(m_colorSpaceDictionary, m_document, m_patternDictionary->get(name.name), m_CMS, m_graphicState.getRenderingIntent(), this);
+                PDFPatternPtr pattern = getPatternFromResources(name.name, false);
                 m_graphicState.setStrokeColorSpace(PDFColorSpacePointer(new PDFPatternColorSpace(qMove(pattern), qMove(uncoloredColorSpace), qMove(uncoloredPatternColor))));
                 updateGraphicState();
                 return;
@@ -2575,7 +2917,7 @@ void PDFPageContentProcessor::operatorColorSetFillingColorN()
             if (m_patternDictionary && m_patternDictionary->hasKey(name.name))
             {
                 // Create the pattern
-                PDFPatternPtr pattern = PDFPattern::createPattern(m_colorSpaceDictionary, m_document, m_patternDictionary->get(name.name), m_CMS, m_graphicState.getRenderingIntent(), this);
+                PDFPatternPtr pattern = getPatternFromResources(name.name, false);
                 m_graphicState.setFillColorSpace(QSharedPointer<PDFAbstractColorSpace>(new PDFPatternColorSpace(qMove(pattern), qMove(uncoloredColorSpace), qMove(uncoloredPatternColor))));
                 updateGraphicState();
                 return;
@@ -2853,7 +3195,7 @@ void PDFPageContentProcessor::operatorTextShowTextString(PDFOperandString text)
             throw PDFRendererException(RenderErrorType::Error, PDFTranslationContext::tr("Invalid font, text can't be printed."));
         }
 
-        TextSequence textSequence;
+        TextSequence textSequence(PDFThreadLocalArena::getResource());
 
         // We use simple heuristic to ensure reallocation doesn't occur too often
         textSequence.items.reserve(m_operands.size());
@@ -2884,7 +3226,7 @@ void PDFPageContentProcessor::operatorTextShowTextIndividualSpacing()
 
     if (m_graphicState.getTextFont())
     {
-        TextSequence textSequence;
+        TextSequence textSequence(PDFThreadLocalArena::getResource());
 
         // We use simple heuristic to ensure reallocation doesn't occur too often
         textSequence.items.reserve(m_operands.size() * 4);
@@ -2902,19 +3244,19 @@ void PDFPageContentProcessor::operatorTextShowTextIndividualSpacing()
             {
                 case PDFLexicalAnalyzer::TokenType::Integer:
                 {
-                    textSequence.items.push_back(TextSequenceItem(m_operands[i].data.value<PDFInteger>()));
+                    textSequence.items.push_back(TextSequenceItem(m_operands[i].integer));
                     break;
                 }
 
                 case PDFLexicalAnalyzer::TokenType::Real:
                 {
-                    textSequence.items.push_back(TextSequenceItem(m_operands[i].data.value<PDFReal>()));
+                    textSequence.items.push_back(TextSequenceItem(m_operands[i].real));
                     break;
                 }
 
                 case PDFLexicalAnalyzer::TokenType::String:
                 {
-                    realizedFont->fillTextSequence(m_operands[i].data.toByteArray(), textSequence, this);
+                    realizedFont->fillTextSequence(m_operands[i].getByteArray(), textSequence, this);
                     break;
                 }
 
@@ -2966,7 +3308,7 @@ void PDFPageContentProcessor::operatorShadingPaintShape(PDFPageContentProcessor:
         throw PDFRendererException(RenderErrorType::Error, PDFTranslationContext::tr("Shading '%1' not found.").arg(QString::fromLatin1(name.name)));
     }
 
-    PDFPatternPtr pattern = PDFPattern::createShadingPattern(m_colorSpaceDictionary, m_document, m_shadingDictionary->get(name.name), QTransform(), PDFObject(), m_CMS, m_graphicState.getRenderingIntent(), this, true);
+    PDFPatternPtr pattern = getPatternFromResources(name.name, true);
 
     // We will do a trick: we will set current fill color space, and then paint
     // bounding rectangle in the color pattern.
@@ -2991,6 +3333,12 @@ void PDFPageContentProcessor::paintXObjectImage(const PDFStream* stream)
         return;
     }
 
+    if (performImageXObjectPlacement(stream))
+    {
+        // Image is not needed by the processor
+        return;
+    }
+
     PDFColorSpacePointer colorSpace;
 
     const PDFDictionary* streamDictionary = stream->getDictionary();
@@ -3007,38 +3355,236 @@ void PDFPageContentProcessor::paintXObjectImage(const PDFStream* stream)
         }
     }
 
-    PDFImage pdfImage = PDFImage::createImage(m_document, stream, qMove(colorSpace), false, m_graphicState.getRenderingIntent(), this);
+    const PDFImageDecodeHints decodeHints = getImageDecodeHints();
+    auto createImage = [&](PDFImageCache::Image& image)
+    {
+        PDFImage pdfImage = PDFImage::createImage(m_document, stream, qMove(colorSpace), false, m_graphicState.getRenderingIntent(), this, decodeHints);
+        image.image = pdfImage.getImage(m_CMS, this, m_operationControl);
+        image.imageRect = pdfImage.getImageRect();
+
+        // Do not cache image, which wasn't completely converted
+        return !isProcessingCancelled();
+    };
+
+    PDFImageCache::Image image;
+    PDFImageCache* imageCache = m_document->getImageCache();
+    std::optional<PDFImageCache::Key> imageCacheKey;
+    if (isImageCacheUsed() && imageCache->getBudget() > 0)
+    {
+        imageCacheKey = createImageCacheKey(stream, decodeHints);
+    }
+
+    if (imageCacheKey)
+    {
+        image = imageCache->getImage(*imageCacheKey, createImage);
+    }
+    else
+    {
+        PDFImage pdfImage = PDFImage::createImage(m_document, stream, qMove(colorSpace), false, m_graphicState.getRenderingIntent(), this, decodeHints);
+        if (performOriginalImagePainting(pdfImage, stream))
+        {
+            return;
+        }
+
+        image.image = pdfImage.getImage(m_CMS, this, m_operationControl);
+        image.imageRect = pdfImage.getImageRect();
+    }
 
-    if (!performOriginalImagePainting(pdfImage, stream))
+    if (!isProcessingCancelled())
     {
-        QImage image = pdfImage.getImage(m_CMS, this, m_operationControl);
+        if (image.image.format() == QImage::Format_Alpha8)
+        {
+            QSize size = image.image.size();
+            QImage unmaskedImage(size, QImage::Format_ARGB32_Premultiplied);
+            unmaskedImage.fill(m_graphicState.getFillColor());
+            unmaskedImage.setAlphaChannel(image.image);
+            image.image = qMove(unmaskedImage);
+        }
 
-        if (!isProcessingCancelled())
+        if (!image.image.isNull())
         {
-            if (image.format() == QImage::Format_Alpha8)
+            if (PDFImage::canBeConvertedToMonochromatic(image.image))
             {
-                QSize size = image.size();
-                QImage unmaskedImage(size, QImage::Format_ARGB32_Premultiplied);
-                unmaskedImage.fill(m_graphicState.getFillColor());
-                unmaskedImage.setAlphaChannel(image);
-                image = qMove(unmaskedImage);
+                image.image.convertTo(QImage::Format_Mono);
             }
 
-            if (!image.isNull())
+            // If only part of the image was decoded, then it is painted into its part of the image space
+            const QRectF& imageRect = image.imageRect;
+            if (imageRect != QRectF(0.0, 0.0, 1.0, 1.0))
             {
-                if (PDFImage::canBeConvertedToMonochromatic(image))
-                {
-                    image.convertTo(QImage::Format_Mono);
-                }
-
-                performImagePainting(image);
+                PDFPageContentProcessorStateGuard guard(this);
+                QTransform imageRectMatrix(imageRect.width(), 0.0, 0.0, imageRect.height(), imageRect.left(), imageRect.top());
+                m_graphicState.setCurrentTransformationMatrix(imageRectMatrix * m_graphicState.getCurrentTransformationMatrix());
+                updateGraphicState();
+                performImagePainting(image.image);
             }
             else
             {
-                throw PDFRendererException(RenderErrorType::Error, PDFTranslationContext::tr("Can't decode the image."));
+                performImagePainting(image.image);
             }
         }
+        else
+        {
+            throw PDFRendererException(RenderErrorType::Error, PDFTranslationContext::tr("Can't decode the image."));
+        }
+    }
+}
+
+std::optional<PDFImageCache::Key> PDFPageContentProcessor::createImageCacheKey(const PDFStream* stream, const PDFImageDecodeHints& decodeHints) const
+{
+    // Default color spaces from resources replace device color spaces,
+    // so converted image depends on resources of the content stream.
+    if (m_colorSpaceDictionary &&
+        (m_colorSpaceDictionary->hasKey(COLOR_SPACE_NAME_DEFAULT_GRAY) ||
+         m_colorSpaceDictionary->hasKey(COLOR_SPACE_NAME_DEFAULT_RGB) ||
+         m_colorSpaceDictionary->hasKey(COLOR_SPACE_NAME_DEFAULT_CMYK)))
+    {
+        return std::nullopt;
+    }
+
+    // Named color space, which is not a device color space, is taken from resources
+    const PDFDictionary* dictionary = stream->getDictionary();
+    const PDFObject& colorSpaceObject = m_document->getObject(dictionary->get("ColorSpace"));
+    if (colorSpaceObject.isName())
+    {
+        const QByteArray& name = colorSpaceObject.getString();
+        if (name != COLOR_SPACE_NAME_DEVICE_GRAY && name != COLOR_SPACE_NAME_DEVICE_RGB && name != COLOR_SPACE_NAME_DEVICE_CMYK &&
+            name != COLOR_SPACE_NAME_ABBREVIATION_DEVICE_GRAY && name != COLOR_SPACE_NAME_ABBREVIATION_DEVICE_RGB && name != COLOR_SPACE_NAME_ABBREVIATION_DEVICE_CMYK)
+        {
+            return std::nullopt;
+        }
+    }
+
+    PDFDocumentDataLoaderDecorator loader(m_document);
+    const PDFInteger width = loader.readIntegerFromDictionary(dictionary, "Width", 0);
+    const PDFInteger height = loader.readIntegerFromDictionary(dictionary, "Height", 0);
+    if (width <= 0 || height <= 0 || width > std::numeric_limits<int>::max() || height > std::numeric_limits<int>::max())
+    {
+        return std::nullopt;
     }
+
+    PDFImageCache::Key key;
+    key.streamId = stream->getUniqueId();
+    key.cmsId = m_CMS ? m_CMS->getUniqueId() : 0;
+    key.renderingIntent = static_cast<int>(m_graphicState.getRenderingIntent());
+
+    // Decoded image depends on the decode hints only through the scale and the
+    // visible area of the image, so we use them (in pixels of the image) in the key.
+    const QSize imageSize(static_cast<int>(width), static_cast<int>(height));
+    key.scaleDenominator = PDFImage::getDownscaleDenominator(imageSize, decodeHints.targetSize, std::numeric_limits<int>::max());
+
+    if (decodeHints.visibleRect.isValid())
+    {
+        const QRectF visibleRect = decodeHints.visibleRect.intersected(QRectF(0.0, 0.0, 1.0, 1.0));
+        const QRect visibleArea(QPoint(qFloor(visibleRect.left() * width), qFloor((1.0 - visibleRect.bottom()) * height)),
+                                QPoint(qCeil(visibleRect.right() * width) - 1, qCeil((1.0 - visibleRect.top()) * height) - 1));
+        if (visibleArea != QRect(QPoint(0, 0), imageSize))
+        {
+            key.visibleArea = visibleArea;
+        }
+    }
+
+    return key;
+}
+
+PDFMesh PDFPageContentProcessor::createShadingMesh(const PDFShadingPattern* shadingPattern, const PDFMeshQualitySettings& settings)
+{
+    const PDFType4567Shading* type4567Shading = dynamic_cast<const PDFType4567Shading*>(shadingPattern);
+    PDFShadingMeshCache* meshCache = m_document->getShadingMeshCache();
+    const QTransform patternSpaceToDeviceSpaceMatrix = shadingPattern->getPatternSpaceToDeviceSpaceMatrix(settings);
+    const PDFReal scale = std::sqrt(std::abs(patternSpaceToDeviceSpaceMatrix.determinant()));
+
+    if (!type4567Shading || type4567Shading->getStreamId() == 0 || meshCache->getBudget() <= 0 ||
+        !patternSpaceToDeviceSpaceMatrix.isInvertible() || qFuzzyIsNull(scale) || settings.preferredMeshResolution <= 0.0)
+    {
+        return shadingPattern->createMesh(settings, m_CMS, m_graphicState.getRenderingIntent(), this, m_operationControl);
+    }
+
+    // Meshes are created in the device space, but the resolution is determined by the
+    // size of the meshing area. We use buckets of half of the octave of the preferred
+    // resolution in pattern space, so cached mesh differs from the requested resolution
+    // at most by the factor of square root of two.
+    const PDFReal patternSpaceResolution = settings.preferredMeshResolution / scale;
+
+    PDFShadingMeshCache::Key key;
+    key.streamId = type4567Shading->getStreamId();
+    key.cmsId = m_CMS ? m_CMS->getUniqueId() : 0;
+    key.renderingIntent = static_cast<int>(m_graphicState.getRenderingIntent());
+    key.resolutionBucket = qFloor(2.0 * std::log2(patternSpaceResolution));
+    key.minimalMeshResolutionRatio = settings.minimalMeshResolutionRatio;
+    key.preferredMeshResolutionRatio = settings.preferredMeshResolutionRatio;
+    key.tolerance = settings.tolerance;
+    key.patchTestPoints = settings.patchTestPoints;
+    key.patchResolutionMappingRatioLow = settings.patchResolutionMappingRatioLow;
+    key.patchResolutionMappingRatioHigh = settings.patchResolutionMappingRatioHigh;
+
+    auto createMesh = [&](PDFShadingMeshCache::Mesh& mesh)
+    {
+        mesh.mesh = std::make_shared<const PDFMesh>(shadingPattern->createMesh(settings, m_CMS, m_graphicState.getRenderingIntent(), this, m_operationControl));
+        mesh.patternSpaceToDeviceSpaceMatrix = patternSpaceToDeviceSpaceMatrix;
+
+        // Do not cache mesh, which wasn't completely created
+        return !isProcessingCancelled();
+    };
+
+    PDFShadingMeshCache::Mesh cachedMesh = meshCache->getMesh(key, createMesh);
+    PDFMesh mesh = *cachedMesh.mesh;
+
+    if (cachedMesh.patternSpaceToDeviceSpaceMatrix != patternSpaceToDeviceSpaceMatrix)
+    {
+        mesh.transform(cachedMesh.patternSpaceToDeviceSpaceMatrix.inverted() * patternSpaceToDeviceSpaceMatrix);
+    }
+
+    // Background is painted over the meshing area, which is not transformed
+    // together with the mesh. Also, background can be ignored by the pattern.
+    const QColor& backgroundColor = shadingPattern->getBackgroundColor();
+    QPainterPath backgroundPath;
+    if (backgroundColor.isValid())
+    {
+        backgroundPath.addRect(settings.deviceSpaceMeshingArea);
+    }
+    mesh.setBackgroundPath(qMove(backgroundPath));
+    mesh.setBackgroundColor(backgroundColor);
+
+    return mesh;
+}
+
+PDFColorSpacePointer PDFPageContentProcessor::getColorSpaceFromResources(const QByteArray& name)
+{
+    PDFResourceCache::Key key;
+    key.type = PDFResourceCache::ResourceType::ColorSpace;
+    key.dictionary = m_colorSpaceDictionary;
+    key.name = name;
+
+    auto createColorSpace = [this, &name]()
+    {
+        return PDFAbstractColorSpace::createColorSpace(m_colorSpaceDictionary, m_document, PDFObject::createName(name));
+    };
+
+    return m_document->getResourceCache()->getColorSpace(key, createColorSpace);
+}
+
+PDFPatternPtr PDFPageContentProcessor::getPatternFromResources(const QByteArray& name, bool isShading)
+{
+    PDFResourceCache::Key key;
+    key.type = isShading ? PDFResourceCache::ResourceType::Shading : PDFResourceCache::ResourceType::Pattern;
+    key.dictionary = isShading ? m_shadingDictionary : m_patternDictionary;
+    key.colorSpaceDictionary = m_colorSpaceDictionary;
+    key.name = name;
+    key.cmsId = m_CMS ? m_CMS->getUniqueId() : 0;
+    key.renderingIntent = static_cast<int>(m_graphicState.getRenderingIntent());
+
+    auto createPattern = [&]()
+    {
+        if (isShading)
+        {
+            return PDFPattern::createShadingPattern(m_colorSpaceDictionary, m_document, m_shadingDictionary->get(name), QTransform(), PDFObject(), m_CMS, m_graphicState.getRenderingIntent(), this, true);
+        }
+
+        return PDFPattern::createPattern(m_colorSpaceDictionary, m_document, m_patternDictionary->get(name), m_CMS, m_graphicState.getRenderingIntent(), this);
+    };
+
+    return m_document->getResourceCache()->getPattern(key, createPattern);
 }
 
 void PDFPageContentProcessor::reportWarningAboutColorOperatorsInUTP()
@@ -3054,6 +3600,14 @@ void PDFPageContentProcessor::processForm(const PDFStream* stream)
         return;
     }
 
+    if (performProcessForm(ProcessOrder::BeforeOperation, stream))
+    {
+        // Form was already painted by the processor
+        return;
+    }
+
+    auto processFormAtEnd = qScopeGuard([this, stream](){ performProcessForm(ProcessOrder::AfterOperation, stream); });
+
     PDFDocumentDataLoaderDecorator loader(getDocument());
     const PDFDictionary* streamDictionary = stream->getDictionary();
 
@@ -3063,8 +3617,8 @@ void PDFPageContentProcessor::processForm(const PDFStream* stream)
     // Read the transformation matrix, if it is present
     QTransform transformationMatrix = loader.readMatrixFromDictionary(streamDictionary, "Matrix", QTransform());
 
-    // Read the dictionary content
-    QByteArray content = m_document->getDecodedStream(stream);
+    // Read the compiled dictionary content
+    std::shared_ptr<const PDFCompiledContentStream> compiledContent = getCompiledContentStream(stream);
 
     // Read resources
     PDFObject resources = m_document->getObject(streamDictionary->get("Resources"));
@@ -3075,7 +3629,7 @@ void PDFPageContentProcessor::processForm(const PDFStream* stream)
     // Form structural parent key
     const PDFInteger formStructuralParentKey = loader.readIntegerFromDictionary(streamDictionary, "StructParent", m_structuralParentKey);
 
-    processForm(transformationMatrix, boundingBox, resources, transparencyGroup, content, formStructuralParentKey);
+    processForm(transformationMatrix, boundingBox, resources, transparencyGroup, *compiledContent, formStructuralParentKey);
 }
 
 void PDFPageContentProcessor::operatorPaintXObject(PDFOperandName name)
@@ -3092,12 +3646,17 @@ void PDFPageContentProcessor::operatorPaintXObject(PDFOperandName name)
             const PDFDictionary* streamDictionary = stream->getDictionary();
 
             // According to the specification, XObjects are skipped entirely, as no operator was invoked.
+            PDFObjectReference deferredOptionalContent;
             if (streamDictionary->hasKey("OC"))
             {
                 const PDFObject& optionalContentObject = streamDictionary->get("OC");
                 if (optionalContentObject.isReference())
                 {
-                    if (isContentSuppressedByOC(optionalContentObject.getReference()))
+                    if (isOptionalContentDeferred())
+                    {
+                        deferredOptionalContent = optionalContentObject.getReference();
+                    }
+                    else if (isContentSuppressedByOC(optionalContentObject.getReference()))
                     {
                         return;
                     }
@@ -3108,6 +3667,18 @@ void PDFPageContentProcessor::operatorPaintXObject(PDFOperandName name)
                 }
             }
 
+            if (deferredOptionalContent.isValid())
+            {
+                performOptionalContentBegin(deferredOptionalContent);
+            }
+            auto optionalContentEnd = qScopeGuard([this, &deferredOptionalContent]()
+            {
+                if (deferredOptionalContent.isValid())
+                {
+                    performOptionalContentEnd();
+                }
+            });
+
             PDFDocumentDataLoaderDecorator loader(m_document);
             QByteArray subtype = loader.readNameFromDictionary(streamDictionary, "Subtype");
             if (subtype == "Image")
@@ -3170,7 +3741,15 @@ void PDFPageContentProcessor::operatorMarkedContentBeginWithProperties(PDFOperan
             }
         }
 
-        m_markedContentStack.emplace_back(name.name, MarkedContentKind::OptionalContent, isContentSuppressedByOC(ocg));
+        if (isOptionalContentDeferred())
+        {
+            m_markedContentStack.emplace_back(name.name, MarkedContentKind::OptionalContent, false);
+            performOptionalContentBegin(ocg);
+        }
+        else
+        {
+            m_markedContentStack.emplace_back(name.name, MarkedContentKind::OptionalContent, isContentSuppressedByOC(ocg));
+        }
     }
     else
     {
@@ -3187,8 +3766,14 @@ void PDFPageContentProcessor::operatorMarkedContentEnd()
         throw PDFRendererException(RenderErrorType::Error, PDFTranslationContext::tr("Mismatched begin/end of marked content."));
     }
 
+    const bool isOptionalContentEnd = m_markedContentStack.back().kind == MarkedContentKind::OptionalContent && isOptionalContentDeferred();
     m_markedContentStack.pop_back();
     performMarkedContentEnd();
+
+    if (isOptionalContentEnd)
+    {
+        performOptionalContentEnd();
+    }
 }
 
 void PDFPageContentProcessor::operatorCompatibilityBegin()
@@ -3271,6 +3856,19 @@ void PDFPageContentProcessor::drawText(const TextSequence& textSequence)
                         if (!glyphPath.isEmpty())
                         {
                             QPainterPath transformedGlyph = textRenderingMatrix.map(glyphPath);
+
+                            PDFGlyphAtlasGlyph glyph;
+                            if (fill && !stroke && font->getGlyphAtlas())
+                            {
+                                // Glyph can be drawn using glyph atlas of the realized font
+                                glyph.atlas = font->getGlyphAtlas();
+                                glyph.outline = glyphPath;
+                                glyph.matrix = textRenderingMatrix;
+                                glyph.glyphId = reinterpret_cast<quintptr>(item.glyph);
+                            }
+
+                            const PDFGlyphAtlasGlyph* previousPaintedGlyph = std::exchange(m_paintedGlyph, glyph.isValid() ? &glyph : nullptr);
+                            auto paintedGlyphGuard = qScopeGuard([this, previousPaintedGlyph]() { m_paintedGlyph = previousPaintedGlyph; });
                             processPathPainting(transformedGlyph, stroke, fill, true, transformedGlyph.fillRule());
 
                             if (clipped)
@@ -3363,7 +3961,10 @@ void PDFPageContentProcessor::drawText(const TextSequence& textSequence)
                     m_graphicState.setCurrentTransformationMatrix(worldMatrix);
                     updateGraphicState();
 
-                    processContent(*item.characterContentStream);
+                    // Glyph procedure is compiled only once, compiled procedure is shared by all pages
+                    auto compile = [this, &item]() { return std::make_shared<const PDFCompiledContentStream>(compileContent(*item.characterContentStream)); };
+                    std::shared_ptr<const PDFCompiledContentStream> compiledContent = parentFont->getCompiledContentStream(item.characterContentStream, compile);
+                    processCompiledContent(*compiledContent);
 
                     if (!item.character.isNull())
                     {
@@ -3427,7 +4028,7 @@ PDFObject PDFPageContentProcessor::readObjectFromOperandStack(size_t startPositi
         {
             return m_operands[startPosition++];
         }
-        return PDFLexicalAnalyzer::Token();
+        return PDFLexicalAnalyzer::TypedToken();
     };
 
     PDFParser parser(tokenFetcher);
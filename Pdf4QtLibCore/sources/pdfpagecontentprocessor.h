@@ -24,6 +24,7 @@
 #define PDFPAGECONTENTPROCESSOR_H
 
 #include "pdfrenderer.h"
+#include "pdfdocument.h"
 #include "pdfcolorspaces.h"
 #include "pdfparser.h"
 #include "pdffont.h"
@@ -38,6 +39,7 @@
 #include <QPainterPath>
 #include <QSharedPointer>
 
+#include <map>
 #include <stack>
 #include <tuple>
 #include <type_traits>
@@ -47,6 +49,7 @@ namespace pdf
 class PDFCMS;
 class PDFMesh;
 class PDFImage;
+struct PDFImageDecodeHints;
 class PDFTilingPattern;
 class PDFShadingPattern;
 class PDFOptionalContentActivity;
@@ -332,6 +335,8 @@ private:
     StateFlags m_stateFlags;
 };
 
+struct PDFCompiledContentStream;
+
 /// Process the contents of the page.
 class PDF4QTLIBCORESHARED_EXPORT PDFPageContentProcessor : public PDFRenderErrorReporter
 {
@@ -454,6 +459,17 @@ public:
         Invalid                             ///< Invalid operator, use for error reporting
     };
 
+    /// Range of the operation (its operands and operator) in the decoded page content stream
+    struct ContentStreamRange
+    {
+        PDFInteger contentStreamIndex = -1; ///< Index of the page content stream, -1 means invalid range
+        PDFInteger begin = 0;               ///< Offset of the first byte of the range
+        PDFInteger end = 0;                 ///< Offset after the last byte of the range
+
+        bool isValid() const { return contentStreamIndex >= 0; }
+        bool operator==(const ContentStreamRange&) const = default;
+    };
+
     enum ProcedureSet
     {
         EmptyProcSet    = 0x0000,
@@ -489,6 +505,29 @@ public:
                      const QByteArray& content,
                      PDFInteger formStructuralParent);
 
+    /// Processes form (XObject of type form)
+    /// \param Matrix Transformation matrix from form coordinate system to page coordinate system
+    /// \param boundingBox Bounding box, to which is drawed content clipped
+    /// \param resources Resources, assigned to the form
+    /// \param transparencyGroup Transparency group object
+    /// \param compiledContent Compiled content stream of the form
+    /// \param formStructuralParent Structural parent key for form
+    void processForm(const QTransform& matrix,
+                     const QRectF& boundingBox,
+                     const PDFObject& resources,
+                     const PDFObject& transparencyGroup,
+                     const PDFCompiledContentStream& compiledContent,
+                     PDFInteger formStructuralParent);
+
+    /// Returns operator for given command. If command is not valid
+    /// operator, then Operator::Invalid is returned.
+    /// \param command Command
+    static Operator getOperator(QByteArrayView command);
+
+    /// Returns command of the operator (Operator::Invalid has no command)
+    /// \param op Operator
+    static QByteArray getOperatorCommand(Operator op);
+
     /// Initialize stream processor for processing content streams. For example,
     /// graphic state is initialized to default, and default color spaces are initialized.
     void initializeProcessor();
@@ -619,6 +658,54 @@ protected:
     /// \returns true, if image is successfully processed
     virtual bool performOriginalImagePainting(const PDFImage& image, const PDFStream* stream);
 
+    /// This function is called before image XObject is decoded. If processor doesn't
+    /// need decoded image (for example, it only collects placements of images), it
+    /// should return true, then image is neither decoded nor painted. Default
+    /// implementation returns false.
+    /// \param stream Image XObject stream
+    virtual bool performImageXObjectPlacement(const PDFStream* stream);
+
+    /// Returns size of currently painted image in device pixels, if image can be
+    /// decoded at reduced resolution. Default implementation returns invalid size,
+    /// so images are always decoded at full resolution.
+    virtual QSize getImageTargetSize() const;
+
+    /// Returns decode hints of currently painted image. Decode hints are returned only, if
+    /// image can be decoded at reduced resolution (see \p getImageTargetSize), then also
+    /// visible part of the image (inside the page) is returned.
+    PDFImageDecodeHints getImageDecodeHints() const;
+
+    /// Returns true, if images converted to the device color space can be taken from
+    /// the image cache of the document. Processor using the cache must not process
+    /// original images (see \p performOriginalImagePainting), because cached images
+    /// are not decoded again. Default implementation returns false.
+    virtual bool isImageCacheUsed() const;
+
+    /// Implement to render one cell of the tiling pattern to the image. Image of the cell
+    /// is then repeated over the tiled area, so content stream of the pattern is not processed
+    /// for each tile. Patterns, which would lose precision, are always painted tile by tile.
+    /// If null image is returned, pattern is painted tile by tile. Default implementation
+    /// returns null image.
+    /// \param tilingPattern Tiling pattern
+    /// \param patternToImageMatrix Matrix mapping pattern space to pixels of the image
+    /// \param imageSize Size of the image
+    /// \param uncoloredPatternColorSpace Color space for uncolored color patterns
+    /// \param uncoloredPatternColor Uncolored color pattern color
+    virtual QImage performTilingPatternCellRendering(const PDFTilingPattern* tilingPattern,
+                                                     const QTransform& patternToImageMatrix,
+                                                     QSize imageSize,
+                                                     const PDFColorSpacePointer& uncoloredPatternColorSpace,
+                                                     const PDFColor& uncoloredPatternColor);
+
+    /// This function is called before and after the form XObject stream is processed.
+    /// Processor can paint the form itself before the processing (for example, by reusing
+    /// output of a previous invocation of the same form), then it should return true,
+    /// and form content stream is not processed at all. Return value is ignored
+    /// after the processing. Default implementation returns false.
+    /// \param order Order (before or after form processing)
+    /// \param stream Form XObject stream
+    virtual bool performProcessForm(ProcessOrder order, const PDFStream* stream);
+
     /// This function has to be implemented in the client drawing implementation, it should
     /// draw the image.
     /// \param image Image to be painted
@@ -661,6 +748,21 @@ protected:
     /// Implement to react on marked content end
     virtual void performMarkedContentEnd();
 
+    /// Returns true, if optional content is not evaluated during processing. Then
+    /// all content is processed as visible, and content belonging to optional content
+    /// is enclosed by calls of \p performOptionalContentBegin and \p performOptionalContentEnd,
+    /// so optional content can be evaluated later (for example, when page is drawn).
+    virtual bool isOptionalContentDeferred() const { return false; }
+
+    /// Implement to react on begin of the optional content, if optional content is deferred.
+    /// Content up to the matching \p performOptionalContentEnd is visible only, if
+    /// optional content group or membership dictionary \p ocgOrOcmd is not suppressed.
+    /// \param ocgOrOcmd Optional content group or membership dictionary
+    virtual void performOptionalContentBegin(PDFObjectReference ocgOrOcmd) { Q_UNUSED(ocgOrOcmd); }
+
+    /// Implement to react on end of the optional content, if optional content is deferred.
+    virtual void performOptionalContentEnd() { }
+
     /// Implement to react on set char width request
     virtual void performSetCharWidth(PDFReal wx, PDFReal wy);
 
@@ -713,6 +815,11 @@ protected:
     /// Returns current graphic state
     const PDFPageContentProcessorState* getGraphicState() const { return &m_graphicState; }
 
+    /// Returns glyph of the realized font, which is being painted by \p performPathPainting,
+    /// or nullptr, if painted path is not a glyph. Glyph is provided only for text, which
+    /// is filled and not stroked, so it can be drawn using glyph atlas.
+    const PDFGlyphAtlasGlyph* getPaintedGlyph() const { return m_paintedGlyph; }
+
     /// Adds error to the error list
     /// \param error Error message
     void addError(const QString& error) { m_errorList.append(PDFRenderError(RenderErrorType::Error, error)); }
@@ -751,8 +858,33 @@ protected:
     /// Returns optional content activity
     const PDFOptionalContentActivity* getOptionalContentActivity() const { return m_optionalContentActivity; }
 
-    /// Returns operand for current operator
-    const PDFFlatArray<PDFLexicalAnalyzer::Token, 33>& getOperands() const { return m_operands; }
+    /// Returns mesh quality settings
+    const PDFMeshQualitySettings& getMeshQualitySettings() const { return m_meshQualitySettings; }
+
+    /// Paints one cell of the tiling pattern, clipped to the bounding box of the pattern.
+    /// Used to render the cell of the pattern to the image (see \p performTilingPatternCellRendering).
+    /// \param tilingPattern Tiling pattern
+    /// \param patternToDeviceMatrix Matrix mapping pattern space to the device space
+    /// \param uncoloredPatternColorSpace Color space for uncolored color patterns
+    /// \param uncoloredPatternColor Uncolored color pattern color
+    void processTilingPatternCell(const PDFTilingPattern* tilingPattern,
+                                  const QTransform& patternToDeviceMatrix,
+                                  PDFColorSpacePointer uncoloredPatternColorSpace,
+                                  PDFColor uncoloredPatternColor);
+
+    /// Returns operand for current operator. Operands can refer to the content
+    /// stream data, so they are valid only during processing of the operator.
+    const PDFFlatArray<PDFLexicalAnalyzer::TypedToken, 33>& getOperands() const { return m_operands; }
+
+    /// Returns range of the currently processed operation in the page content stream.
+    /// If operation is from form, tiling pattern or Type 3 glyph procedure, then range
+    /// of the page content stream operation, which invoked it, is returned. Range
+    /// is invalid, if no page content stream is being processed.
+    const ContentStreamRange& getCurrentOperationRange() const { return m_currentOperationRange; }
+
+    /// Returns true, if currently processed operation is directly from the page
+    /// content stream (not from form, tiling pattern or Type 3 glyph procedure).
+    bool isPageContentStreamOperation() const { return m_compiledContentNestingLevel == 1 && m_currentOperationRange.isValid(); }
 
     class PDF4QTLIBCORESHARED_EXPORT PDFTransparencyGroupGuard
     {
@@ -782,12 +914,34 @@ private:
     /// Process the content stream
     void processContentStream(const PDFStream* stream);
 
-    /// Process the content
-    void processContent(const QByteArray& content);
+    /// Returns compiled content stream. Compiled content stream is taken
+    /// from the cache of the document, or it is compiled, if it is not cached.
+    /// \param stream Content stream
+    std::shared_ptr<const PDFCompiledContentStream> getCompiledContentStream(const PDFStream* stream) const;
+
+    /// Compiles the content to the sequence of operators, which can be processed
+    /// repeatedly by \p processCompiledContent without parsing the content again.
+    /// \param content Content
+    PDFCompiledContentStream compileContent(const QByteArray& content) const;
+
+    /// Process the compiled content
+    /// \param compiledContent Compiled content
+    void processCompiledContent(const PDFCompiledContentStream& compiledContent);
+
+    /// Parses inline image (BI/ID/EI operators) and creates image stream from it. Parser
+    /// must be positioned after the BI operator, and it is moved after the EI operator.
+    /// \param parser Parser of the content
+    /// \param content Content
+    PDFStream createInlineImageStream(PDFLexicalAnalyzer& parser, const QByteArray& content) const;
 
     /// Processes single command
     void processCommand(const QByteArray& command);
 
+    /// Processes single operator
+    /// \param op Operator
+    /// \param command Command of the operator
+    void processOperator(Operator op, const QByteArray& command);
+
     /// Performs path painting
     /// \param path Path, which should be drawn (can be emtpy - in that case nothing happens)
     /// \param stroke Stroke the path
@@ -806,6 +960,32 @@ private:
                                        PDFColorSpacePointer uncoloredPatternColorSpace,
                                        PDFColor uncoloredPatternColor);
 
+    /// Initializes resources, transformation matrix and colors for painting of the tiling
+    /// pattern content. Returns value, which must be added to the uncolored tiling pattern state.
+    /// \param tilingPattern Tiling pattern
+    /// \param patternMatrix Matrix mapping pattern space to the device space
+    /// \param uncoloredPatternColorSpace Color space for uncolored color patterns
+    /// \param uncoloredPatternColor Uncolored color pattern color
+    int initializeTilingPatternState(const PDFTilingPattern* tilingPattern,
+                                     const QTransform& patternMatrix,
+                                     const PDFColorSpacePointer& uncoloredPatternColorSpace,
+                                     const PDFColor& uncoloredPatternColor);
+
+    /// Paints tiling pattern by repeating the image of the pattern cell over the tiled area.
+    /// Images of cells are cached for each scale, so pattern content is processed only
+    /// once. Returns false, if pattern can't be painted this way (for example, cells overlap,
+    /// or pattern is rotated), and it must be painted tile by tile.
+    /// \param tilingPattern Tiling pattern
+    /// \param tilingArea Tiled area in pattern space
+    /// \param patternMatrix Matrix mapping pattern space to the device space
+    /// \param uncoloredPatternColorSpace Color space for uncolored color patterns
+    /// \param uncoloredPatternColor Uncolored color pattern color
+    bool processTilingPatternImagePainting(const PDFTilingPattern* tilingPattern,
+                                           const QRectF& tilingArea,
+                                           const QTransform& patternMatrix,
+                                           const PDFColorSpacePointer& uncoloredPatternColorSpace,
+                                           const PDFColor& uncoloredPatternColor);
+
     /// Applies graphic state dictionary
     /// \param graphicStateDictionary Dictionary to be applied to the current graphic state
     void processApplyGraphicState(const PDFDictionary* graphicStateDictionary);
@@ -1045,6 +1225,33 @@ private:
     /// Implementation of painting of XObject image
     void paintXObjectImage(const PDFStream* stream);
 
+    /// Creates key of the image in the image cache of the document. If converted
+    /// image depends on resources of the content stream (named or default color spaces),
+    /// or image size is invalid, then image is not cached, and empty optional is returned.
+    /// \param stream Image stream
+    /// \param decodeHints Decode hints of the image
+    std::optional<PDFImageCache::Key> createImageCacheKey(const PDFStream* stream, const PDFImageDecodeHints& decodeHints) const;
+
+    /// Creates mesh of the shading pattern. Meshes of shadings of types 4-7 are taken
+    /// from the shading mesh cache of the document, if cached mesh has similar resolution
+    /// in pattern space, otherwise mesh is created and inserted into the cache.
+    /// \param shadingPattern Shading pattern
+    /// \param settings Mesh quality settings (with initialized resolution)
+    PDFMesh createShadingMesh(const PDFShadingPattern* shadingPattern, const PDFMeshQualitySettings& settings);
+
+    /// Returns color space with given name, resolved from the current color space
+    /// dictionary. Color space is taken from the resource cache of the document, or it
+    /// is created and inserted into the cache. If color space is invalid, exception is thrown.
+    /// \param name Name of the color space
+    PDFColorSpacePointer getColorSpaceFromResources(const QByteArray& name);
+
+    /// Returns pattern with given name, resolved from the current pattern dictionary
+    /// (or from the current shading dictionary, if \p isShading is true). Pattern is
+    /// taken from the resource cache of the document, or it is created and inserted into the cache.
+    /// \param name Name of the pattern or shading
+    /// \param isShading Resolve shading (used by the sh operator) instead of pattern
+    PDFPatternPtr getPatternFromResources(const QByteArray& name, bool isShading);
+
     /// Report warning about color operators in uncolored tiling pattern
     void reportWarningAboutColorOperatorsInUTP();
 
@@ -1075,10 +1282,10 @@ private:
     PDFColorSpacePointer m_deviceCMYKColorSpace;
 
     /// Array with current operand arguments
-    PDFFlatArray<PDFLexicalAnalyzer::Token, 33> m_operands;
+    PDFFlatArray<PDFLexicalAnalyzer::TypedToken, 33> m_operands;
 
     /// Stack with saved graphic states
-    std::stack<PDFPageContentProcessorState> m_stack;
+    std::stack<PDFPageContentProcessorState, std::vector<PDFPageContentProcessorState>> m_stack;
 
     /// Stack with transparency groups
     std::stack<PDFTransparencyGroup> m_transparencyGroupStack;
@@ -1104,6 +1311,27 @@ private:
     /// Is drawing uncolored tiling pattern?
     int m_drawingUncoloredTilingPatternState;
 
+    /// Cached image of the tiling pattern cell. Content of the pattern is
+    /// held, so its data (used in the key) are not reused by other pattern.
+    struct TilingPatternCellImage
+    {
+        QByteArray content;
+        QImage image;
+    };
+
+    /// Key of the cell image - content data of the pattern, width and height of the image
+    /// (scale bucket), and color of the uncolored pattern
+    using TilingPatternCellImageKey = std::tuple<const char*, int, int, QRgb>;
+
+    /// Images of the tiling pattern cells
+    std::map<TilingPatternCellImageKey, TilingPatternCellImage> m_tilingPatternCellImages;
+
+    static constexpr PDFReal TILING_PATTERN_IMAGE_TOLERANCE = 0.001;
+    static constexpr PDFReal TILING_PATTERN_IMAGE_MIN_TILES = 16.0;
+    static constexpr PDFReal TILING_PATTERN_IMAGE_MIN_CELL_SIZE = 4.0;
+    static constexpr PDFReal TILING_PATTERN_IMAGE_MAX_CELL_SIZE = 1024.0;
+    static constexpr qint64 TILING_PATTERN_IMAGE_MAX_AREA_PIXELS = 2048 * 2048;
+
     /// Actually realized physical font
     PDFCachedItem<PDFRealizedFontPointer> m_realizedFont;
 
@@ -1111,6 +1339,9 @@ private:
     /// is in device space coordinates.
     QPainterPath m_textClippingPath;
 
+    /// Glyph, which is actually painted (valid only during path painting)
+    const PDFGlyphAtlasGlyph* m_paintedGlyph = nullptr;
+
     /// Base matrix to be used when drawing patterns. Concatenate this matrix
     /// with pattern matrix to get transformation from pattern space to device space.
     QTransform m_patternBaseMatrix;
@@ -1130,6 +1361,50 @@ private:
 
     /// Active structural parent key
     PDFInteger m_structuralParentKey;
+
+    /// Index of currently processed page content stream
+    PDFInteger m_contentStreamIndex = -1;
+
+    /// Nesting level of processed compiled content (forms, patterns, glyph procedures)
+    int m_compiledContentNestingLevel = 0;
+
+    /// Range of currently processed operation in the page content stream
+    ContentStreamRange m_currentOperationRange;
+};
+
+/// Content stream compiled by a single parse to a compact bytecode: flat array of operators
+/// and operand pool, so it can be processed repeatedly without lexing and parsing (it is
+/// used for page content streams, forms, tiling patterns and Type 3 glyph procedures).
+/// Inline images are stored as image streams, so their decoded images can be cached.
+struct PDFCompiledContentStream
+{
+    struct Operation
+    {
+        /// Operator. Operator::InlineImageBegin paints inline image, Operator::Invalid
+        /// refers to command, which is not valid operator.
+        PDFPageContentProcessor::Operator op = PDFPageContentProcessor::Operator::Invalid;
+
+        quint32 firstOperand = 0;   ///< Index of first operand in the operand pool
+        quint32 operandCount = 0;   ///< Number of the operands
+        quint32 dataIndex = 0;      ///< Index of inline image, or index of invalid command
+        quint32 contentBegin = 0;   ///< Offset of the first byte of the operation (including operands)
+        quint32 contentEnd = 0;     ///< Offset after the last byte of the operation
+    };
+
+    std::vector<Operation> operations;
+    std::vector<PDFLexicalAnalyzer::TypedToken> operands;
+    std::vector<std::shared_ptr<PDFStream>> inlineImages;
+    std::vector<QByteArray> invalidCommands;
+
+    /// Number of operands at the end of the operand pool, which are not followed by an operator.
+    /// They remain on the operand stack, because content can be split into more content streams.
+    quint32 trailingOperandCount = 0;
+
+    /// Errors, which occured during parsing of the content stream
+    QList<PDFRenderError> errors;
+
+    /// Memory consumption estimate in bytes
+    qint64 memoryConsumptionEstimate = 0;
 };
 
 template<>
@@ -24,6 +24,8 @@
 #include "pdfpattern.h"
 #include "pdfcms.h"
 #include "pdfpainterutils.h"
+#include "pdfoptionalcontent.h"
+#include "pdfexception.h"
 
 #include <QPainter>
 #include <QCryptographicHash>
@@ -31,6 +33,12 @@
 
 #include "pdfdbgheap.h"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <set>
+#include <unordered_map>
+
 namespace pdf
 {
 
@@ -48,6 +56,68 @@ PDFPainterBase::PDFPainterBase(PDFRenderer::Features features,
 
 }
 
+QSize PDFPainterBase::getImageTargetSize() const
+{
+    if (!m_imageTargetMatrix || !hasFeature(PDFRenderer::DownscaleImages))
+    {
+        return QSize();
+    }
+
+    // Image is painted into the unit square of current user space
+    const QTransform matrix = getCurrentWorldMatrix() * m_imageTargetMatrix.value();
+    const QLineF mappedWidthVector = matrix.map(QLineF(0, 0, 1, 0));
+    const QLineF mappedHeightVector = matrix.map(QLineF(0, 0, 0, 1));
+    return QSize(qCeil(mappedWidthVector.length()), qCeil(mappedHeightVector.length()));
+}
+
+bool PDFPainterBase::isImageCacheUsed() const
+{
+    // Painters paint only converted images, so they can share them
+    return true;
+}
+
+QImage PDFPainterBase::performTilingPatternCellRendering(const PDFTilingPattern* tilingPattern,
+                                                         const QTransform& patternToImageMatrix,
+                                                         QSize imageSize,
+                                                         const PDFColorSpacePointer& uncoloredPatternColorSpace,
+                                                         const PDFColor& uncoloredPatternColor)
+{
+    if (m_isTilingPatternCellPainter || !getPage())
+    {
+        // Patterns nested in the cell of other pattern are painted tile by tile,
+        // because painter of the cell doesn't paint into the page device space.
+        return QImage();
+    }
+
+    QImage image(imageSize, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+
+    QPainter painter(&image);
+    bool isCellPainted = true;
+
+    {
+        PDFPainter cellPainter(&painter, m_features & ~PDFRenderer::Features(PDFRenderer::ClipToCropBox), QTransform(), getPage(), getDocument(),
+                               getFontCache(), getCMS(), getOptionalContentActivity(), getMeshQualitySettings());
+        cellPainter.m_isTilingPatternCellPainter = true;
+
+        try
+        {
+            cellPainter.processTilingPatternCell(tilingPattern, patternToImageMatrix, uncoloredPatternColorSpace, uncoloredPatternColor);
+        }
+        catch (const PDFException&)
+        {
+            isCellPainted = false;
+        }
+        catch (const PDFRendererException&)
+        {
+            isCellPainted = false;
+        }
+    }
+
+    painter.end();
+    return isCellPainted ? image : QImage();
+}
+
 void PDFPainterBase::performUpdateGraphicsState(const PDFPageContentProcessorState& state)
 {
     const PDFPageContentProcessorState::StateFlags flags = state.getStateFlags();
@@ -215,6 +285,9 @@ PDFPainter::PDFPainter(QPainter* painter,
     Q_ASSERT(painter);
     Q_ASSERT(pagePointToDevicePointMatrix.isInvertible());
 
+    // Images are painted directly onto the device
+    setImageTargetMatrix(QTransform());
+
     m_painter->save();
 
     if (features.testFlag(PDFRenderer::ClipToCropBox))
@@ -222,10 +295,17 @@ PDFPainter::PDFPainter(QPainter* painter,
         QRectF cropBox = page->getCropBox();
         if (cropBox.isValid())
         {
-            QPainterPath path;
-            path.addPolygon(pagePointToDevicePointMatrix.map(cropBox));
+            if (pagePointToDevicePointMatrix.type() <= QTransform::TxScale && m_painter->worldTransform().type() <= QTransform::TxScale)
+            {
+                m_painter->setClipRect(pagePointToDevicePointMatrix.mapRect(cropBox), Qt::IntersectClip);
+            }
+            else
+            {
+                QPainterPath path;
+                path.addPolygon(pagePointToDevicePointMatrix.map(cropBox));
 
-            m_painter->setClipPath(path, Qt::IntersectClip);
+                m_painter->setClipPath(path, Qt::IntersectClip);
+            }
         }
     }
 
@@ -243,6 +323,16 @@ void PDFPainter::performPathPainting(const QPainterPath& path, bool stroke, bool
 
     // Set antialiasing
     const bool antialiasing = (text && hasFeature(PDFRenderer::TextAntialiasing)) || (!text && hasFeature(PDFRenderer::Antialiasing));
+
+    // Small glyphs are drawn using coverage masks from glyph atlas
+    if (const PDFGlyphAtlasGlyph* glyph = text ? getPaintedGlyph() : nullptr)
+    {
+        if (antialiasing && hasFeature(PDFRenderer::GlyphAtlas) && glyph->atlas->drawGlyph(m_painter, *glyph, getCurrentBrush()))
+        {
+            return;
+        }
+    }
+
     m_painter->setRenderHint(QPainter::Antialiasing, antialiasing);
 
     if (stroke)
@@ -270,7 +360,16 @@ void PDFPainter::performPathPainting(const QPainterPath& path, bool stroke, bool
 void PDFPainter::performClipping(const QPainterPath& path, Qt::FillRule fillRule)
 {
     Q_ASSERT(path.fillRule() == fillRule);
-    m_painter->setClipPath(path, Qt::IntersectClip);
+
+    const QRectF clipRect = m_painter->worldTransform().type() <= QTransform::TxScale ? PDFPainterHelper::getAxisAlignedRectangle(path) : QRectF();
+    if (clipRect.isValid())
+    {
+        m_painter->setClipRect(clipRect, Qt::IntersectClip);
+    }
+    else
+    {
+        m_painter->setClipPath(path, Qt::IntersectClip);
+    }
 }
 
 void PDFPainter::performImagePainting(const QImage& image)
@@ -381,15 +480,21 @@ void PDFPrecompiledPageGenerator::performPathPainting(const QPainterPath& path,
     Q_ASSERT(stroke || fill);
     Q_ASSERT(path.fillRule() == fillRule);
 
+    if (const PDFGlyphAtlasGlyph* glyph = text ? getPaintedGlyph() : nullptr)
+    {
+        m_precompiledPage->addGlyph(getCurrentBrush(), PDFPrecompiledPage::createCompactPath(path), *glyph);
+        return;
+    }
+
     QPen pen = stroke ? getCurrentPen() : QPen(Qt::NoPen);
     QBrush brush = fill ? getCurrentBrush() : QBrush(Qt::NoBrush);
-    m_precompiledPage->addPath(qMove(pen), qMove(brush), path, text);
+    m_precompiledPage->addPath(qMove(pen), qMove(brush), PDFPrecompiledPage::createCompactPath(path), text);
 }
 
 void PDFPrecompiledPageGenerator::performClipping(const QPainterPath& path, Qt::FillRule fillRule)
 {
     Q_ASSERT(path.fillRule() == fillRule);
-    m_precompiledPage->addClip(path);
+    m_precompiledPage->addClip(PDFPrecompiledPage::createCompactPath(path));
 }
 
 void PDFPrecompiledPageGenerator::performImagePainting(const QImage& image)
@@ -440,6 +545,21 @@ void PDFPrecompiledPageGenerator::performMeshPainting(const PDFMesh& mesh)
     m_precompiledPage->addMesh(mesh, getEffectiveFillingAlpha());
 }
 
+bool PDFPrecompiledPageGenerator::isOptionalContentDeferred() const
+{
+    return m_isOptionalContentDeferred && getOptionalContentActivity() && !hasFeature(PDFRenderer::IgnoreOptionalContent);
+}
+
+void PDFPrecompiledPageGenerator::performOptionalContentBegin(PDFObjectReference ocgOrOcmd)
+{
+    m_precompiledPage->addBeginOptionalContent(ocgOrOcmd);
+}
+
+void PDFPrecompiledPageGenerator::performOptionalContentEnd()
+{
+    m_precompiledPage->addEndOptionalContent();
+}
+
 void PDFPrecompiledPageGenerator::performSaveGraphicState(PDFPageContentProcessor::ProcessOrder order)
 {
     if (order == ProcessOrder::AfterOperation)
@@ -466,15 +586,212 @@ void PDFPrecompiledPageGenerator::setCompositionMode(QPainter::CompositionMode m
     m_precompiledPage->addSetCompositionMode(mode);
 }
 
+bool PDFPrecompiledPageGenerator::performProcessForm(ProcessOrder order, const PDFStream* stream)
+{
+    const quint64 streamId = stream->getUniqueId();
+
+    switch (order)
+    {
+        case ProcessOrder::BeforeOperation:
+        {
+            FormInstructions instructions;
+            instructions.state = getFormInheritedState();
+            instructions.matrix = getCurrentWorldMatrix();
+            instructions.firstInstruction = m_precompiledPage->getInstructionCount();
+            instructions.isReusable = canReuseFormInstructions();
+
+            auto it = m_formInstructions.find(streamId);
+            if (instructions.isReusable && it != m_formInstructions.cend() && it->second.isReusable && it->second.state == instructions.state)
+            {
+                // Form was already processed with the same inherited state, so we
+                // just copy its instructions and place them to the current position.
+                const FormInstructions& formInstructions = it->second;
+                const QTransform matrix = formInstructions.matrix.inverted() * instructions.matrix;
+                m_precompiledPage->instantiate(formInstructions.firstInstruction, formInstructions.lastInstruction, matrix);
+                return true;
+            }
+
+            m_formInstructionsStack.emplace_back(streamId, qMove(instructions));
+            break;
+        }
+
+        case ProcessOrder::AfterOperation:
+        {
+            Q_ASSERT(!m_formInstructionsStack.empty());
+            Q_ASSERT(m_formInstructionsStack.back().first == streamId);
+
+            FormInstructions instructions = qMove(m_formInstructionsStack.back().second);
+            m_formInstructionsStack.pop_back();
+
+            instructions.lastInstruction = m_precompiledPage->getInstructionCount();
+            instructions.isReusable = instructions.isReusable &&
+                                      instructions.matrix.isInvertible() &&
+                                      m_precompiledPage->canInstantiate(instructions.firstInstruction, instructions.lastInstruction);
+            m_formInstructions[streamId] = qMove(instructions);
+            break;
+        }
+    }
+
+    return false;
+}
+
+std::vector<PDFPrecompiledPage::OperatorTime> PDFPrecompiledPageGenerator::getSlowestOperators(size_t count) const
+{
+    std::vector<PDFPrecompiledPage::OperatorTime> operatorTimes;
+    for (size_t i = 0; i < m_operatorTimes.size(); ++i)
+    {
+        if (m_operatorTimes[i].count > 0)
+        {
+            PDFPrecompiledPage::OperatorTime operatorTime = m_operatorTimes[i];
+            operatorTime.op = static_cast<Operator>(i);
+            operatorTimes.push_back(operatorTime);
+        }
+    }
+
+    auto comparator = [](const PDFPrecompiledPage::OperatorTime& left, const PDFPrecompiledPage::OperatorTime& right) { return left.timeNS > right.timeNS; };
+    std::sort(operatorTimes.begin(), operatorTimes.end(), comparator);
+
+    if (operatorTimes.size() > count)
+    {
+        operatorTimes.resize(count);
+    }
+
+    return operatorTimes;
+}
+
+void PDFPrecompiledPageGenerator::performInterceptInstruction(Operator currentOperator, ProcessOrder processOrder, const QByteArray& operatorAsText)
+{
+    BaseClass::performInterceptInstruction(currentOperator, processOrder, operatorAsText);
+
+    if (!hasFeature(PDFRenderer::DisplayTimes) || currentOperator >= Operator::Invalid)
+    {
+        return;
+    }
+
+    if (!m_operatorTimer.isValid())
+    {
+        m_operatorTimer.start();
+    }
+
+    const qint64 currentTimeNS = m_operatorTimer.nsecsElapsed();
+    switch (processOrder)
+    {
+        case ProcessOrder::BeforeOperation:
+        {
+            OperatorTimer timer;
+            timer.startTimeNS = currentTimeNS;
+            m_operatorTimerStack.push_back(timer);
+            break;
+        }
+
+        case ProcessOrder::AfterOperation:
+        {
+            if (m_operatorTimerStack.empty())
+            {
+                break;
+            }
+
+            OperatorTimer timer = m_operatorTimerStack.back();
+            m_operatorTimerStack.pop_back();
+
+            const qint64 totalTimeNS = currentTimeNS - timer.startTimeNS;
+            PDFPrecompiledPage::OperatorTime& operatorTime = m_operatorTimes[size_t(currentOperator)];
+            operatorTime.timeNS += totalTimeNS - timer.nestedTimeNS;
+            ++operatorTime.count;
+
+            if (!m_operatorTimerStack.empty())
+            {
+                m_operatorTimerStack.back().nestedTimeNS += totalTimeNS;
+            }
+            break;
+        }
+    }
+}
+
+bool PDFPrecompiledPageGenerator::canReuseFormInstructions() const
+{
+    // Transparency groups are only approximated using alpha of the outer
+    // group, so form output then depends on the group stack.
+    return !isContentSuppressed() && !isTransparencyGroupActive();
+}
+
+PDFPrecompiledPageGenerator::FormInheritedState PDFPrecompiledPageGenerator::getFormInheritedState() const
+{
+    const PDFPageContentProcessorState* graphicState = getGraphicState();
+
+    FormInheritedState state;
+    state.strokeColorSpace = graphicState->getStrokeColorSpace();
+    state.fillColorSpace = graphicState->getFillColorSpace();
+    state.strokeColor = graphicState->getStrokeColor();
+    state.fillColor = graphicState->getFillColor();
+    state.lineWidth = graphicState->getLineWidth();
+    state.lineCapStyle = graphicState->getLineCapStyle();
+    state.lineJoinStyle = graphicState->getLineJoinStyle();
+    state.mitterLimit = graphicState->getMitterLimit();
+    state.lineDashPattern = graphicState->getLineDashPattern();
+    state.renderingIntent = graphicState->getRenderingIntent();
+    state.alphaStroking = graphicState->getAlphaStroking();
+    state.alphaFilling = graphicState->getAlphaFilling();
+    state.blendMode = graphicState->getBlendMode();
+    state.softMask = graphicState->getSoftMask();
+    state.textFont = graphicState->getTextFont();
+    state.textFontSize = graphicState->getTextFontSize();
+    state.textRenderingMode = graphicState->getTextRenderingMode();
+    state.textCharacterSpacing = graphicState->getTextCharacterSpacing();
+    state.textWordSpacing = graphicState->getTextWordSpacing();
+    state.textHorizontalScaling = graphicState->getTextHorizontalScaling();
+    state.textLeading = graphicState->getTextLeading();
+    state.textRise = graphicState->getTextRise();
+
+    // Forms without their own resources use resources of the parent content stream
+    state.resources = { getColorSpaceDictionary(),
+                        getFontDictionary(),
+                        getXObjectDictionary(),
+                        getExtendedGraphicStateDictionary(),
+                        getShadingDictionary(),
+                        getPatternDictionary() };
+    return state;
+}
+
 void PDFPrecompiledPage::draw(QPainter* painter,
                               const QRectF& cropBox,
                               const QTransform& pagePointToDevicePointMatrix,
                               PDFRenderer::Features features,
-                              PDFReal opacity) const
+                              PDFReal opacity,
+                              const QRectF& cullRect,
+                              const PDFOptionalContentActivity* optionalContentActivity) const
 {
     Q_ASSERT(painter);
     Q_ASSERT(pagePointToDevicePointMatrix.isInvertible());
 
+    // Evaluate recorded optional content. Content is drawn only, if all
+    // optional contents, in which it is enclosed, are not suppressed.
+    std::vector<bool> isOptionalContentSuppressed(m_optionalContents.size(), false);
+    if (optionalContentActivity && !features.testFlag(PDFRenderer::IgnoreOptionalContent))
+    {
+        for (size_t i = 0; i < m_optionalContents.size(); ++i)
+        {
+            isOptionalContentSuppressed[i] = optionalContentActivity->isSuppressed(m_optionalContents[i]);
+        }
+    }
+
+    std::vector<bool> optionalContentStack;
+    size_t suppressedOptionalContentCount = 0;
+
+    // Returns true, if rectangle in the current user space is outside of cull rectangle.
+    // Margin (in device pixels) is added due to antialiasing and cosmetic pens.
+    const bool isCullingEnabled = cullRect.isValid();
+    auto isCulled = [painter, &cullRect, isCullingEnabled](const QRectF& rect, const QTransform& matrix, PDFReal margin)
+    {
+        if (!isCullingEnabled)
+        {
+            return false;
+        }
+
+        const QRectF deviceRect = matrix.mapRect(rect).adjusted(-margin, -margin, margin, margin);
+        return !deviceRect.intersects(cullRect);
+    };
+
     painter->save();
     painter->setWorldTransform(QTransform());
     painter->setOpacity(opacity);
@@ -483,9 +800,16 @@ void PDFPrecompiledPage::draw(QPainter* painter,
     {
         if (cropBox.isValid())
         {
-            QPainterPath path;
-            path.addPolygon(pagePointToDevicePointMatrix.map(cropBox));
-            painter->setClipPath(path, Qt::IntersectClip);
+            if (pagePointToDevicePointMatrix.type() <= QTransform::TxScale)
+            {
+                painter->setClipRect(pagePointToDevicePointMatrix.mapRect(cropBox), Qt::IntersectClip);
+            }
+            else
+            {
+                QPainterPath path;
+                path.addPolygon(pagePointToDevicePointMatrix.map(cropBox));
+                painter->setClipPath(path, Qt::IntersectClip);
+            }
         }
     }
 
@@ -498,10 +822,29 @@ void PDFPrecompiledPage::draw(QPainter* painter,
         {
             case InstructionType::DrawPath:
             {
+                if (suppressedOptionalContentCount > 0)
+                {
+                    break;
+                }
+
                 const PathPaintData& data = m_paths[instruction.dataIndex];
 
+                const PDFReal margin = (data.pen.style() != Qt::NoPen && data.pen.isCosmetic()) ? qMax(data.pen.widthF(), 1.0) + 1.0 : 1.0;
+                if (isCulled(data.boundingRect, painter->worldTransform(), margin))
+                {
+                    break;
+                }
+
                 // Set antialiasing
                 const bool antialiasing = (data.isText && features.testFlag(PDFRenderer::TextAntialiasing)) || (!data.isText && features.testFlag(PDFRenderer::Antialiasing));
+
+                // Small glyphs are drawn using coverage masks from glyph atlas
+                const PDFGlyphAtlasGlyph* glyph = getGlyph(data);
+                if (glyph && antialiasing && features.testFlag(PDFRenderer::GlyphAtlas) && glyph->atlas->drawGlyph(painter, *glyph, data.brush))
+                {
+                    break;
+                }
+
                 painter->setRenderHint(QPainter::Antialiasing, antialiasing);
                 painter->setPen(data.pen);
                 painter->setBrush(data.brush);
@@ -511,8 +854,21 @@ void PDFPrecompiledPage::draw(QPainter* painter,
 
             case InstructionType::DrawImage:
             {
+                if (suppressedOptionalContentCount > 0)
+                {
+                    break;
+                }
+
                 const ImageData& data = m_images[instruction.dataIndex];
-                const QImage& image = data.image;
+
+                // Image is painted into the unit square of the user space
+                if (isCulled(QRectF(0.0, 0.0, 1.0, 1.0), painter->worldTransform(), 1.0))
+                {
+                    break;
+                }
+
+                // Large images are drawn scaled down using mip pyramid
+                const QImage& image = data.getImage(painter->worldTransform());
 
                 painter->save();
 
@@ -532,8 +888,18 @@ void PDFPrecompiledPage::draw(QPainter* painter,
 
             case InstructionType::DrawMesh:
             {
+                if (suppressedOptionalContentCount > 0)
+                {
+                    break;
+                }
+
                 const MeshPaintData& data = m_meshes[instruction.dataIndex];
 
+                if (isCulled(data.boundingRect, pagePointToDevicePointMatrix, 1.0))
+                {
+                    break;
+                }
+
                 painter->save();
                 painter->setWorldTransform(QTransform(pagePointToDevicePointMatrix));
                 data.mesh.paint(painter, data.alpha);
@@ -543,7 +909,17 @@ void PDFPrecompiledPage::draw(QPainter* painter,
 
             case InstructionType::Clip:
             {
-                painter->setClipPath(m_clips[instruction.dataIndex].clipPath, Qt::IntersectClip);
+                // Rectangular clips are intersected analytically, which
+                // is much faster, than intersection of clip paths.
+                const ClipData& data = m_clips[instruction.dataIndex];
+                if (data.clipRect.isValid() && painter->worldTransform().type() <= QTransform::TxScale)
+                {
+                    painter->setClipRect(data.clipRect, Qt::IntersectClip);
+                }
+                else
+                {
+                    painter->setClipPath(data.clipPath, Qt::IntersectClip);
+                }
                 break;
             }
 
@@ -571,6 +947,24 @@ void PDFPrecompiledPage::draw(QPainter* painter,
                 break;
             }
 
+            case InstructionType::BeginOptionalContent:
+            {
+                const bool isSuppressed = isOptionalContentSuppressed[instruction.dataIndex];
+                optionalContentStack.push_back(isSuppressed);
+                suppressedOptionalContentCount += isSuppressed ? 1 : 0;
+                break;
+            }
+
+            case InstructionType::EndOptionalContent:
+            {
+                if (!optionalContentStack.empty())
+                {
+                    suppressedOptionalContentCount -= optionalContentStack.back() ? 1 : 0;
+                    optionalContentStack.pop_back();
+                }
+                break;
+            }
+
             default:
             {
                 Q_ASSERT(false);
@@ -609,6 +1003,8 @@ void PDFPrecompiledPage::redact(QPainterPath redactPath, const QTransform& matri
                 QPainterPath mappedRedactPath = currentMatrix.map(redactPath);
                 PathPaintData& path = m_paths[instruction.dataIndex];
                 path.path = path.path.subtracted(mappedRedactPath);
+                path.glyphIndex = INVALID_INDEX;
+                path.isPathShared = false;
                 break;
             }
 
@@ -629,6 +1025,10 @@ void PDFPrecompiledPage::redact(QPainterPath redactPath, const QTransform& matri
                 painter.setWorldTransform(worldTransform.inverted());
                 painter.drawPath(redactPath);
                 painter.end();
+
+                // Mip pyramid must not contain redacted content
+                data.mipmaps.clear();
+                data.createMipmaps();
                 break;
             }
 
@@ -640,7 +1040,10 @@ void PDFPrecompiledPage::redact(QPainterPath redactPath, const QTransform& matri
             {
                 QTransform currentMatrix = worldMatrixStack.top().inverted();
                 QPainterPath mappedRedactPath = currentMatrix.map(redactPath);
-                m_clips[instruction.dataIndex].clipPath = m_clips[instruction.dataIndex].clipPath.subtracted(mappedRedactPath);
+                ClipData& data = m_clips[instruction.dataIndex];
+                data.clipPath = data.clipPath.subtracted(mappedRedactPath);
+                data.clipRect = PDFPainterHelper::getAxisAlignedRectangle(data.clipPath);
+                data.isPathShared = false;
                 break;
             }
 
@@ -657,6 +1060,8 @@ void PDFPrecompiledPage::redact(QPainterPath redactPath, const QTransform& matri
                 break;
 
             case InstructionType::SetCompositionMode:
+            case InstructionType::BeginOptionalContent:
+            case InstructionType::EndOptionalContent:
                 break;
 
             default:
@@ -674,16 +1079,57 @@ void PDFPrecompiledPage::redact(QPainterPath redactPath, const QTransform& matri
     }
 }
 
+QPainterPath PDFPrecompiledPage::createCompactPath(const QPainterPath& path)
+{
+    if (path.capacity() <= path.elementCount())
+    {
+        return path;
+    }
+
+    QPainterPath compactPath;
+    compactPath.reserve(path.elementCount());
+    compactPath.addPath(path);
+    compactPath.setFillRule(path.fillRule());
+    return compactPath;
+}
+
+QRectF PDFPrecompiledPage::getPathBoundingRect(const QPen& pen, const QPainterPath& path)
+{
+    QRectF boundingRect = path.controlPointRect();
+
+    if (pen.style() != Qt::NoPen && !pen.isCosmetic())
+    {
+        // Miter joins can extend from the join point up to miter limit
+        // times pen width, otherwise stroke extends pen width at most
+        // (half of the pen width, or square cap diagonal).
+        const PDFReal penWidth = pen.widthF();
+        const bool isMiterJoin = pen.joinStyle() == Qt::MiterJoin || pen.joinStyle() == Qt::SvgMiterJoin;
+        const PDFReal margin = isMiterJoin ? penWidth * qMax(pen.miterLimit(), 1.0) : penWidth;
+        boundingRect.adjust(-margin, -margin, margin, margin);
+    }
+
+    return boundingRect;
+}
+
 void PDFPrecompiledPage::addPath(QPen pen, QBrush brush, QPainterPath path, bool isText)
 {
     m_instructions.emplace_back(InstructionType::DrawPath, m_paths.size());
     m_paths.emplace_back(qMove(pen), qMove(brush), qMove(path), isText);
 }
 
+void PDFPrecompiledPage::addGlyph(QBrush brush, QPainterPath path, PDFGlyphAtlasGlyph glyph)
+{
+    m_instructions.emplace_back(InstructionType::DrawPath, m_paths.size());
+    m_paths.emplace_back(QPen(Qt::NoPen), qMove(brush), qMove(path), true);
+    m_paths.back().glyphIndex = static_cast<uint32_t>(m_glyphs.size());
+    m_glyphs.emplace_back(qMove(glyph));
+}
+
 void PDFPrecompiledPage::addClip(QPainterPath path)
 {
     m_instructions.emplace_back(InstructionType::Clip, m_clips.size());
     m_clips.emplace_back(qMove(path));
+    m_clips.back().clipRect = PDFPainterHelper::getAxisAlignedRectangle(m_clips.back().clipPath);
 }
 
 void PDFPrecompiledPage::addImage(QImage image)
@@ -710,15 +1156,192 @@ void PDFPrecompiledPage::addSetCompositionMode(QPainter::CompositionMode composi
     m_compositionModes.push_back(compositionMode);
 }
 
+void PDFPrecompiledPage::addBeginOptionalContent(PDFObjectReference ocgOrOcmd)
+{
+    // Pages usually refer to a few optional contents many times, so they are stored only once
+    auto it = std::find(m_optionalContents.cbegin(), m_optionalContents.cend(), ocgOrOcmd);
+    m_instructions.emplace_back(InstructionType::BeginOptionalContent, static_cast<size_t>(std::distance(m_optionalContents.cbegin(), it)));
+
+    if (it == m_optionalContents.cend())
+    {
+        m_optionalContents.push_back(ocgOrOcmd);
+    }
+}
+
+bool PDFPrecompiledPage::canInstantiate(size_t first, size_t last) const
+{
+    Q_ASSERT(first <= last && last <= m_instructions.size());
+
+    auto isInstructionNotInstantiable = [](const Instruction& instruction)
+    {
+        return instruction.type == InstructionType::DrawImage || instruction.type == InstructionType::DrawMesh;
+    };
+    return std::none_of(m_instructions.cbegin() + first, m_instructions.cbegin() + last, isInstructionNotInstantiable);
+}
+
+void PDFPrecompiledPage::instantiate(size_t first, size_t last, const QTransform& matrix)
+{
+    Q_ASSERT(canInstantiate(first, last));
+
+    for (size_t i = first; i < last; ++i)
+    {
+        // Copy the instruction, because vectors can be reallocated
+        const Instruction instruction = m_instructions[i];
+
+        switch (instruction.type)
+        {
+            case InstructionType::DrawPath:
+            {
+                PathPaintData data = m_paths[instruction.dataIndex];
+                if (const PDFGlyphAtlasGlyph* glyph = getGlyph(data))
+                {
+                    PDFGlyphAtlasGlyph glyphCopy = *glyph;
+                    addGlyph(qMove(data.brush), qMove(data.path), qMove(glyphCopy));
+                }
+                else
+                {
+                    addPath(qMove(data.pen), qMove(data.brush), qMove(data.path), data.isText);
+                }
+                m_paths.back().isPathShared = true;
+                break;
+            }
+
+            case InstructionType::Clip:
+            {
+                QPainterPath clipPath = m_clips[instruction.dataIndex].clipPath;
+                addClip(qMove(clipPath));
+                m_clips.back().isPathShared = true;
+                break;
+            }
+
+            case InstructionType::SaveGraphicState:
+            {
+                addSaveGraphicState();
+                break;
+            }
+
+            case InstructionType::RestoreGraphicState:
+            {
+                addRestoreGraphicState();
+                break;
+            }
+
+            case InstructionType::SetWorldMatrix:
+            {
+                QTransform worldMatrix = m_matrices[instruction.dataIndex] * matrix;
+                addSetWorldMatrix(worldMatrix);
+                break;
+            }
+
+            case InstructionType::SetCompositionMode:
+            {
+                QPainter::CompositionMode compositionMode = m_compositionModes[instruction.dataIndex];
+                addSetCompositionMode(compositionMode);
+                break;
+            }
+
+            case InstructionType::BeginOptionalContent:
+            {
+                addBeginOptionalContent(m_optionalContents[instruction.dataIndex]);
+                break;
+            }
+
+            case InstructionType::EndOptionalContent:
+            {
+                addEndOptionalContent();
+                break;
+            }
+
+            default:
+            {
+                Q_ASSERT(false);
+                break;
+            }
+        }
+    }
+}
+
 void PDFPrecompiledPage::optimize()
 {
+    deduplicatePensAndBrushes();
+    deduplicateMatrices();
+
     m_instructions.shrink_to_fit();
     m_paths.shrink_to_fit();
+    m_glyphs.shrink_to_fit();
     m_clips.shrink_to_fit();
     m_images.shrink_to_fit();
     m_meshes.shrink_to_fit();
     m_matrices.shrink_to_fit();
     m_compositionModes.shrink_to_fit();
+    m_optionalContents.shrink_to_fit();
+}
+
+void PDFPrecompiledPage::deduplicatePensAndBrushes()
+{
+    // Pens and brushes are implicitly shared, but pens/brushes with same values
+    // are often created independently (for example, when graphic state is saved
+    // and restored). Equal pens and brushes are replaced by one shared instance.
+    // Candidates are found using hash of the main properties.
+    std::unordered_map<size_t, std::vector<QPen>> pens;
+    std::unordered_map<size_t, std::vector<QBrush>> brushes;
+
+    auto deduplicate = [](auto& map, size_t hash, auto& value)
+    {
+        auto& candidates = map[hash];
+        auto it = std::find(candidates.cbegin(), candidates.cend(), value);
+        if (it != candidates.cend())
+        {
+            value = *it;
+        }
+        else
+        {
+            candidates.push_back(value);
+        }
+    };
+
+    for (PathPaintData& data : m_paths)
+    {
+        if (data.pen.style() != Qt::NoPen)
+        {
+            const size_t penHash = qHashMulti(0, data.pen.color().rgba(), data.pen.widthF(), int(data.pen.style()), int(data.pen.capStyle()), int(data.pen.joinStyle()));
+            deduplicate(pens, penHash, data.pen);
+        }
+
+        if (data.brush.style() != Qt::NoBrush)
+        {
+            const size_t brushHash = qHashMulti(0, data.brush.color().rgba(), int(data.brush.style()));
+            deduplicate(brushes, brushHash, data.brush);
+        }
+    }
+}
+
+void PDFPrecompiledPage::deduplicateMatrices()
+{
+    std::vector<QTransform> matrices;
+    std::map<std::array<PDFReal, 9>, size_t> matrixIndices;
+
+    for (Instruction& instruction : m_instructions)
+    {
+        if (instruction.type != InstructionType::SetWorldMatrix)
+        {
+            continue;
+        }
+
+        const QTransform& matrix = m_matrices[instruction.dataIndex];
+        const std::array<PDFReal, 9> key = { matrix.m11(), matrix.m12(), matrix.m13(),
+                                             matrix.m21(), matrix.m22(), matrix.m23(),
+                                             matrix.m31(), matrix.m32(), matrix.m33() };
+
+        auto [it, inserted] = matrixIndices.try_emplace(key, matrices.size());
+        if (inserted)
+        {
+            matrices.push_back(matrix);
+        }
+        instruction.dataIndex = it->second;
+    }
+
+    m_matrices = qMove(matrices);
 }
 
 void PDFPrecompiledPage::convertColors(const PDFColorConvertor& colorConvertor)
@@ -758,37 +1381,370 @@ void PDFPrecompiledPage::convertColors(const PDFColorConvertor& colorConvertor)
     m_paperColor = colorConvertor.convert(m_paperColor, true, false);
 }
 
+void PDFPrecompiledPage::serialize(QDataStream& stream) const
+{
+    stream << persist_version;
+    stream << m_compilingTimeNS;
+    stream << m_paperColor;
+
+    stream << m_instructions.size();
+    for (const Instruction& instruction : m_instructions)
+    {
+        stream << int(instruction.type);
+        stream << instruction.dataIndex;
+    }
+
+    stream << m_paths.size();
+    for (const PathPaintData& data : m_paths)
+    {
+        stream << data.pen;
+        stream << data.brush;
+        stream << data.path;
+        stream << data.isText;
+    }
+
+    stream << m_clips.size();
+    for (const ClipData& data : m_clips)
+    {
+        stream << data.clipPath;
+    }
+
+    stream << m_images.size();
+    for (const ImageData& data : m_images)
+    {
+        writeRawImage(stream, data.image);
+    }
+
+    stream << m_meshes.size();
+    for (const MeshPaintData& data : m_meshes)
+    {
+        data.mesh.serialize(stream);
+        stream << data.alpha;
+    }
+
+    stream << m_matrices;
+
+    stream << m_compositionModes.size();
+    for (const QPainter::CompositionMode compositionMode : m_compositionModes)
+    {
+        stream << int(compositionMode);
+    }
+
+    stream << m_optionalContents.size();
+    for (const PDFObjectReference& reference : m_optionalContents)
+    {
+        stream << reference.objectNumber;
+        stream << reference.generation;
+    }
+
+    stream << m_errors.size();
+    for (const PDFRenderError& error : m_errors)
+    {
+        stream << int(error.type);
+        stream << error.message;
+    }
+
+    m_snapInfo.serialize(stream);
+}
+
+void PDFPrecompiledPage::deserialize(QDataStream& stream)
+{
+    *this = PDFPrecompiledPage();
+
+    int persistVersionDeserialized = 0;
+    stream >> persistVersionDeserialized;
+
+    if (persistVersionDeserialized != persist_version)
+    {
+        stream.setStatus(QDataStream::ReadCorruptData);
+        return;
+    }
+
+    qint64 compilingTimeNS = 0;
+    stream >> compilingTimeNS;
+    stream >> m_paperColor;
+
+    auto readCount = [&stream]()
+    {
+        size_t count = 0;
+        stream >> count;
+        return count;
+    };
+
+    const size_t instructionCount = readCount();
+    for (size_t i = 0; i < instructionCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        int type = 0;
+        size_t dataIndex = 0;
+        stream >> type;
+        stream >> dataIndex;
+        m_instructions.emplace_back(static_cast<InstructionType>(type), dataIndex);
+    }
+
+    const size_t pathCount = readCount();
+    for (size_t i = 0; i < pathCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        QPen pen;
+        QBrush brush;
+        QPainterPath path;
+        bool isText = false;
+        stream >> pen;
+        stream >> brush;
+        stream >> path;
+        stream >> isText;
+        m_paths.emplace_back(qMove(pen), qMove(brush), qMove(path), isText);
+    }
+
+    const size_t clipCount = readCount();
+    for (size_t i = 0; i < clipCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        QPainterPath path;
+        stream >> path;
+        m_clips.emplace_back(qMove(path));
+        m_clips.back().clipRect = PDFPainterHelper::getAxisAlignedRectangle(m_clips.back().clipPath);
+    }
+
+    const size_t imageCount = readCount();
+    for (size_t i = 0; i < imageCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        m_images.emplace_back(readRawImage(stream));
+    }
+
+    const size_t meshCount = readCount();
+    for (size_t i = 0; i < meshCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        PDFMesh mesh;
+        PDFReal alpha = 1.0;
+        mesh.deserialize(stream);
+        stream >> alpha;
+        m_meshes.emplace_back(qMove(mesh), alpha);
+    }
+
+    stream >> m_matrices;
+
+    const size_t compositionModeCount = readCount();
+    for (size_t i = 0; i < compositionModeCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        int compositionMode = 0;
+        stream >> compositionMode;
+        m_compositionModes.push_back(static_cast<QPainter::CompositionMode>(compositionMode));
+    }
+
+    const size_t optionalContentCount = readCount();
+    for (size_t i = 0; i < optionalContentCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        PDFObjectReference reference;
+        stream >> reference.objectNumber;
+        stream >> reference.generation;
+        m_optionalContents.push_back(reference);
+    }
+
+    QList<PDFRenderError> errors;
+    const size_t errorCount = readCount();
+    for (size_t i = 0; i < errorCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        int type = 0;
+        QString message;
+        stream >> type;
+        stream >> message;
+        errors.push_back(PDFRenderError(static_cast<RenderErrorType>(type), qMove(message)));
+    }
+
+    m_snapInfo.deserialize(stream);
+
+    if (stream.status() != QDataStream::Ok)
+    {
+        *this = PDFPrecompiledPage();
+        return;
+    }
+
+    // Check indices of the instructions, so corrupted data
+    // can't cause access outside of the arrays.
+    for (const Instruction& instruction : m_instructions)
+    {
+        size_t dataCount = 0;
+        switch (instruction.type)
+        {
+            case InstructionType::DrawPath:
+                dataCount = m_paths.size();
+                break;
+            case InstructionType::DrawImage:
+                dataCount = m_images.size();
+                break;
+            case InstructionType::DrawMesh:
+                dataCount = m_meshes.size();
+                break;
+            case InstructionType::Clip:
+                dataCount = m_clips.size();
+                break;
+            case InstructionType::SetWorldMatrix:
+                dataCount = m_matrices.size();
+                break;
+            case InstructionType::SetCompositionMode:
+                dataCount = m_compositionModes.size();
+                break;
+            case InstructionType::BeginOptionalContent:
+                dataCount = m_optionalContents.size();
+                break;
+            case InstructionType::SaveGraphicState:
+            case InstructionType::RestoreGraphicState:
+            case InstructionType::EndOptionalContent:
+                dataCount = std::numeric_limits<size_t>::max();
+                break;
+            default:
+                break;
+        }
+
+        if (instruction.dataIndex >= dataCount)
+        {
+            *this = PDFPrecompiledPage();
+            stream.setStatus(QDataStream::ReadCorruptData);
+            return;
+        }
+    }
+
+    optimize();
+    finalize(compilingTimeNS, qMove(errors));
+}
+
+void PDFPrecompiledPage::ImageData::createMipmaps()
+{
+    if (image.isNull() || qMax(image.width(), image.height()) < MIPMAP_MINIMAL_IMAGE_SIZE)
+    {
+        return;
+    }
+
+    // Averages four pixels, pairs of channels are averaged in parallel
+    auto average = [](QRgb p00, QRgb p01, QRgb p10, QRgb p11)
+    {
+        constexpr quint32 MASK = 0x00FF00FF;
+        constexpr quint32 ROUNDING = 0x00020002;
+        const quint32 redBlue = (p00 & MASK) + (p01 & MASK) + (p10 & MASK) + (p11 & MASK) + ROUNDING;
+        const quint32 alphaGreen = ((p00 >> 8) & MASK) + ((p01 >> 8) & MASK) + ((p10 >> 8) & MASK) + ((p11 >> 8) & MASK) + ROUNDING;
+        return QRgb(((redBlue >> 2) & MASK) | (((alphaGreen >> 2) & MASK) << 8));
+    };
+
+    // Channels must be premultiplied, so they can be averaged
+    const QImage::Format format = image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+    QImage source = image.convertToFormat(format);
+
+    while (source.width() / 2 >= MIPMAP_MINIMAL_LEVEL_SIZE && source.height() / 2 >= MIPMAP_MINIMAL_LEVEL_SIZE)
+    {
+        const int sourceWidth = source.width();
+        const int sourceHeight = source.height();
+        const int width = sourceWidth / 2;
+        const int height = sourceHeight / 2;
+
+        QImage level(width, height, format);
+        if (level.isNull())
+        {
+            // Not enough memory
+            break;
+        }
+
+        for (int y = 0; y < height; ++y)
+        {
+            const QRgb* row0 = reinterpret_cast<const QRgb*>(source.constScanLine(2 * y));
+            const QRgb* row1 = reinterpret_cast<const QRgb*>(source.constScanLine(2 * y + 1));
+            QRgb* target = reinterpret_cast<QRgb*>(level.scanLine(y));
+
+            for (int x = 0; x < width; ++x)
+            {
+                target[x] = average(row0[2 * x], row0[2 * x + 1], row1[2 * x], row1[2 * x + 1]);
+            }
+        }
+
+        mipmaps.push_back(level);
+        source = qMove(level);
+    }
+
+    mipmaps.shrink_to_fit();
+}
+
+const QImage& PDFPrecompiledPage::ImageData::getImage(const QTransform& matrix) const
+{
+    // Size of the image in device pixels
+    const PDFReal deviceWidth = std::hypot(matrix.m11(), matrix.m12());
+    const PDFReal deviceHeight = std::hypot(matrix.m21(), matrix.m22());
+
+    const QImage* result = &image;
+    for (const QImage& mipmap : mipmaps)
+    {
+        if (mipmap.width() < deviceWidth || mipmap.height() < deviceHeight)
+        {
+            break;
+        }
+
+        result = &mipmap;
+    }
+
+    return *result;
+}
+
 void PDFPrecompiledPage::finalize(qint64 compilingTimeNS, QList<PDFRenderError> errors)
 {
     m_compilingTimeNS = compilingTimeNS;
     m_errors = qMove(errors);
+    m_snapInfo.buildIndex();
 
     // Determine memory consumption
     m_memoryConsumptionEstimate = sizeof(*this);
     m_memoryConsumptionEstimate += sizeof(Instruction) * m_instructions.capacity();
     m_memoryConsumptionEstimate += sizeof(PathPaintData) * m_paths.capacity();
+    m_memoryConsumptionEstimate += sizeof(PDFGlyphAtlasGlyph) * m_glyphs.capacity();
     m_memoryConsumptionEstimate += sizeof(ClipData) * m_clips.capacity();
     m_memoryConsumptionEstimate += sizeof(ImageData) * m_images.capacity();
     m_memoryConsumptionEstimate += sizeof(MeshPaintData) * m_meshes.capacity();
     m_memoryConsumptionEstimate += sizeof(QTransform) * m_matrices.capacity();
     m_memoryConsumptionEstimate += sizeof(QPainter::CompositionMode) * m_compositionModes.capacity();
+    m_memoryConsumptionEstimate += sizeof(PDFObjectReference) * m_optionalContents.capacity();
     m_memoryConsumptionEstimate += sizeof(PDFRenderError) * m_errors.size();
 
+    // Private data of implicitly shared objects (pen, brush, path) are
+    // allocated on the heap, approximate size of the allocation is used.
+    constexpr qint64 SHARED_DATA_SIZE = 64;
+
     auto calculateQPathMemoryConsumption = [](const QPainterPath& path)
     {
-        return sizeof(QPainterPath::Element) * path.capacity();
+        return path.isEmpty() ? 0 : SHARED_DATA_SIZE + sizeof(QPainterPath::Element) * path.capacity();
+    };
+
+    // Pens and brushes are deduplicated, so each shared data is counted only once
+    std::set<const void*> sharedData;
+    auto calculateSharedDataMemoryConsumption = [&sharedData](auto value) -> qint64
+    {
+        return sharedData.insert(static_cast<const void*>(&*value.data_ptr())).second ? SHARED_DATA_SIZE : 0;
     };
+
     for (const PathPaintData& data : m_paths)
     {
-        m_memoryConsumptionEstimate += calculateQPathMemoryConsumption(data.path);
+        if (!data.isPathShared)
+        {
+            m_memoryConsumptionEstimate += calculateQPathMemoryConsumption(data.path);
+        }
+        m_memoryConsumptionEstimate += calculateSharedDataMemoryConsumption(data.pen);
+        m_memoryConsumptionEstimate += calculateSharedDataMemoryConsumption(data.brush);
     }
     for (const ClipData& data : m_clips)
     {
-        m_memoryConsumptionEstimate += calculateQPathMemoryConsumption(data.clipPath);
+        if (!data.isPathShared)
+        {
+            m_memoryConsumptionEstimate += calculateQPathMemoryConsumption(data.clipPath);
+        }
     }
-    for (const ImageData& data : m_images)
+    for (ImageData& data : m_images)
     {
+        if (data.mipmaps.empty())
+        {
+            data.createMipmaps();
+        }
+
         m_memoryConsumptionEstimate += data.image.sizeInBytes();
+        m_memoryConsumptionEstimate += sizeof(QImage) * data.mipmaps.capacity();
+        for (const QImage& mipmap : data.mipmaps)
+        {
+            m_memoryConsumptionEstimate += mipmap.sizeInBytes();
+        }
     }
     for (const MeshPaintData& data : m_meshes)
     {
@@ -797,7 +1753,8 @@ void PDFPrecompiledPage::finalize(qint64 compilingTimeNS, QList<PDFRenderError>
 }
 
 PDFPrecompiledPage::GraphicPieceInfos PDFPrecompiledPage::calculateGraphicPieceInfos(QRectF mediaBox,
-                                                                                     PDFReal epsilon) const
+                                                                                     PDFReal epsilon,
+                                                                                     PDFImagePerceptualHashCache* imageHashCache) const
 {
     GraphicPieceInfos infos;
 
@@ -876,13 +1833,11 @@ PDFPrecompiledPage::GraphicPieceInfos PDFPrecompiledPage::calculateGraphicPieceI
 
                 GraphicPieceInfo info;
                 QByteArray serializedPath;
-                QByteArray serializedImage;
 
                 // Serialize data
                 if (true)
                 {
                     QDataStream stream(&serializedPath, QIODevice::WriteOnly);
-                    QDataStream streamImage(&serializedImage, QIODevice::WriteOnly);
 
                     // Jakub Melka: serialize image position
                     QTransform worldMatrix = stateStack.top().matrix;
@@ -908,22 +1863,18 @@ PDFPrecompiledPage::GraphicPieceInfos PDFPrecompiledPage::calculateGraphicPieceI
                         stream << element.type;
                     }
 
-                    // serialize image data
-                    stream.writeBytes(reinterpret_cast<const char*>(image.bits()), image.sizeInBytes());
-                    streamImage.writeBytes(reinterpret_cast<const char*>(image.bits()), image.sizeInBytes());
+                    // Serialize perceptual hash of the image instead of the image
+                    // data, the whole bitmap is not needed to be hashed.
+                    info.imageHash = imageHashCache ? imageHashCache->getHash(image) : PDFImagePerceptualHash::calculate(image);
+                    stream << info.imageHash.getKey();
                 }
 
                 QByteArray hash = QCryptographicHash::hash(serializedPath, QCryptographicHash::Sha512);
                 Q_ASSERT(QCryptographicHash::hashLength(QCryptographicHash::Sha512) == 64);
 
-                QByteArray imageHash = QCryptographicHash::hash(serializedImage, QCryptographicHash::Sha512);
-
                 size_t size = qMin<size_t>(hash.length(), info.hash.size());
                 std::copy(hash.data(), hash.data() + size, info.hash.data());
 
-                size_t sizeImage = qMin<size_t>(imageHash.length(), info.imageHash.size());
-                std::copy(imageHash.data(), imageHash.data() + sizeImage, info.imageHash.data());
-
                 infos.emplace_back(std::move(info));
                 break;
             }
@@ -1000,6 +1951,8 @@ PDFPrecompiledPage::GraphicPieceInfos PDFPrecompiledPage::calculateGraphicPieceI
             }
 
             case InstructionType::SetCompositionMode:
+            case InstructionType::BeginOptionalContent:
+            case InstructionType::EndOptionalContent:
             {
                 // Do nothing, we are just collecting information
                 break;
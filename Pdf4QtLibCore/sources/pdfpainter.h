@@ -24,6 +24,7 @@
 #define PDFPAINTER_H
 
 #include "pdfutils.h"
+#include "pdfimage.h"
 #include "pdfpattern.h"
 #include "pdfrenderer.h"
 #include "pdfpagecontentprocessor.h"
@@ -35,6 +36,11 @@
 #include <QBrush>
 #include <QElapsedTimer>
 
+#include <array>
+#include <limits>
+#include <map>
+#include <optional>
+
 namespace pdf
 {
 
@@ -84,6 +90,20 @@ protected:
     /// Is transparency group active?
     bool isTransparencyGroupActive() const { return !m_transparencyGroupDataStack.empty(); }
 
+    virtual QSize getImageTargetSize() const override;
+    virtual bool isImageCacheUsed() const override;
+    virtual QImage performTilingPatternCellRendering(const PDFTilingPattern* tilingPattern,
+                                                     const QTransform& patternToImageMatrix,
+                                                     QSize imageSize,
+                                                     const PDFColorSpacePointer& uncoloredPatternColorSpace,
+                                                     const PDFColor& uncoloredPatternColor) override;
+
+    /// Sets matrix, which maps device points of the painter to the device pixels
+    /// of the target, on which page is drawn. If it is set and feature DownscaleImages
+    /// is turned on, then images are decoded at reduced resolution.
+    /// \param imageTargetMatrix Device point to target pixel matrix
+    void setImageTargetMatrix(const QTransform& imageTargetMatrix) { m_imageTargetMatrix = imageTargetMatrix; }
+
 private:
     /// Returns current pen (implementation)
     QPen getCurrentPenImpl() const;
@@ -100,6 +120,8 @@ private:
     };
 
     PDFRenderer::Features m_features;
+    std::optional<QTransform> m_imageTargetMatrix;
+    bool m_isTilingPatternCellPainter = false;
     PDFCachedItem<QPen> m_currentPen;
     PDFCachedItem<QBrush> m_currentBrush;
     std::vector<PDFTransparencyGroupPainterData> m_transparencyGroupDataStack;
@@ -172,7 +194,9 @@ public:
         SaveGraphicState,
         RestoreGraphicState,
         SetWorldMatrix,
-        SetCompositionMode
+        SetCompositionMode,
+        BeginOptionalContent,
+        EndOptionalContent
     };
 
     struct Instruction
@@ -195,11 +219,19 @@ public:
     /// \param pagePointToDevicePointMatrix Page point to device point transformation matrix
     /// \param features Renderer features
     /// \param opacity Opacity of page graphics
+    /// \param cullRect Visible area of the painter in device coordinates. Paths, images
+    ///        and meshes outside of this area are not drawn. If it is invalid, all
+    ///        instructions are drawn.
+    /// \param optionalContentActivity Optional content activity, which is used to evaluate
+    ///        optional content recorded in the page (page compiled with deferred optional
+    ///        content). If it is nullptr, all recorded optional content is drawn.
     void draw(QPainter* painter,
               const QRectF& cropBox,
               const QTransform& pagePointToDevicePointMatrix,
               PDFRenderer::Features features,
-              PDFReal opacity) const;
+              PDFReal opacity,
+              const QRectF& cullRect = QRectF(),
+              const PDFOptionalContentActivity* optionalContentActivity = nullptr) const;
 
     /// Redact path - remove all content intersecting given path,
     /// and fill redact path with given color.
@@ -208,6 +240,12 @@ public:
     void redact(QPainterPath redactPath, const QTransform& matrix, QColor color);
 
     void addPath(QPen pen, QBrush brush, QPainterPath path, bool isText);
+    void addGlyph(QBrush brush, QPainterPath path, PDFGlyphAtlasGlyph glyph);
+
+    /// Creates copy of the path, which doesn't allocate more memory than needed.
+    /// Paths are built incrementally, so their element arrays are usually larger.
+    /// \param path Path
+    static QPainterPath createCompactPath(const QPainterPath& path);
     void addClip(QPainterPath path);
     void addImage(QImage image);
     void addMesh(PDFMesh mesh, PDFReal alpha);
@@ -215,6 +253,30 @@ public:
     void addRestoreGraphicState() { m_instructions.emplace_back(InstructionType::RestoreGraphicState, 0); }
     void addSetWorldMatrix(const QTransform& matrix);
     void addSetCompositionMode(QPainter::CompositionMode compositionMode);
+    void addBeginOptionalContent(PDFObjectReference ocgOrOcmd);
+    void addEndOptionalContent() { m_instructions.emplace_back(InstructionType::EndOptionalContent, 0); }
+
+    /// Returns true, if page contains optional content, which is evaluated when
+    /// page is drawn (page was compiled with deferred optional content).
+    bool hasOptionalContent() const { return !m_optionalContents.empty(); }
+
+    /// Returns count of instructions of the page
+    size_t getInstructionCount() const { return m_instructions.size(); }
+
+    /// Returns true, if instructions in range [first, last) can be instantiated
+    /// using function \p instantiate. Images and meshes can't be instantiated,
+    /// because their snapping info and geometry are in page coordinates.
+    /// \param first First instruction
+    /// \param last Last instruction (not included)
+    bool canInstantiate(size_t first, size_t last) const;
+
+    /// Appends copy of instructions in range [first, last) at the end of the page.
+    /// World matrices of the copied instructions are multiplied by \p matrix,
+    /// so content can be placed at another position.
+    /// \param first First instruction
+    /// \param last Last instruction (not included)
+    /// \param matrix Matrix applied after world matrices of the instructions
+    void instantiate(size_t first, size_t last, const QTransform& matrix);
 
     /// Optimizes page memory allocation to contain less space
     void optimize();
@@ -227,9 +289,37 @@ public:
     /// \param errors List of rendering errors
     void finalize(qint64 compilingTimeNS, QList<PDFRenderError> errors);
 
+    /// Writes precompiled page into the stream, so it can be stored, for
+    /// example, in the disk cache. Glyph atlas data are not written, glyphs
+    /// of the deserialized page are drawn as ordinary paths.
+    /// \param stream Stream
+    void serialize(QDataStream& stream) const;
+
+    /// Reads precompiled page from the stream. Page must be written by
+    /// function \p serialize with the same persist version, otherwise
+    /// stream status is set to QDataStream::ReadCorruptData.
+    /// \param stream Stream
+    void deserialize(QDataStream& stream);
+
     /// Returns compiling time in nanoseconds
     qint64 getCompilingTimeNS() const { return m_compilingTimeNS; }
 
+    /// Time spent in operators of given type during compilation
+    struct OperatorTime
+    {
+        PDFPageContentProcessor::Operator op = PDFPageContentProcessor::Operator::Invalid;
+        qint64 timeNS = 0;  ///< Time spent in the operator, excluding nested operators [ns]
+        qint64 count = 0;   ///< Count of operator invocations
+    };
+
+    /// Sets times of the slowest operators. Times are measured only, when
+    /// feature DisplayTimes is turned on. They are not serialized.
+    /// \param operatorTimes Operator times, sorted by time in descending order
+    void setOperatorTimes(std::vector<OperatorTime> operatorTimes) { m_operatorTimes = qMove(operatorTimes); }
+
+    /// Returns times of the slowest operators, sorted by time in descending order
+    const std::vector<OperatorTime>& getOperatorTimes() const { return m_operatorTimes; }
+
     /// Returns a list of rendering errors
     const QList<PDFRenderError>& getErrors() const { return m_errors; }
 
@@ -280,7 +370,7 @@ public:
         Type type = Type::Unknown;
         QRectF boundingRect;
         std::array<uint8_t, 64> hash = { }; ///< Hash of all data
-        std::array<uint8_t, 64> imageHash = { }; ///< Hash of the image only
+        PDFImagePerceptualHash imageHash; ///< Perceptual hash of the image only
         QPainterPath pagePath;
     };
 
@@ -289,11 +379,14 @@ public:
     /// Creates information about piece of graphic in this page,
     /// for example, for comparation reasons. Parameter \p epsilon
     /// is for numerical precision - values under epsilon are considered
-    /// as equal.
+    /// as equal. Images are represented by their perceptual hash, so
+    /// resampled or recompressed images are considered as equal.
     /// \param mediaBox Page's media box
     /// \param epsilon Epsilon
+    /// \param imageHashCache Cache of image perceptual hashes (can be nullptr)
     GraphicPieceInfos calculateGraphicPieceInfos(QRectF mediaBox,
-                                                 PDFReal epsilon) const;
+                                                 PDFReal epsilon,
+                                                 PDFImagePerceptualHashCache* imageHashCache = nullptr) const;
 
 private:
     struct PathPaintData
@@ -305,13 +398,26 @@ private:
             path(qMove(path)),
             isText(isText)
         {
-
+            boundingRect = getPathBoundingRect(this->pen, this->path);
         }
 
         QPen pen;
         QBrush brush;
         QPainterPath path;
+
+        /// Bounding rectangle of the painted area (including the stroke) in user space.
+        /// Cosmetic pen width is not included, as it is in device space.
+        QRectF boundingRect;
+
+        /// Index of glyph data in the glyph array, if path is a glyph,
+        /// which can be drawn using glyph atlas.
+        uint32_t glyphIndex = INVALID_INDEX;
+
         bool isText = false;
+
+        /// Path data are shared with another path, so they are
+        /// counted only once in memory consumption.
+        bool isPathShared = false;
     };
 
     struct ClipData
@@ -324,6 +430,13 @@ private:
         }
 
         QPainterPath clipPath;
+
+        /// Clip path as rectangle, if clip path is axis-aligned
+        /// rectangle, otherwise rectangle is invalid.
+        QRectF clipRect;
+
+        /// Path data are shared with another clip path
+        bool isPathShared = false;
     };
 
     struct ImageData
@@ -335,9 +448,27 @@ private:
 
         }
 
+        /// Creates mip pyramid of the image, if image is large. Each level
+        /// has half size of the previous level (box filter is used).
+        void createMipmaps();
+
+        /// Returns image (or its mipmap level), which is the smallest one,
+        /// but still at least as large as the image in the device space.
+        /// \param matrix Matrix mapping unit square of the image to the device space
+        const QImage& getImage(const QTransform& matrix) const;
+
         QImage image;
+
+        /// Mip pyramid of large image (levels of half, quarter, ... size)
+        std::vector<QImage> mipmaps;
     };
 
+    /// Minimal size (width or height) of the image, for which mip pyramid is created
+    static constexpr int MIPMAP_MINIMAL_IMAGE_SIZE = 2048;
+
+    /// Minimal size (width and height) of the mipmap level
+    static constexpr int MIPMAP_MINIMAL_LEVEL_SIZE = 64;
+
     struct MeshPaintData
     {
         inline MeshPaintData() = default;
@@ -345,24 +476,47 @@ private:
             mesh(qMove(mesh)),
             alpha(alpha)
         {
-
+            boundingRect = this->mesh.getBoundingRect();
         }
 
         PDFMesh mesh;
         PDFReal alpha = 1.0;
+
+        /// Bounding rectangle of the mesh in page space
+        QRectF boundingRect;
     };
 
+    static constexpr uint32_t INVALID_INDEX = std::numeric_limits<uint32_t>::max();
+    static constexpr int persist_version = 2;
+
+    /// Returns glyph data of the path, or nullptr, if path is not a glyph
+    const PDFGlyphAtlasGlyph* getGlyph(const PathPaintData& data) const { return data.glyphIndex != INVALID_INDEX ? &m_glyphs[data.glyphIndex] : nullptr; }
+
+    /// Shares data of equal pens and brushes of paths
+    void deduplicatePensAndBrushes();
+
+    /// Removes duplicate world matrices
+    void deduplicateMatrices();
+
+    /// Returns bounding rectangle of the path painted using given pen
+    /// \param pen Pen
+    /// \param path Path
+    static QRectF getPathBoundingRect(const QPen& pen, const QPainterPath& path);
+
     qint64 m_compilingTimeNS = 0;
     qint64 m_memoryConsumptionEstimate = 0;
     QColor m_paperColor = QColor(Qt::white);
     std::vector<Instruction> m_instructions;
     std::vector<PathPaintData> m_paths;
+    std::vector<PDFGlyphAtlasGlyph> m_glyphs;
     std::vector<ClipData> m_clips;
     std::vector<ImageData> m_images;
     std::vector<MeshPaintData> m_meshes;
     std::vector<QTransform> m_matrices;
     std::vector<QPainter::CompositionMode> m_compositionModes;
+    std::vector<PDFObjectReference> m_optionalContents;
     QList<PDFRenderError> m_errors;
+    std::vector<OperatorTime> m_operatorTimes;
     PDFSnapInfo m_snapInfo;
     QElapsedTimer m_expirationTimer;
 };
@@ -383,18 +537,101 @@ public:
                                          const PDFOptionalContentActivity* optionalContentActivity,
                                          const PDFMeshQualitySettings& meshQualitySettings);
 
+    using BaseClass::setImageTargetMatrix;
+
+    /// Sets, if optional content is deferred. If it is, then all optional content
+    /// is written to the precompiled page and it is evaluated, when page is drawn,
+    /// so precompiled page doesn't depend on the state of the optional content.
+    /// \param optionalContentDeferred Is optional content deferred?
+    void setOptionalContentDeferred(bool optionalContentDeferred) { m_isOptionalContentDeferred = optionalContentDeferred; }
+
+    /// Returns times of the slowest operators, sorted by time in descending
+    /// order. Times are measured only, when feature DisplayTimes is turned on.
+    /// \param count Maximal count of operators
+    std::vector<PDFPrecompiledPage::OperatorTime> getSlowestOperators(size_t count) const;
+
 protected:
+    virtual void performInterceptInstruction(Operator currentOperator, ProcessOrder processOrder, const QByteArray& operatorAsText) override;
     virtual void performPathPainting(const QPainterPath& path, bool stroke, bool fill, bool text, Qt::FillRule fillRule) override;
     virtual void performClipping(const QPainterPath& path, Qt::FillRule fillRule) override;
     virtual void performImagePainting(const QImage& image) override;
     virtual void performMeshPainting(const PDFMesh& mesh) override;
+    virtual bool isOptionalContentDeferred() const override;
+    virtual void performOptionalContentBegin(PDFObjectReference ocgOrOcmd) override;
+    virtual void performOptionalContentEnd() override;
     virtual void performSaveGraphicState(ProcessOrder order) override;
     virtual void performRestoreGraphicState(ProcessOrder order) override;
     virtual void setWorldMatrix(const QTransform& matrix) override;
     virtual void setCompositionMode(QPainter::CompositionMode mode) override;
+    virtual bool performProcessForm(ProcessOrder order, const PDFStream* stream) override;
 
 private:
+    /// Part of the graphic state inherited by the form, on which
+    /// output of the form depends (except of transformation matrix).
+    struct FormInheritedState
+    {
+        bool operator==(const FormInheritedState&) const = default;
+
+        const PDFAbstractColorSpace* strokeColorSpace = nullptr;
+        const PDFAbstractColorSpace* fillColorSpace = nullptr;
+        QColor strokeColor;
+        QColor fillColor;
+        PDFReal lineWidth = 0.0;
+        Qt::PenCapStyle lineCapStyle = Qt::FlatCap;
+        Qt::PenJoinStyle lineJoinStyle = Qt::MiterJoin;
+        PDFReal mitterLimit = 0.0;
+        PDFLineDashPattern lineDashPattern;
+        RenderingIntent renderingIntent = RenderingIntent::Unknown;
+        PDFReal alphaStroking = 1.0;
+        PDFReal alphaFilling = 1.0;
+        BlendMode blendMode = BlendMode::Normal;
+        const PDFDictionary* softMask = nullptr;
+        PDFFontPointer textFont;
+        PDFReal textFontSize = 0.0;
+        TextRenderingMode textRenderingMode = TextRenderingMode::Fill;
+        PDFReal textCharacterSpacing = 0.0;
+        PDFReal textWordSpacing = 0.0;
+        PDFReal textHorizontalScaling = 0.0;
+        PDFReal textLeading = 0.0;
+        PDFReal textRise = 0.0;
+        std::array<const PDFDictionary*, 6> resources = { };
+    };
+
+    /// Instructions of the precompiled page, which were generated by the form
+    struct FormInstructions
+    {
+        FormInheritedState state;
+        QTransform matrix;              ///< World matrix, when form was invoked
+        size_t firstInstruction = 0;
+        size_t lastInstruction = 0;
+        bool isReusable = false;
+    };
+
+    /// Returns true, if form output can be recorded or reused in current state
+    bool canReuseFormInstructions() const;
+
+    /// Returns current state inherited by invoked form
+    FormInheritedState getFormInheritedState() const;
+
     PDFPrecompiledPage* m_precompiledPage;
+    bool m_isOptionalContentDeferred = false;
+
+    /// Instructions of already processed forms, key is stream's unique id
+    std::map<quint64, FormInstructions> m_formInstructions;
+
+    /// Forms currently being processed (recorded)
+    std::vector<std::pair<quint64, FormInstructions>> m_formInstructionsStack;
+
+    /// Operator being timed, operators can be nested (for example, operators of the form)
+    struct OperatorTimer
+    {
+        qint64 startTimeNS = 0;
+        qint64 nestedTimeNS = 0;
+    };
+
+    QElapsedTimer m_operatorTimer;
+    std::vector<OperatorTimer> m_operatorTimerStack;
+    std::array<PDFPrecompiledPage::OperatorTime, size_t(Operator::Invalid)> m_operatorTimes = { };
 };
 
 }   // namespace pdf
@@ -28,6 +28,8 @@
 
 #include "pdfdbgheap.h"
 
+#include <array>
+
 namespace pdf
 {
 
@@ -237,4 +239,52 @@ QTransform PDFPainterHelper::composeTransform(const PDFTransformationDecompositi
     return QTransform(m11, m12, m21, m22, dx, dy);
 }
 
+QRectF PDFPainterHelper::getAxisAlignedRectangle(const QPainterPath& path)
+{
+    // Rectangle consists of move to element and three or four line
+    // to elements (last element can return to the starting point).
+    const int elementCount = path.elementCount();
+    if (elementCount != 4 && elementCount != 5)
+    {
+        return QRectF();
+    }
+
+    std::array<QPointF, 4> points;
+    for (int i = 0; i < elementCount; ++i)
+    {
+        const QPainterPath::Element& element = path.elementAt(i);
+        if (element.type != (i == 0 ? QPainterPath::MoveToElement : QPainterPath::LineToElement))
+        {
+            return QRectF();
+        }
+
+        const QPointF point(element.x, element.y);
+        if (i < 4)
+        {
+            points[i] = point;
+        }
+        else if (point != points[0])
+        {
+            return QRectF();
+        }
+    }
+
+    // Edges must be alternately horizontal and vertical
+    const bool isFirstEdgeHorizontal = points[0].y() == points[1].y();
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        const QPointF& p1 = points[i];
+        const QPointF& p2 = points[(i + 1) % points.size()];
+        const bool isHorizontal = (i % 2 == 0) == isFirstEdgeHorizontal;
+
+        if (isHorizontal ? p1.y() != p2.y() : p1.x() != p2.x())
+        {
+            return QRectF();
+        }
+    }
+
+    const QRectF rect = QRectF(points[0], points[2]).normalized();
+    return rect.isValid() ? rect : QRectF();
+}
+
 }   // namespace pdf
@@ -86,6 +86,12 @@ public:
 
     /// Compose transform
     static QTransform composeTransform(const PDFTransformationDecomposition& decomposition);
+
+    /// Returns rectangle, if path consists of single axis-aligned rectangle,
+    /// otherwise invalid rectangle is returned. Such paths can be used for
+    /// clipping as rectangles, which is much faster, than path clipping.
+    /// \param path Path
+    static QRectF getAxisAlignedRectangle(const QPainterPath& path);
 };
 
 }   // namespace pdf
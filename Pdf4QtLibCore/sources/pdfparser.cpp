@@ -23,6 +23,7 @@
 #include "pdfparser.h"
 #include "pdfconstants.h"
 #include "pdfexception.h"
+#include "pdfbytescanner.h"
 
 #include <QFile>
 #include <QThread>
@@ -30,8 +31,10 @@
 
 #include "pdfdbgheap.h"
 
+#include <cmath>
 #include <cctype>
 #include <memory>
+#include <algorithm>
 
 namespace pdf
 {
@@ -47,13 +50,24 @@ PDFLexicalAnalyzer::PDFLexicalAnalyzer(const char* begin, const char* end) :
 
 PDFLexicalAnalyzer::Token PDFLexicalAnalyzer::fetch()
 {
+    TypedToken token;
+    fetch(token);
+    return token.toToken();
+}
+
+void PDFLexicalAnalyzer::fetch(TypedToken& token)
+{
+    token.type = TokenType::EndOfFile;
+    token.string = QByteArrayView();
+    token.isStringBuffered = false;
+
     // Skip whitespace/comments at first
     skipWhitespaceAndComments();
 
     // If we are at end of token, then return immediately
     if (isAtEnd())
     {
-        return Token(TokenType::EndOfFile);
+        return;
     }
 
     switch (lookChar())
@@ -72,118 +86,54 @@ PDFLexicalAnalyzer::Token PDFLexicalAnalyzer::fetch()
         case '-':
         case '.':
         {
-            // Scan integer or real number. If integer overflows, then it is converted to the real number. If
-            // real number overflow, then error is reported. This behaviour is according to the PDF 1.7 specification,
-            // chapter 3.2.2.
-
-            // First, treat special characters
-            bool positive = fetchChar('+');
-            bool negative = fetchChar('-');
-            bool dot = fetchChar('.');
-            bool treatAsReal = dot;
-            bool atLeastOneDigit = false;
-
-            if (isAtEnd())
-            {
-                error(tr("Expected a number, but end of stream reached."));
-            }
+            fetchNumber(token);
+            return;
+        }
 
-            PDFInteger integer = 0;
-            PDFReal real = 0.0;
-            PDFReal scale = 0.1;
+        case CHAR_LEFT_BRACKET:
+        {
+            // String '(', sequence of literal characters enclosed in "()", see PDF 1.7 Reference,
+            // chapter 3.2.3. Note: literal string can have properly balanced brackets inside.
 
-            // Now, we can only have digits and a single dot
-            while (!isAtEnd())
+            int parenthesisBalance = 1;
+
+            // Skip first character
+            fetchChar();
+
+            // Fast path - if string doesn't contain any escape sequence, then
+            // token refers directly to the scanned data.
+            const char* stringBegin = m_current;
+            while (true)
             {
-                if (!dot && fetchChar('.'))
+                m_current = PDFByteScanner::findLiteralStringSpecialCharacter(m_current, m_end);
+                const char character = fetchChar();
+
+                if (character == CHAR_LEFT_BRACKET)
                 {
-                    // Entering real mode
-                    dot = true;
-                    treatAsReal = true;
-                    real = integer;
+                    ++parenthesisBalance;
                 }
-                else if (std::isdigit(static_cast<unsigned char>(lookChar())))
+                else if (character == CHAR_RIGHT_BRACKET)
                 {
-                    atLeastOneDigit = true;
-                    PDFInteger digit = lookChar() - '0';
-                    ++m_current;
-
-                    if (!treatAsReal)
+                    if (--parenthesisBalance == 0)
                     {
-                        // Treat value as integer
-                        integer = integer * 10 + digit;
-
-                        // Check, if integer has not overflown, if yes, treat him as real
-                        // according to the PDF 1.7 specification.
-                        if (!isValidInteger(integer))
-                        {
-                            treatAsReal = true;
-                            real = integer;
-                        }
-                    }
-                    else
-                    {
-                        // Treat value as real
-                        if (!dot)
-                        {
-                            real = real * 10.0 + digit;
-                        }
-                        else
-                        {
-                            real = real + scale * digit;
-                            scale *= 0.1;
-                        }
+                        // We are done.
+                        token.type = TokenType::String;
+                        token.string = QByteArrayView(stringBegin, std::prev(m_current));
+                        return;
                     }
                 }
-                else if (isWhitespace(lookChar()) || isDelimiter(lookChar()))
+                else if (character == CHAR_BACKSLASH)
                 {
-                    // Whitespace appeared - whitespaces/delimiters delimits tokens - break
+                    // Escape sequence found, string must be decoded
+                    --m_current;
                     break;
                 }
-                else
-                {
-                    // Another character other than dot and digit appeared - this is an error
-                    error(tr("Invalid format of number. Character '%1' appeared.").arg(lookChar()));
-                }
-            }
-
-            // Now, we have scanned whole token number, check for errors.
-            if (positive && negative)
-            {
-                error(tr("Both '+' and '-' appeared in number. Invalid format of number."));
-            }
-
-            if (!atLeastOneDigit)
-            {
-                error(tr("Bad format of number - no digits appeared."));
-            }
-
-            // Check for real overflow
-            if (treatAsReal && !std::isfinite(real))
-            {
-                error(tr("Real number overflow."));
             }
 
-            if (negative)
-            {
-                integer = -integer;
-                real = -real;
-            }
-
-            return !treatAsReal ? Token(TokenType::Integer, QVariant(static_cast<qint64>(integer))) : Token(TokenType::Real, real);
-        }
-
-        case CHAR_LEFT_BRACKET:
-        {
-            // String '(', sequence of literal characters enclosed in "()", see PDF 1.7 Reference,
-            // chapter 3.2.3. Note: literal string can have properly balanced brackets inside.
-
-            int parenthesisBalance = 1;
-            QByteArray string;
+            QByteArray& string = token.buffer;
+            string.resize(0);
             string.reserve(STRING_BUFFER_RESERVE);
-
-            // Skip first character
-            fetchChar();
+            string.append(stringBegin, std::distance(stringBegin, m_current));
 
             while (true)
             {
@@ -202,7 +152,9 @@ PDFLexicalAnalyzer::Token PDFLexicalAnalyzer::fetch()
                         if (--parenthesisBalance == 0)
                         {
                             // We are done.
-                            return Token(TokenType::String, string);
+                            token.type = TokenType::String;
+                            token.isStringBuffered = true;
+                            return;
                         }
                         else
                         {
@@ -300,7 +252,7 @@ PDFLexicalAnalyzer::Token PDFLexicalAnalyzer::fetch()
             // This code should be unreachable. Either normal string is scanned - then it is returned
             // in the while cycle above, or exception is thrown.
             Q_ASSERT(false);
-            return Token(TokenType::EndOfFile);
+            return;
         }
 
         case CHAR_SLASH:
@@ -310,8 +262,23 @@ PDFLexicalAnalyzer::Token PDFLexicalAnalyzer::fetch()
 
             fetchChar();
 
-            QByteArray name;
+            // Fast path - if name doesn't contain #XX characters, then token
+            // refers directly to the scanned data.
+            const char* nameBegin = m_current;
+            const char* nameEnd = PDFByteScanner::findNonRegular(m_current, m_end);
+            m_current = std::find(nameBegin, nameEnd, CHAR_MARK);
+
+            if (m_current == nameEnd)
+            {
+                token.type = TokenType::Name;
+                token.string = QByteArrayView(nameBegin, nameEnd);
+                return;
+            }
+
+            QByteArray& name = token.buffer;
+            name.resize(0);
             name.reserve(NAME_BUFFER_RESERVE);
+            name.append(nameBegin, std::distance(nameBegin, m_current));
 
             while (!isAtEnd())
             {
@@ -322,7 +289,7 @@ PDFLexicalAnalyzer::Token PDFLexicalAnalyzer::fetch()
 
                     if (isHexCharacter(hexHighCharacter) && isHexCharacter(hexLowCharacter))
                     {
-                        name += QByteArray::fromHex(QByteArray::fromRawData(m_current - 2, 2));
+                        name += static_cast<char>((getHexCharacterValue(hexHighCharacter) << 4) | getHexCharacterValue(hexLowCharacter));
                     }
                     else
                     {
@@ -349,19 +316,23 @@ PDFLexicalAnalyzer::Token PDFLexicalAnalyzer::fetch()
                 }
             }
 
-            return Token(TokenType::Name, std::move(name));
+            token.type = TokenType::Name;
+            token.isStringBuffered = true;
+            return;
         }
 
         case CHAR_ARRAY_START:
         {
             ++m_current;
-            return Token(TokenType::ArrayStart);
+            token.type = TokenType::ArrayStart;
+            return;
         }
 
         case CHAR_ARRAY_END:
         {
             ++m_current;
-            return Token(TokenType::ArrayEnd);
+            token.type = TokenType::ArrayEnd;
+            return;
         }
 
         case CHAR_LEFT_ANGLE:
@@ -371,14 +342,17 @@ PDFLexicalAnalyzer::Token PDFLexicalAnalyzer::fetch()
             // Check if it is dictionary start
             if (fetchChar(CHAR_LEFT_ANGLE))
             {
-                return Token(TokenType::DictionaryStart);
+                token.type = TokenType::DictionaryStart;
+                return;
             }
             else
             {
-                // Reserve two times normal size, because in hexadecimal string, each character
-                // is represented as a pair of hexadecimal numbers.
-                QByteArray hexadecimalString;
-                hexadecimalString.reserve(STRING_BUFFER_RESERVE * 2);
+                // Hexadecimal digits are decoded directly into the token buffer,
+                // each pair of digits represents one character.
+                QByteArray& decodedString = token.buffer;
+                decodedString.resize(0);
+                decodedString.reserve(STRING_BUFFER_RESERVE);
+                int highValue = -1;
 
                 // Scan hexadecimal string
                 while (!isAtEnd())
@@ -386,19 +360,29 @@ PDFLexicalAnalyzer::Token PDFLexicalAnalyzer::fetch()
                     const char character = fetchChar();
                     if (isHexCharacter(character))
                     {
-                        hexadecimalString += character;
+                        const int value = getHexCharacterValue(character);
+                        if (highValue == -1)
+                        {
+                            highValue = value;
+                        }
+                        else
+                        {
+                            decodedString += static_cast<char>((highValue << 4) | value);
+                            highValue = -1;
+                        }
                     }
                     else if (character == CHAR_RIGHT_ANGLE)
                     {
                         // End of string mark. According to the specification, string can contain odd number
                         // of hexadecimal digits, in this case, zero is appended to the string.
-                        if (hexadecimalString.size() % 2 == 1)
+                        if (highValue != -1)
                         {
-                            hexadecimalString += '0';
+                            decodedString += static_cast<char>(highValue << 4);
                         }
 
-                        QByteArray decodedString = QByteArray::fromHex(hexadecimalString);
-                        return Token(TokenType::String, std::move(decodedString));
+                        token.type = TokenType::String;
+                        token.isStringBuffered = true;
+                        return;
                     }
                     else if (isWhitespace(character))
                     {
@@ -425,7 +409,8 @@ PDFLexicalAnalyzer::Token PDFLexicalAnalyzer::fetch()
 
             if (fetchChar(CHAR_RIGHT_ANGLE))
             {
-                return Token(TokenType::DictionaryEnd);
+                token.type = TokenType::DictionaryEnd;
+                return;
             }
 
             error(tr("Invalid character '%1'").arg(CHAR_RIGHT_ANGLE));
@@ -442,37 +427,40 @@ PDFLexicalAnalyzer::Token PDFLexicalAnalyzer::fetch()
             if (isRegular(lookChar()))
             {
                 // It should be sequence of regular characters - command, true, false, null...
-                QByteArray command;
-                command.reserve(COMMAND_BUFFER_RESERVE);
+                const char* commandBegin = m_current;
+                m_current = PDFByteScanner::findNonRegular(m_current, m_end);
 
-                while (!isAtEnd() && isRegular(lookChar()))
+                const QByteArrayView command(commandBegin, m_current);
+                if (command == QByteArrayView(BOOL_OBJECT_TRUE_STRING))
                 {
-                    command += fetchChar();
+                    token.type = TokenType::Boolean;
+                    token.boolean = true;
                 }
-
-                if (command == BOOL_OBJECT_TRUE_STRING)
-                {
-                    return Token(TokenType::Boolean, true);
-                }
-                else if (command == BOOL_OBJECT_FALSE_STRING)
+                else if (command == QByteArrayView(BOOL_OBJECT_FALSE_STRING))
                 {
-                    return Token(TokenType::Boolean, false);
+                    token.type = TokenType::Boolean;
+                    token.boolean = false;
                 }
-                else if (command == NULL_OBJECT_STRING)
+                else if (command == QByteArrayView(NULL_OBJECT_STRING))
                 {
-                    return Token(TokenType::Null);
+                    token.type = TokenType::Null;
                 }
                 else
                 {
-                    return Token(TokenType::Command, std::move(command));
+                    token.type = TokenType::Command;
+                    token.string = command;
                 }
+                return;
             }
             else if (m_tokenizingPostScriptFunction)
             {
                 const char currentChar = lookChar();
                 if (currentChar == CHAR_LEFT_CURLY_BRACKET || currentChar == CHAR_RIGHT_CURLY_BRACKET)
                 {
-                    return Token(TokenType::Command, QByteArray(1, fetchChar()));
+                    token.type = TokenType::Command;
+                    token.string = QByteArrayView(m_current, 1);
+                    ++m_current;
+                    return;
                 }
 
                 error(tr("Unexpected character '%1' in the stream.").arg(currentChar));
@@ -484,54 +472,260 @@ PDFLexicalAnalyzer::Token PDFLexicalAnalyzer::fetch()
             break;
         }
     }
+}
+
+QByteArray PDFLexicalAnalyzer::TypedToken::getByteArray() const
+{
+    if (isStringBuffered)
+    {
+        return buffer;
+    }
 
-    return Token(TokenType::EndOfFile);
+    return string.toByteArray();
 }
 
-void PDFLexicalAnalyzer::seek(PDFInteger offset)
+bool PDFLexicalAnalyzer::TypedToken::isCommand(const char* command) const
 {
-    const PDFInteger limit = std::distance(m_begin, m_end);
-    if (offset >= 0 && offset <= limit)
+    return type == TokenType::Command && getString() == QByteArrayView(command);
+}
+
+void PDFLexicalAnalyzer::TypedToken::detach()
+{
+    if (!isStringBuffered && !string.isNull())
     {
-        m_current = std::next(m_begin, offset);
+        buffer = string.toByteArray();
+        string = QByteArrayView();
+        isStringBuffered = true;
     }
-    else
+}
+
+PDFLexicalAnalyzer::Token PDFLexicalAnalyzer::TypedToken::toToken() const
+{
+    switch (type)
     {
-        error(tr("Trying to seek stream position to %1 bytes from the start, byte offset is invalid.").arg(offset));
+        case TokenType::Boolean:
+            return Token(type, boolean);
+
+        case TokenType::Integer:
+            return Token(type, QVariant(static_cast<qint64>(integer)));
+
+        case TokenType::Real:
+            return Token(type, real);
+
+        case TokenType::String:
+        case TokenType::Name:
+        case TokenType::Command:
+            return Token(type, getByteArray());
+
+        default:
+            break;
     }
+
+    return Token(type);
 }
 
-void PDFLexicalAnalyzer::skipWhitespaceAndComments()
+PDFLexicalAnalyzer::TypedToken PDFLexicalAnalyzer::TypedToken::fromToken(const Token& token)
+{
+    TypedToken typedToken;
+    typedToken.type = token.type;
+
+    switch (token.type)
+    {
+        case TokenType::Boolean:
+            typedToken.boolean = token.data.toBool();
+            break;
+
+        case TokenType::Integer:
+            typedToken.integer = token.data.toLongLong();
+            break;
+
+        case TokenType::Real:
+            typedToken.real = token.data.toDouble();
+            break;
+
+        case TokenType::String:
+        case TokenType::Name:
+        case TokenType::Command:
+            typedToken.buffer = token.data.toByteArray();
+            typedToken.isStringBuffered = true;
+            break;
+
+        default:
+            break;
+    }
+
+    return typedToken;
+}
+
+void PDFLexicalAnalyzer::fetchNumber(TypedToken& token)
 {
-    bool isComment = false;
+    // Scan integer or real number. If integer overflows, then it is converted to the real number. If
+    // real number overflow, then error is reported. This behaviour is according to the PDF 1.7 specification,
+    // chapter 3.2.2. PDF numbers don't have exponent, so we can accumulate all digits into the mantissa.
+
+    // Mantissa can hold 18 significant digits without overflow. Less significant digits
+    // of the integer part only increase decimal exponent, less significant digits
+    // of the fractional part are ignored, as they can't change the double value.
+    constexpr int MAX_SIGNIFICANT_DIGITS = 18;
+
+    // Maximal mantissa, which is exactly representable as double
+    constexpr quint64 MAX_EXACT_MANTISSA = quint64(1) << 53;
+
+    // Powers of ten, which are exactly representable as double
+    static constexpr PDFReal POWERS_OF_TEN[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                                 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    constexpr int MAX_EXACT_POWER_OF_TEN = int(std::size(POWERS_OF_TEN)) - 1;
 
-    while (m_current != m_end)
+    const char* current = m_current;
+
+    // First, treat special characters
+    const bool positive = current != m_end && *current == '+';
+    if (positive)
     {
-        if (isComment)
+        ++current;
+    }
+
+    const bool negative = current != m_end && *current == '-';
+    if (negative)
+    {
+        ++current;
+    }
+
+    bool dot = current != m_end && *current == '.';
+    if (dot)
+    {
+        ++current;
+    }
+
+    if (current == m_end)
+    {
+        m_current = current;
+        error(tr("Expected a number, but end of stream reached."));
+    }
+
+    quint64 mantissa = 0;
+    int significantDigits = 0;
+    int exponent = 0;
+    bool atLeastOneDigit = false;
+
+    // Now, we can only have digits and a single dot
+    for (; current != m_end; ++current)
+    {
+        const char character = *current;
+        const unsigned int digit = static_cast<unsigned char>(character) - unsigned('0');
+
+        if (digit < 10)
         {
-            // Comment ends at end of line
-            if (*m_current == CHAR_CARRIAGE_RETURN || *m_current == CHAR_LINE_FEED)
+            atLeastOneDigit = true;
+
+            if (significantDigits < MAX_SIGNIFICANT_DIGITS)
             {
-                isComment = false;
-            }
+                mantissa = mantissa * 10 + digit;
 
-            // Commented character - step to the next character
-            ++m_current;
+                // Leading zeroes are not significant
+                if (mantissa != 0)
+                {
+                    ++significantDigits;
+                }
+
+                if (dot)
+                {
+                    --exponent;
+                }
+            }
+            else if (!dot)
+            {
+                ++exponent;
+            }
         }
-        else if (*m_current == CHAR_PERCENT)
+        else if (character == '.' && !dot)
         {
-            isComment = true;
-            ++m_current;
+            // Entering real mode
+            dot = true;
         }
-        else if (isWhitespace(*m_current))
+        else if (isWhitespace(character) || isDelimiter(character))
         {
-            ++m_current;
+            // Whitespace appeared - whitespaces/delimiters delimits tokens - break
+            break;
         }
         else
+        {
+            // Another character other than dot and digit appeared - this is an error
+            m_current = current;
+            error(tr("Invalid format of number. Character '%1' appeared.").arg(character));
+        }
+    }
+
+    m_current = current;
+
+    // Now, we have scanned whole token number, check for errors.
+    if (positive && negative)
+    {
+        error(tr("Both '+' and '-' appeared in number. Invalid format of number."));
+    }
+
+    if (!atLeastOneDigit)
+    {
+        error(tr("Bad format of number - no digits appeared."));
+    }
+
+    if (!dot && exponent == 0 && mantissa <= quint64(PDF_INTEGER_MAX))
+    {
+        const PDFInteger integer = static_cast<PDFInteger>(mantissa);
+        token.type = TokenType::Integer;
+        token.integer = negative ? -integer : integer;
+        return;
+    }
+
+    PDFReal real = 0.0;
+    if (mantissa <= MAX_EXACT_MANTISSA && exponent >= -MAX_EXACT_POWER_OF_TEN && exponent <= MAX_EXACT_POWER_OF_TEN)
+    {
+        // Fast path - both mantissa and power of ten are exact, so result is correctly rounded
+        real = exponent < 0 ? PDFReal(mantissa) / POWERS_OF_TEN[-exponent] : PDFReal(mantissa) * POWERS_OF_TEN[exponent];
+    }
+    else
+    {
+        real = exponent < 0 ? PDFReal(mantissa) / std::pow(10.0, -exponent) : PDFReal(mantissa) * std::pow(10.0, exponent);
+    }
+
+    // Check for real overflow
+    if (!std::isfinite(real))
+    {
+        error(tr("Real number overflow."));
+    }
+
+    token.type = TokenType::Real;
+    token.real = negative ? -real : real;
+}
+
+void PDFLexicalAnalyzer::seek(PDFInteger offset)
+{
+    const PDFInteger limit = std::distance(m_begin, m_end);
+    if (offset >= 0 && offset <= limit)
+    {
+        m_current = std::next(m_begin, offset);
+    }
+    else
+    {
+        error(tr("Trying to seek stream position to %1 bytes from the start, byte offset is invalid.").arg(offset));
+    }
+}
+
+void PDFLexicalAnalyzer::skipWhitespaceAndComments()
+{
+    while (true)
+    {
+        m_current = PDFByteScanner::skipWhitespace(m_current, m_end);
+
+        if (m_current == m_end || *m_current != CHAR_PERCENT)
         {
             // Not a whitespace and not in comment
             break;
         }
+
+        // Comment ends at end of line, end of line character is skipped
+        // as a whitespace in the next pass.
+        m_current = PDFByteScanner::findLineEnd(m_current + 1, m_end);
     }
 }
 
@@ -557,6 +751,20 @@ QByteArray PDFLexicalAnalyzer::fetchByteArray(PDFInteger length)
     return result;
 }
 
+QByteArray PDFLexicalAnalyzer::fetchRawByteArray(PDFInteger length)
+{
+    Q_ASSERT(length >= 0);
+
+    if (std::distance(m_current, m_end) < length)
+    {
+        error(tr("Can't read %1 bytes from the input stream. Input stream end reached.").arg(length));
+    }
+
+    QByteArray result = QByteArray::fromRawData(m_current, length);
+    std::advance(m_current, length);
+    return result;
+}
+
 PDFInteger PDFLexicalAnalyzer::findSubstring(const char* str, PDFInteger position) const
 {
     const PDFInteger length = std::distance(m_begin, m_end);
@@ -565,16 +773,10 @@ PDFInteger PDFLexicalAnalyzer::findSubstring(const char* str, PDFInteger positio
         return -1;
     }
 
-    const PDFInteger substringLength = qstrlen(str);
-    const PDFInteger startPos = position;
-    const PDFInteger endPos = length - substringLength;
-    for (PDFInteger i = startPos; i <= endPos; ++i)
+    const char* found = PDFByteScanner::find(m_begin + position, m_end, str, qstrlen(str));
+    if (found != m_end)
     {
-        Q_ASSERT(std::distance(m_begin + i + substringLength - 1, m_end) >= 0);
-        if (memcmp(m_begin + i, str, substringLength) == 0)
-        {
-            return i;
-        }
+        return std::distance(m_begin, found);
     }
 
     return -1;
@@ -647,6 +849,21 @@ constexpr bool PDFLexicalAnalyzer::isHexCharacter(const char character)
     return (character >= '0' && character <= '9') || (character >= 'A' && character <= 'F') || (character >= 'a' && character <= 'f');
 }
 
+constexpr int PDFLexicalAnalyzer::getHexCharacterValue(const char character)
+{
+    if (character >= '0' && character <= '9')
+    {
+        return character - '0';
+    }
+    else if (character >= 'A' && character <= 'F')
+    {
+        return character - 'A' + 10;
+    }
+
+    Q_ASSERT(character >= 'a' && character <= 'f');
+    return character - 'a' + 10;
+}
+
 void PDFLexicalAnalyzer::error(const QString& message) const
 {
     std::size_t distance = std::distance(m_begin, m_current);
@@ -687,8 +904,8 @@ PDFParser::PDFParser(const QByteArray& data, PDFParsingContext* context, Feature
     m_features(features),
     m_lexicalAnalyzer(data.constData(), data.constData() + data.size())
 {
-    m_lookAhead1 = fetch();
-    m_lookAhead2 = fetch();
+    fetch(m_lookAhead1);
+    fetch(m_lookAhead2);
 }
 
 PDFParser::PDFParser(const char* begin, const char* end, PDFParsingContext* context, Features features) :
@@ -696,18 +913,24 @@ PDFParser::PDFParser(const char* begin, const char* end, PDFParsingContext* cont
     m_features(features),
     m_lexicalAnalyzer(begin, end)
 {
-    m_lookAhead1 = fetch();
-    m_lookAhead2 = fetch();
+    fetch(m_lookAhead1);
+    fetch(m_lookAhead2);
 }
 
 PDFParser::PDFParser(std::function<PDFLexicalAnalyzer::Token ()> tokenFetcher) :
+    PDFParser(std::function<PDFLexicalAnalyzer::TypedToken ()>([tokenFetcher = qMove(tokenFetcher)]() { return PDFLexicalAnalyzer::TypedToken::fromToken(tokenFetcher()); }))
+{
+
+}
+
+PDFParser::PDFParser(std::function<PDFLexicalAnalyzer::TypedToken ()> tokenFetcher) :
     m_tokenFetcher(qMove(tokenFetcher)),
     m_context(nullptr),
     m_features(None),
     m_lexicalAnalyzer(nullptr, nullptr)
 {
-    m_lookAhead1 = fetch();
-    m_lookAhead2 = fetch();
+    fetch(m_lookAhead1);
+    fetch(m_lookAhead2);
 }
 
 PDFObject PDFParser::getObject()
@@ -716,26 +939,22 @@ PDFObject PDFParser::getObject()
     {
         case PDFLexicalAnalyzer::TokenType::Boolean:
         {
-            Q_ASSERT(m_lookAhead1.data.typeId() == QMetaType::Bool);
-            const bool value = m_lookAhead1.data.toBool();
+            const bool value = m_lookAhead1.boolean;
             shift();
             return PDFObject::createBool(value);
         }
 
         case PDFLexicalAnalyzer::TokenType::Integer:
         {
-            Q_ASSERT(m_lookAhead1.data.typeId() == QMetaType::LongLong);
-            const PDFInteger value = m_lookAhead1.data.toLongLong();
+            const PDFInteger value = m_lookAhead1.integer;
             shift();
 
             // We must check, if we are reading reference. In this case,
             // actual value is integer and next value is command "R".
             if (m_lookAhead1.type == PDFLexicalAnalyzer::TokenType::Integer &&
-                m_lookAhead2.type == PDFLexicalAnalyzer::TokenType::Command &&
-                m_lookAhead2.data.toByteArray() == PDF_REFERENCE_COMMAND)
+                m_lookAhead2.isCommand(PDF_REFERENCE_COMMAND))
             {
-                Q_ASSERT(m_lookAhead1.data.typeId() == QMetaType::LongLong);
-                const PDFInteger generation = m_lookAhead1.data.toLongLong();
+                const PDFInteger generation = m_lookAhead1.integer;
                 shift();
                 shift();
                 return PDFObject::createReference(PDFObjectReference(value, generation));
@@ -749,28 +968,17 @@ PDFObject PDFParser::getObject()
 
         case PDFLexicalAnalyzer::TokenType::Real:
         {
-            Q_ASSERT(m_lookAhead1.data.typeId() == QMetaType::Double);
-            const PDFReal value = m_lookAhead1.data.toDouble();
+            const PDFReal value = m_lookAhead1.real;
             shift();
             return PDFObject::createReal(value);
         }
 
         case PDFLexicalAnalyzer::TokenType::String:
-        {
-            Q_ASSERT(m_lookAhead1.data.typeId() == QMetaType::QByteArray);
-            QByteArray array = m_lookAhead1.data.toByteArray();
-            array.shrink_to_fit();
-            shift();
-            return PDFObject::createString(std::move(array));
-        }
-
         case PDFLexicalAnalyzer::TokenType::Name:
         {
-            Q_ASSERT(m_lookAhead1.data.typeId() == QMetaType::QByteArray);
-            QByteArray array = m_lookAhead1.data.toByteArray();
-            array.shrink_to_fit();
+            PDFObject object = createStringObject(m_lookAhead1, m_objectArena);
             shift();
-            return PDFObject::createName(std::move(array));
+            return object;
         }
 
         case PDFLexicalAnalyzer::TokenType::ArrayStart:
@@ -779,7 +987,7 @@ PDFObject PDFParser::getObject()
 
             // Create shared pointer to the array (if the exception is thrown, array
             // will be properly destroyed by the shared array destructor)
-            std::shared_ptr<PDFObjectContent> arraySharedPointer = std::make_shared<PDFArray>();
+            std::shared_ptr<PDFObjectContent> arraySharedPointer = makeSharedInArena<PDFArray>(m_objectArena);
             PDFArray* array = static_cast<PDFArray*>(arraySharedPointer.get());
 
             while (m_lookAhead1.type != PDFLexicalAnalyzer::TokenType::EndOfFile &&
@@ -807,7 +1015,7 @@ PDFObject PDFParser::getObject()
 
             // Start reading the dictionary. BEWARE! It can also be a stream. In this case,
             // we must load also the stream content.
-            std::shared_ptr<PDFDictionary> dictionarySharedPointer = std::make_shared<PDFDictionary>();
+            std::shared_ptr<PDFDictionary> dictionarySharedPointer = makeSharedInArena<PDFDictionary>(m_objectArena);
             PDFDictionary* dictionary = dictionarySharedPointer.get();
 
             // Now, scan key/value pairs
@@ -820,13 +1028,16 @@ PDFObject PDFParser::getObject()
                     error(tr("Dictionary key must be a name."));
                 }
 
-                QByteArray key = m_lookAhead1.data.toByteArray();
+                // Long keys are interned, so they are shared by all dictionaries
+                const QByteArrayView keyString = m_lookAhead1.getString();
+                PDFInplaceOrMemoryString key = keyString.size() > PDFInplaceString::MAX_STRING_SIZE ? PDFInplaceOrMemoryString(PDFNameTable::intern(keyString))
+                                                                                                     : PDFInplaceOrMemoryString(keyString);
                 shift();
 
                 // Second value should be a value
                 PDFObject object = getObject();
 
-                dictionary->addEntry(PDFInplaceOrMemoryString(std::move(key)), std::move(object));
+                dictionary->addEntry(std::move(key), std::move(object));
             }
 
             // Now, we should reach dictionary end. If it is not the case, then end of stream occured.
@@ -836,8 +1047,7 @@ PDFObject PDFParser::getObject()
             }
 
             // Is it a content stream?
-            if (m_lookAhead2.type == PDFLexicalAnalyzer::TokenType::Command &&
-                m_lookAhead2.data.toByteArray() == PDF_STREAM_START_COMMAND)
+            if (m_lookAhead2.isCommand(PDF_STREAM_START_COMMAND))
             {
                 if (!m_features.testFlag(AllowStreams))
                 {
@@ -867,12 +1077,14 @@ PDFObject PDFParser::getObject()
 
                 // Skip the stream start, then fetch data of the stream
                 m_lexicalAnalyzer.skipStreamStart();
-                QByteArray buffer = m_lexicalAnalyzer.fetchByteArray(length);
+                const bool isExternalFile = dictionary->hasKey(PDF_STREAM_DICT_FILE_SPECIFICATION);
+                const bool isReferringToData = m_dataOwner && !isExternalFile;
+                QByteArray buffer = isReferringToData ? m_lexicalAnalyzer.fetchRawByteArray(length) : m_lexicalAnalyzer.fetchByteArray(length);
 
                 // According to the PDF Reference 1.7, chapter 3.2.7, stream content can also be specified
                 // in the external file. If this is the case, then we must try to load the stream data
                 // from the external file.
-                if (dictionary->hasKey(PDF_STREAM_DICT_FILE_SPECIFICATION))
+                if (isExternalFile)
                 {
                     PDFObject fileName = m_context ? m_context->getObject(dictionary->get(PDF_STREAM_DICT_FILE_SPECIFICATION)) : dictionary->get(PDF_STREAM_DICT_FILE_SPECIFICATION);
 
@@ -894,15 +1106,20 @@ PDFObject PDFParser::getObject()
                 }
 
                 // Refill lookahead tokens
-                m_lookAhead1 = fetch();
-                m_lookAhead2 = fetch();
+                fetch(m_lookAhead1);
+                fetch(m_lookAhead2);
 
-                if (m_lookAhead1.type == PDFLexicalAnalyzer::TokenType::Command &&
-                    m_lookAhead1.data.toByteArray() == PDF_STREAM_END_COMMAND)
+                if (m_lookAhead1.isCommand(PDF_STREAM_END_COMMAND))
                 {
                     // Everything OK, just advance and return stream object
                     shift();
-                    return PDFObject::createStream(std::make_shared<PDFStream>(std::move(*dictionary), std::move(buffer)));
+
+                    if (isReferringToData)
+                    {
+                        return PDFObject::createStream(makeSharedInArena<PDFStream>(m_objectArena, std::move(*dictionary), std::move(buffer), m_dataOwner));
+                    }
+
+                    return PDFObject::createStream(makeSharedInArena<PDFStream>(m_objectArena, std::move(*dictionary), std::move(buffer)));
                 }
                 else
                 {
@@ -960,14 +1177,13 @@ void PDFParser::seek(PDFInteger offset)
     m_lexicalAnalyzer.seek(offset);
 
     // We must read lookahead symbols, because we invalidated them
-    m_lookAhead1 = fetch();
-    m_lookAhead2 = fetch();
+    fetch(m_lookAhead1);
+    fetch(m_lookAhead2);
 }
 
 bool PDFParser::fetchCommand(const char* command)
 {
-    if (m_lookAhead1.type == PDFLexicalAnalyzer::TokenType::Command &&
-        m_lookAhead1.data.toByteArray() == command)
+    if (m_lookAhead1.isCommand(command))
     {
         shift();
         return true;
@@ -978,13 +1194,48 @@ bool PDFParser::fetchCommand(const char* command)
 
 void PDFParser::shift()
 {
-    m_lookAhead1 = std::move(m_lookAhead2);
-    m_lookAhead2 = fetch();
+    // Swap the tokens, so the buffer of the old token is reused
+    std::swap(m_lookAhead1, m_lookAhead2);
+    fetch(m_lookAhead2);
 }
 
-PDFLexicalAnalyzer::Token PDFParser::fetch()
+void PDFParser::fetch(PDFLexicalAnalyzer::TypedToken& token)
 {
-    return m_tokenFetcher ? m_tokenFetcher() : m_lexicalAnalyzer.fetch();
+    if (m_tokenFetcher)
+    {
+        token = m_tokenFetcher();
+    }
+    else
+    {
+        m_lexicalAnalyzer.fetch(token);
+    }
+}
+
+PDFObject PDFParser::createStringObject(PDFLexicalAnalyzer::TypedToken& token, const PDFObjectArenaPointer& arena)
+{
+    Q_ASSERT(token.type == PDFLexicalAnalyzer::TokenType::String || token.type == PDFLexicalAnalyzer::TokenType::Name);
+
+    const bool isName = token.type == PDFLexicalAnalyzer::TokenType::Name;
+    const QByteArrayView string = token.getString();
+
+    // Short strings are stored inplace, so no memory is allocated
+    if (string.size() <= PDFInplaceString::MAX_STRING_SIZE)
+    {
+        PDFInplaceString inplaceString(string.data(), static_cast<int>(string.size()));
+        PDFStringRef stringRef = { &inplaceString, nullptr };
+        return isName ? PDFObject::createName(stringRef) : PDFObject::createString(stringRef);
+    }
+
+    // Long names are interned, so they are shared by all name objects
+    if (isName)
+    {
+        return PDFObject::createName(PDFNameTable::intern(string), arena);
+    }
+
+    // Take the token's buffer, if it is possible, to avoid copying the data
+    QByteArray array = token.isStringBuffered ? std::move(token.buffer) : string.toByteArray();
+    array.shrink_to_fit();
+    return PDFObject::createString(std::move(array), arena);
 }
 
 }   // namespace pdf
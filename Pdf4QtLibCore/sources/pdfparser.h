@@ -29,6 +29,7 @@
 
 #include <QVariant>
 #include <QByteArray>
+#include <QByteArrayView>
 
 #include <set>
 #include <functional>
@@ -125,10 +126,61 @@ public:
         QVariant data;
     };
 
+    /// Token with typed value, which doesn't use QVariant. Names, commands and
+    /// literal strings without escape sequences refer directly to the scanned data,
+    /// so no memory is allocated, but scanned data must outlive the token. Other
+    /// strings are decoded into the token's own buffer, which is reused, when
+    /// the token is fetched again.
+    struct TypedToken
+    {
+        /// Returns string data of the token (string, name or command)
+        QByteArrayView getString() const { return isStringBuffered ? QByteArrayView(buffer) : string; }
+
+        /// Returns string data of the token as byte array. Data are copied,
+        /// if they are not owned by the token.
+        QByteArray getByteArray() const;
+
+        /// Returns numeric value of the token (integer or real)
+        PDFReal getNumber() const { return type == TokenType::Integer ? PDFReal(integer) : real; }
+
+        /// Returns true, if token is a command with given text
+        /// \param command Command text
+        bool isCommand(const char* command) const;
+
+        /// Copies data referred by the token into the token's own buffer,
+        /// so token doesn't refer to the scanned data anymore.
+        void detach();
+
+        /// Converts token to the token with QVariant value
+        Token toToken() const;
+
+        /// Creates typed token from the token with QVariant value
+        /// \param token Token
+        static TypedToken fromToken(const Token& token);
+
+        TokenType type = TokenType::EndOfFile;
+
+        union
+        {
+            bool boolean;
+            PDFInteger integer = 0;
+            PDFReal real;
+        };
+
+        QByteArrayView string;
+        QByteArray buffer;
+        bool isStringBuffered = false;
+    };
+
     /// Fetches a new token from the input stream. If we are at end of the input
     /// stream, then EndOfFile token is returned.
     Token fetch();
 
+    /// Fetches a new token from the input stream, without creating a QVariant.
+    /// If we are at end of the input stream, then EndOfFile token is returned.
+    /// \param token Token to be filled (its buffer is reused)
+    void fetch(TypedToken& token);
+
     /// Seeks stream from the start. If stream cannot be seeked (position is invalid),
     /// then exception is thrown.
     void seek(PDFInteger offset);
@@ -144,6 +196,13 @@ public:
     /// \param length Length of the buffer
     QByteArray fetchByteArray(PDFInteger length);
 
+    /// Reads number of bytes from the buffer and creates a byte array referring
+    /// to the buffer (no data are copied, see QByteArray::fromRawData). Buffer
+    /// must outlive the returned byte array. If end of stream appears before
+    /// desired end byte, exception is thrown.
+    /// \param length Length of the buffer
+    QByteArray fetchRawByteArray(PDFInteger length);
+
     /// Returns, if whole stream was scanned
     inline bool isAtEnd() const { return m_current == m_end; }
 
@@ -194,10 +253,21 @@ private:
     /// \param output Non-null pointer to the result number
     bool fetchOctalNumber(int maxDigits, int* output);
 
+    /// Fetches integer or real number. Digits are accumulated into the 64-bit
+    /// mantissa, and real number is then created from the mantissa and decimal
+    /// exponent, which for short numbers (the most common in content streams)
+    /// is exact and correctly rounded. Number must start at current position.
+    /// \param token Token, into which number is stored
+    void fetchNumber(TypedToken& token);
+
     /// Returns true, if charachter represents hexadecimal number, i.e. digit 0-9,
     /// or letter A-F, or small letter a-f.
     static constexpr bool isHexCharacter(const char character);
 
+    /// Returns value of the hexadecimal character. Character must be valid
+    /// hexadecimal character.
+    static constexpr int getHexCharacterValue(const char character);
+
     /// Throws an error exception
     void error(const QString& message) const;
 
@@ -302,6 +372,7 @@ public:
     explicit PDFParser(const QByteArray& data, PDFParsingContext* context, Features features);
     explicit PDFParser(const char* begin, const char* end, PDFParsingContext* context, Features features);
     explicit PDFParser(std::function<PDFLexicalAnalyzer::Token(void)> tokenFetcher);
+    explicit PDFParser(std::function<PDFLexicalAnalyzer::TypedToken(void)> tokenFetcher);
 
     /// Fetches single object from the stream. Does not check
     /// cyclical references. If object cannot be fetched, then
@@ -321,20 +392,37 @@ public:
     void seek(PDFInteger offset);
 
     /// Returns currently scanned token
-    const PDFLexicalAnalyzer::Token& lookahead() const { return m_lookAhead1; }
+    const PDFLexicalAnalyzer::TypedToken& lookahead() const { return m_lookAhead1; }
 
     /// If current token is a command with same string, then eat this command
     /// and return true. Otherwise do nothing and return false.
     /// \param command Command to be fetched
     bool fetchCommand(const char* command);
 
+    /// Sets owner of the parsed data. If owner is set, then stream contents
+    /// are not copied, but refer directly to the parsed data, which are kept
+    /// alive by the owner (for example, memory mapped file).
+    /// \param dataOwner Owner of the parsed data
+    void setDataOwner(PDFStreamDataOwner dataOwner) { m_dataOwner = std::move(dataOwner); }
+
+    /// Sets object arena. If arena is set, then arrays, dictionaries, streams
+    /// and long strings are allocated in the arena instead of the heap.
+    /// \param objectArena Object arena (can be nullptr)
+    void setObjectArena(PDFObjectArenaPointer objectArena) { m_objectArena = std::move(objectArena); }
+
 private:
     void shift();
 
-    PDFLexicalAnalyzer::Token fetch();
+    void fetch(PDFLexicalAnalyzer::TypedToken& token);
+
+    /// Creates string or name object from the token. If token owns the string
+    /// data, they may be moved into the object.
+    /// \param token String or name token
+    /// \param arena Object arena (can be nullptr)
+    static PDFObject createStringObject(PDFLexicalAnalyzer::TypedToken& token, const PDFObjectArenaPointer& arena);
 
     /// Functor for fetching tokens
-    std::function<PDFLexicalAnalyzer::Token(void)> m_tokenFetcher;
+    std::function<PDFLexicalAnalyzer::TypedToken(void)> m_tokenFetcher;
 
     /// Parsing context (multiple parsers can share it)
     PDFParsingContext* m_context;
@@ -342,11 +430,17 @@ private:
     /// Enabled features
     Features m_features;
 
+    /// Owner of parsed data (if stream contents can refer to it)
+    PDFStreamDataOwner m_dataOwner;
+
+    /// Arena for parsed objects (can be nullptr)
+    PDFObjectArenaPointer m_objectArena;
+
     /// Lexical analyzer for scanning tokens
     PDFLexicalAnalyzer m_lexicalAnalyzer;
 
-    PDFLexicalAnalyzer::Token m_lookAhead1;
-    PDFLexicalAnalyzer::Token m_lookAhead2;
+    PDFLexicalAnalyzer::TypedToken m_lookAhead1;
+    PDFLexicalAnalyzer::TypedToken m_lookAhead2;
 };
 
 // Implementation
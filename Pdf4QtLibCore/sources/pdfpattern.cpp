@@ -34,6 +34,7 @@
 
 #include "pdfdbgheap.h"
 
+#include <algorithm>
 #include <execution>
 
 namespace pdf
@@ -471,6 +472,21 @@ PDFPatternPtr PDFPattern::createShadingPattern(const PDFDictionary* colorSpaceDi
             type4567Shading->m_functions = qMove(functions);
             type4567Shading->m_data = document->getDecodedStream(stream);
 
+            // Default color spaces from resources replace device color spaces, and named
+            // color spaces are taken from resources, so mesh depends also on resources.
+            const bool isDefaultColorSpaceUsed = colorSpaceDictionary &&
+                                                 (colorSpaceDictionary->hasKey(COLOR_SPACE_NAME_DEFAULT_GRAY) ||
+                                                  colorSpaceDictionary->hasKey(COLOR_SPACE_NAME_DEFAULT_RGB) ||
+                                                  colorSpaceDictionary->hasKey(COLOR_SPACE_NAME_DEFAULT_CMYK));
+            const PDFObject& colorSpaceObject = document->getObject(shadingDictionary->get("ColorSpace"));
+            const bool isResourceColorSpaceUsed = colorSpaceObject.isName() &&
+                                                  !contains(colorSpaceObject.getString(), std::initializer_list<QByteArray>{ COLOR_SPACE_NAME_DEVICE_GRAY, COLOR_SPACE_NAME_DEVICE_RGB, COLOR_SPACE_NAME_DEVICE_CMYK,
+                                                                                                                            COLOR_SPACE_NAME_ABBREVIATION_DEVICE_GRAY, COLOR_SPACE_NAME_ABBREVIATION_DEVICE_RGB, COLOR_SPACE_NAME_ABBREVIATION_DEVICE_CMYK });
+            if (stream && !isDefaultColorSpaceUsed && !isResourceColorSpaceUsed)
+            {
+                type4567Shading->m_streamId = stream->getUniqueId();
+            }
+
             switch (shadingType)
             {
                 case ShadingType::FreeFormGouradTriangle:
@@ -510,6 +526,217 @@ PDFPatternPtr PDFPattern::createShadingPattern(const PDFDictionary* colorSpaceDi
     }
 }
 
+/// Lookup table of shading color functions. Functions are evaluated only in the
+/// grid points, values between the grid points are interpolated (linearly for
+/// functions of one variable, bilinearly for functions of two variables). Shading
+/// samplers evaluate functions for each sampled pixel, which is very slow, for
+/// example, for PostScript calculator functions. Grid is sized for the output
+/// resolution, so interpolation error is not visible.
+class PDFShadingLookupTable
+{
+public:
+    explicit inline PDFShadingLookupTable() = default;
+
+    /// Evaluates functions in the grid points. If some function
+    /// evaluation fails, then lookup table remains invalid.
+    /// \param functions Shading functions
+    /// \param colorComponentCount Number of color components
+    /// \param domain Domain of the function inputs (height is zero for functions of one variable)
+    /// \param columns Number of grid points in the first input variable
+    /// \param rows Number of grid points in the second input variable (1 for functions of one variable)
+    void create(const std::vector<PDFFunctionPtr>& functions,
+                size_t colorComponentCount,
+                const QRectF& domain,
+                size_t columns,
+                size_t rows);
+
+    /// Returns true, if lookup table was successfully created
+    bool isValid() const { return !m_values.empty(); }
+
+    /// Computes color from the lookup table. Input is clamped to the domain.
+    /// \param input Input value (y coordinate is ignored for functions of one variable)
+    /// \param outputBuffer Output color buffer
+    void evaluate(const QPointF& input, PDFColorBuffer outputBuffer) const;
+
+    /// Evaluates shading functions at multiple inputs at once. Inputs and outputs
+    /// are stored as structure of arrays (see \p PDFFunction::applyMany). Returns
+    /// false, if evaluation fails.
+    /// \param functions Shading functions
+    /// \param input Input arrays
+    /// \param inputCount Number of input arrays
+    /// \param output Output arrays
+    /// \param outputCount Number of output arrays
+    /// \param count Number of values in each array
+    static bool evaluateFunctions(const std::vector<PDFFunctionPtr>& functions,
+                                  const PDFFunction::const_iterator* input,
+                                  size_t inputCount,
+                                  const PDFFunction::iterator* output,
+                                  size_t outputCount,
+                                  size_t count);
+
+    /// Maximal number of grid points in one input variable
+    static constexpr size_t MAX_GRID_SIZE = 4096;
+
+private:
+    QRectF m_domain;
+    size_t m_colorComponentCount = 0;
+    size_t m_columns = 0;
+    size_t m_rows = 0;
+    std::vector<PDFColorComponent> m_values;
+};
+
+bool PDFShadingLookupTable::evaluateFunctions(const std::vector<PDFFunctionPtr>& functions,
+                                              const PDFFunction::const_iterator* input,
+                                              size_t inputCount,
+                                              const PDFFunction::iterator* output,
+                                              size_t outputCount,
+                                              size_t count)
+{
+    if (functions.size() == 1)
+    {
+        const PDFFunction* function = functions.front().get();
+        if (function->getInputVariableCount() != inputCount || function->getOutputVariableCount() != outputCount)
+        {
+            // Invalid number of operands
+            return false;
+        }
+
+        return static_cast<bool>(function->applyMany(input, output, count));
+    }
+
+    if (functions.size() != outputCount)
+    {
+        // Invalid number of functions
+        return false;
+    }
+
+    for (size_t i = 0; i < outputCount; ++i)
+    {
+        const PDFFunction* function = functions[i].get();
+        if (function->getInputVariableCount() != inputCount || function->getOutputVariableCount() != 1 || !function->applyMany(input, output + i, count))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void PDFShadingLookupTable::create(const std::vector<PDFFunctionPtr>& functions,
+                                   size_t colorComponentCount,
+                                   const QRectF& domain,
+                                   size_t columns,
+                                   size_t rows)
+{
+    m_values.clear();
+
+    if (functions.empty() || colorComponentCount == 0 || colorComponentCount > PDF_MAX_COLOR_COMPONENTS || columns < 2 || rows < 1)
+    {
+        return;
+    }
+
+    m_domain = domain;
+    m_colorComponentCount = colorComponentCount;
+    m_columns = columns;
+    m_rows = rows;
+
+    std::vector<PDFColorComponent> values(columns * rows * colorComponentCount, 0.0f);
+
+    // Whole row of the grid is evaluated at once. Input and output
+    // values of the row are stored as structure of arrays.
+    std::vector<PDFReal> inputX(columns, 0.0);
+    std::vector<PDFReal> inputY(columns, 0.0);
+    std::vector<PDFReal> outputValues(columns * colorComponentCount, 0.0);
+
+    const std::array<PDFFunction::const_iterator, 2> input = { inputX.data(), inputY.data() };
+    std::array<PDFFunction::iterator, PDF_MAX_COLOR_COMPONENTS> output = { };
+    for (size_t i = 0; i < colorComponentCount; ++i)
+    {
+        output[i] = outputValues.data() + i * columns;
+    }
+
+    for (size_t column = 0; column < columns; ++column)
+    {
+        inputX[column] = interpolate(PDFReal(column), 0.0, PDFReal(columns - 1), domain.left(), domain.right());
+    }
+
+    auto it = values.begin();
+    for (size_t row = 0; row < rows; ++row)
+    {
+        if (rows > 1)
+        {
+            std::fill(inputY.begin(), inputY.end(), interpolate(PDFReal(row), 0.0, PDFReal(rows - 1), domain.top(), domain.bottom()));
+        }
+
+        if (!evaluateFunctions(functions, input.data(), rows > 1 ? 2 : 1, output.data(), colorComponentCount, columns))
+        {
+            // Function can't be evaluated, shading is sampled without lookup table
+            return;
+        }
+
+        for (size_t column = 0; column < columns; ++column)
+        {
+            for (size_t i = 0; i < colorComponentCount; ++i)
+            {
+                *it++ = static_cast<PDFColorComponent>(output[i][column]);
+            }
+        }
+    }
+
+    m_values = qMove(values);
+}
+
+void PDFShadingLookupTable::evaluate(const QPointF& input, PDFColorBuffer outputBuffer) const
+{
+    Q_ASSERT(isValid());
+    Q_ASSERT(outputBuffer.size() == m_colorComponentCount);
+
+    auto getPosition = [](PDFReal value, PDFReal min, PDFReal max, size_t count, size_t& index, PDFColorComponent& fraction)
+    {
+        if (count == 1 || qFuzzyCompare(min, max))
+        {
+            index = 0;
+            fraction = 0.0f;
+            return;
+        }
+
+        const PDFReal position = qBound(0.0, (value - min) / (max - min), 1.0) * (count - 1);
+        index = qMin(static_cast<size_t>(position), count - 2);
+        fraction = static_cast<PDFColorComponent>(position - index);
+    };
+
+    size_t column = 0;
+    size_t row = 0;
+    PDFColorComponent columnFraction = 0.0f;
+    PDFColorComponent rowFraction = 0.0f;
+    getPosition(input.x(), m_domain.left(), m_domain.right(), m_columns, column, columnFraction);
+    getPosition(input.y(), m_domain.top(), m_domain.bottom(), m_rows, row, rowFraction);
+
+    const size_t count = m_colorComponentCount;
+    const PDFColorComponent* v00 = m_values.data() + (row * m_columns + column) * count;
+    const PDFColorComponent* v01 = v00 + count;
+
+    if (m_rows == 1 || rowFraction == 0.0f)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            outputBuffer[i] = v00[i] + (v01[i] - v00[i]) * columnFraction;
+        }
+    }
+    else
+    {
+        const PDFColorComponent* v10 = v00 + m_columns * count;
+        const PDFColorComponent* v11 = v10 + count;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const PDFColorComponent top = v00[i] + (v01[i] - v00[i]) * columnFraction;
+            const PDFColorComponent bottom = v10[i] + (v11[i] - v10[i]) * columnFraction;
+            outputBuffer[i] = top + (bottom - top) * rowFraction;
+        }
+    }
+}
+
 class PDFFunctionShadingSampler : public PDFShadingSampler
 {
 public:
@@ -529,6 +756,16 @@ public:
         {
             m_deviceSpaceToDomainMatrix = QTransform();
         }
+
+        const PDFAbstractColorSpace* colorSpace = functionShadingPattern->getColorSpace();
+        if (colorSpace && domainToDeviceSpaceMatrix.isInvertible() && m_domain.isValid())
+        {
+            // Grid point for each device pixel of the domain, but grid is limited,
+            // because it is two dimensional, and function shading is usually smooth.
+            const size_t columns = qBound<size_t>(2, static_cast<size_t>(std::ceil(QLineF(domainToDeviceSpaceMatrix.map(m_domain.topLeft()), domainToDeviceSpaceMatrix.map(m_domain.topRight())).length())) + 1, MAX_GRID_SIZE);
+            const size_t rows = qBound<size_t>(2, static_cast<size_t>(std::ceil(QLineF(domainToDeviceSpaceMatrix.map(m_domain.topLeft()), domainToDeviceSpaceMatrix.map(m_domain.bottomLeft())).length())) + 1, MAX_GRID_SIZE);
+            m_lookupTable.create(functionShadingPattern->getFunctions(), colorSpace->getColorComponentCount(), m_domain, columns, rows);
+        }
     }
 
     virtual bool sample(const QPointF& devicePoint, PDFColorBuffer outputBuffer, int limit) const override
@@ -548,6 +785,12 @@ public:
             return fillBackgroundColor(outputBuffer);
         }
 
+        if (m_lookupTable.isValid())
+        {
+            m_lookupTable.evaluate(domainPoint, outputBuffer);
+            return true;
+        }
+
         const auto& functions = m_functionShadingPattern->getFunctions();
         std::array<PDFReal, PDF_MAX_COLOR_COMPONENTS> colorBuffer = { };
 
@@ -603,6 +846,10 @@ private:
     const PDFFunctionShading* m_functionShadingPattern;
     QRectF m_domain;
     QTransform m_deviceSpaceToDomainMatrix;
+    PDFShadingLookupTable m_lookupTable;
+
+    /// Maximal number of grid points of the two dimensional lookup table
+    static constexpr size_t MAX_GRID_SIZE = 512;
 };
 
 ShadingType PDFFunctionShading::getShadingType() const
@@ -1203,6 +1450,13 @@ public:
         m_tMax = qMax(m_tAtStart, m_tAtEnd);
 
         m_p1p2GCS = p1p2GCS;
+
+        if (const PDFAbstractColorSpace* colorSpace = axialShadingPattern->getColorSpace())
+        {
+            // Two grid points per device pixel along the shading axis
+            const size_t gridSize = qBound<size_t>(2, static_cast<size_t>(std::ceil(2.0 * (m_xEnd - m_xStart))) + 1, PDFShadingLookupTable::MAX_GRID_SIZE);
+            m_lookupTable.create(axialShadingPattern->getFunctions(), colorSpace->getColorComponentCount(), QRectF(m_tAtStart, 0.0, m_tAtEnd - m_tAtStart, 0.0), gridSize, 1);
+        }
     }
 
     virtual bool sample(const QPointF& devicePoint, PDFColorBuffer outputBuffer, int limit) const override
@@ -1254,6 +1508,12 @@ public:
             t = qBound(m_tMin, t, m_tMax);
         }
 
+        if (m_lookupTable.isValid())
+        {
+            m_lookupTable.evaluate(QPointF(t, 0.0), outputBuffer);
+            return true;
+        }
+
         const auto& functions = m_axialShadingPattern->getFunctions();
         std::array<PDFReal, PDF_MAX_COLOR_COMPONENTS> colorBuffer = { };
 
@@ -1312,6 +1572,7 @@ private:
     PDFReal m_tAtEnd;
     PDFReal m_tMin;
     PDFReal m_tMax;
+    PDFShadingLookupTable m_lookupTable;
 };
 
 PDFShadingSampler* PDFAxialShading::createSampler(QTransform userSpaceToDeviceSpaceMatrix) const
@@ -1404,6 +1665,30 @@ QPointF PDFMesh::getTriangleCenter(const PDFMesh::Triangle& triangle) const
     return (m_vertices[triangle.v1] + m_vertices[triangle.v2] + m_vertices[triangle.v3]) / 3.0;
 }
 
+QRectF PDFMesh::getBoundingRect() const
+{
+    QRectF boundingRect;
+
+    if (!m_vertices.empty())
+    {
+        auto [minX, maxX] = std::minmax_element(m_vertices.cbegin(), m_vertices.cend(), [](const QPointF& l, const QPointF& r) { return l.x() < r.x(); });
+        auto [minY, maxY] = std::minmax_element(m_vertices.cbegin(), m_vertices.cend(), [](const QPointF& l, const QPointF& r) { return l.y() < r.y(); });
+        boundingRect = QRectF(QPointF(minX->x(), minY->y()), QPointF(maxX->x(), maxY->y()));
+    }
+
+    if (!m_backgroundPath.isEmpty() && m_backgroundColor.isValid())
+    {
+        boundingRect = boundingRect.united(m_backgroundPath.controlPointRect());
+    }
+
+    if (!m_boundingPath.isEmpty())
+    {
+        boundingRect = boundingRect.intersected(m_boundingPath.controlPointRect());
+    }
+
+    return boundingRect;
+}
+
 qint64 PDFMesh::getMemoryConsumptionEstimate() const
 {
     qint64 memoryConsumption = sizeof(*this);
@@ -1414,6 +1699,38 @@ qint64 PDFMesh::getMemoryConsumptionEstimate() const
     return memoryConsumption;
 }
 
+void PDFMesh::serialize(QDataStream& stream) const
+{
+    stream << m_vertices;
+    stream << m_triangles.size();
+    for (const Triangle& triangle : m_triangles)
+    {
+        stream << triangle.v1 << triangle.v2 << triangle.v3 << triangle.color;
+    }
+    stream << m_boundingPath;
+    stream << m_backgroundPath;
+    stream << m_backgroundColor;
+}
+
+void PDFMesh::deserialize(QDataStream& stream)
+{
+    stream >> m_vertices;
+
+    size_t triangleCount = 0;
+    stream >> triangleCount;
+    m_triangles.clear();
+    for (size_t i = 0; i < triangleCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        Triangle triangle;
+        stream >> triangle.v1 >> triangle.v2 >> triangle.v3 >> triangle.color;
+        m_triangles.push_back(triangle);
+    }
+
+    stream >> m_boundingPath;
+    stream >> m_backgroundPath;
+    stream >> m_backgroundColor;
+}
+
 void PDFMesh::convertColors(const PDFColorConvertor& colorConvertor)
 {
     for (Triangle& triangle : m_triangles)
@@ -1788,6 +2105,16 @@ public:
         m_r1 = r1;
 
         m_p1p2GCS = p1p2GCS;
+
+        if (const PDFAbstractColorSpace* colorSpace = radialShadingPattern->getColorSpace())
+        {
+            // Circle moves at most by distance of the centers plus difference of
+            // the radii, when parameter s goes from 0 to 1. We use two grid
+            // points per device pixel of this movement.
+            const PDFReal length = (m_xEnd - m_xStart) + qAbs(m_r1 - m_r0);
+            const size_t gridSize = qBound<size_t>(2, static_cast<size_t>(std::ceil(2.0 * length)) + 1, PDFShadingLookupTable::MAX_GRID_SIZE);
+            m_lookupTable.create(radialShadingPattern->getFunctions(), colorSpace->getColorComponentCount(), QRectF(m_tAtStart, 0.0, m_tAtEnd - m_tAtStart, 0.0), gridSize, 1);
+        }
     }
 
     virtual bool sample(const QPointF& devicePoint, PDFColorBuffer outputBuffer, int limit) const override
@@ -1929,6 +2256,12 @@ public:
         PDFReal t = interpolate(s, 0.0, 1.0, m_tAtStart, m_tAtEnd);
         t = qBound(m_tMin, t, m_tMax);
 
+        if (m_lookupTable.isValid())
+        {
+            m_lookupTable.evaluate(QPointF(t, 0.0), outputBuffer);
+            return true;
+        }
+
         const auto& functions = m_radialShadingPattern->getFunctions();
         std::array<PDFReal, PDF_MAX_COLOR_COMPONENTS> colorBuffer = { };
 
@@ -1989,6 +2322,7 @@ private:
     PDFReal m_tMax;
     PDFReal m_r0;
     PDFReal m_r1;
+    PDFShadingLookupTable m_lookupTable;
 };
 
 PDFShadingSampler* PDFRadialShading::createSampler(QTransform userSpaceToDeviceSpaceMatrix) const
@@ -30,6 +30,7 @@
 #include "pdfcolorconvertor.h"
 
 #include <QTransform>
+#include <QDataStream>
 #include <QPainterPath>
 
 #include <memory>
@@ -147,12 +148,18 @@ public:
     /// Returns true, if mesh is empty
     bool isEmpty() const { return m_vertices.empty(); }
 
+    /// Returns bounding rectangle of the painted area of the mesh
+    QRectF getBoundingRect() const;
+
     /// Returns estimate of number of bytes, which this mesh occupies in memory
     qint64 getMemoryConsumptionEstimate() const;
 
     /// Apply color conversion
     void convertColors(const PDFColorConvertor& colorConvertor);
 
+    void serialize(QDataStream& stream) const;
+    void deserialize(QDataStream& stream);
+
 private:
     std::vector<QPointF> m_vertices;
     std::vector<Triangle> m_triangles;
@@ -463,6 +470,11 @@ public:
     /// Returns color for given color or function parameter
     PDFColor getColor(PDFColor colorOrFunctionParameter) const;
 
+    /// Returns unique id of the shading stream. Zero is returned, if mesh of the shading
+    /// depends also on the resources (color space of the shading is taken from resources),
+    /// so mesh can't be identified by the stream only.
+    quint64 getStreamId() const { return m_streamId; }
+
 protected:
     friend class PDFPattern;
 
@@ -494,6 +506,9 @@ protected:
 
     /// Data of the shading, containing triangles and colors
     QByteArray m_data;
+
+    /// Unique id of the shading stream
+    quint64 m_streamId = 0;
 };
 
 class PDFFreeFormGouradTriangleShading : public PDFType4567Shading
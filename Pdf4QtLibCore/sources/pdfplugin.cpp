@@ -21,6 +21,9 @@
 // SOFTWARE.
 
 #include "pdfplugin.h"
+
+#include <QJsonArray>
+
 #include "pdfdbgheap.h"
 
 namespace pdf
@@ -71,6 +74,22 @@ PDFPluginInfo PDFPluginInfo::loadFromJson(const QJsonObject* json)
     result.version = metadata.value(QLatin1String("Version")).toString();
     result.license = metadata.value(QLatin1String("License")).toString();
     result.description = metadata.value(QLatin1String("Description")).toString();
+    result.menuName = metadata.value(QLatin1String("MenuName")).toString();
+
+    const QJsonArray actions = metadata.value(QLatin1String("Actions")).toArray();
+    for (const QJsonValue& actionValue : actions)
+    {
+        const QJsonObject actionObject = actionValue.toObject();
+
+        PDFPluginActionInfo action;
+        action.objectName = actionObject.value(QLatin1String("ObjectName")).toString();
+        action.text = actionObject.value(QLatin1String("Text")).toString();
+        action.isSeparator = actionObject.value(QLatin1String("Separator")).toBool(false);
+        result.actions.push_back(std::move(action));
+    }
+
+    // Plugin can be loaded lazily only, if all its actions are described
+    result.isLazyLoaded = metadata.value(QLatin1String("LazyLoading")).toBool(false) && !result.actions.empty();
 
     return result;
 }
@@ -39,6 +39,15 @@ namespace pdf
 class PDFWidget;
 class PDFCMSManager;
 
+/// Description of plugin action in the plugin metadata. Actions of lazily
+/// loaded plugins are created from these descriptions, before the plugin is loaded.
+struct PDF4QTLIBCORESHARED_EXPORT PDFPluginActionInfo
+{
+    QString objectName;
+    QString text;
+    bool isSeparator = false;
+};
+
 struct PDF4QTLIBCORESHARED_EXPORT PDFPluginInfo
 {
     QString name;
@@ -49,6 +58,13 @@ struct PDF4QTLIBCORESHARED_EXPORT PDFPluginInfo
     QString pluginFile;
     QString pluginFileWithPath;
 
+    /// If true, plugin library is loaded when one of its actions is triggered
+    /// for the first time. Actions of such plugins are available only when
+    /// document is opened.
+    bool isLazyLoaded = false;
+    QString menuName;
+    std::vector<PDFPluginActionInfo> actions;
+
     static PDFPluginInfo loadFromJson(const QJsonObject* json);
 };
 using PDFPluginInfos = std::vector<PDFPluginInfo>;
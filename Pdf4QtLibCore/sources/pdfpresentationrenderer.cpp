@@ -0,0 +1,571 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pdfpresentationrenderer.h"
+#include "pdfdocument.h"
+
+#include <QMutex>
+#include <QPainter>
+#include <QPainterPath>
+#include <QtMath>
+#include <QtConcurrent/QtConcurrent>
+
+#include "pdfdbgheap.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace pdf
+{
+
+PDFPresentationFrameCache::PDFPresentationFrameCache(const PDFDocument* document,
+                                                     PDFFontCache* fontCache,
+                                                     const PDFCMSManager* cmsManager,
+                                                     const PDFOptionalContentActivity* optionalContentActivity,
+                                                     PDFRenderer::Features features,
+                                                     const PDFMeshQualitySettings& meshQualitySettings,
+                                                     RendererEngine rendererEngine,
+                                                     QObject* parent) :
+    BaseClass(parent),
+    m_document(document),
+    m_meshQualitySettings(meshQualitySettings),
+    m_rasterizerPool(document, fontCache, cmsManager, optionalContentActivity, features, m_meshQualitySettings, 2, rendererEngine, nullptr)
+{
+    m_rasterizerPool.setOperationControl(&m_cancellationToken);
+}
+
+PDFPresentationFrameCache::~PDFPresentationFrameCache()
+{
+    if (m_futureWatcher && !m_futureWatcher->isFinished())
+    {
+        m_cancellationToken.cancel();
+        m_futureWatcher->waitForFinished();
+    }
+}
+
+void PDFPresentationFrameCache::setScreenSize(QSize screenSize)
+{
+    if (m_screenSize != screenSize)
+    {
+        m_screenSize = screenSize;
+        m_frames.clear();
+        m_failedPages.clear();
+
+        if (m_futureWatcher && !m_futureWatcher->isFinished())
+        {
+            // Frames being rendered have old size, render will
+            // be restarted, when current render is finished.
+            m_cancellationToken.cancel();
+            return;
+        }
+
+        startRender();
+    }
+}
+
+void PDFPresentationFrameCache::setCurrentPage(PDFInteger pageIndex)
+{
+    m_currentPageIndex = pageIndex;
+
+    // Remove frames of pages, which are not adjacent to the current page
+    std::vector<PDFInteger> adjacentPages = getAdjacentPages();
+    for (auto it = m_frames.begin(); it != m_frames.end();)
+    {
+        if (std::find(adjacentPages.cbegin(), adjacentPages.cend(), it->first) == adjacentPages.cend())
+        {
+            it = m_frames.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    startRender();
+}
+
+QImage PDFPresentationFrameCache::getFrame(PDFInteger pageIndex) const
+{
+    auto it = m_frames.find(pageIndex);
+    if (it != m_frames.cend())
+    {
+        return it->second;
+    }
+
+    return QImage();
+}
+
+QSize PDFPresentationFrameCache::getFrameSize(const PDFPage* page, QSize screenSize)
+{
+    QSizeF pageSize = page->getRotatedMediaBox().size();
+
+    if (pageSize.isEmpty() || screenSize.isEmpty())
+    {
+        return QSize(1, 1);
+    }
+
+    return pageSize.scaled(QSizeF(screenSize), Qt::KeepAspectRatio).toSize().expandedTo(QSize(1, 1));
+}
+
+std::vector<PDFInteger> PDFPresentationFrameCache::getAdjacentPages() const
+{
+    std::vector<PDFInteger> pages;
+
+    if (!m_document || m_currentPageIndex < 0)
+    {
+        return pages;
+    }
+
+    const PDFInteger pageCount = m_document->getCatalog()->getPageCount();
+    for (PDFInteger pageIndex : { m_currentPageIndex, m_currentPageIndex + 1, m_currentPageIndex - 1 })
+    {
+        if (pageIndex >= 0 && pageIndex < pageCount)
+        {
+            pages.push_back(pageIndex);
+        }
+    }
+
+    return pages;
+}
+
+void PDFPresentationFrameCache::startRender()
+{
+    if (m_futureWatcher && !m_futureWatcher->isFinished())
+    {
+        // Render is running, new render will be started, when
+        // current render is finished.
+        return;
+    }
+
+    if (m_screenSize.isEmpty())
+    {
+        return;
+    }
+
+    std::vector<PDFInteger> pageIndices;
+    for (PDFInteger pageIndex : getAdjacentPages())
+    {
+        if (!m_frames.count(pageIndex) && !m_failedPages.count(pageIndex))
+        {
+            pageIndices.push_back(pageIndex);
+        }
+    }
+
+    if (pageIndices.empty())
+    {
+        return;
+    }
+
+    m_cancellationToken.reset();
+
+    auto render = [this, pageIndices, screenSize = m_screenSize]()
+    {
+        RenderResult result;
+        result.screenSize = screenSize;
+
+        QMutex mutex;
+        auto getImageSize = [screenSize](const PDFPage* page) { return getFrameSize(page, screenSize); };
+        auto processImage = [&](PDFRenderedPageImage& image)
+        {
+            QMutexLocker lock(&mutex);
+            result.frames[image.pageIndex] = qMove(image.pageImage);
+        };
+        m_rasterizerPool.render(pageIndices, getImageSize, processImage, nullptr);
+
+        result.isCancelled = m_cancellationToken.isOperationCancelled();
+
+        // Pages, which were not rendered, are failed pages
+        if (!result.isCancelled)
+        {
+            for (PDFInteger pageIndex : pageIndices)
+            {
+                if (!result.frames.count(pageIndex))
+                {
+                    result.frames[pageIndex] = QImage();
+                }
+            }
+        }
+
+        return result;
+    };
+
+    m_futureWatcher.reset();
+    m_futureWatcher.emplace();
+    m_future = QtConcurrent::run(render);
+    connect(&*m_futureWatcher, &QFutureWatcher<RenderResult>::finished, this, &PDFPresentationFrameCache::onRenderFinished);
+    m_futureWatcher->setFuture(m_future);
+}
+
+void PDFPresentationFrameCache::onRenderFinished()
+{
+    RenderResult result = m_future.result();
+
+    if (result.screenSize == m_screenSize)
+    {
+        std::vector<PDFInteger> adjacentPages = getAdjacentPages();
+
+        for (auto& [pageIndex, image] : result.frames)
+        {
+            if (std::find(adjacentPages.cbegin(), adjacentPages.cend(), pageIndex) == adjacentPages.cend())
+            {
+                // Current page was changed meanwhile
+                continue;
+            }
+
+            if (image.isNull())
+            {
+                m_failedPages.insert(pageIndex);
+                continue;
+            }
+
+            m_frames[pageIndex] = qMove(image);
+            Q_EMIT frameRendered(pageIndex);
+        }
+    }
+
+    // Render frames of pages, which were requested during the render
+    QMetaObject::invokeMethod(this, &PDFPresentationFrameCache::startRender, Qt::QueuedConnection);
+}
+
+QImage PDFPageTransitionCompositor::createLayer(const QImage& frame, QSize size)
+{
+    QImage layer(size, QImage::Format_ARGB32_Premultiplied);
+    layer.fill(Qt::black);
+
+    if (!frame.isNull())
+    {
+        QPainter painter(&layer);
+        QRect frameRect(QPoint(0, 0), frame.size().scaled(size, Qt::KeepAspectRatio));
+        frameRect.moveCenter(layer.rect().center());
+        painter.setRenderHint(QPainter::SmoothPixmapTransform, frame.size() != frameRect.size());
+        painter.drawImage(frameRect, frame);
+    }
+
+    return layer;
+}
+
+QPointF PDFPageTransitionCompositor::getDirection(const PDFPageTransition& transition)
+{
+    // Angle is measured counterclockwise, but y axis of the device space points downwards
+    const PDFReal angle = qDegreesToRadians(transition.getAngle());
+    return QPointF(std::cos(angle), -std::sin(angle));
+}
+
+void PDFPageTransitionCompositor::composeBlocks(QPainter* painter,
+                                                const PDFPageTransition& transition,
+                                                const QImage& to,
+                                                PDFReal progress,
+                                                bool useDirection)
+{
+    const int columns = (to.width() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    const int rows = (to.height() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+    // Order of the blocks along the direction of the transition
+    const QPointF direction = getDirection(transition);
+    const PDFReal directionMin = qMin(direction.x(), 0.0) + qMin(direction.y(), 0.0);
+    const PDFReal directionRange = qMax(std::abs(direction.x()) + std::abs(direction.y()), 1e-6);
+
+    QImage mask(columns, rows, QImage::Format_Alpha8);
+    for (int y = 0; y < rows; ++y)
+    {
+        uchar* scanline = mask.scanLine(y);
+        for (int x = 0; x < columns; ++x)
+        {
+            quint32 hash = quint32(x) * 0x9E3779B1u ^ quint32(y) * 0x85EBCA77u;
+            hash ^= hash >> 15;
+            hash *= 0x2C1B3C6Du;
+            hash ^= hash >> 12;
+            PDFReal threshold = PDFReal(hash & 0xFFFF) / 65536.0;
+
+            if (useDirection)
+            {
+                const PDFReal u = (x + 0.5) / columns;
+                const PDFReal v = (y + 0.5) / rows;
+                const PDFReal position = (u * direction.x() + v * direction.y() - directionMin) / directionRange;
+                threshold = 0.25 * threshold + 0.75 * position;
+            }
+
+            scanline[x] = (threshold < progress) ? 0xFF : 0x00;
+        }
+    }
+
+    QImage layer = to;
+    {
+        QPainter layerPainter(&layer);
+        layerPainter.setCompositionMode(QPainter::CompositionMode_DestinationIn);
+        layerPainter.drawImage(layer.rect(), mask);
+    }
+
+    painter->drawImage(0, 0, layer);
+}
+
+QImage PDFPageTransitionCompositor::compose(const PDFPageTransition& transition, const QImage& from, const QImage& to, PDFReal progress)
+{
+    Q_ASSERT(from.size() == to.size());
+
+    progress = qBound(0.0, progress, 1.0);
+
+    if (progress >= 1.0)
+    {
+        return to;
+    }
+
+    const QRectF rect = to.rect();
+    const PDFReal width = rect.width();
+    const PDFReal height = rect.height();
+    const bool isHorizontal = transition.getOrientation() == PDFPageTransition::Orientation::Horizontal;
+    const bool isInward = transition.getDirection() == PDFPageTransition::Direction::Inward;
+
+    // Vector, by which moving page is shifted, when it moves over the whole screen
+    const QPointF direction = getDirection(transition);
+    const QPointF travel(direction.x() * width, direction.y() * height);
+
+    QImage result(to.size(), QImage::Format_ARGB32_Premultiplied);
+    QPainter painter(&result);
+
+    // Clip path of the new page, used in clipping transitions
+    QPainterPath clipPath;
+
+    switch (transition.getStyle())
+    {
+        case PDFPageTransition::Style::Split:
+        {
+            if (isHorizontal)
+            {
+                const PDFReal bandHeight = height * progress;
+                if (isInward)
+                {
+                    clipPath.addRect(QRectF(0, 0, width, bandHeight * 0.5));
+                    clipPath.addRect(QRectF(0, height - bandHeight * 0.5, width, bandHeight * 0.5));
+                }
+                else
+                {
+                    clipPath.addRect(QRectF(0, (height - bandHeight) * 0.5, width, bandHeight));
+                }
+            }
+            else
+            {
+                const PDFReal bandWidth = width * progress;
+                if (isInward)
+                {
+                    clipPath.addRect(QRectF(0, 0, bandWidth * 0.5, height));
+                    clipPath.addRect(QRectF(width - bandWidth * 0.5, 0, bandWidth * 0.5, height));
+                }
+                else
+                {
+                    clipPath.addRect(QRectF((width - bandWidth) * 0.5, 0, bandWidth, height));
+                }
+            }
+            break;
+        }
+
+        case PDFPageTransition::Style::Blinds:
+        {
+            for (int i = 0; i < BLINDS_COUNT; ++i)
+            {
+                if (isHorizontal)
+                {
+                    const PDFReal stripeHeight = height / BLINDS_COUNT;
+                    clipPath.addRect(QRectF(0, i * stripeHeight, width, stripeHeight * progress));
+                }
+                else
+                {
+                    const PDFReal stripeWidth = width / BLINDS_COUNT;
+                    clipPath.addRect(QRectF(i * stripeWidth, 0, stripeWidth * progress, height));
+                }
+            }
+            break;
+        }
+
+        case PDFPageTransition::Style::Box:
+        {
+            const PDFReal scale = isInward ? 1.0 - progress : progress;
+            QRectF boxRect(0, 0, width * scale, height * scale);
+            boxRect.moveCenter(rect.center());
+
+            if (isInward)
+            {
+                clipPath.setFillRule(Qt::OddEvenFill);
+                clipPath.addRect(rect);
+            }
+            clipPath.addRect(boxRect);
+            break;
+        }
+
+        case PDFPageTransition::Style::Wipe:
+        {
+            // New page is on the back side of the line, which moves
+            // in the direction of the transition.
+            const PDFReal length = std::abs(travel.x()) + std::abs(travel.y());
+            const PDFReal front = -length * 0.5 + length * progress;
+            const PDFReal extent = width + height;
+
+            QTransform matrix;
+            matrix.translate(rect.center().x(), rect.center().y());
+            matrix.rotate(-transition.getAngle());
+            clipPath.addPolygon(matrix.map(QPolygonF(QRectF(-extent, -extent, extent + front, 2.0 * extent))));
+            break;
+        }
+
+        case PDFPageTransition::Style::Dissolve:
+        case PDFPageTransition::Style::Glitter:
+        {
+            painter.drawImage(0, 0, from);
+            composeBlocks(&painter, transition, to, progress, transition.getStyle() == PDFPageTransition::Style::Glitter);
+            return result;
+        }
+
+        case PDFPageTransition::Style::Fly:
+        {
+            const PDFReal scale = transition.getScale();
+            if (isInward)
+            {
+                // New page flies in, scaled from the starting scale
+                const PDFReal currentScale = scale + (1.0 - scale) * progress;
+                QRectF flyRect(0, 0, width * currentScale, height * currentScale);
+                flyRect.moveCenter(rect.center() + travel * (progress - 1.0));
+
+                painter.drawImage(0, 0, from);
+                painter.setRenderHint(QPainter::SmoothPixmapTransform);
+                painter.drawImage(flyRect, to);
+            }
+            else
+            {
+                // Old page flies out, scaled to the ending scale
+                const PDFReal currentScale = 1.0 + (scale - 1.0) * progress;
+                QRectF flyRect(0, 0, width * currentScale, height * currentScale);
+                flyRect.moveCenter(rect.center() + travel * progress);
+
+                painter.drawImage(0, 0, to);
+                painter.setRenderHint(QPainter::SmoothPixmapTransform);
+                painter.drawImage(flyRect, from);
+            }
+            return result;
+        }
+
+        case PDFPageTransition::Style::Push:
+        {
+            painter.fillRect(result.rect(), Qt::black);
+            painter.drawImage(travel * progress, from);
+            painter.drawImage(travel * (progress - 1.0), to);
+            return result;
+        }
+
+        case PDFPageTransition::Style::Cover:
+        {
+            painter.drawImage(0, 0, from);
+            painter.drawImage(travel * (progress - 1.0), to);
+            return result;
+        }
+
+        case PDFPageTransition::Style::Uncover:
+        {
+            painter.drawImage(0, 0, to);
+            painter.drawImage(travel * progress, from);
+            return result;
+        }
+
+        case PDFPageTransition::Style::Fade:
+        {
+            painter.drawImage(0, 0, from);
+            painter.setOpacity(progress);
+            painter.drawImage(0, 0, to);
+            return result;
+        }
+
+        case PDFPageTransition::Style::R:
+            return to;
+    }
+
+    painter.drawImage(0, 0, from);
+    painter.setClipPath(clipPath);
+    painter.drawImage(0, 0, to);
+    return result;
+}
+
+PDFPageTransitionAnimator::PDFPageTransitionAnimator(QObject* parent) :
+    BaseClass(parent)
+{
+    m_timer.setTimerType(Qt::PreciseTimer);
+    setFrameRate(60);
+    connect(&m_timer, &QTimer::timeout, this, &PDFPageTransitionAnimator::onFrameTimeout);
+}
+
+void PDFPageTransitionAnimator::setFrameRate(int frameRate)
+{
+    m_timer.setInterval(1000 / qBound(1, frameRate, 1000));
+}
+
+void PDFPageTransitionAnimator::start(const PDFPageTransition& transition, const QImage& fromFrame, const QImage& toFrame, QSize screenSize)
+{
+    m_timer.stop();
+
+    m_transition = transition;
+    m_fromLayer = PDFPageTransitionCompositor::createLayer(fromFrame, screenSize);
+    m_toLayer = PDFPageTransitionCompositor::createLayer(toFrame, screenSize);
+
+    if (transition.getStyle() == PDFPageTransition::Style::R || transition.getDuration() <= 0.0)
+    {
+        stop();
+        return;
+    }
+
+    m_currentFrame = m_fromLayer;
+    Q_EMIT frameChanged();
+
+    m_clock.start();
+    m_timer.start();
+}
+
+void PDFPageTransitionAnimator::stop()
+{
+    if (m_toLayer.isNull())
+    {
+        // Transition is not running
+        return;
+    }
+
+    m_timer.stop();
+
+    m_currentFrame = m_toLayer;
+    m_fromLayer = QImage();
+    m_toLayer = QImage();
+
+    Q_EMIT frameChanged();
+    Q_EMIT finished();
+}
+
+void PDFPageTransitionAnimator::onFrameTimeout()
+{
+    const PDFReal progress = m_clock.elapsed() / (1000.0 * m_transition.getDuration());
+
+    if (progress >= 1.0)
+    {
+        stop();
+        return;
+    }
+
+    m_currentFrame = PDFPageTransitionCompositor::compose(m_transition, m_fromLayer, m_toLayer, progress);
+    Q_EMIT frameChanged();
+}
+
+}   // namespace pdf
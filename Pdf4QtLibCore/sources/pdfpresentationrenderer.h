@@ -0,0 +1,218 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef PDFPRESENTATIONRENDERER_H
+#define PDFPRESENTATIONRENDERER_H
+
+#include "pdfrenderer.h"
+#include "pdfpagetransition.h"
+#include "pdfoperationcontrol.h"
+
+#include <QTimer>
+#include <QImage>
+#include <QObject>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QElapsedTimer>
+
+#include <set>
+#include <map>
+#include <optional>
+
+namespace pdf
+{
+class PDFCMSManager;
+class PDFFontCache;
+class PDFOptionalContentActivity;
+
+/// Cache of page images (frames) for presentation mode. Frames are rendered
+/// at screen resolution in the background. When page is shown, the current
+/// page and its neighbours (next and previous page) are rendered, so transition
+/// to adjacent page can start immediately, without waiting for the page
+/// to be rendered. Frames of other pages are removed from the cache.
+class PDF4QTLIBCORESHARED_EXPORT PDFPresentationFrameCache : public QObject
+{
+    Q_OBJECT
+
+private:
+    using BaseClass = QObject;
+
+public:
+    explicit PDFPresentationFrameCache(const PDFDocument* document,
+                                       PDFFontCache* fontCache,
+                                       const PDFCMSManager* cmsManager,
+                                       const PDFOptionalContentActivity* optionalContentActivity,
+                                       PDFRenderer::Features features,
+                                       const PDFMeshQualitySettings& meshQualitySettings,
+                                       RendererEngine rendererEngine,
+                                       QObject* parent);
+    virtual ~PDFPresentationFrameCache() override;
+
+    /// Sets size of the screen (in device pixels). Frames are scaled
+    /// to fit the screen. If size is changed, all frames are invalidated.
+    /// \param screenSize Screen size
+    void setScreenSize(QSize screenSize);
+
+    /// Returns size of the screen (in device pixels)
+    QSize getScreenSize() const { return m_screenSize; }
+
+    /// Sets currently shown page. Frames of the current, next and previous
+    /// page are rendered in the background, if they are not already cached.
+    /// \param pageIndex Page index
+    void setCurrentPage(PDFInteger pageIndex);
+
+    /// Returns frame of the page. If frame is not yet rendered, or page
+    /// is not adjacent to the current page, null image is returned.
+    /// \param pageIndex Page index
+    QImage getFrame(PDFInteger pageIndex) const;
+
+    /// Returns size of the page frame, i.e. size of the rotated page
+    /// scaled to fit the screen (aspect ratio is preserved).
+    /// \param page Page
+    /// \param screenSize Screen size
+    static QSize getFrameSize(const PDFPage* page, QSize screenSize);
+
+signals:
+    /// This signal is emitted, when frame of the page is rendered
+    void frameRendered(PDFInteger pageIndex);
+
+private:
+    struct RenderResult
+    {
+        QSize screenSize;
+        bool isCancelled = false;
+        std::map<PDFInteger, QImage> frames;
+    };
+
+    /// Returns pages, which frames should be kept in the cache,
+    /// current page is first, then next page and previous page.
+    std::vector<PDFInteger> getAdjacentPages() const;
+
+    void startRender();
+    void onRenderFinished();
+
+    const PDFDocument* m_document;
+    PDFMeshQualitySettings m_meshQualitySettings;
+    PDFRasterizerPool m_rasterizerPool;
+    PDFCancellationToken m_cancellationToken;
+    QSize m_screenSize;
+    PDFInteger m_currentPageIndex = -1;
+    std::map<PDFInteger, QImage> m_frames;
+    std::set<PDFInteger> m_failedPages;
+    QFuture<RenderResult> m_future;
+    std::optional<QFutureWatcher<RenderResult>> m_futureWatcher;
+};
+
+/// Composes frames of the page transition from images of the old page
+/// and the new page. Both images must have the same size (use function
+/// \p createLayer to create images of screen size from the page frames).
+class PDF4QTLIBCORESHARED_EXPORT PDFPageTransitionCompositor
+{
+public:
+    /// Creates image of given size, filled by black color, with the
+    /// frame centered in it.
+    /// \param frame Page frame
+    /// \param size Size of the layer
+    static QImage createLayer(const QImage& frame, QSize size);
+
+    /// Composes frame of the transition.
+    /// \param transition Page transition
+    /// \param from Image of the old page
+    /// \param to Image of the new page
+    /// \param progress Progress of the transition (in range [0, 1])
+    static QImage compose(const PDFPageTransition& transition, const QImage& from, const QImage& to, PDFReal progress);
+
+private:
+    PDFPageTransitionCompositor() = delete;
+
+    /// Composes dissolve-like transition, new page is revealed
+    /// by blocks. If \p useDirection is true, order of the blocks
+    /// follows the direction of the transition.
+    static void composeBlocks(QPainter* painter, const PDFPageTransition& transition, const QImage& to, PDFReal progress, bool useDirection);
+
+    /// Returns direction vector of the transition (in device space)
+    static QPointF getDirection(const PDFPageTransition& transition);
+
+    /// Block size (in pixels) used in dissolve and glitter transitions
+    static constexpr int BLOCK_SIZE = 8;
+
+    /// Number of stripes of the blinds transition
+    static constexpr int BLINDS_COUNT = 6;
+};
+
+/// Animates the page transition. Progress of the transition is computed
+/// from the elapsed time, and frames are composed on steady frame clock,
+/// so if composition of the frame takes longer, frames are dropped, but
+/// the transition takes always the same time.
+class PDF4QTLIBCORESHARED_EXPORT PDFPageTransitionAnimator : public QObject
+{
+    Q_OBJECT
+
+private:
+    using BaseClass = QObject;
+
+public:
+    explicit PDFPageTransitionAnimator(QObject* parent);
+
+    /// Sets frame rate of the animation (frames per second)
+    /// \param frameRate Frame rate
+    void setFrameRate(int frameRate);
+
+    /// Starts the transition. Page frames are centered on the screen. If transition
+    /// has zero duration, or it is a simple replace transition, then final frame
+    /// is set and transition is finished immediately.
+    /// \param transition Page transition
+    /// \param fromFrame Frame of the old page
+    /// \param toFrame Frame of the new page
+    /// \param screenSize Screen size
+    void start(const PDFPageTransition& transition, const QImage& fromFrame, const QImage& toFrame, QSize screenSize);
+
+    /// Stops the transition, final frame is set
+    void stop();
+
+    /// Returns true, if transition is running
+    bool isRunning() const { return m_timer.isActive(); }
+
+    /// Returns current frame of the transition
+    const QImage& getCurrentFrame() const { return m_currentFrame; }
+
+signals:
+    /// This signal is emitted, when current frame is changed
+    void frameChanged();
+
+    /// This signal is emitted, when transition is finished
+    void finished();
+
+private:
+    void onFrameTimeout();
+
+    QTimer m_timer;
+    QElapsedTimer m_clock;
+    PDFPageTransition m_transition;
+    QImage m_fromLayer;
+    QImage m_toLayer;
+    QImage m_currentFrame;
+};
+
+}   // namespace pdf
+
+#endif // PDFPRESENTATIONRENDERER_H
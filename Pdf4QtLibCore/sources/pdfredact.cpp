@@ -24,6 +24,9 @@
 #include "pdfpainter.h"
 #include "pdfdocumentbuilder.h"
 #include "pdfoptimizer.h"
+#include "pdftextlayout.h"
+#include "pdftextlayoutgenerator.h"
+#include "pdfexecutionpolicy.h"
 #include "pdfdbgheap.h"
 
 namespace pdf
@@ -45,6 +48,51 @@ PDFRedact::PDFRedact(const PDFDocument* document,
 
 }
 
+QPainterPath PDFRedact::getRedactedTextPath(size_t pageIndex) const
+{
+    QPainterPath path;
+
+    if (m_redactedTextExpression.pattern().isEmpty() || !m_redactedTextExpression.isValid())
+    {
+        return path;
+    }
+
+    PDFTextLayout textLayout;
+    if (m_textLayoutStorage && m_textLayoutStorage->getCount() == m_document->getCatalog()->getPageCount())
+    {
+        textLayout = m_textLayoutStorage->getTextLayout(pageIndex);
+    }
+    else
+    {
+        const PDFPage* page = m_document->getCatalog()->getPage(pageIndex);
+        PDFTextLayoutGenerator generator(PDFRenderer::None, page, m_document, m_fontCache, m_cms, m_optionalContentActivity, QTransform(), *m_meshQualitySettings);
+        generator.processContents();
+        textLayout = generator.createTextLayout();
+    }
+
+    PDFTextSelection textSelection;
+    PDFTextFlows textFlows = PDFTextFlow::createTextFlows(textLayout, PDFTextFlow::RemoveSoftHyphen, pageIndex);
+    for (const PDFTextFlow& textFlow : textFlows)
+    {
+        for (const PDFFindResult& result : textFlow.find(m_redactedTextExpression))
+        {
+            textSelection.addItems(result.textSelectionItems, Qt::black);
+        }
+    }
+
+    if (!textSelection.isEmpty())
+    {
+        textSelection.build();
+
+        PDFTextLayoutCache textLayoutCache([&textLayout](PDFInteger) { return textLayout; });
+        PDFTextLayoutGetter textLayoutGetter(&textLayoutCache, pageIndex);
+        PDFTextSelectionPainter textSelectionPainter(&textSelection);
+        path = textSelectionPainter.prepareGeometry(pageIndex, textLayoutGetter, QTransform(), nullptr);
+    }
+
+    return path;
+}
+
 PDFDocument PDFRedact::perform(Options options)
 {
     PDFDocumentBuilder builder;
@@ -59,15 +107,17 @@ PDFDocument PDFRedact::perform(Options options)
 
     std::map<PDFObjectReference, PDFObjectReference> mapOldPageRefToNewPageRef;
 
-    for (size_t i = 0; i < m_document->getCatalog()->getPageCount(); ++i)
+    const size_t pageCount = m_document->getCatalog()->getPageCount();
+    std::vector<PDFObjectReference> newPageReferences;
+    newPageReferences.reserve(pageCount);
+
+    for (size_t i = 0; i < pageCount; ++i)
     {
         const PDFPage* page = m_document->getCatalog()->getPage(i);
 
-        PDFPrecompiledPage compiledPage;
-        renderer.compile(&compiledPage, i);
-
         PDFObjectReference newPageReference = builder.appendPage(page->getMediaBox());
         mapOldPageRefToNewPageRef[page->getPageReference()] = newPageReference;
+        newPageReferences.push_back(newPageReference);
 
         if (!page->getCropBox().isEmpty())
         {
@@ -86,10 +136,21 @@ PDFDocument PDFRedact::perform(Options options)
             builder.setPageArtBox(newPageReference, page->getArtBox());
         }
         builder.setPageRotation(newPageReference, page->getPageRotation());
+    }
 
-        PDFPageContentStreamBuilder contentStreamBuilder(&builder);
+    // Pages are independent of each other, so they are compiled, redacted
+    // and drawn into content streams in parallel. Content streams are then
+    // copied into the redacted document sequentially.
+    std::vector<PDFContentStreamBuilder::ContentStream> contentStreams(pageCount);
 
-        QPainterPath redactPath;
+    auto redactPage = [&](size_t i)
+    {
+        const PDFPage* page = m_document->getCatalog()->getPage(i);
+
+        PDFPrecompiledPage compiledPage;
+        renderer.compile(&compiledPage, i);
+
+        QPainterPath redactPath = getRedactedTextPath(i);
 
         for (const PDFObjectReference& annotationReference : page->getAnnotations())
         {
@@ -110,10 +171,41 @@ PDFDocument PDFRedact::perform(Options options)
         matrix.translate(0, page->getMediaBox().height());
         matrix.scale(1.0, -1.0);
 
-        QPainter* painter = contentStreamBuilder.begin(newPageReference);
+        PDFContentStreamBuilder contentStreamBuilder(page->getMediaBox().size(), PDFContentStreamBuilder::CoordinateSystem::Qt);
+        QPainter* painter = contentStreamBuilder.begin();
         compiledPage.redact(redactPath, matrix, m_redactFillColor);
         compiledPage.draw(painter, QRectF(), matrix, PDFRenderer::None, 1.0);
-        contentStreamBuilder.end(painter);
+        contentStreams[i] = contentStreamBuilder.end(painter);
+    };
+
+    auto range = PDFIntegerRange<size_t>(0, pageCount);
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, range.begin(), range.end(), redactPage);
+
+    for (size_t i = 0; i < pageCount; ++i)
+    {
+        PDFContentStreamBuilder::ContentStream& contentStream = contentStreams[i];
+
+        std::vector<PDFObject> copiedObjects = builder.copyFrom({ contentStream.resources, contentStream.contents }, contentStream.document.getStorage(), true);
+        Q_ASSERT(copiedObjects.size() == 2);
+
+        PDFObjectFactory pageUpdateFactory;
+
+        pageUpdateFactory.beginDictionary();
+
+        pageUpdateFactory.beginDictionaryItem("Contents");
+        pageUpdateFactory << copiedObjects[1].getReference();
+        pageUpdateFactory.endDictionaryItem();
+
+        pageUpdateFactory.beginDictionaryItem("Resources");
+        pageUpdateFactory << copiedObjects[0].getReference();
+        pageUpdateFactory.endDictionaryItem();
+
+        pageUpdateFactory.endDictionary();
+
+        builder.mergeTo(newPageReferences[i], pageUpdateFactory.takeObject());
+
+        // Free temporary document of the page as soon as possible
+        contentStream = PDFContentStreamBuilder::ContentStream();
     }
 
     if (options.testFlag(CopyTitle))
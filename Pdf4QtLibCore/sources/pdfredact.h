@@ -26,12 +26,17 @@
 #include "pdfdocument.h"
 #include "pdfrenderer.h"
 
+#include <QRegularExpression>
+
 namespace pdf
 {
+class PDFTextLayoutStorage;
 
 /// Create redacted document from the document, which have redact annotations.
 /// Redacted document has removed content marked by these annotations, and
-/// annotations themselfs are removed.
+/// annotations themselfs are removed. Pages are redacted in parallel (each
+/// page is compiled, redacted and drawn into new content stream independently),
+/// only assembling of the redacted document is sequential.
 class PDF4QTLIBCORESHARED_EXPORT PDFRedact
 {
 public:
@@ -52,15 +57,34 @@ public:
     Q_DECLARE_FLAGS(Options, Option)
 
 
+    /// Sets text layouts of the document pages, which are used for redaction
+    /// of the text. If text layouts are not set, or their page count doesn't
+    /// match the document, text layouts are created during the redaction.
+    /// Storage must not be modified during the redaction.
+    /// \param textLayoutStorage Text layouts (can be nullptr)
+    void setTextLayoutStorage(const PDFTextLayoutStorage* textLayoutStorage) { m_textLayoutStorage = textLayoutStorage; }
+
+    /// Sets regular expression of the redacted text. All text matching the expression
+    /// is redacted, as if it was marked by redact annotation. If expression is empty,
+    /// no text is redacted.
+    /// \param expression Regular expression
+    void setRedactedTextExpression(QRegularExpression expression) { m_redactedTextExpression = qMove(expression); }
+
     pdf::PDFDocument perform(Options options);
 
 private:
+    /// Returns redaction region of the text on the page (in page coordinates)
+    /// \param pageIndex Page index
+    QPainterPath getRedactedTextPath(size_t pageIndex) const;
+
     const PDFDocument* m_document;
     const PDFFontCache* m_fontCache;
     const PDFCMS* m_cms;
     const PDFOptionalContentActivity* m_optionalContentActivity;
     const PDFMeshQualitySettings* m_meshQualitySettings;
     QColor m_redactFillColor;
+    const PDFTextLayoutStorage* m_textLayoutStorage = nullptr;
+    QRegularExpression m_redactedTextExpression;
 };
 
 }   // namespace pdf
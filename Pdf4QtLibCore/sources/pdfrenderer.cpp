@@ -27,10 +27,15 @@
 #include "pdfprogress.h"
 #include "pdfannotation.h"
 #include "pdfblpainter.h"
+#include "pdftracing.h"
 
 #include <QDir>
 #include <QElapsedTimer>
 #include <QtMath>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QXmlStreamWriter>
 
 #include "pdfdbgheap.h"
 
@@ -194,8 +199,10 @@ QList<PDFRenderError> PDFRenderer::render(QPainter* painter, const QTransform& m
     return processor.processContents();
 }
 
-void PDFRenderer::compile(PDFPrecompiledPage* precompiledPage, size_t pageIndex) const
+void PDFRenderer::compile(PDFPrecompiledPage* precompiledPage, size_t pageIndex, const QTransform* imageTargetMatrix) const
 {
+    PDF_TRACE_ZONE("CompilePage", "compile");
+
     const PDFCatalog* catalog = m_document->getCatalog();
     if (pageIndex >= catalog->getPageCount() || !catalog->getPage(pageIndex))
     {
@@ -212,11 +219,26 @@ void PDFRenderer::compile(PDFPrecompiledPage* precompiledPage, size_t pageIndex)
 
     PDFPrecompiledPageGenerator generator(precompiledPage, m_features, page, m_document, m_fontCache, m_cms, m_optionalContentActivity, m_meshQualitySettings);
     generator.setOperationControl(m_operationControl);
+    generator.setOptionalContentDeferred(m_isOptionalContentDeferred);
+    if (imageTargetMatrix)
+    {
+        generator.setImageTargetMatrix(*imageTargetMatrix);
+    }
     QList<PDFRenderError> errors = generator.processContents();
 
-    PDFColorConvertor colorConvertor = m_cms->getColorConvertor();
-    PDFRenderer::applyFeaturesToColorConvertor(m_features, colorConvertor);
-    precompiledPage->convertColors(colorConvertor);
+    if (m_features.testFlag(DisplayTimes))
+    {
+        precompiledPage->setOperatorTimes(generator.getSlowestOperators(SLOWEST_OPERATORS_COUNT));
+    }
+
+    // If colors are adjusted on the rendered page image, we keep original colors
+    // in the compiled page, so it can be drawn using any color mode.
+    if (!m_features.testFlag(ColorAdjust_PostProcess))
+    {
+        PDFColorConvertor colorConvertor = m_cms->getColorConvertor();
+        PDFRenderer::applyFeaturesToColorConvertor(m_features, colorConvertor);
+        precompiledPage->convertColors(colorConvertor);
+    }
 
     precompiledPage->optimize();
     precompiledPage->finalize(timer.nsecsElapsed(), qMove(errors));
@@ -247,27 +269,98 @@ QImage PDFRasterizer::render(PDFInteger pageIndex,
                              PDFRenderer::Features features,
                              const PDFAnnotationManager* annotationManager,
                              const PDFCMS* cms,
-                             PageRotation extraRotation)
+                             PageRotation extraRotation,
+                             const PDFOptionalContentActivity* optionalContentActivity)
+{
+    QTransform matrix = PDFRenderer::createPagePointToDevicePointMatrix(page, QRect(QPoint(0, 0), size), extraRotation);
+    return renderImpl(pageIndex, page, compiledPage, size, matrix, features, annotationManager, cms, optionalContentActivity);
+}
+
+QImage PDFRasterizer::render(PDFInteger pageIndex,
+                             const PDFPage* page,
+                             const PDFPrecompiledPage* compiledPage,
+                             const QRectF& pageRect,
+                             QSize size,
+                             PDFRenderer::Features features,
+                             const PDFAnnotationManager* annotationManager,
+                             const PDFCMS* cms,
+                             PageRotation extraRotation,
+                             const PDFOptionalContentActivity* optionalContentActivity)
 {
+    if (!pageRect.isValid() || size.isEmpty())
+    {
+        return QImage();
+    }
+
+    QTransform matrix = createPageRectToImageMatrix(page, pageRect, size, extraRotation);
+    return renderImpl(pageIndex, page, compiledPage, size, matrix, features, annotationManager, cms, optionalContentActivity);
+}
+
+QTransform PDFRasterizer::createPageRectToImageMatrix(const PDFPage* page,
+                                                      const QRectF& pageRect,
+                                                      QSize size,
+                                                      PageRotation extraRotation)
+{
+    // Take the matrix of the whole page (at scale 1.0), then move and scale
+    // the rectangle mapped by this matrix to the image rectangle. Rectangle
+    // remains axis aligned, because page is rotated by multiples of 90 degrees.
+    const QRectF rotatedMediaBox = page->getRotatedBox(page->getMediaBox(), getPageRotationCombined(page->getPageRotation(), extraRotation));
+    const QTransform pageMatrix = PDFRenderer::createPagePointToDevicePointMatrix(page, QRectF(QPointF(0, 0), rotatedMediaBox.size()), extraRotation);
+    const QRectF deviceRect = pageMatrix.mapRect(pageRect);
+
+    QTransform imageMatrix;
+    imageMatrix.scale(size.width() / deviceRect.width(), size.height() / deviceRect.height());
+    imageMatrix.translate(-deviceRect.left(), -deviceRect.top());
+    return pageMatrix * imageMatrix;
+}
+
+QImage PDFRasterizer::renderImpl(PDFInteger pageIndex,
+                                 const PDFPage* page,
+                                 const PDFPrecompiledPage* compiledPage,
+                                 QSize size,
+                                 const QTransform& matrix,
+                                 PDFRenderer::Features features,
+                                 const PDFAnnotationManager* annotationManager,
+                                 const PDFCMS* cms,
+                                 const PDFOptionalContentActivity* optionalContentActivity)
+{
+    PDF_TRACE_ZONE("RasterizePage", "render");
+
     QImage image(size, QImage::Format_ARGB32_Premultiplied);
 
     PDFColorConvertor convertor = cms->getColorConvertor();
     PDFRenderer::applyFeaturesToColorConvertor(features, convertor);
-    QTransform matrix = PDFRenderer::createPagePointToDevicePointMatrix(page, QRect(QPoint(0, 0), size), extraRotation);
+
+    // Content outside of the image is not drawn at all
+    const QRectF cullRect(QPointF(0, 0), size);
+
+    // If colors are adjusted on the rendered image, then page content is drawn
+    // with original colors, then image is converted and annotations are drawn
+    // afterwards, because annotations convert their colors by themselves.
+    const bool isColorPostProcessed = features.testFlag(PDFRenderer::ColorAdjust_PostProcess) && convertor.isActive();
+
+    auto drawAnnotations = [&](QPainter* painter)
+    {
+        if (annotationManager)
+        {
+            QList<PDFRenderError> errors;
+            PDFTextLayoutGetter textLayoutGetter(nullptr, pageIndex);
+            annotationManager->drawPage(painter, pageIndex, compiledPage, textLayoutGetter, matrix, convertor, errors);
+        }
+    };
 
     if (m_rendererEngine == RendererEngine::Blend2D_MultiThread ||
         m_rendererEngine == RendererEngine::Blend2D_SingleThread)
     {
-        PDFBLPaintDevice blPaintDevice(image, false);
+        const bool isMultithreaded = m_rendererEngine == RendererEngine::Blend2D_MultiThread && m_threadCount != 1;
+        PDFBLPaintDevice blPaintDevice(image, isMultithreaded, m_threadCount);
 
         QPainter painter(&blPaintDevice);
-        compiledPage->draw(&painter, page->getCropBox(), matrix, features, 1.0);
+        compiledPage->draw(&painter, page->getCropBox(), matrix, features, 1.0, cullRect, optionalContentActivity);
 
-        if (annotationManager)
+        if (!isColorPostProcessed)
         {
-            QList<PDFRenderError> errors;
-            PDFTextLayoutGetter textLayoutGetter(nullptr, pageIndex);
-            annotationManager->drawPage(&painter, pageIndex, compiledPage, textLayoutGetter, matrix, convertor, errors);
+            drawAnnotations(&painter);
         }
     }
     else
@@ -276,29 +369,40 @@ QImage PDFRasterizer::render(PDFInteger pageIndex,
         image.fill(Qt::white);
 
         QPainter painter(&image);
-        compiledPage->draw(&painter, page->getCropBox(), matrix, features, 1.0);
+        compiledPage->draw(&painter, page->getCropBox(), matrix, features, 1.0, cullRect, optionalContentActivity);
 
-        if (annotationManager)
+        if (!isColorPostProcessed)
         {
-            QList<PDFRenderError> errors;
-            PDFTextLayoutGetter textLayoutGetter(nullptr, pageIndex);
-            annotationManager->drawPage(&painter, pageIndex, compiledPage, textLayoutGetter, matrix, convertor, errors);
+            drawAnnotations(&painter);
         }
     }
 
-    // Calculate image DPI
-    QSizeF rotatedSizeInMeters = page->getRotatedMediaBoxMM().size() / 1000.0;
-    QSizeF rotatedSizeInPixels = image.size();
-    qreal dpiX = rotatedSizeInPixels.width() / rotatedSizeInMeters.width();
-    qreal dpiY = rotatedSizeInPixels.height() / rotatedSizeInMeters.height();
-    image.setDotsPerMeterX(qCeil(dpiX));
-    image.setDotsPerMeterY(qCeil(dpiY));
+    if (isColorPostProcessed)
+    {
+        convertor.convertRenderedImage(image);
+
+        // Blend2D paint device clears the image, when painting begins,
+        // so annotations are drawn using standard software rasterizer.
+        QPainter painter(&image);
+        drawAnnotations(&painter);
+    }
+
+    // Calculate image DPI (length of the image pixel in page points)
+    const QTransform inversedMatrix = matrix.inverted();
+    const PDFReal pixelWidthMM = convertPDFPointToMM(inversedMatrix.map(QLineF(0, 0, 1, 0)).length());
+    const PDFReal pixelHeightMM = convertPDFPointToMM(inversedMatrix.map(QLineF(0, 0, 0, 1)).length());
+    if (pixelWidthMM > 0.0 && pixelHeightMM > 0.0)
+    {
+        image.setDotsPerMeterX(qCeil(1000.0 / pixelWidthMM));
+        image.setDotsPerMeterY(qCeil(1000.0 / pixelHeightMM));
+    }
 
     return image;
 }
 
 PDFRasterizer* PDFRasterizerPool::acquire()
 {
+    PDF_TRACE_ZONE("AcquireRasterizer", "render");
     m_semaphore.acquire();
 
     QMutexLocker guard(&m_mutex);
@@ -346,6 +450,18 @@ void PDFRasterizerPool::render(const std::vector<PDFInteger>& pageIndices,
     }
     auto processPage = [this, progress, &imageSizeGetter, &processImage](const PDFInteger pageIndex)
     {
+        PDF_TRACE_ZONE("RenderPage", "render");
+
+        if (PDFOperationControl::isOperationCancelled(m_operationControl))
+        {
+            // Rendering was cancelled, skip remaining pages
+            if (progress)
+            {
+                progress->step();
+            }
+            return;
+        }
+
         const PDFPage* page = m_document->getCatalog()->getPage(pageIndex);
 
         if (!page)
@@ -368,10 +484,23 @@ void PDFRasterizerPool::render(const std::vector<PDFInteger>& pageIndices,
         PDFPrecompiledPage precompiledPage;
         PDFCMSPointer cms = m_cmsManager->getCurrentCMS();
         PDFRenderer renderer(m_document, m_fontCache, cms.data(), m_optionalContentActivity, m_features, m_meshQualitySettings);
-        renderer.compile(&precompiledPage, pageIndex);
+        renderer.setOperationControl(m_operationControl);
+        const QSize imageSize = imageSizeGetter(page);
+        const QTransform imageTargetMatrix = PDFRenderer::createPagePointToDevicePointMatrix(page, QRect(QPoint(0, 0), imageSize));
+        renderer.compile(&precompiledPage, pageIndex, &imageTargetMatrix);
 
         qint64 pageCompileTime = pageTimer.restart();
 
+        if (PDFOperationControl::isOperationCancelled(m_operationControl))
+        {
+            // Compiled page may be incomplete, do not render it
+            if (progress)
+            {
+                progress->step();
+            }
+            return;
+        }
+
         for (const PDFRenderError& error : precompiledPage.getErrors())
         {
             Q_EMIT renderError(pageIndex, error);
@@ -389,7 +518,8 @@ void PDFRasterizerPool::render(const std::vector<PDFInteger>& pageIndices,
         pageTimer.restart();
         PDFRasterizer* rasterizer = acquire();
         qint64 pageWaitTime = pageTimer.restart();
-        QImage image = rasterizer->render(pageIndex, page, &precompiledPage, imageSizeGetter(page), m_features, &annotationManager, cms.data(), PageRotation::None);
+        rasterizer->setThreadCount(getRenderThreadCount(&precompiledPage));
+        QImage image = rasterizer->render(pageIndex, page, &precompiledPage, imageSize, m_features, &annotationManager, cms.data(), PageRotation::None);
         qint64 pageRenderTime = pageTimer.elapsed();
         release(rasterizer);
 
@@ -401,6 +531,8 @@ void PDFRasterizerPool::render(const std::vector<PDFInteger>& pageIndices,
         renderedPageImage.pageWaitTime = pageWaitTime;
         renderedPageImage.pageRenderTime = pageRenderTime;
         renderedPageImage.pageTotalTime = totalPageTimer.elapsed();
+        renderedPageImage.pageInstructionCount = precompiledPage.getInstructionCount();
+        renderedPageImage.pageMemoryConsumptionEstimate = precompiledPage.getMemoryConsumptionEstimate();
         processImage(renderedPageImage);
 
         if (progress)
@@ -419,6 +551,156 @@ void PDFRasterizerPool::render(const std::vector<PDFInteger>& pageIndices,
     Q_EMIT renderError(PDFCatalog::INVALID_PAGE_INDEX, PDFRenderError(RenderErrorType::Information, PDFTranslationContext::tr("%1 miliseconds elapsed to render %2 pages...").arg(timer.nsecsElapsed() / 1000000).arg(pageIndices.size())));
 }
 
+void PDFRasterizerPool::renderTiles(const std::vector<PDFRasterizerTile>& tiles,
+                                    const ProcessTileImageMethod& processImage,
+                                    PDFProgress* progress)
+{
+    if (tiles.empty())
+    {
+        return;
+    }
+
+    Q_ASSERT(processImage);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (progress)
+    {
+        ProgressStartupInfo info;
+        info.showDialog = true;
+        info.text = PDFTranslationContext::tr("Rendering document into tile images.");
+        progress->start(tiles.size(), qMove(info));
+    }
+
+    // Group tiles by pages, so each page is compiled only once
+    std::map<PDFInteger, std::vector<size_t>> pageTiles;
+    for (size_t i = 0; i < tiles.size(); ++i)
+    {
+        pageTiles[tiles[i].pageIndex].push_back(i);
+    }
+    std::vector<std::pair<PDFInteger, std::vector<size_t>>> pages(pageTiles.begin(), pageTiles.end());
+
+    auto processPage = [this, progress, &tiles, &processImage](const std::pair<PDFInteger, std::vector<size_t>>& pageItem)
+    {
+        PDF_TRACE_ZONE("RenderPageTiles", "render");
+
+        const PDFInteger pageIndex = pageItem.first;
+        const std::vector<size_t>& tileIndices = pageItem.second;
+        const PDFPage* page = m_document->getCatalog()->getPage(pageIndex);
+
+        if (PDFOperationControl::isOperationCancelled(m_operationControl))
+        {
+            // Rendering was cancelled, skip remaining pages
+            if (progress)
+            {
+                for (size_t i = 0; i < tileIndices.size(); ++i)
+                {
+                    progress->step();
+                }
+            }
+            return;
+        }
+
+        if (!page)
+        {
+            if (progress)
+            {
+                for (size_t i = 0; i < tileIndices.size(); ++i)
+                {
+                    progress->step();
+                }
+            }
+            Q_EMIT renderError(pageIndex, PDFRenderError(RenderErrorType::Error, PDFTranslationContext::tr("Page %1 not found.").arg(pageIndex)));
+            return;
+        }
+
+        QElapsedTimer pageTimer;
+        pageTimer.start();
+
+        // Images are decoded at resolution of the tile with the highest scale
+        auto getTileScale = [&tiles](size_t tileIndex)
+        {
+            const PDFRasterizerTile& tile = tiles[tileIndex];
+            return tile.pageRect.isValid() ? tile.imageSize.width() / tile.pageRect.width() : 0.0;
+        };
+        const size_t maxScaleTileIndex = *std::max_element(tileIndices.cbegin(), tileIndices.cend(), [&getTileScale](size_t l, size_t r) { return getTileScale(l) < getTileScale(r); });
+        const PDFRasterizerTile& maxScaleTile = tiles[maxScaleTileIndex];
+
+        // Precompile the page
+        PDFPrecompiledPage precompiledPage;
+        PDFCMSPointer cms = m_cmsManager->getCurrentCMS();
+        PDFRenderer renderer(m_document, m_fontCache, cms.data(), m_optionalContentActivity, m_features, m_meshQualitySettings);
+        renderer.setOperationControl(m_operationControl);
+        const QTransform imageTargetMatrix = PDFRasterizer::createPageRectToImageMatrix(page, maxScaleTile.pageRect, maxScaleTile.imageSize, PageRotation::None);
+        renderer.compile(&precompiledPage, pageIndex, maxScaleTile.pageRect.isValid() ? &imageTargetMatrix : nullptr);
+
+        const qint64 pageCompileTime = pageTimer.elapsed();
+
+        for (const PDFRenderError& error : precompiledPage.getErrors())
+        {
+            Q_EMIT renderError(pageIndex, error);
+        }
+
+        // We can const-cast here, because we do not modify the document in annotation manager.
+        // Annotations are just rendered to the target picture.
+        PDFModifiedDocument modifiedDocument(const_cast<PDFDocument*>(m_document), const_cast<PDFOptionalContentActivity*>(m_optionalContentActivity));
+
+        // Annotation manager
+        PDFAnnotationManager annotationManager(m_fontCache, m_cmsManager, m_optionalContentActivity, m_meshQualitySettings, m_features, PDFAnnotationManager::Target::Print, nullptr);
+        annotationManager.setDocument(modifiedDocument);
+
+        auto processTile = [&, this](size_t tileIndex)
+        {
+            if (PDFOperationControl::isOperationCancelled(m_operationControl))
+            {
+                if (progress)
+                {
+                    progress->step();
+                }
+                return;
+            }
+
+            const PDFRasterizerTile& tile = tiles[tileIndex];
+
+            QElapsedTimer tileTimer;
+            tileTimer.start();
+
+            // Render tile to image
+            PDFRasterizer* rasterizer = acquire();
+            qint64 tileWaitTime = tileTimer.restart();
+            rasterizer->setThreadCount(getRenderThreadCount(&precompiledPage));
+            QImage image = rasterizer->render(pageIndex, page, &precompiledPage, tile.pageRect, tile.imageSize, m_features, &annotationManager, cms.data(), PageRotation::None);
+            qint64 tileRenderTime = tileTimer.elapsed();
+            release(rasterizer);
+
+            // Now, process the image
+            PDFRenderedTileImage renderedTileImage;
+            renderedTileImage.tileIndex = tileIndex;
+            renderedTileImage.tile = tile;
+            renderedTileImage.tileImage = qMove(image);
+            renderedTileImage.pageCompileTime = pageCompileTime;
+            renderedTileImage.tileWaitTime = tileWaitTime;
+            renderedTileImage.tileRenderTime = tileRenderTime;
+            processImage(renderedTileImage);
+
+            if (progress)
+            {
+                progress->step();
+            }
+        };
+        PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Content, tileIndices.cbegin(), tileIndices.cend(), processTile);
+    };
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, pages.cbegin(), pages.cend(), processPage);
+
+    if (progress)
+    {
+        progress->finish();
+    }
+
+    Q_EMIT renderError(PDFCatalog::INVALID_PAGE_INDEX, PDFRenderError(RenderErrorType::Information, PDFTranslationContext::tr("%1 miliseconds elapsed to render %2 tiles...").arg(timer.nsecsElapsed() / 1000000).arg(tiles.size())));
+}
+
 int PDFRasterizerPool::getDefaultRasterizerCount()
 {
     int hint = QThread::idealThreadCount() / 2;
@@ -430,6 +712,48 @@ int PDFRasterizerPool::getCorrectedRasterizerCount(int rasterizerCount)
     return qBound(1, rasterizerCount, 256);
 }
 
+void PDFRasterizerPool::setThreadBudget(int threadBudget)
+{
+    m_threadBudget = threadBudget > 0 ? threadBudget : getDefaultThreadBudget();
+
+    // Number of concurrently rendered pages can't exceed the thread
+    // budget, so we reserve rasterizers, which are above the budget.
+    const int reservedRasterizerCount = qMax(m_rasterizerCount - m_threadBudget, 0);
+    if (reservedRasterizerCount > m_reservedRasterizerCount)
+    {
+        m_semaphore.acquire(reservedRasterizerCount - m_reservedRasterizerCount);
+    }
+    else if (reservedRasterizerCount < m_reservedRasterizerCount)
+    {
+        m_semaphore.release(m_reservedRasterizerCount - reservedRasterizerCount);
+    }
+    m_reservedRasterizerCount = reservedRasterizerCount;
+}
+
+int PDFRasterizerPool::getDefaultThreadBudget()
+{
+    return QThread::idealThreadCount();
+}
+
+int PDFRasterizerPool::getRenderThreadCount(const PDFPrecompiledPage* compiledPage)
+{
+    int activeRenderCount = 0;
+
+    {
+        QMutexLocker guard(&m_mutex);
+        activeRenderCount = m_rasterizerCount - int(m_rasterizers.size());
+    }
+
+    // Budget is divided between active renders. When only a few pages
+    // remain to be rendered, each of them gets more threads.
+    const int budgetThreadCount = qMax(m_threadBudget / qMax(activeRenderCount, 1), 1);
+
+    // Simple pages are rendered faster, than worker threads are started
+    const size_t complexityThreadCount = 1 + compiledPage->getInstructionCount() / INSTRUCTIONS_PER_THREAD;
+
+    return static_cast<int>(qMin<size_t>(budgetThreadCount, complexityThreadCount));
+}
+
 PDFImageWriterSettings::PDFImageWriterSettings()
 {
     m_formats = QImageWriter::supportedImageFormats();
@@ -671,6 +995,21 @@ bool PDFPageImageExportSettings::validate(QString* errorMessagePtr, bool validat
             errorMessage = PDFTranslationContext::tr("File template must contain character '%' for page number.");
             return false;
         }
+
+        if (m_pyramidMode != PyramidMode::None)
+        {
+            if (m_pyramidTileSize < getMinPyramidTileSize() || m_pyramidTileSize > getMaxPyramidTileSize())
+            {
+                errorMessage = PDFTranslationContext::tr("Tile size should be in range %1 to %2.").arg(getMinPyramidTileSize()).arg(getMaxPyramidTileSize());
+                return false;
+            }
+
+            if (m_pyramidOverlap < 0 || m_pyramidOverlap > m_pyramidTileSize / 2)
+            {
+                errorMessage = PDFTranslationContext::tr("Tile overlap should be in range 0 to %1.").arg(m_pyramidTileSize / 2);
+                return false;
+            }
+        }
     }
 
     // Check page selection
@@ -807,6 +1146,217 @@ QString PDFPageImageExportSettings::getOutputFileName(PDFInteger pageIndex, cons
     return QDir::toNativeSeparators(fileNameWithDirectory);
 }
 
+QString PDFPageImageExportSettings::getOutputPyramidBaseName(PDFInteger pageIndex) const
+{
+    QString baseName = m_fileTemplate;
+    baseName.replace('%', QString::number(pageIndex + 1));
+    return baseName;
+}
+
+PDFImagePyramid PDFPageImageExportSettings::createPyramid(QSize imageSize) const
+{
+    Q_ASSERT(m_pyramidMode != PyramidMode::None);
+
+    const PDFImagePyramid::Format format = (m_pyramidMode == PyramidMode::IIIF) ? PDFImagePyramid::Format::IIIF : PDFImagePyramid::Format::DeepZoom;
+    return PDFImagePyramid(format, imageSize, m_pyramidTileSize, m_pyramidOverlap);
+}
+
+PDFImagePyramid::PDFImagePyramid(Format format, QSize imageSize, int tileSize, int overlap) :
+    m_format(format),
+    m_imageSize(imageSize.expandedTo(QSize(1, 1))),
+    m_tileSize(qMax(tileSize, 1)),
+    m_overlap(format == Format::DeepZoom ? qMax(overlap, 0) : 0),
+    m_levelCount(1)
+{
+    const int maxDimension = qMax(m_imageSize.width(), m_imageSize.height());
+
+    switch (m_format)
+    {
+        case Format::DeepZoom:
+        {
+            // Levels are created down to the 1x1 pixel image
+            while ((qint64(1) << (m_levelCount - 1)) < maxDimension)
+            {
+                ++m_levelCount;
+            }
+            break;
+        }
+
+        case Format::IIIF:
+        {
+            // Levels are created until whole image fits into one tile
+            while (((qint64(maxDimension) + (qint64(1) << (m_levelCount - 1)) - 1) >> (m_levelCount - 1)) > m_tileSize)
+            {
+                ++m_levelCount;
+            }
+            break;
+        }
+    }
+}
+
+QSize PDFImagePyramid::getLevelSize(int scaleFactorExponent) const
+{
+    const qint64 scaleFactor = qint64(1) << scaleFactorExponent;
+    const int width = int((m_imageSize.width() + scaleFactor - 1) / scaleFactor);
+    const int height = int((m_imageSize.height() + scaleFactor - 1) / scaleFactor);
+    return QSize(width, height).expandedTo(QSize(1, 1));
+}
+
+std::vector<PDFImagePyramid::Tile> PDFImagePyramid::createTiles(const PDFPage* page, PDFInteger pageIndex, const QString& baseName, const QByteArray& imageFormat) const
+{
+    std::vector<Tile> tiles;
+
+    // Tiles are given in device space of the page at scale 1.0 (in points),
+    // and are mapped back to the page coordinate system.
+    const QRectF rotatedMediaBox = page->getRotatedMediaBox();
+    const QTransform pageMatrix = PDFRenderer::createPagePointToDevicePointMatrix(page, QRectF(QPointF(0, 0), rotatedMediaBox.size()));
+    const QTransform deviceToPageMatrix = pageMatrix.inverted();
+    const QString suffix = QString::fromLatin1(imageFormat);
+
+    for (int scaleFactorExponent = 0; scaleFactorExponent < m_levelCount; ++scaleFactorExponent)
+    {
+        const int scaleFactor = 1 << scaleFactorExponent;
+        const QSize levelSize = getLevelSize(scaleFactorExponent);
+        const QRect levelRect(QPoint(0, 0), levelSize);
+        const PDFReal scaleX = rotatedMediaBox.width() / levelSize.width();
+        const PDFReal scaleY = rotatedMediaBox.height() / levelSize.height();
+        const int columns = (levelSize.width() + m_tileSize - 1) / m_tileSize;
+        const int rows = (levelSize.height() + m_tileSize - 1) / m_tileSize;
+
+        for (int row = 0; row < rows; ++row)
+        {
+            for (int column = 0; column < columns; ++column)
+            {
+                const QRect tileRect = QRect(column * m_tileSize, row * m_tileSize, m_tileSize, m_tileSize).adjusted(-m_overlap, -m_overlap, m_overlap, m_overlap).intersected(levelRect);
+                const QRectF deviceRect(tileRect.x() * scaleX, tileRect.y() * scaleY, tileRect.width() * scaleX, tileRect.height() * scaleY);
+
+                Tile tile;
+                tile.tile.pageIndex = pageIndex;
+                tile.tile.pageRect = deviceToPageMatrix.mapRect(deviceRect);
+                tile.tile.imageSize = tileRect.size();
+
+                switch (m_format)
+                {
+                    case Format::DeepZoom:
+                    {
+                        // Level with the highest index is the full resolution image
+                        const int level = m_levelCount - 1 - scaleFactorExponent;
+                        tile.fileNames << QString("%1_files/%2/%3_%4.%5").arg(baseName).arg(level).arg(column).arg(row).arg(suffix);
+                        break;
+                    }
+
+                    case Format::IIIF:
+                    {
+                        // Region is given in full resolution image coordinates
+                        const int x = column * m_tileSize * scaleFactor;
+                        const int y = row * m_tileSize * scaleFactor;
+                        const int width = qMin(m_tileSize * scaleFactor, m_imageSize.width() - x);
+                        const int height = qMin(m_tileSize * scaleFactor, m_imageSize.height() - y);
+                        const QString size = QString("%1,%2").arg(tileRect.width()).arg(tileRect.height());
+                        tile.fileNames << QString("%1/%2,%3,%4,%5/%6/0/default.%7").arg(baseName).arg(x).arg(y).arg(width).arg(height).arg(size, suffix);
+
+                        if (columns == 1 && rows == 1)
+                        {
+                            // Tile contains whole image, clients can request it as full region
+                            tile.fileNames << QString("%1/full/%2/0/default.%3").arg(baseName, size, suffix);
+
+                            if (scaleFactorExponent == 0)
+                            {
+                                tile.fileNames << QString("%1/full/max/0/default.%2").arg(baseName, suffix);
+                            }
+                        }
+                        break;
+                    }
+                }
+
+                tiles.push_back(qMove(tile));
+            }
+        }
+    }
+
+    return tiles;
+}
+
+QString PDFImagePyramid::getDescriptorFileName(const QString& baseName) const
+{
+    switch (m_format)
+    {
+        case Format::DeepZoom:
+            return QString("%1.dzi").arg(baseName);
+
+        case Format::IIIF:
+            return QString("%1/info.json").arg(baseName);
+    }
+
+    Q_ASSERT(false);
+    return QString();
+}
+
+QByteArray PDFImagePyramid::createDescriptor(const QString& baseName, const QByteArray& imageFormat) const
+{
+    QByteArray descriptor;
+
+    switch (m_format)
+    {
+        case Format::DeepZoom:
+        {
+            QXmlStreamWriter writer(&descriptor);
+            writer.setAutoFormatting(true);
+            writer.writeStartDocument();
+            writer.writeStartElement("Image");
+            writer.writeDefaultNamespace("http://schemas.microsoft.com/deepzoom/2008");
+            writer.writeAttribute("Format", QString::fromLatin1(imageFormat));
+            writer.writeAttribute("Overlap", QString::number(m_overlap));
+            writer.writeAttribute("TileSize", QString::number(m_tileSize));
+            writer.writeStartElement("Size");
+            writer.writeAttribute("Width", QString::number(m_imageSize.width()));
+            writer.writeAttribute("Height", QString::number(m_imageSize.height()));
+            writer.writeEndElement();
+            writer.writeEndElement();
+            writer.writeEndDocument();
+            break;
+        }
+
+        case Format::IIIF:
+        {
+            QJsonArray scaleFactors;
+            for (int scaleFactorExponent = 0; scaleFactorExponent < m_levelCount; ++scaleFactorExponent)
+            {
+                scaleFactors.append(1 << scaleFactorExponent);
+            }
+
+            QJsonObject tiles;
+            tiles["width"] = m_tileSize;
+            tiles["height"] = m_tileSize;
+            tiles["scaleFactors"] = scaleFactors;
+
+            // Only the smallest level is available as a full image
+            const QSize smallestLevelSize = getLevelSize(m_levelCount - 1);
+            QJsonObject size;
+            size["width"] = smallestLevelSize.width();
+            size["height"] = smallestLevelSize.height();
+
+            // Identifier should be URI of the image service, which is not known
+            // here, so base name is used (it is relative to the descriptor).
+            QJsonObject info;
+            info["@context"] = "http://iiif.io/api/image/3/context.json";
+            info["id"] = baseName;
+            info["type"] = "ImageService3";
+            info["protocol"] = "http://iiif.io/api/image";
+            info["profile"] = "level0";
+            info["width"] = m_imageSize.width();
+            info["height"] = m_imageSize.height();
+            info["sizes"] = QJsonArray({ size });
+            info["tiles"] = QJsonArray({ tiles });
+
+            descriptor = QJsonDocument(info).toJson();
+            break;
+        }
+    }
+
+    return descriptor;
+}
+
 PDFRasterizerPool::PDFRasterizerPool(const PDFDocument* document,
                                      PDFFontCache* fontCache,
                                      const PDFCMSManager* cmsManager,
@@ -823,7 +1373,9 @@ PDFRasterizerPool::PDFRasterizerPool(const PDFDocument* document,
     m_optionalContentActivity(optionalContentActivity),
     m_features(features),
     m_meshQualitySettings(meshQualitySettings),
-    m_semaphore(rasterizerCount)
+    m_semaphore(rasterizerCount),
+    m_rasterizerCount(rasterizerCount),
+    m_threadBudget(getDefaultThreadBudget())
 {
     m_rasterizers.reserve(rasterizerCount);
     for (int i = 0; i < rasterizerCount; ++i)
@@ -60,7 +60,7 @@ public:
         SmoothImages                = 0x0004,   ///< Adjust images to the device space using smooth transformation (slower, but better image quality)
         IgnoreOptionalContent       = 0x0008,   ///< Ignore optional content (so all is drawn ignoring settings of optional content)
         ClipToCropBox               = 0x0010,   ///< Clip page content to crop box (items outside crop box will not be visible)
-        DisplayTimes                = 0x0020,   ///< Display page compile/draw time
+        DisplayTimes                = 0x0020,   ///< Display page compile/draw time, slowest operators and performance overlay
         DebugTextBlocks             = 0x0040,   ///< Debug text block layout algorithm
         DebugTextLines              = 0x0080,   ///< Debug text line layout algorithm
         DenyExtraGraphics           = 0x0100,   ///< Do not display additional graphics, for example from tools
@@ -72,6 +72,11 @@ public:
         ColorAdjust_HighContrast    = 0x2000,   ///< Convert colors to high constrast colors
         ColorAdjust_Bitonal         = 0x4000,   ///< Convert colors to bitonal (monochromatic)
         ColorAdjust_CustomColors    = 0x8000,   ///< Convert colors to custom color settings
+
+        DownscaleImages             = 0x10000,  ///< Decode JPEG images at reduced resolution, if they are painted smaller (faster, but image is no longer sharp, when it is zoomed in)
+        GlyphAtlas                  = 0x20000,  ///< Draw small unrotated text using cached glyph bitmaps (faster, but glyphs are positioned with quarter pixel precision)
+        TiledRendering              = 0x40000,  ///< Render pages in the viewer into cached tiles on worker threads (faster panning at high zoom, but uses more memory)
+        ColorAdjust_PostProcess     = 0x80000,  ///< Adjust colors of the rendered page image instead of colors of the compiled page (changing color mode doesn't require recompilation of pages)
     };
 
     Q_DECLARE_FLAGS(Features, Feature)
@@ -101,7 +106,10 @@ public:
     /// to the compiled page.
     /// \param precompiledPage Precompiled page pointer
     /// \param pageIndex Index of page to be compiled
-    void compile(PDFPrecompiledPage* precompiledPage, size_t pageIndex) const;
+    /// \param imageTargetMatrix Matrix, which maps page points to device pixels of the target,
+    ///        on which compiled page will be drawn (can be nullptr). If it is set, and feature
+    ///        DownscaleImages is turned on, then images are decoded at reduced resolution.
+    void compile(PDFPrecompiledPage* precompiledPage, size_t pageIndex, const QTransform* imageTargetMatrix = nullptr) const;
 
     /// Creates page point to device point matrix for the given rectangle. It creates transformation
     /// from page's media box to the target rectangle.
@@ -132,7 +140,17 @@ public:
     const PDFOperationControl* getOperationControl() const;
     void setOperationControl(const PDFOperationControl* newOperationControl);
 
+    /// Sets, if optional content is deferred in compiled pages. Compiled page then contains
+    /// all optional content, which is evaluated, when page is drawn, so change of the state
+    /// of optional content doesn't require page to be compiled again. Optional content
+    /// activity must be then passed to the function, which draws the compiled page.
+    /// \param optionalContentDeferred Is optional content deferred?
+    void setOptionalContentDeferred(bool optionalContentDeferred) { m_isOptionalContentDeferred = optionalContentDeferred; }
+
 private:
+    /// Count of the slowest operators stored in the compiled page, when times are displayed
+    static constexpr size_t SLOWEST_OPERATORS_COUNT = 3;
+
     const PDFDocument* m_document;
     const PDFFontCache* m_fontCache;
     const PDFCMS* m_cms;
@@ -140,6 +158,7 @@ private:
     const PDFOperationControl* m_operationControl;
     Features m_features;
     PDFMeshQualitySettings m_meshQualitySettings;
+    bool m_isOptionalContentDeferred = false;
 };
 
 /// Renders PDF pages to bitmap images (QImage).
@@ -159,6 +178,11 @@ public:
     /// \param rendererEngine Renderer engine type
     void reset(RendererEngine rendererEngine);
 
+    /// Sets number of threads used by a single render. It is used only
+    /// by multithreaded Blend2D renderer engine. Zero means ideal thread count.
+    /// \param threadCount Thread count
+    void setThreadCount(int threadCount) { m_threadCount = threadCount; }
+
     /// Renders page to the image of given size. If some error occurs, then
     /// empty image is returned. Warning: this function can modify this object,
     /// so it is not const and is not thread safe. We can also draw annotations,
@@ -171,6 +195,8 @@ public:
     /// \param annotationManager Annotation manager (can be nullptr)
     /// \param cms Color management system
     /// \param extraRotation Extra page rotation
+    /// \param optionalContentActivity Optional content activity used to evaluate
+    ///        deferred optional content of the compiled page (can be nullptr)
     QImage render(PDFInteger pageIndex,
                   const PDFPage* page,
                   const PDFPrecompiledPage* compiledPage,
@@ -178,10 +204,61 @@ public:
                   PDFRenderer::Features features,
                   const PDFAnnotationManager* annotationManager,
                   const PDFCMS* cms,
-                  PageRotation extraRotation);
+                  PageRotation extraRotation,
+                  const PDFOptionalContentActivity* optionalContentActivity = nullptr);
+
+    /// Renders rectangle of the page to the image of given size. Rectangle is in
+    /// the page coordinate system and it is scaled to fill the whole image, so
+    /// scale is given by the ratio of image size and rectangle size. Page is rotated
+    /// in the same way, as when whole page is rendered. If some error occurs, then
+    /// empty image is returned. Warning: this function can modify this object,
+    /// so it is not const and is not thread safe.
+    /// \param pageIndex Page index
+    /// \param page Page
+    /// \param compiledPage Compiled page contents
+    /// \param pageRect Rendered rectangle of the page (in page coordinates)
+    /// \param size Size of the target image
+    /// \param features Renderer features
+    /// \param annotationManager Annotation manager (can be nullptr)
+    /// \param cms Color management system
+    /// \param extraRotation Extra page rotation
+    /// \param optionalContentActivity Optional content activity used to evaluate
+    ///        deferred optional content of the compiled page (can be nullptr)
+    QImage render(PDFInteger pageIndex,
+                  const PDFPage* page,
+                  const PDFPrecompiledPage* compiledPage,
+                  const QRectF& pageRect,
+                  QSize size,
+                  PDFRenderer::Features features,
+                  const PDFAnnotationManager* annotationManager,
+                  const PDFCMS* cms,
+                  PageRotation extraRotation,
+                  const PDFOptionalContentActivity* optionalContentActivity = nullptr);
+
+    /// Creates page point to device point matrix, which maps rectangle
+    /// of the page (in page coordinates) onto the whole image.
+    /// \param page Page
+    /// \param pageRect Rectangle of the page
+    /// \param size Size of the target image
+    /// \param extraRotation Extra page rotation
+    static QTransform createPageRectToImageMatrix(const PDFPage* page,
+                                                  const QRectF& pageRect,
+                                                  QSize size,
+                                                  PageRotation extraRotation);
 
 private:
+    QImage renderImpl(PDFInteger pageIndex,
+                      const PDFPage* page,
+                      const PDFPrecompiledPage* compiledPage,
+                      QSize size,
+                      const QTransform& matrix,
+                      PDFRenderer::Features features,
+                      const PDFAnnotationManager* annotationManager,
+                      const PDFCMS* cms,
+                      const PDFOptionalContentActivity* optionalContentActivity);
+
     RendererEngine m_rendererEngine;
+    int m_threadCount = 0;
 };
 
 /// Simple structure for storing rendered page images
@@ -191,10 +268,88 @@ struct PDFRenderedPageImage
     qint64 pageWaitTime = 0;
     qint64 pageRenderTime = 0;
     qint64 pageTotalTime = 0;
+    size_t pageInstructionCount = 0;            ///< Count of instructions of the compiled page
+    qint64 pageMemoryConsumptionEstimate = 0;   ///< Memory consumption estimate of the compiled page (in bytes)
     PDFInteger pageIndex;
     QImage pageImage;
 };
 
+/// Rectangle of the page, which is rendered to the image by rasterizer pool
+struct PDFRasterizerTile
+{
+    PDFInteger pageIndex = 0;
+    QRectF pageRect;    ///< Rendered rectangle of the page (in page coordinates)
+    QSize imageSize;    ///< Size of the target image
+};
+
+/// Simple structure for storing rendered tile images
+struct PDFRenderedTileImage
+{
+    qint64 pageCompileTime = 0;
+    qint64 tileWaitTime = 0;
+    qint64 tileRenderTime = 0;
+    size_t tileIndex = 0;   ///< Index of the tile in the rendered tile list
+    PDFRasterizerTile tile;
+    QImage tileImage;
+};
+
+/// Tiled image pyramid of the page in Deep Zoom or IIIF (level 0, static tiles) layout.
+/// Each level of the pyramid is rendered tile by tile directly from the page (using
+/// rasterizer pool), so bitmap of the whole page is never created, and memory
+/// consumption doesn't depend on image size.
+class PDF4QTLIBCORESHARED_EXPORT PDFImagePyramid
+{
+public:
+    enum class Format
+    {
+        DeepZoom,   ///< Deep Zoom image, descriptor 'name.dzi', tiles in 'name_files/level/column_row.ext'
+        IIIF        ///< IIIF image, descriptor 'name/info.json', tiles in 'name/region/size/0/default.ext'
+    };
+
+    struct Tile
+    {
+        PDFRasterizerTile tile;
+        QStringList fileNames;  ///< File names of the tile image (relative to output directory)
+    };
+
+    /// Creates layout of the pyramid
+    /// \param format Layout of the pyramid
+    /// \param imageSize Size of the full resolution image
+    /// \param tileSize Tile size (in pixels)
+    /// \param overlap Overlap of adjacent tiles (in pixels), used only in Deep Zoom
+    explicit PDFImagePyramid(Format format, QSize imageSize, int tileSize, int overlap);
+
+    /// Returns count of levels of the pyramid
+    int getLevelCount() const { return m_levelCount; }
+
+    /// Creates tiles of all levels of the pyramid, full resolution level first
+    /// \param page Page
+    /// \param pageIndex Page index
+    /// \param baseName Base name of the output files (without suffix)
+    /// \param imageFormat Image format (is used as file suffix)
+    std::vector<Tile> createTiles(const PDFPage* page, PDFInteger pageIndex, const QString& baseName, const QByteArray& imageFormat) const;
+
+    /// Returns file name of the descriptor (relative to output directory)
+    /// \param baseName Base name of the output files (without suffix)
+    QString getDescriptorFileName(const QString& baseName) const;
+
+    /// Creates descriptor of the pyramid (DZI file for Deep Zoom, info.json for IIIF)
+    /// \param baseName Base name of the output files (without suffix)
+    /// \param imageFormat Image format
+    QByteArray createDescriptor(const QString& baseName, const QByteArray& imageFormat) const;
+
+private:
+    /// Returns size of the level, where full resolution image
+    /// is scaled down by factor 2^scaleFactorExponent.
+    QSize getLevelSize(int scaleFactorExponent) const;
+
+    Format m_format;
+    QSize m_imageSize;
+    int m_tileSize;
+    int m_overlap;
+    int m_levelCount;
+};
+
 /// Pool of page image renderers. It can use predefined number of renderers to
 /// render page images asynchronously. You can use this object in two ways -
 /// first one is as standard object pool, second one is to directly render
@@ -211,6 +366,7 @@ public:
 
     using PageImageSizeGetter = std::function<QSize(const PDFPage*)>;
     using ProcessImageMethod = std::function<void(PDFRenderedPageImage&)>;
+    using ProcessTileImageMethod = std::function<void(PDFRenderedTileImage&)>;
 
     /// Creates new rasterizer pool
     /// \param document Document
@@ -252,6 +408,16 @@ public:
                 const ProcessImageMethod& processImage,
                 PDFProgress* progress);
 
+    /// Renders tiles asynchronously to images. Each page is compiled only once,
+    /// and then all its tiles are rendered in parallel. Process image function
+    /// can be called from multiple threads.
+    /// \param tiles Rendered tiles
+    /// \param processImage Method, which processes rendered tile images
+    /// \param progress Progress indicator
+    void renderTiles(const std::vector<PDFRasterizerTile>& tiles,
+                     const ProcessTileImageMethod& processImage,
+                     PDFProgress* progress);
+
     /// Returns default rasterizer count
     static int getDefaultRasterizerCount();
 
@@ -262,10 +428,42 @@ public:
     /// \returns Corrected number of rasterizers
     static int getCorrectedRasterizerCount(int rasterizerCount);
 
+    /// Sets thread budget, i.e. total number of threads used for rendering
+    /// of the pages. Number of pages rendered concurrently doesn't exceed the
+    /// budget, and remaining threads are divided between pages rendered
+    /// by multithreaded Blend2D engine. Complex pages can get more threads,
+    /// simple pages are always rendered by one thread. Do not call this
+    /// function while rendering.
+    /// \param threadBudget Thread budget (zero means ideal thread count)
+    void setThreadBudget(int threadBudget);
+
+    /// Returns thread budget
+    int getThreadBudget() const { return m_threadBudget; }
+
+    /// Returns default thread budget
+    static int getDefaultThreadBudget();
+
+    /// Sets operation control (for example, cancellation token), which is
+    /// propagated to the compilation of the pages. If operation is cancelled,
+    /// pages, which were not yet rendered, are skipped. Do not call this
+    /// function while rendering.
+    /// \param operationControl Operation control
+    void setOperationControl(const PDFOperationControl* operationControl) { m_operationControl = operationControl; }
+
 signals:
     void renderError(PDFInteger pageIndex, PDFRenderError error);
 
 private:
+    /// Returns number of threads for rendering of the page by the
+    /// acquired rasterizer. Thread budget is divided between active
+    /// renders, and page complexity is taken into account.
+    /// \param compiledPage Compiled page
+    int getRenderThreadCount(const PDFPrecompiledPage* compiledPage);
+
+    /// Number of instructions of the compiled page, which are
+    /// rendered by one thread of the multithreaded renderer
+    static constexpr size_t INSTRUCTIONS_PER_THREAD = 2048;
+
     const PDFDocument* m_document;
     PDFFontCache* m_fontCache;
     const PDFCMSManager* m_cmsManager;
@@ -276,6 +474,13 @@ private:
     QSemaphore m_semaphore;
     QMutex m_mutex;
     std::vector<PDFRasterizer*> m_rasterizers;
+    int m_rasterizerCount = 0;
+    int m_threadBudget = 0;
+    const PDFOperationControl* m_operationControl = nullptr;
+
+    /// Number of rasterizers, which can't be acquired,
+    /// because of the thread budget.
+    int m_reservedRasterizerCount = 0;
 };
 
 /// Settings object for image writer
@@ -349,6 +554,13 @@ public:
         Pixels
     };
 
+    enum class PyramidMode
+    {
+        None,       ///< Each page is exported as single image
+        DeepZoom,   ///< Each page is exported as Deep Zoom tiled image pyramid
+        IIIF        ///< Each page is exported as IIIF (level 0) tiled image pyramid
+    };
+
     ResolutionMode getResolutionMode() const;
     void setResolutionMode(ResolutionMode resolution);
 
@@ -370,6 +582,15 @@ public:
     int getPixelResolution() const;
     void setPixelResolution(int pixelResolution);
 
+    PyramidMode getPyramidMode() const { return m_pyramidMode; }
+    void setPyramidMode(PyramidMode pyramidMode) { m_pyramidMode = pyramidMode; }
+
+    int getPyramidTileSize() const { return m_pyramidTileSize; }
+    void setPyramidTileSize(int pyramidTileSize) { m_pyramidTileSize = pyramidTileSize; }
+
+    int getPyramidOverlap() const { return m_pyramidOverlap; }
+    void setPyramidOverlap(int pyramidOverlap) { m_pyramidOverlap = pyramidOverlap; }
+
     /// Validates the settings, if they can be used for image generation
     bool validate(QString* errorMessagePtr, bool validatePageSelection = true, bool validateFileSettings = true, bool validateResolution = true) const;
 
@@ -379,12 +600,23 @@ public:
     /// Returns output file name for given page
     QString getOutputFileName(PDFInteger pageIndex, const QByteArray& outputFormat) const;
 
+    /// Returns base name of the files of image pyramid of the given page (file template
+    /// with page number, without directory and suffix)
+    QString getOutputPyramidBaseName(PDFInteger pageIndex) const;
+
+    /// Creates layout of image pyramid of the page. Pyramid mode must not be None.
+    /// \param imageSize Size of the full resolution image of the page
+    PDFImagePyramid createPyramid(QSize imageSize) const;
+
     static constexpr int getMinDPIResolution() { return 72; }
     static constexpr int getMaxDPIResolution() { return 6000; }
 
     static constexpr int getMinPixelResolution() { return 100; }
     static constexpr int getMaxPixelResolution() { return 16384; }
 
+    static constexpr int getMinPyramidTileSize() { return 16; }
+    static constexpr int getMaxPyramidTileSize() { return 4096; }
+
 private:
     const PDFDocument* m_document;
     ResolutionMode m_resolutionMode = ResolutionMode::DPI;
@@ -394,6 +626,9 @@ private:
     QString m_pageSelection;
     int m_dpiResolution = 300;
     int m_pixelResolution = 100;
+    PyramidMode m_pyramidMode = PyramidMode::None;
+    int m_pyramidTileSize = 256;
+    int m_pyramidOverlap = 1;
 };
 
 }   // namespace pdf
@@ -53,6 +53,7 @@
 #include <openssl/evp.h>
 
 #include <array>
+#include <cstring>
 
 namespace pdf
 {
@@ -85,10 +86,11 @@ public:
         Encrypt
     };
 
-    explicit PDFDecryptOrEncryptObjectVisitor(const PDFSecurityHandler* securityHandler, PDFObjectReference reference, Mode mode) :
+    explicit PDFDecryptOrEncryptObjectVisitor(const PDFSecurityHandler* securityHandler, PDFObjectReference reference, Mode mode, PDFStreamDecryptorPointer streamDecryptor = nullptr) :
         m_securityHandler(securityHandler),
         m_reference(reference),
-        m_mode(mode)
+        m_mode(mode),
+        m_streamDecryptor(std::move(streamDecryptor))
     {
         m_objectStack.reserve(32);
     }
@@ -111,6 +113,7 @@ private:
     std::vector<PDFObject> m_objectStack;
     PDFObjectReference m_reference;
     Mode m_mode = Mode::Decrypt;
+    PDFStreamDecryptorPointer m_streamDecryptor;
 };
 
 void PDFDecryptOrEncryptObjectVisitor::visitNull()
@@ -229,6 +232,16 @@ void PDFDecryptOrEncryptObjectVisitor::visitStream(const PDFStream* stream)
         const bool isEmbeddedFile = object.isName() && object.getString() == "EmbeddedFile";
         const PDFSecurityHandler::EncryptionScope scope = !isEmbeddedFile ? PDFSecurityHandler::EncryptionScope::Stream : PDFSecurityHandler::EncryptionScope::EmbeddedFile;
 
+        if (m_mode == Mode::Decrypt && m_streamDecryptor)
+        {
+            // Content is decrypted lazily, when it is accessed. Content can refer to the
+            // external memory, so it is not copied. We need only size of decrypted data.
+            const QByteArray* content = stream->getContent();
+            processedDictionary.setEntry(PDFInplaceOrMemoryString("Length"), PDFObject::createInteger(m_securityHandler->getDecryptedSize(*content, m_reference, scope)));
+            m_objectStack.push_back(PDFObject::createStream(std::make_shared<PDFStream>(qMove(processedDictionary), QByteArray(*content), stream->getDataOwner(), m_streamDecryptor, m_reference, isEmbeddedFile)));
+            return;
+        }
+
         switch (m_mode)
         {
             case pdf::PDFDecryptOrEncryptObjectVisitor::Mode::Decrypt:
@@ -291,6 +304,44 @@ PDFObject PDFSecurityHandler::decryptObject(const PDFObject& object, PDFObjectRe
     return visitor.getProcessedObject();
 }
 
+PDFObject PDFSecurityHandler::decryptObject(const PDFObject& object, PDFObjectReference reference, PDFStreamDecryptorPointer streamDecryptor) const
+{
+    PDFDecryptOrEncryptObjectVisitor visitor(this, reference, PDFDecryptOrEncryptObjectVisitor::Mode::Decrypt, std::move(streamDecryptor));
+    object.accept(&visitor);
+    return visitor.getProcessedObject();
+}
+
+/// Decrypts stream contents using the security handler. Security
+/// handler is shared, so it is kept alive as long as streams exist.
+class PDFSecurityHandlerStreamDecryptor : public PDFStreamDecryptor
+{
+public:
+    explicit PDFSecurityHandlerStreamDecryptor(PDFSecurityHandlerPointer securityHandler) :
+        m_securityHandler(std::move(securityHandler))
+    {
+
+    }
+
+    virtual QByteArray decrypt(const QByteArray& content, PDFObjectReference reference, bool isEmbeddedFile) const override
+    {
+        const PDFSecurityHandler::EncryptionScope scope = !isEmbeddedFile ? PDFSecurityHandler::EncryptionScope::Stream : PDFSecurityHandler::EncryptionScope::EmbeddedFile;
+        return m_securityHandler->decrypt(content, reference, scope);
+    }
+
+private:
+    PDFSecurityHandlerPointer m_securityHandler;
+};
+
+PDFStreamDecryptorPointer PDFSecurityHandler::createStreamDecryptor(PDFSecurityHandlerPointer securityHandler)
+{
+    if (!securityHandler || securityHandler->getMode() == EncryptionMode::None)
+    {
+        return nullptr;
+    }
+
+    return std::make_shared<PDFSecurityHandlerStreamDecryptor>(std::move(securityHandler));
+}
+
 PDFObject PDFSecurityHandler::encryptObject(const PDFObject& object, PDFObjectReference reference) const
 {
     PDFDecryptOrEncryptObjectVisitor visitor(this, reference, PDFDecryptOrEncryptObjectVisitor::Mode::Encrypt);
@@ -859,57 +910,259 @@ std::vector<uint8_t> PDFStandardOrPublicSecurityHandler::createAESV2_ObjectEncry
     return objectEncryptionKey;
 }
 
-QByteArray PDFStandardOrPublicSecurityHandler::decryptUsingFilter(const QByteArray& data, CryptFilter filter, PDFObjectReference reference) const
+/// Returns AES cipher in CBC mode for given key length in bytes, or nullptr,
+/// if key length is invalid.
+/// \param keyLength Key length in bytes
+static const EVP_CIPHER* getAES_CBC_Cipher(int keyLength)
 {
-    QByteArray decryptedData;
+    switch (keyLength)
+    {
+        case 16:
+            return EVP_aes_128_cbc();
+        case 24:
+            return EVP_aes_192_cbc();
+        case 32:
+            return EVP_aes_256_cbc();
+        default:
+            break;
+    }
 
-    Q_ASSERT(m_authorizationData.isAuthorized());
+    return nullptr;
+}
 
-    struct AES_data
+/// Decrypts blocks of data using AES in CBC mode. EVP interface of the OpenSSL is used,
+/// so hardware acceleration of AES (for example, AES-NI instructions) is used, if it
+/// is available. Cipher context is kept for each thread and reused, so if many objects
+/// are decrypted using the same key (as in AESV3), key schedule is computed only once.
+/// \param key Key
+/// \param keyLength Key length in bytes (16 or 32)
+/// \param initializationVector Initialization vector (AES_BLOCK_SIZE bytes)
+/// \param data Encrypted data
+/// \param size Size of the data (multiple of AES_BLOCK_SIZE)
+/// \param decryptedData Output buffer for decrypted data (size bytes)
+static void decryptAES_CBC(const uint8_t* key, int keyLength, const uint8_t* initializationVector, const uint8_t* data, int size, uint8_t* decryptedData)
+{
+    Q_ASSERT(keyLength <= 32);
+    Q_ASSERT(size % AES_BLOCK_SIZE == 0);
+
+    struct CipherContext
     {
-        QByteArray initializationVector;
-        QByteArray paddedData;
+        CipherContext() : context(EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free) { }
+
+        openssl_ptr<EVP_CIPHER_CTX> context;
+        std::array<uint8_t, 32> key = { };
+        int keyLength = 0;
     };
 
-    auto prepareAES_data = [](const QByteArray& data)
-    {
-        AES_data result;
+    thread_local CipherContext cipherContext;
 
-        result.initializationVector = data.left(AES_BLOCK_SIZE);
+    bool decrypted = false;
+    if (EVP_CIPHER_CTX* context = cipherContext.context.get())
+    {
+        const bool isSameKey = cipherContext.keyLength == keyLength && std::equal(key, key + keyLength, cipherContext.key.cbegin());
 
-        // This is an error. But to handle it, we resize the vector
-        // with arbitrary data.
-        if (result.initializationVector.size() < AES_BLOCK_SIZE)
+        int initialized = 0;
+        if (isSameKey)
         {
-            result.initializationVector.resize(AES_BLOCK_SIZE);
+            // Reuse key schedule, set only the initialization vector
+            initialized = EVP_DecryptInit_ex(context, nullptr, nullptr, nullptr, initializationVector);
+        }
+        else
+        {
+            const EVP_CIPHER* cipher = getAES_CBC_Cipher(keyLength);
+
+            cipherContext.keyLength = 0;
+            if (cipher)
+            {
+                initialized = EVP_DecryptInit_ex(context, cipher, nullptr, key, initializationVector);
+
+                if (initialized)
+                {
+                    std::copy(key, key + keyLength, cipherContext.key.begin());
+                    cipherContext.keyLength = keyLength;
+                }
+            }
         }
 
-        result.paddedData = data.mid(AES_BLOCK_SIZE);
+        int decryptedSize = 0;
+        int finalSize = 0;
+        decrypted = initialized &&
+                    EVP_CIPHER_CTX_set_padding(context, 0) &&
+                    EVP_DecryptUpdate(context, decryptedData, &decryptedSize, data, size) &&
+                    EVP_DecryptFinal_ex(context, decryptedData + decryptedSize, &finalSize) &&
+                    decryptedSize + finalSize == size;
 
-        // Remove errorneous data - we must have a data of multiple of AES_BLOCK_SIZE
-        const int remainder = result.paddedData.size() % AES_BLOCK_SIZE;
-        if (remainder != 0)
+        if (!decrypted)
         {
-            result.paddedData = result.paddedData.left(result.paddedData.size() - remainder);
+            cipherContext.keyLength = 0;
         }
+    }
 
-        return result;
+    if (!decrypted)
+    {
+        // Fallback to the low level interface
+        AES_KEY aesKey = { };
+        AES_set_decrypt_key(key, keyLength * 8, &aesKey);
+
+        std::array<uint8_t, AES_BLOCK_SIZE> vector = { };
+        std::copy(initializationVector, initializationVector + AES_BLOCK_SIZE, vector.begin());
+        AES_cbc_encrypt(data, decryptedData, size, &aesKey, vector.data(), AES_DECRYPT);
+    }
+}
+
+/// Encrypts data using AES in CBC mode. Data are padded according to the specification
+/// (padding bytes have value of the padding length, which is 1 to AES_BLOCK_SIZE),
+/// and encrypted data are prefixed by random initialization vector. As in decryption,
+/// EVP interface with hardware acceleration is used, and cipher context is kept
+/// for each thread, so objects can be encrypted in parallel.
+/// \param key Key
+/// \param keyLength Key length in bytes (16 or 32)
+/// \param data Data to be encrypted
+static QByteArray encryptAES_CBC(const uint8_t* key, int keyLength, const QByteArray& data)
+{
+    Q_ASSERT(keyLength <= 32);
+
+    const int paddingLength = AES_BLOCK_SIZE - (data.size() % AES_BLOCK_SIZE);
+    const int encryptedSize = int(data.size()) + paddingLength;
+
+    QByteArray encryptedData(AES_BLOCK_SIZE + encryptedSize, Qt::Uninitialized);
+    uint8_t* initializationVector = convertByteArrayToUcharPtr(encryptedData);
+    uint8_t* encryptedBlocks = initializationVector + AES_BLOCK_SIZE;
+
+    std::array<quint32, AES_BLOCK_SIZE / sizeof(quint32)> randomData = { };
+    QRandomGenerator::system()->fillRange(randomData.data(), randomData.size());
+    std::memcpy(initializationVector, randomData.data(), AES_BLOCK_SIZE);
+
+    struct CipherContext
+    {
+        CipherContext() : context(EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free) { }
+
+        openssl_ptr<EVP_CIPHER_CTX> context;
+        std::array<uint8_t, 32> key = { };
+        int keyLength = 0;
     };
 
-    auto removeAES_padding = [](const QByteArray& data)
+    thread_local CipherContext cipherContext;
+
+    bool encrypted = false;
+    if (EVP_CIPHER_CTX* context = cipherContext.context.get())
     {
-        if (data.isEmpty())
+        const bool isSameKey = cipherContext.keyLength == keyLength && std::equal(key, key + keyLength, cipherContext.key.cbegin());
+
+        int initialized = 0;
+        if (isSameKey)
         {
-            return data;
+            // Reuse key schedule, set only the initialization vector
+            initialized = EVP_EncryptInit_ex(context, nullptr, nullptr, nullptr, initializationVector);
         }
+        else
+        {
+            const EVP_CIPHER* cipher = getAES_CBC_Cipher(keyLength);
 
-        // If padding doesnt fit from 1 to AES_BLOCK_SIZE, then it is
-        // an error, but just clamp the value.
-        const int padding = data.back();
-        const int clampedPadding = qBound(1, padding, AES_BLOCK_SIZE);
+            cipherContext.keyLength = 0;
+            if (cipher)
+            {
+                initialized = EVP_EncryptInit_ex(context, cipher, nullptr, key, initializationVector);
 
-        return data.left(data.size() - clampedPadding);
-    };
+                if (initialized)
+                {
+                    std::copy(key, key + keyLength, cipherContext.key.begin());
+                    cipherContext.keyLength = keyLength;
+                }
+            }
+        }
+
+        // Padding of the EVP interface (PKCS#7) is the same as padding required by the specification
+        int updateSize = 0;
+        int finalSize = 0;
+        encrypted = initialized &&
+                    EVP_CIPHER_CTX_set_padding(context, 1) &&
+                    EVP_EncryptUpdate(context, encryptedBlocks, &updateSize, reinterpret_cast<const uint8_t*>(data.constData()), int(data.size())) &&
+                    EVP_EncryptFinal_ex(context, encryptedBlocks + updateSize, &finalSize) &&
+                    updateSize + finalSize == encryptedSize;
+
+        if (!encrypted)
+        {
+            cipherContext.keyLength = 0;
+        }
+    }
+
+    if (!encrypted)
+    {
+        // Fallback to the low level interface
+        QByteArray paddedData = data;
+        paddedData.append(paddingLength, char(paddingLength));
+
+        AES_KEY aesKey = { };
+        AES_set_encrypt_key(key, keyLength * 8, &aesKey);
+
+        std::array<uint8_t, AES_BLOCK_SIZE> vector = { };
+        std::copy(initializationVector, initializationVector + AES_BLOCK_SIZE, vector.begin());
+        AES_cbc_encrypt(convertByteArrayToUcharPtr(paddedData), encryptedBlocks, encryptedSize, &aesKey, vector.data(), AES_ENCRYPT);
+    }
+
+    return encryptedData;
+}
+
+/// Returns size of AES encrypted data, which are multiple of AES_BLOCK_SIZE.
+/// First AES_BLOCK_SIZE bytes of the data are initialization vector and
+/// are not counted.
+static int getAES_PaddedDataSize(const QByteArray& data)
+{
+    // Remove errorneous data - we must have a data of multiple of AES_BLOCK_SIZE
+    const int size = static_cast<int>(data.size()) - AES_BLOCK_SIZE;
+    return (size > 0) ? size - size % AES_BLOCK_SIZE : 0;
+}
+
+/// Returns padding size from the last decrypted byte. If padding
+/// doesn't fit from 1 to AES_BLOCK_SIZE, then it is an error, but
+/// just clamp the value.
+static int getAES_PaddingSize(char lastByte)
+{
+    const int padding = lastByte;
+    return qBound(1, padding, AES_BLOCK_SIZE);
+}
+
+/// Decrypts data encrypted by AES in CBC mode, where initialization
+/// vector is stored in the first AES_BLOCK_SIZE bytes, and removes the padding.
+static QByteArray decryptAES(const QByteArray& data, const uint8_t* key, int keyLength)
+{
+    QByteArray decryptedData;
+
+    const int paddedDataSize = getAES_PaddedDataSize(data);
+    if (paddedDataSize > 0)
+    {
+        const uint8_t* encryptedData = convertByteArrayToUcharPtr(data);
+        decryptedData.resize(paddedDataSize);
+        decryptAES_CBC(key, keyLength, encryptedData, encryptedData + AES_BLOCK_SIZE, paddedDataSize, convertByteArrayToUcharPtr(decryptedData));
+        decryptedData.chop(getAES_PaddingSize(decryptedData.back()));
+    }
+
+    return decryptedData;
+}
+
+/// Returns size of data encrypted by AES in CBC mode, after decryption.
+/// Only last block is decrypted, to determine size of the padding.
+static int getAES_DecryptedSize(const QByteArray& data, const uint8_t* key, int keyLength)
+{
+    const int paddedDataSize = getAES_PaddedDataSize(data);
+    if (paddedDataSize > 0)
+    {
+        // Previous block (or initialization vector) serves as initialization vector of the last block
+        const uint8_t* lastBlock = convertByteArrayToUcharPtr(data) + paddedDataSize;
+        std::array<uint8_t, AES_BLOCK_SIZE> decryptedLastBlock = { };
+        decryptAES_CBC(key, keyLength, lastBlock - AES_BLOCK_SIZE, lastBlock, AES_BLOCK_SIZE, decryptedLastBlock.data());
+        return paddedDataSize - getAES_PaddingSize(static_cast<char>(decryptedLastBlock.back()));
+    }
+
+    return 0;
+}
+
+QByteArray PDFStandardOrPublicSecurityHandler::decryptUsingFilter(const QByteArray& data, CryptFilter filter, PDFObjectReference reference) const
+{
+    QByteArray decryptedData;
+
+    Q_ASSERT(m_authorizationData.isAuthorized());
 
     switch (filter.type)
     {
@@ -935,38 +1188,16 @@ QByteArray PDFStandardOrPublicSecurityHandler::decryptUsingFilter(const QByteArr
 
         case CryptFilterType::AESV2:      // Use file encryption key for AES algorithm
         {
-            std::vector<uint8_t> objectEncryptionKey = createAESV2_ObjectEncryptionKey(reference);
-
             // For AES algorithm, always use 16 bytes key (128 bit encryption mode)
-
-            AES_KEY key = { };
-            AES_set_decrypt_key(objectEncryptionKey.data(), static_cast<int>(objectEncryptionKey.size()) * 8, &key);
-
-            AES_data aes_data = prepareAES_data(data);
-            if (!aes_data.paddedData.isEmpty())
-            {
-                decryptedData.resize(aes_data.paddedData.size());
-                AES_cbc_encrypt(convertByteArrayToUcharPtr(aes_data.paddedData), convertByteArrayToUcharPtr(decryptedData), aes_data.paddedData.length(), &key, convertByteArrayToUcharPtr(aes_data.initializationVector), AES_DECRYPT);
-                decryptedData = removeAES_padding(decryptedData);
-            }
-
+            std::vector<uint8_t> objectEncryptionKey = createAESV2_ObjectEncryptionKey(reference);
+            decryptedData = decryptAES(data, objectEncryptionKey.data(), static_cast<int>(objectEncryptionKey.size()));
             break;
         }
 
         case CryptFilterType::AESV3:      // Use file encryption key for AES 256 bit algorithm
         {
             Q_ASSERT(m_authorizationData.fileEncryptionKey.size() == 32);
-            AES_KEY key = { };
-            AES_set_decrypt_key(convertByteArrayToUcharPtr(m_authorizationData.fileEncryptionKey), static_cast<int>(m_authorizationData.fileEncryptionKey.size()) * 8, &key);
-
-            AES_data aes_data = prepareAES_data(data);
-            if (!aes_data.paddedData.isEmpty())
-            {
-                decryptedData.resize(aes_data.paddedData.size());
-                AES_cbc_encrypt(convertByteArrayToUcharPtr(aes_data.paddedData), convertByteArrayToUcharPtr(decryptedData), aes_data.paddedData.length(), &key, convertByteArrayToUcharPtr(aes_data.initializationVector), AES_DECRYPT);
-                decryptedData = removeAES_padding(decryptedData);
-            }
-
+            decryptedData = decryptAES(data, convertByteArrayToUcharPtr(m_authorizationData.fileEncryptionKey), static_cast<int>(m_authorizationData.fileEncryptionKey.size()));
             break;
         }
 
@@ -980,44 +1211,37 @@ QByteArray PDFStandardOrPublicSecurityHandler::decryptUsingFilter(const QByteArr
     return decryptedData;
 }
 
-QByteArray PDFStandardOrPublicSecurityHandler::encryptUsingFilter(const QByteArray& data, CryptFilter filter, PDFObjectReference reference) const
+PDFInteger PDFStandardOrPublicSecurityHandler::getDecryptedSize(const QByteArray& data, PDFObjectReference reference, EncryptionScope encryptionScope) const
 {
-    QByteArray encryptedData;
-
-    Q_ASSERT(m_authorizationData.isAuthorized());
-
-    struct AES_data
-    {
-        QByteArray initializationVector;
-        QByteArray paddedData;
-    };
+    CryptFilter filter = getCryptFilter(encryptionScope);
 
-    auto prepareAES_data = [](const QByteArray& data)
+    switch (filter.type)
     {
-        AES_data result;
+        case CryptFilterType::V2:
+        case CryptFilterType::Identity:
+            return data.size();
 
-        QRandomGenerator randomNumberGenerator = QRandomGenerator::securelySeeded();
-
-        result.initializationVector.resize(AES_BLOCK_SIZE);
-        for (int i = 0; i < AES_BLOCK_SIZE; ++i)
+        case CryptFilterType::AESV2:
         {
-            result.initializationVector[i] = uint8_t(randomNumberGenerator.generate());
+            std::vector<uint8_t> objectEncryptionKey = createAESV2_ObjectEncryptionKey(reference);
+            return getAES_DecryptedSize(data, objectEncryptionKey.data(), static_cast<int>(objectEncryptionKey.size()));
         }
 
-        result.paddedData = data;
+        case CryptFilterType::AESV3:
+            return getAES_DecryptedSize(data, convertByteArrayToUcharPtr(m_authorizationData.fileEncryptionKey), static_cast<int>(m_authorizationData.fileEncryptionKey.size()));
 
-        // Add padding remainder according to the specification
-        int size = data.size();
-        const int paddingRemainder = AES_BLOCK_SIZE - (size % AES_BLOCK_SIZE);
+        default:
+            break;
+    }
 
-        result.initializationVector.reserve(result.initializationVector.size() + paddingRemainder);
-        for (int i = 0; i < paddingRemainder; ++i)
-        {
-            result.paddedData.push_back(paddingRemainder);
-        }
+    return decryptUsingFilter(data, filter, reference).size();
+}
 
-        return result;
-    };
+QByteArray PDFStandardOrPublicSecurityHandler::encryptUsingFilter(const QByteArray& data, CryptFilter filter, PDFObjectReference reference) const
+{
+    QByteArray encryptedData;
+
+    Q_ASSERT(m_authorizationData.isAuthorized());
 
     switch (filter.type)
     {
@@ -1047,37 +1271,14 @@ QByteArray PDFStandardOrPublicSecurityHandler::encryptUsingFilter(const QByteArr
             std::vector<uint8_t> objectEncryptionKey = createAESV2_ObjectEncryptionKey(reference);
 
             // For AES algorithm, always use 16 bytes key (128 bit encryption mode)
-
-            AES_KEY key = { };
-            AES_set_encrypt_key(objectEncryptionKey.data(), static_cast<int>(objectEncryptionKey.size()) * 8, &key);
-
-            AES_data aes_data = prepareAES_data(data);
-            if (!aes_data.paddedData.isEmpty())
-            {
-                QByteArray initializationVectorCopy = aes_data.initializationVector;
-                encryptedData.resize(aes_data.paddedData.size());
-                AES_cbc_encrypt(convertByteArrayToUcharPtr(aes_data.paddedData), convertByteArrayToUcharPtr(encryptedData), aes_data.paddedData.length(), &key, convertByteArrayToUcharPtr(aes_data.initializationVector), AES_ENCRYPT);
-                encryptedData.prepend(initializationVectorCopy);
-            }
-
+            encryptedData = encryptAES_CBC(objectEncryptionKey.data(), static_cast<int>(objectEncryptionKey.size()), data);
             break;
         }
 
         case CryptFilterType::AESV3:      // Use file encryption key for AES 256 bit algorithm
         {
             Q_ASSERT(m_authorizationData.fileEncryptionKey.size() == 32);
-            AES_KEY key = { };
-            AES_set_encrypt_key(convertByteArrayToUcharPtr(m_authorizationData.fileEncryptionKey), static_cast<int>(m_authorizationData.fileEncryptionKey.size()) * 8, &key);
-
-            AES_data aes_data = prepareAES_data(data);
-            if (!aes_data.paddedData.isEmpty())
-            {
-                QByteArray initializationVectorCopy = aes_data.initializationVector;
-                encryptedData.resize(aes_data.paddedData.size());
-                AES_cbc_encrypt(convertByteArrayToUcharPtr(aes_data.paddedData), convertByteArrayToUcharPtr(encryptedData), aes_data.paddedData.length(), &key, convertByteArrayToUcharPtr(aes_data.initializationVector), AES_ENCRYPT);
-                encryptedData.prepend(initializationVectorCopy);
-            }
-
+            encryptedData = encryptAES_CBC(convertByteArrayToUcharPtr(m_authorizationData.fileEncryptionKey), static_cast<int>(m_authorizationData.fileEncryptionKey.size()), data);
             break;
         }
 
@@ -147,6 +147,22 @@ public:
     /// \returns Decrypted object
     PDFObject decryptObject(const PDFObject& object, PDFObjectReference reference) const;
 
+    /// Decrypts the PDF object, but contents of streams are not decrypted. Streams
+    /// keep their encrypted contents, which are decrypted lazily by \p streamDecryptor,
+    /// when they are accessed, or decoded by stream filters. Strings and dictionaries
+    /// are decrypted immediately.
+    /// \param object Object to be decrypted
+    /// \param reference Reference of indirect object (some algorithms require to generate key also from reference)
+    /// \param streamDecryptor Decryptor of stream contents (if it is nullptr, streams are decrypted immediately)
+    /// \returns Decrypted object
+    PDFObject decryptObject(const PDFObject& object, PDFObjectReference reference, PDFStreamDecryptorPointer streamDecryptor) const;
+
+    /// Creates decryptor of stream contents using given security handler. Security
+    /// handler is shared by the decryptor, so it must not be modified afterwards.
+    /// If document is not encrypted, nullptr is returned.
+    /// \param securityHandler Authorized security handler
+    static PDFStreamDecryptorPointer createStreamDecryptor(PDFSecurityHandlerPointer securityHandler);
+
     /// Encrypts the PDF object. This function works properly only (and only if)
     /// \p authenticate function returns user/owner authorization code.
     /// \param object Object to be encrypted
@@ -162,6 +178,13 @@ public:
     /// \returns Decrypted object data
     virtual QByteArray decrypt(const QByteArray& data, PDFObjectReference reference, EncryptionScope encryptionScope) const = 0;
 
+    /// Returns size of the decrypted data. Implementation should determine the size
+    /// without decryption of all data, if it is possible.
+    /// \param data Data to be decrypted
+    /// \param reference Reference of indirect object (some algorithms require to generate key also from reference)
+    /// \param encryptionScope Scope of the encryption (if it is string/stream/...)
+    virtual PDFInteger getDecryptedSize(const QByteArray& data, PDFObjectReference reference, EncryptionScope encryptionScope) const { return decrypt(data, reference, encryptionScope).size(); }
+
     /// Decrypts data using specified filter. Throws exception, if filter is not found.
     /// \param data Data to be decrypted
     /// \param filterName Filter name to be used to decrypt the data
@@ -276,6 +299,7 @@ class PDFStandardOrPublicSecurityHandler : public PDFSecurityHandler
 {
 public:
     virtual QByteArray decrypt(const QByteArray& data, PDFObjectReference reference, EncryptionScope encryptionScope) const override;
+    virtual PDFInteger getDecryptedSize(const QByteArray& data, PDFObjectReference reference, EncryptionScope encryptionScope) const override;
     virtual QByteArray decryptByFilter(const QByteArray& data, const QByteArray& filterName, PDFObjectReference reference) const override;
     virtual QByteArray encrypt(const QByteArray& data, PDFObjectReference reference, EncryptionScope encryptionScope) const override;
     virtual QByteArray encryptByFilter(const QByteArray& data, const QByteArray& filterName, PDFObjectReference reference) const override;
@@ -25,6 +25,8 @@
 #include "pdfencoding.h"
 #include "pdfform.h"
 #include "pdfutils.h"
+#include "pdfexception.h"
+#include "pdfexecutionpolicy.h"
 #include "pdfsignaturehandler_impl.h"
 
 #if defined(PDF4QT_COMPILER_MINGW) || defined(PDF4QT_COMPILER_GCC)
@@ -46,6 +48,8 @@
 
 #include <QDir>
 #include <QMutex>
+#include <QDateTime>
+#include <QCryptographicHash>
 #include <QFileInfo>
 #include <QLockFile>
 #include <QDataStream>
@@ -55,6 +59,8 @@
 #include "pdfdbgheap.h"
 
 #include <array>
+#include <optional>
+#include <algorithm>
 #ifdef Q_OS_UNIX
 #include <time.h>
 #endif
@@ -159,33 +165,40 @@ PDFSignature PDFSignature::parse(const PDFObjectStorage* storage, PDFObject obje
     return result;
 }
 
-PDFSignatureHandler* PDFSignatureHandler::createHandler(const PDFFormFieldSignature* signatureField, const QByteArray& sourceData, const Parameters& parameters)
+PDFSignatureHandler* PDFSignatureHandler::createHandler(const PDFFormFieldSignature* signatureField, const QByteArray& sourceData, const Parameters& parameters, PDFSignatureDigestCache* digestCache)
 {
     Q_ASSERT(signatureField);
 
+    PDFPublicKeySignatureHandler* handler = nullptr;
+
     const QByteArray& subfilter = signatureField->getSignature().getSubfilter();
     if (subfilter == "adbe.pkcs7.detached")
     {
-        return new PDFSignatureHandler_adbe_pkcs7_detached(signatureField, sourceData, parameters);
+        handler = new PDFSignatureHandler_adbe_pkcs7_detached(signatureField, sourceData, parameters);
     }
     else if (subfilter == "adbe.pkcs7.sha1")
     {
-        return new PDFSignatureHandler_adbe_pkcs7_sha1(signatureField, sourceData, parameters);
+        handler = new PDFSignatureHandler_adbe_pkcs7_sha1(signatureField, sourceData, parameters);
     }
     else if (subfilter == "adbe.x509.rsa_sha1")
     {
-        return new PDFSignatureHandler_adbe_pkcs7_rsa_sha1(signatureField, sourceData, parameters);
+        handler = new PDFSignatureHandler_adbe_pkcs7_rsa_sha1(signatureField, sourceData, parameters);
     }
     else if (subfilter == "ETSI.CAdES.detached")
     {
-        return new PDFSignatureHandler_ETSI_CAdES_detached(signatureField, sourceData, parameters);
+        handler = new PDFSignatureHandler_ETSI_CAdES_detached(signatureField, sourceData, parameters);
     }
     else if (subfilter == "ETSI.RFC3161")
     {
-        return new PDFSignatureHandler_ETSI_RFC3161(signatureField, sourceData, parameters);
+        handler = new PDFSignatureHandler_ETSI_RFC3161(signatureField, sourceData, parameters);
     }
 
-    return nullptr;
+    if (handler)
+    {
+        handler->setDigestCache(digestCache);
+    }
+
+    return handler;
 }
 
 std::vector<PDFSignatureVerificationResult> PDFSignatureHandler::verifySignatures(const PDFForm& form, const QByteArray& sourceData, const Parameters& parameters)
@@ -205,23 +218,61 @@ std::vector<PDFSignatureVerificationResult> PDFSignatureHandler::verifySignature
             }
         };
         form.apply(getSignatureFields);
-        result.reserve(signatureFields.size());
 
+        // Signatures of incrementally updated document share data of earlier
+        // revisions, which are covered by first byte ranges of the signatures.
+        std::vector<PDFInteger> prefixSizes;
         for (const PDFFormFieldSignature* signatureField : signatureFields)
         {
-            if (const PDFSignatureHandler* signatureHandler = createHandler(signatureField, sourceData, parameters))
+            const PDFSignature::ByteRanges& byteRanges = signatureField->getSignature().getByteRanges();
+            if (!byteRanges.empty() && byteRanges.front().offset == 0 && byteRanges.front().size > 0)
             {
-                result.emplace_back(signatureHandler->verify());
-                delete signatureHandler;
+                prefixSizes.push_back(byteRanges.front().size);
             }
-            else
+        }
+        PDFSignatureDigestCache digestCache(sourceData, qMove(prefixSizes));
+
+        result.resize(signatureFields.size());
+
+        QMutex exceptionMutex;
+        std::optional<PDFException> exception;
+
+        auto verifySignature = [&](size_t index)
+        {
+            const PDFFormFieldSignature* signatureField = signatureFields[index];
+
+            try
+            {
+                if (const PDFSignatureHandler* signatureHandler = createHandler(signatureField, sourceData, parameters, &digestCache))
+                {
+                    result[index] = signatureHandler->verify();
+                    delete signatureHandler;
+                }
+                else
+                {
+                    PDFObjectReference signatureFieldReference = signatureField->getSelfReference();
+                    QString qualifiedName = signatureField->getName(PDFFormField::NameType::FullyQualified);
+                    PDFSignatureVerificationResult verificationResult(signatureField->getSignature().getType(), signatureFieldReference, qMove(qualifiedName));
+                    verificationResult.addNoHandlerError(signatureField->getSignature().getSubfilter());
+                    result[index] = qMove(verificationResult);
+                }
+            }
+            catch (const PDFException& e)
             {
-                PDFObjectReference signatureFieldReference = signatureField->getSelfReference();
-                QString qualifiedName = signatureField->getName(PDFFormField::NameType::FullyQualified);
-                PDFSignatureVerificationResult verificationResult(signatureField->getSignature().getType(), signatureFieldReference, qMove(qualifiedName));
-                verificationResult.addNoHandlerError(signatureField->getSignature().getSubfilter());
-                result.emplace_back(qMove(verificationResult));
+                QMutexLocker lock(&exceptionMutex);
+                if (!exception)
+                {
+                    exception = e;
+                }
             }
+        };
+
+        PDFIntegerRange<size_t> indices(0, signatureFields.size());
+        PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, indices.begin(), indices.end(), verifySignature);
+
+        if (exception)
+        {
+            throw *exception;
         }
     }
 
@@ -524,8 +575,6 @@ STACK_OF(X509)* PDFPublicKeySignatureHandler::getCertificates(PKCS7* pkcs7)
 
 void PDFPublicKeySignatureHandler::verifyCertificate(PDFSignatureVerificationResult& result) const
 {
-    PDFOpenSSLGlobalLock lock;
-
     OpenSSL_add_all_algorithms();
 
     const PDFSignature& signature = m_signatureField->getSignature();
@@ -536,7 +585,7 @@ void PDFPublicKeySignatureHandler::verifyCertificate(PDFSignatureVerificationRes
     const unsigned char* data = convertByteArrayToUcharPtr(content);
     if (PKCS7* pkcs7 = d2i_PKCS7(nullptr, &data, content.size()))
     {
-        X509_STORE* store = X509_STORE_new();
+        X509_STORE* store = getTrustedCertificateStore();
         X509_STORE_CTX* context = X509_STORE_CTX_new();
 
         // Above functions can fail only if not enough memory. But in this
@@ -544,8 +593,6 @@ void PDFPublicKeySignatureHandler::verifyCertificate(PDFSignatureVerificationRes
         Q_ASSERT(store);
         Q_ASSERT(context);
 
-        addTrustedCertificates(store);
-
         STACK_OF(PKCS7_SIGNER_INFO)* signerInfo = PKCS7_get_signer_info(pkcs7);
         const int signerInfoCount = sk_PKCS7_SIGNER_INFO_num(signerInfo);
         STACK_OF(X509)* certificates = getCertificates(pkcs7);
@@ -740,10 +787,143 @@ BIO* PDFPublicKeySignatureHandler::getSignedDataBuffer(pdf::PDFSignatureVerifica
     return BIO_new_mem_buf(outputBuffer.data(), outputBuffer.length());
 }
 
-void PDFPublicKeySignatureHandler::verifySignature(PDFSignatureVerificationResult& result) const
+PDFSignatureDigestCache::PDFSignatureDigestCache(const QByteArray& sourceData, std::vector<PDFInteger> prefixSizes) :
+    m_sourceData(sourceData),
+    m_prefixSizes(qMove(prefixSizes))
+{
+    std::sort(m_prefixSizes.begin(), m_prefixSizes.end());
+    m_prefixSizes.erase(std::unique(m_prefixSizes.begin(), m_prefixSizes.end()), m_prefixSizes.end());
+}
+
+PDFSignatureDigestCache::~PDFSignatureDigestCache()
+{
+    for (DigestState& state : m_states)
+    {
+        EVP_MD_CTX_free(state.context);
+    }
+}
+
+bool PDFSignatureDigestCache::hasPrefix(PDFInteger prefixSize) const
+{
+    return std::binary_search(m_prefixSizes.cbegin(), m_prefixSizes.cend(), prefixSize);
+}
+
+bool PDFSignatureDigestCache::initializeDigest(EVP_MD_CTX* context, PDFInteger prefixSize)
+{
+    const EVP_MD* digest = EVP_MD_CTX_md(context);
+    if (!digest || !hasPrefix(prefixSize) || prefixSize > m_sourceData.size())
+    {
+        return false;
+    }
+
+    const int digestType = EVP_MD_type(digest);
+
+    QMutexLocker lock(&m_mutex);
+
+    auto findState = [this, digestType](PDFInteger size) -> const DigestState*
+    {
+        auto it = std::find_if(m_states.cbegin(), m_states.cend(), [digestType, size](const DigestState& state) { return state.digestType == digestType && state.prefixSize == size; });
+        return it != m_states.cend() ? &*it : nullptr;
+    };
+
+    if (!findState(prefixSize))
+    {
+        // Digest all prefixes up to the requested one, each one continues
+        // from the previous one, so data are digested only once.
+        EVP_MD_CTX* currentContext = EVP_MD_CTX_new();
+        if (!currentContext || !EVP_DigestInit_ex(currentContext, digest, nullptr))
+        {
+            EVP_MD_CTX_free(currentContext);
+            return false;
+        }
+
+        PDFInteger currentSize = 0;
+        for (PDFInteger size : m_prefixSizes)
+        {
+            if (size > prefixSize || size > m_sourceData.size())
+            {
+                break;
+            }
+
+            if (const DigestState* state = findState(size))
+            {
+                if (!EVP_MD_CTX_copy_ex(currentContext, state->context))
+                {
+                    EVP_MD_CTX_free(currentContext);
+                    return false;
+                }
+
+                currentSize = size;
+                continue;
+            }
+
+            DigestState state;
+            state.digestType = digestType;
+            state.prefixSize = size;
+            state.context = EVP_MD_CTX_new();
+
+            if (!state.context ||
+                !EVP_DigestUpdate(currentContext, m_sourceData.constData() + currentSize, size_t(size - currentSize)) ||
+                !EVP_MD_CTX_copy_ex(state.context, currentContext))
+            {
+                EVP_MD_CTX_free(state.context);
+                EVP_MD_CTX_free(currentContext);
+                return false;
+            }
+
+            m_states.push_back(state);
+            currentSize = size;
+        }
+
+        EVP_MD_CTX_free(currentContext);
+    }
+
+    const DigestState* state = findState(prefixSize);
+    return state && EVP_MD_CTX_copy_ex(context, state->context);
+}
+
+PDFInteger PDFPublicKeySignatureHandler::getCachedPrefixSize() const
+{
+    if (!m_digestCache || !isSignedDataBufferRaw())
+    {
+        return 0;
+    }
+
+    // Signed data starts with first byte range, if it starts at the beginning of the file
+    const PDFSignature::ByteRanges& byteRanges = m_signatureField->getSignature().getByteRanges();
+    if (byteRanges.empty() || byteRanges.front().offset != 0 || !m_digestCache->hasPrefix(byteRanges.front().size))
+    {
+        return 0;
+    }
+
+    return byteRanges.front().size;
+}
+
+bool PDFPublicKeySignatureHandler::initializeDigestsFromCache(BIO* dataBio, PDFInteger prefixSize) const
 {
-    PDFOpenSSLGlobalLock lock;
+    bool hasDigest = false;
+
+    for (BIO* bio = dataBio; bio; bio = BIO_next(bio))
+    {
+        if (BIO_method_type(bio) != BIO_TYPE_MD)
+        {
+            continue;
+        }
+
+        EVP_MD_CTX* context = nullptr;
+        if (BIO_get_md_ctx(bio, &context) <= 0 || !context || !m_digestCache->initializeDigest(context, prefixSize))
+        {
+            return false;
+        }
 
+        hasDigest = true;
+    }
+
+    return hasDigest;
+}
+
+void PDFPublicKeySignatureHandler::verifySignature(PDFSignatureVerificationResult& result) const
+{
     OpenSSL_add_all_algorithms();
 
     const PDFSignature& signature = m_signatureField->getSignature();
@@ -757,7 +937,23 @@ void PDFPublicKeySignatureHandler::verifySignature(PDFSignatureVerificationResul
         QByteArray buffer;
         if (BIO* inputBuffer = getSignedDataBuffer(result, buffer))
         {
-            if (BIO* dataBio = PKCS7_dataInit(pkcs7, inputBuffer))
+            // Digest of the prefix of signed data is taken from the cache,
+            // so only remaining data are read from the input buffer.
+            const PDFInteger prefixSize = getCachedPrefixSize();
+            if (prefixSize > 0)
+            {
+                BIO_free(inputBuffer);
+                inputBuffer = BIO_new_mem_buf(buffer.constData() + prefixSize, int(buffer.size() - prefixSize));
+            }
+
+            BIO* dataBio = PKCS7_dataInit(pkcs7, inputBuffer);
+            if (dataBio && prefixSize > 0 && !initializeDigestsFromCache(dataBio, prefixSize))
+            {
+                result.addSignatureDataOtherError();
+                BIO_free(dataBio);
+                dataBio = nullptr;
+            }
+            else if (dataBio)
             {
                 // Now, we must read from bio to calculate digests (digest is returned)
                 std::array<char, 16384> bioReadBuffer = { };
@@ -870,8 +1066,6 @@ PDFSignatureVerificationResult PDFSignatureHandler_ETSI_RFC3161::verify() const
 
 void PDFSignatureHandler_ETSI_RFC3161::verifySignatureTimestamp(PDFSignatureVerificationResult& result) const
 {
-    PDFOpenSSLGlobalLock lock;
-
     OpenSSL_add_all_algorithms();
 
     const PDFSignature& signature = m_signatureField->getSignature();
@@ -885,14 +1079,12 @@ void PDFSignatureHandler_ETSI_RFC3161::verifySignatureTimestamp(PDFSignatureVeri
         QByteArray buffer;
         if (BIO* inputBuffer = getSignedDataBuffer(result, buffer))
         {
-            X509_STORE* store = X509_STORE_new();
+            X509_STORE* store = getTrustedCertificateStore();
 
             // Above function can fail only if not enough memory. But in this
             // case, this library will crash anyway.
             Q_ASSERT(store);
 
-            addTrustedCertificates(store);
-
             // Add certificates from DSS store
             STACK_OF(X509)* certificatesFromPkcs7 = getCertificates(pkcs7);
             STACK_OF(X509)* usedCertificates = sk_X509_new_null();
@@ -977,8 +1169,9 @@ void PDFSignatureHandler_ETSI_RFC3161::verifySignatureTimestamp(PDFSignatureVeri
     }
 }
 
-// This is protected by global mutex, but it is ugly
-static PDFSignatureVerificationResult* s_ETSI_currentResult = nullptr;
+// Verification callback is called by OpenSSL in the thread, which is verifying
+// the certificate, so each thread has its own current result.
+static thread_local PDFSignatureVerificationResult* s_ETSI_currentResult = nullptr;
 
 int PDFSignatureHandler_ETSI_base::verifyCallback(int ok, X509_STORE_CTX* context)
 {
@@ -1055,8 +1248,6 @@ int PDFSignatureHandler_ETSI_base::verifyCallback(int ok, X509_STORE_CTX* contex
 
 void PDFSignatureHandler_ETSI_base::verifyCertificateCAdES(PDFSignatureVerificationResult& result, int purpose) const
 {
-    PDFOpenSSLGlobalLock lock;
-
     s_ETSI_currentResult = &result;
 
     OpenSSL_add_all_algorithms();
@@ -1069,7 +1260,7 @@ void PDFSignatureHandler_ETSI_base::verifyCertificateCAdES(PDFSignatureVerificat
     const unsigned char* data = convertByteArrayToUcharPtr(content);
     if (PKCS7* pkcs7 = d2i_PKCS7(nullptr, &data, content.size()))
     {
-        X509_STORE* store = X509_STORE_new();
+        X509_STORE* store = getTrustedCertificateStore();
         X509_STORE_CTX* context = X509_STORE_CTX_new();
 
         // Above functions can fail only if not enough memory. But in this
@@ -1077,8 +1268,6 @@ void PDFSignatureHandler_ETSI_base::verifyCertificateCAdES(PDFSignatureVerificat
         Q_ASSERT(store);
         Q_ASSERT(context);
 
-        addTrustedCertificates(store);
-
         STACK_OF(PKCS7_SIGNER_INFO)* signerInfo = PKCS7_get_signer_info(pkcs7);
         const int signerInfoCount = sk_PKCS7_SIGNER_INFO_num(signerInfo);
         STACK_OF(X509)* certificates = getCertificates(pkcs7);
@@ -1107,7 +1296,9 @@ void PDFSignatureHandler_ETSI_base::verifyCertificateCAdES(PDFSignatureVerificat
             }
             STACK_OF(X509)* usedCertificates = allCertificates ? allCertificates : certificates;
 
-            // Jakub Melka: add certificate revocation lists
+            // Jakub Melka: add certificate revocation lists. Store of trusted certificates
+            // is shared, so revocation lists are set to the verification context.
+            STACK_OF(X509_CRL)* crls = sk_X509_CRL_new_null();
             if (m_parameters.dss && !m_parameters.dss->getMasterItem()->CRL.empty())
             {
                 for (const QByteArray& crlData : m_parameters.dss->getMasterItem()->CRL)
@@ -1115,8 +1306,7 @@ void PDFSignatureHandler_ETSI_base::verifyCertificateCAdES(PDFSignatureVerificat
                     const unsigned char* crlDataBuffer = convertByteArrayToUcharPtr(crlData);
                     if (X509_CRL* crl = d2i_X509_CRL(nullptr, &crlDataBuffer, crlData.size()))
                     {
-                        X509_STORE_add_crl(store, crl);
-                        X509_CRL_free(crl);
+                        sk_X509_CRL_push(crls, crl);
                     }
                 }
             }
@@ -1139,6 +1329,8 @@ void PDFSignatureHandler_ETSI_base::verifyCertificateCAdES(PDFSignatureVerificat
                     break;
                 }
 
+                X509_STORE_CTX_set0_crls(context, crls);
+
                 if (!X509_STORE_CTX_set_purpose(context, purpose))
                 {
                     result.addCertificateGenericError();
@@ -1217,6 +1409,8 @@ void PDFSignatureHandler_ETSI_base::verifyCertificateCAdES(PDFSignatureVerificat
 
                 sk_X509_free(allCertificates);
             }
+
+            sk_X509_CRL_pop_free(crls, X509_CRL_free);
         }
         else
         {
@@ -1348,7 +1542,7 @@ void PDFSignatureHandler_adbe_pkcs7_rsa_sha1::verifyRSACertificate(PDFSignatureV
             }
         }
 
-        X509_STORE* store = X509_STORE_new();
+        X509_STORE* store = getTrustedCertificateStore();
         X509_STORE_CTX* context = X509_STORE_CTX_new();
 
         // Above functions can fail only if not enough memory. But in this
@@ -1356,8 +1550,6 @@ void PDFSignatureHandler_adbe_pkcs7_rsa_sha1::verifyRSACertificate(PDFSignatureV
         Q_ASSERT(store);
         Q_ASSERT(context);
 
-        addTrustedCertificates(store);
-
         X509* signer = certificate;
         if (!X509_STORE_CTX_init(context, store, signer, certificates))
         {
@@ -1685,6 +1877,76 @@ void PDFPublicKeySignatureHandler::addSignatureDateFromSignerInfoStack(STACK_OF(
 #endif
 #endif
 
+pdf::PDFTrustedCertificateStoreCache::~PDFTrustedCertificateStoreCache()
+{
+    for (const Entry& entry : m_entries)
+    {
+        X509_STORE_free(entry.store);
+    }
+}
+
+pdf::PDFTrustedCertificateStoreCache* pdf::PDFTrustedCertificateStoreCache::getInstance()
+{
+    static PDFTrustedCertificateStoreCache instance;
+    return &instance;
+}
+
+X509_STORE* pdf::PDFTrustedCertificateStoreCache::getStore(const QByteArray& key, const std::function<void (X509_STORE*)>& initializeStore)
+{
+    QMutexLocker lock(&m_mutex);
+
+    const qint64 currentTime = QDateTime::currentMSecsSinceEpoch();
+    auto isExpired = [currentTime](const Entry& entry) { return currentTime - entry.creationTime > TIMEOUT; };
+
+    for (const Entry& entry : m_entries)
+    {
+        if (entry.key == key && !isExpired(entry))
+        {
+            X509_STORE_up_ref(entry.store);
+            return entry.store;
+        }
+    }
+
+    // Remove expired stores and stores with the same key (they are expired too)
+    auto it = std::remove_if(m_entries.begin(), m_entries.end(), [&](const Entry& entry) { return entry.key == key || isExpired(entry); });
+    for (auto itRemoved = it; itRemoved != m_entries.end(); ++itRemoved)
+    {
+        X509_STORE_free(itRemoved->store);
+    }
+    m_entries.erase(it, m_entries.end());
+
+    if (m_entries.size() >= MAX_ENTRIES)
+    {
+        // Remove the oldest store
+        X509_STORE_free(m_entries.front().store);
+        m_entries.erase(m_entries.begin());
+    }
+
+    X509_STORE* store = X509_STORE_new();
+    Q_ASSERT(store);
+    initializeStore(store);
+    X509_STORE_up_ref(store);
+
+    m_entries.push_back(Entry{ key, store, currentTime });
+    return store;
+}
+
+X509_STORE* pdf::PDFPublicKeySignatureHandler::getTrustedCertificateStore() const
+{
+    // Key identifies set of the trusted certificates
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(m_parameters.useSystemCertificateStore ? QByteArray("1") : QByteArray("0"));
+    if (m_parameters.store)
+    {
+        for (const pdf::PDFCertificateEntry& entry : m_parameters.store->getCertificates())
+        {
+            hash.addData(entry.info.getCertificateData());
+        }
+    }
+
+    return pdf::PDFTrustedCertificateStoreCache::getInstance()->getStore(hash.result(), [this](X509_STORE* store) { addTrustedCertificates(store); });
+}
+
 void pdf::PDFPublicKeySignatureHandler::addTrustedCertificates(X509_STORE* store) const
 {
     if (m_parameters.store)
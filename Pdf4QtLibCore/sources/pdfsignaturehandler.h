@@ -315,6 +315,8 @@ private:
     PDFClosedIntervalSet m_bytesCoveredBySignature;
 };
 
+class PDFSignatureDigestCache;
+
 /// Signature handler. Can verify both certificate and signature validity.
 class PDF4QTLIBCORESHARED_EXPORT PDFSignatureHandler
 {
@@ -334,7 +336,9 @@ public:
     };
 
     /// Tries to verify all signatures in the form. If form is invalid, then
-    /// empty vector is returned.
+    /// empty vector is returned. Signatures are verified in parallel, digest
+    /// of the data shared by signatures (document revisions signed by earlier
+    /// signatures) is computed only once.
     /// \param form Form
     /// \param sourceData Source data
     /// \param parameters Verification settings
@@ -347,7 +351,8 @@ private:
     /// \param signatureField Signature field
     /// \param sourceData
     /// \param parameters Verification settings
-    static PDFSignatureHandler* createHandler(const PDFFormFieldSignature* signatureField, const QByteArray& sourceData, const Parameters& parameters);
+    /// \param digestCache Cache of digests of data shared by signatures (can be nullptr)
+    static PDFSignatureHandler* createHandler(const PDFFormFieldSignature* signatureField, const QByteArray& sourceData, const Parameters& parameters, PDFSignatureDigestCache* digestCache);
 };
 
 } // namespace pdf
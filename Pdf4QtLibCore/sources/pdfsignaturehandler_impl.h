@@ -25,6 +25,11 @@
 
 #include "pdfsignaturehandler.h"
 
+#include <QMutex>
+
+#include <functional>
+
+#include <openssl/evp.h>
 #include <openssl/x509.h>
 #include <openssl/x509v3.h>
 #include <openssl/pkcs7.h>
@@ -32,6 +37,85 @@
 namespace pdf
 {
 
+/// Cache of digests of source data prefixes. When document is signed multiple
+/// times (using incremental updates), first byte range of each later signature
+/// covers data of the earlier signatures, so digest of the shared prefix
+/// can be computed only once, and other signatures just continue from it.
+/// This class is thread safe.
+class PDFSignatureDigestCache
+{
+public:
+    /// Creates cache for given source data
+    /// \param sourceData Source data
+    /// \param prefixSizes Sizes of prefixes, which are used by signatures
+    explicit PDFSignatureDigestCache(const QByteArray& sourceData, std::vector<PDFInteger> prefixSizes);
+    ~PDFSignatureDigestCache();
+
+    PDFSignatureDigestCache(const PDFSignatureDigestCache&) = delete;
+    PDFSignatureDigestCache& operator=(const PDFSignatureDigestCache&) = delete;
+
+    /// Sets state of the digest context to the state after digesting
+    /// first \p prefixSize bytes of source data. Digest context must
+    /// be initialized with digest algorithm. Returns true on success.
+    /// \param context Digest context
+    /// \param prefixSize Size of the prefix, must be one of cache prefix sizes
+    bool initializeDigest(EVP_MD_CTX* context, PDFInteger prefixSize);
+
+    /// Returns true, if given prefix size is one of cache prefix sizes
+    bool hasPrefix(PDFInteger prefixSize) const;
+
+private:
+    struct DigestState
+    {
+        int digestType = NID_undef;
+        PDFInteger prefixSize = 0;
+        EVP_MD_CTX* context = nullptr;
+    };
+
+    QByteArray m_sourceData;
+    std::vector<PDFInteger> m_prefixSizes;
+    std::vector<DigestState> m_states;
+    QMutex m_mutex;
+};
+
+/// Process-wide cache of stores of trusted certificates. Building a store of trusted
+/// certificates (certificate store, system certificates, AATL list) is expensive,
+/// so one store is shared by all verified signatures (and documents). Stores
+/// are created again after timeout, so changes in system certificates are
+/// taken into account. This class is thread safe.
+class PDFTrustedCertificateStoreCache
+{
+public:
+    ~PDFTrustedCertificateStoreCache();
+
+    /// Returns cache instance
+    static PDFTrustedCertificateStoreCache* getInstance();
+
+    /// Returns store of trusted certificates with given key. If store doesn't
+    /// exist, or it has expired, then new store is created and initialized.
+    /// Store is shared, so it must not be modified, caller must release it
+    /// using X509_STORE_free.
+    /// \param key Key identifying set of trusted certificates
+    /// \param initializeStore Initialization function of the new store
+    X509_STORE* getStore(const QByteArray& key, const std::function<void(X509_STORE*)>& initializeStore);
+
+private:
+    explicit PDFTrustedCertificateStoreCache() = default;
+
+    static constexpr qint64 TIMEOUT = 10 * 60 * 1000;
+    static constexpr size_t MAX_ENTRIES = 4;
+
+    struct Entry
+    {
+        QByteArray key;
+        X509_STORE* store = nullptr;
+        qint64 creationTime = 0;
+    };
+
+    QMutex m_mutex;
+    std::vector<Entry> m_entries;
+};
+
 /// PKCS7 public key signature handler
 class PDFPublicKeySignatureHandler : public PDFSignatureHandler
 {
@@ -49,9 +133,29 @@ protected:
     void verifySignature(PDFSignatureVerificationResult& result) const;
     void addTrustedCertificates(X509_STORE* store) const;
 
+    /// Returns shared store of trusted certificates, which must not be
+    /// modified. Caller must release it using X509_STORE_free.
+    X509_STORE* getTrustedCertificateStore() const;
+
     virtual BIO* getSignedDataBuffer(PDFSignatureVerificationResult& result, QByteArray& outputBuffer) const;
 
+    /// Returns true, if signed data buffer contains signed data as they are,
+    /// so digests of prefix of signed data can be taken from the digest cache.
+    virtual bool isSignedDataBufferRaw() const { return true; }
+
+    /// Returns size of the prefix of signed data, for which digest
+    /// can be taken from the digest cache, or zero, if there is no such prefix.
+    PDFInteger getCachedPrefixSize() const;
+
+    /// Initializes all digest contexts in the chain of the data bio
+    /// to the state after digesting prefix of signed data.
+    /// \param dataBio Data bio created by PKCS7_dataInit
+    /// \param prefixSize Size of the prefix
+    bool initializeDigestsFromCache(BIO* dataBio, PDFInteger prefixSize) const;
+
 public:
+    void setDigestCache(PDFSignatureDigestCache* digestCache) { m_digestCache = digestCache; }
+
     /// Return a list of certificates from PKCS7 object
     static STACK_OF(X509)* getCertificates(PKCS7* pkcs7);
 
@@ -86,6 +190,7 @@ protected:
     const PDFFormFieldSignature* m_signatureField;
     QByteArray m_sourceData;
     Parameters m_parameters;
+    PDFSignatureDigestCache* m_digestCache = nullptr;
 };
 
 class PDFSignatureHandler_adbe_pkcs7_detached : public PDFPublicKeySignatureHandler
@@ -133,6 +238,7 @@ public:
 
 protected:
     virtual BIO* getSignedDataBuffer(PDFSignatureVerificationResult& result, QByteArray& outputBuffer) const override;
+    virtual bool isSignedDataBufferRaw() const override { return false; }
 };
 
 class PDFSignatureHandler_ETSI_base : public PDFPublicKeySignatureHandler
@@ -29,9 +29,135 @@
 
 #include "pdfdbgheap.h"
 
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <iterator>
+#include <unordered_map>
+
 namespace pdf
 {
 
+PDFSnapPointIndex::PDFSnapPointIndex(const std::vector<QPointF>& points) :
+    m_points(points)
+{
+    std::vector<quint32> indexedPoints;
+    indexedPoints.reserve(m_points.size());
+
+    PDFReal minX = std::numeric_limits<PDFReal>::infinity();
+    PDFReal minY = std::numeric_limits<PDFReal>::infinity();
+    PDFReal maxX = -std::numeric_limits<PDFReal>::infinity();
+    PDFReal maxY = -std::numeric_limits<PDFReal>::infinity();
+
+    for (size_t i = 0; i < m_points.size(); ++i)
+    {
+        const QPointF& point = m_points[i];
+        if (!std::isfinite(point.x()) || !std::isfinite(point.y()))
+        {
+            continue;
+        }
+
+        minX = qMin(minX, point.x());
+        minY = qMin(minY, point.y());
+        maxX = qMax(maxX, point.x());
+        maxY = qMax(maxY, point.y());
+        indexedPoints.push_back(quint32(i));
+    }
+
+    if (indexedPoints.empty())
+    {
+        return;
+    }
+
+    // Grid has approximately one cell per point, so cells
+    // contain only a few points on average.
+    constexpr int MAX_GRID_SIZE = 1024;
+    const int gridSize = qBound(1, int(std::ceil(std::sqrt(PDFReal(indexedPoints.size())))), MAX_GRID_SIZE);
+
+    m_boundingBox = QRectF(QPointF(minX, minY), QPointF(maxX, maxY));
+    m_columns = m_boundingBox.width() > 0.0 ? gridSize : 1;
+    m_rows = m_boundingBox.height() > 0.0 ? gridSize : 1;
+    m_cellWidth = m_boundingBox.width() / m_columns;
+    m_cellHeight = m_boundingBox.height() / m_rows;
+
+    // Counting sort of points into the cells
+    auto getCellIndex = [this](const QPointF& point)
+    {
+        return size_t(getRow(point.y())) * m_columns + getColumn(point.x());
+    };
+
+    m_cellOffsets.resize(size_t(m_columns) * m_rows + 1, 0);
+    for (quint32 pointIndex : indexedPoints)
+    {
+        ++m_cellOffsets[getCellIndex(m_points[pointIndex]) + 1];
+    }
+
+    for (size_t i = 1; i < m_cellOffsets.size(); ++i)
+    {
+        m_cellOffsets[i] += m_cellOffsets[i - 1];
+    }
+
+    std::vector<quint32> insertPositions(m_cellOffsets.cbegin(), std::prev(m_cellOffsets.cend()));
+    m_cellPoints.resize(indexedPoints.size());
+    for (quint32 pointIndex : indexedPoints)
+    {
+        m_cellPoints[insertPositions[getCellIndex(m_points[pointIndex])]++] = pointIndex;
+    }
+}
+
+void PDFSnapPointIndex::query(const QRectF& rect, std::vector<size_t>& indices) const
+{
+    indices.clear();
+
+    if (m_cellPoints.empty() || !rect.intersects(m_boundingBox.adjusted(-1.0, -1.0, 1.0, 1.0)))
+    {
+        return;
+    }
+
+    const int columnMin = getColumn(rect.left());
+    const int columnMax = getColumn(rect.right());
+    const int rowMin = getRow(rect.top());
+    const int rowMax = getRow(rect.bottom());
+
+    for (int row = rowMin; row <= rowMax; ++row)
+    {
+        for (int column = columnMin; column <= columnMax; ++column)
+        {
+            const size_t cellIndex = size_t(row) * m_columns + column;
+            for (quint32 i = m_cellOffsets[cellIndex]; i < m_cellOffsets[cellIndex + 1]; ++i)
+            {
+                const quint32 pointIndex = m_cellPoints[i];
+                if (rect.contains(m_points[pointIndex]))
+                {
+                    indices.push_back(pointIndex);
+                }
+            }
+        }
+    }
+
+    std::sort(indices.begin(), indices.end());
+}
+
+int PDFSnapPointIndex::getColumn(PDFReal x) const
+{
+    if (m_columns <= 1)
+    {
+        return 0;
+    }
+
+    return int(qBound(0.0, (x - m_boundingBox.left()) / m_cellWidth, PDFReal(m_columns - 1)));
+}
+
+int PDFSnapPointIndex::getRow(PDFReal y) const
+{
+    if (m_rows <= 1)
+    {
+        return 0;
+    }
+
+    return int(qBound(0.0, (y - m_boundingBox.top()) / m_cellHeight, PDFReal(m_rows - 1)));
+}
+
 void PDFSnapInfo::addPageMediaBox(const QRectF& mediaBox)
 {
     QPointF tl = mediaBox.topLeft();
@@ -47,6 +173,7 @@ void PDFSnapInfo::addPageMediaBox(const QRectF& mediaBox)
                             SnapPoint(SnapType::PageCorner, br ),
                             SnapPoint(SnapType::PageCenter, center)
                         });
+    m_index.reset();
 
     addLine(tl, tr);
     addLine(tr, br);
@@ -63,6 +190,7 @@ void PDFSnapInfo::addImage(const std::array<QPointF, 5>& points, const QImage& i
                             SnapPoint(SnapType::ImageCorner, points[3]),
                             SnapPoint(SnapType::ImageCenter, points[4])
                         });
+    m_index.reset();
 
     for (size_t i = 0; i < 4; ++i)
     {
@@ -84,6 +212,63 @@ void PDFSnapInfo::addLine(const QPointF& start, const QPointF& end)
     QLineF line(start, end);
     m_snapPoints.emplace_back(SnapType::LineCenter, line.center());
     m_snapLines.emplace_back(line);
+    m_index.reset();
+}
+
+void PDFSnapInfo::buildIndex()
+{
+    std::vector<QPointF> points;
+    points.reserve(m_snapPoints.size());
+    std::transform(m_snapPoints.cbegin(), m_snapPoints.cend(), std::back_inserter(points), [](const SnapPoint& snapPoint) { return snapPoint.point; });
+    m_index = std::make_shared<const PDFSnapPointIndex>(points);
+}
+
+void PDFSnapInfo::serialize(QDataStream& stream) const
+{
+    stream << m_snapPoints.size();
+    for (const SnapPoint& snapPoint : m_snapPoints)
+    {
+        stream << int(snapPoint.type);
+        stream << snapPoint.point;
+    }
+
+    stream << m_snapLines;
+
+    stream << m_snapImages.size();
+    for (const SnapImage& snapImage : m_snapImages)
+    {
+        stream << snapImage.imagePath;
+        writeRawImage(stream, snapImage.image);
+    }
+}
+
+void PDFSnapInfo::deserialize(QDataStream& stream)
+{
+    size_t snapPointCount = 0;
+    stream >> snapPointCount;
+    m_snapPoints.clear();
+    m_index.reset();
+    for (size_t i = 0; i < snapPointCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        int type = 0;
+        QPointF point;
+        stream >> type;
+        stream >> point;
+        m_snapPoints.emplace_back(static_cast<SnapType>(type), point);
+    }
+
+    stream >> m_snapLines;
+
+    size_t snapImageCount = 0;
+    stream >> snapImageCount;
+    m_snapImages.clear();
+    for (size_t i = 0; i < snapImageCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        SnapImage snapImage;
+        stream >> snapImage.imagePath;
+        snapImage.image = readRawImage(stream);
+        m_snapImages.emplace_back(qMove(snapImage));
+    }
 }
 
 PDFSnapper::PDFSnapper()
@@ -163,15 +348,47 @@ void PDFSnapper::updateSnappedPoint(const QPointF& mousePoint)
     m_snappedImage = std::nullopt;
     m_mousePoint = mousePoint;
 
-    // Iterate trough all points, check, if some satisfies condition
-    const PDFReal toleranceSquared = m_snapPointTolerance * m_snapPointTolerance;
-    for (const ViewportSnapPoint& snapPoint : m_snapPoints)
+    // Find first snap point, which satisfies condition. Only snap points
+    // near the mouse point are tested, using indices of the pages.
+    const PDFReal tolerance = m_snapPointTolerance;
+    const PDFReal toleranceSquared = tolerance * tolerance;
+    const QRectF toleranceRect(mousePoint.x() - tolerance, mousePoint.y() - tolerance, 2.0 * tolerance, 2.0 * tolerance);
+
+    std::vector<size_t> candidates;
+    auto findSnappedPoint = [&](const PDFSnapPointIndexPointer& index, const QRectF& pageRect, size_t firstSnapPoint)
+    {
+        if (!index)
+        {
+            return false;
+        }
+
+        index->query(pageRect, candidates);
+        for (size_t candidate : candidates)
+        {
+            const ViewportSnapPoint& snapPoint = m_snapPoints[firstSnapPoint + candidate];
+            QPointF difference = mousePoint - snapPoint.viewportPoint;
+            PDFReal distanceSquared = QPointF::dotProduct(difference, difference);
+            if (distanceSquared < toleranceSquared)
+            {
+                m_snappedPoint = snapPoint;
+                return true;
+            }
+        }
+
+        return false;
+    };
+
+    for (const PageSnapPoints& pageSnapPoints : m_pageSnapPoints)
     {
-        QPointF difference = mousePoint - snapPoint.viewportPoint;
-        PDFReal distanceSquared = QPointF::dotProduct(difference, difference);
-        if (distanceSquared < toleranceSquared && isSnappingAllowed(snapPoint.pageIndex))
+        if (!isSnappingAllowed(pageSnapPoints.pageIndex))
+        {
+            continue;
+        }
+
+        const QRectF pageRect = pageSnapPoints.deviceToPageMatrix.mapRect(toleranceRect);
+        if (findSnappedPoint(pageSnapPoints.index, pageRect, pageSnapPoints.firstSnapPoint) ||
+            findSnappedPoint(pageSnapPoints.generatedIndex, pageRect, pageSnapPoints.firstGeneratedSnapPoint))
         {
-            m_snappedPoint = snapPoint;
             break;
         }
     }
@@ -191,6 +408,7 @@ void PDFSnapper::buildSnapPoints(const PDFWidgetSnapshot& snapshot)
 {
     // First, clear all snap points
     m_snapPoints.clear();
+    m_pageSnapPoints.clear();
 
     // Second, create snapping points from snapshot
     for (const PDFWidgetSnapshot::SnapshotItem& item : snapshot.items)
@@ -200,7 +418,29 @@ void PDFSnapper::buildSnapPoints(const PDFWidgetSnapshot& snapshot)
             continue;
         }
 
+        bool isInvertible = false;
         const PDFSnapInfo* info = item.compiledPage->getSnapInfo();
+
+        PageSnapPoints pageSnapPoints;
+        pageSnapPoints.pageIndex = item.pageIndex;
+        pageSnapPoints.deviceToPageMatrix = item.pageToDeviceMatrix.inverted(&isInvertible);
+        pageSnapPoints.firstSnapPoint = m_snapPoints.size();
+
+        if (!isInvertible)
+        {
+            // Page is degenerated, nothing can be snapped on it
+            continue;
+        }
+
+        // Index is built, when page is compiled, so it is rebuilt only for changed pages
+        pageSnapPoints.index = info->getIndex();
+        if (!pageSnapPoints.index)
+        {
+            PDFSnapInfo indexedInfo = *info;
+            indexedInfo.buildIndex();
+            pageSnapPoints.index = indexedInfo.getIndex();
+        }
+
         for (const PDFSnapInfo::SnapPoint& snapPoint : info->getSnapPoints())
         {
             ViewportSnapPoint viewportSnapPoint;
@@ -211,6 +451,9 @@ void PDFSnapper::buildSnapPoints(const PDFWidgetSnapshot& snapshot)
             m_snapPoints.push_back(qMove(viewportSnapPoint));
         }
 
+        pageSnapPoints.firstGeneratedSnapPoint = m_snapPoints.size();
+        std::vector<QPointF> generatedPoints;
+
         // Add custom snap points
         if (m_currentPage == item.pageIndex)
         {
@@ -222,14 +465,50 @@ void PDFSnapper::buildSnapPoints(const PDFWidgetSnapshot& snapshot)
                 viewportSnapPoint.pageIndex = item.pageIndex;
                 viewportSnapPoint.viewportPoint = item.pageToDeviceMatrix.map(customSnapPoint);
                 m_snapPoints.push_back(qMove(viewportSnapPoint));
+                generatedPoints.push_back(customSnapPoint);
             }
         }
 
         // Fill line projections snap points
         if (m_currentPage == item.pageIndex && m_referencePoint.has_value())
         {
+            const std::vector<QLineF>& lines = info->getLines();
+
+            // Projected points are compared with already existing points of the page
+            // using grid of generated points, cell size is the maximal tolerance,
+            // so only neighbouring cells have to be tested.
+            PDFReal cellSize = 0.0;
+            for (const QLineF& line : lines)
+            {
+                cellSize = qMax(cellSize, line.length() * 0.01);
+            }
+
+            std::unordered_map<quint64, std::vector<QPointF>> generatedPointsGrid;
+            auto getCell = [cellSize](const QPointF& point)
+            {
+                return std::make_pair(qint64(std::floor(point.x() / cellSize)), qint64(std::floor(point.y() / cellSize)));
+            };
+            auto getCellKey = [](qint64 column, qint64 row)
+            {
+                return (quint64(quint32(column)) << 32) | quint64(quint32(row));
+            };
+            auto addGeneratedPoint = [&](const QPointF& point)
+            {
+                if (cellSize > 0.0)
+                {
+                    auto [column, row] = getCell(point);
+                    generatedPointsGrid[getCellKey(column, row)].push_back(point);
+                }
+            };
+
+            for (const QPointF& customSnapPoint : generatedPoints)
+            {
+                addGeneratedPoint(customSnapPoint);
+            }
+
+            std::vector<size_t> candidates;
             QPointF referencePoint = *m_referencePoint;
-            for (const QLineF& line : info->getLines())
+            for (const QLineF& line : lines)
             {
                 // Project point onto line.
                 const qreal lineLength = line.length();
@@ -243,11 +522,39 @@ void PDFSnapper::buildSnapPoints(const PDFWidgetSnapshot& snapshot)
                     const PDFReal squaredTolerance = tolerance * tolerance;
 
                     // Test, if projected snap point is not already present in snap points
-                    auto testSamePoints = [projectedSnapPoint, squaredTolerance](const ViewportSnapPoint& testedSnapPoint)
+                    bool isPresent = false;
+                    QRectF toleranceRect(projectedSnapPoint.x() - tolerance, projectedSnapPoint.y() - tolerance, 2.0 * tolerance, 2.0 * tolerance);
+                    pageSnapPoints.index->query(toleranceRect, candidates);
+                    for (size_t candidate : candidates)
+                    {
+                        if (isFuzzyComparedPointsSame(projectedSnapPoint, info->getSnapPoints()[candidate].point, squaredTolerance))
+                        {
+                            isPresent = true;
+                            break;
+                        }
+                    }
+
+                    if (!isPresent && cellSize > 0.0)
                     {
-                        return isFuzzyComparedPointsSame(projectedSnapPoint, testedSnapPoint.point, squaredTolerance);
-                    };
-                    if (m_snapPoints.cend() == std::find_if(m_snapPoints.cbegin(), m_snapPoints.cend(), testSamePoints))
+                        auto [column, row] = getCell(projectedSnapPoint);
+                        for (qint64 currentRow = row - 1; currentRow <= row + 1 && !isPresent; ++currentRow)
+                        {
+                            for (qint64 currentColumn = column - 1; currentColumn <= column + 1 && !isPresent; ++currentColumn)
+                            {
+                                auto it = generatedPointsGrid.find(getCellKey(currentColumn, currentRow));
+                                if (it != generatedPointsGrid.cend())
+                                {
+                                    auto testSamePoints = [projectedSnapPoint, squaredTolerance](const QPointF& testedPoint)
+                                    {
+                                        return isFuzzyComparedPointsSame(projectedSnapPoint, testedPoint, squaredTolerance);
+                                    };
+                                    isPresent = std::any_of(it->second.cbegin(), it->second.cend(), testSamePoints);
+                                }
+                            }
+                        }
+                    }
+
+                    if (!isPresent)
                     {
                         ViewportSnapPoint viewportSnapPoint;
                         viewportSnapPoint.type = SnapType::GeneratedLineProjection;
@@ -255,10 +562,19 @@ void PDFSnapper::buildSnapPoints(const PDFWidgetSnapshot& snapshot)
                         viewportSnapPoint.pageIndex = item.pageIndex;
                         viewportSnapPoint.viewportPoint = item.pageToDeviceMatrix.map(projectedSnapPoint);
                         m_snapPoints.push_back(qMove(viewportSnapPoint));
+                        generatedPoints.push_back(projectedSnapPoint);
+                        addGeneratedPoint(projectedSnapPoint);
                     }
                 }
             }
         }
+
+        if (!generatedPoints.empty())
+        {
+            pageSnapPoints.generatedIndex = std::make_shared<const PDFSnapPointIndex>(generatedPoints);
+        }
+
+        m_pageSnapPoints.push_back(qMove(pageSnapPoints));
     }
 
     // Third, update snap shot position
@@ -346,6 +662,7 @@ void PDFSnapper::clear()
 
     m_customSnapPoints.clear();
     m_snapPoints.clear();
+    m_pageSnapPoints.clear();
     m_snapImages.clear();
     m_snappedPoint = std::nullopt;
     m_snappedImage = std::nullopt;
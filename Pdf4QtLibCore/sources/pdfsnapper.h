@@ -26,9 +26,12 @@
 #include "pdfglobal.h"
 
 #include <QImage>
+#include <QDataStream>
+#include <QTransform>
 #include <QPainterPath>
 
 #include <array>
+#include <memory>
 #include <optional>
 
 class QPainter;
@@ -50,6 +53,44 @@ enum class SnapType
     Custom  ///< Custom snap point
 };
 
+/// Spatial index of points (uniform grid), which is used to find snap points
+/// near the mouse cursor without testing all snap points. Index is immutable
+/// once it is built, so it can be shared between copies of snap info.
+class PDF4QTLIBCORESHARED_EXPORT PDFSnapPointIndex
+{
+public:
+    /// Builds index of points. Points are identified by their position
+    /// in \p points, points with non-finite coordinates are not indexed.
+    /// \param points Points
+    explicit PDFSnapPointIndex(const std::vector<QPointF>& points);
+
+    /// Finds points lying in the rectangle. Indices of found points
+    /// are sorted in ascending order.
+    /// \param rect Rectangle
+    /// \param indices Indices of found points (vector is cleared first)
+    void query(const QRectF& rect, std::vector<size_t>& indices) const;
+
+private:
+    /// Returns column of the cell containing x coordinate (clamped to grid)
+    int getColumn(PDFReal x) const;
+
+    /// Returns row of the cell containing y coordinate (clamped to grid)
+    int getRow(PDFReal y) const;
+
+    std::vector<QPointF> m_points;
+    QRectF m_boundingBox;
+    int m_columns = 0;
+    int m_rows = 0;
+    PDFReal m_cellWidth = 0.0;
+    PDFReal m_cellHeight = 0.0;
+
+    /// Points of the cell i are m_cellPoints[m_cellOffsets[i]] to m_cellPoints[m_cellOffsets[i + 1] - 1]
+    std::vector<quint32> m_cellOffsets;
+    std::vector<quint32> m_cellPoints;
+};
+
+using PDFSnapPointIndexPointer = std::shared_ptr<const PDFSnapPointIndex>;
+
 /// Contain informations for snap points in the pdf page. Snap points
 /// can be for example image centers, rectangle corners, line start/end
 /// points, page boundary boxes etc. All coordinates are in page coordinates.
@@ -104,10 +145,21 @@ public:
     /// in which image is painted).
     const std::vector<SnapImage>& getSnapImages() const { return m_snapImages; }
 
+    /// Builds spatial index of snap points. It should be called, when
+    /// all snap points are added (index is reset, when snap points change).
+    void buildIndex();
+
+    /// Returns spatial index of snap points (can be nullptr, if index is not built)
+    const PDFSnapPointIndexPointer& getIndex() const { return m_index; }
+
+    void serialize(QDataStream& stream) const;
+    void deserialize(QDataStream& stream);
+
 private:
     std::vector<SnapPoint> m_snapPoints;
     std::vector<QLineF> m_snapLines;
     std::vector<SnapImage> m_snapImages;
+    PDFSnapPointIndexPointer m_index;
 };
 
 /// Snap engine, which handles snapping of points on the page.
@@ -148,6 +200,7 @@ public:
     /// using snapping info from current page, and if we are hovering at different page,
     /// then nothing happens. Otherwise, other page snap info is used to update snapped point.
     /// If mouse point distance from some snap point is lesser than tolerance, then new snap is set.
+    /// Only snap points near the mouse point are tested (using spatial index of snap points).
     /// \param mousePoint Mouse point in widget coordinates
     void updateSnappedPoint(const QPointF& mousePoint);
 
@@ -155,7 +208,9 @@ public:
     bool isSnapped() const { return m_snappedPoint.has_value(); }
 
     /// Builds snap points from the widget snapshot. Updates current value
-    /// of snapped point (from mouse position).
+    /// of snapped point (from mouse position). Spatial indices of page snap
+    /// points are built with compiled pages, so only index of generated snap
+    /// points (custom points, line projections) is built here.
     /// \param snapshot Widget snapshot
     void buildSnapPoints(const PDFWidgetSnapshot& snapshot);
 
@@ -205,7 +260,21 @@ private:
         QPointF snappedPoint;
     };
 
+    /// Snap points of a single page. Snap points of the page are stored in
+    /// \p m_snapPoints, first snap points from the page snap info, then
+    /// generated snap points. Indices are in page coordinates.
+    struct PageSnapPoints
+    {
+        PDFInteger pageIndex = -1;
+        QTransform deviceToPageMatrix;
+        PDFSnapPointIndexPointer index;
+        PDFSnapPointIndexPointer generatedIndex;
+        size_t firstSnapPoint = 0;
+        size_t firstGeneratedSnapPoint = 0;
+    };
+
     std::vector<ViewportSnapPoint> m_snapPoints;
+    std::vector<PageSnapPoints> m_pageSnapPoints;
     std::vector<ViewportSnapImage> m_snapImages;
     std::vector<QPointF> m_customSnapPoints;
     std::optional<ViewportSnapPoint> m_snappedPoint;
@@ -0,0 +1,397 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pdfspeechsynthesispipeline.h"
+#include "pdfexecutionpolicy.h"
+#include "pdfoperationcontrol.h"
+
+#include <QDir>
+#include <QFile>
+#include <QMutex>
+#include <QtEndian>
+#include <QWaitCondition>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QTextBoundaryFinder>
+
+#include "pdfdbgheap.h"
+
+#include <atomic>
+#include <thread>
+#include <numeric>
+#include <algorithm>
+
+namespace pdf
+{
+
+namespace
+{
+
+/// Audio data of the wave file
+struct PDFWaveData
+{
+    QByteArray format;  ///< Content of the format chunk
+    QByteArray data;    ///< Content of the data chunk (samples)
+};
+
+/// Reads format and samples of the wave (RIFF) file. Other chunks are skipped.
+/// \param fileName File name
+/// \param waveData Audio data
+bool readWaveFile(const QString& fileName, PDFWaveData& waveData)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly))
+    {
+        return false;
+    }
+
+    const QByteArray content = file.readAll();
+    if (content.size() < 12 || !content.startsWith("RIFF") || content.mid(8, 4) != "WAVE")
+    {
+        return false;
+    }
+
+    qsizetype offset = 12;
+    bool hasFormat = false;
+    bool hasData = false;
+    while (offset + 8 <= content.size())
+    {
+        const QByteArray chunkId = content.mid(offset, 4);
+        const qsizetype chunkSize = qFromLittleEndian<quint32>(content.constData() + offset + 4);
+        const qsizetype chunkOffset = offset + 8;
+        const qsizetype availableSize = qMin(chunkSize, content.size() - chunkOffset);
+
+        if (chunkId == "fmt ")
+        {
+            waveData.format = content.mid(chunkOffset, availableSize);
+            hasFormat = true;
+        }
+        else if (chunkId == "data")
+        {
+            waveData.data = content.mid(chunkOffset, availableSize);
+            hasData = true;
+        }
+
+        // Chunks are aligned to the even offsets
+        offset = chunkOffset + chunkSize + (chunkSize % 2);
+    }
+
+    return hasFormat && hasData;
+}
+
+/// Writes header of the wave file. Size of the data chunk must be known.
+/// \param file File (header is written at current position)
+/// \param format Content of the format chunk
+/// \param dataSize Size of the data chunk
+void writeWaveHeader(QFile& file, const QByteArray& format, qint64 dataSize)
+{
+    auto writeUInt32 = [&file](quint32 value)
+    {
+        char buffer[4];
+        qToLittleEndian(value, buffer);
+        file.write(buffer, sizeof(buffer));
+    };
+
+    file.write("RIFF");
+    writeUInt32(quint32(4 + 8 + format.size() + 8 + dataSize));
+    file.write("WAVE");
+    file.write("fmt ");
+    writeUInt32(quint32(format.size()));
+    file.write(format);
+    file.write("data");
+    writeUInt32(quint32(dataSize));
+}
+
+}   // namespace
+
+PDFSpeechSynthesisPipeline::PDFSpeechSynthesisPipeline(Settings settings) :
+    m_settings(qMove(settings))
+{
+    if (m_settings.cacheDirectory.isEmpty())
+    {
+        m_settings.cacheDirectory = getDefaultCacheDirectory();
+    }
+}
+
+QStringList PDFSpeechSynthesisPipeline::createChunks(const QStringList& paragraphs, int maximalChunkLength)
+{
+    QStringList chunks;
+    QString currentChunk;
+
+    auto flush = [&]()
+    {
+        if (!currentChunk.isEmpty())
+        {
+            chunks << currentChunk;
+            currentChunk.clear();
+        }
+    };
+
+    auto append = [&](const QString& text)
+    {
+        if (!currentChunk.isEmpty() && currentChunk.size() + text.size() + 1 > maximalChunkLength)
+        {
+            flush();
+        }
+
+        if (!currentChunk.isEmpty())
+        {
+            currentChunk += QChar('\n');
+        }
+        currentChunk += text;
+    };
+
+    for (const QString& paragraph : paragraphs)
+    {
+        const QString trimmedParagraph = paragraph.trimmed();
+        if (trimmedParagraph.isEmpty())
+        {
+            continue;
+        }
+
+        if (trimmedParagraph.size() <= maximalChunkLength)
+        {
+            append(trimmedParagraph);
+            continue;
+        }
+
+        // Paragraph is too long, split it at sentence boundaries
+        QTextBoundaryFinder finder(QTextBoundaryFinder::Sentence, trimmedParagraph);
+        qsizetype sentenceStart = 0;
+        while (finder.toNextBoundary() != -1)
+        {
+            const qsizetype sentenceEnd = finder.position();
+            const QString sentence = trimmedParagraph.mid(sentenceStart, sentenceEnd - sentenceStart).trimmed();
+            sentenceStart = sentenceEnd;
+
+            if (!sentence.isEmpty())
+            {
+                if (!currentChunk.isEmpty() && currentChunk.size() + sentence.size() + 1 > maximalChunkLength)
+                {
+                    flush();
+                }
+
+                if (!currentChunk.isEmpty())
+                {
+                    currentChunk += QChar(' ');
+                }
+                currentChunk += sentence;
+            }
+        }
+    }
+
+    flush();
+    return chunks;
+}
+
+PDFOperationResult PDFSpeechSynthesisPipeline::execute(const QStringList& chunks,
+                                                       const QString& outputFileName,
+                                                       const SynthesizeFunction& synthesize,
+                                                       const PDFOperationControl* operationControl)
+{
+    m_statistics = Statistics();
+    m_statistics.chunkCount = chunks.size();
+
+    if (chunks.isEmpty())
+    {
+        return PDFTranslationContext::tr("No text to be synthesized.");
+    }
+
+    if (!QDir().mkpath(m_settings.cacheDirectory))
+    {
+        return PDFTranslationContext::tr("Cannot create cache directory '%1'.").arg(m_settings.cacheDirectory);
+    }
+
+    enum class ChunkState
+    {
+        Pending,
+        Ready,
+        Failed
+    };
+
+    struct ChunkInfo
+    {
+        ChunkState state = ChunkState::Pending;
+        QString fileName;
+        QString errorMessage;
+    };
+
+    QMutex mutex;
+    QWaitCondition chunkFinished;
+    std::vector<ChunkInfo> chunkInfos(chunks.size());
+    std::atomic<bool> isAborted = false;
+
+    // Synthesis stage - chunks are synthesized to the cache directory
+    auto synthesizeChunk = [&](qsizetype index)
+    {
+        ChunkInfo info;
+        info.fileName = getChunkFileName(chunks[index]);
+
+        bool isCached = QFile::exists(info.fileName);
+        if (isAborted.load() || PDFOperationControl::isOperationCancelled(operationControl))
+        {
+            info.state = ChunkState::Failed;
+            info.errorMessage = PDFTranslationContext::tr("Speech synthesis was cancelled.");
+        }
+        else if (isCached)
+        {
+            info.state = ChunkState::Ready;
+        }
+        else
+        {
+            // Chunk is synthesized to the temporary file, so unfinished
+            // chunk is never used from the cache.
+            const QString temporaryFileName = QString("%1.%2.tmp").arg(info.fileName).arg(index);
+            PDFOperationResult result = synthesize(chunks[index], temporaryFileName);
+
+            if (result && (QFile::rename(temporaryFileName, info.fileName) || QFile::exists(info.fileName)))
+            {
+                info.state = ChunkState::Ready;
+            }
+            else
+            {
+                info.state = ChunkState::Failed;
+                info.errorMessage = !result ? result.getErrorMessage() : PDFTranslationContext::tr("Cannot write file '%1'.").arg(info.fileName);
+            }
+
+            QFile::remove(temporaryFileName);
+        }
+
+        QMutexLocker lock(&mutex);
+        if (info.state == ChunkState::Ready)
+        {
+            ++(isCached ? m_statistics.cachedChunkCount : m_statistics.synthesizedChunkCount);
+        }
+        chunkInfos[index] = qMove(info);
+        chunkFinished.wakeAll();
+    };
+
+    std::thread synthesisThread([&]()
+    {
+        std::vector<qsizetype> indices(chunks.size(), 0);
+        std::iota(indices.begin(), indices.end(), 0);
+
+        if (m_settings.parallel)
+        {
+            PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, indices.cbegin(), indices.cend(), synthesizeChunk);
+        }
+        else
+        {
+            std::for_each(indices.cbegin(), indices.cend(), synthesizeChunk);
+        }
+    });
+
+    // Encoding stage - samples of the chunks are appended to the output file in order
+    PDFOperationResult result = true;
+    QFile outputFile(outputFileName);
+    QByteArray format;
+    qint64 dataSize = 0;
+
+    if (!outputFile.open(QFile::WriteOnly | QFile::Truncate))
+    {
+        result = PDFTranslationContext::tr("Cannot create output file '%1'.").arg(outputFileName);
+    }
+
+    for (size_t i = 0; result && i < chunkInfos.size(); ++i)
+    {
+        ChunkInfo info;
+        {
+            QMutexLocker lock(&mutex);
+            while (chunkInfos[i].state == ChunkState::Pending)
+            {
+                chunkFinished.wait(&mutex);
+            }
+            info = chunkInfos[i];
+        }
+
+        PDFWaveData waveData;
+        if (info.state == ChunkState::Failed)
+        {
+            result = info.errorMessage;
+        }
+        else if (!readWaveFile(info.fileName, waveData))
+        {
+            // Remove invalid file from the cache, so it is synthesized next time
+            QFile::remove(info.fileName);
+            result = PDFTranslationContext::tr("Invalid synthesized audio file '%1'.").arg(info.fileName);
+        }
+        else if (i == 0)
+        {
+            // Header is rewritten, when size of the data is known
+            format = waveData.format;
+            writeWaveHeader(outputFile, format, 0);
+        }
+        else if (waveData.format != format)
+        {
+            result = PDFTranslationContext::tr("Synthesized audio chunks have different audio format.");
+        }
+
+        if (result)
+        {
+            outputFile.write(waveData.data);
+            dataSize += waveData.data.size();
+        }
+        else
+        {
+            isAborted.store(true);
+        }
+    }
+
+    synthesisThread.join();
+
+    if (result)
+    {
+        outputFile.seek(0);
+        writeWaveHeader(outputFile, format, dataSize);
+
+        if (outputFile.error() != QFile::NoError)
+        {
+            result = PDFTranslationContext::tr("Cannot write output file '%1'.").arg(outputFileName);
+        }
+    }
+
+    outputFile.close();
+
+    if (!result)
+    {
+        outputFile.remove();
+    }
+
+    return result;
+}
+
+QString PDFSpeechSynthesisPipeline::getDefaultCacheDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/SpeechChunks";
+}
+
+QString PDFSpeechSynthesisPipeline::getChunkFileName(const QString& text) const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(m_settings.voiceKey);
+    hash.addData(QByteArrayView("\0", 1));
+    hash.addData(text.toUtf8());
+    return QString("%1/%2.wav").arg(m_settings.cacheDirectory, QString::fromLatin1(hash.result().toHex()));
+}
+
+}   // namespace pdf
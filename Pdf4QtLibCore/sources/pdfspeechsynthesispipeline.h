@@ -0,0 +1,106 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef PDFSPEECHSYNTHESISPIPELINE_H
+#define PDFSPEECHSYNTHESISPIPELINE_H
+
+#include "pdfglobal.h"
+#include "pdfutils.h"
+
+#include <QString>
+#include <QStringList>
+
+#include <vector>
+#include <functional>
+
+namespace pdf
+{
+class PDFOperationControl;
+
+/// Pipeline for speech synthesis of long texts (for example, audio books). Text is split
+/// into independent chunks at paragraph (and, for long paragraphs, at sentence) boundaries.
+/// Chunks are synthesized to wave files concurrently (if backend allows it). Synthesized
+/// chunks are stored in the cache directory under the hash of their text and voice settings,
+/// so when text is edited, only changed chunks are synthesized again. The encoding stage runs
+/// concurrently with the synthesis and appends audio data of the chunks to the output
+/// wave file in order, as soon as chunks are available.
+class PDF4QTLIBCORESHARED_EXPORT PDFSpeechSynthesisPipeline
+{
+public:
+
+    /// Synthesizes the text to the wave file. If backend allows concurrent synthesis,
+    /// function is called from multiple threads simultaneously. All chunks must be
+    /// synthesized using the same audio format.
+    using SynthesizeFunction = std::function<PDFOperationResult(const QString& text, const QString& waveFileName)>;
+
+    struct Settings
+    {
+        QString cacheDirectory;             ///< Directory of cached chunks (if empty, default cache directory is used)
+        QByteArray voiceKey;                ///< Identification of the voice and its parameters (chunks synthesized with other voice are not reused)
+        int maximalChunkLength = 2000;      ///< Preferred maximal count of characters of the chunk
+        bool parallel = true;               ///< Synthesize chunks concurrently
+    };
+
+    struct Statistics
+    {
+        qint64 chunkCount = 0;              ///< Count of chunks
+        qint64 synthesizedChunkCount = 0;   ///< Count of synthesized chunks
+        qint64 cachedChunkCount = 0;        ///< Count of chunks taken from the cache
+    };
+
+    explicit PDFSpeechSynthesisPipeline(Settings settings);
+
+    /// Splits paragraphs of the text into chunks. Consecutive paragraphs are joined into
+    /// single chunk, until chunk length exceeds the maximal length. Paragraphs longer than
+    /// maximal length are split at sentence boundaries. Empty paragraphs are skipped.
+    /// \param paragraphs Paragraphs of the text
+    /// \param maximalChunkLength Maximal length of the chunk
+    static QStringList createChunks(const QStringList& paragraphs, int maximalChunkLength);
+
+    /// Synthesizes chunks and writes the output wave file
+    /// \param chunks Chunks of the text (in order)
+    /// \param outputFileName Output file name
+    /// \param synthesize Synthesis function
+    /// \param operationControl Operation control (can be nullptr)
+    PDFOperationResult execute(const QStringList& chunks,
+                               const QString& outputFileName,
+                               const SynthesizeFunction& synthesize,
+                               const PDFOperationControl* operationControl = nullptr);
+
+    /// Returns statistics of the last execution
+    const Statistics& getStatistics() const { return m_statistics; }
+
+    /// Returns default directory of cached chunks
+    static QString getDefaultCacheDirectory();
+
+private:
+    /// Returns file name of the cached chunk
+    QString getChunkFileName(const QString& text) const;
+
+    Settings m_settings;
+    Statistics m_statistics;
+};
+
+}   // namespace pdf
+
+#endif // PDFSPEECHSYNTHESISPIPELINE_H
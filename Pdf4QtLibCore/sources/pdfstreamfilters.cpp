@@ -26,16 +26,223 @@
 #include "pdfparser.h"
 #include "pdfsecurityhandler.h"
 #include "pdfutils.h"
+#include "pdftracing.h"
 
 #include <zlib.h>
 
+#ifdef PDF4QT_USE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+
 #include <QtEndian>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PDF4QT_STREAM_PREDICTOR_SSE2
+#define PDF4QT_STREAM_PREDICTOR_SIMD
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define PDF4QT_STREAM_PREDICTOR_NEON
+#define PDF4QT_STREAM_PREDICTOR_SIMD
+#include <arm_neon.h>
+#endif
+
 #include "pdfdbgheap.h"
 
+#include <atomic>
+#include <cstring>
+#include <optional>
+
 namespace pdf
 {
 
+QByteArray PDFStreamReader::readAll()
+{
+    constexpr qint64 CHUNK_SIZE = 65536;
+
+    QByteArray result;
+    qint64 size = 0;
+
+    while (true)
+    {
+        result.resize(size + CHUNK_SIZE);
+        const qint64 bytesRead = read(result.data() + size, CHUNK_SIZE);
+
+        if (bytesRead <= 0)
+        {
+            break;
+        }
+
+        size += bytesRead;
+    }
+
+    result.resize(size);
+    return result;
+}
+
+qint64 PDFByteArrayStreamReader::read(char* data, qint64 maxSize)
+{
+    const qint64 bytesRead = qMin(maxSize, m_data.size() - m_position);
+
+    if (bytesRead > 0)
+    {
+        std::copy(m_data.cbegin() + m_position, m_data.cbegin() + m_position + bytesRead, data);
+        m_position += bytesRead;
+    }
+
+    return qMax(bytesRead, qint64(0));
+}
+
+/// Buffered input of the stream decoding stage. Pulls the data from
+/// the previous stage in chunks, so the decoders can process them
+/// byte by byte without virtual call overhead.
+class PDFStreamReaderInput
+{
+public:
+    explicit inline PDFStreamReaderInput(PDFStreamReaderPointer reader) :
+        m_reader(std::move(reader))
+    {
+
+    }
+
+    /// Returns next byte of the input, or -1, if end of input is reached
+    inline int get()
+    {
+        if (m_position == m_size && !fill())
+        {
+            return -1;
+        }
+
+        return static_cast<unsigned char>(m_buffer[m_position++]);
+    }
+
+    /// Fills the buffer, if it is empty. Returns false, if end of input is reached.
+    bool fill();
+
+    /// Reads at most \p maxSize bytes. Returns number of bytes read.
+    qint64 read(char* data, qint64 maxSize);
+
+    /// Returns pointer to the buffered data
+    const char* data() const { return m_buffer.constData() + m_position; }
+
+    /// Returns number of buffered bytes
+    qint64 available() const { return m_size - m_position; }
+
+    /// Removes \p count bytes from the buffer
+    void consume(qint64 count) { m_position += count; }
+
+private:
+    static constexpr qint64 BUFFER_SIZE = 16384;
+
+    PDFStreamReaderPointer m_reader;
+    QByteArray m_buffer;
+    qint64 m_position = 0;
+    qint64 m_size = 0;
+    bool m_end = false;
+};
+
+bool PDFStreamReaderInput::fill()
+{
+    if (m_position < m_size)
+    {
+        return true;
+    }
+
+    if (m_end)
+    {
+        return false;
+    }
+
+    if (m_buffer.isEmpty())
+    {
+        m_buffer.resize(BUFFER_SIZE);
+    }
+
+    m_position = 0;
+    m_size = m_reader->read(m_buffer.data(), BUFFER_SIZE);
+
+    if (m_size <= 0)
+    {
+        m_size = 0;
+        m_end = true;
+        return false;
+    }
+
+    return true;
+}
+
+qint64 PDFStreamReaderInput::read(char* data, qint64 maxSize)
+{
+    qint64 bytesRead = 0;
+
+    while (bytesRead < maxSize && fill())
+    {
+        const qint64 count = qMin(maxSize - bytesRead, available());
+        std::copy(this->data(), this->data() + count, data + bytesRead);
+        consume(count);
+        bytesRead += count;
+    }
+
+    return bytesRead;
+}
+
+/// Base class for decoding stages. Decoder produces data in chunks
+/// into the internal buffer, from which they are read.
+class PDFBufferedStreamReader : public PDFStreamReader
+{
+public:
+    explicit inline PDFBufferedStreamReader(PDFStreamReaderPointer input) :
+        m_input(std::move(input))
+    {
+
+    }
+
+    virtual qint64 read(char* data, qint64 maxSize) override;
+
+protected:
+    /// Chunk size, which decoders should try to produce in single \p decode call
+    static constexpr int CHUNK_SIZE = 16384;
+
+    /// Decodes next chunk of the data and appends it to the \p buffer. Returns false,
+    /// if end of stream is reached and no more data will be appended.
+    /// \param buffer Output buffer
+    virtual bool decode(QByteArray& buffer) = 0;
+
+    PDFStreamReaderInput m_input;
+
+private:
+    QByteArray m_buffer;
+    qint64 m_position = 0;
+    bool m_finished = false;
+};
+
+qint64 PDFBufferedStreamReader::read(char* data, qint64 maxSize)
+{
+    qint64 bytesRead = 0;
+
+    while (bytesRead < maxSize)
+    {
+        if (m_position == m_buffer.size())
+        {
+            if (m_finished)
+            {
+                break;
+            }
+
+            m_buffer.resize(0);
+            m_position = 0;
+            m_finished = !decode(m_buffer);
+            continue;
+        }
+
+        const qint64 count = qMin(maxSize - bytesRead, m_buffer.size() - m_position);
+        std::copy(m_buffer.cbegin() + m_position, m_buffer.cbegin() + m_position + count, data + bytesRead);
+        m_position += count;
+        bytesRead += count;
+    }
+
+    return bytesRead;
+}
+
 QByteArray PDFAsciiHexDecodeFilter::apply(const QByteArray& data,
                                           const PDFObjectFetcher& objectFetcher,
                                           const PDFObject& parameters,
@@ -65,6 +272,80 @@ QByteArray PDFAsciiHexDecodeFilter::apply(const QByteArray& data,
     return QByteArray::fromHex(QByteArray::fromRawData(data.constData(), size));
 }
 
+class PDFAsciiHexStreamReader : public PDFBufferedStreamReader
+{
+public:
+    using PDFBufferedStreamReader::PDFBufferedStreamReader;
+
+protected:
+    virtual bool decode(QByteArray& buffer) override;
+
+private:
+    int m_highNibble = -1;  ///< First digit of the byte being decoded, or -1
+};
+
+bool PDFAsciiHexStreamReader::decode(QByteArray& buffer)
+{
+    while (buffer.size() < CHUNK_SIZE)
+    {
+        const int character = m_input.get();
+        if (character == -1 || character == '>')
+        {
+            // Odd number of digits - last digit is completed with trailing zero
+            if (m_highNibble != -1)
+            {
+                buffer.push_back(static_cast<char>(m_highNibble << 4));
+                m_highNibble = -1;
+            }
+            return false;
+        }
+
+        int value = -1;
+        if (character >= '0' && character <= '9')
+        {
+            value = character - '0';
+        }
+        else if (character >= 'A' && character <= 'F')
+        {
+            value = character - 'A' + 10;
+        }
+        else if (character >= 'a' && character <= 'f')
+        {
+            value = character - 'a' + 10;
+        }
+
+        if (value == -1)
+        {
+            // Invalid characters (including whitespaces) are skipped
+            continue;
+        }
+
+        if (m_highNibble == -1)
+        {
+            m_highNibble = value;
+        }
+        else
+        {
+            buffer.push_back(static_cast<char>((m_highNibble << 4) | value));
+            m_highNibble = -1;
+        }
+    }
+
+    return true;
+}
+
+PDFStreamReaderPointer PDFAsciiHexDecodeFilter::createReader(PDFStreamReaderPointer input,
+                                                             const PDFObjectFetcher& objectFetcher,
+                                                             const PDFObject& parameters,
+                                                             const PDFSecurityHandler* securityHandler) const
+{
+    Q_UNUSED(objectFetcher);
+    Q_UNUSED(parameters);
+    Q_UNUSED(securityHandler);
+
+    return std::make_unique<PDFAsciiHexStreamReader>(std::move(input));
+}
+
 QByteArray PDFAscii85DecodeFilter::apply(const QByteArray& data,
                                          const PDFObjectFetcher& objectFetcher,
                                          const PDFObject& parameters,
@@ -156,12 +437,120 @@ QByteArray PDFAscii85DecodeFilter::apply(const QByteArray& data,
     return result;
 }
 
+class PDFAscii85StreamReader : public PDFBufferedStreamReader
+{
+public:
+    using PDFBufferedStreamReader::PDFBufferedStreamReader;
+
+protected:
+    virtual bool decode(QByteArray& buffer) override;
+
+private:
+    static constexpr uint32_t STREAM_END = 0xFFFFFFFF;
+
+    /// Returns next non-whitespace character, or STREAM_END
+    uint32_t getChar();
+
+    bool m_end = false;     ///< End of data marker was scanned
+};
+
+uint32_t PDFAscii85StreamReader::getChar()
+{
+    if (m_end)
+    {
+        return STREAM_END;
+    }
+
+    int character = m_input.get();
+
+    // Skip whitespace characters
+    while (character != -1 && PDFLexicalAnalyzer::isWhitespace(static_cast<char>(character)))
+    {
+        character = m_input.get();
+    }
+
+    if (character == -1 || character == '~')
+    {
+        m_end = true;
+        return STREAM_END;
+    }
+
+    return static_cast<uint32_t>(character);
+}
+
+bool PDFAscii85StreamReader::decode(QByteArray& buffer)
+{
+    while (buffer.size() < CHUNK_SIZE)
+    {
+        const uint32_t scannedChar = getChar();
+        if (scannedChar == STREAM_END)
+        {
+            return false;
+        }
+        else if (scannedChar == 'z')
+        {
+            buffer.append(4, static_cast<char>(0));
+        }
+        else
+        {
+            // Same decoding as in PDFAscii85DecodeFilter::apply, incomplete
+            // group at the end of stream is completed with 'u' characters.
+            std::array<uint32_t, 5> scannedChars;
+            scannedChars.fill(84);
+            scannedChars[0] = scannedChar - 33;
+            std::size_t validBytes = 0;
+            for (auto it = std::next(scannedChars.begin()); it != scannedChars.end(); ++it)
+            {
+                uint32_t character = getChar();
+                if (character == STREAM_END)
+                {
+                    break;
+                }
+                *it = character - 33;
+                ++validBytes;
+            }
+
+            uint32_t decodedBytesPacked = 0;
+            for (const uint32_t value : scannedChars)
+            {
+                decodedBytesPacked = decodedBytesPacked * 85 + value;
+            }
+
+            for (std::size_t i = 0; i < validBytes; ++i)
+            {
+                buffer.push_back(static_cast<char>((decodedBytesPacked >> (24 - 8 * i)) & 0xFF));
+            }
+        }
+    }
+
+    return true;
+}
+
+PDFStreamReaderPointer PDFAscii85DecodeFilter::createReader(PDFStreamReaderPointer input,
+                                                            const PDFObjectFetcher& objectFetcher,
+                                                            const PDFObject& parameters,
+                                                            const PDFSecurityHandler* securityHandler) const
+{
+    Q_UNUSED(objectFetcher);
+    Q_UNUSED(parameters);
+    Q_UNUSED(securityHandler);
+
+    return std::make_unique<PDFAscii85StreamReader>(std::move(input));
+}
+
 class PDFLzwStreamDecoder
 {
 public:
-    explicit PDFLzwStreamDecoder(const QByteArray& inputByteArray, uint32_t early);
+    explicit PDFLzwStreamDecoder(PDFStreamReaderPointer input, uint32_t early);
+
+    /// Decompresses all data
+    /// \param sizeHint Size of the input data (used to reserve output buffer)
+    QByteArray decompress(int sizeHint);
 
-    QByteArray decompress();
+    /// Decodes next code and appends its sequence to the \p buffer. Returns
+    /// false, if end of stream is reached.
+    /// \param buffer Output buffer
+    bool decodeNext(QByteArray& buffer);
 
 private:
     static constexpr const uint32_t CODE_TABLE_RESET = 256;
@@ -196,11 +585,11 @@ private:
     std::array<char, TABLE_SIZE>::iterator m_currentSequenceEnd;
     bool m_first;               ///< Are we reading from stream for first time after the reset
     char m_newCharacter;        ///< New character to be written
-    int m_position;             ///< Position in the input array
-    const QByteArray& m_inputByteArray;
+    uint32_t m_previousCode;    ///< Previously decoded code
+    PDFStreamReaderInput m_input;
 };
 
-PDFLzwStreamDecoder::PDFLzwStreamDecoder(const QByteArray& inputByteArray, uint32_t early) :
+PDFLzwStreamDecoder::PDFLzwStreamDecoder(PDFStreamReaderPointer input, uint32_t early) :
     m_table(),
     m_sequence(),
     m_nextCode(0),
@@ -211,8 +600,8 @@ PDFLzwStreamDecoder::PDFLzwStreamDecoder(const QByteArray& inputByteArray, uint3
     m_currentSequenceEnd(m_sequence.begin()),
     m_first(false),
     m_newCharacter(0),
-    m_position(0),
-    m_inputByteArray(inputByteArray)
+    m_previousCode(TABLE_SIZE),
+    m_input(std::move(input))
 {
     for (size_t i = 0; i < 256; ++i)
     {
@@ -223,14 +612,24 @@ PDFLzwStreamDecoder::PDFLzwStreamDecoder(const QByteArray& inputByteArray, uint3
     clearTable();
 }
 
-QByteArray PDFLzwStreamDecoder::decompress()
+QByteArray PDFLzwStreamDecoder::decompress(int sizeHint)
 {
     QByteArray result;
 
     // Guess output byte array size - assume compress ratio is 2:1
-    result.reserve(m_inputByteArray.size() * 2);
+    result.reserve(sizeHint * 2);
+
+    while (decodeNext(result))
+    {
+        // Decode all codes
+    }
+
+    result.shrink_to_fit();
+    return result;
+}
 
-    uint32_t previousCode = TABLE_SIZE;
+bool PDFLzwStreamDecoder::decodeNext(QByteArray& buffer)
+{
     while (true)
     {
         const uint32_t code = getCode();
@@ -238,7 +637,7 @@ QByteArray PDFLzwStreamDecoder::decompress()
         if (code == CODE_END_OF_STREAM)
         {
             // We are at end of stream
-            break;
+            return false;
         }
         else if (code == CODE_TABLE_RESET)
         {
@@ -284,7 +683,7 @@ QByteArray PDFLzwStreamDecoder::decompress()
             if (m_nextCode < TABLE_SIZE)
             {
                 m_table[m_nextCode].character = m_newCharacter;
-                m_table[m_nextCode].previous = previousCode;
+                m_table[m_nextCode].previous = m_previousCode;
                 ++m_nextCode;
             }
 
@@ -308,14 +707,12 @@ QByteArray PDFLzwStreamDecoder::decompress()
             }
         }
 
-        previousCode = code;
+        m_previousCode = code;
 
         // Copy the input array to the buffer
-        std::copy(m_sequence.begin(), m_currentSequenceEnd, std::back_inserter(result));
+        buffer.append(m_sequence.data(), std::distance(m_sequence.begin(), m_currentSequenceEnd));
+        return true;
     }
-
-    result.shrink_to_fit();
-    return result;
 }
 
 void PDFLzwStreamDecoder::clearTable()
@@ -333,13 +730,14 @@ uint32_t PDFLzwStreamDecoder::getCode()
 {
     while (m_inputBits < m_nextBits)
     {
-        // Did we reach end of array?
-        if (m_position == m_inputByteArray.size())
+        // Did we reach end of input?
+        const int byte = m_input.get();
+        if (byte == -1)
         {
             return CODE_END_OF_STREAM;
         }
 
-        m_inputBuffer = (m_inputBuffer << 8) | static_cast<unsigned char>(m_inputByteArray[m_position++]);
+        m_inputBuffer = (m_inputBuffer << 8) | static_cast<uint32_t>(byte);
         m_inputBits += 8;
     }
 
@@ -352,13 +750,9 @@ uint32_t PDFLzwStreamDecoder::getCode()
     return code;
 }
 
-QByteArray PDFLzwDecodeFilter::apply(const QByteArray& data,
-                                     const PDFObjectFetcher& objectFetcher,
-                                     const PDFObject& parameters,
-                                     const PDFSecurityHandler* securityHandler) const
+/// Returns EarlyChange parameter of the LZW filter
+static uint32_t getEarlyChange(const PDFObjectFetcher& objectFetcher, const PDFObject& parameters)
 {
-    Q_UNUSED(securityHandler);
-
     uint32_t early = 1;
 
     const PDFObject& dereferencedParameters = objectFetcher(parameters);
@@ -373,42 +767,202 @@ QByteArray PDFLzwDecodeFilter::apply(const QByteArray& data,
         }
     }
 
-    PDFStreamPredictor predictor = PDFStreamPredictor::createPredictor(objectFetcher, parameters);
-    PDFLzwStreamDecoder decoder(data, early);
-    return predictor.apply(decoder.decompress());
+    return early;
 }
 
-QByteArray PDFFlateDecodeFilter::apply(const QByteArray& data,
-                                       const PDFObjectFetcher& objectFetcher,
-                                       const PDFObject& parameters,
-                                       const PDFSecurityHandler* securityHandler) const
+QByteArray PDFLzwDecodeFilter::apply(const QByteArray& data,
+                                     const PDFObjectFetcher& objectFetcher,
+                                     const PDFObject& parameters,
+                                     const PDFSecurityHandler* securityHandler) const
 {
     Q_UNUSED(securityHandler);
 
+    const uint32_t early = getEarlyChange(objectFetcher, parameters);
     PDFStreamPredictor predictor = PDFStreamPredictor::createPredictor(objectFetcher, parameters);
-    return predictor.apply(uncompress(data));
+    PDFLzwStreamDecoder decoder(std::make_unique<PDFByteArrayStreamReader>(data), early);
+    return predictor.apply(decoder.decompress(data.size()));
 }
 
-QByteArray PDFFlateDecodeFilter::compress(const QByteArray& decompressedData)
+class PDFLzwStreamReader : public PDFBufferedStreamReader
 {
-    QByteArray result;
+public:
+    // Decoder pulls the input data itself, so input of the base class is not used
+    explicit inline PDFLzwStreamReader(PDFStreamReaderPointer input, uint32_t early) :
+        PDFBufferedStreamReader(nullptr),
+        m_decoder(std::move(input), early)
+    {
 
-    z_stream stream = { };
-    stream.next_in = const_cast<Bytef*>(convertByteArrayToUcharPtr(decompressedData));
-    stream.avail_in = decompressedData.size();
+    }
 
-    std::array<Bytef, 1024> outputBuffer = { };
+protected:
+    virtual bool decode(QByteArray& buffer) override;
 
-    int error = deflateInit(&stream, Z_BEST_COMPRESSION);
-    if (error != Z_OK)
+private:
+    PDFLzwStreamDecoder m_decoder;
+};
+
+bool PDFLzwStreamReader::decode(QByteArray& buffer)
+{
+    while (buffer.size() < CHUNK_SIZE)
     {
-        throw PDFException(PDFTranslationContext::tr("Failed to initialize flate compression stream."));
+        if (!m_decoder.decodeNext(buffer))
+        {
+            return false;
+        }
     }
 
-    do
-    {
-        stream.next_out = outputBuffer.data();
-        stream.avail_out = static_cast<uInt>(outputBuffer.size());
+    return true;
+}
+
+PDFStreamReaderPointer PDFLzwDecodeFilter::createReader(PDFStreamReaderPointer input,
+                                                        const PDFObjectFetcher& objectFetcher,
+                                                        const PDFObject& parameters,
+                                                        const PDFSecurityHandler* securityHandler) const
+{
+    Q_UNUSED(securityHandler);
+
+    PDFStreamPredictor predictor = PDFStreamPredictor::createPredictor(objectFetcher, parameters);
+    return predictor.createReader(std::make_unique<PDFLzwStreamReader>(std::move(input), getEarlyChange(objectFetcher, parameters)));
+}
+
+QByteArray PDFFlateDecodeFilter::apply(const QByteArray& data,
+                                       const PDFObjectFetcher& objectFetcher,
+                                       const PDFObject& parameters,
+                                       const PDFSecurityHandler* securityHandler) const
+{
+    return applyWithSizeHint(data, objectFetcher, parameters, securityHandler, -1);
+}
+
+QByteArray PDFFlateDecodeFilter::applyWithSizeHint(const QByteArray& data,
+                                                   const PDFObjectFetcher& objectFetcher,
+                                                   const PDFObject& parameters,
+                                                   const PDFSecurityHandler* securityHandler,
+                                                   PDFInteger decodedSizeHint) const
+{
+    Q_UNUSED(securityHandler);
+
+    PDFStreamPredictor predictor = PDFStreamPredictor::createPredictor(objectFetcher, parameters);
+    const PDFInteger decompressedSizeHint = decodedSizeHint > 0 ? predictor.getEncodedDataSize(decodedSizeHint) : -1;
+    return predictor.apply(uncompress(data, decompressedSizeHint));
+}
+
+#ifdef PDF4QT_USE_LIBDEFLATE
+static std::atomic<PDFFlateDecodeFilter::Backend> s_flateBackend = PDFFlateDecodeFilter::Backend::Libdeflate;
+
+struct PDFLibdeflateDeleter
+{
+    void operator()(libdeflate_decompressor* decompressor) const { libdeflate_free_decompressor(decompressor); }
+    void operator()(libdeflate_compressor* compressor) const { libdeflate_free_compressor(compressor); }
+};
+
+/// Decompresses whole buffer using libdeflate. If decompression fails,
+/// nothing is returned, and zlib is used to decompress the data (and to
+/// report the error, or to ignore the checksum error, as zlib path does).
+static std::optional<QByteArray> uncompressLibdeflate(const QByteArray& data, PDFInteger decompressedSizeHint)
+{
+    constexpr qint64 MAX_BUFFER_SIZE = qint64(1) << 30;
+
+    // Decompressor is not thread safe, so each thread uses its own one
+    thread_local std::unique_ptr<libdeflate_decompressor, PDFLibdeflateDeleter> decompressor(libdeflate_alloc_decompressor());
+    if (!decompressor)
+    {
+        return std::nullopt;
+    }
+
+    qint64 bufferSize = decompressedSizeHint > 0 ? decompressedSizeHint : qMax<qint64>(qint64(data.size()) * 4, 4096);
+    while (bufferSize <= MAX_BUFFER_SIZE)
+    {
+        QByteArray result(bufferSize, Qt::Uninitialized);
+        size_t actualSize = 0;
+
+        switch (libdeflate_zlib_decompress(decompressor.get(), data.constData(), data.size(), result.data(), result.size(), &actualSize))
+        {
+            case LIBDEFLATE_SUCCESS:
+                result.resize(actualSize);
+                return result;
+
+            case LIBDEFLATE_INSUFFICIENT_SPACE:
+                bufferSize *= 2;
+                break;
+
+            default:
+                return std::nullopt;
+        }
+    }
+
+    return std::nullopt;
+}
+#else
+static std::atomic<PDFFlateDecodeFilter::Backend> s_flateBackend = PDFFlateDecodeFilter::Backend::Zlib;
+#endif
+
+bool PDFFlateDecodeFilter::isBackendAvailable(Backend backend)
+{
+    switch (backend)
+    {
+        case Backend::Zlib:
+            return true;
+
+        case Backend::Libdeflate:
+#ifdef PDF4QT_USE_LIBDEFLATE
+            return true;
+#else
+            return false;
+#endif
+    }
+
+    return false;
+}
+
+PDFFlateDecodeFilter::Backend PDFFlateDecodeFilter::getBackend()
+{
+    return s_flateBackend.load(std::memory_order_relaxed);
+}
+
+void PDFFlateDecodeFilter::setBackend(Backend backend)
+{
+    s_flateBackend.store(isBackendAvailable(backend) ? backend : Backend::Zlib, std::memory_order_relaxed);
+}
+
+QByteArray PDFFlateDecodeFilter::compress(const QByteArray& decompressedData)
+{
+#ifdef PDF4QT_USE_LIBDEFLATE
+    if (getBackend() == Backend::Libdeflate)
+    {
+        // Compression level 12 is the maximal compression level of libdeflate
+        thread_local std::unique_ptr<libdeflate_compressor, PDFLibdeflateDeleter> compressor(libdeflate_alloc_compressor(12));
+        if (compressor)
+        {
+            QByteArray compressedData(libdeflate_zlib_compress_bound(compressor.get(), decompressedData.size()), Qt::Uninitialized);
+            const size_t compressedSize = libdeflate_zlib_compress(compressor.get(), decompressedData.constData(), decompressedData.size(), compressedData.data(), compressedData.size());
+
+            if (compressedSize > 0)
+            {
+                compressedData.resize(compressedSize);
+                return compressedData;
+            }
+        }
+    }
+#endif
+
+    QByteArray result;
+
+    z_stream stream = { };
+    stream.next_in = const_cast<Bytef*>(convertByteArrayToUcharPtr(decompressedData));
+    stream.avail_in = decompressedData.size();
+
+    std::array<Bytef, 1024> outputBuffer = { };
+
+    int error = deflateInit(&stream, Z_BEST_COMPRESSION);
+    if (error != Z_OK)
+    {
+        throw PDFException(PDFTranslationContext::tr("Failed to initialize flate compression stream."));
+    }
+
+    do
+    {
+        stream.next_out = outputBuffer.data();
+        stream.avail_out = static_cast<uInt>(outputBuffer.size());
 
         error = deflate(&stream, Z_FINISH);
 
@@ -487,7 +1041,29 @@ PDFInteger PDFFlateDecodeFilter::getStreamDataLength(const QByteArray& data, PDF
     return -1;
 }
 
-QByteArray PDFFlateDecodeFilter::uncompress(const QByteArray& data)
+QByteArray PDFFlateDecodeFilter::uncompress(const QByteArray& data, PDFInteger decompressedSizeHint)
+{
+    // Deflate can't compress data with higher ratio than 1032:1, so larger hint
+    // is invalid. We do not allocate such buffer.
+    if (decompressedSizeHint > qint64(data.size()) * 1032 + 4096)
+    {
+        decompressedSizeHint = -1;
+    }
+
+#ifdef PDF4QT_USE_LIBDEFLATE
+    if (getBackend() == Backend::Libdeflate)
+    {
+        if (std::optional<QByteArray> result = uncompressLibdeflate(data, decompressedSizeHint))
+        {
+            return std::move(*result);
+        }
+    }
+#endif
+
+    return uncompressZlib(data, decompressedSizeHint);
+}
+
+QByteArray PDFFlateDecodeFilter::uncompressZlib(const QByteArray& data, PDFInteger decompressedSizeHint)
 {
     QByteArray result;
 
@@ -503,7 +1079,20 @@ QByteArray PDFFlateDecodeFilter::uncompress(const QByteArray& data)
         throw PDFException(PDFTranslationContext::tr("Failed to initialize flate decompression stream."));
     }
 
-    do
+    if (decompressedSizeHint > 0 && decompressedSizeHint <= std::numeric_limits<uInt>::max())
+    {
+        // Decompress directly into the result buffer. If the hint was correct,
+        // whole stream is decompressed in one step, otherwise we continue
+        // with decompression by chunks.
+        result.resize(decompressedSizeHint);
+        stream.next_out = reinterpret_cast<Bytef*>(result.data());
+        stream.avail_out = static_cast<uInt>(result.size());
+
+        error = inflate(&stream, Z_NO_FLUSH);
+        result.resize(result.size() - stream.avail_out);
+    }
+
+    while (error == Z_OK)
     {
         stream.next_out = outputBuffer.data();
         stream.avail_out = static_cast<uInt>(outputBuffer.size());
@@ -512,7 +1101,7 @@ QByteArray PDFFlateDecodeFilter::uncompress(const QByteArray& data)
 
         int bytesWritten = int(outputBuffer.size()) - stream.avail_out;
         result.append(reinterpret_cast<const char*>(outputBuffer.data()), bytesWritten);
-    } while (error == Z_OK);
+    }
 
     QString errorMessage;
     if (stream.msg)
@@ -546,6 +1135,97 @@ QByteArray PDFFlateDecodeFilter::uncompress(const QByteArray& data)
     return result;
 }
 
+class PDFFlateStreamReader : public PDFBufferedStreamReader
+{
+public:
+    explicit PDFFlateStreamReader(PDFStreamReaderPointer input);
+    virtual ~PDFFlateStreamReader() override;
+
+protected:
+    virtual bool decode(QByteArray& buffer) override;
+
+private:
+    z_stream m_stream;
+};
+
+PDFFlateStreamReader::PDFFlateStreamReader(PDFStreamReaderPointer input) :
+    PDFBufferedStreamReader(std::move(input)),
+    m_stream()
+{
+    if (inflateInit(&m_stream) != Z_OK)
+    {
+        throw PDFException(PDFTranslationContext::tr("Failed to initialize flate decompression stream."));
+    }
+}
+
+PDFFlateStreamReader::~PDFFlateStreamReader()
+{
+    inflateEnd(&m_stream);
+}
+
+bool PDFFlateStreamReader::decode(QByteArray& buffer)
+{
+    int error = Z_BUF_ERROR;
+
+    if (m_input.fill())
+    {
+        buffer.resize(CHUNK_SIZE);
+
+        const qint64 availableInput = qMin<qint64>(m_input.available(), std::numeric_limits<uInt>::max());
+        m_stream.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(m_input.data()));
+        m_stream.avail_in = static_cast<uInt>(availableInput);
+        m_stream.next_out = reinterpret_cast<Bytef*>(buffer.data());
+        m_stream.avail_out = static_cast<uInt>(buffer.size());
+
+        error = inflate(&m_stream, Z_NO_FLUSH);
+
+        m_input.consume(availableInput - m_stream.avail_in);
+        buffer.resize(buffer.size() - m_stream.avail_out);
+    }
+
+    switch (error)
+    {
+        case Z_OK:
+            return true;
+
+        case Z_STREAM_END:
+            return false; // No error, normal behaviour
+
+        default:
+        {
+            QString errorMessage;
+            if (m_stream.msg)
+            {
+                errorMessage = QString::fromLatin1(m_stream.msg);
+            }
+
+            if (error == Z_DATA_ERROR && errorMessage == "incorrect data check")
+            {
+                // Same as in PDFFlateDecodeFilter::uncompress, we ignore checksum errors
+                return false;
+            }
+
+            if (errorMessage.isEmpty())
+            {
+                errorMessage = PDFTranslationContext::tr("zlib code: %1").arg(error);
+            }
+
+            throw PDFException(PDFTranslationContext::tr("Error decompressing by flate method: %1").arg(errorMessage));
+        }
+    }
+}
+
+PDFStreamReaderPointer PDFFlateDecodeFilter::createReader(PDFStreamReaderPointer input,
+                                                          const PDFObjectFetcher& objectFetcher,
+                                                          const PDFObject& parameters,
+                                                          const PDFSecurityHandler* securityHandler) const
+{
+    Q_UNUSED(securityHandler);
+
+    PDFStreamPredictor predictor = PDFStreamPredictor::createPredictor(objectFetcher, parameters);
+    return predictor.createReader(std::make_unique<PDFFlateStreamReader>(std::move(input)));
+}
+
 QByteArray PDFRunLengthDecodeFilter::apply(const QByteArray& data,
                                            const PDFObjectFetcher& objectFetcher,
                                            const PDFObject& parameters,
@@ -586,6 +1266,61 @@ QByteArray PDFRunLengthDecodeFilter::apply(const QByteArray& data,
     return result;
 }
 
+class PDFRunLengthStreamReader : public PDFBufferedStreamReader
+{
+public:
+    using PDFBufferedStreamReader::PDFBufferedStreamReader;
+
+protected:
+    virtual bool decode(QByteArray& buffer) override;
+};
+
+bool PDFRunLengthStreamReader::decode(QByteArray& buffer)
+{
+    while (buffer.size() < CHUNK_SIZE)
+    {
+        const int current = m_input.get();
+        if (current == -1 || current == 128)
+        {
+            // End of stream marker
+            return false;
+        }
+        else if (current < 128)
+        {
+            // Copy n + 1 characters from the input literally
+            const int count = current + 1;
+            const int offset = buffer.size();
+            buffer.resize(offset + count);
+            buffer.resize(offset + m_input.read(buffer.data() + offset, count));
+        }
+        else
+        {
+            // Copy 257 - n copies of single character
+            const int count = 257 - current;
+            const int toBeCopied = m_input.get();
+            if (toBeCopied == -1)
+            {
+                return false;
+            }
+            buffer.append(count, static_cast<char>(toBeCopied));
+        }
+    }
+
+    return true;
+}
+
+PDFStreamReaderPointer PDFRunLengthDecodeFilter::createReader(PDFStreamReaderPointer input,
+                                                              const PDFObjectFetcher& objectFetcher,
+                                                              const PDFObject& parameters,
+                                                              const PDFSecurityHandler* securityHandler) const
+{
+    Q_UNUSED(objectFetcher);
+    Q_UNUSED(parameters);
+    Q_UNUSED(securityHandler);
+
+    return std::make_unique<PDFRunLengthStreamReader>(std::move(input));
+}
+
 const PDFStreamFilter* PDFStreamFilterStorage::getFilter(const QByteArray& filterName)
 {
     const PDFStreamFilterStorage* instance = getInstance();
@@ -680,8 +1415,10 @@ PDFStreamFilterStorage::StreamFilters PDFStreamFilterStorage::getStreamFilters(c
 
 QByteArray PDFStreamFilterStorage::getDecodedStream(const PDFStream* stream, const PDFObjectFetcher& objectFetcher, const PDFSecurityHandler* securityHandler)
 {
+    PDF_TRACE_ZONE("DecodeStream", "filter");
+
     StreamFilters streamFilters = getStreamFilters(stream, objectFetcher);
-    QByteArray result = *stream->getContent();
+    QByteArray result = stream->getDecryptedContent();
 
     if (!streamFilters.valid)
     {
@@ -689,6 +1426,14 @@ QByteArray PDFStreamFilterStorage::getDecodedStream(const PDFStream* stream, con
         return QByteArray();
     }
 
+    // Size of decoded data (after all filters are applied) can be stored in the dictionary
+    PDFInteger decodedSizeHint = -1;
+    const PDFObject& decodedLengthObject = objectFetcher(stream->getDictionary()->get(PDF_STREAM_DICT_DECODED_LENGTH));
+    if (decodedLengthObject.isInt())
+    {
+        decodedSizeHint = decodedLengthObject.getInteger();
+    }
+
     for (size_t i = 0, count = streamFilters.filterObjects.size(); i < count; ++i)
     {
         const PDFStreamFilter* streamFilter = streamFilters.filterObjects[i];
@@ -696,7 +1441,14 @@ QByteArray PDFStreamFilterStorage::getDecodedStream(const PDFStream* stream, con
 
         if (streamFilter)
         {
-            result = streamFilter->apply(result, objectFetcher, streamFilterParameters, securityHandler);
+            if (i + 1 == count)
+            {
+                result = streamFilter->applyWithSizeHint(result, objectFetcher, streamFilterParameters, securityHandler, decodedSizeHint);
+            }
+            else
+            {
+                result = streamFilter->apply(result, objectFetcher, streamFilterParameters, securityHandler);
+            }
         }
     }
 
@@ -708,6 +1460,36 @@ QByteArray PDFStreamFilterStorage::getDecodedStream(const PDFStream* stream, con
     return getDecodedStream(stream, [](const PDFObject& object) -> const PDFObject& { return object; }, securityHandler);
 }
 
+PDFStreamReaderPointer PDFStreamFilterStorage::createDecodedStreamReader(const PDFStream* stream, const PDFObjectFetcher& objectFetcher, const PDFSecurityHandler* securityHandler)
+{
+    StreamFilters streamFilters = getStreamFilters(stream, objectFetcher);
+
+    if (!streamFilters.valid)
+    {
+        // Stream filters are invalid
+        return std::make_unique<PDFByteArrayStreamReader>(QByteArray());
+    }
+
+    PDFStreamReaderPointer reader = std::make_unique<PDFByteArrayStreamReader>(stream->getDecryptedContent());
+    for (size_t i = 0, count = streamFilters.filterObjects.size(); i < count; ++i)
+    {
+        const PDFStreamFilter* streamFilter = streamFilters.filterObjects[i];
+        const PDFObject& streamFilterParameters = streamFilters.filterParameterObjects[i];
+
+        if (streamFilter)
+        {
+            reader = streamFilter->createReader(std::move(reader), objectFetcher, streamFilterParameters, securityHandler);
+        }
+    }
+
+    return reader;
+}
+
+PDFStreamReaderPointer PDFStreamFilterStorage::createDecodedStreamReader(const PDFStream* stream, const PDFSecurityHandler* securityHandler)
+{
+    return createDecodedStreamReader(stream, [](const PDFObject& object) -> const PDFObject& { return object; }, securityHandler);
+}
+
 PDFInteger PDFStreamFilterStorage::getStreamDataLength(const QByteArray& data, const QByteArray& filterName, PDFInteger offset)
 {
     if (const PDFStreamFilter* filter = getFilter(filterName))
@@ -743,47 +1525,478 @@ const PDFStreamFilterStorage* PDFStreamFilterStorage::getInstance()
     return &instance;
 }
 
-PDFStreamPredictor PDFStreamPredictor::createPredictor(const PDFObjectFetcher& objectFetcher, const PDFObject& parameters)
+namespace
 {
-    const PDFObject& dereferencedParameters = objectFetcher(parameters);
-    if (dereferencedParameters.isDictionary())
+
+#if defined(PDF4QT_STREAM_PREDICTOR_SSE2)
+
+using Vector = __m128i;
+
+inline Vector zero() { return _mm_setzero_si128(); }
+inline Vector load(const uint8_t* data) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)); }
+inline void store(uint8_t* data, Vector vector) { _mm_storeu_si128(reinterpret_cast<__m128i*>(data), vector); }
+inline Vector fromLow(uint64_t value) { return _mm_set_epi64x(0, static_cast<long long>(value)); }
+#if defined(__x86_64__) || defined(_M_X64)
+inline uint64_t toLow(Vector vector) { return static_cast<uint64_t>(_mm_cvtsi128_si64(vector)); }
+#else
+inline uint64_t toLow(Vector vector) { uint64_t value = 0; _mm_storel_epi64(reinterpret_cast<__m128i*>(&value), vector); return value; }
+#endif
+inline Vector bitOr(Vector a, Vector b) { return _mm_or_si128(a, b); }
+inline Vector select(Vector mask, Vector a, Vector b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+inline Vector add8(Vector a, Vector b) { return _mm_add_epi8(a, b); }
+inline Vector add16(Vector a, Vector b) { return _mm_add_epi16(a, b); }
+inline Vector sub16(Vector a, Vector b) { return _mm_sub_epi16(a, b); }
+inline Vector half16(Vector vector) { return _mm_srli_epi16(vector, 1); }
+inline Vector abs16(Vector vector) { return _mm_max_epi16(vector, _mm_sub_epi16(zero(), vector)); }
+inline Vector greater16(Vector a, Vector b) { return _mm_cmpgt_epi16(a, b); }
+inline Vector swapBytes16(Vector vector) { return _mm_or_si128(_mm_slli_epi16(vector, 8), _mm_srli_epi16(vector, 8)); }
+
+/// Widens low 8 bytes to 16-bit values
+inline Vector widen(Vector vector) { return _mm_unpacklo_epi8(vector, zero()); }
+
+/// Narrows 16-bit values (which must be in range 0-255) to low 8 bytes
+inline Vector narrow(Vector vector) { return _mm_packus_epi16(vector, vector); }
+
+/// Shifts bytes towards higher addresses, free bytes are filled with zeros
+template<int Bytes>
+inline Vector shiftBytes(Vector vector) { return _mm_slli_si128(vector, Bytes); }
+
+/// Fills the vector with the last pixel of the vector
+template<int PixelBytes>
+inline Vector broadcastLastPixel(Vector vector)
+{
+    if constexpr (PixelBytes == 1)
     {
-        const PDFDictionary* dictionary = dereferencedParameters.getDictionary();
+        const Vector words = _mm_shufflehi_epi16(_mm_unpackhi_epi8(vector, vector), _MM_SHUFFLE(3, 3, 3, 3));
+        return _mm_unpackhi_epi64(words, words);
+    }
+    else if constexpr (PixelBytes == 2)
+    {
+        const Vector words = _mm_shufflehi_epi16(vector, _MM_SHUFFLE(3, 3, 3, 3));
+        return _mm_unpackhi_epi64(words, words);
+    }
+    else if constexpr (PixelBytes == 4)
+    {
+        return _mm_shuffle_epi32(vector, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+    else
+    {
+        static_assert(PixelBytes == 8);
+        return _mm_unpackhi_epi64(vector, vector);
+    }
+}
 
-        auto getInteger = [dictionary, &objectFetcher](const char* key, int min, int max, int defaultValue) -> int
-        {
-            const PDFObject& object = objectFetcher(dictionary->get(key));
+#endif
 
-            if (object.isInt())
-            {
-                PDFInteger value = object.getInteger();
-                if (value < min || value > max)
-                {
-                    throw PDFException(PDFTranslationContext::tr("Property '%1' should be in range from %2 to %3.").arg(QString::fromLatin1(key)).arg(min).arg(max));
-                }
+#if defined(PDF4QT_STREAM_PREDICTOR_NEON)
 
-                return value;
-            }
-            else if (object.isNull())
-            {
-                return defaultValue;
-            }
+using Vector = uint8x16_t;
 
-            throw PDFException(PDFTranslationContext::tr("Invalid property '%1' of the stream predictor parameters.").arg(QString::fromLatin1(key)));
-        };
+inline uint16x8_t u16(Vector vector) { return vreinterpretq_u16_u8(vector); }
+inline int16x8_t s16(Vector vector) { return vreinterpretq_s16_u8(vector); }
 
-        int predictor = getInteger("Predictor", 1, 15, 1);
-        int components = getInteger("Colors", 1, PDF_MAX_COLOR_COMPONENTS, 1);
-        int bitsPerComponent = getInteger("BitsPerComponent", 1, 16, 8);
-        int columns = getInteger("Columns", 1, std::numeric_limits<int>::max(), 1);
+inline Vector zero() { return vdupq_n_u8(0); }
+inline Vector load(const uint8_t* data) { return vld1q_u8(data); }
+inline void store(uint8_t* data, Vector vector) { vst1q_u8(data, vector); }
+inline Vector fromLow(uint64_t value) { return vcombine_u8(vcreate_u8(value), vcreate_u8(0)); }
+inline uint64_t toLow(Vector vector) { return vgetq_lane_u64(vreinterpretq_u64_u8(vector), 0); }
+inline Vector bitOr(Vector a, Vector b) { return vorrq_u8(a, b); }
+inline Vector select(Vector mask, Vector a, Vector b) { return vbslq_u8(mask, a, b); }
+inline Vector add8(Vector a, Vector b) { return vaddq_u8(a, b); }
+inline Vector add16(Vector a, Vector b) { return vreinterpretq_u8_u16(vaddq_u16(u16(a), u16(b))); }
+inline Vector sub16(Vector a, Vector b) { return vreinterpretq_u8_u16(vsubq_u16(u16(a), u16(b))); }
+inline Vector half16(Vector vector) { return vreinterpretq_u8_u16(vshrq_n_u16(u16(vector), 1)); }
+inline Vector abs16(Vector vector) { return vreinterpretq_u8_s16(vabsq_s16(s16(vector))); }
+inline Vector greater16(Vector a, Vector b) { return vreinterpretq_u8_u16(vcgtq_s16(s16(a), s16(b))); }
+inline Vector swapBytes16(Vector vector) { return vrev16q_u8(vector); }
 
-        return PDFStreamPredictor(static_cast<Predictor>(predictor), components, bitsPerComponent, columns);
-    }
+/// Widens low 8 bytes to 16-bit values
+inline Vector widen(Vector vector) { return vreinterpretq_u8_u16(vmovl_u8(vget_low_u8(vector))); }
 
-    return PDFStreamPredictor();
-}
+/// Narrows 16-bit values (which must be in range 0-255) to low 8 bytes
+inline Vector narrow(Vector vector) { return vcombine_u8(vmovn_u16(u16(vector)), vdup_n_u8(0)); }
+
+/// Shifts bytes towards higher addresses, free bytes are filled with zeros
+template<int Bytes>
+inline Vector shiftBytes(Vector vector) { return vextq_u8(zero(), vector, 16 - Bytes); }
 
-QByteArray PDFStreamPredictor::apply(const QByteArray& data) const
+/// Fills the vector with the last pixel of the vector
+template<int PixelBytes>
+inline Vector broadcastLastPixel(Vector vector)
+{
+    if constexpr (PixelBytes == 1)
+    {
+        return vdupq_n_u8(vgetq_lane_u8(vector, 15));
+    }
+    else if constexpr (PixelBytes == 2)
+    {
+        return vreinterpretq_u8_u16(vdupq_n_u16(vgetq_lane_u16(u16(vector), 7)));
+    }
+    else if constexpr (PixelBytes == 4)
+    {
+        return vreinterpretq_u8_u32(vdupq_n_u32(vgetq_lane_u32(vreinterpretq_u32_u8(vector), 3)));
+    }
+    else
+    {
+        static_assert(PixelBytes == 8);
+        return vreinterpretq_u8_u64(vdupq_n_u64(vgetq_lane_u64(vreinterpretq_u64_u8(vector), 1)));
+    }
+}
+
+#endif
+
+#if defined(PDF4QT_STREAM_PREDICTOR_SIMD)
+
+constexpr int VECTOR_SIZE = 16;
+
+/// Pixels are loaded and stored by words of 4 or 8 bytes, so the compiler
+/// can use single instruction instead of the sequence of byte loads.
+template<int PixelBytes>
+constexpr int PIXEL_WORD_SIZE = PixelBytes <= 4 ? 4 : 8;
+
+/// Loads pixel into low bytes of the vector, other bytes are zero. If \p word
+/// is true, then whole word can be read from the memory.
+template<int PixelBytes>
+inline Vector loadPixel(const uint8_t* data, bool word)
+{
+    uint64_t value = 0;
+    if (word)
+    {
+        if constexpr (PIXEL_WORD_SIZE<PixelBytes> == 4)
+        {
+            uint32_t wordValue = 0;
+            std::memcpy(&wordValue, data, sizeof(wordValue));
+            value = wordValue;
+        }
+        else
+        {
+            std::memcpy(&value, data, sizeof(value));
+        }
+
+        if constexpr (PixelBytes < 8)
+        {
+            value &= (uint64_t(1) << (8 * PixelBytes)) - 1;
+        }
+    }
+    else
+    {
+        std::memcpy(&value, data, PixelBytes);
+    }
+    return fromLow(value);
+}
+
+/// Stores pixel from low bytes of the vector. If \p word is true, then whole
+/// word is written to the memory (bytes after the pixel are overwritten).
+template<int PixelBytes>
+inline void storePixel(uint8_t* data, Vector vector, bool word)
+{
+    const uint64_t value = toLow(vector);
+    if (word && PIXEL_WORD_SIZE<PixelBytes> == 4)
+    {
+        const uint32_t wordValue = static_cast<uint32_t>(value);
+        std::memcpy(data, &wordValue, sizeof(wordValue));
+    }
+    else
+    {
+        std::memcpy(data, &value, word ? PIXEL_WORD_SIZE<PixelBytes> : PixelBytes);
+    }
+}
+
+/// Computes line[i] = line[i - PixelBytes] + input[i]. Pixels inside the vector
+/// are summed by shifting the vector, last pixel of the previous vector is
+/// then added to all pixels of the current vector.
+template<int PixelBytes>
+void decodeSubVectorized(const uint8_t* input, uint8_t* line, int size)
+{
+    Vector carry = zero();
+
+    int i = 0;
+    for (; i + VECTOR_SIZE <= size; i += VECTOR_SIZE)
+    {
+        Vector vector = load(input + i);
+        vector = add8(vector, shiftBytes<PixelBytes>(vector));
+
+        if constexpr (PixelBytes * 2 < VECTOR_SIZE)
+        {
+            vector = add8(vector, shiftBytes<PixelBytes * 2>(vector));
+        }
+        if constexpr (PixelBytes * 4 < VECTOR_SIZE)
+        {
+            vector = add8(vector, shiftBytes<PixelBytes * 4>(vector));
+        }
+        if constexpr (PixelBytes * 8 < VECTOR_SIZE)
+        {
+            vector = add8(vector, shiftBytes<PixelBytes * 8>(vector));
+        }
+
+        vector = add8(vector, carry);
+        store(line + i, vector);
+        carry = broadcastLastPixel<PixelBytes>(vector);
+    }
+
+    for (; i < size; ++i)
+    {
+        line[i] = (i >= PixelBytes ? line[i - PixelBytes] : 0) + input[i];
+    }
+}
+
+void decodeUpVectorized(const uint8_t* input, uint8_t* line, const uint8_t* previousLine, int size)
+{
+    int i = 0;
+    for (; i + VECTOR_SIZE <= size; i += VECTOR_SIZE)
+    {
+        store(line + i, add8(load(input + i), load(previousLine + i)));
+    }
+
+    for (; i < size; ++i)
+    {
+        line[i] = previousLine[i] + input[i];
+    }
+}
+
+/// Average predictor, whole pixel is processed at once using 16-bit values
+template<int PixelBytes>
+void decodeAverageVectorized(const uint8_t* input, uint8_t* line, const uint8_t* previousLine, int size)
+{
+    Vector left = zero();
+
+    int i = 0;
+    for (; i + PixelBytes <= size; i += PixelBytes)
+    {
+        const bool word = i + PIXEL_WORD_SIZE<PixelBytes> <= size;
+        const Vector upper = widen(loadPixel<PixelBytes>(previousLine + i, word));
+        const Vector current = add8(loadPixel<PixelBytes>(input + i, word), narrow(half16(add16(left, upper))));
+        storePixel<PixelBytes>(line + i, current, word);
+        left = widen(current);
+    }
+
+    Q_ASSERT(i == size);
+}
+
+/// Paeth predictor, whole pixel is processed at once using 16-bit values
+template<int PixelBytes>
+void decodePaethVectorized(const uint8_t* input, uint8_t* line, const uint8_t* previousLine, int size)
+{
+    Vector left = zero();
+    Vector upperLeft = zero();
+
+    int i = 0;
+    for (; i + PixelBytes <= size; i += PixelBytes)
+    {
+        const bool word = i + PIXEL_WORD_SIZE<PixelBytes> <= size;
+        const Vector upper = widen(loadPixel<PixelBytes>(previousLine + i, word));
+
+        // p = a + b - c, pa = |p - a| = |b - c|, pb = |p - b| = |a - c|, pc = |p - c|
+        const Vector pa = abs16(sub16(upper, upperLeft));
+        const Vector pb = abs16(sub16(left, upperLeft));
+        const Vector pc = abs16(sub16(add16(left, upper), add16(upperLeft, upperLeft)));
+
+        const Vector upperOrUpperLeft = select(greater16(pb, pc), upperLeft, upper);
+        const Vector predicted = select(bitOr(greater16(pa, pb), greater16(pa, pc)), upperOrUpperLeft, left);
+
+        const Vector current = add8(loadPixel<PixelBytes>(input + i, word), narrow(predicted));
+        storePixel<PixelBytes>(line + i, current, word);
+
+        left = widen(current);
+        upperLeft = upper;
+    }
+
+    Q_ASSERT(i == size);
+}
+
+/// TIFF predictor for 16-bit components, whole pixel is processed at once
+template<int PixelBytes>
+void decodeTIFF16Vectorized(const uint8_t* input, uint8_t* line, int size)
+{
+    Vector left = zero();
+
+    int i = 0;
+    for (; i + PixelBytes <= size; i += PixelBytes)
+    {
+        // Components are stored in big endian order
+        const bool word = i + PIXEL_WORD_SIZE<PixelBytes> <= size;
+        left = add16(left, swapBytes16(loadPixel<PixelBytes>(input + i, word)));
+        storePixel<PixelBytes>(line + i, swapBytes16(left), word);
+    }
+
+    Q_ASSERT(i == size);
+}
+
+#endif
+
+/// Computes line[i] = line[i - pixelBytes] + input[i]
+void decodeSub(int pixelBytes, const uint8_t* input, uint8_t* line, int size)
+{
+#if defined(PDF4QT_STREAM_PREDICTOR_SIMD)
+    switch (pixelBytes)
+    {
+        case 1:
+            decodeSubVectorized<1>(input, line, size);
+            return;
+
+        case 2:
+            decodeSubVectorized<2>(input, line, size);
+            return;
+
+        case 4:
+            decodeSubVectorized<4>(input, line, size);
+            return;
+
+        case 8:
+            decodeSubVectorized<8>(input, line, size);
+            return;
+
+        default:
+            break;
+    }
+#endif
+
+    const int firstPixelBytes = qMin(pixelBytes, size);
+    std::copy(input, input + firstPixelBytes, line);
+    for (int i = pixelBytes; i < size; ++i)
+    {
+        line[i] = line[i - pixelBytes] + input[i];
+    }
+}
+
+/// Decodes PNG predictor line using optimized kernel. Returns false,
+/// if there is no optimized kernel for given predictor and pixel size.
+bool decodePNGLineOptimized(int predictor, int pixelBytes, const uint8_t* input, uint8_t* line, const uint8_t* previousLine, int size)
+{
+    [[maybe_unused]] constexpr int PNG_SUB = 11;
+    [[maybe_unused]] constexpr int PNG_UP = 12;
+    [[maybe_unused]] constexpr int PNG_AVERAGE = 13;
+    [[maybe_unused]] constexpr int PNG_PAETH = 14;
+
+    switch (predictor)
+    {
+        case PNG_SUB:
+            decodeSub(pixelBytes, input, line, size);
+            return true;
+
+#if defined(PDF4QT_STREAM_PREDICTOR_SIMD)
+        case PNG_UP:
+            decodeUpVectorized(input, line, previousLine, size);
+            return true;
+
+        case PNG_AVERAGE:
+        case PNG_PAETH:
+        {
+            // Only whole pixels with at least three bytes are processed by
+            // kernels, for smaller pixels, reference implementation is faster.
+            if (pixelBytes < 3 || pixelBytes > 8 || size % pixelBytes != 0)
+            {
+                return false;
+            }
+
+            using Kernel = void(*)(const uint8_t*, uint8_t*, const uint8_t*, int);
+            static constexpr Kernel averageKernels[] = { decodeAverageVectorized<3>, decodeAverageVectorized<4>, decodeAverageVectorized<5>,
+                                                         decodeAverageVectorized<6>, decodeAverageVectorized<7>, decodeAverageVectorized<8> };
+            static constexpr Kernel paethKernels[] = { decodePaethVectorized<3>, decodePaethVectorized<4>, decodePaethVectorized<5>,
+                                                       decodePaethVectorized<6>, decodePaethVectorized<7>, decodePaethVectorized<8> };
+
+            const Kernel kernel = (predictor == PNG_AVERAGE) ? averageKernels[pixelBytes - 3] : paethKernels[pixelBytes - 3];
+            kernel(input, line, previousLine, size);
+            return true;
+        }
+#endif
+
+        default:
+            Q_UNUSED(previousLine);
+            return false;
+    }
+}
+
+/// Decodes TIFF predictor line with 8-bit components
+void decodeTIFFLine8(int components, const uint8_t* input, uint8_t* line, int size)
+{
+    decodeSub(components, input, line, size);
+}
+
+/// Decodes TIFF predictor line with 16-bit components
+void decodeTIFFLine16(int components, const uint8_t* input, uint8_t* line, int size)
+{
+#if defined(PDF4QT_STREAM_PREDICTOR_SIMD)
+    if (size % (2 * components) == 0)
+    {
+        switch (components)
+        {
+            case 1:
+                decodeTIFF16Vectorized<2>(input, line, size);
+                return;
+
+            case 2:
+                decodeTIFF16Vectorized<4>(input, line, size);
+                return;
+
+            case 3:
+                decodeTIFF16Vectorized<6>(input, line, size);
+                return;
+
+            case 4:
+                decodeTIFF16Vectorized<8>(input, line, size);
+                return;
+
+            default:
+                break;
+        }
+    }
+#endif
+
+    const int pixelBytes = 2 * components;
+    const int firstPixelBytes = qMin(pixelBytes, size);
+    std::copy(input, input + firstPixelBytes, line);
+    for (int i = pixelBytes; i + 1 < size; i += 2)
+    {
+        const uint16_t value = ((line[i - pixelBytes] << 8) | line[i - pixelBytes + 1]) + ((input[i] << 8) | input[i + 1]);
+        line[i] = static_cast<uint8_t>(value >> 8);
+        line[i + 1] = static_cast<uint8_t>(value);
+    }
+}
+
+}   // namespace
+
+PDFStreamPredictor PDFStreamPredictor::createPredictor(const PDFObjectFetcher& objectFetcher, const PDFObject& parameters)
+{
+    const PDFObject& dereferencedParameters = objectFetcher(parameters);
+    if (dereferencedParameters.isDictionary())
+    {
+        const PDFDictionary* dictionary = dereferencedParameters.getDictionary();
+
+        auto getInteger = [dictionary, &objectFetcher](const char* key, int min, int max, int defaultValue) -> int
+        {
+            const PDFObject& object = objectFetcher(dictionary->get(key));
+
+            if (object.isInt())
+            {
+                PDFInteger value = object.getInteger();
+                if (value < min || value > max)
+                {
+                    throw PDFException(PDFTranslationContext::tr("Property '%1' should be in range from %2 to %3.").arg(QString::fromLatin1(key)).arg(min).arg(max));
+                }
+
+                return value;
+            }
+            else if (object.isNull())
+            {
+                return defaultValue;
+            }
+
+            throw PDFException(PDFTranslationContext::tr("Invalid property '%1' of the stream predictor parameters.").arg(QString::fromLatin1(key)));
+        };
+
+        int predictor = getInteger("Predictor", 1, 15, 1);
+        int components = getInteger("Colors", 1, PDF_MAX_COLOR_COMPONENTS, 1);
+        int bitsPerComponent = getInteger("BitsPerComponent", 1, 16, 8);
+        int columns = getInteger("Columns", 1, std::numeric_limits<int>::max(), 1);
+
+        return PDFStreamPredictor(static_cast<Predictor>(predictor), components, bitsPerComponent, columns);
+    }
+
+    return PDFStreamPredictor();
+}
+
+QByteArray PDFStreamPredictor::apply(const QByteArray& data, Implementation implementation) const
 {
     switch (m_predictor)
     {
@@ -791,13 +2004,29 @@ QByteArray PDFStreamPredictor::apply(const QByteArray& data) const
             return data;
 
         case TIFF:
+        {
+            if (implementation == Implementation::Optimized && isTIFFLineDecodingOptimized() && m_stride > 0 && data.size() % m_stride == 0)
+            {
+                QByteArray outputData(data.size(), Qt::Uninitialized);
+
+                const uint8_t* input = convertByteArrayToUcharPtr(data);
+                uint8_t* output = reinterpret_cast<uint8_t*>(outputData.data());
+                for (qint64 offset = 0; offset < data.size(); offset += m_stride)
+                {
+                    decodeTIFFLine(input + offset, output + offset);
+                }
+
+                return outputData;
+            }
+
             return applyTIFFPredictor(data);
+        }
 
         default:
         {
             if (m_predictor >= 10)
             {
-                return applyPNGPredictor(data);
+                return applyPNGPredictor(data, implementation);
             }
             break;
         }
@@ -806,108 +2035,130 @@ QByteArray PDFStreamPredictor::apply(const QByteArray& data) const
     throw PDFException(PDFTranslationContext::tr("Invalid predictor algorithm."));
 }
 
-QByteArray PDFStreamPredictor::applyPNGPredictor(const QByteArray& data) const
+QByteArray PDFStreamPredictor::applyPNGPredictor(const QByteArray& data, Implementation implementation) const
 {
-    QByteArray outputData;
-    outputData.reserve(data.size());
+    const int encodedLineSize = getEncodedLineSize();
+    const int lineCount = (data.size() + encodedLineSize - 1) / encodedLineSize;
 
-    auto it = data.cbegin();
-    auto itEnd = data.cend();
+    QByteArray outputData(qint64(lineCount) * m_stride, Qt::Uninitialized);
 
-    int pixelBytes = (m_components * m_bitsPerComponent + 7) / 8;
+    const uint8_t* input = convertByteArrayToUcharPtr(data);
+    uint8_t* output = reinterpret_cast<uint8_t*>(outputData.data());
 
-    auto readByte = [&it, &itEnd]() -> uint8_t
+    // Previous line of the first line is filled with zeros
+    std::vector<uint8_t> zeroLine(m_stride, 0);
+    const uint8_t* previousLine = zeroLine.data();
+
+    for (int i = 0; i < lineCount; ++i)
     {
-        if (it != itEnd)
+        const uint8_t* encodedLine = input + qint64(i) * encodedLineSize;
+        const qint64 remainingBytes = data.size() - qint64(i) * encodedLineSize;
+
+        std::vector<uint8_t> incompleteLine;
+        if (remainingBytes < encodedLineSize)
         {
-            return static_cast<uint8_t>(*it++);
+            // According to the PDF specification, incomplete line is completed. For this
+            // reason, we behave as we have zero data in the buffer.
+            incompleteLine.resize(encodedLineSize, 0);
+            std::copy(encodedLine, encodedLine + remainingBytes, incompleteLine.begin());
+            encodedLine = incompleteLine.data();
         }
 
-        // According to the PDF specification, incomplete line is completed. For this
-        // reason, we behave as we have zero data in the buffer.
-        return 0;
-    };
+        uint8_t* line = output + qint64(i) * m_stride;
+        decodePNGLine(encodedLine[0], encodedLine + 1, line, previousLine, implementation);
+        previousLine = line;
+    }
+
+    return outputData;
+}
 
-    // Idea: to avoid using if for many cases, we use larger buffer filled with zeros
-    const int totalBytes = m_stride + pixelBytes;
-    std::vector<uint8_t> line(totalBytes, 0);
-    std::vector<uint8_t> lineOld(totalBytes, 0);
+void PDFStreamPredictor::decodePNGLine(uint8_t type, const uint8_t* input, uint8_t* line, const uint8_t* previousLine, Implementation implementation) const
+{
+    const int pixelBytes = (m_components * m_bitsPerComponent + 7) / 8;
+    const int firstPixelBytes = qMin(pixelBytes, m_stride);
 
-    Predictor currentPredictor = m_predictor;
-    while (it != itEnd)
+    if (implementation == Implementation::Optimized && decodePNGLineOptimized(static_cast<Predictor>(type + PNG_None), pixelBytes, input, line, previousLine, m_stride))
     {
-        // First, read the predictor data for current line
-        currentPredictor = static_cast<Predictor>(readByte() + 10);
+        return;
+    }
 
-        for (int i = 0; i < m_stride; ++i)
+    switch (static_cast<Predictor>(type + PNG_None))
+    {
+        case PNG_Sub:
         {
-            uint8_t currentByte = readByte();
+            std::copy(input, input + firstPixelBytes, line);
+            for (int i = pixelBytes; i < m_stride; ++i)
+            {
+                line[i] = line[i - pixelBytes] + input[i];
+            }
+            break;
+        }
 
-            int lineIndex = i + pixelBytes;
-            switch (currentPredictor)
+        case PNG_Up:
+        {
+            for (int i = 0; i < m_stride; ++i)
             {
-                case PNG_Sub:
-                {
-                    line[lineIndex] = line[i] + currentByte;
-                    break;
-                }
+                line[i] = previousLine[i] + input[i];
+            }
+            break;
+        }
 
-                case PNG_Up:
-                {
-                    line[lineIndex] = lineOld[lineIndex] + currentByte;
-                    break;
-                }
+        case PNG_Average:
+        {
+            for (int i = 0; i < firstPixelBytes; ++i)
+            {
+                line[i] = previousLine[i] / 2 + input[i];
+            }
+            for (int i = pixelBytes; i < m_stride; ++i)
+            {
+                line[i] = (previousLine[i] + line[i - pixelBytes]) / 2 + input[i];
+            }
+            break;
+        }
 
-                case PNG_Average:
+        case PNG_Paeth:
+        {
+            // For the first pixel, left and upper left bytes are zero,
+            // so the upper byte is always selected.
+            for (int i = 0; i < firstPixelBytes; ++i)
+            {
+                line[i] = previousLine[i] + input[i];
+            }
+            for (int i = pixelBytes; i < m_stride; ++i)
+            {
+                // a = left,
+                // b = upper,
+                // c = upper left
+                const int a = line[i - pixelBytes];
+                const int b = previousLine[i];
+                const int c = previousLine[i - pixelBytes];
+                const int p = a + b - c;
+                const int pa = std::abs(p - a);
+                const int pb = std::abs(p - b);
+                const int pc = std::abs(p - c);
+                if (pa <= pb && pa <= pc)
                 {
-                    line[lineIndex] = (lineOld[lineIndex] + line[i]) / 2 + currentByte;
-                    break;
+                    line[i] = a + input[i];
                 }
-
-                case PNG_Paeth:
+                else if (pb <= pc)
                 {
-                    // a = left,
-                    // b = upper,
-                    // c = upper left
-                    const int a = line[i];
-                    const int b = lineOld[lineIndex];
-                    const int c = lineOld[i];
-                    const int p = a + b - c;
-                    const int pa = std::abs(p - a);
-                    const int pb = std::abs(p - b);
-                    const int pc = std::abs(p - c);
-                    if (pa <= pb && pa <= pc)
-                    {
-                        line[lineIndex] = a + currentByte;
-                    }
-                    else if (pb <= pc)
-                    {
-                        line[lineIndex] = b + currentByte;
-                    }
-                    else
-                    {
-                        line[lineIndex] = c + currentByte;
-                    }
-                    break;
+                    line[i] = b + input[i];
                 }
-
-                case PNG_None:
-                default:
+                else
                 {
-                    line[lineIndex] = currentByte;
-                    break;
+                    line[i] = c + input[i];
                 }
             }
-
-            // Fill the output buffer
-            outputData.push_back(static_cast<char>(line[lineIndex]));
+            break;
         }
 
-        // Swap the buffers
-        std::swap(line, lineOld);
+        case PNG_None:
+        default:
+        {
+            std::copy(input, input + m_stride, line);
+            break;
+        }
     }
-
-    return outputData;
 }
 
 QByteArray PDFStreamPredictor::applyTIFFPredictor(const QByteArray& data) const
@@ -939,6 +2190,137 @@ QByteArray PDFStreamPredictor::applyTIFFPredictor(const QByteArray& data) const
     return writer.takeByteArray();
 }
 
+void PDFStreamPredictor::decodeTIFFLine(const uint8_t* input, uint8_t* line) const
+{
+    Q_ASSERT(isTIFFLineDecodingOptimized());
+
+    if (m_bitsPerComponent == 8)
+    {
+        decodeTIFFLine8(m_components, input, line, m_stride);
+    }
+    else
+    {
+        decodeTIFFLine16(m_components, input, line, m_stride);
+    }
+}
+
+bool PDFStreamPredictor::isVectorizationAvailable()
+{
+#if defined(PDF4QT_STREAM_PREDICTOR_SIMD)
+    return true;
+#else
+    return false;
+#endif
+}
+
+class PDFStreamPredictorReader : public PDFBufferedStreamReader
+{
+public:
+    explicit PDFStreamPredictorReader(PDFStreamPredictor predictor, PDFStreamReaderPointer input);
+
+protected:
+    virtual bool decode(QByteArray& buffer) override;
+
+private:
+    PDFStreamPredictor m_predictor;
+    std::vector<uint8_t> m_encodedLine;
+    std::vector<uint8_t> m_previousLine;
+};
+
+PDFStreamPredictorReader::PDFStreamPredictorReader(PDFStreamPredictor predictor, PDFStreamReaderPointer input) :
+    PDFBufferedStreamReader(std::move(input)),
+    m_predictor(predictor),
+    m_encodedLine(predictor.getEncodedLineSize(), 0),
+    m_previousLine(predictor.m_stride, 0)
+{
+
+}
+
+bool PDFStreamPredictorReader::decode(QByteArray& buffer)
+{
+    const int stride = m_predictor.m_stride;
+    const int encodedLineSize = m_predictor.getEncodedLineSize();
+
+    while (buffer.size() < CHUNK_SIZE)
+    {
+        const qint64 bytesRead = m_input.read(reinterpret_cast<char*>(m_encodedLine.data()), encodedLineSize);
+
+        if (bytesRead == 0)
+        {
+            return false;
+        }
+
+        if (m_predictor.m_predictor == PDFStreamPredictor::TIFF)
+        {
+            if (bytesRead < encodedLineSize || !m_predictor.isTIFFLineDecodingOptimized())
+            {
+                // Incomplete lines and lines with components not aligned to bytes
+                // are decoded in the same way, as the whole buffer.
+                buffer.append(m_predictor.applyTIFFPredictor(QByteArray(reinterpret_cast<const char*>(m_encodedLine.data()), bytesRead)));
+            }
+            else
+            {
+                const int offset = buffer.size();
+                buffer.resize(offset + stride);
+                m_predictor.decodeTIFFLine(m_encodedLine.data(), reinterpret_cast<uint8_t*>(buffer.data() + offset));
+            }
+        }
+        else
+        {
+            // According to the PDF specification, incomplete line is completed
+            // by zero data.
+            std::fill(std::next(m_encodedLine.begin(), bytesRead), m_encodedLine.end(), 0);
+
+            const int offset = buffer.size();
+            buffer.resize(offset + stride);
+            uint8_t* line = reinterpret_cast<uint8_t*>(buffer.data() + offset);
+            m_predictor.decodePNGLine(m_encodedLine[0], m_encodedLine.data() + 1, line, m_previousLine.data(), PDFStreamPredictor::Implementation::Optimized);
+            std::copy(line, line + stride, m_previousLine.begin());
+        }
+
+        if (bytesRead < encodedLineSize)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+PDFInteger PDFStreamPredictor::getEncodedDataSize(PDFInteger decodedSize) const
+{
+    if (m_predictor >= PNG_None && m_stride > 0)
+    {
+        // Each line contains also the byte with predictor type
+        return (decodedSize + m_stride - 1) / m_stride * (m_stride + 1);
+    }
+
+    return decodedSize;
+}
+
+PDFStreamReaderPointer PDFStreamPredictor::createReader(PDFStreamReaderPointer input) const
+{
+    switch (m_predictor)
+    {
+        case NoPredictor:
+            return input;
+
+        case TIFF:
+            return std::make_unique<PDFStreamPredictorReader>(*this, std::move(input));
+
+        default:
+        {
+            if (m_predictor >= 10)
+            {
+                return std::make_unique<PDFStreamPredictorReader>(*this, std::move(input));
+            }
+            break;
+        }
+    }
+
+    throw PDFException(PDFTranslationContext::tr("Invalid predictor algorithm."));
+}
+
 QByteArray PDFCryptFilter::apply(const QByteArray& data,
                                  const PDFObjectFetcher& objectFetcher,
                                  const PDFObject& parameters,
@@ -979,4 +2361,23 @@ PDFInteger PDFStreamFilter::getStreamDataLength(const QByteArray& data, PDFInteg
     return -1;
 }
 
+QByteArray PDFStreamFilter::applyWithSizeHint(const QByteArray& data,
+                                              const PDFObjectFetcher& objectFetcher,
+                                              const PDFObject& parameters,
+                                              const PDFSecurityHandler* securityHandler,
+                                              PDFInteger decodedSizeHint) const
+{
+    Q_UNUSED(decodedSizeHint);
+
+    return apply(data, objectFetcher, parameters, securityHandler);
+}
+
+PDFStreamReaderPointer PDFStreamFilter::createReader(PDFStreamReaderPointer input,
+                                                     const PDFObjectFetcher& objectFetcher,
+                                                     const PDFObject& parameters,
+                                                     const PDFSecurityHandler* securityHandler) const
+{
+    return std::make_unique<PDFByteArrayStreamReader>(apply(input->readAll(), objectFetcher, parameters, securityHandler));
+}
+
 }   // namespace pdf
@@ -37,6 +37,46 @@ class PDFSecurityHandler;
 
 using PDFObjectFetcher = std::function<const PDFObject&(const PDFObject&)>;
 
+/// Pull-based reader of the stream data. Readers can be chained, so each
+/// decoding stage pulls the data from the previous one in small chunks,
+/// and the whole decoded stream doesn't have to be held in the memory.
+class PDF4QTLIBCORESHARED_EXPORT PDFStreamReader
+{
+public:
+    explicit PDFStreamReader() = default;
+    virtual ~PDFStreamReader() = default;
+
+    /// Reads at most \p maxSize bytes into the \p data buffer and returns
+    /// number of bytes read. Zero is returned only at the end of the stream.
+    /// If error occurs, exception is thrown.
+    /// \param data Output buffer
+    /// \param maxSize Size of the output buffer
+    virtual qint64 read(char* data, qint64 maxSize) = 0;
+
+    /// Reads all remaining data from the stream
+    QByteArray readAll();
+};
+
+using PDFStreamReaderPointer = std::unique_ptr<PDFStreamReader>;
+
+/// Stream reader, which reads data from the byte array
+class PDF4QTLIBCORESHARED_EXPORT PDFByteArrayStreamReader : public PDFStreamReader
+{
+public:
+    explicit inline PDFByteArrayStreamReader(QByteArray data) :
+        m_data(std::move(data)),
+        m_position(0)
+    {
+
+    }
+
+    virtual qint64 read(char* data, qint64 maxSize) override;
+
+private:
+    QByteArray m_data;
+    qint64 m_position;
+};
+
 /// Storage for stream filters. Can retrieve stream filters by name. Using singleton
 /// design pattern. Use static methods to retrieve filters.
 class PDFStreamFilterStorage
@@ -59,6 +99,20 @@ public:
     /// \param securityHandler Security handler for Crypt filters
     static QByteArray getDecodedStream(const PDFStream* stream, const PDFSecurityHandler* securityHandler);
 
+    /// Returns reader, which decodes data of the stream incrementally. Result
+    /// of the reader is the same as result of \p getDecodedStream, but decoded
+    /// data are produced in chunks, as they are pulled from the reader. Reader
+    /// doesn't reference \p objectFetcher after this function returns.
+    /// \param stream Stream containing the data
+    /// \param objectFetcher Function which retrieves objects (for example, reads objects from reference)
+    /// \param securityHandler Security handler for Crypt filters
+    static PDFStreamReaderPointer createDecodedStreamReader(const PDFStream* stream, const PDFObjectFetcher& objectFetcher, const PDFSecurityHandler* securityHandler);
+
+    /// Returns reader, which decodes data of the stream incrementally, without object fetching
+    /// \param stream Stream containing the data
+    /// \param securityHandler Security handler for Crypt filters
+    static PDFStreamReaderPointer createDecodedStreamReader(const PDFStream* stream, const PDFSecurityHandler* securityHandler);
+
     /// Tries to find stream data length using given filter. Stream will
     /// start at given \p offset in \p data. If stream length cannot be determined,
     /// then -1 is returned.
@@ -92,9 +146,18 @@ private:
     std::map<QByteArray, QByteArray> m_abbreviations;
 };
 
-class PDFStreamPredictor
+class PDF4QTLIBCORESHARED_EXPORT PDFStreamPredictor
 {
 public:
+    enum class Implementation
+    {
+        Reference,  ///< Generic implementation, which decodes data byte by byte (or value by value)
+        Optimized   ///< SIMD kernels (SSE2 or NEON), selected by predictor type and data format, if available
+    };
+
+    /// Returns true, if SIMD kernels are available on this platform
+    static bool isVectorizationAvailable();
+
     /// Create predictor from stream parameters. If error occurs, exception is thrown.
     /// \param objectFetcher Function which retrieves objects (for example, reads objects from reference)
     /// \param parameters Parameters of the predictor (must be an dictionary)
@@ -102,9 +165,30 @@ public:
 
     /// Applies the predictor to the data.
     /// \param data Data to be decoded using predictor
-    QByteArray apply(const QByteArray& data) const;
+    QByteArray apply(const QByteArray& data) const { return apply(data, Implementation::Optimized); }
+
+    /// Applies the predictor to the data using given implementation. Both
+    /// implementations give the same result, this function is mainly
+    /// for testing and benchmarking purposes.
+    /// \param data Data to be decoded using predictor
+    /// \param implementation Implementation of the predictor
+    QByteArray apply(const QByteArray& data, Implementation implementation) const;
+
+    /// Creates reader, which applies the predictor to the data pulled
+    /// from the \p input reader. If predictor doesn't change the data,
+    /// then input reader is returned.
+    /// \param input Reader providing data to be decoded using predictor
+    PDFStreamReaderPointer createReader(PDFStreamReaderPointer input) const;
+
+    /// Returns true, if predictor doesn't change the data
+    bool isIdentity() const { return m_predictor == NoPredictor; }
+
+    /// Returns size of the data encoded by the predictor, whose decoded size is \p decodedSize
+    /// \param decodedSize Size of the decoded data
+    PDFInteger getEncodedDataSize(PDFInteger decodedSize) const;
 
 private:
+    friend class PDFStreamPredictorReader;
 
     enum Predictor
     {
@@ -130,11 +214,32 @@ private:
     }
 
     /// Applies PNG predictor
-    QByteArray applyPNGPredictor(const QByteArray& data) const;
+    QByteArray applyPNGPredictor(const QByteArray& data, Implementation implementation) const;
 
     /// Applies TIFF predictor
     QByteArray applyTIFFPredictor(const QByteArray& data) const;
 
+    /// Returns size of the single encoded line (for PNG predictors,
+    /// including the leading byte with the predictor type)
+    int getEncodedLineSize() const { return m_predictor >= PNG_None ? m_stride + 1 : m_stride; }
+
+    /// Decodes single line of data encoded by PNG predictor.
+    /// \param type Predictor type of the line (first byte of the encoded line)
+    /// \param input Encoded line data (without predictor type), stride bytes
+    /// \param line Decoded line, stride bytes
+    /// \param previousLine Previous decoded line (or zero line), stride bytes
+    /// \param implementation Implementation of the predictor
+    void decodePNGLine(uint8_t type, const uint8_t* input, uint8_t* line, const uint8_t* previousLine, Implementation implementation) const;
+
+    /// Returns true, if lines encoded by TIFF predictor can be decoded
+    /// by \p decodeTIFFLine (components must have 8 or 16 bits)
+    bool isTIFFLineDecodingOptimized() const { return m_bitsPerComponent == 8 || m_bitsPerComponent == 16; }
+
+    /// Decodes single line of data encoded by TIFF predictor, components must have 8 or 16 bits.
+    /// \param input Encoded line data, stride bytes
+    /// \param line Decoded line, stride bytes
+    void decodeTIFFLine(const uint8_t* input, uint8_t* line) const;
+
     Predictor m_predictor = NoPredictor;
     int m_components = 0;
     int m_bitsPerComponent = 0;
@@ -162,11 +267,36 @@ public:
         return apply(data, [](const PDFObject& object) -> const PDFObject& { return object; }, parameters, securityHandler);
     }
 
+    /// Apply with known size of the decoded data. Filters, which can take advantage of
+    /// knowing the size of the decoded data (for example, to allocate output buffer only
+    /// once), override this function. Default implementation ignores the hint.
+    /// \param data Stream data to be decoded
+    /// \param objectFetcher Function which retrieves objects (for example, reads objects from reference)
+    /// \param parameters Stream parameters
+    /// \param decodedSizeHint Expected size of the decoded data (-1, if it is unknown)
+    virtual QByteArray applyWithSizeHint(const QByteArray& data,
+                                         const PDFObjectFetcher& objectFetcher,
+                                         const PDFObject& parameters,
+                                         const PDFSecurityHandler* securityHandler,
+                                         PDFInteger decodedSizeHint) const;
+
     /// Tries to find stream data length. Stream will start at given \p offset in \p data.
     /// If stream length cannot be determined, then -1 is returned.
     /// \param data Buffer data
     /// \param offset Offset to buffer, at which stream data starts
     virtual PDFInteger getStreamDataLength(const QByteArray& data, PDFInteger offset) const;
+
+    /// Creates reader, which decodes data pulled from the \p input reader. Default
+    /// implementation reads all input data and decodes them using \p apply, filters
+    /// supporting incremental decoding override this function.
+    /// \param input Reader providing data to be decoded
+    /// \param objectFetcher Function which retrieves objects (for example, reads objects from reference)
+    /// \param parameters Stream parameters
+    /// \param securityHandler Security handler for Crypt filters
+    virtual PDFStreamReaderPointer createReader(PDFStreamReaderPointer input,
+                                                const PDFObjectFetcher& objectFetcher,
+                                                const PDFObject& parameters,
+                                                const PDFSecurityHandler* securityHandler) const;
 };
 
 class PDF4QTLIBCORESHARED_EXPORT PDFAsciiHexDecodeFilter : public PDFStreamFilter
@@ -179,6 +309,11 @@ public:
                              const PDFObjectFetcher& objectFetcher,
                              const PDFObject& parameters,
                              const PDFSecurityHandler* securityHandler) const override;
+
+    virtual PDFStreamReaderPointer createReader(PDFStreamReaderPointer input,
+                                                const PDFObjectFetcher& objectFetcher,
+                                                const PDFObject& parameters,
+                                                const PDFSecurityHandler* securityHandler) const override;
 };
 
 class PDF4QTLIBCORESHARED_EXPORT PDFAscii85DecodeFilter : public PDFStreamFilter
@@ -191,6 +326,11 @@ public:
                              const PDFObjectFetcher& objectFetcher,
                              const PDFObject& parameters,
                              const PDFSecurityHandler* securityHandler) const override;
+
+    virtual PDFStreamReaderPointer createReader(PDFStreamReaderPointer input,
+                                                const PDFObjectFetcher& objectFetcher,
+                                                const PDFObject& parameters,
+                                                const PDFSecurityHandler* securityHandler) const override;
 };
 
 class PDF4QTLIBCORESHARED_EXPORT PDFLzwDecodeFilter : public PDFStreamFilter
@@ -203,6 +343,11 @@ public:
                              const PDFObjectFetcher& objectFetcher,
                              const PDFObject& parameters,
                              const PDFSecurityHandler* securityHandler) const override;
+
+    virtual PDFStreamReaderPointer createReader(PDFStreamReaderPointer input,
+                                                const PDFObjectFetcher& objectFetcher,
+                                                const PDFObject& parameters,
+                                                const PDFSecurityHandler* securityHandler) const override;
 };
 
 class PDF4QTLIBCORESHARED_EXPORT PDFFlateDecodeFilter : public PDFStreamFilter
@@ -211,11 +356,38 @@ public:
     explicit PDFFlateDecodeFilter() = default;
     virtual ~PDFFlateDecodeFilter() override = default;
 
+    enum class Backend
+    {
+        Zlib,       ///< Zlib library (or zlib-ng in zlib compatible mode, selected at build time)
+        Libdeflate  ///< Libdeflate library, decodes whole buffers at once (requires PDF4QT_USE_LIBDEFLATE)
+    };
+
+    /// Returns true, if given backend was compiled in
+    static bool isBackendAvailable(Backend backend);
+
+    /// Returns backend used to decompress and compress the data
+    static Backend getBackend();
+
+    /// Sets backend used to decompress and compress the data. If backend is
+    /// not available, then zlib is used. This function is thread safe.
+    static void setBackend(Backend backend);
+
+    virtual QByteArray applyWithSizeHint(const QByteArray& data,
+                                         const PDFObjectFetcher& objectFetcher,
+                                         const PDFObject& parameters,
+                                         const PDFSecurityHandler* securityHandler,
+                                         PDFInteger decodedSizeHint) const override;
+
     virtual QByteArray apply(const QByteArray& data,
                              const PDFObjectFetcher& objectFetcher,
                              const PDFObject& parameters,
                              const PDFSecurityHandler* securityHandler) const override;
 
+    virtual PDFStreamReaderPointer createReader(PDFStreamReaderPointer input,
+                                                const PDFObjectFetcher& objectFetcher,
+                                                const PDFObject& parameters,
+                                                const PDFSecurityHandler* securityHandler) const override;
+
     virtual PDFInteger getStreamDataLength(const QByteArray& data, PDFInteger offset) const override;
 
     /// Recompresses data. So, first, data are decompressed, and then
@@ -228,7 +400,14 @@ public:
     static QByteArray recompress(const QByteArray& data);
 
 private:
-    static QByteArray uncompress(const QByteArray& data);
+    /// Decompresses data. If size of the decompressed data is known,
+    /// output buffer is allocated only once.
+    /// \param data Compressed data
+    /// \param decompressedSizeHint Expected size of decompressed data (-1, if it is unknown)
+    static QByteArray uncompress(const QByteArray& data, PDFInteger decompressedSizeHint = -1);
+
+    /// Decompresses data using zlib
+    static QByteArray uncompressZlib(const QByteArray& data, PDFInteger decompressedSizeHint);
 };
 
 class PDF4QTLIBCORESHARED_EXPORT PDFRunLengthDecodeFilter : public PDFStreamFilter
@@ -241,6 +420,11 @@ public:
                              const PDFObjectFetcher& objectFetcher,
                              const PDFObject& parameters,
                              const PDFSecurityHandler* securityHandler) const override;
+
+    virtual PDFStreamReaderPointer createReader(PDFStreamReaderPointer input,
+                                                const PDFObjectFetcher& objectFetcher,
+                                                const PDFObject& parameters,
+                                                const PDFSecurityHandler* securityHandler) const override;
 };
 
 class PDF4QTLIBCORESHARED_EXPORT PDFCryptFilter : public PDFStreamFilter
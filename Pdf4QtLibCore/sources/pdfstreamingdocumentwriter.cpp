@@ -25,16 +25,29 @@
 #include "pdfconstants.h"
 #include "pdfdocumentbuilder.h"
 #include "pdfdocumentreader.h"
+#include "pdfdocumentwriter.h"
+#include "pdfexecutionpolicy.h"
 #include "pdfobjectutils.h"
 #include "pdfparser.h"
+#include "pdfstreamfilters.h"
 #include "pdfvisitor.h"
 
 
+#include <QBuffer>
+#include <QCryptographicHash>
 #include <QFile>
+#include <QFileInfo>
 #include <QSaveFile>
+#include <QThreadPool>
+#include <QWaitCondition>
 
 #include "pdfdbgheap.h"
 
+#include <array>
+#include <numeric>
+#include <optional>
+#include <set>
+
 namespace pdf {
 
 // Reuse the write visitor from pdfdocumentwriter.cpp
@@ -150,6 +163,12 @@ bool PDFStreamingDocumentWriter::beginDocument(PDFVersion version) {
     return false;
   }
 
+  // Object streams and cross-reference streams were introduced in PDF 1.5
+  if (m_mode == Mode::Compressed &&
+      (version.major < 1 || (version.major == 1 && version.minor < 5))) {
+    version = PDFVersion(1, 5);
+  }
+
   m_version = version;
   m_isOpen = true;
 
@@ -180,17 +199,13 @@ PDFStreamingDocumentWriter::writeObject(const PDFObject &object,
   PDFInteger objectNumber = static_cast<PDFInteger>(m_objectOffsets.size());
   PDFObjectReference reference(objectNumber, generation);
 
-  // Record offset before writing
   ObjectEntry entry;
-  entry.offset = m_device->pos();
   entry.generation = generation;
   entry.isReserved = false;
   m_objectOffsets.push_back(entry);
 
   // Write the object
-  writeObjectHeader(reference);
-  writeObjectContent(object);
-  writeObjectFooter();
+  writeIndirectObject(reference, object);
 
   return reference;
 }
@@ -216,17 +231,12 @@ bool PDFStreamingDocumentWriter::writeReservedObject(
   }
 
   ObjectEntry &entry = m_objectOffsets[reference.objectNumber];
-  if (!entry.isReserved || entry.offset != -1) {
+  if (!entry.isReserved || entry.isWritten()) {
     return false; // Not reserved or already written
   }
 
-  // Record offset and write
-  entry.offset = m_device->pos();
   entry.isReserved = false;
-
-  writeObjectHeader(reference);
-  writeObjectContent(object);
-  writeObjectFooter();
+  writeIndirectObject(reference, object);
 
   return true;
 }
@@ -245,6 +255,14 @@ void PDFStreamingDocumentWriter::setInfoReference(
   m_infoReference = infoReference;
 }
 
+PDFObjectReference PDFStreamingDocumentWriter::getPageTreeRootReference() {
+  if (!m_pageTreeRootReference.isValid()) {
+    m_pageTreeRootReference = reserveObject();
+  }
+
+  return m_pageTreeRootReference;
+}
+
 PDFObjectReference PDFStreamingDocumentWriter::createPageTree() {
   // Create the page tree root with all pages
   PDFObjectFactory factory;
@@ -268,6 +286,11 @@ PDFObjectReference PDFStreamingDocumentWriter::createPageTree() {
 
   factory.endDictionary();
 
+  if (m_pageTreeRootReference.isValid()) {
+    writeReservedObject(m_pageTreeRootReference, factory.takeObject());
+    return m_pageTreeRootReference;
+  }
+
   return writeObject(factory.takeObject());
 }
 
@@ -294,9 +317,14 @@ PDFOperationResult PDFStreamingDocumentWriter::endDocument() {
     return tr("Document is not open.");
   }
 
-  // Check for unwritten reserved objects
+  // Check for unwritten reserved objects (page tree root
+  // is written below, when catalog is created)
   for (size_t i = 1; i < m_objectOffsets.size(); ++i) {
-    if (m_objectOffsets[i].isReserved && m_objectOffsets[i].offset == -1) {
+    if (PDFInteger(i) == m_pageTreeRootReference.objectNumber) {
+      continue;
+    }
+
+    if (m_objectOffsets[i].isReserved && !m_objectOffsets[i].isWritten()) {
       return tr("Reserved object %1 was never written.").arg(i);
     }
   }
@@ -305,6 +333,32 @@ PDFOperationResult PDFStreamingDocumentWriter::endDocument() {
   if (!m_catalogReference.isValid()) {
     PDFObjectReference pageTreeRoot = createPageTree();
     m_catalogReference = createCatalog(pageTreeRoot);
+  } else if (m_pageTreeRootReference.isValid() &&
+             !m_objectOffsets[m_pageTreeRootReference.objectNumber]
+                  .isWritten()) {
+    createPageTree();
+  }
+
+  if (m_mode == Mode::Compressed) {
+    flushObjectStream();
+
+    PDFObjectFactory factory;
+    factory.beginDictionary();
+    factory.beginDictionaryItem("Root");
+    factory << m_catalogReference;
+    factory.endDictionaryItem();
+
+    if (m_infoReference.isValid()) {
+      factory.beginDictionaryItem("Info");
+      factory << m_infoReference;
+      factory.endDictionaryItem();
+    }
+
+    factory.endDictionary();
+    writeCrossReferenceStream(factory.takeObject());
+
+    m_isOpen = false;
+    return true;
   }
 
   // Write cross-reference table
@@ -394,10 +448,250 @@ void PDFStreamingDocumentWriter::writeObjectContent(const PDFObject &object) {
   object.accept(&visitor);
 }
 
+void PDFStreamingDocumentWriter::writeIndirectObject(
+    PDFObjectReference reference, const PDFObject &object) {
+  // Entries can be reallocated, when object stream batch is flushed
+  const size_t index = static_cast<size_t>(reference.objectNumber);
+
+  if (m_mode == Mode::Compressed) {
+    if (object.isStream()) {
+      // Stream length is written as direct object, because referenced length
+      // object can be stored in the object stream, which is not accessible
+      // before the stream is parsed. Content is shared, not copied.
+      const PDFStream *stream = object.getStream();
+      const QByteArray *content = stream->getContent();
+      PDFObject streamObject = object;
+
+      const PDFObject &length = stream->getDictionary()->get("Length");
+      if (!length.isInt() || length.getInteger() != content->size()) {
+        PDFDictionary dictionary = *stream->getDictionary();
+        dictionary.setEntry(PDFInplaceOrMemoryString("Length"),
+                            PDFObject::createInteger(content->size()));
+        streamObject = PDFObject::createStream(std::make_shared<PDFStream>(
+            std::move(dictionary), QByteArray(*content),
+            stream->getDataOwner()));
+      }
+
+      m_objectOffsets[index].offset = m_device->pos();
+      writeObjectHeader(reference);
+      writeObjectContent(streamObject);
+      writeObjectFooter();
+      return;
+    }
+
+    if (reference.generation == 0) {
+      QByteArray serializedObject;
+      {
+        QBuffer buffer(&serializedObject);
+        buffer.open(QBuffer::WriteOnly);
+        PDFStreamingWriteObjectVisitor visitor(&buffer);
+        object.accept(&visitor);
+      }
+
+      if (serializedObject.size() <= OBJECT_STREAM_MAX_OBJECT_SIZE) {
+        if (m_objectStreamContent.size() + serializedObject.size() >
+            OBJECT_STREAM_MAX_SIZE) {
+          flushObjectStream();
+        }
+
+        // Object stream number is assigned, when batch is flushed
+        m_objectOffsets[index].objectStream = 0;
+        m_objectOffsets[index].objectStreamIndex = PDFInteger(m_objectStreamObjects.size());
+        m_objectStreamObjects.push_back(reference.objectNumber);
+        m_objectStreamOffsets.append(
+            QByteArray::number(reference.objectNumber));
+        m_objectStreamOffsets.append(' ');
+        m_objectStreamOffsets.append(
+            QByteArray::number(m_objectStreamContent.size()));
+        m_objectStreamOffsets.append(' ');
+        m_objectStreamContent.append(serializedObject);
+        m_objectStreamContent.append(' ');
+
+        if (m_objectStreamObjects.size() >= OBJECT_STREAM_MAX_OBJECTS) {
+          flushObjectStream();
+        }
+        return;
+      }
+    }
+  }
+
+  m_objectOffsets[index].offset = m_device->pos();
+  writeObjectHeader(reference);
+  writeObjectContent(object);
+  writeObjectFooter();
+}
+
+void PDFStreamingDocumentWriter::flushObjectStream() {
+  if (m_objectStreamObjects.empty()) {
+    return;
+  }
+
+  const PDFObjectReference reference(
+      static_cast<PDFInteger>(m_objectOffsets.size()), 0);
+  ObjectEntry streamEntry;
+  streamEntry.offset = m_device->pos();
+  m_objectOffsets.push_back(streamEntry);
+
+  for (const PDFInteger objectNumber : m_objectStreamObjects) {
+    m_objectOffsets[objectNumber].objectStream = reference.objectNumber;
+  }
+
+  const PDFInteger first = m_objectStreamOffsets.size();
+  QByteArray compressedData = PDFFlateDecodeFilter::compress(
+      m_objectStreamOffsets + m_objectStreamContent);
+
+  PDFDictionary dictionary;
+  dictionary.addEntry(PDFInplaceOrMemoryString("Type"),
+                      PDFObject::createName("ObjStm"));
+  dictionary.addEntry(
+      PDFInplaceOrMemoryString("N"),
+      PDFObject::createInteger(PDFInteger(m_objectStreamObjects.size())));
+  dictionary.addEntry(PDFInplaceOrMemoryString("First"),
+                      PDFObject::createInteger(first));
+  dictionary.addEntry(PDFInplaceOrMemoryString("Filter"),
+                      PDFObject::createName("FlateDecode"));
+  dictionary.addEntry(PDFInplaceOrMemoryString("Length"),
+                      PDFObject::createInteger(compressedData.size()));
+
+  writeObjectHeader(reference);
+  writeObjectContent(PDFObject::createStream(std::make_shared<PDFStream>(
+      std::move(dictionary), std::move(compressedData))));
+  writeObjectFooter();
+
+  m_objectStreamObjects.clear();
+  m_objectStreamOffsets.clear();
+  m_objectStreamContent.clear();
+}
+
+void PDFStreamingDocumentWriter::writeCrossReferenceStream(
+    const PDFObject &trailerDictionary) {
+  const PDFObjectReference reference(
+      static_cast<PDFInteger>(m_objectOffsets.size()), 0);
+  ObjectEntry xrefEntry;
+  xrefEntry.offset = m_device->pos();
+  m_objectOffsets.push_back(xrefEntry);
+
+  // Entries - type (0 - free, 1 - uncompressed, 2 - compressed),
+  // offset/object stream number, generation/index in object stream.
+  auto getFields = [](const ObjectEntry &entry, size_t objectNumber) {
+    if (objectNumber == 0 || !entry.isWritten()) {
+      return std::array<PDFInteger, 3>{0, 0, objectNumber == 0 ? 65535 : 0};
+    }
+    if (entry.objectStream != -1) {
+      return std::array<PDFInteger, 3>{2, entry.objectStream,
+                                       entry.objectStreamIndex};
+    }
+    return std::array<PDFInteger, 3>{1, entry.offset, entry.generation};
+  };
+
+  auto getByteCount = [](PDFInteger value) {
+    int count = 1;
+    while (value > 0xFF) {
+      value >>= 8;
+      ++count;
+    }
+    return count;
+  };
+
+  PDFInteger maxField2 = 0;
+  PDFInteger maxField3 = 0;
+  for (size_t i = 0; i < m_objectOffsets.size(); ++i) {
+    const std::array<PDFInteger, 3> fields = getFields(m_objectOffsets[i], i);
+    maxField2 = qMax(maxField2, fields[1]);
+    maxField3 = qMax(maxField3, fields[2]);
+  }
+
+  const int widthField2 = getByteCount(maxField2);
+  const int widthField3 = getByteCount(maxField3);
+
+  auto writeField = [](QByteArray &data, PDFInteger value, int width) {
+    for (int i = width - 1; i >= 0; --i) {
+      data.append(char((value >> (8 * i)) & 0xFF));
+    }
+  };
+
+  QByteArray xrefData;
+  xrefData.reserve(m_objectOffsets.size() * (1 + widthField2 + widthField3));
+  for (size_t i = 0; i < m_objectOffsets.size(); ++i) {
+    const std::array<PDFInteger, 3> fields = getFields(m_objectOffsets[i], i);
+    writeField(xrefData, fields[0], 1);
+    writeField(xrefData, fields[1], widthField2);
+    writeField(xrefData, fields[2], widthField3);
+  }
+  QByteArray compressedXrefData = PDFFlateDecodeFilter::compress(xrefData);
+
+  PDFArray widths;
+  widths.appendItem(PDFObject::createInteger(1));
+  widths.appendItem(PDFObject::createInteger(widthField2));
+  widths.appendItem(PDFObject::createInteger(widthField3));
+
+  PDFDictionary dictionary;
+  dictionary.addEntry(PDFInplaceOrMemoryString("Type"),
+                      PDFObject::createName("XRef"));
+  dictionary.addEntry(
+      PDFInplaceOrMemoryString("Size"),
+      PDFObject::createInteger(PDFInteger(m_objectOffsets.size())));
+  dictionary.addEntry(
+      PDFInplaceOrMemoryString("W"),
+      PDFObject::createArray(std::make_shared<PDFArray>(std::move(widths))));
+
+  const PDFDictionary *trailer = trailerDictionary.getDictionary();
+  for (size_t i = 0, count = trailer->getCount(); i < count; ++i) {
+    dictionary.addEntry(PDFInplaceOrMemoryString(trailer->getKey(i)),
+                        PDFObject(trailer->getValue(i)));
+  }
+
+  dictionary.addEntry(PDFInplaceOrMemoryString("Filter"),
+                      PDFObject::createName("FlateDecode"));
+  dictionary.addEntry(PDFInplaceOrMemoryString("Length"),
+                      PDFObject::createInteger(compressedXrefData.size()));
+
+  writeObjectHeader(reference);
+  writeObjectContent(PDFObject::createStream(std::make_shared<PDFStream>(
+      std::move(dictionary), std::move(compressedXrefData))));
+  writeObjectFooter();
+
+  m_device->write("startxref");
+  writeCRLF();
+  m_device->write(QString::number(xrefEntry.offset).toLatin1());
+  writeCRLF();
+  m_device->write("%%EOF");
+}
+
 // ============================================================================
 // PDFStreamingMerger implementation
 // ============================================================================
 
+static bool containsReferences(const PDFObject &object) {
+  switch (object.getType()) {
+  case PDFObject::Type::Reference:
+    return true;
+
+  case PDFObject::Type::Array: {
+    const PDFArray *array = object.getArray();
+    for (size_t i = 0, count = array->getCount(); i < count; ++i) {
+      if (containsReferences(array->getItem(i))) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  case PDFObject::Type::Dictionary: {
+    const PDFDictionary *dictionary = object.getDictionary();
+    for (size_t i = 0, count = dictionary->getCount(); i < count; ++i) {
+      if (containsReferences(dictionary->getValue(i))) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  default:
+    return false;
+  }
+}
+
 PDFStreamingMerger::PDFStreamingMerger(const QString &outputPath,
                                        PDFProgress *progress)
     : m_outputPath(outputPath), m_progress(progress), m_totalPages(0),
@@ -420,6 +714,7 @@ bool PDFStreamingMerger::begin() {
   m_device = std::move(file);
   m_writer =
       std::make_unique<PDFStreamingDocumentWriter>(m_device.get(), m_progress);
+  m_writer->setMode(m_mode);
 
   return m_writer->beginDocument();
 }
@@ -440,26 +735,67 @@ bool PDFStreamingMerger::addDocument(const PDFDocument &document,
   // Create a mapping from old references to new references
   std::map<PDFObjectReference, PDFObjectReference> referenceMapping;
 
-  // First pass: reserve all object numbers
+  // Calculate deduplication keys of streams in parallel
+  std::vector<QByteArray> deduplicationKeys(objects.size());
+  if (m_deduplicationEnabled) {
+    m_deduplicationTable.setMaxCost(DEDUPLICATION_MAX_ENTRIES);
+
+    std::vector<size_t> objectNumbers(objects.size(), 0);
+    std::iota(objectNumbers.begin(), objectNumbers.end(), 0);
+    auto calculateKey = [&](size_t objectNumber) {
+      const PDFObject &object = objects[objectNumber].object;
+      if (object.isStream()) {
+        deduplicationKeys[objectNumber] =
+            getDeduplicationKey(storage, object.getStream());
+      }
+    };
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown,
+                                objectNumbers.begin(), objectNumbers.end(),
+                                calculateKey);
+  }
+
+  // First pass: reserve all object numbers, streams identical to already
+  // written streams are mapped to them and are not written again.
+  std::vector<bool> isDeduplicated(objects.size(), false);
   for (size_t i = 1; i < objects.size(); ++i) {
     const PDFObjectStorage::Entry &entry = objects[i];
     if (!entry.object.isNull()) {
       PDFObjectReference oldRef(i, entry.generation);
+      const QByteArray &key = deduplicationKeys[i];
+
+      if (!key.isEmpty()) {
+        if (const PDFObjectReference *existingRef =
+                m_deduplicationTable.object(key)) {
+          referenceMapping[oldRef] = *existingRef;
+          isDeduplicated[i] = true;
+          ++m_deduplicatedStreamCount;
+          continue;
+        }
+      }
+
       PDFObjectReference newRef = m_writer->reserveObject(0);
       referenceMapping[oldRef] = newRef;
+
+      if (!key.isEmpty()) {
+        m_deduplicationTable.insert(key, new PDFObjectReference(newRef));
+      }
     }
   }
 
   // Second pass: write all objects with updated references
   for (size_t i = 1; i < objects.size(); ++i) {
     const PDFObjectStorage::Entry &entry = objects[i];
-    if (!entry.object.isNull()) {
+    if (!entry.object.isNull() && !isDeduplicated[i]) {
       PDFObjectReference oldRef(i, entry.generation);
       PDFObjectReference newRef = referenceMapping[oldRef];
 
-      // Replace references in the object
+      // Replace references in the object, stream data are passed through
       PDFObject updatedObject =
-          PDFObjectUtils::replaceReferences(entry.object, referenceMapping);
+          entry.object.isStream()
+              ? createPassthroughStream(entry.object.getStream(),
+                                        referenceMapping)
+              : PDFObjectUtils::replaceReferences(entry.object,
+                                                  referenceMapping);
 
       m_writer->writeReservedObject(newRef, updatedObject);
     }
@@ -483,6 +819,384 @@ bool PDFStreamingMerger::addDocument(const PDFDocument &document,
   return true;
 }
 
+PDFOperationResult
+PDFStreamingMerger::addPages(const PDFDocument &document,
+                             const std::vector<SelectedPage> &pages) {
+  if (!m_writer || !m_writer->isOpen()) {
+    return tr("Merger is not initialized.");
+  }
+
+  const PDFObjectStorage &storage = document.getStorage();
+  const PDFCatalog *catalog = document.getCatalog();
+
+  // Create page objects. References to the selected pages are mapped to the
+  // new page objects (if page is selected multiple times, to the first one).
+  std::map<PDFObjectReference, PDFObjectReference> referenceMapping;
+  std::vector<std::pair<PDFObjectReference, PDFObject>> pageObjects;
+  pageObjects.reserve(pages.size());
+  for (const SelectedPage &selectedPage : pages) {
+    const PDFPage *page = selectedPage.pageIndex >= 0
+                              ? catalog->getPage(selectedPage.pageIndex)
+                              : nullptr;
+    if (!page) {
+      return tr("Page %1 doesn't exist.").arg(selectedPage.pageIndex + 1);
+    }
+
+    PDFObjectReference newPageReference = m_writer->reserveObject(0);
+    referenceMapping.emplace(page->getPageReference(), newPageReference);
+    pageObjects.emplace_back(
+        newPageReference,
+        createSelectedPageObject(storage, page, selectedPage.pageRotation));
+  }
+
+  // Pages, which are not selected, are not traversed, so objects used
+  // only by them are never read.
+  std::set<PDFObjectReference> excludedReferences;
+  for (size_t i = 0; i < catalog->getPageCount(); ++i) {
+    excludedReferences.insert(catalog->getPage(i)->getPageReference());
+  }
+
+  // References to excluded or nonexisting objects are replaced by
+  // reference to the null object, which is written only if it is needed.
+  PDFObjectReference nullReference;
+  std::vector<PDFObjectReference> reachableReferences;
+  auto addReferences = [&](const PDFObject &object) {
+    for (const PDFObjectReference &reference :
+         PDFObjectUtils::getDirectReferences(object)) {
+      if (referenceMapping.count(reference)) {
+        continue;
+      }
+
+      if (excludedReferences.count(reference) ||
+          storage.getObject(reference).isNull()) {
+        if (!nullReference.isValid()) {
+          nullReference = m_writer->writeObject(PDFObject::createNull());
+        }
+        referenceMapping[reference] = nullReference;
+        continue;
+      }
+
+      referenceMapping[reference] = m_writer->reserveObject(0);
+      reachableReferences.push_back(reference);
+    }
+  };
+
+  for (const auto &pageObject : pageObjects) {
+    addReferences(pageObject.second);
+  }
+  for (size_t i = 0; i < reachableReferences.size(); ++i) {
+    addReferences(storage.getObject(reachableReferences[i]));
+  }
+
+  // Write reachable objects
+  for (const PDFObjectReference &reference : reachableReferences) {
+    const PDFObject &object = storage.getObject(reference);
+    PDFObject updatedObject =
+        object.isStream()
+            ? createPassthroughStream(object.getStream(), referenceMapping)
+            : PDFObjectUtils::replaceReferences(object, referenceMapping);
+    m_writer->writeReservedObject(referenceMapping.at(reference),
+                                  updatedObject);
+  }
+
+  // Write pages, they are put into the page tree of the output document
+  const PDFObjectReference pageTreeRoot = m_writer->getPageTreeRootReference();
+  for (const auto &pageObject : pageObjects) {
+    PDFObject updatedObject =
+        PDFObjectUtils::replaceReferences(pageObject.second, referenceMapping);
+    PDFDictionary dictionary = *updatedObject.getDictionary();
+    dictionary.setEntry(PDFInplaceOrMemoryString("Parent"),
+                        PDFObject::createReference(pageTreeRoot));
+
+    m_writer->writeReservedObject(
+        pageObject.first, PDFObject::createDictionary(
+                              std::make_shared<PDFDictionary>(
+                                  std::move(dictionary))));
+    m_writer->addPage(pageObject.first);
+    ++m_totalPages;
+  }
+
+  ++m_totalDocuments;
+  return true;
+}
+
+PDFOperationResult
+PDFStreamingMerger::addPages(const QString &fileName,
+                             const std::vector<SelectedPage> &pages) {
+  PDFDocumentReader reader(
+      nullptr,
+      [](bool *ok) {
+        *ok = false;
+        return QString();
+      },
+      false, false);
+  reader.setLazyObjectLoading(true);
+  PDFDocument document = reader.readFromFile(fileName);
+
+  if (reader.getReadingResult() != PDFDocumentReader::Result::OK) {
+    return tr("Cannot open document '%1'. %2")
+        .arg(fileName, reader.getErrorMessage());
+  }
+
+  if (!document.getStorage().getSecurityHandler()->isAllowed(
+          PDFSecurityHandler::Permission::Assemble)) {
+    return tr("Document '%1' doesn't allow to assemble pages.").arg(fileName);
+  }
+
+  return addPages(document, pages);
+}
+
+PDFObject
+PDFStreamingMerger::createSelectedPageObject(const PDFObjectStorage &storage,
+                                             const PDFPage *page,
+                                             PageRotation pageRotation) {
+  PDFDictionary dictionary;
+  const PDFObject &pageObject =
+      storage.getObjectByReference(page->getPageReference());
+  if (const PDFDictionary *pageDictionary =
+          storage.getDictionaryFromObject(pageObject)) {
+    dictionary = *pageDictionary;
+  }
+
+  // Inherited attributes are taken from the nearest node of the page tree
+  // containing them, because the page will not have its original parent.
+  for (const char *key : {"Resources", "MediaBox", "CropBox"}) {
+    if (dictionary.hasKey(key)) {
+      continue;
+    }
+
+    std::set<PDFObjectReference> visitedNodes;
+    PDFObject parentObject = dictionary.get("Parent");
+    while (parentObject.isReference() &&
+           visitedNodes.insert(parentObject.getReference()).second) {
+      const PDFDictionary *parentDictionary =
+          storage.getDictionaryFromObject(parentObject);
+      if (!parentDictionary) {
+        break;
+      }
+
+      if (parentDictionary->hasKey(key)) {
+        dictionary.setEntry(PDFInplaceOrMemoryString(key),
+                            PDFObject(parentDictionary->get(key)));
+        break;
+      }
+
+      parentObject = parentDictionary->get("Parent");
+    }
+  }
+
+  dictionary.removeEntry("Parent");
+
+  PDFObjectFactory factory;
+  factory << pageRotation;
+  dictionary.setEntry(PDFInplaceOrMemoryString("Rotate"), factory.takeObject());
+
+  return PDFObject::createDictionary(
+      std::make_shared<PDFDictionary>(std::move(dictionary)));
+}
+
+PDFOperationResult
+PDFStreamingMerger::addDocuments(const QStringList &fileNames, int readerCount,
+                                 qint64 memoryBudget) {
+  if (!m_writer || !m_writer->isOpen()) {
+    return tr("Merger is not initialized.");
+  }
+
+  struct PrefetchedDocument {
+    PDFDocument document;
+    QString errorMessage;
+    qint64 size = 0;
+  };
+
+  // State shared between reader threads and writer (calling) thread. Documents
+  // are claimed by readers in order, so documents in flight always form a
+  // contiguous range starting at the document, which is written next. Hence
+  // writer can always make progress and budget is eventually released.
+  struct PrefetchState {
+    QMutex mutex;
+    QWaitCondition condition;
+    std::vector<std::optional<PrefetchedDocument>> documents;
+    qsizetype nextDocument = 0;
+    qint64 bytesInFlight = 0;
+    qsizetype documentsInFlight = 0;
+    bool isAborted = false;
+  };
+
+  PrefetchState state;
+  state.documents.resize(fileNames.size());
+
+  auto readDocuments = [&state, &fileNames, memoryBudget]() {
+    while (true) {
+      qsizetype index = 0;
+      qint64 size = 0;
+
+      {
+        QMutexLocker lock(&state.mutex);
+        if (state.isAborted || state.nextDocument >= fileNames.size()) {
+          return;
+        }
+
+        // Backpressure - wait until documents in flight fit into the budget
+        size = QFileInfo(fileNames[state.nextDocument]).size();
+        while (!state.isAborted && state.nextDocument < fileNames.size() &&
+               state.documentsInFlight > 0 &&
+               state.bytesInFlight + size > memoryBudget) {
+          state.condition.wait(&state.mutex);
+          if (state.nextDocument < fileNames.size()) {
+            size = QFileInfo(fileNames[state.nextDocument]).size();
+          }
+        }
+
+        if (state.isAborted || state.nextDocument >= fileNames.size()) {
+          return;
+        }
+
+        index = state.nextDocument++;
+        state.bytesInFlight += size;
+        ++state.documentsInFlight;
+      }
+
+      PrefetchedDocument prefetchedDocument;
+      prefetchedDocument.size = size;
+
+      PDFDocumentReader reader(
+          nullptr,
+          [](bool *ok) {
+            *ok = false;
+            return QString();
+          },
+          false, false);
+      prefetchedDocument.document = reader.readFromFile(fileNames[index]);
+
+      if (reader.getReadingResult() != PDFDocumentReader::Result::OK) {
+        prefetchedDocument.errorMessage =
+            tr("Cannot open document '%1'. %2")
+                .arg(fileNames[index], reader.getErrorMessage());
+      } else if (!prefetchedDocument.document.getStorage()
+                      .getSecurityHandler()
+                      ->isAllowed(PDFSecurityHandler::Permission::Assemble)) {
+        prefetchedDocument.errorMessage =
+            tr("Document '%1' doesn't allow to assemble pages.")
+                .arg(fileNames[index]);
+      }
+
+      QMutexLocker lock(&state.mutex);
+      state.documents[index] = std::move(prefetchedDocument);
+      state.condition.wakeAll();
+    }
+  };
+
+  QThreadPool threadPool;
+  const int threadCount =
+      qBound(1, readerCount, qMax(1, int(fileNames.size())));
+  threadPool.setMaxThreadCount(threadCount);
+  for (int i = 0; i < threadCount; ++i) {
+    threadPool.start(readDocuments);
+  }
+
+  PDFOperationResult result = true;
+  for (qsizetype i = 0; i < fileNames.size(); ++i) {
+    PrefetchedDocument prefetchedDocument;
+
+    {
+      QMutexLocker lock(&state.mutex);
+      while (!state.documents[i].has_value()) {
+        state.condition.wait(&state.mutex);
+      }
+
+      prefetchedDocument = std::move(*state.documents[i]);
+      state.documents[i].reset();
+    }
+
+    if (prefetchedDocument.errorMessage.isEmpty() &&
+        !addDocument(prefetchedDocument.document, int(m_totalDocuments))) {
+      prefetchedDocument.errorMessage =
+          tr("Document '%1' can't be added.").arg(fileNames[i]);
+    }
+
+    const QString errorMessage = prefetchedDocument.errorMessage;
+    const qint64 size = prefetchedDocument.size;
+
+    // Release the document before reader threads are allowed to continue
+    prefetchedDocument = PrefetchedDocument();
+
+    QMutexLocker lock(&state.mutex);
+    state.bytesInFlight -= size;
+    --state.documentsInFlight;
+
+    if (!errorMessage.isEmpty()) {
+      result = errorMessage;
+      state.isAborted = true;
+    }
+
+    state.condition.wakeAll();
+
+    if (state.isAborted) {
+      break;
+    }
+  }
+
+  threadPool.waitForDone();
+  return result;
+}
+
+QByteArray
+PDFStreamingMerger::getDeduplicationKey(const PDFObjectStorage &storage,
+                                        const PDFStream *stream) {
+  const QByteArray content = stream->getDecryptedContent();
+  if (content.size() < DEDUPLICATION_MIN_STREAM_SIZE) {
+    return QByteArray();
+  }
+
+  PDFDictionary dictionary;
+  const PDFDictionary *streamDictionary = stream->getDictionary();
+  for (size_t i = 0, count = streamDictionary->getCount(); i < count; ++i) {
+    const PDFInplaceOrMemoryString &key = streamDictionary->getKey(i);
+    if (key == "Length") {
+      continue;
+    }
+
+    // Referenced scalar values are resolved. Stream is not deduplicated,
+    // if it refers to other objects (for example, decode parameters),
+    // because they can differ between documents.
+    const PDFObject &value = storage.getObject(streamDictionary->getValue(i));
+    if (containsReferences(value) || value.isStream()) {
+      return QByteArray();
+    }
+
+    dictionary.addEntry(PDFInplaceOrMemoryString(key), PDFObject(value));
+  }
+
+  QCryptographicHash hash(QCryptographicHash::Sha256);
+  hash.addData(PDFDocumentWriter::getSerializedObject(
+      PDFObject::createDictionary(
+          std::make_shared<PDFDictionary>(std::move(dictionary)))));
+  hash.addData(content);
+  return hash.result();
+}
+
+PDFObject PDFStreamingMerger::createPassthroughStream(
+    const PDFStream *stream,
+    const std::map<PDFObjectReference, PDFObjectReference> &referenceMapping) {
+  PDFObject dictionaryObject = PDFObjectUtils::replaceReferences(
+      PDFObject::createDictionary(
+          std::make_shared<PDFDictionary>(*stream->getDictionary())),
+      referenceMapping);
+
+  QByteArray content = stream->getDecryptedContent();
+  PDFDictionary dictionary = *dictionaryObject.getDictionary();
+  dictionary.setEntry(PDFInplaceOrMemoryString("Length"),
+                      PDFObject::createInteger(content.size()));
+
+  // Decrypted content is owned by the byte array, unencrypted content
+  // refers to the source data, so source data owner must be kept
+  PDFStreamDataOwner dataOwner = stream->isContentDecryptedLazily()
+                                     ? PDFStreamDataOwner()
+                                     : stream->getDataOwner();
+  return PDFObject::createStream(std::make_shared<PDFStream>(
+      std::move(dictionary), std::move(content), std::move(dataOwner)));
+}
+
 PDFOperationResult PDFStreamingMerger::finish() {
   if (!m_writer) {
     return tr("Merger is not initialized.");
@@ -28,7 +28,9 @@
 #include "pdfprogress.h"
 #include "pdfutils.h"
 
+#include <QCache>
 #include <QIODevice>
+#include <map>
 #include <memory>
 #include <vector>
 
@@ -47,7 +49,9 @@ namespace pdf {
 /// 4. Call endDocument() to finalize (writes xref and trailer)
 ///
 /// Objects are written immediately to the output device, and only their offsets
-/// are tracked in memory.
+/// are tracked in memory. In compressed mode, small non-stream objects are
+/// buffered into bounded batches, which are flushed as compressed object
+/// streams, and document is finished with a cross-reference stream.
 class PDF4QTLIBCORESHARED_EXPORT PDFStreamingDocumentWriter {
   Q_DECLARE_TR_FUNCTIONS(pdf::PDFStreamingDocumentWriter)
 
@@ -56,6 +60,30 @@ public:
                                       PDFProgress *progress = nullptr);
   ~PDFStreamingDocumentWriter();
 
+  enum class Mode {
+    Classic,   ///< Objects are written as indirect objects, xref table is used
+    Compressed ///< Objects are packed into object streams, xref stream is used
+  };
+
+  /// Maximal number of objects in one object stream batch
+  static constexpr size_t OBJECT_STREAM_MAX_OBJECTS = 100;
+
+  /// Maximal size of uncompressed data of one object stream batch (in bytes)
+  static constexpr qsizetype OBJECT_STREAM_MAX_SIZE = 64 * 1024;
+
+  /// Maximal size of serialized object, which can be put into object stream
+  /// (in bytes). Larger objects are written directly as indirect objects.
+  static constexpr qsizetype OBJECT_STREAM_MAX_OBJECT_SIZE = 4 * 1024;
+
+  /// Sets writing mode. Must be called before beginDocument(). Object streams
+  /// and cross-reference streams require PDF 1.5, so in compressed mode,
+  /// version in the file header is raised to 1.5, if lower version is used.
+  /// @param mode Mode
+  void setMode(Mode mode) { m_mode = mode; }
+
+  /// Returns writing mode
+  Mode getMode() const { return m_mode; }
+
   /// Begins writing a new PDF document. Must be called before any writeObject
   /// calls.
   /// @param version PDF version (default 1.7)
@@ -109,6 +137,12 @@ public:
   /// Checks if the writer is in a valid state for writing.
   bool isOpen() const { return m_isOpen; }
 
+  /// Returns reference of the page tree root, which is created in
+  /// createPageTree(). Reference is reserved, when this function is called
+  /// for the first time, so pages can refer to their parent before the page
+  /// tree is written.
+  PDFObjectReference getPageTreeRootReference();
+
   /// Creates a simple page tree containing all added pages.
   /// @return Reference to the page tree root
   PDFObjectReference createPageTree();
@@ -124,21 +158,42 @@ private:
   void writeObjectFooter();
   void writeObjectContent(const PDFObject &object);
 
+  /// Writes object either directly, or, in compressed mode, into the pending
+  /// object stream batch.
+  void writeIndirectObject(PDFObjectReference reference,
+                           const PDFObject &object);
+
+  /// Writes pending object stream batch (if any) to the output device
+  void flushObjectStream();
+
+  /// Writes cross-reference stream and trailer entries
+  void writeCrossReferenceStream(const PDFObject &trailerDictionary);
+
   struct ObjectEntry {
     PDFInteger offset = -1; // -1 means not yet written
     PDFInteger generation = 0;
+    PDFInteger objectStream = -1; // Object stream number, if compressed
+    PDFInteger objectStreamIndex = 0;
     bool isReserved = false;
+
+    bool isWritten() const { return offset != -1 || objectStream != -1; }
   };
 
   QIODevice *m_device;
   PDFProgress *m_progress;
   PDFVersion m_version;
+  Mode m_mode = Mode::Classic;
   bool m_isOpen = false;
 
+  std::vector<PDFInteger> m_objectStreamObjects;
+  QByteArray m_objectStreamOffsets;
+  QByteArray m_objectStreamContent;
+
   std::vector<ObjectEntry> m_objectOffsets;
   std::vector<PDFObjectReference> m_pages;
   PDFObjectReference m_catalogReference;
   PDFObjectReference m_infoReference;
+  PDFObjectReference m_pageTreeRootReference;
 };
 
 /// Helper class for streaming merge operations.
@@ -165,6 +220,50 @@ public:
   bool addDocument(const PDFDocument &document, int documentIndex = 0,
                    bool namespaceFields = false);
 
+  /// Page selected for the page subset import
+  struct SelectedPage {
+    PDFInteger pageIndex = 0; ///< Page index (zero based)
+    PageRotation pageRotation =
+        PageRotation::None; ///< Rotation written to the page
+  };
+
+  /// Adds selected pages of the document. Only objects reachable from the
+  /// selected pages are read and written, so if objects of the document are
+  /// loaded lazily, objects used only by other pages are never parsed.
+  /// Inherited page attributes are written directly to the pages. References
+  /// to pages, which are not selected (for example, from link annotations),
+  /// are replaced by null objects. Page can be selected multiple times.
+  /// @param document Document
+  /// @param pages Selected pages
+  /// @return Operation result
+  PDFOperationResult addPages(const PDFDocument &document,
+                              const std::vector<SelectedPage> &pages);
+
+  /// Opens document stored in the file with lazy object loading and adds
+  /// its selected pages, see addPages(const PDFDocument&, ...).
+  /// @param fileName File name of the document
+  /// @param pages Selected pages
+  /// @return Operation result
+  PDFOperationResult addPages(const QString &fileName,
+                              const std::vector<SelectedPage> &pages);
+
+  /// Default memory budget of documents, which were read in advance (in bytes)
+  static constexpr qint64 DEFAULT_PREFETCH_MEMORY_BUDGET = 256 * 1024 * 1024;
+
+  /// Adds all pages from documents stored in files, in the given order. Merge
+  /// is pipelined - reader threads parse upcoming documents, while current
+  /// document is being written. Count of documents read in advance is limited
+  /// by memory budget (estimated by file size), but at least one document is
+  /// always read, even if it exceeds the budget. Each document is released
+  /// from memory immediately after it is written.
+  /// @param fileNames Files of documents to be added
+  /// @param readerCount Count of reader threads
+  /// @param memoryBudget Memory budget of documents read in advance
+  /// @return Operation result
+  PDFOperationResult
+  addDocuments(const QStringList &fileNames, int readerCount = 2,
+               qint64 memoryBudget = DEFAULT_PREFETCH_MEMORY_BUDGET);
+
   /// Finalizes the merge and closes the output file.
   /// @return Operation result
   PDFOperationResult finish();
@@ -175,13 +274,71 @@ public:
   /// Returns the total documents added.
   size_t getTotalDocuments() const { return m_totalDocuments; }
 
+  /// Sets writing mode of the output document. Must be called before begin().
+  /// @param mode Mode
+  void setMode(PDFStreamingDocumentWriter::Mode mode) { m_mode = mode; }
+
+  /// Minimal size of stream content (in bytes), for which deduplication
+  /// across merged documents is performed
+  static constexpr qsizetype DEDUPLICATION_MIN_STREAM_SIZE = 1024;
+
+  /// Maximal count of entries in the deduplication table. If table is full,
+  /// least recently used entries are discarded.
+  static constexpr qsizetype DEDUPLICATION_MAX_ENTRIES = 16384;
+
+  /// Enables or disables deduplication of streams (fonts, images, color
+  /// profiles, ...) across merged documents. Identical streams are written
+  /// only once, and all documents refer to the written stream. Enabled
+  /// by default.
+  /// @param enabled Enable deduplication
+  void setDeduplicationEnabled(bool enabled) { m_deduplicationEnabled = enabled; }
+
+  /// Returns count of streams, which were not written, because
+  /// identical stream was already written.
+  size_t getDeduplicatedStreamCount() const { return m_deduplicatedStreamCount; }
+
 private:
+  /// Returns deduplication key of the stream - hash of its dictionary (without
+  /// length, referenced scalar values are resolved) and its data. If stream
+  /// is too small, or its dictionary refers to non-scalar objects, then
+  /// empty key is returned and stream is not deduplicated.
+  /// @param storage Storage of the source document
+  /// @param stream Stream
+  static QByteArray getDeduplicationKey(const PDFObjectStorage &storage,
+                                        const PDFStream *stream);
+
+  /// Creates stream for the output document, whose content is taken from the
+  /// source stream byte for byte (still encoded), only references in the
+  /// dictionary are remapped, and length is written as direct object. Content
+  /// of unencrypted stream is not copied, it refers to the source data.
+  /// Encrypted content is decrypted without being cached in the source document.
+  /// @param stream Source stream
+  /// @param referenceMapping Mapping of source references to output references
+  static PDFObject createPassthroughStream(
+      const PDFStream *stream,
+      const std::map<PDFObjectReference, PDFObjectReference> &referenceMapping);
+
+  /// Creates page dictionary for the page subset import. Page dictionary
+  /// is copied, inherited attributes are written directly, and reference
+  /// to the parent is removed.
+  /// @param storage Storage of the source document
+  /// @param page Page
+  /// @param pageRotation Page rotation
+  static PDFObject createSelectedPageObject(const PDFObjectStorage &storage,
+                                            const PDFPage *page,
+                                            PageRotation pageRotation);
+
   QString m_outputPath;
   PDFProgress *m_progress;
+  PDFStreamingDocumentWriter::Mode m_mode =
+      PDFStreamingDocumentWriter::Mode::Classic;
   std::unique_ptr<QIODevice> m_device;
   std::unique_ptr<PDFStreamingDocumentWriter> m_writer;
   size_t m_totalPages = 0;
   size_t m_totalDocuments = 0;
+  bool m_deduplicationEnabled = true;
+  size_t m_deduplicatedStreamCount = 0;
+  QCache<QByteArray, PDFObjectReference> m_deduplicationTable;
 };
 
 } // namespace pdf
@@ -499,31 +499,211 @@ void PDFStructureTreeAttribute::parseAttributeDictionary(const PDFObjectStorage*
     }
 }
 
+/// Entry of the parent tree (number tree), used for parsing
+struct PDFStructureTreeParentTreeParseEntry
+{
+    PDFInteger id = 0;
+    std::vector<PDFObjectReference> references;
+
+    bool operator<(const PDFStructureTreeParentTreeParseEntry& other) const
+    {
+        return id < other.id;
+    }
+
+    static PDFStructureTreeParentTreeParseEntry parse(PDFInteger id, const PDFObjectStorage* storage, const PDFObject& object)
+    {
+        const PDFObject& dereferencedObject = storage->getObject(object);
+
+        if (dereferencedObject.isArray())
+        {
+            std::vector<PDFObjectReference> references;
+            for (const PDFObject& objectInArray : *dereferencedObject.getArray())
+            {
+                if (objectInArray.isReference())
+                {
+                    references.emplace_back(objectInArray.getReference());
+                }
+            }
+
+            return PDFStructureTreeParentTreeParseEntry{ id, qMove(references) };
+        }
+        else if (object.isReference())
+        {
+            return PDFStructureTreeParentTreeParseEntry{ id, { object.getReference() } };
+        }
+
+        return PDFStructureTreeParentTreeParseEntry{ id, { } };
+    }
+};
+
+PDFStructureTree::PDFStructureTree(PDFStructureTree&& other) :
+    PDFStructureItem(nullptr, this)
+{
+    *this = std::move(other);
+}
+
+PDFStructureTree& PDFStructureTree::operator=(PDFStructureTree&& other)
+{
+    if (this != &other)
+    {
+        QMutexLocker lock(&other.m_mutex);
+
+        m_selfReference = other.m_selfReference;
+        m_childrenLoaded.store(other.m_childrenLoaded.load());
+        m_kids = std::move(other.m_kids);
+        m_children = std::move(other.m_children);
+        m_storage = other.m_storage;
+        m_loadedItems = std::move(other.m_loadedItems);
+        m_allItemsLoaded = other.m_allItemsLoaded;
+        m_idTreeMap = std::move(other.m_idTreeMap);
+        m_parentTreeRoot = std::move(other.m_parentTreeRoot);
+        m_parents = std::move(other.m_parents);
+        m_parentTreeEntries = std::move(other.m_parentTreeEntries);
+        m_parentNextKey = other.m_parentNextKey;
+        m_roleMap = std::move(other.m_roleMap);
+        m_classMap = std::move(other.m_classMap);
+        m_namespaces = std::move(other.m_namespaces);
+        m_pronunciationLexicons = std::move(other.m_pronunciationLexicons);
+        m_associatedFiles = std::move(other.m_associatedFiles);
+
+        other.m_children.clear();
+        other.m_loadedItems.clear();
+        other.m_childrenLoaded.store(true);
+
+        updateRoot();
+    }
+
+    return *this;
+}
+
+void PDFStructureTree::updateRoot()
+{
+    // Only loaded items are updated, items, which will be
+    // loaded later, get the root from their parent.
+    std::vector<PDFStructureItem*> stack = { this };
+    while (!stack.empty())
+    {
+        PDFStructureItem* item = stack.back();
+        stack.pop_back();
+
+        for (const PDFStructureItemPointer& child : item->m_children)
+        {
+            if (item == this)
+            {
+                child->m_parent = this;
+            }
+
+            child->m_root = this;
+            stack.push_back(child.get());
+        }
+    }
+}
+
 std::vector<PDFObjectReference> PDFStructureTree::getParents(PDFInteger id) const
 {
-    std::vector<PDFObjectReference> result;
-    ParentTreeEntry entry{ id, PDFObjectReference() };
+    QMutexLocker lock(&m_mutex);
 
-    Q_ASSERT(std::is_sorted(m_parentTreeEntries.cbegin(), m_parentTreeEntries.cend()));
-    auto iterators = std::equal_range(m_parentTreeEntries.cbegin(), m_parentTreeEntries.cend(), entry);
-    result.reserve(std::distance(iterators.first, iterators.second));
-    std::transform(iterators.first, iterators.second, std::back_inserter(result), [](const auto& item) { return item.reference; });
-    return result;
+    auto it = m_parents.find(id);
+    if (it == m_parents.cend())
+    {
+        // Find only the entry in the parent tree, whole tree is not loaded
+        std::optional<PDFStructureTreeParentTreeParseEntry> entry;
+        if (m_storage)
+        {
+            entry = PDFNumberTreeLoader<PDFStructureTreeParentTreeParseEntry>::find(m_storage, m_parentTreeRoot, id);
+        }
+
+        it = m_parents.emplace(id, entry ? std::move(entry->references) : std::vector<PDFObjectReference>()).first;
+    }
+
+    return it->second;
 }
 
 PDFObjectReference PDFStructureTree::getParent(PDFInteger id, PDFInteger index) const
 {
-    Q_ASSERT(std::is_sorted(m_parentTreeEntries.cbegin(), m_parentTreeEntries.cend()));
-    ParentTreeEntry entry{ id, PDFObjectReference() };
-    auto [it, itEnd] = std::equal_range(m_parentTreeEntries.cbegin(), m_parentTreeEntries.cend(), entry);
-    const PDFInteger count = std::distance(it, itEnd);
-    if (index >= 0 && index < count)
+    std::vector<PDFObjectReference> parents = getParents(id);
+    if (index >= 0 && index < PDFInteger(parents.size()))
     {
-        return (*std::next(it, index)).reference;
+        return parents[index];
     }
     return PDFObjectReference();
 }
 
+const PDFStructureItem* PDFStructureTree::getItem(PDFObjectReference reference) const
+{
+    if (!reference.isValid() || !m_storage)
+    {
+        return nullptr;
+    }
+
+    if (reference == m_selfReference)
+    {
+        return this;
+    }
+
+    {
+        QMutexLocker lock(&m_mutex);
+        auto it = m_loadedItems.find(reference);
+        if (it != m_loadedItems.cend())
+        {
+            return it->second;
+        }
+
+        if (m_allItemsLoaded)
+        {
+            return nullptr;
+        }
+    }
+
+    // Find path to the root using parent entries of the structure elements
+    std::vector<PDFObjectReference> path;
+    std::set<PDFObjectReference> visited;
+    PDFObjectReference current = reference;
+    while (current.isValid() && current != m_selfReference && visited.insert(current).second)
+    {
+        path.push_back(current);
+
+        const PDFDictionary* dictionary = m_storage->getDictionaryFromObject(m_storage->getObjectByReference(current));
+        const PDFObject& parentObject = dictionary ? dictionary->get("P") : PDFObject();
+        current = parentObject.isReference() ? parentObject.getReference() : PDFObjectReference();
+    }
+
+    // Load children on the path from the root
+    const PDFStructureItem* item = this;
+    for (auto it = path.crbegin(); it != path.crend() && item; ++it)
+    {
+        item->loadChildren();
+
+        QMutexLocker lock(&m_mutex);
+        auto itemIt = m_loadedItems.find(*it);
+        item = itemIt != m_loadedItems.cend() ? itemIt->second : nullptr;
+    }
+
+    if (item && item != this)
+    {
+        return item;
+    }
+
+    // Parent entries are invalid, so we must load the whole tree
+    std::vector<const PDFStructureItem*> stack = { this };
+    while (!stack.empty())
+    {
+        const PDFStructureItem* currentItem = stack.back();
+        stack.pop_back();
+
+        const size_t childCount = currentItem->getChildCount();
+        for (size_t i = 0; i < childCount; ++i)
+        {
+            stack.push_back(currentItem->getChild(i));
+        }
+    }
+
+    QMutexLocker lock(&m_mutex);
+    m_allItemsLoaded = true;
+    auto it = m_loadedItems.find(reference);
+    return it != m_loadedItems.cend() ? it->second : nullptr;
+}
+
 PDFStructureItem::Type PDFStructureTree::getTypeFromRole(const QByteArray& role) const
 {
     auto it = m_roleMap.find(role);
@@ -555,61 +735,16 @@ PDFStructureTree PDFStructureTree::parse(const PDFObjectStorage* storage, PDFObj
     {
         PDFDocumentDataLoaderDecorator loader(storage);
 
-        PDFMarkedObjectsContext context;
-        parseKids(storage, &tree, dictionary, &context);
+        tree.m_storage = storage;
+        tree.m_selfReference = object.isReference() ? object.getReference() : PDFObjectReference();
+        tree.setKids(dictionary->get("K"));
 
         if (dictionary->hasKey("IDTree"))
         {
             tree.m_idTreeMap = PDFNameTreeLoader<PDFObjectReference>::parse(storage, dictionary->get("IDTree"), [](const PDFObjectStorage*, const PDFObject& object) { return object.isReference() ? object.getReference() : PDFObjectReference(); });
         }
 
-        if (dictionary->hasKey("ParentTree"))
-        {
-            struct ParentTreeParseEntry
-            {
-                PDFInteger id = 0;
-                std::vector<PDFObjectReference> references;
-
-                bool operator<(const ParentTreeParseEntry& other) const
-                {
-                    return id < other.id;
-                }
-
-                static ParentTreeParseEntry parse(PDFInteger id, const PDFObjectStorage* storage, const PDFObject& object)
-                {
-                    const PDFObject& dereferencedObject = storage->getObject(object);
-
-                    if (dereferencedObject.isArray())
-                    {
-                        std::vector<PDFObjectReference> references;
-                        for (const PDFObject& objectInArray : *dereferencedObject.getArray())
-                        {
-                            if (objectInArray.isReference())
-                            {
-                                references.emplace_back(objectInArray.getReference());
-                            }
-                        }
-
-                        return ParentTreeParseEntry{ id, qMove(references) };
-                    }
-                    else if (object.isReference())
-                    {
-                        return ParentTreeParseEntry{ id, { object.getReference() } };
-                    }
-
-                    return ParentTreeParseEntry{ id, { } };
-                }
-            };
-            auto entries = PDFNumberTreeLoader<ParentTreeParseEntry>::parse(storage, dictionary->get("ParentTree"));
-            for (const auto& entry : entries)
-            {
-                for (const PDFObjectReference& reference : entry.references)
-                {
-                    tree.m_parentTreeEntries.emplace_back(ParentTreeEntry{entry.id, reference});
-                }
-            }
-            std::stable_sort(tree.m_parentTreeEntries.begin(), tree.m_parentTreeEntries.end());
-        }
+        tree.m_parentTreeRoot = dictionary->get("ParentTree");
 
         tree.m_parentNextKey = loader.readIntegerFromDictionary(dictionary, "ParentTreeNextKey", 0);
 
@@ -652,9 +787,29 @@ PDFStructureTree PDFStructureTree::parse(const PDFObjectStorage* storage, PDFObj
 
 PDFStructureTree::ParentTreeEntry PDFStructureTree::getParentTreeEntry(PDFInteger index) const
 {
-    if (index >= 0 && index < PDFInteger(m_parentTreeEntries.size()))
+    QMutexLocker lock(&m_mutex);
+
+    if (!m_parentTreeEntries)
+    {
+        ParentTreeEntries parentTreeEntries;
+        if (m_storage)
+        {
+            auto entries = PDFNumberTreeLoader<PDFStructureTreeParentTreeParseEntry>::parse(m_storage, m_parentTreeRoot);
+            for (const auto& entry : entries)
+            {
+                for (const PDFObjectReference& reference : entry.references)
+                {
+                    parentTreeEntries.emplace_back(ParentTreeEntry{entry.id, reference});
+                }
+            }
+            std::stable_sort(parentTreeEntries.begin(), parentTreeEntries.end());
+        }
+        m_parentTreeEntries = std::move(parentTreeEntries);
+    }
+
+    if (index >= 0 && index < PDFInteger(m_parentTreeEntries->size()))
     {
-        return m_parentTreeEntries[index];
+        return (*m_parentTreeEntries)[index];
     }
 
     return ParentTreeEntry();
@@ -697,9 +852,8 @@ PDFStructureItem::Type PDFStructureItem::getTypeFromName(const QByteArray& name)
     return Invalid;
 }
 
-void PDFStructureItem::parseKids(const PDFObjectStorage* storage, PDFStructureItem* parentItem, const PDFDictionary* dictionary, PDFMarkedObjectsContext* context)
+void PDFStructureItem::parseKids(const PDFObjectStorage* storage, PDFStructureItem* parentItem, const PDFObject& kids, PDFMarkedObjectsContext* context)
 {
-    PDFObject kids = dictionary->get("K");
     if (kids.isArray())
     {
         const PDFArray* kidsArray = kids.getArray();
@@ -722,6 +876,47 @@ void PDFStructureItem::parseKids(const PDFObjectStorage* storage, PDFStructureIt
     }
 }
 
+void PDFStructureItem::setKids(PDFObject kids)
+{
+    m_childrenLoaded.store(kids.isNull());
+    m_kids = std::move(kids);
+}
+
+void PDFStructureItem::loadChildrenImpl() const
+{
+    QMutexLocker lock(&m_root->m_mutex);
+
+    if (m_childrenLoaded.load(std::memory_order_relaxed))
+    {
+        // Children were loaded by other thread
+        return;
+    }
+
+    // Mark ancestors of the item, so cycles in the structure tree are detected
+    PDFMarkedObjectsContext context;
+    for (const PDFStructureItem* item = this; item; item = item->m_parent)
+    {
+        if (item->m_selfReference.isValid())
+        {
+            context.mark(item->m_selfReference);
+        }
+    }
+
+    PDFStructureItem* parentItem = const_cast<PDFStructureItem*>(this);
+    parseKids(m_root->m_storage, parentItem, m_kids, &context);
+    m_kids = PDFObject();
+
+    for (const PDFStructureItemPointer& child : m_children)
+    {
+        if (child->m_selfReference.isValid())
+        {
+            m_root->m_loadedItems.emplace(child->m_selfReference, child.get());
+        }
+    }
+
+    m_childrenLoaded.store(true, std::memory_order_release);
+}
+
 PDFStructureTreeNamespace PDFStructureTreeNamespace::parse(const PDFObjectStorage* storage, PDFObject object)
 {
     PDFStructureTreeNamespace result;
@@ -743,6 +938,20 @@ PDFStructureTreeNamespace PDFStructureTreeNamespace::parse(const PDFObjectStorag
     return result;
 }
 
+const QString& PDFStructureElement::getText(StringValue stringValue) const
+{
+    for (const auto& text : m_texts)
+    {
+        if (text.first == stringValue)
+        {
+            return text.second;
+        }
+    }
+
+    static const QString dummy;
+    return dummy;
+}
+
 const PDFStructureTreeAttribute* PDFStructureElement::findAttribute(Attribute attribute,
                                                                     AttributeOwner owner,
                                                                     RevisionPolicy policy) const
@@ -859,18 +1068,31 @@ PDFStructureItemPointer PDFStructureElement::parseElement(const PDFObjectStorage
             std::reverse(attributes.begin(), attributes.end());
             item->m_attributes = qMove(attributes);
             item->m_revision = loader.readIntegerFromDictionary(dictionary, "R", 0);
-            item->m_texts[Title] = loader.readTextStringFromDictionary(dictionary, "T", QString());
-            item->m_texts[Language] = loader.readTextStringFromDictionary(dictionary, "Lang", QString());
-            item->m_texts[AlternativeDescription] = loader.readTextStringFromDictionary(dictionary, "Alt", QString());
-            item->m_texts[ExpandedForm] = loader.readTextStringFromDictionary(dictionary, "E", QString());
-            item->m_texts[ActualText] = loader.readTextStringFromDictionary(dictionary, "ActualText", QString());
-            item->m_texts[Phoneme] = loader.readTextStringFromDictionary(dictionary, "Phoneme", QString());
+
+            constexpr const std::array<std::pair<StringValue, const char*>, LastStringValue> textKeys =
+            {
+                std::pair<StringValue, const char*>{ Title, "T" },
+                std::pair<StringValue, const char*>{ Language, "Lang" },
+                std::pair<StringValue, const char*>{ AlternativeDescription, "Alt" },
+                std::pair<StringValue, const char*>{ ExpandedForm, "E" },
+                std::pair<StringValue, const char*>{ ActualText, "ActualText" },
+                std::pair<StringValue, const char*>{ Phoneme, "Phoneme" }
+            };
+
+            for (const auto& [stringValue, key] : textKeys)
+            {
+                QString text = loader.readTextStringFromDictionary(dictionary, key, QString());
+                if (!text.isEmpty())
+                {
+                    item->m_texts.emplace_back(stringValue, std::move(text));
+                }
+            }
 
             item->m_associatedFiles = loader.readObjectList<PDFFileSpecification>(dictionary->get("AF"));
             item->m_namespace = loader.readReferenceFromDictionary(dictionary, "NS");
             item->m_phoneticAlphabet = loader.readNameFromDictionary(dictionary, "PhoneticAlphabet");
 
-            parseKids(storage, item, dictionary, context);
+            item->setKids(dictionary->get("K"));
         }
     }
 
@@ -23,6 +23,7 @@
 #ifndef PDFSTRUCTURETREE_H
 #define PDFSTRUCTURETREE_H
 
+#include <QMutex>
 #include <QSharedPointer>
 
 #include "pdfobject.h"
@@ -30,6 +31,10 @@
 #include "pdffile.h"
 #include "pdfexception.h"
 
+#include <atomic>
+#include <optional>
+#include <unordered_map>
+
 namespace pdf
 {
 class PDFDocument;
@@ -318,8 +323,8 @@ public:
     const PDFStructureTree* getTree() const { return m_root; }
     PDFStructureTree* getTree() { return m_root; }
     PDFObjectReference getSelfReference() const { return m_selfReference; }
-    std::size_t getChildCount() const { return m_children.size(); }
-    const PDFStructureItem* getChild(size_t i) const { return m_children.at(i).get(); }
+    std::size_t getChildCount() const { loadChildren(); return m_children.size(); }
+    const PDFStructureItem* getChild(size_t i) const { loadChildren(); return m_children.at(i).get(); }
 
     /// Parses structure tree item from the object. If error occurs,
     /// null pointer is returned.
@@ -334,21 +339,41 @@ public:
     static Type getTypeFromName(const QByteArray& name);
 
 protected:
+    friend class PDFStructureTree;
+
     /// Parses kids of the item. Invalid items aren't added
     /// to the kid list.
     /// \param storage Storage
     /// \param parentItem Parent item, where children are inserted
-    /// \param dictionary Dictionary
+    /// \param kids Kids object (entry /K of the item)
     /// \param context Context
     static void parseKids(const PDFObjectStorage* storage,
                           PDFStructureItem* parentItem,
-                          const PDFDictionary* dictionary,
+                          const PDFObject& kids,
                           PDFMarkedObjectsContext* context);
 
+    /// Sets kids of the item, which will be loaded, when
+    /// children are accessed for the first time.
+    /// \param kids Kids object (entry /K of the item)
+    void setKids(PDFObject kids);
+
+    /// Loads children of the item, if they were not loaded yet
+    void loadChildren() const
+    {
+        if (!m_childrenLoaded.load(std::memory_order_acquire))
+        {
+            loadChildrenImpl();
+        }
+    }
+
+    void loadChildrenImpl() const;
+
     PDFStructureItem* m_parent;
     PDFStructureTree* m_root;
     PDFObjectReference m_selfReference;
-    std::vector<PDFStructureItemPointer> m_children;
+    mutable std::atomic_bool m_childrenLoaded = true;
+    mutable PDFObject m_kids;
+    mutable std::vector<PDFStructureItemPointer> m_children;
 };
 
 /// Structure tree namespace
@@ -373,12 +398,22 @@ private:
 
 using PDFStructureTreeNamespaces = std::vector<PDFStructureTreeNamespace>;
 
-/// Structure tree, contains structure element hierarchy
+/// Structure tree, contains structure element hierarchy. Tree of tagged documents
+/// can be very large, so it is loaded lazily - children of the structure tree items
+/// are loaded, when they are accessed for the first time, and parent tree entries
+/// are looked up in the parent tree, when they are requested. Object storage must
+/// exist for the lifetime of the structure tree. Items can be accessed from multiple threads.
 class PDF4QTLIBCORESHARED_EXPORT PDFStructureTree : public PDFStructureItem
 {
 public:
     explicit inline PDFStructureTree() : PDFStructureItem(nullptr, this) { }
 
+    PDFStructureTree(const PDFStructureTree&) = delete;
+    PDFStructureTree(PDFStructureTree&& other);
+
+    PDFStructureTree& operator=(const PDFStructureTree&) = delete;
+    PDFStructureTree& operator=(PDFStructureTree&& other);
+
     virtual PDFStructureTree* asStructureTree() override { return this; }
     virtual const PDFStructureTree* asStructureTree() const override { return this; }
 
@@ -396,6 +431,12 @@ public:
     /// \param index Index into the subarray
     PDFObjectReference getParent(PDFInteger id, PDFInteger index) const;
 
+    /// Returns structure tree item with given reference. Only items on the path
+    /// from the root to the item are loaded (path is determined using /P entries
+    /// of the structure elements). If item is not found, nullptr is returned.
+    /// \param reference Reference to the structure tree item
+    const PDFStructureItem* getItem(PDFObjectReference reference) const;
+
     /// Returns type from role. Role can be an entry in RoleMap dictionary,
     /// or one of the standard roles.
     /// \param role Role
@@ -436,15 +477,27 @@ public:
     };
 
     /// Returns given page tree entry. If index is invalid,
-    /// empty parent tree entry is returned.
+    /// empty parent tree entry is returned. Whole parent
+    /// tree is loaded, when this function is called first time.
     /// \param index Index
     ParentTreeEntry getParentTreeEntry(PDFInteger index) const;
 
 private:
+    friend class PDFStructureItem;
+
     using ParentTreeEntries = std::vector<ParentTreeEntry>;
 
+    /// Updates root pointer of loaded items, after tree was moved
+    void updateRoot();
+
+    const PDFObjectStorage* m_storage = nullptr;
+    mutable QMutex m_mutex;
+    mutable std::unordered_map<PDFObjectReference, const PDFStructureItem*, PDFObjectReferenceHash> m_loadedItems;
+    mutable bool m_allItemsLoaded = false;
     std::map<QByteArray, PDFObjectReference> m_idTreeMap;
-    ParentTreeEntries m_parentTreeEntries;
+    PDFObject m_parentTreeRoot;
+    mutable std::map<PDFInteger, std::vector<PDFObjectReference>> m_parents;
+    mutable std::optional<ParentTreeEntries> m_parentTreeEntries;
     PDFInteger m_parentNextKey = 0;
     std::map<QByteArray, Type> m_roleMap;
     std::map<QByteArray, std::vector<PDFStructureTreeAttribute>> m_classMap;
@@ -485,7 +538,7 @@ public:
     const PDFObjectReference& getPageReference() const { return m_pageReference; }
     const std::vector<PDFStructureTreeAttribute>& getAttributes() const { return m_attributes; }
     PDFInteger getRevision() const { return m_revision; }
-    const QString& getText(StringValue stringValue) const { return m_texts.at(stringValue); }
+    const QString& getText(StringValue stringValue) const;
     const std::vector<PDFFileSpecification>& getAssociatedFiles() const { return m_associatedFiles; }
     const PDFObjectReference& getNamespace() const { return m_namespace; }
     const QByteArray& getPhoneticAlphabet() const { return m_phoneticAlphabet; }
@@ -539,7 +592,7 @@ private:
     PDFObjectReference m_pageReference;
     std::vector<PDFStructureTreeAttribute> m_attributes;
     PDFInteger m_revision = 0;
-    std::array<QString, LastStringValue> m_texts;
+    std::vector<std::pair<StringValue, QString>> m_texts;   ///< Only non-empty texts are stored
     std::vector<PDFFileSpecification> m_associatedFiles;
     PDFObjectReference m_namespace;
     QByteArray m_phoneticAlphabet;
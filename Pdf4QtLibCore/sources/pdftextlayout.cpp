@@ -23,6 +23,7 @@
 #include "pdftextlayout.h"
 #include "pdfutils.h"
 #include "pdfexecutionpolicy.h"
+#include "pdfoperationcontrol.h"
 #include "pdfcms.h"
 
 #include <QtMath>
@@ -34,6 +35,9 @@
 
 #include "pdfdbgheap.h"
 
+#include <map>
+#include <atomic>
+#include <numeric>
 #include <execution>
 
 namespace pdf
@@ -84,22 +88,22 @@ public:
 
     /// Performs query on structure - finds all characters, which are in given
     /// rectangle, and returns intersection size. If \p result parameter is set
-    /// to valid pointer, all intersected  characters are inserted into the result
-    /// array.
+    /// to valid pointer, indices (into the array, over which structure is build)
+    /// of all intersected characters are inserted into the result array.
     /// \param rect Query rectangle
     /// \param result Result of query (can be nullptr)
     /// \returns Size of intersection
-    size_t query(const QRectF& rect, TextCharacters* result) const;
+    size_t query(const QRectF& rect, std::vector<size_t>* result) const;
 
-    /// Finds character array, which contains at least \p minimalSize characters,
+    /// Finds indices of characters, which contains at least \p minimalSize characters,
     /// with some extra characters, which must be filtered out.
     /// \param minimalSize Minimal size
     /// \param sample Sample character
     /// \param result Result
-    void queryNearestEstimate(size_t minimalSize, const TextCharacter& sample, TextCharacters* result) const;
+    void queryNearestEstimate(size_t minimalSize, const TextCharacter& sample, std::vector<size_t>* result) const;
 
 private:
-    size_t queryImpl(size_t nodeIndex, const QRectF& rect, TextCharacters* result) const;
+    size_t queryImpl(size_t nodeIndex, const QRectF& rect, std::vector<size_t>* result) const;
 
     struct Node
     {
@@ -189,7 +193,7 @@ QRectF PDFTextCharacterSpatialIndex::getBoundingBox(Iterator it1, Iterator it2)
     return QRectF();
 }
 
-size_t PDFTextCharacterSpatialIndex::query(const QRectF& rect, TextCharacters* result) const
+size_t PDFTextCharacterSpatialIndex::query(const QRectF& rect, std::vector<size_t>* result) const
 {
     if (!m_nodes.empty())
     {
@@ -199,11 +203,12 @@ size_t PDFTextCharacterSpatialIndex::query(const QRectF& rect, TextCharacters* r
     return 0;
 }
 
-void PDFTextCharacterSpatialIndex::queryNearestEstimate(size_t minimalSize, const TextCharacter& sample, TextCharacters* result) const
+void PDFTextCharacterSpatialIndex::queryNearestEstimate(size_t minimalSize, const TextCharacter& sample, std::vector<size_t>* result) const
 {
     if (m_characters->size() <= minimalSize)
     {
-        *result = *m_characters;
+        result->resize(m_characters->size());
+        std::iota(result->begin(), result->end(), size_t(0));
     }
     else
     {
@@ -225,7 +230,7 @@ void PDFTextCharacterSpatialIndex::queryNearestEstimate(size_t minimalSize, cons
     }
 }
 
-size_t PDFTextCharacterSpatialIndex::queryImpl(size_t nodeIndex, const QRectF& rect, TextCharacters* result) const
+size_t PDFTextCharacterSpatialIndex::queryImpl(size_t nodeIndex, const QRectF& rect, std::vector<size_t>* result) const
 {
     const Node& node = m_nodes[nodeIndex];
 
@@ -252,8 +257,16 @@ size_t PDFTextCharacterSpatialIndex::queryImpl(size_t nodeIndex, const QRectF& r
 
         if (result)
         {
+            // Indices are not copied from characters, because characters
+            // doesn't need to have valid index during the query.
             const size_t oldSize = result->size();
-            std::copy_if(itStart, itEnd, std::back_inserter(*result), isInside);
+            for (size_t i = node.index1; i < node.index2; ++i)
+            {
+                if (isInside((*m_characters)[i]))
+                {
+                    result->push_back(i);
+                }
+            }
             return result->size() - oldSize;
         }
 
@@ -326,19 +339,21 @@ bool PDFTextLayout::isHoveringOverTextBlock(const QPointF& point) const
     return false;
 }
 
-PDFTextSelection PDFTextLayout::createTextSelection(PDFInteger pageIndex, const QPointF& point1, const QPointF& point2, QColor selectionColor, bool strictSelection)
+PDFTextSelection PDFTextLayout::createTextSelection(PDFInteger pageIndex, const QPointF& point1, const QPointF& point2, QColor selectionColor, bool strictSelection) const
 {
     PDFTextSelection selection;
 
     // Jakub Melka: We must treat each block in its own coordinate system. Because texts can
-    // have different angles, we will treat each block separately.
+    // have different angles, we will treat each block separately. Block itself is not
+    // transformed, we transform only geometry, which we really need. Horizontal blocks
+    // (which are the most common) are not transformed at all.
 
     size_t blockId = 0;
-    for (PDFTextBlock& block : m_blocks)
+    for (const PDFTextBlock& block : m_blocks)
     {
         QTransform angleMatrix;
         angleMatrix.rotate(block.getAngle());
-        block.applyTransform(angleMatrix);
+        const bool isRotated = !angleMatrix.isIdentity();
 
         QPointF pointA = angleMatrix.map(point1);
         QPointF pointB = angleMatrix.map(point2);
@@ -351,7 +366,15 @@ PDFTextSelection PDFTextLayout::createTextSelection(PDFInteger pageIndex, const
         QRectF rect(xMin, yMin, xMax - xMin, yMax - yMin);
         QPainterPath rectPath;
         rectPath.addRect(rect);
-        const QPainterPath& boundingBoxPath = block.getBoundingBox();
+        const QPainterPath boundingBoxPath = isRotated ? angleMatrix.map(block.getBoundingBox()) : block.getBoundingBox();
+
+        // Quick rejection test, intersection of paths is expensive
+        if (!boundingBoxPath.controlPointRect().intersects(rect))
+        {
+            ++blockId;
+            continue;
+        }
+
         QPainterPath intersectionPath = boundingBoxPath.intersected(rectPath);
         if (!intersectionPath.isEmpty())
         {
@@ -362,9 +385,18 @@ PDFTextSelection PDFTextLayout::createTextSelection(PDFInteger pageIndex, const
             bool isBottomPointBelowText = false;
 
             const PDFTextLines& lines = block.getLines();
-            auto itLineA = std::find_if(lines.cbegin(), lines.cend(), [pointA](const PDFTextLine& line) { return line.getBoundingBox().contains(pointA); });
-            auto itLineB = std::find_if(lines.cbegin(), lines.cend(), [pointB](const PDFTextLine& line) { return line.getBoundingBox().contains(pointB); });
-            if (itLineA == itLineB && itLineA != lines.cend())
+
+            // Bounding boxes of lines in the coordinate system of the block
+            std::vector<QRectF> lineBoundingRects;
+            lineBoundingRects.reserve(lines.size());
+            for (const PDFTextLine& line : lines)
+            {
+                lineBoundingRects.push_back(isRotated ? angleMatrix.map(line.getBoundingBox()).boundingRect() : line.getBoundingBox().boundingRect());
+            }
+
+            auto itLineA = std::find_if(lineBoundingRects.cbegin(), lineBoundingRects.cend(), [pointA](const QRectF& lineRect) { return lineRect.contains(pointA); });
+            auto itLineB = std::find_if(lineBoundingRects.cbegin(), lineBoundingRects.cend(), [pointB](const QRectF& lineRect) { return lineRect.contains(pointB); });
+            if (itLineA == itLineB && itLineA != lineBoundingRects.cend())
             {
                 // Both points are in the same line. We consider point with lesser
                 // horizontal coordinate as start selection point, and point with greater
@@ -411,7 +443,7 @@ PDFTextSelection PDFTextLayout::createTextSelection(PDFInteger pageIndex, const
             for (size_t lineId = 0, linesCount = lines.size(); lineId < linesCount; ++lineId)
             {
                 const PDFTextLine& line = lines[lineId];
-                QRectF lineBoundingRect = line.getBoundingBox().boundingRect();
+                const QRectF& lineBoundingRect = lineBoundingRects[lineId];
 
                 // We skip lines, which are not in the range (pointB.y(), pointA.y),
                 // i.e. are above or below.
@@ -425,7 +457,13 @@ PDFTextSelection PDFTextLayout::createTextSelection(PDFInteger pageIndex, const
                 for (size_t characterId = 0, characterCount = characters.size(); characterId < characterCount; ++characterId)
                 {
                     const TextCharacter& character = characters[characterId];
+                    // Character bounding box is a parallelogram, so center of its bounding
+                    // rectangle is mapped to the center of the mapped bounding rectangle.
                     QPointF characterCenter = character.boundingBox.boundingRect().center();
+                    if (isRotated)
+                    {
+                        characterCenter = angleMatrix.map(characterCenter);
+                    }
 
                     qreal distanceA = QLineF(pointA, characterCenter).length();
                     qreal distanceB = QLineF(pointB, characterCenter).length();
@@ -482,9 +520,6 @@ PDFTextSelection PDFTextLayout::createTextSelection(PDFInteger pageIndex, const
 
         // Increment block index
         ++blockId;
-
-        // Apply backward transformation to restore original coordinate system
-        block.applyTransform(angleMatrix.inverted());
     }
 
     selection.build();
@@ -582,6 +617,252 @@ QString PDFTextLayout::getTextFromSelection(const PDFTextSelection& selection, P
     return getTextFromSelection(selection.begin(pageIndex), selection.end(pageIndex), pageIndex);
 }
 
+QByteArray PDFTextLayout::writeCompact() const
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    std::vector<const PDFTextLine*> lines;
+    for (const PDFTextBlock& block : m_blocks)
+    {
+        for (const PDFTextLine& line : block.getLines())
+        {
+            lines.push_back(&line);
+        }
+    }
+
+    std::vector<const TextCharacter*> characters;
+    for (const PDFTextLine* line : lines)
+    {
+        for (const TextCharacter& character : line->getCharacters())
+        {
+            characters.push_back(&character);
+        }
+    }
+
+    stream << COMPACT_FORMAT_VERSION;
+    stream << m_settings;
+    stream << quint32(m_blocks.size()) << quint32(lines.size()) << quint32(characters.size());
+
+    // Blocks
+    for (const PDFTextBlock& block : m_blocks)
+    {
+        stream << quint32(block.getLines().size());
+    }
+    for (const PDFTextBlock& block : m_blocks)
+    {
+        stream << block.getTopLeft();
+        writeCompactPath(stream, block.getBoundingBox());
+    }
+
+    // Lines
+    for (const PDFTextLine* line : lines)
+    {
+        stream << quint32(line->getCharacters().size());
+    }
+    for (const PDFTextLine* line : lines)
+    {
+        stream << line->getTopLeft();
+        writeCompactPath(stream, line->getBoundingBox());
+    }
+
+    // Characters
+    for (const TextCharacter* character : characters)
+    {
+        stream << character->character;
+    }
+    for (const TextCharacter* character : characters)
+    {
+        stream << float(character->position.x()) << float(character->position.y());
+    }
+    for (const TextCharacter* character : characters)
+    {
+        stream << qint16(character->angle);
+    }
+    for (const TextCharacter* character : characters)
+    {
+        stream << float(character->fontSize) << float(character->advance);
+    }
+    for (const TextCharacter* character : characters)
+    {
+        writeCompactPath(stream, character->boundingBox);
+    }
+
+    return data;
+}
+
+PDFTextLayout PDFTextLayout::readCompact(const QByteArray& data)
+{
+    PDFTextLayout layout;
+
+    QDataStream stream(data);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    quint32 version = 0;
+    stream >> version;
+    if (version != COMPACT_FORMAT_VERSION)
+    {
+        return layout;
+    }
+
+    quint32 blockCount = 0;
+    quint32 lineCount = 0;
+    quint32 characterCount = 0;
+    stream >> layout.m_settings;
+    stream >> blockCount >> lineCount >> characterCount;
+
+    if (stream.status() != QDataStream::Ok)
+    {
+        return PDFTextLayout();
+    }
+
+    std::vector<quint32> blockLineCounts(blockCount, 0);
+    std::vector<quint32> lineCharacterCounts(lineCount, 0);
+    PDFTextBlocks blocks(blockCount);
+    PDFTextLines lines(lineCount);
+    TextCharacters characters(characterCount);
+
+    // Blocks
+    for (quint32& count : blockLineCounts)
+    {
+        stream >> count;
+    }
+    for (PDFTextBlock& block : blocks)
+    {
+        stream >> block.m_topLeft;
+        block.m_boundingBox = readCompactPath(stream);
+    }
+
+    // Lines
+    for (quint32& count : lineCharacterCounts)
+    {
+        stream >> count;
+    }
+    for (PDFTextLine& line : lines)
+    {
+        stream >> line.m_topLeft;
+        line.m_boundingBox = readCompactPath(stream);
+    }
+
+    // Characters
+    for (TextCharacter& character : characters)
+    {
+        stream >> character.character;
+    }
+    for (TextCharacter& character : characters)
+    {
+        float x = 0.0f;
+        float y = 0.0f;
+        stream >> x >> y;
+        character.position = QPointF(x, y);
+    }
+    for (TextCharacter& character : characters)
+    {
+        qint16 angle = 0;
+        stream >> angle;
+        character.angle = angle;
+    }
+    for (TextCharacter& character : characters)
+    {
+        float fontSize = 0.0f;
+        float advance = 0.0f;
+        stream >> fontSize >> advance;
+        character.fontSize = fontSize;
+        character.advance = advance;
+    }
+    for (TextCharacter& character : characters)
+    {
+        character.boundingBox = readCompactPath(stream);
+    }
+
+    if (stream.status() != QDataStream::Ok)
+    {
+        return PDFTextLayout();
+    }
+
+    // Distribute characters to the lines and lines to the blocks
+    auto itCharacter = characters.begin();
+    for (size_t i = 0; i < lines.size(); ++i)
+    {
+        const size_t count = qMin<size_t>(lineCharacterCounts[i], std::distance(itCharacter, characters.end()));
+        lines[i].m_characters.assign(std::make_move_iterator(itCharacter), std::make_move_iterator(std::next(itCharacter, count)));
+        std::advance(itCharacter, count);
+    }
+
+    auto itLine = lines.begin();
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        const size_t count = qMin<size_t>(blockLineCounts[i], std::distance(itLine, lines.end()));
+        blocks[i].m_lines.assign(std::make_move_iterator(itLine), std::make_move_iterator(std::next(itLine, count)));
+        std::advance(itLine, count);
+    }
+
+    layout.m_blocks = qMove(blocks);
+    return layout;
+}
+
+void PDFTextLayout::writeCompactPath(QDataStream& stream, const QPainterPath& path)
+{
+    const int elementCount = path.elementCount();
+    stream << quint16(elementCount);
+
+    for (int i = 0; i < elementCount; ++i)
+    {
+        const QPainterPath::Element& element = path.elementAt(i);
+        stream << quint8(element.type) << float(element.x) << float(element.y);
+    }
+}
+
+QPainterPath PDFTextLayout::readCompactPath(QDataStream& stream)
+{
+    QPainterPath path;
+
+    quint16 elementCount = 0;
+    stream >> elementCount;
+
+    std::vector<std::pair<quint8, QPointF>> elements;
+    elements.reserve(elementCount);
+    for (quint16 i = 0; i < elementCount; ++i)
+    {
+        quint8 type = 0;
+        float x = 0.0f;
+        float y = 0.0f;
+        stream >> type >> x >> y;
+        elements.emplace_back(type, QPointF(x, y));
+    }
+
+    for (size_t i = 0; i < elements.size(); ++i)
+    {
+        const QPointF& point = elements[i].second;
+        switch (elements[i].first)
+        {
+            case QPainterPath::MoveToElement:
+                path.moveTo(point);
+                break;
+
+            case QPainterPath::LineToElement:
+                path.lineTo(point);
+                break;
+
+            case QPainterPath::CurveToElement:
+            {
+                if (i + 2 < elements.size())
+                {
+                    path.cubicTo(point, elements[i + 1].second, elements[i + 2].second);
+                    i += 2;
+                }
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    return path;
+}
+
 QDataStream& operator>>(QDataStream& stream, PDFTextLayout& layout)
 {
     stream >> layout.m_characters;
@@ -649,17 +930,19 @@ void PDFTextLayout::performDoLayout(PDFReal angle)
         NearestCharacterInfo& insertInfo = *itLast;
         QPointF currentPoint = characters[currentCharacterIndex].position;
 
-        TextCharacters nearestPointSamples;
+        // Only indices of characters are queried, copying the characters
+        // (including the bounding box paths) is too expensive on dense pages.
+        std::vector<size_t> nearestPointSamples;
         spatialIndex.queryNearestEstimate(m_settings.samples, characters[currentCharacterIndex], &nearestPointSamples);
-        for (size_t i = 0, count = nearestPointSamples.size(); i < count; ++i)
+        for (const size_t sampleIndex : nearestPointSamples)
         {
-            if (nearestPointSamples[i].index == currentCharacterIndex)
+            if (sampleIndex == currentCharacterIndex)
             {
                 continue;
             }
 
-            insertInfo.index = nearestPointSamples[i].index;
-            insertInfo.distance = QLineF(currentPoint, nearestPointSamples[i].position).length();
+            insertInfo.index = sampleIndex;
+            insertInfo.distance = QLineF(currentPoint, characters[sampleIndex].position).length();
 
             // Now, use insert sort to sort the array of samples + 1 elements (#samples elements
             // are sorted, we use only insert sort on the last element).
@@ -740,13 +1023,35 @@ void PDFTextLayout::performDoLayout(PDFReal angle)
 
     // Step 4) - detect text blocks
     const size_t lineCount = lines.size();
+    std::vector<QRectF> lineBoundingBoxes;
+    lineBoundingBoxes.reserve(lineCount);
+    PDFReal maximalLineHeight = 0.0;
+    for (const PDFTextLine& line : lines)
+    {
+        lineBoundingBoxes.push_back(line.getBoundingBox().boundingRect());
+        maximalLineHeight = qMax(maximalLineHeight, lineBoundingBoxes.back().height());
+    }
+
+    // Lines are swept in order of their top coordinate. For two lines, where second
+    // line starts below the first one, union height is at least the distance of their
+    // tops, so second line can't be joined with the first line, if distance of their
+    // tops exceeds (h1 + maximal height) * sensitivity. Only lines in this window
+    // are tested, instead of testing all pairs of lines.
+    std::vector<size_t> linesByTop(lineCount, 0);
+    std::iota(linesByTop.begin(), linesByTop.end(), size_t(0));
+    std::sort(linesByTop.begin(), linesByTop.end(), [&lineBoundingBoxes](size_t l, size_t r) { return lineBoundingBoxes[l].top() < lineBoundingBoxes[r].top(); });
+
     PDFUnionFindAlgorithm<size_t> textBlocksUF(lineCount);
-    for (size_t i = 0; i < lineCount; ++i)
+    for (size_t ii = 0; ii < lineCount; ++ii)
     {
-        for (size_t j = i + 1; j < lineCount; ++j)
+        const size_t i = linesByTop[ii];
+        const QRectF& bb1 = lineBoundingBoxes[i];
+        const PDFReal topLimit = bb1.top() + (bb1.height() + maximalLineHeight) * m_settings.blockVerticalSensitivity;
+
+        for (size_t jj = ii + 1; jj < lineCount && lineBoundingBoxes[linesByTop[jj]].top() <= topLimit; ++jj)
         {
-            QRectF bb1 = lines[i].getBoundingBox().boundingRect();
-            QRectF bb2 = lines[j].getBoundingBox().boundingRect();
+            const size_t j = linesByTop[jj];
+            const QRectF& bb2 = lineBoundingBoxes[j];
 
             // Jakub Melka: we will join two blocks, if these two conditions both holds:
             //     1) bounding boxes overlap horizontally by large portion
@@ -790,32 +1095,39 @@ void PDFTextLayout::performDoLayout(PDFReal angle)
     //    - there doesn't exist block c, which is between a,b in y-axis
     //      and moreover, overlaps both a and b in x-axis.
 
-    auto isBeforeByRule1 = [&blocks](const size_t aIndex, const size_t bIndex)
+    std::vector<QRectF> blockBoundingBoxes;
+    blockBoundingBoxes.reserve(blocks.size());
+    for (const PDFTextBlock& block : blocks)
     {
-        QRectF aBB = blocks[aIndex].getBoundingBox().boundingRect();
-        QRectF bBB = blocks[bIndex].getBoundingBox().boundingRect();
+        blockBoundingBoxes.push_back(block.getBoundingBox().boundingRect());
+    }
+
+    auto isBeforeByRule1 = [&blockBoundingBoxes](const size_t aIndex, const size_t bIndex)
+    {
+        const QRectF& aBB = blockBoundingBoxes[aIndex];
+        const QRectF& bBB = blockBoundingBoxes[bIndex];
 
         const bool isOverlappedOnHorizontalAxis = isRectangleHorizontallyOverlapped(aBB, bBB);
         const bool isAoverB = aBB.bottom() > bBB.top();
         return isOverlappedOnHorizontalAxis && isAoverB;
     };
-    auto isBeforeByRule2 = [&blocks](const size_t aIndex, const size_t bIndex)
+    auto isBeforeByRule2 = [&blockBoundingBoxes](const size_t aIndex, const size_t bIndex)
     {
-        QRectF aBB = blocks[aIndex].getBoundingBox().boundingRect();
-        QRectF bBB = blocks[bIndex].getBoundingBox().boundingRect();
+        const QRectF& aBB = blockBoundingBoxes[aIndex];
+        const QRectF& bBB = blockBoundingBoxes[bIndex];
         QRectF abBB = aBB.united(bBB);
 
         if (aBB.right() < bBB.left())
         {
             // Check, if 'c' block doesn't exist
-            for (size_t i = 0, count = blocks.size(); i < count; ++i)
+            for (size_t i = 0, count = blockBoundingBoxes.size(); i < count; ++i)
             {
                 if (i == aIndex || i == bIndex)
                 {
                     continue;
                 }
 
-                QRectF cBB = blocks[i].getBoundingBox().boundingRect();
+                const QRectF& cBB = blockBoundingBoxes[i];
                 if (cBB.top() >= abBB.top() && cBB.bottom() <= abBB.bottom())
                 {
                     const bool isAOverlappedOnHorizontalAxis = isRectangleHorizontallyOverlapped(aBB, cBB);
@@ -834,37 +1146,50 @@ void PDFTextLayout::performDoLayout(PDFReal angle)
     };
 
     // Order blocks using topological sort (https://en.wikipedia.org/wiki/Topological_sorting,
-    // Kahn's algorithm is used)
-    std::set<size_t> workBlocks;
-    std::vector<size_t> ordering;
-    std::vector<std::set<size_t>> orderingEdges(blocks.size(), std::set<size_t>());
-    ordering.reserve(blocks.size());
-    for (size_t i = 0; i < blocks.size(); ++i)
+    // Kahn's algorithm is used). For each block, we store number of blocks, which
+    // precede it, and list of blocks, which follow it. Work blocks are ordered
+    // by number of preceding blocks, then by index, so block with fewest preceding
+    // blocks (and lowest index) is always taken first.
+    const size_t blockCount = blocks.size();
+    std::vector<size_t> precedingBlockCount(blockCount, 0);
+    std::vector<std::vector<size_t>> followingBlocks(blockCount);
+    for (size_t i = 0; i < blockCount; ++i)
     {
-        workBlocks.insert(workBlocks.end(), i);
-        for (size_t j = 0; j < blocks.size(); ++j)
+        for (size_t j = 0; j < blockCount; ++j)
         {
             if (i != j && (isBeforeByRule1(j, i) || isBeforeByRule2(j, i)))
             {
-                orderingEdges[i].insert(j);
+                ++precedingBlockCount[i];
+                followingBlocks[j].push_back(i);
             }
         }
     }
 
+    std::set<std::pair<size_t, size_t>> workBlocks;
+    for (size_t i = 0; i < blockCount; ++i)
+    {
+        workBlocks.emplace(precedingBlockCount[i], i);
+    }
+
     // Topological sort
     QTransform invertedAngleMatrix = angleMatrix.inverted();
     while (!workBlocks.empty())
     {
-        auto it = std::min_element(workBlocks.begin(), workBlocks.end(), [&orderingEdges](const size_t l, const size_t r) { return orderingEdges[l].size() < orderingEdges[r].size(); });
-        ordering.push_back(*it);
-        for (std::set<size_t>& edges : orderingEdges)
+        const size_t blockIndex = workBlocks.begin()->second;
+        workBlocks.erase(workBlocks.begin());
+
+        for (const size_t followingBlockIndex : followingBlocks[blockIndex])
         {
-            edges.erase(*it);
+            auto it = workBlocks.find(std::make_pair(precedingBlockCount[followingBlockIndex], followingBlockIndex));
+            if (it != workBlocks.end())
+            {
+                workBlocks.erase(it);
+                workBlocks.emplace(--precedingBlockCount[followingBlockIndex], followingBlockIndex);
+            }
         }
 
-        blocks[*it].applyTransform(invertedAngleMatrix);
-        m_blocks.emplace_back(qMove(blocks[*it]));
-        workBlocks.erase(it);
+        blocks[blockIndex].applyTransform(invertedAngleMatrix);
+        m_blocks.emplace_back(qMove(blocks[blockIndex]));
     }
 }
 
@@ -1109,10 +1434,7 @@ PDFTextLayout PDFTextLayoutStorage::getTextLayout(PDFInteger pageIndex) const
 
         QByteArray buffer;
         layoutStream >> buffer;
-        buffer = qUncompress(buffer);
-
-        QDataStream stream(&buffer, QIODevice::ReadOnly);
-        stream >> result;
+        result = PDFTextLayout::readCompact(qUncompress(buffer));
     }
 
     return result;
@@ -1120,27 +1442,204 @@ PDFTextLayout PDFTextLayoutStorage::getTextLayout(PDFInteger pageIndex) const
 
 void PDFTextLayoutStorage::setTextLayout(PDFInteger pageIndex, const PDFTextLayout& layout, QMutex* mutex)
 {
-    QByteArray result;
+    QByteArray result = qCompress(layout.writeCompact(), 9);
+
+    QByteArray signature;
+    if (m_textIndex.getCount() > 0)
     {
-        QDataStream stream(&result, QIODevice::WriteOnly);
-        stream << layout;
+        signature = PDFTextIndex::createSignature(PDFTextFlow::createTextFlows(layout, m_textIndex.getFlowFlags(), pageIndex));
     }
-    result = qCompress(result, 9);
 
     QMutexLocker lock(mutex);
     m_offsets[pageIndex] = m_textLayouts.size();
 
     QDataStream layoutStream(&m_textLayouts, QIODevice::Append | QIODevice::WriteOnly);
     layoutStream << result;
+
+    if (!signature.isEmpty())
+    {
+        m_textIndex.setSignature(pageIndex, qMove(signature));
+    }
+}
+
+void PDFTextLayoutStorage::collectMemoryUsage(PDFMemoryReport* report) const
+{
+    report->addItem(PDFTranslationContext::tr("Text layouts"), m_textLayouts.size() + qint64(m_offsets.size() * sizeof(int)), qint64(m_offsets.size()));
+
+    if (m_textIndex.getCount() > 0)
+    {
+        report->addItem(PDFTranslationContext::tr("Text index"), m_textIndex.getMemoryConsumptionEstimate(), m_textIndex.getCount());
+    }
+}
+
+void PDFTextLayoutStorage::enableTextIndex(PDFTextFlow::FlowFlags flowFlags)
+{
+    m_textIndex = PDFTextIndex(m_offsets.size(), flowFlags);
+}
+
+void PDFTextLayoutStorage::setTextIndex(PDFTextIndex textIndex)
+{
+    if (textIndex.getCount() == m_offsets.size())
+    {
+        m_textIndex = qMove(textIndex);
+    }
+}
+
+QByteArray PDFTextIndex::createSignature(const PDFTextFlows& textFlows)
+{
+    QByteArray signature(SIGNATURE_BITS / 8, 0);
+    uchar* bits = reinterpret_cast<uchar*>(signature.data());
+
+    for (const PDFTextFlow& textFlow : textFlows)
+    {
+        const QString text = textFlow.getText();
+        for (qsizetype i = 2; i < text.size(); ++i)
+        {
+            const quint32 bit = getTrigramBit(text[i - 2], text[i - 1], text[i]);
+            bits[bit / 8] |= uchar(1 << (bit % 8));
+        }
+    }
+
+    return signature;
+}
+
+void PDFTextIndex::setSignature(PDFInteger pageIndex, QByteArray signature)
+{
+    if (pageIndex >= 0 && pageIndex < PDFInteger(m_signatures.size()))
+    {
+        m_signatures[pageIndex] = qMove(signature);
+    }
+}
+
+std::vector<quint32> PDFTextIndex::getTrigramBits(const QString& text)
+{
+    std::vector<quint32> result;
+
+    for (qsizetype i = 2; i < text.size(); ++i)
+    {
+        result.push_back(getTrigramBit(text[i - 2], text[i - 1], text[i]));
+    }
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+bool PDFTextIndex::mayContain(PDFInteger pageIndex, const std::vector<quint32>& trigramBits) const
+{
+    if (pageIndex < 0 || pageIndex >= PDFInteger(m_signatures.size()))
+    {
+        return true;
+    }
+
+    const QByteArray& signature = m_signatures[pageIndex];
+    if (signature.size() != SIGNATURE_BITS / 8)
+    {
+        // Page is not indexed
+        return true;
+    }
+
+    const uchar* bits = reinterpret_cast<const uchar*>(signature.constData());
+    for (const quint32 bit : trigramBits)
+    {
+        if (!(bits[bit / 8] & (1 << (bit % 8))))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+qint64 PDFTextIndex::getMemoryConsumptionEstimate() const
+{
+    qint64 result = qint64(m_signatures.size() * sizeof(QByteArray));
+    for (const QByteArray& signature : m_signatures)
+    {
+        result += signature.size();
+    }
+    return result;
+}
+
+quint32 PDFTextIndex::getTrigramBit(QChar c1, QChar c2, QChar c3)
+{
+    const quint64 trigram = (quint64(getNormalizedCharacter(c1).unicode()) << 32) |
+                            (quint64(getNormalizedCharacter(c2).unicode()) << 16) |
+                            (quint64(getNormalizedCharacter(c3).unicode()));
+    return quint32((trigram * 0x9E3779B97F4A7C15ULL) >> 51) % SIGNATURE_BITS;
+}
+
+QChar PDFTextIndex::getNormalizedCharacter(QChar character)
+{
+    // Case insensitive search folds surrogate pairs as a whole, so we
+    // do not distinguish between surrogates at all. All other characters
+    // are case folded, so index can be used for case insensitive search.
+    if (character.isSurrogate())
+    {
+        return QChar(0xD800);
+    }
+
+    return character.toCaseFolded();
+}
+
+QDataStream& operator<<(QDataStream& stream, const PDFTextIndex& index)
+{
+    stream << PDFTextIndex::PERSIST_VERSION;
+    stream << int(index.m_flowFlags);
+    stream << qint64(index.m_signatures.size());
+    for (const QByteArray& signature : index.m_signatures)
+    {
+        stream << signature;
+    }
+    return stream;
+}
+
+QDataStream& operator>>(QDataStream& stream, PDFTextIndex& index)
+{
+    quint32 version = 0;
+    stream >> version;
+
+    if (version != PDFTextIndex::PERSIST_VERSION)
+    {
+        index = PDFTextIndex();
+        stream.setStatus(QDataStream::ReadCorruptData);
+        return stream;
+    }
+
+    int flowFlags = 0;
+    qint64 count = 0;
+    stream >> flowFlags;
+    stream >> count;
+
+    std::vector<QByteArray> signatures;
+    for (qint64 i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+    {
+        QByteArray signature;
+        stream >> signature;
+        signatures.emplace_back(qMove(signature));
+    }
+
+    index.m_flowFlags = PDFTextFlow::FlowFlags(flowFlags);
+    index.m_signatures = qMove(signatures);
+    return stream;
 }
 
 PDFFindResults PDFTextLayoutStorage::find(const QString& text, Qt::CaseSensitivity caseSensitivity, PDFTextFlow::FlowFlags flowFlags) const
 {
     PDFFindResults results;
 
+    // Only pages, which can contain the text, are scanned
+    const bool useTextIndex = m_textIndex.isUsable(flowFlags);
+    const std::vector<quint32> trigramBits = useTextIndex ? PDFTextIndex::getTrigramBits(text) : std::vector<quint32>();
+
     QMutex resultsMutex;
-    auto findImpl = [this, flowFlags, caseSensitivity, &results, &resultsMutex, &text](size_t pageIndex)
+    auto findImpl = [this, flowFlags, caseSensitivity, &results, &resultsMutex, &text, &trigramBits](size_t pageIndex)
     {
+        if (!trigramBits.empty() && !m_textIndex.mayContain(PDFInteger(pageIndex), trigramBits))
+        {
+            return;
+        }
+
         PDFTextLayout textLayout = getTextLayout(pageIndex);
         PDFTextFlows textFlows = PDFTextFlow::createTextFlows(textLayout, flowFlags, pageIndex);
         for (const PDFTextFlow& textFlow : textFlows)
@@ -1159,7 +1658,7 @@ PDFFindResults PDFTextLayoutStorage::find(const QString& text, Qt::CaseSensitivi
     auto range = PDFIntegerRange<size_t>(0, m_offsets.size());
     PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, range.begin(), range.end(), findImpl);
 
-    std::sort(results.begin(), results.end());
+    PDFExecutionPolicy::sort(PDFExecutionPolicy::Scope::Content, results.begin(), results.end(), std::less<PDFFindResult>());
     return results;
 }
 
@@ -1188,10 +1687,119 @@ PDFFindResults PDFTextLayoutStorage::find(const QRegularExpression& expression,
     auto range = PDFIntegerRange<size_t>(0, m_offsets.size());
     PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, range.begin(), range.end(), findImpl);
 
-    std::sort(results.begin(), results.end());
+    PDFExecutionPolicy::sort(PDFExecutionPolicy::Scope::Content, results.begin(), results.end(), std::less<PDFFindResult>());
     return results;
 }
 
+void PDFTextLayoutStorage::findIncremental(const QString& text,
+                                           Qt::CaseSensitivity caseSensitivity,
+                                           PDFTextFlow::FlowFlags flowFlags,
+                                           PDFInteger startPageIndex,
+                                           size_t resultLimit,
+                                           const PDFOperationControl* operationControl,
+                                           const PDFFindResultsCallback& callback) const
+{
+    const bool useTextIndex = m_textIndex.isUsable(flowFlags);
+    const std::vector<quint32> trigramBits = useTextIndex ? PDFTextIndex::getTrigramBits(text) : std::vector<quint32>();
+    auto findInTextFlow = [&text, caseSensitivity](const PDFTextFlow& textFlow) { return textFlow.find(text, caseSensitivity); };
+    findIncrementalImpl(findInTextFlow, trigramBits, flowFlags, startPageIndex, resultLimit, operationControl, callback);
+}
+
+void PDFTextLayoutStorage::findIncremental(const QRegularExpression& expression,
+                                           PDFTextFlow::FlowFlags flowFlags,
+                                           PDFInteger startPageIndex,
+                                           size_t resultLimit,
+                                           const PDFOperationControl* operationControl,
+                                           const PDFFindResultsCallback& callback) const
+{
+    auto findInTextFlow = [&expression](const PDFTextFlow& textFlow) { return textFlow.find(expression); };
+    findIncrementalImpl(findInTextFlow, std::vector<quint32>(), flowFlags, startPageIndex, resultLimit, operationControl, callback);
+}
+
+void PDFTextLayoutStorage::findIncrementalImpl(const std::function<PDFFindResults(const PDFTextFlow&)>& findInTextFlow,
+                                               const std::vector<quint32>& trigramBits,
+                                               PDFTextFlow::FlowFlags flowFlags,
+                                               PDFInteger startPageIndex,
+                                               size_t resultLimit,
+                                               const PDFOperationControl* operationControl,
+                                               const PDFFindResultsCallback& callback) const
+{
+    const PDFInteger pageCount = PDFInteger(m_offsets.size());
+    if (pageCount == 0)
+    {
+        return;
+    }
+
+    startPageIndex = qBound(PDFInteger(0), startPageIndex, pageCount - 1);
+
+    // Position is an order of the page in the search. Each call takes next
+    // position, so pages are searched approximately in the order, in which
+    // results are reported, and only a few results are waiting for reporting.
+    std::atomic<PDFInteger> nextPosition = 0;
+    std::atomic_bool isLimitReached = false;
+
+    QMutex reportMutex;
+    std::map<PDFInteger, PDFFindResults> pendingResults;
+    PDFInteger nextReportedPosition = 0;
+    size_t reportedCount = 0;
+
+    auto isStopped = [&isLimitReached, operationControl]()
+    {
+        return isLimitReached || PDFOperationControl::isOperationCancelled(operationControl);
+    };
+
+    auto findImpl = [&, this](PDFInteger)
+    {
+        if (isStopped())
+        {
+            return;
+        }
+
+        const PDFInteger position = nextPosition.fetch_add(1);
+        const PDFInteger pageIndex = (startPageIndex + position) % pageCount;
+
+        PDFFindResults pageResults;
+        if (trigramBits.empty() || m_textIndex.mayContain(pageIndex, trigramBits))
+        {
+            PDFTextLayout textLayout = getTextLayout(pageIndex);
+            PDFTextFlows textFlows = PDFTextFlow::createTextFlows(textLayout, flowFlags, pageIndex);
+            for (const PDFTextFlow& textFlow : textFlows)
+            {
+                PDFFindResults flowResults = findInTextFlow(textFlow);
+                pageResults.insert(pageResults.end(), std::make_move_iterator(flowResults.begin()), std::make_move_iterator(flowResults.end()));
+            }
+            std::sort(pageResults.begin(), pageResults.end());
+        }
+
+        QMutexLocker lock(&reportMutex);
+        pendingResults[position] = qMove(pageResults);
+
+        // Report all results, which are continuous from the last reported position
+        for (auto it = pendingResults.begin(); it != pendingResults.end() && it->first == nextReportedPosition && !isStopped(); it = pendingResults.erase(it))
+        {
+            ++nextReportedPosition;
+
+            PDFFindResults& results = it->second;
+            if (results.empty())
+            {
+                continue;
+            }
+
+            if (resultLimit > 0 && reportedCount + results.size() >= resultLimit)
+            {
+                results.resize(resultLimit - reportedCount);
+                isLimitReached = true;
+            }
+
+            reportedCount += results.size();
+            callback((startPageIndex + it->first) % pageCount, qMove(results));
+        }
+    };
+
+    auto range = PDFIntegerRange<PDFInteger>(0, pageCount);
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, range.begin(), range.end(), findImpl);
+}
+
 QDataStream& operator<<(QDataStream& stream, const PDFTextLayoutSettings& settings)
 {
     stream << settings.samples;
@@ -1214,14 +1822,53 @@ QDataStream& operator>>(QDataStream& stream, PDFTextLayoutSettings& settings)
     return stream;
 }
 
+struct PDFTextSelection::HighlightCache
+{
+    QMutex mutex;
+    std::map<PDFInteger, PDFTextSelectionHighlights> highlights;
+};
+
 void PDFTextSelection::addItems(const PDFTextSelectionItems& items, QColor color)
 {
     std::transform(items.cbegin(), items.cend(), std::back_inserter(m_items), [color] (const auto& item) { return PDFTextSelectionColoredItem(item.first, item.second, color); });
+    m_highlightCache.reset();
 }
 
 void PDFTextSelection::build()
 {
     std::sort(m_items.begin(), m_items.end());
+
+    // Copies of the selection can share the old cache, so we create a new one
+    m_highlightCache = std::make_shared<HighlightCache>();
+}
+
+bool PDFTextSelection::getCachedHighlights(PDFInteger pageIndex, PDFTextSelectionHighlights& highlights) const
+{
+    if (!m_highlightCache)
+    {
+        return false;
+    }
+
+    QMutexLocker lock(&m_highlightCache->mutex);
+    auto it = m_highlightCache->highlights.find(pageIndex);
+    if (it != m_highlightCache->highlights.cend())
+    {
+        highlights = it->second;
+        return true;
+    }
+
+    return false;
+}
+
+void PDFTextSelection::setCachedHighlights(PDFInteger pageIndex, PDFTextSelectionHighlights highlights) const
+{
+    if (!m_highlightCache)
+    {
+        return;
+    }
+
+    QMutexLocker lock(&m_highlightCache->mutex);
+    m_highlightCache->highlights[pageIndex] = qMove(highlights);
 }
 
 PDFTextSelection::iterator PDFTextSelection::begin(PDFInteger pageIndex) const
@@ -1532,11 +2179,37 @@ void PDFTextSelectionPainter::draw(QPainter* painter,
         return;
     }
 
+    PDFTextSelectionHighlights highlights;
+    if (!m_selection->getCachedHighlights(pageIndex, highlights))
+    {
+        highlights = createHighlights(pageIndex, textLayoutGetter);
+    }
+
     painter->save();
 
+    for (const PDFTextSelectionHighlight& highlight : highlights)
+    {
+        QColor penColor = highlight.color.darker();
+        QColor brushColor = highlight.color;
+        brushColor.setAlphaF(SELECTION_ALPHA);
+
+        painter->setPen(convertor.convert(QPen(penColor)));
+        painter->setBrush(convertor.convert(QBrush(brushColor, Qt::SolidPattern)));
+        painter->drawPath(matrix.map(highlight.path));
+    }
+
+    painter->restore();
+}
+
+PDFTextSelectionHighlights PDFTextSelectionPainter::createHighlights(PDFInteger pageIndex, PDFTextLayoutGetter& textLayoutGetter) const
+{
+    PDFTextSelectionHighlights highlights;
+
     const PDFTextLayout& layout = textLayoutGetter;
     const PDFTextBlocks& blocks = layout.getTextBlocks();
-    for (; it != itEnd; ++it)
+
+    auto itEnd = m_selection->end(pageIndex);
+    for (auto it = m_selection->begin(pageIndex); it != itEnd; ++it)
     {
         const PDFTextSelectionColoredItem& item = *it;
         const PDFCharacterPointer& start = item.start;
@@ -1551,19 +2224,29 @@ void PDFTextSelectionPainter::draw(QPainter* painter,
             continue;
         }
 
+        auto highlightIt = std::find_if(highlights.begin(), highlights.end(), [&item](const PDFTextSelectionHighlight& highlight) { return highlight.color == item.color; });
+        if (highlightIt == highlights.end())
+        {
+            highlightIt = highlights.insert(highlights.end(), PDFTextSelectionHighlight{ item.color, QPainterPath() });
+        }
+
         const PDFTextBlock& block = blocks[start.blockIndex];
-        QPainterPath path = block.getCharacterRangeBoundingPath(start, end, matrix, HEIGHT_INCREASE_FACTOR);
+        highlightIt->path.addPath(block.getCharacterRangeBoundingPath(start, end, QTransform(), HEIGHT_INCREASE_FACTOR));
+    }
 
-        QColor penColor = item.color.darker();
-        QColor brushColor = item.color;
-        brushColor.setAlphaF(SELECTION_ALPHA);
+    // Merge overlapping rectangles, so each area is highlighted only once
+    for (PDFTextSelectionHighlight& highlight : highlights)
+    {
+        highlight.path = highlight.path.simplified();
+    }
 
-        painter->setPen(convertor.convert(QPen(penColor)));
-        painter->setBrush(convertor.convert(QBrush(brushColor, Qt::SolidPattern)));
-        painter->drawPath(path);
+    // Text layout may not be compiled yet, in that case, we do not cache highlights
+    if (!blocks.empty())
+    {
+        m_selection->setCachedHighlights(pageIndex, highlights);
     }
 
-    painter->restore();
+    return highlights;
 }
 
 QPainterPath PDFTextSelectionPainter::prepareGeometry(PDFInteger pageIndex, PDFTextLayoutGetter& textLayoutGetter, const QTransform& matrix, QPolygonF* quadrilaterals)
@@ -25,6 +25,7 @@
 
 #include "pdfglobal.h"
 #include "pdfutils.h"
+#include "pdfmemoryreport.h"
 
 #include <QColor>
 #include <QDataStream>
@@ -37,6 +38,7 @@ class QMutex;
 
 namespace pdf
 {
+class PDFOperationControl;
 class PDFTextLayout;
 class PDFTextLayoutStorage;
 struct PDFCharacterPointer;
@@ -140,6 +142,8 @@ public:
     friend QDataStream& operator>>(QDataStream& stream, PDFTextLine& line);
 
 private:
+    friend class PDFTextLayout;
+
     TextCharacters m_characters;
     QPainterPath m_boundingBox;
     QPointF m_topLeft;
@@ -179,6 +183,8 @@ public:
     friend QDataStream& operator>>(QDataStream& stream, PDFTextBlock& block);
 
 private:
+    friend class PDFTextLayout;
+
     PDFTextLines m_lines;
     QPainterPath m_boundingBox;
     QPointF m_topLeft;
@@ -232,6 +238,15 @@ struct PDFTextSelectionColoredItem
 };
 using PDFTextSelectionColoredItems = std::vector<PDFTextSelectionColoredItem>;
 
+/// Highlight of text selection items of the same color on the page. Rectangles
+/// of selected parts of lines are merged, path is in page coordinates.
+struct PDFTextSelectionHighlight
+{
+    QColor color;
+    QPainterPath path;
+};
+using PDFTextSelectionHighlights = std::vector<PDFTextSelectionHighlight>;
+
 /// Text selection, can be used across multiple pages. Also defines color
 /// for each text selection.
 class PDF4QTLIBCORESHARED_EXPORT PDFTextSelection
@@ -241,8 +256,8 @@ public:
 
     using iterator = PDFTextSelectionColoredItems::const_iterator;
 
-    bool operator==(const PDFTextSelection&) const = default;
-    bool operator!=(const PDFTextSelection&) const = default;
+    bool operator==(const PDFTextSelection& other) const { return m_items == other.m_items; }
+    bool operator!=(const PDFTextSelection& other) const { return !(*this == other); }
 
     /// Adds text selection items to selection
     /// \param items Items
@@ -268,8 +283,25 @@ public:
     iterator begin() const { return m_items.cbegin(); }
     iterator end() const { return m_items.cend(); }
 
+    /// Returns highlights of the page, if they are cached. Highlights are
+    /// cached, until text selection is changed. Function is thread safe.
+    /// \param pageIndex Page index
+    /// \param highlights Highlights of the page
+    bool getCachedHighlights(PDFInteger pageIndex, PDFTextSelectionHighlights& highlights) const;
+
+    /// Stores highlights of the page into the cache. Text selection must
+    /// be built. Function is thread safe.
+    /// \param pageIndex Page index
+    /// \param highlights Highlights of the page
+    void setCachedHighlights(PDFInteger pageIndex, PDFTextSelectionHighlights highlights) const;
+
 private:
+    struct HighlightCache;
+
     PDFTextSelectionColoredItems m_items;
+
+    /// Cache of highlights of pages, it is shared by copies of the text selection
+    std::shared_ptr<HighlightCache> m_highlightCache;
 };
 
 struct PDF4QTLIBCORESHARED_EXPORT PDFFindResult
@@ -288,6 +320,9 @@ struct PDF4QTLIBCORESHARED_EXPORT PDFFindResult
 };
 using PDFFindResults = std::vector<PDFFindResult>;
 
+/// Callback receiving results found on a single page during incremental search
+using PDFFindResultsCallback = std::function<void(PDFInteger, PDFFindResults)>;
+
 class PDFTextFlow;
 using PDFTextFlows = std::vector<PDFTextFlow>;
 
@@ -382,9 +417,9 @@ public:
     /// Returns true, if given point is pointing to some text block
     bool isHoveringOverTextBlock(const QPointF& point) const;
 
-    /// Creates text selection. This function needs to modify the layout contents,
-    /// so do not use this function from multiple threads (it is not thread-safe).
-    /// Text selection is created from rectangle using two points.
+    /// Creates text selection. Text selection is created from rectangle using two points.
+    /// Layout is not modified, only geometry of text lines in the selection range is
+    /// transformed into the coordinate system of the rotated text blocks.
     /// \param pageIndex Page index
     /// \param point1 First point
     /// \param point2 Second point
@@ -394,7 +429,7 @@ public:
                                          const QPointF& point1,
                                          const QPointF& point2,
                                          QColor selectionColor = Qt::yellow,
-                                         bool strictSelection = false);
+                                         bool strictSelection = false) const;
 
     /// Returns string from text selection
     /// \param itBegin Iterator (begin range)
@@ -420,10 +455,28 @@ public:
     /// \param color Selection color
     PDFTextSelection selectLineInBlock(const size_t blockIndex, const size_t lineIndex, PDFInteger pageIndex, QColor color) const;
 
+    /// Writes text blocks of the layout in compact columnar format. Each column
+    /// (text, positions, sizes, bounding boxes) is stored contiguously, using single
+    /// precision numbers. Characters, which are used only by the layout algorithm,
+    /// are not written, so layout read from this format can't be performed again.
+    QByteArray writeCompact() const;
+
+    /// Reads text layout written by \p writeCompact
+    /// \param data Data in compact columnar format
+    static PDFTextLayout readCompact(const QByteArray& data);
+
     friend QDataStream& operator<<(QDataStream& stream, const PDFTextLayout& layout);
     friend QDataStream& operator>>(QDataStream& stream, PDFTextLayout& layout);
 
 private:
+    static constexpr quint32 COMPACT_FORMAT_VERSION = 1;
+
+    /// Writes painter path (only element types and coordinates)
+    static void writeCompactPath(QDataStream& stream, const QPainterPath& path);
+
+    /// Reads painter path written by \p writeCompactPath
+    static QPainterPath readCompactPath(QDataStream& stream);
+
     /// Makes layout for particular angle
     void performDoLayout(PDFReal angle);
 
@@ -541,14 +594,90 @@ private:
     static constexpr const PDFReal HEIGHT_INCREASE_FACTOR = 0.40;
     static constexpr const PDFReal SELECTION_ALPHA = 0.25;
 
+    /// Creates highlights of the page from the text layout and stores them
+    /// in the cache of the text selection, so text layout is not accessed
+    /// again, until text selection is changed.
+    /// \param pageIndex Page index
+    /// \param textLayoutGetter Text layout getter
+    PDFTextSelectionHighlights createHighlights(PDFInteger pageIndex, PDFTextLayoutGetter& textLayoutGetter) const;
+
     const PDFTextSelection* m_selection;
 };
 
+/// Index of the text of the pages. For each page, a signature is stored - bit array,
+/// in which each trigram (three consecutive case folded characters) of the text flows
+/// of the page sets one bit. Page, whose signature doesn't contain all bits of the
+/// trigrams of the searched text, can't contain the text, so it is not necessary
+/// to decompress its text layout and scan it. Index is valid only for text flows
+/// created using the same flow flags, as the index was built with.
+class PDF4QTLIBCORESHARED_EXPORT PDFTextIndex
+{
+public:
+    explicit inline PDFTextIndex() = default;
+    explicit inline PDFTextIndex(PDFInteger pageCount, PDFTextFlow::FlowFlags flowFlags) :
+        m_flowFlags(flowFlags),
+        m_signatures(pageCount)
+    {
+
+    }
+
+    /// Returns flow flags used to create text flows for the index
+    PDFTextFlow::FlowFlags getFlowFlags() const { return m_flowFlags; }
+
+    /// Returns number of pages
+    size_t getCount() const { return m_signatures.size(); }
+
+    /// Returns true, if index can be used to search text flows created using \p flowFlags
+    /// \param flowFlags Text flow flags
+    bool isUsable(PDFTextFlow::FlowFlags flowFlags) const { return !m_signatures.empty() && m_flowFlags == flowFlags; }
+
+    /// Creates signature of the page from its text flows. Text flows
+    /// must be created using the flow flags of the index.
+    /// \param textFlows Text flows of the page
+    static QByteArray createSignature(const PDFTextFlows& textFlows);
+
+    /// Sets signature of the page. Function is not thread safe.
+    /// \param pageIndex Page index
+    /// \param signature Signature created by \p createSignature
+    void setSignature(PDFInteger pageIndex, QByteArray signature);
+
+    /// Returns bits of the trigrams of the text. If text is too short to
+    /// have a trigram, empty vector is returned.
+    /// \param text Text
+    static std::vector<quint32> getTrigramBits(const QString& text);
+
+    /// Returns false, if page surely doesn't contain the text, whose trigram bits
+    /// are \p trigramBits (in any letter case). If true is returned, page can contain
+    /// the text. Pages, which are not indexed, can contain any text.
+    /// \param pageIndex Page index
+    /// \param trigramBits Trigram bits of the searched text
+    bool mayContain(PDFInteger pageIndex, const std::vector<quint32>& trigramBits) const;
+
+    /// Returns estimate of memory (in bytes) consumed by the index
+    qint64 getMemoryConsumptionEstimate() const;
+
+    friend QDataStream& operator<<(QDataStream& stream, const PDFTextIndex& index);
+    friend QDataStream& operator>>(QDataStream& stream, PDFTextIndex& index);
+
+private:
+    static constexpr quint32 SIGNATURE_BITS = 8192;
+    static constexpr quint32 PERSIST_VERSION = 1;
+
+    /// Returns bit of the trigram in the signature
+    static quint32 getTrigramBit(QChar c1, QChar c2, QChar c3);
+
+    /// Returns character normalized for the index
+    static QChar getNormalizedCharacter(QChar character);
+
+    PDFTextFlow::FlowFlags m_flowFlags = PDFTextFlow::None;
+    std::vector<QByteArray> m_signatures;
+};
+
 /// Storage for text layouts. For reading and writing, this object is thread safe.
 /// For writing, mutex is used to synchronize asynchronous writes, for reading
 /// no mutex is used at all. For this reason, both reading/writing at the same time
 /// is prohibited, it is not thread safe.
-class PDF4QTLIBCORESHARED_EXPORT PDFTextLayoutStorage
+class PDF4QTLIBCORESHARED_EXPORT PDFTextLayoutStorage : public PDFMemoryAccountable
 {
 public:
     explicit inline PDFTextLayoutStorage() = default;
@@ -577,6 +706,21 @@ public:
     /// \param mutex Mutex for locking (calls of setTextLayout from multiple threads)
     void setTextLayout(PDFInteger pageIndex, const PDFTextLayout& layout, QMutex* mutex);
 
+    /// Enables text index, which is built incrementally in \p setTextLayout. Simple
+    /// text search with the same flow flags then scans only pages, which can contain
+    /// the searched text. Regular expression search always scans all pages.
+    /// Function must be called before any text layout is set.
+    /// \param flowFlags Text flow flags used for the index
+    void enableTextIndex(PDFTextFlow::FlowFlags flowFlags);
+
+    /// Returns text index (it can be empty, if index is not enabled)
+    const PDFTextIndex& getTextIndex() const { return m_textIndex; }
+
+    /// Sets text index, for example, previously stored one. Index must
+    /// have the same page count as the storage, otherwise it is ignored.
+    /// \param textIndex Text index
+    void setTextIndex(PDFTextIndex textIndex);
+
     /// Finds simple text in all pages. All text occurences are returned.
     /// \param text Text to be found
     /// \param caseSensitivity Case sensitivity
@@ -588,12 +732,66 @@ public:
     /// \param flowFlags Text flow flags
     PDFFindResults find(const QRegularExpression& expression, PDFTextFlow::FlowFlags flowFlags) const;
 
+    /// Finds simple text in all pages incrementally. Pages are searched in parallel,
+    /// results are reported by \p callback page by page, as soon as they are available,
+    /// in order starting from page \p startPageIndex and continuing cyclically
+    /// to the pages before it. Callback is never called concurrently, but it is called
+    /// from worker threads. Pages without results are not reported. Search can be
+    /// cancelled using \p operationControl.
+    /// \param text Text to be found
+    /// \param caseSensitivity Case sensitivity
+    /// \param flowFlags Text flow flags
+    /// \param startPageIndex Page, from which search is started
+    /// \param resultLimit Maximal number of reported results (zero means no limit)
+    /// \param operationControl Operation control (can be nullptr)
+    /// \param callback Callback receiving results of single page
+    void findIncremental(const QString& text,
+                         Qt::CaseSensitivity caseSensitivity,
+                         PDFTextFlow::FlowFlags flowFlags,
+                         PDFInteger startPageIndex,
+                         size_t resultLimit,
+                         const PDFOperationControl* operationControl,
+                         const PDFFindResultsCallback& callback) const;
+
+    /// Finds regular expression matches in all pages incrementally. Results are reported
+    /// in the same way, as in the simple text incremental search.
+    /// \param expression Regular expression to be matched
+    /// \param flowFlags Text flow flags
+    /// \param startPageIndex Page, from which search is started
+    /// \param resultLimit Maximal number of reported results (zero means no limit)
+    /// \param operationControl Operation control (can be nullptr)
+    /// \param callback Callback receiving results of single page
+    void findIncremental(const QRegularExpression& expression,
+                         PDFTextFlow::FlowFlags flowFlags,
+                         PDFInteger startPageIndex,
+                         size_t resultLimit,
+                         const PDFOperationControl* operationControl,
+                         const PDFFindResultsCallback& callback) const;
+
     /// Returns number of pages
     size_t getCount() const { return m_offsets.size(); }
 
+    /// Adds consumed memory of compressed text layouts and of the text index
+    /// into the report. Function is not thread safe, if function \p setTextLayout
+    /// is called from another thread.
+    /// \param report Report
+    virtual void collectMemoryUsage(PDFMemoryReport* report) const override;
+
 private:
+    /// Implementation of incremental search
+    /// \param findInTextFlow Function, which finds results in a single text flow
+    /// \param trigramBits Trigram bits of searched text (if empty, text index is not used)
+    void findIncrementalImpl(const std::function<PDFFindResults(const PDFTextFlow&)>& findInTextFlow,
+                             const std::vector<quint32>& trigramBits,
+                             PDFTextFlow::FlowFlags flowFlags,
+                             PDFInteger startPageIndex,
+                             size_t resultLimit,
+                             const PDFOperationControl* operationControl,
+                             const PDFFindResultsCallback& callback) const;
+
     std::vector<int> m_offsets;
     QByteArray m_textLayouts;
+    PDFTextIndex m_textIndex;
 };
 
 }   // namespace pdf
@@ -0,0 +1,364 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pdftracing.h"
+
+#include <QFile>
+#include <QMutex>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QCoreApplication>
+#include "pdfdbgheap.h"
+
+#include <memory>
+#include <vector>
+
+namespace pdf
+{
+
+std::atomic_bool PDFTracing::s_enabled = false;
+
+namespace
+{
+
+struct PDFTraceEvent
+{
+    char phase = 0;
+    const char* name = nullptr;
+    const char* category = nullptr;
+    qint64 timestamp = 0;
+    qint64 value = 0;               ///< Duration of zone, value of counter, or identifier of flow
+};
+
+/// Buffer of the events of one thread. Buffer is locked only by its thread
+/// (when event is recorded) and by exporting thread, so lock is uncontended.
+struct PDFTraceThreadBuffer
+{
+    int threadId = 0;
+    QString threadName;
+    QMutex mutex;
+    std::vector<PDFTraceEvent> events;
+};
+
+class PDFTraceStorage
+{
+public:
+    static PDFTraceStorage* getInstance()
+    {
+        static PDFTraceStorage storage;
+        return &storage;
+    }
+
+    PDFTraceThreadBuffer* getCurrentThreadBuffer()
+    {
+        // Buffers are owned by the storage, so they outlive the threads
+        // and events of finished threads can still be exported.
+        thread_local PDFTraceThreadBuffer* buffer = nullptr;
+
+        if (!buffer)
+        {
+            QMutexLocker lock(&m_mutex);
+            m_buffers.emplace_back(std::make_unique<PDFTraceThreadBuffer>());
+            buffer = m_buffers.back().get();
+            buffer->threadId = int(m_buffers.size());
+
+            QThread* thread = QThread::currentThread();
+            if (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread())
+            {
+                buffer->threadName = QStringLiteral("Main thread");
+            }
+            else if (thread && !thread->objectName().isEmpty())
+            {
+                buffer->threadName = thread->objectName();
+            }
+            else
+            {
+                buffer->threadName = QString("Thread %1").arg(buffer->threadId);
+            }
+        }
+
+        return buffer;
+    }
+
+    void addEvent(const PDFTraceEvent& event)
+    {
+        PDFTraceThreadBuffer* buffer = getCurrentThreadBuffer();
+        QMutexLocker lock(&buffer->mutex);
+        buffer->events.push_back(event);
+    }
+
+    void clear()
+    {
+        QMutexLocker lock(&m_mutex);
+        for (const auto& buffer : m_buffers)
+        {
+            QMutexLocker bufferLock(&buffer->mutex);
+            buffer->events.clear();
+        }
+    }
+
+    qint64 getTimestamp() const { return m_timer.nsecsElapsed(); }
+
+    quint64 createFlowId() { return ++m_lastFlowId; }
+
+    QByteArray createChromeTrace();
+
+private:
+    // Timer is never restarted, so it can be read without locking
+    PDFTraceStorage()
+    {
+        m_timer.start();
+    }
+
+    QMutex m_mutex;
+    QElapsedTimer m_timer;
+    std::atomic<quint64> m_lastFlowId = 0;
+    std::vector<std::unique_ptr<PDFTraceThreadBuffer>> m_buffers;
+};
+
+void appendJsonString(QByteArray& output, const QByteArray& string)
+{
+    output.append('"');
+    for (const char character : string)
+    {
+        switch (character)
+        {
+            case '"':
+                output.append("\\\"");
+                break;
+
+            case '\\':
+                output.append("\\\\");
+                break;
+
+            default:
+                if (static_cast<unsigned char>(character) < 0x20)
+                {
+                    output.append(QByteArray("\\u00") + QByteArray::number(static_cast<unsigned char>(character), 16).rightJustified(2, '0'));
+                }
+                else
+                {
+                    output.append(character);
+                }
+                break;
+        }
+    }
+    output.append('"');
+}
+
+/// Converts nanoseconds to microseconds (time unit of Chrome trace format)
+QByteArray formatMicroseconds(qint64 nanoseconds)
+{
+    return QByteArray::number(double(nanoseconds) / 1000.0, 'f', 3);
+}
+
+QByteArray PDFTraceStorage::createChromeTrace()
+{
+    QByteArray output;
+    output.append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    bool isFirst = true;
+    auto beginEvent = [&output, &isFirst](const PDFTraceThreadBuffer* buffer, char phase, const char* name)
+    {
+        if (!isFirst)
+        {
+            output.append(",\n");
+        }
+        isFirst = false;
+
+        output.append("{\"pid\":1,\"tid\":");
+        output.append(QByteArray::number(buffer->threadId));
+        output.append(",\"ph\":\"");
+        output.append(phase);
+        output.append("\",\"name\":");
+        appendJsonString(output, name);
+    };
+
+    QMutexLocker lock(&m_mutex);
+    for (const auto& buffer : m_buffers)
+    {
+        QMutexLocker bufferLock(&buffer->mutex);
+
+        beginEvent(buffer.get(), 'M', "thread_name");
+        output.append(",\"args\":{\"name\":");
+        appendJsonString(output, buffer->threadName.toUtf8());
+        output.append("}}");
+
+        for (const PDFTraceEvent& event : buffer->events)
+        {
+            beginEvent(buffer.get(), event.phase, event.name);
+            output.append(",\"ts\":");
+            output.append(formatMicroseconds(event.timestamp));
+
+            switch (event.phase)
+            {
+                case 'X':
+                    output.append(",\"cat\":");
+                    appendJsonString(output, event.category);
+                    output.append(",\"dur\":");
+                    output.append(formatMicroseconds(event.value));
+                    break;
+
+                case 'C':
+                    output.append(",\"args\":{\"value\":");
+                    output.append(QByteArray::number(event.value));
+                    output.append("}");
+                    break;
+
+                case 's':
+                case 't':
+                case 'f':
+                    output.append(",\"cat\":\"flow\",\"id\":");
+                    output.append(QByteArray::number(event.value));
+                    if (event.phase == 'f')
+                    {
+                        output.append(",\"bp\":\"e\"");
+                    }
+                    break;
+
+                default:
+                    Q_ASSERT(false);
+                    break;
+            }
+
+            output.append("}");
+        }
+    }
+
+    output.append("\n]}\n");
+    return output;
+}
+
+}   // namespace
+
+void PDFTracing::start()
+{
+    PDFTraceStorage* storage = PDFTraceStorage::getInstance();
+    storage->clear();
+    s_enabled.store(true, std::memory_order_relaxed);
+}
+
+void PDFTracing::stop()
+{
+    s_enabled.store(false, std::memory_order_relaxed);
+}
+
+void PDFTracing::clear()
+{
+    PDFTraceStorage::getInstance()->clear();
+}
+
+qint64 PDFTracing::getTimestamp()
+{
+    return PDFTraceStorage::getInstance()->getTimestamp();
+}
+
+void PDFTracing::addZone(const char* name, const char* category, qint64 beginTimestamp)
+{
+    PDFTraceStorage* storage = PDFTraceStorage::getInstance();
+
+    PDFTraceEvent event;
+    event.phase = 'X';
+    event.name = name;
+    event.category = category;
+    event.timestamp = beginTimestamp;
+    event.value = storage->getTimestamp() - beginTimestamp;
+    storage->addEvent(event);
+}
+
+void PDFTracing::addCounter(const char* name, qint64 value)
+{
+    PDFTraceStorage* storage = PDFTraceStorage::getInstance();
+
+    PDFTraceEvent event;
+    event.phase = 'C';
+    event.name = name;
+    event.timestamp = storage->getTimestamp();
+    event.value = value;
+    storage->addEvent(event);
+}
+
+void PDFTracing::addFlow(FlowPhase phase, const char* name, quint64 id)
+{
+    PDFTraceStorage* storage = PDFTraceStorage::getInstance();
+
+    PDFTraceEvent event;
+    event.name = name;
+    event.timestamp = storage->getTimestamp();
+    event.value = qint64(id);
+
+    switch (phase)
+    {
+        case FlowPhase::Begin:
+            event.phase = 's';
+            break;
+
+        case FlowPhase::Step:
+            event.phase = 't';
+            break;
+
+        case FlowPhase::End:
+            event.phase = 'f';
+            break;
+    }
+
+    storage->addEvent(event);
+}
+
+quint64 PDFTracing::createFlowId()
+{
+    return PDFTraceStorage::getInstance()->createFlowId();
+}
+
+void PDFTracing::setCurrentThreadName(QString name)
+{
+    PDFTraceThreadBuffer* buffer = PDFTraceStorage::getInstance()->getCurrentThreadBuffer();
+    QMutexLocker lock(&buffer->mutex);
+    buffer->threadName = qMove(name);
+}
+
+QByteArray PDFTracing::createChromeTrace()
+{
+    return PDFTraceStorage::getInstance()->createChromeTrace();
+}
+
+PDFOperationResult PDFTracing::exportChromeTrace(const QString& fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate))
+    {
+        return PDFTranslationContext::tr("Can't open file '%1' for writing.").arg(fileName);
+    }
+
+    file.write(createChromeTrace());
+
+    if (file.error() != QFile::NoError)
+    {
+        return PDFTranslationContext::tr("Error writing file '%1': %2").arg(fileName, file.errorString());
+    }
+
+    file.close();
+    return true;
+}
+
+}   // namespace pdf
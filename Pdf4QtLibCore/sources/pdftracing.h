@@ -0,0 +1,157 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef PDFTRACING_H
+#define PDFTRACING_H
+
+#include "pdfglobal.h"
+#include "pdfutils.h"
+
+#include <QString>
+#include <QByteArray>
+
+#include <atomic>
+
+namespace pdf
+{
+
+/// Lightweight tracing of the library. Events (zones, counters and flow events)
+/// are recorded into the buffers of the threads, and can be exported to the Chrome
+/// trace event format (JSON), which can be viewed in chrome://tracing or Perfetto UI.
+/// Tracing is disabled by default, and if it is disabled, cost of the trace macro
+/// is a single relaxed atomic load. Tracing can be compiled out completely
+/// by defining PDF4QT_DISABLE_TRACING (see CMake option PDF4QT_ENABLE_TRACING).
+/// Names and categories of the events must be string literals (or strings
+/// with static storage duration), they are not copied.
+class PDF4QTLIBCORESHARED_EXPORT PDFTracing
+{
+public:
+    enum class FlowPhase
+    {
+        Begin,      ///< Flow starts in enclosing zone
+        Step,       ///< Flow continues in enclosing zone
+        End         ///< Flow ends in enclosing zone
+    };
+
+    /// Returns true, if events are being recorded
+    static inline bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    /// Clears all recorded events and starts recording
+    static void start();
+
+    /// Stops recording of the events, recorded events are kept
+    static void stop();
+
+    /// Clears all recorded events
+    static void clear();
+
+    /// Returns current time of the trace clock in nanoseconds
+    static qint64 getTimestamp();
+
+    /// Records complete event (zone), which started at \p beginTimestamp
+    /// and ends now. Event is recorded to the buffer of current thread.
+    /// \param name Name of the zone
+    /// \param category Category of the zone
+    /// \param beginTimestamp Begin time (see \p getTimestamp)
+    static void addZone(const char* name, const char* category, qint64 beginTimestamp);
+
+    /// Records value of the counter
+    /// \param name Name of the counter
+    /// \param value Value
+    static void addCounter(const char* name, qint64 value);
+
+    /// Records flow event. Flow events connect zones in different threads
+    /// (for example, request of the page and its compilation).
+    /// \param phase Phase of the flow
+    /// \param name Name of the flow
+    /// \param id Identifier of the flow (see \p createFlowId)
+    static void addFlow(FlowPhase phase, const char* name, quint64 id);
+
+    /// Creates new unique flow identifier
+    static quint64 createFlowId();
+
+    /// Sets name of current thread in the trace. If name is not set,
+    /// object name of current QThread is used, or generic name.
+    /// \param name Name of the thread
+    static void setCurrentThreadName(QString name);
+
+    /// Creates trace of recorded events in Chrome trace event format (JSON)
+    static QByteArray createChromeTrace();
+
+    /// Writes trace of recorded events in Chrome trace event format to the file
+    /// \param fileName File name
+    static PDFOperationResult exportChromeTrace(const QString& fileName);
+
+private:
+    PDFTracing() = delete;
+
+    static std::atomic_bool s_enabled;
+};
+
+/// Traces scope as a zone. Begin time is taken only, if tracing is enabled.
+class PDFTraceZone
+{
+public:
+    inline explicit PDFTraceZone(const char* name, const char* category) :
+        m_name(name),
+        m_category(category),
+        m_beginTimestamp(PDFTracing::isEnabled() ? PDFTracing::getTimestamp() : -1)
+    {
+
+    }
+
+    inline ~PDFTraceZone()
+    {
+        if (m_beginTimestamp >= 0 && PDFTracing::isEnabled())
+        {
+            PDFTracing::addZone(m_name, m_category, m_beginTimestamp);
+        }
+    }
+
+    PDFTraceZone(const PDFTraceZone&) = delete;
+    PDFTraceZone& operator=(const PDFTraceZone&) = delete;
+
+private:
+    const char* m_name;
+    const char* m_category;
+    qint64 m_beginTimestamp;
+};
+
+}   // namespace pdf
+
+#define PDF_TRACE_CONCAT_IMPL(a, b) a##b
+#define PDF_TRACE_CONCAT(a, b) PDF_TRACE_CONCAT_IMPL(a, b)
+
+#ifndef PDF4QT_DISABLE_TRACING
+#define PDF_TRACE_ZONE(name, category) pdf::PDFTraceZone PDF_TRACE_CONCAT(pdfTraceZone, __LINE__)(name, category)
+#define PDF_TRACE_COUNTER(name, value) do { if (pdf::PDFTracing::isEnabled()) { pdf::PDFTracing::addCounter(name, value); } } while (false)
+#define PDF_TRACE_FLOW(phase, name, id) do { if (pdf::PDFTracing::isEnabled() && (id) != 0) { pdf::PDFTracing::addFlow(pdf::PDFTracing::FlowPhase::phase, name, id); } } while (false)
+#define PDF_TRACE_FLOW_ID() (pdf::PDFTracing::isEnabled() ? pdf::PDFTracing::createFlowId() : quint64(0))
+#else
+#define PDF_TRACE_ZONE(name, category) do { } while (false)
+#define PDF_TRACE_COUNTER(name, value) do { } while (false)
+#define PDF_TRACE_FLOW(phase, name, id) do { } while (false)
+#define PDF_TRACE_FLOW_ID() (quint64(0))
+#endif
+
+#endif // PDFTRACING_H
@@ -26,10 +26,16 @@
 #include "pdfexecutionpolicy.h"
 #include "pdfimage.h"
 #include "pdfpattern.h"
+
+#include <QSemaphore>
+#include <QElapsedTimer>
+
 #include "pdfdbgheap.h"
 
 #include <QtMath>
+#include <limits>
 #include <iterator>
+#include <type_traits>
 
 namespace pdf
 {
@@ -62,6 +68,7 @@ PDFColorBuffer PDFFloatBitmap::getPixel(size_t x, size_t y)
 {
     Q_ASSERT(x < m_width);
     Q_ASSERT(y < m_height);
+    Q_ASSERT(isFullPrecision());
 
     const size_t index = getPixelIndex(x, y);
     return PDFColorBuffer(m_data.data() + index, m_pixelSize);
@@ -71,6 +78,7 @@ PDFConstColorBuffer PDFFloatBitmap::getPixel(size_t x, size_t y) const
 {
     Q_ASSERT(x < m_width);
     Q_ASSERT(y < m_height);
+    Q_ASSERT(isFullPrecision());
 
     const size_t index = getPixelIndex(x, y);
     return PDFConstColorBuffer(m_data.data() + index, m_pixelSize);
@@ -78,25 +86,213 @@ PDFConstColorBuffer PDFFloatBitmap::getPixel(size_t x, size_t y) const
 
 PDFColorBuffer PDFFloatBitmap::getPixels()
 {
+    Q_ASSERT(isFullPrecision());
     return PDFColorBuffer(m_data.data(), m_data.size());
 }
 
-PDFColorComponent PDFFloatBitmap::getPixelInkCoverage(size_t x, size_t y) const
+void PDFFloatBitmap::setPrecision(Precision precision)
 {
-    PDFConstColorBuffer buffer = getPixel(x, y);
+    if (m_precision == precision)
+    {
+        return;
+    }
+
+    const size_t dataLength = m_format.calculateBitmapDataLength(m_width, m_height);
+
+    switch (precision)
+    {
+        case Precision::Float32:
+        {
+            std::vector<PDFColorComponent> data(dataLength, 0.0f);
+            for (size_t i = 0; i < dataLength; ++i)
+            {
+                data[i] = getValue(i);
+            }
+            m_data = std::move(data);
+            break;
+        }
+
+        case Precision::UNorm16:
+        {
+            std::vector<uint16_t> data(dataLength, 0);
+            for (size_t i = 0; i < dataLength; ++i)
+            {
+                data[i] = static_cast<uint16_t>(qRound(qBound(0.0f, getValue(i), 1.0f) * 65535.0f));
+            }
+            m_dataUNorm16 = std::move(data);
+            break;
+        }
+
+        case Precision::UNorm8:
+        {
+            std::vector<uint8_t> data(dataLength, 0);
+            for (size_t i = 0; i < dataLength; ++i)
+            {
+                data[i] = static_cast<uint8_t>(qRound(qBound(0.0f, getValue(i), 1.0f) * 255.0f));
+            }
+            m_dataUNorm8 = std::move(data);
+            break;
+        }
+    }
 
+    // Release data of old precision
+    switch (m_precision)
+    {
+        case Precision::Float32:
+            m_data = std::vector<PDFColorComponent>();
+            break;
+
+        case Precision::UNorm16:
+            m_dataUNorm16 = std::vector<uint16_t>();
+            break;
+
+        case Precision::UNorm8:
+            m_dataUNorm8 = std::vector<uint8_t>();
+            break;
+    }
+
+    m_precision = precision;
+}
+
+void PDFFloatBitmap::readPixel(size_t x, size_t y, PDFColorBuffer pixel) const
+{
+    Q_ASSERT(x < m_width);
+    Q_ASSERT(y < m_height);
+    Q_ASSERT(pixel.size() >= m_pixelSize);
+
+    const size_t index = getPixelIndex(x, y);
+    for (size_t i = 0; i < m_pixelSize; ++i)
+    {
+        pixel[i] = getValue(index + i);
+    }
+}
+
+PDFColorComponent PDFFloatBitmap::getValue(size_t index) const
+{
+    switch (m_precision)
+    {
+        case Precision::Float32:
+            return m_data[index];
+
+        case Precision::UNorm16:
+            return m_dataUNorm16[index] / 65535.0f;
+
+        case Precision::UNorm8:
+            return m_dataUNorm8[index] / 255.0f;
+    }
+
+    Q_ASSERT(false);
+    return 0.0f;
+}
+
+PDFColorComponent PDFFloatBitmap::getPixelInkCoverage(size_t x, size_t y) const
+{
+    const size_t index = getPixelIndex(x, y);
     const uint8_t colorChannelIndexStart = m_format.getColorChannelIndexStart();
     const uint8_t colorChannelIndexEnd = m_format.getColorChannelIndexEnd();
 
     PDFColorComponent inkCoverage = 0.0;
     for (uint8_t i = colorChannelIndexStart; i < colorChannelIndexEnd; ++i)
     {
-        inkCoverage += buffer[i];
+        inkCoverage += getValue(index + i);
     }
 
     return inkCoverage;
 }
 
+namespace
+{
+
+/// Calculates ink coverage of pixels. Reduced precision values are summed as integers
+/// and scaled only once per pixel.
+template<typename T>
+void calculateInkCoverage(const T* data, size_t pixelCount, size_t pixelSize, uint8_t colorChannelStart, uint8_t colorChannelEnd, PDFColorComponent scale, PDFColorComponent* output)
+{
+    using Accumulator = std::conditional_t<std::is_floating_point_v<T>, PDFColorComponent, uint32_t>;
+
+    for (size_t i = 0; i < pixelCount; ++i, data += pixelSize)
+    {
+        Accumulator coverage = 0;
+        for (uint8_t channel = colorChannelStart; channel < colorChannelEnd; ++channel)
+        {
+            coverage += data[channel];
+        }
+
+        output[i] = PDFColorComponent(coverage) * scale;
+    }
+}
+
+/// Calculates sums of color channels, weighted by opacity
+template<typename T>
+void calculateColorChannelSums(const T* data, size_t pixelCount, size_t pixelSize, uint8_t colorChannelStart, uint8_t colorChannelCount, uint8_t opacityChannel, PDFColorComponent scale, PDFColorComponent* output)
+{
+    for (size_t i = 0; i < pixelCount; ++i, data += pixelSize)
+    {
+        const PDFColorComponent alpha = opacityChannel != PDFPixelFormat::INVALID_CHANNEL_INDEX ? PDFColorComponent(data[opacityChannel]) * scale : 1.0f;
+        const PDFColorComponent alphaScale = alpha * scale;
+
+        for (uint8_t channel = 0; channel < colorChannelCount; ++channel)
+        {
+            output[channel] += PDFColorComponent(data[colorChannelStart + channel]) * alphaScale;
+        }
+    }
+}
+
+}   // namespace
+
+std::vector<PDFColorComponent> PDFFloatBitmap::getInkCoverageValues() const
+{
+    const size_t pixelCount = m_width * m_height;
+    const uint8_t colorChannelIndexStart = m_format.getColorChannelIndexStart();
+    const uint8_t colorChannelIndexEnd = m_format.getColorChannelIndexEnd();
+
+    std::vector<PDFColorComponent> result(pixelCount, 0.0f);
+
+    switch (m_precision)
+    {
+        case Precision::Float32:
+            calculateInkCoverage(m_data.data(), pixelCount, m_pixelSize, colorChannelIndexStart, colorChannelIndexEnd, 1.0f, result.data());
+            break;
+
+        case Precision::UNorm16:
+            calculateInkCoverage(m_dataUNorm16.data(), pixelCount, m_pixelSize, colorChannelIndexStart, colorChannelIndexEnd, 1.0f / 65535.0f, result.data());
+            break;
+
+        case Precision::UNorm8:
+            calculateInkCoverage(m_dataUNorm8.data(), pixelCount, m_pixelSize, colorChannelIndexStart, colorChannelIndexEnd, 1.0f / 255.0f, result.data());
+            break;
+    }
+
+    return result;
+}
+
+std::vector<PDFColorComponent> PDFFloatBitmap::getColorChannelSums() const
+{
+    const size_t pixelCount = m_width * m_height;
+    const uint8_t colorChannelIndexStart = m_format.getColorChannelIndexStart();
+    const uint8_t colorChannelCount = m_format.getColorChannelCount();
+    const uint8_t opacityChannelIndex = m_format.getOpacityChannelIndex();
+
+    std::vector<PDFColorComponent> result(colorChannelCount, 0.0f);
+
+    switch (m_precision)
+    {
+        case Precision::Float32:
+            calculateColorChannelSums(m_data.data(), pixelCount, m_pixelSize, colorChannelIndexStart, colorChannelCount, opacityChannelIndex, 1.0f, result.data());
+            break;
+
+        case Precision::UNorm16:
+            calculateColorChannelSums(m_dataUNorm16.data(), pixelCount, m_pixelSize, colorChannelIndexStart, colorChannelCount, opacityChannelIndex, 1.0f / 65535.0f, result.data());
+            break;
+
+        case Precision::UNorm8:
+            calculateColorChannelSums(m_dataUNorm8.data(), pixelCount, m_pixelSize, colorChannelIndexStart, colorChannelCount, opacityChannelIndex, 1.0f / 255.0f, result.data());
+            break;
+    }
+
+    return result;
+}
+
 PDFFloatBitmap PDFFloatBitmap::getInkCoverageBitmap() const
 {
     PDFFloatBitmap result(getWidth(), getHeight(), PDFPixelFormat::createFormat(1, 0, false, true, false));
@@ -222,8 +418,7 @@ QImage PDFFloatBitmap::getChannelImage(uint8_t channelIndex) const
         uchar* line = image.scanLine(y);
         for (int x = 0; x < image.width(); ++x)
         {
-            PDFConstColorBuffer buffer = getPixel(x, y);
-            line[x] = qRound(buffer[channelIndex] * 255);
+            line[x] = qRound(getValue(getPixelIndex(x, y) + channelIndex) * 255);
         }
     }
 
@@ -634,9 +829,34 @@ void PDFFloatBitmap::blend(const PDFFloatBitmap& source,
         return channelBlendModes[channel];
     };
 
-    for (int x = blendRegion.left(); x <= blendRegion.right(); ++x)
-    {
-        for (int y = blendRegion.top(); y <= blendRegion.bottom(); ++y)
+    const bool isSeparable = PDFBlendModeInfo::isSeparable(mode);
+    const bool isProcessColorSubtractive = pixelFormat.hasProcessColorsSubtractive();
+    const bool isSpotColorSubtractive = pixelFormat.hasSpotColorsSubtractive();
+    const BlendMode spotColorBlendMode = pixelFormat.hasSpotColors() ? channelBlendModes[spotColorChannelStart] : mode;
+    const uint8_t processColorChannelCount = pixelFormat.getProcessColorChannelCount();
+    const uint8_t spotColorChannelCount = pixelFormat.getSpotColorChannelCount();
+
+    // Without overprinting, blend mode of each channel doesn't depend on the pixel,
+    // so we can use span blending kernels. If all color channels are blended using
+    // the same blend mode, whole row is blended at once (auxiliary channels are
+    // blended too, but their blended values are not used).
+    const bool useSpanBlending = overprintMode == OverprintMode::NoOveprint;
+    const bool useRowBlending = useSpanBlending && isSeparable &&
+                                (!pixelFormat.hasProcessColors() || !pixelFormat.hasSpotColors() ||
+                                 (spotColorBlendMode == mode && isSpotColorSubtractive == isProcessColorSubtractive));
+    const bool isRowSubtractive = pixelFormat.hasProcessColors() ? isProcessColorSubtractive : isSpotColorSubtractive;
+    const size_t pixelSize = source.getPixelSize();
+    std::vector<PDFColorComponent> B_row(useRowBlending ? size_t(qMax(blendRegion.width(), 0)) * pixelSize : 0, 0.0f);
+
+    for (int y = blendRegion.top(); y <= blendRegion.bottom(); ++y)
+    {
+        if (useRowBlending)
+        {
+            PDFBlendFunction::blendSpan(mode, isRowSubtractive, backdrop.getPixel(blendRegion.left(), y).begin(),
+                                        source.getPixel(blendRegion.left(), y).begin(), B_row.data(), B_row.size());
+        }
+
+        for (int x = blendRegion.left(); x <= blendRegion.right(); ++x)
         {
             PDFConstColorBuffer sourceColor = source.getPixel(x, y);
             PDFColorBuffer targetColor = target.getPixel(x, y);
@@ -689,15 +909,33 @@ void PDFFloatBitmap::blend(const PDFFloatBitmap& source,
                 target.markPixelActiveColorMask(x, y, activeColorChannels);
             }
 
-            std::fill(B_i.begin(), B_i.end(), 0.0f);
+            const PDFColorComponent* B = B_i.data();
 
             // Calculate blended pixel
-            if (PDFBlendModeInfo::isSeparable(mode))
+            if (useRowBlending)
             {
-                // Separable blend mode - process each color separately
-                const bool isProcessColorSubtractive = pixelFormat.hasProcessColorsSubtractive();
-                const bool isSpotColorSubtractive = pixelFormat.hasSpotColorsSubtractive();
+                B = B_row.data() + size_t(x - blendRegion.left()) * pixelSize;
+            }
+            else if (isSeparable && useSpanBlending)
+            {
+                // Separable blend mode - process and spot colors are blended separately
+                if (pixelFormat.hasProcessColors())
+                {
+                    PDFBlendFunction::blendSpan(mode, isProcessColorSubtractive, backdropColor.begin() + processColorChannelStart,
+                                                sourceColor.begin() + processColorChannelStart, B_i.data() + processColorChannelStart, processColorChannelCount);
+                }
 
+                if (pixelFormat.hasSpotColors())
+                {
+                    PDFBlendFunction::blendSpan(spotColorBlendMode, isSpotColorSubtractive, backdropColor.begin() + spotColorChannelStart,
+                                                sourceColor.begin() + spotColorChannelStart, B_i.data() + spotColorChannelStart, spotColorChannelCount);
+                }
+            }
+            else if (isSeparable)
+            {
+                std::fill(B_i.begin(), B_i.end(), 0.0f);
+
+                // Separable blend mode - process each color separately
                 if (pixelFormat.hasProcessColors())
                 {
                     if (!isProcessColorSubtractive)
@@ -741,6 +979,8 @@ void PDFFloatBitmap::blend(const PDFFloatBitmap& source,
             }
             else
             {
+                std::fill(B_i.begin(), B_i.end(), 0.0f);
+
                 // Nonseparable blend mode - process colors together
                 if (pixelFormat.hasProcessColors())
                 {
@@ -800,9 +1040,13 @@ void PDFFloatBitmap::blend(const PDFFloatBitmap& source,
                     }
                 }
 
-                if (pixelFormat.hasSpotColors())
+                if (pixelFormat.hasSpotColors() && useSpanBlending)
+                {
+                    PDFBlendFunction::blendSpan(spotColorBlendMode, isSpotColorSubtractive, backdropColor.begin() + spotColorChannelStart,
+                                                sourceColor.begin() + spotColorChannelStart, B_i.data() + spotColorChannelStart, spotColorChannelCount);
+                }
+                else if (pixelFormat.hasSpotColors())
                 {
-                    const bool isSpotColorSubtractive = pixelFormat.hasSpotColorsSubtractive();
                     if (!isSpotColorSubtractive)
                     {
                         for (uint8_t i = spotColorChannelStart; i < spotColorChannelEnd; ++i)
@@ -828,7 +1072,7 @@ void PDFFloatBitmap::blend(const PDFFloatBitmap& source,
                 const PDFColorComponent C_b = backdropColor[i];
                 const PDFColorComponent C_i_1 = targetColor[i];
 
-                PDFColorComponent C_t = (f_s_i - alpha_s_i) * alpha_b * C_b + alpha_s_i * ((1.0f - alpha_b) * C_s_i + alpha_b * B_i[i]);
+                PDFColorComponent C_t = (f_s_i - alpha_s_i) * alpha_b * C_b + alpha_s_i * ((1.0f - alpha_b) * C_s_i + alpha_b * B[i]);
                 PDFColorComponent C_i = ((1.0f - f_s_i) * alpha_i_1 * C_i_1 + C_t) / alpha_i;
 
                 targetColor[i] = C_i;
@@ -897,6 +1141,27 @@ void PDFFloatBitmap::fillChannel(size_t channel, PDFColorComponent value)
     }
 }
 
+void PDFFloatBitmap::clearInactiveColors(uint32_t activeColorMask)
+{
+    Q_ASSERT(isFullPrecision());
+
+    const uint32_t colorChannelStart = m_format.getColorChannelIndexStart();
+    const uint32_t colorChannelEnd = m_format.getColorChannelIndexEnd();
+    const uint32_t processColorChannelEnd = m_format.getProcessColorChannelIndexEnd();
+
+    for (uint32_t colorChannelIndex = colorChannelStart; colorChannelIndex < colorChannelEnd; ++colorChannelIndex)
+    {
+        const uint32_t flag = 1 << colorChannelIndex;
+        if (!(activeColorMask & flag))
+        {
+            const bool isProcessColor = colorChannelIndex < processColorChannelEnd;
+            const bool isSubtractive = isProcessColor ? m_format.hasProcessColorsSubtractive() : m_format.hasSpotColorsSubtractive();
+
+            fillChannel(colorChannelIndex, isSubtractive ? 0.0f : 1.0f);
+        }
+    }
+}
+
 PDFFloatBitmap PDFFloatBitmap::createOpaqueSoftMask(size_t width, size_t height)
 {
     PDFFloatBitmap result(width, height, PDFPixelFormat::createOpacityMask());
@@ -1030,6 +1295,7 @@ void PDFTransparencyRenderer::beginPaint(QSize pixelSize)
     Q_ASSERT(m_processColorSpace);
 
     m_originalProcessBitmap = PDFFloatBitmapWithColorSpace();
+    m_softMaskCache.clear();
     m_transparencyGroupDataStack.clear();
     m_painterStateStack.push(PDFTransparencyPainterState());
 
@@ -1088,7 +1354,7 @@ const PDFFloatBitmap& PDFTransparencyRenderer::endPaint()
     return *getImmediateBackdrop();
 }
 
-QImage PDFTransparencyRenderer::toImageImpl(const PDFFloatBitmapWithColorSpace& floatImage, bool use16Bit) const
+QImage PDFTransparencyRenderer::toImageImpl(const PDFFloatBitmapWithColorSpace& floatImage, bool use16Bit)
 {
     QImage image;
 
@@ -1163,27 +1429,75 @@ QImage PDFTransparencyRenderer::toImage(bool use16Bit, bool usePaper, const PDFR
     if (m_transparencyGroupDataStack.size() == 1 && // We have finished the painting
         getImmediateBackdrop()->getPixelFormat().getProcessColorChannelCount() == 3) // We have exactly three process colors (RGB)
     {
-        const PDFFloatBitmapWithColorSpace& floatImage = *getImmediateBackdrop();
-        Q_ASSERT(floatImage.getPixelFormat().hasOpacityChannel());
+        return toImageImpl(*getImmediateBackdrop(), use16Bit, usePaper, paperColor);
+    }
 
-        if (!usePaper)
-        {
-            return toImageImpl(floatImage, use16Bit);
-        }
+    return image;
+}
 
-        PDFFloatBitmapWithColorSpace paperImage(floatImage.getWidth(), floatImage.getHeight(), floatImage.getPixelFormat(), floatImage.getColorSpace());
-        createPaperBitmap(paperImage, paperColor);
+QImage PDFTransparencyRenderer::toImageImpl(const PDFFloatBitmapWithColorSpace& floatImage, bool use16Bit, bool usePaper, const PDFRGB& paperColor)
+{
+    Q_ASSERT(floatImage.getPixelFormat().hasOpacityChannel());
+
+    if (!usePaper)
+    {
+        return toImageImpl(floatImage, use16Bit);
+    }
 
-        PDFFloatBitmap imageSoftMask;
-        createOpaqueSoftMask(imageSoftMask, paperImage.getWidth(), paperImage.getHeight());
+    PDFFloatBitmapWithColorSpace paperImage(floatImage.getWidth(), floatImage.getHeight(), floatImage.getPixelFormat(), floatImage.getColorSpace());
+    createPaperBitmap(paperImage, paperColor);
 
-        QRect blendRegion(0, 0, int(floatImage.getWidth()), int(floatImage.getHeight()));
-        PDFFloatBitmapWithColorSpace::blend(floatImage, paperImage, paperImage, paperImage, imageSoftMask, false, 1.0f, BlendMode::Normal, false, PDFFloatBitmap::OverprintMode::NoOveprint, blendRegion);
+    PDFFloatBitmap imageSoftMask;
+    createOpaqueSoftMask(imageSoftMask, paperImage.getWidth(), paperImage.getHeight());
+
+    QRect blendRegion(0, 0, int(floatImage.getWidth()), int(floatImage.getHeight()));
+    PDFFloatBitmapWithColorSpace::blend(floatImage, paperImage, paperImage, paperImage, imageSoftMask, false, 1.0f, BlendMode::Normal, false, PDFFloatBitmap::OverprintMode::NoOveprint, blendRegion);
+
+    return toImageImpl(paperImage, use16Bit);
+}
 
-        return toImageImpl(paperImage, use16Bit);
+QImage PDFTransparencyRenderer::createImageFromOriginalProcessBitmap(PDFFloatBitmapWithColorSpace originalProcessBitmap,
+                                                                     uint32_t activeColorMask,
+                                                                     const PDFInkMapper* inkMapper,
+                                                                     const PDFCMS* cms,
+                                                                     const PDFColorSpacePointer& deviceColorSpace,
+                                                                     bool usePaper,
+                                                                     const PDFRGB& paperColor,
+                                                                     PDFRenderErrorReporter* reporter)
+{
+    const size_t width = originalProcessBitmap.getWidth();
+    const size_t height = originalProcessBitmap.getHeight();
+
+    if (width == 0 || height == 0 || !deviceColorSpace || deviceColorSpace->getColorComponentCount() != 3)
+    {
+        return QImage();
     }
 
-    return image;
+    // Perform the same steps as are performed, when page transparency group is finished
+    originalProcessBitmap.setPrecision(PDFFloatBitmap::Precision::Float32);
+    if (activeColorMask != PDFPixelFormat::getAllColorsMask())
+    {
+        originalProcessBitmap.clearInactiveColors(activeColorMask);
+    }
+
+    collapseSpotColorsToDeviceColors(originalProcessBitmap, inkMapper, cms, RenderingIntent::Perceptual, reporter);
+    originalProcessBitmap.convertToColorSpace(cms, RenderingIntent::RelativeColorimetric, deviceColorSpace, reporter);
+
+    if (originalProcessBitmap.getPixelFormat().getProcessColorChannelCount() != 3)
+    {
+        return QImage();
+    }
+
+    PDFFloatBitmapWithColorSpace deviceBitmap(width, height, originalProcessBitmap.getPixelFormat(), deviceColorSpace);
+    deviceBitmap.makeColorWhite();
+
+    PDFFloatBitmap softMask;
+    createOpaqueSoftMask(softMask, width, height);
+
+    QRect blendRegion(0, 0, int(width), int(height));
+    PDFFloatBitmap::blend(originalProcessBitmap, deviceBitmap, deviceBitmap, deviceBitmap, softMask, false, 1.0f, BlendMode::Normal, false, PDFFloatBitmap::OverprintMode::NoOveprint, blendRegion);
+
+    return toImageImpl(deviceBitmap, false, usePaper, paperColor);
 }
 
 void PDFTransparencyRenderer::clearColor(const PDFColor& color)
@@ -1352,6 +1666,15 @@ void PDFTransparencyRenderer::performFillFragmentFromTexture(const PDFReal shape
 }
 
 void PDFTransparencyRenderer::collapseSpotColorsToDeviceColors(PDFFloatBitmapWithColorSpace& bitmap)
+{
+    collapseSpotColorsToDeviceColors(bitmap, m_inkMapper, getCMS(), getGraphicState()->getRenderingIntent(), this);
+}
+
+void PDFTransparencyRenderer::collapseSpotColorsToDeviceColors(PDFFloatBitmapWithColorSpace& bitmap,
+                                                               const PDFInkMapper* inkMapper,
+                                                               const PDFCMS* cms,
+                                                               RenderingIntent intent,
+                                                               PDFRenderErrorReporter* reporter)
 {
     PDFPixelFormat pixelFormat = bitmap.getPixelFormat();
 
@@ -1366,7 +1689,7 @@ void PDFTransparencyRenderer::collapseSpotColorsToDeviceColors(PDFFloatBitmapWit
     for (uint8_t i = spotColorIndexStart; i < spotColorIndexEnd; ++i)
     {
         // Collapse spot color
-        const PDFInkMapper::ColorInfo* spotColor = m_inkMapper->getActiveSpotColor(i - spotColorIndexStart);
+        const PDFInkMapper::ColorInfo* spotColor = inkMapper->getActiveSpotColor(i - spotColorIndexStart);
         Q_ASSERT(spotColor);
 
         switch (spotColor->colorSpace->getColorSpace())
@@ -1375,9 +1698,9 @@ void PDFTransparencyRenderer::collapseSpotColorsToDeviceColors(PDFFloatBitmapWit
             {
                 PDFFloatBitmap spotColorBitmap = bitmap.extractSpotChannel(i);
                 PDFFloatBitmap processColorBitmap(spotColorBitmap.getWidth(), spotColorBitmap.getHeight(), PDFPixelFormat::createFormat(pixelFormat.getProcessColorChannelCount(), 0, false, pixelFormat.hasProcessColorsSubtractive(), false));
-                if (!PDFAbstractColorSpace::transform(spotColor->colorSpace.data(), bitmap.getColorSpace().data(), getCMS(), getGraphicState()->getRenderingIntent(), spotColorBitmap.getPixels(), processColorBitmap.getPixels(), this))
+                if (!PDFAbstractColorSpace::transform(spotColor->colorSpace.data(), bitmap.getColorSpace().data(), cms, intent, spotColorBitmap.getPixels(), processColorBitmap.getPixels(), reporter))
                 {
-                    reportRenderError(RenderErrorType::Error, PDFTranslationContext::tr("Transformation of spot color to blend color space failed."));
+                    reporter->reportRenderError(RenderErrorType::Error, PDFTranslationContext::tr("Transformation of spot color to blend color space failed."));
                 }
 
                 bitmap.blendConvertedSpots(processColorBitmap);
@@ -1391,9 +1714,9 @@ void PDFTransparencyRenderer::collapseSpotColorsToDeviceColors(PDFFloatBitmapWit
 
                 deviceNBitmap.copyChannel(bitmap, i, spotColor->colorSpaceIndex);
 
-                if (!PDFAbstractColorSpace::transform(spotColor->colorSpace.data(), bitmap.getColorSpace().data(), getCMS(), getGraphicState()->getRenderingIntent(), deviceNBitmap.getPixels(), processColorBitmap.getPixels(), this))
+                if (!PDFAbstractColorSpace::transform(spotColor->colorSpace.data(), bitmap.getColorSpace().data(), cms, intent, deviceNBitmap.getPixels(), processColorBitmap.getPixels(), reporter))
                 {
-                    reportRenderError(RenderErrorType::Error, PDFTranslationContext::tr("Transformation of spot color to blend color space failed."));
+                    reporter->reportRenderError(RenderErrorType::Error, PDFTranslationContext::tr("Transformation of spot color to blend color space failed."));
                 }
 
                 bitmap.blendConvertedSpots(processColorBitmap);
@@ -1401,7 +1724,7 @@ void PDFTransparencyRenderer::collapseSpotColorsToDeviceColors(PDFFloatBitmapWit
             }
 
             default:
-                reportRenderError(RenderErrorType::Error, PDFTranslationContext::tr("Transformation of spot color to blend color space failed."));
+                reporter->reportRenderError(RenderErrorType::Error, PDFTranslationContext::tr("Transformation of spot color to blend color space failed."));
                 break;
         }
 
@@ -2008,6 +2331,22 @@ void PDFTransparencyRenderer::processSoftMask(const PDFDictionary* softMask)
     }
     else
     {
+        // Soft masks are often reused by many objects (for example, drop shadows),
+        // so we render each soft mask only once for given transformation.
+        const QTransform& matrix = getGraphicState()->getCurrentTransformationMatrix();
+        PDFSoftMaskCacheKey key;
+        key.softMask = softMask;
+        key.matrix = { matrix.m11(), matrix.m12(), matrix.m21(), matrix.m22(), matrix.dx(), matrix.dy() };
+        key.width = m_drawBuffer.getWidth();
+        key.height = m_drawBuffer.getHeight();
+
+        auto it = m_softMaskCache.find(key);
+        if (it != m_softMaskCache.cend())
+        {
+            getPainterState()->softMask = it->second;
+            return;
+        }
+
         PDFSoftMaskDefinition softMaskDefinition = PDFSoftMaskDefinition::parse(softMask, this);
 
         if (!softMaskDefinition.getFormStream())
@@ -2090,6 +2429,7 @@ void PDFTransparencyRenderer::processSoftMask(const PDFDictionary* softMask)
         }
 
         getPainterState()->softMask = PDFTransparencySoftMask(false, qMove(createdSoftMask));
+        m_softMaskCache[key] = getPainterState()->softMask;
     }
 }
 
@@ -2530,6 +2870,15 @@ void PDFTransparencyRenderer::performBeginTransparencyGroup(ProcessOrder order,
         // Create draw buffer
         m_drawBuffer = PDFDrawBuffer(data.immediateBackdrop.getWidth(), data.immediateBackdrop.getHeight(), data.immediateBackdrop.getPixelFormat());
 
+        // Backdrops of the parent group are not used until this group
+        // is finished, so we can store them in reduced precision.
+        if (m_settings.storagePrecision != PDFFloatBitmap::Precision::Float32 && !m_transparencyGroupDataStack.empty())
+        {
+            PDFTransparencyGroupPainterData& parentData = m_transparencyGroupDataStack.back();
+            parentData.initialBackdrop.setPrecision(m_settings.storagePrecision);
+            parentData.immediateBackdrop.setPrecision(m_settings.storagePrecision);
+        }
+
         m_transparencyGroupDataStack.emplace_back(qMove(data));
         invalidateCachedItems();
     }
@@ -2547,31 +2896,21 @@ void PDFTransparencyRenderer::performEndTransparencyGroup(ProcessOrder order, co
         PDFTransparencyGroupPainterData sourceData = qMove(m_transparencyGroupDataStack.back());
         m_transparencyGroupDataStack.pop_back();
 
+        // Parent group is active again, restore full precision of its backdrops
+        m_transparencyGroupDataStack.back().initialBackdrop.setPrecision(PDFFloatBitmap::Precision::Float32);
+        m_transparencyGroupDataStack.back().immediateBackdrop.setPrecision(PDFFloatBitmap::Precision::Float32);
+
         // Filter inactive colors - clear all colors in immediate mask,
         // which are set to inactive.
         if (sourceData.filterColorsUsingMask)
         {
-            const PDFPixelFormat pixelFormat = sourceData.immediateBackdrop.getPixelFormat();
-            const uint32_t colorChannelStart = pixelFormat.getColorChannelIndexStart();
-            const uint32_t colorChannelEnd = pixelFormat.getColorChannelIndexEnd();
-            const uint32_t processColorChannelEnd = pixelFormat.getProcessColorChannelIndexEnd();
-
-            for (uint32_t colorChannelIndex = colorChannelStart; colorChannelIndex < colorChannelEnd; ++colorChannelIndex)
-            {
-                const uint32_t flag = 1 << colorChannelIndex;
-                if (!(sourceData.activeColorMask & flag))
-                {
-                    const bool isProcessColor = colorChannelIndex < processColorChannelEnd;
-                    const bool isSubtractive = isProcessColor ? pixelFormat.hasProcessColorsSubtractive() : pixelFormat.hasSpotColorsSubtractive();
-
-                    sourceData.immediateBackdrop.fillChannel(colorChannelIndex, isSubtractive ? 0.0f : 1.0f);
-                }
-            }
+            sourceData.immediateBackdrop.clearInactiveColors(sourceData.activeColorMask);
         }
 
         if (sourceData.saveOriginalImage)
         {
             m_originalProcessBitmap = sourceData.immediateBackdrop;
+            m_originalProcessBitmap.setPrecision(m_settings.storagePrecision);
         }
 
         // Collapse spot colors
@@ -3519,296 +3858,352 @@ PDFInkMapping PDFInkMapper::createMapping(const PDFAbstractColorSpace* sourceCol
     return mapping;
 }
 
-PDFPainterPathSampler::PDFPainterPathSampler(QPainterPath path, int samplesCount, PDFColorComponent defaultShape, QRect fillRect, bool precise) :
-    m_defaultShape(defaultShape),
-    m_samplesCount(qMax(samplesCount, 1)),
-    m_path(qMove(path)),
-    m_fillRect(fillRect),
-    m_precise(precise)
-{
-    if (!precise)
-    {
-        m_fillPolygon = m_path.toFillPolygon();
-        prepareScanLines();
-    }
-}
-
-PDFColorComponent PDFPainterPathSampler::sample(QPoint point) const
+PDFPathCoverageRasterizer::PDFPathCoverageRasterizer(const QPainterPath& path, QRect rect) :
+    m_rect(rect),
+    m_fillRule(path.fillRule())
 {
-    if (m_path.isEmpty() || !m_fillRect.contains(point))
+    if (!m_rect.isValid())
     {
-        return m_defaultShape;
+        return;
     }
 
-    if (!m_scanLineInfo.empty())
+    // Each subpath polygon is implicitly closed
+    const QList<QPolygonF> polygons = path.toSubpathPolygons();
+    const QPointF offset = m_rect.topLeft();
+    for (const QPolygonF& polygon : polygons)
     {
-        return sampleByScanLine(point);
-    }
-
-    const qreal coordX1 = point.x();
-    const qreal coordX2 = coordX1 + 1.0;
-    const qreal coordY1 = point.y();
-    const qreal coordY2 = coordY1 + 1.0;
-
-    const qreal centerX = (coordX1 + coordX2) * 0.5;
-    const qreal centerY = (coordY1 + coordY2) * 0.5;
-
-    const QPointF topLeft(coordX1, coordY1);
-    const QPointF topRight(coordX2, coordY1);
-    const QPointF bottomLeft(coordX1, coordY2);
-    const QPointF bottomRight(coordX2, coordY2);
+        if (polygon.size() < 2)
+        {
+            continue;
+        }
 
-    if (m_samplesCount <= 1)
-    {
-        // Jakub Melka: Just one sample
-        if (m_precise)
+        for (qsizetype i = 1; i < polygon.size(); ++i)
         {
-            return m_path.contains(QPointF(centerX, centerY)) ? 1.0f : 0.0f;
+            addEdge(polygon[i - 1] - offset, polygon[i] - offset);
         }
-        else
+
+        if (polygon.front() != polygon.back())
         {
-            return m_fillPolygon.contains(QPointF(centerX, centerY)) ? 1.0f : 0.0f;
+            addEdge(polygon.back() - offset, polygon.front() - offset);
         }
     }
 
-    int cornerHits = 0;
-    Qt::FillRule fillRule = m_path.fillRule();
+    std::sort(m_edges.begin(), m_edges.end(), [](const Edge& l, const Edge& r) { return l.p1.y() < r.p1.y(); });
 
-    if (m_precise)
-    {
-        cornerHits += m_path.contains(topLeft) ? 1 : 0;
-        cornerHits += m_path.contains(topRight) ? 1 : 0;
-        cornerHits += m_path.contains(bottomLeft) ? 1 : 0;
-        cornerHits += m_path.contains(bottomRight) ? 1 : 0;
-    }
-    else
-    {
-        cornerHits += m_fillPolygon.containsPoint(topLeft, fillRule) ? 1 : 0;
-        cornerHits += m_fillPolygon.containsPoint(topRight, fillRule) ? 1 : 0;
-        cornerHits += m_fillPolygon.containsPoint(bottomLeft, fillRule) ? 1 : 0;
-        cornerHits += m_fillPolygon.containsPoint(bottomRight, fillRule) ? 1 : 0;
-    }
+    const int width = m_rect.width();
+    const int height = m_rect.height();
+    m_rowSpanStart.reserve(height + 1);
 
-    if (cornerHits == 4)
-    {
-        // Completely inside
-        return 1.0;
-    }
+    // Buffer has two additional cells, because edge at the right
+    // border of the rectangle accumulates area behind the border.
+    const size_t rowBufferSize = width + 2;
+    std::vector<PDFReal> buffer(rowBufferSize * BAND_HEIGHT, 0.0);
+    std::vector<const Edge*> activeEdges;
+    auto edgeIt = m_edges.cbegin();
 
-    if (cornerHits == 0)
+    for (int bandTop = 0; bandTop < height; bandTop += BAND_HEIGHT)
     {
-        // Completely outside
-        return 0.0;
-    }
+        const int bandBottom = qMin(bandTop + BAND_HEIGHT, height);
 
-    // Otherwise we must use regular sample grid
-    const qreal offset = 1.0f / PDFColorComponent(m_samplesCount + 1);
-    PDFColorComponent sampleValue = 0.0f;
-    const PDFColorComponent sampleGain = 1.0f / PDFColorComponent(m_samplesCount * m_samplesCount);
-    for (int ix = 0; ix < m_samplesCount; ++ix)
-    {
-        const qreal x = offset * (ix + 1) + coordX1;
+        // Update active edges - remove edges above the band, add edges starting in the band
+        activeEdges.erase(std::remove_if(activeEdges.begin(), activeEdges.end(), [bandTop](const Edge* edge) { return edge->p2.y() <= bandTop; }), activeEdges.end());
+        for (; edgeIt != m_edges.cend() && edgeIt->p1.y() < bandBottom; ++edgeIt)
+        {
+            if (edgeIt->p2.y() > bandTop)
+            {
+                activeEdges.push_back(&*edgeIt);
+            }
+        }
 
-        for (int iy = 0; iy < m_samplesCount; ++iy)
+        for (const Edge* edge : activeEdges)
         {
-            const qreal y = offset * (iy + 1) + coordY1;
+            accumulateEdge(*edge, bandTop, bandBottom, buffer);
+        }
+
+        // Accumulate signed areas and create coverage spans
+        for (int row = bandTop; row < bandBottom; ++row)
+        {
+            m_rowSpanStart.push_back(m_spans.size());
 
-            if (m_precise)
+            PDFReal* rowBuffer = buffer.data() + (row - bandTop) * rowBufferSize;
+            PDFReal accumulator = 0.0;
+            for (int i = 0; i < width; ++i)
             {
-                if (m_path.contains(QPointF(x, y)))
+                accumulator += rowBuffer[i];
+
+                PDFReal coverage = std::abs(accumulator);
+                if (m_fillRule == Qt::WindingFill)
                 {
-                    sampleValue += sampleGain;
+                    coverage = qMin(coverage, 1.0);
                 }
-            }
-            else
-            {
-                if (m_fillPolygon.containsPoint(QPointF(x, y), fillRule))
+                else
+                {
+                    coverage = std::fmod(coverage, 2.0);
+                    if (coverage > 1.0)
+                    {
+                        coverage = 2.0 - coverage;
+                    }
+                }
+
+                // Very small differences are just rounding errors of accumulation
+                const PDFColorComponent spanCoverage = PDFColorComponent(coverage);
+                if (i == 0 || std::abs(m_spans.back().coverage - spanCoverage) > COVERAGE_EPSILON)
                 {
-                    sampleValue += sampleGain;
+                    m_spans.push_back(Span{ m_rect.left() + i, spanCoverage });
                 }
             }
+
+            std::fill(rowBuffer, rowBuffer + rowBufferSize, 0.0);
         }
     }
 
-    return sampleValue;
+    m_rowSpanStart.push_back(m_spans.size());
+    m_edges.clear();
+    m_edges.shrink_to_fit();
 }
 
-PDFColorComponent PDFPainterPathSampler::sampleByScanLine(QPoint point) const
+PDFColorComponent PDFPathCoverageRasterizer::getCoverage(QPoint point) const
 {
-    int scanLinePosition = point.y() - m_fillRect.y();
-
-    size_t scanLineCountPerPixel = getScanLineCountPerPixel();
-    size_t scanLineTopRow = scanLinePosition * scanLineCountPerPixel;
-    size_t scanLineBottomRow = scanLineTopRow + scanLineCountPerPixel - 1;
-    size_t scanLineGridRowTop = scanLineTopRow + 1;
+    if (!m_rect.contains(point))
+    {
+        return 0.0f;
+    }
 
-    Qt::FillRule fillRule = m_path.fillRule();
+    const size_t row = point.y() - m_rect.top();
+    auto it = std::next(m_spans.cbegin(), m_rowSpanStart[row]);
+    auto itEnd = std::next(m_spans.cbegin(), m_rowSpanStart[row + 1]);
 
-    auto performSampling = [&](size_t scanLineIndex, PDFReal firstOrdinate, int sampleCount, PDFReal step, PDFReal gain)
+    auto spanIt = std::upper_bound(it, itEnd, point.x(), [](int x, const Span& span) { return x < span.x; });
+    if (spanIt == it)
     {
-        ScanLineInfo info = m_scanLineInfo[scanLineIndex];
-        auto it = std::next(m_scanLineSamples.cbegin(), info.indexStart);
+        return 0.0f;
+    }
 
-        PDFReal ordinate = firstOrdinate;
-        PDFColorComponent value = 0.0;
-        auto ordinateIt = it;
-        for (int i = 0; i < sampleCount; ++i)
-        {
-            while (std::next(ordinateIt)->x < ordinate)
-            {
-                ++ordinateIt;
-            }
+    return std::prev(spanIt)->coverage;
+}
 
-            int windingNumber = ordinateIt->windingNumber;
+void PDFPathCoverageRasterizer::addEdge(QPointF p1, QPointF p2)
+{
+    if (p1.y() == p2.y())
+    {
+        // Horizontal edges don't contribute to coverage
+        return;
+    }
 
-            const bool inside = (fillRule == Qt::WindingFill) ? windingNumber != 0 : windingNumber % 2 != 0;
-            if (inside)
-            {
-                value += gain;
-            }
+    // Split edge at the left and right border of the rectangle
+    const PDFReal width = m_rect.width();
+    const PDFReal minX = qMin(p1.x(), p2.x());
+    const PDFReal maxX = qMax(p1.x(), p2.x());
 
-            ordinate += step;
+    for (const PDFReal border : { 0.0, width })
+    {
+        if (minX < border && border < maxX)
+        {
+            const PDFReal y = interpolate(border, p1.x(), p2.x(), p1.y(), p2.y());
+            const QPointF splitPoint(border, y);
+            addEdge(p1, splitPoint);
+            addEdge(splitPoint, p2);
+            return;
         }
+    }
 
-        return value;
-    };
+    addClampedEdge(p1, p2);
+}
 
-    const qreal coordX1 = point.x();
-    const PDFReal cornerValue = performSampling(scanLineTopRow, coordX1, 2, 1.0, 1.0) + performSampling(scanLineBottomRow, coordX1, 2, 1.0, 1.0);
+void PDFPathCoverageRasterizer::addClampedEdge(QPointF p1, QPointF p2)
+{
+    const PDFReal width = m_rect.width();
+    const PDFReal height = m_rect.height();
 
-    if (qFuzzyIsNull(4.0 - cornerValue))
-    {
-        // Whole inside
-        return 1.0;
-    }
+    Edge edge;
+    edge.p1 = p1;
+    edge.p2 = p2;
 
-    if (qFuzzyIsNull(cornerValue))
+    if (edge.p1.y() > edge.p2.y())
     {
-        // Whole outside
-        return 0.0;
+        std::swap(edge.p1, edge.p2);
+        edge.direction = -1.0;
     }
 
-    const qreal offset = 1.0f / PDFColorComponent(m_samplesCount + 1);
-    PDFColorComponent sampleValue = 0.0f;
-    const PDFColorComponent sampleGain = 1.0f / PDFColorComponent(m_samplesCount * m_samplesCount);
-
-    for (int i = 0; i < m_samplesCount; ++i)
+    if (edge.p1.y() >= height || edge.p2.y() <= 0.0)
     {
-        sampleValue += performSampling(scanLineGridRowTop++, coordX1 + offset, m_samplesCount, offset, sampleGain);
+        // Edge is outside of the rectangle
+        return;
     }
 
-    return sampleValue;
-}
+    // Parts outside of the rectangle affect coverage of the rectangle
+    // in the same way, as if they were projected to its border.
+    edge.p1.setX(qBound(0.0, edge.p1.x(), width));
+    edge.p2.setX(qBound(0.0, edge.p2.x(), width));
 
-size_t PDFPainterPathSampler::getScanLineCountPerPixel() const
-{
-    return m_samplesCount + 2;
+    m_edges.push_back(edge);
 }
 
-void PDFPainterPathSampler::prepareScanLines()
+void PDFPathCoverageRasterizer::accumulateEdge(const Edge& edge, int bandTop, int bandBottom, std::vector<PDFReal>& buffer) const
 {
-    if (m_fillPolygon.isEmpty())
-    {
-        return;
-    }
+    const size_t rowBufferSize = m_rect.width() + 2;
+    const PDFReal y1 = edge.p1.y();
+    const PDFReal y2 = edge.p2.y();
+    const PDFReal dxdy = (edge.p2.x() - edge.p1.x()) / (y2 - y1);
 
-    for (int yOffset = m_fillRect.top(); yOffset <= m_fillRect.bottom(); ++yOffset)
+    const int firstRow = qMax(int(std::floor(y1)), bandTop);
+    const int lastRow = qMin(int(std::ceil(y2)), bandBottom);
+
+    for (int row = firstRow; row < lastRow; ++row)
     {
-        const qreal coordY1 = yOffset;
-        const qreal coordY2 = coordY1 + 1.0;
+        const PDFReal rowY1 = qMax(PDFReal(row), y1);
+        const PDFReal rowY2 = qMin(PDFReal(row + 1), y2);
+        const PDFReal dy = rowY2 - rowY1;
 
-        // Top pixel line
-        if (m_scanLineInfo.empty())
-        {
-            m_scanLineInfo.emplace_back(createScanLine(coordY1));
-        }
-        else
+        if (dy <= 0.0)
         {
-            m_scanLineInfo.emplace_back(m_scanLineInfo.back());
+            continue;
         }
 
-        // Sample grid
-        const qreal offset = 1.0f / PDFColorComponent(m_samplesCount + 1);
-        for (int iy = 0; iy < m_samplesCount; ++iy)
+        PDFReal* rowBuffer = buffer.data() + (row - bandTop) * rowBufferSize;
+        const PDFReal xStart = edge.p1.x() + (rowY1 - y1) * dxdy;
+        const PDFReal xEnd = edge.p1.x() + (rowY2 - y1) * dxdy;
+        const PDFReal d = dy * edge.direction;
+
+        const PDFReal x0 = qMin(xStart, xEnd);
+        const PDFReal x1 = qMax(xStart, xEnd);
+        const PDFReal x0Floor = std::floor(x0);
+        const PDFReal x1Ceil = std::ceil(x1);
+        const int x0i = int(x0Floor);
+        const int x1i = int(x1Ceil);
+
+        if (x1i <= x0i + 1)
         {
-            const qreal y = offset * (iy + 1) + coordY1;
-            m_scanLineInfo.emplace_back(createScanLine(y));
+            // Edge is inside one pixel column, area right to the edge
+            // in this pixel is covered, next pixels are covered fully.
+            const PDFReal xmf = 0.5 * (xStart + xEnd) - x0Floor;
+            rowBuffer[x0i] += d - d * xmf;
+            rowBuffer[x0i + 1] += d * xmf;
         }
+        else
+        {
+            // Edge crosses multiple pixel columns, area is distributed
+            // among them (trapezoids in between and triangles at ends).
+            const PDFReal s = 1.0 / (x1 - x0);
+            const PDFReal x0f = x0 - x0Floor;
+            const PDFReal a0 = 0.5 * s * (1.0 - x0f) * (1.0 - x0f);
+            const PDFReal x1f = x1 - x1Ceil + 1.0;
+            const PDFReal am = 0.5 * s * x1f * x1f;
+
+            rowBuffer[x0i] += d * a0;
+
+            if (x1i == x0i + 2)
+            {
+                rowBuffer[x0i + 1] += d * (1.0 - a0 - am);
+            }
+            else
+            {
+                const PDFReal a1 = s * (1.5 - x0f);
+                rowBuffer[x0i + 1] += d * (a1 - a0);
+
+                for (int xi = x0i + 2; xi < x1i - 1; ++xi)
+                {
+                    rowBuffer[xi] += d * s;
+                }
 
-        // Bottom pixel line
-        m_scanLineInfo.emplace_back(createScanLine(coordY2));
+                const PDFReal a2 = a1 + (x1i - x0i - 3) * s;
+                rowBuffer[x1i - 1] += d * (1.0 - a2 - am);
+            }
+
+            rowBuffer[x1i] += d * am;
+        }
     }
 }
 
-PDFPainterPathSampler::ScanLineInfo PDFPainterPathSampler::createScanLine(qreal y)
+PDFPainterPathSampler::PDFPainterPathSampler(QPainterPath path, int samplesCount, PDFColorComponent defaultShape, QRect fillRect, bool precise) :
+    m_defaultShape(defaultShape),
+    m_samplesCount(qMax(samplesCount, 1)),
+    m_path(qMove(path)),
+    m_fillRect(fillRect),
+    m_precise(precise)
 {
-    ScanLineInfo result;
-    result.indexStart = m_scanLineSamples.size();
-
-    // Add start item
-    m_scanLineSamples.emplace_back(-std::numeric_limits<PDFReal>::infinity(), 0);
-
-    // Traverse polygon, add sample for each polygon line, we must
-    // also implicitly close last edge (if polygon is not closed)
-    for (int i = 1; i < m_fillPolygon.size(); ++i)
+    if (!precise && !m_path.isEmpty())
     {
-        createScanLineSample(m_fillPolygon[i - 1], m_fillPolygon[i], y);
+        m_coverage.emplace(m_path, m_fillRect);
     }
+}
 
-    if (m_fillPolygon.front() != m_fillPolygon.back())
+PDFColorComponent PDFPainterPathSampler::sample(QPoint point) const
+{
+    if (m_path.isEmpty() || !m_fillRect.contains(point))
     {
-        createScanLineSample(m_fillPolygon.back(), m_fillPolygon.front(), y);
+        return m_defaultShape;
     }
 
-    // Add end item
-    m_scanLineSamples.emplace_back(+std::numeric_limits<PDFReal>::infinity(), 0);
+    if (m_coverage)
+    {
+        const PDFColorComponent coverage = m_coverage->getCoverage(point);
+        if (m_samplesCount <= 1)
+        {
+            // Just one sample - antialiasing is turned off
+            return coverage >= 0.5f ? 1.0f : 0.0f;
+        }
+
+        return coverage;
+    }
 
-    result.indexEnd = m_scanLineSamples.size();
+    const qreal coordX1 = point.x();
+    const qreal coordX2 = coordX1 + 1.0;
+    const qreal coordY1 = point.y();
+    const qreal coordY2 = coordY1 + 1.0;
 
-    auto it = std::next(m_scanLineSamples.begin(), result.indexStart);
-    auto itEnd = std::next(m_scanLineSamples.begin(), result.indexEnd);
+    const qreal centerX = (coordX1 + coordX2) * 0.5;
+    const qreal centerY = (coordY1 + coordY2) * 0.5;
 
-    // Jakub Melka: now, sort the line samples and compute properly the winding number
-    std::sort(it, itEnd);
+    const QPointF topLeft(coordX1, coordY1);
+    const QPointF topRight(coordX2, coordY1);
+    const QPointF bottomLeft(coordX1, coordY2);
+    const QPointF bottomRight(coordX2, coordY2);
 
-    int currentWindingNumber = 0;
-    for (; it != itEnd; ++it)
+    if (m_samplesCount <= 1)
     {
-        currentWindingNumber += it->windingNumber;
-        it->windingNumber = currentWindingNumber;
+        // Just one sample
+        return m_path.contains(QPointF(centerX, centerY)) ? 1.0f : 0.0f;
     }
 
-    return result;
-}
-
-void PDFPainterPathSampler::createScanLineSample(const QPointF& p1, const QPointF& p2, qreal y)
-{
-    PDFReal y1 = p1.y();
-    PDFReal y2 = p2.y();
+    int cornerHits = 0;
+    cornerHits += m_path.contains(topLeft) ? 1 : 0;
+    cornerHits += m_path.contains(topRight) ? 1 : 0;
+    cornerHits += m_path.contains(bottomLeft) ? 1 : 0;
+    cornerHits += m_path.contains(bottomRight) ? 1 : 0;
 
-    if (qFuzzyIsNull(y2 - y1))
+    if (cornerHits == 4)
     {
-        // Ignore horizontal lines
-        return;
+        // Completely inside
+        return 1.0;
     }
 
-    PDFReal x1 = p1.x();
-    PDFReal x2 = p2.x();
-
-    int windingNumber = 1;
-    if (y2 < y1)
+    if (cornerHits == 0)
     {
-        std::swap(y1, y2);
-        std::swap(x1, x2);
-        windingNumber = -1;
+        // Completely outside
+        return 0.0;
     }
 
-    // Do we have intercept?
-    if (y1 <= y && y < y2)
+    // Otherwise we must use regular sample grid
+    const qreal offset = 1.0f / PDFColorComponent(m_samplesCount + 1);
+    PDFColorComponent sampleValue = 0.0f;
+    const PDFColorComponent sampleGain = 1.0f / PDFColorComponent(m_samplesCount * m_samplesCount);
+    for (int ix = 0; ix < m_samplesCount; ++ix)
     {
-        const PDFReal x = interpolate(y, y1, y2, x1, x2);
-        m_scanLineSamples.emplace_back(x, windingNumber);
+        const qreal x = offset * (ix + 1) + coordX1;
+
+        for (int iy = 0; iy < m_samplesCount; ++iy)
+        {
+            const qreal y = offset * (iy + 1) + coordY1;
+
+            if (m_path.contains(QPointF(x, y)))
+            {
+                sampleValue += sampleGain;
+            }
+        }
     }
+
+    return sampleValue;
 }
 
 void PDFDrawBuffer::clear()
@@ -3895,7 +4290,13 @@ void PDFInkCoverageCalculator::perform(QSize size, const std::vector<PDFInteger>
         m_progress->start(pages.size(), ProgressStartupInfo());
     }
 
-    auto calculatePageCoverage = [this, size](PDFInteger pageIndex)
+    // Memory limit is divided into units of one megabyte, each page
+    // acquires units of its estimated bitmap memory before rendering.
+    const qint64 memoryUnitSize = 1024 * 1024;
+    const int memoryUnits = (m_memoryLimit > 0) ? int(qBound<qint64>(1, m_memoryLimit / memoryUnitSize, std::numeric_limits<int>::max())) : 0;
+    QSemaphore memorySemaphore(memoryUnits);
+
+    auto calculatePageCoverage = [this, size, memoryUnits, memoryUnitSize, &memorySemaphore](PDFInteger pageIndex)
     {
         if (pageIndex >= PDFInteger(m_document->getCatalog()->getPageCount()))
         {
@@ -3908,6 +4309,9 @@ void PDFInkCoverageCalculator::perform(QSize size, const std::vector<PDFInteger>
             return;
         }
 
+        QElapsedTimer pageTimer;
+        pageTimer.start();
+
         QRectF pageRect = page->getRotatedMediaBox();
         QSizeF pageSize = pageRect.size();
         pageSize.scale(size.width(), size.height(), Qt::KeepAspectRatio);
@@ -3929,38 +4333,96 @@ void PDFInkCoverageCalculator::perform(QSize size, const std::vector<PDFInteger>
         settings.flags.setFlag(PDFTransparencyRendererSettings::ActiveColorMask, false);
         settings.flags.setFlag(PDFTransparencyRendererSettings::SeparationSimulation, true);
         settings.activeColorMask = PDFPixelFormat::getAllColorsMask();
+        settings.storagePrecision = m_settings.storagePrecision;
+
+        // Page is rendered in horizontal bands, so only bitmaps of the band
+        // are allocated. Each band is rendered using its own renderer.
+        const int bandHeight = (m_settings.bandHeight > 0) ? qMin(m_settings.bandHeight, imageSize.height()) : imageSize.height();
+        const int bandCount = (imageSize.height() + bandHeight - 1) / bandHeight;
 
+        int pageMemoryUnits = 0;
+        if (memoryUnits > 0)
+        {
+            const qint64 memoryEstimate = getBitmapMemoryEstimate(QSize(imageSize.width(), bandHeight));
+            pageMemoryUnits = int(qBound<qint64>(1, (memoryEstimate + memoryUnitSize - 1) / memoryUnitSize, memoryUnits));
+            memorySemaphore.acquire(pageMemoryUnits);
+            pageTimer.restart();
+        }
+        QSemaphoreReleaser memoryReleaser(pageMemoryUnits > 0 ? &memorySemaphore : nullptr, pageMemoryUnits);
+
+        struct BandCoverage
+        {
+            PDFPixelFormat pixelFormat;
+            std::vector<PDFColorComponent> coverage;
+        };
+
+        std::vector<BandCoverage> bandCoverages(bandCount);
         QTransform pagePointToDevicePoint = pdf::PDFRenderer::createPagePointToDevicePointMatrix(page, QRect(QPoint(0, 0), imageSize));
         pdf::PDFCMSPointer cms = m_cmsManager->getCurrentCMS();
-        pdf::PDFTransparencyRenderer renderer(page, m_document, m_fontCache, cms.data(), m_optionalContentActivity,
-                                              m_inkMapper, settings, pagePointToDevicePoint);
 
-        renderer.beginPaint(imageSize);
-        renderer.processContents();
-        renderer.endPaint();
+        auto calculateBandCoverage = [&](int bandIndex)
+        {
+            const int bandTop = bandIndex * bandHeight;
+            const QSize bandSize(imageSize.width(), qMin(bandHeight, imageSize.height() - bandTop));
+            const QTransform bandPagePointToDevicePoint = pagePointToDevicePoint * QTransform::fromTranslate(0, -bandTop);
+
+            pdf::PDFTransparencyRenderer renderer(page, m_document, m_fontCache, cms.data(), m_optionalContentActivity,
+                                                  m_inkMapper, settings, bandPagePointToDevicePoint);
+
+            renderer.beginPaint(bandSize);
+            renderer.processContents();
+            renderer.endPaint();
+
+            PDFFloatBitmapWithColorSpace originalProcessImage = renderer.getOriginalProcessBitmap();
+            const PDFPixelFormat pixelFormat = originalProcessImage.getPixelFormat();
+            const uint8_t colorChannelCount = pixelFormat.getColorChannelCount();
+
+            BandCoverage& bandCoverage = bandCoverages[bandIndex];
+            bandCoverage.pixelFormat = pixelFormat;
+            bandCoverage.coverage.resize(colorChannelCount, 0.0f);
+
+            std::vector<PDFColorComponent> pixel(originalProcessImage.getPixelSize(), 0.0f);
+            const pdf::PDFColorBuffer buffer(pixel.data(), pixel.size());
+
+            for (size_t y = 0; y < originalProcessImage.getHeight(); ++y)
+            {
+                for (size_t x = 0; x < originalProcessImage.getWidth(); ++x)
+                {
+                    originalProcessImage.readPixel(x, y, buffer);
+                    const pdf::PDFColorComponent alpha = pixelFormat.hasOpacityChannel() ? buffer[pixelFormat.getOpacityChannelIndex()] : 1.0f;
+
+                    for (uint8_t i = 0; i < colorChannelCount; ++i)
+                    {
+                        bandCoverage.coverage[i] += buffer[i] * alpha;
+                    }
+                }
+            }
+        };
+
+        // Bands are processed sequentially, pages are processed in parallel, so number of
+        // resident bands is bounded by the number of page threads. Renderer itself
+        // uses content scope parallelization, so we can't use it for the bands.
+        for (int bandIndex = 0; bandIndex < bandCount; ++bandIndex)
+        {
+            calculateBandCoverage(bandIndex);
+        }
 
-        PDFFloatBitmapWithColorSpace originalProcessImage = renderer.getOriginalProcessBitmap();
         QSizeF pageSizeMM = page->getRotatedMediaBoxMM().size();
 
-        pdf::PDFPixelFormat pixelFormat = originalProcessImage.getPixelFormat();
+        const pdf::PDFPixelFormat pixelFormat = bandCoverages.front().pixelFormat;
         pdf::PDFColorComponent totalArea = pageSizeMM.width() * pageSizeMM.height();
-        pdf::PDFColorComponent pixelArea = totalArea / pdf::PDFColorComponent(originalProcessImage.getWidth() * originalProcessImage.getHeight());
+        pdf::PDFColorComponent pixelArea = totalArea / pdf::PDFColorComponent(imageSize.width() * imageSize.height());
 
         std::vector<PDFColorComponent> pageCoverage;
         const uint8_t colorChannelCount = pixelFormat.getColorChannelCount();
         pageCoverage.resize(colorChannelCount, 0.0f);
 
-        for (size_t y = 0; y < originalProcessImage.getHeight(); ++y)
+        for (const BandCoverage& bandCoverage : bandCoverages)
         {
-            for (size_t x = 0; x < originalProcessImage.getWidth(); ++x)
+            Q_ASSERT(bandCoverage.pixelFormat == pixelFormat);
+            for (uint8_t i = 0; i < colorChannelCount; ++i)
             {
-                const pdf::PDFColorBuffer buffer = originalProcessImage.getPixel(x, y);
-                const pdf::PDFColorComponent alpha = pixelFormat.hasOpacityChannel() ? buffer[pixelFormat.getOpacityChannelIndex()] : 1.0f;
-
-                for (uint8_t i = 0; i < colorChannelCount; ++i)
-                {
-                    pageCoverage[i] += buffer[i] * alpha;
-                }
+                pageCoverage[i] += bandCoverage.coverage[i];
             }
         }
 
@@ -3998,6 +4460,7 @@ void PDFInkCoverageCalculator::perform(QSize size, const std::vector<PDFInteger>
 
         QMutexLocker lock(&m_mutex);
         m_inkCoverageResults[pageIndex] = qMove(results);
+        m_pageTimes[pageIndex] = pageTimer.elapsed();
     };
 
     PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, pages.begin(), pages.end(), calculatePageCoverage);
@@ -4012,6 +4475,7 @@ void PDFInkCoverageCalculator::clear()
 {
     QMutexLocker lock(&m_mutex);
     m_inkCoverageResults.clear();
+    m_pageTimes.clear();
 }
 
 const std::vector<PDFInkCoverageCalculator::InkCoverageChannelInfo>* PDFInkCoverageCalculator::getInkCoverage(PDFInteger pageIndex) const
@@ -4026,6 +4490,22 @@ const std::vector<PDFInkCoverageCalculator::InkCoverageChannelInfo>* PDFInkCover
     return &dummy;
 }
 
+qint64 PDFInkCoverageCalculator::getBitmapMemoryEstimate(QSize imageSize) const
+{
+    // Bitmaps contain process colors (at most four), active spot colors, shape
+    // and opacity channels. Painted bitmap, its backdrop and original process
+    // image are allocated at once.
+    constexpr qint64 bitmapCount = 3;
+    const qint64 channelCount = 4 + qint64(m_inkMapper->getActiveSpotColorCount()) + 2;
+    return qint64(imageSize.width()) * qint64(imageSize.height()) * channelCount * qint64(sizeof(PDFColorComponent)) * bitmapCount;
+}
+
+qint64 PDFInkCoverageCalculator::getPageTime(PDFInteger pageIndex) const
+{
+    auto it = m_pageTimes.find(pageIndex);
+    return it != m_pageTimes.end() ? it->second : -1;
+}
+
 const PDFInkCoverageCalculator::InkCoverageChannelInfo* PDFInkCoverageCalculator::findCoverageInfoByName(const std::vector<PDFInkCoverageCalculator::InkCoverageChannelInfo>& infos,
                                                                                                          const QByteArray& name)
 {
@@ -32,6 +32,8 @@
 
 #include <QImage>
 
+#include <optional>
+
 namespace pdf
 {
 
@@ -141,10 +143,21 @@ private:
 };
 
 /// Represents float bitmap with arbitrary color channel count. Bitmap can also
-/// have auxiliary channels, such as shape and opacity channels.
+/// have auxiliary channels, such as shape and opacity channels. Bitmap can be
+/// stored in reduced precision to save memory. Reduced precision bitmap can only
+/// be read using \p readPixel, \p getPixelInkCoverage and \p getChannelImage;
+/// it must be converted back to full precision before painting or blending.
 class PDF4QTLIBCORESHARED_EXPORT PDFFloatBitmap
 {
 public:
+
+    enum class Precision : uint8_t
+    {
+        Float32,    ///< 32-bit floating point values
+        UNorm16,    ///< 16-bit fixed point values in range [0, 1]
+        UNorm8,     ///< 8-bit fixed point values in range [0, 1]
+    };
+
     explicit PDFFloatBitmap();
     explicit PDFFloatBitmap(size_t width, size_t height, PDFPixelFormat format);
 
@@ -170,6 +183,16 @@ public:
     /// which consists of ink coverage.
     PDFFloatBitmap getInkCoverageBitmap() const;
 
+    /// Returns ink coverage of all pixels, pixels are ordered row by row.
+    /// Works with any precision, and it is much faster than calling
+    /// \p getPixelInkCoverage for each pixel.
+    std::vector<PDFColorComponent> getInkCoverageValues() const;
+
+    /// Returns sums of color channel values over all pixels. Values are
+    /// weighted by pixel opacity, if bitmap has opacity channel. Works
+    /// with any precision.
+    std::vector<PDFColorComponent> getColorChannelSums() const;
+
     const PDFColorComponent* begin() const;
     const PDFColorComponent* end() const;
 
@@ -180,6 +203,20 @@ public:
     size_t getHeight() const { return m_height; }
     size_t getPixelSize() const { return m_pixelSize; }
     PDFPixelFormat getPixelFormat() const { return m_format; }
+    Precision getPrecision() const { return m_precision; }
+    bool isFullPrecision() const { return m_precision == Precision::Float32; }
+
+    /// Converts bitmap data to given precision. Values are clamped
+    /// to range [0, 1], if reduced precision is used. Conversion from reduced
+    /// precision to full precision doesn't restore the lost precision.
+    /// \param precision Precision
+    void setPrecision(Precision precision);
+
+    /// Reads pixel channels, works with any precision
+    /// \param x Horizontal coordinate of the pixel
+    /// \param y Vertical coordinate of the pixel
+    /// \param pixel Buffer for pixel channels (must have pixel size)
+    void readPixel(size_t x, size_t y, PDFColorBuffer pixel) const;
 
     /// Fills both shape and opacity channel with zero value.
     /// If bitmap doesn't have shape/opacity channel, nothing happens.
@@ -309,17 +346,29 @@ public:
     void fillProcessColorChannels(PDFColorComponent value);
     void fillChannel(size_t channel, PDFColorComponent value);
 
+    /// Fills color channels, which are not active in the active color mask,
+    /// with value corresponding to no ink (0.0 for subtractive colors,
+    /// 1.0 for additive colors). Bitmap must be in full precision.
+    /// \param activeColorMask Active color mask
+    void clearInactiveColors(uint32_t activeColorMask);
+
     /// Creates opaque soft mask of given size
     /// \param width Width
     /// \param height Height
     static PDFFloatBitmap createOpaqueSoftMask(size_t width, size_t height);
 
 private:
+    /// Returns value of channel at given index in the data block (works with any precision)
+    PDFColorComponent getValue(size_t index) const;
+
     PDFPixelFormat m_format;
     std::size_t m_width;
     std::size_t m_height;
     std::size_t m_pixelSize;
+    Precision m_precision = Precision::Float32;
     std::vector<PDFColorComponent> m_data;
+    std::vector<uint16_t> m_dataUNorm16;
+    std::vector<uint8_t> m_dataUNorm8;
     std::vector<uint32_t> m_activeColorMask;
 };
 
@@ -457,20 +506,83 @@ private:
     size_t m_activeSpotColors = 0;
 };
 
-/// Painter path sampler. Returns shape value of pixel. This sampler
-/// uses MSAA with regular grid.
+/// Analytic coverage rasterizer. Computes exact area coverage of pixels
+/// by the filled polygon in one pass over its edges, by accumulation
+/// of signed areas (as font rasterizers do). Coverage is stored as spans
+/// of pixels with the same coverage value for each row of the rectangle.
+/// Overlapping parts of the path are resolved by the fill rule from the
+/// accumulated signed area (winding), which is exact for non-overlapping
+/// edges inside a pixel.
+class PDF4QTLIBCORESHARED_EXPORT PDFPathCoverageRasterizer
+{
+public:
+    /// Creates coverage of the path in the given rectangle
+    /// \param path Rasterized path
+    /// \param rect Rectangle, in which coverage is computed
+    explicit PDFPathCoverageRasterizer(const QPainterPath& path, QRect rect);
+
+    /// Returns coverage of the pixel (in range [0, 1]). Pixels
+    /// outside of the rectangle have zero coverage.
+    PDFColorComponent getCoverage(QPoint point) const;
+
+    /// Returns count of spans for all rows
+    size_t getSpanCount() const { return m_spans.size(); }
+
+private:
+    /// Number of rows rasterized at once
+    static constexpr int BAND_HEIGHT = 32;
+
+    /// Coverage differences below this value are not creating new spans
+    static constexpr PDFColorComponent COVERAGE_EPSILON = 1e-5f;
+
+    struct Edge
+    {
+        QPointF p1; ///< Top point (in rectangle coordinates)
+        QPointF p2; ///< Bottom point (in rectangle coordinates)
+        PDFReal direction = 1.0;
+    };
+
+    struct Span
+    {
+        int x = 0; ///< Pixels from x to x of next span have the same coverage
+        PDFColorComponent coverage = 0.0f;
+    };
+
+    /// Adds edge of the polygon, edge is split at left and right border
+    /// of the rectangle and parts outside are projected to the border.
+    void addEdge(QPointF p1, QPointF p2);
+
+    /// Adds edge, which doesn't cross left and right border of the rectangle
+    void addClampedEdge(QPointF p1, QPointF p2);
+
+    /// Accumulates signed area of the edge into rows of the band
+    /// \param edge Edge
+    /// \param bandTop First row of the band
+    /// \param bandBottom Row after the last row of the band
+    /// \param buffer Accumulation buffer of the band
+    void accumulateEdge(const Edge& edge, int bandTop, int bandBottom, std::vector<PDFReal>& buffer) const;
+
+    QRect m_rect;
+    Qt::FillRule m_fillRule = Qt::WindingFill;
+    std::vector<Edge> m_edges;
+    std::vector<Span> m_spans;
+    std::vector<size_t> m_rowSpanStart;
+};
+
+/// Painter path sampler. Returns shape value of pixel. Precise sampler
+/// uses MSAA with regular grid, otherwise analytic coverage is used.
 class PDFPainterPathSampler
 {
 public:
     /// Creates new painter path sampler, using given painter path,
     /// sample count (in one direction) and default shape used, when painter path is empty.
-    /// Fill rectangle is used to precompute winding numbers for samples. Points outside
+    /// Fill rectangle is used to precompute coverage of pixels. Points outside
     /// of fill rectangle are considered as outside and defaultShape is returned.
     /// \param path Sampled path
     /// \param samplesCount Samples count in one direction
     /// \param defaultShape Default shape returned, if path is empty
     /// \param fillRect Fill rectangle (sample point must be in this rectangle)
-    /// \param precise Use precise painter path computation
+    /// \param precise Use precise painter path computation (regular sample grid)
     PDFPainterPathSampler(QPainterPath path,
                           int samplesCount,
                           PDFColorComponent defaultShape,
@@ -481,57 +593,11 @@ public:
     PDFColorComponent sample(QPoint point) const;
 
 private:
-    struct ScanLineSample
-    {
-        inline constexpr ScanLineSample() = default;
-        inline constexpr ScanLineSample(PDFReal x, int windingNumber) :
-            x(x),
-            windingNumber(windingNumber)
-        {
-
-        }
-
-        bool operator<(const ScanLineSample& other) const { return x < other.x; }
-        bool operator<(PDFReal ordinate) const { return x < ordinate; }
-
-        PDFReal x = 0.0;
-        int windingNumber = 0;
-    };
-
-    struct ScanLineInfo
-    {
-        size_t indexStart = 0;
-        size_t indexEnd = 0;
-    };
-
-    /// Compute sample by using scan lines
-    PDFColorComponent sampleByScanLine(QPoint point) const;
-
-    /// Returns number of scan lines per pixel
-    size_t getScanLineCountPerPixel() const;
-
-    /// Creates scan lines using fill rectangle
-    void prepareScanLines();
-
-    /// Creates scan line for given y coordinate and
-    /// returns info about this scan line
-    /// \param y Vertical coordinate of the sample line
-    ScanLineInfo createScanLine(qreal y);
-
-    /// Creates scan line sample (if horizontal line of y coordinate
-    /// is intersecting boundary line segment p1-p2.
-    /// \param p1 First point of the oriented boundary line segment
-    /// \param p2 Second point of the oriented boundary line segment
-    /// \param y Vertical coordinate of the sample line
-    void createScanLineSample(const QPointF& p1, const QPointF& p2, qreal y);
-
     PDFColorComponent m_defaultShape = 0.0;
     int m_samplesCount = 0; ///< Samples count in one direction
     QPainterPath m_path;
-    QPolygonF m_fillPolygon;
     QRect m_fillRect;
-    std::vector<ScanLineSample> m_scanLineSamples;
-    std::vector<ScanLineInfo> m_scanLineInfo;
+    std::optional<PDFPathCoverageRasterizer> m_coverage;
     bool m_precise;
 };
 
@@ -631,6 +697,17 @@ struct PDFTransparencyRendererSettings
 
     /// Active color mask
     uint32_t activeColorMask = PDFPixelFormat::getAllColorsMask();
+
+    /// Precision of bitmaps, which are not painted into (backdrops of parent
+    /// transparency groups and original process image). Painting and blending
+    /// is always performed in full precision.
+    PDFFloatBitmap::Precision storagePrecision = PDFFloatBitmap::Precision::Float32;
+
+    /// Height of the horizontal band (in pixels), in which the page is rendered
+    /// in the PDFInkCoverageCalculator. Bands are rendered independently, so
+    /// only bitmaps of the band size are allocated. Zero means, that the whole
+    /// page is rendered at once.
+    int bandHeight = 0;
 };
 
 /// Renders PDF pages with transparency, using 32-bit floating point precision.
@@ -696,6 +773,29 @@ public:
     /// applied to this image.
     PDFFloatBitmapWithColorSpace getOriginalProcessBitmap() const { return m_originalProcessBitmap; }
 
+    /// Creates RGB image from original process bitmap (see \p getOriginalProcessBitmap),
+    /// so page can be displayed for various active color masks without rendering it again.
+    /// Original process bitmap must be rendered with all colors active. Colors, which
+    /// are not active, are cleared, spot colors are transformed into device colors and
+    /// bitmap is painted onto device transparency group (page transparency group is
+    /// composited using normal blend mode). If error occurs, empty image is returned.
+    /// \param originalProcessBitmap Original process bitmap, with all colors active
+    /// \param activeColorMask Active color mask
+    /// \param inkMapper Ink mapper used for rendering of the original process bitmap
+    /// \param cms Color management system
+    /// \param deviceColorSpace Device color space (must be RGB)
+    /// \param usePaper Blend image with opaque paper, with color \p paperColor
+    /// \param paperColor Paper color
+    /// \param reporter Error reporter
+    static QImage createImageFromOriginalProcessBitmap(PDFFloatBitmapWithColorSpace originalProcessBitmap,
+                                                       uint32_t activeColorMask,
+                                                       const PDFInkMapper* inkMapper,
+                                                       const PDFCMS* cms,
+                                                       const PDFColorSpacePointer& deviceColorSpace,
+                                                       bool usePaper,
+                                                       const PDFRGB& paperColor,
+                                                       PDFRenderErrorReporter* reporter);
+
     virtual bool isContentKindSuppressed(ContentKind kind) const override;
     virtual void performPathPainting(const QPainterPath& path, bool stroke, bool fill, bool text, Qt::FillRule fillRule) override;
     virtual bool performPathPaintingUsingShading(const QPainterPath& path, bool stroke, bool fill, const PDFShadingPattern* shadingPattern) override;
@@ -748,6 +848,18 @@ private:
         QSharedDataPointer<PDFTransparencySoftMaskImpl> m_data;
     };
 
+    /// Key of rendered soft mask. Soft mask group is rendered in isolation,
+    /// in the coordinate system, which was active, when soft mask was set.
+    struct PDFSoftMaskCacheKey
+    {
+        auto operator<=>(const PDFSoftMaskCacheKey&) const = default;
+
+        const PDFDictionary* softMask = nullptr;
+        std::array<PDFReal, 6> matrix = { };
+        size_t width = 0;
+        size_t height = 0;
+    };
+
     struct PDFTransparencyGroupPainterData
     {
         void makeInitialBackdropTransparent();
@@ -800,7 +912,10 @@ private:
     PDFFloatBitmapWithColorSpace convertImageToBlendSpace(const PDFFloatBitmapWithColorSpace& image);
 
     /// Converts RGB bitmap to the image.
-    QImage toImageImpl(const PDFFloatBitmapWithColorSpace& floatImage, bool use16Bit) const;
+    static QImage toImageImpl(const PDFFloatBitmapWithColorSpace& floatImage, bool use16Bit);
+
+    /// Converts RGB bitmap to the image, optionally painted onto opaque paper
+    static QImage toImageImpl(const PDFFloatBitmapWithColorSpace& floatImage, bool use16Bit, bool usePaper, const PDFRGB& paperColor);
 
     PDFFloatBitmapWithColorSpace* getInitialBackdrop();
     PDFFloatBitmapWithColorSpace* getImmediateBackdrop();
@@ -892,6 +1007,18 @@ private:
     /// \param data Bitmap with data
     void collapseSpotColorsToDeviceColors(PDFFloatBitmapWithColorSpace& bitmap);
 
+    /// Collapses spot colors to device colors
+    /// \param data Bitmap with data
+    /// \param inkMapper Ink mapper
+    /// \param cms Color management system
+    /// \param intent Rendering intent
+    /// \param reporter Error reporter
+    static void collapseSpotColorsToDeviceColors(PDFFloatBitmapWithColorSpace& bitmap,
+                                                 const PDFInkMapper* inkMapper,
+                                                 const PDFCMS* cms,
+                                                 RenderingIntent intent,
+                                                 PDFRenderErrorReporter* reporter);
+
     /// Transforms image to float image in actual blending color space,
     /// with marked colors. Function for internal use only.
     /// \param sourceImage
@@ -928,6 +1055,9 @@ private:
     PDFTransparencyRendererSettings m_settings;
     PDFDrawBuffer m_drawBuffer;
     PDFFloatBitmapWithColorSpace m_originalProcessBitmap;
+
+    /// Soft masks rendered during painting of the current page
+    std::map<PDFSoftMaskCacheKey, PDFTransparencySoftMask> m_softMaskCache;
 };
 
 /// Ink coverage calculator. Calculates ink coverage for a given
@@ -960,6 +1090,22 @@ public:
     /// \param pages Page indices
     void perform(QSize size, const std::vector<PDFInteger>& pages);
 
+    /// Returns memory limit for bitmaps of pages calculated at once (in bytes)
+    qint64 getMemoryLimit() const { return m_memoryLimit; }
+
+    /// Sets memory limit for bitmaps of pages calculated at once. Pages
+    /// are calculated in parallel, but only so many pages are calculated
+    /// at once, that estimated memory of their bitmaps fits into the limit.
+    /// Page exceeding the limit is calculated alone. Zero or negative
+    /// value means, that memory is not limited.
+    /// \param memoryLimit Memory limit in bytes
+    void setMemoryLimit(qint64 memoryLimit) { m_memoryLimit = memoryLimit; }
+
+    /// Returns estimate of memory (in bytes), which is allocated for bitmaps,
+    /// when the image (or the band of the image) of given size is rendered.
+    /// \param imageSize Size of the rendered image (or band)
+    qint64 getBitmapMemoryEstimate(QSize imageSize) const;
+
     /// Clear all calculated ink coverage results
     void clear();
 
@@ -968,6 +1114,11 @@ public:
     /// \param pageIndex Page index
     const std::vector<InkCoverageChannelInfo>* getInkCoverage(PDFInteger pageIndex) const;
 
+    /// Returns time (in milliseconds), which was spent by calculation of ink
+    /// coverage of given page. If page was not processed, -1 is returned.
+    /// \param pageIndex Page index
+    qint64 getPageTime(PDFInteger pageIndex) const;
+
     /// Find coverage info in vector by colorant name. If coverage info with a given colorant
     /// name is not found, then nullptr is returned.
     /// \param infos Vector of coverage info
@@ -990,9 +1141,11 @@ private:
     const PDFInkMapper* m_inkMapper;
     PDFProgress* m_progress;
     PDFTransparencyRendererSettings m_settings;
+    qint64 m_memoryLimit = 0;
 
     QMutex m_mutex;
     std::map<pdf::PDFInteger, std::vector<InkCoverageChannelInfo>> m_inkCoverageResults;
+    std::map<pdf::PDFInteger, qint64> m_pageTimes;
 };
 
 }   // namespace pdf
@@ -28,6 +28,8 @@
 #include <QtMath>
 #include "pdfdbgheap.h"
 
+#include <algorithm>
+
 #include <jpeglib.h>
 #include <ft2build.h>
 #include <freetype/freetype.h>
@@ -103,22 +105,25 @@ PDFBitReader::Value PDFBitReader::read(PDFBitReader::Value bits)
 
 PDFBitReader::Value PDFBitReader::look(Value bits) const
 {
-    PDFBitReader temp(*this);
+    Q_ASSERT(bits <= 56);
+
+    // Bits behind the end of the stream are read as zeros. Bits above m_bitsInBuffer
+    // in the buffer can contain already consumed data, so result must be masked.
+    Value buffer = m_buffer;
+    Value bitsInBuffer = m_bitsInBuffer;
+    int position = m_position;
 
-    Value result = 0;
-    for (Value i = 0; i < bits; ++i)
+    while (bitsInBuffer < bits)
     {
-        if (!temp.isAtEnd())
-        {
-            result = (result << 1) | temp.read(1);
-        }
-        else
+        buffer = buffer << 8;
+        if (position < m_stream->size())
         {
-            result = (result << 1);
+            buffer |= static_cast<uint8_t>((*m_stream)[position++]);
         }
+        bitsInBuffer += 8;
     }
 
-    return result;
+    return (buffer >> (bitsInBuffer - bits)) & ((static_cast<Value>(1) << bits) - static_cast<Value>(1));
 }
 
 void PDFBitReader::seek(qint64 position)
@@ -219,6 +224,17 @@ void PDFBitWriter::write(Value value)
     flush(false);
 }
 
+void PDFBitWriter::write(Value value, Value bits)
+{
+    Q_ASSERT(bits <= 32);
+
+    const Value mask = (static_cast<Value>(1) << bits) - static_cast<Value>(1);
+    m_buffer = (m_buffer << bits) | (value & mask);
+    m_bitsInBuffer += bits;
+
+    flush(false);
+}
+
 void PDFBitWriter::flush(bool alignToByteBoundary)
 {
     if (m_bitsInBuffer >= 8)
@@ -485,6 +501,150 @@ PDFClosedIntervalSet PDFClosedIntervalSet::parse(PDFInteger first, PDFInteger la
     return result;
 }
 
+void PDFRectangleTree::Box::unite(const Box& other)
+{
+    left = qMin(left, other.left);
+    top = qMin(top, other.top);
+    right = qMax(right, other.right);
+    bottom = qMax(bottom, other.bottom);
+}
+
+PDFRectangleTree::PDFRectangleTree(const std::vector<QRectF>& rectangles)
+{
+    m_items.reserve(rectangles.size());
+    for (size_t i = 0; i < rectangles.size(); ++i)
+    {
+        const QRectF rectangle = rectangles[i].normalized();
+        if (!std::isfinite(rectangle.left()) || !std::isfinite(rectangle.top()) ||
+            !std::isfinite(rectangle.right()) || !std::isfinite(rectangle.bottom()))
+        {
+            continue;
+        }
+
+        Item item;
+        item.box = Box{ rectangle.left(), rectangle.top(), rectangle.right(), rectangle.bottom() };
+        item.index = i;
+        m_items.push_back(item);
+    }
+
+    if (m_items.empty())
+    {
+        return;
+    }
+
+    sortTileRecursive(m_items);
+    m_levels.push_back(createParentNodes(m_items));
+
+    while (m_levels.back().size() > 1)
+    {
+        // Nodes keep ranges of their children, so they can
+        // be reordered before their parents are created.
+        std::vector<Node>& nodes = m_levels.back();
+        sortTileRecursive(nodes);
+        std::vector<Node> parentNodes = createParentNodes(nodes);
+        m_levels.push_back(qMove(parentNodes));
+    }
+}
+
+template<typename T>
+void PDFRectangleTree::sortTileRecursive(std::vector<T>& elements)
+{
+    auto compareX = [](const T& l, const T& r) { return l.box.centerX() < r.box.centerX(); };
+    auto compareY = [](const T& l, const T& r) { return l.box.centerY() < r.box.centerY(); };
+
+    // Elements are sorted by x coordinate and divided into vertical slices,
+    // then each slice is sorted by y coordinate.
+    const size_t nodeCount = (elements.size() + NODE_CAPACITY - 1) / NODE_CAPACITY;
+    const size_t sliceCount = size_t(std::ceil(std::sqrt(PDFReal(nodeCount))));
+    const size_t sliceSize = sliceCount * NODE_CAPACITY;
+
+    std::sort(elements.begin(), elements.end(), compareX);
+    for (size_t i = 0; i < elements.size(); i += sliceSize)
+    {
+        auto itEnd = std::next(elements.begin(), qMin(i + sliceSize, elements.size()));
+        std::sort(std::next(elements.begin(), i), itEnd, compareY);
+    }
+}
+
+template<typename T>
+std::vector<PDFRectangleTree::Node> PDFRectangleTree::createParentNodes(const std::vector<T>& elements)
+{
+    std::vector<Node> nodes;
+    nodes.reserve((elements.size() + NODE_CAPACITY - 1) / NODE_CAPACITY);
+
+    for (size_t i = 0; i < elements.size(); i += NODE_CAPACITY)
+    {
+        Node node;
+        node.first = i;
+        node.last = qMin(i + NODE_CAPACITY, elements.size());
+        node.box = elements[i].box;
+        for (size_t j = node.first + 1; j < node.last; ++j)
+        {
+            node.box.unite(elements[j].box);
+        }
+        nodes.push_back(node);
+    }
+
+    return nodes;
+}
+
+void PDFRectangleTree::query(const QPointF& point, std::vector<size_t>& indices) const
+{
+    query(Box{ point.x(), point.y(), point.x(), point.y() }, indices);
+}
+
+void PDFRectangleTree::query(const QRectF& rectangle, std::vector<size_t>& indices) const
+{
+    const QRectF normalizedRectangle = rectangle.normalized();
+    query(Box{ normalizedRectangle.left(), normalizedRectangle.top(), normalizedRectangle.right(), normalizedRectangle.bottom() }, indices);
+}
+
+void PDFRectangleTree::query(const Box& box, std::vector<size_t>& indices) const
+{
+    indices.clear();
+
+    if (m_levels.empty())
+    {
+        return;
+    }
+
+    // Stack of nodes to be processed (level, node index)
+    std::vector<std::pair<size_t, size_t>> stack;
+    stack.emplace_back(m_levels.size() - 1, 0);
+
+    while (!stack.empty())
+    {
+        auto [level, nodeIndex] = stack.back();
+        stack.pop_back();
+
+        const Node& node = m_levels[level][nodeIndex];
+        if (!node.box.intersects(box))
+        {
+            continue;
+        }
+
+        if (level == 0)
+        {
+            for (size_t i = node.first; i < node.last; ++i)
+            {
+                if (m_items[i].box.intersects(box))
+                {
+                    indices.push_back(m_items[i].index);
+                }
+            }
+        }
+        else
+        {
+            for (size_t i = node.first; i < node.last; ++i)
+            {
+                stack.emplace_back(level - 1, i);
+            }
+        }
+    }
+
+    std::sort(indices.begin(), indices.end());
+}
+
 void PDFClosedIntervalSet::normalize()
 {
     // Algorithm:
@@ -624,4 +784,103 @@ QDataStream& operator>>(QDataStream& stream, long unsigned int &i)
     return stream;
 }
 
+void writeRawImage(QDataStream& stream, const QImage& image)
+{
+    stream << int(image.format());
+    stream << image.width();
+    stream << image.height();
+    stream << image.colorTable();
+    stream << image.devicePixelRatio();
+
+    const int bytesPerLine = (image.width() * image.depth() + 7) / 8;
+    for (int i = 0; i < image.height(); ++i)
+    {
+        stream.writeRawData(reinterpret_cast<const char*>(image.constScanLine(i)), bytesPerLine);
+    }
+}
+
+QImage readRawImage(QDataStream& stream)
+{
+    int format = QImage::Format_Invalid;
+    int width = 0;
+    int height = 0;
+    QList<QRgb> colorTable;
+    qreal devicePixelRatio = 1.0;
+
+    stream >> format;
+    stream >> width;
+    stream >> height;
+    stream >> colorTable;
+    stream >> devicePixelRatio;
+
+    if (stream.status() != QDataStream::Ok ||
+        format <= QImage::Format_Invalid ||
+        format >= QImage::NImageFormats ||
+        width <= 0 ||
+        height <= 0)
+    {
+        return QImage();
+    }
+
+    QImage image(width, height, static_cast<QImage::Format>(format));
+    if (image.isNull())
+    {
+        return QImage();
+    }
+
+    image.setColorTable(colorTable);
+    image.setDevicePixelRatio(devicePixelRatio);
+
+    const int bytesPerLine = (image.width() * image.depth() + 7) / 8;
+    for (int i = 0; i < image.height(); ++i)
+    {
+        if (stream.readRawData(reinterpret_cast<char*>(image.scanLine(i)), bytesPerLine) != bytesPerLine)
+        {
+            return QImage();
+        }
+    }
+
+    return image;
+}
+
+struct PDFThreadLocalArenaData
+{
+    static constexpr size_t INITIAL_BUFFER_SIZE = 64 * 1024;
+
+    PDFThreadLocalArenaData() :
+        resource(INITIAL_BUFFER_SIZE)
+    {
+
+    }
+
+    std::pmr::monotonic_buffer_resource resource;
+    int scopeDepth = 0;
+};
+
+static PDFThreadLocalArenaData& getThreadLocalArenaData()
+{
+    static thread_local PDFThreadLocalArenaData data;
+    return data;
+}
+
+PDFThreadLocalArena::Scope::Scope()
+{
+    ++getThreadLocalArenaData().scopeDepth;
+}
+
+PDFThreadLocalArena::Scope::~Scope()
+{
+    PDFThreadLocalArenaData& data = getThreadLocalArenaData();
+    if (--data.scopeDepth == 0)
+    {
+        data.resource.release();
+    }
+}
+
+std::pmr::memory_resource* PDFThreadLocalArena::getResource()
+{
+    PDFThreadLocalArenaData& data = getThreadLocalArenaData();
+    return data.scopeDepth > 0 ? &data.resource : std::pmr::get_default_resource();
+}
+
 }   // namespace pdf
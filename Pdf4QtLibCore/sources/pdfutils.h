@@ -29,12 +29,15 @@
 #include <QColor>
 #include <QByteArray>
 #include <QDataStream>
+#include <QImage>
 
 #include <set>
+#include <memory>
 #include <vector>
 #include <iterator>
 #include <functional>
 #include <type_traits>
+#include <memory_resource>
 
 namespace pdf
 {
@@ -205,6 +208,12 @@ public:
     /// Writes value to the output stream
     void write(Value value);
 
+    /// Writes value to the output stream using given number of bits instead
+    /// of bits per component. Bit count must not exceed 32 bits.
+    /// \param value Value
+    /// \param bits Number of bits
+    void write(Value value, Value bits);
+
     /// Finish line - align to byte boundary
     void finishLine() { flush(true); }
 
@@ -579,6 +588,240 @@ private:
     value_ptr m_end;
 };
 
+/// Vector, which stores items in chunks of fixed size. Chunks can be shared between
+/// vectors (function \p share), so shared copy of large vector is cheap, and when
+/// vector with shared chunks is modified, only modified chunk is copied (copy-on-write).
+/// Copy constructor and assignment operator create deep copy, so copies behave as
+/// std::vector and can be modified independently, even from multiple threads.
+/// Modification of vector sharing chunks is not thread safe.
+template<typename T, size_t ChunkSize = 1024>
+class PDFSharedChunkedVector
+{
+    using Chunk = std::vector<T>;
+    using ChunkPointer = std::shared_ptr<Chunk>;
+
+public:
+    using value_type = T;
+    using size_type = size_t;
+    using difference_type = ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+
+    template<typename Container, typename Value>
+    class IteratorBase
+    {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using difference_type   = ptrdiff_t;
+        using value_type        = T;
+        using pointer           = Value*;
+        using reference         = Value&;
+
+        inline IteratorBase() = default;
+        inline IteratorBase(Container* container, size_t index) : m_container(container), m_index(index) { }
+
+        inline bool operator==(const IteratorBase& other) const { return m_index == other.m_index; }
+        inline bool operator!=(const IteratorBase& other) const { return m_index != other.m_index; }
+        inline bool operator<(const IteratorBase& other) const { return m_index < other.m_index; }
+        inline bool operator>(const IteratorBase& other) const { return m_index > other.m_index; }
+        inline bool operator<=(const IteratorBase& other) const { return m_index <= other.m_index; }
+        inline bool operator>=(const IteratorBase& other) const { return m_index >= other.m_index; }
+
+        inline reference operator*() const { return m_container->getItem(m_index); }
+        inline pointer operator->() const { return &m_container->getItem(m_index); }
+        inline reference operator[](ptrdiff_t offset) const { return m_container->getItem(m_index + offset); }
+
+        inline IteratorBase& operator+=(ptrdiff_t movement) { m_index += movement; return *this; }
+        inline IteratorBase& operator-=(ptrdiff_t movement) { m_index -= movement; return *this; }
+        inline IteratorBase operator+(ptrdiff_t movement) const { return IteratorBase(m_container, m_index + movement); }
+        inline IteratorBase operator-(ptrdiff_t movement) const { return IteratorBase(m_container, m_index - movement); }
+        inline ptrdiff_t operator-(const IteratorBase& other) const { return ptrdiff_t(m_index) - ptrdiff_t(other.m_index); }
+        friend inline IteratorBase operator+(ptrdiff_t movement, const IteratorBase& iterator) { return iterator + movement; }
+
+        inline IteratorBase& operator++() { ++m_index; return *this; }
+        inline IteratorBase operator++(int) { IteratorBase copy(*this); ++m_index; return copy; }
+        inline IteratorBase& operator--() { --m_index; return *this; }
+        inline IteratorBase operator--(int) { IteratorBase copy(*this); --m_index; return copy; }
+
+    private:
+        Container* m_container = nullptr;
+        size_t m_index = 0;
+    };
+
+    using iterator = IteratorBase<PDFSharedChunkedVector, T>;
+    using const_iterator = IteratorBase<const PDFSharedChunkedVector, const T>;
+
+    inline PDFSharedChunkedVector() = default;
+    inline PDFSharedChunkedVector(PDFSharedChunkedVector&&) = default;
+    inline PDFSharedChunkedVector& operator=(PDFSharedChunkedVector&&) = default;
+
+    PDFSharedChunkedVector(const PDFSharedChunkedVector& other) :
+        m_size(other.m_size)
+    {
+        m_chunks.reserve(other.m_chunks.size());
+        for (const ChunkPointer& chunk : other.m_chunks)
+        {
+            m_chunks.push_back(std::make_shared<Chunk>(*chunk));
+        }
+    }
+
+    PDFSharedChunkedVector& operator=(const PDFSharedChunkedVector& other)
+    {
+        if (this != &other)
+        {
+            *this = PDFSharedChunkedVector(other);
+        }
+
+        return *this;
+    }
+
+    bool operator==(const PDFSharedChunkedVector& other) const
+    {
+        if (m_size != other.m_size)
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < m_chunks.size(); ++i)
+        {
+            if (m_chunks[i] != other.m_chunks[i] && *m_chunks[i] != *other.m_chunks[i])
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool operator!=(const PDFSharedChunkedVector& other) const { return !(*this == other); }
+
+    /// Returns copy of the vector, which shares all chunks with this vector
+    PDFSharedChunkedVector share() const
+    {
+        PDFSharedChunkedVector result;
+        result.m_chunks = m_chunks;
+        result.m_size = m_size;
+        return result;
+    }
+
+    /// Returns true, if item with given index is stored in chunk shared with another vector
+    bool isShared(size_t index) const { return m_chunks[index / ChunkSize].use_count() > 1; }
+
+    /// Returns true, if item with given index is stored in the same chunk
+    /// as item with the same index in the other vector.
+    /// \param index Index of the item
+    /// \param other Other vector
+    bool isSharedWith(size_t index, const PDFSharedChunkedVector& other) const
+    {
+        const size_t chunkIndex = index / ChunkSize;
+        return chunkIndex < m_chunks.size() && chunkIndex < other.m_chunks.size() && m_chunks[chunkIndex] == other.m_chunks[chunkIndex];
+    }
+
+    /// Returns count of items, which are stored in one chunk
+    static constexpr size_t getChunkSize() { return ChunkSize; }
+
+    /// Copies all chunks, which are shared with another vector
+    void detach()
+    {
+        for (size_t i = 0; i < m_chunks.size(); ++i)
+        {
+            detachChunk(i);
+        }
+    }
+
+    inline size_t size() const { return m_size; }
+    inline bool empty() const { return m_size == 0; }
+
+    inline void reserve(size_t size) { m_chunks.reserve((size + ChunkSize - 1) / ChunkSize); }
+
+    void clear()
+    {
+        m_chunks.clear();
+        m_size = 0;
+    }
+
+    void resize(size_t size)
+    {
+        if (size < m_size)
+        {
+            m_chunks.resize((size + ChunkSize - 1) / ChunkSize);
+            m_size = size;
+
+            if (size % ChunkSize != 0)
+            {
+                detachChunk(m_chunks.size() - 1);
+                m_chunks.back()->resize(size % ChunkSize);
+            }
+        }
+
+        while (m_size < size)
+        {
+            emplace_back();
+        }
+    }
+
+    template<typename... Arguments>
+    T& emplace_back(Arguments&&... arguments)
+    {
+        if (m_size % ChunkSize == 0)
+        {
+            m_chunks.push_back(std::make_shared<Chunk>());
+            m_chunks.back()->reserve(ChunkSize);
+        }
+        else
+        {
+            detachChunk(m_chunks.size() - 1);
+        }
+
+        ++m_size;
+        return m_chunks.back()->emplace_back(std::forward<Arguments>(arguments)...);
+    }
+
+    inline void push_back(const T& value) { emplace_back(value); }
+    inline void push_back(T&& value) { emplace_back(std::move(value)); }
+
+    /// Returns item for modification. If chunk containing the item
+    /// is shared with another vector, chunk is copied.
+    inline T& operator[](size_t index)
+    {
+        detachChunk(index / ChunkSize);
+        return getItem(index);
+    }
+
+    inline const T& operator[](size_t index) const { return getItem(index); }
+
+    inline T& back() { return (*this)[m_size - 1]; }
+    inline const T& back() const { return getItem(m_size - 1); }
+
+    /// Returns iterator for modification, all shared chunks are copied
+    inline iterator begin() { detach(); return iterator(this, 0); }
+    inline iterator end() { return iterator(this, m_size); }
+
+    inline const_iterator begin() const { return const_iterator(this, 0); }
+    inline const_iterator end() const { return const_iterator(this, m_size); }
+    inline const_iterator cbegin() const { return const_iterator(this, 0); }
+    inline const_iterator cend() const { return const_iterator(this, m_size); }
+
+private:
+    inline T& getItem(size_t index) { return (*m_chunks[index / ChunkSize])[index % ChunkSize]; }
+    inline const T& getItem(size_t index) const { return (*m_chunks[index / ChunkSize])[index % ChunkSize]; }
+
+    void detachChunk(size_t chunkIndex)
+    {
+        ChunkPointer& chunk = m_chunks[chunkIndex];
+        if (chunk.use_count() > 1)
+        {
+            ChunkPointer copy = std::make_shared<Chunk>();
+            copy->reserve(ChunkSize);
+            copy->insert(copy->end(), chunk->cbegin(), chunk->cend());
+            chunk = std::move(copy);
+        }
+    }
+
+    std::vector<ChunkPointer> m_chunks;
+    size_t m_size = 0;
+};
+
 /// Storage for result of some operation. Stores, if operation was successful, or not and
 /// also error message, why operation has failed. Can be converted explicitly to bool.
 class PDFOperationResult
@@ -738,6 +981,94 @@ private:
     std::vector<ClosedInterval> m_intervals;
 };
 
+/// Static R-tree of rectangles, which is built at once using sort-tile-recursive
+/// bulk loading. It is used to find rectangles containing given point, or intersecting
+/// given rectangle, without testing all rectangles. Rectangles are identified
+/// by their index in the vector, from which tree was built. Rectangle boundaries
+/// are considered to be part of the rectangle.
+class PDF4QTLIBCORESHARED_EXPORT PDFRectangleTree
+{
+public:
+    explicit inline PDFRectangleTree() = default;
+
+    /// Builds tree from rectangles. Rectangles with non-finite
+    /// coordinates are not indexed (they can't be found).
+    /// \param rectangles Rectangles
+    explicit PDFRectangleTree(const std::vector<QRectF>& rectangles);
+
+    /// Finds rectangles, which contain the point. Indices of found
+    /// rectangles are sorted in ascending order.
+    /// \param point Point
+    /// \param indices Indices of found rectangles (vector is cleared first)
+    void query(const QPointF& point, std::vector<size_t>& indices) const;
+
+    /// Finds rectangles, which intersect the rectangle. Indices of
+    /// found rectangles are sorted in ascending order.
+    /// \param rectangle Rectangle
+    /// \param indices Indices of found rectangles (vector is cleared first)
+    void query(const QRectF& rectangle, std::vector<size_t>& indices) const;
+
+    /// Returns true, if tree doesn't contain any rectangle
+    bool isEmpty() const { return m_items.empty(); }
+
+private:
+    static constexpr size_t NODE_CAPACITY = 16;
+
+    struct Box
+    {
+        PDFReal left = 0.0;
+        PDFReal top = 0.0;
+        PDFReal right = 0.0;
+        PDFReal bottom = 0.0;
+
+        void unite(const Box& other);
+        bool intersects(const Box& other) const { return left <= other.right && other.left <= right && top <= other.bottom && other.top <= bottom; }
+        PDFReal centerX() const { return (left + right) * 0.5; }
+        PDFReal centerY() const { return (top + bottom) * 0.5; }
+    };
+
+    struct Item
+    {
+        Box box;
+        size_t index = 0;
+    };
+
+    struct Node
+    {
+        Box box;
+        size_t first = 0;   ///< First child (node in lower level, or item for leaf level)
+        size_t last = 0;    ///< One past the last child
+    };
+
+    /// Sorts elements by sort-tile-recursive algorithm, so consecutive groups
+    /// of \p NODE_CAPACITY elements are spatially close to each other.
+    template<typename T>
+    static void sortTileRecursive(std::vector<T>& elements);
+
+    /// Creates parent nodes of the consecutive groups of elements
+    template<typename T>
+    static std::vector<Node> createParentNodes(const std::vector<T>& elements);
+
+    void query(const Box& box, std::vector<size_t>& indices) const;
+
+    std::vector<Item> m_items;
+
+    /// Levels of nodes, first level contains leaf nodes, last level contains root node
+    std::vector<std::vector<Node>> m_levels;
+};
+
+/// Writes image into the stream uncompressed. Unlike QDataStream operator
+/// for QImage, which encodes the image as PNG, this function is fast and
+/// image format is preserved.
+/// \param stream Stream
+/// \param image Image
+void writeRawImage(QDataStream& stream, const QImage& image);
+
+/// Reads image written by function \p writeRawImage. If stream
+/// is corrupted, then null image is returned.
+/// \param stream Stream
+QImage readRawImage(QDataStream& stream);
+
 QDataStream& operator>>(QDataStream& stream, long unsigned int &i);
 
 template<typename T>
@@ -862,6 +1193,36 @@ private:
     PDFReal m_max;
 };
 
+/// Thread local monotonic memory arena for short-lived temporary objects,
+/// which are created during processing of the page (for example, text sequences
+/// of text showing operators). Allocation from the arena is very fast, deallocation
+/// does nothing, and all memory is released at once, when the outermost arena
+/// scope of the thread ends. Objects allocated from the arena must not outlive
+/// the scope. Copies of containers using polymorphic allocator don't
+/// inherit the memory resource, so they can be safely stored.
+class PDF4QTLIBCORESHARED_EXPORT PDFThreadLocalArena
+{
+public:
+    /// Activates the arena of current thread. Scopes can be nested,
+    /// memory is released, when the outermost scope ends.
+    class PDF4QTLIBCORESHARED_EXPORT Scope
+    {
+    public:
+        explicit Scope();
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    /// Returns memory resource of the arena of current thread. If no
+    /// arena scope is active, default memory resource is returned.
+    static std::pmr::memory_resource* getResource();
+
+private:
+    PDFThreadLocalArena() = delete;
+};
+
 }   // namespace pdf
 
 #endif // PDFUTILS_H
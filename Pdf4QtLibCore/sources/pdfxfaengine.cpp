@@ -35,12 +35,14 @@
 #include <QTextBlock>
 #include <QFontDatabase>
 #include <QAbstractTextDocumentLayout>
+#include <QCryptographicHash>
 #include <QtMath>
 
 #include "pdfdbgheap.h"
 
 #include <stack>
 #include <optional>
+#include <unordered_map>
 
 namespace pdf
 {
@@ -153,6 +155,14 @@ public:
     QFont getFont() const;
     void setFont(const QFont& font);
 
+    friend size_t qHash(const XFA_ParagraphSettings& settings, size_t seed = 0)
+    {
+        const QMarginsF& margins = settings.m_margins;
+        seed = qHashMulti(seed, settings.m_lineHeight, settings.m_fontEmSize, settings.m_fontSpaceSize, settings.m_radixOffset, settings.m_textIndent);
+        seed = qHashMulti(seed, settings.m_alignment.toInt(), margins.left(), margins.top(), margins.right(), margins.bottom());
+        return qHashMulti(seed, settings.m_orphans, settings.m_widows, settings.m_tabDefault, settings.m_tabStops, settings.m_font);
+    }
+
 private:
     PDFReal m_lineHeight = 0.0;
     PDFReal m_fontEmSize = 0.0;
@@ -9690,11 +9700,14 @@ public:
 
     using LayoutItems = std::vector<LayoutItem>;
 
-    std::vector<QSizeF> getPageSizes() const { return m_layout.pageSizes; }
+    struct Layout
+    {
+        std::vector<QSizeF> pageSizes;
+        std::map<PDFInteger, LayoutItems> layoutItems;
+        std::vector<xfa::XFA_ParagraphSettings> paragraphSettings;
+    };
 
-    inline void setPageSizes(std::vector<QSizeF> pageSizes) { m_layout.pageSizes = std::move(pageSizes); }
-    inline void setLayoutItems(PDFInteger pageIndex, LayoutItems layoutItems) { m_layout.layoutItems[pageIndex] = std::move(layoutItems); }
-    inline void setParagraphSettings(std::vector<xfa::XFA_ParagraphSettings> paragraphSettings) { m_layout.paragraphSettings = std::move(paragraphSettings); }
+    std::vector<QSizeF> getPageSizes() const { return m_layout.pageSizes; }
 
     void draw(const QTransform& pagePointToDevicePointMatrix,
               const PDFPage* page,
@@ -9702,17 +9715,15 @@ public:
               QPainter* painter);
 
 private:
-
-    struct Layout
-    {
-        std::vector<QSizeF> pageSizes;
-        std::map<PDFInteger, LayoutItems> layoutItems;
-        std::vector<xfa::XFA_ParagraphSettings> paragraphSettings;
-    };
-
     void updateResources(const PDFObject& resources);
     void clear();
 
+    /// Creates key identifying layout input - template data and fonts
+    /// used in the layout. If key is same as key of current layout,
+    /// then layout doesn't have to be performed again.
+    /// \param templateData Template data
+    QByteArray createLayoutKey(const QByteArray& templateData) const;
+
     QMarginsF createMargin(const xfa::XFA_margin* margin);
 
     QColor createColor(const xfa::XFA_color* color) const;
@@ -9861,6 +9872,7 @@ private:
     xfa::XFA_Node<xfa::XFA_template> m_template;
     const PDFDocument* m_document;
     Layout m_layout;
+    QByteArray m_layoutKey;
     std::map<int, QByteArray> m_fonts;
 };
 
@@ -9878,7 +9890,10 @@ public:
     virtual void visit(const xfa::XFA_field* node) override;
     virtual void visit(const xfa::XFA_exclGroup* node) override;
 
-    void performLayout(PDFXFAEngineImpl* engine, const xfa::XFA_template* node);
+    /// Performs layout of the template. Result is returned as a whole,
+    /// so engine can replace its current layout at once.
+    /// \param node Template
+    PDFXFAEngineImpl::Layout performLayout(const xfa::XFA_template* node);
 
 private:
     enum class ContentAreaScope
@@ -10150,6 +10165,9 @@ private:
     std::vector<Layout> m_layout;
     std::map<const xfa::XFA_pageArea*, std::vector<Layout>> m_pageLayouts;
     std::vector<xfa::XFA_ParagraphSettings> m_paragraphSettings;
+
+    /// Index of paragraph settings (hash of settings to index in \p m_paragraphSettings)
+    std::unordered_multimap<size_t, size_t> m_paragraphSettingsIndex;
     std::stack<LayoutParameters> m_layoutParameters;
     size_t m_currentPageIndex = 0;
     size_t m_maximalPageCount = 128;
@@ -10854,10 +10872,13 @@ void PDFXFALayoutEngine::visit(const xfa::XFA_field* node)
     parameters.layout.emplace_back(std::move(layout));
 }
 
-void PDFXFALayoutEngine::performLayout(PDFXFAEngineImpl* engine, const xfa::XFA_template* node)
+PDFXFAEngineImpl::Layout PDFXFALayoutEngine::performLayout(const xfa::XFA_template* node)
 {
+    PDFXFAEngineImpl::Layout result;
+
     // Create default paragraph settings
     m_paragraphSettings = { xfa::XFA_ParagraphSettings() };
+    m_paragraphSettingsIndex = { { qHash(m_paragraphSettings.front()), 0 } };
 
     node->accept(this);
 
@@ -10929,11 +10950,12 @@ void PDFXFALayoutEngine::performLayout(PDFXFAEngineImpl* engine, const xfa::XFA_
             }
         }
 
-        engine->setLayoutItems(pageIndex++, std::move(layoutItems));
+        result.layoutItems[pageIndex++] = std::move(layoutItems);
     }
 
-    engine->setPageSizes(std::move(pageSizes));
-    engine->setParagraphSettings(std::move(m_paragraphSettings));
+    result.pageSizes = std::move(pageSizes);
+    result.paragraphSettings = std::move(m_paragraphSettings);
+    return result;
 }
 
 void PDFXFALayoutEngine::visit(const xfa::XFA_pageArea* node)
@@ -11488,13 +11510,22 @@ size_t PDFXFALayoutEngine::createParagraphSettings()
 {
     const LayoutParameters& layoutParameters = getLayoutParameters();
 
-    auto it = std::find(m_paragraphSettings.begin(), m_paragraphSettings.end(), layoutParameters.paragraphSettings);
-    if (it == m_paragraphSettings.end())
+    // Paragraph settings are created for each layout item, so we use the index
+    // instead of searching all settings, which were already created.
+    const size_t hash = qHash(layoutParameters.paragraphSettings);
+    auto [it, itEnd] = m_paragraphSettingsIndex.equal_range(hash);
+    for (; it != itEnd; ++it)
     {
-        it = m_paragraphSettings.insert(m_paragraphSettings.end(), layoutParameters.paragraphSettings);
+        if (m_paragraphSettings[it->second] == layoutParameters.paragraphSettings)
+        {
+            return it->second;
+        }
     }
 
-    return std::distance(m_paragraphSettings.begin(), it);
+    const size_t index = m_paragraphSettings.size();
+    m_paragraphSettings.push_back(layoutParameters.paragraphSettings);
+    m_paragraphSettingsIndex.emplace(hash, index);
+    return index;
 }
 
 void PDFXFALayoutEngine::handleBreak(const std::vector<xfa::XFA_Node<xfa::XFA_breakBefore>>& nodes)
@@ -11645,7 +11676,7 @@ void PDFXFAEngineImpl::setDocument(const PDFModifiedDocument& document, PDFForm*
 
         if (document.hasReset())
         {
-            clear();
+            bool isLayoutValid = false;
 
             if (form->getFormType() == PDFForm::FormType::XFAForm)
             {
@@ -11676,25 +11707,46 @@ void PDFXFAEngineImpl::setDocument(const PDFModifiedDocument& document, PDFForm*
                         xfaData["template"] = m_document->getDecodedStream(xfaObject.getStream());
                     }
 
-                    QDomDocument templateDocument;
-                    if (templateDocument.setContent(xfaData["template"]))
+                    // Document reset doesn't necessarily mean, that XFA form
+                    // has changed (for example, annotation was edited). If template
+                    // and fonts are same, current layout is still valid.
+                    QByteArray layoutKey = createLayoutKey(xfaData["template"]);
+                    isLayoutValid = m_template.hasValue() && layoutKey == m_layoutKey;
+
+                    if (!isLayoutValid)
                     {
-                        m_template = xfa::XFA_template::parse(templateDocument.firstChildElement("template"));
+                        m_template = xfa::XFA_Node<xfa::XFA_template>();
+                        m_layout = Layout();
+                        m_layoutKey.clear();
+
+                        QDomDocument templateDocument;
+                        if (templateDocument.setContent(xfaData["template"]))
+                        {
+                            m_template = xfa::XFA_template::parse(templateDocument.firstChildElement("template"));
+                        }
+
+                        // Perform layout
+                        if (m_template.hasValue())
+                        {
+                            PDFXFALayoutEngine layoutEngine;
+                            m_layout = layoutEngine.performLayout(m_template.getValue());
+                            m_layoutKey = std::move(layoutKey);
+                        }
+
+                        isLayoutValid = true;
                     }
                 }
                 catch (const PDFException&)
                 {
-                    // Just clear once again - if some errorneous data
+                    // Just clear - if some errorneous data
                     // were read, we want to clear them.
-                    clear();
+                    isLayoutValid = false;
                 }
             }
 
-            // Perform layout
-            if (m_template.hasValue())
+            if (!isLayoutValid)
             {
-                PDFXFALayoutEngine layoutEngine;
-                layoutEngine.performLayout(this, m_template.getValue());
+                clear();
             }
         }
     }
@@ -13139,11 +13191,25 @@ void PDFXFAEngineImpl::drawItemRectEdges(const std::vector<xfa::XFA_Node<xfa::XF
     drawCorner(drawRect.bottomLeft(), cornerPens[CORNER_BOTTOM_LEFT_INDEX], 270, getCorner(CORNER_BOTTOM_LEFT_INDEX));
 }
 
+QByteArray PDFXFAEngineImpl::createLayoutKey(const QByteArray& templateData) const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(templateData);
+
+    for (const auto& font : m_fonts)
+    {
+        hash.addData(QByteArrayView(reinterpret_cast<const char*>(&font.first), sizeof(font.first)));
+    }
+
+    return hash.result();
+}
+
 void PDFXFAEngineImpl::clear()
 {
     // Clear the template
     m_template = xfa::XFA_Node<xfa::XFA_template>();
     m_layout = Layout();
+    m_layoutKey.clear();
 
     for (const auto& font : m_fonts)
     {
@@ -25,6 +25,8 @@
 #include "pdfexception.h"
 #include "pdfparser.h"
 #include "pdfstreamfilters.h"
+#include "pdfexecutionpolicy.h"
+#include "pdfutils.h"
 
 #include <QIODevice>
 #include <QDataStream>
@@ -32,23 +34,88 @@
 #include "pdfdbgheap.h"
 
 #include <stack>
+#include <atomic>
+#include <cstring>
+#include <algorithm>
 
 namespace pdf
 {
 
-void PDFXRefTable::readXRefTable(PDFParsingContext* context, const QByteArray& byteArray, PDFInteger startTableOffset)
+void PDFXRefTable::readXRefTable(PDFParsingContext* context,
+                                 const QByteArray& byteArray,
+                                 PDFInteger startTableOffset,
+                                 const std::function<void(PDFInteger)>& sectionDataRequest)
 {
     PDFParser parser(byteArray, context, PDFParser::AllowStreams);
 
     m_entries.clear();
+    m_entryRevisions.clear();
+    m_revisions.clear();
+
+    // Revisions are numbered from the newest one during reading
+    struct WorkItem
+    {
+        PDFInteger offset = 0;
+        int revision = 0;
+    };
 
     std::set<PDFInteger> processedOffsets;
-    std::stack<PDFInteger> workSet;
-    workSet.push(startTableOffset);
+    std::stack<WorkItem> workSet;
+    workSet.push(WorkItem{ startTableOffset, 0 });
+
+    auto resizeEntries = [this](PDFInteger size)
+    {
+        if (static_cast<PDFInteger>(m_entries.size()) < size)
+        {
+            m_entries.resize(size);
+            m_entryRevisions.resize(size, -1);
+        }
+    };
+
+    // Entry is set, if object was not defined yet. Free entries of newer revisions hide
+    // entries of older revisions, but in the same revision, free entry can be replaced,
+    // because hybrid-reference files mark objects from object streams as free in the
+    // reference table and define them in the cross-reference stream (XRefStm).
+    auto setEntry = [this](PDFInteger objectNumber, Entry&& entry, int revision)
+    {
+        const int entryRevision = m_entryRevisions[objectNumber];
+        if (entryRevision == -1 || (entryRevision == revision && m_entries[objectNumber].type == EntryType::Free))
+        {
+            m_entries[objectNumber] = std::move(entry);
+            m_entryRevisions[objectNumber] = revision;
+        }
+    };
+
+    auto registerRevision = [this, &byteArray](int revision, PDFInteger offset)
+    {
+        if (static_cast<int>(m_revisions.size()) <= revision)
+        {
+            m_revisions.resize(revision + 1);
+        }
+
+        Revision& currentRevision = m_revisions[revision];
+        if (currentRevision.xrefOffset == -1)
+        {
+            currentRevision.xrefOffset = offset;
+        }
+
+        // Revision ends after end of file mark following the section
+        const qsizetype endOfFileMarkOffset = byteArray.indexOf(PDF_END_OF_FILE_MARK, offset);
+        const PDFInteger endOffset = (endOfFileMarkOffset != -1) ? endOfFileMarkOffset + static_cast<PDFInteger>(std::strlen(PDF_END_OF_FILE_MARK)) : byteArray.size();
+        currentRevision.endOffset = qMax(currentRevision.endOffset, endOffset);
+    };
+
+    auto pushPrevious = [&workSet](PDFInteger previousOffset, PDFInteger currentOffset, int revision)
+    {
+        // Previous section, which lies after current section, belongs to
+        // the same revision (main section of the linearized document).
+        workSet.push(WorkItem{ previousOffset, previousOffset > currentOffset ? revision : revision + 1 });
+    };
 
     while (!workSet.empty())
     {
-        PDFInteger currentOffset = workSet.top();
+        const PDFInteger currentOffset = workSet.top().offset;
+        const int currentRevision = workSet.top().revision;
         workSet.pop();
 
         // Check, if we have cyclical references between tables
@@ -62,11 +129,38 @@ void PDFXRefTable::readXRefTable(PDFParsingContext* context, const QByteArray& b
             processedOffsets.insert(currentOffset);
         }
 
+        if (sectionDataRequest)
+        {
+            sectionDataRequest(currentOffset);
+        }
+
+        registerRevision(currentRevision, currentOffset);
+
         // Now, we are ready to scan the table. Seek to the start of the reference table.
         parser.seek(currentOffset);
 
         if (parser.fetchCommand(PDF_XREF_HEADER))
         {
+            // Try to read well-formed section using the fast path first. If it succeeds,
+            // we continue with the trailer, otherwise section is read by the tolerant parser.
+            std::vector<Subsection> subsections;
+            const PDFInteger trailerOffset = readFixedWidthSubsections(byteArray, currentOffset, subsections);
+            if (trailerOffset != -1)
+            {
+                for (Subsection& subsection : subsections)
+                {
+                    const PDFInteger count = static_cast<PDFInteger>(subsection.entries.size());
+                    resizeEntries(subsection.firstObjectNumber + count);
+
+                    for (PDFInteger i = 0; i < count; ++i)
+                    {
+                        setEntry(subsection.firstObjectNumber + i, std::move(subsection.entries[i]), currentRevision);
+                    }
+                }
+
+                parser.seek(trailerOffset);
+            }
+
             while (!parser.fetchCommand(PDF_XREF_TRAILER))
             {
                 // Now, first number is start offset, second number is count of table items
@@ -83,11 +177,7 @@ void PDFXRefTable::readXRefTable(PDFParsingContext* context, const QByteArray& b
 
                 const PDFInteger lastObjectIndex = firstObjectNumber + count - 1;
                 const PDFInteger desiredSize = lastObjectIndex + 1;
-
-                if (static_cast<PDFInteger>(m_entries.size()) < desiredSize)
-                {
-                    m_entries.resize(desiredSize);
-                }
+                resizeEntries(desiredSize);
 
                 // Now, read the records
                 for (PDFInteger i = 0; i < count; ++i)
@@ -121,10 +211,7 @@ void PDFXRefTable::readXRefTable(PDFParsingContext* context, const QByteArray& b
                         entry.type = EntryType::Occupied;
                     }
 
-                    if (m_entries[objectNumber].type == EntryType::Free)
-                    {
-                        m_entries[objectNumber] = std::move(entry);
-                    }
+                    setEntry(objectNumber, std::move(entry), currentRevision);
                 }
             }
 
@@ -141,6 +228,11 @@ void PDFXRefTable::readXRefTable(PDFParsingContext* context, const QByteArray& b
                 m_trailerDictionary = trailerDictionary;
             }
 
+            if (m_revisions[currentRevision].trailerDictionary.isNull())
+            {
+                m_revisions[currentRevision].trailerDictionary = trailerDictionary;
+            }
+
             const PDFDictionary* dictionary = trailerDictionary.getDictionary();
             if (dictionary->hasKey(PDF_XREF_TRAILER_PREVIOUS))
             {
@@ -151,13 +243,14 @@ void PDFXRefTable::readXRefTable(PDFParsingContext* context, const QByteArray& b
                     throw PDFException(tr("Offset of previous reference table is invalid."));
                 }
 
-                workSet.push(previousOffset.getInteger());
+                pushPrevious(previousOffset.getInteger(), currentOffset, currentRevision);
             }
 
+            // Cross-reference stream of hybrid-reference file belongs to the same revision
             const PDFObject& xrefstmObject = dictionary->get(PDF_XREF_TRAILER_XREFSTM);
             if (xrefstmObject.isInt())
             {
-                workSet.push(xrefstmObject.getInteger());
+                workSet.push(WorkItem{ xrefstmObject.getInteger(), currentRevision });
             }
         }
         else
@@ -197,15 +290,12 @@ void PDFXRefTable::readXRefTable(PDFParsingContext* context, const QByteArray& b
                     }
 
                     const PDFInteger desiredSize = sizeObject.getInteger();
-                    if (static_cast<PDFInteger>(m_entries.size()) < desiredSize)
-                    {
-                        m_entries.resize(desiredSize);
-                    }
+                    resizeEntries(desiredSize);
 
                     PDFObject prevObject = crossReferenceStreamDictionary->get("Prev");
                     if (prevObject.isInt())
                     {
-                        workSet.push(prevObject.getInteger());
+                        pushPrevious(prevObject.getInteger(), currentOffset, currentRevision);
                     }
 
                     // Do not overwrite trailer dictionary, if it was already loaded.
@@ -214,6 +304,11 @@ void PDFXRefTable::readXRefTable(PDFParsingContext* context, const QByteArray& b
                         m_trailerDictionary = crossReferenceObject;
                     }
 
+                    if (m_revisions[currentRevision].trailerDictionary.isNull())
+                    {
+                        m_revisions[currentRevision].trailerDictionary = crossReferenceObject;
+                    }
+
                     auto readIntegerArray = [crossReferenceStreamDictionary](const char* key, auto defaultValues) -> std::vector<PDFInteger>
                     {
                         std::vector<PDFInteger> result;
@@ -294,11 +389,7 @@ void PDFXRefTable::readXRefTable(PDFParsingContext* context, const QByteArray& b
 
                         const PDFInteger lastObjectIndex = firstObjectNumber + count - 1;
                         const PDFInteger currentDesiredSize = lastObjectIndex + 1;
-
-                        if (static_cast<PDFInteger>(m_entries.size()) < currentDesiredSize)
-                        {
-                            m_entries.resize(currentDesiredSize);
-                        }
+                        resizeEntries(currentDesiredSize);
 
                         for (PDFInteger objectNumber = firstObjectNumber; objectNumber <= lastObjectIndex; ++ objectNumber)
                         {
@@ -310,6 +401,7 @@ void PDFXRefTable::readXRefTable(PDFParsingContext* context, const QByteArray& b
                             {
                                 case 0:
                                     // Free object
+                                    setEntry(objectNumber, Entry(), currentRevision);
                                     break;
 
                                 case 1:
@@ -318,11 +410,7 @@ void PDFXRefTable::readXRefTable(PDFParsingContext* context, const QByteArray& b
                                     entry.reference = PDFObjectReference(objectNumber, itemGenerationNumberOrObjectIndex);
                                     entry.offset = itemObjectNumberOfObjectStreamOrByteOffset;
                                     entry.type = EntryType::Occupied;
-
-                                    if (m_entries[objectNumber].type == EntryType::Free)
-                                    {
-                                        m_entries[objectNumber] = std::move(entry);
-                                    }
+                                    setEntry(objectNumber, std::move(entry), currentRevision);
                                     break;
                                 }
 
@@ -333,12 +421,7 @@ void PDFXRefTable::readXRefTable(PDFParsingContext* context, const QByteArray& b
                                     entry.objectStream = PDFObjectReference(itemObjectNumberOfObjectStreamOrByteOffset, 0);
                                     entry.indexInObjectStream = itemGenerationNumberOrObjectIndex;
                                     entry.type = EntryType::InObjectStream;
-
-                                    if (m_entries[objectNumber].type == EntryType::Free)
-                                    {
-                                        m_entries[objectNumber] = std::move(entry);
-                                    }
-
+                                    setEntry(objectNumber, std::move(entry), currentRevision);
                                     break;
                                 }
 
@@ -356,6 +439,18 @@ void PDFXRefTable::readXRefTable(PDFParsingContext* context, const QByteArray& b
             throw PDFException(tr("Invalid format of reference table."));
         }
     }
+
+    // Renumber revisions from the oldest one. Revision can be missing,
+    // if its section was already processed (cyclical references).
+    const int revisionCount = static_cast<int>(m_revisions.size());
+    for (int& revision : m_entryRevisions)
+    {
+        if (revision != -1)
+        {
+            revision = revisionCount - 1 - revision;
+        }
+    }
+    std::reverse(m_revisions.begin(), m_revisions.end());
 }
 
 std::vector<PDFXRefTable::Entry> PDFXRefTable::getOccupiedEntries() const
@@ -380,6 +475,190 @@ std::vector<PDFXRefTable::Entry> PDFXRefTable::getObjectStreamEntries() const
     return result;
 }
 
+void PDFXRefTable::setEntries(std::vector<Entry> entries, PDFObject trailerDictionary)
+{
+    m_entries = std::move(entries);
+    m_entryRevisions.clear();
+    m_revisions.clear();
+    m_trailerDictionary = std::move(trailerDictionary);
+}
+
+PDFInteger PDFXRefTable::readFixedWidthSubsections(const QByteArray& byteArray, PDFInteger offset, std::vector<Subsection>& subsections)
+{
+    // Each record has form "nnnnnnnnnn ggggg n" followed by two-character end of line
+    constexpr PDFInteger RECORD_SIZE = 20;
+    constexpr PDFInteger OFFSET_DIGITS = 10;
+    constexpr PDFInteger GENERATION_DIGITS = 5;
+
+    // Minimal count of records parsed by one worker
+    constexpr int RECORD_GRAIN_SIZE = 16384;
+
+    if (offset < 0 || offset >= byteArray.size())
+    {
+        return -1;
+    }
+
+    const char* const begin = byteArray.constData();
+    const char* const end = begin + byteArray.size();
+    const char* current = begin + offset;
+
+    auto isDigit = [](char character) { return character >= '0' && character <= '9'; };
+
+    auto skipWhitespace = [&]()
+    {
+        while (current != end && PDFLexicalAnalyzer::isWhitespace(*current))
+        {
+            ++current;
+        }
+    };
+
+    auto startsWith = [&](const char* keyword)
+    {
+        const PDFInteger length = std::strlen(keyword);
+        return end - current >= length && std::memcmp(current, keyword, length) == 0;
+    };
+
+    auto readInteger = [&](PDFInteger& value)
+    {
+        value = 0;
+        const char* start = current;
+        while (current != end && isDigit(*current) && current - start < 18)
+        {
+            value = value * 10 + (*current - '0');
+            ++current;
+        }
+        return current != start && (current == end || !isDigit(*current));
+    };
+
+    auto readDigits = [](const char* data, PDFInteger digits, PDFInteger& value)
+    {
+        value = 0;
+        for (PDFInteger i = 0; i < digits; ++i)
+        {
+            const unsigned int digit = static_cast<unsigned char>(data[i]) - unsigned('0');
+            if (digit >= 10)
+            {
+                return false;
+            }
+            value = value * 10 + digit;
+        }
+        return true;
+    };
+
+    skipWhitespace();
+    if (!startsWith(PDF_XREF_HEADER))
+    {
+        return -1;
+    }
+    current += std::strlen(PDF_XREF_HEADER);
+
+    while (true)
+    {
+        skipWhitespace();
+
+        if (startsWith(PDF_XREF_TRAILER))
+        {
+            return current - begin;
+        }
+
+        // Subsection header - first object number and count of records
+        PDFInteger firstObjectNumber = 0;
+        PDFInteger count = 0;
+
+        if (!readInteger(firstObjectNumber))
+        {
+            return -1;
+        }
+
+        while (current != end && (*current == CHAR_SPACE || *current == CHAR_TAB))
+        {
+            ++current;
+        }
+
+        if (!readInteger(count))
+        {
+            return -1;
+        }
+
+        // Header is terminated by the end of line, records follow immediately
+        skipWhitespace();
+
+        if (count > (end - current) / RECORD_SIZE || !isValidInteger(firstObjectNumber + count))
+        {
+            return -1;
+        }
+
+        Subsection subsection;
+        subsection.firstObjectNumber = firstObjectNumber;
+        subsection.entries.resize(count);
+
+        const char* const records = current;
+        std::atomic_bool isValid = true;
+
+        auto parseRecords = [&](PDFIntegerRange<PDFInteger>::Iterator it, PDFIntegerRange<PDFInteger>::Iterator itEnd)
+        {
+            for (; it != itEnd; ++it)
+            {
+                const PDFInteger index = *it;
+                const char* record = records + index * RECORD_SIZE;
+
+                PDFInteger entryOffset = 0;
+                PDFInteger generation = 0;
+
+                const bool isRecordValid = readDigits(record, OFFSET_DIGITS, entryOffset) &&
+                                           record[OFFSET_DIGITS] == CHAR_SPACE &&
+                                           readDigits(record + OFFSET_DIGITS + 1, GENERATION_DIGITS, generation) &&
+                                           record[OFFSET_DIGITS + GENERATION_DIGITS + 1] == CHAR_SPACE &&
+                                           (record[17] == 'n' || record[17] == 'f') &&
+                                           ((record[18] == CHAR_SPACE && (record[19] == CHAR_CARRIAGE_RETURN || record[19] == CHAR_LINE_FEED)) ||
+                                            (record[18] == CHAR_CARRIAGE_RETURN && record[19] == CHAR_LINE_FEED));
+
+                if (!isRecordValid)
+                {
+                    isValid.store(false, std::memory_order_relaxed);
+                    return;
+                }
+
+                if (record[17] == 'n')
+                {
+                    Entry& entry = subsection.entries[index];
+                    entry.reference = PDFObjectReference(firstObjectNumber + index, generation);
+                    entry.offset = entryOffset;
+                    entry.type = EntryType::Occupied;
+                }
+            }
+        };
+
+        PDFIntegerRange<PDFInteger> indices(0, count);
+        if (count >= RECORD_GRAIN_SIZE * 2)
+        {
+            PDFExecutionPolicy::executePartitioned(PDFExecutionPolicy::Scope::Unknown, indices.begin(), indices.end(), RECORD_GRAIN_SIZE, parseRecords);
+        }
+        else
+        {
+            parseRecords(indices.begin(), indices.end());
+        }
+
+        if (!isValid.load(std::memory_order_relaxed))
+        {
+            return -1;
+        }
+
+        current = records + count * RECORD_SIZE;
+        subsections.emplace_back(std::move(subsection));
+    }
+}
+
+int PDFXRefTable::getEntryRevision(PDFInteger objectNumber) const
+{
+    if (objectNumber >= 0 && objectNumber < static_cast<PDFInteger>(m_entryRevisions.size()))
+    {
+        return m_entryRevisions[objectNumber];
+    }
+
+    return -1;
+}
+
 const PDFXRefTable::Entry& PDFXRefTable::getEntry(PDFObjectReference reference) const
 {
     // We must also check generation number here. For this reason, we compare references of the entry at given position.
@@ -27,6 +27,7 @@
 #include "pdfobject.h"
 
 #include <vector>
+#include <functional>
 
 namespace pdf
 {
@@ -35,7 +36,7 @@ class PDFParsingContext;
 /// Represents table of references in the PDF file. It contains
 /// scanned table in the PDF file, together with information, if entry
 /// is occupied, or it is free.
-class PDFXRefTable
+class PDF4QTLIBCORESHARED_EXPORT PDFXRefTable
 {
     Q_DECLARE_TR_FUNCTIONS(pdf::PDFXRefTable)
 
@@ -66,12 +67,31 @@ public:
         EntryType type = EntryType::Free;
     };
 
+    /// Revision of the document. Each incremental update of the document creates
+    /// a new revision with its own section of the reference table, which refers
+    /// to the section of previous revision.
+    struct Revision
+    {
+        PDFInteger xrefOffset = -1;     ///< Offset of the newest section of the reference table of the revision
+        PDFInteger endOffset = -1;      ///< End of the revision data (after end of file mark)
+        PDFObject trailerDictionary;    ///< Trailer dictionary of the revision
+    };
+
     /// Tries to read reference table from the byte array. If error occurs, then exception
-    /// is raised. This fuction also checks redundant entries.
+    /// is raised. This fuction also checks redundant entries. Only the newest definition
+    /// of each object is used, object marked as free in newer revision is free, even if it
+    /// is occupied in older revision. Sections reached through /Prev entry, which lie after
+    /// the referring section (for example, main section of linearized document), belong
+    /// to the same revision.
     /// \param context Current parsing context
     /// \param byteArray Input byte array (containing the PDF file)
     /// \param startTableOffset Offset of first reference table
-    void readXRefTable(PDFParsingContext* context, const QByteArray& byteArray, PDFInteger startTableOffset);
+    /// \param sectionDataRequest If set, it is called with offset of each section of the
+    ///        reference table before it is read, so its data can be fetched
+    void readXRefTable(PDFParsingContext* context,
+                       const QByteArray& byteArray,
+                       PDFInteger startTableOffset,
+                       const std::function<void(PDFInteger)>& sectionDataRequest = nullptr);
 
     /// Filters only occupied entries and returns them
     std::vector<Entry> getOccupiedEntries() const;
@@ -82,6 +102,15 @@ public:
     /// Returns size of the reference table
     std::size_t getSize() const { return m_entries.size(); }
 
+    /// Returns all entries of the reference table (entry index is the object number)
+    const std::vector<Entry>& getEntries() const { return m_entries; }
+
+    /// Sets the reference table entries and the trailer dictionary, which
+    /// were read previously (for example, from document snapshot)
+    /// \param entries Entries (entry index must be the object number)
+    /// \param trailerDictionary Trailer dictionary
+    void setEntries(std::vector<Entry> entries, PDFObject trailerDictionary);
+
     /// Gets the entry for given reference. If entry for given reference is not found,
     /// then free entry is returned.
     const Entry& getEntry(PDFObjectReference reference) const;
@@ -89,10 +118,43 @@ public:
     /// Returns the trailer dictionary
     const PDFObject& getTrailerDictionary() const { return m_trailerDictionary; }
 
+    /// Returns revisions of the document, sorted from the oldest to the newest.
+    /// If entries were set using \p setEntries, then revisions are unknown.
+    const std::vector<Revision>& getRevisions() const { return m_revisions; }
+
+    /// Returns index of revision (into array returned by \p getRevisions), in which
+    /// entry of given object was defined. If entry was not defined (or revision is
+    /// unknown), then -1 is returned.
+    /// \param objectNumber Object number
+    int getEntryRevision(PDFInteger objectNumber) const;
+
 private:
+    /// Subsection of the classic reference table
+    struct Subsection
+    {
+        PDFInteger firstObjectNumber = 0;
+        std::vector<Entry> entries;
+    };
+
+    /// Reads subsections of the classic reference table section, which has records
+    /// of the fixed width (20 bytes) exactly according to the specification. Records
+    /// of large subsections are parsed in parallel. If section has different format
+    /// (or records are malformed), then -1 is returned and section must be read
+    /// by the tolerant parser. Otherwise offset of the trailer keyword is returned.
+    /// \param byteArray Byte array with the document data
+    /// \param offset Offset of the section (of the xref keyword)
+    /// \param subsections Parsed subsections
+    static PDFInteger readFixedWidthSubsections(const QByteArray& byteArray, PDFInteger offset, std::vector<Subsection>& subsections);
+
     /// Reference table entries
     std::vector<Entry> m_entries;
 
+    /// Revisions, in which entries were defined
+    std::vector<int> m_entryRevisions;
+
+    /// Revisions of the document
+    std::vector<Revision> m_revisions;
+
     /// Trailer dictionary
     PDFObject m_trailerDictionary;
 };
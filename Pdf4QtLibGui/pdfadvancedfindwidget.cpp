@@ -29,6 +29,7 @@
 #include "pdfdrawspacecontroller.h"
 
 #include <QMessageBox>
+#include <QtConcurrent/QtConcurrent>
 
 #include "pdfdbgheap.h"
 
@@ -39,7 +40,9 @@ PDFAdvancedFindWidget::PDFAdvancedFindWidget(pdf::PDFDrawWidgetProxy* proxy, QWi
     QWidget(parent),
     ui(new Ui::PDFAdvancedFindWidget),
     m_proxy(proxy),
-    m_document(nullptr)
+    m_document(nullptr),
+    m_isSearchCancelled(false),
+    m_searchId(0)
 {
     ui->setupUi(this);
 
@@ -54,6 +57,7 @@ PDFAdvancedFindWidget::PDFAdvancedFindWidget(pdf::PDFDrawWidgetProxy* proxy, QWi
 
 PDFAdvancedFindWidget::~PDFAdvancedFindWidget()
 {
+    cancelSearch();
     delete ui;
 }
 
@@ -67,6 +71,7 @@ void PDFAdvancedFindWidget::setDocument(const pdf::PDFModifiedDocument& document
         // so, there is no need to clear the results.
         if (document.hasReset() || document.hasPageContentsChanged())
         {
+            cancelSearch();
             m_findResults.clear();
             updateUI();
             updateResultsUI();
@@ -130,6 +135,7 @@ void PDFAdvancedFindWidget::on_searchButton_clicked()
         }
     }
 
+    cancelSearch();
     m_findResults.clear();
     m_textSelection.dirty();
     updateResultsUI();
@@ -147,8 +153,10 @@ void PDFAdvancedFindWidget::on_searchButton_clicked()
 
 void PDFAdvancedFindWidget::on_clearButton_clicked()
 {
+    cancelSearch();
     m_parameters = SearchParameters();
     m_findResults.clear();
+    m_textSelection.dirty();
     updateResultsUI();
 }
 
@@ -256,12 +264,30 @@ void PDFAdvancedFindWidget::performSearch()
         flowFlags |= pdf::PDFTextFlow::AddLineBreaks;
     }
 
-    const pdf::PDFTextLayoutStorage* textLayoutStorage = compiler->getTextLayoutStorage();
+    // Search is performed in the background thread on a copy of text layout storage
+    // (copy is cheap, data are implicitly shared), so storage can be changed
+    // during the search. Results are reported page by page, starting from
+    // the current page.
+    cancelSearch();
+    const quint64 searchId = ++m_searchId;
+    const pdf::PDFTextLayoutStorage textLayoutStorage = *compiler->getTextLayoutStorage();
+    const std::vector<pdf::PDFInteger> activePages = m_proxy->getActivePages();
+    const pdf::PDFInteger startPageIndex = !activePages.empty() ? activePages.front() : 0;
+
+    auto callback = [this, searchId](pdf::PDFInteger pageIndex, pdf::PDFFindResults results)
+    {
+        Q_UNUSED(pageIndex);
+        QMetaObject::invokeMethod(this, [this, searchId, results = qMove(results)]() { onResultsFound(searchId, results); }, Qt::QueuedConnection);
+    };
+
     if (!useRegularExpression)
     {
         // Use simple text search
         Qt::CaseSensitivity caseSensitivity = m_parameters.isCaseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive;
-        m_findResults = textLayoutStorage->find(expression, caseSensitivity, flowFlags);
+        m_searchFuture = QtConcurrent::run([this, textLayoutStorage, expression, caseSensitivity, flowFlags, startPageIndex, callback]()
+        {
+            textLayoutStorage.findIncremental(expression, caseSensitivity, flowFlags, startPageIndex, RESULT_LIMIT, this, callback);
+        });
     }
     else
     {
@@ -281,13 +307,57 @@ void PDFAdvancedFindWidget::performSearch()
         }
 
         QRegularExpression regularExpression(expression, patternOptions);
-        m_findResults = textLayoutStorage->find(regularExpression, flowFlags);
+        m_searchFuture = QtConcurrent::run([this, textLayoutStorage, regularExpression, flowFlags, startPageIndex, callback]()
+        {
+            textLayoutStorage.findIncremental(regularExpression, flowFlags, startPageIndex, RESULT_LIMIT, this, callback);
+        });
+    }
+}
+
+void PDFAdvancedFindWidget::cancelSearch()
+{
+    if (m_searchFuture.isRunning())
+    {
+        m_isSearchCancelled = true;
+        m_searchFuture.waitForFinished();
+    }
+
+    m_searchFuture = QFuture<void>();
+    m_isSearchCancelled = false;
+
+    // Results already posted by the cancelled search are ignored
+    ++m_searchId;
+}
+
+void PDFAdvancedFindWidget::onResultsFound(quint64 searchId, pdf::PDFFindResults results)
+{
+    if (searchId != m_searchId || results.empty())
+    {
+        return;
+    }
+
+    const int firstRow = int(m_findResults.size());
+    m_findResults.insert(m_findResults.end(), std::make_move_iterator(results.begin()), std::make_move_iterator(results.end()));
+
+    // Append only new rows, so table is not rebuilt each time new results arrive
+    ui->tabWidget->setTabText(ui->tabWidget->indexOf(ui->resultsTab), tr("Results (%1)").arg(m_findResults.size()));
+    ui->resultsTableWidget->setRowCount(static_cast<int>(m_findResults.size()));
+
+    for (int i = firstRow, rowCount = int(m_findResults.size()); i < rowCount; ++i)
+    {
+        const pdf::PDFFindResult& findResult = m_findResults[i];
+        ui->resultsTableWidget->setItem(i, 0, new QTableWidgetItem(QString::number(findResult.textSelectionItems.front().first.pageIndex + 1)));
+        ui->resultsTableWidget->setItem(i, 1, new QTableWidgetItem(findResult.matched));
+        ui->resultsTableWidget->setItem(i, 2, new QTableWidgetItem(findResult.context));
+    }
+
+    if (firstRow == 0)
+    {
+        ui->tabWidget->setCurrentWidget(ui->resultsTab);
     }
 
     m_textSelection.dirty();
     m_proxy->repaintNeeded();
-
-    updateResultsUI();
 }
 
 pdf::PDFTextSelection PDFAdvancedFindWidget::getTextSelectionImpl() const
@@ -26,8 +26,12 @@
 #include "pdfglobal.h"
 #include "pdfdrawspacecontroller.h"
 #include "pdftextlayout.h"
+#include "pdfoperationcontrol.h"
 
 #include <QWidget>
+#include <QFuture>
+
+#include <atomic>
 
 namespace Ui
 {
@@ -43,7 +47,7 @@ class PDFDrawWidgetProxy;
 namespace pdfviewer
 {
 
-class PDFAdvancedFindWidget : public QWidget, public pdf::IDocumentDrawInterface
+class PDFAdvancedFindWidget : public QWidget, public pdf::IDocumentDrawInterface, public pdf::PDFOperationControl
 {
     Q_OBJECT
 
@@ -68,6 +72,8 @@ public:
     /// but those, which are selected rows in the result table)
     pdf::PDFTextSelection getSelectedText() const;
 
+    virtual bool isOperationCancelled() const override { return m_isSearchCancelled; }
+
 protected:
     virtual void showEvent(QShowEvent* event) override;
     virtual void hideEvent(QHideEvent* event) override;
@@ -84,6 +90,14 @@ private:
     void updateResultsUI();
     void performSearch();
 
+    /// Cancels running search (if any) and waits until it is finished
+    void cancelSearch();
+
+    /// Appends results found on a single page by running search
+    /// \param searchId Id of the search, results from older searches are ignored
+    /// \param results Results found on the page
+    void onResultsFound(quint64 searchId, pdf::PDFFindResults results);
+
     pdf::PDFTextSelection getTextSelection() const { return m_textSelection.get(this, &PDFAdvancedFindWidget::getTextSelectionImpl); }
     pdf::PDFTextSelection getTextSelectionImpl() const;
 
@@ -99,6 +113,9 @@ private:
         bool isSoftHyphenRemoved = false;
     };
 
+    /// Maximal number of results of single search
+    static constexpr size_t RESULT_LIMIT = 50000;
+
     Ui::PDFAdvancedFindWidget* ui;
 
     pdf::PDFDrawWidgetProxy* m_proxy;
@@ -106,6 +123,9 @@ private:
     SearchParameters m_parameters;
     pdf::PDFFindResults m_findResults;
     mutable pdf::PDFCachedItem<pdf::PDFTextSelection> m_textSelection;
+    QFuture<void> m_searchFuture;
+    std::atomic_bool m_isSearchCancelled;
+    quint64 m_searchId;
 };
 
 }   // namespace pdfviewer
@@ -218,25 +218,7 @@ void PDFCreateBitonalDocumentDialog::createBitonalDocument()
 
         if (imageConversion.convert())
         {
-            QImage bitonalImage = imageConversion.getConvertedImage();
-            Q_ASSERT(bitonalImage.format() == QImage::Format_Mono);
-
-            pdf::PDFBitWriter bitWriter(1);
-            bitWriter.reserve(bitonalImage.sizeInBytes());
-            for (int row = 0; row < bitonalImage.height(); ++row)
-            {
-                for (int col = 0; col < bitonalImage.width(); ++col)
-                {
-                    QRgb pixelValue = bitonalImage.pixel(col, row);
-                    QRgb withoutAlphaValue = pixelValue & 0xFFFFFF;
-                    int value = withoutAlphaValue > 0 ? 1 : 0;
-                    bitWriter.write(value);
-                }
-
-                bitWriter.finishLine();
-            }
-
-            QByteArray imageData = bitWriter.takeByteArray();
+            QByteArray imageData = imageConversion.getConvertedImageData();
             QByteArray compressedData = pdf::PDFFlateDecodeFilter::compress(imageData);
 
             pdf::PDFArray array;
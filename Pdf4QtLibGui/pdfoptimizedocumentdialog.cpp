@@ -61,6 +61,8 @@ PDFOptimizeDocumentDialog::PDFOptimizeDocumentDialog(const pdf::PDFDocument* doc
     addCheckBox(tr("Merge identical objects"), pdf::PDFOptimizer::MergeIdenticalObjects);
     addCheckBox(tr("Shrink object storage (squeeze free entries)"), pdf::PDFOptimizer::ShrinkObjectStorage);
     addCheckBox(tr("Recompress flate streams by maximal compression"), pdf::PDFOptimizer::RecompressFlateStreams);
+    addCheckBox(tr("Downsample and recompress images with too high resolution (lossy)"), pdf::PDFOptimizer::DownsampleImages);
+    addCheckBox(tr("Subset embedded fonts (remove unused glyphs)"), pdf::PDFOptimizer::SubsetFonts);
 
     m_optimizeButton = ui->buttonBox->addButton(tr("Optimize"), QDialogButtonBox::ActionRole);
 
@@ -30,6 +30,7 @@
 #include "pdfwidgetutils.h"
 #include "pdfconstants.h"
 #include "pdfdocumentbuilder.h"
+#include "pdfdocumentregistry.h"
 #include "pdfcertificatemanagerdialog.h"
 #include "pdfwidgetutils.h"
 
@@ -49,6 +50,7 @@
 #include "pdfwidgetannotation.h"
 #include "pdfwidgetformmanager.h"
 #include "pdfactioncombobox.h"
+#include "pdftracing.h"
 
 #include <QMenu>
 #include <QPrinter>
@@ -58,6 +60,7 @@
 #include <QApplication>
 #include <QFileDialog>
 #include <QtConcurrent/QtConcurrent>
+#include <QThreadPool>
 #include <QInputDialog>
 #include <QMainWindow>
 #include <QToolBar>
@@ -188,6 +191,18 @@ void PDFActionManager::addAdditionalAction(QAction* action)
     m_additionalActions.push_back(action);
 }
 
+void PDFActionManager::replaceAdditionalAction(QAction* oldAction, QAction* newAction)
+{
+    if (newAction)
+    {
+        std::replace(m_additionalActions.begin(), m_additionalActions.end(), oldAction, newAction);
+    }
+    else
+    {
+        std::erase(m_additionalActions, oldAction);
+    }
+}
+
 void PDFActionManager::initActions(QSize iconSize, bool initializeStampActions)
 {
     setShortcut(Open, QKeySequence::Open);
@@ -328,6 +343,14 @@ void PDFActionManager::styleActions()
     }
 }
 
+void PDFActionManager::styleActions(const std::vector<QAction*>& actions)
+{
+    if (pdf::PDFWidgetUtils::isDarkTheme())
+    {
+        pdf::PDFWidgetUtils::convertActionsForDarkTheme(actions, m_iconSize, qGuiApp->devicePixelRatio());
+    }
+}
+
 bool PDFActionManager::hasActions(const std::initializer_list<Action>& actionTypes) const
 {
     for (Action actionType : actionTypes)
@@ -366,6 +389,7 @@ PDFProgramController::PDFProgramController(QObject* parent) :
     m_settings(new PDFViewerSettings(this)),
     m_undoRedoManager(nullptr),
     m_recentFileManager(new PDFRecentFileManager(this)),
+    m_recentFilePreloader(new PDFRecentFilePreloader(m_recentFileManager, this)),
     m_optionalContentActivity(nullptr),
     m_textToSpeech(nullptr),
     m_isDocumentSetInProgress(false),
@@ -381,6 +405,7 @@ PDFProgramController::PDFProgramController(QObject* parent) :
     m_progress(nullptr),
     m_loadAllPlugins(false)
 {
+    m_CMSManager->setAsynchronousProfileEnumeration(true);
     connect(&m_fileWatcher, &QFileSystemWatcher::fileChanged, this, &PDFProgramController::onFileChanged);
 }
 
@@ -542,6 +567,10 @@ void PDFProgramController::initialize(Features features,
     {
         connect(action, &QAction::triggered, this, &PDFProgramController::onActionRenderingErrorsTriggered);
     }
+    if (QAction* action = m_actionManager->getAction(PDFActionManager::RecordPerformanceTrace))
+    {
+        connect(action, &QAction::triggered, this, &PDFProgramController::onActionRecordPerformanceTraceTriggered);
+    }
     if (QAction* action = m_actionManager->getAction(PDFActionManager::PageLayoutSinglePage))
     {
         connect(action, &QAction::triggered, this, &PDFProgramController::onActionPageLayoutSinglePageTriggered);
@@ -788,6 +817,14 @@ void PDFProgramController::performPrint()
         info.text = tr("Printing document");
         m_progress->start(pageIndices.size(), qMove(info));
         printer.setFullPage(true);
+
+        if (m_settings->getSettings().m_rasterizedPrinting)
+        {
+            printPagesRasterized(&printer, pageIndices);
+            m_progress->finish();
+            return;
+        }
+
         QPainter painter(&printer);
 
         const pdf::PDFCatalog* catalog = m_pdfDocument->getCatalog();
@@ -825,6 +862,110 @@ void PDFProgramController::performPrint()
     }
 }
 
+void PDFProgramController::printPagesRasterized(QPrinter* printer, const std::vector<pdf::PDFInteger>& pageIndices)
+{
+    struct PrintedBand
+    {
+        QRectF targetRect;              ///< Target rectangle on the paper (in device pixels)
+        bool isLastBandOfPage = false;
+    };
+
+    const pdf::PDFCatalog* catalog = m_pdfDocument->getCatalog();
+    pdf::PDFDrawWidgetProxy* proxy = m_pdfWidget->getDrawWidgetProxy();
+    pdf::PDFOptionalContentActivity optionalContentActivity(m_pdfDocument.data(), pdf::OCUsage::Print, nullptr);
+    pdf::PDFRasterizerPool rasterizerPool(m_pdfDocument.data(), proxy->getFontCache(), proxy->getCMSManager(),
+                                          &optionalContentActivity, proxy->getFeatures(), proxy->getMeshQualitySettings(),
+                                          pdf::PDFRasterizerPool::getDefaultRasterizerCount(), proxy->getRendererEngine(), nullptr);
+
+    // Split pages into bands. Band images have whole pixel rows, so there
+    // are no seams between bands on the paper.
+    std::vector<pdf::PDFRasterizerTile> tiles;
+    std::vector<PrintedBand> bands;
+    const QRectF paperRect = printer->pageLayout().fullRectPixels(printer->resolution());
+    for (const pdf::PDFInteger pageIndex : pageIndices)
+    {
+        const pdf::PDFPage* page = catalog->getPage(pageIndex);
+        Q_ASSERT(page);
+
+        QRectF targetRect = page->getRotatedMediaBox();
+        targetRect.setSize(targetRect.size().scaled(paperRect.size(), Qt::KeepAspectRatio));
+        targetRect.moveCenter(paperRect.center());
+
+        const QSize imageSize = targetRect.size().toSize().expandedTo(QSize(1, 1));
+        const int bandHeight = qBound(1, int(PRINT_BAND_SIZE_LIMIT / (qint64(imageSize.width()) * 4)), imageSize.height());
+        const QTransform deviceToPageMatrix = pdf::PDFRenderer::createPagePointToDevicePointMatrix(page, QRectF(QPointF(0, 0), imageSize)).inverted();
+        const pdf::PDFReal scaleY = targetRect.height() / imageSize.height();
+
+        for (int top = 0; top < imageSize.height(); top += bandHeight)
+        {
+            const int height = qMin(bandHeight, imageSize.height() - top);
+
+            pdf::PDFRasterizerTile tile;
+            tile.pageIndex = pageIndex;
+            tile.pageRect = deviceToPageMatrix.mapRect(QRectF(0, top, imageSize.width(), height));
+            tile.imageSize = QSize(imageSize.width(), height);
+            tiles.push_back(tile);
+
+            PrintedBand band;
+            band.targetRect = QRectF(targetRect.left(), targetRect.top() + top * scaleY, targetRect.width(), height * scaleY);
+            band.isLastBandOfPage = top + height >= imageSize.height();
+            bands.push_back(band);
+        }
+    }
+
+    auto renderChunk = [&rasterizerPool, &tiles](size_t chunkBegin, size_t chunkEnd)
+    {
+        std::vector<pdf::PDFRasterizerTile> chunkTiles(tiles.cbegin() + chunkBegin, tiles.cbegin() + chunkEnd);
+        std::vector<QImage> images(chunkTiles.size());
+        auto onTileRendered = [&images](pdf::PDFRenderedTileImage& renderedTileImage)
+        {
+            images[renderedTileImage.tileIndex] = qMove(renderedTileImage.tileImage);
+        };
+        rasterizerPool.renderTiles(chunkTiles, onTileRendered, nullptr);
+        return images;
+    };
+
+    // Rendering of the next chunk of bands runs ahead of the printer
+    const size_t chunkSize = size_t(pdf::PDFRasterizerPool::getDefaultRasterizerCount()) * 2;
+    QFuture<std::vector<QImage>> future = QtConcurrent::run(renderChunk, size_t(0), qMin(chunkSize, tiles.size()));
+
+    QPainter painter(printer);
+    bool isPrinterReady = true;
+    for (size_t chunkBegin = 0; isPrinterReady && chunkBegin < tiles.size(); chunkBegin += chunkSize)
+    {
+        const size_t chunkEnd = qMin(chunkBegin + chunkSize, tiles.size());
+        std::vector<QImage> images = future.result();
+
+        if (chunkEnd < tiles.size())
+        {
+            future = QtConcurrent::run(renderChunk, chunkEnd, qMin(chunkEnd + chunkSize, tiles.size()));
+        }
+
+        for (size_t i = chunkBegin; i < chunkEnd; ++i)
+        {
+            QImage& image = images[i - chunkBegin];
+            const PrintedBand& band = bands[i];
+            painter.drawImage(band.targetRect, image);
+            image = QImage();
+
+            if (band.isLastBandOfPage)
+            {
+                m_progress->step();
+
+                if (i + 1 < tiles.size() && !printer->newPage())
+                {
+                    isPrinterReady = false;
+                    break;
+                }
+            }
+        }
+    }
+
+    // Chunk rendered in advance refers to local variables, we must wait for it
+    future.waitForFinished();
+    painter.end();
+}
+
 void PDFProgramController::onActionTriggered(const pdf::PDFAction* action)
 {
     Q_ASSERT(action);
@@ -1169,10 +1310,12 @@ void PDFProgramController::onActionRenderingOptionTriggered(bool checked)
 void PDFProgramController::performSaveAs()
 {
     QFileInfo fileInfo(m_fileInfo.originalFileName);
-    QString saveFileName = QFileDialog::getSaveFileName(m_mainWindow, tr("Save As"), fileInfo.dir().absoluteFilePath(m_fileInfo.originalFileName), tr("Portable Document (*.pdf);;All files (*.*)"));
+    const QString linearizedFilter = tr("Portable Document, Fast Web View (*.pdf)");
+    QString selectedFilter;
+    QString saveFileName = QFileDialog::getSaveFileName(m_mainWindow, tr("Save As"), fileInfo.dir().absoluteFilePath(m_fileInfo.originalFileName), tr("Portable Document (*.pdf);;%1;;All files (*.*)").arg(linearizedFilter), &selectedFilter);
     if (!saveFileName.isEmpty())
     {
-        saveDocument(saveFileName);
+        saveDocument(saveFileName, selectedFilter == linearizedFilter ? pdf::PDFDocumentWriter::Mode::Linearized : pdf::PDFDocumentWriter::Mode::Classic);
     }
 }
 
@@ -1181,11 +1324,12 @@ void PDFProgramController::performSave()
     saveDocument(m_fileInfo.originalFileName);
 }
 
-void PDFProgramController::saveDocument(const QString& fileName)
+void PDFProgramController::saveDocument(const QString& fileName, pdf::PDFDocumentWriter::Mode mode)
 {
     updateFileWatcher(true);
 
     pdf::PDFDocumentWriter writer(nullptr);
+    writer.setMode(mode);
     pdf::PDFOperationResult result = writer.write(fileName, m_pdfDocument.data(), true);
     if (result)
     {
@@ -1562,6 +1706,29 @@ void PDFProgramController::onActionRenderingErrorsTriggered()
     renderingErrorsDialog.exec();
 }
 
+void PDFProgramController::onActionRecordPerformanceTraceTriggered(bool checked)
+{
+    if (checked)
+    {
+        pdf::PDFTracing::start();
+        return;
+    }
+
+    pdf::PDFTracing::stop();
+
+    QString fileName = QFileDialog::getSaveFileName(m_mainWindow, tr("Save Performance Trace"), QString(), tr("Chrome trace (*.json);;All files (*.*)"));
+    if (!fileName.isEmpty())
+    {
+        pdf::PDFOperationResult result = pdf::PDFTracing::exportChromeTrace(fileName);
+        if (!result)
+        {
+            QMessageBox::critical(m_mainWindow, tr("Error"), result.getErrorMessage());
+        }
+    }
+
+    pdf::PDFTracing::clear();
+}
+
 void PDFProgramController::updateMagnifierToolSettings()
 {
     if (m_toolManager)
@@ -1578,6 +1745,7 @@ void PDFProgramController::updateUndoRedoSettings()
     {
         const PDFViewerSettings::Settings& settings = m_settings->getSettings();
         m_undoRedoManager->setMaximumSteps(settings.m_maximumUndoSteps, settings.m_maximumRedoSteps);
+        m_undoRedoManager->setMemoryLimit(qint64(settings.m_undoRedoMemoryLimit) * 1024 * 1024);
     }
 }
 
@@ -1781,6 +1949,15 @@ void PDFProgramController::updateActionsAvailability()
     m_actionManager->setEnabled(PDFActionManager::SaveAs, hasValidDocument);
     m_actionManager->setEnabled(PDFActionManager::Properties, hasDocument);
     m_actionManager->setEnabled(PDFActionManager::SendByMail, hasDocument);
+
+    for (const LazyPlugin& lazyPlugin : m_lazyPlugins)
+    {
+        for (QAction* action : lazyPlugin.placeholderActions)
+        {
+            action->setEnabled(hasValidDocument);
+        }
+    }
+
     m_mainWindow->setEnabled(!isBusy);
     updateUndoRedoActions();
 }
@@ -1796,6 +1973,7 @@ void PDFProgramController::onViewerSettingsChanged()
     m_annotationManager->setFeatures(m_settings->getFeatures());
     m_annotationManager->setMeshQualitySettings(m_pdfWidget->getDrawWidgetProxy()->getMeshQualitySettings());
     pdf::PDFExecutionPolicy::setStrategy(m_settings->getMultithreadingStrategy());
+    m_recentFilePreloader->setEnabled(m_settings->isRecentFilesPreloadingEnabled());
 
     updateRenderingOptionActions();
 }
@@ -1905,6 +2083,35 @@ void PDFProgramController::openDocument(const QString& fileName)
     {
         AsyncReadingResult result;
 
+        auto verifySignatures = [this](const pdf::PDFDocument* document, const QByteArray& sourceData)
+        {
+            pdf::PDFSignatureHandler::Parameters parameters;
+            parameters.store = &m_certificateStore;
+            parameters.dss = &document->getCatalog()->getDocumentSecurityStore();
+            parameters.enableVerification = m_settings->getSettings().m_signatureVerificationEnabled;
+            parameters.ignoreExpirationDate = m_settings->getSettings().m_signatureIgnoreCertificateValidityTime;
+            parameters.useSystemCertificateStore = m_settings->getSettings().m_signatureUseSystemStore;
+
+            pdf::PDFForm form = pdf::PDFForm::parse(document, document->getCatalog()->getFormObject());
+            return pdf::PDFSignatureHandler::verifySignatures(form, sourceData, parameters);
+        };
+
+        // If document was already opened, then registered document is used
+        // and file doesn't have to be parsed again.
+        pdf::PDFDocumentRegistry* registry = pdf::PDFDocumentRegistry::getInstance();
+        if (pdf::PDFDocumentPointer registeredDocument = registry->getDocument(fileName))
+        {
+            QFile file(fileName);
+            if (file.open(QFile::ReadOnly))
+            {
+                result.signatures = verifySignatures(registeredDocument.data(), file.readAll());
+                result.result = pdf::PDFDocumentReader::Result::OK;
+                result.document = qMove(registeredDocument);
+                file.close();
+                return result;
+            }
+        }
+
         auto queryPassword = [this](bool* ok)
         {
             QString result;
@@ -1921,17 +2128,8 @@ void PDFProgramController::openDocument(const QString& fileName)
         result.result = reader.getReadingResult();
         if (result.result == pdf::PDFDocumentReader::Result::OK)
         {
-            // Verify signatures
-            pdf::PDFSignatureHandler::Parameters parameters;
-            parameters.store = &m_certificateStore;
-            parameters.dss = &document.getCatalog()->getDocumentSecurityStore();
-            parameters.enableVerification = m_settings->getSettings().m_signatureVerificationEnabled;
-            parameters.ignoreExpirationDate = m_settings->getSettings().m_signatureIgnoreCertificateValidityTime;
-            parameters.useSystemCertificateStore = m_settings->getSettings().m_signatureUseSystemStore;
-
-            pdf::PDFForm form = pdf::PDFForm::parse(&document, document.getCatalog()->getFormObject());
-            result.signatures = pdf::PDFSignatureHandler::verifySignatures(form, reader.getSource(), parameters);
-            result.document.reset(new pdf::PDFDocument(qMove(document)));
+            result.signatures = verifySignatures(&document, reader.getSource());
+            result.document = registry->registerDocument(fileName, pdf::PDFDocumentPointer(new pdf::PDFDocument(qMove(document))));
         }
 
         return result;
@@ -1968,6 +2166,11 @@ void PDFProgramController::onDocumentReadingFinished()
             pdf::PDFModifiedDocument document(m_pdfDocument.data(), m_optionalContentActivity);
             setDocument(document, m_signatures, true);
 
+            // Named destinations are looked up lazily, build their index in the background,
+            // document is kept alive by the shared pointer until the job finishes.
+            pdf::PDFDocumentPointer namedDestinationsDocument = m_pdfDocument;
+            QThreadPool::globalInstance()->start([namedDestinationsDocument]() { namedDestinationsDocument->getCatalog()->buildNamedDestinationsIndex(); });
+
             if (m_formManager)
             {
                 m_formManager->performPaging();
@@ -2281,25 +2484,39 @@ void PDFProgramController::loadPlugins()
     {
         QString pluginFileName = directory.absoluteFilePath(availablePlugin);
         QPluginLoader loader(pluginFileName);
-        if (loader.load())
+
+        // Metadata are read without loading the plugin library
+        QJsonObject metaData = loader.metaData();
+        if (metaData.isEmpty())
         {
-            QJsonObject metaData = loader.metaData();
-            m_plugins.emplace_back(pdf::PDFPluginInfo::loadFromJson(&metaData));
-            m_plugins.back().pluginFile = availablePlugin;
-            m_plugins.back().pluginFileWithPath = pluginFileName;
+            continue;
+        }
 
-            QString pluginName = m_plugins.back().name;
-            if (!m_enabledPlugins.contains(pluginName) && !m_loadAllPlugins)
-            {
-                loader.unload();
-                continue;
-            }
+        m_plugins.emplace_back(pdf::PDFPluginInfo::loadFromJson(&metaData));
+        m_plugins.back().pluginFile = availablePlugin;
+        m_plugins.back().pluginFileWithPath = pluginFileName;
 
-            if (m_loadAllPlugins)
-            {
-                m_enabledPlugins << pluginName;
-            }
+        QString pluginName = m_plugins.back().name;
+        if (!m_enabledPlugins.contains(pluginName) && !m_loadAllPlugins)
+        {
+            continue;
+        }
+
+        if (m_loadAllPlugins)
+        {
+            m_enabledPlugins << pluginName;
+        }
+
+        if (m_plugins.back().isLazyLoaded)
+        {
+            LazyPlugin lazyPlugin;
+            lazyPlugin.info = m_plugins.back();
+            m_lazyPlugins.emplace_back(std::move(lazyPlugin));
+            continue;
+        }
 
+        if (loader.load())
+        {
             pdf::PDFPlugin* plugin = qobject_cast<pdf::PDFPlugin*>(loader.instance());
             if (plugin)
             {
@@ -2317,10 +2534,7 @@ void PDFProgramController::loadPlugins()
 
     for (const auto& plugin : m_loadedPlugins)
     {
-        plugin.second->setDataExchangeInterface(this);
-        plugin.second->setWidget(m_pdfWidget);
-        plugin.second->setCMSManager(m_CMSManager);
-        std::vector<QAction*> actions = plugin.second->getActions();
+        std::vector<QAction*> actions = initializePlugin(plugin.second);
 
         if (!actions.empty())
         {
@@ -2344,6 +2558,131 @@ void PDFProgramController::loadPlugins()
             }
         }
     }
+
+    // Lazily loaded plugins have placeholder actions created from the metadata,
+    // plugin library is loaded, when one of the actions is triggered.
+    std::sort(m_lazyPlugins.begin(), m_lazyPlugins.end(), [](const LazyPlugin& l, const LazyPlugin& r) { return l.info.name < r.info.name; });
+    for (LazyPlugin& lazyPlugin : m_lazyPlugins)
+    {
+        const QString pluginName = lazyPlugin.info.name;
+
+        lazyPlugin.toolBar = m_mainWindow->addToolBar(pluginName);
+        lazyPlugin.toolBar->setObjectName(QString("Plugin_Toolbar_%1").arg(pluginName));
+        m_mainWindowInterface->adjustToolbar(lazyPlugin.toolBar);
+        lazyPlugin.menu = m_mainWindowInterface->addToolMenu(lazyPlugin.info.menuName);
+
+        for (const pdf::PDFPluginActionInfo& actionInfo : lazyPlugin.info.actions)
+        {
+            if (actionInfo.isSeparator)
+            {
+                lazyPlugin.menu->addSeparator();
+                lazyPlugin.toolBar->addSeparator();
+                continue;
+            }
+
+            QAction* action = new QAction(actionInfo.text, this);
+            action->setObjectName(actionInfo.objectName);
+            action->setEnabled(false);
+            connect(action, &QAction::triggered, this, [this, pluginName, objectName = actionInfo.objectName]() { activateLazyPlugin(pluginName, objectName); }, Qt::QueuedConnection);
+
+            m_actionManager->addAdditionalAction(action);
+
+            lazyPlugin.menu->addAction(action);
+            lazyPlugin.toolBar->addAction(action);
+            lazyPlugin.placeholderActions.push_back(action);
+        }
+    }
+}
+
+std::vector<QAction*> PDFProgramController::initializePlugin(pdf::PDFPlugin* plugin)
+{
+    plugin->setDataExchangeInterface(this);
+    plugin->setWidget(m_pdfWidget);
+    plugin->setCMSManager(m_CMSManager);
+    return plugin->getActions();
+}
+
+void PDFProgramController::activateLazyPlugin(QString pluginName, QString actionObjectName)
+{
+    auto it = std::find_if(m_lazyPlugins.begin(), m_lazyPlugins.end(), [&pluginName](const LazyPlugin& lazyPlugin) { return lazyPlugin.info.name == pluginName; });
+    if (it == m_lazyPlugins.end())
+    {
+        return;
+    }
+
+    LazyPlugin lazyPlugin = std::move(*it);
+    m_lazyPlugins.erase(it);
+
+    QPluginLoader loader(lazyPlugin.info.pluginFileWithPath);
+    pdf::PDFPlugin* plugin = loader.load() ? qobject_cast<pdf::PDFPlugin*>(loader.instance()) : nullptr;
+    if (!plugin)
+    {
+        QMessageBox::critical(m_mainWindow, tr("Error"), tr("Plugin '%1' cannot be loaded. %2").arg(pluginName, loader.errorString()));
+
+        for (QAction* placeholderAction : lazyPlugin.placeholderActions)
+        {
+            placeholderAction->setEnabled(false);
+        }
+        return;
+    }
+
+    m_loadedPlugins.push_back(std::make_pair(lazyPlugin.info, plugin));
+    std::vector<QAction*> actions = initializePlugin(plugin);
+
+    if (m_pdfDocument)
+    {
+        plugin->setDocument(pdf::PDFModifiedDocument(m_pdfDocument.data(), m_optionalContentActivity));
+    }
+
+    // Replace placeholders by the plugin actions (shortcuts, which were
+    // assigned to the placeholders, are kept). Actions without placeholder
+    // are appended to the end of the menu and tool bar.
+    QAction* triggeredAction = nullptr;
+    for (QAction* action : actions)
+    {
+        if (!action)
+        {
+            continue;
+        }
+
+        auto itPlaceholder = std::find_if(lazyPlugin.placeholderActions.begin(), lazyPlugin.placeholderActions.end(), [action](QAction* placeholderAction) { return placeholderAction->objectName() == action->objectName(); });
+        if (itPlaceholder != lazyPlugin.placeholderActions.end())
+        {
+            QAction* placeholderAction = *itPlaceholder;
+            action->setShortcuts(placeholderAction->shortcuts());
+            lazyPlugin.menu->insertAction(placeholderAction, action);
+            lazyPlugin.toolBar->insertAction(placeholderAction, action);
+            m_actionManager->replaceAdditionalAction(placeholderAction, action);
+            lazyPlugin.placeholderActions.erase(itPlaceholder);
+            delete placeholderAction;
+        }
+        else
+        {
+            lazyPlugin.menu->addAction(action);
+            lazyPlugin.toolBar->addAction(action);
+            m_actionManager->addAdditionalAction(action);
+        }
+
+        if (action->objectName() == actionObjectName)
+        {
+            triggeredAction = action;
+        }
+    }
+
+    // Placeholders, which don't have a corresponding action
+    // in the plugin, are obsolete and are removed.
+    for (QAction* placeholderAction : lazyPlugin.placeholderActions)
+    {
+        m_actionManager->replaceAdditionalAction(placeholderAction, nullptr);
+        delete placeholderAction;
+    }
+
+    m_actionManager->styleActions(actions);
+
+    if (triggeredAction && triggeredAction->isEnabled())
+    {
+        triggeredAction->trigger();
+    }
 }
 
 void PDFProgramController::writeSettings()
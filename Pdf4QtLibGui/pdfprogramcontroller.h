@@ -27,6 +27,7 @@
 #include "pdfdocument.h"
 #include "pdfsignaturehandler.h"
 #include "pdfdocumentreader.h"
+#include "pdfdocumentwriter.h"
 #include "pdfdocumentpropertiesdialog.h"
 #include "pdfplugin.h"
 #include "pdfbookmarkmanager.h"
@@ -42,6 +43,7 @@
 class QMainWindow;
 class QComboBox;
 class QToolBar;
+class QPrinter;
 
 namespace pdf
 {
@@ -58,6 +60,7 @@ namespace pdfviewer
 class PDFViewerSettings;
 class PDFUndoRedoManager;
 class PDFRecentFileManager;
+class PDFRecentFilePreloader;
 class PDFTextToSpeech;
 class PDFActionComboBox;
 
@@ -125,6 +128,7 @@ public:
         FitWidth,
         FitHeight,
         ShowRenderingErrors,
+        RecordPerformanceTrace,
         GoToDocumentStart,
         GoToDocumentEnd,
         GoToNextPage,
@@ -245,9 +249,20 @@ public:
     /// Adds additional action to action manager
     void addAdditionalAction(QAction* action);
 
+    /// Replaces additional action by another action. If \p oldAction
+    /// is not an additional action, then nothing happens. If \p newAction
+    /// is nullptr, then old action is just removed.
+    /// \param oldAction Old action
+    /// \param newAction New action
+    void replaceAdditionalAction(QAction* oldAction, QAction* newAction);
+
     void initActions(QSize iconSize, bool initializeStampActions);
     void styleActions();
 
+    /// Styles actions, which were added after all actions were styled
+    /// \param actions Actions
+    void styleActions(const std::vector<QAction*>& actions);
+
 private:
     bool hasActions(const std::initializer_list<Action>& actionTypes) const;
     std::vector<QAction*> getActionList(const std::initializer_list<Action>& actionTypes) const;
@@ -340,6 +355,17 @@ private:
         std::vector<pdf::PDFSignatureVerificationResult> signatures;
     };
 
+    /// Maximal size of the image of one band in rasterized printing (in bytes)
+    static constexpr qint64 PRINT_BAND_SIZE_LIMIT = 16 * 1024 * 1024;
+
+    /// Prints pages as images. Pages are split into horizontal bands, which are rendered
+    /// at printer resolution by rasterizer pool. Bands are rendered in chunks in the
+    /// background, while previous chunk is sent to the printer, so only two chunks
+    /// of bands are held in the memory, regardless of paper size.
+    /// \param printer Printer
+    /// \param pageIndices Indices of printed pages
+    void printPagesRasterized(QPrinter* printer, const std::vector<pdf::PDFInteger>& pageIndices);
+
     void initializeToolManager();
     void initializeAnnotationManager();
     void initializeFormManager();
@@ -369,6 +395,7 @@ private:
     void onActionFitWidthTriggered();
     void onActionFitHeightTriggered();
     void onActionRenderingErrorsTriggered();
+    void onActionRecordPerformanceTraceTriggered(bool checked);
     void onActionPageLayoutSinglePageTriggered();
     void onActionPageLayoutContinuousTriggered();
     void onActionPageLayoutTwoPagesTriggered();
@@ -427,7 +454,27 @@ private:
     void loadPlugins();
     void readSettings(Settings settings);
 
-    void saveDocument(const QString& fileName);
+    /// Initializes loaded plugin and returns its actions
+    /// \param plugin Plugin
+    std::vector<QAction*> initializePlugin(pdf::PDFPlugin* plugin);
+
+    /// Loads lazily loaded plugin, replaces its placeholder actions
+    /// by the plugin actions, and triggers the plugin action.
+    /// \param pluginName Name of the plugin
+    /// \param actionObjectName Object name of the triggered action
+    void activateLazyPlugin(QString pluginName, QString actionObjectName);
+
+    /// Plugin, which library is loaded, when one of its actions
+    /// is triggered for the first time.
+    struct LazyPlugin
+    {
+        pdf::PDFPluginInfo info;
+        QMenu* menu = nullptr;
+        QToolBar* toolBar = nullptr;
+        std::vector<QAction*> placeholderActions;
+    };
+
+    void saveDocument(const QString& fileName, pdf::PDFDocumentWriter::Mode mode = pdf::PDFDocumentWriter::Mode::Classic);
     void savePageLayoutPerDocument();
 
     PDFActionManager* m_actionManager;
@@ -437,6 +484,7 @@ private:
     PDFViewerSettings* m_settings;
     PDFUndoRedoManager* m_undoRedoManager;
     PDFRecentFileManager* m_recentFileManager;
+    PDFRecentFilePreloader* m_recentFilePreloader;
     pdf::PDFOptionalContentActivity* m_optionalContentActivity;
     pdf::PDFDocumentPointer m_pdfDocument;
     PDFTextToSpeech* m_textToSpeech;
@@ -465,6 +513,7 @@ private:
     bool m_loadAllPlugins;
     pdf::PDFPluginInfos m_plugins;
     std::vector<std::pair<pdf::PDFPluginInfo, pdf::PDFPlugin*>> m_loadedPlugins;
+    std::vector<LazyPlugin> m_lazyPlugins;
 };
 
 }   // namespace pdfviewer
@@ -21,10 +21,14 @@
 // SOFTWARE.
 
 #include "pdfrecentfilemanager.h"
+#include "pdfdocumentreader.h"
+#include "pdfdocumentregistry.h"
 #include "pdfdbgheap.h"
 
 #include <QFontMetrics>
 #include <QAction>
+#include <QFileInfo>
+#include <QApplication>
 
 namespace pdfviewer
 {
@@ -152,4 +156,168 @@ void PDFRecentFileManager::setClearRecentFileHistoryAction(QAction* newClearRece
     updateClearRecentFileAction();
 }
 
+PDFRecentFilePreloader::PDFRecentFilePreloader(PDFRecentFileManager* recentFileManager, QObject* parent) :
+    BaseClass(parent),
+    m_recentFileManager(recentFileManager)
+{
+    m_threadPool.setMaxThreadCount(1);
+    m_threadPool.setThreadPriority(QThread::LowestPriority);
+
+    m_idleTimer.setSingleShot(true);
+    m_idleTimer.setInterval(IDLE_INTERVAL);
+    connect(&m_idleTimer, &QTimer::timeout, this, &PDFRecentFilePreloader::onIdleTimeout);
+}
+
+PDFRecentFilePreloader::~PDFRecentFilePreloader()
+{
+    setEnabled(false);
+    m_threadPool.clear();
+    m_threadPool.waitForDone();
+}
+
+bool PDFRecentFilePreloader::eventFilter(QObject* watched, QEvent* event)
+{
+    switch (event->type())
+    {
+        case QEvent::MouseButtonPress:
+        case QEvent::MouseMove:
+        case QEvent::Wheel:
+        case QEvent::KeyPress:
+        case QEvent::TouchBegin:
+        case QEvent::TouchUpdate:
+            // User is interacting with the application, postpone preloading
+            if (m_idleTimer.isActive())
+            {
+                m_idleTimer.start();
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return BaseClass::eventFilter(watched, event);
+}
+
+void PDFRecentFilePreloader::setEnabled(bool enabled)
+{
+    if (m_enabled == enabled)
+    {
+        return;
+    }
+
+    m_enabled = enabled;
+    pdf::PDFDocumentRegistry::getInstance()->setRetainedDocumentCount(enabled ? PRELOADED_FILES + 1 : 1);
+
+    if (enabled)
+    {
+        qApp->installEventFilter(this);
+        m_idleTimer.start();
+    }
+    else
+    {
+        qApp->removeEventFilter(this);
+        m_idleTimer.stop();
+    }
+}
+
+void PDFRecentFilePreloader::onIdleTimeout()
+{
+    if (!m_enabled || m_preloadInProgress)
+    {
+        return;
+    }
+
+    const QStringList& recentFiles = m_recentFileManager->getRecentFiles();
+    for (const QString& fileName : recentFiles.mid(0, PRELOADED_FILES))
+    {
+        if (!m_attemptedFiles.insert(fileName).second)
+        {
+            continue;
+        }
+
+        QFileInfo fileInfo(fileName);
+        if (!fileInfo.isFile() || m_preloadedBytes + fileInfo.size() > PRELOAD_BYTES_LIMIT)
+        {
+            continue;
+        }
+
+        m_preloadedBytes += fileInfo.size();
+        m_preloadInProgress = true;
+        m_threadPool.start([this, fileName]()
+        {
+            preload(fileName);
+            QMetaObject::invokeMethod(this, &PDFRecentFilePreloader::onPreloadFinished, Qt::QueuedConnection);
+        });
+        return;
+    }
+}
+
+void PDFRecentFilePreloader::onPreloadFinished()
+{
+    m_preloadInProgress = false;
+
+    // Preload next file, when application is idle again
+    if (m_enabled)
+    {
+        m_idleTimer.start();
+    }
+}
+
+void PDFRecentFilePreloader::preload(const QString& fileName)
+{
+    pdf::PDFDocumentRegistry* registry = pdf::PDFDocumentRegistry::getInstance();
+    if (registry->getDocument(fileName))
+    {
+        // Document is already opened
+        return;
+    }
+
+    // We do not ask for a password, encrypted documents are
+    // not registered in the registry anyway.
+    auto queryPassword = [](bool* ok)
+    {
+        *ok = false;
+        return QString();
+    };
+
+    pdf::PDFDocumentReader reader(nullptr, queryPassword, true, false);
+    pdf::PDFDocument document = reader.readFromFile(fileName);
+    if (reader.getReadingResult() != pdf::PDFDocumentReader::Result::OK)
+    {
+        return;
+    }
+
+    pdf::PDFDocumentPointer documentPointer = registry->registerDocument(fileName, pdf::PDFDocumentPointer(new pdf::PDFDocument(qMove(document))));
+    const pdf::PDFCatalog* catalog = documentPointer->getCatalog();
+    if (catalog->getPageCount() == 0)
+    {
+        return;
+    }
+
+    // Decode content streams of the first page, so they are in the decoded stream cache
+    std::vector<pdf::PDFObject> contents;
+    pdf::PDFObject contentsObject = documentPointer->getObject(catalog->getPage(0)->getContents());
+    if (contentsObject.isArray())
+    {
+        const pdf::PDFArray* contentsArray = contentsObject.getArray();
+        for (size_t i = 0; i < contentsArray->getCount(); ++i)
+        {
+            contents.push_back(documentPointer->getObject(contentsArray->getItem(i)));
+        }
+    }
+    else
+    {
+        contents.push_back(qMove(contentsObject));
+    }
+
+    for (const pdf::PDFObject& object : contents)
+    {
+        if (object.isStream())
+        {
+            documentPointer->getDecodedStream(object.getStream());
+        }
+    }
+}
+
 }   // namespace pdfviewer
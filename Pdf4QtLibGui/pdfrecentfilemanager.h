@@ -25,8 +25,11 @@
 
 #include <QObject>
 #include <QAction>
+#include <QTimer>
+#include <QThreadPool>
 
 #include <array>
+#include <set>
 
 namespace pdfviewer
 {
@@ -94,6 +97,56 @@ private:
     QStringList m_recentFiles;
 };
 
+/// Preloads most recent files in the background, when application is idle,
+/// so they are opened immediately. Documents are read in low priority
+/// thread and registered in the document registry (together with decoded
+/// content streams of the first page). Each file is preloaded at most once
+/// per session, preloading is postponed when user interacts with
+/// the application, and total size of preloaded files is limited.
+class PDFRecentFilePreloader : public QObject
+{
+    Q_OBJECT
+
+private:
+    using BaseClass = QObject;
+
+    static constexpr const int PRELOADED_FILES = 3;
+    static constexpr const int IDLE_INTERVAL = 3000;
+    static constexpr const qint64 PRELOAD_BYTES_LIMIT = 2048ll * 1024 * 1024;
+
+public:
+    explicit PDFRecentFilePreloader(PDFRecentFileManager* recentFileManager, QObject* parent);
+    virtual ~PDFRecentFilePreloader() override;
+
+    virtual bool eventFilter(QObject* watched, QEvent* event) override;
+
+    bool isEnabled() const { return m_enabled; }
+
+    /// Enables/disables preloading. When preloading is enabled,
+    /// document registry retains preloaded documents.
+    /// \param enabled Enable preloading
+    void setEnabled(bool enabled);
+
+private:
+    /// Starts preloading of next recent file, which wasn't preloaded yet
+    void onIdleTimeout();
+
+    /// Reaction on finished preloading
+    void onPreloadFinished();
+
+    /// Preloads document and decoded content of the first page
+    /// \param fileName File name
+    static void preload(const QString& fileName);
+
+    PDFRecentFileManager* m_recentFileManager;
+    QTimer m_idleTimer;
+    QThreadPool m_threadPool;
+    std::set<QString> m_attemptedFiles;
+    qint64 m_preloadedBytes = 0;
+    bool m_enabled = false;
+    bool m_preloadInProgress = false;
+};
+
 }   // namespace pdfviewer
 
 #endif // PDFRECENTFILEMANAGER_H
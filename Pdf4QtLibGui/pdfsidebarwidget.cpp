@@ -44,6 +44,7 @@
 #include <QAction>
 #include <QFileDialog>
 #include <QStandardPaths>
+#include <QDir>
 #include <QMessageBox>
 #include <QPainter>
 #include <QTextToSpeech>
@@ -119,6 +120,12 @@ PDFSidebarWidget::PDFSidebarWidget(pdf::PDFDrawWidgetProxy* proxy,
 
     // Thumbnails
     m_thumbnailsModel = new pdf::PDFThumbnailsItemModel(proxy, this);
+    constexpr qint64 THUMBNAILS_DISK_CACHE_LIMIT = 64 * 1024 * 1024;
+    QString thumbnailsCacheDirectory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (!thumbnailsCacheDirectory.isEmpty())
+    {
+        m_thumbnailsModel->setDiskCache(QDir(thumbnailsCacheDirectory).filePath(QLatin1String("thumbnails")), THUMBNAILS_DISK_CACHE_LIMIT);
+    }
     int thumbnailsMargin = ui->thumbnailsListView->style()->pixelMetric(QStyle::PM_FocusFrameHMargin, nullptr, ui->thumbnailsListView) + 1;
     int thumbnailsFontSize = QFontMetrics(ui->thumbnailsListView->font()).lineSpacing();
     m_thumbnailsModel->setExtraItemSizeHint(2 * thumbnailsMargin, thumbnailsMargin + thumbnailsFontSize);
@@ -0,0 +1,158 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pdfsingleinstance.h"
+
+#include <QDir>
+#include <QDataStream>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QCryptographicHash>
+
+#include "pdfdbgheap.h"
+
+namespace pdfviewer
+{
+
+namespace
+{
+
+/// Acknowledgement sent by the server, when open request is processed
+constexpr char OPEN_REQUEST_ACCEPTED = 'A';
+
+}   // namespace
+
+PDFSingleInstanceServer::PDFSingleInstanceServer(QObject* parent) :
+    BaseClass(parent),
+    m_server(new QLocalServer(this))
+{
+    connect(m_server, &QLocalServer::newConnection, this, &PDFSingleInstanceServer::onNewConnection);
+}
+
+PDFSingleInstanceServer::~PDFSingleInstanceServer()
+{
+    m_server->close();
+}
+
+QString PDFSingleInstanceServer::getServerName(const QString& applicationName)
+{
+    // Server name must be unique for each user, home path identifies the user
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(applicationName.toUtf8());
+    hash.addData(QDir::homePath().toUtf8());
+    return QString("PDF4QT-%1").arg(QString::fromLatin1(hash.result().toHex().left(16)));
+}
+
+bool PDFSingleInstanceServer::sendOpenRequest(const QString& serverName, const QStringList& files)
+{
+    QLocalSocket socket;
+    socket.connectToServer(serverName);
+    if (!socket.waitForConnected(TIMEOUT))
+    {
+        return false;
+    }
+
+    QByteArray request;
+    {
+        QDataStream stream(&request, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_6_0);
+        stream << files;
+    }
+
+    socket.write(request);
+    if (!socket.waitForBytesWritten(TIMEOUT))
+    {
+        return false;
+    }
+
+    // Wait for acknowledgement, running instance can be unresponsive
+    while (socket.bytesAvailable() < 1)
+    {
+        if (!socket.waitForReadyRead(TIMEOUT))
+        {
+            return false;
+        }
+    }
+
+    char answer = 0;
+    return socket.getChar(&answer) && answer == OPEN_REQUEST_ACCEPTED;
+}
+
+bool PDFSingleInstanceServer::listen(const QString& serverName)
+{
+    m_server->setSocketOptions(QLocalServer::UserAccessOption);
+
+    if (m_server->listen(serverName))
+    {
+        return true;
+    }
+
+    // Server may remain from crashed instance (on Unix systems, socket file
+    // is not removed), we already know, that no instance is responding.
+    if (m_server->serverError() == QAbstractSocket::AddressInUseError)
+    {
+        QLocalServer::removeServer(serverName);
+        return m_server->listen(serverName);
+    }
+
+    return false;
+}
+
+void PDFSingleInstanceServer::onNewConnection()
+{
+    while (QLocalSocket* socket = m_server->nextPendingConnection())
+    {
+        connect(socket, &QLocalSocket::disconnected, socket, &QLocalSocket::deleteLater);
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() { onReadyRead(socket); });
+
+        if (socket->bytesAvailable() > 0)
+        {
+            onReadyRead(socket);
+        }
+    }
+}
+
+void PDFSingleInstanceServer::onReadyRead(QLocalSocket* socket)
+{
+    QDataStream stream(socket);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    // Request can arrive in several parts
+    stream.startTransaction();
+
+    QStringList files;
+    stream >> files;
+
+    if (!stream.commitTransaction())
+    {
+        return;
+    }
+
+    socket->putChar(OPEN_REQUEST_ACCEPTED);
+    socket->flush();
+    socket->disconnectFromServer();
+
+    Q_EMIT openRequested(files);
+}
+
+}   // namespace pdfviewer
@@ -0,0 +1,87 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef PDFSINGLEINSTANCE_H
+#define PDFSINGLEINSTANCE_H
+
+#include "pdfviewerglobal.h"
+
+#include <QObject>
+#include <QStringList>
+
+class QLocalServer;
+class QLocalSocket;
+
+namespace pdfviewer
+{
+
+/// Single instance server of the application. First instance of the application
+/// listens on local socket, next instances send files to be opened to the first
+/// instance and then terminate. The first instance opens the files in new windows,
+/// so files are opened quickly (application, plugins, color management, fonts
+/// and thread pool are already initialized).
+class PDF4QTLIBGUILIBSHARED_EXPORT PDFSingleInstanceServer : public QObject
+{
+    Q_OBJECT
+
+private:
+    using BaseClass = QObject;
+
+public:
+    explicit PDFSingleInstanceServer(QObject* parent);
+    virtual ~PDFSingleInstanceServer() override;
+
+    /// Timeout for communication with running instance [ms]
+    static constexpr int TIMEOUT = 2000;
+
+    /// Returns server name for the current user and application
+    /// \param applicationName Application name
+    static QString getServerName(const QString& applicationName);
+
+    /// Sends request to open the files to the running instance. Returns
+    /// true, if running instance accepted the request. If no instance is
+    /// running, false is returned. Empty list of files requests a new window.
+    /// \param serverName Server name
+    /// \param files Absolute file paths
+    static bool sendOpenRequest(const QString& serverName, const QStringList& files);
+
+    /// Starts to listen for open requests. Returns true, if server
+    /// is listening, false otherwise.
+    /// \param serverName Server name
+    bool listen(const QString& serverName);
+
+signals:
+    /// Request to open files (in new windows). If list of files
+    /// is empty, new empty window should be opened.
+    void openRequested(const QStringList& files);
+
+private:
+    void onNewConnection();
+    void onReadyRead(QLocalSocket* socket);
+
+    QLocalServer* m_server;
+};
+
+}   // namespace pdfviewer
+
+#endif // PDFSINGLEINSTANCE_H
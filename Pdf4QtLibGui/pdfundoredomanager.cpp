@@ -26,6 +26,25 @@
 namespace pdfviewer
 {
 
+PDFUndoRedoManager::UndoRedoItem::UndoRedoItem(pdf::PDFDocumentPointer oldDocument, pdf::PDFDocumentPointer newDocument, pdf::PDFModifiedDocument::ModificationFlags flags) :
+    oldDocument(qMove(oldDocument)),
+    newDocument(qMove(newDocument)),
+    flags(flags)
+{
+    // Documents share unmodified objects, so we count only modified ones
+    const pdf::PDFObjectStorage* oldStorage = this->oldDocument ? &this->oldDocument->getStorage() : nullptr;
+    const pdf::PDFObjectStorage* newStorage = this->newDocument ? &this->newDocument->getStorage() : nullptr;
+
+    if (oldStorage)
+    {
+        undoMemoryConsumption = oldStorage->getMemoryConsumptionEstimate(newStorage);
+    }
+    if (newStorage)
+    {
+        redoMemoryConsumption = newStorage->getMemoryConsumptionEstimate(oldStorage);
+    }
+}
+
 PDFUndoRedoManager::PDFUndoRedoManager(QObject* parent) :
     BaseClass(parent)
 {
@@ -103,6 +122,33 @@ void PDFUndoRedoManager::setMaximumSteps(size_t undoLimit, size_t redoLimit)
     }
 }
 
+void PDFUndoRedoManager::setMemoryLimit(qint64 memoryLimit)
+{
+    if (m_memoryLimit != memoryLimit)
+    {
+        m_memoryLimit = memoryLimit;
+        clampUndoRedoSteps();
+        Q_EMIT undoRedoStateChanged();
+    }
+}
+
+qint64 PDFUndoRedoManager::getMemoryConsumptionEstimate() const
+{
+    qint64 memoryConsumption = 0;
+
+    for (const UndoRedoItem& item : m_undoSteps)
+    {
+        memoryConsumption += item.undoMemoryConsumption;
+    }
+
+    for (const UndoRedoItem& item : m_redoSteps)
+    {
+        memoryConsumption += item.redoMemoryConsumption;
+    }
+
+    return memoryConsumption;
+}
+
 void PDFUndoRedoManager::clampUndoRedoSteps()
 {
     if (m_undoSteps.size() > m_undoLimit)
@@ -115,6 +161,27 @@ void PDFUndoRedoManager::clampUndoRedoSteps()
         // Newest steps are erased
         m_redoSteps.resize(m_redoLimit);
     }
+
+    if (m_memoryLimit > 0)
+    {
+        qint64 memoryConsumption = getMemoryConsumptionEstimate();
+
+        // Oldest undo steps are erased first, but the most recent step is kept
+        auto undoEnd = m_undoSteps.begin();
+        while (memoryConsumption > m_memoryLimit && std::distance(undoEnd, m_undoSteps.end()) > 1)
+        {
+            memoryConsumption -= undoEnd->undoMemoryConsumption;
+            ++undoEnd;
+        }
+        m_undoSteps.erase(m_undoSteps.begin(), undoEnd);
+
+        // Then erase redo steps, the most distant ones first
+        while (memoryConsumption > m_memoryLimit && !m_redoSteps.empty())
+        {
+            memoryConsumption -= m_redoSteps.back().redoMemoryConsumption;
+            m_redoSteps.pop_back();
+        }
+    }
 }
 
 bool PDFUndoRedoManager::isCurrentSaved() const
@@ -67,6 +67,17 @@ public:
     /// \param redoLimit Maximum redo steps
     void setMaximumSteps(size_t undoLimit, size_t redoLimit);
 
+    /// Sets maximum memory consumed by undo/redo steps. Documents of consecutive
+    /// steps share unmodified objects, so each step consumes only memory of
+    /// objects changed by the step. When limit is exceeded, oldest undo steps
+    /// are removed first (the most recent undo step is always kept), then
+    /// the most distant redo steps.
+    /// \param memoryLimit Memory limit in bytes (zero means no limit)
+    void setMemoryLimit(qint64 memoryLimit);
+
+    /// Returns estimate of memory consumed by undo/redo steps (in bytes)
+    qint64 getMemoryConsumptionEstimate() const;
+
     /// Returns true, if document was saved
     bool isCurrentSaved() const;
 
@@ -85,27 +96,30 @@ signals:
     void documentChangeRequest(pdf::PDFModifiedDocument document);
 
 private:
-    /// Clamps undo/redo steps so they fit the limits
+    /// Clamps undo/redo steps so they fit the limits (step count and memory)
     void clampUndoRedoSteps();
 
     struct UndoRedoItem
     {
         explicit inline UndoRedoItem() = default;
-        explicit inline UndoRedoItem(pdf::PDFDocumentPointer oldDocument, pdf::PDFDocumentPointer newDocument, pdf::PDFModifiedDocument::ModificationFlags flags) :
-            oldDocument(qMove(oldDocument)),
-            newDocument(qMove(newDocument)),
-            flags(flags)
-        {
-
-        }
+        explicit UndoRedoItem(pdf::PDFDocumentPointer oldDocument, pdf::PDFDocumentPointer newDocument, pdf::PDFModifiedDocument::ModificationFlags flags);
 
         pdf::PDFDocumentPointer oldDocument;
         pdf::PDFDocumentPointer newDocument;
         pdf::PDFModifiedDocument::ModificationFlags flags = pdf::PDFModifiedDocument::None;
+
+        /// Memory of old document not shared with new document, i.e. memory
+        /// consumed by the step, when it is in the undo list
+        qint64 undoMemoryConsumption = 0;
+
+        /// Memory of new document not shared with old document, i.e. memory
+        /// consumed by the step, when it is in the redo list
+        qint64 redoMemoryConsumption = 0;
     };
 
     size_t m_undoLimit = 0;
     size_t m_redoLimit = 0;
+    qint64 m_memoryLimit = 0;
     std::vector<UndoRedoItem> m_undoSteps;
     std::vector<UndoRedoItem> m_redoSteps;
     bool m_isCurrentSaved = true;
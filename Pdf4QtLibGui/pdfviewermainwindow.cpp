@@ -155,6 +155,7 @@ PDFViewerMainWindow::PDFViewerMainWindow(QWidget* parent) :
     m_actionManager->setAction(PDFActionManager::FitWidth, ui->actionFitWidth);
     m_actionManager->setAction(PDFActionManager::FitHeight, ui->actionFitHeight);
     m_actionManager->setAction(PDFActionManager::ShowRenderingErrors, ui->actionRendering_Errors);
+    m_actionManager->setAction(PDFActionManager::RecordPerformanceTrace, ui->actionRecordPerformanceTrace);
     m_actionManager->setAction(PDFActionManager::PageLayoutSinglePage, ui->actionPageLayoutSinglePage);
     m_actionManager->setAction(PDFActionManager::PageLayoutContinuous, ui->actionPageLayoutContinuous);
     m_actionManager->setAction(PDFActionManager::PageLayoutTwoPages, ui->actionPageLayoutTwoPages);
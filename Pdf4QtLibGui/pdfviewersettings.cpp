@@ -50,6 +50,8 @@ void PDFViewerSettings::readSettings(QSettings& settings, const pdf::PDFCMSSetti
     m_settings.m_features = static_cast<pdf::PDFRenderer::Features>(settings.value("rendererFeaturesv2", static_cast<int>(pdf::PDFRenderer::getDefaultFeatures())).toInt());
     m_settings.m_rendererEngine = static_cast<pdf::RendererEngine>(settings.value("renderingEngine", static_cast<int>(pdf::RendererEngine::Blend2D_MultiThread)).toInt());
     m_settings.m_prefetchPages = settings.value("prefetchPages", defaultSettings.m_prefetchPages).toBool();
+    m_settings.m_rasterizedPrinting = settings.value("rasterizedPrinting", defaultSettings.m_rasterizedPrinting).toBool();
+    m_settings.m_preloadRecentFiles = settings.value("preloadRecentFiles", defaultSettings.m_preloadRecentFiles).toBool();
     m_settings.m_preferredMeshResolutionRatio = settings.value("preferredMeshResolutionRatio", defaultSettings.m_preferredMeshResolutionRatio).toDouble();
     m_settings.m_minimalMeshResolutionRatio = settings.value("minimalMeshResolutionRatio", defaultSettings.m_minimalMeshResolutionRatio).toDouble();
     m_settings.m_colorTolerance = settings.value("colorTolerance", defaultSettings.m_colorTolerance).toDouble();
@@ -65,6 +67,7 @@ void PDFViewerSettings::readSettings(QSettings& settings, const pdf::PDFCMSSetti
     m_settings.m_magnifierZoom = settings.value("magnifierZoom", defaultSettings.m_magnifierZoom).toDouble();
     m_settings.m_maximumUndoSteps = settings.value("maximumUndoSteps", defaultSettings.m_maximumUndoSteps).toInt();
     m_settings.m_maximumRedoSteps = settings.value("maximumRedoSteps", defaultSettings.m_maximumRedoSteps).toInt();
+    m_settings.m_undoRedoMemoryLimit = settings.value("undoRedoMemoryLimit", defaultSettings.m_undoRedoMemoryLimit).toInt();
     settings.endGroup();
 
     settings.beginGroup("ColorManagementSystemSettings");
@@ -130,6 +133,8 @@ void PDFViewerSettings::writeSettings(QSettings& settings)
     settings.setValue("rendererFeaturesv2", static_cast<int>(m_settings.m_features));
     settings.setValue("renderingEngine", static_cast<int>(m_settings.m_rendererEngine));
     settings.setValue("prefetchPages", m_settings.m_prefetchPages);
+    settings.setValue("rasterizedPrinting", m_settings.m_rasterizedPrinting);
+    settings.setValue("preloadRecentFiles", m_settings.m_preloadRecentFiles);
     settings.setValue("preferredMeshResolutionRatio", m_settings.m_preferredMeshResolutionRatio);
     settings.setValue("minimalMeshResolutionRatio", m_settings.m_minimalMeshResolutionRatio);
     settings.setValue("colorTolerance", m_settings.m_colorTolerance);
@@ -145,6 +150,7 @@ void PDFViewerSettings::writeSettings(QSettings& settings)
     settings.setValue("magnifierZoom", m_settings.m_magnifierZoom);
     settings.setValue("maximumUndoSteps", m_settings.m_maximumUndoSteps);
     settings.setValue("maximumRedoSteps", m_settings.m_maximumRedoSteps);
+    settings.setValue("undoRedoMemoryLimit", m_settings.m_undoRedoMemoryLimit);
     settings.endGroup();
 
     settings.beginGroup("ColorManagementSystemSettings");
@@ -297,12 +303,14 @@ PDFViewerSettings::Settings::Settings() :
     m_features(pdf::PDFRenderer::getDefaultFeatures()),
     m_rendererEngine(pdf::RendererEngine::Blend2D_MultiThread),
     m_prefetchPages(true),
+    m_rasterizedPrinting(false),
     m_preferredMeshResolutionRatio(0.02),
     m_minimalMeshResolutionRatio(0.005),
     m_colorTolerance(0.01),
     m_allowLaunchApplications(true),
     m_allowLaunchURI(true),
     m_allowDeveloperMode(false),
+    m_preloadRecentFiles(false),
     m_multithreadingStrategy(pdf::PDFExecutionPolicy::Strategy::AlwaysMultithreaded),
     m_compiledPageCacheLimit(512 * 1024),
     m_thumbnailsCacheLimit(64 * 1024),
@@ -315,6 +323,7 @@ PDFViewerSettings::Settings::Settings() :
     m_magnifierZoom(2.0),
     m_maximumUndoSteps(5),
     m_maximumRedoSteps(5),
+    m_undoRedoMemoryLimit(256),
     m_formAppearanceFlags(pdf::PDFFormManager::getDefaultApperanceFlags()),
     m_signatureVerificationEnabled(true),
     m_signatureTreatWarningsAsErrors(false),
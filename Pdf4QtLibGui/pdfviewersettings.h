@@ -67,12 +67,14 @@ public:
         QString m_directory;
         pdf::RendererEngine m_rendererEngine;
         bool m_prefetchPages;
+        bool m_rasterizedPrinting; ///< Pages are printed as images, rendered in bands at printer resolution
         pdf::PDFReal m_preferredMeshResolutionRatio;
         pdf::PDFReal m_minimalMeshResolutionRatio;
         pdf::PDFReal m_colorTolerance;
         bool m_allowLaunchApplications;
         bool m_allowLaunchURI;
         bool m_allowDeveloperMode;
+        bool m_preloadRecentFiles;
         pdf::PDFExecutionPolicy::Strategy m_multithreadingStrategy;
 
         // Cache settings
@@ -96,6 +98,7 @@ public:
         // Undo/redo steps settings
         int m_maximumUndoSteps;
         int m_maximumRedoSteps;
+        int m_undoRedoMemoryLimit; ///< Memory limit of undo/redo steps in MB (zero means no limit)
 
         // Form settings
         pdf::PDFFormManager::FormAppearanceFlags m_formAppearanceFlags;
@@ -132,6 +135,7 @@ public:
     void setRendererEngine(pdf::RendererEngine rendererEngine);
 
     bool isPagePrefetchingEnabled() const { return m_settings.m_prefetchPages; }
+    bool isRecentFilesPreloadingEnabled() const { return m_settings.m_preloadRecentFiles; }
 
     pdf::PDFReal getPreferredMeshResolutionRatio() const { return m_settings.m_preferredMeshResolutionRatio; }
     void setPreferredMeshResolutionRatio(pdf::PDFReal preferredMeshResolutionRatio);
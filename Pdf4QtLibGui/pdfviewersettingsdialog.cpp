@@ -294,6 +294,7 @@ void PDFViewerSettingsDialog::loadData()
 
     // Engine
     ui->prefetchPagesCheckBox->setChecked(m_settings.m_prefetchPages);
+    ui->rasterizedPrintingCheckBox->setChecked(m_settings.m_rasterizedPrinting);
     ui->multithreadingComboBox->setCurrentIndex(ui->multithreadingComboBox->findData(static_cast<int>(m_settings.m_multithreadingStrategy)));
 
     // Rendering
@@ -304,6 +305,7 @@ void PDFViewerSettingsDialog::loadData()
     ui->clipToCropBoxCheckBox->setChecked(m_settings.m_features.testFlag(pdf::PDFRenderer::ClipToCropBox));
     ui->displayTimeCheckBox->setChecked(m_settings.m_features.testFlag(pdf::PDFRenderer::DisplayTimes));
     ui->displayAnnotationsCheckBox->setChecked(m_settings.m_features.testFlag(pdf::PDFRenderer::DisplayAnnotations));
+    ui->colorAdjustPostProcessCheckBox->setChecked(m_settings.m_features.testFlag(pdf::PDFRenderer::ColorAdjust_PostProcess));
 
     // Shading
     ui->preferredMeshResolutionEdit->setValue(m_settings.m_preferredMeshResolutionRatio);
@@ -326,7 +328,9 @@ void PDFViewerSettingsDialog::loadData()
     ui->magnifierZoomEdit->setValue(m_settings.m_magnifierZoom);
     ui->maximumUndoStepsEdit->setValue(m_settings.m_maximumUndoSteps);
     ui->maximumRedoStepsEdit->setValue(m_settings.m_maximumRedoSteps);
+    ui->undoRedoMemoryLimitEdit->setValue(m_settings.m_undoRedoMemoryLimit);
     ui->developerModeCheckBox->setChecked(m_settings.m_allowDeveloperMode);
+    ui->preloadRecentFilesCheckBox->setChecked(m_settings.m_preloadRecentFiles);
     ui->logicalPixelZoomCheckBox->setChecked(m_settings.m_features.testFlag(pdf::PDFRenderer::LogicalSizeZooming));
     ui->colorSchemeCombo->setCurrentIndex(ui->colorSchemeCombo->findData(static_cast<int>(m_settings.m_colorScheme)));
     ui->languageCombo->setCurrentIndex(ui->languageCombo->findData(static_cast<int>(m_settings.m_language)));
@@ -437,6 +441,10 @@ void PDFViewerSettingsDialog::saveData()
     {
         m_settings.m_prefetchPages = ui->prefetchPagesCheckBox->isChecked();
     }
+    else if (sender == ui->rasterizedPrintingCheckBox)
+    {
+        m_settings.m_rasterizedPrinting = ui->rasterizedPrintingCheckBox->isChecked();
+    }
     else if (sender == ui->antialiasingCheckBox)
     {
         m_settings.m_features.setFlag(pdf::PDFRenderer::Antialiasing, ui->antialiasingCheckBox->isChecked());
@@ -465,6 +473,10 @@ void PDFViewerSettingsDialog::saveData()
     {
         m_settings.m_features.setFlag(pdf::PDFRenderer::DisplayTimes, ui->displayTimeCheckBox->isChecked());
     }
+    else if (sender == ui->colorAdjustPostProcessCheckBox)
+    {
+        m_settings.m_features.setFlag(pdf::PDFRenderer::ColorAdjust_PostProcess, ui->colorAdjustPostProcessCheckBox->isChecked());
+    }
     else if (sender == ui->preferredMeshResolutionEdit)
     {
         m_settings.m_preferredMeshResolutionRatio = ui->preferredMeshResolutionEdit->value();
@@ -489,6 +501,10 @@ void PDFViewerSettingsDialog::saveData()
     {
         m_settings.m_allowDeveloperMode = ui->developerModeCheckBox->isChecked();
     }
+    else if (sender == ui->preloadRecentFilesCheckBox)
+    {
+        m_settings.m_preloadRecentFiles = ui->preloadRecentFilesCheckBox->isChecked();
+    }
     else if (sender == ui->compiledPageCacheSizeEdit)
     {
         m_settings.m_compiledPageCacheLimit = ui->compiledPageCacheSizeEdit->value();
@@ -635,6 +651,10 @@ void PDFViewerSettingsDialog::saveData()
     {
         m_settings.m_maximumRedoSteps = ui->maximumRedoStepsEdit->value();
     }
+    else if (sender == ui->undoRedoMemoryLimitEdit)
+    {
+        m_settings.m_undoRedoMemoryLimit = ui->undoRedoMemoryLimitEdit->value();
+    }
     else if (sender == ui->logicalPixelZoomCheckBox)
     {
         m_settings.m_features.setFlag(pdf::PDFRenderer::LogicalSizeZooming, ui->logicalPixelZoomCheckBox->isChecked());
@@ -1055,7 +1055,7 @@ void PDFCreateHighlightTextTool::mouseReleaseEvent(QWidget* widget, QMouseEvent*
             {
                 // Jakub Melka: handle the selection
                 PDFTextLayoutGetter textLayoutGetter = getProxy()->getTextLayoutCompiler()->getTextLayoutLazy(pageIndex);
-                PDFTextLayout textLayout = textLayoutGetter;
+                const PDFTextLayout& textLayout = textLayoutGetter;
                 setSelection(textLayout.createTextSelection(pageIndex, m_selectionInfo.selectionStartPoint, pagePoint, m_color));
 
                 QPolygonF quadrilaterals;
@@ -1117,7 +1117,8 @@ void PDFCreateHighlightTextTool::mouseMoveEvent(QWidget* widget, QMouseEvent* ev
 
     QPointF pagePoint;
     const PDFInteger pageIndex = getProxy()->getPageUnderPoint(event->pos(), &pagePoint);
-    PDFTextLayout textLayout = getProxy()->getTextLayoutCompiler()->getTextLayoutLazy(pageIndex);
+    PDFTextLayoutGetter textLayoutGetter = getProxy()->getTextLayoutCompiler()->getTextLayoutLazy(pageIndex);
+    const PDFTextLayout& textLayout = textLayoutGetter;
     m_isCursorOverText = textLayout.isHoveringOverTextBlock(pagePoint);
 
     if (m_selectionInfo.pageIndex != -1)
@@ -1351,7 +1352,7 @@ void PDFCreateRedactTextTool::mouseReleaseEvent(QWidget* widget, QMouseEvent* ev
             {
                 // Jakub Melka: handle the selection
                 PDFTextLayoutGetter textLayoutGetter = getProxy()->getTextLayoutCompiler()->getTextLayoutLazy(pageIndex);
-                PDFTextLayout textLayout = textLayoutGetter;
+                const PDFTextLayout& textLayout = textLayoutGetter;
                 setSelection(textLayout.createTextSelection(pageIndex, m_selectionInfo.selectionStartPoint, pagePoint, Qt::black));
 
                 QPolygonF quadrilaterals;
@@ -1388,7 +1389,8 @@ void PDFCreateRedactTextTool::mouseMoveEvent(QWidget* widget, QMouseEvent* event
 
     QPointF pagePoint;
     const PDFInteger pageIndex = getProxy()->getPageUnderPoint(event->pos(), &pagePoint);
-    PDFTextLayout textLayout = getProxy()->getTextLayoutCompiler()->getTextLayoutLazy(pageIndex);
+    PDFTextLayoutGetter textLayoutGetter = getProxy()->getTextLayoutCompiler()->getTextLayoutLazy(pageIndex);
+    const PDFTextLayout& textLayout = textLayoutGetter;
     m_isCursorOverText = textLayout.isHoveringOverTextBlock(pagePoint);
 
     if (m_selectionInfo.pageIndex != -1)
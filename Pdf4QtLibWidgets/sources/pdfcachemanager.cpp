@@ -0,0 +1,221 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pdfcachemanager.h"
+
+#include <QFile>
+#include <QTimer>
+#include <QCoreApplication>
+
+#include "pdfdbgheap.h"
+
+#ifdef Q_OS_WIN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#endif
+
+#include <algorithm>
+
+namespace pdf
+{
+
+PDFCacheManager::PDFCacheManager(QObject* parent) :
+    BaseClass(parent),
+    m_updateTimer(new QTimer(this)),
+    m_budget(getDefaultBudget())
+{
+    m_elapsedTimer.start();
+    connect(m_updateTimer, &QTimer::timeout, this, &PDFCacheManager::update);
+}
+
+PDFCacheManager* PDFCacheManager::getInstance()
+{
+    static PDFCacheManager* instance = new PDFCacheManager(QCoreApplication::instance());
+    return instance;
+}
+
+qint64 PDFCacheManager::getDefaultBudget()
+{
+    constexpr qint64 MINIMAL_BUDGET = 512ll * 1024 * 1024;
+    constexpr qint64 FALLBACK_BUDGET = 1024ll * 1024 * 1024;
+
+    MemoryStatus status = getMemoryStatus();
+    if (status.totalMemory > 0)
+    {
+        return qMax(status.totalMemory / 4, MINIMAL_BUDGET);
+    }
+
+    return FALLBACK_BUDGET;
+}
+
+void PDFCacheManager::setBudget(qint64 budget)
+{
+    if (m_budget != budget)
+    {
+        m_budget = budget;
+        update();
+    }
+}
+
+void PDFCacheManager::registerCache(Cache cache)
+{
+    Q_ASSERT(cache.owner && cache.getCost && cache.shrink);
+
+    m_lastUsed.emplace(cache.owner, m_elapsedTimer.elapsed());
+    m_caches.emplace_back(qMove(cache));
+
+    if (!m_updateTimer->isActive())
+    {
+        m_updateTimer->start(UPDATE_INTERVAL);
+    }
+}
+
+void PDFCacheManager::unregisterCaches(const void* owner)
+{
+    m_caches.erase(std::remove_if(m_caches.begin(), m_caches.end(), [owner](const Cache& cache) { return cache.owner == owner; }), m_caches.end());
+    m_lastUsed.erase(owner);
+
+    if (m_caches.empty())
+    {
+        m_updateTimer->stop();
+    }
+}
+
+void PDFCacheManager::touch(const void* owner)
+{
+    auto it = m_lastUsed.find(owner);
+    if (it != m_lastUsed.end())
+    {
+        it->second = m_elapsedTimer.elapsed();
+    }
+}
+
+qint64 PDFCacheManager::getTotalCost() const
+{
+    qint64 totalCost = 0;
+    for (const Cache& cache : m_caches)
+    {
+        totalCost += cache.getCost();
+    }
+    return totalCost;
+}
+
+void PDFCacheManager::update()
+{
+    const qint64 totalCost = getTotalCost();
+    qint64 budget = m_budget;
+
+    MemoryStatus status = getMemoryStatus();
+    if (status.totalMemory > 0 && status.availableMemory >= 0 && status.availableMemory < status.totalMemory / LOW_MEMORY_RATIO)
+    {
+        // System is running out of memory, release half of the caches,
+        // they can be rebuilt, other memory of the application can't.
+        budget = qMin(budget, totalCost / 2);
+    }
+
+    if (totalCost <= budget)
+    {
+        return;
+    }
+
+    // Caches of least recently used owners are shrunk first,
+    // caches of the same owner are shrunk by their rebuild cost.
+    std::vector<const Cache*> caches;
+    caches.reserve(m_caches.size());
+    for (const Cache& cache : m_caches)
+    {
+        caches.push_back(&cache);
+    }
+
+    auto comparator = [this](const Cache* left, const Cache* right)
+    {
+        const qint64 leftLastUsed = m_lastUsed.at(left->owner);
+        const qint64 rightLastUsed = m_lastUsed.at(right->owner);
+        return std::make_pair(leftLastUsed, left->rebuildCost) < std::make_pair(rightLastUsed, right->rebuildCost);
+    };
+    std::stable_sort(caches.begin(), caches.end(), comparator);
+
+    qint64 excess = totalCost - budget;
+    for (const Cache* cache : caches)
+    {
+        if (excess <= 0)
+        {
+            break;
+        }
+
+        const qint64 cost = cache->getCost();
+        if (cost > 0)
+        {
+            cache->shrink(qMax(cost - excess, qint64(0)));
+            excess -= cost - cache->getCost();
+        }
+    }
+}
+
+PDFCacheManager::MemoryStatus PDFCacheManager::getMemoryStatus()
+{
+    MemoryStatus status;
+
+#if defined(Q_OS_WIN)
+    MEMORYSTATUSEX memoryStatus = { };
+    memoryStatus.dwLength = sizeof(memoryStatus);
+    if (GlobalMemoryStatusEx(&memoryStatus))
+    {
+        status.totalMemory = qint64(memoryStatus.ullTotalPhys);
+        status.availableMemory = qint64(memoryStatus.ullAvailPhys);
+    }
+#elif defined(Q_OS_LINUX)
+    QFile file(QLatin1String("/proc/meminfo"));
+    if (file.open(QFile::ReadOnly | QFile::Text))
+    {
+        // Lines are in format "MemTotal:       16326428 kB"
+        auto parseValue = [](const QByteArray& line)
+        {
+            QByteArray value = line.mid(line.indexOf(':') + 1).trimmed();
+            value.chop(value.endsWith("kB") ? 2 : 0);
+            bool ok = false;
+            const qint64 kiloBytes = value.trimmed().toLongLong(&ok);
+            return ok ? kiloBytes * 1024 : -1;
+        };
+
+        QByteArray line;
+        while (!(line = file.readLine()).isEmpty())
+        {
+            if (line.startsWith("MemTotal:"))
+            {
+                status.totalMemory = parseValue(line);
+            }
+            else if (line.startsWith("MemAvailable:"))
+            {
+                status.availableMemory = parseValue(line);
+            }
+        }
+    }
+#endif
+
+    return status;
+}
+
+}   // namespace pdf
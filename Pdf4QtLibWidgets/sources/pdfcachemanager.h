@@ -0,0 +1,137 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef PDFCACHEMANAGER_H
+#define PDFCACHEMANAGER_H
+
+#include "pdfwidgetsglobal.h"
+#include "pdfglobal.h"
+
+#include <QObject>
+#include <QElapsedTimer>
+
+#include <map>
+#include <vector>
+#include <functional>
+
+class QTimer;
+
+namespace pdf
+{
+
+/// Manages one global memory budget of caches of all draw widgets (for example,
+/// draw widgets in multiple tabs). Caches are registered together with their
+/// owner and report their cost in bytes. Manager periodically computes total
+/// cost of all caches, and if it exceeds the budget, caches are shrunk. Caches
+/// of least recently used owners are shrunk first, and of the same owner, caches
+/// which are cheap to rebuild are shrunk before expensive ones. When system is
+/// running out of physical memory, caches are shrunk regardless of the budget.
+/// Manager must be used only from the main thread.
+class PDF4QTLIBWIDGETSSHARED_EXPORT PDFCacheManager : public QObject
+{
+    Q_OBJECT
+
+private:
+    using BaseClass = QObject;
+
+    explicit PDFCacheManager(QObject* parent);
+
+public:
+    enum class RebuildCost
+    {
+        Low,    ///< Cache content is cheap to rebuild (for example, rasterized images)
+        High    ///< Cache content is expensive to rebuild (for example, compiled pages)
+    };
+
+    struct Cache
+    {
+        const void* owner = nullptr;
+        RebuildCost rebuildCost = RebuildCost::Low;
+        std::function<qint64()> getCost;        ///< Returns current cost of the cache [bytes]
+        std::function<void(qint64)> shrink;     ///< Shrinks the cache to given cost [bytes]
+    };
+
+    /// Returns instance of the cache manager
+    static PDFCacheManager* getInstance();
+
+    /// Returns default budget, which is a quarter of physical memory,
+    /// but at least 512 MB (or 1 GB, if physical memory can't be determined).
+    static qint64 getDefaultBudget();
+
+    /// Sets budget of all caches in bytes
+    /// \param budget Budget [bytes]
+    void setBudget(qint64 budget);
+
+    /// Returns budget of all caches in bytes
+    qint64 getBudget() const { return m_budget; }
+
+    /// Registers the cache. Cache must be unregistered by its
+    /// owner before the cache is destroyed.
+    /// \param cache Cache
+    void registerCache(Cache cache);
+
+    /// Unregisters all caches of given owner
+    /// \param owner Owner
+    void unregisterCaches(const void* owner);
+
+    /// Marks caches of the owner as recently used. Call this
+    /// function, when owner uses its caches (for example, when
+    /// draw widget is being drawn).
+    /// \param owner Owner
+    void touch(const void* owner);
+
+    /// Returns total cost of all registered caches [bytes]
+    qint64 getTotalCost() const;
+
+    /// Checks total cost of caches and available physical
+    /// memory and shrinks caches, if it is needed.
+    void update();
+
+private:
+    /// Interval of cache cost checks [ms]
+    static constexpr int UPDATE_INTERVAL = 2000;
+
+    /// If available physical memory falls below this fraction
+    /// of the total physical memory, caches are halved.
+    static constexpr int LOW_MEMORY_RATIO = 10;
+
+    struct MemoryStatus
+    {
+        qint64 totalMemory = -1;        ///< Total physical memory [bytes], -1 if unknown
+        qint64 availableMemory = -1;    ///< Available physical memory [bytes], -1 if unknown
+    };
+
+    static MemoryStatus getMemoryStatus();
+
+    QTimer* m_updateTimer;
+    QElapsedTimer m_elapsedTimer;
+    qint64 m_budget;
+    std::vector<Cache> m_caches;
+
+    /// Time of last use of owner caches [ms]
+    std::map<const void*, qint64> m_lastUsed;
+};
+
+}   // namespace pdf
+
+#endif // PDFCACHEMANAGER_H
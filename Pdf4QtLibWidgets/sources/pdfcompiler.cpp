@@ -26,24 +26,311 @@
 #include "pdfexecutionpolicy.h"
 #include "pdftextlayoutgenerator.h"
 #include "pdfdrawspacecontroller.h"
+#include "pdfoptionalcontent.h"
+#include "pdftracing.h"
 
+#include <QDir>
 #include <QCache>
+#include <QPainter>
+#include <QSaveFile>
+#include <QCryptographicHash>
 #include <QtConcurrent/QtConcurrent>
 
 #include "pdfdbgheap.h"
 
+#include <numeric>
+#include <algorithm>
 #include <execution>
 
 namespace pdf
 {
 
+void PDFPrecompiledPageDiskCache::setCacheDirectory(QString directory, qint64 limit)
+{
+    QMutexLocker locker(&m_mutex);
+    m_directory = qMove(directory);
+    m_limit = limit;
+    m_size = -1;
+}
+
+bool PDFPrecompiledPageDiskCache::load(PDFInteger pageIndex, PDFPrecompiledPage* precompiledPage)
+{
+    if (!isEnabled())
+    {
+        return false;
+    }
+
+    QFile file(getFileName(pageIndex));
+    if (!file.open(QFile::ReadOnly))
+    {
+        return false;
+    }
+
+    const qint64 size = file.size();
+    uchar* data = size > 0 ? file.map(0, size) : nullptr;
+    if (!data)
+    {
+        return false;
+    }
+
+    bool isLoaded = false;
+
+    {
+        // Raw data are used, so page is read directly from the mapped memory
+        QByteArray fileData = QByteArray::fromRawData(reinterpret_cast<const char*>(data), size);
+        QDataStream stream(fileData);
+        stream.setVersion(QDataStream::Qt_6_0);
+
+        quint32 magic = 0;
+        int persistVersionDeserialized = 0;
+        QByteArray key;
+        QByteArray checksum;
+        stream >> magic;
+        stream >> persistVersionDeserialized;
+        stream >> key;
+        stream >> checksum;
+
+        if (stream.status() == QDataStream::Ok && magic == FILE_MAGIC && persistVersionDeserialized == persist_version && key == m_key)
+        {
+            const qint64 offset = stream.device()->pos();
+            QByteArray payload = QByteArray::fromRawData(fileData.constData() + offset, size - offset);
+            if (QCryptographicHash::hash(payload, QCryptographicHash::Md5) == checksum)
+            {
+                precompiledPage->deserialize(stream);
+                isLoaded = stream.status() == QDataStream::Ok && precompiledPage->isValid();
+            }
+        }
+    }
+
+    file.unmap(data);
+
+    if (isLoaded)
+    {
+        // Modification time is used as access time to find least recently used pages
+        file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+        file.close();
+    }
+    else
+    {
+        // File is corrupted, or it is a hash collision, remove it
+        *precompiledPage = PDFPrecompiledPage();
+        file.close();
+        file.remove();
+    }
+
+    return isLoaded;
+}
+
+void PDFPrecompiledPageDiskCache::store(PDFInteger pageIndex, const PDFPrecompiledPage& precompiledPage)
+{
+    if (!isEnabled() || !precompiledPage.isValid())
+    {
+        return;
+    }
+
+    QByteArray payload;
+    {
+        QDataStream stream(&payload, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_6_0);
+        precompiledPage.serialize(stream);
+    }
+
+    QByteArray header;
+    {
+        QDataStream stream(&header, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_6_0);
+        stream << FILE_MAGIC;
+        stream << persist_version;
+        stream << m_key;
+        stream << QCryptographicHash::hash(payload, QCryptographicHash::Md5);
+    }
+
+    const qint64 fileSize = header.size() + payload.size();
+    if (fileSize > m_limit)
+    {
+        return;
+    }
+
+    QString fileName = getFileName(pageIndex);
+    const qint64 oldFileSize = QFileInfo(fileName).size();
+
+    if (!QDir().mkpath(m_directory))
+    {
+        return;
+    }
+
+    QSaveFile file(fileName);
+    if (file.open(QFile::WriteOnly))
+    {
+        file.write(header);
+        file.write(payload);
+
+        if (file.commit())
+        {
+            QMutexLocker locker(&m_mutex);
+            if (m_size >= 0)
+            {
+                m_size += fileSize - oldFileSize;
+            }
+            shrink();
+        }
+    }
+}
+
+QString PDFPrecompiledPageDiskCache::getFileName(PDFInteger pageIndex) const
+{
+    QByteArray hash = QCryptographicHash::hash(m_key + QByteArray::number(pageIndex), QCryptographicHash::Sha256);
+    return QDir(m_directory).filePath(QString::fromLatin1(hash.toHex()) + QLatin1String(".page"));
+}
+
+void PDFPrecompiledPageDiskCache::shrink()
+{
+    QDir directory(m_directory);
+    const QStringList nameFilters = { QLatin1String("*.page") };
+
+    if (m_size < 0)
+    {
+        m_size = 0;
+        for (const QFileInfo& fileInfo : directory.entryInfoList(nameFilters, QDir::Files))
+        {
+            m_size += fileInfo.size();
+        }
+    }
+
+    if (m_size <= m_limit)
+    {
+        return;
+    }
+
+    // Remove least recently used files until only 3/4 of the limit
+    // is used, so we do not have to list the directory on each store.
+    const qint64 targetSize = m_limit / 4 * 3;
+    for (const QFileInfo& fileInfo : directory.entryInfoList(nameFilters, QDir::Files, QDir::Time | QDir::Reversed))
+    {
+        if (m_size <= targetSize)
+        {
+            break;
+        }
+
+        if (QFile::remove(fileInfo.filePath()))
+        {
+            m_size -= fileInfo.size();
+        }
+    }
+}
+
+PDFPrecompiledPageCompressedCache::PDFPrecompiledPageCompressedCache() :
+    m_cache(new QCache<PDFInteger, QByteArray>())
+{
+    m_cache->setMaxCost(64 * 1024 * 1024);
+}
+
+PDFPrecompiledPageCompressedCache::~PDFPrecompiledPageCompressedCache()
+{
+    delete m_cache;
+    m_cache = nullptr;
+}
+
+void PDFPrecompiledPageCompressedCache::setCacheLimit(qint64 limit)
+{
+    QMutexLocker locker(&m_mutex);
+    m_cache->setMaxCost(qsizetype(qMax<qint64>(limit, 0)));
+}
+
+bool PDFPrecompiledPageCompressedCache::isEnabled() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cache->maxCost() > 0;
+}
+
+bool PDFPrecompiledPageCompressedCache::load(PDFInteger pageIndex, PDFPrecompiledPage* precompiledPage)
+{
+    QByteArray compressedData;
+
+    {
+        QMutexLocker locker(&m_mutex);
+        if (const QByteArray* data = m_cache->object(pageIndex))
+        {
+            compressedData = *data;
+        }
+    }
+
+    if (compressedData.isEmpty())
+    {
+        return false;
+    }
+
+    // Decompress the page without locked mutex, so other
+    // compile tasks are not blocked.
+    QByteArray data = qUncompress(compressedData);
+    bool isLoaded = false;
+
+    if (!data.isEmpty())
+    {
+        QDataStream stream(data);
+        stream.setVersion(QDataStream::Qt_6_0);
+        precompiledPage->deserialize(stream);
+        isLoaded = stream.status() == QDataStream::Ok && precompiledPage->isValid();
+    }
+
+    if (!isLoaded)
+    {
+        *precompiledPage = PDFPrecompiledPage();
+
+        QMutexLocker locker(&m_mutex);
+        m_cache->remove(pageIndex);
+    }
+
+    return isLoaded;
+}
+
+void PDFPrecompiledPageCompressedCache::store(PDFInteger pageIndex, const PDFPrecompiledPage& precompiledPage)
+{
+    if (!isEnabled() || !precompiledPage.isValid())
+    {
+        return;
+    }
+
+    QByteArray data;
+    {
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_6_0);
+        precompiledPage.serialize(stream);
+    }
+
+    QByteArray compressedData = qCompress(data, COMPRESSION_LEVEL);
+    const qsizetype cost = compressedData.size();
+
+    QMutexLocker locker(&m_mutex);
+    m_cache->insert(pageIndex, new QByteArray(qMove(compressedData)), cost);
+}
+
+void PDFPrecompiledPageCompressedCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_cache->clear();
+}
+
+qint64 PDFPrecompiledPageCompressedCache::getCacheCost() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cache->totalCost();
+}
+
+qint64 PDFPrecompiledPageCompressedCache::getCachedPageCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cache->count();
+}
+
 PDFAsynchronousPageCompilerWorkerThread::PDFAsynchronousPageCompilerWorkerThread(PDFAsynchronousPageCompiler* parent) :
     QThread(parent),
     m_compiler(parent),
     m_mutex(&m_compiler->m_mutex),
     m_waitCondition(&m_compiler->m_waitCondition)
 {
-
+    // Name of the thread is displayed in the trace
+    setObjectName("Page compiler");
 }
 
 void PDFAsynchronousPageCompilerWorkerThread::run()
@@ -55,15 +342,33 @@ void PDFAsynchronousPageCompilerWorkerThread::run()
         {
             while (!isInterruptionRequested())
             {
+                // Pages requested for drawing are compiled first. Prefetched
+                // pages are compiled only in small batches, when there are no
+                // other tasks, so newly requested pages don't wait too long.
                 std::vector<PDFAsynchronousPageCompiler::CompileTask> tasks;
+                std::vector<PDFAsynchronousPageCompiler::CompileTask> prefetchTasks;
                 for (auto& task : m_compiler->m_tasks)
                 {
                     if (!task.second.finished)
                     {
-                        tasks.push_back(task.second);
+                        if (task.second.prefetch)
+                        {
+                            prefetchTasks.push_back(task.second);
+                        }
+                        else
+                        {
+                            tasks.push_back(task.second);
+                        }
                     }
                 }
 
+                if (tasks.empty() && !prefetchTasks.empty())
+                {
+                    std::sort(prefetchTasks.begin(), prefetchTasks.end(), [](const auto& l, const auto& r) { return l.prefetchOrder < r.prefetchOrder; });
+                    const size_t count = qMin(prefetchTasks.size(), PDFAsynchronousPageCompiler::PREFETCH_BATCH_SIZE);
+                    tasks.insert(tasks.end(), std::make_move_iterator(prefetchTasks.begin()), std::make_move_iterator(std::next(prefetchTasks.begin(), count)));
+                }
+
                 if (!tasks.empty())
                 {
                     locker.unlock();
@@ -74,15 +379,63 @@ void PDFAsynchronousPageCompilerWorkerThread::run()
 
                     auto compilePage = [this, proxy](PDFAsynchronousPageCompiler::CompileTask& task) -> PDFPrecompiledPage
                     {
+                        PDF_TRACE_ZONE("CompilePageTask", "compile");
+                        PDF_TRACE_FLOW(End, "PageRequest", task.traceFlowId);
+
                         PDFPrecompiledPage compiledPage;
-                        PDFCMSPointer cms = proxy->getCMSManager()->getCurrentCMS();
-                        PDFRenderer renderer(proxy->getDocument(), proxy->getFontCache(), cms.data(), proxy->getOptionalContentActivity(), proxy->getFeatures(), proxy->getMeshQualitySettings());
-                        renderer.setOperationControl(m_compiler);
-                        renderer.compile(&task.precompiledPage, task.pageIndex);
+
+                        // Try to decompress the page from the compressed cache first,
+                        // then try to load it from the disk cache.
+                        const bool isCompressedCacheEnabled = m_compiler->m_compressedCache.isEnabled();
+                        const bool isDiskCacheEnabled = m_compiler->m_diskCache.isEnabled();
+                        if (m_compiler->m_compressedCache.load(task.pageIndex, &task.precompiledPage))
+                        {
+                            ++m_compiler->m_compressedCacheHits;
+                        }
+                        else if (m_compiler->m_diskCache.load(task.pageIndex, &task.precompiledPage))
+                        {
+                            ++m_compiler->m_diskCacheHits;
+
+                            if (isCompressedCacheEnabled)
+                            {
+                                ++m_compiler->m_compressedCacheMisses;
+                                m_compiler->m_compressedCache.store(task.pageIndex, task.precompiledPage);
+                            }
+                        }
+                        else
+                        {
+                            if (isCompressedCacheEnabled)
+                            {
+                                ++m_compiler->m_compressedCacheMisses;
+                            }
+
+                            if (isDiskCacheEnabled)
+                            {
+                                ++m_compiler->m_diskCacheMisses;
+                            }
+
+                            PDFCMSPointer cms = proxy->getCMSManager()->getCurrentCMS();
+                            PDFRenderer renderer(proxy->getDocument(), proxy->getFontCache(), cms.data(), proxy->getOptionalContentActivity(), proxy->getFeatures(), proxy->getMeshQualitySettings());
+                            renderer.setOperationControl(m_compiler);
+                            renderer.setOptionalContentDeferred(true);
+                            renderer.compile(&task.precompiledPage, task.pageIndex);
+
+                            if (!m_compiler->isOperationCancelled())
+                            {
+                                m_compiler->m_diskCache.store(task.pageIndex, task.precompiledPage);
+                                m_compiler->m_compressedCache.store(task.pageIndex, task.precompiledPage);
+                            }
+                        }
                         task.finished = true;
                         return compiledPage;
                     };
-                    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, tasks.begin(), tasks.end(), compilePage);
+                    {
+                        // Pages requested for drawing have interactive priority,
+                        // prefetched pages are compiled in the background.
+                        const bool isPrefetch = std::all_of(tasks.cbegin(), tasks.cend(), [](const auto& task) { return task.prefetch; });
+                        PDFExecutionPriorityGuard priorityGuard(isPrefetch ? PDFExecutionPolicy::Priority::Background : PDFExecutionPolicy::Priority::Interactive);
+                        PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, tasks.begin(), tasks.end(), compilePage);
+                    }
 
                     proxy->getFontCache()->setCacheShrinkEnabled(this, true);
 
@@ -148,188 +501,1024 @@ void PDFAsynchronousPageCompiler::start()
         {
             Q_ASSERT(!m_thread);
             m_state = State::Active;
+            m_diskCache.setKey(createDiskCacheKey());
             m_thread = new PDFAsynchronousPageCompilerWorkerThread(this);
             connect(m_thread, &PDFAsynchronousPageCompilerWorkerThread::pageCompiled, this, &PDFAsynchronousPageCompiler::onPageCompiled);
             m_thread->start();
             break;
         }
 
-        case State::Active:
-            break; // We have nothing to do...
+        case State::Active:
+            break; // We have nothing to do...
+
+        case State::Stopping:
+        {
+            // We shouldn't call this function while stopping!
+            Q_ASSERT(false);
+            break;
+        }
+    }
+}
+
+void PDFAsynchronousPageCompiler::stop(bool clearCache)
+{
+    switch (m_state)
+    {
+        case State::Inactive:
+        {
+            Q_ASSERT(!m_thread);
+            break; // We have nothing to do...
+        }
+
+        case State::Active:
+        {
+            // Stop the engine
+            m_state = State::Stopping;
+
+            Q_ASSERT(m_thread);
+            m_thread->requestInterruption();
+            m_waitCondition.wakeAll();
+            m_thread->wait();
+            delete m_thread;
+            m_thread = nullptr;
+
+            // It is safe to do not use mutex, because
+            // we have ended the work thread.
+            m_tasks.clear();
+
+            if (clearCache)
+            {
+                m_cache->clear();
+                m_compressedCache.clear();
+            }
+
+            m_state = State::Inactive;
+            break;
+        }
+
+        case State::Stopping:
+        {
+            // We shouldn't call this function while stopping!
+            Q_ASSERT(false);
+            break;
+        }
+    }
+}
+
+void PDFAsynchronousPageCompiler::reset()
+{
+    stop(true);
+    start();
+}
+
+void PDFAsynchronousPageCompiler::setCacheLimit(int limit)
+{
+    m_cache->setMaxCost(limit);
+}
+
+qint64 PDFAsynchronousPageCompiler::getCacheCost() const
+{
+    return m_cache->totalCost();
+}
+
+void PDFAsynchronousPageCompiler::shrinkCache(qint64 cost)
+{
+    // Cache removes least recently used objects, when maximal cost is decreased
+    const qsizetype limit = m_cache->maxCost();
+    m_cache->setMaxCost(qsizetype(qMin<qint64>(cost, limit)));
+    m_cache->setMaxCost(limit);
+}
+
+void PDFAsynchronousPageCompiler::setDiskCache(QString directory, qint64 limit)
+{
+    Q_ASSERT(m_state == State::Inactive);
+    m_diskCache.setCacheDirectory(qMove(directory), limit);
+}
+
+void PDFAsynchronousPageCompiler::setCompressedCacheLimit(qint64 limit)
+{
+    m_compressedCache.setCacheLimit(limit);
+}
+
+QByteArray PDFAsynchronousPageCompiler::createDiskCacheKey() const
+{
+    const PDFDocument* document = m_proxy->getDocument();
+    if (!document || document->getSourceDataHash().isEmpty())
+    {
+        return QByteArray();
+    }
+
+    QByteArray key;
+    QDataStream stream(&key, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    stream << document->getSourceDataHash();
+
+    // Compiled pages don't depend on color mode, if colors are adjusted on rendered images
+    PDFRenderer::Features features = m_proxy->getFeatures();
+    if (features.testFlag(PDFRenderer::ColorAdjust_PostProcess))
+    {
+        features &= ~PDFRenderer::getColorFeatures();
+    }
+    stream << int(features);
+
+    const PDFMeshQualitySettings& meshQualitySettings = m_proxy->getMeshQualitySettings();
+    stream << meshQualitySettings.minimalMeshResolutionRatio;
+    stream << meshQualitySettings.preferredMeshResolutionRatio;
+    stream << meshQualitySettings.userSpaceToDeviceSpaceMatrix;
+    stream << meshQualitySettings.deviceSpaceMeshingArea;
+    stream << meshQualitySettings.preferredMeshResolution;
+    stream << meshQualitySettings.minimalMeshResolution;
+    stream << meshQualitySettings.tolerance;
+    stream << meshQualitySettings.patchTestPoints;
+    stream << meshQualitySettings.patchResolutionMappingRatioLow;
+    stream << meshQualitySettings.patchResolutionMappingRatioHigh;
+
+    const PDFCMSSettings& cmsSettings = m_proxy->getCMSManager()->getSettings();
+    stream << int(cmsSettings.system);
+    stream << int(cmsSettings.accuracy);
+    stream << int(cmsSettings.intent);
+    stream << int(cmsSettings.proofingIntent);
+    stream << int(cmsSettings.colorAdaptationXYZ);
+    stream << cmsSettings.isBlackPointCompensationActive;
+    stream << cmsSettings.isWhitePaperColorTransformed;
+    stream << cmsSettings.isGamutChecking;
+    stream << cmsSettings.isSoftProofing;
+    stream << cmsSettings.isConsiderOutputIntent;
+    stream << cmsSettings.outOfGamutColor;
+    stream << cmsSettings.outputCS;
+    stream << cmsSettings.deviceGray;
+    stream << cmsSettings.deviceRGB;
+    stream << cmsSettings.deviceCMYK;
+    stream << cmsSettings.softProofingProfile;
+    stream << cmsSettings.profileDirectory;
+    stream << cmsSettings.foregroundColor;
+    stream << cmsSettings.backgroundColor;
+    stream << cmsSettings.bitonalThreshold;
+    stream << cmsSettings.sigmoidSlopeFactor;
+
+    // States of optional content groups are not part of the key, because
+    // optional content is deferred and it is evaluated, when page is drawn.
+
+    return key;
+}
+
+const PDFPrecompiledPage* PDFAsynchronousPageCompiler::getCompiledPage(PDFInteger pageIndex, bool compile)
+{
+    if (m_state != State::Active || !m_proxy->getDocument())
+    {
+        // Engine is not active, always return nullptr
+        return nullptr;
+    }
+
+    PDFPrecompiledPage* page = m_cache->object(pageIndex);
+
+    if (compile)
+    {
+        ++(page ? m_cacheHits : m_cacheMisses);
+    }
+
+    if (!page && compile)
+    {
+        PDF_TRACE_ZONE("RequestPage", "compile");
+
+        QMutexLocker locker(&m_mutex);
+        auto it = m_tasks.find(pageIndex);
+        if (it == m_tasks.end())
+        {
+            // Flow connects request of the page with its compilation in the worker thread
+            CompileTask task(pageIndex);
+            task.traceFlowId = PDF_TRACE_FLOW_ID();
+            PDF_TRACE_FLOW(Begin, "PageRequest", task.traceFlowId);
+
+            m_tasks.insert(std::make_pair(pageIndex, qMove(task)));
+            m_waitCondition.wakeOne();
+        }
+        else if (it->second.prefetch)
+        {
+            // Page is needed now, so it has no longer low priority
+            it->second.prefetch = false;
+            m_waitCondition.wakeOne();
+        }
+    }
+
+    if (page)
+    {
+        page->markAccessed();
+    }
+
+    return page;
+}
+
+PDFAsynchronousPageCompilerStatistics PDFAsynchronousPageCompiler::getStatistics() const
+{
+    PDFAsynchronousPageCompilerStatistics statistics;
+    statistics.cacheHits = m_cacheHits;
+    statistics.cacheMisses = m_cacheMisses;
+    statistics.diskCacheHits = m_diskCacheHits;
+    statistics.diskCacheMisses = m_diskCacheMisses;
+    statistics.compressedCacheHits = m_compressedCacheHits;
+    statistics.compressedCacheMisses = m_compressedCacheMisses;
+    statistics.compressedCachedPageCount = m_compressedCache.getCachedPageCount();
+    statistics.compressedCacheCost = m_compressedCache.getCacheCost();
+    statistics.cachedPageCount = m_cache->count();
+    statistics.cacheCost = m_cache->totalCost();
+
+    QMutexLocker locker(&m_mutex);
+    for (const auto& item : m_tasks)
+    {
+        const CompileTask& task = item.second;
+        if (!task.finished)
+        {
+            ++(task.prefetch ? statistics.pendingPrefetchTaskCount : statistics.pendingTaskCount);
+        }
+    }
+
+    return statistics;
+}
+
+void PDFAsynchronousPageCompiler::prefetchPages(const std::vector<PDFInteger>& pageIndices)
+{
+    if (m_state != State::Active || !m_proxy->getDocument())
+    {
+        return;
+    }
+
+    // Do not prefetch pages, if cache is almost full, because prefetched
+    // pages would evict pages, which were recently drawn.
+    const bool isCacheAlmostFull = m_cache->totalCost() >= m_cache->maxCost() / 4 * 3;
+
+    QMutexLocker locker(&m_mutex);
+
+    // Cancel pending prefetch requests
+    for (auto it = m_tasks.begin(); it != m_tasks.end();)
+    {
+        const CompileTask& task = it->second;
+        if (task.prefetch && !task.finished && (isCacheAlmostFull || std::find(pageIndices.cbegin(), pageIndices.cend(), task.pageIndex) == pageIndices.cend()))
+        {
+            it = m_tasks.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    if (isCacheAlmostFull)
+    {
+        return;
+    }
+
+    bool isTaskAdded = false;
+    for (size_t i = 0; i < pageIndices.size(); ++i)
+    {
+        const PDFInteger pageIndex = pageIndices[i];
+        if (m_cache->contains(pageIndex))
+        {
+            continue;
+        }
+
+        auto it = m_tasks.find(pageIndex);
+        if (it == m_tasks.end())
+        {
+            CompileTask task(pageIndex);
+            task.prefetch = true;
+            task.prefetchOrder = i;
+            m_tasks.insert(std::make_pair(pageIndex, std::move(task)));
+            isTaskAdded = true;
+        }
+        else if (it->second.prefetch)
+        {
+            it->second.prefetchOrder = i;
+        }
+    }
+
+    if (isTaskAdded)
+    {
+        m_waitCondition.wakeOne();
+    }
+}
+
+void PDFAsynchronousPageCompiler::smartClearCache(const int milisecondsLimit, const std::vector<PDFInteger>& activePages)
+{
+    if (m_state != State::Active)
+    {
+        // Jakub Melka: Cache clearing can be done only in active state
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+
+    Q_ASSERT(std::is_sorted(activePages.cbegin(), activePages.cend()));
+
+    QList<PDFInteger> pageIndices = m_cache->keys();
+    for (const PDFInteger pageIndex : pageIndices)
+    {
+        if (std::binary_search(activePages.cbegin(), activePages.cend(), pageIndex))
+        {
+            // We do not remove active page
+            continue;
+        }
+
+        const PDFPrecompiledPage* page = m_cache->object(pageIndex);
+        if (page && page->hasExpired(milisecondsLimit))
+        {
+            m_cache->remove(pageIndex);
+        }
+    }
+}
+
+void PDFAsynchronousPageCompiler::onPageCompiled()
+{
+    PDF_TRACE_ZONE("StoreCompiledPages", "compile");
+
+    std::vector<PDFInteger> compiledPages;
+    std::map<PDFInteger, PDFRenderError> errors;
+
+    {
+        QMutexLocker locker(&m_mutex);
+
+        // Search all tasks for finished tasks
+        for (auto it = m_tasks.begin(); it != m_tasks.end();)
+        {
+            CompileTask& task = it->second;
+            if (task.finished)
+            {
+                if (m_state == State::Active)
+                {
+                    // If we are in active state, try to store precompiled page
+                    PDFPrecompiledPage* page = new PDFPrecompiledPage(std::move(task.precompiledPage));
+                    page->markAccessed();
+                    qint64 memoryConsumptionEstimate = page->getMemoryConsumptionEstimate();
+                    if (m_cache->insert(it->first, page, memoryConsumptionEstimate))
+                    {
+                        compiledPages.push_back(it->first);
+                    }
+                    else
+                    {
+                        // We can't insert page to the cache, because cache size is too small. We will
+                        // emit error string to inform the user, that cache is too small.
+                        QString message = PDFTranslationContext::tr("Precompiled page size is too high (%1 kB). Cache size is %2 kB. Increase the cache size!").arg(memoryConsumptionEstimate / 1024).arg(m_cache->maxCost() / 1024);
+                        errors[it->first] = PDFRenderError(RenderErrorType::Error, message);
+                    }
+                }
+
+                it = m_tasks.erase(it);
+            }
+            else
+            {
+                // Just increment the counter
+                ++it;
+            }
+        }
+    }
+
+    for (const auto& error : errors)
+    {
+        Q_EMIT renderingError(error.first, { error.second });
+    }
+
+    if (!compiledPages.empty())
+    {
+        Q_ASSERT(std::is_sorted(compiledPages.cbegin(), compiledPages.cend()));
+        Q_EMIT pageImageChanged(false, compiledPages);
+    }
+}
+
+PDFAsynchronousTileRenderer::PDFAsynchronousTileRenderer(PDFDrawWidgetProxy* proxy) :
+    BaseClass(proxy),
+    m_proxy(proxy),
+    m_cache(new QCache<TileKey, QImage>()),
+    m_convertedCache(new QCache<TileKey, QImage>())
+{
+    m_cache->setMaxCost(128 * 1024 * 1024);
+    m_convertedCache->setMaxCost(128 * 1024 * 1024);
+}
+
+PDFAsynchronousTileRenderer::~PDFAsynchronousTileRenderer()
+{
+    m_threadPool.clear();
+    m_threadPool.waitForDone();
+
+    delete m_cache;
+    m_cache = nullptr;
+
+    delete m_convertedCache;
+    m_convertedCache = nullptr;
+}
+
+void PDFAsynchronousTileRenderer::drawPage(QPainter* painter,
+                                           PDFInteger pageIndex,
+                                           const PDFPage* page,
+                                           const PDFPrecompiledPage* compiledPage,
+                                           const QRect& placedRect,
+                                           const QRect& visibleRect,
+                                           PDFRenderer::Features features,
+                                           PDFReal opacity,
+                                           const PDFColorConvertor& imageConvertor)
+{
+    Q_ASSERT(painter->worldTransform().type() <= QTransform::TxTranslate);
+
+    const QRect pageVisibleRect = placedRect.intersected(visibleRect);
+    if (pageVisibleRect.isEmpty())
+    {
+        return;
+    }
+
+    if (m_convertedCacheConvertor != imageConvertor)
+    {
+        // Color mode was changed, tiles are converted again from tiles with original colors
+        m_convertedCache->clear();
+        m_convertedCacheConvertor = imageConvertor;
+    }
+
+    const PDFReal devicePixelRatio = painter->device()->devicePixelRatioF();
+    const int columnCount = (placedRect.width() + TILE_SIZE - 1) / TILE_SIZE;
+    const int rowCount = (placedRect.height() + TILE_SIZE - 1) / TILE_SIZE;
+
+    // Tiles are numbered from the top left corner of the page
+    const QRect visibleTilesRect = pageVisibleRect.translated(-placedRect.topLeft());
+    const int firstColumn = visibleTilesRect.left() / TILE_SIZE;
+    const int lastColumn = visibleTilesRect.right() / TILE_SIZE;
+    const int firstRow = visibleTilesRect.top() / TILE_SIZE;
+    const int lastRow = visibleTilesRect.bottom() / TILE_SIZE;
+
+    TileKey baseKey;
+    baseKey.pageIndex = pageIndex;
+    baseKey.pageWidth = placedRect.width();
+    baseKey.pageHeight = placedRect.height();
+    baseKey.devicePixelRatio = qRound(devicePixelRatio * 100.0);
+
+    auto getTileRect = [&placedRect](int column, int row)
+    {
+        return QRect(placedRect.left() + column * TILE_SIZE, placedRect.top() + row * TILE_SIZE, TILE_SIZE, TILE_SIZE).intersected(placedRect);
+    };
+
+    QRegion missingRegion;
+    std::vector<TileKey> requestedTiles;
+
+    painter->save();
+    painter->setOpacity(opacity);
+
+    for (int row = firstRow; row <= lastRow; ++row)
+    {
+        for (int column = firstColumn; column <= lastColumn; ++column)
+        {
+            TileKey key = baseKey;
+            key.column = column;
+            key.row = row;
+
+            const QRect tileRect = getTileRect(column, row);
+            if (const QImage* image = getTileImage(key, imageConvertor))
+            {
+                painter->drawImage(tileRect.topLeft(), *image);
+            }
+            else
+            {
+                missingRegion += tileRect;
+                requestedTiles.push_back(key);
+            }
+        }
+    }
+
+    painter->restore();
+
+    // Missing tiles are presented as scaled tiles of previous zoom
+    // level, if we have them, otherwise they are drawn directly.
+    if (!missingRegion.isEmpty())
+    {
+        painter->save();
+        painter->setOpacity(opacity);
+        missingRegion = drawFallbackTiles(painter, baseKey, placedRect, qMove(missingRegion), imageConvertor);
+        painter->restore();
+    }
+
+    if (!missingRegion.isEmpty())
+    {
+        const QTransform baseMatrix = painter->worldTransform();
+        const QTransform matrix = m_proxy->createPagePointToDevicePointMatrix(page, placedRect) * baseMatrix;
+
+        painter->save();
+        painter->setClipRegion(missingRegion, Qt::IntersectClip);
+        const QRectF missingDeviceRect = baseMatrix.mapRect(QRectF(missingRegion.boundingRect()));
+        if (imageConvertor.isActive())
+        {
+            m_proxy->drawCompiledPageColorPostProcessed(painter, page, compiledPage, matrix, missingDeviceRect, features, opacity, imageConvertor);
+        }
+        else
+        {
+            compiledPage->draw(painter, page->getCropBox(), matrix, features, opacity, missingDeviceRect, m_proxy->getOptionalContentActivity());
+        }
+        painter->restore();
+    }
+
+    // Visible tiles are rendered first, tiles closest to the center of
+    // the visible area have the highest priority. Then tiles around
+    // the visible area are rendered in advance, so panning is smooth.
+    const QPoint center(visibleTilesRect.center().x() / TILE_SIZE, visibleTilesRect.center().y() / TILE_SIZE);
+    auto getDistance = [&center](const TileKey& key) { return qAbs(key.column - center.x()) + qAbs(key.row - center.y()); };
+    std::sort(requestedTiles.begin(), requestedTiles.end(), [&getDistance](const TileKey& l, const TileKey& r) { return getDistance(l) < getDistance(r); });
+    const size_t visibleTileCount = requestedTiles.size();
+
+    for (int row = qMax(firstRow - 1, 0); row <= qMin(lastRow + 1, rowCount - 1); ++row)
+    {
+        for (int column = qMax(firstColumn - 1, 0); column <= qMin(lastColumn + 1, columnCount - 1); ++column)
+        {
+            if (row >= firstRow && row <= lastRow && column >= firstColumn && column <= lastColumn)
+            {
+                continue;
+            }
+
+            TileKey key = baseKey;
+            key.column = column;
+            key.row = row;
+
+            if (!m_cache->contains(key))
+            {
+                requestedTiles.push_back(key);
+            }
+        }
+    }
+
+    if (requestedTiles.empty())
+    {
+        return;
+    }
+
+    // Worker threads use their own copy of the precompiled page, because
+    // precompiled page can be removed from the compiler cache meanwhile.
+    PDFPrecompiledPagePointer& sharedCompiledPage = m_compiledPages[pageIndex];
+    if (!sharedCompiledPage)
+    {
+        sharedCompiledPage = std::make_shared<const PDFPrecompiledPage>(*compiledPage);
+    }
+
+    const QRectF cropBox = page->getCropBox();
+    const QTransform pageMatrix = m_proxy->createPagePointToDevicePointMatrix(page, QRectF(QPointF(0, 0), placedRect.size()));
+    const PDFOptionalContentActivity* optionalContentActivity = m_proxy->getOptionalContentActivity();
+
+    for (size_t i = 0; i < requestedTiles.size(); ++i)
+    {
+        const TileKey& key = requestedTiles[i];
+        if (!m_pendingTiles.insert(key).second)
+        {
+            // Tile is already being rendered
+            continue;
+        }
+
+        const QRect tileRect = getTileRect(key.column, key.row).translated(-placedRect.topLeft());
+        const QSize imageSize(qCeil(tileRect.width() * devicePixelRatio), qCeil(tileRect.height() * devicePixelRatio));
+        const QTransform tileMatrix = pageMatrix * QTransform::fromTranslate(-tileRect.left(), -tileRect.top()) * QTransform::fromScale(devicePixelRatio, devicePixelRatio);
+
+        auto renderTile = [this, key, sharedCompiledPage, cropBox, tileMatrix, imageSize, devicePixelRatio, features, optionalContentActivity, imageConvertor]()
+        {
+            QImage image(imageSize, QImage::Format_ARGB32_Premultiplied);
+            image.fill(Qt::transparent);
+
+            {
+                QPainter painter(&image);
+                sharedCompiledPage->draw(&painter, cropBox, tileMatrix, features, 1.0, QRectF(QPointF(0, 0), imageSize), optionalContentActivity);
+            }
+
+            image.setDevicePixelRatio(devicePixelRatio);
+
+            // Tile with original colors is kept too, so color mode can be changed later
+            QImage convertedImage;
+            if (imageConvertor.isActive())
+            {
+                convertedImage = image.copy();
+                imageConvertor.convertRenderedImage(convertedImage);
+            }
+
+            QMetaObject::invokeMethod(this, [this, key, sharedCompiledPage, image, convertedImage, imageConvertor]() { onTileRendered(key, sharedCompiledPage, image, convertedImage, imageConvertor); }, Qt::QueuedConnection);
+        };
+
+        m_threadPool.start(renderTile, i < visibleTileCount ? 1 : 0);
+    }
+}
+
+void PDFAsynchronousTileRenderer::clear()
+{
+    m_threadPool.clear();
+    m_pendingTiles.clear();
+    m_compiledPages.clear();
+    m_tileGrids.clear();
+    m_cache->clear();
+    m_convertedCache->clear();
+}
+
+void PDFAsynchronousTileRenderer::setCacheLimit(qint64 limit)
+{
+    m_cache->setMaxCost(limit);
+    m_convertedCache->setMaxCost(limit);
+}
+
+qint64 PDFAsynchronousTileRenderer::getCacheCost() const
+{
+    return m_cache->totalCost() + m_convertedCache->totalCost();
+}
+
+void PDFAsynchronousTileRenderer::shrinkCache(qint64 cost)
+{
+    // Cache removes least recently used objects, when maximal cost is decreased.
+    // Converted tiles are removed first, because they can be recreated quickly.
+    const qint64 convertedCost = qMax<qint64>(cost - m_cache->totalCost(), 0);
+    const qsizetype convertedLimit = m_convertedCache->maxCost();
+    m_convertedCache->setMaxCost(qsizetype(qMin<qint64>(convertedCost, convertedLimit)));
+    m_convertedCache->setMaxCost(convertedLimit);
+
+    const qsizetype limit = m_cache->maxCost();
+    m_cache->setMaxCost(qsizetype(qMin<qint64>(qMax<qint64>(cost - m_convertedCache->totalCost(), 0), limit)));
+    m_cache->setMaxCost(limit);
+}
+
+void PDFAsynchronousTileRenderer::smartClearCache(const std::vector<PDFInteger>& activePages)
+{
+    Q_ASSERT(std::is_sorted(activePages.cbegin(), activePages.cend()));
+
+    for (auto it = m_compiledPages.begin(); it != m_compiledPages.end();)
+    {
+        if (!std::binary_search(activePages.cbegin(), activePages.cend(), it->first))
+        {
+            it = m_compiledPages.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void PDFAsynchronousTileRenderer::onPageImageChanged(bool all, const std::vector<PDFInteger>& pages)
+{
+    if (all)
+    {
+        clear();
+        return;
+    }
+
+    for (const PDFInteger pageIndex : pages)
+    {
+        m_compiledPages.erase(pageIndex);
+        m_tileGrids.erase(pageIndex);
+    }
+
+    for (QCache<TileKey, QImage>* cache : { m_cache, m_convertedCache })
+    {
+        const QList<TileKey> keys = cache->keys();
+        for (const TileKey& key : keys)
+        {
+            if (std::binary_search(pages.cbegin(), pages.cend(), key.pageIndex))
+            {
+                cache->remove(key);
+            }
+        }
+    }
+}
+
+const QImage* PDFAsynchronousTileRenderer::getTileImage(const TileKey& key, const PDFColorConvertor& imageConvertor)
+{
+    const QImage* image = m_cache->object(key);
+    if (!image || !imageConvertor.isActive())
+    {
+        return image;
+    }
+
+    Q_ASSERT(m_convertedCacheConvertor == imageConvertor);
+    if (const QImage* convertedImage = m_convertedCache->object(key))
+    {
+        return convertedImage;
+    }
+
+    QImage* convertedImage = new QImage(image->copy());
+    imageConvertor.convertRenderedImage(*convertedImage);
+
+    const qint64 memoryConsumptionEstimate = convertedImage->sizeInBytes();
+    m_convertedCache->insert(key, convertedImage, memoryConsumptionEstimate);
+    return m_convertedCache->object(key);
+}
+
+void PDFAsynchronousTileRenderer::onTileRendered(TileKey key, PDFPrecompiledPagePointer compiledPage, QImage image, QImage convertedImage, PDFColorConvertor imageConvertor)
+{
+    m_pendingTiles.erase(key);
+
+    auto it = m_compiledPages.find(key.pageIndex);
+    if (it == m_compiledPages.cend() || it->second != compiledPage)
+    {
+        // Page was changed meanwhile, tile is outdated
+        return;
+    }
+
+    TileKey gridKey = key;
+    gridKey.column = 0;
+    gridKey.row = 0;
+
+    std::vector<TileKey>& tileGrids = m_tileGrids[key.pageIndex];
+    if (tileGrids.empty() || tileGrids.front() != gridKey)
+    {
+        auto gridIt = std::find(tileGrids.begin(), tileGrids.end(), gridKey);
+        if (gridIt != tileGrids.end())
+        {
+            tileGrids.erase(gridIt);
+        }
+
+        tileGrids.insert(tileGrids.begin(), gridKey);
+        if (tileGrids.size() > MAX_FALLBACK_TILE_GRIDS)
+        {
+            tileGrids.resize(MAX_FALLBACK_TILE_GRIDS);
+        }
+    }
+
+    const qint64 memoryConsumptionEstimate = image.sizeInBytes();
+    m_cache->insert(key, new QImage(qMove(image)), memoryConsumptionEstimate);
+
+    if (!convertedImage.isNull() && imageConvertor == m_convertedCacheConvertor)
+    {
+        const qint64 convertedMemoryConsumptionEstimate = convertedImage.sizeInBytes();
+        m_convertedCache->insert(key, new QImage(qMove(convertedImage)), convertedMemoryConsumptionEstimate);
+    }
+    else
+    {
+        // Converted tile is outdated, it will be converted again, when it is drawn
+        m_convertedCache->remove(key);
+    }
+
+    Q_EMIT tileRendered();
+}
+
+QRegion PDFAsynchronousTileRenderer::drawFallbackTiles(QPainter* painter, const TileKey& baseKey, const QRect& placedRect, QRegion missingRegion, const PDFColorConvertor& imageConvertor)
+{
+    auto it = m_tileGrids.find(baseKey.pageIndex);
+    if (it == m_tileGrids.cend())
+    {
+        return missingRegion;
+    }
+
+    painter->setRenderHint(QPainter::SmoothPixmapTransform, true);
+
+    for (const TileKey& gridKey : it->second)
+    {
+        if (missingRegion.isEmpty())
+        {
+            break;
+        }
+
+        if (gridKey.pageWidth == baseKey.pageWidth && gridKey.pageHeight == baseKey.pageHeight)
+        {
+            // This is the current zoom level
+            continue;
+        }
 
-        case State::Stopping:
+        if (gridKey.devicePixelRatio != baseKey.devicePixelRatio || gridKey.pageWidth <= 0 || gridKey.pageHeight <= 0)
         {
-            // We shouldn't call this function while stopping!
-            Q_ASSERT(false);
-            break;
+            continue;
         }
-    }
-}
 
-void PDFAsynchronousPageCompiler::stop(bool clearCache)
-{
-    switch (m_state)
-    {
-        case State::Inactive:
+        const PDFReal scaleX = PDFReal(placedRect.width()) / PDFReal(gridKey.pageWidth);
+        const PDFReal scaleY = PDFReal(placedRect.height()) / PDFReal(gridKey.pageHeight);
+        const PDFReal scale = qMax(scaleX, scaleY);
+        if (scale > MAX_FALLBACK_TILE_SCALE || scale < 1.0 / MAX_FALLBACK_TILE_SCALE)
         {
-            Q_ASSERT(!m_thread);
-            break; // We have nothing to do...
+            continue;
         }
 
-        case State::Active:
+        // Find tiles of the grid, which are intersecting missing region
+        const QRect gridRect(0, 0, gridKey.pageWidth, gridKey.pageHeight);
+        const QRectF missingRect = QRectF(missingRegion.boundingRect()).translated(-placedRect.topLeft());
+        const QRect missingGridRect = QRectF(missingRect.left() / scaleX, missingRect.top() / scaleY, missingRect.width() / scaleX, missingRect.height() / scaleY).toAlignedRect().intersected(gridRect);
+        if (missingGridRect.isEmpty())
         {
-            // Stop the engine
-            m_state = State::Stopping;
+            continue;
+        }
 
-            Q_ASSERT(m_thread);
-            m_thread->requestInterruption();
-            m_waitCondition.wakeAll();
-            m_thread->wait();
-            delete m_thread;
-            m_thread = nullptr;
+        const int firstColumn = missingGridRect.left() / TILE_SIZE;
+        const int lastColumn = missingGridRect.right() / TILE_SIZE;
+        const int firstRow = missingGridRect.top() / TILE_SIZE;
+        const int lastRow = missingGridRect.bottom() / TILE_SIZE;
 
-            // It is safe to do not use mutex, because
-            // we have ended the work thread.
-            m_tasks.clear();
+        QRegion coveredRegion;
 
-            if (clearCache)
+        painter->save();
+        painter->setClipRegion(missingRegion, Qt::IntersectClip);
+
+        for (int row = firstRow; row <= lastRow; ++row)
+        {
+            for (int column = firstColumn; column <= lastColumn; ++column)
             {
-                m_cache->clear();
-            }
+                TileKey key = gridKey;
+                key.column = column;
+                key.row = row;
 
-            m_state = State::Inactive;
-            break;
+                if (const QImage* image = getTileImage(key, imageConvertor))
+                {
+                    const QRect tileRect = QRect(column * TILE_SIZE, row * TILE_SIZE, TILE_SIZE, TILE_SIZE).intersected(gridRect);
+                    const QRectF targetRect(placedRect.left() + tileRect.left() * scaleX,
+                                            placedRect.top() + tileRect.top() * scaleY,
+                                            tileRect.width() * scaleX,
+                                            tileRect.height() * scaleY);
+                    painter->drawImage(targetRect, *image);
+                    coveredRegion += targetRect.toAlignedRect();
+                }
+            }
         }
 
-        case State::Stopping:
-        {
-            // We shouldn't call this function while stopping!
-            Q_ASSERT(false);
-            break;
-        }
+        painter->restore();
+        missingRegion -= coveredRegion;
     }
+
+    return missingRegion;
 }
 
-void PDFAsynchronousPageCompiler::reset()
+PDFAsynchronousPreviewRenderer::PDFAsynchronousPreviewRenderer(PDFDrawWidgetProxy* proxy) :
+    BaseClass(proxy),
+    m_proxy(proxy),
+    m_cache(new QCache<PDFInteger, QImage>())
 {
-    stop(true);
-    start();
+    m_cache->setMaxCost(64 * 1024 * 1024);
+
+    // Previews should not slow down compiling of pages
+    m_threadPool.setMaxThreadCount(1);
 }
 
-void PDFAsynchronousPageCompiler::setCacheLimit(int limit)
+PDFAsynchronousPreviewRenderer::~PDFAsynchronousPreviewRenderer()
 {
-    m_cache->setMaxCost(limit);
+    clear();
+
+    delete m_cache;
+    m_cache = nullptr;
 }
 
-const PDFPrecompiledPage* PDFAsynchronousPageCompiler::getCompiledPage(PDFInteger pageIndex, bool compile)
+const QImage* PDFAsynchronousPreviewRenderer::getPreviewImage(PDFInteger pageIndex) const
 {
-    if (m_state != State::Active || !m_proxy->getDocument())
+    return m_cache->object(pageIndex);
+}
+
+void PDFAsynchronousPreviewRenderer::requestPreviewImage(PDFInteger pageIndex, const PDFPrecompiledPage* compiledPage)
+{
+    if (m_cache->contains(pageIndex))
     {
-        // Engine is not active, always return nullptr
-        return nullptr;
+        // Preview image already exists
+        return;
     }
 
-    PDFPrecompiledPage* page = m_cache->object(pageIndex);
-
-    if (!page && compile)
+    auto it = m_tasks.find(pageIndex);
+    if (it != m_tasks.cend())
     {
-        QMutexLocker locker(&m_mutex);
-        if (!m_tasks.count(pageIndex))
+        if (it->second->isFromCompiledPage || !compiledPage)
         {
-            m_tasks.insert(std::make_pair(pageIndex, CompileTask(pageIndex)));
-            m_waitCondition.wakeOne();
+            // Preview is already being rendered
+            return;
         }
+
+        // Page was compiled meanwhile, so rendering from compiled
+        // page is faster than compiling it in preview mode.
+        it->second->isCancelled = true;
+        m_tasks.erase(it);
     }
 
-    if (page)
+    const PDFDocument* document = m_proxy->getDocument();
+    const PDFPage* page = document ? document->getCatalog()->getPage(pageIndex) : nullptr;
+    if (!page)
     {
-        page->markAccessed();
+        return;
     }
 
-    return page;
-}
-
-void PDFAsynchronousPageCompiler::smartClearCache(const int milisecondsLimit, const std::vector<PDFInteger>& activePages)
-{
-    if (m_state != State::Active)
+    QSizeF pageSize = page->getRotatedMediaBox().size();
+    pageSize.scale(PREVIEW_SIZE, PREVIEW_SIZE, Qt::KeepAspectRatio);
+    const QSize imageSize = pageSize.toSize();
+    if (imageSize.isEmpty())
     {
-        // Jakub Melka: Cache clearing can be done only in active state
         return;
     }
 
-    QMutexLocker locker(&m_mutex);
+    PreviewTaskPointer task = std::make_shared<PreviewTask>();
+    task->isFromCompiledPage = compiledPage != nullptr;
+    m_tasks[pageIndex] = task;
 
-    Q_ASSERT(std::is_sorted(activePages.cbegin(), activePages.cend()));
+    // Worker thread uses its own copy of the compiled page, because
+    // compiled page can be removed from the compiler cache meanwhile.
+    std::shared_ptr<const PDFPrecompiledPage> sharedCompiledPage;
+    if (compiledPage)
+    {
+        sharedCompiledPage = std::make_shared<const PDFPrecompiledPage>(*compiledPage);
+    }
 
-    QList<PDFInteger> pageIndices = m_cache->keys();
-    for (const PDFInteger pageIndex : pageIndices)
+    auto renderPreview = [this, pageIndex, page, task, sharedCompiledPage, imageSize]()
     {
-        if (std::binary_search(activePages.cbegin(), activePages.cend(), pageIndex))
+        PDFExecutionPriorityGuard priorityGuard(PDFExecutionPolicy::Priority::Background);
+
+        QImage image;
+        const QTransform matrix = PDFRenderer::createPagePointToDevicePointMatrix(page, QRect(QPoint(0, 0), imageSize));
+        PDFRenderer::Features features = m_proxy->getFeatures();
+
+        std::shared_ptr<const PDFPrecompiledPage> previewCompiledPage = sharedCompiledPage;
+        if (!previewCompiledPage && !task->isCancelled)
         {
-            // We do not remove active page
-            continue;
+            // Compile the page in fast preview mode - images are decoded at reduced
+            // resolution and shadings are meshed with coarse resolution.
+            PDFMeshQualitySettings meshQualitySettings = m_proxy->getMeshQualitySettings();
+            meshQualitySettings.minimalMeshResolutionRatio *= 4.0;
+            meshQualitySettings.preferredMeshResolutionRatio *= 4.0;
+            meshQualitySettings.tolerance = qMax(meshQualitySettings.tolerance, 0.05);
+            meshQualitySettings.patchTestPoints = qMin<PDFInteger>(meshQualitySettings.patchTestPoints, 16);
+
+            m_proxy->getFontCache()->setCacheShrinkEnabled(task.get(), false);
+
+            PDFPrecompiledPage compiledPage;
+            PDFCMSPointer cms = m_proxy->getCMSManager()->getCurrentCMS();
+            PDFRenderer renderer(m_proxy->getDocument(), m_proxy->getFontCache(), cms.data(), m_proxy->getOptionalContentActivity(), features | PDFRenderer::DownscaleImages, meshQualitySettings);
+            renderer.setOperationControl(task.get());
+            renderer.compile(&compiledPage, pageIndex, &matrix);
+            previewCompiledPage = std::make_shared<const PDFPrecompiledPage>(qMove(compiledPage));
+
+            m_proxy->getFontCache()->setCacheShrinkEnabled(task.get(), true);
         }
 
-        const PDFPrecompiledPage* page = m_cache->object(pageIndex);
-        if (page && page->hasExpired(milisecondsLimit))
+        if (!task->isCancelled)
         {
-            m_cache->remove(pageIndex);
+            image = QImage(imageSize, QImage::Format_ARGB32_Premultiplied);
+            image.fill(Qt::transparent);
+
+            QPainter painter(&image);
+            previewCompiledPage->draw(&painter, page->getCropBox(), matrix, features, 1.0, QRectF(), m_proxy->getOptionalContentActivity());
         }
-    }
+
+        QMetaObject::invokeMethod(this, [this, pageIndex, task, image]() { onPreviewImageRendered(pageIndex, task, image); }, Qt::QueuedConnection);
+    };
+
+    m_threadPool.start(renderPreview);
 }
 
-void PDFAsynchronousPageCompiler::onPageCompiled()
+void PDFAsynchronousPreviewRenderer::cancelStaleTasks(const std::vector<PDFInteger>& activePages)
 {
-    std::vector<PDFInteger> compiledPages;
-    std::map<PDFInteger, PDFRenderError> errors;
+    Q_ASSERT(std::is_sorted(activePages.cbegin(), activePages.cend()));
 
+    for (auto it = m_tasks.begin(); it != m_tasks.end();)
     {
-        QMutexLocker locker(&m_mutex);
-
-        // Search all tasks for finished tasks
-        for (auto it = m_tasks.begin(); it != m_tasks.end();)
+        if (!std::binary_search(activePages.cbegin(), activePages.cend(), it->first))
         {
-            CompileTask& task = it->second;
-            if (task.finished)
-            {
-                if (m_state == State::Active)
-                {
-                    // If we are in active state, try to store precompiled page
-                    PDFPrecompiledPage* page = new PDFPrecompiledPage(std::move(task.precompiledPage));
-                    page->markAccessed();
-                    qint64 memoryConsumptionEstimate = page->getMemoryConsumptionEstimate();
-                    if (m_cache->insert(it->first, page, memoryConsumptionEstimate))
-                    {
-                        compiledPages.push_back(it->first);
-                    }
-                    else
-                    {
-                        // We can't insert page to the cache, because cache size is too small. We will
-                        // emit error string to inform the user, that cache is too small.
-                        QString message = PDFTranslationContext::tr("Precompiled page size is too high (%1 kB). Cache size is %2 kB. Increase the cache size!").arg(memoryConsumptionEstimate / 1024).arg(m_cache->maxCost() / 1024);
-                        errors[it->first] = PDFRenderError(RenderErrorType::Error, message);
-                    }
-                }
-
-                it = m_tasks.erase(it);
-            }
-            else
-            {
-                // Just increment the counter
-                ++it;
-            }
+            it->second->isCancelled = true;
+            it = m_tasks.erase(it);
+        }
+        else
+        {
+            ++it;
         }
     }
+}
 
-    for (const auto& error : errors)
+void PDFAsynchronousPreviewRenderer::clear()
+{
+    for (const auto& task : m_tasks)
     {
-        Q_EMIT renderingError(error.first, { error.second });
+        task.second->isCancelled = true;
     }
+    m_tasks.clear();
 
-    if (!compiledPages.empty())
+    // Tasks use the document, so we must wait for them to finish
+    m_threadPool.clear();
+    m_threadPool.waitForDone();
+    m_cache->clear();
+}
+
+qint64 PDFAsynchronousPreviewRenderer::getCacheCost() const
+{
+    return m_cache->totalCost();
+}
+
+void PDFAsynchronousPreviewRenderer::shrinkCache(qint64 cost)
+{
+    // Cache removes least recently used objects, when maximal cost is decreased
+    const qsizetype limit = m_cache->maxCost();
+    m_cache->setMaxCost(qsizetype(qMin<qint64>(cost, limit)));
+    m_cache->setMaxCost(limit);
+}
+
+void PDFAsynchronousPreviewRenderer::onPageImageChanged(bool all, const std::vector<PDFInteger>& pages)
+{
+    Q_UNUSED(pages);
+
+    if (all)
     {
-        Q_ASSERT(std::is_sorted(compiledPages.cbegin(), compiledPages.cend()));
-        Q_EMIT pageImageChanged(false, compiledPages);
+        clear();
+    }
+}
+
+void PDFAsynchronousPreviewRenderer::onPreviewImageRendered(PDFInteger pageIndex, PreviewTaskPointer task, QImage image)
+{
+    auto it = m_tasks.find(pageIndex);
+    if (it == m_tasks.cend() || it->second != task)
+    {
+        // Task was cancelled meanwhile
+        return;
+    }
+    m_tasks.erase(it);
+
+    if (!task->isCancelled && !image.isNull())
+    {
+        const qint64 memoryConsumptionEstimate = image.sizeInBytes();
+        m_cache->insert(pageIndex, new QImage(qMove(image)), memoryConsumptionEstimate);
+        Q_EMIT previewImageRendered();
     }
 }
 
@@ -339,7 +1528,7 @@ PDFAsynchronousTextLayoutCompiler::PDFAsynchronousTextLayoutCompiler(PDFDrawWidg
     m_isRunning(false),
     m_cache(std::bind(&PDFAsynchronousTextLayoutCompiler::createTextLayout, this, std::placeholders::_1))
 {
-    connect(&m_textLayoutCompileFutureWatcher, &QFutureWatcher<PDFTextLayoutStorage>::finished, this, &PDFAsynchronousTextLayoutCompiler::onTextLayoutCreated);
+    connect(&m_textLayoutCompileFutureWatcher, &QFutureWatcher<void>::finished, this, &PDFAsynchronousTextLayoutCompiler::onTextLayoutCreated);
 }
 
 void PDFAsynchronousTextLayoutCompiler::start()
@@ -373,12 +1562,22 @@ void PDFAsynchronousTextLayoutCompiler::stop(bool clearCache)
 
         case State::Active:
         {
-            // Stop the engine
+            // Stop the engine. If cache is being cleared, then text layout
+            // being created is no longer needed, so we cancel its creation.
             m_state = State::Stopping;
+            if (clearCache)
+            {
+                m_cancellationToken.cancel();
+            }
             m_textLayoutCompileFutureWatcher.waitForFinished();
 
             if (clearCache)
             {
+                if (m_isRunning)
+                {
+                    finishTextLayoutCreation();
+                }
+
                 m_textLayouts = std::nullopt;
                 m_cache.clear();
             }
@@ -418,6 +1617,12 @@ PDFTextLayout PDFAsynchronousTextLayoutCompiler::createTextLayout(PDFInteger pag
             return result;
         }
 
+        if (std::optional<PDFTextLayout> partialTextLayout = getPartialTextLayout(pageIndex))
+        {
+            // Page was already processed by asynchronous compilation
+            return qMove(*partialTextLayout);
+        }
+
         const PDFCatalog* catalog = m_proxy->getDocument()->getCatalog();
         if (pageIndex < 0 || pageIndex >= PDFInteger(catalog->getPageCount()))
         {
@@ -441,6 +1646,15 @@ PDFTextLayout PDFAsynchronousTextLayoutCompiler::createTextLayout(PDFInteger pag
         generator.processContents();
         result = generator.createTextLayout();
         m_proxy->getFontCache()->setCacheShrinkEnabled(&guard, true);
+
+        if (m_isRunning)
+        {
+            // Store the layout, so asynchronous compilation can skip this page
+            m_partialTextLayouts.setTextLayout(pageIndex, result, &m_partialTextLayoutsMutex);
+
+            QMutexLocker lock(&m_partialTextLayoutsMutex);
+            m_partialTextLayoutsReady[pageIndex] = true;
+        }
     }
 
     return result;
@@ -553,31 +1767,78 @@ void PDFAsynchronousTextLayoutCompiler::makeTextLayout()
 
     PDFCMSPointer cms = m_proxy->getCMSManager()->getCurrentCMS();
 
-    auto createTextLayout = [this, cms, catalog]() -> PDFTextLayoutStorage
+    const PDFInteger pageCount = catalog->getPageCount();
+    m_cancellationToken.reset();
+    m_partialTextLayouts = PDFTextLayoutStorage(pageCount);
+    m_partialTextLayouts.enableTextIndex(PDFTextFlow::SeparateBlocks);
+    m_partialTextLayoutsReady.assign(pageCount, false);
+    m_pendingPages.resize(pageCount);
+    std::iota(m_pendingPages.begin(), m_pendingPages.end(), PDFInteger(0));
+    sortPendingPages();
+
+    auto createTextLayout = [this, cms, catalog, pageCount]()
     {
-        PDFTextLayoutStorage result(catalog->getPageCount());
-        QMutex mutex;
-        auto generateTextLayout = [this, &result, &mutex, cms, catalog](PDFInteger pageIndex)
+        // Each call takes the page with highest priority from
+        // the queue, so the order of processing follows the priority, even
+        // if the queue is reordered during the compilation.
+        auto generateTextLayout = [this, cms, catalog](PDFInteger)
         {
-            if (!catalog->getPage(pageIndex))
+            if (m_cancellationToken.isOperationCancelled())
+            {
+                return;
+            }
+
+            PDFInteger pageIndex = -1;
+            {
+                QMutexLocker lock(&m_partialTextLayoutsMutex);
+                while (!m_pendingPages.empty() && pageIndex == -1)
+                {
+                    pageIndex = m_pendingPages.back();
+                    m_pendingPages.pop_back();
+
+                    if (m_partialTextLayoutsReady[pageIndex])
+                    {
+                        // Page was already processed synchronously
+                        pageIndex = -1;
+                        m_proxy->getProgress()->step();
+                    }
+                }
+            }
+
+            if (pageIndex == -1)
             {
-                // Invalid page index
-                result.setTextLayout(pageIndex, PDFTextLayout(), &mutex);
                 return;
             }
 
-            const PDFPage* page = catalog->getPage(pageIndex);
-            Q_ASSERT(page);
+            PDFTextLayout textLayout;
+            if (const PDFPage* page = catalog->getPage(pageIndex))
+            {
+                PDFTextLayoutGenerator generator(m_proxy->getFeatures(), page, m_proxy->getDocument(), m_proxy->getFontCache(), cms.data(), m_proxy->getOptionalContentActivity(), QTransform(), m_proxy->getMeshQualitySettings());
+                generator.setOperationControl(&m_cancellationToken);
+                generator.processContents();
+                textLayout = generator.createTextLayout();
+            }
+
+            if (m_cancellationToken.isOperationCancelled())
+            {
+                // Text layout may be incomplete, it is abandoned
+                return;
+            }
+
+            m_partialTextLayouts.setTextLayout(pageIndex, textLayout, &m_partialTextLayoutsMutex);
+
+            {
+                QMutexLocker lock(&m_partialTextLayoutsMutex);
+                m_partialTextLayoutsReady[pageIndex] = true;
+            }
 
-            PDFTextLayoutGenerator generator(m_proxy->getFeatures(), page, m_proxy->getDocument(), m_proxy->getFontCache(), cms.data(), m_proxy->getOptionalContentActivity(), QTransform(), m_proxy->getMeshQualitySettings());
-            generator.processContents();
-            result.setTextLayout(pageIndex, generator.createTextLayout(), &mutex);
             m_proxy->getProgress()->step();
         };
 
-        auto pageRange = PDFIntegerRange<PDFInteger>(0, catalog->getPageCount());
+        // Indexing of the whole document must not delay compilation of visible pages
+        PDFExecutionPriorityGuard priorityGuard(PDFExecutionPolicy::Priority::Background);
+        auto pageRange = PDFIntegerRange<PDFInteger>(0, pageCount);
         PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, pageRange.begin(), pageRange.end(), generateTextLayout);
-        return result;
     };
 
     Q_ASSERT(!m_textLayoutCompileFuture.isRunning());
@@ -585,14 +1846,97 @@ void PDFAsynchronousTextLayoutCompiler::makeTextLayout()
     m_textLayoutCompileFutureWatcher.setFuture(m_textLayoutCompileFuture);
 }
 
-void PDFAsynchronousTextLayoutCompiler::onTextLayoutCreated()
+void PDFAsynchronousTextLayoutCompiler::setPriorityPages(std::vector<PDFInteger> pages)
+{
+    Q_ASSERT(std::is_sorted(pages.cbegin(), pages.cend()));
+
+    if (!m_isRunning || m_priorityPages == pages)
+    {
+        m_priorityPages = qMove(pages);
+        return;
+    }
+
+    QMutexLocker lock(&m_partialTextLayoutsMutex);
+    m_priorityPages = qMove(pages);
+    sortPendingPages();
+}
+
+void PDFAsynchronousTextLayoutCompiler::sortPendingPages()
+{
+    // Priority pages are processed first (in their order), then pages
+    // near the priority pages, pages after priority pages are preferred.
+    // If no priority pages are set, then pages are processed in document order.
+    const std::vector<PDFInteger>& priorityPages = m_priorityPages;
+    auto getPriority = [&priorityPages](PDFInteger pageIndex) -> PDFInteger
+    {
+        if (priorityPages.empty())
+        {
+            return pageIndex;
+        }
+
+        auto it = std::lower_bound(priorityPages.cbegin(), priorityPages.cend(), pageIndex);
+        if (it != priorityPages.cend() && *it == pageIndex)
+        {
+            return -PDFInteger(priorityPages.size()) + std::distance(priorityPages.cbegin(), it);
+        }
+
+        if (pageIndex > priorityPages.back())
+        {
+            return 2 * (pageIndex - priorityPages.back());
+        }
+
+        if (pageIndex < priorityPages.front())
+        {
+            return 2 * (priorityPages.front() - pageIndex) + 1;
+        }
+
+        // Page is between priority pages
+        return 0;
+    };
+
+    // Page with highest priority (lowest value) is at the back of the queue
+    std::stable_sort(m_pendingPages.begin(), m_pendingPages.end(), [&getPriority](PDFInteger l, PDFInteger r) { return getPriority(l) > getPriority(r); });
+}
+
+std::optional<PDFTextLayout> PDFAsynchronousTextLayoutCompiler::getPartialTextLayout(PDFInteger pageIndex)
+{
+    if (!m_isRunning)
+    {
+        return std::nullopt;
+    }
+
+    QMutexLocker lock(&m_partialTextLayoutsMutex);
+    if (pageIndex >= 0 && pageIndex < PDFInteger(m_partialTextLayoutsReady.size()) && m_partialTextLayoutsReady[pageIndex])
+    {
+        return m_partialTextLayouts.getTextLayout(pageIndex);
+    }
+
+    return std::nullopt;
+}
+
+void PDFAsynchronousTextLayoutCompiler::finishTextLayoutCreation()
 {
     m_proxy->getFontCache()->setCacheShrinkEnabled(this, true);
     m_proxy->getProgress()->finish();
-    m_cache.clear();
 
-    m_textLayouts = m_textLayoutCompileFuture.result();
+    m_partialTextLayouts = PDFTextLayoutStorage();
+    m_partialTextLayoutsReady.clear();
+    m_pendingPages.clear();
+    m_cancellationToken.reset();
     m_isRunning = false;
+}
+
+void PDFAsynchronousTextLayoutCompiler::onTextLayoutCreated()
+{
+    if (!m_isRunning)
+    {
+        // Text layout creation was cancelled
+        return;
+    }
+
+    m_cache.clear();
+    m_textLayouts = qMove(m_partialTextLayouts);
+    finishTextLayoutCreation();
     Q_EMIT textLayoutChanged();
 }
 
@@ -32,6 +32,12 @@
 #include <QFuture>
 #include <QFutureWatcher>
 #include <QWaitCondition>
+#include <QThreadPool>
+#include <QImage>
+#include <QMutex>
+
+#include <set>
+#include <atomic>
 
 template <class Key, class T>
 class QCache;
@@ -41,6 +47,115 @@ namespace pdf
 class PDFDrawWidgetProxy;
 class PDFAsynchronousPageCompiler;
 
+/// Disk cache of precompiled pages. It is used as a second level cache
+/// of the asynchronous page compiler. Compiled pages are written to the
+/// disk, and when page is evicted from the memory cache, it is loaded
+/// from the memory mapped file instead of compiling it again. Pages are
+/// identified by the key (derived from document hash and compile settings)
+/// and page index, so entries can be used also after document is reopened.
+/// Functions \p load and \p store are thread safe.
+class PDFPrecompiledPageDiskCache
+{
+public:
+    explicit PDFPrecompiledPageDiskCache() = default;
+
+    /// Sets directory of the cache and its size limit. If directory is empty,
+    /// or size limit is zero, then disk cache is disabled.
+    /// \param directory Cache directory
+    /// \param limit Cache size limit [bytes]
+    void setCacheDirectory(QString directory, qint64 limit);
+
+    /// Sets key, which identifies document and compile settings. If key
+    /// is empty (for example, document is modified and doesn't have source
+    /// data hash), then pages are neither stored, nor loaded. Do not call this
+    /// function, while another thread is loading or storing pages.
+    /// \param key Key
+    void setKey(QByteArray key) { m_key = qMove(key); }
+
+    /// Returns true, if pages can be stored or loaded
+    bool isEnabled() const { return !m_directory.isEmpty() && m_limit > 0 && !m_key.isEmpty(); }
+
+    /// Loads precompiled page from the disk cache. Returns true, if page
+    /// has been found and successfully loaded.
+    /// \param pageIndex Page index
+    /// \param precompiledPage Precompiled page
+    bool load(PDFInteger pageIndex, PDFPrecompiledPage* precompiledPage);
+
+    /// Stores precompiled page to the disk cache. If cache size limit
+    /// is exceeded, least recently used pages are removed.
+    /// \param pageIndex Page index
+    /// \param precompiledPage Precompiled page
+    void store(PDFInteger pageIndex, const PDFPrecompiledPage& precompiledPage);
+
+private:
+    static constexpr quint32 FILE_MAGIC = 0x50444643;
+    static constexpr int persist_version = 1;
+
+    QString getFileName(PDFInteger pageIndex) const;
+
+    /// Removes least recently used files, until cache size is
+    /// below the limit. Mutex must be locked.
+    void shrink();
+
+    QString m_directory;
+    qint64 m_limit = 0;
+    QByteArray m_key;
+
+    /// Size of the cache. Value -1 means, that size was
+    /// not determined yet. Protected by the mutex.
+    qint64 m_size = -1;
+    QMutex m_mutex;
+};
+
+/// Compressed memory cache of precompiled pages. It is used as a second level
+/// cache of the asynchronous page compiler, between memory cache of the pages
+/// and the disk cache. Compiled pages are serialized and compressed, so many more
+/// pages fit into the same amount of memory, and when page is evicted from the
+/// memory cache, it is decompressed instead of compiling it again. It has its
+/// own size limit. All functions are thread safe.
+class PDFPrecompiledPageCompressedCache
+{
+public:
+    explicit PDFPrecompiledPageCompressedCache();
+    ~PDFPrecompiledPageCompressedCache();
+
+    /// Sets cache limit in bytes. If limit is zero, compressed cache is disabled.
+    /// \param limit Cache limit [bytes]
+    void setCacheLimit(qint64 limit);
+
+    /// Returns true, if pages can be stored or loaded
+    bool isEnabled() const;
+
+    /// Loads precompiled page from the compressed cache. Returns true, if page
+    /// has been found and successfully decompressed.
+    /// \param pageIndex Page index
+    /// \param precompiledPage Precompiled page
+    bool load(PDFInteger pageIndex, PDFPrecompiledPage* precompiledPage);
+
+    /// Stores compressed precompiled page to the cache. If cache limit
+    /// is exceeded, least recently used pages are removed.
+    /// \param pageIndex Page index
+    /// \param precompiledPage Precompiled page
+    void store(PDFInteger pageIndex, const PDFPrecompiledPage& precompiledPage);
+
+    /// Removes all pages from the cache
+    void clear();
+
+    /// Returns total size of compressed pages in the cache [bytes]
+    qint64 getCacheCost() const;
+
+    /// Returns count of pages in the cache
+    qint64 getCachedPageCount() const;
+
+private:
+    /// Compression level, fast compression is preferred, because
+    /// pages are compressed on the compiler thread after each compilation.
+    static constexpr int COMPRESSION_LEVEL = 1;
+
+    mutable QMutex m_mutex;
+    QCache<PDFInteger, QByteArray>* m_cache;
+};
+
 class PDFAsynchronousPageCompilerWorkerThread : public QThread
 {
     Q_OBJECT
@@ -60,6 +175,23 @@ private:
     QWaitCondition* m_waitCondition;
 };
 
+/// Statistics of the asynchronous page compiler
+struct PDFAsynchronousPageCompilerStatistics
+{
+    qint64 cacheHits = 0;               ///< Count of requested pages taken from the cache
+    qint64 cacheMisses = 0;             ///< Count of requested pages, which were not in the cache
+    qint64 diskCacheHits = 0;           ///< Count of pages loaded from the disk cache
+    qint64 diskCacheMisses = 0;         ///< Count of pages, which were not found in the disk cache
+    qint64 compressedCacheHits = 0;     ///< Count of pages decompressed from the compressed cache
+    qint64 compressedCacheMisses = 0;   ///< Count of pages, which were not found in the compressed cache
+    qint64 compressedCachedPageCount = 0;///< Count of pages in the compressed cache
+    qint64 compressedCacheCost = 0;     ///< Total size of pages in the compressed cache [bytes]
+    qint64 pendingTaskCount = 0;        ///< Count of pages waiting for compilation (queue depth)
+    qint64 pendingPrefetchTaskCount = 0;///< Count of prefetched pages waiting for compilation
+    qint64 cachedPageCount = 0;         ///< Count of pages in the cache
+    qint64 cacheCost = 0;               ///< Total cost of pages in the cache [bytes]
+};
+
 /// Asynchronous page compiler compiles pages asynchronously, and stores them in the
 /// cache. Cache size can be set. This object is designed to cooperate with
 /// draw widget proxy.
@@ -94,6 +226,27 @@ public:
     /// \param limit Cache limit [bytes]
     void setCacheLimit(int limit);
 
+    /// Returns total cost of pages in the cache [bytes]
+    qint64 getCacheCost() const;
+
+    /// Removes least recently used pages from the cache,
+    /// until total cost of the cache is below given cost.
+    /// \param cost Target cost [bytes]
+    void shrinkCache(qint64 cost);
+
+    /// Sets directory and size limit of the disk cache of compiled pages.
+    /// Disk cache is disabled by default, it can be enabled by setting nonempty
+    /// directory and nonzero limit. Call this function only if the engine is stopped.
+    /// \param directory Cache directory
+    /// \param limit Disk cache limit [bytes]
+    void setDiskCache(QString directory, qint64 limit);
+
+    /// Sets size limit of the compressed memory cache of compiled pages.
+    /// Compressed cache has its own limit, independent of the limit of the
+    /// cache of the pages. Zero limit disables the compressed cache.
+    /// \param limit Compressed cache limit [bytes]
+    void setCompressedCacheLimit(qint64 limit);
+
     enum class State
     {
         Inactive,
@@ -115,6 +268,15 @@ public:
     /// \param compile Compile the page, if it is not found in the cache
     const PDFPrecompiledPage* getCompiledPage(PDFInteger pageIndex, bool compile);
 
+    /// Prefetches pages, i.e. compiles them with low priority. Pages are compiled
+    /// only if no other pages are waiting for compilation, in given order, and in
+    /// small batches, so pages requested by \p getCompiledPage are not delayed
+    /// too much. Pending prefetch requests of pages not in the list are cancelled.
+    /// Pages are prefetched only, if cache is not almost full, so prefetched pages
+    /// do not evict pages, which were recently drawn.
+    /// \param pageIndices Indices of pages to be prefetched
+    void prefetchPages(const std::vector<PDFInteger>& pageIndices);
+
     /// Performs smart cache clear. Too old pages are removed from the cache,
     /// but only if these pages are not in active pages. Use this function to
     /// clear cache to avoid huge memory consumption.
@@ -125,6 +287,15 @@ public:
     /// Is operation being cancelled?
     virtual bool isOperationCancelled() const override;
 
+    /// Returns statistics of the compiler. Cache hits and misses
+    /// are counted only for pages requested to be compiled.
+    PDFAsynchronousPageCompilerStatistics getStatistics() const;
+
+    /// Creates key of the disk cache. Key identifies document and all
+    /// settings, which affect page compilation. If document doesn't
+    /// have source data hash (it was modified), empty key is returned.
+    QByteArray createDiskCacheKey() const;
+
 signals:
     void pageImageChanged(bool all, const std::vector<pdf::PDFInteger>& pages);
     void renderingError(pdf::PDFInteger pageIndex, const QList<pdf::PDFRenderError>& errors);
@@ -142,19 +313,252 @@ private:
         PDFInteger pageIndex = 0;
         bool finished = false;
         PDFPrecompiledPage precompiledPage;
+        quint64 traceFlowId = 0;    ///< Identifier of the trace flow of the page request (or zero)
+
+        /// Prefetch tasks have low priority. They are performed in
+        /// order given by prefetch order, when there are no other tasks.
+        bool prefetch = false;
+        size_t prefetchOrder = 0;
     };
 
+    /// Maximal number of prefetched pages compiled at once
+    static constexpr size_t PREFETCH_BATCH_SIZE = 2;
+
     State m_state = State::Inactive;
-    QMutex m_mutex;
+    mutable QMutex m_mutex;
     QWaitCondition m_waitCondition;
     PDFAsynchronousPageCompilerWorkerThread* m_thread = nullptr;
 
     PDFDrawWidgetProxy* m_proxy;
     QCache<PDFInteger, PDFPrecompiledPage>* m_cache;
+    PDFPrecompiledPageDiskCache m_diskCache;
+    PDFPrecompiledPageCompressedCache m_compressedCache;
 
     /// This task is protected by mutex. Every access to this
     /// variable must be done with locked mutex.
     std::map<PDFInteger, CompileTask> m_tasks;
+
+    qint64 m_cacheHits = 0;
+    qint64 m_cacheMisses = 0;
+    std::atomic<qint64> m_diskCacheHits = 0;
+    std::atomic<qint64> m_diskCacheMisses = 0;
+    std::atomic<qint64> m_compressedCacheHits = 0;
+    std::atomic<qint64> m_compressedCacheMisses = 0;
+};
+
+/// Asynchronous tile renderer renders precompiled pages into tiles of fixed size
+/// on worker threads and stores rendered tiles in the cache. When view is panned,
+/// only newly exposed tiles are rendered. When view is zoomed, tiles rendered
+/// for previous zoom are scaled and presented, until tiles for new zoom are
+/// rendered, so zooming doesn't require drawing of precompiled page on each
+/// frame. This object is designed to cooperate with draw widget proxy.
+class PDFAsynchronousTileRenderer : public QObject
+{
+    Q_OBJECT
+
+private:
+    using BaseClass = QObject;
+
+public:
+    explicit PDFAsynchronousTileRenderer(PDFDrawWidgetProxy* proxy);
+    virtual ~PDFAsynchronousTileRenderer();
+
+    /// Size of the tile in logical pixels
+    static constexpr int TILE_SIZE = 256;
+
+    /// Maximal count of previous zoom levels of a page, whose
+    /// tiles can be scaled and presented for the current zoom level
+    static constexpr size_t MAX_FALLBACK_TILE_GRIDS = 4;
+
+    /// Maximal scale factor between tiles of previous zoom level
+    /// and the current zoom level, for which scaled tiles are presented
+    static constexpr PDFReal MAX_FALLBACK_TILE_SCALE = 4.0;
+
+    /// Draws the page using tiles. Tiles found in the cache are drawn as images.
+    /// Other tiles are scheduled for rendering (visible tiles first, then
+    /// tiles around visible area) and meanwhile they are presented as scaled
+    /// tiles of previous zoom level, or drawn directly from the precompiled page.
+    /// \param painter Painter, its world matrix must be a translation
+    /// \param pageIndex Index of page
+    /// \param page Page
+    /// \param compiledPage Precompiled page
+    /// \param placedRect Rectangle of the page in painter coordinates
+    /// \param visibleRect Visible area in painter coordinates
+    /// \param features Renderer features
+    /// \param opacity Opacity of page graphics
+    /// \param imageConvertor Color convertor, which adjusts colors of rendered tiles (if it is
+    ///        active, tiles with original colors are kept in the cache, so color mode can be
+    ///        changed without rendering the tiles again)
+    void drawPage(QPainter* painter,
+                  PDFInteger pageIndex,
+                  const PDFPage* page,
+                  const PDFPrecompiledPage* compiledPage,
+                  const QRect& placedRect,
+                  const QRect& visibleRect,
+                  PDFRenderer::Features features,
+                  PDFReal opacity,
+                  const PDFColorConvertor& imageConvertor);
+
+    /// Removes all tiles from the cache and cancels pending
+    /// rendering of tiles, which was not started yet.
+    void clear();
+
+    /// Sets cache limit in bytes
+    /// \param limit Cache limit [bytes]
+    void setCacheLimit(qint64 limit);
+
+    /// Returns total cost of tiles in the cache [bytes]
+    qint64 getCacheCost() const;
+
+    /// Removes least recently used tiles from the cache,
+    /// until total cost of the cache is below given cost.
+    /// \param cost Target cost [bytes]
+    void shrinkCache(qint64 cost);
+
+    /// Removes copies of precompiled pages, which are not in active pages.
+    /// Tiles of these pages remain in the cache.
+    /// \param activePages Sorted vector of active pages
+    void smartClearCache(const std::vector<PDFInteger>& activePages);
+
+    /// Removes tiles of given pages, whose precompiled pages were changed
+    /// \param all Remove tiles of all pages
+    /// \param pages Pages
+    void onPageImageChanged(bool all, const std::vector<PDFInteger>& pages);
+
+signals:
+    void tileRendered();
+
+private:
+    struct TileKey
+    {
+        auto operator<=>(const TileKey&) const = default;
+
+        PDFInteger pageIndex = 0;
+        int pageWidth = 0;
+        int pageHeight = 0;
+        int devicePixelRatio = 0;   ///< Device pixel ratio in percents
+        int column = 0;
+        int row = 0;
+
+        friend size_t qHash(const TileKey& key, size_t seed = 0)
+        {
+            return qHashMulti(seed, key.pageIndex, key.pageWidth, key.pageHeight, key.devicePixelRatio, key.column, key.row);
+        }
+    };
+
+    using PDFPrecompiledPagePointer = std::shared_ptr<const PDFPrecompiledPage>;
+
+    void onTileRendered(TileKey key, PDFPrecompiledPagePointer compiledPage, QImage image, QImage convertedImage, PDFColorConvertor imageConvertor);
+
+    /// Returns image of the tile from the cache, or nullptr, if tile is not
+    /// in the cache. If image convertor is active, then tile with converted
+    /// colors is returned (it is created from the cached tile, if it is missing).
+    /// \param key Key of the tile
+    /// \param imageConvertor Color convertor of rendered tiles
+    const QImage* getTileImage(const TileKey& key, const PDFColorConvertor& imageConvertor);
+
+    /// Draws cached tiles of previous zoom levels of the page, scaled to
+    /// the current zoom level, into the missing region. Returns region,
+    /// which remains missing (no scaled tile was drawn there).
+    /// \param painter Painter
+    /// \param baseKey Key of the current tile grid (column and row are ignored)
+    /// \param placedRect Rectangle of the page in painter coordinates
+    /// \param missingRegion Region, where tiles of current zoom level are missing
+    /// \param imageConvertor Color convertor of rendered tiles
+    QRegion drawFallbackTiles(QPainter* painter, const TileKey& baseKey, const QRect& placedRect, QRegion missingRegion, const PDFColorConvertor& imageConvertor);
+
+    PDFDrawWidgetProxy* m_proxy;
+    QThreadPool m_threadPool;
+    QCache<TileKey, QImage>* m_cache;
+
+    /// Tiles with colors converted by color convertor \p m_convertedCacheConvertor
+    QCache<TileKey, QImage>* m_convertedCache;
+    PDFColorConvertor m_convertedCacheConvertor;
+
+    /// Tiles, which are being rendered
+    std::set<TileKey> m_pendingTiles;
+
+    /// Copies of precompiled pages, which are shared with worker threads
+    std::map<PDFInteger, PDFPrecompiledPagePointer> m_compiledPages;
+
+    /// Tile grids (keys with column and row set to zero) of pages, for which
+    /// some tiles were rendered, most recently rendered first
+    std::map<PDFInteger, std::vector<TileKey>> m_tileGrids;
+};
+
+/// Asynchronous preview renderer renders small preview images of pages, which
+/// are displayed (scaled up), until the page is compiled. Preview is rendered
+/// either from already compiled page, or page is compiled in fast preview mode
+/// (images decoded at reduced resolution, coarse shading meshes). Previews
+/// of pages, which are no longer displayed, can be cancelled. This object
+/// is designed to cooperate with draw widget proxy.
+class PDFAsynchronousPreviewRenderer : public QObject
+{
+    Q_OBJECT
+
+private:
+    using BaseClass = QObject;
+
+public:
+    explicit PDFAsynchronousPreviewRenderer(PDFDrawWidgetProxy* proxy);
+    virtual ~PDFAsynchronousPreviewRenderer();
+
+    /// Size of larger side of the preview image in pixels
+    static constexpr int PREVIEW_SIZE = 384;
+
+    /// Returns preview image of the page, or nullptr, if preview image
+    /// has not been rendered yet.
+    /// \param pageIndex Index of page
+    const QImage* getPreviewImage(PDFInteger pageIndex) const;
+
+    /// Requests rendering of the preview image of the page, if it has not been
+    /// rendered yet. If \p compiledPage is valid, preview is rendered from it,
+    /// otherwise page is compiled in fast preview mode.
+    /// \param pageIndex Index of page
+    /// \param compiledPage Compiled page (can be nullptr)
+    void requestPreviewImage(PDFInteger pageIndex, const PDFPrecompiledPage* compiledPage);
+
+    /// Cancels rendering of previews of pages, which are not active
+    /// \param activePages Sorted vector of active pages
+    void cancelStaleTasks(const std::vector<PDFInteger>& activePages);
+
+    /// Removes all preview images and cancels all tasks
+    void clear();
+
+    /// Returns total cost of preview images in the cache [bytes]
+    qint64 getCacheCost() const;
+
+    /// Removes least recently used preview images from the cache,
+    /// until total cost of the cache is below given cost.
+    /// \param cost Target cost [bytes]
+    void shrinkCache(qint64 cost);
+
+    /// Removes preview images, when all pages were changed (page
+    /// contents of the individual page is not changed by compiling)
+    /// \param all All pages were changed
+    /// \param pages Pages
+    void onPageImageChanged(bool all, const std::vector<PDFInteger>& pages);
+
+signals:
+    void previewImageRendered();
+
+private:
+    struct PreviewTask : public PDFOperationControl
+    {
+        virtual bool isOperationCancelled() const override { return isCancelled; }
+
+        bool isFromCompiledPage = false;
+        std::atomic_bool isCancelled = false;
+    };
+
+    using PreviewTaskPointer = std::shared_ptr<PreviewTask>;
+
+    void onPreviewImageRendered(PDFInteger pageIndex, PreviewTaskPointer task, QImage image);
+
+    PDFDrawWidgetProxy* m_proxy;
+    QThreadPool m_threadPool;
+    QCache<PDFInteger, QImage>* m_cache;
+    std::map<PDFInteger, PreviewTaskPointer> m_tasks;
 };
 
 class PDF4QTLIBWIDGETSSHARED_EXPORT PDFAsynchronousTextLayoutCompiler : public QObject
@@ -211,9 +615,19 @@ public:
 
     /// Create text layout for the document. Function is asynchronous,
     /// it returns immediately. After text layout is created, signal
-    /// \p textLayoutChanged is emitted.
+    /// \p textLayoutChanged is emitted. Pages are processed in order
+    /// of priority - visible pages first, then pages near the viewport,
+    /// then the rest of the document. Text layout of each page can be
+    /// obtained as soon as it is processed, even if the text layout
+    /// of the whole document is not ready yet.
     void makeTextLayout();
 
+    /// Sets pages, which are currently visible to the user. If text layout
+    /// of the document is being created, then pending pages are reordered,
+    /// so these pages are processed first, then pages near them.
+    /// \param pages Visible pages (sorted)
+    void setPriorityPages(std::vector<PDFInteger> pages);
+
     /// Returns true, if text layout is ready
     bool isTextLayoutReady() const { return m_textLayouts.has_value(); }
 
@@ -226,12 +640,34 @@ signals:
 private:
     void onTextLayoutCreated();
 
+    /// Finishes text layout creation - releases resources, which
+    /// were locked during the creation of the text layout.
+    void finishTextLayoutCreation();
+
+    /// Sorts pending pages by their priority, the page with highest
+    /// priority is at the back of the queue. Mutex must be locked.
+    void sortPendingPages();
+
+    /// Returns text layout of the page, if it was already created by
+    /// asynchronous compilation, which is still running.
+    /// \param pageIndex Page index
+    std::optional<PDFTextLayout> getPartialTextLayout(PDFInteger pageIndex);
+
     PDFDrawWidgetProxy* m_proxy;
     State m_state = State::Inactive;
     bool m_isRunning;
     std::optional<PDFTextLayoutStorage> m_textLayouts;
-    QFuture<PDFTextLayoutStorage> m_textLayoutCompileFuture;
-    QFutureWatcher<PDFTextLayoutStorage> m_textLayoutCompileFutureWatcher;
+
+    /// Mutex protecting partial text layout storage, pending pages
+    /// and priority pages during asynchronous compilation
+    QMutex m_partialTextLayoutsMutex;
+    PDFTextLayoutStorage m_partialTextLayouts;
+    std::vector<bool> m_partialTextLayoutsReady;
+    std::vector<PDFInteger> m_pendingPages;
+    std::vector<PDFInteger> m_priorityPages;
+    PDFCancellationToken m_cancellationToken;
+    QFuture<void> m_textLayoutCompileFuture;
+    QFutureWatcher<void> m_textLayoutCompileFutureWatcher;
     PDFTextLayoutCache m_cache;
 };
 
@@ -24,6 +24,7 @@
 #include "pdfrenderer.h"
 #include "pdfpainter.h"
 #include "pdfcompiler.h"
+#include "pdfcachemanager.h"
 #include "pdfconstants.h"
 #include "pdfcms.h"
 #include "pdfannotation.h"
@@ -31,15 +32,21 @@
 #include "pdfwidgetannotation.h"
 #include "pdfpainterutils.h"
 #include "pdfwidgetutils.h"
+#include "pdftracing.h"
 
 #include <QTimer>
 #include <QPainter>
 #include <QFontMetrics>
 #include <QScreen>
 #include <QGuiApplication>
+#include <QtMath>
 
 #include "pdfdbgheap.h"
 
+#include <atomic>
+#include <numeric>
+#include <algorithm>
+
 namespace pdf
 {
 
@@ -121,17 +128,12 @@ PDFDrawSpaceController::LayoutItem PDFDrawSpaceController::getLayoutItemForPage(
 {
     LayoutItem result;
 
-    if (pageIndex >= 0 && pageIndex < static_cast<PDFInteger>(m_layoutItems.size()) && m_layoutItems[pageIndex].pageIndex == pageIndex)
-    {
-        result = m_layoutItems[pageIndex];
-    }
-
-    if (!result.isValid())
+    if (pageIndex >= 0 && pageIndex < static_cast<PDFInteger>(m_pageToLayoutItemIndex.size()))
     {
-        auto it = std::find_if(m_layoutItems.cbegin(), m_layoutItems.cend(), [pageIndex](const LayoutItem& item) { return item.pageIndex == pageIndex; });
-        if (it != m_layoutItems.cend())
+        const size_t itemIndex = m_pageToLayoutItemIndex[pageIndex];
+        if (itemIndex < m_layoutItems.size())
         {
-            result = *it;
+            result = m_layoutItems[itemIndex];
         }
     }
 
@@ -442,13 +444,34 @@ void PDFDrawSpaceController::recalculate()
         }
     }
 
+    updateLayoutIndex();
     Q_EMIT drawSpaceChanged();
 }
 
+void PDFDrawSpaceController::updateLayoutIndex()
+{
+    ++m_layoutRevision;
+
+    const size_t pageCount = m_document ? m_document->getCatalog()->getPageCount() : 0;
+    m_pageToLayoutItemIndex.assign(pageCount, m_layoutItems.size());
+
+    // If page has more layout items, first one is used
+    for (size_t i = m_layoutItems.size(); i > 0; --i)
+    {
+        const PDFInteger pageIndex = m_layoutItems[i - 1].pageIndex;
+        if (pageIndex >= 0 && pageIndex < static_cast<PDFInteger>(pageCount))
+        {
+            m_pageToLayoutItemIndex[pageIndex] = i - 1;
+        }
+    }
+}
+
 void PDFDrawSpaceController::clear(bool emitSignal)
 {
     m_layoutItems.clear();
     m_blockItems.clear();
+    m_pageToLayoutItemIndex.clear();
+    ++m_layoutRevision;
 
     if (emitSignal)
     {
@@ -473,6 +496,8 @@ PDFDrawWidgetProxy::PDFDrawWidgetProxy(QObject* parent) :
     m_features(PDFRenderer::getDefaultFeatures()),
     m_compiler(new PDFAsynchronousPageCompiler(this)),
     m_textLayoutCompiler(new PDFAsynchronousTextLayoutCompiler(this)),
+    m_tileRenderer(new PDFAsynchronousTileRenderer(this)),
+    m_previewRenderer(new PDFAsynchronousPreviewRenderer(this)),
     m_rasterizer(new PDFRasterizer(this)),
     m_progress(nullptr),
     m_cacheClearTimer(new QTimer(this)),
@@ -485,12 +510,47 @@ PDFDrawWidgetProxy::PDFDrawWidgetProxy(QObject* parent) :
     connect(m_compiler, &PDFAsynchronousPageCompiler::renderingError, this, &PDFDrawWidgetProxy::renderingError);
     connect(m_compiler, &PDFAsynchronousPageCompiler::pageImageChanged, this, &PDFDrawWidgetProxy::pageImageChanged);
     connect(m_textLayoutCompiler, &PDFAsynchronousTextLayoutCompiler::textLayoutChanged, this, &PDFDrawWidgetProxy::onTextLayoutChanged);
+    connect(this, &PDFDrawWidgetProxy::pageImageChanged, m_tileRenderer, &PDFAsynchronousTileRenderer::onPageImageChanged);
+    connect(m_tileRenderer, &PDFAsynchronousTileRenderer::tileRendered, this, &PDFDrawWidgetProxy::repaintNeeded);
+    connect(this, &PDFDrawWidgetProxy::pageImageChanged, m_previewRenderer, &PDFAsynchronousPreviewRenderer::onPageImageChanged);
+    connect(m_previewRenderer, &PDFAsynchronousPreviewRenderer::previewImageRendered, this, &PDFDrawWidgetProxy::repaintNeeded);
     connect(m_cacheClearTimer, &QTimer::timeout, this, &PDFDrawWidgetProxy::performPageCacheClear);
+
+    // Caches share one global budget with caches of other draw widgets
+    PDFCacheManager* cacheManager = PDFCacheManager::getInstance();
+
+    PDFCacheManager::Cache compiledPagesCache;
+    compiledPagesCache.owner = this;
+    compiledPagesCache.rebuildCost = PDFCacheManager::RebuildCost::High;
+    compiledPagesCache.getCost = [this]() { return m_compiler->getCacheCost(); };
+    compiledPagesCache.shrink = [this](qint64 cost) { m_compiler->shrinkCache(cost); };
+    cacheManager->registerCache(qMove(compiledPagesCache));
+
+    PDFCacheManager::Cache tilesCache;
+    tilesCache.owner = this;
+    tilesCache.rebuildCost = PDFCacheManager::RebuildCost::Low;
+    tilesCache.getCost = [this]() { return m_tileRenderer->getCacheCost(); };
+    tilesCache.shrink = [this](qint64 cost) { m_tileRenderer->shrinkCache(cost); };
+    cacheManager->registerCache(qMove(tilesCache));
+
+    PDFCacheManager::Cache previewsCache;
+    previewsCache.owner = this;
+    previewsCache.rebuildCost = PDFCacheManager::RebuildCost::Low;
+    previewsCache.getCost = [this]() { return m_previewRenderer->getCacheCost(); };
+    previewsCache.shrink = [this](qint64 cost) { m_previewRenderer->shrinkCache(cost); };
+    cacheManager->registerCache(qMove(previewsCache));
+
+    static std::atomic<int> s_sessionCount = 0;
+    PDFMemoryAccounting::registerAccountable(this, PDFTranslationContext::tr("Session %1").arg(++s_sessionCount));
 }
 
 PDFDrawWidgetProxy::~PDFDrawWidgetProxy()
 {
+    PDFMemoryAccounting::unregisterAccountable(this);
+    PDFCacheManager::getInstance()->unregisterCaches(this);
 
+    // Preview tasks use the document and this object
+    m_previewRenderer->clear();
 }
 
 void PDFDrawWidgetProxy::setDocument(const PDFModifiedDocument& document, std::vector<PDFSignatureVerificationResult> signatureVerificationResult)
@@ -500,6 +560,8 @@ void PDFDrawWidgetProxy::setDocument(const PDFModifiedDocument& document, std::v
         m_cacheClearTimer->stop();
         m_compiler->stop(document.hasReset() || document.hasPageContentsChanged());
         m_textLayoutCompiler->stop(document.hasReset() || document.hasPageContentsChanged());
+        m_tileRenderer->clear();
+        m_previewRenderer->clear();
         m_controller->setDocument(document);
 
         if (PDFOptionalContentActivity* optionalContentActivity = document.getOptionalContentActivity())
@@ -571,8 +633,6 @@ void PDFDrawWidgetProxy::update()
     m_deviceSpaceUnitToPixel = m_pixelPerMM * m_zoom;
     m_pixelToDeviceSpaceUnit = 1.0 / m_deviceSpaceUnitToPixel;
 
-    m_layout.clear();
-
     // Switch to the first block, if we haven't selected any, otherwise fix active
     // block item (select first block available).
     if (m_controller->getBlockCount() > 0)
@@ -591,20 +651,35 @@ void PDFDrawWidgetProxy::update()
         m_currentBlock = INVALID_BLOCK_INDEX;
     }
 
-    // Then, create pixel size layout of the pages using the draw space controller
-    QRectF rectangle = m_controller->getBlockBoundingRectangle(m_currentBlock);
-    if (rectangle.isValid())
+    // Then, create pixel size layout of the pages using the draw space controller. Layout
+    // is created only, if layout of the draw space controller, block or zoom have been
+    // changed, so it is not created, for example, when widget is resized.
+    const bool isLayoutValid = m_layout.layoutRevision == m_controller->getLayoutRevision() &&
+                               m_layout.blockIndex == m_currentBlock &&
+                               m_layout.deviceSpaceUnitToPixel == m_deviceSpaceUnitToPixel;
+    if (!isLayoutValid)
     {
-        // We must have a valid block
-        PDFDrawSpaceController::LayoutItems items = m_controller->getLayoutItems(m_currentBlock);
+        m_layout.clear();
 
-        m_layout.items.reserve(items.size());
-        for (const PDFDrawSpaceController::LayoutItem& item : items)
+        QRectF rectangle = m_controller->getBlockBoundingRectangle(m_currentBlock);
+        if (rectangle.isValid())
         {
-            m_layout.items.emplace_back(item.pageIndex, item.groupIndex, fromDeviceSpace(item.pageRectMM).toRect());
+            // We must have a valid block
+            PDFDrawSpaceController::LayoutItems items = m_controller->getLayoutItems(m_currentBlock);
+
+            m_layout.items.reserve(items.size());
+            for (const PDFDrawSpaceController::LayoutItem& item : items)
+            {
+                m_layout.items.emplace_back(item.pageIndex, item.groupIndex, fromDeviceSpace(item.pageRectMM).toRect());
+            }
+
+            m_layout.blockRect = fromDeviceSpace(rectangle).toRect();
+            m_layout.createIndex();
         }
 
-        m_layout.blockRect = fromDeviceSpace(rectangle).toRect();
+        m_layout.layoutRevision = m_controller->getLayoutRevision();
+        m_layout.blockIndex = m_currentBlock;
+        m_layout.deviceSpaceUnitToPixel = m_deviceSpaceUnitToPixel;
     }
 
     QSize blockSize = m_layout.blockRect.size();
@@ -764,6 +839,12 @@ QTransform PDFDrawWidgetProxy::createPagePointToDevicePointMatrix(const PDFPage*
 
 void PDFDrawWidgetProxy::draw(QPainter* painter, QRect rect)
 {
+    PDF_TRACE_ZONE("DrawWidget", "paint");
+
+    QElapsedTimer timer;
+    timer.start();
+
+    PDFCacheManager::getInstance()->touch(this);
     drawPages(painter, rect, m_features);
 
     for (IDocumentDrawInterface* drawInterface : m_drawInterfaces)
@@ -772,6 +853,119 @@ void PDFDrawWidgetProxy::draw(QPainter* painter, QRect rect)
         drawInterface->drawPostRendering(painter, rect);
         painter->restore();
     }
+
+    if (m_features.testFlag(PDFRenderer::DisplayTimes))
+    {
+        m_frameTimesNS.push_back(timer.nsecsElapsed());
+        if (m_frameTimesNS.size() > FRAME_TIME_HISTORY_SIZE)
+        {
+            m_frameTimesNS.pop_front();
+        }
+
+        drawPerformanceOverlay(painter, rect);
+    }
+    else
+    {
+        m_frameTimesNS.clear();
+    }
+}
+
+void PDFDrawWidgetProxy::collectMemoryUsage(PDFMemoryReport* report) const
+{
+    if (const PDFDocument* document = getDocument())
+    {
+        document->collectMemoryUsage(report);
+    }
+
+    getFontCache()->collectMemoryUsage(report);
+
+    if (m_widget)
+    {
+        getCMSManager()->collectMemoryUsage(report);
+    }
+
+    const PDFAsynchronousPageCompilerStatistics compilerStatistics = m_compiler->getStatistics();
+    report->addItem(PDFTranslationContext::tr("Compiled pages"), compilerStatistics.cacheCost, compilerStatistics.cachedPageCount);
+    report->addItem(PDFTranslationContext::tr("Compressed compiled pages"), compilerStatistics.compressedCacheCost, compilerStatistics.compressedCachedPageCount);
+    report->addItem(PDFTranslationContext::tr("Tiles"), m_tileRenderer->getCacheCost());
+    report->addItem(PDFTranslationContext::tr("Page previews"), m_previewRenderer->getCacheCost());
+
+    if (const PDFTextLayoutStorage* textLayoutStorage = m_textLayoutCompiler->getTextLayoutStorage())
+    {
+        textLayoutStorage->collectMemoryUsage(report);
+    }
+}
+
+void PDFDrawWidgetProxy::drawPerformanceOverlay(QPainter* painter, QRect rect) const
+{
+    auto formatTime = [](qint64 nanoseconds)
+    {
+        PDFReal miliseconds = nanoseconds / 1000000.0;
+        return QString::number(miliseconds, 'f', 3);
+    };
+
+    auto formatRatio = [](qint64 hits, qint64 misses)
+    {
+        const qint64 total = hits + misses;
+        PDFReal percents = total > 0 ? 100.0 * hits / total : 0.0;
+        return QString::number(percents, 'f', 1);
+    };
+
+    auto formatSize = [](qint64 bytes)
+    {
+        return QString::number(bytes / (1024.0 * 1024.0), 'f', 1);
+    };
+
+    const qint64 lastFrameTimeNS = !m_frameTimesNS.empty() ? m_frameTimesNS.back() : 0;
+    const qint64 maxFrameTimeNS = !m_frameTimesNS.empty() ? *std::max_element(m_frameTimesNS.cbegin(), m_frameTimesNS.cend()) : 0;
+    const qint64 averageFrameTimeNS = !m_frameTimesNS.empty() ? std::accumulate(m_frameTimesNS.cbegin(), m_frameTimesNS.cend(), qint64(0)) / qint64(m_frameTimesNS.size()) : 0;
+
+    const PDFAsynchronousPageCompilerStatistics compilerStatistics = m_compiler->getStatistics();
+    const PDFFontCacheStatistics fontCacheStatistics = getFontCache()->getStatistics();
+
+    QStringList lines;
+    lines << PDFTranslationContext::tr("Frame time:      %1 [ms] (average %2 [ms], max %3 [ms])").arg(formatTime(lastFrameTimeNS), formatTime(averageFrameTimeNS), formatTime(maxFrameTimeNS));
+    lines << PDFTranslationContext::tr("Page cache:      %1 % hits, %2 pages, %3 [MB]").arg(formatRatio(compilerStatistics.cacheHits, compilerStatistics.cacheMisses)).arg(compilerStatistics.cachedPageCount).arg(formatSize(compilerStatistics.cacheCost));
+    lines << PDFTranslationContext::tr("Packed pages:    %1 % hits, %2 pages, %3 [MB]").arg(formatRatio(compilerStatistics.compressedCacheHits, compilerStatistics.compressedCacheMisses)).arg(compilerStatistics.compressedCachedPageCount).arg(formatSize(compilerStatistics.compressedCacheCost));
+    lines << PDFTranslationContext::tr("Page disk cache: %1 % hits").arg(formatRatio(compilerStatistics.diskCacheHits, compilerStatistics.diskCacheMisses));
+    lines << PDFTranslationContext::tr("Compile queue:   %1 pages, %2 prefetched pages").arg(compilerStatistics.pendingTaskCount).arg(compilerStatistics.pendingPrefetchTaskCount);
+    lines << PDFTranslationContext::tr("Font cache:      %1 % hits, %2 fonts").arg(formatRatio(fontCacheStatistics.fontHits, fontCacheStatistics.fontMisses)).arg(fontCacheStatistics.fontCount);
+    lines << PDFTranslationContext::tr("Glyph cache:     %1 % hits, %2 realized fonts").arg(formatRatio(fontCacheStatistics.realizedFontHits, fontCacheStatistics.realizedFontMisses)).arg(fontCacheStatistics.realizedFontCount);
+    lines << PDFTranslationContext::tr("Tile cache:      %1 [MB]").arg(formatSize(m_tileRenderer->getCacheCost()));
+
+    PDFMemoryReport memoryReport;
+    collectMemoryUsage(&memoryReport);
+    const qint64 processMemoryUsage = PDFMemoryAccounting::getProcessMemoryUsage();
+    lines << PDFTranslationContext::tr("Memory:          %1 [MB] document session, %2 [MB] process").arg(formatSize(memoryReport.getTotalBytes()), processMemoryUsage >= 0 ? formatSize(processMemoryUsage) : QString("-"));
+
+    // Show the largest consumers of memory of this session
+    std::vector<PDFMemoryReport::Item> memoryItems = memoryReport.getItems();
+    std::sort(memoryItems.begin(), memoryItems.end(), [](const auto& l, const auto& r) { return l.bytes > r.bytes; });
+    memoryItems.resize(qMin(memoryItems.size(), size_t(3)));
+    for (const PDFMemoryReport::Item& item : memoryItems)
+    {
+        lines << PDFTranslationContext::tr("  %1: %2 [MB]").arg(item.name, formatSize(item.bytes));
+    }
+
+    QFont font = m_widget->font();
+    font.setPointSize(10);
+    QFontMetrics fontMetrics(font);
+    const int lineSpacing = fontMetrics.lineSpacing();
+
+    painter->save();
+    painter->setPen(Qt::red);
+    painter->setFont(font);
+    painter->setBackground(QBrush(Qt::white));
+    painter->setBackgroundMode(Qt::OpaqueMode);
+    painter->translate(rect.topLeft() + QPoint(lineSpacing, 2 * lineSpacing));
+
+    for (const QString& line : lines)
+    {
+        painter->drawText(0, 0, line);
+        painter->translate(0, lineSpacing);
+    }
+
+    painter->restore();
 }
 
 QColor PDFDrawWidgetProxy::getPaperColor()
@@ -792,6 +986,9 @@ void PDFDrawWidgetProxy::drawPages(QPainter* painter, QRect rect, PDFRenderer::F
     painter->fillRect(rect, backgroundColor);
     QTransform baseMatrix = painter->worldTransform();
 
+    // Visible area in device coordinates, page content outside of it is not drawn
+    const QRectF cullRect = baseMatrix.mapRect(QRectF(rect));
+
     // Use current paper color (it can be a bit different from white)
     QColor paperColor = getPaperColor();
 
@@ -800,9 +997,16 @@ void PDFDrawWidgetProxy::drawPages(QPainter* painter, QRect rect, PDFRenderer::F
     PDFColorConvertor convertor = cms->getColorConvertor();
     PDFRenderer::applyFeaturesToColorConvertor(features, convertor);
 
+    // If colors are adjusted on rendered images, compiled pages have original
+    // colors, and rendered page images are converted by this convertor.
+    const bool isColorPostProcessed = features.testFlag(PDFRenderer::ColorAdjust_PostProcess) && convertor.isActive();
+    const PDFColorConvertor imageConvertor = isColorPostProcessed ? convertor : PDFColorConvertor();
+
     // Iterate trough pages and display them on the painter device
-    for (const LayoutItem& item : m_layout.items)
+    for (const size_t itemIndex : getLayoutItemCandidates(rect))
     {
+        const LayoutItem& item = m_layout.items[itemIndex];
+
         // The offsets m_horizontalOffset and m_verticalOffset are offsets to the
         // topleft point of the block. But block maybe doesn't start at (0, 0),
         // so we must also use translation from the block beginning.
@@ -818,6 +1022,35 @@ void PDFDrawWidgetProxy::drawPages(QPainter* painter, QRect rect, PDFRenderer::F
             }
 
             const PDFPrecompiledPage* compiledPage = m_compiler->getCompiledPage(item.pageIndex, true);
+            if (!compiledPage || !compiledPage->isValid())
+            {
+                // Page is not compiled yet, so draw its preview, if we have it
+                m_previewRenderer->requestPreviewImage(item.pageIndex, nullptr);
+                if (const QImage* previewImage = m_previewRenderer->getPreviewImage(item.pageIndex))
+                {
+                    painter->save();
+                    painter->setOpacity(groupInfo.transparency);
+                    painter->setRenderHint(QPainter::SmoothPixmapTransform, true);
+                    if (isColorPostProcessed)
+                    {
+                        QImage convertedPreviewImage = previewImage->copy();
+                        imageConvertor.convertRenderedImage(convertedPreviewImage);
+                        painter->drawImage(QRectF(placedRect), convertedPreviewImage);
+                    }
+                    else
+                    {
+                        painter->drawImage(QRectF(placedRect), *previewImage);
+                    }
+                    painter->restore();
+                }
+            }
+            else
+            {
+                // Preview is rendered from the compiled page, so it
+                // can be displayed, when page is removed from the cache.
+                m_previewRenderer->requestPreviewImage(item.pageIndex, compiledPage);
+            }
+
             if (compiledPage && compiledPage->isValid())
             {
                 QElapsedTimer timer;
@@ -835,7 +1068,18 @@ void PDFDrawWidgetProxy::drawPages(QPainter* painter, QRect rect, PDFRenderer::F
 
                 if (!isPageContentDrawSuppressed)
                 {
-                    compiledPage->draw(painter, page->getCropBox(), matrix, features, groupInfo.transparency);
+                    if (features.testFlag(PDFRenderer::TiledRendering) && baseMatrix.type() <= QTransform::TxTranslate)
+                    {
+                        m_tileRenderer->drawPage(painter, item.pageIndex, page, compiledPage, placedRect, rect, features, groupInfo.transparency, imageConvertor);
+                    }
+                    else if (isColorPostProcessed)
+                    {
+                        drawCompiledPageColorPostProcessed(painter, page, compiledPage, matrix, baseMatrix.mapRect(QRectF(placedRect.intersected(rect))), features, groupInfo.transparency, imageConvertor);
+                    }
+                    else
+                    {
+                        compiledPage->draw(painter, page->getCropBox(), matrix, features, groupInfo.transparency, cullRect, getOptionalContentActivity());
+                    }
                 }
 
                 // Draw text blocks/text lines, if it is enabled
@@ -929,6 +1173,13 @@ void PDFDrawWidgetProxy::drawPages(QPainter* painter, QRect rect, PDFRenderer::F
                     painter->translate(0, lineSpacing);
                     painter->drawText(0, 0, PDFTranslationContext::tr("Draw time:       %1 [ms]").arg(formatDrawTime(drawTimeNS)));
 
+                    for (const PDFPrecompiledPage::OperatorTime& operatorTime : compiledPage->getOperatorTimes())
+                    {
+                        const QString operatorName = QString::fromLatin1(PDFPageContentProcessor::getOperatorCommand(operatorTime.op));
+                        painter->translate(0, lineSpacing);
+                        painter->drawText(0, 0, PDFTranslationContext::tr("Operator %1:    %2 [ms] (%3 times)").arg(operatorName.leftJustified(3), formatDrawTime(operatorTime.timeNS)).arg(operatorTime.count));
+                    }
+
                     painter->restore();
                 }
 
@@ -945,6 +1196,50 @@ void PDFDrawWidgetProxy::drawPages(QPainter* painter, QRect rect, PDFRenderer::F
             }
         }
     }
+
+    // Previews of pages, which are no longer visible, are not needed
+    std::vector<PDFInteger> activePages = getActivePages();
+    m_previewRenderer->cancelStaleTasks(activePages);
+
+    // Text layout of visible pages should be created first
+    m_textLayoutCompiler->setPriorityPages(qMove(activePages));
+}
+
+void PDFDrawWidgetProxy::drawCompiledPageColorPostProcessed(QPainter* painter,
+                                                             const PDFPage* page,
+                                                             const PDFPrecompiledPage* compiledPage,
+                                                             const QTransform& matrix,
+                                                             const QRectF& deviceRect,
+                                                             PDFRenderer::Features features,
+                                                             PDFReal opacity,
+                                                             const PDFColorConvertor& imageConvertor) const
+{
+    const QRect imageRect = deviceRect.toAlignedRect();
+    if (imageRect.isEmpty())
+    {
+        return;
+    }
+
+    const PDFReal devicePixelRatio = painter->device()->devicePixelRatioF();
+    const QSize imageSize(qCeil(imageRect.width() * devicePixelRatio), qCeil(imageRect.height() * devicePixelRatio));
+    const QTransform imageMatrix = matrix * QTransform::fromTranslate(-imageRect.left(), -imageRect.top()) * QTransform::fromScale(devicePixelRatio, devicePixelRatio);
+
+    QImage image(imageSize, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+
+    {
+        QPainter imagePainter(&image);
+        compiledPage->draw(&imagePainter, page->getCropBox(), imageMatrix, features, 1.0, QRectF(QPointF(0, 0), imageSize), getOptionalContentActivity());
+    }
+
+    imageConvertor.convertRenderedImage(image);
+    image.setDevicePixelRatio(devicePixelRatio);
+
+    painter->save();
+    painter->setWorldTransform(QTransform());
+    painter->setOpacity(opacity);
+    painter->drawImage(imageRect.topLeft(), image);
+    painter->restore();
 }
 
 QImage PDFDrawWidgetProxy::drawThumbnailImage(PDFInteger pageIndex, int pixelSize) const
@@ -970,7 +1265,7 @@ QImage PDFDrawWidgetProxy::drawThumbnailImage(PDFInteger pageIndex, int pixelSiz
             {
                 // Rasterize the image.
                 PDFCMSPointer cms = getCMSManager()->getCurrentCMS();
-                image = m_rasterizer->render(pageIndex, page, compiledPage, imageSize, m_features, m_widget->getAnnotationManager(), cms.data(), PageRotation::None);
+                image = m_rasterizer->render(pageIndex, page, compiledPage, imageSize, m_features, m_widget->getAnnotationManager(), cms.data(), PageRotation::None, getOptionalContentActivity());
             }
 
             if (image.isNull())
@@ -984,6 +1279,65 @@ QImage PDFDrawWidgetProxy::drawThumbnailImage(PDFInteger pageIndex, int pixelSiz
     return image;
 }
 
+void PDFDrawWidgetProxy::Layout::createIndex()
+{
+    itemsByTop.resize(items.size());
+    std::iota(itemsByTop.begin(), itemsByTop.end(), size_t(0));
+
+    auto comparator = [this](size_t left, size_t right) { return items[left].pageRect.top() < items[right].pageRect.top(); };
+    std::stable_sort(itemsByTop.begin(), itemsByTop.end(), comparator);
+
+    maximalBottoms.clear();
+    maximalBottoms.reserve(itemsByTop.size());
+
+    int maximalBottom = std::numeric_limits<int>::min();
+    for (const size_t itemIndex : itemsByTop)
+    {
+        maximalBottom = qMax(maximalBottom, items[itemIndex].pageRect.bottom());
+        maximalBottoms.push_back(maximalBottom);
+    }
+}
+
+std::vector<size_t> PDFDrawWidgetProxy::Layout::getItemsIntersecting(int top, int bottom) const
+{
+    Q_ASSERT(itemsByTop.size() == items.size());
+
+    // Items, which start below the interval, can't intersect it
+    auto comparator = [this](int value, size_t itemIndex) { return value < items[itemIndex].pageRect.top(); };
+    auto itEnd = std::upper_bound(itemsByTop.cbegin(), itemsByTop.cend(), bottom, comparator);
+    const size_t endIndex = std::distance(itemsByTop.cbegin(), itEnd);
+
+    // Items, which end above the interval, can't intersect it. Maximal
+    // bottom coordinates are nondecreasing, so we can use binary search.
+    auto itBegin = std::lower_bound(maximalBottoms.cbegin(), std::next(maximalBottoms.cbegin(), endIndex), top);
+    const size_t beginIndex = std::distance(maximalBottoms.cbegin(), itBegin);
+
+    std::vector<size_t> result;
+    if (beginIndex < endIndex)
+    {
+        result.reserve(endIndex - beginIndex);
+        for (size_t i = beginIndex; i < endIndex; ++i)
+        {
+            const size_t itemIndex = itemsByTop[i];
+            if (items[itemIndex].pageRect.bottom() >= top)
+            {
+                result.push_back(itemIndex);
+            }
+        }
+        std::sort(result.begin(), result.end());
+    }
+
+    return result;
+}
+
+std::vector<size_t> PDFDrawWidgetProxy::getLayoutItemCandidates(const QRect& rect) const
+{
+    // Transform the rectangle into the layout coordinates, they
+    // are shifted by the vertical offset and the block beginning.
+    const int verticalShift = m_verticalOffset - m_layout.blockRect.top();
+    return m_layout.getItemsIntersecting(rect.top() - verticalShift, rect.bottom() - verticalShift);
+}
+
 std::vector<PDFInteger> PDFDrawWidgetProxy::getPagesIntersectingRect(QRect rect) const
 {
     std::vector<PDFInteger> pages;
@@ -992,8 +1346,10 @@ std::vector<PDFInteger> PDFDrawWidgetProxy::getPagesIntersectingRect(QRect rect)
     pages.reserve(32);
 
     // Iterate trough pages, place them and test, if they intersects with rectangle
-    for (const LayoutItem& item : m_layout.items)
+    for (const size_t itemIndex : getLayoutItemCandidates(rect))
     {
+        const LayoutItem& item = m_layout.items[itemIndex];
+
         // The offsets m_horizontalOffset and m_verticalOffset are offsets to the
         // topleft point of the block. But block maybe doesn't start at (0, 0),
         // so we must also use translation from the block beginning.
@@ -1034,8 +1390,10 @@ std::vector<PDFInteger> PDFDrawWidgetProxy::getActivePages() const
 PDFInteger PDFDrawWidgetProxy::getPageUnderPoint(QPoint point, QPointF* pagePoint) const
 {
     // Iterate trough pages, place them and test, if they intersects with rectangle
-    for (const LayoutItem& item : m_layout.items)
+    for (const size_t itemIndex : getLayoutItemCandidates(QRect(point, QSize(1, 1)).adjusted(-1, -1, 1, 1)))
     {
+        const LayoutItem& item = m_layout.items[itemIndex];
+
         // The offsets m_horizontalOffset and m_verticalOffset are offsets to the
         // topleft point of the block. But block maybe doesn't start at (0, 0),
         // so we must also use translation from the block beginning.
@@ -1065,8 +1423,10 @@ PDFWidgetSnapshot PDFDrawWidgetProxy::getSnapshot() const
     QRect viewport = getWidget()->rect();
 
     // Iterate trough pages, place them and test, if they intersects with rectangle
-    for (const LayoutItem& item : m_layout.items)
+    for (const size_t itemIndex : getLayoutItemCandidates(viewport))
     {
+        const LayoutItem& item = m_layout.items[itemIndex];
+
         // The offsets m_horizontalOffset and m_verticalOffset are offsets to the
         // topleft point of the block. But block maybe doesn't start at (0, 0),
         // so we must also use translation from the block beginning.
@@ -1108,8 +1468,10 @@ QRect PDFDrawWidgetProxy::getPagesIntersectingRectBoundingBox(QRect rect) const
     QRect resultRect;
 
     // Iterate trough pages, place them and test, if they intersects with rectangle
-    for (const LayoutItem& item : m_layout.items)
+    for (const size_t itemIndex : getLayoutItemCandidates(rect))
     {
+        const LayoutItem& item = m_layout.items[itemIndex];
+
         // The offsets m_horizontalOffset and m_verticalOffset are offsets to the
         // topleft point of the block. But block maybe doesn't start at (0, 0),
         // so we must also use translation from the block beginning.
@@ -1421,6 +1783,7 @@ void PDFDrawWidgetProxy::performPageCacheClear()
 {
     std::vector<PDFInteger> activePage = getActivePages();
     m_compiler->smartClearCache(CACHE_PAGE_EXPIRATION_TIMEOUT, activePage);
+    m_tileRenderer->smartClearCache(activePage);
 }
 
 void PDFDrawWidgetProxy::onTextLayoutChanged()
@@ -1485,15 +1848,103 @@ void PDFDrawWidgetProxy::prefetchPages(PDFInteger pageIndex)
             break;
     }
 
+    if (prefetchCount == 0)
+    {
+        return;
+    }
+
     if (const PDFDocument* document = getDocument())
     {
-        const PDFInteger pageCount = document->getCatalog()->getPageCount();
-        const PDFInteger pageEnd = qMin(pageCount, pageIndex + prefetchCount + 1);
-        for (PDFInteger i = pageIndex + 1; i < pageEnd; ++i)
+        // When user scrolls, we prefetch pages, which will be reached soon
+        const PDFReal velocity = (m_scrollTimer.isValid() && m_scrollTimer.elapsed() < SCROLL_VELOCITY_TIMEOUT) ? m_scrollVelocity : 0.0;
+        const PDFInteger lookaheadCount = qCeil(qAbs(velocity) * PREFETCH_LOOKAHEAD_TIME / 1000.0);
+        const PDFInteger count = qMin<PDFInteger>(prefetchCount + lookaheadCount, MAX_PREFETCH_PAGE_COUNT);
+
+        std::vector<PDFInteger> pages;
+        pages.reserve(count);
+
+        if (velocity < 0.0)
+        {
+            std::vector<PDFInteger> visiblePages = getPagesIntersectingRect(m_widget->rect());
+            const PDFInteger firstPageIndex = !visiblePages.empty() ? visiblePages.front() : pageIndex;
+            const PDFInteger pageBegin = qMax<PDFInteger>(0, firstPageIndex - count);
+            for (PDFInteger i = firstPageIndex - 1; i >= pageBegin; --i)
+            {
+                pages.push_back(i);
+            }
+        }
+        else
+        {
+            const PDFInteger pageCount = document->getCatalog()->getPageCount();
+            const PDFInteger pageEnd = qMin(pageCount, pageIndex + count + 1);
+            for (PDFInteger i = pageIndex + 1; i < pageEnd; ++i)
+            {
+                pages.push_back(i);
+            }
+        }
+
+        m_compiler->prefetchPages(pages);
+    }
+}
+
+PDFReal PDFDrawWidgetProxy::getScrollPosition() const
+{
+    const QRect rect = m_widget->rect();
+    const LayoutItem* firstItem = nullptr;
+    QRect firstItemRect;
+
+    for (const size_t itemIndex : getLayoutItemCandidates(rect))
+    {
+        const LayoutItem& item = m_layout.items[itemIndex];
+        QRect placedRect = item.pageRect.translated(m_horizontalOffset - m_layout.blockRect.left(), m_verticalOffset - m_layout.blockRect.top());
+        if (placedRect.intersects(rect) && (!firstItem || item.pageIndex < firstItem->pageIndex))
+        {
+            firstItem = &item;
+            firstItemRect = placedRect;
+        }
+    }
+
+    if (!firstItem)
+    {
+        return m_scrollPosition;
+    }
+
+    PDFReal fraction = 0.0;
+    if (firstItemRect.height() > 0)
+    {
+        fraction = qBound(0.0, PDFReal(rect.top() - firstItemRect.top()) / PDFReal(firstItemRect.height()), 1.0);
+    }
+
+    return firstItem->pageIndex + fraction;
+}
+
+void PDFDrawWidgetProxy::updateScrollVelocity()
+{
+    const PDFReal scrollPosition = getScrollPosition();
+
+    if (m_scrollTimer.isValid())
+    {
+        const qint64 elapsedNS = m_scrollTimer.nsecsElapsed();
+        m_scrollTimer.restart();
+
+        if (elapsedNS >= SCROLL_VELOCITY_TIMEOUT * 1000000)
+        {
+            // User started to scroll again
+            m_scrollVelocity = 0.0;
+        }
+        else if (elapsedNS > 0)
         {
-            m_compiler->getCompiledPage(i, true);
+            // Smooth the velocity, because scroll events are not regular
+            const PDFReal velocity = (scrollPosition - m_scrollPosition) * 1000000000.0 / elapsedNS;
+            m_scrollVelocity = 0.5 * m_scrollVelocity + 0.5 * velocity;
         }
     }
+    else
+    {
+        m_scrollTimer.start();
+    }
+
+    m_scrollPosition = scrollPosition;
 }
 
 void PDFDrawWidgetProxy::onHorizontalScrollbarValueChanged(int value)
@@ -1538,6 +1989,7 @@ void PDFDrawWidgetProxy::setVerticalOffset(int value)
     if (m_verticalOffset != verticalOffset)
     {
         m_verticalOffset = verticalOffset;
+        updateScrollVelocity();
         updateVerticalScrollbarFromOffset();
         Q_EMIT drawSpaceChanged();
     }
@@ -1549,6 +2001,7 @@ void PDFDrawWidgetProxy::setBlockIndex(int index)
     {
         m_currentBlock = static_cast<size_t>(index);
         update();
+        updateScrollVelocity();
     }
 }
 
@@ -1600,6 +2053,20 @@ void PDFDrawWidgetProxy::setFeatures(PDFRenderer::Features features)
 {
     if (m_features != features)
     {
+        // If colors are adjusted on rendered images, compiled pages don't
+        // depend on color mode, so they are not compiled again, when only
+        // color mode is changed.
+        const PDFRenderer::Features colorFeatures = PDFRenderer::getColorFeatures();
+        if (m_features.testFlag(PDFRenderer::ColorAdjust_PostProcess) &&
+            features.testFlag(PDFRenderer::ColorAdjust_PostProcess) &&
+            (m_features & ~colorFeatures) == (features & ~colorFeatures))
+        {
+            m_features = features;
+            Q_EMIT colorAdjustmentChanged();
+            Q_EMIT repaintNeeded();
+            return;
+        }
+
         m_compiler->stop(true);
         m_textLayoutCompiler->stop(true);
         m_features = features;
@@ -1650,7 +2117,8 @@ void PDFDrawWidgetProxy::onColorManagementSystemChanged()
 
 void PDFDrawWidgetProxy::onOptionalContentGroupStateChanged()
 {
-    m_compiler->reset();
+    // Compiled pages contain all optional content, which is evaluated
+    // when page is drawn, so pages need not to be compiled again.
     m_textLayoutCompiler->reset();
     Q_EMIT pageImageChanged(true, { });
 }
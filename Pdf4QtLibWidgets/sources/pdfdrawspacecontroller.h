@@ -35,6 +35,9 @@
 #include <QRectF>
 #include <QObject>
 #include <QMarginsF>
+#include <QElapsedTimer>
+
+#include <deque>
 
 class QPainter;
 class QScrollBar;
@@ -49,6 +52,8 @@ class PDFTextLayoutGetter;
 class PDFWidgetAnnotationManager;
 class PDFAsynchronousPageCompiler;
 class PDFAsynchronousTextLayoutCompiler;
+class PDFAsynchronousTileRenderer;
+class PDFAsynchronousPreviewRenderer;
 
 /// This class controls draw space - page layout. Pages are divided into blocks
 /// each block can contain one or multiple pages. Units are in milimeters.
@@ -112,6 +117,10 @@ public:
     /// \param pageIndex Page index
     LayoutItem getLayoutItemForPage(PDFInteger pageIndex) const;
 
+    /// Returns revision of the layout. Revision is changed each time,
+    /// when layout items are recalculated or cleared.
+    quint64 getLayoutRevision() const { return m_layoutRevision; }
+
     /// Returns the document
     const PDFDocument* getDocument() const { return m_document; }
 
@@ -148,6 +157,7 @@ signals:
     void drawSpaceChanged();
     void repaintNeeded();
     void pageImageChanged(bool all, const std::vector<PDFInteger>& pages);
+    void colorAdjustmentChanged();
 
 private:
     /// Recalculates the draw space. Preserves setted page rotation.
@@ -156,6 +166,9 @@ private:
     /// Clears the draw space. Emits signal if desired.
     void clear(bool emitSignal);
 
+    /// Updates index of layout items by page index and layout revision
+    void updateLayoutIndex();
+
     /// Represents data for the single block. Contains block size in milimeters.
     struct LayoutBlock
     {
@@ -178,13 +191,18 @@ private:
     PageRotation m_pageRotation;
     LayoutItems m_customLayoutItems;
 
+    /// Index of layout item of the page. If page has no layout
+    /// item, then index is equal to layout item count.
+    std::vector<size_t> m_pageToLayoutItemIndex;
+    quint64 m_layoutRevision = 0;
+
     /// Font cache
     PDFFontCache m_fontCache;
 };
 
 /// This is a proxy class to draw space controller using widget. We have two spaces, pixel space
 /// (on the controlled widget) and device space (device is draw space controller).
-class PDF4QTLIBWIDGETSSHARED_EXPORT PDFDrawWidgetProxy : public QObject
+class PDF4QTLIBWIDGETSSHARED_EXPORT PDFDrawWidgetProxy : public QObject, public PDFMemoryAccountable
 {
     Q_OBJECT
 
@@ -225,6 +243,27 @@ public:
     /// \param features Rendering features
     void drawPages(QPainter* painter, QRect rect, PDFRenderer::Features features);
 
+    /// Draws the compiled page, whose colors are adjusted on the rendered image
+    /// (feature ColorAdjust_PostProcess). Page is drawn into the offscreen image
+    /// covering the device rectangle, colors of the image are converted, and then
+    /// the image is drawn onto the painter.
+    /// \param painter Painter
+    /// \param page Page
+    /// \param compiledPage Precompiled page
+    /// \param matrix Page point to device point matrix
+    /// \param deviceRect Area in device coordinates, which is drawn
+    /// \param features Rendering features
+    /// \param opacity Opacity of page graphics
+    /// \param imageConvertor Color convertor of the rendered image
+    void drawCompiledPageColorPostProcessed(QPainter* painter,
+                                            const PDFPage* page,
+                                            const PDFPrecompiledPage* compiledPage,
+                                            const QTransform& matrix,
+                                            const QRectF& deviceRect,
+                                            PDFRenderer::Features features,
+                                            PDFReal opacity,
+                                            const PDFColorConvertor& imageConvertor) const;
+
     /// Draws thumbnail image of the given size (so larger of the page size
     /// width or height equals to pixel size and the latter size is rescaled
     /// using the aspect ratio)
@@ -328,7 +367,9 @@ public:
     void updateRenderer(RendererEngine rendererEngine);
 
     /// Prefetches (prerenders) pages after page with pageIndex, i.e., prepares
-    /// for non-flickering scroll operation.
+    /// for non-flickering scroll operation. If user scrolls, more pages are
+    /// prefetched according to the scroll velocity, and if user scrolls back,
+    /// pages before currently visible pages are prefetched.
     void prefetchPages(PDFInteger pageIndex);
 
     static constexpr PDFReal ZOOM_STEP = 1.2;
@@ -347,6 +388,12 @@ public:
     RendererEngine getRendererEngine() const { return m_rendererEngine; }
     PageRotation getPageRotation() const { return m_controller->getPageRotation(); }
 
+    /// Adds consumed memory of the document, of its caches, and of caches of this
+    /// proxy (compiled pages, tiles, previews, text layouts) into the report.
+    /// Proxy is registered in the memory accounting as one document session.
+    /// \param report Report
+    virtual void collectMemoryUsage(PDFMemoryReport* report) const override;
+
     void setFeatures(PDFRenderer::Features features);
     void setPreferredMeshResolutionRatio(PDFReal ratio);
     void setMinimalMeshResolutionRatio(PDFReal ratio);
@@ -408,13 +455,45 @@ private:
         inline void clear()
         {
             items.clear();
+            itemsByTop.clear();
+            maximalBottoms.clear();
             blockRect = QRect();
+            layoutRevision = 0;
+            blockIndex = INVALID_BLOCK_INDEX;
+            deviceSpaceUnitToPixel = 0.0;
         }
 
+        /// Creates interval index of the items. Items are sorted by top
+        /// coordinate of the page rectangle, and for each sorted item,
+        /// maximal bottom coordinate of page rectangles up to this
+        /// item is stored (it is nondecreasing sequence).
+        void createIndex();
+
+        /// Returns indices of items, whose page rectangles can intersect
+        /// vertical interval [top, bottom] (in layout coordinates). Indices
+        /// are sorted, so items are in the layout order. Complexity is
+        /// O(log n + k), where k is count of candidates.
+        /// \param top Top of the interval
+        /// \param bottom Bottom of the interval
+        std::vector<size_t> getItemsIntersecting(int top, int bottom) const;
+
         std::vector<LayoutItem> items;
+        std::vector<size_t> itemsByTop;
+        std::vector<int> maximalBottoms;
         QRect blockRect;
+
+        /// Layout is valid for this revision of draw space
+        /// controller layout, block, and pixel scale.
+        quint64 layoutRevision = 0;
+        size_t blockIndex = INVALID_BLOCK_INDEX;
+        PDFReal deviceSpaceUnitToPixel = 0.0;
     };
 
+    /// Returns indices of layout items, whose page rectangles can intersect
+    /// given rectangle in widget coordinates, in layout order.
+    /// \param rect Rectangle in widget coordinates
+    std::vector<size_t> getLayoutItemCandidates(const QRect& rect) const;
+
     struct GroupInfo
     {
         bool operator==(const GroupInfo&) const = default;
@@ -434,6 +513,24 @@ private:
     static constexpr qint64 CACHE_CLEAR_TIMEOUT = 5000;
     static constexpr qint64 CACHE_PAGE_EXPIRATION_TIMEOUT = 30000;
 
+    /// If user doesn't scroll for this time [ms], scroll velocity is zero
+    static constexpr qint64 SCROLL_VELOCITY_TIMEOUT = 500;
+
+    /// Pages, which will be reached within this time [ms] using current
+    /// scroll velocity, are prefetched
+    static constexpr qint64 PREFETCH_LOOKAHEAD_TIME = 1000;
+
+    /// Maximal number of prefetched pages
+    static constexpr PDFInteger MAX_PREFETCH_PAGE_COUNT = 8;
+
+    /// Number of frames, from which average and maximal frame time is computed
+    static constexpr size_t FRAME_TIME_HISTORY_SIZE = 60;
+
+    /// Draws performance overlay (frame times, cache hit rates, compile queue depth)
+    /// \param painter Painter
+    /// \param rect Draw rectangle
+    void drawPerformanceOverlay(QPainter* painter, QRect rect) const;
+
     /// Converts rectangle from device space to the pixel space
     QRectF fromDeviceSpace(const QRectF& rect) const;
 
@@ -449,6 +546,13 @@ private:
     void setVerticalOffset(int value);
     void setBlockIndex(int index);
 
+    /// Returns scroll position in pages - index of first visible
+    /// page plus scrolled fraction of this page.
+    PDFReal getScrollPosition() const;
+
+    /// Updates scroll velocity from current scroll position
+    void updateScrollVelocity();
+
     void updateHorizontalScrollbarFromOffset();
     void updateVerticalScrollbarFromOffset();
 
@@ -491,6 +595,12 @@ private:
     /// with this vertical offset)
     PDFInteger m_verticalOffset;
 
+    /// Last scroll position (in pages) and smoothed scroll velocity (in pages
+    /// per second, negative when scrolling back), used for page prefetching
+    PDFReal m_scrollPosition = 0.0;
+    PDFReal m_scrollVelocity = 0.0;
+    QElapsedTimer m_scrollTimer;
+
     /// Range of vertical offset
     Range<PDFInteger> m_verticalOffsetRange;
 
@@ -528,6 +638,12 @@ private:
     /// Text layout compiler
     PDFAsynchronousTextLayoutCompiler* m_textLayoutCompiler;
 
+    /// Tile renderer (used, when tiled rendering is turned on)
+    PDFAsynchronousTileRenderer* m_tileRenderer;
+
+    /// Preview renderer (previews are displayed, until pages are compiled)
+    PDFAsynchronousPreviewRenderer* m_previewRenderer;
+
     /// Page image rasterizer for thumbnails
     PDFRasterizer* m_rasterizer;
 
@@ -550,6 +666,9 @@ private:
 
     /// Signature verification results
     std::vector<PDFSignatureVerificationResult> m_signatureVerificationResult;
+
+    /// Paint times of last frames [ns], used by performance overlay
+    std::deque<qint64> m_frameTimesNS;
 };
 
 }   // namespace pdf
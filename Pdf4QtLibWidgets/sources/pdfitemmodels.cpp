@@ -22,6 +22,7 @@
 
 #include "pdfitemmodels.h"
 #include "pdfdocument.h"
+#include "pdfcompiler.h"
 #include "pdfdrawspacecontroller.h"
 #include "pdfdrawwidget.h"
 #include "pdfwidgetutils.h"
@@ -32,6 +33,11 @@
 #include <QMimeDatabase>
 #include <QFileIconProvider>
 #include <QMimeData>
+#include <QDir>
+#include <QBuffer>
+#include <QDateTime>
+#include <QThreadPool>
+#include <QCryptographicHash>
 
 #include "pdfdbgheap.h"
 
@@ -990,6 +996,264 @@ const PDFFileSpecification* PDFAttachmentsTreeItemModel::getFileSpecification(co
     return nullptr;
 }
 
+void PDFThumbnailDiskCache::setCacheDirectory(QString directory, qint64 limit)
+{
+    QMutexLocker locker(&m_mutex);
+    m_directory = qMove(directory);
+    m_limit = limit;
+    openPackFile();
+}
+
+void PDFThumbnailDiskCache::setKey(QByteArray key)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_key != key)
+    {
+        m_key = qMove(key);
+        openPackFile();
+    }
+}
+
+QByteArray PDFThumbnailDiskCache::getKey() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_packFile.isOpen() ? m_key : QByteArray();
+}
+
+QImage PDFThumbnailDiskCache::load(PDFInteger pageIndex, int pixelSize)
+{
+    QByteArray data;
+
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_records.find(std::make_pair(pageIndex, pixelSize));
+        if (it == m_records.cend() || !m_packFile.isOpen())
+        {
+            return QImage();
+        }
+
+        if (m_packFile.seek(it->second.offset))
+        {
+            data = m_packFile.read(it->second.size);
+        }
+
+        if (data.size() != it->second.size)
+        {
+            m_records.erase(it);
+            return QImage();
+        }
+    }
+
+    // Decompress the image outside of the lock
+    QImage image;
+    image.loadFromData(data, "PNG");
+    return image;
+}
+
+void PDFThumbnailDiskCache::store(const QByteArray& key, PDFInteger pageIndex, int pixelSize, const QImage& thumbnail)
+{
+    if (thumbnail.isNull())
+    {
+        return;
+    }
+
+    // Compress the image outside of the lock
+    QByteArray data;
+    {
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::WriteOnly);
+        if (!thumbnail.save(&buffer, "PNG"))
+        {
+            return;
+        }
+    }
+
+    QByteArray recordHeader;
+    {
+        QDataStream stream(&recordHeader, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_6_0);
+        stream << RECORD_MAGIC;
+        stream << qint32(pageIndex);
+        stream << qint32(pixelSize);
+        stream << qint32(data.size());
+    }
+
+    QMutexLocker locker(&m_mutex);
+    if (key != m_key || !m_packFile.isOpen())
+    {
+        return;
+    }
+
+    // Pack file can use half of the limit, other half
+    // is used by pack files of other documents.
+    const qint64 recordSize = recordHeader.size() + data.size();
+    const qint64 packFileLimit = m_limit / 2;
+    if (m_packFile.size() + recordSize > packFileLimit)
+    {
+        if (!resetPackFile())
+        {
+            m_packFile.close();
+            return;
+        }
+
+        if (m_packFile.size() + recordSize > packFileLimit)
+        {
+            return;
+        }
+    }
+
+    const qint64 recordOffset = m_packFile.size();
+    if (!m_packFile.seek(recordOffset) ||
+        m_packFile.write(recordHeader) != recordHeader.size() ||
+        m_packFile.write(data) != data.size() ||
+        !m_packFile.flush())
+    {
+        // Write error, we do not know, which data are in the pack file
+        m_records.clear();
+        m_packFile.close();
+        return;
+    }
+
+    Record record;
+    record.offset = recordOffset + recordHeader.size();
+    record.size = data.size();
+    m_records[std::make_pair(pageIndex, pixelSize)] = record;
+}
+
+void PDFThumbnailDiskCache::openPackFile()
+{
+    m_records.clear();
+
+    if (m_packFile.isOpen())
+    {
+        m_packFile.close();
+    }
+
+    if (m_directory.isEmpty() || m_limit <= 0 || m_key.isEmpty() || !QDir().mkpath(m_directory))
+    {
+        return;
+    }
+
+    QByteArray hash = QCryptographicHash::hash(m_key, QCryptographicHash::Sha256);
+    m_packFile.setFileName(QDir(m_directory).filePath(QString::fromLatin1(hash.toHex()) + QLatin1String(".thumbnails")));
+    if (!m_packFile.open(QFile::ReadWrite))
+    {
+        return;
+    }
+
+    QDataStream stream(&m_packFile);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0;
+    int persistVersionDeserialized = 0;
+    QByteArray key;
+    stream >> magic;
+    stream >> persistVersionDeserialized;
+    stream >> key;
+
+    if (stream.status() != QDataStream::Ok || magic != FILE_MAGIC || persistVersionDeserialized != persist_version || key != m_key)
+    {
+        // New file, corrupted file, or it is a hash collision
+        if (!resetPackFile())
+        {
+            m_packFile.close();
+        }
+    }
+    else
+    {
+        // Read index of records. Record at the end of the file can
+        // be incomplete (application was terminated during write),
+        // in that case, it is removed.
+        const qint64 fileSize = m_packFile.size();
+        qint64 validSize = m_packFile.pos();
+        while (validSize < fileSize)
+        {
+            quint32 recordMagic = 0;
+            qint32 pageIndex = 0;
+            qint32 pixelSize = 0;
+            qint32 size = 0;
+            stream >> recordMagic;
+            stream >> pageIndex;
+            stream >> pixelSize;
+            stream >> size;
+
+            Record record;
+            record.offset = m_packFile.pos();
+            record.size = size;
+
+            if (stream.status() != QDataStream::Ok || recordMagic != RECORD_MAGIC || size <= 0 || record.offset + size > fileSize)
+            {
+                break;
+            }
+
+            m_records[std::make_pair(PDFInteger(pageIndex), int(pixelSize))] = record;
+            validSize = record.offset + size;
+            m_packFile.seek(validSize);
+        }
+
+        if (validSize < fileSize)
+        {
+            m_packFile.resize(validSize);
+        }
+    }
+
+    if (m_packFile.isOpen())
+    {
+        // Modification time is used as access time to find least recently used pack files
+        m_packFile.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+        shrink();
+    }
+}
+
+bool PDFThumbnailDiskCache::resetPackFile()
+{
+    m_records.clear();
+
+    if (!m_packFile.resize(0) || !m_packFile.seek(0))
+    {
+        return false;
+    }
+
+    QDataStream stream(&m_packFile);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << FILE_MAGIC;
+    stream << persist_version;
+    stream << m_key;
+    return stream.status() == QDataStream::Ok && m_packFile.flush();
+}
+
+void PDFThumbnailDiskCache::shrink()
+{
+    QDir directory(m_directory);
+    const QStringList nameFilters = { QLatin1String("*.thumbnails") };
+    const QFileInfo packFileInfo(m_packFile.fileName());
+    const QFileInfoList fileInfos = directory.entryInfoList(nameFilters, QDir::Files, QDir::Time | QDir::Reversed);
+
+    qint64 size = 0;
+    for (const QFileInfo& fileInfo : fileInfos)
+    {
+        if (fileInfo != packFileInfo)
+        {
+            size += fileInfo.size();
+        }
+    }
+
+    // Pack files of other documents can use half of the limit
+    const qint64 targetSize = m_limit / 2;
+    for (const QFileInfo& fileInfo : fileInfos)
+    {
+        if (size <= targetSize)
+        {
+            break;
+        }
+
+        if (fileInfo != packFileInfo && QFile::remove(fileInfo.filePath()))
+        {
+            size -= fileInfo.size();
+        }
+    }
+}
+
 PDFThumbnailsItemModel::PDFThumbnailsItemModel(const PDFDrawWidgetProxy* proxy, QObject* parent) :
     QAbstractItemModel(parent),
     m_proxy(proxy),
@@ -997,9 +1261,12 @@ PDFThumbnailsItemModel::PDFThumbnailsItemModel(const PDFDrawWidgetProxy* proxy,
     m_extraItemWidthHint(0),
     m_extraItemHeighHint(0),
     m_pageCount(0),
-    m_document(nullptr)
+    m_document(nullptr),
+    m_diskCache(std::make_shared<PDFThumbnailDiskCache>()),
+    m_isDiskCacheKeyDirty(true)
 {
     connect(proxy, &PDFDrawWidgetProxy::pageImageChanged, this, &PDFThumbnailsItemModel::onPageImageChanged);
+    connect(proxy, &PDFDrawWidgetProxy::colorAdjustmentChanged, this, [this]() { onPageImageChanged(true, { }); });
 }
 
 bool PDFThumbnailsItemModel::isEmpty() const
@@ -1059,8 +1326,36 @@ QVariant PDFThumbnailsItemModel::data(const QModelIndex& index, int role) const
             QPixmap pixmap;
             if (!m_thumbnailCache.find(key, &pixmap))
             {
+                if (m_isDiskCacheKeyDirty)
+                {
+                    updateDiskCacheKey();
+                }
+
                 const qreal devicePixelRatio = m_proxy->getWidget()->devicePixelRatioF();
-                QImage thumbnail = m_proxy->drawThumbnailImage(index.row(), m_thumbnailSize * devicePixelRatio);
+                const int pixelSize = m_thumbnailSize * devicePixelRatio;
+                QImage thumbnail = m_diskCache->load(pageIndex, pixelSize);
+                if (thumbnail.isNull())
+                {
+                    thumbnail = m_proxy->drawThumbnailImage(pageIndex, pixelSize);
+
+                    // If page is not compiled yet, then placeholder is drawn
+                    // instead of the thumbnail, and it can't be stored.
+                    const PDFPrecompiledPage* compiledPage = m_proxy->getCompiler()->getCompiledPage(pageIndex, false);
+                    QByteArray diskCacheKey = m_diskCache->getKey();
+                    if (!thumbnail.isNull() && compiledPage && compiledPage->isValid() && !diskCacheKey.isEmpty())
+                    {
+                        // Thumbnail is compressed and stored in the background with low
+                        // priority, so it doesn't delay any other work in the thread pool.
+                        constexpr int STORE_TASK_PRIORITY = -1;
+                        std::shared_ptr<PDFThumbnailDiskCache> diskCache = m_diskCache;
+                        auto storeThumbnail = [diskCache, diskCacheKey, pageIndex, pixelSize, thumbnail]()
+                        {
+                            diskCache->store(diskCacheKey, pageIndex, pixelSize, thumbnail);
+                        };
+                        QThreadPool::globalInstance()->start(storeThumbnail, STORE_TASK_PRIORITY);
+                    }
+                }
+
                 if (!thumbnail.isNull())
                 {
                     thumbnail.setDevicePixelRatio(devicePixelRatio);
@@ -1112,6 +1407,7 @@ void PDFThumbnailsItemModel::setDocument(const PDFModifiedDocument& document)
             beginResetModel();
             m_thumbnailCache.clear();
             m_document = document;
+            m_isDiskCacheKeyDirty = true;
 
             m_pageCount = 0;
             if (m_document)
@@ -1134,6 +1430,26 @@ PDFInteger PDFThumbnailsItemModel::getPageIndex(const QModelIndex& index) const
     return index.row();
 }
 
+void PDFThumbnailsItemModel::setDiskCache(QString directory, qint64 limit)
+{
+    m_diskCache->setCacheDirectory(qMove(directory), limit);
+    m_isDiskCacheKeyDirty = true;
+}
+
+void PDFThumbnailsItemModel::updateDiskCacheKey() const
+{
+    QByteArray key;
+
+    // Key is valid only, if proxy draws the same document
+    if (m_document && m_proxy->getDocument() == m_document)
+    {
+        key = m_proxy->getCompiler()->createDiskCacheKey();
+        m_isDiskCacheKeyDirty = false;
+    }
+
+    m_diskCache->setKey(qMove(key));
+}
+
 void PDFThumbnailsItemModel::onPageImageChanged(bool all, const std::vector<PDFInteger>& pages)
 {
     Q_UNUSED(all);
@@ -1141,7 +1457,9 @@ void PDFThumbnailsItemModel::onPageImageChanged(bool all, const std::vector<PDFI
 
     if (all)
     {
+        // Render settings may have been changed
         m_thumbnailCache.clear();
+        m_isDiskCacheKeyDirty = true;
         Q_EMIT dataChanged(index(0, 0, QModelIndex()), index(rowCount(QModelIndex()) - 1, 0, QModelIndex()));
     }
     else
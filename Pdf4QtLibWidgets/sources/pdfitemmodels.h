@@ -28,10 +28,14 @@
 #include "pdfobject.h"
 
 #include <QIcon>
+#include <QFile>
+#include <QMutex>
 #include <QPixmapCache>
 #include <QAbstractItemModel>
 
 #include <set>
+#include <map>
+#include <memory>
 
 namespace pdf
 {
@@ -296,6 +300,77 @@ public:
     const PDFFileSpecification* getFileSpecification(const QModelIndex& index) const;
 };
 
+/// Persistent cache of page thumbnails. Thumbnails of one document are stored
+/// as PNG compressed images in a single pack file, so opening the document again
+/// doesn't require to compile and rasterize pages only to display the sidebar.
+/// Records are only appended to the pack file, index of records is created
+/// when key is set. This class is thread safe.
+class PDFThumbnailDiskCache
+{
+public:
+    explicit PDFThumbnailDiskCache() = default;
+
+    /// Sets directory of the cache and its size limit. If directory is empty,
+    /// or size limit is zero, then disk cache is disabled.
+    /// \param directory Cache directory
+    /// \param limit Cache size limit [bytes]
+    void setCacheDirectory(QString directory, qint64 limit);
+
+    /// Sets key, which identifies document and render settings. Pack file
+    /// of the key is opened and its index is read. If key is empty, then
+    /// thumbnails are neither stored, nor loaded.
+    /// \param key Key
+    void setKey(QByteArray key);
+
+    /// Returns current key
+    QByteArray getKey() const;
+
+    /// Loads thumbnail from the pack file. If thumbnail is not found,
+    /// then null image is returned.
+    /// \param pageIndex Page index
+    /// \param pixelSize Size of the thumbnail [pixels]
+    QImage load(PDFInteger pageIndex, int pixelSize);
+
+    /// Stores thumbnail to the pack file. If key has been changed meanwhile,
+    /// then thumbnail is not stored. If pack file exceeds the cache size limit,
+    /// then it is cleared. Least recently used pack files of other documents
+    /// are removed, if whole cache exceeds the limit.
+    /// \param key Key, for which the thumbnail was rendered
+    /// \param pageIndex Page index
+    /// \param pixelSize Size of the thumbnail [pixels]
+    /// \param thumbnail Thumbnail image
+    void store(const QByteArray& key, PDFInteger pageIndex, int pixelSize, const QImage& thumbnail);
+
+private:
+    static constexpr quint32 FILE_MAGIC = 0x50445448;
+    static constexpr quint32 RECORD_MAGIC = 0x52454344;
+    static constexpr int persist_version = 1;
+
+    struct Record
+    {
+        qint64 offset = 0;
+        qint32 size = 0;
+    };
+
+    /// Opens pack file of the current key and reads index of records.
+    /// Mutex must be locked.
+    void openPackFile();
+
+    /// Truncates pack file and writes header. Mutex must be locked.
+    bool resetPackFile();
+
+    /// Removes least recently used pack files of other documents, until
+    /// cache size is below the limit. Mutex must be locked.
+    void shrink();
+
+    QString m_directory;
+    qint64 m_limit = 0;
+    QByteArray m_key;
+    QFile m_packFile;
+    std::map<std::pair<PDFInteger, int>, Record> m_records;
+    mutable QMutex m_mutex;
+};
+
 class PDF4QTLIBWIDGETSSHARED_EXPORT PDFThumbnailsItemModel : public QAbstractItemModel
 {
     Q_OBJECT
@@ -319,9 +394,21 @@ public:
 
     PDFInteger getPageIndex(const QModelIndex& index) const;
 
+    /// Sets directory and size limit of the disk cache of thumbnails.
+    /// Disk cache is disabled by default, it can be enabled by setting
+    /// nonempty directory and nonzero limit.
+    /// \param directory Cache directory
+    /// \param limit Disk cache limit [bytes]
+    void setDiskCache(QString directory, qint64 limit);
+
 private:
     void onPageImageChanged(bool all, const std::vector<PDFInteger>& pages);
 
+    /// Updates key of the disk cache from the current document and render
+    /// settings. Key is updated lazily, when thumbnail is requested, because
+    /// draw widget proxy can receive new document after this model.
+    void updateDiskCacheKey() const;
+
     /// Returns generated key for page index
     QString getKey(int pageIndex) const;
 
@@ -332,6 +419,11 @@ private:
     int m_pageCount;
     const PDFDocument* m_document;
     QPixmapCache m_thumbnailCache;
+
+    /// Disk cache is shared with background tasks storing the thumbnails,
+    /// so it stays alive until all pending tasks are finished.
+    std::shared_ptr<PDFThumbnailDiskCache> m_diskCache;
+    mutable bool m_isDiskCacheKeyDirty;
 };
 
 }   // namespace pdf
@@ -178,6 +178,7 @@ void PDFWidgetAnnotationManager::setDocument(const PDFModifiedDocument& document
     {
         m_editableAnnotation = PDFObjectReference();
         m_editableAnnotationPage = PDFObjectReference();
+        m_pageAnnotationIndices.clear();
     }
 }
 
@@ -567,6 +568,51 @@ void PDFWidgetAnnotationManager::wheelEvent(QWidget* widget, QWheelEvent* event)
     Q_UNUSED(event);
 }
 
+PDFWidgetAnnotationManager::PageAnnotationIndex& PDFWidgetAnnotationManager::getPageAnnotationIndex(PDFInteger pageIndex, const PageAnnotations& pageAnnotations)
+{
+    PDFWidget* widget = m_proxy->getWidget();
+    const int logicalDpiX = widget->logicalDpiX();
+
+    PageAnnotationIndex& annotationIndex = m_pageAnnotationIndices[pageIndex];
+    if (annotationIndex.isValid &&
+        annotationIndex.annotationCount == pageAnnotations.annotations.size() &&
+        annotationIndex.logicalDpiX == logicalDpiX)
+    {
+        return annotationIndex;
+    }
+
+    const PDFPage* page = m_document->getCatalog()->getPage(pageIndex);
+
+    std::vector<QRectF> rectangles;
+    rectangles.reserve(pageAnnotations.annotations.size());
+    for (const PageAnnotation& pageAnnotation : pageAnnotations.annotations)
+    {
+        // Transformation of the annotation rectangle doesn't depend on page to device
+        // matrix, so we can use identity to obtain rectangle in page coordinates.
+        // Rectangle is slightly enlarged, so rounding errors don't matter.
+        QRectF annotationRect = pageAnnotation.annotation->getRectangle();
+        QTransform matrix = prepareTransformations(QTransform(), widget, pageAnnotation.annotation->getEffectiveFlags(), page, annotationRect);
+        rectangles.push_back(matrix.mapRect(annotationRect).adjusted(-0.01, -0.01, 0.01, 0.01));
+    }
+
+    annotationIndex.isValid = true;
+    annotationIndex.tree = PDFRectangleTree(rectangles);
+    annotationIndex.annotationCount = pageAnnotations.annotations.size();
+    annotationIndex.logicalDpiX = logicalDpiX;
+    annotationIndex.hoveredAnnotations.clear();
+
+    // Annotations could be hovered before index was created
+    for (size_t i = 0; i < pageAnnotations.annotations.size(); ++i)
+    {
+        if (pageAnnotations.annotations[i].isHovered)
+        {
+            annotationIndex.hoveredAnnotations.push_back(i);
+        }
+    }
+
+    return annotationIndex;
+}
+
 void PDFWidgetAnnotationManager::updateFromMouseEvent(QMouseEvent* event)
 {
     PDFWidget* widget = m_proxy->getWidget();
@@ -587,11 +633,30 @@ void PDFWidgetAnnotationManager::updateFromMouseEvent(QMouseEvent* event)
     const bool isDown = event->buttons().testFlag(Qt::LeftButton);
     const PDFAppeareanceStreams::Appearance hoverAppearance = isDown ? PDFAppeareanceStreams::Appearance::Down : PDFAppeareanceStreams::Appearance::Rollover;
 
+    std::vector<size_t> annotationIndices;
     for (const PDFWidgetSnapshot::SnapshotItem& snapshotItem : snapshot.items)
     {
         PageAnnotations& pageAnnotations = getPageAnnotations(snapshotItem.pageIndex);
-        for (PageAnnotation& pageAnnotation : pageAnnotations.annotations)
+        PageAnnotationIndex& pageAnnotationIndex = getPageAnnotationIndex(snapshotItem.pageIndex, pageAnnotations);
+
+        // Only annotations under the mouse cursor and previously
+        // hovered annotations can change their state.
+        bool isInvertible = false;
+        const QTransform deviceToPageMatrix = snapshotItem.pageToDeviceMatrix.inverted(&isInvertible);
+        annotationIndices.clear();
+        if (isInvertible)
         {
+            pageAnnotationIndex.tree.query(deviceToPageMatrix.map(QPointF(event->pos())), annotationIndices);
+        }
+        annotationIndices.insert(annotationIndices.end(), pageAnnotationIndex.hoveredAnnotations.cbegin(), pageAnnotationIndex.hoveredAnnotations.cend());
+        std::sort(annotationIndices.begin(), annotationIndices.end());
+        annotationIndices.erase(std::unique(annotationIndices.begin(), annotationIndices.end()), annotationIndices.end());
+        pageAnnotationIndex.hoveredAnnotations.clear();
+
+        for (size_t annotationIndex : annotationIndices)
+        {
+            PageAnnotation& pageAnnotation = pageAnnotations.annotations[annotationIndex];
+
             if (pageAnnotation.annotation->isReplyTo())
             {
                 // Annotation is reply to another annotation, do not interact with it
@@ -609,6 +674,7 @@ void PDFWidgetAnnotationManager::updateFromMouseEvent(QMouseEvent* event)
             {
                 pageAnnotation.appearance = hoverAppearance;
                 pageAnnotation.isHovered = true;
+                pageAnnotationIndex.hoveredAnnotations.push_back(annotationIndex);
 
                 // Generate tooltip
                 if (m_tooltip.isEmpty())
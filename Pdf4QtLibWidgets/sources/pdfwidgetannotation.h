@@ -88,6 +88,24 @@ signals:
     void documentModified(PDFModifiedDocument document);
 
 private:
+    /// Spatial index of annotations of a single page. Hit regions of annotations
+    /// are indexed in page coordinates, so they don't depend on zoom or position
+    /// of the page in the viewport. Indices refer to page annotations.
+    struct PageAnnotationIndex
+    {
+        bool isValid = false;
+        PDFRectangleTree tree;
+        size_t annotationCount = 0;
+        int logicalDpiX = 0;
+        std::vector<size_t> hoveredAnnotations; ///< Hovered annotations, sorted
+    };
+
+    /// Returns spatial index of page annotations. If index doesn't exist,
+    /// or it is outdated, then it is created.
+    /// \param pageIndex Page index
+    /// \param pageAnnotations Annotations of the page
+    PageAnnotationIndex& getPageAnnotationIndex(PDFInteger pageIndex, const PageAnnotations& pageAnnotations);
+
     void updateFromMouseEvent(QMouseEvent* event);
     bool beginAnnotationDrag(QMouseEvent* event);
     void startAnnotationDrag(QMouseEvent* event);
@@ -152,6 +170,7 @@ private:
         QPoint dragHotSpot;
     };
     DragState m_dragState;
+    std::map<PDFInteger, PageAnnotationIndex> m_pageAnnotationIndices;
 };
 
 }   // namespace pdf
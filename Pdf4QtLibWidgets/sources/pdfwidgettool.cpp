@@ -771,7 +771,8 @@ void PDFSelectTextTool::mouseReleaseEvent(QWidget* widget, QMouseEvent* event)
             if (m_selectionInfo.pageIndex == pageIndex)
             {
                 // Jakub Melka: handle the selection
-                PDFTextLayout textLayout = getProxy()->getTextLayoutCompiler()->getTextLayoutLazy(pageIndex);
+                PDFTextLayoutGetter textLayoutGetter = getProxy()->getTextLayoutCompiler()->getTextLayoutLazy(pageIndex);
+                const PDFTextLayout& textLayout = textLayoutGetter;
                 setSelection(textLayout.createTextSelection(pageIndex, m_selectionInfo.selectionStartPoint, pagePoint));
             }
             else
@@ -797,7 +798,8 @@ void PDFSelectTextTool::mouseMoveEvent(QWidget* widget, QMouseEvent* event)
 
     QPointF pagePoint;
     const PDFInteger pageIndex = getProxy()->getPageUnderPoint(event->pos(), &pagePoint);
-    PDFTextLayout textLayout = getProxy()->getTextLayoutCompiler()->getTextLayoutLazy(pageIndex);
+    PDFTextLayoutGetter textLayoutGetter = getProxy()->getTextLayoutCompiler()->getTextLayoutLazy(pageIndex);
+    const PDFTextLayout& textLayout = textLayoutGetter;
     m_isCursorOverText = textLayout.isHoveringOverTextBlock(pagePoint);
 
     if (m_selectionInfo.pageIndex != -1)
@@ -877,7 +879,8 @@ void PDFSelectTextTool::onActionCopyText()
             while (it != m_textSelection.end())
             {
                 const PDFInteger pageIndex = it->start.pageIndex;
-                PDFTextLayout textLayout = getProxy()->getTextLayoutCompiler()->getTextLayoutLazy(pageIndex);
+                PDFTextLayoutGetter textLayoutGetter = getProxy()->getTextLayoutCompiler()->getTextLayoutLazy(pageIndex);
+                const PDFTextLayout& textLayout = textLayoutGetter;
                 result << textLayout.getTextFromSelection(it, itEnd, pageIndex);
 
                 it = itEnd;
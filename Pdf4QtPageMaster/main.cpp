@@ -29,6 +29,8 @@
 
 #include <QApplication>
 #include <QCommandLineParser>
+#include <QDir>
+#include <QStandardPaths>
 
 int main(int argc, char *argv[]) {
   QApplication::setAttribute(Qt::AA_CompressHighFrequencyEvents, true);
@@ -66,6 +68,10 @@ int main(int argc, char *argv[]) {
 
   // PDF4QT-Opus: Initialize PDFium for fast thumbnail rendering
   pdfpagemaster::PdfiumThumbnail::initialize();
+  pdfpagemaster::PdfiumThumbnail::setCacheDirectory(
+      QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation))
+          .filePath("thumbnails"),
+      256 * 1024 * 1024);
 
   QIcon appIcon(":/app-icon.svg");
   QApplication::setWindowIcon(appIcon);
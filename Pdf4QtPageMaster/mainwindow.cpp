@@ -471,6 +471,7 @@ bool MainWindow::insertDocument(const QString &fileName,
 
   // Try to open a new document
   pdf::PDFDocumentReader reader(nullptr, qMove(queryPassword), true, false);
+  reader.setLazyObjectLoading(true);
   pdf::PDFDocument document = reader.readFromFile(fileName);
 
   QString errorMessage = reader.getErrorMessage();
@@ -543,6 +544,7 @@ void MainWindow::insertDocumentsBatch(const QStringList &fileNames,
           return QString();
         },
         true, false);
+    reader.setLazyObjectLoading(true);
     loaded.document = reader.readFromFile(fileName);
     loaded.result = reader.getReadingResult();
     loaded.errorMessage = reader.getErrorMessage();
@@ -765,6 +767,46 @@ bool MainWindow::canPerformOperation(Operation operation) const {
   return false;
 }
 
+pdf::PDFOperationResult MainWindow::writeSelectedPages(
+    const QString &fileName,
+    const std::vector<pdf::PDFDocumentManipulator::AssembledPage>
+        &assembledPages) const {
+  pdf::PDFStreamingMerger merger(fileName);
+  if (!merger.begin()) {
+    return tr("Cannot write file '%1'.").arg(fileName);
+  }
+
+  const std::map<int, DocumentItem> &documents = m_model->getDocuments();
+
+  // Consecutive pages of the same document are added at once, so objects
+  // shared by these pages are written only once
+  auto it = assembledPages.cbegin();
+  while (it != assembledPages.cend()) {
+    const pdf::PDFInteger documentIndex = it->documentIndex;
+    auto documentIt = documents.find(int(documentIndex));
+    if (documentIt == documents.cend()) {
+      return tr("Document doesn't exist.");
+    }
+
+    std::vector<pdf::PDFStreamingMerger::SelectedPage> selectedPages;
+    for (; it != assembledPages.cend() && it->documentIndex == documentIndex;
+         ++it) {
+      pdf::PDFStreamingMerger::SelectedPage selectedPage;
+      selectedPage.pageIndex = it->pageIndex;
+      selectedPage.pageRotation = it->pageRotation;
+      selectedPages.push_back(selectedPage);
+    }
+
+    pdf::PDFOperationResult result =
+        merger.addPages(documentIt->second.document, selectedPages);
+    if (!result) {
+      return result;
+    }
+  }
+
+  return merger.finish();
+}
+
 void MainWindow::performOperation(Operation operation) {
   switch (operation) {
   case Operation::Clear: {
@@ -1022,13 +1064,6 @@ void MainWindow::performOperation(Operation operation) {
       pdf::PDFOperationResult result(true);
       for (const std::vector<pdf::PDFDocumentManipulator::AssembledPage>
                &assembledPages : assembledDocuments) {
-        pdf::PDFOperationResult currentResult =
-            manipulator.assemble(assembledPages);
-        if (!currentResult && result) {
-          result = currentResult;
-          break;
-        }
-
         pdf::PDFDocumentManipulator::AssembledPage samplePage =
             assembledPages.front();
         sourceDocumentIndex = samplePage.documentIndex == -1
@@ -1057,6 +1092,33 @@ void MainWindow::performOperation(Operation operation) {
           return;
         }
 
+        // Documents containing only document pages (without outline) are
+        // written directly, only objects of the assembled pages are read
+        const bool isDocumentPagesOnly = std::all_of(
+            assembledPages.cbegin(), assembledPages.cend(),
+            [](const auto &page) { return page.isDocumentPage(); });
+        if (isDocumentPagesOnly &&
+            outlineMode == pdf::PDFDocumentManipulator::OutlineMode::NoOutline) {
+          pdf::PDFOperationResult writeResult =
+              writeSelectedPages(fileName, assembledPages);
+
+          if (!writeResult) {
+            QMessageBox::critical(this, tr("Error"),
+                                  writeResult.getErrorMessage());
+            return;
+          }
+
+          ++assembledDocumentIndex;
+          continue;
+        }
+
+        pdf::PDFOperationResult currentResult =
+            manipulator.assemble(assembledPages);
+        if (!currentResult && result) {
+          result = currentResult;
+          break;
+        }
+
         // Write immediately to disk - releases memory after each document
         pdf::PDFDocument assembledDoc = manipulator.takeAssembledDocument();
         pdf::PDFDocumentWriter writer(nullptr);
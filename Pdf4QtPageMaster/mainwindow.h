@@ -126,6 +126,16 @@ private:
   bool canPerformOperation(Operation operation) const;
   void performOperation(Operation operation);
 
+  /// Writes assembled pages, which are all document pages, directly to the
+  /// file. Only objects reachable from the assembled pages are read from
+  /// the source documents and written to the output file.
+  /// @param fileName File name of the output document
+  /// @param assembledPages Assembled pages
+  pdf::PDFOperationResult writeSelectedPages(
+      const QString &fileName,
+      const std::vector<pdf::PDFDocumentManipulator::AssembledPage>
+          &assembledPages) const;
+
   struct Settings {
     QString directory;
   };
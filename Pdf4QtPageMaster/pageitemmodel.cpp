@@ -27,6 +27,7 @@
 #include <QMimeData>
 
 #include <iterator>
+#include <numeric>
 
 namespace pdfpagemaster {
 
@@ -419,17 +420,28 @@ void PageItemModel::removeSelection(const QModelIndexList &list) {
 
   Modifier modifier(this);
 
-  std::vector<int> rows;
-  rows.reserve(list.size());
-  std::transform(list.cbegin(), list.cend(), std::back_inserter(rows),
-                 [](const auto &index) { return index.row(); });
-  std::sort(rows.begin(), rows.end(), std::greater<int>());
+  const std::vector<bool> mask = getSelectedRowsMask(list);
 
   beginResetModel();
-  for (int row : rows) {
-    m_trashBin.emplace_back(qMove(m_pageGroupItems[row]));
-    m_pageGroupItems.erase(std::next(m_pageGroupItems.begin(), row));
+
+  // Removed items are put into the trash bin in reversed order
+  for (size_t i = mask.size(); i > 0; --i) {
+    if (mask[i - 1]) {
+      m_trashBin.emplace_back(std::move(m_pageGroupItems[i - 1]));
+    }
   }
+
+  size_t newSize = 0;
+  for (size_t i = 0; i < mask.size(); ++i) {
+    if (!mask[i]) {
+      if (newSize != i) {
+        m_pageGroupItems[newSize] = std::move(m_pageGroupItems[i]);
+      }
+      ++newSize;
+    }
+  }
+  m_pageGroupItems.resize(newSize);
+
   endResetModel();
 }
 
@@ -483,21 +495,89 @@ PageItemModel::extractItems(std::vector<PageGroupItem> &items,
                             const QModelIndexList &selection) const {
   std::vector<PageGroupItem::GroupItem> extractedItems;
 
-  std::vector<int> rows;
-  rows.reserve(selection.size());
-  std::transform(selection.cbegin(), selection.cend(), std::back_inserter(rows),
-                 [](const auto &index) { return index.row(); });
-  std::sort(rows.begin(), rows.end(), std::greater<int>());
+  // Single pass over the items, so extraction is linear even for very
+  // large number of rows
+  std::vector<bool> mask = getSelectedRowsMask(selection);
+  mask.resize(items.size(), false);
 
-  for (int row : rows) {
-    extractedItems.insert(extractedItems.begin(), items[row].groups.cbegin(),
-                          items[row].groups.cend());
-    items.erase(std::next(items.begin(), row));
+  size_t newSize = 0;
+  for (size_t i = 0; i < items.size(); ++i) {
+    if (mask[i]) {
+      extractedItems.insert(extractedItems.end(), items[i].groups.cbegin(),
+                            items[i].groups.cend());
+    } else {
+      if (newSize != i) {
+        items[newSize] = std::move(items[i]);
+      }
+      ++newSize;
+    }
   }
+  items.resize(newSize);
 
   return extractedItems;
 }
 
+std::vector<bool>
+PageItemModel::getSelectedRowsMask(const QModelIndexList &selection) const {
+  std::vector<bool> mask(m_pageGroupItems.size(), false);
+
+  for (const QModelIndex &index : selection) {
+    const int row = index.row();
+    if (row >= 0 && row < int(mask.size())) {
+      mask[row] = true;
+    }
+  }
+
+  return mask;
+}
+
+void PageItemModel::applyPermutation(const std::vector<int> &permutation) {
+  Q_ASSERT(permutation.size() == m_pageGroupItems.size());
+
+  Q_EMIT layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+
+  std::vector<PageGroupItem> pageGroupItems;
+  pageGroupItems.reserve(m_pageGroupItems.size());
+  for (int row : permutation) {
+    pageGroupItems.emplace_back(std::move(m_pageGroupItems[row]));
+  }
+  m_pageGroupItems = std::move(pageGroupItems);
+
+  const std::vector<int> inversePermutation =
+      getInversePermutation(permutation);
+  const QModelIndexList oldIndices = persistentIndexList();
+  QModelIndexList newIndices;
+  newIndices.reserve(oldIndices.size());
+  for (const QModelIndex &oldIndex : oldIndices) {
+    newIndices << index(inversePermutation[oldIndex.row()], oldIndex.column(),
+                        QModelIndex());
+  }
+  changePersistentIndexList(oldIndices, newIndices);
+
+  Q_EMIT layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+}
+
+void PageItemModel::performPermutation(const std::vector<int> &permutation) {
+  UndoRedoStep step;
+  step.permutation = getInversePermutation(permutation);
+  m_undoSteps.emplace_back(std::move(step));
+  m_redoSteps.clear();
+  updateUndoRedoSteps();
+
+  applyPermutation(permutation);
+}
+
+std::vector<int>
+PageItemModel::getInversePermutation(const std::vector<int> &permutation) {
+  std::vector<int> inversePermutation(permutation.size(), 0);
+
+  for (size_t i = 0; i < permutation.size(); ++i) {
+    inversePermutation[permutation[i]] = int(i);
+  }
+
+  return inversePermutation;
+}
+
 void PageItemModel::rotateLeft(const QModelIndexList &list) {
   if (list.isEmpty()) {
     return;
@@ -849,9 +929,21 @@ void PageItemModel::performUndoRedo(
     return;
   }
 
-  save.emplace_back(getCurrentStep());
   UndoRedoStep step = std::move(load.back());
   load.pop_back();
+
+  if (!step.permutation.empty()) {
+    // Rows rearrangement, store only the inverse permutation
+    UndoRedoStep inverseStep;
+    inverseStep.permutation = getInversePermutation(step.permutation);
+    save.emplace_back(std::move(inverseStep));
+    updateUndoRedoSteps();
+
+    applyPermutation(step.permutation);
+    return;
+  }
+
+  save.emplace_back(getCurrentStep());
   updateUndoRedoSteps();
 
   beginResetModel();
@@ -1136,8 +1228,6 @@ bool PageItemModel::dropMimeData(const QMimeData *data, Qt::DropAction action,
     return false;
   }
 
-  Modifier modifier(this);
-
   int insertRow = rowCount(QModelIndex());
   if (row > -1) {
     insertRow = row;
@@ -1156,6 +1246,7 @@ bool PageItemModel::dropMimeData(const QMimeData *data, Qt::DropAction action,
   }
 
   std::sort(rows.begin(), rows.end());
+  rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
 
   // Sanity checks on rows
   if (rows.empty()) {
@@ -1165,9 +1256,6 @@ bool PageItemModel::dropMimeData(const QMimeData *data, Qt::DropAction action,
     return false;
   }
 
-  std::vector<PageGroupItem> newItems = m_pageGroupItems;
-  std::vector<PageGroupItem> workItems;
-
   // When moving, update insert row
   if (action == Qt::MoveAction) {
     const int originalInsertRow = insertRow;
@@ -1180,21 +1268,47 @@ bool PageItemModel::dropMimeData(const QMimeData *data, Qt::DropAction action,
         --insertRow;
       }
     }
+
+    // Move is just a rearrangement of the rows, so we do not copy the items,
+    // we only compute a permutation of the rows (also used for undo/redo).
+    std::vector<int> permutation;
+    permutation.reserve(m_pageGroupItems.size());
+
+    auto rowIt = rows.cbegin();
+    for (int i = 0; i < int(m_pageGroupItems.size()); ++i) {
+      if (rowIt != rows.cend() && *rowIt == i) {
+        ++rowIt;
+      } else {
+        permutation.push_back(i);
+      }
+    }
+
+    insertRow = qBound(0, insertRow, int(permutation.size()));
+    permutation.insert(std::next(permutation.begin(), insertRow), rows.cbegin(),
+                       rows.cend());
+
+    std::vector<int> identity(permutation.size(), 0);
+    std::iota(identity.begin(), identity.end(), 0);
+
+    if (permutation != identity) {
+      performPermutation(permutation);
+    }
+
+    return true;
   }
 
+  Modifier modifier(this);
+
+  std::vector<PageGroupItem> newItems = m_pageGroupItems;
+  std::vector<PageGroupItem> workItems;
+
   workItems.reserve(rows.size());
   for (int currentRow : rows) {
     workItems.push_back(m_pageGroupItems[currentRow]);
   }
 
-  // When move, delete old page items
-  if (action == Qt::MoveAction) {
-    for (auto it = rows.rbegin(); it != rows.rend(); ++it) {
-      newItems.erase(std::next(newItems.begin(), *it));
-    }
-  }
-
   // Insert work items at a given position
+  insertRow = qBound(0, insertRow, int(newItems.size()));
   newItems.insert(std::next(newItems.begin(), insertRow), workItems.begin(),
                   workItems.end());
 
@@ -1321,9 +1435,9 @@ PageItemModel::Modifier::Modifier(PageItemModel *model) : m_model(model) {
 }
 
 PageItemModel::Modifier::~Modifier() {
-  UndoRedoStep stateAfterModification = m_model->getCurrentStep();
-
-  if (m_stateBeforeModification != stateAfterModification) {
+  // Compare with the current state directly, so we do not have to copy it
+  if (m_stateBeforeModification.pageGroupItems != m_model->m_pageGroupItems ||
+      m_stateBeforeModification.trashBin != m_model->m_trashBin) {
     m_model->m_undoSteps.emplace_back(std::move(m_stateBeforeModification));
     m_model->m_redoSteps.clear();
     m_model->updateUndoRedoSteps();
@@ -231,11 +231,17 @@ private:
   void updateItemCaptionAndTags(PageGroupItem &item) const;
   void insertEmptyPage(const QModelIndex &index);
 
+  /// Undo/redo step. If permutation is empty, step contains full state
+  /// of the model. Otherwise step is just a rearrangement of the rows
+  /// (for example, drag and drop move of the pages) and only permutation
+  /// of the rows is stored: row i of the restored state is row
+  /// permutation[i] of the current state.
   struct UndoRedoStep {
     auto operator<=>(const UndoRedoStep &) const = default;
 
     std::vector<PageGroupItem> pageGroupItems;
     std::vector<PageGroupItem> trashBin;
+    std::vector<int> permutation;
   };
 
   class Modifier {
@@ -252,11 +258,26 @@ private:
   extractItems(std::vector<PageGroupItem> &items,
                const QModelIndexList &selection) const;
 
+  /// Returns mask of selected rows (size of the mask is row count)
+  std::vector<bool> getSelectedRowsMask(const QModelIndexList &selection) const;
+
+  /// Rearranges rows, so row i will be the row permutation[i]. Persistent
+  /// indices (for example, selection) are updated. Undo/redo is not changed.
+  /// \param permutation Permutation of rows
+  void applyPermutation(const std::vector<int> &permutation);
+
+  /// Stores undo step of the rows rearrangement and rearranges rows
+  /// \param permutation Permutation of rows
+  void performPermutation(const std::vector<int> &permutation);
+
+  static std::vector<int>
+  getInversePermutation(const std::vector<int> &permutation);
+
   QItemSelection getSelectionImpl(
       std::function<bool(const PageGroupItem::GroupItem &)> filter) const;
 
   UndoRedoStep getCurrentStep() const {
-    return UndoRedoStep{m_pageGroupItems, m_trashBin};
+    return UndoRedoStep{m_pageGroupItems, m_trashBin, {}};
   }
   void updateUndoRedoSteps();
   void clearUndoRedo();
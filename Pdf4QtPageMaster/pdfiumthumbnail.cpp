@@ -3,9 +3,15 @@
 
 #include "pdfiumthumbnail.h"
 
+#include <QCryptographicHash>
+#include <QDateTime>
 #include <QDebug>
+#include <QDir>
 #include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
 
+#include <list>
 
 // PDFium headers
 #include "fpdf_thumbnail.h"
@@ -14,8 +20,83 @@
 
 namespace pdfpagemaster {
 
+namespace {
+
+/// Maximal number of documents kept opened
+constexpr size_t MAX_OPENED_DOCUMENTS = 32;
+
+struct OpenedDocument {
+  QString path;
+  qint64 fileSize = 0;
+  QDateTime lastModified;
+  FPDF_DOCUMENT document = nullptr;
+};
+
+/// Pool of opened documents, most recently used document is at the front.
+/// Protected by the PDFium mutex.
+std::list<OpenedDocument> s_openedDocuments;
+
+/// Return opened document, open it if it is not in the pool. If file was
+/// modified since it was opened, it is opened again. PDFium mutex must be
+/// locked. Returns nullptr, if document can't be opened.
+FPDF_DOCUMENT getDocument(const QString &pdfPath) {
+  QFileInfo fileInfo(pdfPath);
+  const qint64 fileSize = fileInfo.size();
+  const QDateTime lastModified = fileInfo.lastModified();
+
+  for (auto it = s_openedDocuments.begin(); it != s_openedDocuments.end();
+       ++it) {
+    if (it->path == pdfPath) {
+      if (it->fileSize == fileSize && it->lastModified == lastModified) {
+        s_openedDocuments.splice(s_openedDocuments.begin(), s_openedDocuments,
+                                 it);
+        return it->document;
+      }
+
+      // File was modified, document must be opened again
+      FPDF_CloseDocument(it->document);
+      s_openedDocuments.erase(it);
+      break;
+    }
+  }
+
+  QByteArray pathUtf8 = pdfPath.toUtf8();
+  FPDF_DOCUMENT document = FPDF_LoadDocument(pathUtf8.constData(), nullptr);
+  if (!document) {
+    return nullptr;
+  }
+
+  OpenedDocument openedDocument;
+  openedDocument.path = pdfPath;
+  openedDocument.fileSize = fileSize;
+  openedDocument.lastModified = lastModified;
+  openedDocument.document = document;
+  s_openedDocuments.push_front(openedDocument);
+
+  while (s_openedDocuments.size() > MAX_OPENED_DOCUMENTS) {
+    FPDF_CloseDocument(s_openedDocuments.back().document);
+    s_openedDocuments.pop_back();
+  }
+
+  return document;
+}
+
+/// Close all opened documents. PDFium mutex must be locked.
+void closeAllDocuments() {
+  for (const OpenedDocument &openedDocument : s_openedDocuments) {
+    FPDF_CloseDocument(openedDocument.document);
+  }
+  s_openedDocuments.clear();
+}
+
+} // namespace
+
 bool PdfiumThumbnail::s_initialized = false;
 QMutex PdfiumThumbnail::s_mutex;
+QMutex PdfiumThumbnail::s_cacheMutex;
+QString PdfiumThumbnail::s_cacheDirectory;
+qint64 PdfiumThumbnail::s_cacheLimit = 0;
+qint64 PdfiumThumbnail::s_cacheSize = 0;
 
 bool PdfiumThumbnail::initialize() {
   QMutexLocker lock(&s_mutex);
@@ -39,6 +120,7 @@ bool PdfiumThumbnail::initialize() {
 void PdfiumThumbnail::shutdown() {
   QMutexLocker lock(&s_mutex);
   if (s_initialized) {
+    closeAllDocuments();
     FPDF_DestroyLibrary();
     s_initialized = false;
   }
@@ -46,15 +128,39 @@ void PdfiumThumbnail::shutdown() {
 
 bool PdfiumThumbnail::isAvailable() { return s_initialized; }
 
+void PdfiumThumbnail::setCacheDirectory(const QString &directory,
+                                        qint64 limit) {
+  QMutexLocker lock(&s_cacheMutex);
+  s_cacheDirectory = directory;
+  s_cacheLimit = limit;
+  s_cacheSize = 0;
+
+  if (!s_cacheDirectory.isEmpty() && s_cacheLimit > 0) {
+    shrinkCache(s_cacheDirectory, s_cacheLimit);
+  }
+}
+
+void PdfiumThumbnail::closeDocument(const QString &pdfPath) {
+  QMutexLocker lock(&s_mutex);
+  for (auto it = s_openedDocuments.begin(); it != s_openedDocuments.end();
+       ++it) {
+    if (it->path == pdfPath) {
+      FPDF_CloseDocument(it->document);
+      s_openedDocuments.erase(it);
+      break;
+    }
+  }
+}
+
 QImage PdfiumThumbnail::getEmbeddedThumbnail(const QString &pdfPath,
                                              int pageIndex) {
+  QMutexLocker lock(&s_mutex);
   if (!s_initialized) {
     return QImage();
   }
 
-  // Load PDF document
-  QByteArray pathUtf8 = pdfPath.toUtf8();
-  FPDF_DOCUMENT doc = FPDF_LoadDocument(pathUtf8.constData(), nullptr);
+  // Get PDF document from the pool
+  FPDF_DOCUMENT doc = getDocument(pdfPath);
   if (!doc) {
     return QImage();
   }
@@ -62,7 +168,6 @@ QImage PdfiumThumbnail::getEmbeddedThumbnail(const QString &pdfPath,
   // Load page
   FPDF_PAGE page = FPDF_LoadPage(doc, pageIndex);
   if (!page) {
-    FPDF_CloseDocument(doc);
     return QImage();
   }
 
@@ -85,7 +190,6 @@ QImage PdfiumThumbnail::getEmbeddedThumbnail(const QString &pdfPath,
   }
 
   FPDF_ClosePage(page);
-  FPDF_CloseDocument(doc);
 
   return result;
 }
@@ -96,60 +200,151 @@ QImage PdfiumThumbnail::renderPage(const QString &pdfPath, int pageIndex,
     return QImage();
   }
 
-  // Load PDF document
-  QByteArray pathUtf8 = pdfPath.toUtf8();
-  FPDF_DOCUMENT doc = FPDF_LoadDocument(pathUtf8.constData(), nullptr);
-  if (!doc) {
-    return QImage();
-  }
-
-  // Load page
-  FPDF_PAGE page = FPDF_LoadPage(doc, pageIndex);
-  if (!page) {
-    FPDF_CloseDocument(doc);
-    return QImage();
+  // Try the disk cache first, it can be read in parallel
+  const QString cacheFileName =
+      getCacheFileName(pdfPath, pageIndex, targetSize);
+  if (!cacheFileName.isEmpty()) {
+    QImage cachedImage;
+    if (cachedImage.load(cacheFileName, "PNG")) {
+      // Modification time is used as access time to find least recently
+      // used thumbnails
+      QFile file(cacheFileName);
+      if (file.open(QFile::ReadWrite)) {
+        file.setFileTime(QDateTime::currentDateTime(),
+                         QFileDevice::FileModificationTime);
+      }
+      return cachedImage;
+    }
   }
 
-  // Get page dimensions and calculate target size maintaining aspect ratio
-  double pageWidth = FPDF_GetPageWidth(page);
-  double pageHeight = FPDF_GetPageHeight(page);
-
-  double scaleX = targetSize.width() / pageWidth;
-  double scaleY = targetSize.height() / pageHeight;
-  double scale = qMin(scaleX, scaleY);
+  QImage result;
 
-  int renderWidth = static_cast<int>(pageWidth * scale);
-  int renderHeight = static_cast<int>(pageHeight * scale);
+  {
+    QMutexLocker lock(&s_mutex);
+    if (!s_initialized) {
+      return QImage();
+    }
+
+    // Get PDF document from the pool
+    FPDF_DOCUMENT doc = getDocument(pdfPath);
+    if (!doc) {
+      return QImage();
+    }
+
+    // Load page
+    FPDF_PAGE page = FPDF_LoadPage(doc, pageIndex);
+    if (!page) {
+      return QImage();
+    }
+
+    // Get page dimensions and calculate target size maintaining aspect ratio
+    double pageWidth = FPDF_GetPageWidth(page);
+    double pageHeight = FPDF_GetPageHeight(page);
+
+    double scaleX = targetSize.width() / pageWidth;
+    double scaleY = targetSize.height() / pageHeight;
+    double scale = qMin(scaleX, scaleY);
+
+    int renderWidth = static_cast<int>(pageWidth * scale);
+    int renderHeight = static_cast<int>(pageHeight * scale);
+
+    // Create bitmap for rendering
+    FPDF_BITMAP bitmap = FPDFBitmap_Create(renderWidth, renderHeight, 0);
+    if (!bitmap) {
+      FPDF_ClosePage(page);
+      return QImage();
+    }
+
+    // Fill with white background
+    FPDFBitmap_FillRect(bitmap, 0, 0, renderWidth, renderHeight, 0xFFFFFFFF);
+
+    // Render page to bitmap
+    FPDF_RenderPageBitmap(bitmap, page, 0, 0, renderWidth, renderHeight, 0,
+                          FPDF_ANNOT | FPDF_LCD_TEXT);
+
+    // Create QImage from PDFium bitmap
+    int stride = FPDFBitmap_GetStride(bitmap);
+    void *buffer = FPDFBitmap_GetBuffer(bitmap);
+
+    result = QImage(static_cast<uchar *>(buffer), renderWidth, renderHeight,
+                    stride, QImage::Format_ARGB32)
+                 .copy();
 
-  // Create bitmap for rendering
-  FPDF_BITMAP bitmap = FPDFBitmap_Create(renderWidth, renderHeight, 0);
-  if (!bitmap) {
+    // Cleanup
+    FPDFBitmap_Destroy(bitmap);
     FPDF_ClosePage(page);
-    FPDF_CloseDocument(doc);
-    return QImage();
   }
 
-  // Fill with white background
-  FPDFBitmap_FillRect(bitmap, 0, 0, renderWidth, renderHeight, 0xFFFFFFFF);
+  // Store the thumbnail into the disk cache, compression is done
+  // without PDFium mutex locked
+  if (!cacheFileName.isEmpty() && !result.isNull()) {
+    QSaveFile file(cacheFileName);
+    if (file.open(QFile::WriteOnly) && result.save(&file, "PNG") &&
+        file.commit()) {
+      QMutexLocker lock(&s_cacheMutex);
+      s_cacheSize += QFileInfo(cacheFileName).size();
+      if (s_cacheSize > s_cacheLimit) {
+        shrinkCache(s_cacheDirectory, s_cacheLimit);
+      }
+    }
+  }
 
-  // Render page to bitmap
-  FPDF_RenderPageBitmap(bitmap, page, 0, 0, renderWidth, renderHeight, 0,
-                        FPDF_ANNOT | FPDF_LCD_TEXT);
+  return result;
+}
 
-  // Create QImage from PDFium bitmap
-  int stride = FPDFBitmap_GetStride(bitmap);
-  void *buffer = FPDFBitmap_GetBuffer(bitmap);
+QString PdfiumThumbnail::getCacheFileName(const QString &pdfPath,
+                                          int pageIndex, QSize targetSize) {
+  QString directory;
+  {
+    QMutexLocker lock(&s_cacheMutex);
+    if (s_cacheDirectory.isEmpty() || s_cacheLimit <= 0) {
+      return QString();
+    }
+    directory = s_cacheDirectory;
+  }
 
-  QImage result = QImage(static_cast<uchar *>(buffer), renderWidth,
-                         renderHeight, stride, QImage::Format_ARGB32)
-                      .copy();
+  if (!QDir().mkpath(directory)) {
+    return QString();
+  }
 
-  // Cleanup
-  FPDFBitmap_Destroy(bitmap);
-  FPDF_ClosePage(page);
-  FPDF_CloseDocument(doc);
+  // Key contains file size and modification time, so thumbnails
+  // of modified file are not taken from the cache.
+  QFileInfo fileInfo(pdfPath);
+  QByteArray key = fileInfo.absoluteFilePath().toUtf8();
+  key += QByteArray::number(fileInfo.size());
+  key += QByteArray::number(fileInfo.lastModified().toMSecsSinceEpoch());
+  key += QByteArray::number(pageIndex);
+  key += QByteArray::number(targetSize.width());
+  key += QByteArray::number(targetSize.height());
+
+  QByteArray hash = QCryptographicHash::hash(key, QCryptographicHash::Sha256);
+  return QDir(directory).filePath(QString::fromLatin1(hash.toHex()) +
+                                  QLatin1String(".png"));
+}
 
-  return result;
+void PdfiumThumbnail::shrinkCache(const QString &directory, qint64 limit) {
+  QDir cacheDirectory(directory);
+  const QStringList nameFilters = {QLatin1String("*.png")};
+  const QFileInfoList fileInfos = cacheDirectory.entryInfoList(
+      nameFilters, QDir::Files, QDir::Time | QDir::Reversed);
+
+  s_cacheSize = 0;
+  for (const QFileInfo &fileInfo : fileInfos) {
+    s_cacheSize += fileInfo.size();
+  }
+
+  // Remove least recently used thumbnails until only 3/4 of the limit
+  // is used, so we do not have to list the directory on each store.
+  const qint64 targetSize = limit / 4 * 3;
+  for (const QFileInfo &fileInfo : fileInfos) {
+    if (s_cacheSize <= targetSize) {
+      break;
+    }
+
+    if (QFile::remove(fileInfo.filePath())) {
+      s_cacheSize -= fileInfo.size();
+    }
+  }
 }
 
 } // namespace pdfpagemaster
@@ -12,7 +12,11 @@
 namespace pdfpagemaster {
 
 /// Fast PDF thumbnail renderer using PDFium (Google Chrome's PDF engine)
-/// This provides NAPS2-level performance for thumbnail generation
+/// This provides NAPS2-level performance for thumbnail generation.
+/// PDFium is not thread safe, so all PDFium calls are serialized. Opened
+/// documents are kept in a small pool, so rendering of consecutive pages
+/// doesn't reopen and reparse the file. Rendered thumbnails can be stored
+/// in a persistent disk cache.
 class PdfiumThumbnail {
 public:
   /// Initialize PDFium library (call once at startup)
@@ -24,7 +28,19 @@ public:
   /// Check if PDFium is available
   static bool isAvailable();
 
-  /// Render a page thumbnail using PDFium
+  /// Set directory and size limit of the persistent thumbnail cache.
+  /// If directory is empty, or limit is zero, disk cache is disabled.
+  /// @param directory Cache directory
+  /// @param limit Cache size limit [bytes]
+  static void setCacheDirectory(const QString &directory, qint64 limit);
+
+  /// Close opened document of given file (for example, when the file
+  /// was removed from the application, or it has been modified)
+  /// @param pdfPath Path to PDF file
+  static void closeDocument(const QString &pdfPath);
+
+  /// Render a page thumbnail using PDFium. Thumbnail is taken from
+  /// the disk cache, if it is enabled and thumbnail is found there.
   /// @param pdfPath Path to PDF file
   /// @param pageIndex 0-based page index
   /// @param targetSize Target thumbnail size
@@ -39,8 +55,21 @@ public:
   static QImage getEmbeddedThumbnail(const QString &pdfPath, int pageIndex);
 
 private:
+  /// Return file name of the thumbnail in the disk cache, or empty
+  /// string, if disk cache is disabled.
+  static QString getCacheFileName(const QString &pdfPath, int pageIndex,
+                                  QSize targetSize);
+
+  /// Remove least recently used thumbnails, until cache
+  /// size is below the limit.
+  static void shrinkCache(const QString &directory, qint64 limit);
+
   static bool s_initialized;
   static QMutex s_mutex;
+  static QMutex s_cacheMutex;
+  static QString s_cacheDirectory;
+  static qint64 s_cacheLimit;
+  static qint64 s_cacheSize;
 };
 
 } // namespace pdfpagemaster
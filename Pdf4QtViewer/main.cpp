@@ -26,9 +26,11 @@
 #include "pdfwidgetutils.h"
 #include "pdfviewersettings.h"
 #include "pdfapplicationtranslator.h"
+#include "pdfsingleinstance.h"
 
 #include <QApplication>
 #include <QCommandLineParser>
+#include <QFileInfo>
 
 int main(int argc, char *argv[])
 {
@@ -43,17 +45,36 @@ int main(int argc, char *argv[])
     QCommandLineOption noDrm("no-drm", "Disable DRM settings of documents.");
     QCommandLineOption lightGui("theme-light", "Use a light theme for the GUI.");
     QCommandLineOption darkGui("theme-dark", "Use a dark theme for the GUI.");
+    QCommandLineOption singleInstance("single-instance", "Open files in a new window of the already running instance.");
 
     QCommandLineParser parser;
     parser.setApplicationDescription(QCoreApplication::applicationName());
     parser.addOption(noDrm);
     parser.addOption(lightGui);
     parser.addOption(darkGui);
+    parser.addOption(singleInstance);
     parser.addHelpOption();
     parser.addVersionOption();
     parser.addPositionalArgument("file", "The PDF file to open.");
     parser.process(application);
 
+    // In single instance mode, files are opened by the running instance (if it exists)
+    const bool isSingleInstance = parser.isSet(singleInstance);
+    const QString singleInstanceServerName = pdfviewer::PDFSingleInstanceServer::getServerName(QCoreApplication::applicationName());
+    if (isSingleInstance)
+    {
+        QStringList files;
+        for (const QString& fileName : parser.positionalArguments())
+        {
+            files << QFileInfo(fileName).absoluteFilePath();
+        }
+
+        if (pdfviewer::PDFSingleInstanceServer::sendOpenRequest(singleInstanceServerName, files))
+        {
+            return 0;
+        }
+    }
+
     if (parser.isSet(noDrm))
     {
         pdf::PDFSecurityHandler::setNoDRMMode();
@@ -94,6 +115,37 @@ int main(int argc, char *argv[])
     pdfviewer::PDFViewerMainWindow mainWindow;
     mainWindow.show();
 
+    pdfviewer::PDFSingleInstanceServer singleInstanceServer(nullptr);
+    if (isSingleInstance && singleInstanceServer.listen(singleInstanceServerName))
+    {
+        auto openWindow = [](const QString& fileName)
+        {
+            pdfviewer::PDFViewerMainWindow* window = new pdfviewer::PDFViewerMainWindow();
+            window->setAttribute(Qt::WA_DeleteOnClose, true);
+            window->show();
+            window->raise();
+            window->activateWindow();
+
+            if (!fileName.isEmpty())
+            {
+                window->getProgramController()->openDocument(fileName);
+            }
+        };
+
+        QObject::connect(&singleInstanceServer, &pdfviewer::PDFSingleInstanceServer::openRequested, &application, [openWindow](const QStringList& files)
+        {
+            if (files.isEmpty())
+            {
+                openWindow(QString());
+            }
+
+            for (const QString& fileName : files)
+            {
+                openWindow(fileName);
+            }
+        });
+    }
+
     QStringList arguments = parser.positionalArguments();
     if (arguments.size() > 0)
     {
@@ -22,6 +22,8 @@
 
 #include "pdftoolabstractapplication.h"
 #include "pdfconstants.h"
+#include "pdftracing.h"
+#include "pdfoutputformatter.h"
 
 #include <QGuiApplication>
 #include <QCommandLineParser>
@@ -56,9 +58,30 @@ int main(int argc, char *argv[])
 
     application->initializeCommandLineParser(&parser);
 
+    QCommandLineOption traceOption("trace", "Record trace of the command and write it to the file in Chrome trace format (JSON).", "file");
+    parser.addOption(traceOption);
     parser.addHelpOption();
     parser.addVersionOption();
     parser.process(arguments);
 
-    return application->execute(application->getOptions(&parser));
+    const QString traceFileName = parser.value(traceOption);
+    if (!traceFileName.isEmpty())
+    {
+        pdf::PDFTracing::start();
+    }
+
+    const int exitCode = application->execute(application->getOptions(&parser));
+
+    if (!traceFileName.isEmpty())
+    {
+        pdf::PDFTracing::stop();
+
+        pdf::PDFOperationResult result = pdf::PDFTracing::exportChromeTrace(traceFileName);
+        if (!result)
+        {
+            pdftool::PDFConsole::writeError(result.getErrorMessage(), QStringConverter::Utf8);
+        }
+    }
+
+    return exitCode;
 }
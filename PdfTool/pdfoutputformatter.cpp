@@ -640,8 +640,22 @@ QString PDFOutputFormatter::getString() const
     return m_impl->getString();
 }
 
+QMutex s_captureMutex;
+bool s_isCaptureActive = false;
+QByteArray s_capturedOutput;
+QString s_capturedErrors;
+
 void PDFConsole::writeText(QString text, QStringConverter::Encoding encoding)
 {
+    {
+        QMutexLocker lock(&s_captureMutex);
+        if (s_isCaptureActive)
+        {
+            s_capturedOutput += text.toUtf8();
+            return;
+        }
+    }
+
 #ifdef Q_OS_WIN
     HANDLE outputHandle = GetStdHandle(STD_OUTPUT_HANDLE);
     if (!WriteConsoleW(outputHandle, text.utf16(), text.size(), nullptr, nullptr))
@@ -667,6 +681,16 @@ void PDFConsole::writeError(QString text, QStringConverter::Encoding encoding)
         return;
     }
 
+    {
+        QMutexLocker lock(&s_captureMutex);
+        if (s_isCaptureActive)
+        {
+            s_capturedErrors += text;
+            s_capturedErrors += "\n";
+            return;
+        }
+    }
+
     QMutexLocker lock(&s_writeErrorMutex);
 
     text += "\n";
@@ -693,9 +717,36 @@ void PDFConsole::writeData(const QByteArray& data)
 {
     if (!data.isEmpty())
     {
+        {
+            QMutexLocker lock(&s_captureMutex);
+            if (s_isCaptureActive)
+            {
+                s_capturedOutput += data;
+                return;
+            }
+        }
+
         QTextStream stream(stdout);
         stream.device()->write(data);
     }
 }
 
+void PDFConsole::beginCapture()
+{
+    QMutexLocker lock(&s_captureMutex);
+    s_isCaptureActive = true;
+    s_capturedOutput.clear();
+    s_capturedErrors.clear();
+}
+
+void PDFConsole::endCapture(QByteArray& output, QString& errors)
+{
+    QMutexLocker lock(&s_captureMutex);
+    s_isCaptureActive = false;
+    output = std::move(s_capturedOutput);
+    errors = std::move(s_capturedErrors);
+    s_capturedOutput.clear();
+    s_capturedErrors.clear();
+}
+
 }   // pdftool
@@ -111,6 +111,17 @@ public:
     /// Writes binary data to the console
     static void writeData(const QByteArray& data);
 
+    /// Starts capturing of the console output. Until the capture is ended,
+    /// text and data are not written to the console, but they are stored
+    /// (text is encoded in UTF-8), errors are stored separately.
+    static void beginCapture();
+
+    /// Ends capturing of the console output and returns captured
+    /// output and errors.
+    /// \param[out] output Captured text and data
+    /// \param[out] errors Captured errors
+    static void endCapture(QByteArray& output, QString& errors);
+
 private:
     explicit PDFConsole() = delete;
 };
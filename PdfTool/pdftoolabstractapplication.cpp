@@ -21,11 +21,17 @@
 // SOFTWARE.
 
 #include "pdftoolabstractapplication.h"
+#include "pdftoolperformancereport.h"
 #include "pdfdocumentreader.h"
 #include "pdfutils.h"
 
 #include <QFileInfo>
 #include <QCommandLineParser>
+#include <QThread>
+#include <QDateTime>
+#include <QMutex>
+
+#include <list>
 
 namespace pdftool
 {
@@ -173,6 +179,7 @@ void PDFToolAbstractApplication::initializeCommandLineParser(QCommandLineParser*
     if (optionFlags.testFlag(Separate))
     {
         parser->addPositionalArgument("pattern", "Page pattern, must contain '%' character if multiple pages are selected.");
+        parser->addOption(QCommandLineOption("separate-threads", "Number of threads writing single page documents.", "threads", QString::number(QThread::idealThreadCount())));
     }
 
     if (optionFlags.testFlag(Unite))
@@ -183,10 +190,43 @@ void PDFToolAbstractApplication::initializeCommandLineParser(QCommandLineParser*
         parser->addOption(QCommandLineOption("namespace-fields", "Prefix form field names with document index to prevent conflicts when merging forms."));
     }
 
+    if (optionFlags.testFlag(Batch))
+    {
+        parser->addPositionalArgument("jobs", "Job list file, each line contains one command with its arguments. If '-' is used, job list is read from standard input.");
+        parser->addOption(QCommandLineOption("batch-stop-on-error", "Stop processing of the job list, when some job fails."));
+        parser->addOption(QCommandLineOption("document-cache", "Count of recently used documents kept opened between jobs. 0 disables the cache.", "count", "8"));
+    }
+
+    if (optionFlags.testFlag(InkCoverage))
+    {
+        parser->addOption(QCommandLineOption("ink-band-height", "Render pages in horizontal bands of given height (in pixels), so only bitmaps of the band are allocated. 0 means whole page is rendered at once.", "height", "0"));
+        parser->addOption(QCommandLineOption("ink-memory-limit", "Limit of memory (in megabytes) for bitmaps of pages calculated in parallel. 0 means no limit.", "megabytes", "2048"));
+    }
+
+    if (optionFlags.testFlag(Statistics))
+    {
+        parser->addOption(QCommandLineOption("streaming", "Compute statistics in one pass over the reference table, without loading the document (fast for very large files)."));
+        parser->addOption(QCommandLineOption("decode-streams", "Decode streams in streaming mode to compute size of decoded data."));
+    }
+
+    if (optionFlags.testFlag(FetchImages))
+    {
+        parser->addOption(QCommandLineOption("image-passthrough", "Write DCT (JPEG) and JPX (JPEG 2000) images as original data, without decoding."));
+        parser->addOption(QCommandLineOption("image-manifest", "Write manifest (JSON), which maps image placements on pages to files.", "file"));
+    }
+
+    if (optionFlags.testFlag(PerformanceReport))
+    {
+        parser->addOption(QCommandLineOption("perf-report", "Write machine readable performance report (per-page times, instruction counts, peak memory) into a file. JSON format is used for files with 'json' suffix, CSV format otherwise.", "file"));
+    }
+
     if (optionFlags.testFlag(Diff))
     {
         parser->addPositionalArgument("left", "Left (old) document to be compared.");
         parser->addPositionalArgument("right", "Right (new) document to be compared.");
+        parser->addOption(QCommandLineOption("diff-stream", "Stream differences progressively into a file (memory consumption doesn't depend on document size).", "file"));
+        parser->addOption(QCommandLineOption("diff-stream-format", "Format of the streamed differences (ndjson, xml).", "format", "ndjson"));
+        parser->addOption(QCommandLineOption("diff-stream-window", "Number of page pairs compared at once in streaming mode.", "count"));
     }
 
     if (optionFlags.testFlag(Redact))
@@ -195,6 +235,7 @@ void PDFToolAbstractApplication::initializeCommandLineParser(QCommandLineParser*
         parser->addOption(QCommandLineOption("redact-copy-title", "Copy source title into the redacted document."));
         parser->addOption(QCommandLineOption("redact-copy-metadata", "Copy source metadata into the redacted document."));
         parser->addOption(QCommandLineOption("redact-copy-outline", "Copy source outline into the redacted document."));
+        parser->addOption(QCommandLineOption("redact-text", "Redact all text matching the regular expression (in addition to redact annotations).", "regexp"));
     }
 
     if (optionFlags.testFlag(SignatureVerification))
@@ -212,6 +253,7 @@ void PDFToolAbstractApplication::initializeCommandLineParser(QCommandLineParser*
         parser->addOption(QCommandLineOption("xml-export-streams-as-text", "Export streams as text, if possible."));
         parser->addOption(QCommandLineOption("xml-use-indent", "Use automatic indent when writing output xml file."));
         parser->addOption(QCommandLineOption("xml-always-binary", "Do not try to attempt transform strings to text."));
+        parser->addOption(QCommandLineOption("xml-threads", "Number of threads serializing upcoming objects, while current objects are written. 1 means objects are serialized sequentially.", "threads", "1"));
     }
 
     if (optionFlags.testFlag(Attachments))
@@ -251,6 +293,13 @@ void PDFToolAbstractApplication::initializeCommandLineParser(QCommandLineParser*
         parser->addOption(QCommandLineOption("text-show-phoneme", "Show phoneme extracted from structure tree."));
     }
 
+    if (optionFlags.testFlag(TextStream))
+    {
+        parser->addOption(QCommandLineOption("text-ndjson", "Write text as NDJSON (one JSON record per page). Each page is written as soon as it is processed."));
+        parser->addOption(QCommandLineOption("text-ndjson-boxes", "Add bounding boxes of text items to NDJSON records."));
+        parser->addOption(QCommandLineOption("text-ndjson-window", "Maximal number of pages processed at once when writing NDJSON (default is four pages per thread).", "count"));
+    }
+
     if (optionFlags.testFlag(VoiceSelector))
     {
         parser->addOption(QCommandLineOption("voice-name", "Choose voice name for text-to-speech engine.", "name"));
@@ -289,6 +338,9 @@ void PDFToolAbstractApplication::initializeCommandLineParser(QCommandLineParser*
     {
         parser->addOption(QCommandLineOption("image-output-dir", "Output directory, where images are saved.", "dir"));
         parser->addOption(QCommandLineOption("image-template-fn", "Template file name, must contain '%' character, must not contain suffix.", "template file name", "Image_%"));
+        parser->addOption(QCommandLineOption("image-pyramid", "Export pages as tiled image pyramids (valid values are none|dzi|iiif). Template file name is used as base name of the pyramid.", "pyramid", "none"));
+        parser->addOption(QCommandLineOption("image-pyramid-tile-size", "Tile size of image pyramid (in pixels).", "tile size", "256"));
+        parser->addOption(QCommandLineOption("image-pyramid-overlap", "Overlap of adjacent tiles of image pyramid (in pixels, dzi only).", "overlap", "1"));
     }
 
     if (optionFlags.testFlag(ImageExportSettingsResolution))
@@ -326,6 +378,8 @@ void PDFToolAbstractApplication::initializeCommandLineParser(QCommandLineParser*
         parser->addOption(QCommandLineOption("render-show-page-stat", "Show page rendering statistics."));
         parser->addOption(QCommandLineOption("render-msaa-samples", "MSAA sample count for GPU rendering.", "samples", "4"));
         parser->addOption(QCommandLineOption("render-rasterizers", "Number of rasterizer contexts.", "rasterizers", QString::number(pdf::PDFRasterizerPool::getDefaultRasterizerCount())));
+        parser->addOption(QCommandLineOption("render-threads", "Total number of rendering threads, divided between concurrently rendered pages.", "threads", QString::number(pdf::PDFRasterizerPool::getDefaultThreadBudget())));
+        parser->addOption(QCommandLineOption("render-encoders", "Number of threads encoding rendered images, 0 means images are encoded in rendering threads.", "encoders", QString::number(QThread::idealThreadCount())));
     }
 
     if (optionFlags.testFlag(Optimize))
@@ -334,6 +388,13 @@ void PDFToolAbstractApplication::initializeCommandLineParser(QCommandLineParser*
         {
             parser->addOption(QCommandLineOption(info.option, info.description));
         }
+
+        parser->addOption(QCommandLineOption("opt-object-streams", "Pack objects into compressed object streams and write cross-reference stream (requires PDF 1.5)."));
+        parser->addOption(QCommandLineOption("opt-linearize", "Write linearized document, optimized for fast web view (can't be combined with object streams)."));
+        parser->addOption(QCommandLineOption("opt-streaming", "Optimize document without loading it into the memory, objects are processed one by one (for very large documents, can't be combined with linearization, images and fonts are not optimized)."));
+        parser->addOption(QCommandLineOption("opt-image-dpi", "Target resolution of downsampled images (in DPI).", "dpi", QString::number(pdf::PDFOptimizer::ImageSettings().targetResolution)));
+        parser->addOption(QCommandLineOption("opt-image-threshold-dpi", "Only images with higher resolution are downsampled (in DPI).", "dpi", QString::number(pdf::PDFOptimizer::ImageSettings().thresholdResolution)));
+        parser->addOption(QCommandLineOption("opt-image-jpeg-quality", "Quality of JPEG compression of downsampled images (0-100).", "quality", QString::number(pdf::PDFOptimizer::ImageSettings().jpegQuality)));
     }
 
     if (optionFlags.testFlag(CertStore))
@@ -444,11 +505,22 @@ PDFToolOptions PDFToolAbstractApplication::getOptions(QCommandLineParser* parser
         {
             options.redactOptions |= pdf::PDFRedact::CopyOutline;
         }
+
+        options.redactText = parser->isSet("redact-text") ? parser->value("redact-text") : QString();
     }
 
     if (optionFlags.testFlag(Separate))
     {
         options.separatePagePattern = positionalArguments.size() >= 2 ? positionalArguments[1] : QString();
+
+        bool ok = false;
+        QString textValue = parser->value("separate-threads");
+        options.separateThreadCount = textValue.toInt(&ok);
+        if (!ok || options.separateThreadCount <= 0)
+        {
+            options.separateThreadCount = QThread::idealThreadCount();
+            PDFConsole::writeError(PDFToolTranslationContext::tr("Invalid thread count '%1'. %2 threads are used as default.").arg(textValue).arg(options.separateThreadCount), options.outputCodec);
+        }
     }
 
     if (optionFlags.testFlag(SignatureVerification))
@@ -466,6 +538,15 @@ PDFToolOptions PDFToolAbstractApplication::getOptions(QCommandLineParser* parser
         options.xmlExportStreamsAsText = parser->isSet("xml-export-streams-as-text");
         options.xmlUseIndent = parser->isSet("xml-use-indent");
         options.xmlAlwaysBinaryStrings = parser->isSet("xml-always-binary");
+
+        bool ok = false;
+        QString textValue = parser->value("xml-threads");
+        options.xmlThreadCount = textValue.toInt(&ok);
+        if (!ok || options.xmlThreadCount <= 0)
+        {
+            options.xmlThreadCount = 1;
+            PDFConsole::writeError(PDFToolTranslationContext::tr("Invalid thread count '%1'. Objects are serialized sequentially.").arg(textValue), options.outputCodec);
+        }
     }
 
     if (optionFlags.testFlag(Attachments))
@@ -525,6 +606,24 @@ PDFToolOptions PDFToolAbstractApplication::getOptions(QCommandLineParser* parser
         options.textShowStructPhoneme = parser->isSet("text-show-phoneme");
     }
 
+    if (optionFlags.testFlag(TextStream))
+    {
+        options.textStreamNDJSON = parser->isSet("text-ndjson");
+        options.textStreamBoundingBoxes = parser->isSet("text-ndjson-boxes");
+
+        if (parser->isSet("text-ndjson-window"))
+        {
+            bool ok = false;
+            options.textStreamWindow = parser->value("text-ndjson-window").toInt(&ok);
+
+            if (!ok || options.textStreamWindow <= 0)
+            {
+                PDFConsole::writeError(PDFToolTranslationContext::tr("Invalid NDJSON window size '%1'. Defaulting to automatic window size.").arg(parser->value("text-ndjson-window")), options.outputCodec);
+                options.textStreamWindow = 0;
+            }
+        }
+    }
+
     if (optionFlags.testFlag(VoiceSelector))
     {
         options.textVoiceName = parser->isSet("voice-name") ? parser->value("voice-name") : QString();
@@ -670,6 +769,48 @@ PDFToolOptions PDFToolAbstractApplication::getOptions(QCommandLineParser* parser
 
         options.imageExportSettings.setDirectory(outputDir);
         options.imageExportSettings.setFileTemplate(parser->value("image-template-fn"));
+
+        QString pyramid = parser->value("image-pyramid").toLower();
+        if (pyramid == "none")
+        {
+            options.imageExportSettings.setPyramidMode(pdf::PDFPageImageExportSettings::PyramidMode::None);
+        }
+        else if (pyramid == "dzi")
+        {
+            options.imageExportSettings.setPyramidMode(pdf::PDFPageImageExportSettings::PyramidMode::DeepZoom);
+        }
+        else if (pyramid == "iiif")
+        {
+            options.imageExportSettings.setPyramidMode(pdf::PDFPageImageExportSettings::PyramidMode::IIIF);
+        }
+        else
+        {
+            PDFConsole::writeError(PDFToolTranslationContext::tr("Invalid image pyramid '%1'. Defaulting to none.").arg(pyramid), options.outputCodec);
+            options.imageExportSettings.setPyramidMode(pdf::PDFPageImageExportSettings::PyramidMode::None);
+        }
+
+        QString tileSizeText = parser->value("image-pyramid-tile-size");
+        bool ok = false;
+        int tileSize = tileSizeText.toInt(&ok);
+        if (ok)
+        {
+            options.imageExportSettings.setPyramidTileSize(tileSize);
+        }
+        else
+        {
+            PDFConsole::writeError(PDFToolTranslationContext::tr("Cannot read image pyramid tile size from text '%1'. Defaulting to %2.").arg(tileSizeText).arg(options.imageExportSettings.getPyramidTileSize()), options.outputCodec);
+        }
+
+        QString overlapText = parser->value("image-pyramid-overlap");
+        int overlap = overlapText.toInt(&ok);
+        if (ok)
+        {
+            options.imageExportSettings.setPyramidOverlap(overlap);
+        }
+        else
+        {
+            PDFConsole::writeError(PDFToolTranslationContext::tr("Cannot read image pyramid overlap from text '%1'. Defaulting to %2.").arg(overlapText).arg(options.imageExportSettings.getPyramidOverlap()), options.outputCodec);
+        }
     }
 
     if (optionFlags.testFlag(ImageExportSettingsResolution))
@@ -918,6 +1059,22 @@ PDFToolOptions PDFToolAbstractApplication::getOptions(QCommandLineParser* parser
             options.renderRasterizerCount = correctedRasterizerCount;
         }
 
+        textValue = parser->value("render-threads");
+        options.renderThreadBudget = textValue.toInt(&ok);
+        if (!ok || options.renderThreadBudget <= 0)
+        {
+            options.renderThreadBudget = pdf::PDFRasterizerPool::getDefaultThreadBudget();
+            PDFConsole::writeError(PDFToolTranslationContext::tr("Invalid thread count '%1'. %2 threads are used as default.").arg(textValue).arg(options.renderThreadBudget), options.outputCodec);
+        }
+
+        textValue = parser->value("render-encoders");
+        options.renderEncoderCount = textValue.toInt(&ok);
+        if (!ok || options.renderEncoderCount < 0)
+        {
+            options.renderEncoderCount = QThread::idealThreadCount();
+            PDFConsole::writeError(PDFToolTranslationContext::tr("Invalid encoder count '%1'. %2 encoders are used as default.").arg(textValue).arg(options.renderEncoderCount), options.outputCodec);
+        }
+
         options.renderShowPageStatistics = parser->isSet("render-show-page-stat");
     }
 
@@ -928,9 +1085,80 @@ PDFToolOptions PDFToolAbstractApplication::getOptions(QCommandLineParser* parser
         options.namespaceFields = parser->isSet("namespace-fields");
     }
 
+    if (optionFlags.testFlag(Batch))
+    {
+        options.batchJobList = !positionalArguments.isEmpty() ? positionalArguments.front() : QString();
+        options.batchStopOnError = parser->isSet("batch-stop-on-error");
+
+        bool ok = false;
+        options.batchDocumentCacheSize = parser->value("document-cache").toInt(&ok);
+        if (!ok || options.batchDocumentCacheSize < 0)
+        {
+            PDFConsole::writeError(PDFToolTranslationContext::tr("Invalid document cache size '%1'.").arg(parser->value("document-cache")), options.outputCodec);
+            options.batchDocumentCacheSize = 0;
+        }
+    }
+
+    if (optionFlags.testFlag(InkCoverage))
+    {
+        bool ok = false;
+        QString textValue = parser->value("ink-band-height");
+        options.inkCoverageBandHeight = textValue.toInt(&ok);
+        if (!ok || options.inkCoverageBandHeight < 0)
+        {
+            options.inkCoverageBandHeight = 0;
+            PDFConsole::writeError(PDFToolTranslationContext::tr("Invalid band height '%1'. Pages are rendered at once.").arg(textValue), options.outputCodec);
+        }
+
+        textValue = parser->value("ink-memory-limit");
+        options.inkCoverageMemoryLimit = textValue.toLongLong(&ok);
+        if (!ok || options.inkCoverageMemoryLimit < 0)
+        {
+            options.inkCoverageMemoryLimit = 2048;
+            PDFConsole::writeError(PDFToolTranslationContext::tr("Invalid memory limit '%1'. %2 MB is used as default.").arg(textValue).arg(options.inkCoverageMemoryLimit), options.outputCodec);
+        }
+    }
+
+    if (optionFlags.testFlag(Statistics))
+    {
+        options.statisticsStreaming = parser->isSet("streaming");
+        options.statisticsDecodeStreams = parser->isSet("decode-streams");
+    }
+
+    if (optionFlags.testFlag(FetchImages))
+    {
+        options.fetchImagesWriteOriginalData = parser->isSet("image-passthrough");
+        options.fetchImagesManifestFile = parser->value("image-manifest");
+    }
+
+    if (optionFlags.testFlag(PerformanceReport))
+    {
+        options.performanceReportFile = parser->isSet("perf-report") ? parser->value("perf-report") : QString();
+    }
+
     if (optionFlags.testFlag(Diff))
     {
         options.diffFiles = positionalArguments;
+        options.diffStreamFile = parser->isSet("diff-stream") ? parser->value("diff-stream") : QString();
+        options.diffStreamFormat = parser->value("diff-stream-format").toLower();
+
+        if (options.diffStreamFormat != "ndjson" && options.diffStreamFormat != "xml")
+        {
+            PDFConsole::writeError(PDFToolTranslationContext::tr("Unknown difference stream format '%1'. Defaulting to NDJSON.").arg(options.diffStreamFormat), options.outputCodec);
+            options.diffStreamFormat = "ndjson";
+        }
+
+        if (parser->isSet("diff-stream-window"))
+        {
+            bool ok = false;
+            options.diffStreamWindow = parser->value("diff-stream-window").toInt(&ok);
+
+            if (!ok || options.diffStreamWindow <= 0)
+            {
+                PDFConsole::writeError(PDFToolTranslationContext::tr("Invalid difference stream window size '%1'. Defaulting to default window size.").arg(parser->value("diff-stream-window")), options.outputCodec);
+                options.diffStreamWindow = 0;
+            }
+        }
     }
 
     if (optionFlags.testFlag(Optimize))
@@ -943,6 +1171,41 @@ PDFToolOptions PDFToolAbstractApplication::getOptions(QCommandLineParser* parser
                 options.optimizeFlags |= info.flag;
             }
         }
+
+        options.optimizeObjectStreams = parser->isSet("opt-object-streams");
+        options.optimizeLinearize = parser->isSet("opt-linearize");
+        options.optimizeStreaming = parser->isSet("opt-streaming");
+
+        bool ok = false;
+        pdf::PDFReal targetResolution = parser->value("opt-image-dpi").toDouble(&ok);
+        if (ok && targetResolution > 0.0)
+        {
+            options.optimizeImageSettings.targetResolution = targetResolution;
+        }
+        else
+        {
+            PDFConsole::writeError(PDFToolTranslationContext::tr("Invalid target image resolution '%1'.").arg(parser->value("opt-image-dpi")), options.outputCodec);
+        }
+
+        pdf::PDFReal thresholdResolution = parser->value("opt-image-threshold-dpi").toDouble(&ok);
+        if (ok && thresholdResolution > 0.0)
+        {
+            options.optimizeImageSettings.thresholdResolution = thresholdResolution;
+        }
+        else
+        {
+            PDFConsole::writeError(PDFToolTranslationContext::tr("Invalid threshold image resolution '%1'.").arg(parser->value("opt-image-threshold-dpi")), options.outputCodec);
+        }
+
+        int jpegQuality = parser->value("opt-image-jpeg-quality").toInt(&ok);
+        if (ok && jpegQuality >= 0 && jpegQuality <= 100)
+        {
+            options.optimizeImageSettings.jpegQuality = jpegQuality;
+        }
+        else
+        {
+            PDFConsole::writeError(PDFToolTranslationContext::tr("Invalid JPEG quality '%1'. Quality must be in range 0-100.").arg(parser->value("opt-image-jpeg-quality")), options.outputCodec);
+        }
     }
 
     if (optionFlags.testFlag(CertStore))
@@ -1032,8 +1295,119 @@ QString PDFToolAbstractApplication::convertDateTimeToString(const QDateTime& dat
     return QLocale::system().toString(dateTime, QLocale::ShortFormat);
 }
 
+/// Cache of recently read documents. Document is identified by its file name,
+/// size and last modification time, and by options, which affect the reading.
+class PDFToolDocumentCache
+{
+public:
+    struct Entry
+    {
+        QString fileName;
+        qint64 fileSize = 0;
+        QDateTime lastModified;
+        QString password;
+        bool permissiveReading = false;
+        bool authorizeOwnerOnly = false;
+        pdf::PDFDocument document;
+        QByteArray sourceData;
+    };
+
+    static PDFToolDocumentCache* getInstance()
+    {
+        static PDFToolDocumentCache instance;
+        return &instance;
+    }
+
+    void setMaximalSize(int maximalSize)
+    {
+        QMutexLocker lock(&m_mutex);
+        m_maximalSize = maximalSize;
+        trim();
+    }
+
+    bool isEnabled() const
+    {
+        QMutexLocker lock(&m_mutex);
+        return m_maximalSize > 0;
+    }
+
+    /// Finds entry with same file and reading options and moves it to
+    /// the front of the cache. Returns true, if entry is found.
+    bool find(Entry& entry)
+    {
+        QMutexLocker lock(&m_mutex);
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it)
+        {
+            if (it->fileName == entry.fileName &&
+                it->fileSize == entry.fileSize &&
+                it->lastModified == entry.lastModified &&
+                it->password == entry.password &&
+                it->permissiveReading == entry.permissiveReading &&
+                it->authorizeOwnerOnly == entry.authorizeOwnerOnly)
+            {
+                m_entries.splice(m_entries.begin(), m_entries, it);
+                entry = m_entries.front();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void insert(Entry entry)
+    {
+        QMutexLocker lock(&m_mutex);
+        m_entries.remove_if([&entry](const Entry& item) { return item.fileName == entry.fileName && item.authorizeOwnerOnly == entry.authorizeOwnerOnly; });
+        m_entries.push_front(std::move(entry));
+        trim();
+    }
+
+private:
+    void trim()
+    {
+        while (m_entries.size() > size_t(qMax(m_maximalSize, 0)))
+        {
+            m_entries.pop_back();
+        }
+    }
+
+    mutable QMutex m_mutex;
+    int m_maximalSize = 0;
+    std::list<Entry> m_entries;
+};
+
+void PDFToolAbstractApplication::setDocumentCacheSize(int documentCacheSize)
+{
+    PDFToolDocumentCache::getInstance()->setMaximalSize(documentCacheSize);
+}
+
 bool PDFToolAbstractApplication::readDocument(const PDFToolOptions& options, pdf::PDFDocument& document, QByteArray* sourceData, bool authorizeOwnerOnly)
 {
+    PDFToolDocumentCache* cache = PDFToolDocumentCache::getInstance();
+    const bool isCacheEnabled = cache->isEnabled();
+
+    PDFToolDocumentCache::Entry cacheEntry;
+    if (isCacheEnabled)
+    {
+        QFileInfo fileInfo(options.document);
+        cacheEntry.fileName = fileInfo.absoluteFilePath();
+        cacheEntry.fileSize = fileInfo.size();
+        cacheEntry.lastModified = fileInfo.lastModified();
+        cacheEntry.password = options.password;
+        cacheEntry.permissiveReading = options.permissiveReading;
+        cacheEntry.authorizeOwnerOnly = authorizeOwnerOnly;
+
+        if (cache->find(cacheEntry))
+        {
+            document = cacheEntry.document;
+            if (sourceData)
+            {
+                *sourceData = cacheEntry.sourceData;
+            }
+            return true;
+        }
+    }
+
     bool isFirstPasswordAttempt = true;
     auto passwordCallback = [&options, &isFirstPasswordAttempt](bool* ok) -> QString
     {
@@ -1052,6 +1426,14 @@ bool PDFToolAbstractApplication::readDocument(const PDFToolOptions& options, pdf
             {
                 *sourceData = reader.getSource();
             }
+
+            if (isCacheEnabled)
+            {
+                // Source data of memory mapped file remain valid, as long as the document exists
+                cacheEntry.document = document;
+                cacheEntry.sourceData = reader.getSource();
+                cache->insert(std::move(cacheEntry));
+            }
             break;
         }
 
@@ -1082,6 +1464,20 @@ bool PDFToolAbstractApplication::readDocument(const PDFToolOptions& options, pdf
     return true;
 }
 
+void PDFToolAbstractApplication::writePerformanceReport(const PDFToolOptions& options, PDFToolPerformanceReport& report) const
+{
+    if (options.performanceReportFile.isEmpty())
+    {
+        return;
+    }
+
+    QString errorMessage;
+    if (!report.write(options.performanceReportFile, &errorMessage))
+    {
+        PDFConsole::writeError(errorMessage, options.outputCodec);
+    }
+}
+
 QList<QByteArray> PDFToolAbstractApplication::getAvailableEncodings()
 {
     QList<QByteArray> encodings;
@@ -1212,6 +1608,7 @@ std::vector<PDFToolOptions::RenderFeatureInfo> PDFToolOptions::getRenderFeatures
         RenderFeatureInfo{ "render-high-contrast", "Color conversion: high contrast colors", pdf::PDFRenderer::ColorAdjust_HighContrast },
         RenderFeatureInfo{ "render-bitonal", "Color conversion: bitonal page image", pdf::PDFRenderer::ColorAdjust_Bitonal },
         RenderFeatureInfo{ "render-custom-colors", "Color conversion: custom colors", pdf::PDFRenderer::ColorAdjust_CustomColors },
+        RenderFeatureInfo{ "render-color-post-process", "Color conversion: adjust colors of rendered page image", pdf::PDFRenderer::ColorAdjust_PostProcess },
         RenderFeatureInfo{ "render-display-annot", "Display annotations.", pdf::PDFRenderer::DisplayAnnotations }
     };
 }
@@ -1225,7 +1622,9 @@ std::vector<PDFToolOptions::OptimizeFeatureInfo> PDFToolOptions::getOptimizeFlag
         OptimizeFeatureInfo{ "opt-merge-identical", "Merge identical objects.", pdf::PDFOptimizer::MergeIdenticalObjects },
         OptimizeFeatureInfo{ "opt-shrink-storage", "Shrink object storage by renumbering objects.", pdf::PDFOptimizer::ShrinkObjectStorage },
         OptimizeFeatureInfo{ "opt-recompress-flate", "Recompress flate streams with maximal compression.", pdf::PDFOptimizer::RecompressFlateStreams },
-        OptimizeFeatureInfo{ "opt-all", "Use all optimization algorithms.", pdf::PDFOptimizer::All }
+        OptimizeFeatureInfo{ "opt-downsample-images", "Downsample images with too high resolution and recompress them (lossy).", pdf::PDFOptimizer::DownsampleImages },
+        OptimizeFeatureInfo{ "opt-subset-fonts", "Subset embedded TrueType and CID-keyed CFF fonts to used glyphs.", pdf::PDFOptimizer::SubsetFonts },
+        OptimizeFeatureInfo{ "opt-all", "Use all lossless optimization algorithms.", pdf::PDFOptimizer::All }
     };
 }
 
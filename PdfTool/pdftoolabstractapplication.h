@@ -44,6 +44,7 @@ class QCommandLineParser;
 
 namespace pdftool
 {
+class PDFToolPerformanceReport;
 
 struct PDFToolTranslationContext
 {
@@ -84,6 +85,7 @@ struct PDFToolOptions
     bool xmlExportStreamsAsText = false;
     bool xmlUseIndent = false;
     bool xmlAlwaysBinaryStrings = false;
+    int xmlThreadCount = 1;     ///< Count of threads serializing upcoming objects (1 means objects are serialized sequentially)
 
     // For option 'Attachments'
     QString attachmentsSaveNumber;
@@ -112,6 +114,11 @@ struct PDFToolOptions
     bool textShowStructActualText = false;
     bool textShowStructPhoneme = false;
 
+    // For option 'TextStream'
+    bool textStreamNDJSON = false;
+    bool textStreamBoundingBoxes = false;
+    int textStreamWindow = 0;
+
     // For option 'VoiceSelector'
     QString textVoiceName;
     QString textVoiceGender;
@@ -145,9 +152,12 @@ struct PDFToolOptions
     bool renderShowPageStatistics = false;
     int renderMSAAsamples = 4;
     int renderRasterizerCount = pdf::PDFRasterizerPool::getDefaultRasterizerCount();
+    int renderThreadBudget = pdf::PDFRasterizerPool::getDefaultThreadBudget();
+    int renderEncoderCount = 0; ///< Count of image encoder threads (0 means images are encoded in rendering threads)
 
     // For option 'Separate'
     QString separatePagePattern;
+    int separateThreadCount = 1;    ///< Count of threads writing output documents
 
     // For option 'Unite'
     QStringList uniteFiles;
@@ -156,9 +166,16 @@ struct PDFToolOptions
 
     // For option 'Diff'
     QStringList diffFiles;
+    QString diffStreamFile;
+    QString diffStreamFormat = "ndjson";
+    int diffStreamWindow = 0;
 
     // For option 'Optimize'
     pdf::PDFOptimizer::OptimizationFlags optimizeFlags = pdf::PDFOptimizer::None;
+    bool optimizeObjectStreams = false;
+    bool optimizeLinearize = false;
+    bool optimizeStreaming = false;
+    pdf::PDFOptimizer::ImageSettings optimizeImageSettings;
 
     // For option 'CertStore'
     bool certStoreEnumerateSystemCertificates = false;
@@ -170,6 +187,7 @@ struct PDFToolOptions
     // For option 'Redact'
     pdf::PDFRedact::Options redactOptions = {};
     QString redactedDocument;
+    QString redactText;
 
     // For option 'Encrypt'
     pdf::PDFSecurityHandlerFactory::Algorithm encryptionAlgorithm = pdf::PDFSecurityHandlerFactory::Algorithm::AES_256;
@@ -178,6 +196,26 @@ struct PDFToolOptions
     QString encryptionOwnerPassword;
     uint32_t encryptionPermissions = 0;
 
+    // For option 'Batch'
+    QString batchJobList;
+    bool batchStopOnError = false;
+    int batchDocumentCacheSize = 8;
+
+    // For option 'PerformanceReport'
+    QString performanceReportFile;
+
+    // For option 'InkCoverage'
+    int inkCoverageBandHeight = 0;
+    qint64 inkCoverageMemoryLimit = 2048;   ///< Memory limit for page bitmaps in megabytes (0 means no limit)
+
+    // For option 'Statistics'
+    bool statisticsStreaming = false;
+    bool statisticsDecodeStreams = false;
+
+    // For option 'FetchImages'
+    bool fetchImagesWriteOriginalData = false;
+    QString fetchImagesManifestFile;
+
     /// Returns page range. If page range is invalid, then \p errorMessage is empty.
     /// \param pageCount Page count
     /// \param[out] errorMessage Error message
@@ -265,6 +303,12 @@ public:
         Encrypt                         = 0x00800000,       ///< Encryption settings
         Diff                            = 0x01000000,       ///< Diff settings (compare documents)
         Redact                          = 0x02000000,       ///< Settings for Redact tool
+        TextStream                      = 0x04000000,       ///< Streaming text output options
+        Batch                           = 0x08000000,       ///< Settings for batch processing
+        PerformanceReport               = 0x10000000,       ///< Machine readable performance report
+        Statistics                      = 0x20000000,       ///< Settings for object statistics
+        InkCoverage                     = 0x40000000,       ///< Settings for ink coverage calculation
+        FetchImages                     = 0x80000000,       ///< Settings for fetching images
     };
     Q_DECLARE_FLAGS(Options, Option)
 
@@ -277,6 +321,13 @@ public:
 
     static QString convertDateTimeToString(const QDateTime& dateTime, PDFToolOptions::DateFormat dateFormat);
 
+    /// Sets maximal count of documents kept in the document cache. Documents
+    /// read by \p readDocument are kept in the cache (least recently used documents
+    /// are removed first), so when the same unmodified file is read again, it is
+    /// not parsed again. Zero disables the cache (default).
+    /// \param documentCacheSize Maximal count of cached documents
+    static void setDocumentCacheSize(int documentCacheSize);
+
 protected:
     /// Tries to read the document. If document is successfully read, true is returned,
     /// if error occurs, then false is returned. Optionally, original document content
@@ -287,6 +338,12 @@ protected:
     /// \param authorizeOwnerOnly Require to authorize as owner
     bool readDocument(const PDFToolOptions& options, pdf::PDFDocument& document, QByteArray* sourceData, bool authorizeOwnerOnly);
 
+    /// Writes performance report to the file specified in options, if performance
+    /// report was requested. Errors are written to the error console.
+    /// \param options Options
+    /// \param report Performance report
+    void writePerformanceReport(const PDFToolOptions& options, PDFToolPerformanceReport& report) const;
+
     /// Returns a list of available encodings
     static QList<QByteArray> getAvailableEncodings();
 
@@ -22,8 +22,11 @@
 
 #include "pdftoolattachments.h"
 #include "pdfexception.h"
+#include "pdfexecutionpolicy.h"
+#include "pdfutils.h"
 
 #include <QFile>
+#include <QMutex>
 #include <QMimeDatabase>
 
 namespace pdftool
@@ -162,13 +165,24 @@ int PDFToolAttachmentsApplication::execute(const PDFToolOptions& options)
             return ErrorInvalidArguments;
         }
 
+        std::vector<const FileInfo*> savedFiles;
         for (const FileInfo& info : embeddedFiles)
         {
-            if (!info.isSaved)
+            if (info.isSaved)
             {
-                // This file is not marked to be saved
-                continue;
+                savedFiles.push_back(&info);
             }
+        }
+
+        QMutex errorMutex;
+        QStringList errors;
+
+        // Attachments are decoded and written concurrently. Decoded data are
+        // streamed to the file in chunks, so the whole decoded attachment
+        // is never held in the memory.
+        auto saveFile = [&](size_t index)
+        {
+            const FileInfo& info = *savedFiles[index];
 
             QString outputFile = info.fileName;
             if (!options.attachmentsTargetFile.isEmpty())
@@ -181,27 +195,59 @@ int PDFToolAttachmentsApplication::execute(const PDFToolOptions& options)
                 outputFile = QString("%1/%2").arg(options.attachmentsOutputDirectory, outputFile);
             }
 
-            try
+            QString errorMessage;
+            QFile file(outputFile);
+            if (file.open(QFile::WriteOnly | QFile::Truncate))
             {
-                QByteArray data = document.getDecodedStream(info.specification->getPlatformFile()->getStream());
-
-                QFile file(outputFile);
-                if (file.open(QFile::WriteOnly | QFile::Truncate))
+                try
                 {
-                    file.write(data);
-                    file.close();
+                    pdf::PDFStreamReaderPointer reader = document.createDecodedStreamReader(info.specification->getPlatformFile()->getStream());
+
+                    QByteArray buffer(65536, Qt::Uninitialized);
+                    while (qint64 readBytes = reader->read(buffer.data(), buffer.size()))
+                    {
+                        if (file.write(buffer.constData(), readBytes) != readBytes)
+                        {
+                            errorMessage = file.errorString();
+                            break;
+                        }
+                    }
                 }
-                else
+                catch (const pdf::PDFException &e)
+                {
+                    errorMessage = e.getMessage();
+                }
+
+                file.close();
+
+                if (!errorMessage.isEmpty())
                 {
-                    PDFConsole::writeError(PDFToolTranslationContext::tr("Failed to save attachment to file. %1").arg(file.errorString()), options.outputCodec);
-                    return ErrorFailedWriteToFile;
+                    // Do not leave incomplete attachment on the disk
+                    file.remove();
                 }
             }
-            catch (const pdf::PDFException &e)
+            else
+            {
+                errorMessage = file.errorString();
+            }
+
+            if (!errorMessage.isEmpty())
+            {
+                QMutexLocker lock(&errorMutex);
+                errors << PDFToolTranslationContext::tr("Failed to save attachment to file. %1").arg(errorMessage);
+            }
+        };
+
+        auto range = pdf::PDFIntegerRange<size_t>(0, savedFiles.size());
+        pdf::PDFExecutionPolicy::execute(pdf::PDFExecutionPolicy::Scope::Unknown, range.begin(), range.end(), saveFile);
+
+        if (!errors.isEmpty())
+        {
+            for (const QString& error : errors)
             {
-                PDFConsole::writeError(PDFToolTranslationContext::tr("Failed to save attachment to file. %1").arg(e.getMessage()), options.outputCodec);
-                return ErrorFailedWriteToFile;
+                PDFConsole::writeError(error, options.outputCodec);
             }
+            return ErrorFailedWriteToFile;
         }
     }
 
@@ -21,6 +21,7 @@
 // SOFTWARE.
 
 #include "pdftoolaudiobook.h"
+#include "pdfspeechsynthesispipeline.h"
 
 #ifdef Q_OS_WIN
 
@@ -363,14 +364,13 @@ int PDFToolAudioBook::getDocumentTextFlow(const PDFToolOptions& options, pdf::PD
 
 int PDFToolAudioBook::createAudioBook(const PDFToolOptions& options, pdf::PDFDocumentTextFlow& flow)
 {
-    QString audioString;
-    QTextStream textStream(&audioString);
+    QStringList paragraphs;
 
     for (const pdf::PDFDocumentTextFlow::Item& item : flow.getItems())
     {
         if (item.flags.testFlag(pdf::PDFDocumentTextFlow::PageStart) && options.textSpeechMarkPageNumbers)
         {
-            textStream << QString("<bookmark mark=\"%1\"/>").arg(item.text) << Qt::endl;
+            paragraphs << QString("<bookmark mark=\"%1\"/>").arg(item.text);
         }
 
         if (!item.text.isEmpty())
@@ -385,7 +385,7 @@ int PDFToolAudioBook::createAudioBook(const PDFToolOptions& options, pdf::PDFDoc
 
             if (showText)
             {
-                textStream << item.text << Qt::endl;
+                paragraphs << item.text;
             }
         }
     }
@@ -406,47 +406,95 @@ int PDFToolAudioBook::createAudioBook(const PDFToolOptions& options, pdf::PDFDoc
         return ErrorSAPI;
     }
 
+    // Chunks are synthesized in worker threads, so we use the voice
+    // token identifier instead of the token (COM objects can't be shared
+    // between threads without marshalling).
+    QString voiceTokenId;
+    LPWSTR voiceTokenIdString = nullptr;
+    if (SUCCEEDED(voices.front().getVoiceToken()->GetId(&voiceTokenIdString)))
+    {
+        voiceTokenId = QString::fromWCharArray(voiceTokenIdString);
+        ::CoTaskMemFree(voiceTokenIdString);
+    }
+    voices.clear();
+
     QFileInfo info(options.document);
     QString outputFile = QString("%1/%2.%3").arg(info.path(), info.completeBaseName(), options.textSpeechAudioFormat);
-    BSTR outputFileName = (BSTR)outputFile.utf16();
 
-    ISpeechFileStream* stream = nullptr;
-    if (!SUCCEEDED(::CoCreateInstance(CLSID_SpFileStream, NULL, CLSCTX_ALL, __uuidof(ISpeechFileStream), (LPVOID*)&stream)))
+    auto synthesize = [&voiceTokenId](const QString& text, const QString& waveFileName) -> pdf::PDFOperationResult
     {
-        PDFConsole::writeError(PDFToolTranslationContext::tr("Cannot create output stream '%1'.").arg(outputFile), options.outputCodec);
-        return ErrorSAPI;
-    }
+        const bool isComInitialized = SUCCEEDED(::CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+        pdf::PDFOperationResult result = true;
 
-    ISpVoice* voice = nullptr;
-    if (!SUCCEEDED(::CoCreateInstance(CLSID_SpVoice, NULL, CLSCTX_ALL, __uuidof(ISpVoice), (LPVOID*)&voice)))
-    {
-        PDFConsole::writeError(PDFToolTranslationContext::tr("Cannot create voice."), options.outputCodec);
-        stream->Release();
-        return ErrorSAPI;
-    }
+        ISpObjectToken* token = nullptr;
+        ISpeechFileStream* stream = nullptr;
+        ISpVoice* voice = nullptr;
 
-    if (!SUCCEEDED(stream->Open(outputFileName, SSFMCreateForWrite)))
-    {
-        PDFConsole::writeError(PDFToolTranslationContext::tr("Cannot create output stream '%1'.").arg(outputFile), options.outputCodec);
-        voice->Release();
-        stream->Release();
-        return ErrorSAPI;
-    }
+        if (!SUCCEEDED(::CoCreateInstance(CLSID_SpFileStream, NULL, CLSCTX_ALL, __uuidof(ISpeechFileStream), (LPVOID*)&stream)) ||
+            !SUCCEEDED(stream->Open((BSTR)waveFileName.utf16(), SSFMCreateForWrite)))
+        {
+            result = PDFToolTranslationContext::tr("Cannot create output stream '%1'.").arg(waveFileName);
+        }
+        else if (!SUCCEEDED(::CoCreateInstance(CLSID_SpVoice, NULL, CLSCTX_ALL, __uuidof(ISpVoice), (LPVOID*)&voice)))
+        {
+            result = PDFToolTranslationContext::tr("Cannot create voice.");
+        }
+        else
+        {
+            // If voice can't be set, default voice is used
+            if (!voiceTokenId.isEmpty() &&
+                SUCCEEDED(::CoCreateInstance(CLSID_SpObjectToken, NULL, CLSCTX_ALL, __uuidof(ISpObjectToken), (LPVOID*)&token)) &&
+                SUCCEEDED(token->SetId(NULL, (LPCWSTR)voiceTokenId.utf16(), FALSE)))
+            {
+                voice->SetVoice(token);
+            }
 
-    ISpObjectToken* voiceToken = voices.front().getVoiceToken();
-    if (!SUCCEEDED(voice->SetVoice(voiceToken)))
-    {
-        PDFConsole::writeError(PDFToolTranslationContext::tr("Failed to set requested voice. Default voice will be used."), options.outputCodec);
-    }
-    voices.clear();
+            voice->SetOutput(stream, FALSE);
+            if (!SUCCEEDED(voice->Speak((LPCWSTR)text.utf16(), SPF_PURGEBEFORESPEAK | SPF_PARSE_SAPI, NULL)))
+            {
+                result = PDFToolTranslationContext::tr("Speech synthesis failed.");
+            }
+        }
+
+        if (voice)
+        {
+            voice->Release();
+        }
+
+        if (stream)
+        {
+            stream->Close();
+            stream->Release();
+        }
+
+        if (token)
+        {
+            token->Release();
+        }
+
+        if (isComInitialized)
+        {
+            ::CoUninitialize();
+        }
 
-    LPCWSTR stringToSpeak = (LPCWSTR)audioString.utf16();
+        return result;
+    };
 
-    voice->SetOutput(stream, FALSE);
-    voice->Speak(stringToSpeak, SPF_PURGEBEFORESPEAK | SPF_PARSE_SAPI, NULL);
+    pdf::PDFSpeechSynthesisPipeline::Settings settings;
+    settings.voiceKey = voiceTokenId.toUtf8();
+    const QStringList chunks = pdf::PDFSpeechSynthesisPipeline::createChunks(paragraphs, settings.maximalChunkLength);
+
+    pdf::PDFSpeechSynthesisPipeline pipeline(qMove(settings));
+    pdf::PDFOperationResult result = pipeline.execute(chunks, outputFile, synthesize);
+
+    if (!result)
+    {
+        PDFConsole::writeError(result.getErrorMessage(), options.outputCodec);
+        return ErrorSAPI;
+    }
 
-    voice->Release();
-    stream->Release();
+    const pdf::PDFSpeechSynthesisPipeline::Statistics& statistics = pipeline.getStatistics();
+    PDFConsole::writeText(PDFToolTranslationContext::tr("Audio book '%1' created from %2 chunks (%3 synthesized, %4 cached).\n").arg(outputFile).arg(statistics.chunkCount).arg(statistics.synthesizedChunkCount).arg(statistics.cachedChunkCount), options.outputCodec);
 
     return ExitSuccess;
 }
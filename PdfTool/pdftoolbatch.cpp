@@ -0,0 +1,195 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+// Optimizations by Opus (Claude AI) - January 2026
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+
+#include "pdftoolbatch.h"
+
+#include <QFile>
+#include <QProcess>
+#include <QElapsedTimer>
+#include <QCommandLineParser>
+
+#include <cstdio>
+
+namespace pdftool
+{
+
+static PDFToolBatch s_toolBatchApplication;
+
+QString PDFToolBatch::getStandardString(PDFToolAbstractApplication::StandardString standardString) const
+{
+    switch (standardString)
+    {
+        case Command:
+            return "batch";
+
+        case Name:
+            return PDFToolTranslationContext::tr("Batch processing");
+
+        case Description:
+            return PDFToolTranslationContext::tr("Execute commands from the job list (one command per line) in a single process.");
+
+        default:
+            Q_ASSERT(false);
+            break;
+    }
+
+    return QString();
+}
+
+PDFToolAbstractApplication::Options PDFToolBatch::getOptionsFlags() const
+{
+    return ConsoleFormat | Batch;
+}
+
+int PDFToolBatch::execute(const PDFToolOptions& options)
+{
+    if (options.batchJobList.isEmpty())
+    {
+        PDFConsole::writeError(PDFToolTranslationContext::tr("Job list is not specified."), options.outputCodec);
+        return ErrorInvalidArguments;
+    }
+
+    QFile file;
+    bool isOpened = false;
+    if (options.batchJobList == "-")
+    {
+        isOpened = file.open(stdin, QFile::ReadOnly | QFile::Text);
+    }
+    else
+    {
+        file.setFileName(options.batchJobList);
+        isOpened = file.open(QFile::ReadOnly | QFile::Text);
+    }
+
+    if (!isOpened)
+    {
+        PDFConsole::writeError(PDFToolTranslationContext::tr("Cannot open job list '%1'. %2").arg(options.batchJobList, file.errorString()), options.outputCodec);
+        return ErrorInvalidArguments;
+    }
+
+    setDocumentCacheSize(options.batchDocumentCacheSize);
+
+    PDFOutputFormatter formatter(options.outputStyle);
+    formatter.beginDocument("batch", PDFToolTranslationContext::tr("Batch processing of job list %1").arg(options.batchJobList));
+    formatter.endl();
+
+    formatter.beginTable("jobs", PDFToolTranslationContext::tr("Jobs"));
+
+    formatter.beginTableHeaderRow("header");
+    formatter.writeTableHeaderColumn("line", PDFToolTranslationContext::tr("Line"), Qt::AlignLeft);
+    formatter.writeTableHeaderColumn("command", PDFToolTranslationContext::tr("Command"), Qt::AlignLeft);
+    formatter.writeTableHeaderColumn("exit-code", PDFToolTranslationContext::tr("Exit Code"), Qt::AlignLeft);
+    formatter.writeTableHeaderColumn("time", PDFToolTranslationContext::tr("Time [msec]"), Qt::AlignLeft);
+    formatter.writeTableHeaderColumn("error", PDFToolTranslationContext::tr("Error"), Qt::AlignLeft);
+    formatter.endTableHeaderRow();
+
+    QLocale locale;
+    int jobCount = 0;
+    int failedJobCount = 0;
+    int lineNumber = 0;
+
+    QElapsedTimer totalTimer;
+    totalTimer.start();
+
+    while (!file.atEnd())
+    {
+        ++lineNumber;
+        const QString line = QString::fromUtf8(file.readLine()).trimmed();
+
+        if (line.isEmpty() || line.startsWith('#'))
+        {
+            continue;
+        }
+
+        const QStringList jobArguments = QProcess::splitCommand(line);
+        if (jobArguments.isEmpty())
+        {
+            continue;
+        }
+
+        QElapsedTimer jobTimer;
+        jobTimer.start();
+
+        QString errorMessage;
+        const int exitCode = executeJob(jobArguments, errorMessage);
+        const qint64 jobTime = jobTimer.elapsed();
+
+        ++jobCount;
+        if (exitCode != ExitSuccess)
+        {
+            ++failedJobCount;
+        }
+
+        formatter.beginTableRow("job", lineNumber);
+        formatter.writeTableColumn("line", locale.toString(lineNumber), Qt::AlignRight);
+        formatter.writeTableColumn("command", jobArguments.front());
+        formatter.writeTableColumn("exit-code", locale.toString(exitCode), Qt::AlignRight);
+        formatter.writeTableColumn("time", locale.toString(jobTime), Qt::AlignRight);
+        formatter.writeTableColumn("error", errorMessage);
+        formatter.endTableRow();
+
+        if (exitCode != ExitSuccess && options.batchStopOnError)
+        {
+            break;
+        }
+    }
+
+    formatter.endTable();
+    setDocumentCacheSize(0);
+
+    formatter.endl();
+    formatter.writeText("summary", PDFToolTranslationContext::tr("Jobs executed: %1, failed: %2, total time: %3 msec.").arg(locale.toString(jobCount), locale.toString(failedJobCount), locale.toString(totalTimer.elapsed())));
+
+    formatter.endDocument();
+    PDFConsole::writeText(formatter.getString(), options.outputCodec);
+
+    return failedJobCount == 0 ? ExitSuccess : ExitFailure;
+}
+
+int PDFToolBatch::executeJob(const QStringList& jobArguments, QString& errorMessage)
+{
+    const QString command = jobArguments.front();
+    PDFToolAbstractApplication* application = PDFToolApplicationStorage::getApplicationByCommand(command);
+
+    if (!application || application == this)
+    {
+        errorMessage = PDFToolTranslationContext::tr("Unknown command '%1'.").arg(command);
+        return ErrorInvalidArguments;
+    }
+
+    // First argument is ignored by the parser (program name)
+    QStringList arguments = jobArguments;
+    arguments.front() = QCoreApplication::applicationFilePath();
+
+    QCommandLineParser parser;
+    application->initializeCommandLineParser(&parser);
+
+    if (!parser.parse(arguments))
+    {
+        errorMessage = parser.errorText();
+        return ErrorInvalidArguments;
+    }
+
+    return application->execute(application->getOptions(&parser));
+}
+
+}   // namespace pdftool
@@ -0,0 +1,51 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef PDFTOOLBATCH_H
+#define PDFTOOLBATCH_H
+
+#include "pdftoolabstractapplication.h"
+
+namespace pdftool
+{
+
+/// Executes jobs from the job list in one process. Each line of the job list
+/// contains one command with its arguments (as if it was passed on the command line),
+/// empty lines and lines starting with '#' are ignored. So process startup and library
+/// initialization is performed only once for all jobs.
+class PDFToolBatch : public PDFToolAbstractApplication
+{
+public:
+    virtual QString getStandardString(StandardString standardString) const override;
+    virtual int execute(const PDFToolOptions& options) override;
+    virtual Options getOptionsFlags() const override;
+
+private:
+    /// Executes single job. Returns exit code of the job.
+    /// \param jobArguments Command and its arguments
+    /// \param[out] errorMessage Error message, if job can't be started
+    int executeJob(const QStringList& jobArguments, QString& errorMessage);
+};
+
+}   // namespace pdftool
+
+#endif // PDFTOOLBATCH_H
@@ -21,10 +21,14 @@
 // SOFTWARE.
 
 #include "pdftooldiff.h"
+#include "pdftoolperformancereport.h"
 
 #include "pdfdiff.h"
 #include "pdfdocumentreader.h"
 
+#include <QFile>
+#include <QElapsedTimer>
+
 namespace pdftool
 {
 
@@ -59,6 +63,10 @@ int PDFToolDiff::execute(const PDFToolOptions& options)
         return ErrorInvalidArguments;
     }
 
+    PDFToolPerformanceReport report(getStandardString(Command));
+    QElapsedTimer timer;
+    timer.start();
+
     pdf::PDFDocumentReader reader(nullptr, [](bool* ok) { *ok = false; return QString(); }, options.permissiveReading, false);
 
     pdf::PDFDocument leftDocument = reader.readFromFile(options.diffFiles.front());
@@ -68,6 +76,10 @@ int PDFToolDiff::execute(const PDFToolOptions& options)
         return ErrorDocumentReading;
     }
 
+    report.setValue("left-document", options.diffFiles.front());
+    report.setValue("left-pages", qulonglong(leftDocument.getCatalog()->getPageCount()));
+    report.setValue("left-read-time", timer.restart());
+
     pdf::PDFDocument rightDocument = reader.readFromFile(options.diffFiles.back());
     if (reader.getReadingResult() != pdf::PDFDocumentReader::Result::OK)
     {
@@ -75,6 +87,10 @@ int PDFToolDiff::execute(const PDFToolOptions& options)
         return ErrorDocumentReading;
     }
 
+    report.setValue("right-document", options.diffFiles.back());
+    report.setValue("right-pages", qulonglong(rightDocument.getCatalog()->getPageCount()));
+    report.setValue("right-read-time", timer.restart());
+
     pdf::PDFClosedIntervalSet leftPages;
     leftPages.addInterval(0, leftDocument.getCatalog()->getPageCount() - 1);
 
@@ -87,13 +103,66 @@ int PDFToolDiff::execute(const PDFToolOptions& options)
     diff.setRightDocument(&rightDocument);
     diff.setPagesForLeftDocument(std::move(leftPages));
     diff.setPagesForRightDocument(std::move(rightPages));
-    diff.start();
 
     QLocale locale;
 
+    if (!options.diffStreamFile.isEmpty())
+    {
+        // Streaming mode - differences are written to the file progressively
+        QFile file(options.diffStreamFile);
+        if (!file.open(QFile::WriteOnly | QFile::Truncate))
+        {
+            PDFConsole::writeError(PDFToolTranslationContext::tr("Cannot open file '%1' for writing.").arg(options.diffStreamFile), options.outputCodec);
+            return ErrorFailedWriteToFile;
+        }
+
+        std::unique_ptr<pdf::PDFDiffResultSink> sink;
+        if (options.diffStreamFormat == "xml")
+        {
+            sink = std::make_unique<pdf::PDFDiffResultXMLSink>(&file);
+        }
+        else
+        {
+            sink = std::make_unique<pdf::PDFDiffResultNDJSONSink>(&file);
+        }
+
+        const size_t windowSize = options.diffStreamWindow > 0 ? size_t(options.diffStreamWindow) : pdf::PDFDiff::DEFAULT_STREAMING_WINDOW_SIZE;
+        diff.setResultSink(sink.get(), windowSize);
+        diff.start();
+        file.close();
+        report.setValue("compare-time", timer.elapsed());
+
+        const pdf::PDFDiffResult& result = diff.getResult();
+        if (!result.getResult())
+        {
+            PDFConsole::writeError(result.getResult().getErrorMessage(), options.outputCodec);
+            return ErrorUnknown;
+        }
+
+        PDFOutputFormatter formatter(options.outputStyle);
+        formatter.beginDocument("diff", PDFToolTranslationContext::tr("Difference Report"));
+        formatter.endl();
+        formatter.writeText("differences", PDFToolTranslationContext::tr("Differences written to '%1': %2").arg(options.diffStreamFile, locale.toString(qulonglong(sink->getWrittenDifferencesCount()))));
+        formatter.writeText("unchanged-pages", PDFToolTranslationContext::tr("Unchanged pages (comparation skipped): %1").arg(locale.toString(qulonglong(result.getUnchangedPageCount()))));
+        formatter.endDocument();
+        PDFConsole::writeText(formatter.getString(), options.outputCodec);
+
+        report.setValue("differences", qulonglong(sink->getWrittenDifferencesCount()));
+        report.setValue("unchanged-pages", qulonglong(result.getUnchangedPageCount()));
+        writePerformanceReport(options, report);
+        return ExitSuccess;
+    }
+
+    diff.start();
+    report.setValue("compare-time", timer.elapsed());
+
     const pdf::PDFDiffResult& result = diff.getResult();
     if (result.getResult())
     {
+        report.setValue("differences", qulonglong(result.getDifferencesCount()));
+        report.setValue("unchanged-pages", qulonglong(result.getUnchangedPageCount()));
+        writePerformanceReport(options, report);
+
         PDFOutputFormatter formatter(options.outputStyle);
         formatter.beginDocument("diff", PDFToolTranslationContext::tr("Difference Report").arg(options.document));
         formatter.endl();
@@ -127,6 +196,10 @@ int PDFToolDiff::execute(const PDFToolOptions& options)
         }
 
         formatter.endTable();
+
+        formatter.endl();
+        formatter.writeText("unchanged-pages", PDFToolTranslationContext::tr("Unchanged pages (comparation skipped): %1").arg(locale.toString(qulonglong(result.getUnchangedPageCount()))));
+
         formatter.endDocument();
 
         if (options.outputStyle == PDFOutputFormatter::Style::Xml)
@@ -151,7 +224,7 @@ int PDFToolDiff::execute(const PDFToolOptions& options)
 
 PDFToolAbstractApplication::Options PDFToolDiff::getOptionsFlags() const
 {
-    return ConsoleFormat | Diff;
+    return ConsoleFormat | Diff | PerformanceReport;
 }
 
 }   // namespace pdftool
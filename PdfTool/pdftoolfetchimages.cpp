@@ -24,7 +24,12 @@
 #include "pdfpagecontentprocessor.h"
 #include "pdfconstants.h"
 #include "pdfexecutionpolicy.h"
+#include "pdfdocumentwriter.h"
 
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
 #include <QCryptographicHash>
 
 namespace pdftool
@@ -49,6 +54,8 @@ public:
         BaseClass(page, document, fontCache, cms, optionalContentActivity, pagePointToDevicePointMatrix, meshQualitySettings),
         m_pageIndex(pageIndex),
         m_order(0),
+        m_imageOrder(0),
+        m_imageStream(nullptr),
         m_tool(tool)
     {
 
@@ -57,11 +64,14 @@ public:
 protected:
     virtual bool isContentSuppressedByOC(pdf::PDFObjectReference ocgOrOcmd) override;
     virtual bool isContentKindSuppressed(ContentKind kind) const override;
+    virtual bool performImageXObjectPlacement(const pdf::PDFStream* stream) override;
     virtual void performImagePainting(const QImage& image) override;
 
 private:
     pdf::PDFInteger m_pageIndex;
     pdf::PDFInteger m_order;
+    pdf::PDFInteger m_imageOrder;
+    const pdf::PDFStream* m_imageStream; ///< Image XObject being decoded
     PDFToolFetchImages* m_tool;
 };
 
@@ -94,10 +104,32 @@ bool PDFImageContentExtractorProcessor::isContentKindSuppressed(ContentKind kind
     return false;
 }
 
+bool PDFImageContentExtractorProcessor::performImageXObjectPlacement(const pdf::PDFStream* stream)
+{
+    m_imageOrder = m_order++;
+    m_imageStream = nullptr;
+
+    if (m_tool->onImageXObjectPlacement(m_pageIndex, m_imageOrder, stream))
+    {
+        return true;
+    }
+
+    m_imageStream = stream;
+    return false;
+}
 
 void PDFImageContentExtractorProcessor::performImagePainting(const QImage& image)
 {
-    m_tool->onImageExtracted(m_pageIndex, m_order++, image);
+    if (m_imageStream)
+    {
+        m_tool->onImageExtracted(m_pageIndex, m_imageOrder, image, m_imageStream);
+        m_imageStream = nullptr;
+    }
+    else
+    {
+        // Inline image
+        m_tool->onImageExtracted(m_pageIndex, m_order++, image, nullptr);
+    }
 }
 
 QString PDFToolFetchImages::getStandardString(PDFToolAbstractApplication::StandardString standardString) const
@@ -136,6 +168,13 @@ int PDFToolFetchImages::execute(const PDFToolOptions& options)
         return ErrorPermissions;
     }
 
+    m_document = &document;
+    m_writeOriginalData = options.fetchImagesWriteOriginalData;
+    m_images.clear();
+    m_placements.clear();
+    m_streamToImage.clear();
+    m_hashToImage.clear();
+
     QString parseError;
     std::vector<pdf::PDFInteger> pageIndices = options.getPageRange(document.getCatalog()->getPageCount(), parseError, true);
 
@@ -185,11 +224,33 @@ int PDFToolFetchImages::execute(const PDFToolOptions& options)
     pdf::PDFExecutionPolicy::execute(pdf::PDFExecutionPolicy::Scope::Page, pageIndices.begin(), pageIndices.end(), processPageContents);
     fontCache.setCacheShrinkEnabled(nullptr, true);
 
-    auto comparator = [](const Image& left, const Image& right) -> bool
+    // Images are sorted by their first placement, images, which
+    // failed to decode, are removed.
+    std::vector<size_t> imageIndices;
+    for (size_t i = 0; i < m_images.size(); ++i)
     {
-        return std::make_pair(left.pageIndex, left.order) < std::make_pair(right.pageIndex, right.order);
+        const Image& image = m_images[i];
+        if (!image.image.isNull() || !image.originalData.isEmpty())
+        {
+            imageIndices.push_back(i);
+        }
+    }
+
+    auto comparator = [this](size_t left, size_t right) -> bool
+    {
+        return std::make_pair(m_images[left].pageIndex, m_images[left].order) < std::make_pair(m_images[right].pageIndex, m_images[right].order);
     };
-    std::sort(m_images.begin(), m_images.end(), comparator);
+    std::sort(imageIndices.begin(), imageIndices.end(), comparator);
+
+    std::vector<size_t> imageNumbers(m_images.size(), 0);
+    Images images;
+    images.reserve(imageIndices.size());
+    for (size_t imageIndex : imageIndices)
+    {
+        images.emplace_back(qMove(m_images[imageIndex]));
+        imageNumbers[imageIndex] = images.size();
+    }
+    m_images = qMove(images);
 
     // Write information about images
     PDFOutputFormatter formatter(options.outputStyle);
@@ -212,15 +273,16 @@ int PDFToolFetchImages::execute(const PDFToolOptions& options)
     for (size_t i = 0; i < m_images.size(); ++i)
     {
         Image& image = m_images[i];
-        image.fileName = options.imageExportSettings.getOutputFileName(pdf::PDFInteger(i), options.imageWriterSettings.getCurrentFormat());
+        const bool isOriginalData = !image.originalData.isEmpty();
+        image.fileName = options.imageExportSettings.getOutputFileName(pdf::PDFInteger(i), isOriginalData ? image.originalFormat : options.imageWriterSettings.getCurrentFormat());
 
         formatter.beginTableRow("image", int(i));
 
         formatter.writeTableColumn("item-no", locale.toString(i + 1), Qt::AlignRight);
         formatter.writeTableColumn("page-no", locale.toString(image.pageIndex + 1), Qt::AlignRight);
-        formatter.writeTableColumn("width", locale.toString(image.image.width()), Qt::AlignRight);
-        formatter.writeTableColumn("height", locale.toString(image.image.height()), Qt::AlignRight);
-        formatter.writeTableColumn("size", locale.toString(image.image.sizeInBytes()), Qt::AlignRight);
+        formatter.writeTableColumn("width", locale.toString(isOriginalData ? image.originalSize.width() : image.image.width()), Qt::AlignRight);
+        formatter.writeTableColumn("height", locale.toString(isOriginalData ? image.originalSize.height() : image.image.height()), Qt::AlignRight);
+        formatter.writeTableColumn("size", locale.toString(isOriginalData ? image.originalData.size() : image.image.sizeInBytes()), Qt::AlignRight);
         formatter.writeTableColumn("stored-to", image.fileName);
 
         formatter.endTableRow();
@@ -236,6 +298,16 @@ int PDFToolFetchImages::execute(const PDFToolOptions& options)
     {
         Image& image = m_images[index];
 
+        if (!image.originalData.isEmpty())
+        {
+            QFile file(image.fileName);
+            if (!file.open(QFile::WriteOnly | QFile::Truncate) || file.write(image.originalData) != image.originalData.size())
+            {
+                PDFConsole::writeError(PDFToolTranslationContext::tr("Cannot write page image to file '%1', because: %2.").arg(image.fileName).arg(file.errorString()), options.outputCodec);
+            }
+            return;
+        }
+
         QImageWriter imageWriter(image.fileName, options.imageWriterSettings.getCurrentFormat());
         imageWriter.setSubType(options.imageWriterSettings.getCurrentSubtype());
         imageWriter.setCompression(options.imageWriterSettings.getCompression());
@@ -252,41 +324,194 @@ int PDFToolFetchImages::execute(const PDFToolOptions& options)
     auto imageRange = pdf::PDFIntegerRange<size_t>(0, m_images.size());
     pdf::PDFExecutionPolicy::execute(pdf::PDFExecutionPolicy::Scope::Page, imageRange.begin(), imageRange.end(), saveImage);
 
+    // Write manifest, which maps image placements to files
+    if (!options.fetchImagesManifestFile.isEmpty())
+    {
+        std::sort(m_placements.begin(), m_placements.end(), [](const Placement& left, const Placement& right) { return std::make_pair(left.pageIndex, left.order) < std::make_pair(right.pageIndex, right.order); });
+
+        QJsonArray placements;
+        for (const Placement& placement : m_placements)
+        {
+            const size_t imageNumber = imageNumbers[placement.imageIndex];
+            if (imageNumber == 0)
+            {
+                // Image was not decoded
+                continue;
+            }
+
+            QJsonObject object;
+            object["page"] = qint64(placement.pageIndex + 1);
+            object["order"] = qint64(placement.order);
+            object["image"] = qint64(imageNumber);
+            object["file"] = m_images[imageNumber - 1].fileName;
+            placements.append(object);
+        }
+
+        QJsonObject manifest;
+        manifest["document"] = options.document;
+        manifest["images"] = qint64(m_images.size());
+        manifest["placements"] = placements;
+
+        QFile file(options.fetchImagesManifestFile);
+        if (!file.open(QFile::WriteOnly | QFile::Truncate) || file.write(QJsonDocument(manifest).toJson(QJsonDocument::Indented)) < 0)
+        {
+            PDFConsole::writeError(PDFToolTranslationContext::tr("Cannot write manifest to file '%1', because: %2.").arg(options.fetchImagesManifestFile, file.errorString()), options.outputCodec);
+            return ErrorFailedWriteToFile;
+        }
+    }
+
     return ExitSuccess;
 }
 
 PDFToolAbstractApplication::Options PDFToolFetchImages::getOptionsFlags() const
 {
-    return ConsoleFormat | OpenDocument | PageSelector | ImageWriterSettings | ImageExportSettingsFiles | ColorManagementSystem;
+    return ConsoleFormat | OpenDocument | PageSelector | ImageWriterSettings | ImageExportSettingsFiles | ColorManagementSystem | FetchImages;
+}
+
+bool PDFToolFetchImages::onImageXObjectPlacement(pdf::PDFInteger pageIndex, pdf::PDFInteger order, const pdf::PDFStream* stream)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        auto it = m_streamToImage.find(stream);
+        if (it != m_streamToImage.cend())
+        {
+            // Image was already found on other place
+            addPlacement(pageIndex, order, it->second);
+            return true;
+        }
+    }
+
+    // Image XObjects with the same content (for example, duplicated
+    // objects) are also written only once.
+    QByteArray hash = getImageXObjectHash(stream);
+    QByteArray originalFormat = m_writeOriginalData ? getOriginalImageFormat(stream) : QByteArray();
+    QByteArray originalData = !originalFormat.isEmpty() ? stream->getDecryptedContent() : QByteArray();
+
+    QMutexLocker lock(&m_mutex);
+    auto it = m_streamToImage.find(stream);
+    if (it == m_streamToImage.cend())
+    {
+        auto hashIt = m_hashToImage.find(hash);
+        if (hashIt != m_hashToImage.cend())
+        {
+            it = m_streamToImage.emplace(stream, hashIt->second).first;
+        }
+    }
+
+    if (it != m_streamToImage.cend())
+    {
+        addPlacement(pageIndex, order, it->second);
+        return true;
+    }
+
+    const size_t imageIndex = m_images.size();
+    Image imageStructure;
+    imageStructure.hash = hash;
+    imageStructure.pageIndex = pageIndex;
+    imageStructure.order = order;
+
+    const bool writeOriginalData = !originalData.isEmpty();
+    if (writeOriginalData)
+    {
+        const pdf::PDFDictionary* dictionary = stream->getDictionary();
+        pdf::PDFDocumentDataLoaderDecorator loader(m_document);
+        imageStructure.originalData = qMove(originalData);
+        imageStructure.originalFormat = originalFormat;
+        imageStructure.originalSize = QSize(loader.readIntegerFromDictionary(dictionary, "Width", 0), loader.readIntegerFromDictionary(dictionary, "Height", 0));
+    }
+
+    m_images.emplace_back(qMove(imageStructure));
+    m_streamToImage[stream] = imageIndex;
+    m_hashToImage[hash] = imageIndex;
+    addPlacement(pageIndex, order, imageIndex);
+
+    // Image is decoded only by the processor, which found it first
+    return writeOriginalData;
 }
 
-void PDFToolFetchImages::onImageExtracted(pdf::PDFInteger pageIndex, pdf::PDFInteger order, const QImage& image)
+void PDFToolFetchImages::onImageExtracted(pdf::PDFInteger pageIndex, pdf::PDFInteger order, const QImage& image, const pdf::PDFStream* stream)
 {
+    if (stream)
+    {
+        QMutexLocker lock(&m_mutex);
+        auto it = m_streamToImage.find(stream);
+        if (it != m_streamToImage.cend())
+        {
+            m_images[it->second].image = image;
+        }
+        return;
+    }
+
     QCryptographicHash hasher(QCryptographicHash::Sha512);
     QByteArrayView imageData(image.bits(), image.sizeInBytes());
     hasher.addData(imageData);
     QByteArray hash = hasher.result();
 
     QMutexLocker lock(&m_mutex);
-    auto it = std::find_if(m_images.begin(), m_images.end(), [&hash](const Image& image) { return image.hash == hash; });
-    if (it == m_images.cend())
+    auto it = m_hashToImage.find(hash);
+    if (it == m_hashToImage.cend())
     {
         Image imageStructure;
         imageStructure.hash = hash;
         imageStructure.pageIndex = pageIndex;
         imageStructure.order = order;
         imageStructure.image = image;
+        it = m_hashToImage.emplace(hash, m_images.size()).first;
         m_images.emplace_back(qMove(imageStructure));
     }
-    else
+
+    addPlacement(pageIndex, order, it->second);
+}
+
+void PDFToolFetchImages::addPlacement(pdf::PDFInteger pageIndex, pdf::PDFInteger order, size_t imageIndex)
+{
+    Image& imageStructure = m_images[imageIndex];
+    if (std::make_pair(pageIndex, order) < std::make_pair(imageStructure.pageIndex, imageStructure.order))
+    {
+        imageStructure.pageIndex = pageIndex;
+        imageStructure.order = order;
+    }
+
+    m_placements.push_back(Placement{ pageIndex, order, imageIndex });
+}
+
+QByteArray PDFToolFetchImages::getImageXObjectHash(const pdf::PDFStream* stream)
+{
+    QCryptographicHash hasher(QCryptographicHash::Sha256);
+
+    const pdf::PDFDictionary* dictionary = stream->getDictionary();
+    for (size_t i = 0, count = dictionary->getCount(); i < count; ++i)
     {
-        Image& imageStructure = *it;
-        if (imageStructure.pageIndex > pageIndex)
+        hasher.addData(dictionary->getKey(i).getView());
+        hasher.addData(pdf::PDFDocumentWriter::getSerializedObject(dictionary->getValue(i)));
+    }
+
+    hasher.addData(*stream->getContent());
+    return hasher.result();
+}
+
+QByteArray PDFToolFetchImages::getOriginalImageFormat(const pdf::PDFStream* stream) const
+{
+    pdf::PDFObject filter = m_document->getObject(stream->getDictionary()->get("Filter"));
+    if (filter.isArray() && filter.getArray()->getCount() == 1)
+    {
+        filter = m_document->getObject(filter.getArray()->getItem(0));
+    }
+
+    if (filter.isName())
+    {
+        if (filter.getString() == "DCTDecode")
         {
-            imageStructure.pageIndex = pageIndex;
-            imageStructure.order = order;
+            return "jpg";
+        }
+
+        if (filter.getString() == "JPXDecode")
+        {
+            return "jp2";
         }
     }
+
+    return QByteArray();
 }
 
 }   // namespace pdftool
@@ -27,6 +27,8 @@
 
 #include <QMutex>
 
+#include <map>
+
 namespace pdftool
 {
 
@@ -37,7 +39,21 @@ public:
     virtual int execute(const PDFToolOptions& options) override;
     virtual Options getOptionsFlags() const override;
 
-    void onImageExtracted(pdf::PDFInteger pageIndex, pdf::PDFInteger order, const QImage& image);
+    /// Called before image XObject is decoded. Returns true, if image
+    /// doesn't have to be decoded, because the same image was already
+    /// found (or it is being decoded on another page), or because original
+    /// image data are written.
+    /// \param pageIndex Page index
+    /// \param order Order of the image on the page
+    /// \param stream Image XObject stream
+    bool onImageXObjectPlacement(pdf::PDFInteger pageIndex, pdf::PDFInteger order, const pdf::PDFStream* stream);
+
+    /// Called when image is decoded
+    /// \param pageIndex Page index
+    /// \param order Order of the image on the page
+    /// \param image Decoded image
+    /// \param stream Image XObject stream (nullptr for inline images)
+    void onImageExtracted(pdf::PDFInteger pageIndex, pdf::PDFInteger order, const QImage& image, const pdf::PDFStream* stream);
 
 private:
     struct Image
@@ -46,12 +62,39 @@ private:
         pdf::PDFInteger pageIndex = 0;
         pdf::PDFInteger order = 0;
         QImage image;
+        QByteArray originalData;    ///< Original (not decoded) image data, if image is written without decoding
+        QByteArray originalFormat;  ///< Format of original image data
+        QSize originalSize;
         QString fileName;
     };
     using Images = std::vector<Image>;
 
+    /// Placement of the image on the page
+    struct Placement
+    {
+        pdf::PDFInteger pageIndex = 0;
+        pdf::PDFInteger order = 0;
+        size_t imageIndex = 0;
+    };
+
+    /// Adds placement of the image, mutex must be locked
+    void addPlacement(pdf::PDFInteger pageIndex, pdf::PDFInteger order, size_t imageIndex);
+
+    /// Returns hash of the image XObject (dictionary and encoded data)
+    static QByteArray getImageXObjectHash(const pdf::PDFStream* stream);
+
+    /// Returns format of original data of the image ("jpg" or "jp2"), if image
+    /// is encoded by single DCT or JPX filter, otherwise empty byte array is returned.
+    QByteArray getOriginalImageFormat(const pdf::PDFStream* stream) const;
+
+    const pdf::PDFDocument* m_document = nullptr;
+    bool m_writeOriginalData = false;
+
     QMutex m_mutex;
     Images m_images;
+    std::vector<Placement> m_placements;
+    std::map<const pdf::PDFStream*, size_t> m_streamToImage;
+    std::map<QByteArray, size_t> m_hashToImage;
 };
 
 }   // namespace pdftool
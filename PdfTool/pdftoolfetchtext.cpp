@@ -21,13 +21,84 @@
 // SOFTWARE.
 
 #include "pdftoolfetchtext.h"
+#include "pdftoolperformancereport.h"
 #include "pdfdocumenttextflow.h"
 
+#include <QThread>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
+
 namespace pdftool
 {
 
 static PDFToolFetchTextApplication s_fetchTextApplication;
 
+/// Adds count of text items and characters of each page to the performance report
+static void addTextFlowPageValues(PDFToolPerformanceReport& report, const pdf::PDFDocumentTextFlow::Items& items)
+{
+    std::map<pdf::PDFInteger, std::pair<qint64, qint64>> pageValues;
+    for (const pdf::PDFDocumentTextFlow::Item& item : items)
+    {
+        if (item.isText())
+        {
+            std::pair<qint64, qint64>& values = pageValues[item.pageIndex];
+            values.first += 1;
+            values.second += item.text.size();
+        }
+    }
+
+    for (const auto& pageValue : pageValues)
+    {
+        report.setPageValue(pageValue.first, "text-items", pageValue.second.first);
+        report.setPageValue(pageValue.first, "characters", pageValue.second.second);
+    }
+}
+
+static bool isTextShown(const pdf::PDFDocumentTextFlow::Item& item, const PDFToolOptions& options)
+{
+    return (item.flags.testFlag(pdf::PDFDocumentTextFlow::Text)) ||
+           (item.flags.testFlag(pdf::PDFDocumentTextFlow::PageStart) && options.textShowPageNumbers) ||
+           (item.flags.testFlag(pdf::PDFDocumentTextFlow::PageEnd) && options.textShowPageNumbers) ||
+           (item.flags.testFlag(pdf::PDFDocumentTextFlow::StructureTitle) && options.textShowStructTitles) ||
+           (item.flags.testFlag(pdf::PDFDocumentTextFlow::StructureLanguage) && options.textShowStructLanguage) ||
+           (item.flags.testFlag(pdf::PDFDocumentTextFlow::StructureAlternativeDescription) && options.textShowStructAlternativeDescription) ||
+           (item.flags.testFlag(pdf::PDFDocumentTextFlow::StructureExpandedForm) && options.textShowStructExpandedForm) ||
+           (item.flags.testFlag(pdf::PDFDocumentTextFlow::StructureActualText) && options.textShowStructActualText) ||
+           (item.flags.testFlag(pdf::PDFDocumentTextFlow::StructurePhoneme) && options.textShowStructPhoneme);
+}
+
+static QString getStructureInfoType(pdf::PDFDocumentTextFlow::Flags flags)
+{
+    if (flags.testFlag(pdf::PDFDocumentTextFlow::StructureTitle))
+    {
+        return "title";
+    }
+    if (flags.testFlag(pdf::PDFDocumentTextFlow::StructureLanguage))
+    {
+        return "language";
+    }
+    if (flags.testFlag(pdf::PDFDocumentTextFlow::StructureAlternativeDescription))
+    {
+        return "alternative-description";
+    }
+    if (flags.testFlag(pdf::PDFDocumentTextFlow::StructureExpandedForm))
+    {
+        return "expanded-form";
+    }
+    if (flags.testFlag(pdf::PDFDocumentTextFlow::StructureActualText))
+    {
+        return "actual-text";
+    }
+    if (flags.testFlag(pdf::PDFDocumentTextFlow::StructurePhoneme))
+    {
+        return "phoneme";
+    }
+
+    return QString();
+}
+
 QString PDFToolFetchTextApplication::getStandardString(PDFToolAbstractApplication::StandardString standardString) const
 {
     switch (standardString)
@@ -73,9 +144,28 @@ int PDFToolFetchTextApplication::execute(const PDFToolOptions& options)
         return ErrorInvalidArguments;
     }
 
+    if (options.textStreamNDJSON)
+    {
+        return executeNDJSON(&document, pages, options);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
     pdf::PDFDocumentTextFlowFactory factory;
     pdf::PDFDocumentTextFlow documentTextFlow = factory.create(&document, pages, options.textAnalysisAlgorithm);
 
+    if (!options.performanceReportFile.isEmpty())
+    {
+        PDFToolPerformanceReport report(getStandardString(Command));
+        report.setValue("document", options.document);
+        report.setValue("wall-time", timer.elapsed());
+        report.setValue("pages", qulonglong(pages.size()));
+        report.setValue("errors", qulonglong(factory.getErrors().size()));
+        addTextFlowPageValues(report, documentTextFlow.getItems());
+        writePerformanceReport(options, report);
+    }
+
     PDFOutputFormatter formatter(options.outputStyle);
     formatter.beginDocument("text-extraction", QString());
     formatter.endl();
@@ -87,22 +177,9 @@ int PDFToolFetchTextApplication::execute(const PDFToolOptions& options)
             formatter.beginHeader("item", item.text);
         }
 
-        if (!item.text.isEmpty())
+        if (!item.text.isEmpty() && isTextShown(item, options))
         {
-            bool showText = (item.flags.testFlag(pdf::PDFDocumentTextFlow::Text)) ||
-                            (item.flags.testFlag(pdf::PDFDocumentTextFlow::PageStart) && options.textShowPageNumbers) ||
-                            (item.flags.testFlag(pdf::PDFDocumentTextFlow::PageEnd) && options.textShowPageNumbers) ||
-                            (item.flags.testFlag(pdf::PDFDocumentTextFlow::StructureTitle) && options.textShowStructTitles) ||
-                            (item.flags.testFlag(pdf::PDFDocumentTextFlow::StructureLanguage) && options.textShowStructLanguage) ||
-                            (item.flags.testFlag(pdf::PDFDocumentTextFlow::StructureAlternativeDescription) && options.textShowStructAlternativeDescription) ||
-                            (item.flags.testFlag(pdf::PDFDocumentTextFlow::StructureExpandedForm) && options.textShowStructExpandedForm) ||
-                            (item.flags.testFlag(pdf::PDFDocumentTextFlow::StructureActualText) && options.textShowStructActualText) ||
-                            (item.flags.testFlag(pdf::PDFDocumentTextFlow::StructurePhoneme) && options.textShowStructPhoneme);
-
-            if (showText)
-            {
-                formatter.writeText("text", item.text);
-            }
+            formatter.writeText("text", item.text);
         }
 
         if (item.flags.testFlag(pdf::PDFDocumentTextFlow::StructureItemEnd))
@@ -128,9 +205,100 @@ int PDFToolFetchTextApplication::execute(const PDFToolOptions& options)
     return ExitSuccess;
 }
 
+int PDFToolFetchTextApplication::executeNDJSON(const pdf::PDFDocument* document, const std::vector<pdf::PDFInteger>& pages, const PDFToolOptions& options)
+{
+    // Each record contains page number, text of the page, and optionally, the bounding
+    // boxes of text items and structure information. Only a limited window of pages
+    // is held in memory, records are written in page order.
+    PDFToolPerformanceReport report(getStandardString(Command));
+    const bool isPerformanceReportEnabled = !options.performanceReportFile.isEmpty();
+
+    auto writePage = [&options, &report, isPerformanceReportEnabled](pdf::PDFInteger pageIndex, pdf::PDFDocumentTextFlow::Items items)
+    {
+        if (isPerformanceReportEnabled)
+        {
+            addTextFlowPageValues(report, items);
+        }
+
+        QStringList texts;
+        QJsonArray boxes;
+        QJsonArray structure;
+
+        for (const pdf::PDFDocumentTextFlow::Item& item : items)
+        {
+            if (item.text.isEmpty() || !isTextShown(item, options) || item.flags.testFlag(pdf::PDFDocumentTextFlow::PageStart) || item.flags.testFlag(pdf::PDFDocumentTextFlow::PageEnd))
+            {
+                continue;
+            }
+
+            if (item.isText())
+            {
+                texts << item.text;
+
+                if (options.textStreamBoundingBoxes && item.boundingRect.isValid())
+                {
+                    const QRectF& rect = item.boundingRect;
+                    QJsonObject box;
+                    box["text"] = item.text;
+                    box["box"] = QJsonArray({ rect.left(), rect.top(), rect.width(), rect.height() });
+                    boxes.append(box);
+                }
+            }
+            else
+            {
+                QJsonObject structureInfo;
+                structureInfo["type"] = getStructureInfoType(item.flags);
+                structureInfo["text"] = item.text;
+                structure.append(structureInfo);
+            }
+        }
+
+        QJsonObject record;
+        record["page"] = pageIndex + 1;
+        record["text"] = texts.join('\n');
+
+        if (options.textStreamBoundingBoxes)
+        {
+            record["boxes"] = boxes;
+        }
+
+        if (!structure.isEmpty())
+        {
+            record["structure"] = structure;
+        }
+
+        PDFConsole::writeData(QJsonDocument(record).toJson(QJsonDocument::Compact) + '\n');
+    };
+
+    const size_t windowSize = options.textStreamWindow > 0 ? size_t(options.textStreamWindow) : size_t(qMax(QThread::idealThreadCount(), 1) * 4);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    pdf::PDFDocumentTextFlowFactory factory;
+    factory.setCalculateBoundingBoxes(options.textStreamBoundingBoxes);
+    factory.createStreaming(document, pages, options.textAnalysisAlgorithm, windowSize, writePage);
+
+    if (isPerformanceReportEnabled)
+    {
+        report.setValue("document", options.document);
+        report.setValue("wall-time", timer.elapsed());
+        report.setValue("pages", qulonglong(pages.size()));
+        report.setValue("errors", qulonglong(factory.getErrors().size()));
+        writePerformanceReport(options, report);
+    }
+
+    for (const pdf::PDFRenderError& error : factory.getErrors())
+    {
+        PDFConsole::writeError(error.message, options.outputCodec);
+    }
+
+    return ExitSuccess;
+}
+
 PDFToolAbstractApplication::Options PDFToolFetchTextApplication::getOptionsFlags() const
 {
-    return ConsoleFormat | OpenDocument | PageSelector | TextAnalysis | TextShow;
+    return ConsoleFormat | OpenDocument | PageSelector | TextAnalysis | TextShow | TextStream | PerformanceReport;
 }
 
 }   // namespace pdftool
@@ -34,6 +34,14 @@ public:
     virtual QString getStandardString(StandardString standardString) const override;
     virtual int execute(const PDFToolOptions& options) override;
     virtual Options getOptionsFlags() const override;
+
+private:
+    /// Writes text of the document pages as NDJSON records, page by page,
+    /// as soon as text of each page is available.
+    /// \param document Document
+    /// \param pages Page indices
+    /// \param options Options
+    int executeNDJSON(const pdf::PDFDocument* document, const std::vector<pdf::PDFInteger>& pages, const PDFToolOptions& options);
 };
 
 }   // namespace pdftool
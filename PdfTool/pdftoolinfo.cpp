@@ -23,6 +23,7 @@
 #include "pdftoolinfo.h"
 #include "pdfform.h"
 #include "pdfjavascriptscanner.h"
+#include "pdfmemoryreport.h"
 
 #include <QPageSize>
 #include <QCryptographicHash>
@@ -268,6 +269,42 @@ int PDFToolInfoApplication::execute(const PDFToolOptions& options)
 
     formatter.endTable();
 
+    formatter.endl();
+
+    pdf::PDFMemoryReport memoryReport;
+    document.collectMemoryUsage(&memoryReport);
+
+    formatter.beginTable("memory", PDFToolTranslationContext::tr("Memory usage (estimate):"));
+
+    formatter.beginTableHeaderRow("header");
+    formatter.writeTableHeaderColumn("item", PDFToolTranslationContext::tr("Item"), Qt::AlignLeft);
+    formatter.writeTableHeaderColumn("count", PDFToolTranslationContext::tr("Count"), Qt::AlignRight);
+    formatter.writeTableHeaderColumn("size", PDFToolTranslationContext::tr("Size"), Qt::AlignRight);
+    formatter.endTableHeaderRow();
+
+    auto writeMemoryItem = [&formatter, &locale](const QString& name, qint64 count, qint64 bytes)
+    {
+        formatter.beginTableRow("item");
+        formatter.writeTableColumn("item", name);
+        formatter.writeTableColumn("count", count >= 0 ? locale.toString(count) : QString(), Qt::AlignRight);
+        formatter.writeTableColumn("size", pdf::PDFMemoryReport::formatBytes(bytes), Qt::AlignRight);
+        formatter.endTableRow();
+    };
+
+    for (const pdf::PDFMemoryReport::Item& item : memoryReport.getItems())
+    {
+        writeMemoryItem(item.name, item.count, item.bytes);
+    }
+    writeMemoryItem(PDFToolTranslationContext::tr("Total"), -1, memoryReport.getTotalBytes());
+
+    const qint64 processMemoryUsage = pdf::PDFMemoryAccounting::getProcessMemoryUsage();
+    if (processMemoryUsage >= 0)
+    {
+        writeMemoryItem(PDFToolTranslationContext::tr("Process"), -1, processMemoryUsage);
+    }
+
+    formatter.endTable();
+
     if (options.computeHashes)
     {
         formatter.endl();
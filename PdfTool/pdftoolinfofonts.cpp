@@ -52,6 +52,69 @@ QString PDFToolInfoFonts::getStandardString(StandardString standardString) const
     return QString();
 }
 
+/// Collects fonts from the resource dictionary, and recursively from resource
+/// dictionaries of form XObjects, tiling patterns and Type 3 fonts.
+/// \param document Document
+/// \param resources Resource dictionary
+/// \param fonts Collected fonts (resource name and font object)
+/// \param visitedObjects Already visited objects (to avoid cycles)
+static void collectFonts(const pdf::PDFDocument* document,
+                         const pdf::PDFObject& resources,
+                         std::vector<std::pair<QByteArray, pdf::PDFObject>>& fonts,
+                         std::set<pdf::PDFObjectReference>& visitedObjects)
+{
+    const pdf::PDFDictionary* resourcesDictionary = document->getDictionaryFromObject(resources);
+    if (!resourcesDictionary)
+    {
+        return;
+    }
+
+    // Returns false, if object was already visited
+    auto visit = [&visitedObjects](const pdf::PDFObject& object)
+    {
+        return !object.isReference() || visitedObjects.insert(object.getReference()).second;
+    };
+
+    if (const pdf::PDFDictionary* fontsDictionary = document->getDictionaryFromObject(resourcesDictionary->get("Font")))
+    {
+        for (size_t i = 0, count = fontsDictionary->getCount(); i < count; ++i)
+        {
+            const pdf::PDFObject& fontObject = fontsDictionary->getValue(i);
+            fonts.emplace_back(fontsDictionary->getKey(i).getString(), fontObject);
+
+            // Type 3 fonts can have their own resources
+            const pdf::PDFDictionary* fontDictionary = document->getDictionaryFromObject(fontObject);
+            if (fontDictionary && fontDictionary->hasKey("Resources") && visit(fontObject))
+            {
+                collectFonts(document, fontDictionary->get("Resources"), fonts, visitedObjects);
+            }
+        }
+    }
+
+    for (const char* key : { "XObject", "Pattern" })
+    {
+        if (const pdf::PDFDictionary* dictionary = document->getDictionaryFromObject(resourcesDictionary->get(key)))
+        {
+            for (size_t i = 0, count = dictionary->getCount(); i < count; ++i)
+            {
+                const pdf::PDFObject& object = dictionary->getValue(i);
+                if (!visit(object))
+                {
+                    continue;
+                }
+
+                // Forms and tiling patterns are streams with resources, images
+                // and shading patterns don't have resources.
+                const pdf::PDFObject& dereferencedObject = document->getObject(object);
+                if (dereferencedObject.isStream())
+                {
+                    collectFonts(document, dereferencedObject.getStream()->getDictionary()->get("Resources"), fonts, visitedObjects);
+                }
+            }
+        }
+    }
+}
+
 struct FontInfo
 {
     pdf::PDFClosedIntervalSet pages;
@@ -95,177 +158,185 @@ int PDFToolInfoFonts::execute(const PDFToolOptions& options)
         try
         {
             const pdf::PDFPage* page = document.getCatalog()->getPage(pageIndex);
-            if (const pdf::PDFDictionary* resourcesDictionary = document.getDictionaryFromObject(page->getResources()))
+
+            // Fonts are collected from resources of the page, and from resources of
+            // nested forms, patterns and Type 3 fonts, content streams are not processed.
+            std::vector<std::pair<QByteArray, pdf::PDFObject>> fonts;
+            std::set<pdf::PDFObjectReference> visitedObjects;
+            collectFonts(&document, page->getResources(), fonts, visitedObjects);
+
+            // Iterate trough each font
+            for (const auto& [fontKey, object] : fonts)
             {
-                if (const pdf::PDFDictionary* fontsDictionary = document.getDictionaryFromObject(resourcesDictionary->get("Font")))
+                pdf::PDFObjectReference fontReference;
+                if (object.isReference())
+                {
+                    // Check, if we have not processed the object. If we have it processed,
+                    // then do nothing, otherwise insert it into the processed objects.
+                    // We must also use mutex, because we use multithreading.
+                    QMutexLocker lock(&mutex);
+                    if (usedFontReferences.count(object.getReference()))
+                    {
+                        fontInfoMap[object.getReference()].pages.addValue(pageIndex + 1);
+                        continue;
+                    }
+                    else
+                    {
+                        fontReference = object.getReference();
+                        usedFontReferences.insert(fontReference);
+                    }
+                }
+
+                try
                 {
-                    // Iterate trough each font
-                    const size_t fontsCount = fontsDictionary->getCount();
-                    for (size_t i = 0; i < fontsCount; ++i)
+                    if (pdf::PDFFontPointer font = pdf::PDFFont::createFont(object, fontKey, &document))
                     {
-                        pdf::PDFObjectReference fontReference;
-                        pdf::PDFObject object = fontsDictionary->getValue(i);
-                        if (object.isReference())
+                        const pdf::FontType fontType = font->getFontType();
+                        const pdf::FontDescriptor* fontDescriptor = font->getFontDescriptor();
+                        const bool isEmbedded = fontDescriptor->isEmbedded() || fontType == pdf::FontType::Type3;
+
+                        // Font program is loaded only, if we need substituted font,
+                        // or character map of the embedded font.
+                        pdf::PDFRealizedFontPointer realizedFont;
+                        if (!isEmbedded || options.showCharacterMapsForEmbeddedFonts)
                         {
-                            // Check, if we have not processed the object. If we have it processed,
-                            // then do nothing, otherwise insert it into the processed objects.
-                            // We must also use mutex, because we use multithreading.
-                            QMutexLocker lock(&mutex);
-                            if (usedFontReferences.count(object.getReference()))
-                            {
-                                fontInfoMap[object.getReference()].pages.addValue(pageIndex + 1);
-                                continue;
-                            }
-                            else
-                            {
-                                fontReference = object.getReference();
-                                usedFontReferences.insert(fontReference);
-                            }
+                            pdf::PDFRenderErrorReporterDummy dummyReporter;
+                            realizedFont = pdf::PDFRealizedFont::createRealizedFont(font, 8.0, &dummyReporter);
                         }
 
-                        try
+                        if (realizedFont || isEmbedded)
                         {
-                            if (pdf::PDFFontPointer font = pdf::PDFFont::createFont(object, fontsDictionary->getKey(i).getString(), &document))
+                            QString fontName = fontDescriptor->fontName;
+                            QString fontFullName = fontName;
+                            int plusPos = fontName.lastIndexOf('+');
+
+                            // Jakub Melka: Detect, if font is subset. Font subsets have special form,
+                            // according to chapter 9.9.2 of PDF 2.0 specification. The first 6 letters
+                            // of font name are uppercase alphabet letters, and 7'th character is '+' sign.
+                            bool isSubset = false;
+                            if (plusPos == 6)
                             {
-                                pdf::PDFRenderErrorReporterDummy dummyReporter;
-                                pdf::PDFRealizedFontPointer realizedFont = pdf::PDFRealizedFont::createRealizedFont(font, 8.0, &dummyReporter);
-                                if (realizedFont)
+                                isSubset = true;
+                                for (int iFontName = 0; iFontName < 6; ++iFontName)
                                 {
-                                    const pdf::FontType fontType = font->getFontType();
-                                    const pdf::FontDescriptor* fontDescriptor = font->getFontDescriptor();
-                                    QString fontName = fontDescriptor->fontName;
-                                    QString fontFullName = fontName;
-                                    int plusPos = fontName.lastIndexOf('+');
-
-                                    // Jakub Melka: Detect, if font is subset. Font subsets have special form,
-                                    // according to chapter 9.9.2 of PDF 2.0 specification. The first 6 letters
-                                    // of font name are uppercase alphabet letters, and 7'th character is '+' sign.
-                                    bool isSubset = false;
-                                    if (plusPos == 6)
-                                    {
-                                        isSubset = true;
-                                        for (int iFontName = 0; iFontName < 6; ++iFontName)
-                                        {
-                                            QChar character = fontName[iFontName];
-                                            if (!character.isLetter() || !character.isUpper())
-                                            {
-                                                isSubset = false;
-                                                break;
-                                            }
-                                        }
-                                    }
-
-                                    // Try to remove characters from +, if we have font name 'SDFDSF+ValidFontName'
-                                    if (plusPos != -1 && plusPos < fontName.size() - 1)
+                                    QChar character = fontName[iFontName];
+                                    if (!character.isLetter() || !character.isUpper())
                                     {
-                                        fontName = fontName.mid(plusPos + 1);
+                                        isSubset = false;
+                                        break;
                                     }
+                                }
+                            }
 
-                                    if (fontName.isEmpty())
-                                    {
-                                        fontName = QString::fromLatin1(fontsDictionary->getKey(i).getString());
-                                    }
+                            // Try to remove characters from +, if we have font name 'SDFDSF+ValidFontName'
+                            if (plusPos != -1 && plusPos < fontName.size() - 1)
+                            {
+                                fontName = fontName.mid(plusPos + 1);
+                            }
 
-                                    QString fontTypeName;
-                                    switch (fontType)
-                                    {
-                                        case pdf::FontType::Type0:
-                                            fontTypeName = PDFToolTranslationContext::tr("Type 0 (CID)");
-                                            break;
+                            if (fontName.isEmpty())
+                            {
+                                fontName = QString::fromLatin1(fontKey);
+                            }
 
-                                        case pdf::FontType::Type1:
-                                            fontTypeName = PDFToolTranslationContext::tr("Type 1 (8 bit)");
-                                            break;
+                            QString fontTypeName;
+                            switch (fontType)
+                            {
+                                case pdf::FontType::Type0:
+                                    fontTypeName = PDFToolTranslationContext::tr("Type 0 (CID)");
+                                    break;
 
-                                        case pdf::FontType::MMType1:
-                                            fontTypeName = PDFToolTranslationContext::tr("MM Type 1 (8 bit)");
-                                            break;
+                                case pdf::FontType::Type1:
+                                    fontTypeName = PDFToolTranslationContext::tr("Type 1 (8 bit)");
+                                    break;
 
-                                        case pdf::FontType::TrueType:
-                                            fontTypeName = PDFToolTranslationContext::tr("TrueType (8 bit)");
-                                            break;
+                                case pdf::FontType::MMType1:
+                                    fontTypeName = PDFToolTranslationContext::tr("MM Type 1 (8 bit)");
+                                    break;
 
-                                        case pdf::FontType::Type3:
-                                            fontTypeName = PDFToolTranslationContext::tr("Type 3");
-                                            break;
+                                case pdf::FontType::TrueType:
+                                    fontTypeName = PDFToolTranslationContext::tr("TrueType (8 bit)");
+                                    break;
 
-                                        default:
-                                            Q_ASSERT(false);
-                                            break;
-                                    }
+                                case pdf::FontType::Type3:
+                                    fontTypeName = PDFToolTranslationContext::tr("Type 3");
+                                    break;
 
-                                    const pdf::PDFFontCMap* toUnicode = font->getToUnicode();
+                                default:
+                                    Q_ASSERT(false);
+                                    break;
+                            }
 
-                                    FontInfo info;
-                                    info.fontName = fontName;
-                                    info.fontFullName = fontFullName;
-                                    info.pages.addValue(pageIndex + 1);
-                                    info.fontTypeName = fontTypeName;
-                                    info.isEmbedded = fontDescriptor->isEmbedded() || fontType == pdf::FontType::Type3;
-                                    info.isSubset = isSubset;
-                                    info.isToUnicodePresent = toUnicode && toUnicode->isValid();
-                                    info.reference = fontReference;
-                                    info.substitutedFont = realizedFont->getPostScriptName();
+                            const pdf::PDFFontCMap* toUnicode = font->getToUnicode();
 
-                                    if (options.showCharacterMapsForEmbeddedFonts && info.isEmbedded)
-                                    {
-                                        info.characterInfos = realizedFont->getCharacterInfos();
-                                    }
+                            FontInfo info;
+                            info.fontName = fontName;
+                            info.fontFullName = fontFullName;
+                            info.pages.addValue(pageIndex + 1);
+                            info.fontTypeName = fontTypeName;
+                            info.isEmbedded = isEmbedded;
+                            info.isSubset = isSubset;
+                            info.isToUnicodePresent = toUnicode && toUnicode->isValid();
+                            info.reference = fontReference;
+                            info.substitutedFont = realizedFont ? realizedFont->getPostScriptName() : QString();
 
-                                    const pdf::PDFSimpleFont* simpleFont = dynamic_cast<const pdf::PDFSimpleFont*>(font.data());
-                                    if (simpleFont)
-                                    {
-                                        const pdf::PDFEncoding::Encoding encoding = simpleFont->getEncodingType();
-                                        switch (encoding)
-                                        {
-                                            case pdf::PDFEncoding::Encoding::Standard:
-                                                info.encoding = PDFToolTranslationContext::tr("Standard");
-                                                break;
-                                            case pdf::PDFEncoding::Encoding::MacRoman:
-                                                info.encoding = PDFToolTranslationContext::tr("MacRoman");
-                                                break;
-                                            case pdf::PDFEncoding::Encoding::WinAnsi:
-                                                info.encoding = PDFToolTranslationContext::tr("WinAnsi");
-                                                break;
-                                            case pdf::PDFEncoding::Encoding::PDFDoc:
-                                                info.encoding = PDFToolTranslationContext::tr("PDFDoc");
-                                                break;
-                                            case pdf::PDFEncoding::Encoding::MacExpert:
-                                                info.encoding = PDFToolTranslationContext::tr("MacExpert");
-                                                break;
-                                            case pdf::PDFEncoding::Encoding::Symbol:
-                                                info.encoding = PDFToolTranslationContext::tr("Symbol");
-                                                break;
-                                            case pdf::PDFEncoding::Encoding::ZapfDingbats:
-                                                info.encoding = PDFToolTranslationContext::tr("ZapfDingbats");
-                                                break;
-
-                                            default:
-                                                info.encoding = PDFToolTranslationContext::tr("Custom");
-                                                break;
-                                        }
-                                    }
+                            if (options.showCharacterMapsForEmbeddedFonts && info.isEmbedded && realizedFont)
+                            {
+                                info.characterInfos = realizedFont->getCharacterInfos();
+                            }
 
-                                    QMutexLocker lock(&mutex);
-                                    if (fontReference.isValid())
-                                    {
-                                        info.pages.merge(fontInfoMap[fontReference].pages);
-                                        fontInfoMap[fontReference] = qMove(info);
-                                    }
-                                    else
-                                    {
-                                        directFonts.emplace_back(qMove(info));
-                                    }
+                            const pdf::PDFSimpleFont* simpleFont = dynamic_cast<const pdf::PDFSimpleFont*>(font.data());
+                            if (simpleFont)
+                            {
+                                const pdf::PDFEncoding::Encoding encoding = simpleFont->getEncodingType();
+                                switch (encoding)
+                                {
+                                    case pdf::PDFEncoding::Encoding::Standard:
+                                        info.encoding = PDFToolTranslationContext::tr("Standard");
+                                        break;
+                                    case pdf::PDFEncoding::Encoding::MacRoman:
+                                        info.encoding = PDFToolTranslationContext::tr("MacRoman");
+                                        break;
+                                    case pdf::PDFEncoding::Encoding::WinAnsi:
+                                        info.encoding = PDFToolTranslationContext::tr("WinAnsi");
+                                        break;
+                                    case pdf::PDFEncoding::Encoding::PDFDoc:
+                                        info.encoding = PDFToolTranslationContext::tr("PDFDoc");
+                                        break;
+                                    case pdf::PDFEncoding::Encoding::MacExpert:
+                                        info.encoding = PDFToolTranslationContext::tr("MacExpert");
+                                        break;
+                                    case pdf::PDFEncoding::Encoding::Symbol:
+                                        info.encoding = PDFToolTranslationContext::tr("Symbol");
+                                        break;
+                                    case pdf::PDFEncoding::Encoding::ZapfDingbats:
+                                        info.encoding = PDFToolTranslationContext::tr("ZapfDingbats");
+                                        break;
+
+                                    default:
+                                        info.encoding = PDFToolTranslationContext::tr("Custom");
+                                        break;
                                 }
                             }
-                        }
-                        catch (const pdf::PDFException &)
-                        {
-                            // Do nothing, some error occured, continue with next font
-                            continue;
+
+                            QMutexLocker lock(&mutex);
+                            if (fontReference.isValid())
+                            {
+                                info.pages.merge(fontInfoMap[fontReference].pages);
+                                fontInfoMap[fontReference] = qMove(info);
+                            }
+                            else
+                            {
+                                directFonts.emplace_back(qMove(info));
+                            }
                         }
                     }
                 }
+                catch (const pdf::PDFException &)
+                {
+                    // Do nothing, some error occured, continue with next font
+                    continue;
+                }
             }
         }
         catch (const pdf::PDFException &)
@@ -21,8 +21,11 @@
 // SOFTWARE.
 
 #include "pdftoolinkcoverage.h"
+#include "pdftoolperformancereport.h"
 #include "pdftransparencyrenderer.h"
 
+#include <QElapsedTimer>
+
 namespace pdftool
 {
 
@@ -81,14 +84,21 @@ int PDFToolInkCoverageApplication::execute(const PDFToolOptions& options)
     pdf::PDFInkMapper inkMapper(&cmsManager, &document);
     inkMapper.createSpotColors(true);
 
+    pdf::PDFTransparencyRendererSettings settings;
+    settings.bandHeight = options.inkCoverageBandHeight;
+
     pdf::PDFInkCoverageCalculator calculator(&document,
                                              &fontCache,
                                              &cmsManager,
                                              &optionalContentActivity,
                                              &inkMapper,
                                              nullptr,
-                                             pdf::PDFTransparencyRendererSettings());
+                                             settings);
+    calculator.setMemoryLimit(options.inkCoverageMemoryLimit * 1024 * 1024);
+    QElapsedTimer timer;
+    timer.start();
     calculator.perform(QSize(1920, 1920), pageIndices);
+    const qint64 wallTime = timer.elapsed();
 
     fontCache.setCacheShrinkEnabled(nullptr, true);
 
@@ -181,12 +191,30 @@ int PDFToolInkCoverageApplication::execute(const PDFToolOptions& options)
     formatter.endDocument();
     PDFConsole::writeText(formatter.getString(), options.outputCodec);
 
+    if (!options.performanceReportFile.isEmpty())
+    {
+        PDFToolPerformanceReport report(getStandardString(Command));
+        report.setValue("document", options.document);
+        report.setValue("wall-time", wallTime);
+
+        for (const pdf::PDFInteger pageIndex : pageIndices)
+        {
+            const qint64 pageTime = calculator.getPageTime(pageIndex);
+            if (pageTime >= 0)
+            {
+                report.setPageValue(pageIndex, "total-time", pageTime);
+            }
+        }
+
+        writePerformanceReport(options, report);
+    }
+
     return ExitSuccess;
 }
 
 PDFToolAbstractApplication::Options PDFToolInkCoverageApplication::getOptionsFlags() const
 {
-    return ConsoleFormat | OpenDocument | PageSelector | ColorManagementSystem;
+    return ConsoleFormat | OpenDocument | PageSelector | ColorManagementSystem | InkCoverage | PerformanceReport;
 }
 
 }   // namespace pdftool
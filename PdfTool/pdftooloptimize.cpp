@@ -23,6 +23,8 @@
 #include "pdftooloptimize.h"
 #include "pdfdocumentwriter.h"
 
+#include <QSaveFile>
+
 namespace pdftool
 {
 
@@ -51,12 +53,23 @@ QString PDFToolOptimize::getStandardString(PDFToolAbstractApplication::StandardS
 
 int PDFToolOptimize::execute(const PDFToolOptions& options)
 {
-    if (!options.optimizeFlags)
+    if (!options.optimizeFlags && !options.optimizeObjectStreams && !options.optimizeLinearize)
     {
         PDFConsole::writeError(PDFToolTranslationContext::tr("No optimization option has been set."), options.outputCodec);
         return ErrorInvalidArguments;
     }
 
+    if (options.optimizeObjectStreams && options.optimizeLinearize)
+    {
+        PDFConsole::writeError(PDFToolTranslationContext::tr("Object streams can't be used in linearized document."), options.outputCodec);
+        return ErrorInvalidArguments;
+    }
+
+    if (options.optimizeStreaming)
+    {
+        return executeStreaming(options);
+    }
+
     pdf::PDFDocument document;
     QByteArray sourceData;
     if (!readDocument(options, document, &sourceData, false))
@@ -65,12 +78,22 @@ int PDFToolOptimize::execute(const PDFToolOptions& options)
     }
 
     pdf::PDFOptimizer optimizer(options.optimizeFlags, nullptr);
+    optimizer.setImageSettings(options.optimizeImageSettings);
     QObject::connect(&optimizer, &pdf::PDFOptimizer::optimizationProgress, &optimizer, [&options](QString text) { PDFConsole::writeError(text, options.outputCodec); }, Qt::DirectConnection);
     optimizer.setDocument(&document);
     optimizer.optimize();
     document = optimizer.takeOptimizedDocument();
 
     pdf::PDFDocumentWriter writer(nullptr);
+    if (options.optimizeObjectStreams)
+    {
+        writer.setMode(pdf::PDFDocumentWriter::Mode::Compressed);
+    }
+    else if (options.optimizeLinearize)
+    {
+        writer.setMode(pdf::PDFDocumentWriter::Mode::Linearized);
+    }
+
     pdf::PDFOperationResult result = writer.write(options.document, &document, true);
     if (!result)
     {
@@ -81,6 +104,44 @@ int PDFToolOptimize::execute(const PDFToolOptions& options)
     return ExitSuccess;
 }
 
+int PDFToolOptimize::executeStreaming(const PDFToolOptions& options)
+{
+    if (options.optimizeLinearize)
+    {
+        PDFConsole::writeError(PDFToolTranslationContext::tr("Linearized document can't be written in streaming mode."), options.outputCodec);
+        return ErrorInvalidArguments;
+    }
+
+    // Source document is memory mapped during optimization, optimized
+    // document is written to the temporary file, which replaces it at the end.
+    QSaveFile file(options.document);
+    if (!file.open(QFile::WriteOnly))
+    {
+        PDFConsole::writeError(PDFToolTranslationContext::tr("Failed to write optimize document. %1").arg(file.errorString()), options.outputCodec);
+        return ErrorFailedWriteToFile;
+    }
+
+    pdf::PDFOptimizer optimizer(options.optimizeFlags, nullptr);
+    QObject::connect(&optimizer, &pdf::PDFOptimizer::optimizationProgress, &optimizer, [&options](QString text) { PDFConsole::writeError(text, options.outputCodec); }, Qt::DirectConnection);
+
+    const pdf::PDFStreamingDocumentWriter::Mode mode = options.optimizeObjectStreams ? pdf::PDFStreamingDocumentWriter::Mode::Compressed : pdf::PDFStreamingDocumentWriter::Mode::Classic;
+    pdf::PDFOperationResult result = optimizer.optimizeStreaming(options.document, &file, mode);
+    if (!result)
+    {
+        file.cancelWriting();
+        PDFConsole::writeError(PDFToolTranslationContext::tr("Failed to write optimize document. %1").arg(result.getErrorMessage()), options.outputCodec);
+        return ErrorFailedWriteToFile;
+    }
+
+    if (!file.commit())
+    {
+        PDFConsole::writeError(PDFToolTranslationContext::tr("Failed to write optimize document. %1").arg(file.errorString()), options.outputCodec);
+        return ErrorFailedWriteToFile;
+    }
+
+    return ExitSuccess;
+}
+
 PDFToolAbstractApplication::Options PDFToolOptimize::getOptionsFlags() const
 {
     return ConsoleFormat | OpenDocument | Optimize;
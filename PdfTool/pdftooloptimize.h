@@ -34,6 +34,10 @@ public:
     virtual QString getStandardString(StandardString standardString) const override;
     virtual int execute(const PDFToolOptions& options) override;
     virtual Options getOptionsFlags() const override;
+
+private:
+    /// Optimizes document without loading it into the memory
+    int executeStreaming(const PDFToolOptions& options);
 };
 
 }   // namespace pdftool
@@ -0,0 +1,202 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pdftoolperformancereport.h"
+#include "pdftoolabstractapplication.h"
+
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStringList>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
+
+#include <algorithm>
+
+#if defined(Q_OS_WIN)
+#include <Windows.h>
+#include <Psapi.h>
+#elif defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+namespace pdftool
+{
+
+PDFToolPerformanceReport::PDFToolPerformanceReport(QString command) :
+    m_command(qMove(command))
+{
+
+}
+
+void PDFToolPerformanceReport::setValue(const QString& key, QVariant value)
+{
+    QMutexLocker lock(&m_mutex);
+    setValueImpl(m_values, key, qMove(value));
+}
+
+void PDFToolPerformanceReport::setPageValue(pdf::PDFInteger pageIndex, const QString& key, QVariant value)
+{
+    QMutexLocker lock(&m_mutex);
+    setValueImpl(m_pageValues[pageIndex], key, qMove(value));
+}
+
+bool PDFToolPerformanceReport::write(const QString& fileName, QString* errorMessage)
+{
+    const qint64 peakMemory = getPeakMemoryUsage();
+    if (peakMemory >= 0)
+    {
+        setValue("peak-memory", peakMemory);
+    }
+
+    const bool isJson = QFileInfo(fileName).suffix().compare("json", Qt::CaseInsensitive) == 0;
+
+    QSaveFile file(fileName);
+    if (!file.open(QSaveFile::WriteOnly | QSaveFile::Truncate))
+    {
+        *errorMessage = PDFToolTranslationContext::tr("Cannot open file '%1' for writing performance report.").arg(fileName);
+        return false;
+    }
+
+    QMutexLocker lock(&m_mutex);
+    file.write(isJson ? createJson() : createCsv());
+
+    if (!file.commit())
+    {
+        *errorMessage = PDFToolTranslationContext::tr("Cannot write performance report to file '%1'. %2").arg(fileName, file.errorString());
+        return false;
+    }
+
+    return true;
+}
+
+qint64 PDFToolPerformanceReport::getPeakMemoryUsage()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters = { };
+    if (K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return qint64(counters.PeakWorkingSetSize);
+    }
+#elif defined(Q_OS_UNIX)
+    rusage usage = { };
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+#if defined(Q_OS_MACOS)
+        // On macOS, maximal resident set size is in bytes
+        return qint64(usage.ru_maxrss);
+#else
+        // On Linux, maximal resident set size is in kilobytes
+        return qint64(usage.ru_maxrss) * 1024;
+#endif
+    }
+#endif
+
+    return -1;
+}
+
+void PDFToolPerformanceReport::setValueImpl(Values& values, const QString& key, QVariant value)
+{
+    auto it = std::find_if(values.begin(), values.end(), [&key](const auto& item) { return item.first == key; });
+    if (it != values.end())
+    {
+        it->second = qMove(value);
+    }
+    else
+    {
+        values.emplace_back(key, qMove(value));
+    }
+}
+
+QByteArray PDFToolPerformanceReport::createJson() const
+{
+    auto createObject = [](const Values& values)
+    {
+        QJsonObject object;
+        for (const auto& item : values)
+        {
+            object[item.first] = QJsonValue::fromVariant(item.second);
+        }
+        return object;
+    };
+
+    QJsonArray pages;
+    for (const auto& pageValues : m_pageValues)
+    {
+        QJsonObject page = createObject(pageValues.second);
+        page["page"] = pageValues.first + 1;
+        pages.append(page);
+    }
+
+    QJsonObject report;
+    report["command"] = m_command;
+    report["document"] = createObject(m_values);
+    report["pages"] = pages;
+
+    return QJsonDocument(report).toJson(QJsonDocument::Indented);
+}
+
+QByteArray PDFToolPerformanceReport::createCsv() const
+{
+    // Columns are union of page value keys in order of first occurrence,
+    // document values are written as comment lines before the table.
+    QStringList columns;
+    for (const auto& pageValues : m_pageValues)
+    {
+        for (const auto& item : pageValues.second)
+        {
+            if (!columns.contains(item.first))
+            {
+                columns << item.first;
+            }
+        }
+    }
+
+    QByteArray result;
+    result += QString("# command,%1\n").arg(m_command).toUtf8();
+    for (const auto& item : m_values)
+    {
+        result += QString("# %1,%2\n").arg(item.first, item.second.toString()).toUtf8();
+    }
+
+    QStringList row;
+    row << "page" << columns;
+    result += row.join(',').toUtf8() + '\n';
+
+    for (const auto& pageValues : m_pageValues)
+    {
+        row.clear();
+        row << QString::number(pageValues.first + 1);
+
+        for (const QString& column : columns)
+        {
+            auto it = std::find_if(pageValues.second.cbegin(), pageValues.second.cend(), [&column](const auto& item) { return item.first == column; });
+            row << (it != pageValues.second.cend() ? it->second.toString() : QString());
+        }
+
+        result += row.join(',').toUtf8() + '\n';
+    }
+
+    return result;
+}
+
+}   // namespace pdftool
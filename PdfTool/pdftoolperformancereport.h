@@ -0,0 +1,86 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef PDFTOOLPERFORMANCEREPORT_H
+#define PDFTOOLPERFORMANCEREPORT_H
+
+#include "pdfglobal.h"
+
+#include <QMutex>
+#include <QString>
+#include <QVariant>
+
+#include <map>
+#include <vector>
+
+namespace pdftool
+{
+
+/// Machine readable performance report of the command. Report consists of
+/// document values (for example, wall time) and of per-page values (for example,
+/// page compile time). Page values can be set from multiple threads. Report
+/// is written either in JSON format (if file has 'json' suffix), or in CSV format,
+/// where each row corresponds to one page.
+class PDFToolPerformanceReport
+{
+public:
+    explicit PDFToolPerformanceReport(QString command);
+
+    /// Sets document value
+    /// \param key Key
+    /// \param value Value
+    void setValue(const QString& key, QVariant value);
+
+    /// Sets page value. This function is thread safe.
+    /// \param pageIndex Page index (zero based)
+    /// \param key Key
+    /// \param value Value
+    void setPageValue(pdf::PDFInteger pageIndex, const QString& key, QVariant value);
+
+    /// Writes report to the file. Peak memory of the process is added to the
+    /// document values, if it can be determined. If error occurs, then false
+    /// is returned and error message is filled.
+    /// \param fileName Target file name
+    /// \param[out] errorMessage Error message
+    bool write(const QString& fileName, QString* errorMessage);
+
+    /// Returns peak resident memory of the process in bytes, or -1,
+    /// if it can't be determined on current platform.
+    static qint64 getPeakMemoryUsage();
+
+private:
+    using Values = std::vector<std::pair<QString, QVariant>>;
+
+    static void setValueImpl(Values& values, const QString& key, QVariant value);
+
+    QByteArray createJson() const;
+    QByteArray createCsv() const;
+
+    QString m_command;
+    Values m_values;
+    std::map<pdf::PDFInteger, Values> m_pageValues;
+    QMutex m_mutex;
+};
+
+}   // namespace pdftool
+
+#endif // PDFTOOLPERFORMANCEREPORT_H
@@ -60,6 +60,13 @@ int PDFToolRedact::execute(const PDFToolOptions& options)
         return ErrorInvalidArguments;
     }
 
+    QRegularExpression redactedTextExpression(options.redactText);
+    if (!redactedTextExpression.isValid())
+    {
+        PDFConsole::writeError(PDFToolTranslationContext::tr("Invalid regular expression of redacted text. %1").arg(redactedTextExpression.errorString()), options.outputCodec);
+        return ErrorInvalidArguments;
+    }
+
     pdf::PDFDocument document;
     QByteArray sourceData;
     if (!readDocument(options, document, &sourceData, false))
@@ -80,6 +87,7 @@ int PDFToolRedact::execute(const PDFToolOptions& options)
     fontCache.setCacheShrinkEnabled(nullptr, false);
 
     pdf::PDFRedact redactor(&document, &fontCache, cms.get(), &optionalContentActivity, &meshQualitySettings, Qt::black);
+    redactor.setRedactedTextExpression(qMove(redactedTextExpression));
     pdf::PDFDocument redactedDocument = redactor.perform(options.redactOptions);
 
     pdf::PDFDocumentWriter writer(nullptr);
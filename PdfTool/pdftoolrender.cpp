@@ -21,12 +21,17 @@
 // SOFTWARE.
 
 #include "pdftoolrender.h"
+#include "pdftoolperformancereport.h"
 #include "pdffont.h"
 #include "pdfconstants.h"
 
+#include <QDir>
+#include <QFile>
 #include <QColorSpace>
 #include <QElapsedTimer>
 
+#include <set>
+
 namespace pdftool
 {
 
@@ -56,7 +61,7 @@ QString PDFToolRender::getStandardString(PDFToolAbstractApplication::StandardStr
 
 PDFToolAbstractApplication::Options PDFToolRender::getOptionsFlags() const
 {
-    return ConsoleFormat | OpenDocument | PageSelector | ImageWriterSettings | ImageExportSettingsFiles | ImageExportSettingsResolution | ColorManagementSystem | RenderFlags;
+    return ConsoleFormat | OpenDocument | PageSelector | ImageWriterSettings | ImageExportSettingsFiles | ImageExportSettingsResolution | ColorManagementSystem | RenderFlags | PerformanceReport;
 }
 
 void PDFToolRender::finish(const PDFToolOptions& options)
@@ -79,24 +84,93 @@ void PDFToolRender::finish(const PDFToolOptions& options)
 void PDFToolRender::onPageRendered(const PDFToolOptions& options, pdf::PDFRenderedPageImage& renderedPageImage)
 {
     writePageInfoStatistics(renderedPageImage);
+
     QString fileName = options.imageExportSettings.getOutputFileName(renderedPageImage.pageIndex, options.imageWriterSettings.getCurrentFormat());
+    scheduleWriteImage(options, qMove(renderedPageImage.pageImage), renderedPageImage.pageIndex, { fileName });
+}
+
+void PDFToolRender::onTileRendered(const PDFToolOptions& options, pdf::PDFRenderedTileImage& renderedTileImage, const QStringList& fileNames)
+{
+    writeTileInfoStatistics(renderedTileImage);
+
+    QStringList filePaths;
+    filePaths.reserve(fileNames.size());
+    for (const QString& fileName : fileNames)
+    {
+        filePaths << QDir::toNativeSeparators(QString("%1/%2").arg(options.imageExportSettings.getDirectory(), fileName));
+    }
+
+    scheduleWriteImage(options, qMove(renderedTileImage.tileImage), renderedTileImage.tile.pageIndex, qMove(filePaths));
+}
+
+void PDFToolRender::scheduleWriteImage(const PDFToolOptions& options, QImage image, pdf::PDFInteger pageIndex, QStringList fileNames)
+{
+    if (!m_encoderPool)
+    {
+        writeImage(options, image, pageIndex, fileNames);
+        return;
+    }
+
+    // Image is handed to the encoder threads, so rendering thread can continue
+    // with the next page. If too many images are waiting, we must wait too,
+    // otherwise rendered images could consume a lot of memory.
+    m_pendingImageSlots->acquire();
+
+    const PDFToolOptions* encoderOptions = m_options;
+    m_encoderPool->start([this, encoderOptions, image = qMove(image), pageIndex, fileNames = qMove(fileNames)]()
+    {
+        writeImage(*encoderOptions, image, pageIndex, fileNames);
+        m_pendingImageSlots->release();
+    });
+}
+
+void PDFToolRender::beginRendering(const PDFToolOptions& options)
+{
+    m_options = &options;
+
+    if (options.renderEncoderCount > 0)
+    {
+        m_encoderPool = std::make_unique<QThreadPool>();
+        m_encoderPool->setMaxThreadCount(options.renderEncoderCount);
+        m_pendingImageSlots = std::make_unique<QSemaphore>(options.renderEncoderCount * MAX_PENDING_IMAGES_PER_ENCODER);
+    }
+}
+
+void PDFToolRender::endRendering()
+{
+    if (m_encoderPool)
+    {
+        m_encoderPool->waitForDone();
+        m_encoderPool.reset();
+        m_pendingImageSlots.reset();
+    }
+
+    m_options = nullptr;
+}
 
+void PDFToolRender::writeImage(const PDFToolOptions& options, const QImage& image, pdf::PDFInteger pageIndex, const QStringList& fileNames)
+{
     QElapsedTimer imageWriterTimer;
     imageWriterTimer.start();
 
-    QImageWriter imageWriter(fileName, options.imageWriterSettings.getCurrentFormat());
-    imageWriter.setSubType(options.imageWriterSettings.getCurrentSubtype());
-    imageWriter.setCompression(options.imageWriterSettings.getCompression());
-    imageWriter.setQuality(options.imageWriterSettings.getQuality());
-    imageWriter.setOptimizedWrite(options.imageWriterSettings.hasOptimizedWrite());
-    imageWriter.setProgressiveScanWrite(options.imageWriterSettings.hasProgressiveScanWrite());
-
-    if (!imageWriter.write(renderedPageImage.pageImage))
+    for (const QString& fileName : fileNames)
     {
-        m_pageInfo[renderedPageImage.pageIndex].errors.emplace_back(pdf::PDFRenderError(pdf::RenderErrorType::Error, PDFToolTranslationContext::tr("Cannot write page image to file '%1', because: %2.").arg(fileName).arg(imageWriter.errorString())));
+        QImageWriter imageWriter(fileName, options.imageWriterSettings.getCurrentFormat());
+        imageWriter.setSubType(options.imageWriterSettings.getCurrentSubtype());
+        imageWriter.setCompression(options.imageWriterSettings.getCompression());
+        imageWriter.setQuality(options.imageWriterSettings.getQuality());
+        imageWriter.setOptimizedWrite(options.imageWriterSettings.hasOptimizedWrite());
+        imageWriter.setProgressiveScanWrite(options.imageWriterSettings.hasProgressiveScanWrite());
+
+        if (!imageWriter.write(image))
+        {
+            addPageError(pageIndex, pdf::PDFRenderError(pdf::RenderErrorType::Error, PDFToolTranslationContext::tr("Cannot write page image to file '%1', because: %2.").arg(fileName).arg(imageWriter.errorString())));
+        }
     }
 
-    m_pageInfo[renderedPageImage.pageIndex].pageWriteTime = imageWriterTimer.elapsed();
+    // Tiles of the page are written from several threads, so write times are accumulated
+    QMutexLocker lock(&m_pageInfoMutex);
+    m_pageInfo[pageIndex].pageWriteTime += imageWriterTimer.elapsed();
 }
 
 QString PDFToolBenchmark::getStandardString(PDFToolAbstractApplication::StandardString standardString) const
@@ -122,7 +196,7 @@ QString PDFToolBenchmark::getStandardString(PDFToolAbstractApplication::Standard
 
 PDFToolAbstractApplication::Options PDFToolBenchmark::getOptionsFlags() const
 {
-    return ConsoleFormat | OpenDocument | PageSelector | ImageExportSettingsResolution | ColorManagementSystem | RenderFlags;
+    return ConsoleFormat | OpenDocument | PageSelector | ImageExportSettingsResolution | ColorManagementSystem | RenderFlags | PerformanceReport;
 }
 
 void PDFToolBenchmark::finish(const PDFToolOptions& options)
@@ -185,17 +259,19 @@ int PDFToolRenderBase::execute(const PDFToolOptions& options)
     fontCache.setDocument(md);
     fontCache.setCacheShrinkEnabled(nullptr, false);
 
+    m_pageInfo.clear();
     m_pageInfo.resize(document.getCatalog()->getPageCount());
     pdf::PDFRasterizerPool rasterizerPool(&document, &fontCache, &cmsManager,
                                           &optionalContentActivity, options.renderFeatures, meshQualitySettings,
                                           pdf::PDFRasterizerPool::getCorrectedRasterizerCount(options.renderRasterizerCount),
-                                          options.renderUseSoftwareRendering ? pdf::RendererEngine::QPainter : pdf::RendererEngine::Blend2D_SingleThread, nullptr);
+                                          options.renderUseSoftwareRendering ? pdf::RendererEngine::QPainter : pdf::RendererEngine::Blend2D_MultiThread, nullptr);
+    rasterizerPool.setThreadBudget(options.renderThreadBudget);
 
     auto onRenderError = [this](pdf::PDFInteger pageIndex, pdf::PDFRenderError error)
     {
         if (pageIndex != pdf::PDFCatalog::INVALID_PAGE_INDEX)
         {
-            m_pageInfo[pageIndex].errors.emplace_back(qMove(error));
+            addPageError(pageIndex, qMove(error));
         }
     };
     QObject holder;
@@ -233,13 +309,23 @@ int PDFToolRenderBase::execute(const PDFToolOptions& options)
     QElapsedTimer timer;
     timer.start();
 
-    rasterizerPool.render(pageIndices, imageSizeGetter, std::bind(&PDFToolRenderBase::onPageRendered, this, options, std::placeholders::_1), nullptr);
+    beginRendering(options);
+    if (optionFlags.testFlag(ImageExportSettingsFiles) && options.imageExportSettings.getPyramidMode() != pdf::PDFPageImageExportSettings::PyramidMode::None)
+    {
+        renderPyramids(options, document, pageIndices, imageSizeGetter, rasterizerPool);
+    }
+    else
+    {
+        rasterizerPool.render(pageIndices, imageSizeGetter, std::bind(&PDFToolRenderBase::onPageRendered, this, options, std::placeholders::_1), nullptr);
+    }
+    endRendering();
 
     m_wallTime = timer.elapsed();
 
     fontCache.setCacheShrinkEnabled(nullptr, true);
 
     finish(options);
+    writeRenderPerformanceReport(options);
     return ExitSuccess;
 }
 
@@ -251,9 +337,129 @@ void PDFToolRenderBase::writePageInfoStatistics(const pdf::PDFRenderedPageImage&
     info.pageWaitTime = renderedPageImage.pageWaitTime;
     info.pageRenderTime = renderedPageImage.pageRenderTime;
     info.pageTotalTime = renderedPageImage.pageTotalTime;
+    info.pageInstructionCount = renderedPageImage.pageInstructionCount;
+    info.pageMemoryConsumptionEstimate = renderedPageImage.pageMemoryConsumptionEstimate;
     info.pageIndex = renderedPageImage.pageIndex;
 }
 
+void PDFToolRenderBase::writeTileInfoStatistics(const pdf::PDFRenderedTileImage& renderedTileImage)
+{
+    // Page statistics are sums over all tiles of the page
+    QMutexLocker lock(&m_pageInfoMutex);
+    PageInfo& info = m_pageInfo[renderedTileImage.tile.pageIndex];
+    if (!info.isRendered)
+    {
+        info.isRendered = true;
+        info.pageIndex = renderedTileImage.tile.pageIndex;
+        info.pageCompileTime = renderedTileImage.pageCompileTime;
+        info.pageTotalTime = renderedTileImage.pageCompileTime;
+    }
+    info.pageWaitTime += renderedTileImage.tileWaitTime;
+    info.pageRenderTime += renderedTileImage.tileRenderTime;
+    info.pageTotalTime += renderedTileImage.tileWaitTime + renderedTileImage.tileRenderTime;
+}
+
+void PDFToolRenderBase::addPageError(pdf::PDFInteger pageIndex, pdf::PDFRenderError error)
+{
+    QMutexLocker lock(&m_pageInfoMutex);
+    m_pageInfo[pageIndex].errors.emplace_back(qMove(error));
+}
+
+void PDFToolRenderBase::renderPyramids(const PDFToolOptions& options,
+                                       const pdf::PDFDocument& document,
+                                       const std::vector<pdf::PDFInteger>& pageIndices,
+                                       const std::function<QSize(const pdf::PDFPage*)>& imageSizeGetter,
+                                       pdf::PDFRasterizerPool& rasterizerPool)
+{
+    const QByteArray imageFormat = options.imageWriterSettings.getCurrentFormat();
+    const QDir outputDirectory(options.imageExportSettings.getDirectory());
+
+    std::vector<pdf::PDFRasterizerTile> tiles;
+    std::vector<QStringList> tileFileNames;
+
+    for (pdf::PDFInteger pageIndex : pageIndices)
+    {
+        const pdf::PDFPage* page = document.getCatalog()->getPage(pageIndex);
+        if (!page)
+        {
+            addPageError(pageIndex, pdf::PDFRenderError(pdf::RenderErrorType::Error, PDFToolTranslationContext::tr("Page %1 not found.").arg(pageIndex + 1)));
+            continue;
+        }
+
+        const QString baseName = options.imageExportSettings.getOutputPyramidBaseName(pageIndex);
+        const pdf::PDFImagePyramid pyramid = options.imageExportSettings.createPyramid(imageSizeGetter(page));
+
+        // Directories are created here, before rendering, so encoder threads just write files
+        std::set<QString> directories;
+        for (pdf::PDFImagePyramid::Tile& tile : pyramid.createTiles(page, pageIndex, baseName, imageFormat))
+        {
+            for (const QString& fileName : tile.fileNames)
+            {
+                directories.insert(QFileInfo(outputDirectory.filePath(fileName)).path());
+            }
+
+            tiles.push_back(tile.tile);
+            tileFileNames.push_back(qMove(tile.fileNames));
+        }
+
+        const QString descriptorFileName = outputDirectory.filePath(pyramid.getDescriptorFileName(baseName));
+        directories.insert(QFileInfo(descriptorFileName).path());
+
+        for (const QString& directory : directories)
+        {
+            outputDirectory.mkpath(directory);
+        }
+
+        QFile file(descriptorFileName);
+        if (file.open(QFile::WriteOnly | QFile::Truncate))
+        {
+            file.write(pyramid.createDescriptor(baseName, imageFormat));
+            file.close();
+        }
+        else
+        {
+            addPageError(pageIndex, pdf::PDFRenderError(pdf::RenderErrorType::Error, PDFToolTranslationContext::tr("Cannot write image pyramid descriptor to file '%1', because: %2.").arg(descriptorFileName, file.errorString())));
+        }
+    }
+
+    auto onTileRenderedImpl = [this, &options, &tileFileNames](pdf::PDFRenderedTileImage& renderedTileImage)
+    {
+        onTileRendered(options, renderedTileImage, tileFileNames[renderedTileImage.tileIndex]);
+    };
+    rasterizerPool.renderTiles(tiles, onTileRenderedImpl, nullptr);
+}
+
+void PDFToolRenderBase::writeRenderPerformanceReport(const PDFToolOptions& options)
+{
+    if (options.performanceReportFile.isEmpty())
+    {
+        return;
+    }
+
+    PDFToolPerformanceReport report(getStandardString(Command));
+    report.setValue("document", options.document);
+    report.setValue("wall-time", m_wallTime);
+
+    for (const PageInfo& info : m_pageInfo)
+    {
+        if (!info.isRendered)
+        {
+            continue;
+        }
+
+        report.setPageValue(info.pageIndex, "compile-time", info.pageCompileTime);
+        report.setPageValue(info.pageIndex, "wait-time", info.pageWaitTime);
+        report.setPageValue(info.pageIndex, "render-time", info.pageRenderTime);
+        report.setPageValue(info.pageIndex, "write-time", info.pageWriteTime);
+        report.setPageValue(info.pageIndex, "total-time", info.pageTotalTime + info.pageWriteTime);
+        report.setPageValue(info.pageIndex, "instructions", qulonglong(info.pageInstructionCount));
+        report.setPageValue(info.pageIndex, "memory-estimate", info.pageMemoryConsumptionEstimate);
+        report.setPageValue(info.pageIndex, "errors", qulonglong(info.errors.size()));
+    }
+
+    writePerformanceReport(options, report);
+}
+
 void PDFToolRenderBase::writeStatistics(PDFOutputFormatter& formatter)
 {
     // Jakub Melka: Write overall statistics
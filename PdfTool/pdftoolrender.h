@@ -26,6 +26,12 @@
 #include "pdftoolabstractapplication.h"
 #include "pdfexception.h"
 
+#include <QMutex>
+#include <QSemaphore>
+#include <QThreadPool>
+
+#include <memory>
+
 namespace pdftool
 {
 
@@ -38,11 +44,32 @@ protected:
     virtual void finish(const PDFToolOptions& options) = 0;
     virtual void onPageRendered(const PDFToolOptions& options, pdf::PDFRenderedPageImage& renderedPageImage) = 0;
 
+    /// Called when tile of the image pyramid is rendered. Tiles of the same
+    /// page can be rendered concurrently from several threads.
+    /// \param options Options
+    /// \param renderedTileImage Rendered tile image
+    /// \param fileNames File names of the tile (relative to output directory)
+    virtual void onTileRendered(const PDFToolOptions& options, pdf::PDFRenderedTileImage& renderedTileImage, const QStringList& fileNames)
+    {
+        Q_UNUSED(options);
+        Q_UNUSED(renderedTileImage);
+        Q_UNUSED(fileNames);
+    }
+
+    /// Called before pages are rendered
+    virtual void beginRendering(const PDFToolOptions& options) { Q_UNUSED(options); }
+
+    /// Called after all pages are rendered, waits for work,
+    /// which has not been finished yet (for example, writing of images).
+    virtual void endRendering() { }
+
     void writePageInfoStatistics(const pdf::PDFRenderedPageImage& renderedPageImage);
+    void writeTileInfoStatistics(const pdf::PDFRenderedTileImage& renderedTileImage);
 
     void writeStatistics(PDFOutputFormatter& formatter);
     void writePageStatistics(PDFOutputFormatter& formatter);
     void writeErrors(PDFOutputFormatter& formatter);
+    void writeRenderPerformanceReport(const PDFToolOptions& options);
 
     struct PageInfo
     {
@@ -53,10 +80,22 @@ protected:
         qint64 pageRenderTime = 0;
         qint64 pageTotalTime = 0;
         qint64 pageWriteTime = 0;
+        size_t pageInstructionCount = 0;
+        qint64 pageMemoryConsumptionEstimate = 0;
         std::vector<pdf::PDFRenderError> errors;
     };
 
+    /// Renders pages as tiled image pyramids
+    void renderPyramids(const PDFToolOptions& options,
+                        const pdf::PDFDocument& document,
+                        const std::vector<pdf::PDFInteger>& pageIndices,
+                        const std::function<QSize(const pdf::PDFPage*)>& imageSizeGetter,
+                        pdf::PDFRasterizerPool& rasterizerPool);
+
+    void addPageError(pdf::PDFInteger pageIndex, pdf::PDFRenderError error);
+
     std::vector<PageInfo> m_pageInfo;
+    QMutex m_pageInfoMutex; ///< Guards page infos, if they are modified from several threads
     qint64 m_wallTime = 0;
 };
 
@@ -69,6 +108,24 @@ public:
 protected:
     virtual void finish(const PDFToolOptions& options) override;
     virtual void onPageRendered(const PDFToolOptions& options, pdf::PDFRenderedPageImage& renderedPageImage) override;
+    virtual void onTileRendered(const PDFToolOptions& options, pdf::PDFRenderedTileImage& renderedTileImage, const QStringList& fileNames) override;
+    virtual void beginRendering(const PDFToolOptions& options) override;
+    virtual void endRendering() override;
+
+private:
+    /// Maximal count of rendered images waiting for encoding per encoder thread.
+    /// Rendering threads are blocked, if too many images are waiting.
+    static constexpr int MAX_PENDING_IMAGES_PER_ENCODER = 2;
+
+    /// Encodes image and writes it to the files
+    void writeImage(const PDFToolOptions& options, const QImage& image, pdf::PDFInteger pageIndex, const QStringList& fileNames);
+
+    /// Writes image using encoder threads (if they are enabled), otherwise directly
+    void scheduleWriteImage(const PDFToolOptions& options, QImage image, pdf::PDFInteger pageIndex, QStringList fileNames);
+
+    std::unique_ptr<QThreadPool> m_encoderPool;
+    std::unique_ptr<QSemaphore> m_pendingImageSlots;
+    const PDFToolOptions* m_options = nullptr;
 };
 
 class PDFToolBenchmark : public PDFToolRenderBase
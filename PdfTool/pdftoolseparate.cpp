@@ -27,6 +27,7 @@
 #include "pdfdocumentwriter.h"
 
 #include <QFileInfo>
+#include <QThreadPool>
 
 namespace pdftool
 {
@@ -90,19 +91,42 @@ int PDFToolSeparate::execute(const PDFToolOptions& options)
         return ErrorInvalidArguments;
     }
 
-    for (pdf::PDFInteger pageIndex : pageIndices)
+    // Parts of the document, which are common to all single page documents,
+    // are prepared only once. Object storage of the base document is shared
+    // by the single page documents (it is copied on write), so each output
+    // document costs only objects, which are modified.
+    std::vector<pdf::PDFObjectReference> pageReferences;
+    pdf::PDFDocument baseDocument;
+
+    try
+    {
+        pdf::PDFDocumentBuilder documentBuilder(&document);
+        documentBuilder.flattenPageTree();
+        documentBuilder.removeOutline();
+        documentBuilder.removeThreads();
+        documentBuilder.removeDocumentActions();
+        documentBuilder.removeStructureTree();
+        pageReferences = documentBuilder.getPages();
+        baseDocument = documentBuilder.build();
+    }
+    catch (const pdf::PDFException &exception)
     {
+        PDFConsole::writeError(exception.getMessage(), options.outputCodec);
+        return ErrorUnknown;
+    }
+
+    // Output documents are independent, so they are written in parallel. Errors
+    // are collected and written in page order, after all documents are written.
+    std::vector<QString> errors(pageIndices.size());
+
+    auto writePage = [&](size_t index)
+    {
+        const pdf::PDFInteger pageIndex = pageIndices[index];
+
         try
         {
-            pdf::PDFDocumentBuilder documentBuilder(&document);
-            documentBuilder.flattenPageTree();
-            std::vector<pdf::PDFObjectReference> pageReferences = documentBuilder.getPages();
-            std::vector<pdf::PDFObjectReference> singlePageRef = { pageReferences[pageIndex] };
-            documentBuilder.setPages(singlePageRef);
-            documentBuilder.removeOutline();
-            documentBuilder.removeThreads();
-            documentBuilder.removeDocumentActions();
-            documentBuilder.removeStructureTree();
+            pdf::PDFDocumentBuilder documentBuilder(&baseDocument);
+            documentBuilder.setPages({ pageReferences[pageIndex] });
 
             pdf::PDFDocument singlePageDocument = documentBuilder.build();
 
@@ -117,7 +141,7 @@ int PDFToolSeparate::execute(const PDFToolOptions& options)
 
             if (QFileInfo::exists(fileName))
             {
-                PDFConsole::writeError(PDFToolTranslationContext::tr("File '%1' already exists. Page %2 was not extracted.").arg(fileName).arg(pageIndex + 1), options.outputCodec);
+                errors[index] = PDFToolTranslationContext::tr("File '%1' already exists. Page %2 was not extracted.").arg(fileName).arg(pageIndex + 1);
             }
             else
             {
@@ -125,14 +149,39 @@ int PDFToolSeparate::execute(const PDFToolOptions& options)
                 pdf::PDFOperationResult result = writer.write(fileName, &singlePageDocument, false);
                 if (!result)
                 {
-                    PDFConsole::writeError(result.getErrorMessage(), options.outputCodec);
+                    errors[index] = result.getErrorMessage();
                 }
             }
         }
         catch (const pdf::PDFException &exception)
         {
-            PDFConsole::writeError(exception.getMessage(), options.outputCodec);
+            errors[index] = exception.getMessage();
         }
+    };
+
+    if (options.separateThreadCount > 1 && pageIndices.size() > 1)
+    {
+        QThreadPool threadPool;
+        threadPool.setMaxThreadCount(options.separateThreadCount);
+
+        for (size_t i = 0; i < pageIndices.size(); ++i)
+        {
+            threadPool.start([&writePage, i]() { writePage(i); });
+        }
+
+        threadPool.waitForDone();
+    }
+    else
+    {
+        for (size_t i = 0; i < pageIndices.size(); ++i)
+        {
+            writePage(i);
+        }
+    }
+
+    for (const QString& error : errors)
+    {
+        PDFConsole::writeError(error, options.outputCodec);
     }
 
     return ExitSuccess;
@@ -0,0 +1,221 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pdftoolserve.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QElapsedTimer>
+#include <QStringDecoder>
+#include <QCommandLineParser>
+
+#include <cstdio>
+
+namespace pdftool
+{
+
+static PDFToolServe s_toolServeApplication;
+
+QString PDFToolServe::getStandardString(PDFToolAbstractApplication::StandardString standardString) const
+{
+    switch (standardString)
+    {
+        case Command:
+            return "serve";
+
+        case Name:
+            return PDFToolTranslationContext::tr("Service mode");
+
+        case Description:
+            return PDFToolTranslationContext::tr("Run as a service executing JSON requests (one request per line) read from the standard input, keeping recently used documents opened.");
+
+        default:
+            Q_ASSERT(false);
+            break;
+    }
+
+    return QString();
+}
+
+PDFToolAbstractApplication::Options PDFToolServe::getOptionsFlags() const
+{
+    return Batch;
+}
+
+int PDFToolServe::execute(const PDFToolOptions& options)
+{
+    QFile file;
+    bool isOpened = false;
+    if (options.batchJobList.isEmpty() || options.batchJobList == "-")
+    {
+        isOpened = file.open(stdin, QFile::ReadOnly | QFile::Text);
+    }
+    else
+    {
+        file.setFileName(options.batchJobList);
+        isOpened = file.open(QFile::ReadOnly | QFile::Text);
+    }
+
+    if (!isOpened)
+    {
+        PDFConsole::writeError(PDFToolTranslationContext::tr("Cannot open request file '%1'. %2").arg(options.batchJobList, file.errorString()), options.outputCodec);
+        return ErrorInvalidArguments;
+    }
+
+    setDocumentCacheSize(options.batchDocumentCacheSize);
+
+    int failedRequestCount = 0;
+    bool isQuitRequested = false;
+    while (!isQuitRequested && !file.atEnd())
+    {
+        const QByteArray line = file.readLine().trimmed();
+        if (line.isEmpty())
+        {
+            continue;
+        }
+
+        QJsonObject response;
+        QJsonParseError parseError;
+        QJsonDocument requestDocument = QJsonDocument::fromJson(line, &parseError);
+
+        if (parseError.error != QJsonParseError::NoError || !requestDocument.isObject())
+        {
+            response["exit-code"] = ErrorInvalidArguments;
+            response["error"] = parseError.error != QJsonParseError::NoError ? parseError.errorString() : PDFToolTranslationContext::tr("Request must be a JSON object.");
+        }
+        else
+        {
+            response = executeRequest(requestDocument.object(), isQuitRequested);
+        }
+
+        if (response["exit-code"].toInt() != ExitSuccess)
+        {
+            ++failedRequestCount;
+        }
+
+        // Response must be delivered immediately, client waits for it
+        PDFConsole::writeData(QJsonDocument(response).toJson(QJsonDocument::Compact) + "\n");
+        std::fflush(stdout);
+
+        if (response["exit-code"].toInt() != ExitSuccess && options.batchStopOnError)
+        {
+            break;
+        }
+    }
+
+    setDocumentCacheSize(0);
+    return failedRequestCount == 0 ? ExitSuccess : ExitFailure;
+}
+
+QJsonObject PDFToolServe::executeRequest(const QJsonObject& request, bool& isQuitRequested)
+{
+    QJsonObject response;
+    if (request.contains("id"))
+    {
+        response["id"] = request["id"];
+    }
+
+    QStringList requestArguments;
+    if (request.contains("command"))
+    {
+        requestArguments << request["command"].toString();
+    }
+
+    for (const QJsonValue& value : request["arguments"].toArray())
+    {
+        requestArguments << value.toString();
+    }
+
+    if (requestArguments.isEmpty() || requestArguments.front().isEmpty())
+    {
+        response["exit-code"] = ErrorInvalidArguments;
+        response["error"] = PDFToolTranslationContext::tr("Request doesn't contain a command.");
+        return response;
+    }
+
+    const QString command = requestArguments.front();
+    if (command == "quit")
+    {
+        isQuitRequested = true;
+        response["exit-code"] = ExitSuccess;
+        return response;
+    }
+
+    PDFToolAbstractApplication* application = PDFToolApplicationStorage::getApplicationByCommand(command);
+    if (!application || application == this || application == PDFToolApplicationStorage::getApplicationByCommand("batch"))
+    {
+        response["exit-code"] = ErrorInvalidArguments;
+        response["error"] = PDFToolTranslationContext::tr("Unknown command '%1'.").arg(command);
+        return response;
+    }
+
+    // First argument is ignored by the parser (program name)
+    QStringList arguments = requestArguments;
+    arguments.front() = QCoreApplication::applicationFilePath();
+
+    QCommandLineParser parser;
+    application->initializeCommandLineParser(&parser);
+
+    if (!parser.parse(arguments))
+    {
+        response["exit-code"] = ErrorInvalidArguments;
+        response["error"] = parser.errorText();
+        return response;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QByteArray output;
+    QString errors;
+
+    PDFConsole::beginCapture();
+    const PDFToolOptions applicationOptions = application->getOptions(&parser);
+    const int exitCode = application->execute(applicationOptions);
+    PDFConsole::endCapture(output, errors);
+
+    response["exit-code"] = exitCode;
+    response["time"] = timer.elapsed();
+
+    // Binary output (for example, an image written to the standard output) is encoded in base 64
+    QStringDecoder decoder(QStringConverter::Utf8);
+    QString text = decoder.decode(output);
+    if (decoder.hasError())
+    {
+        response["output-base64"] = QString::fromLatin1(output.toBase64());
+    }
+    else
+    {
+        response["output"] = text;
+    }
+
+    if (!errors.isEmpty())
+    {
+        response["errors"] = errors;
+    }
+
+    return response;
+}
+
+}   // namespace pdftool
@@ -0,0 +1,57 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef PDFTOOLSERVE_H
+#define PDFTOOLSERVE_H
+
+#include "pdftoolabstractapplication.h"
+
+#include <QJsonObject>
+
+namespace pdftool
+{
+
+/// Long running service, which executes requests read from the standard input
+/// (or a request file). Each line contains one request as JSON object, for example
+/// {"id": 1, "arguments": ["info", "document.pdf"]}. Response for each request
+/// is written as one line containing JSON object with the request identifier,
+/// exit code, execution time, and captured output and errors of the command.
+/// Recently used documents are kept opened between requests, so they are not
+/// parsed again, if they were not modified. Request {"command": "quit"} stops
+/// the service.
+class PDFToolServe : public PDFToolAbstractApplication
+{
+public:
+    virtual QString getStandardString(StandardString standardString) const override;
+    virtual int execute(const PDFToolOptions& options) override;
+    virtual Options getOptionsFlags() const override;
+
+private:
+    /// Executes single request and returns the response
+    /// \param request Request
+    /// \param[out] isQuitRequested Set to true, if service should be stopped
+    QJsonObject executeRequest(const QJsonObject& request, bool& isQuitRequested);
+};
+
+}   // namespace pdftool
+
+#endif // PDFTOOLSERVE_H
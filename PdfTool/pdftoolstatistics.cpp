@@ -22,6 +22,7 @@
 
 #include "pdftoolstatistics.h"
 #include "pdfobjectutils.h"
+#include "pdfdocumentreader.h"
 
 namespace pdftool
 {
@@ -51,6 +52,11 @@ QString PDFToolStatisticsApplication::getStandardString(StandardString standardS
 
 int PDFToolStatisticsApplication::execute(const PDFToolOptions& options)
 {
+    if (options.statisticsStreaming)
+    {
+        return executeStreaming(options);
+    }
+
     pdf::PDFDocument document;
     QByteArray sourceData;
     if (!readDocument(options, document, &sourceData, false))
@@ -171,9 +177,172 @@ int PDFToolStatisticsApplication::execute(const PDFToolOptions& options)
     return ExitSuccess;
 }
 
+int PDFToolStatisticsApplication::executeStreaming(const PDFToolOptions& options)
+{
+    pdf::PDFDocumentReader reader(nullptr, [](bool* ok) { *ok = false; return QString(); }, options.permissiveReading, false);
+    pdf::PDFXRefTable xrefTable = reader.readReferenceTableFromFile(options.document);
+
+    if (reader.getReadingResult() != pdf::PDFDocumentReader::Result::OK)
+    {
+        PDFConsole::writeError(PDFToolTranslationContext::tr("Error occured during document reading. %1").arg(reader.getErrorMessage()), options.outputCodec);
+        return ErrorDocumentReading;
+    }
+
+    pdf::PDFObjectStreamingStatistics::Flags flags = pdf::PDFObjectStreamingStatistics::None;
+    flags.setFlag(pdf::PDFObjectStreamingStatistics::DecodeStreams, options.statisticsDecodeStreams);
+    pdf::PDFObjectStreamingStatistics::Statistics statistics = pdf::PDFObjectStreamingStatistics::calculate(reader.getSource(), reader.getSourceOwner(), xrefTable, flags);
+    const bool showDecodedBytes = options.statisticsDecodeStreams && !statistics.isEncrypted;
+
+    QLocale locale;
+
+    PDFOutputFormatter formatter(options.outputStyle);
+    formatter.beginDocument("info", PDFToolTranslationContext::tr("Information about document %1").arg(options.document));
+    formatter.endl();
+
+    {
+        formatter.beginTable("statistics-summary", PDFToolTranslationContext::tr("Summary"));
+
+        formatter.beginTableHeaderRow("header");
+        formatter.writeTableHeaderColumn("property", PDFToolTranslationContext::tr("Property"), Qt::AlignLeft);
+        formatter.writeTableHeaderColumn("value", PDFToolTranslationContext::tr("Value"), Qt::AlignLeft);
+        formatter.endTableHeaderRow();
+
+        int ref = 1;
+        auto writeProperty = [&](const QString& name, const QString& text, const QString& value)
+        {
+            formatter.beginTableRow("property", ref++);
+            formatter.writeTableColumn(name, text);
+            formatter.writeTableColumn("value", value, Qt::AlignRight);
+            formatter.endTableRow();
+        };
+
+        writeProperty("objects", PDFToolTranslationContext::tr("Objects"), locale.toString(statistics.objectCount));
+        writeProperty("compressed-objects", PDFToolTranslationContext::tr("Objects in object streams"), locale.toString(statistics.compressedObjectCount));
+        writeProperty("invalid-objects", PDFToolTranslationContext::tr("Invalid objects"), locale.toString(statistics.invalidObjectCount));
+        writeProperty("space-usage", PDFToolTranslationContext::tr("Space usage [bytes]"), locale.toString(statistics.bytes));
+        writeProperty("encrypted", PDFToolTranslationContext::tr("Encrypted"), statistics.isEncrypted ? PDFToolTranslationContext::tr("Yes") : PDFToolTranslationContext::tr("No"));
+
+        if (showDecodedBytes)
+        {
+            writeProperty("decoding-errors", PDFToolTranslationContext::tr("Streams, which can't be decoded"), locale.toString(statistics.decodingErrorCount));
+        }
+
+        formatter.endTable();
+    }
+
+    formatter.endl();
+
+    auto writeItemsTable = [&](const QString& name, const QString& caption, const QString& keyCaption, const std::map<QByteArray, pdf::PDFObjectStreamingStatistics::Item>& items, const QString& emptyKeyText, bool isStreamSize)
+    {
+        formatter.beginTable(name, caption);
+
+        formatter.beginTableHeaderRow("header");
+        formatter.writeTableHeaderColumn("class", keyCaption, Qt::AlignLeft);
+        formatter.writeTableHeaderColumn("count", PDFToolTranslationContext::tr("Count [#]"), Qt::AlignLeft);
+        formatter.writeTableHeaderColumn("space-usage", isStreamSize ? PDFToolTranslationContext::tr("Stream Data [bytes]") : PDFToolTranslationContext::tr("Space Usage [bytes]"), Qt::AlignLeft);
+        if (showDecodedBytes)
+        {
+            formatter.writeTableHeaderColumn("decoded-size", PDFToolTranslationContext::tr("Decoded Data [bytes]"), Qt::AlignLeft);
+        }
+        formatter.endTableHeaderRow();
+
+        int ref = 1;
+        for (const auto& item : items)
+        {
+            formatter.beginTableRow("item", ref++);
+            formatter.writeTableColumn("class", !item.first.isEmpty() ? QString::fromLatin1(item.first) : emptyKeyText);
+            formatter.writeTableColumn("count", locale.toString(item.second.count), Qt::AlignRight);
+            formatter.writeTableColumn("space-usage", locale.toString(item.second.bytes), Qt::AlignRight);
+            if (showDecodedBytes)
+            {
+                formatter.writeTableColumn("decoded-size", locale.toString(item.second.decodedBytes), Qt::AlignRight);
+            }
+            formatter.endTableRow();
+        }
+
+        formatter.endTable();
+        formatter.endl();
+    };
+
+    writeItemsTable("statistics-objects-by-class", PDFToolTranslationContext::tr("Statistics by Object Class"), PDFToolTranslationContext::tr("Class"), statistics.objectsByClass, PDFToolTranslationContext::tr("Other"), false);
+    writeItemsTable("statistics-streams-by-filter", PDFToolTranslationContext::tr("Statistics by Stream Filter"), PDFToolTranslationContext::tr("Filter"), statistics.streamsByFilter, PDFToolTranslationContext::tr("None"), true);
+
+    {
+        formatter.beginTable("statistics-objects-by-size", PDFToolTranslationContext::tr("Statistics by Object Size"));
+
+        formatter.beginTableHeaderRow("header");
+        formatter.writeTableHeaderColumn("size", PDFToolTranslationContext::tr("Size [bytes]"), Qt::AlignLeft);
+        formatter.writeTableHeaderColumn("count", PDFToolTranslationContext::tr("Count [#]"), Qt::AlignLeft);
+        formatter.writeTableHeaderColumn("space-usage", PDFToolTranslationContext::tr("Space Usage [bytes]"), Qt::AlignLeft);
+        formatter.endTableHeaderRow();
+
+        const auto& bounds = pdf::PDFObjectStreamingStatistics::SIZE_HISTOGRAM_BOUNDS;
+        for (size_t i = 0; i < statistics.sizeHistogram.size(); ++i)
+        {
+            const pdf::PDFObjectStreamingStatistics::Item& item = statistics.sizeHistogram[i];
+
+            QString sizeText;
+            if (i == 0)
+            {
+                sizeText = QString("< %1").arg(locale.toString(bounds[i]));
+            }
+            else if (i < bounds.size())
+            {
+                sizeText = QString("%1 - %2").arg(locale.toString(bounds[i - 1]), locale.toString(bounds[i] - 1));
+            }
+            else
+            {
+                sizeText = QString(">= %1").arg(locale.toString(bounds.back()));
+            }
+
+            formatter.beginTableRow("item", int(i));
+            formatter.writeTableColumn("size", sizeText);
+            formatter.writeTableColumn("count", locale.toString(item.count), Qt::AlignRight);
+            formatter.writeTableColumn("space-usage", locale.toString(item.bytes), Qt::AlignRight);
+            formatter.endTableRow();
+        }
+
+        formatter.endTable();
+    }
+
+    formatter.endl();
+
+    {
+        formatter.beginTable("statistics-objects-by-type", PDFToolTranslationContext::tr("Statistics by Object Type"));
+
+        formatter.beginTableHeaderRow("header");
+        formatter.writeTableHeaderColumn("class", PDFToolTranslationContext::tr("Type") , Qt::AlignLeft);
+        formatter.writeTableHeaderColumn("count", PDFToolTranslationContext::tr("Count [#]"), Qt::AlignLeft);
+        formatter.endTableHeaderRow();
+
+        for (pdf::PDFObject::Type type : pdf::PDFObject::getTypes())
+        {
+            const qint64 currentObjectCount = statistics.objectCountByType[size_t(type)];
+
+            if (currentObjectCount == 0)
+            {
+                continue;
+            }
+
+            formatter.beginTableRow("item", int(type));
+            formatter.writeTableColumn("type", pdf::PDFObjectUtils::getObjectTypeName(type));
+            formatter.writeTableColumn("count", locale.toString(currentObjectCount), Qt::AlignRight);
+            formatter.endTableRow();
+        }
+
+        formatter.endTable();
+    }
+
+    formatter.endDocument();
+
+    PDFConsole::writeText(formatter.getString(), options.outputCodec);
+
+    return ExitSuccess;
+}
+
 PDFToolAbstractApplication::Options PDFToolStatisticsApplication::getOptionsFlags() const
 {
-    return ConsoleFormat | OpenDocument;
+    return ConsoleFormat | OpenDocument | Statistics;
 }
 
 }   // namespace pdftool
@@ -34,6 +34,10 @@ public:
     virtual QString getStandardString(StandardString standardString) const override;
     virtual int execute(const PDFToolOptions& options) override;
     virtual Options getOptionsFlags() const override;
+
+private:
+    /// Computes statistics in one pass over the reference table, without loading the document
+    int executeStreaming(const PDFToolOptions& options);
 };
 
 }   // namespace pdftool
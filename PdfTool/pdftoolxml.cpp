@@ -25,20 +25,48 @@
 #include "pdfencoding.h"
 #include "pdfexception.h"
 
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <QStringDecoder>
 #include <QXmlStreamWriter>
 
+#include <optional>
+#include <functional>
+
 namespace pdftool
 {
 
 static PDFToolXmlApplication s_xmlApplication;
 
+/// Size of the chunk of stream data, which are written at once
+static constexpr qint64 XML_STREAM_CHUNK_SIZE = 48 * 1024;
+
+/// Decoded streams up to this size are converted to text in memory,
+/// larger streams are decoded twice, chunk by chunk (first to
+/// detect the encoding, then to convert them to text).
+static constexpr qint64 XML_STREAM_TEXT_IN_MEMORY_LIMIT = 16 * 1024 * 1024;
+
+/// Size of the output, at which it is flushed
+static constexpr qsizetype XML_OUTPUT_FLUSH_SIZE = 1024 * 1024;
+
+/// Objects with streams larger than this size are not serialized
+/// in advance, they are written directly to the output.
+static constexpr qint64 XML_LARGE_STREAM_SIZE = 8 * 1024 * 1024;
+
+/// Limits of the batch of objects serialized in advance
+static constexpr size_t XML_BATCH_OBJECT_COUNT = 256;
+static constexpr qint64 XML_BATCH_STREAM_SIZE = 32 * 1024 * 1024;
+
 class PDFXmlExportVisitor : public pdf::PDFAbstractVisitor
 {
 public:
-    PDFXmlExportVisitor(QXmlStreamWriter* writer, const pdf::PDFDocument* document, const PDFToolOptions* options) :
+    /// Creates visitor. If \p flush callback is set, it is called, when large
+    /// stream data are being written, so output can be written continuously.
+    PDFXmlExportVisitor(QXmlStreamWriter* writer, const pdf::PDFDocument* document, const PDFToolOptions* options, std::function<void()> flush = nullptr) :
         m_writer(writer),
         m_options(options),
-        m_document(document)
+        m_document(document),
+        m_flush(qMove(flush))
     {
 
     }
@@ -57,9 +85,21 @@ public:
 private:
     void writeTextOrBinary(const QByteArray& stream, QString name);
 
+    /// Writes decoded stream as text, if it is possible
+    void writeStreamText(const pdf::PDFStream* stream);
+
+    void flush()
+    {
+        if (m_flush)
+        {
+            m_flush();
+        }
+    }
+
     QXmlStreamWriter* m_writer;
     const PDFToolOptions* m_options;
     const pdf::PDFDocument* m_document;
+    std::function<void()> m_flush;
 };
 
 void PDFXmlExportVisitor::visitNull()
@@ -122,30 +162,128 @@ void PDFXmlExportVisitor::visitStream(const pdf::PDFStream* stream)
 
     if (m_options->xmlExportStreams)
     {
-        m_writer->writeTextElement("data", QString::fromLatin1(stream->getContent()->toHex()).toUpper());
+        const QByteArray* content = stream->getContent();
+
+        m_writer->writeStartElement("data");
+        for (qint64 offset = 0; offset < content->size(); offset += XML_STREAM_CHUNK_SIZE)
+        {
+            QByteArrayView chunk = QByteArrayView(*content).sliced(offset, qMin(XML_STREAM_CHUNK_SIZE, content->size() - offset));
+            m_writer->writeCharacters(QString::fromLatin1(chunk.toByteArray().toHex()).toUpper());
+            flush();
+        }
+        m_writer->writeEndElement();
     }
 
     if (m_options->xmlExportStreamsAsText)
     {
-        try
+        writeStreamText(stream);
+    }
+
+    m_writer->writeEndElement();
+}
+
+void PDFXmlExportVisitor::writeStreamText(const pdf::PDFStream* stream)
+{
+    try
+    {
+        // Attempt to decode the stream. Exception can be thrown.
+        pdf::PDFStreamReaderPointer reader = m_document->createDecodedStreamReader(stream);
+
+        QByteArray decodedData;
+        QByteArray buffer(XML_STREAM_CHUNK_SIZE, Qt::Uninitialized);
+        qint64 readBytes = 0;
+        while (decodedData.size() <= XML_STREAM_TEXT_IN_MEMORY_LIMIT && (readBytes = reader->read(buffer.data(), buffer.size())) > 0)
         {
-            // Attempt to decode the stream. Exception can be thrown.
-            QByteArray decodedData = m_document->getDecodedStream(stream);
+            decodedData.append(buffer.constData(), readBytes);
+        }
 
+        if (decodedData.size() <= XML_STREAM_TEXT_IN_MEMORY_LIMIT)
+        {
+            // Whole stream was decoded
             bool isBinary = true;
             QString text = pdf::PDFEncoding::convertSmartFromByteStringToUnicode(decodedData, &isBinary);
             if (!isBinary)
             {
                 m_writer->writeTextElement("text", text);
             }
+            return;
         }
-        catch (const pdf::PDFException &)
+
+        // Large stream - detect encoding in the same way as convertSmartFromByteStringToUnicode,
+        // but chunk by chunk, and then decode the stream again and convert it chunk by chunk.
+        const bool hasUnicodeLeadMarkings = pdf::PDFEncoding::hasUnicodeLeadMarkings(decodedData);
+        const bool hasUTF8LeadMarkings = pdf::PDFEncoding::hasUTF8LeadMarkings(decodedData);
+
+        QStringDecoder utf16BEDecoder(QStringDecoder::Utf16BE);
+        QStringDecoder utf16LEDecoder(QStringDecoder::Utf16LE);
+        QStringDecoder utf8Decoder(QStringDecoder::Utf8);
+        bool isUtf16BE = hasUnicodeLeadMarkings;
+        bool isUtf16LE = hasUnicodeLeadMarkings;
+        bool isUtf8 = hasUTF8LeadMarkings;
+        bool isPrintableAscii = true;
+        bool isPDFDoc = true;
+
+        auto checkDecoder = [](QStringDecoder& decoder, const QByteArray& chunk)
         {
-            // Do nothing
+            QString text = decoder.decode(chunk);
+            return !decoder.hasError();
+        };
+
+        auto checkChunk = [&](const QByteArray& chunk)
+        {
+            isUtf16BE = isUtf16BE && checkDecoder(utf16BEDecoder, chunk);
+            isUtf16LE = isUtf16LE && checkDecoder(utf16LEDecoder, chunk);
+            isUtf8 = isUtf8 && checkDecoder(utf8Decoder, chunk);
+            isPrintableAscii = isPrintableAscii && pdf::PDFEncoding::isPrintableAscii(chunk);
+            isPDFDoc = isPDFDoc && pdf::PDFEncoding::canConvertFromEncoding(chunk, pdf::PDFEncoding::Encoding::PDFDoc);
+            return isUtf16BE || isUtf16LE || isUtf8 || isPrintableAscii || isPDFDoc;
+        };
+
+        bool isText = checkChunk(decodedData);
+        decodedData.clear();
+
+        while (isText && (readBytes = reader->read(buffer.data(), buffer.size())) > 0)
+        {
+            isText = checkChunk(QByteArray::fromRawData(buffer.constData(), readBytes));
         }
-    }
 
-    m_writer->writeEndElement();
+        if (!isText)
+        {
+            // Stream is binary
+            return;
+        }
+
+        std::optional<QStringDecoder> decoder;
+        if (isUtf16BE || isUtf16LE || isUtf8)
+        {
+            decoder.emplace(isUtf16BE ? QStringDecoder::Utf16BE : (isUtf16LE ? QStringDecoder::Utf16LE : QStringDecoder::Utf8));
+        }
+
+        reader = m_document->createDecodedStreamReader(stream);
+        m_writer->writeStartElement("text");
+        while ((readBytes = reader->read(buffer.data(), buffer.size())) > 0)
+        {
+            QByteArray chunk = QByteArray::fromRawData(buffer.constData(), readBytes);
+            if (decoder)
+            {
+                m_writer->writeCharacters(QString(decoder->decode(chunk)));
+            }
+            else if (isPrintableAscii)
+            {
+                m_writer->writeCharacters(QString::fromLatin1(chunk));
+            }
+            else
+            {
+                m_writer->writeCharacters(pdf::PDFEncoding::convert(chunk, pdf::PDFEncoding::Encoding::PDFDoc));
+            }
+            flush();
+        }
+        m_writer->writeEndElement();
+    }
+    catch (const pdf::PDFException &)
+    {
+        // Do nothing
+    }
 }
 
 void PDFXmlExportVisitor::visitReference(const pdf::PDFObjectReference reference)
@@ -225,7 +363,64 @@ int PDFToolXmlApplication::execute(const PDFToolOptions& options)
     document.getStorage().getTrailerDictionary().accept(&visitor);
     writer.writeEndElement();
 
-    pdf::PDFObjectStorage::PDFObjects entries = document.getStorage().getObjects();
+    auto flushOutput = [&xmlString, &options](qsizetype flushSize)
+    {
+        if (xmlString.size() >= flushSize)
+        {
+            PDFConsole::writeText(xmlString, options.outputCodec);
+            xmlString.clear();
+        }
+    };
+    flushOutput(0);
+
+    // Objects are written to the output object by object. Each object is serialized
+    // by its own writer to the xml fragment, which is then appended to the output,
+    // so upcoming objects can be serialized in parallel, while current objects
+    // are being written.
+    const pdf::PDFObjectStorage::PDFObjects& entries = document.getStorage().getObjects();
+    auto writeObject = [&](pdf::PDFInteger id, QString* fragment, std::function<void()> flush)
+    {
+        const pdf::PDFObjectStorage::Entry& entry = entries[id];
+
+        QXmlStreamWriter objectWriter(fragment);
+        if (options.xmlUseIndent)
+        {
+            objectWriter.setAutoFormatting(true);
+            objectWriter.setAutoFormattingIndent(2);
+        }
+
+        // Root element is written only to have correct indentation of the
+        // object, it is removed from the fragment and it is never closed.
+        const QString rootElement = "<document>";
+        objectWriter.writeStartElement("document");
+        objectWriter.writeStartElement("pdfobject");
+        Q_ASSERT(fragment->startsWith(rootElement));
+        fragment->remove(0, rootElement.size());
+
+        objectWriter.writeAttribute("id", QString::number(id));
+        objectWriter.writeAttribute("gen", QString::number(entry.generation));
+        PDFXmlExportVisitor objectVisitor(&objectWriter, &document, &options, qMove(flush));
+        entry.object.accept(&objectVisitor);
+        objectWriter.writeEndElement();
+    };
+
+    auto serializeObject = [&writeObject](pdf::PDFInteger id)
+    {
+        QString fragment;
+        writeObject(id, &fragment, nullptr);
+        return fragment;
+    };
+
+    // Objects with large streams are written directly, with continuous flushing
+    // of the output, other objects are serialized in batches.
+    struct Segment
+    {
+        std::vector<pdf::PDFInteger> objects;
+        bool isLarge = false;
+    };
+
+    std::vector<Segment> segments;
+    qint64 batchStreamSize = 0;
     for (pdf::PDFInteger i = 0; i < pdf::PDFInteger(entries.size()); ++i)
     {
         const pdf::PDFObjectStorage::Entry& entry = entries[i];
@@ -235,11 +430,73 @@ int PDFToolXmlApplication::execute(const PDFToolOptions& options)
             continue;
         }
 
-        writer.writeStartElement("pdfobject");
-        writer.writeAttribute("id", QString::number(i));
-        writer.writeAttribute("gen", QString::number(entry.generation));
-        entry.object.accept(&visitor);
-        writer.writeEndElement();
+        const qint64 streamSize = entry.object.isStream() ? entry.object.getStream()->getContent()->size() : 0;
+        if (streamSize > XML_LARGE_STREAM_SIZE)
+        {
+            segments.push_back(Segment{ { i }, true });
+            batchStreamSize = 0;
+            continue;
+        }
+
+        if (segments.empty() || segments.back().isLarge ||
+            segments.back().objects.size() >= XML_BATCH_OBJECT_COUNT ||
+            batchStreamSize + streamSize > XML_BATCH_STREAM_SIZE)
+        {
+            segments.push_back(Segment());
+            batchStreamSize = 0;
+        }
+
+        segments.back().objects.push_back(i);
+        batchStreamSize += streamSize;
+    }
+
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(options.xmlThreadCount);
+
+    auto startSegment = [&](size_t index)
+    {
+        if (options.xmlThreadCount > 1 && index < segments.size() && !segments[index].isLarge)
+        {
+            return QtConcurrent::mapped(&threadPool, segments[index].objects, serializeObject);
+        }
+
+        return QFuture<QString>();
+    };
+
+    QFuture<QString> currentSegmentFuture = startSegment(0);
+    for (size_t i = 0; i < segments.size(); ++i)
+    {
+        const Segment& segment = segments[i];
+        QFuture<QString> nextSegmentFuture = startSegment(i + 1);
+
+        if (currentSegmentFuture.isValid())
+        {
+            for (const QString& fragment : currentSegmentFuture.results())
+            {
+                xmlString.append(fragment);
+                flushOutput(XML_OUTPUT_FLUSH_SIZE);
+            }
+        }
+        else
+        {
+            for (pdf::PDFInteger id : segment.objects)
+            {
+                QString fragment;
+                writeObject(id, &fragment, [&]()
+                {
+                    if (fragment.size() >= XML_OUTPUT_FLUSH_SIZE)
+                    {
+                        xmlString.append(fragment);
+                        fragment.clear();
+                        flushOutput(0);
+                    }
+                });
+                xmlString.append(fragment);
+                flushOutput(XML_OUTPUT_FLUSH_SIZE);
+            }
+        }
+
+        currentSegmentFuture = qMove(nextSegmentFuture);
     }
 
     writer.writeEndElement();
@@ -31,8 +31,35 @@
 #include "pdfdocument.h"
 #include "pdfexception.h"
 #include "pdfjbig2decoder.h"
+#include "pdfdocumentreader.h"
+#include "pdfdocumentwriter.h"
+#include "pdfdocumentbuilder.h"
+#include "pdfstreamingdocumentwriter.h"
+#include "pdfoptimizer.h"
+#include "pdffontsubsetter.h"
+#include "pdfobjectutils.h"
+#include "pdfbytescanner.h"
+#include "pdfsecurityhandler.h"
+#include "pdfimage.h"
+#include "pdfcms.h"
+#include "pdfccittfaxdecoder.h"
+#include "pdftextlayout.h"
+#include "pdfalgorithmlcs.h"
+#include "pdfexecutionpolicy.h"
+#include "pdftracing.h"
+#include "pdfmemoryreport.h"
+#include "pdfsnapper.h"
+#include "pdfnametreeloader.h"
+#include "pdfstructuretree.h"
+#include "pdfnametounicode.h"
+#include "pdfencoding.h"
+#include "pdfpainterutils.h"
+#include "pdftransparencyrenderer.h"
+#include "pdfcolorconvertor.h"
 
 #include <regex>
+#include <random>
+#include <numeric>
 
 #ifdef PDF4QT_COMPILER_MSVC
 #pragma warning(push)
@@ -55,21 +82,84 @@ private slots:
     void test_bool();
     void test_ad();
     void test_command();
+    void test_typed_tokens();
+    void test_byte_scanner();
     void test_invalid_input();
     void test_header_regexp();
     void test_flat_map();
+    void test_dictionary_index();
+    void test_name_table();
+    void test_object_arena();
     void test_lzw_filter();
+    void test_stream_reader();
+    void test_decoded_stream_cache();
+    void test_image_cache();
+    void test_lazy_stream_decryption();
+    void test_stream_predictor();
+    void test_stream_predictor_benchmark_data();
+    void test_stream_predictor_benchmark();
     void test_sampled_function();
     void test_exponential_function();
     void test_stitching_function();
     void test_postscript_function();
     void test_jbig2_arithmetic_decoder();
+    void test_jbig2_bitmap();
+    void test_ccitt_decoder();
+    void test_ccitt_decoder_benchmark_data();
+    void test_ccitt_decoder_benchmark();
+    void test_text_layout_benchmark_data();
+    void test_text_layout_benchmark();
+    void test_lcs_benchmark_data();
+    void test_lcs_benchmark();
+    void test_image_downscale_denominator();
+    void test_device_color_space_image();
+    void test_lazy_object_loading();
+    void test_damaged_document_recovery();
+    void test_incremental_update();
+    void test_compressed_document_writer();
+    void test_incremental_document_writer();
+    void test_compressed_streaming_document_writer();
+    void test_streaming_merger_stream_passthrough();
+    void test_streaming_merger_prefetch();
+    void test_streaming_merger_deduplication();
+    void test_optimizer_merge_identical_objects();
+    void test_optimizer_downsample_images();
+    void test_font_subsetter_truetype();
+    void test_object_reachability();
+    void test_document_builder_append_pages();
+    void test_object_storage_copy_on_write();
+    void test_object_storage_memory_estimate();
+    void test_streaming_merger_page_subset();
+    void test_streaming_object_statistics();
+    void test_execution_policy_nested();
+    void test_execution_policy_sort_reduce();
+    void test_tracing();
+    void test_memory_report();
+    void test_snap_point_index();
+    void test_rectangle_tree();
+    void test_page_tree_lazy_loading();
+    void test_name_tree_lookup();
+    void test_structure_tree_lazy_loading();
+    void test_glyph_name_to_unicode();
+    void test_encoding_span_conversion();
+    void test_number_scanning_benchmark();
+    void test_xref_table_fixed_width_records();
+    void test_function_apply_many();
+    void test_axis_aligned_rectangle_path();
+    void test_path_coverage_rasterizer();
+    void test_color_convertor_rendered_image();
+    void test_document_snapshot();
+    void test_document_preloader();
+    void test_document_data_source();
 
 private:
     void scanWholeStream(const char* stream);
     void testTokens(const char* stream, const std::vector<pdf::PDFLexicalAnalyzer::Token>& tokens);
 
     QString getStringFromTokens(const std::vector<pdf::PDFLexicalAnalyzer::Token>& tokens);
+
+    /// Creates simple one page document with classic reference table
+    QByteArray createTestDocument() const;
 };
 
 LexicalAnalyzerTest::LexicalAnalyzerTest()
@@ -103,6 +193,19 @@ void LexicalAnalyzerTest::test_numbers()
     testTokens("1 +2 -3 +40 -55", { Token(Type::Integer, 1), Token(Type::Integer, 2), Token(Type::Integer, -3), Token(Type::Integer, 40), Token(Type::Integer, -55) });
     testTokens(".0 0.1 3.5 -4. +5.0 -6.58 7.478", { Token(Type::Real, 0.0),  Token(Type::Real, 0.1),  Token(Type::Real, 3.5),  Token(Type::Real, -4.0),  Token(Type::Real, 5.0),  Token(Type::Real, -6.58),  Token(Type::Real, 7.478) });
     testTokens("1000000000000000000000000000", { Token(Type::Real, 1e27) });
+
+    // Short decimals must be correctly rounded
+    const char* stream = "0.1 -0.3 12.34 .5 -.25 595.276 0.0000001 100000000000000000000";
+    const std::vector<pdf::PDFReal> expected = { 0.1, -0.3, 12.34, 0.5, -0.25, 595.276, 0.0000001, 1e20 };
+    pdf::PDFLexicalAnalyzer analyzer(stream, stream + strlen(stream));
+    pdf::PDFLexicalAnalyzer::TypedToken token;
+
+    for (pdf::PDFReal value : expected)
+    {
+        analyzer.fetch(token);
+        QCOMPARE(token.type, Type::Real);
+        QCOMPARE(token.real, value);
+    }
 }
 
 void LexicalAnalyzerTest::test_strings()
@@ -219,6 +322,93 @@ void LexicalAnalyzerTest::test_command()
     testTokens("command1 command2", { Token(Type::Command, QByteArray("command1")), Token(Type::Command, QByteArray("command2")) });
 }
 
+void LexicalAnalyzerTest::test_typed_tokens()
+{
+    using TypedToken = pdf::PDFLexicalAnalyzer::TypedToken;
+    using Type = pdf::PDFLexicalAnalyzer::TokenType;
+
+    const char* stream = "/Name /A#42C (Simple) (Esc\\(aped) <414243> 12 -3.5 false cm";
+    pdf::PDFLexicalAnalyzer analyzer(stream, stream + strlen(stream));
+
+    TypedToken token;
+    analyzer.fetch(token);
+    QCOMPARE(token.type, Type::Name);
+    QVERIFY(!token.isStringBuffered);
+    QVERIFY(token.getString().data() == stream + 1);
+    QCOMPARE(token.getByteArray(), QByteArray("Name"));
+
+    analyzer.fetch(token);
+    QCOMPARE(token.type, Type::Name);
+    QVERIFY(token.isStringBuffered);
+    QCOMPARE(token.getByteArray(), QByteArray("ABC"));
+
+    analyzer.fetch(token);
+    QCOMPARE(token.type, Type::String);
+    QVERIFY(!token.isStringBuffered);
+    QCOMPARE(token.getByteArray(), QByteArray("Simple"));
+
+    analyzer.fetch(token);
+    QCOMPARE(token.type, Type::String);
+    QVERIFY(token.isStringBuffered);
+    QCOMPARE(token.getByteArray(), QByteArray("Esc(aped"));
+
+    analyzer.fetch(token);
+    QCOMPARE(token.type, Type::String);
+    QCOMPARE(token.getByteArray(), QByteArray("ABC"));
+
+    analyzer.fetch(token);
+    QCOMPARE(token.type, Type::Integer);
+    QCOMPARE(token.integer, pdf::PDFInteger(12));
+
+    analyzer.fetch(token);
+    QCOMPARE(token.type, Type::Real);
+    QCOMPARE(token.real, -3.5);
+
+    analyzer.fetch(token);
+    QCOMPARE(token.type, Type::Boolean);
+    QCOMPARE(token.boolean, false);
+
+    analyzer.fetch(token);
+    QVERIFY(token.isCommand("cm"));
+
+    TypedToken convertedToken = TypedToken::fromToken(token.toToken());
+    QVERIFY(convertedToken.isCommand("cm"));
+
+    analyzer.fetch(token);
+    QCOMPARE(token.type, Type::EndOfFile);
+}
+
+void LexicalAnalyzerTest::test_byte_scanner()
+{
+    // Characters are placed at various positions, so both block and scalar scanning is tested
+    QByteArray buffer;
+    for (int i = 0; i < 70; ++i)
+    {
+        buffer.append(QByteArray(i, ' '));
+        buffer.append("/Name");
+        buffer.append(QByteArray(i % 7, 'x'));
+        buffer.append("(text)\r\n");
+    }
+    buffer.append("endobj");
+
+    const char* begin = buffer.constData();
+    const char* end = buffer.constData() + buffer.size();
+
+    for (const char* current = begin; current != end; ++current)
+    {
+        QVERIFY(pdf::PDFByteScanner::skipWhitespace(current, end) == std::find_if(current, end, [](char c) { return !pdf::PDFLexicalAnalyzer::isWhitespace(c); }));
+        QVERIFY(pdf::PDFByteScanner::findNonRegular(current, end) == std::find_if(current, end, [](char c) { return !pdf::PDFLexicalAnalyzer::isRegular(c); }));
+        QVERIFY(pdf::PDFByteScanner::findLineEnd(current, end) == std::find_if(current, end, [](char c) { return c == '\r' || c == '\n'; }));
+        QVERIFY(pdf::PDFByteScanner::findLiteralStringSpecialCharacter(current, end) == std::find_if(current, end, [](char c) { return c == '(' || c == ')' || c == '\\'; }));
+
+        for (const char* what : { "Name", "endobj", "t)", "missing" })
+        {
+            const size_t length = std::strlen(what);
+            QVERIFY(pdf::PDFByteScanner::find(current, end, what, length) == std::search(current, end, what, what + length));
+        }
+    }
+}
+
 void LexicalAnalyzerTest::test_invalid_input()
 {
     QByteArray bigNumber(500, '0');
@@ -258,6 +448,104 @@ void LexicalAnalyzerTest::test_header_regexp()
     }
 }
 
+void LexicalAnalyzerTest::test_dictionary_index()
+{
+    const size_t count = pdf::PDFDictionary::INDEX_THRESHOLD * 4;
+
+    pdf::PDFDictionary dictionary;
+    for (size_t i = 0; i < count; ++i)
+    {
+        // Keys are added in reversed order, with long keys between short ones
+        const QByteArray key = QByteArray::number(static_cast<qlonglong>(count - i)) + ((i % 2) ? QByteArray("LongKeyStoredInMemory") : QByteArray());
+        dictionary.addEntry(pdf::PDFInplaceOrMemoryString(key), pdf::PDFObject::createInteger(static_cast<pdf::PDFInteger>(i)));
+    }
+
+    // Duplicate key, first occurence must be found
+    dictionary.addEntry(pdf::PDFInplaceOrMemoryString("2"), pdf::PDFObject::createInteger(-1));
+    dictionary.optimize();
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const QByteArray key = QByteArray::number(static_cast<qlonglong>(count - i)) + ((i % 2) ? QByteArray("LongKeyStoredInMemory") : QByteArray());
+        QVERIFY(dictionary.hasKey(key));
+        QCOMPARE(dictionary.get(key).getInteger(), static_cast<pdf::PDFInteger>(i));
+        QCOMPARE(dictionary.getKey(i).getString(), key);
+    }
+
+    QVERIFY(!dictionary.hasKey("0"));
+    QVERIFY(!dictionary.hasKey(QByteArray()));
+
+    // Changing the dictionary must keep the lookup valid
+    dictionary.removeEntry("4");
+    dictionary.setEntry(pdf::PDFInplaceOrMemoryString("0"), pdf::PDFObject::createInteger(1000));
+    QVERIFY(!dictionary.hasKey("4"));
+    QCOMPARE(dictionary.get("0").getInteger(), static_cast<pdf::PDFInteger>(1000));
+    QCOMPARE(dictionary.getKey(dictionary.getCount() - 1).getString(), QByteArray("0"));
+}
+
+void LexicalAnalyzerTest::test_name_table()
+{
+    const char* stream = "<< /ThisIsVeryLongKeyName /ThisIsVeryLongKeyName /Short /Short >>";
+    pdf::PDFParser parser(stream, stream + strlen(stream), nullptr, pdf::PDFParser::None);
+    pdf::PDFObject object = parser.getObject();
+
+    QVERIFY(object.isDictionary());
+    const pdf::PDFDictionary* dictionary = object.getDictionary();
+    QCOMPARE(dictionary->getCount(), size_t(2));
+
+    // Long key and long name value share the interned data
+    const pdf::PDFObject& value = dictionary->get("ThisIsVeryLongKeyName");
+    QVERIFY(value.isName());
+    QVERIFY(!dictionary->getKey(0).isInplace());
+    QVERIFY(value.getStringObject().memoryString);
+    QVERIFY(dictionary->getKey(0).getView().data() == value.getStringObject().memoryString->getString().constData());
+    QVERIFY(pdf::PDFNameTable::intern("ThisIsVeryLongKeyName").constData() == value.getStringObject().memoryString->getString().constData());
+
+    // Short names are stored inplace
+    QVERIFY(dictionary->getKey(1).isInplace());
+    QVERIFY(dictionary->get("Short").getStringObject().inplaceString);
+}
+
+void LexicalAnalyzerTest::test_object_arena()
+{
+    pdf::PDFObjectArenaPointer arena = std::make_shared<pdf::PDFObjectArena>(4096);
+
+    // Blocks are aligned and do not overlap
+    void* first = arena->allocate(3, 1);
+    void* second = arena->allocate(16, 16);
+    QVERIFY(reinterpret_cast<std::uintptr_t>(second) % 16 == 0);
+    QVERIFY(static_cast<char*>(second) >= static_cast<char*>(first) + 3);
+    QCOMPARE(arena->getAllocatedSize(), size_t(4096));
+
+    // Large block has its own chunk
+    arena->allocate(2048, 8);
+    QCOMPARE(arena->getAllocatedSize(), size_t(4096 + 2048 + 8));
+
+    const char* stream = "<< /Array [1 2 (This is a long string)] /Name /ThisIsVeryLongName >> 5 0 obj";
+    pdf::PDFObject object;
+    {
+        pdf::PDFParser parser(stream, stream + strlen(stream), nullptr, pdf::PDFParser::None);
+        parser.setObjectArena(arena);
+        object = parser.getObject();
+    }
+
+    // Objects keep the arena alive
+    std::weak_ptr<pdf::PDFObjectArena> weakArena = arena;
+    arena.reset();
+    QVERIFY(!weakArena.expired());
+
+    QVERIFY(object.isDictionary());
+    const pdf::PDFDictionary* dictionary = object.getDictionary();
+    const pdf::PDFObject& array = dictionary->get("Array");
+    QVERIFY(array.isArray());
+    QCOMPARE(array.getArray()->getCount(), size_t(3));
+    QCOMPARE(array.getArray()->getItem(2).getString(), QByteArray("This is a long string"));
+    QCOMPARE(dictionary->get("Name").getString(), QByteArray("ThisIsVeryLongName"));
+
+    object = pdf::PDFObject();
+    QVERIFY(weakArena.expired());
+}
+
 void LexicalAnalyzerTest::test_flat_map()
 {
     using Map = pdf::PDFFlatMap<int, 2>;
@@ -325,6 +613,240 @@ void LexicalAnalyzerTest::test_lzw_filter()
     QCOMPARE(decoded, valid);
 }
 
+void LexicalAnalyzerTest::test_stream_reader()
+{
+    auto createStream = [](const QByteArray& dictionary, const QByteArray& content)
+    {
+        QByteArray data = "<< " + dictionary + " /Length " + QByteArray::number(content.size()) + " >> stream\n" + content + "\nendstream";
+        pdf::PDFParser parser(data, nullptr, pdf::PDFParser::AllowStreams);
+        return parser.getObject();
+    };
+
+    auto readInChunks = [](const pdf::PDFStream* stream)
+    {
+        pdf::PDFStreamReaderPointer reader = pdf::PDFStreamFilterStorage::createDecodedStreamReader(stream, nullptr);
+
+        QByteArray result;
+        char buffer[7] = { };
+        while (qint64 bytesRead = reader->read(buffer, std::size(buffer)))
+        {
+            result.append(buffer, bytesRead);
+        }
+        return result;
+    };
+
+    // Lines with all PNG predictor types, the last line is incomplete
+    QByteArray predicted;
+    for (int i = 0; i < 4000; ++i)
+    {
+        predicted.push_back(static_cast<char>((i % 9 == 0) ? (i / 9) % 5 : (i * 37) % 251));
+    }
+
+    QByteArray hexEncoded = pdf::PDFFlateDecodeFilter::compress(predicted).toHex(' ');
+    pdf::PDFObject flateStream = createStream("/Filter [/AHx /Fl] /DecodeParms [null << /Predictor 12 /Colors 2 /Columns 4 >>]", hexEncoded);
+    QVERIFY(flateStream.isStream());
+
+    QByteArray decoded = pdf::PDFStreamFilterStorage::getDecodedStream(flateStream.getStream(), nullptr);
+    QCOMPARE(decoded.size(), (4000 + 8) / 9 * 8);
+    QCOMPARE(readInChunks(flateStream.getStream()), decoded);
+
+    // Decoded length hint gives the same result
+    pdf::PDFObject flateStreamWithHint = createStream("/Filter [/AHx /Fl] /DecodeParms [null << /Predictor 12 /Colors 2 /Columns 4 >>] /DL " + QByteArray::number(decoded.size()), hexEncoded);
+    QCOMPARE(pdf::PDFStreamFilterStorage::getDecodedStream(flateStreamWithHint.getStream(), nullptr), decoded);
+
+    // Run length stream is terminated by end of data marker
+    pdf::PDFObject runLengthStream = createStream("/Filter /RL", QByteArray::fromHex("02414243FD44807F"));
+    QVERIFY(runLengthStream.isStream());
+    QCOMPARE(readInChunks(runLengthStream.getStream()), QByteArray("ABCDDDD"));
+}
+
+void LexicalAnalyzerTest::test_decoded_stream_cache()
+{
+    QByteArray content = pdf::PDFFlateDecodeFilter::compress(QByteArray(1000, 'A'));
+    QByteArray data = "<< /Filter /Fl /Length " + QByteArray::number(content.size()) + " >> stream\n" + content + "\nendstream";
+    pdf::PDFParser parser(data, nullptr, pdf::PDFParser::AllowStreams);
+    pdf::PDFObject stream = parser.getObject();
+    QVERIFY(stream.isStream());
+
+    pdf::PDFObjectStorage storage;
+    QCOMPARE(storage.getDecodedStream(stream.getStream()), QByteArray(1000, 'A'));
+    QCOMPARE(storage.getDecodedStreamCacheStatistics().misses, qint64(0));
+
+    storage.setDecodedStreamCacheBudget(1000);
+    QCOMPARE(storage.getDecodedStream(stream.getStream()), QByteArray(1000, 'A'));
+    QCOMPARE(storage.getDecodedStream(stream.getStream()), QByteArray(1000, 'A'));
+
+    pdf::PDFDecodedStreamCacheStatistics statistics = storage.getDecodedStreamCacheStatistics();
+    QCOMPARE(statistics.hits, qint64(1));
+    QCOMPARE(statistics.misses, qint64(1));
+    QCOMPARE(statistics.size, qint64(1000));
+
+    // Stream larger than the budget is not cached
+    storage.setDecodedStreamCacheBudget(999);
+    QCOMPARE(storage.getDecodedStream(stream.getStream()), QByteArray(1000, 'A'));
+    QCOMPARE(storage.getDecodedStreamCacheStatistics().size, qint64(0));
+}
+
+void LexicalAnalyzerTest::test_image_cache()
+{
+    pdf::PDFImageCache cache(1024 * 1024);
+
+    int createCount = 0;
+    auto create = [&createCount](pdf::PDFImageCache::Image& image)
+    {
+        ++createCount;
+        image.image = QImage(16, 16, QImage::Format_RGB32);
+        image.imageRect = QRectF(0.0, 0.0, 1.0, 1.0);
+        return true;
+    };
+
+    pdf::PDFImageCache::Key key;
+    key.streamId = 1;
+    QCOMPARE(cache.getImage(key, create).image.size(), QSize(16, 16));
+    QCOMPARE(cache.getImage(key, create).image.size(), QSize(16, 16));
+    QCOMPARE(createCount, 1);
+
+    // Image converted at different scale is a different image
+    key.scaleDenominator = 2;
+    cache.getImage(key, create);
+    QCOMPARE(createCount, 2);
+
+    // Image, which wasn't created successfully, is not cached
+    key.streamId = 2;
+    auto cancelledCreate = [&createCount](pdf::PDFImageCache::Image& image) { ++createCount; image.image = QImage(16, 16, QImage::Format_RGB32); return false; };
+    cache.getImage(key, cancelledCreate);
+    cache.getImage(key, cancelledCreate);
+    QCOMPARE(createCount, 4);
+
+    pdf::PDFImageCacheStatistics statistics = cache.getStatistics();
+    QCOMPARE(statistics.hits, qint64(1));
+    QCOMPARE(statistics.misses, qint64(4));
+    QCOMPARE(statistics.size, qint64(2 * 16 * 16 * 4));
+}
+
+void LexicalAnalyzerTest::test_lazy_stream_decryption()
+{
+    QByteArray content;
+    for (int i = 0; i < 1000; ++i)
+    {
+        content.push_back(static_cast<char>((i * 31) % 256));
+    }
+
+    for (pdf::PDFSecurityHandlerFactory::Algorithm algorithm : { pdf::PDFSecurityHandlerFactory::RC4, pdf::PDFSecurityHandlerFactory::AES_128, pdf::PDFSecurityHandlerFactory::AES_256 })
+    {
+        pdf::PDFSecurityHandlerFactory::SecuritySettings settings;
+        settings.algorithm = algorithm;
+        settings.userPassword = "user";
+        settings.ownerPassword = "owner";
+        settings.id = "0123456789ABCDEF";
+
+        pdf::PDFSecurityHandlerPointer securityHandler = pdf::PDFSecurityHandlerFactory::createSecurityHandler(settings);
+        QVERIFY(securityHandler);
+
+        const pdf::PDFObjectReference reference(5, 0);
+        pdf::PDFObject stream = pdf::PDFObject::createStream(std::make_shared<pdf::PDFStream>(pdf::PDFDictionary(), QByteArray(content)));
+        pdf::PDFObject encryptedStream = securityHandler->encryptObject(stream, reference);
+        pdf::PDFObject decryptedStream = securityHandler->decryptObject(encryptedStream, reference, pdf::PDFSecurityHandler::createStreamDecryptor(securityHandler));
+
+        QVERIFY(decryptedStream.isStream());
+        QVERIFY(decryptedStream.getStream()->isContentDecryptedLazily());
+        QCOMPARE(decryptedStream.getStream()->getDictionary()->get("Length").getInteger(), pdf::PDFInteger(content.size()));
+        QCOMPARE(pdf::PDFStreamFilterStorage::getDecodedStream(decryptedStream.getStream(), nullptr), content);
+        QCOMPARE(*decryptedStream.getStream()->getContent(), content);
+        QCOMPARE(securityHandler->decryptObject(encryptedStream, reference), decryptedStream);
+    }
+}
+
+static pdf::PDFStreamPredictor createStreamPredictor(int predictor, int colors, int bitsPerComponent, int columns)
+{
+    QByteArray parameters = QString("<< /Predictor %1 /Colors %2 /BitsPerComponent %3 /Columns %4 >>").arg(predictor).arg(colors).arg(bitsPerComponent).arg(columns).toLatin1();
+    pdf::PDFParser parser(parameters, nullptr, pdf::PDFParser::None);
+    return pdf::PDFStreamPredictor::createPredictor([](const pdf::PDFObject& object) -> const pdf::PDFObject& { return object; }, parser.getObject());
+}
+
+static QByteArray createStreamPredictorData(int predictor, int colors, int bitsPerComponent, int columns, int lines)
+{
+    const int stride = (columns * colors * bitsPerComponent + 7) / 8;
+    const bool isPNG = predictor >= 10;
+
+    QByteArray data;
+    uint32_t value = 12345;
+    for (int line = 0; line < lines; ++line)
+    {
+        if (isPNG)
+        {
+            data.push_back(static_cast<char>(line % 5));
+        }
+
+        for (int i = 0; i < stride; ++i)
+        {
+            value = value * 1103515245 + 12345;
+            data.push_back(static_cast<char>(value >> 16));
+        }
+    }
+
+    return data;
+}
+
+void LexicalAnalyzerTest::test_stream_predictor()
+{
+    for (int predictor : { 2, 15 })
+    {
+        for (int bitsPerComponent : { 1, 2, 4, 8, 16 })
+        {
+            for (int colors : { 1, 2, 3, 4, 5 })
+            {
+                pdf::PDFStreamPredictor streamPredictor = createStreamPredictor(predictor, colors, bitsPerComponent, 37);
+                QByteArray data = createStreamPredictorData(predictor, colors, bitsPerComponent, 37, 11);
+
+                QByteArray reference = streamPredictor.apply(data, pdf::PDFStreamPredictor::Implementation::Reference);
+                QCOMPARE(streamPredictor.apply(data, pdf::PDFStreamPredictor::Implementation::Optimized), reference);
+                QCOMPARE(streamPredictor.createReader(std::make_unique<pdf::PDFByteArrayStreamReader>(data))->readAll(), reference);
+            }
+        }
+    }
+}
+
+void LexicalAnalyzerTest::test_stream_predictor_benchmark_data()
+{
+    QTest::addColumn<int>("predictor");
+    QTest::addColumn<int>("colors");
+    QTest::addColumn<int>("bitsPerComponent");
+    QTest::addColumn<bool>("optimized");
+
+    for (bool optimized : { false, true })
+    {
+        const char* implementation = optimized ? "optimized" : "reference";
+        QTest::addRow("png-rgb8-%s", implementation) << 15 << 3 << 8 << optimized;
+        QTest::addRow("png-cmyk8-%s", implementation) << 15 << 4 << 8 << optimized;
+        QTest::addRow("png-gray16-%s", implementation) << 15 << 1 << 16 << optimized;
+        QTest::addRow("tiff-rgb8-%s", implementation) << 2 << 3 << 8 << optimized;
+        QTest::addRow("tiff-gray16-%s", implementation) << 2 << 1 << 16 << optimized;
+        QTest::addRow("tiff-rgb16-%s", implementation) << 2 << 3 << 16 << optimized;
+    }
+}
+
+void LexicalAnalyzerTest::test_stream_predictor_benchmark()
+{
+    QFETCH(int, predictor);
+    QFETCH(int, colors);
+    QFETCH(int, bitsPerComponent);
+    QFETCH(bool, optimized);
+
+    pdf::PDFStreamPredictor streamPredictor = createStreamPredictor(predictor, colors, bitsPerComponent, 2048);
+    QByteArray data = createStreamPredictorData(predictor, colors, bitsPerComponent, 2048, 256);
+    const pdf::PDFStreamPredictor::Implementation implementation = optimized ? pdf::PDFStreamPredictor::Implementation::Optimized
+                                                                             : pdf::PDFStreamPredictor::Implementation::Reference;
+
+    QByteArray result;
+    QBENCHMARK
+    {
+        result = streamPredictor.apply(data, implementation);
+    }
+
+    QVERIFY(!result.isEmpty());
+}
+
 void LexicalAnalyzerTest::test_sampled_function()
 {
     {
@@ -1064,6 +1586,30 @@ void LexicalAnalyzerTest::test_postscript_function()
     test01("pop 4 3 2 1   3 -1 roll 3 eq { 1 eq { 2 eq { 4 eq { 1.0 } { 0.0 } ifelse } { 0.0 } ifelse } { 0.0 } ifelse } { 0.0 } ifelse", [](double) { return 1.0; }); // we should have 4 2 1 3
     test01("2.0 2 copy div 3 1 roll exp add", [](double x) { return qBound(0.0, 0.5 * x + std::pow(x, 2.0), 1.0); });
     test01("2.0 1 index exch div exch pop", [](double x) { return x / 2.0; });
+
+    // Function evaluated many times is sampled to the lookup table, if interpolated
+    // values are within the tolerance (step functions must remain exact).
+    auto test02 = [&](const char* program, auto verifyFunction, double tolerance)
+    {
+        QByteArray data = makeStream(0, 1, 0, 1, program);
+
+        pdf::PDFDocument document;
+        pdf::PDFParser parser(data, nullptr, pdf::PDFParser::AllowStreams);
+        pdf::PDFFunctionPtr function = pdf::PDFFunction::createFunction(&document, parser.getObject());
+
+        QVERIFY(function);
+        for (int i = 0; i < 10000; ++i)
+        {
+            const double value = (i % 997) / 996.0;
+            double actual = 0.0;
+            QVERIFY(function->apply(&value, &value + 1, &actual, &actual + 1));
+            QVERIFY(std::abs(verifyFunction(value) - actual) <= tolerance);
+        }
+    };
+
+    test02("{ dup mul }", [](double x) { return x * x; }, 1.0 / 1024.0);
+    test02("{ 0.5 gt { 1.0 } { 0.0 } ifelse }", [](double x) { return (x > 0.5) ? 1.0 : 0.0; }, 1e-10);
+    test02("{ 10.0 mul floor 10.0 div }", [](double x) { return std::floor(10.0 * x) / 10.0; }, 1e-10);
 }
 
 void LexicalAnalyzerTest::test_jbig2_arithmetic_decoder()
@@ -1105,55 +1651,2279 @@ void LexicalAnalyzerTest::test_jbig2_arithmetic_decoder()
     QVERIFY(decompressed == decompressedByAD);
 }
 
-void LexicalAnalyzerTest::scanWholeStream(const char* stream)
+void LexicalAnalyzerTest::test_jbig2_bitmap()
 {
-    pdf::PDFLexicalAnalyzer analyzer(stream, stream + strlen(stream));
+    pdf::PDFJBIG2Bitmap source(70, 2, 0x00);
+    for (int y = 0; y < source.getHeight(); ++y)
+    {
+        for (int x = 0; x < source.getWidth(); ++x)
+        {
+            source.setPixel(x, y, ((x + y) % 3 == 0) ? 0xFF : 0x00);
+        }
+    }
 
-    // Scan whole stream
-    while (!analyzer.isAtEnd())
+    // Paint across word boundaries and clip the source on both sides
+    for (int offsetX : { -5, 0, 37, 100 })
     {
-        analyzer.fetch();
+        pdf::PDFJBIG2Bitmap target(150, 3, 0xFF);
+        target.paint(source, offsetX, 1, pdf::PDFJBIG2BitOperation::Xor, false, 0x00);
+
+        for (int y = 0; y < target.getHeight(); ++y)
+        {
+            for (int x = 0; x < target.getWidth(); ++x)
+            {
+                QCOMPARE(target.getPixel(x, y), uint8_t(0xFF ^ source.getPixelSafe(x - offsetX, y - 1)));
+            }
+        }
+
+        pdf::PDFJBIG2Bitmap subbitmap = target.getSubbitmap(offsetX + 3, 1, 65, 2);
+        for (int y = 0; y < subbitmap.getHeight(); ++y)
+        {
+            for (int x = 0; x < subbitmap.getWidth(); ++x)
+            {
+                QCOMPARE(subbitmap.getPixel(x, y), target.getPixelSafe(x + offsetX + 3, y + 1));
+            }
+        }
     }
+
+    // Set pixels are black in the image data, unused bits are zero
+    pdf::PDFJBIG2Bitmap bitmap(10, 1, 0x00);
+    bitmap.setPixel(0, 0, 0xFF);
+    bitmap.setPixel(9, 0, 0xFF);
+    QCOMPARE(bitmap.toImageData(pdf::PDFImageData::MaskingType::None).getData(), QByteArray::fromHex("7f80"));
 }
 
-void LexicalAnalyzerTest::testTokens(const char* stream, const std::vector<pdf::PDFLexicalAnalyzer::Token>& tokens)
+/// Creates Group 4 encoded image. Even rows consist of runs white 4 + black 4 encoded
+/// in horizontal mode, odd rows consist of runs white 3 + black 5, encoded in vertical mode.
+static QByteArray createCCITTGroup4Data(int columns, int rows)
 {
-    pdf::PDFLexicalAnalyzer analyzer(stream, stream + strlen(stream));
+    Q_ASSERT(columns % 8 == 0);
 
-    std::vector<pdf::PDFLexicalAnalyzer::Token> scanned;
-    scanned.reserve(tokens.size());
+    std::string bits;
+    for (int row = 0; row < rows; ++row)
+    {
+        for (int column = 0; column < columns; column += 8)
+        {
+            if (row % 2 == 0)
+            {
+                // Horizontal mode, white run 4, black run 4
+                bits += "001" "1011" "011";
+            }
+            else
+            {
+                // Vertical mode, a1 is one pixel left of b1, then a1 = b1
+                bits += "010" "1";
+            }
+        }
+    }
 
-    // Scan whole stream
-    while (!analyzer.isAtEnd())
+    QByteArray data((bits.size() + 7) / 8, 0);
+    for (size_t i = 0; i < bits.size(); ++i)
     {
-        scanned.emplace_back(analyzer.fetch());
+        if (bits[i] == '1')
+        {
+            data[i / 8] = data[i / 8] | char(0x80 >> (i % 8));
+        }
     }
 
-    QVERIFY(scanned.size() == tokens.size());
+    return data;
+}
 
-    for (size_t i = 0; i < scanned.size(); ++i)
+static pdf::PDFCCITTFaxDecoderParameters createCCITTGroup4Parameters(int columns, int rows)
+{
+    pdf::PDFCCITTFaxDecoderParameters parameters;
+    parameters.K = -1;
+    parameters.columns = columns;
+    parameters.rows = rows;
+    parameters.hasEndOfBlock = false;
+    parameters.decode = { 0.0, 1.0 };
+    return parameters;
+}
+
+void LexicalAnalyzerTest::test_ccitt_decoder()
+{
+    for (int columns : { 8, 16, 1728 })
     {
-        const pdf::PDFLexicalAnalyzer::Token& scannedItem = scanned[i];
-        const pdf::PDFLexicalAnalyzer::Token& tokenItem = scanned[i];
+        const int rows = 6;
+        QByteArray data = createCCITTGroup4Data(columns, rows);
+        pdf::PDFCCITTFaxDecoderParameters parameters = createCCITTGroup4Parameters(columns, rows);
 
-        if (scannedItem == tokenItem)
+        pdf::PDFCCITTFaxDecoder referenceDecoder(&data, parameters);
+        pdf::PDFCCITTFaxDecoder optimizedDecoder(&data, parameters);
+        pdf::PDFImageData referenceImage = referenceDecoder.decode(pdf::PDFCCITTFaxDecoder::Implementation::Reference);
+        pdf::PDFImageData optimizedImage = optimizedDecoder.decode(pdf::PDFCCITTFaxDecoder::Implementation::Optimized);
+
+        QByteArray expectedData;
+        for (int row = 0; row < rows; ++row)
         {
-            continue;
+            expectedData.append(columns / 8, row % 2 == 0 ? char(0xF0) : char(0xE0));
         }
 
-        if (scannedItem.type == tokenItem.type && scannedItem.type == pdf::PDFLexicalAnalyzer::TokenType::Real)
+        QCOMPARE(optimizedImage.getHeight(), unsigned(rows));
+        QCOMPARE(optimizedImage.getData(), expectedData);
+        QCOMPARE(referenceImage.getData(), expectedData);
+    }
+}
+
+void LexicalAnalyzerTest::test_ccitt_decoder_benchmark_data()
+{
+    QTest::addColumn<bool>("optimized");
+
+    QTest::addRow("reference") << false;
+    QTest::addRow("optimized") << true;
+}
+
+void LexicalAnalyzerTest::test_ccitt_decoder_benchmark()
+{
+    QFETCH(bool, optimized);
+
+    // Size of A4 page scanned at fine fax resolution
+    const int columns = 1728;
+    const int rows = 2200;
+    QByteArray data = createCCITTGroup4Data(columns, rows);
+    pdf::PDFCCITTFaxDecoderParameters parameters = createCCITTGroup4Parameters(columns, rows);
+    const pdf::PDFCCITTFaxDecoder::Implementation implementation = optimized ? pdf::PDFCCITTFaxDecoder::Implementation::Optimized
+                                                                             : pdf::PDFCCITTFaxDecoder::Implementation::Reference;
+
+    pdf::PDFImageData image;
+    QBENCHMARK
+    {
+        pdf::PDFCCITTFaxDecoder decoder(&data, parameters);
+        image = decoder.decode(implementation);
+    }
+
+    QCOMPARE(image.getHeight(), unsigned(rows));
+}
+
+void LexicalAnalyzerTest::test_text_layout_benchmark_data()
+{
+    QTest::addColumn<int>("rows");
+    QTest::addColumn<int>("columns");
+
+    QTest::addRow("table-20x5") << 20 << 5;
+    QTest::addRow("table-60x10") << 60 << 10;
+    QTest::addRow("table-120x20") << 120 << 20;
+}
+
+void LexicalAnalyzerTest::test_text_layout_benchmark()
+{
+    QFETCH(int, rows);
+    QFETCH(int, columns);
+
+    // Synthetic data table page - each cell contains six characters. Cells in a row
+    // are far enough to form separate lines, rows are close enough, so each column
+    // forms a single text block.
+    constexpr pdf::PDFReal advance = 5.0;
+    constexpr pdf::PDFReal fontSize = 8.0;
+    constexpr int cellLength = 6;
+
+    pdf::PDFTextLayout layout;
+    for (int row = 0; row < rows; ++row)
+    {
+        for (int column = 0; column < columns; ++column)
         {
-            if (qFuzzyCompare(scannedItem.data.toDouble(), tokenItem.data.toDouble()))
+            for (int i = 0; i < cellLength; ++i)
             {
-                continue;
+                pdf::PDFTextCharacterInfo info;
+                info.character = QChar('0' + (row + column + i) % 10);
+                info.outline.addRect(0.0, 0.0, advance, fontSize);
+                info.advance = advance;
+                info.fontSize = fontSize;
+                info.matrix = QTransform::fromTranslate(column * 2 * cellLength * advance + i * advance, row * 12.0);
+                layout.addCharacter(info);
             }
         }
+    }
 
-        // Now, compare scanned tokens
-        QString actual = getStringFromTokens({ scannedItem });
-        QString expected = getStringFromTokens({ tokenItem });
-        QVERIFY2(scannedItem == tokenItem, qPrintable(QString("stream: %1, actual = %2, expected = %3").arg(QString(stream), actual, expected)));
+    pdf::PDFTextLayout result;
+    QBENCHMARK
+    {
+        result = layout;
+        result.perform();
+    }
+
+    QCOMPARE(result.getTextBlocks().size(), size_t(columns));
+
+    size_t lineCount = 0;
+    for (const pdf::PDFTextBlock& block : result.getTextBlocks())
+    {
+        lineCount += block.getLines().size();
+    }
+    QCOMPARE(lineCount, size_t(rows * columns));
+}
+
+void LexicalAnalyzerTest::test_lcs_benchmark_data()
+{
+    QTest::addColumn<int>("length");
+    QTest::addColumn<int>("edits");
+
+    QTest::addRow("text-2k") << 2000 << 50;
+    QTest::addRow("text-20k") << 20000 << 200;
+    QTest::addRow("text-500k") << 500000 << 1000;
+}
+
+void LexicalAnalyzerTest::test_lcs_benchmark()
+{
+    QFETCH(int, length);
+    QFETCH(int, edits);
+
+    // Right text is created from the left one by random replacements,
+    // insertions and removals of characters.
+    QRandomGenerator generator(length);
+    QString left;
+    left.reserve(length);
+    for (int i = 0; i < length; ++i)
+    {
+        left.append(QChar('a' + generator.bounded(26)));
+    }
+
+    QString right = left;
+    for (int i = 0; i < edits; ++i)
+    {
+        const int position = generator.bounded(int(right.size()));
+        switch (i % 3)
+        {
+            case 0:
+                right[position] = QChar('#');
+                break;
+            case 1:
+                right.insert(position, QChar('$'));
+                break;
+            case 2:
+                right.remove(position, 1);
+                break;
+        }
+    }
+
+    using Algorithm = pdf::PDFAlgorithmLongestCommonSubsequence<QString::const_iterator, std::equal_to<QChar>>;
+
+    auto getMatchCount = [&](Algorithm::Method method, bool* isValid)
+    {
+        Algorithm algorithm(left.cbegin(), left.cend(), right.cbegin(), right.cend(), std::equal_to<QChar>());
+        algorithm.setMethod(method);
+        algorithm.perform();
+
+        // Sequence must cover both inputs in order
+        size_t matchCount = 0;
+        size_t index1 = 0;
+        size_t index2 = 0;
+        *isValid = true;
+        for (const pdf::PDFAlgorithmLongestCommonSubsequenceBase::SequenceItem& item : algorithm.getSequence())
+        {
+            if (item.isLeftValid())
+            {
+                *isValid = *isValid && item.index1 == index1++;
+            }
+            if (item.isRightValid())
+            {
+                *isValid = *isValid && item.index2 == index2++;
+            }
+            if (item.isMatch())
+            {
+                *isValid = *isValid && left[item.index1] == right[item.index2];
+                ++matchCount;
+            }
+        }
+
+        *isValid = *isValid && index1 == size_t(left.size()) && index2 == size_t(right.size());
+        return matchCount;
+    };
+
+    size_t matchCount = 0;
+    bool isValid = false;
+    QBENCHMARK
+    {
+        matchCount = getMatchCount(Algorithm::Method::Myers, &isValid);
+    }
+
+    QVERIFY(isValid);
+
+    // Each edit breaks at most one match
+    QVERIFY(matchCount + edits >= size_t(length));
+
+    if (size_t(length) * size_t(length) <= Algorithm::TABLE_METHOD_CELL_LIMIT)
+    {
+        bool isTableValid = false;
+        QCOMPARE(matchCount, getMatchCount(Algorithm::Method::Table, &isTableValid));
+        QVERIFY(isTableValid);
+    }
+}
+
+void LexicalAnalyzerTest::test_image_downscale_denominator()
+{
+    // Invalid target size - image is decoded at full resolution
+    QCOMPARE(pdf::PDFImage::getDownscaleDenominator(QSize(4800, 6600), QSize()), 1);
+
+    // Decoded image must never be smaller than target size
+    QCOMPARE(pdf::PDFImage::getDownscaleDenominator(QSize(4800, 6600), QSize(600, 825)), 8);
+    QCOMPARE(pdf::PDFImage::getDownscaleDenominator(QSize(4800, 6600), QSize(601, 825)), 4);
+    QCOMPARE(pdf::PDFImage::getDownscaleDenominator(QSize(4800, 6600), QSize(2400, 3300)), 2);
+    QCOMPARE(pdf::PDFImage::getDownscaleDenominator(QSize(4800, 6600), QSize(2401, 100)), 1);
+
+    // Scaled dimensions are rounded up
+    QCOMPARE(pdf::PDFImage::getDownscaleDenominator(QSize(17, 17), QSize(3, 3)), 8);
+
+    // Denominator is limited (for example, by resolution levels of JPEG 2000 image)
+    QCOMPARE(pdf::PDFImage::getDownscaleDenominator(QSize(4800, 6600), QSize(100, 100), 32), 32);
+    QCOMPARE(pdf::PDFImage::getDownscaleDenominator(QSize(4800, 6600), QSize(100, 100), 6), 4);
+    QCOMPARE(pdf::PDFImage::getDownscaleDenominator(QSize(4800, 6600), QSize(100, 100), 1), 1);
+}
+
+void LexicalAnalyzerTest::test_device_color_space_image()
+{
+    pdf::PDFCMSGeneric cms;
+    pdf::PDFColorSpacePointer colorSpace = pdf::PDFAbstractColorSpace::createDeviceColorSpaceByName(nullptr, nullptr, pdf::COLOR_SPACE_NAME_DEVICE_CMYK);
+
+    auto getImage = [&](unsigned int bitsPerComponent, QByteArray data)
+    {
+        const unsigned int stride = 2 * 4 * bitsPerComponent / 8;
+        pdf::PDFImageData imageData(4, bitsPerComponent, 2, 1, stride, pdf::PDFImageData::MaskingType::None, data, { }, { }, { });
+        return colorSpace->getImage(imageData, pdf::PDFImageData(), &cms, pdf::RenderingIntent::Perceptual, nullptr, nullptr);
+    };
+
+    // Cyan pixel and pixel with 50 % of black
+    QImage image8 = getImage(8, QByteArray::fromHex("ff00000000000080"));
+    QCOMPARE(image8.pixel(0, 0), qRgb(0, 255, 255));
+    QCOMPARE(image8.pixel(1, 0), qRgb(127, 127, 127));
+
+    QImage image16 = getImage(16, QByteArray::fromHex("ffff0000000000000000000000008080"));
+    QCOMPARE(image16, image8);
+}
+
+void LexicalAnalyzerTest::test_lazy_object_loading()
+{
+    QByteArray buffer = createTestDocument();
+    auto getPassword = [](bool* ok) { *ok = false; return QString(); };
+
+    pdf::PDFDocumentReader eagerReader(nullptr, getPassword, false, false);
+    pdf::PDFDocument eagerDocument = eagerReader.readFromBuffer(buffer);
+    QVERIFY(eagerReader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+    QVERIFY(!eagerDocument.getStorage().isLazy());
+
+    pdf::PDFDocumentReader lazyReader(nullptr, getPassword, false, false);
+    lazyReader.setLazyObjectLoading(true);
+    pdf::PDFDocument lazyDocument = lazyReader.readFromBuffer(buffer);
+    QVERIFY(lazyReader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+    QVERIFY(lazyDocument.getStorage().isLazy());
+    QCOMPARE(lazyDocument.getCatalog()->getPageCount(), size_t(1));
+
+    // Stream length is an indirect object, which must be loaded recursively
+    const pdf::PDFObject& contentObject = lazyDocument.getStorage().getObject(pdf::PDFObjectReference(4, 0));
+    QVERIFY(contentObject.isStream());
+    QCOMPARE(*contentObject.getStream()->getContent(), QByteArray("BT /F1 12 Tf (Hello) Tj ET"));
+
+    // Comparison loads all remaining objects
+    QVERIFY(lazyDocument == eagerDocument);
+}
+
+void LexicalAnalyzerTest::test_damaged_document_recovery()
+{
+    // Break the reference table offset, so document must be restored
+    QByteArray buffer = createTestDocument();
+    const qsizetype startxrefOffset = buffer.lastIndexOf("startxref\n") + 10;
+    buffer = buffer.left(startxrefOffset) + "1\n%%EOF\n";
+    auto getPassword = [](bool* ok) { *ok = false; return QString(); };
+
+    pdf::PDFDocumentReader reader(nullptr, getPassword, true, false);
+    pdf::PDFDocument document = reader.readFromBuffer(buffer);
+    QVERIFY(reader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+    QCOMPARE(document.getCatalog()->getPageCount(), size_t(1));
+
+    // Stream length is defined by the object after the stream, so second pass is needed
+    const pdf::PDFObject& contentObject = document.getStorage().getObject(pdf::PDFObjectReference(4, 0));
+    QVERIFY(contentObject.isStream());
+    QCOMPARE(*contentObject.getStream()->getContent(), QByteArray("BT /F1 12 Tf (Hello) Tj ET"));
+
+    const pdf::PDFDocumentRecoveryStatistics& statistics = reader.getRecoveryStatistics();
+    QVERIFY(statistics.isValid());
+    QCOMPARE(statistics.candidateCount, pdf::PDFInteger(5));
+    QCOMPARE(statistics.restoredObjectCount, pdf::PDFInteger(5));
+    QCOMPARE(statistics.failedObjectCount, pdf::PDFInteger(0));
+    QCOMPARE(statistics.passCount, pdf::PDFInteger(2));
+}
+
+void LexicalAnalyzerTest::test_incremental_update()
+{
+    QByteArray buffer = createTestDocument();
+    auto getPassword = [](bool* ok) { *ok = false; return QString(); };
+
+    pdf::PDFDocumentReader baseReader(nullptr, getPassword, false, false);
+    pdf::PDFDocument baseDocument = baseReader.readFromBuffer(buffer);
+    QVERIFY(baseReader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+    QCOMPARE(baseReader.getRevisions().size(), size_t(1));
+    const pdf::PDFDocumentRevision baseRevision = baseReader.getRevisions().back();
+    QCOMPARE(baseRevision.endOffset, pdf::PDFInteger(buffer.size() - 1));
+    QCOMPARE(baseRevision.objectCount, pdf::PDFInteger(6));
+
+    // Append incremental update, which replaces page contents and frees the length object
+    const qsizetype previousXrefOffset = buffer.lastIndexOf("xref\n");
+    QByteArray content = "BT /F1 12 Tf (World) Tj ET";
+    const qsizetype contentOffset = buffer.size();
+    buffer += "4 0 obj\n<< /Length " + QByteArray::number(content.size()) + " >>\nstream\n" + content + "\nendstream\nendobj\n";
+    const qsizetype xrefOffset = buffer.size();
+    buffer += "xref\n0 1\n0000000005 65535 f \n4 2\n";
+    buffer += QByteArray::number(qint64(contentOffset)).rightJustified(10, '0') + " 00000 n \n";
+    buffer += "0000000000 00001 f \n";
+    buffer += "trailer\n<< /Size 6 /Root 1 0 R /Prev " + QByteArray::number(qint64(previousXrefOffset)) + " >>\n";
+    buffer += "startxref\n" + QByteArray::number(qint64(xrefOffset)) + "\n%%EOF\n";
+
+    pdf::PDFDocumentReader reader(nullptr, getPassword, false, false);
+    pdf::PDFDocument document = reader.readIncrementalUpdate(buffer, baseDocument, baseRevision);
+    QVERIFY(reader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+    QVERIFY(reader.getWarnings().isEmpty());
+    QCOMPARE(reader.getRevisions().size(), size_t(2));
+    QCOMPARE(reader.getRevisions().front().xrefOffset, baseRevision.xrefOffset);
+    QCOMPARE(reader.getRevisions().back().xrefOffset, pdf::PDFInteger(xrefOffset));
+    QCOMPARE(reader.getRevisions().back().objectCount, pdf::PDFInteger(3));
+    QCOMPARE(document.getCatalog()->getPageCount(), size_t(1));
+
+    const pdf::PDFObject& contentObject = document.getStorage().getObject(pdf::PDFObjectReference(4, 0));
+    QVERIFY(contentObject.isStream());
+    QCOMPARE(*contentObject.getStream()->getContent(), content);
+    QVERIFY(document.getStorage().getObject(pdf::PDFObjectReference(5, 0)).isNull());
+
+    // Full reading of the updated document must give the same result
+    pdf::PDFDocumentReader fullReader(nullptr, getPassword, false, false);
+    pdf::PDFDocument fullDocument = fullReader.readFromBuffer(buffer);
+    QVERIFY(fullReader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+    QVERIFY(fullDocument == document);
+}
+
+void LexicalAnalyzerTest::test_compressed_document_writer()
+{
+    QByteArray buffer = createTestDocument();
+    auto getPassword = [](bool* ok) { *ok = false; return QString(); };
+
+    pdf::PDFDocumentReader reader(nullptr, getPassword, false, false);
+    pdf::PDFDocument document = reader.readFromBuffer(buffer);
+    QVERIFY(reader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+
+    QBuffer outputBuffer;
+    QVERIFY(outputBuffer.open(QBuffer::WriteOnly));
+    pdf::PDFDocumentWriter writer(nullptr);
+    writer.setMode(pdf::PDFDocumentWriter::Mode::Compressed);
+    QVERIFY(writer.write(&outputBuffer, &document));
+    outputBuffer.close();
+
+    // Non-stream objects are packed into the object stream, only content
+    // stream, object stream and cross-reference stream are written directly.
+    const QByteArray writtenData = outputBuffer.data();
+    QVERIFY(!writtenData.contains("\nxref"));
+    QVERIFY(!writtenData.contains("1 0 obj"));
+    QVERIFY(writtenData.contains("4 0 obj"));
+    QVERIFY(writtenData.contains("/ObjStm"));
+    QVERIFY(writtenData.contains("/XRef"));
+
+    pdf::PDFDocumentReader compressedReader(nullptr, getPassword, false, false);
+    pdf::PDFDocument compressedDocument = compressedReader.readFromBuffer(writtenData);
+    QVERIFY(compressedReader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+    QCOMPARE(compressedDocument.getCatalog()->getPageCount(), size_t(1));
+    QCOMPARE(compressedDocument.getStorage().getObjects().size(), size_t(8));
+
+    for (pdf::PDFInteger i = 1; i < pdf::PDFInteger(document.getStorage().getObjects().size()); ++i)
+    {
+        const pdf::PDFObjectReference reference(i, 0);
+        const pdf::PDFObject& object = document.getStorage().getObject(reference);
+        const pdf::PDFObject& compressedObject = compressedDocument.getStorage().getObject(reference);
+
+        // Stream length is written as direct object
+        if (object.isStream())
+        {
+            QVERIFY(compressedObject.isStream());
+            QCOMPARE(*compressedObject.getStream()->getContent(), *object.getStream()->getContent());
+        }
+        else
+        {
+            QVERIFY(object == compressedObject);
+        }
+    }
+
+    // Writing is deterministic, even if objects are serialized in parallel
+    QBuffer secondOutputBuffer;
+    QVERIFY(secondOutputBuffer.open(QBuffer::WriteOnly));
+    QVERIFY(writer.write(&secondOutputBuffer, &document));
+    QCOMPARE(secondOutputBuffer.data(), writtenData);
+}
+
+void LexicalAnalyzerTest::test_incremental_document_writer()
+{
+    QByteArray buffer = createTestDocument();
+    auto getPassword = [](bool* ok) { *ok = false; return QString(); };
+
+    pdf::PDFDocumentReader baseReader(nullptr, getPassword, false, false);
+    pdf::PDFDocument baseDocument = baseReader.readFromBuffer(buffer);
+    QVERIFY(baseReader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+    const pdf::PDFDocumentRevision baseRevision = baseReader.getRevisions().back();
+
+    // Replace page contents and free the length object
+    QByteArray content = "BT /F1 12 Tf (World) Tj ET";
+    pdf::PDFDictionary contentDictionary;
+    contentDictionary.addEntry(pdf::PDFInplaceOrMemoryString("Length"), pdf::PDFObject::createInteger(content.size()));
+
+    pdf::PDFDocumentBuilder builder(&baseDocument);
+    builder.setObject(pdf::PDFObjectReference(4, 0), pdf::PDFObject::createStream(std::make_shared<pdf::PDFStream>(qMove(contentDictionary), QByteArray(content))));
+    builder.setObject(pdf::PDFObjectReference(5, 0), pdf::PDFObject());
+    pdf::PDFDocument modifiedDocument = builder.build();
+
+    QBuffer outputBuffer;
+    QVERIFY(outputBuffer.open(QBuffer::WriteOnly));
+    pdf::PDFDocumentWriter writer(nullptr);
+    QVERIFY(writer.writeIncremental(&outputBuffer, buffer, baseRevision, &baseDocument, &modifiedDocument));
+    outputBuffer.close();
+
+    // Original data are unchanged, unchanged objects are not written again
+    const QByteArray writtenData = outputBuffer.data();
+    QVERIFY(writtenData.startsWith(buffer));
+    const QByteArray appendedData = writtenData.mid(buffer.size());
+    QVERIFY(appendedData.contains("4 0 obj"));
+    QVERIFY(!appendedData.contains("1 0 obj"));
+    QVERIFY(!appendedData.contains("3 0 obj"));
+    QVERIFY(appendedData.contains("/Prev " + QByteArray::number(baseRevision.xrefOffset)));
+
+    pdf::PDFDocumentReader reader(nullptr, getPassword, false, false);
+    pdf::PDFDocument document = reader.readFromBuffer(writtenData);
+    QVERIFY(reader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+    QCOMPARE(reader.getRevisions().size(), size_t(2));
+    QCOMPARE(document.getCatalog()->getPageCount(), size_t(1));
+
+    const pdf::PDFObject& contentObject = document.getStorage().getObject(pdf::PDFObjectReference(4, 0));
+    QVERIFY(contentObject.isStream());
+    QCOMPARE(*contentObject.getStream()->getContent(), content);
+    QVERIFY(document.getStorage().getObject(pdf::PDFObjectReference(5, 0)).isNull());
+
+    for (pdf::PDFInteger i = 1; i <= 3; ++i)
+    {
+        const pdf::PDFObjectReference reference(i, 0);
+        QVERIFY(document.getStorage().getObject(reference) == baseDocument.getStorage().getObject(reference));
+    }
+
+    // Unchanged document is written as a copy of original data
+    QBuffer copyBuffer;
+    QVERIFY(copyBuffer.open(QBuffer::WriteOnly));
+    QVERIFY(writer.writeIncremental(&copyBuffer, buffer, baseRevision, &baseDocument, &baseDocument));
+    QCOMPARE(copyBuffer.data(), buffer);
+}
+
+void LexicalAnalyzerTest::test_compressed_streaming_document_writer()
+{
+    QByteArray buffer = createTestDocument();
+    auto getPassword = [](bool* ok) { *ok = false; return QString(); };
+
+    pdf::PDFDocumentReader reader(nullptr, getPassword, false, false);
+    pdf::PDFDocument document = reader.readFromBuffer(buffer);
+    QVERIFY(reader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+
+    // Write page of the document two times, objects of the second copy
+    // are written to a new object stream, because first batch is full.
+    QBuffer outputBuffer;
+    QVERIFY(outputBuffer.open(QBuffer::WriteOnly));
+    pdf::PDFStreamingDocumentWriter writer(&outputBuffer);
+    writer.setMode(pdf::PDFStreamingDocumentWriter::Mode::Compressed);
+    QVERIFY(writer.beginDocument(pdf::PDFVersion(1, 4)));
+
+    for (int copy = 0; copy < 2; ++copy)
+    {
+        // Content stream is written after the page, which refers to it
+        const pdf::PDFObjectReference contentReference = writer.reserveObject();
+        pdf::PDFDictionary pageDictionary = *document.getStorage().getDictionaryFromObject(document.getStorage().getObject(pdf::PDFObjectReference(3, 0)));
+        pageDictionary.removeEntry("Parent");
+        pageDictionary.setEntry(pdf::PDFInplaceOrMemoryString("Contents"), pdf::PDFObject::createReference(contentReference));
+        writer.addPage(writer.writeObject(pdf::PDFObject::createDictionary(std::make_shared<pdf::PDFDictionary>(qMove(pageDictionary)))));
+
+        for (size_t i = 0; i < pdf::PDFStreamingDocumentWriter::OBJECT_STREAM_MAX_OBJECTS; ++i)
+        {
+            writer.writeObject(pdf::PDFObject::createInteger(pdf::PDFInteger(i)));
+        }
+
+        pdf::PDFDictionary contentDictionary;
+        contentDictionary.addEntry(pdf::PDFInplaceOrMemoryString("Length"), pdf::PDFObject::createInteger(0));
+        QByteArray content = "BT /F1 12 Tf (Hello) Tj ET";
+        QVERIFY(writer.writeReservedObject(contentReference, pdf::PDFObject::createStream(std::make_shared<pdf::PDFStream>(qMove(contentDictionary), qMove(content)))));
+    }
+
+    QVERIFY(writer.endDocument());
+    outputBuffer.close();
+
+    const QByteArray writtenData = outputBuffer.data();
+    QVERIFY(writtenData.startsWith("%PDF-1.5"));
+    QVERIFY(!writtenData.contains("\nxref"));
+    QVERIFY(writtenData.count("/ObjStm") >= 2);
+    QVERIFY(writtenData.contains("/XRef"));
+
+    pdf::PDFDocumentReader compressedReader(nullptr, getPassword, false, false);
+    pdf::PDFDocument compressedDocument = compressedReader.readFromBuffer(writtenData);
+    QVERIFY(compressedReader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+    QCOMPARE(compressedDocument.getCatalog()->getPageCount(), size_t(2));
+
+    const pdf::PDFPage* page = compressedDocument.getCatalog()->getPage(1);
+    QVERIFY(page);
+    QCOMPARE(page->getMediaBox(), QRectF(0, 0, 612, 792));
+
+    // Stream length is always written as direct object with correct value
+    const pdf::PDFObject& contentObject = compressedDocument.getStorage().getObject(page->getContents());
+    QVERIFY(contentObject.isStream());
+    QCOMPARE(*contentObject.getStream()->getContent(), QByteArray("BT /F1 12 Tf (Hello) Tj ET"));
+}
+
+void LexicalAnalyzerTest::test_streaming_merger_stream_passthrough()
+{
+    QByteArray buffer = createTestDocument();
+    auto getPassword = [](bool* ok) { *ok = false; return QString(); };
+
+    pdf::PDFDocumentReader reader(nullptr, getPassword, false, false);
+    pdf::PDFDocument document = reader.readFromBuffer(buffer);
+    QVERIFY(reader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+
+    QTemporaryDir temporaryDirectory;
+    QVERIFY(temporaryDirectory.isValid());
+    const QString fileName = temporaryDirectory.filePath("merged.pdf");
+
+    pdf::PDFStreamingMerger merger(fileName);
+    QVERIFY(merger.begin());
+    QVERIFY(merger.addDocument(document));
+    QVERIFY(merger.addDocument(document));
+    QVERIFY(merger.finish());
+
+    QFile file(fileName);
+    QVERIFY(file.open(QFile::ReadOnly));
+    const QByteArray mergedData = file.readAll();
+
+    // Stream data are copied byte for byte, with direct length
+    const QByteArray content = "BT /F1 12 Tf (Hello) Tj ET";
+    QCOMPARE(mergedData.count("stream\r\n" + content + "\r\nendstream"), 2);
+    QCOMPARE(mergedData.count("/Length " + QByteArray::number(content.size())), 2);
+
+    pdf::PDFDocumentReader mergedReader(nullptr, getPassword, false, false);
+    pdf::PDFDocument mergedDocument = mergedReader.readFromBuffer(mergedData);
+    QVERIFY(mergedReader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+    QCOMPARE(mergedDocument.getCatalog()->getPageCount(), size_t(2));
+}
+
+void LexicalAnalyzerTest::test_streaming_merger_prefetch()
+{
+    QTemporaryDir temporaryDirectory;
+    QVERIFY(temporaryDirectory.isValid());
+
+    QStringList fileNames;
+    for (int i = 0; i < 5; ++i)
+    {
+        fileNames << temporaryDirectory.filePath(QString("input%1.pdf").arg(i));
+        QFile file(fileNames.back());
+        QVERIFY(file.open(QFile::WriteOnly));
+        file.write(createTestDocument());
+    }
+
+    // Memory budget is smaller than one document, so documents are
+    // read in advance one by one, but all of them are merged in order.
+    const QString fileName = temporaryDirectory.filePath("merged.pdf");
+    pdf::PDFStreamingMerger merger(fileName);
+    QVERIFY(merger.begin());
+    QVERIFY(merger.addDocuments(fileNames, 3, 1));
+    QVERIFY(merger.finish());
+    QCOMPARE(merger.getTotalDocuments(), size_t(5));
+    QCOMPARE(merger.getTotalPages(), size_t(5));
+
+    auto getPassword = [](bool* ok) { *ok = false; return QString(); };
+    pdf::PDFDocumentReader reader(nullptr, getPassword, false, false);
+    pdf::PDFDocument document = reader.readFromFile(fileName);
+    QVERIFY(reader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+    QCOMPARE(document.getCatalog()->getPageCount(), size_t(5));
+
+    // Missing input aborts the merge
+    pdf::PDFStreamingMerger failingMerger(temporaryDirectory.filePath("failed.pdf"));
+    QVERIFY(failingMerger.begin());
+    QVERIFY(!failingMerger.addDocuments({ fileNames.front(), temporaryDirectory.filePath("missing.pdf"), fileNames.back() }));
+    QCOMPARE(failingMerger.getTotalDocuments(), size_t(1));
+}
+
+void LexicalAnalyzerTest::test_streaming_merger_deduplication()
+{
+    QByteArray buffer = createTestDocument();
+    auto getPassword = [](bool* ok) { *ok = false; return QString(); };
+
+    pdf::PDFDocumentReader reader(nullptr, getPassword, false, false);
+    pdf::PDFDocument baseDocument = reader.readFromBuffer(buffer);
+    QVERIFY(reader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+
+    // Add large resource stream (for example, embedded font)
+    const QByteArray resourceData(4 * pdf::PDFStreamingMerger::DEDUPLICATION_MIN_STREAM_SIZE, 'x');
+    pdf::PDFDocumentBuilder builder(&baseDocument);
+    pdf::PDFDictionary resourceDictionary;
+    resourceDictionary.addEntry(pdf::PDFInplaceOrMemoryString("Length1"), pdf::PDFObject::createInteger(resourceData.size()));
+    builder.addObject(pdf::PDFObject::createStream(std::make_shared<pdf::PDFStream>(qMove(resourceDictionary), QByteArray(resourceData))));
+    pdf::PDFDocument document = builder.build();
+
+    QTemporaryDir temporaryDirectory;
+    QVERIFY(temporaryDirectory.isValid());
+    const QString fileName = temporaryDirectory.filePath("merged.pdf");
+
+    pdf::PDFStreamingMerger merger(fileName);
+    QVERIFY(merger.begin());
+    QVERIFY(merger.addDocument(document));
+    QVERIFY(merger.addDocument(document));
+    QVERIFY(merger.addDocument(document));
+    QVERIFY(merger.finish());
+    QCOMPARE(merger.getDeduplicatedStreamCount(), size_t(2));
+
+    QFile file(fileName);
+    QVERIFY(file.open(QFile::ReadOnly));
+    const QByteArray mergedData = file.readAll();
+    QCOMPARE(mergedData.count(resourceData), 1);
+
+    // Small streams are not deduplicated
+    QCOMPARE(mergedData.count("BT /F1 12 Tf (Hello) Tj ET"), 3);
+
+    pdf::PDFDocumentReader mergedReader(nullptr, getPassword, false, false);
+    pdf::PDFDocument mergedDocument = mergedReader.readFromBuffer(mergedData);
+    QVERIFY(mergedReader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+    QCOMPARE(mergedDocument.getCatalog()->getPageCount(), size_t(3));
+}
+
+void LexicalAnalyzerTest::test_optimizer_merge_identical_objects()
+{
+    QByteArray buffer = createTestDocument();
+    auto getPassword = [](bool* ok) { *ok = false; return QString(); };
+
+    pdf::PDFDocumentReader reader(nullptr, getPassword, false, false);
+    pdf::PDFDocument baseDocument = reader.readFromBuffer(buffer);
+    QVERIFY(reader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+
+    auto createNode = [](pdf::PDFObjectReference next, const char* name)
+    {
+        pdf::PDFDictionary dictionary;
+        dictionary.addEntry(pdf::PDFInplaceOrMemoryString("Name"), pdf::PDFObject::createName(name));
+        dictionary.addEntry(pdf::PDFInplaceOrMemoryString("Next"), pdf::PDFObject::createReference(next));
+        return pdf::PDFObject::createDictionary(std::make_shared<pdf::PDFDictionary>(qMove(dictionary)));
+    };
+
+    // Two identical cycles (A1 -> B1 -> A1, A2 -> B2 -> A2) and one cycle,
+    // which differs in one node (A3 -> B3 -> A3), and one cycle, which refers
+    // to the page (can't be merged with others).
+    pdf::PDFDocumentBuilder builder(&baseDocument);
+    std::vector<pdf::PDFObjectReference> nodes;
+    for (int i = 0; i < 4; ++i)
+    {
+        const pdf::PDFObjectReference first = builder.addObject(pdf::PDFObject());
+        const pdf::PDFObjectReference second = builder.addObject(pdf::PDFObject());
+        builder.setObject(first, createNode(second, "A"));
+        builder.setObject(second, createNode(i == 3 ? pdf::PDFObjectReference(3, 0) : first, i == 2 ? "C" : "B"));
+        nodes.push_back(first);
+    }
+
+    pdf::PDFArray items;
+    for (const pdf::PDFObjectReference& reference : nodes)
+    {
+        items.appendItem(pdf::PDFObject::createReference(reference));
+    }
+    const pdf::PDFObjectReference holder = builder.addObject(pdf::PDFObject::createArray(std::make_shared<pdf::PDFArray>(qMove(items))));
+    pdf::PDFDocument document = builder.build();
+
+    pdf::PDFOptimizer optimizer(pdf::PDFOptimizer::MergeIdenticalObjects, nullptr);
+    optimizer.setDocument(&document);
+    optimizer.optimize();
+
+    const pdf::PDFObjectStorage& storage = optimizer.getStorage();
+    const pdf::PDFArray* mergedItems = storage.getObject(holder).getArray();
+    QVERIFY(mergedItems);
+    QCOMPARE(mergedItems->getCount(), size_t(4));
+    QCOMPARE(mergedItems->getItem(0).getReference(), nodes[0]);
+    QCOMPARE(mergedItems->getItem(1).getReference(), nodes[0]);
+    QCOMPARE(mergedItems->getItem(2).getReference(), nodes[2]);
+    QCOMPARE(mergedItems->getItem(3).getReference(), nodes[3]);
+
+    // Reference to the page is preserved
+    const pdf::PDFDictionary* lastNode = storage.getDictionaryFromObject(storage.getObject(storage.getDictionaryFromObject(storage.getObject(nodes[3]))->get("Next")));
+    QVERIFY(lastNode);
+    QCOMPARE(lastNode->get("Next").getReference(), pdf::PDFObjectReference(3, 0));
+}
+
+void LexicalAnalyzerTest::test_optimizer_downsample_images()
+{
+    QByteArray buffer = createTestDocument();
+    auto getPassword = [](bool* ok) { *ok = false; return QString(); };
+
+    pdf::PDFDocumentReader reader(nullptr, getPassword, false, false);
+    pdf::PDFDocument baseDocument = reader.readFromBuffer(buffer);
+    QVERIFY(reader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+
+    // Gray image 600 x 600 pixels is placed into the square of 1 inch, so it has 600 DPI
+    const int imageSize = 600;
+    QByteArray samples(imageSize * imageSize, 0);
+    for (int y = 0; y < imageSize; ++y)
+    {
+        for (int x = 0; x < imageSize; ++x)
+        {
+            samples[y * imageSize + x] = char((x * 7 + y * 13) % 256);
+        }
+    }
+    QByteArray imageData = pdf::PDFFlateDecodeFilter::compress(samples);
+
+    pdf::PDFDictionary imageDictionary;
+    imageDictionary.addEntry(pdf::PDFInplaceOrMemoryString("Type"), pdf::PDFObject::createName("XObject"));
+    imageDictionary.addEntry(pdf::PDFInplaceOrMemoryString("Subtype"), pdf::PDFObject::createName("Image"));
+    imageDictionary.addEntry(pdf::PDFInplaceOrMemoryString("Width"), pdf::PDFObject::createInteger(imageSize));
+    imageDictionary.addEntry(pdf::PDFInplaceOrMemoryString("Height"), pdf::PDFObject::createInteger(imageSize));
+    imageDictionary.addEntry(pdf::PDFInplaceOrMemoryString("ColorSpace"), pdf::PDFObject::createName("DeviceGray"));
+    imageDictionary.addEntry(pdf::PDFInplaceOrMemoryString("BitsPerComponent"), pdf::PDFObject::createInteger(8));
+    imageDictionary.addEntry(pdf::PDFInplaceOrMemoryString("Filter"), pdf::PDFObject::createName("FlateDecode"));
+    imageDictionary.addEntry(pdf::PDFInplaceOrMemoryString("Length"), pdf::PDFObject::createInteger(imageData.size()));
+    const qsizetype originalImageDataSize = imageData.size();
+
+    QByteArray content = "q 72 0 0 72 100 100 cm /Im1 Do Q";
+    pdf::PDFDictionary contentDictionary;
+    contentDictionary.addEntry(pdf::PDFInplaceOrMemoryString("Length"), pdf::PDFObject::createInteger(content.size()));
+
+    pdf::PDFDocumentBuilder builder(&baseDocument);
+    const pdf::PDFObjectReference image = builder.addObject(pdf::PDFObject::createStream(std::make_shared<pdf::PDFStream>(qMove(imageDictionary), qMove(imageData))));
+    const pdf::PDFObjectReference contents = builder.addObject(pdf::PDFObject::createStream(std::make_shared<pdf::PDFStream>(qMove(contentDictionary), qMove(content))));
+
+    pdf::PDFDictionary xobjectDictionary;
+    xobjectDictionary.addEntry(pdf::PDFInplaceOrMemoryString("Im1"), pdf::PDFObject::createReference(image));
+    pdf::PDFDictionary resourcesDictionary;
+    resourcesDictionary.addEntry(pdf::PDFInplaceOrMemoryString("XObject"), pdf::PDFObject::createDictionary(std::make_shared<pdf::PDFDictionary>(qMove(xobjectDictionary))));
+
+    pdf::PDFDictionary pageDictionary = *baseDocument.getStorage().getDictionaryFromObject(baseDocument.getObjectByReference(pdf::PDFObjectReference(3, 0)));
+    pageDictionary.setEntry(pdf::PDFInplaceOrMemoryString("Contents"), pdf::PDFObject::createReference(contents));
+    pageDictionary.setEntry(pdf::PDFInplaceOrMemoryString("Resources"), pdf::PDFObject::createDictionary(std::make_shared<pdf::PDFDictionary>(qMove(resourcesDictionary))));
+    builder.setObject(pdf::PDFObjectReference(3, 0), pdf::PDFObject::createDictionary(std::make_shared<pdf::PDFDictionary>(qMove(pageDictionary))));
+    pdf::PDFDocument document = builder.build();
+
+    // Lossy downsampling is not part of all (lossless) optimizations
+    QVERIFY(!pdf::PDFOptimizer::OptimizationFlags(pdf::PDFOptimizer::All).testFlag(pdf::PDFOptimizer::DownsampleImages));
+
+    pdf::PDFOptimizer::ImageSettings settings;
+    settings.targetResolution = 150.0;
+    settings.thresholdResolution = 225.0;
+
+    pdf::PDFOptimizer optimizer(pdf::PDFOptimizer::DownsampleImages, nullptr);
+    optimizer.setImageSettings(settings);
+    optimizer.setDocument(&document);
+    optimizer.optimize();
+
+    const pdf::PDFObjectStorage& storage = optimizer.getStorage();
+    const pdf::PDFObject& downsampledImage = storage.getObject(image);
+    QVERIFY(downsampledImage.isStream());
+
+    const pdf::PDFDictionary* downsampledDictionary = downsampledImage.getStream()->getDictionary();
+    QCOMPARE(downsampledDictionary->get("Width").getInteger(), pdf::PDFInteger(150));
+    QCOMPARE(downsampledDictionary->get("Height").getInteger(), pdf::PDFInteger(150));
+    QCOMPARE(downsampledDictionary->get("BitsPerComponent").getInteger(), pdf::PDFInteger(8));
+    QCOMPARE(downsampledDictionary->get("Length").getInteger(), pdf::PDFInteger(downsampledImage.getStream()->getContent()->size()));
+    QVERIFY(downsampledImage.getStream()->getContent()->size() < originalImageDataSize);
+
+    // Image with resolution under the threshold is not changed
+    settings.thresholdResolution = 1200.0;
+    pdf::PDFOptimizer thresholdOptimizer(pdf::PDFOptimizer::DownsampleImages, nullptr);
+    thresholdOptimizer.setImageSettings(settings);
+    thresholdOptimizer.setDocument(&document);
+    thresholdOptimizer.optimize();
+    QCOMPARE(thresholdOptimizer.getStorage().getObject(image).getStream()->getDictionary()->get("Width").getInteger(), pdf::PDFInteger(imageSize));
+}
+
+void LexicalAnalyzerTest::test_font_subsetter_truetype()
+{
+    auto appendUInt16 = [](QByteArray& data, uint16_t value) { data.append(char(value >> 8)); data.append(char(value)); };
+    auto readUInt16 = [](const QByteArray& data, qsizetype offset) { return uint16_t((uint8_t(data[offset]) << 8) | uint8_t(data[offset + 1])); };
+    auto readUInt32 = [&](const QByteArray& data, qsizetype offset) { return (uint32_t(readUInt16(data, offset)) << 16) | readUInt16(data, offset + 2); };
+
+    // Glyph 0 is empty (.notdef), glyph 1 is simple glyph used as component,
+    // glyph 2 is unused simple glyph and glyph 3 is composite glyph.
+    QByteArray simpleGlyph(40, char(0x11));
+    simpleGlyph[0] = 0;
+    simpleGlyph[1] = 1;
+    QByteArray unusedGlyph(400, char(0x22));
+    unusedGlyph[0] = 0;
+    unusedGlyph[1] = 1;
+    QByteArray compositeGlyph;
+    appendUInt16(compositeGlyph, 0xFFFF);
+    compositeGlyph.append(QByteArray(8, 0));
+    appendUInt16(compositeGlyph, 0x0001);
+    appendUInt16(compositeGlyph, 1);
+    compositeGlyph.append(QByteArray(4, 0));
+    compositeGlyph.append(QByteArray(2, 0));
+
+    QByteArray glyf = simpleGlyph + unusedGlyph + compositeGlyph;
+    QByteArray loca;
+    appendUInt16(loca, 0);
+    appendUInt16(loca, 0);
+    appendUInt16(loca, uint16_t(simpleGlyph.size() / 2));
+    appendUInt16(loca, uint16_t((simpleGlyph.size() + unusedGlyph.size()) / 2));
+    appendUInt16(loca, uint16_t(glyf.size() / 2));
+
+    QByteArray head(54, 0);
+    head[0] = 0;
+    head[1] = 1;
+    QByteArray maxp(6, 0);
+    maxp[0] = 0;
+    maxp[1] = 0;
+    maxp[2] = 0x50;
+    maxp[5] = 4;
+
+    std::vector<std::pair<QByteArray, QByteArray>> tables = { { "glyf", glyf }, { "head", head }, { "loca", loca }, { "maxp", maxp } };
+    QByteArray fontData;
+    appendUInt16(fontData, 1);
+    appendUInt16(fontData, 0);
+    appendUInt16(fontData, uint16_t(tables.size()));
+    fontData.append(QByteArray(6, 0));
+
+    QByteArray tableData;
+    for (const auto& table : tables)
+    {
+        const uint32_t offset = uint32_t(12 + 16 * tables.size() + tableData.size());
+        fontData.append(table.first);
+        fontData.append(QByteArray(4, 0));
+        appendUInt16(fontData, uint16_t(offset >> 16));
+        appendUInt16(fontData, uint16_t(offset));
+        appendUInt16(fontData, 0);
+        appendUInt16(fontData, uint16_t(table.second.size()));
+        tableData.append(table.second);
+        while (tableData.size() % 4)
+        {
+            tableData.append(char(0));
+        }
+    }
+    fontData.append(tableData);
+
+    QByteArray subset = pdf::PDFFontSubsetter::createTrueTypeSubset(fontData, { 3 });
+    QVERIFY(!subset.isEmpty());
+    QVERIFY(subset.size() < fontData.size());
+
+    // Find new glyph locations (subset always uses long format)
+    std::map<QByteArray, std::pair<qsizetype, qsizetype>> subsetTables;
+    const uint16_t tableCount = readUInt16(subset, 4);
+    for (uint16_t i = 0; i < tableCount; ++i)
+    {
+        const qsizetype recordOffset = 12 + 16 * i;
+        subsetTables[subset.mid(recordOffset, 4)] = std::make_pair(qsizetype(readUInt32(subset, recordOffset + 8)), qsizetype(readUInt32(subset, recordOffset + 12)));
+    }
+
+    QVERIFY(subsetTables.count("loca") && subsetTables.count("head") && subsetTables.count("glyf"));
+    QCOMPARE(readUInt16(subset, subsetTables["head"].first + 50), uint16_t(1));
+
+    const qsizetype locaOffset = subsetTables["loca"].first;
+    auto getGlyphSize = [&](int glyph) { return readUInt32(subset, locaOffset + 4 * (glyph + 1)) - readUInt32(subset, locaOffset + 4 * glyph); };
+    QCOMPARE(getGlyphSize(0), uint32_t(0));
+    QCOMPARE(getGlyphSize(1), uint32_t(simpleGlyph.size()));
+    QCOMPARE(getGlyphSize(2), uint32_t(0));
+    QCOMPARE(getGlyphSize(3), uint32_t(compositeGlyph.size()));
+
+    // Glyph data of the component are preserved
+    const qsizetype glyfOffset = subsetTables["glyf"].first + readUInt32(subset, locaOffset + 4);
+    QCOMPARE(subset.mid(glyfOffset, simpleGlyph.size()), simpleGlyph);
+
+    // Subset tag is six uppercase letters
+    const QByteArray tag = pdf::PDFFontSubsetter::createSubsetTag(subset);
+    QCOMPARE(tag.size(), 6);
+    QVERIFY(pdf::PDFFontSubsetter::hasSubsetTag(tag + "+Arial"));
+    QVERIFY(!pdf::PDFFontSubsetter::hasSubsetTag("Arial"));
+}
+
+void LexicalAnalyzerTest::test_object_reachability()
+{
+    auto createDictionary = [](std::vector<pdf::PDFObjectReference> references)
+    {
+        pdf::PDFArray array;
+        for (const pdf::PDFObjectReference& reference : references)
+        {
+            array.appendItem(pdf::PDFObject::createReference(reference));
+        }
+
+        pdf::PDFDictionary dictionary;
+        dictionary.addEntry(pdf::PDFInplaceOrMemoryString("Refs"), pdf::PDFObject::createArray(std::make_shared<pdf::PDFArray>(qMove(array))));
+        return pdf::PDFObject::createDictionary(std::make_shared<pdf::PDFDictionary>(qMove(dictionary)));
+    };
+
+    // Object 1 and 2 form a cycle, object 3 references object 4 with wrong
+    // generation number, object 5 is not referenced and long chain of objects
+    // starting at object 6 is followed through many frontiers.
+    const size_t chainLength = 1000;
+    pdf::PDFObjectStorage::PDFObjects objects;
+    objects.emplace_back(0, pdf::PDFObject());
+    objects.emplace_back(0, createDictionary({ pdf::PDFObjectReference(2, 0), pdf::PDFObjectReference(6, 0) }));
+    objects.emplace_back(0, createDictionary({ pdf::PDFObjectReference(1, 0), pdf::PDFObjectReference(3, 0) }));
+    objects.emplace_back(0, createDictionary({ pdf::PDFObjectReference(4, 1), pdf::PDFObjectReference(100000, 0) }));
+    objects.emplace_back(0, createDictionary({ }));
+    objects.emplace_back(0, createDictionary({ pdf::PDFObjectReference(1, 0) }));
+    for (size_t i = 0; i < chainLength; ++i)
+    {
+        objects.emplace_back(0, createDictionary({ pdf::PDFObjectReference(pdf::PDFInteger(objects.size() + 1), 0) }));
+    }
+    objects.emplace_back(0, createDictionary({ }));
+
+    pdf::PDFObjectStorage storage(qMove(objects), pdf::PDFObject(), pdf::PDFSecurityHandlerPointer());
+    std::vector<bool> reachableObjects = pdf::PDFObjectUtils::getReachableObjects({ createDictionary({ pdf::PDFObjectReference(1, 0) }) }, storage);
+
+    QCOMPARE(reachableObjects.size(), storage.getObjectCount());
+    QVERIFY(!reachableObjects[0]);
+    QVERIFY(reachableObjects[1]);
+    QVERIFY(reachableObjects[2]);
+    QVERIFY(reachableObjects[3]);
+    QVERIFY(!reachableObjects[4]);
+    QVERIFY(!reachableObjects[5]);
+    QCOMPARE(std::count(reachableObjects.cbegin(), reachableObjects.cend(), true), std::ptrdiff_t(3 + chainLength + 1));
+}
+
+void LexicalAnalyzerTest::test_document_builder_append_pages()
+{
+    QByteArray buffer = createTestDocument();
+    auto getPassword = [](bool* ok) { *ok = false; return QString(); };
+
+    pdf::PDFDocumentReader reader(nullptr, getPassword, false, false);
+    pdf::PDFDocument baseDocument = reader.readFromBuffer(buffer);
+    QVERIFY(reader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+
+    // Page width identifies the page, so we can check page order
+    const size_t pageCount = 2000;
+    auto generatePage = [](size_t index)
+    {
+        pdf::PDFDocumentBuilder::BatchPage page;
+        page.mediaBox = QRectF(0, 0, pdf::PDFReal(index + 1), 100);
+        page.contents = (index % 2) ? QByteArray("0 0 m 10 10 l S") : QByteArray();
+        return page;
+    };
+
+    pdf::PDFDocumentBuilder builder(&baseDocument);
+    std::vector<pdf::PDFObjectReference> pages = builder.appendPages(pageCount, generatePage, true);
+    QCOMPARE(pages.size(), pageCount);
+
+    pdf::PDFDocument document = builder.build();
+    const pdf::PDFCatalog* catalog = document.getCatalog();
+    QCOMPARE(catalog->getPageCount(), pageCount + 1);
+
+    for (size_t i = 0; i < pageCount; ++i)
+    {
+        const pdf::PDFPage* page = catalog->getPage(i + 1);
+        QCOMPARE(page->getPageReference(), pages[i]);
+        QCOMPARE(page->getMediaBox().width(), pdf::PDFReal(i + 1));
+        QCOMPARE(document.getObject(page->getContents()).isStream(), bool(i % 2));
+    }
+
+    // Page tree is balanced, no node has too many kids
+    for (const pdf::PDFObjectStorage::Entry& entry : document.getStorage().getObjects())
+    {
+        const pdf::PDFDictionary* dictionary = document.getDictionaryFromObject(entry.object);
+        if (dictionary && document.getObject(dictionary->get("Type")).isName() && document.getObject(dictionary->get("Type")).getString() == "Pages")
+        {
+            QVERIFY(document.getObject(dictionary->get("Kids")).getArray()->getCount() <= 32);
+        }
+    }
+}
+
+void LexicalAnalyzerTest::test_object_storage_copy_on_write()
+{
+    pdf::PDFObjectStorage storage;
+    std::vector<pdf::PDFObjectReference> references;
+    for (pdf::PDFInteger i = 0; i < 3000; ++i)
+    {
+        references.push_back(storage.addObject(pdf::PDFObject::createInteger(i)));
+    }
+
+    pdf::PDFObjectStorage copy(storage);
+    QCOMPARE(copy.getObjectCount(), storage.getObjectCount());
+    QVERIFY(&copy.getObject(references[5]) == &storage.getObject(references[5]));
+    QVERIFY(&copy.getObject(references[2500]) == &storage.getObject(references[2500]));
+
+    // Modification of the copy must not affect original storage, and only
+    // the modified chunk of objects is copied.
+    copy.setObject(references[5], pdf::PDFObject::createInteger(-1));
+    QCOMPARE(copy.getObject(references[5]).getInteger(), pdf::PDFInteger(-1));
+    QCOMPARE(storage.getObject(references[5]).getInteger(), pdf::PDFInteger(5));
+    QVERIFY(&copy.getObject(references[6]) != &storage.getObject(references[6]));
+    QVERIFY(&copy.getObject(references[2500]) == &storage.getObject(references[2500]));
+
+    pdf::PDFObjectReference added = copy.addObject(pdf::PDFObject::createInteger(3000));
+    QCOMPARE(copy.getObjectCount(), storage.getObjectCount() + 1);
+    QCOMPARE(copy.getObject(added).getInteger(), pdf::PDFInteger(3000));
+    QCOMPARE(storage.getObject(references[2999]).getInteger(), pdf::PDFInteger(2999));
+}
+
+void LexicalAnalyzerTest::test_object_storage_memory_estimate()
+{
+    pdf::PDFObjectStorage storage;
+    for (size_t i = 0; i < 3000; ++i)
+    {
+        storage.addObject(pdf::PDFObject::createString(QByteArray(1000, 'a')));
+    }
+
+    const qint64 totalMemory = storage.getMemoryConsumptionEstimate(nullptr);
+    QVERIFY(totalMemory >= 3000 * 1000);
+
+    pdf::PDFObjectStorage copy(storage);
+    QCOMPARE(copy.getMemoryConsumptionEstimate(&storage), qint64(0));
+
+    // Only modified object is counted with its content, other objects
+    // of the copied chunk share their contents.
+    copy.setObject(pdf::PDFObjectReference(10, 0), pdf::PDFObject::createString(QByteArray(50000, 'b')));
+    const qint64 deltaMemory = copy.getMemoryConsumptionEstimate(&storage);
+    QVERIFY(deltaMemory >= 50000);
+    QVERIFY(deltaMemory < 50000 + qint64(pdf::PDFObjectStorage::PDFObjects::getChunkSize() * sizeof(pdf::PDFObjectStorage::Entry)) + 1000);
+    QVERIFY(storage.getMemoryConsumptionEstimate(&copy) < totalMemory / 2);
+}
+
+void LexicalAnalyzerTest::test_streaming_merger_page_subset()
+{
+    QTemporaryDir temporaryDirectory;
+    QVERIFY(temporaryDirectory.isValid());
+
+    const QString inputFileName = temporaryDirectory.filePath("input.pdf");
+    {
+        QFile file(inputFileName);
+        QVERIFY(file.open(QFile::WriteOnly));
+        file.write(createTestDocument());
+    }
+
+    // Same page twice, the first one rotated
+    pdf::PDFStreamingMerger::SelectedPage rotatedPage;
+    rotatedPage.pageIndex = 0;
+    rotatedPage.pageRotation = pdf::PageRotation::Rotate90;
+    pdf::PDFStreamingMerger::SelectedPage page;
+    page.pageIndex = 0;
+
+    const QString fileName = temporaryDirectory.filePath("subset.pdf");
+    pdf::PDFStreamingMerger merger(fileName);
+    QVERIFY(merger.begin());
+    QVERIFY(merger.addPages(inputFileName, { rotatedPage, page }));
+    QVERIFY(merger.finish());
+    QCOMPARE(merger.getTotalPages(), size_t(2));
+
+    auto getPassword = [](bool* ok) { *ok = false; return QString(); };
+    pdf::PDFDocumentReader reader(nullptr, getPassword, false, false);
+    pdf::PDFDocument document = reader.readFromFile(fileName);
+    QVERIFY(reader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+    QCOMPARE(document.getCatalog()->getPageCount(), size_t(2));
+    QVERIFY(document.getCatalog()->getPage(0)->getPageRotation() == pdf::PageRotation::Rotate90);
+    QVERIFY(document.getCatalog()->getPage(1)->getPageRotation() == pdf::PageRotation::None);
+    QCOMPARE(document.getCatalog()->getPage(1)->getMediaBox(), QRectF(0, 0, 612, 792));
+
+    // Shared content stream is written only once
+    QFile file(fileName);
+    QVERIFY(file.open(QFile::ReadOnly));
+    QCOMPARE(file.readAll().count("BT /F1 12 Tf (Hello) Tj ET"), 1);
+
+    // Nonexisting page
+    pdf::PDFStreamingMerger failingMerger(temporaryDirectory.filePath("failed.pdf"));
+    pdf::PDFStreamingMerger::SelectedPage invalidPage;
+    invalidPage.pageIndex = 10;
+    QVERIFY(failingMerger.begin());
+    QVERIFY(!failingMerger.addPages(inputFileName, { invalidPage }));
+}
+
+void LexicalAnalyzerTest::test_streaming_object_statistics()
+{
+    const QByteArray buffer = createTestDocument();
+    const QByteArray content = "BT /F1 12 Tf (Hello) Tj ET";
+
+    QTemporaryDir temporaryDirectory;
+    QVERIFY(temporaryDirectory.isValid());
+    const QString fileName = temporaryDirectory.filePath("statistics.pdf");
+
+    QFile file(fileName);
+    QVERIFY(file.open(QFile::WriteOnly));
+    file.write(buffer);
+    file.close();
+
+    auto getPassword = [](bool* ok) { *ok = false; return QString(); };
+    pdf::PDFDocumentReader reader(nullptr, getPassword, false, false);
+    pdf::PDFXRefTable xrefTable = reader.readReferenceTableFromFile(fileName);
+    QVERIFY(reader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+    QCOMPARE(xrefTable.getSize(), size_t(6));
+
+    using Statistics = pdf::PDFObjectStreamingStatistics;
+    Statistics::Statistics statistics = Statistics::calculate(reader.getSource(), reader.getSourceOwner(), xrefTable, Statistics::DecodeStreams);
+
+    QCOMPARE(statistics.objectCount, qint64(5));
+    QCOMPARE(statistics.compressedObjectCount, qint64(0));
+    QCOMPARE(statistics.invalidObjectCount, qint64(0));
+    QCOMPARE(statistics.decodingErrorCount, qint64(0));
+    QVERIFY(!statistics.isEncrypted);
+
+    // Objects occupy all data between the header and the reference table
+    QCOMPARE(statistics.bytes, qint64(buffer.indexOf("xref\n") - buffer.indexOf("1 0 obj")));
+
+    QCOMPARE(statistics.objectsByClass["Catalog"].count, qint64(1));
+    QCOMPARE(statistics.objectsByClass["Pages"].count, qint64(1));
+    QCOMPARE(statistics.objectsByClass["Page"].count, qint64(1));
+    QCOMPARE(statistics.objectsByClass[QByteArray()].count, qint64(2));
+
+    // Content stream is not compressed, its length is an indirect object
+    QCOMPARE(statistics.streamsByFilter.size(), size_t(1));
+    const Statistics::Item& streamItem = statistics.streamsByFilter[QByteArray()];
+    QCOMPARE(streamItem.count, qint64(1));
+    QCOMPARE(streamItem.bytes, qint64(content.size()));
+    QCOMPARE(streamItem.decodedBytes, qint64(content.size()));
+
+    qint64 histogramCount = 0;
+    for (const Statistics::Item& item : statistics.sizeHistogram)
+    {
+        histogramCount += item.count;
+    }
+    QCOMPARE(histogramCount, qint64(5));
+    QCOMPARE(statistics.sizeHistogram.front().count, qint64(5));
+}
+
+void LexicalAnalyzerTest::test_execution_policy_nested()
+{
+    pdf::PDFExecutionPolicy::setStrategy(pdf::PDFExecutionPolicy::Strategy::AlwaysMultithreaded);
+
+    // Nested parallel execution must not block, even if all threads are busy
+    std::vector<int> outer(64, 0);
+    std::iota(outer.begin(), outer.end(), 0);
+    std::atomic<int> sum = 0;
+    pdf::PDFExecutionPolicy::execute(pdf::PDFExecutionPolicy::Scope::Page, outer.begin(), outer.end(), [&sum](int value)
+    {
+        std::vector<int> inner(100, value);
+        pdf::PDFExecutionPolicy::execute(pdf::PDFExecutionPolicy::Scope::Unknown, inner.begin(), inner.end(), [&sum](int item) { sum += item; });
+    });
+    QCOMPARE(sum.load(), 100 * (63 * 64 / 2));
+
+    std::atomic<int> taskCount = 0;
+    std::atomic<int> countAtContinuation = -1;
+    {
+        pdf::PDFExecutionTaskGroup group(pdf::PDFExecutionPolicy::Scope::Page);
+        for (int i = 0; i < 32; ++i)
+        {
+            group.run([&taskCount]() { ++taskCount; });
+        }
+        group.then([&taskCount, &countAtContinuation]() { countAtContinuation = taskCount.load(); });
+        group.wait();
+        QCOMPARE(taskCount.load(), 32);
+
+        // Continuation is executed after the last task, or immediately, if all tasks were already finished
+        QCOMPARE(countAtContinuation.load(), 32);
+    }
+
+    pdf::PDFExecutionPolicy::setStrategy(pdf::PDFExecutionPolicy::Strategy::PageMultithreaded);
+}
+
+void LexicalAnalyzerTest::test_execution_policy_sort_reduce()
+{
+    pdf::PDFExecutionPolicy::setStrategy(pdf::PDFExecutionPolicy::Strategy::AlwaysMultithreaded);
+
+    std::vector<int> values(100000, 0);
+    uint32_t seed = 12345;
+    for (int& value : values)
+    {
+        seed = seed * 1103515245 + 12345;
+        value = static_cast<int>((seed >> 8) % 10000);
+    }
+
+    std::vector<int> expectedValues = values;
+    std::sort(expectedValues.begin(), expectedValues.end());
+
+    pdf::PDFExecutionPolicy::sort(pdf::PDFExecutionPolicy::Scope::Content, values.begin(), values.end(), std::less<int>(), 1000);
+    QVERIFY(values == expectedValues);
+
+    const qint64 expectedSum = std::accumulate(values.cbegin(), values.cend(), qint64(0));
+    const qint64 sum = pdf::PDFExecutionPolicy::transformReduce(pdf::PDFExecutionPolicy::Scope::Content, values.cbegin(), values.cend(), qint64(0), std::plus<qint64>(), [](int value) { return qint64(value); }, 100);
+    QCOMPARE(sum, expectedSum);
+
+    // Reduce operation need not to be commutative, partial results are reduced in order
+    std::vector<QString> strings = { "a", "b", "c", "d", "e", "f", "g" };
+    const QString concatenated = pdf::PDFExecutionPolicy::transformReduce(pdf::PDFExecutionPolicy::Scope::Content, strings.cbegin(), strings.cend(), QString(), std::plus<QString>(), [](const QString& string) { return string; });
+    QCOMPARE(concatenated, QString("abcdefg"));
+
+    std::atomic<qint64> partitionedSum = 0;
+    pdf::PDFExecutionPolicy::executePartitioned(pdf::PDFExecutionPolicy::Scope::Content, values.cbegin(), values.cend(), 500, [&partitionedSum](auto it, auto itEnd)
+    {
+        QVERIFY(std::distance(it, itEnd) >= 500);
+        partitionedSum += std::accumulate(it, itEnd, qint64(0));
+    });
+    QCOMPARE(partitionedSum.load(), expectedSum);
+
+    pdf::PDFExecutionPolicy::setStrategy(pdf::PDFExecutionPolicy::Strategy::PageMultithreaded);
+}
+
+void LexicalAnalyzerTest::test_tracing()
+{
+#ifndef PDF4QT_DISABLE_TRACING
+    {
+        PDF_TRACE_ZONE("DisabledZone", "test");
+    }
+
+    pdf::PDFTracing::start();
+    {
+        PDF_TRACE_ZONE("TestZone", "test");
+        PDF_TRACE_COUNTER("TestCounter", 42);
+
+        const quint64 flowId = PDF_TRACE_FLOW_ID();
+        QVERIFY(flowId != 0);
+        PDF_TRACE_FLOW(Begin, "TestFlow", flowId);
+        PDF_TRACE_FLOW(End, "TestFlow", flowId);
+    }
+    pdf::PDFTracing::stop();
+
+    const QByteArray trace = pdf::PDFTracing::createChromeTrace();
+    pdf::PDFTracing::clear();
+
+    QJsonParseError error;
+    QJsonDocument document = QJsonDocument::fromJson(trace, &error);
+    QCOMPARE(error.error, QJsonParseError::NoError);
+
+    QStringList names;
+    for (const QJsonValue& value : document.object().value("traceEvents").toArray())
+    {
+        names << value.toObject().value("name").toString();
+    }
+
+    QVERIFY(names.contains("TestZone"));
+    QVERIFY(names.contains("TestCounter"));
+    QCOMPARE(names.count("TestFlow"), 2);
+    QVERIFY(!names.contains("DisabledZone"));
+#endif
+}
+
+void LexicalAnalyzerTest::test_memory_report()
+{
+    pdf::PDFMemoryReport subReport;
+    subReport.addItem("A", 100, 2);
+    subReport.addItem("B", 50);
+
+    pdf::PDFMemoryReport report;
+    report.addItem("C", 10);
+    report.addReport("Session", subReport);
+    QCOMPARE(report.getItems().size(), size_t(3));
+    QCOMPARE(report.getTotalBytes(), qint64(160));
+    QCOMPARE(report.getItems()[1].name, QString("Session / A"));
+    QCOMPARE(report.getItems()[1].count, qint64(2));
+    QCOMPARE(report.getItems()[2].count, qint64(-1));
+
+    auto getPassword = [](bool* ok) { *ok = false; return QString(); };
+    pdf::PDFDocumentReader reader(nullptr, getPassword, false, false);
+    pdf::PDFDocument document = reader.readFromBuffer(createTestDocument());
+    QVERIFY(reader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+
+    pdf::PDFMemoryReport documentReport;
+    document.collectMemoryUsage(&documentReport);
+    QVERIFY(!documentReport.isEmpty());
+    QVERIFY(documentReport.getItems().front().bytes > 0);
+    QVERIFY(documentReport.getItems().front().count > 0);
+
+    // Accountable, which is unregistered, is not in the process report
+    pdf::PDFMemoryAccounting::registerAccountable(&document, "Test document");
+    const pdf::PDFMemoryReport processReport = pdf::PDFMemoryAccounting::createProcessReport();
+    pdf::PDFMemoryAccounting::unregisterAccountable(&document);
+    const pdf::PDFMemoryReport emptyProcessReport = pdf::PDFMemoryAccounting::createProcessReport();
+
+    auto hasDocumentItems = [](const pdf::PDFMemoryReport& report)
+    {
+        return std::any_of(report.getItems().cbegin(), report.getItems().cend(), [](const auto& item) { return item.name.startsWith("Test document / "); });
+    };
+    QVERIFY(hasDocumentItems(processReport));
+    QVERIFY(!hasDocumentItems(emptyProcessReport));
+}
+
+void LexicalAnalyzerTest::test_snap_point_index()
+{
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<pdf::PDFReal> distribution(-100.0, 500.0);
+
+    std::vector<QPointF> points;
+    for (size_t i = 0; i < 5000; ++i)
+    {
+        points.emplace_back(distribution(generator), distribution(generator));
+    }
+
+    // Duplicated, degenerated and invalid points
+    points.push_back(points.front());
+    points.emplace_back(std::numeric_limits<pdf::PDFReal>::quiet_NaN(), 0.0);
+    points.emplace_back(std::numeric_limits<pdf::PDFReal>::infinity(), 10.0);
+
+    pdf::PDFSnapPointIndex index(points);
+
+    std::vector<size_t> indices;
+    for (size_t i = 0; i < 200; ++i)
+    {
+        const pdf::PDFReal x = distribution(generator);
+        const pdf::PDFReal y = distribution(generator);
+        const pdf::PDFReal size = (i % 10) * 5.0;
+        QRectF rect(x, y, size, size);
+
+        std::vector<size_t> expectedIndices;
+        for (size_t j = 0; j < points.size(); ++j)
+        {
+            if (rect.contains(points[j]))
+            {
+                expectedIndices.push_back(j);
+            }
+        }
+
+        index.query(rect, indices);
+        QCOMPARE(indices, expectedIndices);
+    }
+
+    // Whole plane
+    index.query(QRectF(-1000.0, -1000.0, 3000.0, 3000.0), indices);
+    QCOMPARE(indices.size(), size_t(5001));
+
+    // Points on a single line
+    pdf::PDFSnapPointIndex lineIndex({ QPointF(0.0, 5.0), QPointF(10.0, 5.0), QPointF(20.0, 5.0) });
+    lineIndex.query(QRectF(5.0, 0.0, 10.0, 10.0), indices);
+    QCOMPARE(indices, std::vector<size_t>({ 1 }));
+
+    pdf::PDFSnapPointIndex emptyIndex((std::vector<QPointF>()));
+    emptyIndex.query(QRectF(0.0, 0.0, 10.0, 10.0), indices);
+    QVERIFY(indices.empty());
+}
+
+void LexicalAnalyzerTest::test_rectangle_tree()
+{
+    std::mt19937 generator(11);
+    std::uniform_real_distribution<pdf::PDFReal> positionDistribution(0.0, 1000.0);
+    std::uniform_real_distribution<pdf::PDFReal> sizeDistribution(0.0, 30.0);
+
+    auto intersects = [](const QRectF& l, const QRectF& r)
+    {
+        return l.left() <= r.right() && r.left() <= l.right() && l.top() <= r.bottom() && r.top() <= l.bottom();
+    };
+
+    for (size_t count : { 0, 1, 16, 17, 257, 5000 })
+    {
+        std::vector<QRectF> rectangles;
+        for (size_t i = 0; i < count; ++i)
+        {
+            rectangles.emplace_back(positionDistribution(generator), positionDistribution(generator), sizeDistribution(generator), sizeDistribution(generator));
+        }
+
+        pdf::PDFRectangleTree tree(rectangles);
+        QCOMPARE(tree.isEmpty(), count == 0);
+
+        std::vector<size_t> indices;
+        for (size_t i = 0; i < 200; ++i)
+        {
+            QRectF rectangle(positionDistribution(generator), positionDistribution(generator), sizeDistribution(generator) * (i % 3), sizeDistribution(generator) * (i % 2));
+
+            std::vector<size_t> expectedIndices;
+            for (size_t j = 0; j < rectangles.size(); ++j)
+            {
+                if (intersects(rectangles[j], rectangle))
+                {
+                    expectedIndices.push_back(j);
+                }
+            }
+
+            tree.query(rectangle, indices);
+            QCOMPARE(indices, expectedIndices);
+
+            expectedIndices.clear();
+            for (size_t j = 0; j < rectangles.size(); ++j)
+            {
+                if (intersects(rectangles[j], QRectF(rectangle.topLeft(), QSizeF(0.0, 0.0))))
+                {
+                    expectedIndices.push_back(j);
+                }
+            }
+
+            tree.query(rectangle.topLeft(), indices);
+            QCOMPARE(indices, expectedIndices);
+        }
+    }
+
+    // Boundary of the rectangle belongs to the rectangle
+    pdf::PDFRectangleTree tree({ QRectF(0.0, 0.0, 10.0, 10.0), QRectF(10.0, 10.0, 5.0, 5.0) });
+    std::vector<size_t> indices;
+    tree.query(QPointF(10.0, 10.0), indices);
+    QCOMPARE(indices, std::vector<size_t>({ 0, 1 }));
+    tree.query(QPointF(16.0, 10.0), indices);
+    QVERIFY(indices.empty());
+}
+
+void LexicalAnalyzerTest::test_page_tree_lazy_loading()
+{
+    QByteArray buffer = createTestDocument();
+    auto getPassword = [](bool* ok) { *ok = false; return QString(); };
+
+    pdf::PDFDocumentReader reader(nullptr, getPassword, false, false);
+    pdf::PDFDocument baseDocument = reader.readFromBuffer(buffer);
+    QVERIFY(reader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+
+    const size_t pageCount = 1500;
+    auto generatePage = [](size_t index)
+    {
+        pdf::PDFDocumentBuilder::BatchPage page;
+        page.mediaBox = QRectF(0, 0, pdf::PDFReal(index + 1), 100);
+        return page;
+    };
+
+    pdf::PDFDocumentBuilder builder(&baseDocument);
+    std::vector<pdf::PDFObjectReference> pages = builder.appendPages(pageCount, generatePage, true);
+    pdf::PDFDocument builtDocument = builder.build();
+
+    // Copied document must refer to its own storage
+    pdf::PDFDocument document(builtDocument);
+    builtDocument = pdf::PDFDocument();
+
+    const pdf::PDFObject& pageTreeRoot = document.getDictionaryFromObject(document.getTrailerDictionary()->get("Root"))->get("Pages");
+    std::vector<pdf::PDFPage> eagerPages = pdf::PDFPage::parse(&document.getStorage(), pageTreeRoot);
+
+    const pdf::PDFCatalog* catalog = document.getCatalog();
+    QCOMPARE(catalog->getPageCount(), eagerPages.size());
+    QCOMPARE(catalog->getPageCount(), pageCount + 1);
+
+    // Access pages in reverse order, so they are not loaded sequentially
+    for (size_t i = pageCount; i > 0; --i)
+    {
+        QCOMPARE(catalog->getPageIndexFromPageReference(pages[i - 1]), i);
+    }
+
+    for (size_t i = 0; i < eagerPages.size(); ++i)
+    {
+        const pdf::PDFPage* page = catalog->getPage(i);
+        QCOMPARE(page->getPageReference(), eagerPages[i].getPageReference());
+        QCOMPARE(page->getMediaBox(), eagerPages[i].getMediaBox());
+        QCOMPARE(page->getCropBox(), eagerPages[i].getCropBox());
+        QCOMPARE(page->getPageRotation(), eagerPages[i].getPageRotation());
+    }
+
+    QCOMPARE(catalog->getPageIndexFromPageReference(pdf::PDFObjectReference(document.getStorage().getObjectCount() + 10, 0)), pdf::PDFCatalog::INVALID_PAGE_INDEX);
+}
+
+void LexicalAnalyzerTest::test_name_tree_lookup()
+{
+    pdf::PDFObjectStorage storage;
+    auto getKey = [](int i) { return QByteArray("name") + QByteArray::number(i).rightJustified(5, '0'); };
+    auto getObject = [](const pdf::PDFObjectStorage*, const pdf::PDFObject& object) { return object; };
+    auto createDictionary = [](pdf::PDFDictionary dictionary) { return pdf::PDFObject::createDictionary(std::make_shared<pdf::PDFDictionary>(qMove(dictionary))); };
+    auto createArray = [](pdf::PDFArray array) { return pdf::PDFObject::createArray(std::make_shared<pdf::PDFArray>(qMove(array))); };
+
+    // Leaves with 100 names each, last leaf doesn't have limits
+    const int leafCount = 8;
+    const int itemsPerLeaf = 100;
+    pdf::PDFArray kids;
+    for (int leaf = 0; leaf < leafCount; ++leaf)
+    {
+        pdf::PDFArray names;
+        for (int i = leaf * itemsPerLeaf; i < (leaf + 1) * itemsPerLeaf; ++i)
+        {
+            names.appendItem(pdf::PDFObject::createString(getKey(i)));
+            names.appendItem(pdf::PDFObject::createInteger(i));
+        }
+
+        pdf::PDFDictionary leafDictionary;
+        leafDictionary.addEntry(pdf::PDFInplaceOrMemoryString("Names"), createArray(qMove(names)));
+
+        if (leaf + 1 < leafCount)
+        {
+            pdf::PDFArray limits;
+            limits.appendItem(pdf::PDFObject::createString(getKey(leaf * itemsPerLeaf)));
+            limits.appendItem(pdf::PDFObject::createString(getKey((leaf + 1) * itemsPerLeaf - 1)));
+            leafDictionary.addEntry(pdf::PDFInplaceOrMemoryString("Limits"), createArray(qMove(limits)));
+        }
+
+        kids.appendItem(pdf::PDFObject::createReference(storage.addObject(createDictionary(qMove(leafDictionary)))));
+    }
+
+    pdf::PDFDictionary rootDictionary;
+    rootDictionary.addEntry(pdf::PDFInplaceOrMemoryString("Kids"), createArray(qMove(kids)));
+    pdf::PDFObject root = pdf::PDFObject::createReference(storage.addObject(createDictionary(qMove(rootDictionary))));
+
+    auto allItems = pdf::PDFNameTreeLoader<pdf::PDFObject>::parse(&storage, root, getObject);
+    QCOMPARE(allItems.size(), size_t(leafCount * itemsPerLeaf));
+
+    for (const auto& item : allItems)
+    {
+        std::optional<pdf::PDFObject> object = pdf::PDFNameTreeLoader<pdf::PDFObject>::find(&storage, root, item.first, getObject);
+        QVERIFY(object.has_value());
+        QCOMPARE(object->getInteger(), item.second.getInteger());
+    }
+
+    QVERIFY(!pdf::PDFNameTreeLoader<pdf::PDFObject>::find(&storage, root, "name", getObject).has_value());
+    QVERIFY(!pdf::PDFNameTreeLoader<pdf::PDFObject>::find(&storage, root, getKey(leafCount * itemsPerLeaf), getObject).has_value());
+    QVERIFY(!pdf::PDFNameTreeLoader<pdf::PDFObject>::find(&storage, root, getKey(150) + "x", getObject).has_value());
+}
+
+void LexicalAnalyzerTest::test_structure_tree_lazy_loading()
+{
+    pdf::PDFObjectStorage storage;
+    auto createDictionary = [](pdf::PDFDictionary dictionary) { return pdf::PDFObject::createDictionary(std::make_shared<pdf::PDFDictionary>(qMove(dictionary))); };
+    auto createArray = [](pdf::PDFArray array) { return pdf::PDFObject::createArray(std::make_shared<pdf::PDFArray>(qMove(array))); };
+
+    // Structure tree root -> Document -> 100 paragraphs, each one with MCID
+    const pdf::PDFObjectReference rootReference = storage.addObject(pdf::PDFObject());
+    const pdf::PDFObjectReference documentReference = storage.addObject(pdf::PDFObject());
+
+    const int paragraphCount = 100;
+    pdf::PDFArray paragraphs;
+    pdf::PDFArray parents;
+    std::vector<pdf::PDFObjectReference> paragraphReferences;
+    for (int i = 0; i < paragraphCount; ++i)
+    {
+        pdf::PDFDictionary paragraph;
+        paragraph.addEntry(pdf::PDFInplaceOrMemoryString("S"), pdf::PDFObject::createName("P"));
+        paragraph.addEntry(pdf::PDFInplaceOrMemoryString("P"), pdf::PDFObject::createReference(documentReference));
+        paragraph.addEntry(pdf::PDFInplaceOrMemoryString("K"), pdf::PDFObject::createInteger(i));
+        paragraph.addEntry(pdf::PDFInplaceOrMemoryString("T"), pdf::PDFObject::createString(QByteArray("Paragraph ") + QByteArray::number(i)));
+        paragraphReferences.push_back(storage.addObject(createDictionary(qMove(paragraph))));
+        paragraphs.appendItem(pdf::PDFObject::createReference(paragraphReferences.back()));
+        parents.appendItem(pdf::PDFObject::createReference(paragraphReferences.back()));
+    }
+
+    // Cycle, last kid of the document refers to the document itself
+    paragraphs.appendItem(pdf::PDFObject::createReference(documentReference));
+
+    pdf::PDFDictionary document;
+    document.addEntry(pdf::PDFInplaceOrMemoryString("S"), pdf::PDFObject::createName("Document"));
+    document.addEntry(pdf::PDFInplaceOrMemoryString("P"), pdf::PDFObject::createReference(rootReference));
+    document.addEntry(pdf::PDFInplaceOrMemoryString("K"), createArray(qMove(paragraphs)));
+    storage.setObject(documentReference, createDictionary(qMove(document)));
+
+    pdf::PDFArray nums;
+    nums.appendItem(pdf::PDFObject::createInteger(0));
+    nums.appendItem(createArray(qMove(parents)));
+    pdf::PDFDictionary parentTree;
+    parentTree.addEntry(pdf::PDFInplaceOrMemoryString("Nums"), createArray(qMove(nums)));
+
+    pdf::PDFArray rootKids;
+    rootKids.appendItem(pdf::PDFObject::createReference(documentReference));
+    pdf::PDFDictionary root;
+    root.addEntry(pdf::PDFInplaceOrMemoryString("Type"), pdf::PDFObject::createName("StructTreeRoot"));
+    root.addEntry(pdf::PDFInplaceOrMemoryString("K"), createArray(qMove(rootKids)));
+    root.addEntry(pdf::PDFInplaceOrMemoryString("ParentTree"), createDictionary(qMove(parentTree)));
+    storage.setObject(rootReference, createDictionary(qMove(root)));
+
+    pdf::PDFStructureTree parsedTree = pdf::PDFStructureTree::parse(&storage, pdf::PDFObject::createReference(rootReference));
+    QVERIFY(parsedTree.isValid());
+
+    // Tree must remain valid after it is moved
+    pdf::PDFStructureTree tree;
+    tree = std::move(parsedTree);
+
+    // Lookup of the item loads only path to the item
+    for (int i = paragraphCount - 1; i >= 0; --i)
+    {
+        const pdf::PDFObjectReference parentReference = tree.getParent(0, i);
+        QCOMPARE(parentReference, paragraphReferences[i]);
+
+        const pdf::PDFStructureItem* item = tree.getItem(parentReference);
+        QVERIFY(item);
+        QVERIFY(item->asStructureElement());
+        QVERIFY(item->getTree() == &tree);
+        QCOMPARE(item->getSelfReference(), paragraphReferences[i]);
+        QCOMPARE(item->asStructureElement()->getStandardType(), pdf::PDFStructureItem::P);
+        QCOMPARE(item->asStructureElement()->getText(pdf::PDFStructureElement::Title), QString("Paragraph %1").arg(i));
+        QVERIFY(item->asStructureElement()->getText(pdf::PDFStructureElement::Language).isEmpty());
+        QCOMPARE(item->getParent()->getSelfReference(), documentReference);
+        QVERIFY(item->getParent()->getParent() == &tree);
+    }
+
+    QCOMPARE(tree.getParent(0, paragraphCount), pdf::PDFObjectReference());
+    QCOMPARE(tree.getParent(1, 0), pdf::PDFObjectReference());
+    QVERIFY(!tree.getItem(pdf::PDFObjectReference(storage.getObjectCount() + 1, 0)));
+
+    // Cyclic kid is skipped
+    QCOMPARE(tree.getChildCount(), size_t(1));
+    QCOMPARE(tree.getChild(0)->getChildCount(), size_t(paragraphCount));
+}
+
+void LexicalAnalyzerTest::test_glyph_name_to_unicode()
+{
+    QCOMPARE(pdf::PDFNameToUnicode::getUnicodeForName("A"), QChar(0x0041));
+    QCOMPARE(pdf::PDFNameToUnicode::getUnicodeForName("zukatakana"), QChar(0x30BA));
+    QCOMPARE(pdf::PDFNameToUnicode::getUnicodeForName("universal"), QChar(0x2200));
+    QVERIFY(pdf::PDFNameToUnicode::getUnicodeForName("nonexistingglyph").isNull());
+    QVERIFY(pdf::PDFNameToUnicode::getUnicodeForName(QByteArray()).isNull());
+    QCOMPARE(pdf::PDFNameToUnicode::getUnicodeForNameZapfDingbats("a1"), QChar(0x2701));
+    QVERIFY(pdf::PDFNameToUnicode::getUnicodeForNameZapfDingbats("A").isNull());
+
+    QCOMPARE(pdf::PDFNameToUnicode::getUnicodeUsingResolvedName("a99"), QChar(0x275D));
+    QCOMPARE(pdf::PDFNameToUnicode::getUnicodeUsingResolvedName("uni00E9"), QChar(0x00E9));
+    QCOMPARE(pdf::PDFNameToUnicode::getUnicodeUsingResolvedName("uni00e9"), QChar(0x00E9));
+    QCOMPARE(pdf::PDFNameToUnicode::getUnicodeUsingResolvedName("u1E95"), QChar(0x1E95));
+    QCOMPARE(pdf::PDFNameToUnicode::getUnicodeUsingResolvedName("u00FF5A"), QChar(0xFF5A));
+    QCOMPARE(pdf::PDFNameToUnicode::getUnicodeUsingResolvedName("union"), QChar(0x222A));
+    QCOMPARE(pdf::PDFNameToUnicode::getUnicodeUsingResolvedName("udieresis"), QChar(0x00FC));
+    QVERIFY(pdf::PDFNameToUnicode::getUnicodeUsingResolvedName("u1F600").isNull());
+    QVERIFY(pdf::PDFNameToUnicode::getUnicodeUsingResolvedName("uniXYZW").isNull());
+
+    QCOMPARE(pdf::PDFNameToUnicode::getNameForUnicode(QChar(0x0041)), QByteArray("A"));
+    QCOMPARE(pdf::PDFNameToUnicode::getNameForUnicode(QChar(0x30BA)), QByteArray("zukatakana"));
+    QCOMPARE(pdf::PDFNameToUnicode::getNameForUnicodeZapfDingbats(QChar(0x2701)), QByteArray("a1"));
+    QVERIFY(pdf::PDFNameToUnicode::getNameForUnicode(QChar(0x0001)).isEmpty());
+
+    for (char16_t code = 0x20; code < 0x7F; ++code)
+    {
+        const QByteArray name = pdf::PDFNameToUnicode::getNameForUnicode(QChar(code));
+        if (!name.isEmpty())
+        {
+            QCOMPARE(pdf::PDFNameToUnicode::getUnicodeForName(name), QChar(code));
+        }
+    }
+}
+
+void LexicalAnalyzerTest::test_encoding_span_conversion()
+{
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> distribution(0, 255);
+    std::uniform_int_distribution<int> asciiDistribution(0x20, 0x7E);
+
+    const pdf::PDFEncoding::Encoding encodings[] = { pdf::PDFEncoding::Encoding::Standard,
+                                                     pdf::PDFEncoding::Encoding::MacRoman,
+                                                     pdf::PDFEncoding::Encoding::WinAnsi,
+                                                     pdf::PDFEncoding::Encoding::PDFDoc,
+                                                     pdf::PDFEncoding::Encoding::Symbol };
+
+    for (int length : { 0, 1, 15, 16, 17, 63, 100 })
+    {
+        QByteArray ascii;
+        QByteArray mixed;
+        for (int i = 0; i < length; ++i)
+        {
+            ascii.push_back(char(asciiDistribution(generator)));
+            mixed.push_back(char((i % 20 == 19) ? distribution(generator) : asciiDistribution(generator)));
+        }
+
+        QVERIFY(pdf::PDFEncoding::isPrintableAscii(ascii));
+        QCOMPARE(pdf::PDFEncoding::convertTextString(ascii), QString::fromLatin1(ascii));
+
+        for (const QByteArray& stream : { ascii, mixed })
+        {
+            for (pdf::PDFEncoding::Encoding encoding : encodings)
+            {
+                const pdf::encoding::EncodingTable* table = pdf::PDFEncoding::getTableForEncoding(encoding);
+                QString expected;
+                for (const char character : stream)
+                {
+                    expected.push_back((*table)[static_cast<unsigned char>(character)]);
+                }
+
+                QCOMPARE(pdf::PDFEncoding::convert(stream, encoding), expected);
+            }
+        }
+
+        QString text;
+        for (int i = 0; i < length; ++i)
+        {
+            text.push_back(QChar(char16_t(distribution(generator) * 97 + 1)));
+        }
+
+        QByteArray utf16BE("\xFE\xFF", 2);
+        for (QChar character : text)
+        {
+            utf16BE.push_back(char(character.unicode() >> 8));
+            utf16BE.push_back(char(character.unicode() & 0xFF));
+        }
+
+        QCOMPARE(pdf::PDFEncoding::convertTextString(utf16BE), text);
+    }
+
+    QVERIFY(!pdf::PDFEncoding::isPrintableAscii(QByteArray("0123456789abcdef\x7F", 17)));
+    QVERIFY(!pdf::PDFEncoding::isPrintableAscii(QByteArray("0123456789abcdef\x80")));
+    QVERIFY(!pdf::PDFEncoding::isPrintableAscii(QByteArray("0123456789\tabcdef")));
+}
+
+void LexicalAnalyzerTest::test_number_scanning_benchmark()
+{
+    // Synthetic vector-heavy content stream - paths with curves, rectangles,
+    // transformation matrices and colors, as produced by CAD or chart exporters.
+    std::mt19937 generator(0);
+    std::uniform_real_distribution<double> coordinate(0.0, 842.0);
+    std::uniform_real_distribution<double> color(0.0, 1.0);
+
+    QByteArray content;
+    for (int i = 0; i < 20000; ++i)
+    {
+        content += QByteArray::number(color(generator), 'f', 3) + " " + QByteArray::number(color(generator), 'f', 3) + " " + QByteArray::number(color(generator), 'f', 3) + " rg\n";
+        content += "1 0 0 1 " + QByteArray::number(coordinate(generator), 'f', 2) + " " + QByteArray::number(coordinate(generator), 'f', 2) + " cm\n";
+        content += QByteArray::number(coordinate(generator), 'f', 4) + " " + QByteArray::number(coordinate(generator), 'f', 4) + " m\n";
+
+        for (int j = 0; j < 3; ++j)
+        {
+            content += QByteArray::number(coordinate(generator), 'f', 4) + " " + QByteArray::number(coordinate(generator), 'f', 4) + " ";
+        }
+        content += "c\n";
+        content += QByteArray::number(int(coordinate(generator))) + " " + QByteArray::number(int(coordinate(generator))) + " 10 -20 re f\n";
+    }
+
+    pdf::PDFLexicalAnalyzer::TypedToken token;
+    int numbers = 0;
+    pdf::PDFReal sum = 0.0;
+
+    QBENCHMARK
+    {
+        pdf::PDFLexicalAnalyzer analyzer(content.constData(), content.constData() + content.size());
+        numbers = 0;
+        sum = 0.0;
+
+        for (analyzer.fetch(token); token.type != pdf::PDFLexicalAnalyzer::TokenType::EndOfFile; analyzer.fetch(token))
+        {
+            if (token.type == pdf::PDFLexicalAnalyzer::TokenType::Integer || token.type == pdf::PDFLexicalAnalyzer::TokenType::Real)
+            {
+                sum += token.getNumber();
+                ++numbers;
+            }
+        }
+    }
+
+    QCOMPARE(numbers, 20000 * 21);
+    QVERIFY(std::isfinite(sum));
+}
+
+void LexicalAnalyzerTest::test_xref_table_fixed_width_records()
+{
+    // Large section (parsed in parallel) with two subsections - first subsection
+    // is formed by free records, second one by occupied records.
+    constexpr int objectCount = 50000;
+
+    QByteArray section = "xref\n0 " + QByteArray::number(objectCount) + "\n";
+    for (int i = 0; i < objectCount; ++i)
+    {
+        section += (i == 0) ? "0000000000 65535 f\r\n" : "0000000000 00000 f\r\n";
+    }
+
+    section += QByteArray::number(objectCount) + " " + QByteArray::number(objectCount) + "\n";
+    for (int i = 0; i < objectCount; ++i)
+    {
+        section += QByteArray::number(100 + i * 10).rightJustified(10, '0') + " " + QByteArray::number(i % 3).rightJustified(5, '0') + " n \n";
+    }
+    section += "trailer\n<< /Size " + QByteArray::number(objectCount * 2) + " >>\n";
+
+    // Records with single character end of line are not according to the specification,
+    // they must be read by the tolerant parser with the same result.
+    QByteArray damagedSection = section;
+    damagedSection.replace(" n \n", " n\n");
+
+    auto readTable = [](const QByteArray& data)
+    {
+        pdf::PDFParsingContext context([](pdf::PDFParsingContext*, pdf::PDFObjectReference) { return pdf::PDFObject(); });
+        pdf::PDFXRefTable table;
+        table.readXRefTable(&context, data, 0, nullptr);
+        return table;
+    };
+
+    pdf::PDFXRefTable table = readTable(section);
+    pdf::PDFXRefTable damagedTable = readTable(damagedSection);
+
+    QCOMPARE(table.getSize(), size_t(objectCount * 2));
+    QCOMPARE(damagedTable.getSize(), table.getSize());
+    QVERIFY(table.getTrailerDictionary().isDictionary());
+
+    for (size_t i = 0; i < table.getSize(); ++i)
+    {
+        const pdf::PDFXRefTable::Entry& entry = table.getEntries()[i];
+        const pdf::PDFXRefTable::Entry& damagedEntry = damagedTable.getEntries()[i];
+
+        QCOMPARE(entry.type, damagedEntry.type);
+        QCOMPARE(entry.offset, damagedEntry.offset);
+        QCOMPARE(entry.reference, damagedEntry.reference);
+    }
+
+    const pdf::PDFXRefTable::Entry& lastEntry = table.getEntries().back();
+    QCOMPARE(lastEntry.type, pdf::PDFXRefTable::EntryType::Occupied);
+    QCOMPARE(lastEntry.offset, pdf::PDFInteger(100 + (objectCount - 1) * 10));
+    QCOMPARE(lastEntry.reference, pdf::PDFObjectReference(objectCount * 2 - 1, (objectCount - 1) % 3));
+    QCOMPARE(table.getEntries()[objectCount - 1].type, pdf::PDFXRefTable::EntryType::Free);
+}
+
+void LexicalAnalyzerTest::test_function_apply_many()
+{
+    // Batch evaluation must give the same results as evaluation tuple by tuple
+    auto compare = [](const pdf::PDFFunction* function)
+    {
+        const size_t count = 401;
+        const uint32_t n = function->getOutputVariableCount();
+
+        std::vector<pdf::PDFReal> input(count, 0.0);
+        for (size_t k = 0; k < count; ++k)
+        {
+            input[k] = -0.5 + 2.0 * pdf::PDFReal(k) / pdf::PDFReal(count - 1);
+        }
+
+        std::vector<pdf::PDFReal> outputValues(count * n, -1.0);
+        std::vector<pdf::PDFFunction::iterator> outputs(n, nullptr);
+        for (uint32_t j = 0; j < n; ++j)
+        {
+            outputs[j] = outputValues.data() + j * count;
+        }
+
+        const pdf::PDFFunction::const_iterator inputs = input.data();
+        if (!function->applyMany(&inputs, outputs.data(), count))
+        {
+            return false;
+        }
+
+        std::vector<pdf::PDFReal> expected(n, 0.0);
+        for (size_t k = 0; k < count; ++k)
+        {
+            if (!function->apply(&input[k], &input[k] + 1, expected.data(), expected.data() + n))
+            {
+                return false;
+            }
+
+            for (uint32_t j = 0; j < n; ++j)
+            {
+                if (!qFuzzyCompare(1.0 + expected[j], 1.0 + outputs[j][k]))
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    };
+
+    {
+        QByteArray data = " << "
+                          "     /FunctionType 3 "
+                          "     /Domain [ 0 1 ] "
+                          "     /Bounds [ 0.25 0.6 ] "
+                          "     /Encode [ 0 1 1 0 0 1 ] "
+                          "     /Range [ 0 1 0 1 ] "
+                          "     /Functions [ << /FunctionType 2 /Domain [ 0 1 ] /C0 [ 0 1 ] /C1 [ 1 0 ] /N 2.2 >> "
+                          "                  << /FunctionType 2 /Domain [ 0 1 ] /C0 [ 0.5 0.5 ] /C1 [ 1 0.25 ] /N 1 >> "
+                          "                  << /FunctionType 2 /Domain [ 0 1 ] /C0 [ 0 0 ] /C1 [ 2 -1 ] /N 0.5 >> ] "
+                          " >> ";
+
+        pdf::PDFDocument document;
+        pdf::PDFParser parser(data, nullptr, pdf::PDFParser::None);
+        pdf::PDFFunctionPtr function = pdf::PDFFunction::createFunction(&document, parser.getObject());
+
+        QVERIFY(function);
+        QVERIFY(compare(function.get()));
+    }
+
+    {
+        const char data[] = " << "
+                            "     /FunctionType 0 "
+                            "     /Domain [ 0 1 ] "
+                            "     /Range [ 0 1 0 1 0 1 ] "
+                            "     /Size [ 4 ] "
+                            "     /BitsPerSample 8 "
+                            "     /Length 12 "
+                            " >> "
+                            " stream\n\000\377\200\100\040\300\377\000\020\200\200\200 endstream ";
+
+        pdf::PDFDocument document;
+        pdf::PDFParser parser(data, data + std::size(data), nullptr, pdf::PDFParser::AllowStreams);
+        pdf::PDFFunctionPtr function = pdf::PDFFunction::createFunction(&document, parser.getObject());
+
+        QVERIFY(function);
+        QVERIFY(compare(function.get()));
+    }
+}
+
+void LexicalAnalyzerTest::test_axis_aligned_rectangle_path()
+{
+    QPainterPath rectPath;
+    rectPath.addRect(QRectF(10.0, 20.0, 30.0, 40.0));
+    QCOMPARE(pdf::PDFPainterHelper::getAxisAlignedRectangle(rectPath), QRectF(10.0, 20.0, 30.0, 40.0));
+
+    // Rectangle drawn in opposite direction, without explicit closing line
+    QPainterPath reversedPath;
+    reversedPath.moveTo(40.0, 60.0);
+    reversedPath.lineTo(40.0, 20.0);
+    reversedPath.lineTo(10.0, 20.0);
+    reversedPath.lineTo(10.0, 60.0);
+    QCOMPARE(pdf::PDFPainterHelper::getAxisAlignedRectangle(reversedPath), QRectF(10.0, 20.0, 30.0, 40.0));
+
+    QPainterPath rotatedPath = QTransform().rotate(30.0).map(rectPath);
+    QVERIFY(!pdf::PDFPainterHelper::getAxisAlignedRectangle(rotatedPath).isValid());
+
+    QPainterPath ellipsePath;
+    ellipsePath.addEllipse(QRectF(10.0, 20.0, 30.0, 40.0));
+    QVERIFY(!pdf::PDFPainterHelper::getAxisAlignedRectangle(ellipsePath).isValid());
+
+    QPainterPath twoRectsPath = rectPath;
+    twoRectsPath.addRect(QRectF(100.0, 100.0, 10.0, 10.0));
+    QVERIFY(!pdf::PDFPainterHelper::getAxisAlignedRectangle(twoRectsPath).isValid());
+
+    QPainterPath degeneratePath;
+    degeneratePath.addRect(QRectF(10.0, 20.0, 0.0, 40.0));
+    QVERIFY(!pdf::PDFPainterHelper::getAxisAlignedRectangle(degeneratePath).isValid());
+}
+
+void LexicalAnalyzerTest::test_path_coverage_rasterizer()
+{
+    const QRect rect(10, 20, 10, 10);
+
+    auto getTotalCoverage = [&rect](const pdf::PDFPathCoverageRasterizer& rasterizer)
+    {
+        double total = 0.0;
+        for (int y = rect.top(); y <= rect.bottom(); ++y)
+        {
+            for (int x = rect.left(); x <= rect.right(); ++x)
+            {
+                total += rasterizer.getCoverage(QPoint(x, y));
+            }
+        }
+        return total;
+    };
+
+    // Rectangle with fractional borders
+    QPainterPath rectPath;
+    rectPath.addRect(QRectF(11.5, 22.5, 4.75, 4.5));
+    pdf::PDFPathCoverageRasterizer rectRasterizer(rectPath, rect);
+    QVERIFY(qAbs(getTotalCoverage(rectRasterizer) - 4.75 * 4.5) < 1e-4);
+    QVERIFY(qAbs(rectRasterizer.getCoverage(QPoint(11, 22)) - 0.25) < 1e-5);
+    QVERIFY(qAbs(rectRasterizer.getCoverage(QPoint(13, 24)) - 1.0) < 1e-5);
+    QVERIFY(qAbs(rectRasterizer.getCoverage(QPoint(16, 24)) - 0.25) < 1e-5);
+    QCOMPARE(rectRasterizer.getCoverage(QPoint(18, 24)), 0.0f);
+    QCOMPARE(rectRasterizer.getCoverage(QPoint(0, 0)), 0.0f);
+
+    // Triangle, which crosses left border of the rectangle
+    QPainterPath trianglePath;
+    trianglePath.moveTo(7.0, 20.0);
+    trianglePath.lineTo(16.0, 29.0);
+    trianglePath.lineTo(19.0, 20.0);
+    trianglePath.closeSubpath();
+    pdf::PDFPathCoverageRasterizer triangleRasterizer(trianglePath, rect);
+    QVERIFY(qAbs(getTotalCoverage(triangleRasterizer) - (0.5 * 12.0 * 9.0 - 0.5 * 3.0 * 3.0)) < 1e-4);
+
+    // Same rectangle twice, with even-odd fill rule it is empty,
+    // with nonzero winding fill rule it is covered once.
+    QPainterPath doubleRectPath;
+    doubleRectPath.addRect(QRectF(12.0, 22.0, 4.0, 4.0));
+    doubleRectPath.addRect(QRectF(12.0, 22.0, 4.0, 4.0));
+    doubleRectPath.setFillRule(Qt::OddEvenFill);
+    QVERIFY(qAbs(getTotalCoverage(pdf::PDFPathCoverageRasterizer(doubleRectPath, rect))) < 1e-4);
+    doubleRectPath.setFillRule(Qt::WindingFill);
+    QVERIFY(qAbs(getTotalCoverage(pdf::PDFPathCoverageRasterizer(doubleRectPath, rect)) - 16.0) < 1e-4);
+
+    // Interior of the rectangle is represented by one span per row
+    QPainterPath largeRectPath;
+    largeRectPath.addRect(QRectF(0.0, 0.0, 100.0, 100.0));
+    pdf::PDFPathCoverageRasterizer largeRectRasterizer(largeRectPath, rect);
+    QCOMPARE(largeRectRasterizer.getSpanCount(), size_t(rect.height()));
+    QVERIFY(qAbs(getTotalCoverage(largeRectRasterizer) - 100.0) < 1e-4);
+}
+
+void LexicalAnalyzerTest::test_color_convertor_rendered_image()
+{
+    const QList<QColor> colors = { Qt::white, Qt::black, QColor(200, 30, 40), QColor(20, 140, 90), QColor(90, 90, 250), QColor(160, 160, 160) };
+
+    QImage image(colors.size(), 2, QImage::Format_ARGB32_Premultiplied);
+    for (int i = 0; i < colors.size(); ++i)
+    {
+        image.setPixelColor(i, 0, colors[i]);
+
+        QColor semitransparentColor = colors[i];
+        semitransparentColor.setAlpha(128);
+        image.setPixelColor(i, 1, semitransparentColor);
+    }
+
+    auto isNear = [](QColor l, QColor r, int tolerance)
+    {
+        return qAbs(l.red() - r.red()) <= tolerance &&
+               qAbs(l.green() - r.green()) <= tolerance &&
+               qAbs(l.blue() - r.blue()) <= tolerance &&
+               qAbs(l.alpha() - r.alpha()) <= tolerance;
+    };
+
+    // Opaque pixels must be converted in the same way as colors
+    // are converted, semitransparent pixels keep their alpha.
+    for (const pdf::PDFColorConvertor::Mode mode : { pdf::PDFColorConvertor::Mode::InvertedColors,
+                                                     pdf::PDFColorConvertor::Mode::Grayscale,
+                                                     pdf::PDFColorConvertor::Mode::HighContrast,
+                                                     pdf::PDFColorConvertor::Mode::Bitonal })
+    {
+        pdf::PDFColorConvertor convertor;
+        convertor.setMode(mode);
+
+        QImage convertedImage = image;
+        convertor.convertRenderedImage(convertedImage);
+        QCOMPARE(convertedImage.format(), QImage::Format_ARGB32_Premultiplied);
+
+        for (int i = 0; i < colors.size(); ++i)
+        {
+            QVERIFY(isNear(convertedImage.pixelColor(i, 0), convertor.convert(colors[i], false, false), 2));
+
+            QColor expectedColor = convertor.convert(colors[i], false, false);
+            expectedColor.setAlpha(128);
+            QVERIFY(isNear(convertedImage.pixelColor(i, 1), expectedColor, 8));
+        }
+    }
+
+    // In custom colors mode, white is mapped to background color and black is mapped to foreground color
+    pdf::PDFColorConvertor convertor;
+    convertor.setMode(pdf::PDFColorConvertor::Mode::CustomColors);
+    convertor.setBackgroundColor(QColor(10, 20, 30));
+    convertor.setForegroundColor(QColor(250, 240, 0));
+
+    QImage convertedImage = image;
+    convertor.convertRenderedImage(convertedImage);
+    QVERIFY(isNear(convertedImage.pixelColor(0, 0), QColor(10, 20, 30), 0));
+    QVERIFY(isNear(convertedImage.pixelColor(1, 0), QColor(250, 240, 0), 0));
+
+    // Image is not changed in normal mode
+    pdf::PDFColorConvertor normalConvertor;
+    QImage unchangedImage = image;
+    normalConvertor.convertRenderedImage(unchangedImage);
+    QCOMPARE(unchangedImage, image);
+}
+
+void LexicalAnalyzerTest::test_document_snapshot()
+{
+    QByteArray buffer = createTestDocument();
+    auto getPassword = [](bool* ok) { *ok = false; return QString(); };
+
+    QTemporaryDir snapshotDirectory;
+    QVERIFY(snapshotDirectory.isValid());
+
+    // First reading creates the snapshot
+    pdf::PDFDocumentReader coldReader(nullptr, getPassword, false, false);
+    coldReader.setSnapshotCacheDirectory(snapshotDirectory.path());
+    pdf::PDFDocument coldDocument = coldReader.readFromBuffer(buffer);
+    QVERIFY(coldReader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+    QVERIFY(!coldDocument.getStorage().isLazy());
+    QCOMPARE(QDir(snapshotDirectory.path()).entryList(QDir::Files).size(), 1);
+
+    // Second reading uses the snapshot
+    pdf::PDFDocumentReader warmReader(nullptr, getPassword, false, false);
+    warmReader.setSnapshotCacheDirectory(snapshotDirectory.path());
+    pdf::PDFDocument warmDocument = warmReader.readFromBuffer(buffer);
+    QVERIFY(warmReader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+    QVERIFY(warmDocument.getStorage().isLazy());
+    QCOMPARE(warmDocument.getCatalog()->getPageCount(), size_t(1));
+    QVERIFY(warmDocument == coldDocument);
+
+    // Snapshot of other document is not used
+    QByteArray modifiedBuffer = buffer;
+    modifiedBuffer.replace("Hello", "World");
+    pdf::PDFDocumentReader otherReader(nullptr, getPassword, false, false);
+    otherReader.setSnapshotCacheDirectory(snapshotDirectory.path());
+    pdf::PDFDocument otherDocument = otherReader.readFromBuffer(modifiedBuffer);
+    QVERIFY(otherReader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+    QVERIFY(!otherDocument.getStorage().isLazy());
+}
+
+void LexicalAnalyzerTest::test_document_preloader()
+{
+    QByteArray buffer = createTestDocument();
+    auto getPassword = [](bool* ok) { *ok = false; return QString(); };
+
+    pdf::PDFDocumentReader eagerReader(nullptr, getPassword, false, false);
+    pdf::PDFDocument eagerDocument = eagerReader.readFromBuffer(buffer);
+
+    pdf::PDFDocumentReader lazyReader(nullptr, getPassword, false, false);
+    lazyReader.setLazyObjectLoading(true);
+    pdf::PDFDocument lazyDocument = lazyReader.readFromBuffer(buffer);
+    QVERIFY(lazyReader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+    QVERIFY(!lazyReader.getLinearizationInfo().isValid());
+
+    pdf::PDFDocumentPreloader preloader(nullptr);
+    preloader.setDocument(&lazyDocument);
+    preloader.setPriorityObjects({ 3 });
+
+    QSignalSpy spy(&preloader, &pdf::PDFDocumentPreloader::preloadingFinished);
+    preloader.start();
+    QVERIFY(spy.wait());
+
+    QVERIFY(lazyDocument.getStorage().isLazy());
+    QVERIFY(lazyDocument == eagerDocument);
+}
+
+void LexicalAnalyzerTest::test_document_data_source()
+{
+    QByteArray buffer = createTestDocument();
+    auto getPassword = [](bool* ok) { *ok = false; return QString(); };
+
+    QBuffer device(&buffer);
+    QVERIFY(device.open(QBuffer::ReadOnly));
+
+    // Blocks are fetched only once, string can span block boundary
+    {
+        pdf::PDFDocumentDataCache cache(std::make_shared<pdf::PDFDeviceDocumentDataSource>(&device), 16);
+        QCOMPARE(cache.getSize(), qint64(buffer.size()));
+
+        const qint64 endOffset = cache.fetchUntil(0, "endobj");
+        QCOMPARE(endOffset, qint64(buffer.indexOf("endobj") + 6));
+        QCOMPARE(cache.getFetchedSize(), (endOffset + 15) / 16 * 16);
+        QVERIFY(cache.getData().startsWith("%PDF-1.7"));
+
+        cache.fetch(0, endOffset);
+        QCOMPARE(cache.getFetchedSize(), (endOffset + 15) / 16 * 16);
+        QCOMPARE(cache.fetchUntil(buffer.size() - 10, "missing"), qint64(buffer.size()));
+    }
+
+    pdf::PDFDocumentReader eagerReader(nullptr, getPassword, false, false);
+    pdf::PDFDocument eagerDocument = eagerReader.readFromBuffer(buffer);
+
+    pdf::PDFDocumentReader reader(nullptr, getPassword, false, false);
+    pdf::PDFDocument document = reader.readFromDataSource(std::make_shared<pdf::PDFDeviceDocumentDataSource>(&device));
+    QVERIFY(reader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+    QVERIFY(document.getStorage().isLazy());
+    QCOMPARE(document.getCatalog()->getPageCount(), size_t(1));
+    QVERIFY(document == eagerDocument);
+}
+
+void LexicalAnalyzerTest::scanWholeStream(const char* stream)
+{
+    pdf::PDFLexicalAnalyzer analyzer(stream, stream + strlen(stream));
+
+    // Scan whole stream
+    while (!analyzer.isAtEnd())
+    {
+        analyzer.fetch();
+    }
+}
+
+void LexicalAnalyzerTest::testTokens(const char* stream, const std::vector<pdf::PDFLexicalAnalyzer::Token>& tokens)
+{
+    pdf::PDFLexicalAnalyzer analyzer(stream, stream + strlen(stream));
+
+    std::vector<pdf::PDFLexicalAnalyzer::Token> scanned;
+    scanned.reserve(tokens.size());
+
+    // Scan whole stream
+    while (!analyzer.isAtEnd())
+    {
+        scanned.emplace_back(analyzer.fetch());
+    }
+
+    QVERIFY(scanned.size() == tokens.size());
+
+    for (size_t i = 0; i < scanned.size(); ++i)
+    {
+        const pdf::PDFLexicalAnalyzer::Token& scannedItem = scanned[i];
+        const pdf::PDFLexicalAnalyzer::Token& tokenItem = scanned[i];
+
+        if (scannedItem == tokenItem)
+        {
+            continue;
+        }
+
+        if (scannedItem.type == tokenItem.type && scannedItem.type == pdf::PDFLexicalAnalyzer::TokenType::Real)
+        {
+            if (qFuzzyCompare(scannedItem.data.toDouble(), tokenItem.data.toDouble()))
+            {
+                continue;
+            }
+        }
+
+        // Now, compare scanned tokens
+        QString actual = getStringFromTokens({ scannedItem });
+        QString expected = getStringFromTokens({ tokenItem });
+        QVERIFY2(scannedItem == tokenItem, qPrintable(QString("stream: %1, actual = %2, expected = %3").arg(QString(stream), actual, expected)));
+    }
+}
+
+QByteArray LexicalAnalyzerTest::createTestDocument() const
+{
+    QByteArray content = "BT /F1 12 Tf (Hello) Tj ET";
+    std::vector<QByteArray> objects = {
+        "<< /Type /Catalog /Pages 2 0 R >>",
+        "<< /Type /Pages /Kids [3 0 R] /Count 1 >>",
+        "<< /Type /Page /Parent 2 0 R /MediaBox [0 0 612 792] /Contents 4 0 R >>",
+        "<< /Length 5 0 R >>\nstream\n" + content + "\nendstream",
+        QByteArray::number(content.size())
+    };
+
+    QByteArray buffer = "%PDF-1.7\n";
+    std::vector<qsizetype> offsets;
+    for (size_t i = 0; i < objects.size(); ++i)
+    {
+        offsets.push_back(buffer.size());
+        buffer += QByteArray::number(qint64(i + 1)) + " 0 obj\n" + objects[i] + "\nendobj\n";
+    }
+
+    const qsizetype xrefOffset = buffer.size();
+    buffer += "xref\n0 " + QByteArray::number(qint64(objects.size() + 1)) + "\n";
+    buffer += "0000000000 65535 f \n";
+    for (qsizetype offset : offsets)
+    {
+        buffer += QByteArray::number(qint64(offset)).rightJustified(10, '0') + " 00000 n \n";
     }
+    buffer += "trailer\n<< /Size " + QByteArray::number(qint64(objects.size() + 1)) + " /Root 1 0 R >>\n";
+    buffer += "startxref\n" + QByteArray::number(qint64(xrefOffset)) + "\n%%EOF\n";
+    return buffer;
 }
 
 QString LexicalAnalyzerTest::getStringFromTokens(const std::vector<pdf::PDFLexicalAnalyzer::Token>& tokens)
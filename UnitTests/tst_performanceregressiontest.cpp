@@ -0,0 +1,386 @@
+// MIT License
+//
+// Copyright (c) 2018-2025 Jakub Melka and Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <QtTest>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
+
+#include "pdfdocument.h"
+#include "pdfdocumentreader.h"
+#include "pdfconstants.h"
+#include "pdfcms.h"
+#include "pdffont.h"
+#include "pdfrenderer.h"
+#include "pdfoptionalcontent.h"
+#include "pdftextlayoutgenerator.h"
+#include "pdfmemoryreport.h"
+#include "pdfexception.h"
+
+#include <atomic>
+#include <numeric>
+#include <algorithm>
+
+/// Performance regression test. Documents of the corpus are described in the manifest
+/// (JSON file), whose path is taken from environment variable PDF4QT_PERFORMANCE_MANIFEST.
+/// If variable is not set, test is skipped. Manifest has the following format (all
+/// budgets are optional, measured values without budget are only stored in the history):
+///
+/// {
+///     "tolerance": 0.25,              // Relative tolerance of budgets
+///     "iterations": 3,                // Number of measured iterations
+///     "warmup": 1,                    // Number of iterations, which are not measured
+///     "failOnRegression": true,       // Fail, or just warn, if budget is exceeded
+///     "history": "history.json",      // File, to which results are appended
+///     "documents": [
+///         {
+///             "file": "document.pdf", // Paths are relative to the manifest
+///             "tolerance": 0.5,       // Tolerance of this document (optional)
+///             "budgets": { "open_ms": 50, "page_render_ms": 20, "text_extraction_ms": 100, "peak_memory_mb": 200 }
+///         }
+///     ]
+/// }
+///
+/// Open time and text extraction time are measured for the whole document, page render
+/// time is time of the slowest page, peak memory is the largest increase of physical memory
+/// of the process (sampled after each stage and after each rendered page) since the document
+/// was opened. Median of the measured iterations is compared with the budget.
+class PerformanceRegressionTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PerformanceRegressionTest() = default;
+    virtual ~PerformanceRegressionTest() override = default;
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void test_budgets_data();
+    void test_budgets();
+
+private:
+    struct Measurement
+    {
+        double openTime = 0.0;              ///< Time of opening of the document [ms]
+        double pageRenderTime = 0.0;        ///< Time of rendering of the slowest page [ms]
+        double textExtractionTime = 0.0;    ///< Time of creation of text layouts of all pages [ms]
+        double peakMemory = 0.0;            ///< Peak memory increase [MB]
+    };
+
+    /// Measures single iteration for the document
+    /// \param fileName File name of the document
+    Measurement measure(const QString& fileName) const;
+
+    /// Returns median of the values
+    static double getMedian(std::vector<double> values);
+
+    QDir m_manifestDirectory;
+    QJsonObject m_manifest;
+    QJsonArray m_results;
+};
+
+void PerformanceRegressionTest::initTestCase()
+{
+    const QString manifestFileName = qEnvironmentVariable("PDF4QT_PERFORMANCE_MANIFEST");
+    if (manifestFileName.isEmpty())
+    {
+        QSKIP("Performance manifest is not set (environment variable PDF4QT_PERFORMANCE_MANIFEST).");
+    }
+
+    QFile file(manifestFileName);
+    QVERIFY2(file.open(QFile::ReadOnly), qPrintable(QString("Can't open manifest '%1'.").arg(manifestFileName)));
+
+    QJsonParseError error;
+    QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &error);
+    QVERIFY2(error.error == QJsonParseError::NoError, qPrintable(error.errorString()));
+    QVERIFY2(document.isObject(), "Manifest must be a JSON object.");
+
+    m_manifest = document.object();
+    m_manifestDirectory = QFileInfo(manifestFileName).absoluteDir();
+}
+
+void PerformanceRegressionTest::cleanupTestCase()
+{
+    const QString historyFileName = m_manifest.value("history").toString();
+    if (historyFileName.isEmpty() || m_results.isEmpty())
+    {
+        return;
+    }
+
+    QFile file(m_manifestDirectory.absoluteFilePath(historyFileName));
+
+    QJsonObject history;
+    if (file.open(QFile::ReadOnly))
+    {
+        history = QJsonDocument::fromJson(file.readAll()).object();
+        file.close();
+    }
+
+    QJsonObject run;
+    run["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    run["version"] = pdf::PDF_LIBRARY_VERSION;
+    run["results"] = m_results;
+
+    QJsonArray runs = history.value("runs").toArray();
+    runs.append(run);
+    history["runs"] = runs;
+
+    if (file.open(QFile::WriteOnly | QFile::Truncate))
+    {
+        file.write(QJsonDocument(history).toJson());
+        file.close();
+    }
+    else
+    {
+        qWarning("Can't write performance history '%s'.", qPrintable(file.fileName()));
+    }
+}
+
+void PerformanceRegressionTest::test_budgets_data()
+{
+    QTest::addColumn<QJsonObject>("entry");
+
+    for (const QJsonValue& value : m_manifest.value("documents").toArray())
+    {
+        const QJsonObject entry = value.toObject();
+        QTest::newRow(qPrintable(entry.value("file").toString())) << entry;
+    }
+}
+
+void PerformanceRegressionTest::test_budgets()
+{
+    QFETCH(QJsonObject, entry);
+
+    const QString fileName = m_manifestDirectory.absoluteFilePath(entry.value("file").toString());
+    QVERIFY2(QFile::exists(fileName), qPrintable(QString("Document '%1' doesn't exist.").arg(fileName)));
+
+    const int iterations = qMax(m_manifest.value("iterations").toInt(3), 1);
+    const int warmupIterations = qMax(m_manifest.value("warmup").toInt(1), 0);
+    const double tolerance = entry.value("tolerance").toDouble(m_manifest.value("tolerance").toDouble(0.25));
+    const bool failOnRegression = m_manifest.value("failOnRegression").toBool(true);
+
+    std::vector<Measurement> measurements;
+    for (int i = 0; i < warmupIterations + iterations; ++i)
+    {
+        try
+        {
+            Measurement measurement = measure(fileName);
+            if (i >= warmupIterations)
+            {
+                measurements.push_back(measurement);
+            }
+        }
+        catch (const pdf::PDFException& exception)
+        {
+            QFAIL(qPrintable(exception.getMessage()));
+        }
+    }
+
+    auto getMedianOf = [&measurements](double Measurement::* value)
+    {
+        std::vector<double> values;
+        std::transform(measurements.cbegin(), measurements.cend(), std::back_inserter(values), [value](const Measurement& measurement) { return measurement.*value; });
+        return getMedian(qMove(values));
+    };
+
+    struct Metric
+    {
+        const char* name;
+        double value;
+    };
+
+    const Metric metrics[] = {
+        { "open_ms", getMedianOf(&Measurement::openTime) },
+        { "page_render_ms", getMedianOf(&Measurement::pageRenderTime) },
+        { "text_extraction_ms", getMedianOf(&Measurement::textExtractionTime) },
+        { "peak_memory_mb", getMedianOf(&Measurement::peakMemory) }
+    };
+
+    const QJsonObject budgets = entry.value("budgets").toObject();
+
+    QJsonObject values;
+    QJsonArray regressions;
+    QStringList messages;
+    for (const Metric& metric : metrics)
+    {
+        values[metric.name] = metric.value;
+
+        if (!budgets.contains(metric.name))
+        {
+            continue;
+        }
+
+        const double budget = budgets.value(metric.name).toDouble();
+        if (metric.value > budget * (1.0 + tolerance))
+        {
+            regressions.append(QString::fromLatin1(metric.name));
+            messages << QString("%1: %2 exceeds budget %3 (tolerance %4 %)").arg(metric.name).arg(metric.value, 0, 'f', 2).arg(budget, 0, 'f', 2).arg(tolerance * 100.0, 0, 'f', 0);
+        }
+    }
+
+    QJsonObject result;
+    result["file"] = entry.value("file").toString();
+    result["values"] = values;
+    result["regressions"] = regressions;
+    m_results.append(result);
+
+    if (!messages.isEmpty())
+    {
+        const QString message = messages.join("; ");
+        if (failOnRegression)
+        {
+            QFAIL(qPrintable(message));
+        }
+
+        qWarning("%s", qPrintable(message));
+    }
+}
+
+PerformanceRegressionTest::Measurement PerformanceRegressionTest::measure(const QString& fileName) const
+{
+    Measurement measurement;
+
+    const qint64 baseMemory = pdf::PDFMemoryAccounting::getProcessMemoryUsage();
+    qint64 peakMemory = baseMemory;
+    auto sampleMemory = [&peakMemory]()
+    {
+        peakMemory = qMax(peakMemory, pdf::PDFMemoryAccounting::getProcessMemoryUsage());
+    };
+
+    QElapsedTimer timer;
+    timer.start();
+
+    pdf::PDFDocumentReader reader(nullptr, [](bool* ok) { *ok = false; return QString(); }, true, false);
+    pdf::PDFDocument document = reader.readFromFile(fileName);
+    if (reader.getReadingResult() != pdf::PDFDocumentReader::Result::OK)
+    {
+        throw pdf::PDFException(reader.getErrorMessage());
+    }
+
+    measurement.openTime = timer.nsecsElapsed() / 1000000.0;
+    sampleMemory();
+
+    const size_t pageCount = document.getCatalog()->getPageCount();
+    std::vector<pdf::PDFInteger> pageIndices(pageCount, 0);
+    std::iota(pageIndices.begin(), pageIndices.end(), 0);
+
+    pdf::PDFOptionalContentActivity optionalContentActivity(&document, pdf::OCUsage::View, nullptr);
+    pdf::PDFCMSManager cmsManager(nullptr);
+    cmsManager.setDocument(&document);
+
+    pdf::PDFFontCache fontCache(pdf::DEFAULT_FONT_CACHE_LIMIT, pdf::DEFAULT_REALIZED_FONT_CACHE_LIMIT);
+    pdf::PDFModifiedDocument modifiedDocument(&document, &optionalContentActivity);
+    fontCache.setDocument(modifiedDocument);
+    fontCache.setCacheShrinkEnabled(nullptr, false);
+
+    pdf::PDFMeshQualitySettings meshQualitySettings;
+
+    {
+        pdf::PDFRasterizerPool rasterizerPool(&document, &fontCache, &cmsManager, &optionalContentActivity,
+                                              pdf::PDFRenderer::getDefaultFeatures(), meshQualitySettings,
+                                              pdf::PDFRasterizerPool::getDefaultRasterizerCount(), pdf::RendererEngine::Blend2D_MultiThread, nullptr);
+
+        auto imageSizeGetter = [](const pdf::PDFPage* page) -> QSize
+        {
+            return (page->getRotatedMediaBox().size() * pdf::PDF_POINT_TO_INCH * 150.0).toSize();
+        };
+
+        // Callback is called from worker threads
+        std::atomic<qint64> pageRenderTime = 0;
+        std::atomic<qint64> renderPeakMemory = peakMemory;
+        auto processImage = [&](pdf::PDFRenderedPageImage& image)
+        {
+            const qint64 time = image.pageCompileTime + image.pageRenderTime;
+            qint64 currentTime = pageRenderTime.load();
+            while (time > currentTime && !pageRenderTime.compare_exchange_weak(currentTime, time))
+            {
+                continue;
+            }
+
+            const qint64 memory = pdf::PDFMemoryAccounting::getProcessMemoryUsage();
+            qint64 currentMemory = renderPeakMemory.load();
+            while (memory > currentMemory && !renderPeakMemory.compare_exchange_weak(currentMemory, memory))
+            {
+                continue;
+            }
+        };
+        rasterizerPool.render(pageIndices, imageSizeGetter, processImage, nullptr);
+
+        measurement.pageRenderTime = pageRenderTime.load();
+        peakMemory = qMax(peakMemory, renderPeakMemory.load());
+    }
+
+    timer.restart();
+
+    pdf::PDFCMSPointer cms = cmsManager.getCurrentCMS();
+    for (size_t i = 0; i < pageCount; ++i)
+    {
+        const pdf::PDFPage* page = document.getCatalog()->getPage(i);
+        pdf::PDFTextLayoutGenerator generator(pdf::PDFRenderer::IgnoreOptionalContent, page, &document, &fontCache,
+                                              cms.data(), &optionalContentActivity, QTransform(), meshQualitySettings);
+        generator.processContents();
+        pdf::PDFTextLayout textLayout = generator.createTextLayout();
+        Q_UNUSED(textLayout);
+    }
+
+    measurement.textExtractionTime = timer.nsecsElapsed() / 1000000.0;
+    sampleMemory();
+
+    fontCache.setCacheShrinkEnabled(nullptr, true);
+
+    if (baseMemory >= 0)
+    {
+        measurement.peakMemory = (peakMemory - baseMemory) / (1024.0 * 1024.0);
+    }
+
+    return measurement;
+}
+
+double PerformanceRegressionTest::getMedian(std::vector<double> values)
+{
+    if (values.empty())
+    {
+        return 0.0;
+    }
+
+    std::sort(values.begin(), values.end());
+    const size_t middle = values.size() / 2;
+    return (values.size() % 2 == 1) ? values[middle] : (values[middle - 1] + values[middle]) * 0.5;
+}
+
+int main(int argc, char *argv[])
+{
+    // Rendering doesn't need any display, so offscreen platform is used by default
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+    {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QGuiApplication application(argc, argv);
+    PerformanceRegressionTest test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_performanceregressiontest.moc"